@@ -32,18 +32,36 @@
 
 #include <string.h>
 
+#include <algorithm>
+#include <random>
+#include <string>
 #include <vector>
 
 #include "google/ads/googleads/v13/services/google_ads_service.upbdefs.h"
 #include "google/protobuf/descriptor.pb.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/random/random.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/json/json.h"
+#include "google/protobuf/parse_batch.h"
 #include "benchmarks/descriptor.pb.h"
 #include "benchmarks/descriptor.upb.h"
 #include "benchmarks/descriptor.upbdefs.h"
 #include "benchmarks/descriptor_sv.pb.h"
+#include "benchmarks/extensions.pb.h"
+#include "benchmarks/perf_counters.h"
 #include "upb/base/internal/log2.h"
+#include "upb/hash/int_table.h"
+#include "upb/hash/str_table.h"
+#include "upb/json/decode.h"
+#include "upb/json/encode.h"
 #include "upb/mem/arena.h"
+#include "upb/mem/arena.hpp"
 #include "upb/reflection/def.hpp"
 
 upb_StringView descriptor = benchmarks_descriptor_proto_upbdefinit.descriptor;
@@ -73,6 +91,17 @@ static void BM_ArenaOneAlloc(benchmark::State& state) {
 }
 BENCHMARK(BM_ArenaOneAlloc);
 
+static void BM_ArenaOneAllocCached(benchmark::State& state) {
+  upb_Arena_SetMaxCachedBlocks(kUpb_Arena_MaxCachedBlocks);
+  for (auto _ : state) {
+    upb_Arena* arena = upb_Arena_New();
+    upb_Arena_Malloc(arena, 1);
+    upb_Arena_Free(arena);
+  }
+  upb_Arena_SetMaxCachedBlocks(0);
+}
+BENCHMARK(BM_ArenaOneAllocCached);
+
 static void BM_ArenaInitialBlockOneAlloc(benchmark::State& state) {
   for (auto _ : state) {
     upb_Arena* arena = upb_Arena_Init(buf, sizeof(buf), nullptr);
@@ -128,6 +157,171 @@ static void BM_ArenaFuseBalanced(benchmark::State& state) {
 }
 BENCHMARK(BM_ArenaFuseBalanced)->Range(2, 128);
 
+static void BM_ArenaFuseMany(benchmark::State& state) {
+  std::vector<upb_Arena*> arenas(state.range(0));
+  size_t n = 0;
+  for (auto _ : state) {
+    for (auto& arena : arenas) {
+      arena = upb_Arena_New();
+    }
+    upb_Arena_FuseMany(arenas.data(), arenas.size());
+    for (auto& arena : arenas) {
+      upb_Arena_Free(arena);
+    }
+    n += arenas.size();
+  }
+  state.SetItemsProcessed(n);
+}
+BENCHMARK(BM_ArenaFuseMany)->Range(2, 128);
+
+// Every thread fuses its own arenas into a group shared by all threads, and
+// frees them again, so the threads contend on the root of the group.
+static void BM_ArenaFuseShared(benchmark::State& state) {
+  static upb_Arena* shared;
+  if (state.thread_index() == 0) shared = upb_Arena_New();
+  std::vector<upb_Arena*> arenas(state.range(0));
+  size_t n = 0;
+  for (auto _ : state) {
+    for (auto& arena : arenas) {
+      arena = upb_Arena_New();
+      upb_Arena_Fuse(shared, arena);
+    }
+    for (auto& arena : arenas) {
+      upb_Arena_Free(arena);
+    }
+    n += arenas.size();
+  }
+  state.SetItemsProcessed(n);
+  if (state.thread_index() == 0) upb_Arena_Free(shared);
+}
+BENCHMARK(BM_ArenaFuseShared)->Range(2, 128)->ThreadRange(1, 16);
+
+// Threads taking and dropping refs on the same arena, as when many messages
+// referencing one arena are shared across threads.
+static void BM_ArenaIncRefShared(benchmark::State& state) {
+  static upb_Arena* shared;
+  if (state.thread_index() == 0) shared = upb_Arena_New();
+  for (auto _ : state) {
+    upb_Arena_IncRefFor(shared, nullptr);
+    upb_Arena_DecRefFor(shared, nullptr);
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) upb_Arena_Free(shared);
+}
+BENCHMARK(BM_ArenaIncRefShared)->ThreadRange(1, 16);
+
+static void BM_StrTableLookup(benchmark::State& state) {
+  upb::Arena arena;
+  upb_strtable table;
+  upb_strtable_init(&table, 0, arena.ptr());
+  if (state.range(1) > 0) upb_strtable_setmaxload(&table, state.range(1));
+  std::vector<std::string> keys;
+  for (int i = 0; i < state.range(0); i++) {
+    keys.push_back("google.protobuf.Field" + std::to_string(i));
+    upb_strtable_insert(&table, keys.back().data(), keys.back().size(),
+                        upb_value_int32(i), arena.ptr());
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    const std::string& key = keys[i++ % keys.size()];
+    upb_value val;
+    benchmark::DoNotOptimize(
+        upb_strtable_lookup2(&table, key.data(), key.size(), &val));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+// The second argument is the max load factor, or 0 for the default.
+BENCHMARK(BM_StrTableLookup)
+    ->ArgsProduct({{8, 64, 4096}, {0, 50, 95}});
+
+static void BM_IntTableLookup(benchmark::State& state) {
+  upb::Arena arena;
+  upb_inttable table;
+  upb_inttable_init(&table, arena.ptr());
+  // Sparse keys, which go to the hash part rather than the array part.
+  std::vector<uintptr_t> keys;
+  for (int i = 0; i < state.range(0); i++) {
+    keys.push_back(uintptr_t{1000} + i * 1000);
+    upb_inttable_insert(&table, keys.back(), upb_value_int32(i), arena.ptr());
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    upb_value val;
+    benchmark::DoNotOptimize(
+        upb_inttable_lookup(&table, keys[i++ % keys.size()], &val));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IntTableLookup)->Range(8, 4096);
+
+// Removing and inserting keys, as for a map that is updated in place.
+static void BM_IntTableChurn(benchmark::State& state) {
+  upb::Arena arena;
+  upb_inttable table;
+  upb_inttable_init(&table, arena.ptr());
+  uintptr_t n = state.range(0);
+  for (uintptr_t key = 1000; key < 1000 + n; key++) {
+    upb_inttable_insert(&table, key, upb_value_int32(0), arena.ptr());
+  }
+  uintptr_t key = 1000;
+  for (auto _ : state) {
+    upb_inttable_remove(&table, key, nullptr);
+    upb_inttable_insert(&table, key + n, upb_value_int32(0), arena.ptr());
+    key++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IntTableChurn)->Range(8, 4096);
+
+// Only the arena destructor is timed, which runs the cleanup list.
+template <bool kMixed>
+static void BM_ArenaCleanup_Proto2(benchmark::State& state) {
+  // Non-trivially destructible type that is not specially handled by the
+  // cleanup list.
+  struct Dynamic {
+    ~Dynamic() { benchmark::DoNotOptimize(value); }
+    int value = 0;
+  };
+  const int n = state.range(0);
+  for (auto _ : state) {
+    state.PauseTiming();
+    {
+      protobuf::Arena arena;
+      for (int i = 0; i < n; ++i) {
+        protobuf::Arena::Create<std::string>(&arena, 64, 'x');
+        if (kMixed) {
+          protobuf::Arena::Create<Dynamic>(&arena);
+          if (i % 4 == 0) protobuf::Arena::Create<absl::Cord>(&arena, "cord");
+        }
+      }
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK_TEMPLATE(BM_ArenaCleanup_Proto2, false)->Range(1 << 10, 1 << 16);
+BENCHMARK_TEMPLATE(BM_ArenaCleanup_Proto2, true)->Range(1 << 10, 1 << 16);
+
+// Allocates round-robin from several live arenas on the same thread, e.g.
+// request, response and session arenas.
+static void BM_ArenaInterleaved_Proto2(benchmark::State& state) {
+  std::vector<protobuf::Arena> arenas(state.range(0));
+  size_t n = 0;
+  for (auto _ : state) {
+    for (auto& arena : arenas) {
+      benchmark::DoNotOptimize(protobuf::Arena::CreateArray<char>(&arena, 16));
+    }
+    n += arenas.size();
+    if (n % (1 << 16) == 0) {
+      state.PauseTiming();
+      for (auto& arena : arenas) arena.Reset();
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(n);
+}
+BENCHMARK(BM_ArenaInterleaved_Proto2)->DenseRange(1, 4);
+
 enum LoadDescriptorMode {
   NoLayout,
   WithLayout,
@@ -210,6 +404,37 @@ static void BM_LoadAdsDescriptor_Upb(benchmark::State& state) {
 BENCHMARK_TEMPLATE(BM_LoadAdsDescriptor_Upb, NoLayout);
 BENCHMARK_TEMPLATE(BM_LoadAdsDescriptor_Upb, WithLayout);
 
+static void BM_LoadAdsDescriptorSet_Upb(benchmark::State& state) {
+  extern _upb_DefPool_Init
+      google_ads_googleads_v13_services_google_ads_service_proto_upbdefinit;
+  std::vector<upb_StringView> serialized_files;
+  absl::flat_hash_set<const _upb_DefPool_Init*> seen_files;
+  CollectFileDescriptors(
+      &google_ads_googleads_v13_services_google_ads_service_proto_upbdefinit,
+      serialized_files, seen_files);
+  // Each file is a length-delimited FileDescriptorSet.file (field 1).
+  std::string set;
+  for (auto file : serialized_files) {
+    set.push_back('\x0a');
+    size_t n = file.size;
+    for (; n >= 0x80; n >>= 7) {
+      set.push_back(static_cast<char>((n & 0x7f) | 0x80));
+    }
+    set.push_back(static_cast<char>(n));
+    set.append(file.data, file.size);
+  }
+  for (auto _ : state) {
+    upb::DefPool defpool;
+    upb::Status status;
+    if (!defpool.AddFileSet(set.data(), set.size(), &status)) {
+      printf("Failed to add files: %s\n", status.error_message());
+      exit(1);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * set.size());
+}
+BENCHMARK(BM_LoadAdsDescriptorSet_Upb);
+
 template <LoadDescriptorMode Mode>
 static void BM_LoadAdsDescriptor_Proto2(benchmark::State& state) {
   extern _upb_DefPool_Init
@@ -266,6 +491,7 @@ enum ArenaMode {
 
 template <ArenaMode AMode, CopyStrings Copy>
 static void BM_Parse_Upb_FileDesc(benchmark::State& state) {
+  benchmarks::PerfCounterScope perf(state);
   for (auto _ : state) {
     upb_Arena* arena;
     if (AMode == InitBlock) {
@@ -337,6 +563,7 @@ void BM_Parse_Proto2(benchmark::State& state) {
       kCopy == Copy
           ? protobuf::MessageLite::ParseFlags::kMergePartial
           : protobuf::MessageLite::ParseFlags::kMergePartialWithAliasing;
+  benchmarks::PerfCounterScope perf(state);
   for (auto _ : state) {
     Proto2Factory<AMode, P> proto_factory;
     auto proto = proto_factory.GetProto();
@@ -354,9 +581,232 @@ BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDesc, UseArena, Copy);
 BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDesc, InitBlock, Copy);
 BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDescSV, InitBlock, Alias);
 
+// Reuses one message for every parse, as servers that Clear() and re-parse a
+// message per request do, so only Clear() and the parse itself are measured.
+template <class P>
+void BM_ParseClearParse_Proto2(benchmark::State& state) {
+  P proto;
+  absl::string_view input(descriptor.data, descriptor.size);
+  benchmarks::PerfCounterScope perf(state);
+  for (auto _ : state) {
+    proto.Clear();
+    if (!proto.ParseFromString(input)) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * descriptor.size);
+}
+BENCHMARK_TEMPLATE(BM_ParseClearParse_Proto2, FileDesc);
+BENCHMARK_TEMPLATE(BM_ParseClearParse_Proto2, FileDescSV);
+
+// Parses a batch of tiny messages into a reused RepeatedPtrField, either one
+// ParseFromString() call per message or with one ParseBatch() call.
+template <bool kBatch>
+static void BM_ParseTinyMessages_Proto2(benchmark::State& state) {
+  std::vector<std::string> data;
+  for (int i = 0; i < 1024; ++i) {
+    FileDesc proto;
+    proto.set_name(absl::StrCat("f", i));
+    proto.add_public_dependency(i);
+    data.push_back(proto.SerializeAsString());
+  }
+  const std::vector<absl::string_view> inputs(data.begin(), data.end());
+  protobuf::RepeatedPtrField<FileDesc> output;
+  benchmarks::PerfCounterScope perf(state);
+  for (auto _ : state) {
+    output.Clear();
+    bool ok = true;
+    if (kBatch) {
+      ok = protobuf::ParseBatch(inputs, &output);
+    } else {
+      for (absl::string_view input : inputs) {
+        ok &= output.Add()->ParseFromString(input);
+      }
+    }
+    if (!ok) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * inputs.size());
+}
+BENCHMARK_TEMPLATE(BM_ParseTinyMessages_Proto2, false);
+BENCHMARK_TEMPLATE(BM_ParseTinyMessages_Proto2, true);
+
+// Merges many small serialized deltas into a message with a large repeated
+// field, as MergeFromString() of incremental updates does. Each delta appends a
+// run of unpacked elements to the base's field.
+static void BM_MergeRepeatedDelta_Proto2(benchmark::State& state) {
+  constexpr int kDeltas = 64;
+  FileDesc base;
+  for (int i = 0; i < (1 << 16); ++i) base.add_public_dependency(i);
+  FileDesc delta_proto;
+  for (int i = 0; i < state.range(0); ++i) {
+    delta_proto.add_public_dependency(i);
+  }
+  const std::string delta = delta_proto.SerializeAsString();
+  FileDesc proto;
+  for (auto _ : state) {
+    state.PauseTiming();
+    proto = base;
+    state.ResumeTiming();
+    for (int i = 0; i < kDeltas; ++i) {
+      if (!proto.MergeFromString(delta)) {
+        printf("Failed to merge.\n");
+        exit(1);
+      }
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * kDeltas * delta.size());
+}
+BENCHMARK(BM_MergeRepeatedDelta_Proto2)->Range(16, 1 << 14);
+
+// Records that carry most of their data in extensions: every record sets all
+// of Record's extensions.
+static std::string SerializedRecordList(int num_records) {
+  upb_benchmark::ext::RecordList list;
+  const protobuf::FileDescriptor* file =
+      upb_benchmark::ext::Record::descriptor()->file();
+  for (int i = 0; i < num_records; ++i) {
+    upb_benchmark::ext::Record* record = list.add_records();
+    record->set_id(i);
+    record->set_name("record");
+    const protobuf::Reflection* reflection = record->GetReflection();
+    for (int j = 0; j < file->extension_count(); ++j) {
+      const protobuf::FieldDescriptor* field = file->extension(j);
+      if (field->is_repeated()) {
+        for (int k = 0; k < 4; ++k) reflection->AddInt32(record, field, i + k);
+        continue;
+      }
+      switch (field->cpp_type()) {
+        case protobuf::FieldDescriptor::CPPTYPE_INT32:
+          reflection->SetInt32(record, field, i + j);
+          break;
+        case protobuf::FieldDescriptor::CPPTYPE_INT64:
+          reflection->SetInt64(record, field, int64_t{i} << 32);
+          break;
+        case protobuf::FieldDescriptor::CPPTYPE_UINT32:
+          reflection->SetUInt32(record, field, i);
+          break;
+        case protobuf::FieldDescriptor::CPPTYPE_BOOL:
+          reflection->SetBool(record, field, true);
+          break;
+        case protobuf::FieldDescriptor::CPPTYPE_DOUBLE:
+          reflection->SetDouble(record, field, i * 0.5);
+          break;
+        case protobuf::FieldDescriptor::CPPTYPE_STRING:
+          reflection->SetString(record, field, "value");
+          break;
+        case protobuf::FieldDescriptor::CPPTYPE_MESSAGE: {
+          auto* attribute = static_cast<upb_benchmark::ext::Attribute*>(
+              reflection->MutableMessage(record, field));
+          attribute->set_key("key");
+          attribute->set_value(i);
+          break;
+        }
+        default:
+          break;
+      }
+    }
+  }
+  return list.SerializeAsString();
+}
+
+template <ArenaMode AMode>
+static void BM_Parse_Proto2_Extensions(benchmark::State& state) {
+  const std::string data = SerializedRecordList(state.range(0));
+  benchmarks::PerfCounterScope perf(state);
+  for (auto _ : state) {
+    Proto2Factory<AMode, upb_benchmark::ext::RecordList> proto_factory;
+    auto proto = proto_factory.GetProto();
+    if (!proto->ParseFromString(data)) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK_TEMPLATE(BM_Parse_Proto2_Extensions, NoArena)->Range(1, 64);
+BENCHMARK_TEMPLATE(BM_Parse_Proto2_Extensions, UseArena)->Range(1, 64);
+
+// Parsing from streams that return the input in chunks of state.range(0)
+// bytes, or in random fragments of 1 to 4096 bytes if it is 0.  This covers
+// the slop-region handling at buffer boundaries in EpsCopyInputStream, which
+// a flat buffer never reaches.  Reports cycles per input byte, estimated from
+// the CPU frequency.
+struct DescriptorCorpus {
+  using Proto = FileDesc;
+  static std::string Data() {
+    return std::string(descriptor.data, descriptor.size);
+  }
+};
+
+struct ExtensionsCorpus {
+  using Proto = upb_benchmark::ext::RecordList;
+  static std::string Data() { return SerializedRecordList(64); }
+};
+
+static std::vector<absl::string_view> RandomFragments(absl::string_view data) {
+  std::vector<absl::string_view> fragments;
+  absl::BitGen gen(std::seed_seq{42});
+  while (!data.empty()) {
+    size_t size = std::min(data.size(), absl::Uniform<size_t>(
+                                            absl::IntervalClosed, gen, 1, 4096));
+    fragments.push_back(data.substr(0, size));
+    data.remove_prefix(size);
+  }
+  return fragments;
+}
+
+template <class Corpus>
+static void BM_Parse_Proto2_Chunked(benchmark::State& state) {
+  const std::string data = Corpus::Data();
+  const int chunk_size = state.range(0);
+  const std::vector<absl::string_view> fragments = RandomFragments(data);
+  benchmarks::PerfCounterScope perf(state);
+  for (auto _ : state) {
+    Proto2Factory<UseArena, typename Corpus::Proto> proto_factory;
+    auto proto = proto_factory.GetProto();
+    bool ok;
+    if (chunk_size > 0) {
+      protobuf::io::ArrayInputStream input(data.data(), data.size(),
+                                           chunk_size);
+      ok = proto->ParseFromZeroCopyStream(&input);
+    } else {
+      protobuf::io::SpanChainInputStream input(fragments);
+      // Through the base class, like any other stream.
+      ok = proto->ParseFromZeroCopyStream(
+          static_cast<protobuf::io::ZeroCopyInputStream*>(&input));
+    }
+    if (!ok) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+  state.counters["cycles/byte"] = benchmark::Counter(
+      state.iterations() * data.size() /
+          benchmark::CPUInfo::Get().cycles_per_second,
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+BENCHMARK_TEMPLATE(BM_Parse_Proto2_Chunked, DescriptorCorpus)
+    ->Arg(1)
+    ->Arg(17)
+    ->Arg(4096)
+    ->Arg(65536)
+    ->Arg(0);
+BENCHMARK_TEMPLATE(BM_Parse_Proto2_Chunked, ExtensionsCorpus)
+    ->Arg(1)
+    ->Arg(17)
+    ->Arg(4096)
+    ->Arg(65536)
+    ->Arg(0);
+
 static void BM_SerializeDescriptor_Proto2(benchmark::State& state) {
   upb_benchmark::FileDescriptorProto proto;
   proto.ParseFromArray(descriptor.data, descriptor.size);
+  benchmarks::PerfCounterScope perf(state);
   for (auto _ : state) {
     proto.SerializePartialToArray(buf, sizeof(buf));
   }
@@ -364,6 +814,95 @@ static void BM_SerializeDescriptor_Proto2(benchmark::State& state) {
 }
 BENCHMARK(BM_SerializeDescriptor_Proto2);
 
+static void BM_JsonParse_Proto2(benchmark::State& state) {
+  upb_benchmark::FileDescriptorProto proto;
+  proto.ParseFromArray(descriptor.data, descriptor.size);
+  std::string json;
+  if (!protobuf::json::MessageToJsonString(proto, &json).ok()) {
+    printf("Failed to print JSON.\n");
+    exit(1);
+  }
+  for (auto _ : state) {
+    upb_benchmark::FileDescriptorProto parsed;
+    if (!protobuf::json::JsonStringToMessage(json, &parsed).ok()) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_JsonParse_Proto2);
+
+static void BM_JsonSerialize_Proto2(benchmark::State& state) {
+  upb_benchmark::FileDescriptorProto proto;
+  proto.ParseFromArray(descriptor.data, descriptor.size);
+  size_t total = 0;
+  for (auto _ : state) {
+    std::string json;
+    if (!protobuf::json::MessageToJsonString(proto, &json).ok()) {
+      printf("Failed to print JSON.\n");
+      exit(1);
+    }
+    total += json.size();
+  }
+  state.SetBytesProcessed(total);
+}
+BENCHMARK(BM_JsonSerialize_Proto2);
+
+static void BM_JsonParse_Upb(benchmark::State& state) {
+  upb_benchmark::FileDescriptorProto proto;
+  proto.ParseFromArray(descriptor.data, descriptor.size);
+  std::string json;
+  if (!protobuf::json::MessageToJsonString(proto, &json).ok()) {
+    printf("Failed to print JSON.\n");
+    exit(1);
+  }
+  upb::DefPool defpool;
+  const upb_MessageDef* m =
+      upb_benchmark_FileDescriptorProto_getmsgdef(defpool.ptr());
+  for (auto _ : state) {
+    upb_Arena* arena = upb_Arena_New();
+    upb_benchmark_FileDescriptorProto* parsed =
+        upb_benchmark_FileDescriptorProto_new(arena);
+    upb::Status status;
+    if (!upb_JsonDecode(json.data(), json.size(),
+                        reinterpret_cast<upb_Message*>(parsed), m,
+                        defpool.ptr(), 0, arena, status.ptr())) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+    upb_Arena_Free(arena);
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_JsonParse_Upb);
+
+static void BM_JsonSerialize_Upb(benchmark::State& state) {
+  upb::Arena arena;
+  const upb_Message* msg = reinterpret_cast<upb_Message*>(
+      upb_benchmark_FileDescriptorProto_parse(descriptor.data, descriptor.size,
+                                              arena.ptr()));
+  upb::DefPool defpool;
+  const upb_MessageDef* m =
+      upb_benchmark_FileDescriptorProto_getmsgdef(defpool.ptr());
+  std::string json;
+  size_t total = 0;
+  for (auto _ : state) {
+    upb::Status status;
+    size_t size =
+        upb_JsonEncode(msg, m, defpool.ptr(), 0, nullptr, 0, status.ptr());
+    json.resize(size + 1);
+    if (upb_JsonEncode(msg, m, defpool.ptr(), 0, json.data(), json.size(),
+                       status.ptr()) != size) {
+      printf("Failed to print JSON.\n");
+      exit(1);
+    }
+    total += size;
+  }
+  state.SetBytesProcessed(total);
+}
+BENCHMARK(BM_JsonSerialize_Upb);
+
 static void BM_SerializeDescriptor_Upb(benchmark::State& state) {
   int64_t total = 0;
   upb_Arena* arena = upb_Arena_New();
@@ -374,6 +913,7 @@ static void BM_SerializeDescriptor_Upb(benchmark::State& state) {
     printf("Failed to parse.\n");
     exit(1);
   }
+  benchmarks::PerfCounterScope perf(state);
   for (auto _ : state) {
     upb_Arena* enc_arena = upb_Arena_Init(buf, sizeof(buf), nullptr);
     size_t size;
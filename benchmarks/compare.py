@@ -58,7 +58,29 @@ def GitWorktree(commit):
 def Run(cmd):
   subprocess.check_call(cmd, shell=True)
 
-def Benchmark(outbase, bench_cpu=True, runs=12, fasttable=False):
+# Hardware counters reported by benchmarks/perf_counters.h, with their
+# benchstat units.  All but IPC are averaged per iteration.
+PERF_COUNTERS = [
+    ("cycles", "cycles/op"),
+    ("instructions", "instructions/op"),
+    ("IPC", "instructions/cycle"),
+    ("branch-misses", "branch-misses/op"),
+    ("L1-dcache-load-misses", "L1-dcache-load-misses/op"),
+    ("LLC-load-misses", "LLC-load-misses/op"),
+]
+
+def BenchstatLine(run):
+  name = run["name"]
+  name = name.replace(" ", "")
+  name = re.sub(r'^BM_', 'Benchmark', name)
+  line = "{} {} {} ns/op".format(name, run["iterations"], run["cpu_time"])
+  for counter, unit in PERF_COUNTERS:
+    if counter in run:
+      line += " {} {}".format(run[counter], unit)
+  return line
+
+def Benchmark(outbase, bench_cpu=True, runs=12, fasttable=False,
+              perf_counters=False):
   tmpfile = "/tmp/bench-output.json"
   Run("rm -rf {}".format(tmpfile))
   #Run("CC=clang bazel test ...")
@@ -68,22 +90,28 @@ def Benchmark(outbase, bench_cpu=True, runs=12, fasttable=False):
     extra_args = ""
 
   if bench_cpu:
-    Run("CC=clang bazel build -c opt --copt=-march=native benchmarks:benchmark" + extra_args)
-    Run("./bazel-bin/benchmarks/benchmark --benchmark_out_format=json --benchmark_out={} --benchmark_repetitions={} --benchmark_min_time=0.05 --benchmark_enable_random_interleaving=true".format(tmpfile, runs))
-    with open(tmpfile) as f:
-      bench_json = json.load(f)
-
-    # Translate into the format expected by benchstat.
+    Run("CC=clang bazel build -c opt --copt=-march=native benchmarks:benchmark benchmarks:shapes_benchmark" + extra_args)
     txt_filename = outbase + ".txt"
-    with open(txt_filename, "w") as f:
-      for run in bench_json["benchmarks"]:
-        if run["run_type"] == "aggregate":
-          continue
-        name = run["name"]
-        name = name.replace(" ", "")
-        name = re.sub(r'^BM_', 'Benchmark', name)
-        values = (name, run["iterations"], run["cpu_time"])
-        print("{} {} {} ns/op".format(*values), file=f)
+    Run("rm -f {}".format(txt_filename))
+    env = "BENCHMARK_PERF_COUNTERS=1 " if perf_counters else ""
+    for target in ["benchmark", "shapes_benchmark"]:
+      Run(env + "./bazel-bin/benchmarks/{} --benchmark_out_format=json --benchmark_out={} --benchmark_repetitions={} --benchmark_min_time=0.05 --benchmark_enable_random_interleaving=true".format(target, tmpfile, runs))
+      with open(tmpfile) as f:
+        bench_json = json.load(f)
+
+      # Translate into the format expected by benchstat.
+      with open(txt_filename, "a") as f:
+        for run in bench_json["benchmarks"]:
+          if run["run_type"] == "aggregate":
+            continue
+          print(BenchstatLine(run), file=f)
+
+    # The Python and Rust shape benchmarks print benchstat lines themselves.
+    for target in ["shapes_benchmark_py", "shapes_benchmark_rust_upb",
+                   "shapes_benchmark_rust_cpp"]:
+      for _ in range(runs):
+        Run("CC=clang bazel run -c opt --copt=-march=native benchmarks:{}{} >> {}"
+            .format(target, extra_args, txt_filename))
     Run("sort {} -o {} ".format(txt_filename, txt_filename))
 
   Run("CC=clang bazel build -c opt --copt=-g --copt=-march=native :conformance_upb"
@@ -94,20 +122,30 @@ def Benchmark(outbase, bench_cpu=True, runs=12, fasttable=False):
 baseline = "main"
 bench_cpu = True
 fasttable = False
+perf_counters = False
+
+args = sys.argv[1:]
+if "--perf_counters" in args:
+  # Also compare hardware counters, which benchstat reports as extra units.
+  # Needs perf_event_open(2) to be allowed, e.g. perf_event_paranoid <= 2.
+  args.remove("--perf_counters")
+  perf_counters = True
 
-if len(sys.argv) > 1:
-  baseline = sys.argv[1]
+if args:
+  baseline = args[0]
 
   # Quickly verify that the baseline exists.
   with GitWorktree(baseline):
     pass
 
 # Benchmark our current directory first, since it's more likely to be broken.
-Benchmark("/tmp/new", bench_cpu, fasttable=fasttable)
+Benchmark("/tmp/new", bench_cpu, fasttable=fasttable,
+          perf_counters=perf_counters)
 
 # Benchmark the baseline.
 with GitWorktree(baseline):
-  Benchmark("/tmp/old", bench_cpu, fasttable=fasttable)
+  Benchmark("/tmp/old", bench_cpu, fasttable=fasttable,
+            perf_counters=perf_counters)
 
 print()
 print()
@@ -30,6 +30,7 @@
 # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+import struct
 import sys
 import random
 
@@ -121,3 +122,193 @@ with open(base + "/200_fields.proto", "w") as f:
     f.write('  {label} {field_type} field{i} = {i};\n'.format(i=i, label=label,field_type=field_type))
     i += 1
   f.write('}\n')
+
+# Message shapes that stress different parts of the runtimes, along with one
+# binary payload per shape.  Every runtime benchmarks the same payloads (see
+# shapes_benchmark.cc, shapes_benchmark.py and shapes_benchmark.rs), so the
+# numbers are comparable across runtimes.
+
+SHAPES = {
+    'deep': 'Deep',
+    'wide': 'Wide',
+    'map_heavy': 'MapHeavy',
+    'string_heavy': 'StringHeavy',
+    'packed_numeric': 'PackedNumeric',
+}
+
+# Nesting of the "deep" payload.  Kept below the default recursion limit of
+# every runtime (100).
+DEEP_DEPTH = 64
+
+# Field types of the "wide" message, which sets every field.
+WIDE_TYPES = [
+    'bool', 'bytes', 'double', 'fixed32', 'fixed64', 'float', 'int32',
+    'int64', 'sfixed32', 'sfixed64', 'sint32', 'sint64', 'string', 'uint32',
+    'uint64'
+]
+WIDE_FIELDS = 150
+
+PACKED_COUNT = 1000
+MAP_ENTRIES = 200
+STRING_COUNT = 200
+BLOB_COUNT = 8
+BLOB_SIZE = 1024
+
+def varint(n):
+  n &= (1 << 64) - 1
+  out = bytearray()
+  while True:
+    byte = n & 0x7f
+    n >>= 7
+    if n:
+      out.append(byte | 0x80)
+    else:
+      out.append(byte)
+      return bytes(out)
+
+def zigzag(n):
+  return (n << 1) ^ (n >> 63)
+
+def tag(field_number, wire_type):
+  return varint((field_number << 3) | wire_type)
+
+def delimited(field_number, data):
+  return tag(field_number, 2) + varint(len(data)) + data
+
+def scalar(field_type, field_number, value):
+  """Encodes a singular scalar field."""
+  if field_type in ('int32', 'int64', 'uint32', 'uint64', 'bool'):
+    return tag(field_number, 0) + varint(value)
+  if field_type in ('sint32', 'sint64'):
+    return tag(field_number, 0) + varint(zigzag(value))
+  if field_type in ('fixed32', 'sfixed32', 'float'):
+    fmt = {'fixed32': '<I', 'sfixed32': '<i', 'float': '<f'}[field_type]
+    return tag(field_number, 5) + struct.pack(fmt, value)
+  if field_type in ('fixed64', 'sfixed64', 'double'):
+    fmt = {'fixed64': '<Q', 'sfixed64': '<q', 'double': '<d'}[field_type]
+    return tag(field_number, 1) + struct.pack(fmt, value)
+  if field_type == 'string':
+    return delimited(field_number, value.encode('utf-8'))
+  if field_type == 'bytes':
+    return delimited(field_number, value)
+  raise ValueError(field_type)
+
+def random_value(field_type):
+  if field_type == 'bool':
+    return 1
+  if field_type in ('int32', 'sint32', 'sfixed32'):
+    return random.randint(-(1 << 31), (1 << 31) - 1)
+  if field_type in ('int64', 'sint64', 'sfixed64'):
+    return random.randint(-(1 << 63), (1 << 63) - 1)
+  if field_type in ('uint32', 'fixed32'):
+    return random.randint(1, (1 << 32) - 1)
+  if field_type in ('uint64', 'fixed64'):
+    return random.randint(1, (1 << 64) - 1)
+  if field_type == 'float':
+    # Exactly representable, so every runtime round-trips it.
+    return random.randint(1, 1 << 20) / 8.0
+  if field_type == 'double':
+    return random.random() * 1e6
+  if field_type == 'string':
+    return random_string(random.randint(4, 32))
+  if field_type == 'bytes':
+    return bytes(random.getrandbits(8) for _ in range(random.randint(4, 32)))
+  raise ValueError(field_type)
+
+def random_string(size):
+  alphabet = 'abcdefghijklmnopqrstuvwxyz0123456789 _-'
+  return ''.join(random.choice(alphabet) for _ in range(size))
+
+def deep_payload(depth):
+  data = scalar('int32', 2, depth) + scalar('string', 3, 'level%d' % depth)
+  if depth > 1:
+    data = delimited(1, deep_payload(depth - 1)) + data
+  return data
+
+def packed(field_type, field_number, values):
+  if field_type in ('int32', 'int64', 'uint64'):
+    data = b''.join(varint(v) for v in values)
+  elif field_type == 'sint64':
+    data = b''.join(varint(zigzag(v)) for v in values)
+  else:
+    fmt = {'fixed32': '<I', 'double': '<d', 'float': '<f'}[field_type]
+    data = b''.join(struct.pack(fmt, v) for v in values)
+  return delimited(field_number, data)
+
+random.seed(a=0, version=2)
+wide_types = [random.choice(WIDE_TYPES) for _ in range(WIDE_FIELDS)]
+packed_fields = [
+    ('int32', 'int32s'),
+    ('int64', 'int64s'),
+    ('uint64', 'uint64s'),
+    ('sint64', 'sint64s'),
+    ('fixed32', 'fixed32s'),
+    ('double', 'doubles'),
+    ('float', 'floats'),
+]
+
+with open(base + "/shapes.proto", "w") as f:
+  f.write('syntax = "proto3";\n')
+  f.write('package upb_benchmark;\n')
+  f.write('message Deep {\n')
+  f.write('  Deep child = 1;\n')
+  f.write('  int32 depth = 2;\n')
+  f.write('  string tag = 3;\n')
+  f.write('}\n')
+  f.write('message Wide {\n')
+  for i, field_type in enumerate(wide_types, 1):
+    f.write('  {field_type} field{i} = {i};\n'.format(i=i, field_type=field_type))
+  f.write('}\n')
+  f.write('message MapValue {\n')
+  f.write('  int64 id = 1;\n')
+  f.write('  string label = 2;\n')
+  f.write('}\n')
+  f.write('message MapHeavy {\n')
+  f.write('  map<string, int64> counts = 1;\n')
+  f.write('  map<int32, string> names = 2;\n')
+  f.write('  map<string, MapValue> values = 3;\n')
+  f.write('}\n')
+  f.write('message StringHeavy {\n')
+  f.write('  repeated string strings = 1;\n')
+  f.write('  repeated bytes blobs = 2;\n')
+  f.write('  string text = 3;\n')
+  f.write('}\n')
+  f.write('message PackedNumeric {\n')
+  for i, (field_type, name) in enumerate(packed_fields, 1):
+    f.write('  repeated {field_type} {name} = {i};\n'.format(
+        i=i, field_type=field_type, name=name))
+  f.write('}\n')
+
+payloads = {}
+payloads['deep'] = deep_payload(DEEP_DEPTH)
+payloads['wide'] = b''.join(
+    scalar(field_type, i, random_value(field_type))
+    for i, field_type in enumerate(wide_types, 1))
+
+data = b''
+for i in range(MAP_ENTRIES):
+  key = 'key%d' % i
+  data += delimited(1, scalar('string', 1, key) +
+                    scalar('int64', 2, random_value('int64')))
+  data += delimited(2, scalar('int32', 1, i) +
+                    scalar('string', 2, random_string(16)))
+  value = scalar('int64', 1, i) + scalar('string', 2, random_string(16))
+  data += delimited(3, scalar('string', 1, key) + delimited(2, value))
+payloads['map_heavy'] = data
+
+data = b''
+for _ in range(STRING_COUNT):
+  data += scalar('string', 1, random_string(random.randint(8, 64)))
+for _ in range(BLOB_COUNT):
+  data += scalar('bytes', 2, random_value('bytes') * (BLOB_SIZE // 32))
+data += scalar('string', 3, random_string(4096))
+payloads['string_heavy'] = data
+
+payloads['packed_numeric'] = b''.join(
+    packed(field_type, i,
+           [random_value(field_type) for _ in range(PACKED_COUNT)])
+    for i, (field_type, _) in enumerate(packed_fields, 1))
+
+for name, data in payloads.items():
+  with open(base + "/shapes_" + name + ".binpb", "wb") as f:
+    f.write(data)
@@ -0,0 +1,184 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "benchmarks/perf_counters.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace benchmarks {
+namespace {
+
+bool Requested() {
+  static const bool requested = [] {
+    const char* value = getenv("BENCHMARK_PERF_COUNTERS");
+    return value != nullptr && strcmp(value, "1") == 0;
+  }();
+  return requested;
+}
+
+#ifdef __linux__
+
+struct Event {
+  const char* name;
+  uint32_t type;
+  uint64_t config;
+};
+
+constexpr uint64_t CacheMiss(uint64_t cache) {
+  return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+// The first event leads the group: the others are only counted while it is.
+constexpr Event kEvents[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"L1-dcache-load-misses", PERF_TYPE_HW_CACHE,
+     CacheMiss(PERF_COUNT_HW_CACHE_L1D)},
+    {"LLC-load-misses", PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_LL)},
+};
+constexpr int kNumEvents = sizeof(kEvents) / sizeof(kEvents[0]);
+
+int OpenEvent(const Event& event, int group_fd) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = event.type;
+  attr.config = event.config;
+  attr.disabled = group_fd == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, /*pid=*/0,
+                                  /*cpu=*/-1, group_fd, PERF_FLAG_FD_CLOEXEC));
+}
+
+// The counters of the calling thread.
+class CounterGroup {
+ public:
+  CounterGroup() {
+    for (int i = 0; i < kNumEvents; ++i) {
+      int fd = OpenEvent(kEvents[i], fds_.empty() ? -1 : fds_[0]);
+      if (fd < 0) {
+        if (i == 0) {
+          Warn(strerror(errno));
+          return;
+        }
+        continue;
+      }
+      fds_.push_back(fd);
+      events_.push_back(i);
+    }
+  }
+
+  ~CounterGroup() {
+    for (int fd : fds_) close(fd);
+  }
+
+  bool ok() const { return !fds_.empty(); }
+
+  void Start() {
+    ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+
+  // Stops counting and sets `values[i]` to the count of kEvents[i], or to -1
+  // if it was not counted.  Returns false if nothing was counted.
+  bool Stop(double values[kNumEvents]) {
+    ioctl(fds_[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    // nr, time_enabled, time_running, then one value per event.
+    uint64_t data[3 + kNumEvents];
+    ssize_t size = read(fds_[0], data, sizeof(data));
+    if (size < static_cast<ssize_t>(3 * sizeof(uint64_t)) ||
+        data[0] != events_.size() || data[2] == 0) {
+      return false;
+    }
+    // The group may have shared the PMU with other groups for part of the
+    // time; scale up to the whole time it was enabled.
+    double scale = static_cast<double>(data[1]) / data[2];
+    for (int i = 0; i < kNumEvents; ++i) values[i] = -1;
+    for (size_t i = 0; i < events_.size(); ++i) {
+      values[events_[i]] = data[3 + i] * scale;
+    }
+    return true;
+  }
+
+ private:
+  static void Warn(const char* error) {
+    static std::once_flag once;
+    std::call_once(once, [error] {
+      fprintf(stderr,
+              "Cannot read performance counters: perf_event_open: %s.  Check "
+              "/proc/sys/kernel/perf_event_paranoid.\n",
+              error);
+    });
+  }
+
+  std::vector<int> fds_;
+  // The index in kEvents of the event counted by each of `fds_`.
+  std::vector<int> events_;
+};
+
+CounterGroup& ThreadCounters() {
+  thread_local CounterGroup counters;
+  return counters;
+}
+
+#endif  // __linux__
+
+}  // namespace
+
+bool PerfCounterScope::Enabled() {
+#ifdef __linux__
+  return Requested() && ThreadCounters().ok();
+#else
+  return false;
+#endif
+}
+
+PerfCounterScope::PerfCounterScope(benchmark::State& state)
+    : state_(state), active_(Enabled()) {
+#ifdef __linux__
+  if (active_) ThreadCounters().Start();
+#endif
+}
+
+PerfCounterScope::~PerfCounterScope() {
+#ifdef __linux__
+  if (!active_) return;
+  double values[kNumEvents];
+  if (!ThreadCounters().Stop(values)) return;
+  for (int i = 0; i < kNumEvents; ++i) {
+    if (values[i] < 0) continue;
+    state_.counters[kEvents[i].name] =
+        benchmark::Counter(values[i], benchmark::Counter::kAvgIterations);
+  }
+  // kEvents[0] and kEvents[1] are cycles and instructions.
+  if (values[0] > 0 && values[1] >= 0) {
+    state_.counters["IPC"] = benchmark::Counter(
+        values[1] / values[0], benchmark::Counter::kAvgThreads);
+  }
+#endif
+}
+
+}  // namespace benchmarks
@@ -0,0 +1,59 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Hardware performance counters for benchmarks.  When the environment variable
+// BENCHMARK_PERF_COUNTERS is set to 1, a PerfCounterScope reads the CPU's
+// counters through perf_event_open(2) and reports them as user counters of the
+// benchmark, averaged per iteration:
+//
+//   cycles, instructions, branch-misses, L1-dcache-load-misses,
+//   LLC-load-misses
+//
+// plus IPC, the number of instructions per cycle.  compare.py turns these into
+// benchstat units next to the time per operation.  Counters the CPU or kernel
+// do not provide are left out, and without the variable, or on platforms
+// other than Linux, a PerfCounterScope does nothing.
+//
+// Example:
+//
+//   static void BM_Parse(benchmark::State& state) {
+//     benchmarks::PerfCounterScope perf(state);
+//     for (auto _ : state) {
+//       ...
+//     }
+//   }
+//
+// Everything between the construction and the destruction of the scope is
+// counted, including any work done under state.PauseTiming(), so the scope is
+// only meaningful in benchmarks that do not pause the timer.
+
+#ifndef GOOGLE_PROTOBUF_BENCHMARKS_PERF_COUNTERS_H__
+#define GOOGLE_PROTOBUF_BENCHMARKS_PERF_COUNTERS_H__
+
+#include <benchmark/benchmark.h>
+
+namespace benchmarks {
+
+class PerfCounterScope {
+ public:
+  explicit PerfCounterScope(benchmark::State& state);
+  ~PerfCounterScope();
+
+  PerfCounterScope(const PerfCounterScope&) = delete;
+  PerfCounterScope& operator=(const PerfCounterScope&) = delete;
+
+  // Returns true if counters are requested and can be read on this thread.
+  static bool Enabled();
+
+ private:
+  benchmark::State& state_;
+  bool active_;
+};
+
+}  // namespace benchmarks
+
+#endif  // GOOGLE_PROTOBUF_BENCHMARKS_PERF_COUNTERS_H__
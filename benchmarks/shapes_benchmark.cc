@@ -0,0 +1,308 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Benchmarks the C++ runtime and upb on the synthetic message shapes written
+// by gen_synthetic_protos.py.  shapes_benchmark.py and shapes_benchmark.rs run
+// the same operations on the same payloads for Python and Rust, and name their
+// results the same way, so that compare.py can put all of them side by side.
+
+#include <benchmark/benchmark.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "google/protobuf/arena.h"
+#include "google/protobuf/json/json.h"
+#include "google/protobuf/util/message_differencer.h"
+#include "benchmarks/shapes.pb.h"
+#include "benchmarks/shapes.upbdefs.h"
+#include "upb/base/status.hpp"
+#include "upb/json/decode.h"
+#include "upb/json/encode.h"
+#include "upb/mem/arena.h"
+#include "upb/mem/arena.hpp"
+#include "upb/message/copy.h"
+#include "upb/reflection/def.hpp"
+#include "upb/util/compare.h"
+#include "upb/wire/decode.h"
+#include "upb/wire/encode.h"
+
+namespace protobuf = ::google::protobuf;
+
+#define SHAPE(Name, file)                                           \
+  struct Name {                                                     \
+    using Proto = upb_benchmark::Name;                              \
+    static constexpr const char* kPath = "benchmarks/" file;        \
+    static const upb_MessageDef* MessageDef(upb_DefPool* defpool) { \
+      return upb_benchmark_##Name##_getmsgdef(defpool);             \
+    }                                                               \
+  };
+
+SHAPE(Deep, "shapes_deep.binpb")
+SHAPE(Wide, "shapes_wide.binpb")
+SHAPE(MapHeavy, "shapes_map_heavy.binpb")
+SHAPE(StringHeavy, "shapes_string_heavy.binpb")
+SHAPE(PackedNumeric, "shapes_packed_numeric.binpb")
+
+#undef SHAPE
+
+[[noreturn]] static void Fail(const char* what) {
+  printf("Failed to %s.\n", what);
+  exit(1);
+}
+
+template <class Shape>
+static const std::string& Payload() {
+  static const std::string* payload = [] {
+    std::ifstream file(Shape::kPath, std::ios::binary);
+    if (!file) Fail("open the payload");
+    std::stringstream data;
+    data << file.rdbuf();
+    return new std::string(data.str());
+  }();
+  return *payload;
+}
+
+template <class Shape>
+static std::string Json() {
+  typename Shape::Proto proto;
+  if (!proto.ParseFromString(Payload<Shape>())) Fail("parse");
+  std::string json;
+  if (!protobuf::json::MessageToJsonString(proto, &json).ok()) {
+    Fail("print JSON");
+  }
+  return json;
+}
+
+// Holds the payload parsed with upb, for the benchmarks that start from a
+// message.
+template <class Shape>
+class UpbMessage {
+ public:
+  UpbMessage() : m_(Shape::MessageDef(defpool_.ptr())) {
+    msg_ = Parse(arena_.ptr());
+  }
+
+  upb_Message* Parse(upb_Arena* arena) const {
+    const std::string& payload = Payload<Shape>();
+    upb_Message* msg = upb_Message_New(layout(), arena);
+    if (!msg || upb_Decode(payload.data(), payload.size(), msg, layout(),
+                           nullptr, 0, arena) != kUpb_DecodeStatus_Ok) {
+      Fail("parse");
+    }
+    return msg;
+  }
+
+  const upb_Message* msg() const { return msg_; }
+  const upb_MessageDef* m() const { return m_; }
+  const upb_MiniTable* layout() const { return upb_MessageDef_MiniTable(m_); }
+  const upb_DefPool* defpool() const { return defpool_.ptr(); }
+
+ private:
+  upb::DefPool defpool_;
+  upb::Arena arena_;
+  const upb_MessageDef* m_;
+  upb_Message* msg_;
+};
+
+// Parse //////////////////////////////////////////////////////////////////////
+
+template <class Shape>
+static void BM_Parse_Proto2(benchmark::State& state) {
+  const std::string& payload = Payload<Shape>();
+  for (auto _ : state) {
+    protobuf::Arena arena;
+    auto* proto =
+        protobuf::Arena::CreateMessage<typename Shape::Proto>(&arena);
+    if (!proto->ParseFromString(payload)) Fail("parse");
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+
+template <class Shape>
+static void BM_Parse_Upb(benchmark::State& state) {
+  UpbMessage<Shape> message;
+  for (auto _ : state) {
+    upb::Arena arena;
+    benchmark::DoNotOptimize(message.Parse(arena.ptr()));
+  }
+  state.SetBytesProcessed(state.iterations() * Payload<Shape>().size());
+}
+
+// Serialize //////////////////////////////////////////////////////////////////
+
+template <class Shape>
+static void BM_Serialize_Proto2(benchmark::State& state) {
+  typename Shape::Proto proto;
+  if (!proto.ParseFromString(Payload<Shape>())) Fail("parse");
+  std::string out;
+  for (auto _ : state) {
+    out.clear();
+    if (!proto.SerializeToString(&out)) Fail("serialize");
+  }
+  state.SetBytesProcessed(state.iterations() * out.size());
+}
+
+template <class Shape>
+static void BM_Serialize_Upb(benchmark::State& state) {
+  UpbMessage<Shape> message;
+  size_t size = 0;
+  for (auto _ : state) {
+    upb::Arena arena;
+    char* data;
+    if (upb_Encode(message.msg(), message.layout(), 0, arena.ptr(), &data,
+                   &size) != kUpb_EncodeStatus_Ok) {
+      Fail("serialize");
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+
+// JSON ///////////////////////////////////////////////////////////////////////
+
+template <class Shape>
+static void BM_JsonParse_Proto2(benchmark::State& state) {
+  const std::string json = Json<Shape>();
+  for (auto _ : state) {
+    typename Shape::Proto proto;
+    if (!protobuf::json::JsonStringToMessage(json, &proto).ok()) {
+      Fail("parse JSON");
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+
+template <class Shape>
+static void BM_JsonParse_Upb(benchmark::State& state) {
+  UpbMessage<Shape> message;
+  const std::string json = Json<Shape>();
+  for (auto _ : state) {
+    upb::Arena arena;
+    upb::Status status;
+    upb_Message* msg = upb_Message_New(message.layout(), arena.ptr());
+    if (!upb_JsonDecode(json.data(), json.size(), msg, message.m(),
+                        message.defpool(), 0, arena.ptr(), status.ptr())) {
+      Fail("parse JSON");
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+
+template <class Shape>
+static void BM_JsonSerialize_Proto2(benchmark::State& state) {
+  typename Shape::Proto proto;
+  if (!proto.ParseFromString(Payload<Shape>())) Fail("parse");
+  std::string json;
+  for (auto _ : state) {
+    json.clear();
+    if (!protobuf::json::MessageToJsonString(proto, &json).ok()) {
+      Fail("print JSON");
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+
+template <class Shape>
+static void BM_JsonSerialize_Upb(benchmark::State& state) {
+  UpbMessage<Shape> message;
+  std::string json;
+  for (auto _ : state) {
+    upb::Status status;
+    size_t size = upb_JsonEncode(message.msg(), message.m(), message.defpool(),
+                                 0, nullptr, 0, status.ptr());
+    json.resize(size + 1);
+    if (upb_JsonEncode(message.msg(), message.m(), message.defpool(), 0,
+                       json.data(), json.size(), status.ptr()) != size) {
+      Fail("print JSON");
+    }
+    json.resize(size);
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+
+// Copy ///////////////////////////////////////////////////////////////////////
+
+template <class Shape>
+static void BM_Copy_Proto2(benchmark::State& state) {
+  typename Shape::Proto proto;
+  if (!proto.ParseFromString(Payload<Shape>())) Fail("parse");
+  for (auto _ : state) {
+    protobuf::Arena arena;
+    auto* copy =
+        protobuf::Arena::CreateMessage<typename Shape::Proto>(&arena);
+    copy->CopyFrom(proto);
+  }
+  state.SetBytesProcessed(state.iterations() * Payload<Shape>().size());
+}
+
+template <class Shape>
+static void BM_Copy_Upb(benchmark::State& state) {
+  UpbMessage<Shape> message;
+  for (auto _ : state) {
+    upb::Arena arena;
+    if (!upb_Message_DeepClone(message.msg(), message.layout(), arena.ptr())) {
+      Fail("copy");
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * Payload<Shape>().size());
+}
+
+// Compare ////////////////////////////////////////////////////////////////////
+
+// Compares two equal messages, which is the slowest case.
+template <class Shape>
+static void BM_Compare_Proto2(benchmark::State& state) {
+  typename Shape::Proto proto1;
+  typename Shape::Proto proto2;
+  if (!proto1.ParseFromString(Payload<Shape>()) ||
+      !proto2.ParseFromString(Payload<Shape>())) {
+    Fail("parse");
+  }
+  for (auto _ : state) {
+    if (!protobuf::util::MessageDifferencer::Equals(proto1, proto2)) {
+      Fail("compare");
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * Payload<Shape>().size());
+}
+
+template <class Shape>
+static void BM_Compare_Upb(benchmark::State& state) {
+  UpbMessage<Shape> message;
+  upb::Arena arena;
+  const upb_Message* other = message.Parse(arena.ptr());
+  for (auto _ : state) {
+    if (!upb_Message_IsEqual(message.msg(), other, message.layout())) {
+      Fail("compare");
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * Payload<Shape>().size());
+}
+
+#define SHAPE_BENCHMARKS(Shape)                       \
+  BENCHMARK_TEMPLATE(BM_Parse_Proto2, Shape);         \
+  BENCHMARK_TEMPLATE(BM_Parse_Upb, Shape);            \
+  BENCHMARK_TEMPLATE(BM_Serialize_Proto2, Shape);     \
+  BENCHMARK_TEMPLATE(BM_Serialize_Upb, Shape);        \
+  BENCHMARK_TEMPLATE(BM_JsonParse_Proto2, Shape);     \
+  BENCHMARK_TEMPLATE(BM_JsonParse_Upb, Shape);        \
+  BENCHMARK_TEMPLATE(BM_JsonSerialize_Proto2, Shape); \
+  BENCHMARK_TEMPLATE(BM_JsonSerialize_Upb, Shape);    \
+  BENCHMARK_TEMPLATE(BM_Copy_Proto2, Shape);          \
+  BENCHMARK_TEMPLATE(BM_Copy_Upb, Shape);             \
+  BENCHMARK_TEMPLATE(BM_Compare_Proto2, Shape);       \
+  BENCHMARK_TEMPLATE(BM_Compare_Upb, Shape)
+
+SHAPE_BENCHMARKS(Deep);
+SHAPE_BENCHMARKS(Wide);
+SHAPE_BENCHMARKS(MapHeavy);
+SHAPE_BENCHMARKS(StringHeavy);
+SHAPE_BENCHMARKS(PackedNumeric);
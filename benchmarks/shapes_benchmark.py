@@ -0,0 +1,76 @@
+# Protocol Buffers - Google's data interchange format
+# Copyright 2023 Google LLC.  All rights reserved.
+#
+# Use of this source code is governed by a BSD-style
+# license that can be found in the LICENSE file or at
+# https://developers.google.com/open-source/licenses/bsd
+
+"""Benchmarks Python (upb) on the synthetic message shapes.
+
+Runs the same operations as shapes_benchmark.cc on the same payloads and
+prints the results in the format expected by benchstat, so that compare.py can
+list them next to the C++ and upb results.
+"""
+
+import os
+import sys
+import timeit
+
+from google.protobuf import json_format
+from benchmarks import shapes_pb2
+
+SHAPES = [
+    ('Deep', 'shapes_deep.binpb'),
+    ('Wide', 'shapes_wide.binpb'),
+    ('MapHeavy', 'shapes_map_heavy.binpb'),
+    ('StringHeavy', 'shapes_string_heavy.binpb'),
+    ('PackedNumeric', 'shapes_packed_numeric.binpb'),
+]
+
+# Minimum time spent on each benchmark, in seconds.
+MIN_TIME = 0.5
+
+
+def Report(name, shape, func):
+  """Times func() and prints one benchstat line for it."""
+  timer = timeit.Timer(func)
+  iterations, elapsed = timer.autorange()
+  while elapsed < MIN_TIME:
+    iterations *= 2
+    elapsed = timer.timeit(iterations)
+  print('Benchmark{}_Python<{}> {} {} ns/op'.format(
+      name, shape, iterations, int(elapsed * 1e9 / iterations)))
+
+
+def BenchmarkShape(shape, path):
+  cls = getattr(shapes_pb2, shape)
+  with open(path, 'rb') as f:
+    payload = f.read()
+  msg = cls.FromString(payload)
+  other = cls.FromString(payload)
+  json = json_format.MessageToJson(msg)
+
+  def Copy():
+    cls().CopyFrom(msg)
+
+  def Compare():
+    if msg != other:
+      raise AssertionError('Failed to compare.')
+
+  Report('Parse', shape, lambda: cls.FromString(payload))
+  Report('Serialize', shape, msg.SerializeToString)
+  Report('JsonParse', shape, lambda: json_format.Parse(json, cls()))
+  Report('JsonSerialize', shape, lambda: json_format.MessageToJson(msg))
+  Report('Copy', shape, Copy)
+  Report('Compare', shape, Compare)
+
+
+def main():
+  datadir = os.path.dirname(os.path.abspath(__file__))
+  for shape, filename in SHAPES:
+    BenchmarkShape(shape, os.path.join(datadir, filename))
+  sys.stdout.flush()
+
+
+if __name__ == '__main__':
+  main()
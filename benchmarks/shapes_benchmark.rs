@@ -0,0 +1,64 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+//! Benchmarks Rust protobuf on the synthetic message shapes.
+//!
+//! Built once per kernel (see `SHAPES_KERNEL` in the BUILD file).  Results are
+//! printed in the format expected by benchstat, with the same names as
+//! shapes_benchmark.cc, so that compare.py can list them side by side.  The
+//! Rust API does not offer JSON, copy or compare yet, so only parsing and
+//! serializing are measured.
+
+use shapes_proto::upb_benchmark::{Deep, MapHeavy, PackedNumeric, StringHeavy, Wide};
+use std::hint::black_box;
+use std::time::{Duration, Instant};
+
+const KERNEL: &str = env!("SHAPES_KERNEL");
+const MIN_TIME: Duration = Duration::from_millis(500);
+
+fn report(name: &str, shape: &str, mut f: impl FnMut()) {
+    let mut iterations: u64 = 1;
+    loop {
+        let start = Instant::now();
+        for _ in 0..iterations {
+            f();
+        }
+        let elapsed = start.elapsed();
+        if elapsed >= MIN_TIME {
+            let ns = elapsed.as_nanos() / u128::from(iterations);
+            println!("Benchmark{name}_{KERNEL}<{shape}> {iterations} {ns} ns/op");
+            return;
+        }
+        iterations *= 2;
+    }
+}
+
+macro_rules! benchmark_shape {
+    ($shape:ident, $file:expr) => {{
+        let path = concat!("benchmarks/", $file);
+        let payload = std::fs::read(path).expect("failed to read the payload");
+        let mut msg = $shape::new();
+        msg.deserialize(&payload).expect("failed to parse");
+
+        report("Parse", stringify!($shape), || {
+            let mut msg = $shape::new();
+            msg.deserialize(black_box(&payload)).expect("failed to parse");
+            black_box(&msg);
+        });
+        report("Serialize", stringify!($shape), || {
+            black_box(msg.serialize());
+        });
+    }};
+}
+
+fn main() {
+    benchmark_shape!(Deep, "shapes_deep.binpb");
+    benchmark_shape!(Wide, "shapes_wide.binpb");
+    benchmark_shape!(MapHeavy, "shapes_map_heavy.binpb");
+    benchmark_shape!(StringHeavy, "shapes_string_heavy.binpb");
+    benchmark_shape!(PackedNumeric, "shapes_packed_numeric.binpb");
+}
@@ -70,6 +70,17 @@ set(protobuf_HEADERS
   ${plugin_proto_proto_srcs}
   ${java_features_proto_proto_srcs}
 )
+# The compression streams are only built, and their headers only installed,
+# when the library they wrap was found.
+set(_optional_stream_headers)
+if (HAVE_ZSTD)
+  list(APPEND _optional_stream_headers ${zstd_stream_files})
+endif ()
+if (HAVE_LZ4)
+  list(APPEND _optional_stream_headers ${lz4_stream_files})
+endif ()
+list(FILTER _optional_stream_headers INCLUDE REGEX "\\.h$")
+list(APPEND protobuf_HEADERS ${_optional_stream_headers})
 foreach(_header ${protobuf_HEADERS})
   string(FIND ${_header} "${protobuf_SOURCE_DIR}/src" _find_src)
   string(FIND ${_header} "${protobuf_SOURCE_DIR}" _find_nosrc)
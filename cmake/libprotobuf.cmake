@@ -20,6 +20,14 @@ target_link_libraries(libprotobuf PRIVATE ${CMAKE_THREAD_LIBS_INIT})
 if(protobuf_WITH_ZLIB)
   target_link_libraries(libprotobuf PRIVATE ${ZLIB_LIBRARIES})
 endif()
+if(HAVE_ZSTD)
+  target_sources(libprotobuf PRIVATE ${zstd_stream_files})
+  target_link_libraries(libprotobuf PRIVATE ${ZSTD_LIBRARIES})
+endif()
+if(HAVE_LZ4)
+  target_sources(libprotobuf PRIVATE ${lz4_stream_files})
+  target_link_libraries(libprotobuf PRIVATE ${LZ4_LIBRARIES})
+endif()
 if(protobuf_LINK_LIBATOMIC)
   target_link_libraries(libprotobuf PRIVATE atomic)
 endif()
@@ -17,6 +17,9 @@ if(protobuf_HAVE_LD_VERSION_SCRIPT)
     LINK_DEPENDS ${protobuf_SOURCE_DIR}/src/libprotoc.map)
 endif()
 target_link_libraries(libprotoc PRIVATE libprotobuf)
+if(protobuf_WITH_ZLIB)
+  target_link_libraries(libprotoc PRIVATE ${ZLIB_LIBRARIES})
+endif()
 target_link_libraries(libprotoc PUBLIC ${protobuf_ABSL_USED_TARGETS})
 protobuf_configure_target(libprotoc)
 if(protobuf_BUILD_SHARED_LIBS)
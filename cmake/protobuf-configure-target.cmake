@@ -52,4 +52,10 @@ function(protobuf_configure_target target)
     if (HAVE_ZLIB)
         target_compile_definitions("${target}" PRIVATE -DHAVE_ZLIB)
     endif ()
+    if (HAVE_ZSTD)
+        target_compile_definitions("${target}" PRIVATE -DHAVE_ZSTD)
+    endif ()
+    if (HAVE_LZ4)
+        target_compile_definitions("${target}" PRIVATE -DHAVE_LZ4)
+    endif ()
 endfunction ()
@@ -9,6 +9,7 @@
 #include <stdarg.h>
 #include <unistd.h>
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <utility>
@@ -226,6 +227,17 @@ absl::StatusOr<bool> Harness::ServeConformanceRequest() {
   absl::StatusOr<ConformanceResponse> response = RunTest(request);
   RETURN_IF_ERROR(response.status());
 
+  if (request.benchmark_iterations() > 0) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < request.benchmark_iterations(); ++i) {
+      RETURN_IF_ERROR(RunTest(request).status());
+    }
+    response->set_benchmark_nanos(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count());
+  }
+
   std::string serialized_output;
   response->SerializeToString(&serialized_output);
 
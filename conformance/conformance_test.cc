@@ -9,6 +9,7 @@
 
 #include <stdarg.h>
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <fstream>
@@ -425,6 +426,98 @@ void ConformanceTestSuite::RunTest(const std::string& test_name,
         test_name, TruncateRequest(request).ShortDebugString(),
         TruncateResponse(*response).ShortDebugString());
   }
+
+  if (benchmark_iterations_ > 0) {
+    switch (response->result_case()) {
+      case ConformanceResponse::kProtobufPayload:
+      case ConformanceResponse::kJsonPayload:
+      case ConformanceResponse::kJspbPayload:
+      case ConformanceResponse::kTextPayload:
+        RunBenchmark(test_name, request);
+        break;
+      default:
+        // Errors and skipped tests are not representative of throughput.
+        break;
+    }
+  }
+}
+
+void ConformanceTestSuite::RunBenchmark(const std::string& test_name,
+                                        const ConformanceRequest& request) {
+  ConformanceRequest benchmark_request(request);
+  benchmark_request.set_benchmark_iterations(benchmark_iterations_);
+  std::string serialized_request;
+  std::string serialized_response;
+  benchmark_request.SerializeToString(&serialized_request);
+  runner_->RunTest(test_name, serialized_request, &serialized_response);
+
+  ConformanceResponse response;
+  int64_t nanos = 0;
+  bool in_process = response.ParseFromString(serialized_response) &&
+                    response.benchmark_nanos() > 0;
+  if (in_process) {
+    nanos = response.benchmark_nanos();
+  } else {
+    // The testee ignores benchmark_iterations, so time whole round trips.
+    request.SerializeToString(&serialized_request);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < benchmark_iterations_; ++i) {
+      runner_->RunTest(test_name, serialized_request, &serialized_response);
+    }
+    nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count();
+  }
+
+  size_t payload_size = 0;
+  WireFormat input_format = conformance::UNSPECIFIED;
+  switch (request.payload_case()) {
+    case ConformanceRequest::kProtobufPayload:
+      payload_size = request.protobuf_payload().size();
+      input_format = conformance::PROTOBUF;
+      break;
+    case ConformanceRequest::kJsonPayload:
+      payload_size = request.json_payload().size();
+      input_format = conformance::JSON;
+      break;
+    case ConformanceRequest::kJspbPayload:
+      payload_size = request.jspb_payload().size();
+      input_format = conformance::JSPB;
+      break;
+    case ConformanceRequest::kTextPayload:
+      payload_size = request.text_payload().size();
+      input_format = conformance::TEXT_FORMAT;
+      break;
+    default:
+      break;
+  }
+
+  BenchmarkTotals& totals = benchmark_totals_[absl::StrCat(
+      request.message_type(), " ", WireFormatToString(input_format), " -> ",
+      WireFormatToString(request.requested_output_format()))];
+  totals.requests++;
+  totals.bytes += static_cast<int64_t>(payload_size) * benchmark_iterations_;
+  totals.nanos += nanos;
+  totals.in_process = totals.in_process && in_process;
+}
+
+void ConformanceTestSuite::ReportBenchmarks() {
+  if (benchmark_totals_.empty()) return;
+  absl::StrAppendFormat(&output_,
+                        "BENCHMARK RESULTS (%d iterations per request):\n\n",
+                        benchmark_iterations_);
+  for (const auto& entry : benchmark_totals_) {
+    const BenchmarkTotals& totals = entry.second;
+    double seconds = totals.nanos * 1e-9;
+    absl::StrAppendFormat(
+        &output_, "  %s: %d requests, %.1f MB/s, %.0f ns/request (%s)\n",
+        entry.first, totals.requests,
+        seconds > 0 ? totals.bytes / seconds / 1e6 : 0.0,
+        static_cast<double>(totals.nanos) /
+            (static_cast<int64_t>(totals.requests) * benchmark_iterations_),
+        totals.in_process ? "in-process" : "round trips");
+  }
+  absl::StrAppendFormat(&output_, "\n");
 }
 
 std::string ConformanceTestSuite::WireFormatToString(WireFormat wire_format) {
@@ -460,6 +553,7 @@ bool ConformanceTestSuite::RunSuite(ConformanceTestRunner* runner,
   test_names_.clear();
   unexpected_failing_tests_.clear();
   unexpected_succeeding_tests_.clear();
+  benchmark_totals_.clear();
 
   output_ = "\nCONFORMANCE TEST BEGIN ====================================\n\n";
 
@@ -512,6 +606,8 @@ bool ConformanceTestSuite::RunSuite(ConformanceTestRunner* runner,
                   output_dir_, &output_);
   }
 
+  ReportBenchmarks();
+
   absl::StrAppendFormat(&output_,
                         "CONFORMANCE SUITE %s: %d successes, %zu skipped, "
                         "%d expected failures, %zu unexpected failures.\n",
@@ -15,12 +15,14 @@
 #define CONFORMANCE_CONFORMANCE_TEST_H
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "google/protobuf/descriptor.pb.h"
 #include "google/protobuf/util/type_resolver.h"
+#include "absl/container/btree_map.h"
 #include "absl/container/btree_set.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
@@ -131,6 +133,7 @@ class ConformanceTestSuite {
   ConformanceTestSuite()
       : verbose_(false),
         performance_(false),
+        benchmark_iterations_(0),
         enforce_recommended_(false),
         maximum_edition_(Edition::EDITION_PROTO3),
         failure_list_flag_name_("--failure_list") {}
@@ -139,6 +142,15 @@ class ConformanceTestSuite {
   void SetPerformance(bool performance) { performance_ = performance; }
   void SetVerbose(bool verbose) { verbose_ = verbose; }
 
+  // If nonzero, every request that the testee handles successfully is then
+  // replayed `iterations` times, and RunSuite() reports the throughput for
+  // each message type and pair of input and output formats.  Testees that
+  // support ConformanceRequest.benchmark_iterations time the replays
+  // in-process; for the others, round trips through the runner are timed.
+  void SetBenchmarkIterations(int iterations) {
+    benchmark_iterations_ = iterations;
+  }
+
   // Whether to require the testee to pass RECOMMENDED tests. By default failing
   // a RECOMMENDED test case will not fail the entire suite but will only
   // generated a warning. If this flag is set to true, RECOMMENDED tests will
@@ -278,6 +290,11 @@ class ConformanceTestSuite {
                const conformance::ConformanceRequest& request,
                conformance::ConformanceResponse* response);
 
+  // Replays a request that succeeded and adds its time to the totals.
+  void RunBenchmark(const std::string& test_name,
+                    const conformance::ConformanceRequest& request);
+  void ReportBenchmarks();
+
   void AddExpectedFailedTest(const std::string& test_name);
 
   virtual void RunSuiteImpl() = 0;
@@ -287,6 +304,7 @@ class ConformanceTestSuite {
   int expected_failures_;
   bool verbose_;
   bool performance_;
+  int benchmark_iterations_;
   bool enforce_recommended_;
   Edition maximum_edition_;
   std::string output_;
@@ -310,6 +328,17 @@ class ConformanceTestSuite {
 
   // The set of tests that the testee opted out of;
   absl::btree_set<std::string> skipped_;
+
+  struct BenchmarkTotals {
+    int requests = 0;
+    int64_t bytes = 0;
+    int64_t nanos = 0;
+    // Whether the testee timed the requests itself, without the pipe.
+    bool in_process = true;
+  };
+
+  // The benchmark totals for each message type and pair of formats.
+  absl::btree_map<std::string, BenchmarkTotals> benchmark_totals_;
 };
 
 }  // namespace protobuf
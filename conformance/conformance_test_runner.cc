@@ -45,6 +45,7 @@
 #include <vector>
 
 #include "absl/log/absl_log.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "conformance/conformance.pb.h"
@@ -130,6 +131,10 @@ void UsageError() {
   fprintf(stderr,
           "  --output_dir                <dirname> Directory to write\n"
           "                              output files.\n");
+  fprintf(stderr,
+          "  --benchmark_iterations <n>  Replay each successful test case\n"
+          "                              n times and report throughput by\n"
+          "                              message type and formats.\n");
   exit(1);
 }
 
@@ -219,6 +224,14 @@ int ForkPipeRunner::Run(int argc, char *argv[],
       } else if (strcmp(argv[arg], "--output_dir") == 0) {
         if (++arg == argc) UsageError();
         suite->SetOutputDir(argv[arg]);
+      } else if (strcmp(argv[arg], "--benchmark_iterations") == 0) {
+        if (++arg == argc) UsageError();
+        int iterations;
+        if (!absl::SimpleAtoi(argv[arg], &iterations) || iterations < 0) {
+          fprintf(stderr, "Invalid iteration count: %s\n", argv[arg]);
+          UsageError();
+        }
+        suite->SetBenchmarkIterations(iterations);
       } else if (argv[arg][0] == '-') {
         bool recognized_flag = false;
         for (ConformanceTestSuite *suite : suites) {
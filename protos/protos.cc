@@ -156,6 +156,28 @@ const upb_Message_Extension* GetOrPromoteExtension(
   return ext;
 }
 
+const upb_Message_Extension* GetPromotedExtension(
+    const upb_Message* msg, const upb_MiniTableExtension* eid) {
+  return _upb_Message_Getext(msg, eid);
+}
+
+absl::Status PromoteExtensions(upb_Message* msg,
+                               const upb_MiniTable* mini_table,
+                               const ExtensionRegistry& extension_registry,
+                               upb_Arena* arena) {
+  const upb_ExtensionRegistry* extreg = GetUpbExtensions(extension_registry);
+  if (extreg == nullptr) {
+    return MessageAllocationError();
+  }
+  MessageLock msg_lock(msg);
+  upb_DecodeStatus status =
+      upb_Message_PromoteExtensions(msg, mini_table, extreg, 0, arena);
+  if (status != kUpb_DecodeStatus_Ok) {
+    return MessageDecodeError(status);
+  }
+  return absl::OkStatus();
+}
+
 absl::StatusOr<absl::string_view> Serialize(const upb_Message* message,
                                             const upb_MiniTable* mini_table,
                                             upb_Arena* arena, int options) {
@@ -248,6 +248,14 @@ bool HasExtensionOrUnknown(const upb_Message* msg,
 const upb_Message_Extension* GetOrPromoteExtension(
     upb_Message* msg, const upb_MiniTableExtension* eid, upb_Arena* arena);
 
+const upb_Message_Extension* GetPromotedExtension(
+    const upb_Message* msg, const upb_MiniTableExtension* eid);
+
+absl::Status PromoteExtensions(upb_Message* msg,
+                               const upb_MiniTable* mini_table,
+                               const ExtensionRegistry& extension_registry,
+                               upb_Arena* arena);
+
 void DeepCopy(upb_Message* target, const upb_Message* source,
               const upb_MiniTable* mini_table, upb_Arena* arena);
 
@@ -449,6 +457,56 @@ absl::StatusOr<Ptr<const Extension>> GetExtension(
   return GetExtension(protos::Ptr(message), id);
 }
 
+// Promotes all extensions of `message` and its sub-messages that are known to
+// `extension_registry` but still stored as unknown fields, e.g. because the
+// message was parsed without the registry.
+//
+// Once a message has been promoted and is no longer mutated, it can be shared
+// between threads and read with GetPromotedExtension(), which never takes the
+// extension lock.
+template <typename T>
+absl::Status PromoteExtensions(
+    Ptr<T> message, const ::protos::ExtensionRegistry& extension_registry) {
+  static_assert(!std::is_const_v<T>);
+  return ::protos::internal::PromoteExtensions(
+      internal::GetInternalMsg(message),
+      ::protos::internal::GetMiniTable(message), extension_registry,
+      ::protos::internal::GetArena(message));
+}
+
+template <typename T>
+absl::Status PromoteExtensions(
+    T* message, const ::protos::ExtensionRegistry& extension_registry) {
+  return PromoteExtensions(protos::Ptr(message), extension_registry);
+}
+
+// Lock-free variant of GetExtension() for extensions that are already
+// promoted, see PromoteExtensions().  Extensions that are only present as
+// unknown fields are reported as not found.
+//
+// The message must not be mutated concurrently.
+template <typename T, typename Extendee, typename Extension,
+          typename = EnableIfProtosClass<T>>
+absl::StatusOr<Ptr<const Extension>> GetPromotedExtension(
+    Ptr<T> message,
+    const ::protos::internal::ExtensionIdentifier<Extendee, Extension>& id) {
+  const upb_Message_Extension* ext = ::protos::internal::GetPromotedExtension(
+      internal::GetInternalMsg(message), id.mini_table_ext());
+  if (!ext) {
+    return ExtensionNotFoundError(id.mini_table_ext()->field.number);
+  }
+  return Ptr<const Extension>(::protos::internal::CreateMessage<Extension>(
+      ext->data.ptr, ::protos::internal::GetArena(message)));
+}
+
+template <typename T, typename Extendee, typename Extension,
+          typename = EnableIfProtosClass<T>>
+absl::StatusOr<Ptr<const Extension>> GetPromotedExtension(
+    const T* message,
+    const ::protos::internal::ExtensionIdentifier<Extendee, Extension>& id) {
+  return GetPromotedExtension(protos::Ptr(message), id);
+}
+
 template <typename T>
 ABSL_MUST_USE_RESULT bool Parse(Ptr<T> message, absl::string_view bytes) {
   static_assert(!std::is_const_v<T>);
@@ -926,6 +926,35 @@ TEST(CppGeneratedCode, ParseWithExtensionRegistry) {
                                ->ext_name());
 }
 
+TEST(CppGeneratedCode, PromoteExtensionsThenGetLockFree) {
+  TestModel model;
+  model.set_str1("Test123");
+  ThemeExtension extension1;
+  extension1.set_ext_name("Hello World");
+  EXPECT_EQ(true, ::protos::SetExtension(&model, theme, extension1).ok());
+  EXPECT_EQ(true,
+            ::protos::SetExtension(model.mutable_recursive_child(), theme,
+                                   extension1)
+                .ok());
+  ::upb::Arena arena;
+  auto bytes = ::protos::Serialize(&model, arena);
+  EXPECT_EQ(true, bytes.ok());
+  TestModel parsed_model = ::protos::Parse<TestModel>(bytes.value()).value();
+  // Parsed without a registry, so the extensions are still unknown fields.
+  EXPECT_EQ(false, ::protos::GetPromotedExtension(&parsed_model, theme).ok());
+
+  ::protos::ExtensionRegistry extensions({&theme}, arena);
+  EXPECT_EQ(true, ::protos::PromoteExtensions(&parsed_model, extensions).ok());
+  EXPECT_EQ(
+      "Hello World",
+      ::protos::GetPromotedExtension(&parsed_model, theme).value()->ext_name());
+  EXPECT_EQ("Hello World",
+            ::protos::GetPromotedExtension(parsed_model.recursive_child(),
+                                           theme)
+                .value()
+                ->ext_name());
+}
+
 TEST(CppGeneratedCode, NameCollisions) {
   TestModel model;
   model.set_template_("test");
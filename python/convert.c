@@ -285,9 +285,6 @@ bool PyUpb_PyToUpb(PyObject* obj, const upb_FieldDef* f, upb_MessageValue* val,
   }
 }
 
-bool upb_Message_IsEqual(const upb_Message* msg1, const upb_Message* msg2,
-                         const upb_MessageDef* m);
-
 // -----------------------------------------------------------------------------
 // Equal
 // -----------------------------------------------------------------------------
@@ -314,37 +311,13 @@ bool PyUpb_ValueEq(upb_MessageValue val1, upb_MessageValue val2,
              memcmp(val1.str_val.data, val2.str_val.data, val1.str_val.size) ==
                  0;
     case kUpb_CType_Message:
-      return upb_Message_IsEqual(val1.msg_val, val2.msg_val,
-                                 upb_FieldDef_MessageSubDef(f));
+      return PyUpb_Message_IsEqualByDef(val1.msg_val, val2.msg_val,
+                                        upb_FieldDef_MessageSubDef(f));
     default:
       return false;
   }
 }
 
-bool PyUpb_Map_IsEqual(const upb_Map* map1, const upb_Map* map2,
-                       const upb_FieldDef* f) {
-  assert(upb_FieldDef_IsMap(f));
-  if (map1 == map2) return true;
-
-  size_t size1 = map1 ? upb_Map_Size(map1) : 0;
-  size_t size2 = map2 ? upb_Map_Size(map2) : 0;
-  if (size1 != size2) return false;
-  if (size1 == 0) return true;
-
-  const upb_MessageDef* entry_m = upb_FieldDef_MessageSubDef(f);
-  const upb_FieldDef* val_f = upb_MessageDef_Field(entry_m, 1);
-  size_t iter = kUpb_Map_Begin;
-
-  upb_MessageValue key, val1;
-  while (upb_Map_Next(map1, &key, &val1, &iter)) {
-    upb_MessageValue val2;
-    if (!upb_Map_Get(map2, key, &val2)) return false;
-    if (!PyUpb_ValueEq(val1, val2, val_f)) return false;
-  }
-
-  return true;
-}
-
 static bool PyUpb_ArrayElem_IsEqual(const upb_Array* arr1,
                                     const upb_Array* arr2, size_t i,
                                     const upb_FieldDef* f) {
@@ -383,64 +356,10 @@ bool PyUpb_Array_IsEqual(const upb_Array* arr1, const upb_Array* arr2,
   return true;
 }
 
-bool upb_Message_IsEqual(const upb_Message* msg1, const upb_Message* msg2,
-                         const upb_MessageDef* m) {
-  if (msg1 == msg2) return true;
-  if (upb_Message_ExtensionCount(msg1) != upb_Message_ExtensionCount(msg2))
-    return false;
-
-  // Compare messages field-by-field.  This is slightly tricky, because while
-  // we can iterate over normal fields in a predictable order, the extension
-  // order is unpredictable and may be different between msg1 and msg2.
-  // So we use the following strategy:
-  //   1. Iterate over all msg1 fields (including extensions).
-  //   2. For non-extension fields, we find the corresponding field by simply
-  //      using upb_Message_Next(msg2).  If the two messages have the same set
-  //      of fields, this will yield the same field.
-  //   3. For extension fields, we have to actually search for the corresponding
-  //      field, which we do with upb_Message_GetFieldByDef(msg2, ext_f1).
-  //   4. Once iteration over msg1 is complete, we call upb_Message_Next(msg2)
-  //   one
-  //      final time to verify that we have visited all of msg2's regular fields
-  //      (we pass NULL for ext_dict so that iteration will *not* return
-  //      extensions).
-  //
-  // We don't need to visit all of msg2's extensions, because we verified up
-  // front that both messages have the same number of extensions.
-  const upb_DefPool* symtab = upb_FileDef_Pool(upb_MessageDef_File(m));
-  const upb_FieldDef *f1, *f2;
-  upb_MessageValue val1, val2;
-  size_t iter1 = kUpb_Message_Begin;
-  size_t iter2 = kUpb_Message_Begin;
-  while (upb_Message_Next(msg1, m, symtab, &f1, &val1, &iter1)) {
-    if (upb_FieldDef_IsExtension(f1)) {
-      val2 = upb_Message_GetFieldByDef(msg2, f1);
-    } else {
-      if (!upb_Message_Next(msg2, m, NULL, &f2, &val2, &iter2) || f1 != f2) {
-        return false;
-      }
-    }
-
-    if (upb_FieldDef_IsMap(f1)) {
-      if (!PyUpb_Map_IsEqual(val1.map_val, val2.map_val, f1)) return false;
-    } else if (upb_FieldDef_IsRepeated(f1)) {
-      if (!PyUpb_Array_IsEqual(val1.array_val, val2.array_val, f1)) {
-        return false;
-      }
-    } else {
-      if (!PyUpb_ValueEq(val1, val2, f1)) return false;
-    }
-  }
-
-  if (upb_Message_Next(msg2, m, NULL, &f2, &val2, &iter2)) return false;
-
-  size_t usize1, usize2;
-  const char* uf1 = upb_Message_GetUnknown(msg1, &usize1);
-  const char* uf2 = upb_Message_GetUnknown(msg2, &usize2);
-  // 100 is arbitrary, we're trying to prevent stack overflow but it's not
-  // obvious how deep we should allow here.
-  return upb_Message_UnknownFieldsAreEqual(uf1, usize1, uf2, usize2, 100) ==
-         kUpb_UnknownCompareResult_Equal;
+bool PyUpb_Message_IsEqualByDef(const upb_Message* msg1,
+                                const upb_Message* msg2,
+                                const upb_MessageDef* m) {
+  return upb_Message_IsEqual(msg1, msg2, upb_MessageDef_MiniTable(m));
 }
 
 #include "upb/port/undef.inc"
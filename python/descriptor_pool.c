@@ -220,7 +220,7 @@ static PyObject* PyUpb_DescriptorPool_DoAddSerializedFile(
       goto done;
     }
     const upb_MessageDef* m = PyUpb_DescriptorPool_GetFileProtoDef();
-    if (upb_Message_IsEqual(proto, existing, m)) {
+    if (PyUpb_Message_IsEqualByDef(proto, existing, m)) {
       result = PyUpb_FileDescriptor_Get(file);
       goto done;
     }
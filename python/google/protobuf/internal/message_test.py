@@ -15,6 +15,7 @@ serialization code in the whole library.
 
 __author__ = 'gps@google.com (Gregory P. Smith)'
 
+import array
 import collections
 import copy
 import math
@@ -789,6 +790,24 @@ class MessageTest(unittest.TestCase):
     self.assertIsInstance(m1.optional_string, str)
     self.assertIsInstance(m1.repeated_string[0], str)
 
+  def testMergeFromStringOutlivesInput(self, message_module):
+    m2 = message_module.TestAllTypes()
+    m2.optional_string = 'a' * 1000
+    m2.repeated_bytes.append(b'b' * 1000)
+
+    # upb may alias immutable inputs, which must then be kept alive.
+    serialized = m2.SerializeToString()
+    m1 = message_module.TestAllTypes.FromString(serialized)
+    del serialized
+    self.assertEqual(m1.optional_string, 'a' * 1000)
+    self.assertEqual(m1.repeated_bytes, [b'b' * 1000])
+
+    # Mutable inputs must be copied.
+    buf = bytearray(m2.SerializeToString())
+    m1 = message_module.TestAllTypes.FromString(buf)
+    buf[:] = bytes(len(buf))
+    self.assertEqual(m1, m2)
+
   def testMergeFromEmpty(self, message_module):
     m1 = message_module.TestAllTypes()
     # Cpp extension will lazily create a sub message which is immutable.
@@ -1125,6 +1144,29 @@ class MessageTest(unittest.TestCase):
     m.repeated_float.extend(MessageTest.TestIterable([3.0, 4.0]))
     self.assertSequenceEqual([0.0, 1.0, 2.0, 3.0, 4.0], m.repeated_float)
 
+  def testExtendNumericWithBuffer(self, message_module):
+    """Test extending repeated numeric fields with buffers."""
+    m = message_module.TestAllTypes()
+    m.repeated_int32.extend(array.array('i', [1, -2]))
+    m.repeated_int32.extend(memoryview(array.array('i', [3])))
+    m.repeated_int32.extend(array.array('b', [4]))
+    self.assertSequenceEqual([1, -2, 3, 4], m.repeated_int32)
+    m.repeated_uint64.extend(array.array('Q', [1 << 63]))
+    self.assertSequenceEqual([1 << 63], m.repeated_uint64)
+    m.repeated_double.extend(array.array('d', [0.5, -1.5]))
+    m.repeated_float.extend(array.array('d', [0.5, -1.5]))
+    self.assertSequenceEqual([0.5, -1.5], m.repeated_double)
+    self.assertSequenceEqual([0.5, -1.5], m.repeated_float)
+    m.repeated_bool.extend(array.array('b', [0, 1]))
+    self.assertSequenceEqual([False, True], m.repeated_bool)
+
+    with self.assertRaises(ValueError):
+      m.repeated_int32.extend(array.array('q', [5, 1 << 40]))
+    self.assertSequenceEqual([1, -2, 3, 4], m.repeated_int32)
+    with self.assertRaises(ValueError):
+      m.repeated_uint32.extend(array.array('i', [-1]))
+    self.assertSequenceEqual([], m.repeated_uint32)
+
   def testExtendStringWithIterable(self, message_module):
     """Test extending repeated string fields with iterable."""
     m = message_module.TestAllTypes()
@@ -1455,6 +1497,70 @@ class Proto2Test(unittest.TestCase):
     if api_implementation.Type() != 'upb':
       self.assertEqual(golden_data, golden_copy.SerializeToString())
 
+  @unittest.skipIf(api_implementation.Type() != 'upb',
+                   '_SerializeInto() is only implemented by upb.')
+  def testSerializeInto(self):
+    msg = unittest_pb2.TestAllTypes()
+    test_util.SetAllFields(msg)
+    serialized = msg.SerializeToString(deterministic=True)
+    buf = bytearray(len(serialized) + 10)
+    size = msg._SerializeInto(buf, deterministic=True)
+    self.assertEqual(size, len(serialized))
+    self.assertEqual(bytes(buf[:size]), serialized)
+
+    with self.assertRaises(ValueError):
+      msg._SerializeInto(bytearray(len(serialized) - 1))
+    # Not writable.
+    with self.assertRaises((BufferError, TypeError)):
+      msg._SerializeInto(serialized)
+
+    incomplete = unittest_pb2.TestRequired(a=1)
+    with self.assertRaises(message.EncodeError):
+      incomplete._SerializeInto(buf)
+    size = incomplete._SerializeInto(buf, partial=True)
+    self.assertEqual(bytes(buf[:size]), incomplete.SerializePartialToString())
+
+  @unittest.skipIf(api_implementation.Type() != 'upb',
+                   'Field properties are specific to upb.')
+  def testFieldProperties(self):
+    prop = unittest_pb2.TestAllTypes.__dict__['optional_int32']
+    msg = unittest_pb2.TestAllTypes(optional_int32=5)
+    self.assertIs(unittest_pb2.TestAllTypes.optional_int32, prop)
+    self.assertEqual(prop.__get__(msg), 5)
+    self.assertEqual(msg.optional_int32, 5)
+    with self.assertRaises(TypeError):
+      prop.__get__(unittest_pb2.ForeignMessage())
+    with self.assertRaises(TypeError):
+      prop.__get__(object())
+
+  @unittest.skipIf(api_implementation.Type() != 'upb',
+                   'Only upb exposes repeated fields as buffers.')
+  def testRepeatedScalarBuffer(self):
+    msg = unittest_pb2.TestAllTypes()
+    msg.repeated_double.extend([1.5, -2.0])
+    msg.repeated_int64.extend([1, -(1 << 40)])
+    try:
+      view = memoryview(msg.repeated_double)
+    except TypeError:
+      self.skipTest('Built without the buffer protocol.')
+    self.assertTrue(view.readonly)
+    self.assertEqual(view.format, 'd')
+    self.assertEqual(view.tolist(), [1.5, -2.0])
+    msg.repeated_double[0] = 3.0
+    self.assertEqual(view.tolist(), [3.0, -2.0])
+
+    view = memoryview(msg.repeated_int64)
+    self.assertEqual(view.tolist(), [1, -(1 << 40)])
+    self.assertEqual(memoryview(msg.repeated_bool).tolist(), [])
+    self.assertEqual(memoryview(msg.repeated_nested_enum).format, 'i')
+    with self.assertRaises(BufferError):
+      memoryview(msg.repeated_string)
+
+    # Views outlive both the message and changes to the field's size.
+    msg.repeated_int64.extend(range(1000))
+    del msg
+    self.assertEqual(view.tolist(), [1, -(1 << 40)])
+
   def testPickleIncompleteProto(self):
     golden_message = unittest_pb2.TestRequired(a=1)
     pickled_message = pickle.dumps(golden_message)
@@ -681,6 +681,9 @@ def Parse(text,
   Raises:
     ParseError: On text parsing problems.
   """
+  if _MergeFromText(text, message, False, allow_unknown_extension,
+                    allow_field_number, descriptor_pool, allow_unknown_field):
+    return message
   return ParseLines(text.split(b'\n' if isinstance(text, bytes) else u'\n'),
                     message,
                     allow_unknown_extension,
@@ -718,6 +721,9 @@ def Merge(text,
   Raises:
     ParseError: On text parsing problems.
   """
+  if _MergeFromText(text, message, True, allow_unknown_extension,
+                    allow_field_number, descriptor_pool, allow_unknown_field):
+    return message
   return MergeLines(
       text.split(b'\n' if isinstance(text, bytes) else u'\n'),
       message,
@@ -727,6 +733,25 @@ def Merge(text,
       allow_unknown_field=allow_unknown_field)
 
 
+def _MergeFromText(text, message, allow_multiple_scalars,
+                   allow_unknown_extension, allow_field_number, descriptor_pool,
+                   allow_unknown_field):
+  """Parses text with the upb text decoder when the backend provides one.
+
+  Only the default options are supported.  Returns False without modifying the
+  message if the fast path does not apply or the text does not parse, so that
+  the caller can report errors from the pure-Python parser.
+  """
+  if (allow_unknown_extension or allow_field_number or
+      descriptor_pool is not None or allow_unknown_field or
+      not isinstance(text, str)):
+    return False
+  merge_from_text = getattr(message, '_MergeFromText', None)
+  if merge_from_text is None:
+    return False
+  return merge_from_text(text, allow_multiple_scalars)
+
+
 def ParseLines(lines,
                message,
                allow_unknown_extension=False,
@@ -32,12 +32,14 @@
 
 #include "python/convert.h"
 #include "python/descriptor.h"
+#include "python/descriptor_pool.h"
 #include "python/extension_dict.h"
 #include "python/map.h"
 #include "python/repeated.h"
 #include "upb/message/copy.h"
 #include "upb/reflection/def.h"
 #include "upb/reflection/message.h"
+#include "upb/text/decode.h"
 #include "upb/text/encode.h"
 #include "upb/util/required_fields.h"
 
@@ -381,10 +383,10 @@ err:
 
 void PyUpb_Message_EnsureReified(PyUpb_Message* self);
 
-static bool PyUpb_Message_InitMapAttribute(PyObject* _self, PyObject* name,
+static bool PyUpb_Message_InitMapAttribute(PyObject* _self,
                                            const upb_FieldDef* f,
                                            PyObject* value) {
-  PyObject* map = PyUpb_Message_GetAttr(_self, name);
+  PyObject* map = PyUpb_Message_GetFieldValue(_self, f);
   int ok = PyUpb_Message_InitMapAttributes(map, value, f);
   Py_DECREF(map);
   return ok >= 0;
@@ -454,9 +456,10 @@ err:
   return ok;
 }
 
-static bool PyUpb_Message_InitMessageAttribute(PyObject* _self, PyObject* name,
+static bool PyUpb_Message_InitMessageAttribute(PyObject* _self,
+                                               const upb_FieldDef* f,
                                                PyObject* value) {
-  PyObject* submsg = PyUpb_Message_GetAttr(_self, name);
+  PyObject* submsg = PyUpb_Message_GetFieldValue(_self, f);
   if (!submsg) return -1;
   assert(!PyErr_Occurred());
   bool ok;
@@ -520,11 +523,11 @@ int PyUpb_Message_InitAttributes(PyObject* _self, PyObject* args,
     assert(!PyErr_Occurred());
 
     if (upb_FieldDef_IsMap(f)) {
-      if (!PyUpb_Message_InitMapAttribute(_self, name, f, value)) return -1;
+      if (!PyUpb_Message_InitMapAttribute(_self, f, value)) return -1;
     } else if (upb_FieldDef_IsRepeated(f)) {
       if (!PyUpb_Message_InitRepeatedAttribute(_self, name, value)) return -1;
     } else if (upb_FieldDef_IsSubMessage(f)) {
-      if (!PyUpb_Message_InitMessageAttribute(_self, name, value)) return -1;
+      if (!PyUpb_Message_InitMessageAttribute(_self, f, value)) return -1;
     } else {
       if (!PyUpb_Message_InitScalarAttribute(msg, f, value, arena)) return -1;
     }
@@ -598,7 +601,7 @@ static bool PyUpb_Message_IsEqual(PyUpb_Message* m1, PyObject* _m2) {
   const bool e2 = PyUpb_Message_IsEmpty(m2_msg, m1_msgdef, symtab);
   if (e1 || e2) return e1 && e2;
 
-  return upb_Message_IsEqual(m1_msg, m2_msg, m1_msgdef);
+  return PyUpb_Message_IsEqualByDef(m1_msg, m2_msg, m1_msgdef);
 }
 
 static const upb_FieldDef* PyUpb_Message_InitAsMsg(PyUpb_Message* m,
@@ -992,16 +995,9 @@ int PyUpb_Message_GetVersion(PyObject* _self) {
  */
 __attribute__((flatten)) static PyObject* PyUpb_Message_GetAttr(
     PyObject* _self, PyObject* attr) {
-  PyUpb_Message* self = (void*)_self;
-
-  // Lookup field by name.
-  const upb_FieldDef* field;
-  if (PyUpb_Message_LookupName(self, attr, &field, NULL, NULL)) {
-    return PyUpb_Message_GetFieldValue(_self, field);
-  }
-
-  // Check base class attributes.
-  assert(!PyErr_Occurred());
+  // Fields are found here too, through the FieldProperty objects that
+  // MessageMeta puts into the class dict.  They take precedence over the
+  // attributes of the base classes, as they live in the most derived class.
   PyObject* ret = PyObject_GenericGetAttr(_self, attr);
   if (ret) return ret;
 
@@ -1260,21 +1256,67 @@ static PyObject* PyUpb_Message_UnknownFields(PyObject* _self, PyObject* arg) {
   return NULL;
 }
 
+// Inputs at least this large are aliased rather than copied when possible.
+// Below this, copying the strings is cheaper than keeping the input alive.
+#define PYUPB_ALIAS_MIN_SIZE 512
+
+// Gets the serialized data in `arg`, which may be `bytes` or (if the buffer
+// API is available) any contiguous buffer.  Returns a new reference to an
+// object that keeps `*buf` alive for as long as it is held, or NULL with an
+// error set.  `*immutable` is set if the data will never change, so that the
+// parsed message can alias it.
+static PyObject* PyUpb_Message_GetSerialized(PyObject* arg, char** buf,
+                                             Py_ssize_t* size,
+                                             bool* immutable) {
+  *immutable = true;
+  if (PyBytes_Check(arg)) {
+    if (PyBytes_AsStringAndSize(arg, buf, size) < 0) return NULL;
+    Py_INCREF(arg);
+    return arg;
+  }
+
+#if PYUPB_HAS_BUFFER_API
+  // The memoryview holds an export of the buffer, so the memory cannot move or
+  // be freed while we hold it, even after we release our own view below.
+  PyObject* mv = PyMemoryView_FromObject(arg);
+  if (!mv) return NULL;
+  Py_buffer view;
+  if (PyObject_GetBuffer(mv, &view, PyBUF_SIMPLE) == 0) {
+    *buf = view.buf;
+    *size = view.len;
+    // Read-only buffers (bytes, read-only mmaps) are trusted not to change.
+    *immutable = view.readonly;
+    PyBuffer_Release(&view);
+    return mv;
+  }
+  // Not contiguous, make a contiguous copy.
+  PyErr_Clear();
+  PyObject* bytes = PyBytes_FromObject(mv);
+  Py_DECREF(mv);
+#else
+  if (!PyMemoryView_Check(arg)) {
+    // Raises the same TypeError as before buffers were supported.
+    PyBytes_AsStringAndSize(arg, buf, size);
+    return NULL;
+  }
+  PyObject* bytes = PyBytes_FromObject(arg);
+#endif
+  if (!bytes) return NULL;
+  // Cannot fail when passed something of the correct type.
+  int err = PyBytes_AsStringAndSize(bytes, buf, size);
+  (void)err;
+  assert(err >= 0);
+  return bytes;
+}
+
 PyObject* PyUpb_Message_MergeFromString(PyObject* _self, PyObject* arg) {
   PyUpb_Message* self = (void*)_self;
   char* buf;
   Py_ssize_t size;
-  PyObject* bytes = NULL;
-
-  if (PyMemoryView_Check(arg)) {
-    bytes = PyBytes_FromObject(arg);
-    // Cannot fail when passed something of the correct type.
-    int err = PyBytes_AsStringAndSize(bytes, &buf, &size);
-    (void)err;
-    assert(err >= 0);
-  } else if (PyBytes_AsStringAndSize(arg, &buf, &size) < 0) {
-    return NULL;
-  }
+  bool immutable;
+  PyObject* serialized =
+      PyUpb_Message_GetSerialized(arg, &buf, &size, &immutable);
+  if (!serialized) return NULL;
 
   PyUpb_Message_EnsureReified(self);
   const upb_MessageDef* msgdef = _PyUpb_Message_GetMsgdef(self);
@@ -1286,9 +1328,15 @@ PyObject* PyUpb_Message_MergeFromString(PyObject* _self, PyObject* arg) {
   PyUpb_ModuleState* state = PyUpb_ModuleState_Get();
   int options =
       upb_DecodeOptions_MaxDepth(state->allow_oversize_protos ? UINT16_MAX : 0);
+  // Strings in the message point into the input instead of being copied, with
+  // the arena holding on to the input.
+  if (immutable && size >= PYUPB_ALIAS_MIN_SIZE &&
+      PyUpb_Arena_KeepAlive(arena, serialized)) {
+    options |= kUpb_DecodeOption_AliasString;
+  }
   upb_DecodeStatus status =
       upb_Decode(buf, size, self->ptr.msg, layout, extreg, options, arena);
-  Py_XDECREF(bytes);
+  Py_DECREF(serialized);
   if (status != kUpb_DecodeStatus_Ok) {
     PyErr_Format(state->decode_error_class, "Error parsing message");
     return NULL;
@@ -1303,6 +1351,52 @@ static PyObject* PyUpb_Message_ParseFromString(PyObject* self, PyObject* arg) {
   return PyUpb_Message_MergeFromString(self, arg);
 }
 
+// Fast path for text_format.Parse()/Merge() with default options.  Returns
+// False, leaving the message unchanged, whenever the text cannot be handled
+// here, so that the caller can fall back to the pure-Python parser (which
+// also produces the detailed error messages).
+static PyObject* PyUpb_Message_MergeFromText(PyObject* _self, PyObject* args) {
+  PyUpb_Message* self = (void*)_self;
+  const char* buf;
+  Py_ssize_t size;
+  int allow_multiple_scalars;
+
+  if (!PyArg_ParseTuple(args, "s#p", &buf, &size, &allow_multiple_scalars)) {
+    // Includes strings that cannot be encoded as UTF-8.
+    PyErr_Clear();
+    Py_RETURN_FALSE;
+  }
+
+  // Parsing into a stub must not mark it as present if the text is empty, and
+  // restoring an already populated message after a failure is not possible.
+  if (PyUpb_Message_IsStub(self)) Py_RETURN_FALSE;
+  const upb_MessageDef* msgdef = _PyUpb_Message_GetMsgdef(self);
+  const upb_DefPool* symtab = upb_FileDef_Pool(upb_MessageDef_File(msgdef));
+  const upb_FieldDef* f;
+  upb_MessageValue val;
+  size_t iter = kUpb_Message_Begin;
+  if (upb_Message_Next(self->ptr.msg, msgdef, symtab, &f, &val, &iter)) {
+    Py_RETURN_FALSE;
+  }
+
+  // The pure-Python parser resolves Any types in the default pool.
+  PyObject* pool = PyUpb_DescriptorPool_GetDefaultPool();
+  if (symtab != PyUpb_DescriptorPool_GetSymtab(pool)) Py_RETURN_FALSE;
+
+  int options =
+      allow_multiple_scalars ? upb_TextDecode_AllowMultipleScalars : 0;
+  upb_Status status;
+  upb_Status_Clear(&status);
+  if (!upb_TextDecode(buf, size, self->ptr.msg, msgdef, symtab, options,
+                      PyUpb_Arena_Get(self->arena), &status)) {
+    PyObject* tmp = PyUpb_Message_Clear(self);
+    Py_DECREF(tmp);
+    Py_RETURN_FALSE;
+  }
+  PyUpb_Message_SyncSubobjs(self);
+  Py_RETURN_TRUE;
+}
+
 static PyObject* PyUpb_Message_ByteSize(PyObject* self, PyObject* args) {
   // TODO: At the
   // moment upb does not have a "byte size" function, so we just serialize to
@@ -1524,61 +1618,128 @@ done:
   Py_DECREF(errors);
 }
 
-PyObject* PyUpb_Message_SerializeInternal(PyObject* _self, PyObject* args,
-                                          PyObject* kwargs,
-                                          bool check_required) {
-  PyUpb_Message* self = (void*)_self;
-  if (!PyUpb_Message_Verify((PyObject*)self)) return NULL;
-  static const char* kwlist[] = {"deterministic", NULL};
-  int deterministic = 0;
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|p", (char**)(kwlist),
-                                   &deterministic)) {
-    return NULL;
-  }
-
+// Serializes the message into `arena`, setting an EncodeError on failure.
+static bool PyUpb_Message_Encode(PyUpb_Message* self, bool check_required,
+                                 bool deterministic, upb_Arena* arena,
+                                 char** pb, size_t* size) {
   const upb_MessageDef* msgdef = _PyUpb_Message_GetMsgdef(self);
+  PyUpb_ModuleState* state = PyUpb_ModuleState_Get();
   if (PyUpb_Message_IsStub(self)) {
     // Nothing to serialize, but we do have to check whether the message is
     // initialized.
-    PyUpb_ModuleState* state = PyUpb_ModuleState_Get();
-    PyObject* errors = PyUpb_Message_FindInitializationErrors(_self, NULL);
-    if (!errors) return NULL;
+    PyObject* errors =
+        PyUpb_Message_FindInitializationErrors((PyObject*)self, NULL);
+    if (!errors) return false;
     if (PyList_Size(errors) == 0) {
       Py_DECREF(errors);
-      return PyBytes_FromStringAndSize(NULL, 0);
+      *pb = NULL;
+      *size = 0;
+      return true;
     }
     PyUpb_Message_ReportInitializationErrors(msgdef, errors,
                                              state->encode_error_class);
-    return NULL;
+    return false;
   }
 
-  upb_Arena* arena = upb_Arena_New();
   const upb_MiniTable* layout = upb_MessageDef_MiniTable(msgdef);
-  size_t size = 0;
   // Python does not currently have any effective limit on serialization depth.
   int options = upb_EncodeOptions_MaxDepth(UINT16_MAX);
   if (check_required) options |= kUpb_EncodeOption_CheckRequired;
   if (deterministic) options |= kUpb_EncodeOption_Deterministic;
-  char* pb;
   upb_EncodeStatus status =
-      upb_Encode(self->ptr.msg, layout, options, arena, &pb, &size);
+      upb_Encode(self->ptr.msg, layout, options, arena, pb, size);
+  if (status == kUpb_EncodeStatus_Ok) return true;
+
+  PyObject* errors =
+      PyUpb_Message_FindInitializationErrors((PyObject*)self, NULL);
+  if (PyList_Size(errors) != 0) {
+    PyUpb_Message_ReportInitializationErrors(msgdef, errors,
+                                             state->encode_error_class);
+  } else {
+    PyErr_Format(state->encode_error_class, "Failed to serialize proto");
+  }
+  return false;
+}
+
+PyObject* PyUpb_Message_SerializeInternal(PyObject* _self, PyObject* args,
+                                          PyObject* kwargs,
+                                          bool check_required) {
+  PyUpb_Message* self = (void*)_self;
+  if (!PyUpb_Message_Verify((PyObject*)self)) return NULL;
+  static const char* kwlist[] = {"deterministic", NULL};
+  int deterministic = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|p", (char**)(kwlist),
+                                   &deterministic)) {
+    return NULL;
+  }
+
+  upb_Arena* arena = upb_Arena_New();
+  char* pb;
+  size_t size;
   PyObject* ret = NULL;
+  if (PyUpb_Message_Encode(self, check_required, deterministic, arena, &pb,
+                           &size)) {
+    ret = PyBytes_FromStringAndSize(pb, size);
+  }
+  upb_Arena_Free(arena);
+  return ret;
+}
 
-  if (status != kUpb_EncodeStatus_Ok) {
-    PyUpb_ModuleState* state = PyUpb_ModuleState_Get();
-    PyObject* errors = PyUpb_Message_FindInitializationErrors(_self, NULL);
-    if (PyList_Size(errors) != 0) {
-      PyUpb_Message_ReportInitializationErrors(msgdef, errors,
-                                               state->encode_error_class);
-    } else {
-      PyErr_Format(state->encode_error_class, "Failed to serialize proto");
-    }
-    goto done;
+// Copies `size` bytes to the start of `obj`, which must be a writable buffer
+// (only a bytearray without the buffer API) of at least that size.
+static bool PyUpb_Message_CopyToBuffer(PyObject* obj, const char* data,
+                                       size_t size) {
+#if PYUPB_HAS_BUFFER_API
+  Py_buffer view;
+  if (PyObject_GetBuffer(obj, &view, PyBUF_WRITABLE) < 0) return false;
+  char* dst = view.buf;
+  Py_ssize_t capacity = view.len;
+#else
+  if (!PyByteArray_Check(obj)) {
+    PyErr_SetString(PyExc_TypeError, "Expected a bytearray.");
+    return false;
   }
+  char* dst = PyByteArray_AsString(obj);
+  Py_ssize_t capacity = PyByteArray_Size(obj);
+#endif
+  bool ok = (size_t)capacity >= size;
+  if (ok) {
+    if (size) memcpy(dst, data, size);
+  } else {
+    PyErr_Format(PyExc_ValueError,
+                 "Buffer of %zd bytes is too small for %zu byte message",
+                 capacity, size);
+  }
+#if PYUPB_HAS_BUFFER_API
+  PyBuffer_Release(&view);
+#endif
+  return ok;
+}
 
-  ret = PyBytes_FromStringAndSize(pb, size);
+// Serializes into a caller-provided buffer instead of a new bytes object, so
+// that a buffer can be reused across messages.  Returns the number of bytes
+// written.
+static PyObject* PyUpb_Message_SerializeInto(PyObject* _self, PyObject* args,
+                                             PyObject* kwargs) {
+  PyUpb_Message* self = (void*)_self;
+  if (!PyUpb_Message_Verify(_self)) return NULL;
+  static const char* kwlist[] = {"buffer", "deterministic", "partial", NULL};
+  PyObject* buffer;
+  int deterministic = 0;
+  int partial = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|pp", (char**)(kwlist),
+                                   &buffer, &deterministic, &partial)) {
+    return NULL;
+  }
 
-done:
+  upb_Arena* arena = upb_Arena_New();
+  char* pb;
+  size_t size;
+  PyObject* ret = NULL;
+  if (PyUpb_Message_Encode(self, !partial, deterministic, arena, &pb, &size) &&
+      PyUpb_Message_CopyToBuffer(buffer, pb, size)) {
+    ret = PyLong_FromSize_t(size);
+  }
   upb_Arena_Free(arena);
   return ret;
 }
@@ -1697,6 +1858,11 @@ static PyMethodDef PyUpb_Message_Methods[] = {
     {"WhichOneof", PyUpb_Message_WhichOneof, METH_O,
      "Returns the name of the field set inside a oneof, "
      "or None if no field is set."},
+    {"_MergeFromText", PyUpb_Message_MergeFromText, METH_VARARGS,
+     "Merges text format into an empty message if possible."},
+    {"_SerializeInto", (PyCFunction)PyUpb_Message_SerializeInto,
+     METH_VARARGS | METH_KEYWORDS,
+     "Serializes the message into a writable buffer, returning its size."},
     {"_ListFieldsItemKey", PyUpb_Message_ListFieldsItemKey,
      METH_O | METH_STATIC,
      "Compares ListFields() list entries by field number"},
@@ -1728,6 +1894,97 @@ PyType_Spec PyUpb_Message_Spec = {
     PyUpb_Message_Slots,
 };
 
+// -----------------------------------------------------------------------------
+// FieldProperty
+// -----------------------------------------------------------------------------
+
+// MessageMeta puts one FieldProperty per field into the dict of every message
+// class.  This lets `msg.foo` be resolved by CPython's type attribute cache,
+// which is keyed by the (interned) attribute name, instead of hashing the name
+// into the upb_MessageDef's table on every access.
+
+typedef struct {
+  PyObject_HEAD;
+  PyObject* pool;             // We own a ref.
+  const upb_FieldDef* field;  // Kept alive by "pool".
+} PyUpb_FieldProperty;
+
+static PyObject* PyUpb_FieldProperty_New(PyObject* pool,
+                                         const upb_FieldDef* f) {
+  PyUpb_ModuleState* state = PyUpb_ModuleState_Get();
+  PyUpb_FieldProperty* prop =
+      (void*)PyType_GenericAlloc(state->field_property_type, 0);
+  if (!prop) return NULL;
+  prop->pool = pool;
+  prop->field = f;
+  Py_INCREF(pool);
+  return &prop->ob_base;
+}
+
+static void PyUpb_FieldProperty_Dealloc(PyObject* _self) {
+  PyUpb_FieldProperty* self = (void*)_self;
+  Py_DECREF(self->pool);
+  PyUpb_Dealloc(self);
+}
+
+static PyObject* PyUpb_FieldProperty_DescrGet(PyObject* _self, PyObject* obj,
+                                              PyObject* type) {
+  PyUpb_FieldProperty* self = (void*)_self;
+  if (!obj) return PyUpb_NewRef(_self);  // Accessed on the class.
+  if (!PyUpb_Message_Verify(obj)) return NULL;
+  if (PyUpb_Message_GetMsgdef(obj) !=
+      upb_FieldDef_ContainingType(self->field)) {
+    return PyErr_Format(PyExc_TypeError, "Field %s does not belong to %R.",
+                        upb_FieldDef_FullName(self->field), obj);
+  }
+  return PyUpb_Message_GetFieldValue(obj, self->field);
+}
+
+static PyObject* PyUpb_FieldProperty_Repr(PyObject* _self) {
+  PyUpb_FieldProperty* self = (void*)_self;
+  return PyUnicode_FromFormat("<field property '%s'>",
+                              upb_FieldDef_FullName(self->field));
+}
+
+static PyType_Slot PyUpb_FieldProperty_Slots[] = {
+    {Py_tp_dealloc, PyUpb_FieldProperty_Dealloc},
+    {Py_tp_descr_get, PyUpb_FieldProperty_DescrGet},
+    {Py_tp_repr, PyUpb_FieldProperty_Repr},
+    {0, NULL}};
+
+static PyType_Spec PyUpb_FieldProperty_Spec = {
+    PYUPB_MODULE_NAME "._FieldProperty",  // tp_name
+    sizeof(PyUpb_FieldProperty),          // tp_basicsize
+    0,                                    // tp_itemsize
+    Py_TPFLAGS_DEFAULT,                   // tp_flags
+    PyUpb_FieldProperty_Slots,
+};
+
+// Adds a FieldProperty for every field of `m` to `dict`, the dict of the class
+// being created.  Names that the dict already has (ie. DESCRIPTOR) are left
+// alone.
+static bool PyUpb_MessageMeta_AddFieldProperties(PyObject* dict,
+                                                 const upb_MessageDef* m) {
+  const upb_FileDef* file = upb_MessageDef_File(m);
+  PyObject* pool = PyUpb_DescriptorPool_Get(upb_FileDef_Pool(file));
+  if (!pool) return false;
+  bool ok = true;
+  for (int i = 0, n = upb_MessageDef_FieldCount(m); ok && i < n; i++) {
+    const upb_FieldDef* f = upb_MessageDef_Field(m, i);
+    PyObject* name = PyUnicode_InternFromString(upb_FieldDef_Name(f));
+    int present = name ? PyDict_Contains(dict, name) : -1;
+    if (present == 0) {
+      PyObject* prop = PyUpb_FieldProperty_New(pool, f);
+      present = prop ? PyDict_SetItem(dict, name, prop) : -1;
+      Py_XDECREF(prop);
+    }
+    Py_XDECREF(name);
+    ok = present >= 0;
+  }
+  Py_DECREF(pool);
+  return ok;
+}
+
 // -----------------------------------------------------------------------------
 // MessageMeta
 // -----------------------------------------------------------------------------
@@ -1779,6 +2036,7 @@ PyObject* PyUpb_MessageMeta_DoCreateClass(PyObject* py_descriptor,
   int status = PyDict_SetItemString(dict, "__slots__", slots);
   Py_DECREF(slots);
   if (status < 0) return NULL;
+  if (!PyUpb_MessageMeta_AddFieldProperties(dict, msgdef)) return NULL;
 
   // Bases are either:
   //    (Message, Message)            # for regular messages
@@ -1985,9 +2243,13 @@ bool PyUpb_InitMessage(PyObject* m) {
 
   PyUpb_ModuleState* state = PyUpb_ModuleState_GetFromModule(m);
   state->cmessage_type = PyUpb_AddClass(m, &PyUpb_Message_Spec);
+  state->field_property_type = PyUpb_AddClass(m, &PyUpb_FieldProperty_Spec);
   state->message_meta_type = (PyTypeObject*)message_meta_type;
 
-  if (!state->cmessage_type || !state->message_meta_type) return false;
+  if (!state->cmessage_type || !state->field_property_type ||
+      !state->message_meta_type) {
+    return false;
+  }
   if (PyModule_AddObject(m, "MessageMeta", message_meta_type)) return false;
   state->listfields_item_key = PyObject_GetAttrString(
       (PyObject*)state->cmessage_type, "_ListFieldsItemKey");
@@ -277,6 +277,48 @@ PyObject* PyUpb_Arena_New(void) {
   return &arena->ob_base;
 }
 
+// The allocator of an arena that does nothing but hold a reference to an
+// object.  The arena only ever has its first block, so freeing that block means
+// the arena (and every arena fused with it) is gone.
+typedef struct {
+  upb_alloc alloc;
+  PyObject* obj;
+} PyUpb_ArenaOwner;
+
+static void* PyUpb_ArenaOwner_AllocFunc(upb_alloc* alloc, void* ptr,
+                                        size_t oldsize, size_t size) {
+  (void)oldsize;
+  if (size) return realloc(ptr, size);
+  PyUpb_ArenaOwner* owner = (PyUpb_ArenaOwner*)alloc;
+  free(ptr);
+  // Arenas may be freed by other languages, without the GIL held.
+  PyGILState_STATE gil = PyGILState_Ensure();
+  Py_DECREF(owner->obj);
+  PyGILState_Release(gil);
+  free(owner);
+  return NULL;
+}
+
+bool PyUpb_Arena_KeepAlive(upb_Arena* arena, PyObject* obj) {
+  PyUpb_ArenaOwner* owner = malloc(sizeof(*owner));
+  if (!owner) return false;
+  owner->alloc.func = &PyUpb_ArenaOwner_AllocFunc;
+  upb_Arena* owner_arena = upb_Arena_Init(NULL, 0, &owner->alloc);
+  if (!owner_arena) {
+    free(owner);
+    return false;
+  }
+  Py_INCREF(obj);
+  owner->obj = obj;
+  // None of our arenas have an initial block, so fusing cannot fail.  Being
+  // fused also keeps the owner's block out of the arena block cache.
+  bool ok = upb_Arena_Fuse(arena, owner_arena);
+  (void)ok;
+  assert(ok);
+  upb_Arena_Free(owner_arena);
+  return true;
+}
+
 static void PyUpb_Arena_Dealloc(PyObject* self) {
   upb_Arena_Free(PyUpb_Arena_Get(self));
   PyUpb_Dealloc(self);
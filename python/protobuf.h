@@ -98,6 +98,7 @@ typedef struct {
   PyObject* enum_type_wrapper_class;
   PyObject* message_class;
   PyTypeObject* cmessage_type;
+  PyTypeObject* field_property_type;
   PyTypeObject* message_meta_type;
   PyObject* listfields_item_key;
 
@@ -189,6 +190,11 @@ PyUpb_WeakMap* PyUpb_ObjCache_Instance(void);
 PyObject* PyUpb_Arena_New(void);
 upb_Arena* PyUpb_Arena_Get(PyObject* arena);
 
+// Holds a reference to `obj` until `arena` and every arena fused with it are
+// freed, so that messages in the arena can alias memory owned by `obj`.
+// Returns false if out of memory.
+bool PyUpb_Arena_KeepAlive(upb_Arena* arena, PyObject* obj);
+
 // -----------------------------------------------------------------------------
 // Utilities
 // -----------------------------------------------------------------------------
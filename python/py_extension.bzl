@@ -54,5 +54,8 @@ def py_extension(name, srcs, copts, deps = [], **kwargs):
         name = name,
         data = [output_file],
         imports = ["."],
-        visibility = ["//python:__subpackages__"],
+        visibility = [
+            "//benchmarks:__pkg__",
+            "//python:__subpackages__",
+        ],
     )
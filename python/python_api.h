@@ -61,4 +61,12 @@ PyAPI_FUNC(const char*)
     PyUnicode_AsUTF8AndSize(PyObject* unicode, Py_ssize_t* size);
 #endif
 
+// The buffer protocol only joined the limited API in 3.11.  Without it we can
+// read `bytes` and `bytearray`, but not arbitrary buffers such as mmap.
+#if !defined(Py_LIMITED_API) || Py_LIMITED_API >= 0x030b0000
+#define PYUPB_HAS_BUFFER_API 1
+#else
+#define PYUPB_HAS_BUFFER_API 0
+#endif
+
 #endif  // PYUPB_PYTHON_H__
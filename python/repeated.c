@@ -30,6 +30,8 @@
 
 #include "python/repeated.h"
 
+#include <string.h>
+
 #include "python/convert.h"
 #include "python/message.h"
 #include "python/protobuf.h"
@@ -188,9 +190,112 @@ PyObject* PyUpb_RepeatedContainer_DeepCopy(PyObject* _self, PyObject* value) {
   return (PyObject*)clone;
 }
 
+#if PYUPB_HAS_BUFFER_API
+// Returns the buffer format (as in the struct module) of the elements of a
+// repeated field of the given type, or NULL if the field is not numeric.
+static const char* PyUpb_RepeatedContainer_BufferFormat(upb_CType type,
+                                                        Py_ssize_t* itemsize) {
+  switch (type) {
+    case kUpb_CType_Bool:
+      *itemsize = 1;
+      return "?";
+    case kUpb_CType_Float:
+      *itemsize = 4;
+      return "f";
+    case kUpb_CType_Int32:
+    case kUpb_CType_Enum:
+      *itemsize = 4;
+      return "i";
+    case kUpb_CType_UInt32:
+      *itemsize = 4;
+      return "I";
+    case kUpb_CType_Double:
+      *itemsize = 8;
+      return "d";
+    case kUpb_CType_Int64:
+      *itemsize = 8;
+      return "q";
+    case kUpb_CType_UInt64:
+      *itemsize = 8;
+      return "Q";
+    default:
+      return NULL;
+  }
+}
+
+// Returns true if `view` holds elements laid out exactly like those of a
+// repeated field of `type`, so that they can be copied without conversion.
+// Bools and enums are excluded, since their values would need checking.
+static bool PyUpb_RepeatedContainer_IsBufferCompatible(const Py_buffer* view,
+                                                       upb_CType type) {
+  Py_ssize_t itemsize;
+  if (type == kUpb_CType_Bool || type == kUpb_CType_Enum ||
+      !PyUpb_RepeatedContainer_BufferFormat(type, &itemsize) ||
+      view->itemsize != itemsize) {
+    return false;
+  }
+  const char* format = view->format ? view->format : "B";
+  if (*format == '@' || *format == '=') format++;  // Native byte order.
+  if (format[0] == '\0' || format[1] != '\0') return false;
+  const char* kinds;
+  switch (type) {
+    case kUpb_CType_Float:
+    case kUpb_CType_Double:
+      kinds = "fd";
+      break;
+    case kUpb_CType_Int32:
+    case kUpb_CType_Int64:
+      kinds = "bhilqn";
+      break;
+    default:
+      kinds = "BHILQN";
+      break;
+  }
+  return strchr(kinds, *format) != NULL;
+}
+
+// Appends the elements of `value` with a single copy if it is a contiguous
+// buffer of the field's element type.  Returns false, with the array
+// unchanged and no error set, if `value` is not such a buffer.
+static bool PyUpb_RepeatedContainer_ExtendFromBuffer(
+    PyUpb_RepeatedContainer* self, upb_Array* arr, PyObject* value,
+    bool* ok) {
+  Py_buffer view;
+  if (!PyObject_CheckBuffer(value)) return false;
+  if (PyObject_GetBuffer(value, &view, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) <
+      0) {
+    PyErr_Clear();
+    return false;
+  }
+  const upb_FieldDef* f = PyUpb_RepeatedContainer_GetField(self);
+  bool compatible =
+      PyUpb_RepeatedContainer_IsBufferCompatible(&view, upb_FieldDef_CType(f));
+  if (compatible) {
+    *ok = upb_Array_AppendN(arr, view.buf, view.len / view.itemsize,
+                            PyUpb_Arena_Get(self->arena));
+    if (!*ok) PyErr_NoMemory();
+  }
+  PyBuffer_Release(&view);
+  return compatible;
+}
+#endif
+
 PyObject* PyUpb_RepeatedContainer_Extend(PyObject* _self, PyObject* value) {
   PyUpb_RepeatedContainer* self = (PyUpb_RepeatedContainer*)_self;
   upb_Array* arr = PyUpb_RepeatedContainer_EnsureReified(_self);
+  const upb_FieldDef* f = PyUpb_RepeatedContainer_GetField(self);
+  bool submsg = upb_FieldDef_IsSubMessage(f);
+
+#if PYUPB_HAS_BUFFER_API
+  // Numeric arrays (array.array, NumPy) are copied in one go.
+  bool ok;
+  if (!submsg && PyUpb_RepeatedContainer_ExtendFromBuffer(self, arr, value,
+                                                          &ok)) {
+    if (!ok) return NULL;
+    Py_RETURN_NONE;
+  }
+#endif
+
   size_t start_size = upb_Array_Size(arr);
   PyObject* it = PyObject_GetIter(value);
   if (!it) {
@@ -198,8 +303,6 @@ PyObject* PyUpb_RepeatedContainer_Extend(PyObject* _self, PyObject* value) {
     return NULL;
   }
 
-  const upb_FieldDef* f = PyUpb_RepeatedContainer_GetField(self);
-  bool submsg = upb_FieldDef_IsSubMessage(f);
   PyObject* e;
 
   while ((e = PyIter_Next(it))) {
@@ -716,6 +819,61 @@ static PyObject* PyUpb_RepeatedScalarContainer_Reduce(PyObject* unused_self,
   return NULL;
 }
 
+#if PYUPB_HAS_BUFFER_API && defined(Py_bf_getbuffer)
+// Exposes the elements of numeric fields in place, for example to NumPy or
+// memoryview.  The view is read-only, and only reflects the field until the
+// field changes size: the elements may then move, leaving the view with a
+// stale copy.  The old storage stays in the arena that the view holds on to,
+// so reading a stale view is still safe.
+static int PyUpb_RepeatedScalarContainer_GetBuffer(PyObject* _self,
+                                                   Py_buffer* view,
+                                                   int flags) {
+  PyUpb_RepeatedContainer* self = (PyUpb_RepeatedContainer*)_self;
+  const upb_FieldDef* f = PyUpb_RepeatedContainer_GetField(self);
+  Py_ssize_t itemsize;
+  const char* format =
+      PyUpb_RepeatedContainer_BufferFormat(upb_FieldDef_CType(f), &itemsize);
+  view->obj = NULL;
+  if (!format) {
+    PyErr_SetString(PyExc_BufferError,
+                    "Only numeric repeated fields support the buffer "
+                    "protocol.");
+    return -1;
+  }
+  if (flags & PyBUF_WRITABLE) {
+    PyErr_SetString(PyExc_BufferError, "Repeated field buffers are read-only.");
+    return -1;
+  }
+  Py_ssize_t* shape = PyMem_Malloc(sizeof(*shape));
+  if (!shape) {
+    PyErr_NoMemory();
+    return -1;
+  }
+
+  upb_Array* arr = PyUpb_RepeatedContainer_GetIfReified(self);
+  *shape = arr ? upb_Array_Size(arr) : 0;
+  view->buf = *shape ? (void*)upb_Array_DataPtr(arr) : (void*)"";
+  view->obj = _self;
+  Py_INCREF(_self);
+  view->len = *shape * itemsize;
+  view->itemsize = itemsize;
+  view->readonly = 1;
+  view->ndim = 1;
+  view->format = (flags & PyBUF_FORMAT) ? (char*)format : NULL;
+  view->shape = (flags & PyBUF_ND) ? shape : NULL;
+  view->strides =
+      (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &view->itemsize : NULL;
+  view->suboffsets = NULL;
+  view->internal = shape;
+  return 0;
+}
+
+static void PyUpb_RepeatedScalarContainer_ReleaseBuffer(PyObject* _self,
+                                                        Py_buffer* view) {
+  PyMem_Free(view->internal);
+}
+#endif
+
 static PyMethodDef PyUpb_RepeatedScalarContainer_Methods[] = {
     {"__deepcopy__", PyUpb_RepeatedContainer_DeepCopy, METH_VARARGS,
      "Makes a deep copy of the class."},
@@ -752,6 +910,10 @@ static PyType_Slot PyUpb_RepeatedScalarContainer_Slots[] = {
     {Py_mp_ass_subscript, PyUpb_RepeatedContainer_AssignSubscript},
     {Py_tp_richcompare, PyUpb_RepeatedContainer_RichCompare},
     {Py_tp_hash, PyObject_HashNotImplemented},
+#if PYUPB_HAS_BUFFER_API && defined(Py_bf_getbuffer)
+    {Py_bf_getbuffer, PyUpb_RepeatedScalarContainer_GetBuffer},
+    {Py_bf_releasebuffer, PyUpb_RepeatedScalarContainer_ReleaseBuffer},
+#endif
     {0, NULL}};
 
 static PyType_Spec PyUpb_RepeatedScalarContainer_Spec = {
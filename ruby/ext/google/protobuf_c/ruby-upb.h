@@ -192,32 +192,36 @@ Error, UINTPTR_MAX is undefined
 
 #if UPB_HAS_ATTRIBUTE(musttail)
 #define UPB_MUSTTAIL __attribute__((musttail))
+#define UPB_HAS_MUSTTAIL 1
 #else
 #define UPB_MUSTTAIL
+#define UPB_HAS_MUSTTAIL 0
 #endif
 
 #undef UPB_HAS_ATTRIBUTE
 
-/* This check is not fully robust: it does not require that we have "musttail"
- * support available. We need tail calls to avoid consuming arbitrary amounts
- * of stack space.
+/* Fasttable needs a 64-bit target that passes six arguments in registers and
+ * leaves the high bits of pointers unused, which x86-64 and ARM64 both do.
  *
- * GCC/Clang can mostly be trusted to generate tail calls as long as
- * optimization is enabled, but, debug builds will not generate tail calls
- * unless "musttail" is available.
- *
- * We should probably either:
- *   1. require that the compiler supports musttail.
- *   2. add some fallback code for when musttail isn't available (ie. return
- *      instead of tail calling). This is safe and portable, but this comes at
- *      a CPU cost.
- */
+ * This check does not require that we have "musttail" support available. We
+ * need tail calls to avoid consuming arbitrary amounts of stack space. GCC and
+ * Clang generate tail calls as long as optimization is enabled, but debug
+ * builds will not generate tail calls unless "musttail" is available. */
 #if (defined(__x86_64__) || defined(__aarch64__)) && defined(__GNUC__)
 #define UPB_FASTTABLE_SUPPORTED 1
 #else
 #define UPB_FASTTABLE_SUPPORTED 0
 #endif
 
+/* Whether the fasttable parsers are sure to tail call each other. Without
+ * tail calls, every field parsed takes another stack frame, so large messages
+ * could overflow the stack. */
+#if UPB_FASTTABLE_SUPPORTED && (UPB_HAS_MUSTTAIL || defined(__OPTIMIZE__))
+#define UPB_FASTTABLE_TAILCALLS 1
+#else
+#define UPB_FASTTABLE_TAILCALLS 0
+#endif
+
 /* define UPB_ENABLE_FASTTABLE to force fast table support.
  * This is useful when we want to ensure we are really getting fasttable,
  * for example for testing or benchmarking. */
@@ -228,9 +232,10 @@ Error, UINTPTR_MAX is undefined
 #define UPB_FASTTABLE 1
 /* Define UPB_TRY_ENABLE_FASTTABLE to use fasttable if possible.
  * This is useful for releasing code that might be used on multiple platforms,
- * for example the PHP or Ruby C extensions. */
-#elif defined(UPB_TRY_ENABLE_FASTTABLE)
-#define UPB_FASTTABLE UPB_FASTTABLE_SUPPORTED
+ * for example the PHP or Ruby C extensions. Unoptimized builds with compilers
+ * that lack musttail fall back to the MiniTable decoder. */
+#elif defined(UPB_TRY_ENABLE_FASTTABLE) && UPB_FASTTABLE_TAILCALLS
+#define UPB_FASTTABLE 1
 #else
 #define UPB_FASTTABLE 0
 #endif
@@ -246,6 +251,8 @@ Error, UINTPTR_MAX is undefined
 #endif
 
 #undef UPB_FASTTABLE_SUPPORTED
+#undef UPB_FASTTABLE_TAILCALLS
+#undef UPB_HAS_MUSTTAIL
 
 /* ASAN poisoning (for arena).
  * If using UPB from an interpreted language like Ruby, a build of the
@@ -13024,7 +13031,9 @@ UPB_INLINE uint32_t _upb_FastDecoder_LoadTag(const char* ptr) {
 #undef UPB_LONGJMP
 #undef UPB_PTRADD
 #undef UPB_MUSTTAIL
+#undef UPB_HAS_MUSTTAIL
 #undef UPB_FASTTABLE_SUPPORTED
+#undef UPB_FASTTABLE_TAILCALLS
 #undef UPB_FASTTABLE_MASK
 #undef UPB_FASTTABLE
 #undef UPB_FASTTABLE_INIT
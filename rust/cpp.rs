@@ -219,12 +219,15 @@ impl<'msg, T: ?Sized> RepeatedField<'msg, T> {
 }
 impl<'msg> RepeatedField<'msg, i32> {}
 
-pub trait RepeatedScalarOps {
+pub trait RepeatedScalarOps: Sized {
     fn new_repeated_field() -> RawRepeatedField;
     fn push(f: RawRepeatedField, v: Self);
     fn len(f: RawRepeatedField) -> usize;
     fn get(f: RawRepeatedField, i: usize) -> Self;
     fn set(f: RawRepeatedField, i: usize, v: Self);
+    fn data(f: RawRepeatedField) -> *const Self;
+    fn extend(f: RawRepeatedField, vals: &[Self]);
+    fn copy_from(f: RawRepeatedField, vals: &[Self]);
 }
 
 macro_rules! impl_repeated_scalar_ops {
@@ -236,6 +239,9 @@ macro_rules! impl_repeated_scalar_ops {
                 fn [< __pb_rust_RepeatedField_ $t _size >](f: RawRepeatedField) -> usize;
                 fn [< __pb_rust_RepeatedField_ $t _get >](f: RawRepeatedField, i: usize) -> $t;
                 fn [< __pb_rust_RepeatedField_ $t _set >](f: RawRepeatedField, i: usize, v: $t);
+                fn [< __pb_rust_RepeatedField_ $t _data >](f: RawRepeatedField) -> *const $t;
+                fn [< __pb_rust_RepeatedField_ $t _extend >](f: RawRepeatedField, vals: *const $t, len: usize);
+                fn [< __pb_rust_RepeatedField_ $t _copy_from >](f: RawRepeatedField, vals: *const $t, len: usize);
             }
             impl RepeatedScalarOps for $t {
                 fn new_repeated_field() -> RawRepeatedField {
@@ -253,6 +259,15 @@ macro_rules! impl_repeated_scalar_ops {
                 fn set(f: RawRepeatedField, i: usize, v: Self) {
                     unsafe { [< __pb_rust_RepeatedField_ $t _set >](f, i, v) }
                 }
+                fn data(f: RawRepeatedField) -> *const Self {
+                    unsafe { [< __pb_rust_RepeatedField_ $t _data >](f) }
+                }
+                fn extend(f: RawRepeatedField, vals: &[Self]) {
+                    unsafe { [< __pb_rust_RepeatedField_ $t _extend >](f, vals.as_ptr(), vals.len()) }
+                }
+                fn copy_from(f: RawRepeatedField, vals: &[Self]) {
+                    unsafe { [< __pb_rust_RepeatedField_ $t _copy_from >](f, vals.as_ptr(), vals.len()) }
+                }
             }
         )* }
     };
@@ -292,6 +307,24 @@ impl<'msg, T: RepeatedScalarOps> RepeatedField<'msg, T> {
         }
         T::set(self.inner.raw, index, val)
     }
+    /// Returns the elements as a slice, without copying them.
+    pub fn as_slice(&self) -> &[T] {
+        let len = self.len();
+        if len == 0 {
+            return &[];
+        }
+        // SAFETY: `RepeatedField<T>` stores `len` contiguous, initialized
+        // elements that can't be mutated while `self` is borrowed.
+        unsafe { std::slice::from_raw_parts(T::data(self.inner.raw), len) }
+    }
+    /// Appends all of `vals` in a single call into C++.
+    pub fn extend_from_slice(&mut self, vals: &[T]) {
+        T::extend(self.inner.raw, vals)
+    }
+    /// Replaces the contents with `vals` in a single call into C++.
+    pub fn copy_from_slice(&mut self, vals: &[T]) {
+        T::copy_from(self.inner.raw, vals)
+    }
 }
 
 #[cfg(test)]
@@ -336,4 +369,15 @@ mod tests {
         r.push(true);
         assert_eq!(r.get(0), Some(true));
     }
+
+    #[test]
+    fn repeated_field_slices() {
+        let mut r = RepeatedField::<i64>::new();
+        assert_eq!(r.as_slice(), &[]);
+        r.extend_from_slice(&[1, 2, 3]);
+        r.extend_from_slice(&[4]);
+        assert_eq!(r.as_slice(), &[1, 2, 3, 4]);
+        r.copy_from_slice(&[5, 6]);
+        assert_eq!(r.as_slice(), &[5, 6]);
+    }
 }
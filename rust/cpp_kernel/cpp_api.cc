@@ -21,6 +21,18 @@ extern "C" {
   void __pb_rust_RepeatedField_##rust_ty##_set(google::protobuf::RepeatedField<ty>* r, \
                                                size_t index, ty val) {       \
     return r->Set(index, val);                                               \
+  }                                                                          \
+  const ty* __pb_rust_RepeatedField_##rust_ty##_data(                        \
+      google::protobuf::RepeatedField<ty>* r) {                                        \
+    return r->data();                                                        \
+  }                                                                          \
+  void __pb_rust_RepeatedField_##rust_ty##_extend(                           \
+      google::protobuf::RepeatedField<ty>* r, const ty* vals, size_t len) {            \
+    r->Add(vals, vals + len);                                                \
+  }                                                                          \
+  void __pb_rust_RepeatedField_##rust_ty##_copy_from(                        \
+      google::protobuf::RepeatedField<ty>* r, const ty* vals, size_t len) {            \
+    r->Assign(vals, vals + len);                                             \
   }
 
 expose_repeated_field_methods(int32_t, i32);
@@ -11,6 +11,8 @@
 #define GOOGLE_PROTOBUF_RUST_CPP_KERNEL_CPP_H__
 
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 
 #include "google/protobuf/message.h"
 
@@ -39,15 +41,35 @@ extern "C" struct SerializedData {
 // This function is defined in `rust_alloc_for_cpp_api.rs`.
 extern "C" void* __pb_rust_alloc(size_t size, size_t align);
 
-inline SerializedData SerializeMsg(const google::protobuf::Message* msg) {
+// Returns the serialized size of `msg`, leaving the sizes of its submessages
+// cached for SerializeWithCachedSizesToArray().
+inline size_t CacheSizes(const google::protobuf::Message* msg) {
   size_t len = msg->ByteSizeLong();
-  void* bytes = __pb_rust_alloc(len, alignof(char));
-  if (!msg->SerializeToArray(bytes, static_cast<int>(len))) {
-    ABSL_LOG(FATAL) << "Couldn't serialize the message.";
+  if (len > static_cast<size_t>(std::numeric_limits<int>::max())) {
+    ABSL_LOG(FATAL) << "Couldn't serialize the message: it exceeds 2GB.";
   }
+  return len;
+}
+
+inline SerializedData SerializeMsg(const google::protobuf::Message* msg) {
+  size_t len = CacheSizes(msg);
+  void* bytes = __pb_rust_alloc(len, alignof(char));
+  msg->SerializeWithCachedSizesToArray(static_cast<uint8_t*>(bytes));
   return SerializedData(static_cast<char*>(bytes), len);
 }
 
+// Serializes `msg` into `buf`, which Rust owns, if it fits into `capacity`
+// bytes.  Returns the serialized size; if it is larger than `capacity`,
+// nothing was written.
+inline size_t SerializeMsgInto(const google::protobuf::Message* msg, void* buf,
+                               size_t capacity) {
+  size_t len = CacheSizes(msg);
+  if (len <= capacity) {
+    msg->SerializeWithCachedSizesToArray(static_cast<uint8_t*>(buf));
+  }
+  return len;
+}
+
 // Represents an ABI-stable version of &[u8]/string_view (borrowed slice of
 // bytes) for FFI use only.
 struct PtrAndLen {
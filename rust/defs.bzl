@@ -12,6 +12,7 @@ load(
 )
 
 visibility([
+    "//benchmarks/...",
     "//experimental/...",
     "//src/google/protobuf/...",
     "//rust/...",
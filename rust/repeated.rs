@@ -83,6 +83,11 @@ macro_rules! impl_repeated_primitives {
                 pub fn get(&self, index: usize) -> Option<$t> {
                     self.inner.get(index)
                 }
+                /// Borrows all elements at once, without copying them out
+                /// one by one.
+                pub fn as_slice(&self) -> &[$t] {
+                    self.inner.as_slice()
+                }
             }
 
             impl<'a> RepeatedMut<'a, $t> {
@@ -92,6 +97,15 @@ macro_rules! impl_repeated_primitives {
                 pub fn set(&mut self, index: usize, val: $t) {
                     self.inner.set(index, val)
                 }
+                /// Appends all of `vals` in one call into the runtime.
+                pub fn extend_from_slice(&mut self, vals: &[$t]) {
+                    self.inner.extend_from_slice(vals)
+                }
+                /// Replaces all elements with `vals` in one call into the
+                /// runtime.
+                pub fn copy_from_slice(&mut self, vals: &[$t]) {
+                    self.inner.copy_from_slice(vals)
+                }
             }
 
             impl<'a> std::iter::Iterator for RepeatedFieldIter<'a, $t> {
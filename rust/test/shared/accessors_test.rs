@@ -715,6 +715,11 @@ macro_rules! generate_repeated_numeric_test {
                 mutator.push(1 as $t);
 
                 assert_that!(mutator.into_iter().collect::<Vec<_>>(), eq(vec![2 as $t, 1 as $t]));
+
+                mutator.extend_from_slice(&[3 as $t, 4 as $t]);
+                assert_that!(mutator.as_slice(), eq(&[2 as $t, 1 as $t, 3 as $t, 4 as $t][..]));
+                mutator.copy_from_slice(&[5 as $t]);
+                assert_that!(msg.[< repeated_ $field >]().as_slice(), eq(&[5 as $t][..]));
             }
         )* }
     };
@@ -743,4 +748,9 @@ fn test_repeated_bool_accessors() {
     assert_that!(mutator.get(0), some(eq(false)));
     mutator.push(true);
     assert_that!(mutator.into_iter().collect::<Vec<_>>(), eq(vec![false, true]));
+
+    mutator.extend_from_slice(&[true]);
+    assert_that!(mutator.as_slice(), eq(&[false, true, true][..]));
+    mutator.copy_from_slice(&[]);
+    assert_that!(*msg.repeated_bool().as_slice(), empty());
 }
@@ -37,3 +37,19 @@ fn deserialize_error() {
     let data = b"not a serialized proto";
     assert!(msg.deserialize(&*data).is_err());
 }
+
+#[test]
+fn serialize_into_appends() {
+    let mut msg = TestAllTypes::new();
+    msg.optional_int64_set(Some(42));
+    msg.optional_bytes_mut().set(b"serialize into test");
+    let serialized = msg.serialize();
+
+    // Both without and with enough spare capacity.
+    for mut out in [Vec::new(), Vec::with_capacity(1024)] {
+        out.extend_from_slice(b"prefix");
+        msg.serialize_into(&mut out);
+        assert_that!(&out[..6], eq(b"prefix"));
+        assert_that!(&out[6..], eq(&*serialized));
+    }
+}
@@ -352,6 +352,15 @@ extern "C" {
     fn upb_Array_Set(arr: RawRepeatedField, i: usize, val: upb_MessageValue);
     fn upb_Array_Get(arr: RawRepeatedField, i: usize) -> upb_MessageValue;
     fn upb_Array_Append(arr: RawRepeatedField, val: upb_MessageValue, arena: RawArena);
+    fn upb_Array_AppendN(
+        arr: RawRepeatedField,
+        data: *const std::ffi::c_void,
+        count: usize,
+        arena: RawArena,
+    ) -> bool;
+    fn upb_Array_Resize(arr: RawRepeatedField, size: usize, arena: RawArena) -> bool;
+    fn upb_Array_DataPtr(arr: RawRepeatedField) -> *const std::ffi::c_void;
+    fn upb_Array_MutableDataPtr(arr: RawRepeatedField) -> *mut std::ffi::c_void;
 }
 
 macro_rules! impl_repeated_primitives {
@@ -392,6 +401,49 @@ macro_rules! impl_repeated_primitives {
                         upb_MessageValue { $union_field: val },
                     ) }
                 }
+                /// Returns the elements as a slice over the `upb_Array`'s
+                /// storage, without copying them.
+                pub fn as_slice(&self) -> &[$rs_type] {
+                    let len = self.len();
+                    if len == 0 {
+                        return &[];
+                    }
+                    // SAFETY: the array stores `len` contiguous elements of
+                    // this type, which can't be mutated while `self` is
+                    // borrowed.
+                    unsafe {
+                        slice::from_raw_parts(
+                            upb_Array_DataPtr(self.inner.raw) as *const $rs_type, len)
+                    }
+                }
+                /// Appends all of `vals` with a single `memcpy()`.
+                pub fn extend_from_slice(&mut self, vals: &[$rs_type]) {
+                    let ok = unsafe { upb_Array_AppendN(
+                        self.inner.raw,
+                        vals.as_ptr() as *const std::ffi::c_void,
+                        vals.len(),
+                        self.inner.arena.raw(),
+                    ) };
+                    assert!(ok, "arena allocation failed");
+                }
+                /// Replaces the contents with `vals` with a single `memcpy()`.
+                pub fn copy_from_slice(&mut self, vals: &[$rs_type]) {
+                    let raw = self.inner.raw;
+                    let ok = unsafe {
+                        upb_Array_Resize(raw, vals.len(), self.inner.arena.raw())
+                    };
+                    assert!(ok, "arena allocation failed");
+                    if vals.is_empty() {
+                        return;
+                    }
+                    // SAFETY: the array was just resized to hold `vals.len()`
+                    // elements, and `vals` can't overlap with it since `self`
+                    // is borrowed mutably.
+                    unsafe {
+                        (upb_Array_MutableDataPtr(raw) as *mut $rs_type)
+                            .copy_from_nonoverlapping(vals.as_ptr(), vals.len());
+                    }
+                }
             }
         )*
     }
@@ -483,4 +535,18 @@ mod tests {
             assert_eq!(arr.get(arr.len() - 1), Some(i));
         }
     }
+
+    #[test]
+    fn array_slices() {
+        let arena = Arena::new();
+        let mut arr = RepeatedField::<f64>::new(&arena);
+        assert_eq!(arr.as_slice(), &[]);
+        arr.extend_from_slice(&[1.0, 2.0, 3.0]);
+        arr.push(4.0);
+        assert_eq!(arr.as_slice(), &[1.0, 2.0, 3.0, 4.0]);
+        arr.copy_from_slice(&[5.0]);
+        assert_eq!(arr.as_slice(), &[5.0]);
+        arr.copy_from_slice(&[]);
+        assert!(arr.is_empty());
+    }
 }
@@ -20,6 +20,7 @@
 #include "absl/container/internal/layout.h"
 #include "absl/synchronization/mutex.h"
 #include "google/protobuf/arena_allocation_policy.h"
+#include "google/protobuf/arena_block_cache.h"
 #include "google/protobuf/arenaz_sampler.h"
 #include "google/protobuf/port.h"
 #include "google/protobuf/serial_arena.h"
@@ -30,6 +31,14 @@
 #include <sanitizer/asan_interface.h>
 #endif  // ADDRESS_SANITIZER
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#elif defined(_WIN32)
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif  // __linux__
+
 // Must be included last.
 #include "google/protobuf/port_def.inc"
 
@@ -59,10 +68,55 @@ ArenaBlock* SentryArenaBlock() {
 }
 #endif
 
+constexpr size_t kHugePageSize = AllocationPolicy::kHugePageSize;
+
+// Returns a block of at least `size` bytes, rounded up to a multiple of
+// kHugePageSize and aligned to kHugePageSize.
+SizedPtr AllocateHugePageBlock(size_t size) {
+  size = (size + kHugePageSize - 1) & ~(kHugePageSize - 1);
+#if defined(__linux__)
+  // Over-map by one huge page and trim both ends to get an aligned block.
+  void* mapped = mmap(nullptr, size + kHugePageSize, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ABSL_CHECK(mapped != MAP_FAILED) << "Failed to map " << size << " bytes.";
+  char* begin = static_cast<char*>(mapped);
+  char* aligned = reinterpret_cast<char*>(
+      (reinterpret_cast<uintptr_t>(begin) + kHugePageSize - 1) &
+      ~(kHugePageSize - 1));
+  char* end = begin + size + kHugePageSize;
+  if (aligned != begin) munmap(begin, aligned - begin);
+  if (aligned + size != end) munmap(aligned + size, end - (aligned + size));
+#ifdef MADV_HUGEPAGE
+  madvise(aligned, size, MADV_HUGEPAGE);
+#endif  // MADV_HUGEPAGE
+  return {aligned, size};
+#elif defined(_WIN32)
+  void* p = _aligned_malloc(size, kHugePageSize);
+  ABSL_CHECK(p != nullptr) << "Failed to allocate " << size << " bytes.";
+  return {p, size};
+#else
+  void* p = nullptr;
+  ABSL_CHECK_EQ(posix_memalign(&p, kHugePageSize, size), 0)
+      << "Failed to allocate " << size << " bytes.";
+  return {p, size};
+#endif  // __linux__
+}
+
+void FreeHugePageBlock(SizedPtr mem) {
+#if defined(__linux__)
+  munmap(mem.p, mem.n);
+#elif defined(_WIN32)
+  _aligned_free(mem.p);
+#else
+  free(mem.p);
+#endif  // __linux__
+}
+
 }  // namespace
 
 static SizedPtr AllocateMemory(const AllocationPolicy* policy_ptr,
-                               size_t last_size, size_t min_bytes) {
+                               size_t last_size, size_t min_bytes,
+                               int numa_node = -1) {
   AllocationPolicy policy;  // default policy
   if (policy_ptr) policy = *policy_ptr;
   size_t size;
@@ -78,7 +132,17 @@ static SizedPtr AllocateMemory(const AllocationPolicy* policy_ptr,
                                SerialArena::kBlockHeaderSize);
   size = std::max(size, SerialArena::kBlockHeaderSize + min_bytes);
 
+  if (numa_node >= 0 && policy.numa_block_alloc != nullptr) {
+    return {policy.numa_block_alloc(size, numa_node), size};
+  }
+  if (policy.HugePagesEnabled()) {
+    if (policy.UsesHugePages(size)) return AllocateHugePageBlock(size);
+    // Blocks are released according to their size, so regular blocks must
+    // stay below the threshold.
+    return {::operator new(size), size};
+  }
   if (policy.block_alloc == nullptr) {
+    if (policy.block_cache != nullptr) return policy.block_cache->Allocate(size);
     return AllocateAtLeast(size);
   }
   return {policy.block_alloc(size), size};
@@ -88,6 +152,11 @@ class GetDeallocator {
  public:
   GetDeallocator(const AllocationPolicy* policy, size_t* space_allocated)
       : dealloc_(policy ? policy->block_dealloc : nullptr),
+        block_cache_(policy && dealloc_ == nullptr &&
+                             !policy->HugePagesEnabled()
+                         ? policy->block_cache
+                         : nullptr),
+        policy_(policy),
         space_allocated_(space_allocated) {}
 
   void operator()(SizedPtr mem) const {
@@ -96,8 +165,12 @@ class GetDeallocator {
     // so return it in an unpoisoned state.
     ASAN_UNPOISON_MEMORY_REGION(mem.p, mem.n);
 #endif  // ADDRESS_SANITIZER
-    if (dealloc_) {
+    if (policy_ && policy_->UsesHugePages(mem.n)) {
+      FreeHugePageBlock(mem);
+    } else if (dealloc_) {
       dealloc_(mem.p, mem.n);
+    } else if (block_cache_) {
+      block_cache_->Deallocate(mem);
     } else {
       internal::SizedDelete(mem.p, mem.n);
     }
@@ -106,12 +179,15 @@ class GetDeallocator {
 
  private:
   void (*dealloc_)(void*, size_t);
+  ArenaBlockCache* block_cache_;
+  const AllocationPolicy* policy_;
   size_t* space_allocated_;
 };
 
 // It is guaranteed that this is constructed in `b`. IOW, this is not the first
 // arena and `b` cannot be sentry.
-SerialArena::SerialArena(ArenaBlock* b, ThreadSafeArena& parent)
+SerialArena::SerialArena(ArenaBlock* b, ThreadSafeArena& parent,
+                         int numa_node)
     : ptr_{b->Pointer(kBlockHeaderSize + ThreadSafeArena::kSerialArenaSize)},
       limit_{b->Limit()},
       prefetch_ptr_(
@@ -119,7 +195,8 @@ SerialArena::SerialArena(ArenaBlock* b, ThreadSafeArena& parent)
       prefetch_limit_(b->Limit()),
       head_{b},
       space_allocated_{b->size},
-      parent_{parent} {
+      parent_{parent},
+      numa_node_{numa_node} {
   ABSL_DCHECK(!b->IsSentry());
 }
 
@@ -130,8 +207,11 @@ SerialArena::SerialArena(ThreadSafeArena& parent)
 // It is guaranteed that this is the first SerialArena but `b` may be user
 // provided or newly allocated to store AllocationPolicy.
 SerialArena::SerialArena(FirstSerialArena, ArenaBlock* b,
-                         ThreadSafeArena& parent)
-    : head_{b}, space_allocated_{b->size}, parent_{parent} {
+                         ThreadSafeArena& parent, int numa_node)
+    : head_{b},
+      space_allocated_{b->size},
+      parent_{parent},
+      numa_node_{numa_node} {
   if (b->IsSentry()) return;
   set_range(b->Pointer(kBlockHeaderSize), b->Limit());
 }
@@ -164,19 +244,21 @@ void SerialArena::Init(ArenaBlock* b, size_t offset) {
   head_.store(b, std::memory_order_relaxed);
   space_used_.store(0, std::memory_order_relaxed);
   space_allocated_.store(b->size, std::memory_order_relaxed);
+  space_wasted_.store(0, std::memory_order_relaxed);
   cached_block_length_ = 0;
   cached_blocks_ = nullptr;
   string_block_.store(nullptr, std::memory_order_relaxed);
   string_block_unused_.store(0, std::memory_order_relaxed);
 }
 
-SerialArena* SerialArena::New(SizedPtr mem, ThreadSafeArena& parent) {
+SerialArena* SerialArena::New(SizedPtr mem, ThreadSafeArena& parent,
+                              int numa_node) {
   ABSL_DCHECK_LE(kBlockHeaderSize + ThreadSafeArena::kSerialArenaSize, mem.n);
   ThreadSafeArenaStats::RecordAllocateStats(parent.arena_stats_.MutableStats(),
                                             /*used=*/0, /*allocated=*/mem.n,
                                             /*wasted=*/0);
   auto b = new (mem.p) ArenaBlock{nullptr, mem.n};
-  return new (b->Pointer(kBlockHeaderSize)) SerialArena(b, parent);
+  return new (b->Pointer(kBlockHeaderSize)) SerialArena(b, parent, numa_node);
 }
 
 template <typename Deallocator>
@@ -252,6 +334,7 @@ void SerialArena::AllocateNewBlock(size_t n) {
     used = static_cast<size_t>(ptr() - old_head->Pointer(kBlockHeaderSize));
     wasted = old_head->size - used - kBlockHeaderSize;
     AddSpaceUsed(used);
+    AddSpaceWasted(static_cast<size_t>(limit_ - ptr()));
   }
 
   // TODO: Evaluate if pushing unused space into the cached blocks is a
@@ -259,7 +342,8 @@ void SerialArena::AllocateNewBlock(size_t n) {
   // but with a CPU regression. The regression might have been an artifact of
   // the microbenchmark.
 
-  auto mem = AllocateMemory(parent_.AllocPolicy(), old_head->size, n);
+  auto mem =
+      AllocateMemory(parent_.AllocPolicy(), old_head->size, n, numa_node_);
   // We don't want to emit an expensive RMW instruction that requires
   // exclusive access to a cacheline. Hence we write it in terms of a
   // regular add.
@@ -303,6 +387,29 @@ uint64_t SerialArena::SpaceUsed() const {
   return space_used + space_used_.load(std::memory_order_relaxed);
 }
 
+void SerialArena::AddToMemoryReport(ArenaMemoryReport& report,
+                                    std::vector<size_t>& block_sizes) const {
+  if (string_block_.load(std::memory_order_acquire) != nullptr) {
+    report.string_block_unused_bytes +=
+        string_block_unused_.load(std::memory_order_relaxed);
+  }
+  const ArenaBlock* h = head_.load(std::memory_order_acquire);
+  if (h->IsSentry()) return;
+
+  report.block_tail_wasted_bytes +=
+      space_wasted_.load(std::memory_order_relaxed);
+  report.current_block_free_bytes += static_cast<uint64_t>(limit_ - ptr());
+  ArenaBlock* b = const_cast<ArenaBlock*>(h);
+  report.cleanup_bytes += static_cast<uint64_t>(b->Limit() - limit_);
+  block_sizes.push_back(b->size);
+  for (b = b->next; b != nullptr; b = b->next) {
+    if (b->IsSentry()) continue;
+    report.cleanup_bytes += static_cast<uint64_t>(
+        b->Limit() - static_cast<char*>(b->cleanup_nodes));
+    block_sizes.push_back(b->size);
+  }
+}
+
 size_t SerialArena::FreeStringBlocks(StringBlock* string_block,
                                      size_t unused_bytes) {
   ABSL_DCHECK(string_block != nullptr);
@@ -332,9 +439,7 @@ void SerialArena::CleanupList() {
     char* limit = b->Limit();
     char* it = reinterpret_cast<char*>(b->cleanup_nodes);
     ABSL_DCHECK(!b->IsSentry() || it == limit);
-    while (it < limit) {
-      it += cleanup::DestroyNode(it);
-    }
+    cleanup::DestroyNodes(it, limit);
     b = b->next;
   } while (b);
 }
@@ -516,13 +621,15 @@ PROTOBUF_CONSTINIT PROTOBUF_THREAD_LOCAL
 ThreadSafeArena::ThreadSafeArena() : first_arena_(*this) { Init(); }
 
 ThreadSafeArena::ThreadSafeArena(char* mem, size_t size)
-    : first_arena_(FirstSerialArena{}, FirstBlock(mem, size), *this) {
+    : first_arena_(FirstSerialArena{}, FirstBlock(mem, size), *this,
+                   /*numa_node=*/-1) {
   Init();
 }
 
 ThreadSafeArena::ThreadSafeArena(void* mem, size_t size,
                                  const AllocationPolicy& policy)
-    : first_arena_(FirstSerialArena{}, FirstBlock(mem, size, policy), *this) {
+    : first_arena_(FirstSerialArena{}, FirstBlock(mem, size, policy), *this,
+                   policy.CurrentNumaNode()) {
   InitializeWithPolicy(policy);
 }
 
@@ -544,7 +651,8 @@ ArenaBlock* ThreadSafeArena::FirstBlock(void* buf, size_t size,
 
   SizedPtr mem;
   if (buf == nullptr || size < kBlockHeaderSize + kAllocPolicySize) {
-    mem = AllocateMemory(&policy, 0, kAllocPolicySize);
+    mem = AllocateMemory(&policy, 0, kAllocPolicySize,
+                         policy.CurrentNumaNode());
   } else {
     mem = {buf, size};
     // Record user-owned block.
@@ -559,6 +667,10 @@ void ThreadSafeArena::InitializeWithPolicy(const AllocationPolicy& policy) {
 
   if (policy.IsDefault()) return;
 
+  // NUMA blocks cannot be released with the default deallocator.
+  ABSL_DCHECK(policy.numa_block_alloc == nullptr ||
+              policy.block_dealloc != nullptr);
+
 #ifndef NDEBUG
   const uint64_t old_alloc_policy = alloc_policy_.get_raw();
   // If there was a policy (e.g., in Reset()), make sure flags were preserved.
@@ -674,6 +786,8 @@ void ThreadSafeArena::Init() {
 }
 
 ThreadSafeArena::~ThreadSafeArena() {
+  RecordMemoryReportStats();
+
   // Have to do this in a first pass, because some of the destructors might
   // refer to memory in other blocks.
   CleanupList();
@@ -692,8 +806,34 @@ ThreadSafeArena::~ThreadSafeArena() {
 }
 
 SizedPtr ThreadSafeArena::Free(size_t* space_allocated) {
-  auto deallocator = GetDeallocator(alloc_policy_.get(), space_allocated);
+  return Free(GetDeallocator(alloc_policy_.get(), space_allocated),
+              space_allocated);
+}
+
+SizedPtr ThreadSafeArena::Free(size_t* space_allocated,
+                               size_t min_retained_size, SizedPtr* retained) {
+  *retained = {nullptr, 0};
+  const size_t max_retained_size = alloc_policy_->reset_retained_bytes;
+  auto dealloc = GetDeallocator(alloc_policy_.get(), space_allocated);
+  auto deallocator = [&](SizedPtr mem) {
+    if (mem.n < min_retained_size || mem.n > max_retained_size ||
+        mem.n <= retained->n) {
+      dealloc(mem);
+      return;
+    }
+    if (retained->p != nullptr) dealloc(*retained);
+    *retained = mem;
+  };
+  SizedPtr first = Free(deallocator, space_allocated);
+  // A block that was retained and then replaced is counted when freed, so
+  // only the one finally kept is added here.
+  *space_allocated += retained->n;
+  return first;
+}
 
+template <typename Deallocator>
+SizedPtr ThreadSafeArena::Free(Deallocator deallocator,
+                               size_t* space_allocated) {
   WalkSerialArenaChunk([&](SerialArenaChunk* chunk) {
     absl::Span<std::atomic<SerialArena*>> span = chunk->arenas();
     // Walks arenas backward to handle the first serial arena the last. Freeing
@@ -721,6 +861,13 @@ SizedPtr ThreadSafeArena::Free(size_t* space_allocated) {
 }
 
 uint64_t ThreadSafeArena::Reset() {
+  RecordMemoryReportStats();
+
+  AllocationPolicy* policy = alloc_policy_.get();
+  if (policy != nullptr && policy->reset_retained_bytes != 0) {
+    return ResetRetainingBlock(*policy);
+  }
+
   // Have to do this in a first pass, because some of the destructors might
   // refer to memory in other blocks.
   CleanupList();
@@ -751,6 +898,42 @@ uint64_t ThreadSafeArena::Reset() {
   return space_allocated;
 }
 
+uint64_t ThreadSafeArena::ResetRetainingBlock(AllocationPolicy& policy) {
+  const size_t retained_size =
+      policy.UpdateResetRetainedBlockSize(SpaceUsed(), kBlockHeaderSize);
+
+  CleanupList();
+
+  size_t space_allocated = 0;
+  SizedPtr retained;
+  auto mem = Free(&space_allocated, retained_size, &retained);
+  space_allocated += mem.n;
+  if (retained.p == nullptr && retained_size != 0) {
+    retained = AllocateMemory(&policy, 0, retained_size - kBlockHeaderSize,
+                              first_arena_.numa_node());
+  }
+
+  // The first block always holds the AllocationPolicy and is kept as is.
+  auto* first = new (mem.p) ArenaBlock{nullptr, mem.n};
+  if (retained.p == nullptr) {
+    first_arena_.Init(first, kBlockHeaderSize + kAllocPolicySize);
+  } else {
+    // Allocate from the retained block and keep the first one behind it, with
+    // an empty cleanup list.
+    first->cleanup_nodes = first->Limit();
+    first_arena_.Init(new (retained.p) ArenaBlock{first, retained.n},
+                      kBlockHeaderSize);
+    first_arena_.AddSpaceAllocated(mem.n);
+    first_arena_.AddSpaceUsed(kAllocPolicySize);
+    // Nothing is allocated from the first block anymore.
+    first_arena_.AddSpaceWasted(mem.n - kBlockHeaderSize - kAllocPolicySize);
+  }
+
+  Init();
+
+  return space_allocated;
+}
+
 void* ThreadSafeArena::AllocateAlignedWithCleanup(size_t n, size_t align,
                                                   void (*destructor)(void*)) {
   SerialArena* arena;
@@ -830,6 +1013,19 @@ uint64_t ThreadSafeArena::SpaceAllocated() const {
   return space_allocated;
 }
 
+uint64_t ThreadSafeArena::SpaceAllocatedOnNumaNode(int numa_node) const {
+  uint64_t space_allocated = first_arena_.numa_node() == numa_node
+                                 ? first_arena_.SpaceAllocated()
+                                 : 0;
+  PerConstSerialArenaInChunk(
+      [&space_allocated, numa_node](const SerialArena* serial) {
+        if (serial->numa_node() == numa_node) {
+          space_allocated += serial->SpaceAllocated();
+        }
+      });
+  return space_allocated;
+}
+
 uint64_t ThreadSafeArena::SpaceUsed() const {
   // First arena is inlined to ThreadSafeArena and the first block's overhead is
   // smaller than others that contain SerialArena.
@@ -842,6 +1038,37 @@ uint64_t ThreadSafeArena::SpaceUsed() const {
   return space_used - (alloc_policy_.get() ? sizeof(AllocationPolicy) : 0);
 }
 
+ArenaMemoryReport ThreadSafeArena::GetMemoryReport() const {
+  ArenaMemoryReport report;
+  report.space_allocated = SpaceAllocated();
+  report.space_used = SpaceUsed();
+
+  std::vector<size_t> block_sizes;
+  first_arena_.AddToMemoryReport(report, block_sizes);
+  PerConstSerialArenaInChunk([&](const SerialArena* serial) {
+    serial->AddToMemoryReport(report, block_sizes);
+  });
+
+  std::sort(block_sizes.begin(), block_sizes.end());
+  for (size_t size : block_sizes) {
+    if (report.block_size_counts.empty() ||
+        report.block_size_counts.back().first != size) {
+      report.block_size_counts.emplace_back(size, 0);
+    }
+    ++report.block_size_counts.back().second;
+  }
+  return report;
+}
+
+void ThreadSafeArena::RecordMemoryReportStats() {
+  ThreadSafeArenaStats* stats = arena_stats_.MutableStats();
+  if (PROTOBUF_PREDICT_TRUE(stats == nullptr)) return;
+  const ArenaMemoryReport report = GetMemoryReport();
+  ThreadSafeArenaStats::RecordMemoryReportStats(
+      stats, report.cleanup_bytes, report.block_tail_wasted_bytes,
+      report.current_block_free_bytes, report.string_block_unused_bytes);
+}
+
 template <AllocationClient alloc_client>
 PROTOBUF_NOINLINE void* ThreadSafeArena::AllocateAlignedFallback(size_t n) {
   return GetSerialArenaFallback(n)->AllocateAligned<alloc_client>(n);
@@ -892,9 +1119,14 @@ SerialArena* ThreadSafeArena::GetSerialArenaFallback(size_t n) {
   if (!serial) {
     // This thread doesn't have any SerialArena, which also means it doesn't
     // have any blocks yet.  So we'll allocate its first block now. It must be
-    // big enough to host SerialArena and the pending request.
+    // big enough to host SerialArena and the pending request. With a
+    // NUMA-aware policy, the block is placed on this thread's node and so are
+    // all later blocks of the new SerialArena.
+    const AllocationPolicy* policy = alloc_policy_.get();
+    const int numa_node = policy != nullptr ? policy->CurrentNumaNode() : -1;
     serial = SerialArena::New(
-        AllocateMemory(alloc_policy_.get(), 0, n + kSerialArenaSize), *this);
+        AllocateMemory(policy, 0, n + kSerialArenaSize, numa_node), *this,
+        numa_node);
 
     AddSerialArena(id, serial);
   }
@@ -11,6 +11,7 @@
 #define GOOGLE_PROTOBUF_ARENA_H__
 
 #include <limits>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <utility>
@@ -44,7 +45,9 @@ namespace protobuf {
 
 struct ArenaOptions;  // defined below
 class Arena;    // defined below
-class Message;  // defined in message.h
+class ArenaBlockCache;    // defined in arena_block_cache.h
+class StringInternTable;  // defined in string_intern_table.h
+class Message;            // defined in message.h
 class MessageLite;
 template <typename Key, typename T>
 class Map;
@@ -121,6 +124,52 @@ struct ArenaOptions {
   // calls free.
   void (*block_dealloc)(void*, size_t) = nullptr;
 
+  // Optional hooks for NUMA-aware block placement. If both are set, every
+  // per-thread allocation region of the arena requests its blocks from
+  // `numa_block_alloc` on the node that `current_numa_node` reported for the
+  // thread that created the region. Blocks are still released through
+  // `block_dealloc`, which must be set as well. The region of the thread that
+  // constructs the arena starts with the first block, which is placed on that
+  // thread's node as well. The only exception is a caller-provided
+  // `initial_block`: it is used where it is, but still counts toward that
+  // node in SpaceAllocatedOnNumaNode().
+  int (*current_numa_node)() = nullptr;
+  void* (*numa_block_alloc)(size_t size, int numa_node) = nullptr;
+
+  // An optional cache of blocks shared across arena lifetimes. If set, and the
+  // default block allocator is used, blocks are taken from the cache before
+  // going to the system allocator and are handed back to it when the arena is
+  // destroyed or Reset(). The cache must outlive the arena.
+  ArenaBlockCache* block_cache = nullptr;
+
+  // If non-zero, blocks of at least this many bytes are backed by 2MB huge
+  // pages: their size is rounded up to a multiple of 2MB and they are mapped on
+  // a 2MB boundary (with madvise(MADV_HUGEPAGE) on Linux). Set max_block_size
+  // above the threshold to let regular block growth reach huge-page blocks.
+  // Ignored if block_alloc, block_dealloc or numa_block_alloc is set.
+  size_t huge_page_threshold = 0;
+
+  // If non-zero, Reset() keeps one block of at most this many bytes instead of
+  // returning it to the allocator. The kept block is the largest one that is
+  // big enough for a moving average of the arena's peak SpaceUsed() over
+  // recent Reset() cycles; if none is, a block of that size is allocated. A
+  // reused arena with a stable workload thus stops allocating in steady state.
+  size_t reset_retained_bytes = 0;
+
+  // If true, repeated message fields on this arena create new elements in
+  // batches: whenever a field needs a new element, it also creates spare
+  // default-constructed elements for the next additions, back to back in the
+  // same arena block. Elements of large repeated fields are then contiguous,
+  // which helps iterating over them, at the cost of up to twice the element
+  // memory for a field that stops growing right after a batch.
+  bool contiguous_repeated_elements = false;
+
+  // An optional dictionary of shared string values. If set, singular string
+  // and bytes fields parsed into this arena point to the table's copy of their
+  // value when it has one; see StringInternTable. The table must outlive the
+  // arena.
+  StringInternTable* string_intern_table = nullptr;
+
  private:
   internal::AllocationPolicy AllocationPolicy() const {
     internal::AllocationPolicy res;
@@ -128,6 +177,13 @@ struct ArenaOptions {
     res.max_block_size = max_block_size;
     res.block_alloc = block_alloc;
     res.block_dealloc = block_dealloc;
+    res.current_numa_node = current_numa_node;
+    res.numa_block_alloc = numa_block_alloc;
+    res.block_cache = block_cache;
+    res.huge_page_threshold = huge_page_threshold;
+    res.reset_retained_bytes = reset_retained_bytes;
+    res.contiguous_repeated_elements = contiguous_repeated_elements;
+    res.string_intern_table = string_intern_table;
     return res;
   }
 
@@ -252,6 +308,11 @@ class PROTOBUF_EXPORT PROTOBUF_ALIGNAS(8) Arena final {
     if (PROTOBUF_PREDICT_FALSE(arena == nullptr)) {
       return new T(std::forward<Args>(args)...);
     }
+    internal::RecordArenaAllocation<T>(
+        std::is_same<T, std::string>::value
+            ? internal::ArenaAllocationKind::kString
+            : internal::ArenaAllocationKind::kOther,
+        sizeof(T));
     return new (arena->AllocateInternal<T>()) T(std::forward<Args>(args)...);
   }
 
@@ -319,12 +380,31 @@ class PROTOBUF_EXPORT PROTOBUF_ALIGNAS(8) Arena final {
   // can lead to underestimates of the space used, and race conditions can lead
   // to overestimates (up to the current block size).
   uint64_t SpaceUsed() const { return impl_.SpaceUsed(); }
+  // Returns the part of SpaceAllocated() that was placed on `numa_node`. Only
+  // meaningful for arenas constructed with NUMA-aware ArenaOptions; otherwise
+  // all blocks are reported on node -1. A caller-provided initial block is
+  // reported on the node of the thread that constructed the arena.
+  uint64_t SpaceAllocatedOnNumaNode(int numa_node) const {
+    return impl_.SpaceAllocatedOnNumaNode(numa_node);
+  }
+
+  // Breakdown of SpaceAllocated() into used bytes, cleanup list bytes, bytes
+  // wasted at block tails and bytes free in the blocks currently allocated
+  // from, plus the block size distribution.
+  // Useful to tune start_block_size / max_block_size in ArenaOptions. Walks
+  // all blocks of the arena; the numbers are only exact if no other thread is
+  // allocating on the arena concurrently.
+  using MemoryReport = internal::ArenaMemoryReport;
+  MemoryReport GetMemoryReport() const { return impl_.GetMemoryReport(); }
 
   // Frees all storage allocated by this arena after calling destructors
   // registered with OwnDestructor() and freeing objects registered with Own().
   // Any objects allocated on this arena are unusable after this call. It also
   // returns the total space used by the arena which is the sums of the sizes
   // of the allocated blocks. This method is not thread-safe.
+  //
+  // See ArenaOptions::reset_retained_bytes for keeping a block warm across
+  // calls.
   uint64_t Reset() { return impl_.Reset(); }
 
   // Adds |object| to a list of heap-allocated objects to be freed with |delete|
@@ -363,6 +443,24 @@ class PROTOBUF_EXPORT PROTOBUF_ALIGNAS(8) Arena final {
     impl_.AddCleanup(object, destruct);
   }
 
+  // Makes this arena the owner of `other`, which is destroyed when this arena
+  // is destroyed or reset. Objects allocated on `other` then live as long as
+  // this arena, so they can be moved under objects on this arena without a
+  // copy:
+  //
+  //   response_arena.Adopt(std::move(request_arena));
+  //   response->unsafe_arena_set_allocated_payload(
+  //       request->unsafe_arena_release_payload());
+  //
+  // The safe set_allocated_*(), Swap() and AddAllocated() still copy, as they
+  // cannot tell that the arenas are tied. Moved objects keep returning `other`
+  // from GetArena() and allocate their new children there.
+  //
+  // Blocks are not transferred between arenas: every arena is still freed as
+  // a whole, just later. Must not be called concurrently with destroying or
+  // resetting this arena.
+  void Adopt(std::unique_ptr<Arena> other) { Own(other.release()); }
+
   // Retrieves the arena associated with |value| if |value| is an arena-capable
   // message, or nullptr otherwise. If possible, the call resolves at compile
   // time. Note that we can often devirtualize calls to `value->GetArena()` so
@@ -508,6 +606,16 @@ class PROTOBUF_EXPORT PROTOBUF_ALIGNAS(8) Arena final {
     impl_.ReturnArrayMemory(p, size);
   }
 
+  // For RepeatedPtrFieldBase; see ArenaOptions::contiguous_repeated_elements.
+  bool ContiguousRepeatedElements() const {
+    return impl_.ContiguousRepeatedElements();
+  }
+
+  // For parsing; see ArenaOptions::string_intern_table.
+  StringInternTable* GetStringInternTable() const {
+    return impl_.GetStringInternTable();
+  }
+
   template <typename T, typename... Args>
   PROTOBUF_NDEBUG_INLINE static T* CreateMessageInternal(Arena* arena,
                                                          Args&&... args) {
@@ -578,6 +686,8 @@ class PROTOBUF_EXPORT PROTOBUF_ALIGNAS(8) Arena final {
 
   template <typename T, typename... Args>
   PROTOBUF_NDEBUG_INLINE T* DoCreateMessage(Args&&... args) {
+    internal::RecordArenaAllocation<T>(internal::ArenaAllocationKind::kMessage,
+                                       sizeof(T));
     return InternalHelper<T>::Construct(
         AllocateInternal<T, is_destructor_skippable<T>::value>(), this,
         std::forward<Args>(args)...);
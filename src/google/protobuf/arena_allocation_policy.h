@@ -13,6 +13,10 @@
 
 namespace google {
 namespace protobuf {
+
+class ArenaBlockCache;    // defined in arena_block_cache.h
+class StringInternTable;  // defined in string_intern_table.h
+
 namespace internal {
 
 // `AllocationPolicy` defines `Arena` allocation policies. Applications can
@@ -30,10 +34,75 @@ struct AllocationPolicy {
   void* (*block_alloc)(size_t) = nullptr;
   void (*block_dealloc)(void*, size_t) = nullptr;
 
+  // Optional NUMA-aware block placement. `current_numa_node` returns the NUMA
+  // node of the calling thread and `numa_block_alloc` returns a block of the
+  // requested size on the given node. Blocks are released via `block_dealloc`.
+  int (*current_numa_node)() = nullptr;
+  void* (*numa_block_alloc)(size_t, int) = nullptr;
+
+  // Optional pool that blocks are taken from and returned to when the default
+  // block allocator is used.
+  ArenaBlockCache* block_cache = nullptr;
+
+  // Blocks of at least this many bytes are rounded up to a multiple of
+  // kHugePageSize and mapped on huge page boundaries, or 0 to disable. Only
+  // applies when none of `block_alloc`, `block_dealloc` and
+  // `numa_block_alloc` is set, as the arena both allocates and frees them.
+  size_t huge_page_threshold = 0;
+  static constexpr size_t kHugePageSize = 2 << 20;
+
+  bool HugePagesEnabled() const {
+    return huge_page_threshold != 0 && block_alloc == nullptr &&
+           block_dealloc == nullptr && numa_block_alloc == nullptr;
+  }
+  bool UsesHugePages(size_t block_size) const {
+    return HugePagesEnabled() && block_size >= huge_page_threshold;
+  }
+
+  // Upper bound on the size of the block kept by ThreadSafeArena::Reset(), or
+  // 0 to release all blocks except the first one.
+  size_t reset_retained_bytes = 0;
+  // Moving average of the peak space used, updated on every Reset().
+  size_t average_peak_space_used = 0;
+
+  // See ArenaOptions::contiguous_repeated_elements.
+  bool contiguous_repeated_elements = false;
+
+  // See ArenaOptions::string_intern_table.
+  StringInternTable* string_intern_table = nullptr;
+
   bool IsDefault() const {
     return start_block_size == kDefaultStartBlockSize &&
            max_block_size == kDefaultMaxBlockSize && block_alloc == nullptr &&
-           block_dealloc == nullptr;
+           block_dealloc == nullptr && current_numa_node == nullptr &&
+           numa_block_alloc == nullptr && block_cache == nullptr &&
+           huge_page_threshold == 0 && reset_retained_bytes == 0 &&
+           !contiguous_repeated_elements && string_intern_table == nullptr;
+  }
+
+  // Folds `peak_space_used` into the moving average and returns the block
+  // size that Reset() should keep warm, capped by `reset_retained_bytes`. 0
+  // means that no block should be kept.
+  size_t UpdateResetRetainedBlockSize(size_t peak_space_used,
+                                      size_t block_header_size) {
+    if (reset_retained_bytes == 0) return 0;
+    average_peak_space_used =
+        average_peak_space_used == 0
+            ? peak_space_used
+            : (3 * average_peak_space_used + peak_space_used) / 4;
+    if (average_peak_space_used == 0) return 0;
+    size_t size = average_peak_space_used + block_header_size;
+    return size <= reset_retained_bytes ? size : reset_retained_bytes;
+  }
+
+  bool IsNumaAware() const {
+    return current_numa_node != nullptr && numa_block_alloc != nullptr;
+  }
+
+  // Returns the NUMA node of the calling thread, or -1 if the policy is not
+  // NUMA-aware.
+  int CurrentNumaNode() const {
+    return IsNumaAware() ? current_numa_node() : -1;
   }
 };
 
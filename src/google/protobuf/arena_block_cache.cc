@@ -0,0 +1,110 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/arena_block_cache.h"
+
+#include <cstddef>
+
+#include "absl/log/absl_check.h"
+#include "absl/numeric/bits.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/port.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+ArenaBlockCache::ArenaBlockCache(size_t max_cached_bytes)
+    : max_cached_bytes_(max_cached_bytes) {}
+
+ArenaBlockCache::~ArenaBlockCache() { Clear(); }
+
+ArenaBlockCache::Stats ArenaBlockCache::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void ArenaBlockCache::Clear() {
+  CachedBlock* to_free[kNumBuckets];
+  {
+    absl::MutexLock lock(&mutex_);
+    for (int i = 0; i < kNumBuckets; ++i) {
+      to_free[i] = buckets_[i];
+      buckets_[i] = nullptr;
+    }
+    stats_.cached_blocks = 0;
+    stats_.cached_bytes = 0;
+  }
+  for (CachedBlock* head : to_free) {
+    while (head != nullptr) {
+      PROTOBUF_UNPOISON_MEMORY_REGION(head, sizeof(CachedBlock));
+      CachedBlock* next = head->next;
+      size_t size = head->size;
+      PROTOBUF_UNPOISON_MEMORY_REGION(head, size);
+      internal::SizedDelete(head, size);
+      head = next;
+    }
+  }
+}
+
+internal::SizedPtr ArenaBlockCache::Allocate(size_t size) {
+  ABSL_DCHECK_GE(size, sizeof(CachedBlock));
+  // Every block in bucket `first` and above is large enough. Arenas tend to
+  // request the same sizes over and over, so first try the head of the bucket
+  // below, which holds the closest fit. Only look one bucket further up to
+  // avoid handing out blocks far larger than requested.
+  const int first = static_cast<int>(absl::bit_width(size - 1));
+  {
+    absl::MutexLock lock(&mutex_);
+    for (int i = first - 1; i < kNumBuckets && i <= first + 1; ++i) {
+      CachedBlock* block = buckets_[i];
+      if (block == nullptr) continue;
+      PROTOBUF_UNPOISON_MEMORY_REGION(block, sizeof(CachedBlock));
+      const size_t block_size = block->size;
+      if (block_size < size) {
+        PROTOBUF_POISON_MEMORY_REGION(block, sizeof(CachedBlock));
+        continue;
+      }
+      buckets_[i] = block->next;
+      ++stats_.hits;
+      --stats_.cached_blocks;
+      stats_.cached_bytes -= block_size;
+      PROTOBUF_UNPOISON_MEMORY_REGION(block, block_size);
+      return {block, block_size};
+    }
+    ++stats_.misses;
+  }
+  return internal::AllocateAtLeast(size);
+}
+
+void ArenaBlockCache::Deallocate(internal::SizedPtr block) {
+  ABSL_DCHECK_GE(block.n, sizeof(CachedBlock));
+  const int bucket = static_cast<int>(absl::bit_width(block.n)) - 1;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (bucket < kNumBuckets &&
+        stats_.cached_bytes + block.n <= max_cached_bytes_) {
+      auto* node = static_cast<CachedBlock*>(block.p);
+      node->next = buckets_[bucket];
+      node->size = block.n;
+      buckets_[bucket] = node;
+      ++stats_.cached_blocks;
+      stats_.cached_bytes += block.n;
+      PROTOBUF_POISON_MEMORY_REGION(block.p, block.n);
+      return;
+    }
+    ++stats_.evictions;
+  }
+  internal::SizedDelete(block.p, block.n);
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,103 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines ArenaBlockCache, a pool of arena blocks that outlives the
+// arenas using it.
+
+#ifndef GOOGLE_PROTOBUF_ARENA_BLOCK_CACHE_H__
+#define GOOGLE_PROTOBUF_ARENA_BLOCK_CACHE_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/port.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+// ArenaBlockCache keeps the blocks released by destroyed (or Reset()) arenas
+// and hands them to new arenas before falling back to the system allocator.
+// Workloads that create an arena per request and grow it to roughly the same
+// size every time can then run without any malloc/free traffic for arena
+// blocks in steady state.
+//
+// Blocks are kept in power-of-two size buckets and the total number of cached
+// bytes is bounded by `max_cached_bytes`; blocks returned to a full cache are
+// freed immediately. A cache is thread-safe and may be shared by any number of
+// arenas, e.g. by using one process-wide instance or one instance per thread.
+// It must outlive every arena that uses it.
+//
+// Only arenas using the default block allocator (no `block_alloc` /
+// `block_dealloc` in ArenaOptions) take part in recycling.
+//
+// Example:
+//
+//   static ArenaBlockCache* cache = new ArenaBlockCache(64 << 20);
+//   ArenaOptions options;
+//   options.block_cache = cache;
+//   Arena arena(options);
+class PROTOBUF_EXPORT ArenaBlockCache {
+ public:
+  static constexpr size_t kDefaultMaxCachedBytes = 16 << 20;
+
+  explicit ArenaBlockCache(size_t max_cached_bytes = kDefaultMaxCachedBytes);
+  ArenaBlockCache(const ArenaBlockCache&) = delete;
+  ArenaBlockCache& operator=(const ArenaBlockCache&) = delete;
+
+  // Frees all cached blocks.
+  ~ArenaBlockCache();
+
+  struct Stats {
+    // Number of block requests served from the cache.
+    uint64_t hits = 0;
+    // Number of block requests that had to go to the system allocator.
+    uint64_t misses = 0;
+    // Number of released blocks freed because the cache was full.
+    uint64_t evictions = 0;
+    // Number of blocks and bytes currently held by the cache.
+    uint64_t cached_blocks = 0;
+    uint64_t cached_bytes = 0;
+  };
+  Stats GetStats() const;
+
+  // Frees all cached blocks. Statistics other than the cached totals are kept.
+  void Clear();
+
+  // Returns a block of at least `size` bytes, either from the cache or from
+  // the system allocator. For use by Arena.
+  internal::SizedPtr Allocate(size_t size);
+
+  // Takes ownership of `block`, which must have been obtained from
+  // `Allocate()` or `AllocateAtLeast()`. For use by Arena.
+  void Deallocate(internal::SizedPtr block);
+
+ private:
+  // Blocks in bucket `i` have a size in [2^i, 2^(i+1)).
+  static constexpr int kNumBuckets = 48;
+
+  struct CachedBlock {
+    CachedBlock* next;
+    size_t size;
+  };
+
+  const size_t max_cached_bytes_;
+  mutable absl::Mutex mutex_;
+  CachedBlock* buckets_[kNumBuckets] ABSL_GUARDED_BY(mutex_) = {};
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_ARENA_BLOCK_CACHE_H__
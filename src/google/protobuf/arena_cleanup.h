@@ -10,7 +10,9 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "absl/base/attributes.h"
@@ -141,6 +143,65 @@ inline ABSL_ATTRIBUTE_ALWAYS_INLINE size_t DestroyNode(const void* pos) {
   return sizeof(DynamicNode);
 }
 
+// Destroys the `T` objects referenced by the packed array of tagged nodes in
+// [pos, limit). If `mixed` is true, the array may also hold nodes of other
+// types which are skipped.
+template <typename T, bool mixed>
+inline void DestroyTaggedNodes(const char* pos, const char* limit) {
+  constexpr Tag kTag = std::is_same<T, std::string>::value ? Tag::kString
+                                                           : Tag::kCord;
+  for (; pos < limit; pos += sizeof(TaggedNode)) {
+    uintptr_t elem;
+    memcpy(&elem, pos, sizeof(elem));
+    if (mixed && static_cast<Tag>(elem & 3) != kTag) continue;
+    reinterpret_cast<T*>(elem - static_cast<uintptr_t>(kTag))->~T();
+  }
+}
+
+// Destroys the objects referenced by all cleanup nodes in [pos, limit).
+//
+// Rather than dispatching on every node, destruction is grouped by type: the
+// first pass runs the destructors of all dynamic nodes in LIFO order and packs
+// the tagged nodes into a contiguous array at the front of the range, which
+// later passes destroy in tight per-type loops. Objects of tagged types never
+// reference other arena objects, so destroying them after the dynamic nodes
+// of the same range is safe.
+//
+// The cleanup nodes in [pos, limit) are overwritten in the process.
+inline void DestroyNodes(char* pos, char* limit) {
+  if (!EnableSpecializedTags()) {
+    while (pos < limit) pos += DestroyNode(pos);
+    return;
+  }
+
+  // Tagged nodes are never larger than any node, so the write position never
+  // overtakes the read position.
+  char* const tagged_begin = pos;
+  char* tagged_end = pos;
+  bool has_cords = false;
+  while (pos < limit) {
+    uintptr_t elem;
+    memcpy(&elem, pos, sizeof(elem));
+    const Tag tag = static_cast<Tag>(elem & 3);
+    if (tag == Tag::kDynamic) {
+      pos += DestroyNode(pos);
+      continue;
+    }
+    has_cords |= tag == Tag::kCord;
+    memcpy(tagged_end, &elem, sizeof(elem));
+    tagged_end += sizeof(TaggedNode);
+    pos += sizeof(TaggedNode);
+  }
+
+  if (!has_cords) {
+    // Common case: only strings, no need to look at the tags again.
+    DestroyTaggedNodes<std::string, /*mixed=*/false>(tagged_begin, tagged_end);
+    return;
+  }
+  DestroyTaggedNodes<std::string, /*mixed=*/true>(tagged_begin, tagged_end);
+  DestroyTaggedNodes<absl::Cord, /*mixed=*/true>(tagged_begin, tagged_end);
+}
+
 // Append in `out` the pointer to the to-be-cleaned object in `pos`.
 // Return the length of the cleanup node to allow the caller to advance the
 // position, like `DestroyNode` does.
@@ -22,8 +22,10 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/log/absl_check.h"
+#include "absl/strings/cord.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/barrier.h"
+#include "google/protobuf/arena_block_cache.h"
 #include "google/protobuf/arena_test_util.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/extension_set.h"
@@ -523,6 +525,44 @@ TEST(ArenaTest, ReleaseString) {
   // Test default value.
 }
 
+TEST(ArenaTest, SetMovedStringAdoptsBuffer) {
+  Arena arena;
+  TestAllTypes* arena_message = Arena::CreateMessage<TestAllTypes>(&arena);
+  std::string value(1000, 'x');
+  const char* data = value.data();
+  arena_message->set_optional_string(std::move(value));
+  EXPECT_EQ(arena_message->optional_string().data(), data);
+
+  std::string replacement(1000, 'y');
+  data = replacement.data();
+  arena_message->set_optional_string(std::move(replacement));
+  EXPECT_EQ(arena_message->optional_string().data(), data);
+}
+
+TEST(ArenaTest, SetMovedCord) {
+  Arena arena;
+  auto* cord_message =
+      Arena::CreateMessage<protobuf_unittest::TestCord>(&arena);
+  absl::Cord cord(std::string(1000, 'x'));
+  cord_message->set_optional_bytes_cord(std::move(cord));
+  EXPECT_EQ(cord_message->optional_bytes_cord(), std::string(1000, 'x'));
+  cord_message->set_optional_bytes_cord(std::string(2000, 'y'));
+  EXPECT_EQ(cord_message->optional_bytes_cord(), std::string(2000, 'y'));
+  // Lvalue strings and literals are still copied through string_view.
+  const std::string value = "value";
+  cord_message->set_optional_bytes_cord(value);
+  EXPECT_EQ(cord_message->optional_bytes_cord(), "value");
+  cord_message->set_optional_bytes_cord("literal");
+  EXPECT_EQ(cord_message->optional_bytes_cord(), "literal");
+
+  TestOneof2* oneof_message = Arena::CreateMessage<TestOneof2>(&arena);
+  oneof_message->set_foo_bytes_cord(std::string(1000, 'z'));
+  EXPECT_TRUE(oneof_message->has_foo_bytes_cord());
+  EXPECT_EQ(oneof_message->foo_bytes_cord(), std::string(1000, 'z'));
+  oneof_message->set_foo_bytes_cord(absl::Cord("cord"));
+  EXPECT_EQ(oneof_message->foo_bytes_cord(), "cord");
+}
+
 
 TEST(ArenaTest, SwapBetweenArenasWithAllFieldsSet) {
   Arena arena1;
@@ -691,6 +731,25 @@ TEST(ArenaTest, UnsafeArenaSetAllocatedAcrossArenas) {
   delete heap_message;
 }
 
+TEST(ArenaTest, AdoptKeepsArenaAliveForMovedObjects) {
+  Arena arena;
+  TestAllTypes* response = Arena::CreateMessage<TestAllTypes>(&arena);
+  TestAllTypes::NestedMessage* moved;
+  {
+    auto request_arena = std::make_unique<Arena>();
+    TestAllTypes* request =
+        Arena::CreateMessage<TestAllTypes>(request_arena.get());
+    request->mutable_optional_nested_message()->set_bb(42);
+    moved = request->unsafe_arena_release_optional_nested_message();
+    Arena* request_arena_ptr = request_arena.get();
+    arena.Adopt(std::move(request_arena));
+    response->unsafe_arena_set_allocated_optional_nested_message(moved);
+    EXPECT_EQ(moved->GetArena(), request_arena_ptr);
+  }
+  EXPECT_EQ(response->mutable_optional_nested_message(), moved);
+  EXPECT_EQ(response->optional_nested_message().bb(), 42);
+}
+
 TEST(ArenaTest, SetAllocatedAcrossArenasWithReflection) {
   // Same as above, with reflection.
   Arena arena1;
@@ -1386,6 +1445,118 @@ void VerifyArenaOverhead(Arena& arena, size_t overhead) {
 
 }  // namespace
 
+TEST(ArenaTest, InterleavedAllocationsOnSeveralArenas) {
+  // More arenas than entries in the thread cache, so that entries get evicted.
+  constexpr int kNumArenas = 5;
+  std::vector<Arena> arenas(kNumArenas);
+  for (int round = 0; round < 100; ++round) {
+    for (int i = 0; i < kNumArenas; ++i) {
+      // Alternate between patterns that stay within and exceed the cache.
+      const int n = round % 2 == 0 ? kNumArenas : 2;
+      Arena::CreateArray<char>(&arenas[i % n], 8 * (i + 1));
+    }
+  }
+  std::vector<uint64_t> used;
+  for (const Arena& arena : arenas) used.push_back(arena.SpaceUsed());
+  // Each arena got exactly its own allocations.
+  EXPECT_EQ(used[0], 50 * (8 + 24 + 40) + 50 * 8);
+  EXPECT_EQ(used[1], 50 * (16 + 32) + 50 * 16);
+  EXPECT_EQ(used[2], 50 * 24);
+  EXPECT_EQ(used[3], 50 * 32);
+  EXPECT_EQ(used[4], 50 * 40);
+
+  // A reset arena must not be found through stale cache entries.
+  arenas[0].Reset();
+  Arena::CreateArray<char>(&arenas[1], 8);
+  Arena::CreateArray<char>(&arenas[0], 8);
+  EXPECT_EQ(arenas[0].SpaceUsed(), 8);
+  EXPECT_EQ(arenas[1].SpaceUsed(), used[1] + 8);
+}
+
+TEST(ArenaTest, MemoryReport) {
+  Arena arena;
+  Arena::MemoryReport report = arena.GetMemoryReport();
+  EXPECT_EQ(report.space_allocated, 0);
+  EXPECT_TRUE(report.block_size_counts.empty());
+
+  Arena::CreateArray<char>(&arena, 200);
+  // Does not fit in the rest of the first block.
+  Arena::CreateArray<char>(&arena, 96);
+  for (int i = 0; i < 10; ++i) arena.Own(new int);
+
+  report = arena.GetMemoryReport();
+  ASSERT_EQ(report.block_size_counts.size(), 2);
+  EXPECT_EQ(report.block_size_counts[0].second, 1);
+  EXPECT_EQ(report.block_size_counts[1].second, 1);
+  constexpr size_t kHeader = internal::SerialArena::kBlockHeaderSize;
+  const size_t first_block = report.block_size_counts[0].first;
+  EXPECT_EQ(report.space_allocated, arena.SpaceAllocated());
+  EXPECT_EQ(report.space_used, 296);
+  EXPECT_EQ(report.cleanup_bytes, 10 * sizeof(internal::cleanup::DynamicNode));
+  EXPECT_EQ(report.block_tail_wasted_bytes, first_block - kHeader - 200);
+  // Every allocated byte is accounted for.
+  EXPECT_EQ(report.space_allocated,
+            report.space_used + report.cleanup_bytes +
+                report.block_tail_wasted_bytes +
+                report.current_block_free_bytes + 2 * kHeader);
+}
+
+TEST(ArenaTest, ArenaSpaceUsedLongCountsSubtree) {
+  Arena arena;
+  auto* message = Arena::CreateMessage<TestAllTypes>(&arena);
+  EXPECT_EQ(message->ArenaSpaceUsedLong(), Align8(sizeof(TestAllTypes)));
+
+  message->mutable_optional_nested_message()->set_bb(1);
+  message->set_optional_string(std::string(100, 'x'));
+  for (int i = 0; i < 10; ++i) message->add_repeated_int32(i);
+  for (int i = 0; i < 3; ++i) message->add_repeated_string("abc");
+  // Cleared elements still hold arena memory.
+  message->mutable_repeated_string()->RemoveLast();
+
+  const size_t nested = message->optional_nested_message().ArenaSpaceUsedLong();
+  EXPECT_EQ(nested, Align8(sizeof(TestAllTypes::NestedMessage)));
+  const size_t repeated_string =
+      Align8(message->repeated_string().SpaceUsedExcludingSelfLong() -
+             3 * sizeof(std::string)) +
+      3 * sizeof(std::string);
+  EXPECT_EQ(message->ArenaSpaceUsedLong(),
+            Align8(sizeof(TestAllTypes)) + nested + sizeof(std::string) +
+                Align8(message->repeated_int32().SpaceUsedExcludingSelfLong()) +
+                repeated_string);
+  EXPECT_LE(message->ArenaSpaceUsedLong(), arena.SpaceUsed());
+
+  TestAllTypes heap_message;
+  heap_message.mutable_optional_nested_message()->set_bb(1);
+  EXPECT_EQ(heap_message.ArenaSpaceUsedLong(), 0);
+}
+
+TEST(ArenaTest, HeapSpaceUsedLongLeavesOutArenaMemory) {
+  TestAllTypes heap_message;
+  heap_message.mutable_optional_nested_message()->set_bb(1);
+  heap_message.set_optional_string(std::string(100, 'x'));
+  heap_message.add_repeated_int32(1);
+  EXPECT_EQ(heap_message.HeapSpaceUsedLong(), heap_message.SpaceUsedLong());
+
+  Arena arena;
+  auto* message = Arena::CreateMessage<TestAllTypes>(&arena);
+  EXPECT_EQ(message->HeapSpaceUsedLong(), 0);
+  message->mutable_optional_nested_message()->set_bb(1);
+  for (int i = 0; i < 10; ++i) message->add_repeated_int32(i);
+  message->add_repeated_string("abc");
+  EXPECT_EQ(message->HeapSpaceUsedLong(), 0);
+
+  // String buffers are allocated on the heap.
+  message->set_optional_string(std::string(100, 'x'));
+  message->add_repeated_string(std::string(200, 'y'));
+  message->mutable_optional_nested_message()->set_bb(1);
+  EXPECT_EQ(message->HeapSpaceUsedLong(),
+            internal::StringSpaceUsedExcludingSelfLong(
+                message->optional_string()) +
+                internal::StringSpaceUsedExcludingSelfLong(
+                    message->repeated_string(1)));
+  EXPECT_LT(message->HeapSpaceUsedLong(), message->SpaceUsedLong());
+}
+
 TEST(ArenaTest, FirstArenaOverhead) {
   Arena arena;
   VerifyArenaOverhead(arena, internal::SerialArena::kBlockHeaderSize);
@@ -1411,6 +1582,325 @@ TEST(ArenaTest, BlockSizeDoubling) {
   EXPECT_GE(second_block_size, 2*first_block_size);
 }
 
+namespace {
+
+thread_local int fake_numa_node = 0;
+std::atomic<size_t> numa_allocations[2];
+
+int FakeCurrentNumaNode() { return fake_numa_node; }
+
+void* FakeNumaBlockAlloc(size_t size, int numa_node) {
+  numa_allocations[numa_node].fetch_add(1, std::memory_order_relaxed);
+  return ::operator new(size);
+}
+
+void FakeNumaBlockDealloc(void* p, size_t size) {
+  internal::SizedDelete(p, size);
+}
+
+}  // namespace
+
+TEST(ArenaTest, NumaAwareBlockPlacement) {
+  numa_allocations[0] = 0;
+  numa_allocations[1] = 0;
+
+  ArenaOptions options;
+  options.current_numa_node = FakeCurrentNumaNode;
+  options.numa_block_alloc = FakeNumaBlockAlloc;
+  options.block_dealloc = FakeNumaBlockDealloc;
+  Arena arena(options);
+
+  Arena::CreateArray<char>(&arena, 1000);
+  std::thread([&] {
+    fake_numa_node = 1;
+    for (int i = 0; i < 10; ++i) Arena::CreateArray<char>(&arena, 1000);
+  }).join();
+
+  EXPECT_GE(numa_allocations[0], 1);
+  EXPECT_GE(numa_allocations[1], 2);
+  EXPECT_GT(arena.SpaceAllocatedOnNumaNode(0), 0);
+  EXPECT_GT(arena.SpaceAllocatedOnNumaNode(1), 10000);
+  EXPECT_EQ(arena.SpaceAllocatedOnNumaNode(-1), 0);
+  EXPECT_EQ(arena.SpaceAllocated(), arena.SpaceAllocatedOnNumaNode(0) +
+                                        arena.SpaceAllocatedOnNumaNode(1));
+}
+
+TEST(ArenaTest, NumaAwareFirstBlock) {
+  numa_allocations[0] = 0;
+  numa_allocations[1] = 0;
+
+  ArenaOptions options;
+  options.current_numa_node = FakeCurrentNumaNode;
+  options.numa_block_alloc = FakeNumaBlockAlloc;
+  options.block_dealloc = FakeNumaBlockDealloc;
+  std::thread([&] {
+    fake_numa_node = 1;
+    {
+      // The first block is requested on the node of the constructing thread.
+      Arena arena(options);
+      EXPECT_EQ(numa_allocations[1], 1);
+      EXPECT_EQ(arena.SpaceAllocatedOnNumaNode(1), arena.SpaceAllocated());
+    }
+    {
+      // A caller-provided initial block is used as is, and the blocks after it
+      // are requested on the node of the constructing thread.
+      alignas(8) char initial_block[1024];
+      options.initial_block = initial_block;
+      options.initial_block_size = sizeof(initial_block);
+      Arena arena(options);
+      EXPECT_EQ(numa_allocations[1], 1);
+      Arena::CreateArray<char>(&arena, 2000);
+      EXPECT_EQ(numa_allocations[1], 2);
+      EXPECT_EQ(arena.SpaceAllocatedOnNumaNode(1), arena.SpaceAllocated());
+    }
+  }).join();
+  EXPECT_EQ(numa_allocations[0], 0);
+}
+
+TEST(ArenaTest, BlockCacheRecyclesBlocksAcrossArenas) {
+  ArenaBlockCache cache;
+  ArenaOptions options;
+  options.block_cache = &cache;
+
+  uint64_t first_space_allocated;
+  {
+    Arena arena(options);
+    for (int i = 0; i < 100; ++i) Arena::CreateArray<char>(&arena, 1000);
+    first_space_allocated = arena.SpaceAllocated();
+  }
+  ArenaBlockCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 0);
+  EXPECT_GT(stats.misses, 0);
+  EXPECT_EQ(stats.cached_bytes, first_space_allocated);
+
+  const uint64_t misses = stats.misses;
+  {
+    Arena arena(options);
+    for (int i = 0; i < 100; ++i) Arena::CreateArray<char>(&arena, 1000);
+  }
+  stats = cache.GetStats();
+  EXPECT_GT(stats.hits, 0);
+  EXPECT_EQ(stats.misses, misses);
+
+  cache.Clear();
+  EXPECT_EQ(cache.GetStats().cached_blocks, 0);
+  EXPECT_EQ(cache.GetStats().cached_bytes, 0);
+}
+
+TEST(ArenaTest, BlockCacheIsBounded) {
+  ArenaBlockCache cache(/*max_cached_bytes=*/4096);
+  ArenaOptions options;
+  options.block_cache = &cache;
+  {
+    Arena arena(options);
+    for (int i = 0; i < 100; ++i) Arena::CreateArray<char>(&arena, 1000);
+  }
+  ArenaBlockCache::Stats stats = cache.GetStats();
+  EXPECT_LE(stats.cached_bytes, 4096);
+  EXPECT_GT(stats.evictions, 0);
+}
+
+TEST(ArenaTest, ResetRetainsWarmBlock) {
+  ArenaOptions options;
+  options.reset_retained_bytes = 1 << 20;
+  Arena arena(options);
+
+  auto fill = [&] {
+    for (int i = 0; i < 100; ++i) Arena::CreateArray<char>(&arena, 1000);
+  };
+  fill();
+  arena.Reset();
+  fill();
+  arena.Reset();
+
+  // The arena now starts out with a block big enough for the whole workload.
+  const uint64_t space_allocated = arena.SpaceAllocated();
+  EXPECT_GE(space_allocated, 100 * 1000);
+  EXPECT_EQ(arena.SpaceUsed(), 0);
+  fill();
+  EXPECT_EQ(arena.SpaceAllocated(), space_allocated);
+  EXPECT_EQ(arena.SpaceUsed(), 100 * Align8(1000));
+
+  // Destructors registered before Reset() still run.
+  Notifier notifier;
+  SimpleDataType* data = Arena::Create<SimpleDataType>(&arena);
+  data->SetNotifier(&notifier);
+  arena.Reset();
+  EXPECT_EQ(notifier.GetCount(), 1);
+}
+
+TEST(ArenaTest, MemoryReportAfterRetainingReset) {
+  ArenaOptions options;
+  options.reset_retained_bytes = 1 << 20;
+  Arena arena(options);
+  for (int i = 0; i < 100; ++i) Arena::CreateArray<char>(&arena, 1000);
+  arena.Reset();
+
+  // The kept block is allocated from, and the first block only holds the
+  // allocation policy.
+  Arena::MemoryReport report = arena.GetMemoryReport();
+  ASSERT_EQ(report.block_size_counts.size(), 2);
+  constexpr size_t kHeader = internal::SerialArena::kBlockHeaderSize;
+  const size_t policy_size = Align8(sizeof(internal::AllocationPolicy));
+  const size_t first_block = report.block_size_counts[0].first;
+  const size_t kept_block = report.block_size_counts[1].first;
+  EXPECT_EQ(report.space_used, 0);
+  EXPECT_EQ(report.current_block_free_bytes, kept_block - kHeader);
+  EXPECT_EQ(report.block_tail_wasted_bytes,
+            first_block - kHeader - policy_size);
+  EXPECT_EQ(report.space_allocated,
+            report.space_used + report.cleanup_bytes +
+                report.block_tail_wasted_bytes +
+                report.current_block_free_bytes + policy_size + 2 * kHeader);
+}
+
+TEST(ArenaTest, ResetRetainedBlockIsBounded) {
+  ArenaOptions options;
+  options.reset_retained_bytes = 4096;
+  Arena arena(options);
+  for (int i = 0; i < 100; ++i) Arena::CreateArray<char>(&arena, 1000);
+  arena.Reset();
+  EXPECT_LE(arena.SpaceAllocated(),
+            4096 + internal::AllocationPolicy::kDefaultStartBlockSize);
+}
+
+TEST(ArenaTest, ResetCountsRetainedBlockOnce) {
+  ArenaOptions options;
+  options.reset_retained_bytes = 1 << 20;
+  Arena arena(options);
+  // Keep a block of about 140000 bytes, then lower the average peak so that
+  // smaller blocks are large enough to be kept as well.
+  Arena::CreateArray<char>(&arena, 140000);
+  arena.Reset();
+  for (int i = 0; i < 4; ++i) arena.Reset();
+
+  // Fill most of the kept block, then overflow into a smaller new block,
+  // which Reset() first keeps and then replaces with the larger one.
+  Arena::CreateArray<char>(&arena, 130000);
+  Arena::CreateArray<char>(&arena, 100000);
+  const uint64_t space_allocated = arena.SpaceAllocated();
+  EXPECT_EQ(arena.Reset(), space_allocated);
+
+  const uint64_t kept = arena.SpaceAllocated();
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(arena.Reset(), kept);
+    EXPECT_EQ(arena.SpaceAllocated(), kept);
+  }
+}
+
+TEST(ArenaTest, HugePageBlocks) {
+  constexpr size_t kHugePageSize = internal::AllocationPolicy::kHugePageSize;
+  ArenaOptions options;
+  options.max_block_size = 8 << 20;
+  options.huge_page_threshold = 1 << 20;
+  Arena arena(options);
+
+  const uint64_t initial = arena.SpaceAllocated();
+  char* p = Arena::CreateArray<char>(&arena, 3 << 20);
+  memset(p, 0, 3 << 20);
+  const uint64_t huge = arena.SpaceAllocated() - initial;
+  EXPECT_EQ(huge % kHugePageSize, 0);
+  EXPECT_GE(huge, 3 << 20);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(p - internal::SerialArena::
+                                                 kBlockHeaderSize) %
+                kHugePageSize,
+            0);
+
+  // Small blocks are still regular allocations.
+  Arena::CreateArray<char>(&arena, 100);
+  arena.Reset();
+  Arena::CreateArray<char>(&arena, 100);
+}
+
+size_t hook_freed_bytes = 0;
+
+void CountingDealloc(void* p, size_t size) {
+  hook_freed_bytes += size;
+  ::operator delete(p);
+}
+
+TEST(ArenaTest, HugePagesNeedDefaultDealloc) {
+  // Blocks from the default allocator are freed through the user's hook, so
+  // they must not be huge-page blocks.
+  ArenaOptions options;
+  options.max_block_size = 8 << 20;
+  options.huge_page_threshold = 1 << 20;
+  options.block_dealloc = &CountingDealloc;
+  hook_freed_bytes = 0;
+  uint64_t allocated;
+  {
+    Arena arena(options);
+    Arena::CreateArray<char>(&arena, 3 << 20);
+    allocated = arena.SpaceAllocated();
+    EXPECT_NE(allocated % internal::AllocationPolicy::kHugePageSize, 0);
+  }
+  EXPECT_EQ(hook_freed_bytes, allocated);
+}
+
+// Counts the elements that directly follow the previous one in memory.
+int CountAdjacentElements(const RepeatedPtrField<TestAllTypes>& field) {
+  int adjacent = 0;
+  for (int i = 1; i < field.size(); ++i) {
+    adjacent += reinterpret_cast<const char*>(&field.Get(i)) -
+                    reinterpret_cast<const char*>(&field.Get(i - 1)) ==
+                sizeof(TestAllTypes);
+  }
+  return adjacent;
+}
+
+TEST(ArenaTest, ContiguousRepeatedElements) {
+  protobuf_unittest::TestParsingMerge source;
+  for (int i = 0; i < 200; ++i) {
+    TestAllTypes* element = source.add_repeated_all_types();
+    element->set_optional_int32(i);
+    // Allocated on the arena between the elements unless they are batched.
+    element->mutable_optional_nested_message()->set_bb(i);
+  }
+  const std::string data = source.SerializePartialAsString();
+
+  ArenaOptions options;
+  options.contiguous_repeated_elements = true;
+  Arena arena(options);
+  auto* parsed =
+      Arena::CreateMessage<protobuf_unittest::TestParsingMerge>(&arena);
+  ASSERT_TRUE(parsed->ParsePartialFromString(data));
+  ASSERT_EQ(parsed->repeated_all_types_size(), 200);
+  for (int i = 0; i < 200; ++i) {
+    EXPECT_EQ(parsed->repeated_all_types(i).optional_int32(), i);
+    EXPECT_EQ(parsed->repeated_all_types(i).optional_nested_message().bb(), i);
+  }
+  // Only the boundaries of batches and of arena blocks break adjacency.
+  EXPECT_GE(CountAdjacentElements(parsed->repeated_all_types()), 180);
+  EXPECT_EQ(parsed->SerializePartialAsString(), data);
+
+  Arena regular_arena;
+  auto* regular =
+      Arena::CreateMessage<protobuf_unittest::TestParsingMerge>(&regular_arena);
+  ASSERT_TRUE(regular->ParsePartialFromString(data));
+  EXPECT_LT(CountAdjacentElements(regular->repeated_all_types()), 20);
+}
+
+TEST(ArenaTest, ContiguousRepeatedElementsWithTypedAdd) {
+  ArenaOptions options;
+  options.contiguous_repeated_elements = true;
+  Arena arena(options);
+  auto* message = Arena::CreateMessage<TestAllTypes>(&arena);
+  for (int i = 0; i < 10; ++i) {
+    message->add_repeated_nested_message()->set_bb(i);
+  }
+  ASSERT_EQ(message->repeated_nested_message_size(), 10);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(message->repeated_nested_message(i).bb(), i);
+  }
+
+  // Spare elements are cleared elements, reused by later additions.
+  const TestAllTypes::NestedMessage* first =
+      &message->repeated_nested_message(0);
+  message->clear_repeated_nested_message();
+  EXPECT_EQ(message->add_repeated_nested_message(), first);
+  EXPECT_FALSE(message->repeated_nested_message(0).has_bb());
+}
+
 TEST(ArenaTest, Alignment) {
   Arena arena;
   for (int i = 0; i < 200; i++) {
@@ -1463,6 +1953,36 @@ TEST(ArenaTest, AddCleanup) {
   }
 }
 
+TEST(ArenaTest, CleanupGroupsDestructionByType) {
+  // Reads a string owned by the arena from its destructor. Strings are
+  // destroyed in a separate pass, which must come after the objects that were
+  // registered later.
+  struct StringReader {
+    StringReader(const std::string* s, std::vector<std::string>* out)
+        : s(s), out(out) {}
+    ~StringReader() { out->push_back(*s); }
+    const std::string* s;
+    std::vector<std::string>* out;
+  };
+
+  std::vector<std::string> seen;
+  {
+    Arena arena;
+    for (int i = 0; i < 1000; ++i) {
+      auto* s = Arena::Create<std::string>(&arena, 100, 'a' + i % 26);
+      Arena::Create<StringReader>(&arena, s, &seen);
+      if (i % 10 == 0) {
+        Arena::Create<absl::Cord>(&arena, std::string(100, 'x'));
+      }
+    }
+  }
+  ASSERT_EQ(seen.size(), 1000u);
+  // Dynamic destructors still run in reverse order of registration.
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(seen[999 - i], std::string(100, 'a' + i % 26));
+  }
+}
+
 TEST(ArenaTest, SpaceReuseForArraysSizeChecks) {
   // Limit to 1<<20 to avoid using too much memory on the test.
   for (int i = 0; i < 20; ++i) {
@@ -15,6 +15,7 @@
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/message_lite.h"
 #include "google/protobuf/parse_context.h"
+#include "google/protobuf/string_intern_table.h"
 
 // clang-format off
 #include "google/protobuf/port_def.inc"
@@ -99,7 +100,7 @@ TaggedStringPtr TaggedStringPtr::ForceCopy(Arena* arena) const {
 
 void ArenaStringPtr::Set(absl::string_view value, Arena* arena) {
   ScopedCheckPtrInvariants check(&tagged_ptr_);
-  if (IsDefault()) {
+  if (!tagged_ptr_.IsMutable()) {
     // If we're not on an arena, skip straight to a true string to avoid
     // possible copy cost later.
     tagged_ptr_ = arena != nullptr ? CreateArenaString(*arena, value)
@@ -124,7 +125,7 @@ void ArenaStringPtr::Set(absl::string_view value, Arena* arena) {
 template <>
 void ArenaStringPtr::Set(const std::string& value, Arena* arena) {
   ScopedCheckPtrInvariants check(&tagged_ptr_);
-  if (IsDefault()) {
+  if (!tagged_ptr_.IsMutable()) {
     // If we're not on an arena, skip straight to a true string to avoid
     // possible copy cost later.
     tagged_ptr_ = arena != nullptr ? CreateArenaString(*arena, value)
@@ -148,14 +149,9 @@ void ArenaStringPtr::Set(const std::string& value, Arena* arena) {
 
 void ArenaStringPtr::Set(std::string&& value, Arena* arena) {
   ScopedCheckPtrInvariants check(&tagged_ptr_);
-  if (IsDefault()) {
+  if (!tagged_ptr_.IsMutable()) {
     NewString(arena, std::move(value));
-  } else if (IsFixedSizeArena()) {
-    std::string* current = tagged_ptr_.Get();
-    auto* s = new (current) std::string(std::move(value));
-    arena->OwnDestructor(s);
-    tagged_ptr_.SetMutableArena(s);
-  } else /* !IsFixedSizeArena() */ {
+  } else {
     *UnsafeMutablePointer() = std::move(value);
   }
 }
@@ -184,7 +180,6 @@ std::string* ArenaStringPtr::MutableNoCopy(Arena* arena) {
   if (tagged_ptr_.IsMutable()) {
     return tagged_ptr_.Get();
   } else {
-    ABSL_DCHECK(IsDefault());
     // Allocate empty. The contents are not relevant.
     return NewString(arena);
   }
@@ -193,7 +188,11 @@ std::string* ArenaStringPtr::MutableNoCopy(Arena* arena) {
 template <typename... Lazy>
 std::string* ArenaStringPtr::MutableSlow(::google::protobuf::Arena* arena,
                                          const Lazy&... lazy_default) {
-  ABSL_DCHECK(IsDefault());
+  ABSL_DCHECK(!tagged_ptr_.IsMutable());
+  if (IsFixedSizeArena()) {
+    // Interned values are shared, copy them.
+    return NewString(arena, *tagged_ptr_.Get());
+  }
 
   // For empty defaults, this ends up calling the default constructor which is
   // more efficient than a copy construction from
@@ -242,6 +241,9 @@ void ArenaStringPtr::ClearToEmpty() {
   ScopedCheckPtrInvariants check(&tagged_ptr_);
   if (IsDefault()) {
     // Already set to default -- do nothing.
+  } else if (IsFixedSizeArena()) {
+    // Interned values are shared.
+    InitDefault();
   } else {
     // Unconditionally mask away the tag.
     //
@@ -258,6 +260,9 @@ void ArenaStringPtr::ClearToDefault(const LazyString& default_value,
   (void)arena;
   if (IsDefault()) {
     // Already set to default -- do nothing.
+  } else if (IsFixedSizeArena()) {
+    // Interned values are shared.
+    tagged_ptr_.SetDefault(&default_value.get());
   } else {
     UnsafeMutablePointer()->assign(default_value.get());
   }
@@ -272,6 +277,18 @@ const char* EpsCopyInputStream::ReadArenaString(const char* ptr,
   int size = ReadSize(&ptr);
   if (!ptr) return nullptr;
 
+  StringInternTable* intern_table = arena->GetStringInternTable();
+  if (PROTOBUF_PREDICT_FALSE(intern_table != nullptr) &&
+      static_cast<size_t>(size) <= intern_table->max_string_size() &&
+      size <= buffer_end_ + kSlopBytes - ptr) {
+    const std::string* interned =
+        intern_table->Intern(absl::string_view(ptr, size));
+    if (interned != nullptr) {
+      s->SetInterned(interned);
+      return ptr + size;
+    }
+  }
+
   auto* str = s->NewString(arena);
   ptr = ReadString(ptr, size, str);
   GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
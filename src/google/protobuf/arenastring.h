@@ -103,6 +103,10 @@ class PROTOBUF_EXPORT TaggedStringPtr {
     // size arena strings are immutable, with the exception of custom internal
     // updates to the content that fit inside the existing capacity.
     // Fixed size arena strings must never be deleted or destroyed.
+    //
+    // Interned strings (see StringInternTable) also use this type. They are
+    // shared by every field holding them and are never modified: mutations
+    // replace the value with a private copy first.
     kFixedSizeArena = kArenaBit,
   };
 
@@ -130,6 +134,13 @@ class PROTOBUF_EXPORT TaggedStringPtr {
     return TagAs(kFixedSizeArena, p);
   }
 
+  // Sets the value to the interned string `p`, which must outlive this
+  // instance. See documentation for kFixedSizeArena for more info.
+  // `p` must not be null
+  inline const std::string* SetInterned(const std::string* p) {
+    return TagAs(kFixedSizeArena, const_cast<std::string*>(p));
+  }
+
   // Sets the value to `p`, tagging the value as a mutable arena string.
   // See documentation for kMutableArena for more info.
   // `p` must not be null
@@ -365,6 +376,11 @@ struct PROTOBUF_EXPORT ArenaStringPtr {
   // string default.
   void ClearNonDefaultToEmpty();
 
+  // Called from parsing code only. Points this instance at the interned
+  // string `str`, which must outlive it, discarding the current value. The
+  // current value must not be heap allocated.
+  inline void SetInterned(const std::string* str);
+
   // Clears content, but keeps allocated std::string if arena != nullptr, to
   // avoid the overhead of heap operations. After this returns, the content
   // (as seen by the user) will always be equal to |default_value|.
@@ -402,7 +418,7 @@ struct PROTOBUF_EXPORT ArenaStringPtr {
 
   TaggedStringPtr tagged_ptr_;
 
-  bool IsFixedSizeArena() const { return false; }
+  bool IsFixedSizeArena() const { return tagged_ptr_.IsFixedSizeArena(); }
 
   // Swaps tagged pointer without debug hardening. This is to allow python
   // protobuf to maintain pointer stability even in DEBUG builds.
@@ -416,7 +432,7 @@ struct PROTOBUF_EXPORT ArenaStringPtr {
 
   // Slow paths.
 
-  // MutableSlow requires that !IsString() || IsDefault
+  // MutableSlow requires that !tagged_ptr_.IsMutable()
   // Variadic to support 0 args for empty default and 1 arg for LazyString.
   template <typename... Lazy>
   std::string* MutableSlow(::google::protobuf::Arena* arena, const Lazy&... lazy_default);
@@ -518,7 +534,17 @@ inline PROTOBUF_NDEBUG_INLINE void ArenaStringPtr::InternalSwap(
 #endif  // PROTOBUF_FORCE_COPY_IN_SWAP
 }
 
+inline void ArenaStringPtr::SetInterned(const std::string* str) {
+  ABSL_DCHECK(tagged_ptr_.GetIfAllocated() == nullptr);
+  tagged_ptr_.SetInterned(str);
+}
+
 inline void ArenaStringPtr::ClearNonDefaultToEmpty() {
+  if (PROTOBUF_PREDICT_FALSE(IsFixedSizeArena())) {
+    // Interned values are shared.
+    InitDefault();
+    return;
+  }
   // Unconditionally mask away the tag.
   tagged_ptr_.Get()->clear();
 }
@@ -8,10 +8,24 @@
 #include "google/protobuf/arenaz_sampler.h"
 
 #include <atomic>
+#include <cmath>
 #include <cstdint>
+#include <cstdlib>
 #include <limits>
+#include <string>
 #include <utility>
+#include <vector>
 
+#if defined(PROTOBUF_ARENAZ_SAMPLE)
+#include "absl/container/flat_hash_map.h"
+#include "absl/debugging/stacktrace.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+#endif  // defined(PROTOBUF_ARENAZ_SAMPLE)
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
@@ -63,6 +77,10 @@ void ThreadSafeArenaStats::PrepareForSampling(int64_t stride) {
   for (auto& blockstats : block_histogram) blockstats.PrepareForSampling();
   max_block_size.store(0, std::memory_order_relaxed);
   thread_ids.store(0, std::memory_order_relaxed);
+  bytes_cleanup.store(0, std::memory_order_relaxed);
+  bytes_tail_wasted.store(0, std::memory_order_relaxed);
+  bytes_current_block_free.store(0, std::memory_order_relaxed);
+  bytes_string_block_unused.store(0, std::memory_order_relaxed);
   weight = stride;
   // The inliner makes hardcoded skip_count difficult (especially when combined
   // with LTO).  We use the ability to exclude stacks by regex when encoding
@@ -112,6 +130,17 @@ void RecordAllocateSlow(ThreadSafeArenaStats* info, size_t used,
   info->thread_ids.fetch_or(tid, std::memory_order_relaxed);
 }
 
+void RecordMemoryReportSlow(ThreadSafeArenaStats* info, size_t cleanup,
+                            size_t tail_wasted, size_t current_block_free,
+                            size_t string_block_unused) {
+  info->bytes_cleanup.fetch_add(cleanup, std::memory_order_relaxed);
+  info->bytes_tail_wasted.fetch_add(tail_wasted, std::memory_order_relaxed);
+  info->bytes_current_block_free.fetch_add(current_block_free,
+                                           std::memory_order_relaxed);
+  info->bytes_string_block_unused.fetch_add(string_block_unused,
+                                            std::memory_order_relaxed);
+}
+
 ThreadSafeArenaStats* SampleSlow(SamplingState& sampling_state) {
   bool first = sampling_state.next_sample < 0;
   const int64_t next_stride = g_exponential_biased_generator.GetStride(
@@ -199,6 +228,256 @@ void SetThreadSafeArenazGlobalNextSample(int64_t next_sample) {
   }
 }
 
+PROTOBUF_THREAD_LOCAL int64_t arena_allocation_bytes_until_sample = 0;
+
+namespace {
+
+PROTOBUF_CONSTINIT std::atomic<int64_t> g_arena_allocation_sample_bytes{0};
+
+// Whether arena_allocation_bytes_until_sample of this thread was drawn for the
+// current sampling period, so that the allocation reaching it is a sample.
+PROTOBUF_THREAD_LOCAL bool arena_allocation_sampling_armed = false;
+
+// The profiler can be turned on at any time, so while it is off each thread
+// still checks again after allocating this many bytes.
+constexpr int64_t kArenaAllocationRecheckBytes = 1 << 20;
+
+// Upper bound on the number of samples kept by the allocation profiler.
+constexpr size_t kMaxArenaAllocationSamples = 1 << 16;
+constexpr int kMaxArenaAllocationStackDepth = 32;
+
+struct ArenaAllocationSample {
+  ArenaAllocationKind kind;
+  const char* type_name;
+  // Estimated number of allocations and bytes this sample stands for.
+  int64_t count;
+  int64_t bytes;
+  int depth;
+  void* stack[kMaxArenaAllocationStackDepth];
+};
+
+struct ArenaAllocationSamples {
+  absl::Mutex mutex;
+  std::vector<ArenaAllocationSample> samples ABSL_GUARDED_BY(mutex);
+};
+
+ArenaAllocationSamples& GlobalArenaAllocationSamples() {
+  static auto* samples = new ArenaAllocationSamples();
+  return *samples;
+}
+
+const char* ArenaAllocationKindName(ArenaAllocationKind kind) {
+  switch (kind) {
+    case ArenaAllocationKind::kMessage:
+      return "message";
+    case ArenaAllocationKind::kString:
+      return "string";
+    case ArenaAllocationKind::kRepeated:
+      return "repeated";
+    case ArenaAllocationKind::kMap:
+      return "map";
+    case ArenaAllocationKind::kOther:
+      break;
+  }
+  return "other";
+}
+
+// Returns the readable name of a type from its std::type_info::name().
+std::string DemangledTypeName(const char* name) {
+#if defined(__GNUC__)
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  if (status == 0 && demangled != nullptr) {
+    std::string result(demangled);
+    std::free(demangled);
+    return result;
+  }
+#endif
+  return name;
+}
+
+}  // namespace
+
+void RecordArenaAllocationSlow(ArenaAllocationKind kind, const char* type_name,
+                               size_t bytes) {
+  const int64_t period =
+      g_arena_allocation_sample_bytes.load(std::memory_order_relaxed);
+  if (period <= 0) {
+    arena_allocation_sampling_armed = false;
+    arena_allocation_bytes_until_sample = kArenaAllocationRecheckBytes;
+    return;
+  }
+  // The first allocation after the period was set only draws the initial
+  // stride.
+  const bool armed = arena_allocation_sampling_armed;
+  arena_allocation_sampling_armed = true;
+  arena_allocation_bytes_until_sample =
+      g_exponential_biased_generator.GetStride(period);
+  if (!armed) return;
+
+  ArenaAllocationSample sample;
+  sample.kind = kind;
+  sample.type_name = type_name;
+  // Unbias the estimate: an allocation of `bytes` is sampled with probability
+  // 1 - exp(-bytes / period).
+  const double scale =
+      1 / (1 - std::exp(-static_cast<double>(bytes) / period));
+  sample.count = static_cast<int64_t>(scale + 0.5);
+  sample.bytes = static_cast<int64_t>(scale * bytes + 0.5);
+  sample.depth = absl::GetStackTrace(sample.stack,
+                                     kMaxArenaAllocationStackDepth,
+                                     /* skip_count= */ 1);
+
+  ArenaAllocationSamples& global = GlobalArenaAllocationSamples();
+  absl::MutexLock lock(&global.mutex);
+  if (global.samples.size() < kMaxArenaAllocationSamples) {
+    global.samples.push_back(sample);
+  }
+}
+
+void SetArenaAllocationProfileSampleBytes(int64_t bytes) {
+  g_arena_allocation_sample_bytes.store(bytes > 0 ? bytes : 0,
+                                        std::memory_order_relaxed);
+  arena_allocation_sampling_armed = false;
+  arena_allocation_bytes_until_sample = 0;
+}
+
+int64_t ArenaAllocationProfileSampleBytes() {
+  return g_arena_allocation_sample_bytes.load(std::memory_order_relaxed);
+}
+
+void ResetArenaAllocationProfile() {
+  ArenaAllocationSamples& global = GlobalArenaAllocationSamples();
+  absl::MutexLock lock(&global.mutex);
+  global.samples.clear();
+}
+
+std::string ArenaAllocationProfile() {
+  // Field numbers of perftools.profiles.Profile and its nested messages.
+  enum : int {
+    kProfileSampleType = 1,
+    kProfileSample = 2,
+    kProfileLocation = 4,
+    kProfileStringTable = 6,
+    kProfilePeriodType = 11,
+    kProfilePeriod = 12,
+    kValueTypeType = 1,
+    kValueTypeUnit = 2,
+    kSampleLocationId = 1,
+    kSampleValue = 2,
+    kSampleLabel = 3,
+    kLabelKey = 1,
+    kLabelStr = 2,
+    kLocationId = 1,
+    kLocationAddress = 3,
+  };
+
+  std::vector<std::string> string_table = {""};
+  absl::flat_hash_map<std::string, int64_t> string_ids = {{"", 0}};
+  auto string_id = [&](const std::string& str) {
+    auto it = string_ids.emplace(str, string_table.size()).first;
+    if (it->second == static_cast<int64_t>(string_table.size())) {
+      string_table.push_back(str);
+    }
+    return it->second;
+  };
+  absl::flat_hash_map<void*, uint64_t> location_ids;
+  absl::flat_hash_map<const char*, std::string> type_names;
+  auto type_name = [&](const char* name) -> const std::string& {
+    auto it = type_names.find(name);
+    if (it == type_names.end()) {
+      it = type_names.emplace(name, DemangledTypeName(name)).first;
+    }
+    return it->second;
+  };
+
+  // Encodes a message from a callback writing its fields.
+  auto encode = [](auto fields) {
+    std::string out;
+    {
+      io::StringOutputStream stream(&out);
+      io::CodedOutputStream coded(&stream);
+      fields(coded);
+    }
+    return out;
+  };
+  auto write_varint_field = [](io::CodedOutputStream& out, int field,
+                               uint64_t value) {
+    out.WriteTag(static_cast<uint32_t>(field << 3));
+    out.WriteVarint64(value);
+  };
+  auto write_bytes_field = [](io::CodedOutputStream& out, int field,
+                              const std::string& value) {
+    out.WriteTag(static_cast<uint32_t>(field << 3 | 2));
+    out.WriteVarint32(static_cast<uint32_t>(value.size()));
+    out.WriteString(value);
+  };
+  auto value_type = [&](const char* type, const char* unit) {
+    return encode([&](io::CodedOutputStream& out) {
+      write_varint_field(out, kValueTypeType, string_id(type));
+      write_varint_field(out, kValueTypeUnit, string_id(unit));
+    });
+  };
+  auto label = [&](const char* key, const std::string& str) {
+    return encode([&](io::CodedOutputStream& out) {
+      write_varint_field(out, kLabelKey, string_id(key));
+      write_varint_field(out, kLabelStr, string_id(str));
+    });
+  };
+
+  std::vector<std::string> samples;
+  {
+    ArenaAllocationSamples& global = GlobalArenaAllocationSamples();
+    absl::MutexLock lock(&global.mutex);
+    for (const ArenaAllocationSample& sample : global.samples) {
+      samples.push_back(encode([&](io::CodedOutputStream& out) {
+        for (int i = 0; i < sample.depth; ++i) {
+          auto it = location_ids.emplace(sample.stack[i],
+                                         location_ids.size() + 1);
+          write_varint_field(out, kSampleLocationId, it.first->second);
+        }
+        write_varint_field(out, kSampleValue,
+                           static_cast<uint64_t>(sample.count));
+        write_varint_field(out, kSampleValue,
+                           static_cast<uint64_t>(sample.bytes));
+        write_bytes_field(out, kSampleLabel,
+                          label("kind", ArenaAllocationKindName(sample.kind)));
+        if (sample.type_name != nullptr) {
+          write_bytes_field(out, kSampleLabel,
+                            label("type", type_name(sample.type_name)));
+        }
+      }));
+    }
+  }
+
+  return encode([&](io::CodedOutputStream& out) {
+    write_bytes_field(out, kProfileSampleType, value_type("alloc_objects",
+                                                          "count"));
+    write_bytes_field(out, kProfileSampleType, value_type("alloc_space",
+                                                          "bytes"));
+    for (const std::string& sample : samples) {
+      write_bytes_field(out, kProfileSample, sample);
+    }
+    for (const auto& location : location_ids) {
+      write_bytes_field(out, kProfileLocation,
+                        encode([&](io::CodedOutputStream& out) {
+                          write_varint_field(out, kLocationId, location.second);
+                          write_varint_field(
+                              out, kLocationAddress,
+                              reinterpret_cast<uintptr_t>(location.first));
+                        }));
+    }
+    write_bytes_field(out, kProfilePeriodType, value_type("space", "bytes"));
+    write_varint_field(
+        out, kProfilePeriod,
+        static_cast<uint64_t>(ArenaAllocationProfileSampleBytes()));
+    // The string table goes last as the entries above add to it.
+    for (const std::string& str : string_table) {
+      write_bytes_field(out, kProfileStringTable, str);
+    }
+  });
+}
+
 #else
 ThreadSafeArenaStats* SampleSlow(int64_t* next_sample) {
   *next_sample = std::numeric_limits<int64_t>::max();
@@ -216,6 +495,10 @@ void SetThreadSafeArenazMaxSamples(int32_t max) {}
 void SetThreadSafeArenazMaxSamplesInternal(int32_t max) {}
 size_t ThreadSafeArenazMaxSamples() { return 0; }
 void SetThreadSafeArenazGlobalNextSample(int64_t next_sample) {}
+void SetArenaAllocationProfileSampleBytes(int64_t bytes) {}
+int64_t ArenaAllocationProfileSampleBytes() { return 0; }
+std::string ArenaAllocationProfile() { return ""; }
+void ResetArenaAllocationProfile() {}
 #endif  // defined(PROTOBUF_ARENAZ_SAMPLE)
 
 }  // namespace internal
@@ -12,6 +12,8 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <string>
+#include <typeinfo>
 #include <utility>
 
 
@@ -22,10 +24,23 @@ namespace google {
 namespace protobuf {
 namespace internal {
 
+// What an arena allocation is made for, as recorded by the arena allocation
+// profiler.
+enum class ArenaAllocationKind : uint8_t {
+  kMessage,
+  kString,
+  kRepeated,
+  kMap,
+  kOther,
+};
+
 #if defined(PROTOBUF_ARENAZ_SAMPLE)
 struct ThreadSafeArenaStats;
 void RecordAllocateSlow(ThreadSafeArenaStats* info, size_t used,
                         size_t allocated, size_t wasted);
+void RecordMemoryReportSlow(ThreadSafeArenaStats* info, size_t cleanup,
+                            size_t tail_wasted, size_t current_block_free,
+                            size_t string_block_unused);
 // Stores information about a sampled thread safe arena.  All mutations to this
 // *must* be made through `Record*` functions below.  All reads from this *must*
 // only occur in the callback to `ThreadSafeArenazSampler::Iterate`.
@@ -74,6 +89,13 @@ struct ThreadSafeArenaStats
   // create sampling artifacts.
   std::atomic<uint64_t> thread_ids;
 
+  // Totals of Arena::GetMemoryReport() taken each time the arena is reset or
+  // destroyed, to compute waste ratios against `block_histogram`.
+  std::atomic<size_t> bytes_cleanup;
+  std::atomic<size_t> bytes_tail_wasted;
+  std::atomic<size_t> bytes_current_block_free;
+  std::atomic<size_t> bytes_string_block_unused;
+
   // All of the fields below are set by `PrepareForSampling`, they must not
   // be mutated in `Record*` functions.  They are logically `const` in that
   // sense. These are guarded by init_mu, but that is not externalized to
@@ -88,6 +110,15 @@ struct ThreadSafeArenaStats
     RecordAllocateSlow(info, used, allocated, wasted);
   }
 
+  static void RecordMemoryReportStats(ThreadSafeArenaStats* info,
+                                      size_t cleanup, size_t tail_wasted,
+                                      size_t current_block_free,
+                                      size_t string_block_unused) {
+    if (PROTOBUF_PREDICT_TRUE(info == nullptr)) return;
+    RecordMemoryReportSlow(info, cleanup, tail_wasted, current_block_free,
+                           string_block_unused);
+  }
+
   // Returns the bin for the provided size.
   static size_t FindBin(size_t bytes);
 
@@ -160,6 +191,32 @@ inline ThreadSafeArenaStatsHandle Sample() {
   return ThreadSafeArenaStatsHandle(SampleSlow(global_sampling_state));
 }
 
+// Number of bytes this thread may allocate on arenas before the next
+// allocation is sampled by the arena allocation profiler.
+extern PROTOBUF_THREAD_LOCAL int64_t arena_allocation_bytes_until_sample;
+
+void RecordArenaAllocationSlow(ArenaAllocationKind kind, const char* type_name,
+                               size_t bytes);
+
+template <typename T>
+const char* ArenaAllocationTypeName() {
+#if PROTOBUF_RTTI
+  return typeid(T).name();
+#else
+  return nullptr;
+#endif
+}
+
+// Records an arena allocation of `bytes` for objects of type `T` with the
+// arena allocation profiler. Only one in every
+// ArenaAllocationProfileSampleBytes() bytes (on average) takes the slow path.
+template <typename T>
+inline void RecordArenaAllocation(ArenaAllocationKind kind, size_t bytes) {
+  arena_allocation_bytes_until_sample -= static_cast<int64_t>(bytes);
+  if (PROTOBUF_PREDICT_TRUE(arena_allocation_bytes_until_sample > 0)) return;
+  RecordArenaAllocationSlow(kind, ArenaAllocationTypeName<T>(), bytes);
+}
+
 #else
 
 using SamplingState = int64_t;
@@ -167,6 +224,11 @@ using SamplingState = int64_t;
 struct ThreadSafeArenaStats {
   static void RecordAllocateStats(ThreadSafeArenaStats*, size_t /*requested*/,
                                   size_t /*allocated*/, size_t /*wasted*/) {}
+  static void RecordMemoryReportStats(ThreadSafeArenaStats*,
+                                      size_t /*cleanup*/,
+                                      size_t /*tail_wasted*/,
+                                      size_t /*current_block_free*/,
+                                      size_t /*string_block_unused*/) {}
 };
 
 ThreadSafeArenaStats* SampleSlow(SamplingState& next_sample);
@@ -198,6 +260,9 @@ class ThreadSafeArenazSampler {
 inline ThreadSafeArenaStatsHandle Sample() {
   return ThreadSafeArenaStatsHandle(nullptr);
 }
+
+template <typename T>
+inline void RecordArenaAllocation(ArenaAllocationKind, size_t) {}
 #endif  // defined(PROTOBUF_ARENAZ_SAMPLE)
 
 // Returns a global Sampler.
@@ -230,6 +295,26 @@ size_t ThreadSafeArenazMaxSamples();
 // Sets the current value for when arenas should be next sampled.
 void SetThreadSafeArenazGlobalNextSample(int64_t next_sample);
 
+// Sets the mean number of bytes allocated on arenas between two allocations
+// sampled by the arena allocation profiler. 0 disables the profiler, which is
+// the default. Threads that are already allocating pick up a new value within
+// about a megabyte of allocations.
+void SetArenaAllocationProfileSampleBytes(int64_t bytes);
+
+// Returns the mean number of bytes between sampled arena allocations.
+int64_t ArenaAllocationProfileSampleBytes();
+
+// Returns the allocations sampled so far as a serialized, uncompressed
+// `perftools.profiles.Profile` (the pprof format). Every sample carries the
+// allocating stack, a "kind" label (message, string, repeated, map or other)
+// and, when RTTI is available, a "type" label with the demangled C++ name of
+// the allocated type, such as "proto2_unittest::TestAllTypes". Values
+// are estimated totals of allocation counts and bytes.
+std::string ArenaAllocationProfile();
+
+// Drops all allocations sampled so far.
+void ResetArenaAllocationProfile();
+
 }  // namespace internal
 }  // namespace protobuf
 }  // namespace google
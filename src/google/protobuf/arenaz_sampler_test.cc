@@ -11,6 +11,9 @@
 #include <limits>
 #include <memory>
 #include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <typeinfo>
 #include <utility>
 #include <vector>
 
@@ -591,6 +594,66 @@ TEST(ThreadSafeArenazSamplerTest, UsedAndWasted) {
   });
   SetThreadSafeArenazSampleParameter(oldparam);
 }
+
+TEST(ArenaAllocationProfileTest, RecordsKindsOfSampledAllocations) {
+  ResetArenaAllocationProfile();
+  EXPECT_EQ(ArenaAllocationProfileSampleBytes(), 0);
+  SetArenaAllocationProfileSampleBytes(1);
+  google::protobuf::Arena arena;
+  for (int i = 0; i < 100; ++i) {
+    Arena::Create<std::string>(&arena);
+    Arena::Create<int64_t>(&arena);
+  }
+  SetArenaAllocationProfileSampleBytes(0);
+
+  std::string profile = ArenaAllocationProfile();
+  EXPECT_THAT(profile, testing::HasSubstr("alloc_space"));
+  EXPECT_THAT(profile, testing::HasSubstr("string"));
+  EXPECT_THAT(profile, testing::HasSubstr("other"));
+
+  ResetArenaAllocationProfile();
+  EXPECT_THAT(ArenaAllocationProfile(),
+              testing::Not(testing::HasSubstr("string")));
+}
+
+TEST(ArenaAllocationProfileTest, ReachesThreadsThatAllocatedWhileDisabled) {
+  ResetArenaAllocationProfile();
+  google::protobuf::Arena arena;
+  std::atomic<bool> enabled{false};
+  std::thread thread([&] {
+    // Allocate while the profiler is off, then wait for it to be turned on
+    // from another thread.
+    Arena::Create<int64_t>(&arena);
+    while (!enabled.load()) {
+    }
+    // Two megabytes, which is more than the thread allocates before it checks
+    // whether the profiler was turned on.
+    for (int i = 0; i < (2 << 20) / 8; ++i) Arena::Create<int64_t>(&arena);
+  });
+  SetArenaAllocationProfileSampleBytes(1000);
+  enabled = true;
+  thread.join();
+  SetArenaAllocationProfileSampleBytes(0);
+
+  EXPECT_THAT(ArenaAllocationProfile(), testing::HasSubstr("other"));
+  ResetArenaAllocationProfile();
+}
+
+#if PROTOBUF_RTTI && defined(__GNUC__)
+TEST(ArenaAllocationProfileTest, ReportsDemangledTypeNames) {
+  ResetArenaAllocationProfile();
+  SetArenaAllocationProfileSampleBytes(1);
+  google::protobuf::Arena arena;
+  for (int i = 0; i < 100; ++i) Arena::Create<std::string>(&arena);
+  SetArenaAllocationProfileSampleBytes(0);
+
+  std::string profile = ArenaAllocationProfile();
+  EXPECT_THAT(profile, testing::HasSubstr("std::"));
+  EXPECT_THAT(profile,
+              testing::Not(testing::HasSubstr(typeid(std::string).name())));
+  ResetArenaAllocationProfile();
+}
+#endif
 #endif  // defined(PROTOBUF_ARENAZ_SAMPLE)
 
 }  // namespace
@@ -0,0 +1,332 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/columnar_view.h"
+
+#include <cstdint>
+#include <memory>
+
+#include "absl/base/casts.h"
+#include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/generated_enum_util.h"
+#include "google/protobuf/generated_message_tctable_decl.h"
+#include "google/protobuf/generated_message_tctable_impl.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/repeated_field.h"
+#include "google/protobuf/wire_format_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+using internal::TcParseTableBase;
+using internal::WireFormatLite;
+namespace fl = internal::field_layout;
+
+struct ColumnarView::Column {
+  const FieldDescriptor* field;
+  // Taken from the element type's parse table.
+  uint16_t type_card;
+  TcParseTableBase::FieldAux aux;
+  WireFormatLite::WireType wire_type;
+  // Set for closed enums that the parse table does not validate.
+  const EnumDescriptor* closed_enum = nullptr;
+
+  // Only the array matching the C++ type of `field` is used.
+  RepeatedField<int32_t> int32_values;
+  RepeatedField<int64_t> int64_values;
+  RepeatedField<uint32_t> uint32_values;
+  RepeatedField<uint64_t> uint64_values;
+  RepeatedField<float> float_values;
+  RepeatedField<double> double_values;
+  RepeatedField<bool> bool_values;
+
+  template <typename T>
+  const RepeatedField<T>& values() const;
+
+  void Clear();
+  void AddDefault();
+  // Stores the wire value `raw` in the last row.
+  void SetLast(uint64_t raw);
+};
+
+template <>
+const RepeatedField<int32_t>& ColumnarView::Column::values() const {
+  return int32_values;
+}
+template <>
+const RepeatedField<int64_t>& ColumnarView::Column::values() const {
+  return int64_values;
+}
+template <>
+const RepeatedField<uint32_t>& ColumnarView::Column::values() const {
+  return uint32_values;
+}
+template <>
+const RepeatedField<uint64_t>& ColumnarView::Column::values() const {
+  return uint64_values;
+}
+template <>
+const RepeatedField<float>& ColumnarView::Column::values() const {
+  return float_values;
+}
+template <>
+const RepeatedField<double>& ColumnarView::Column::values() const {
+  return double_values;
+}
+template <>
+const RepeatedField<bool>& ColumnarView::Column::values() const {
+  return bool_values;
+}
+
+void ColumnarView::Column::Clear() {
+  int32_values.Clear();
+  int64_values.Clear();
+  uint32_values.Clear();
+  uint64_values.Clear();
+  float_values.Clear();
+  double_values.Clear();
+  bool_values.Clear();
+}
+
+void ColumnarView::Column::AddDefault() {
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+      int32_values.Add(field->default_value_int32());
+      break;
+    case FieldDescriptor::CPPTYPE_ENUM:
+      int32_values.Add(field->default_value_enum()->number());
+      break;
+    case FieldDescriptor::CPPTYPE_INT64:
+      int64_values.Add(field->default_value_int64());
+      break;
+    case FieldDescriptor::CPPTYPE_UINT32:
+      uint32_values.Add(field->default_value_uint32());
+      break;
+    case FieldDescriptor::CPPTYPE_UINT64:
+      uint64_values.Add(field->default_value_uint64());
+      break;
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      float_values.Add(field->default_value_float());
+      break;
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      double_values.Add(field->default_value_double());
+      break;
+    case FieldDescriptor::CPPTYPE_BOOL:
+      bool_values.Add(field->default_value_bool());
+      break;
+    default:
+      ABSL_LOG(FATAL) << "Can't reach";
+  }
+}
+
+void ColumnarView::Column::SetLast(uint64_t raw) {
+  const bool zigzag = (type_card & fl::kTvMask) == fl::kTvZigZag;
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+      int32_values[int32_values.size() - 1] =
+          zigzag ? WireFormatLite::ZigZagDecode32(static_cast<uint32_t>(raw))
+                 : static_cast<int32_t>(raw);
+      break;
+    case FieldDescriptor::CPPTYPE_ENUM: {
+      const int32_t value = static_cast<int32_t>(raw);
+      const uint16_t xform_val = type_card & fl::kTvMask;
+      if (xform_val == fl::kTvRange) {
+        if (value < aux.enum_range.start ||
+            value >= aux.enum_range.start + aux.enum_range.length) {
+          return;
+        }
+      } else if (xform_val == fl::kTvEnum) {
+        if (!internal::ValidateEnum(value, aux.enum_data)) return;
+      } else if (closed_enum != nullptr) {
+        if (closed_enum->FindValueByNumber(value) == nullptr) return;
+      }
+      int32_values[int32_values.size() - 1] = value;
+      break;
+    }
+    case FieldDescriptor::CPPTYPE_INT64:
+      int64_values[int64_values.size() - 1] =
+          zigzag ? WireFormatLite::ZigZagDecode64(raw)
+                 : static_cast<int64_t>(raw);
+      break;
+    case FieldDescriptor::CPPTYPE_UINT32:
+      uint32_values[uint32_values.size() - 1] = static_cast<uint32_t>(raw);
+      break;
+    case FieldDescriptor::CPPTYPE_UINT64:
+      uint64_values[uint64_values.size() - 1] = raw;
+      break;
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      float_values[float_values.size() - 1] =
+          absl::bit_cast<float>(static_cast<uint32_t>(raw));
+      break;
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      double_values[double_values.size() - 1] = absl::bit_cast<double>(raw);
+      break;
+    case FieldDescriptor::CPPTYPE_BOOL:
+      bool_values[bool_values.size() - 1] = raw != 0;
+      break;
+    default:
+      ABSL_LOG(FATAL) << "Can't reach";
+  }
+}
+
+ColumnarView::ColumnarView(const FieldDescriptor* field,
+                           absl::Span<const int> column_field_numbers)
+    : field_(field) {
+  ABSL_CHECK(field->is_repeated() &&
+             field->type() == FieldDescriptor::TYPE_MESSAGE)
+      << "ColumnarView requires a repeated message field, got "
+      << field->full_name();
+  const Descriptor* element = field->message_type();
+  const Message* prototype =
+      MessageFactory::generated_factory()->GetPrototype(element);
+  ABSL_CHECK(prototype != nullptr)
+      << "ColumnarView requires a generated message type, got "
+      << element->full_name();
+  const TcParseTableBase* table =
+      prototype->GetReflection()->GetTcParseTable();
+
+  columns_.reserve(column_field_numbers.size());
+  for (int number : column_field_numbers) {
+    const FieldDescriptor* column_field = element->FindFieldByNumber(number);
+    ABSL_CHECK(column_field != nullptr)
+        << element->full_name() << " has no field number " << number;
+    ABSL_CHECK(!column_field->is_repeated() &&
+               column_field->cpp_type() != FieldDescriptor::CPPTYPE_STRING &&
+               column_field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE)
+        << "ColumnarView columns must be singular numeric, bool or enum "
+           "fields, got "
+        << column_field->full_name();
+
+    auto column = std::make_unique<Column>();
+    column->field = column_field;
+    const TcParseTableBase::FieldEntry* entry =
+        internal::TcParser::FindFieldEntry(table, number);
+    if (entry != nullptr && (entry->type_card & fl::kFkMask) != fl::kFkNone) {
+      column->type_card = entry->type_card;
+      if (entry->aux_idx != TcParseTableBase::FieldEntry::kNoAuxIdx) {
+        column->aux = *table->field_aux(entry->aux_idx);
+      }
+    } else {
+      // Reflection tables leave closed enums that are validated by a function
+      // to the fallback. Validate those through the descriptor instead.
+      ABSL_CHECK_EQ(column_field->cpp_type(), FieldDescriptor::CPPTYPE_ENUM);
+      column->type_card = fl::kOpenEnum;
+      column->closed_enum = column_field->enum_type();
+    }
+    if ((column->type_card & fl::kFkMask) == fl::kFkVarint) {
+      column->wire_type = WireFormatLite::WIRETYPE_VARINT;
+    } else if ((column->type_card & fl::kRepMask) == fl::kRep64Bits) {
+      column->wire_type = WireFormatLite::WIRETYPE_FIXED64;
+    } else {
+      column->wire_type = WireFormatLite::WIRETYPE_FIXED32;
+    }
+    columns_.push_back(std::move(column));
+  }
+}
+
+ColumnarView::~ColumnarView() = default;
+
+const FieldDescriptor* ColumnarView::column_field(int column) const {
+  ABSL_DCHECK_GE(column, 0);
+  ABSL_DCHECK_LT(column, columns());
+  return columns_[column]->field;
+}
+
+template <typename T>
+const RepeatedField<T>& ColumnarView::column(int column) const {
+  ABSL_DCHECK_GE(column, 0);
+  ABSL_DCHECK_LT(column, columns());
+  return columns_[column]->values<T>();
+}
+
+template const RepeatedField<int32_t>& ColumnarView::column(int) const;
+template const RepeatedField<int64_t>& ColumnarView::column(int) const;
+template const RepeatedField<uint32_t>& ColumnarView::column(int) const;
+template const RepeatedField<uint64_t>& ColumnarView::column(int) const;
+template const RepeatedField<float>& ColumnarView::column(int) const;
+template const RepeatedField<double>& ColumnarView::column(int) const;
+template const RepeatedField<bool>& ColumnarView::column(int) const;
+
+void ColumnarView::Clear() {
+  rows_ = 0;
+  for (auto& column : columns_) column->Clear();
+}
+
+bool ColumnarView::ParseFromString(absl::string_view data) {
+  Clear();
+  io::CodedInputStream input(reinterpret_cast<const uint8_t*>(data.data()),
+                             static_cast<int>(data.size()));
+  const uint32_t element_tag = WireFormatLite::MakeTag(
+      field_->number(), WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+
+  while (uint32_t tag = input.ReadTag()) {
+    if (tag != element_tag) {
+      if (WireFormatLite::GetTagWireType(tag) ==
+              WireFormatLite::WIRETYPE_END_GROUP ||
+          !WireFormatLite::SkipField(&input, tag)) {
+        return false;
+      }
+      continue;
+    }
+
+    int length;
+    if (!input.ReadVarintSizeAsInt(&length)) return false;
+    const io::CodedInputStream::Limit limit = input.PushLimit(length);
+    for (auto& column : columns_) column->AddDefault();
+    ++rows_;
+    while (uint32_t element_field_tag = input.ReadTag()) {
+      const int number = WireFormatLite::GetTagFieldNumber(element_field_tag);
+      Column* column = nullptr;
+      for (auto& candidate : columns_) {
+        if (candidate->field->number() == number) {
+          column = candidate.get();
+          break;
+        }
+      }
+      const WireFormatLite::WireType wire_type =
+          WireFormatLite::GetTagWireType(element_field_tag);
+      if (column == nullptr || wire_type != column->wire_type) {
+        if (wire_type == WireFormatLite::WIRETYPE_END_GROUP ||
+            !WireFormatLite::SkipField(&input, element_field_tag)) {
+          return false;
+        }
+        continue;
+      }
+      uint64_t raw;
+      bool ok;
+      if (wire_type == WireFormatLite::WIRETYPE_VARINT) {
+        ok = input.ReadVarint64(&raw);
+      } else if (wire_type == WireFormatLite::WIRETYPE_FIXED64) {
+        ok = input.ReadLittleEndian64(&raw);
+      } else {
+        uint32_t raw32;
+        ok = input.ReadLittleEndian32(&raw32);
+        raw = raw32;
+      }
+      if (!ok) return false;
+      column->SetLast(raw);
+    }
+    if (!input.ConsumedEntireMessage() || input.BytesUntilLimit() != 0) {
+      return false;
+    }
+    input.PopLimit(limit);
+  }
+  return input.ConsumedEntireMessage();
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
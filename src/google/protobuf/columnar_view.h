@@ -0,0 +1,94 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines ColumnarView, which decodes scalar subfields of a repeated
+// message field into contiguous per-column arrays.
+
+#ifndef GOOGLE_PROTOBUF_COLUMNAR_VIEW_H__
+#define GOOGLE_PROTOBUF_COLUMNAR_VIEW_H__
+
+#include <memory>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/repeated_field.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+// A ColumnarView decodes a repeated message field in struct-of-arrays form.
+// Instead of building one message object per element, the chosen scalar
+// subfields of every element are decoded straight into one contiguous
+// RepeatedField per subfield ("column"). Loops that read a few fields of many
+// elements then scan dense arrays instead of chasing a pointer per element:
+//
+//   // message Table { repeated Row rows = 1; }
+//   // message Row { int64 id = 1; double score = 2; string name = 3; }
+//   ColumnarView view(Table::descriptor()->FindFieldByName("rows"),
+//                     {Row::kIdFieldNumber, Row::kScoreFieldNumber});
+//   if (!view.ParseFromString(serialized_table)) { ... }
+//   const RepeatedField<int64_t>& ids = view.column<int64_t>(0);
+//   const RepeatedField<double>& scores = view.column<double>(1);
+//   for (int row = 0; row < view.rows(); ++row) { ... ids[row] ... }
+//
+// Row `i` of every column holds the value of element `i`, or the field's
+// default value if the element does not set it. When a field occurs several
+// times in an element the last value wins, as in regular parsing. All other
+// fields, of the containing message and of the elements, are skipped. Values
+// of closed enums that are not known are dropped, as if the field were unset.
+//
+// Columns must be singular fields of numeric, bool or enum type. The wire
+// layout of each column is taken from the element type's parse table, so the
+// element type must be a generated message.
+class PROTOBUF_EXPORT ColumnarView {
+ public:
+  // `field` must be a repeated message field. `column_field_numbers` are the
+  // numbers of the fields of `field->message_type()` to decode, in column
+  // order.
+  ColumnarView(const FieldDescriptor* field,
+               absl::Span<const int> column_field_numbers);
+  ColumnarView(const ColumnarView&) = delete;
+  ColumnarView& operator=(const ColumnarView&) = delete;
+  ~ColumnarView();
+
+  // Decodes the elements of `field()` from `data`, a serialized message of
+  // type `field()->containing_type()`, replacing the previous contents.
+  // Returns false if `data` is malformed; the columns are then unspecified.
+  bool ParseFromString(absl::string_view data);
+
+  // Removes all rows, keeping the allocated column storage.
+  void Clear();
+
+  const FieldDescriptor* field() const { return field_; }
+  int rows() const { return rows_; }
+  int columns() const { return static_cast<int>(columns_.size()); }
+  const FieldDescriptor* column_field(int column) const;
+
+  // Returns the values of a column, one per row. `T` must be the C++ type of
+  // the column field, with `int` used for enums.
+  template <typename T>
+  const RepeatedField<T>& column(int column) const;
+
+ private:
+  struct Column;
+
+  const FieldDescriptor* field_;
+  int rows_ = 0;
+  std::vector<std::unique_ptr<Column>> columns_;
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_COLUMNAR_VIEW_H__
@@ -0,0 +1,150 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/columnar_view.h"
+
+#include <cstdint>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/wire_format_lite.h"
+
+
+namespace google {
+namespace protobuf {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestParsingMerge;
+using internal::WireFormatLite;
+
+const FieldDescriptor* RepeatedAllTypes() {
+  return TestParsingMerge::descriptor()->FindFieldByName("repeated_all_types");
+}
+
+// Appends `element` to `data` as an element of repeated_all_types.
+void AppendElement(const std::string& element, std::string* data) {
+  io::StringOutputStream output(data);
+  io::CodedOutputStream coded(&output);
+  coded.WriteTag(WireFormatLite::MakeTag(
+      TestParsingMerge::kRepeatedAllTypesFieldNumber,
+      WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+  coded.WriteVarint32(static_cast<uint32_t>(element.size()));
+  coded.WriteString(element);
+}
+
+TEST(ColumnarViewTest, MatchesRegularParsing) {
+  TestParsingMerge source;
+  source.mutable_optional_all_types()->set_optional_int32(100);
+  TestAllTypes* row = source.add_repeated_all_types();
+  row->set_optional_int32(1);
+  row->set_optional_sint64(-5);
+  row->set_optional_fixed32(7);
+  row->set_optional_float(2.5f);
+  row->set_optional_double(1.5);
+  row->set_optional_bool(true);
+  row->set_optional_nested_enum(TestAllTypes::BAZ);
+  row->set_optional_string("skipped");
+  row->mutable_optionalgroup()->set_a(9);
+  source.add_repeated_all_types();
+  row = source.add_repeated_all_types();
+  row->set_optional_int32(-3);
+  row->set_optional_nested_enum(TestAllTypes::NEG);
+  std::string data = source.SerializePartialAsString();
+
+  // A row that sets a field twice and that has an unknown closed enum value.
+  TestAllTypes first;
+  first.set_optional_int32(10);
+  first.set_optional_nested_enum(TestAllTypes::BAR);
+  TestAllTypes second;
+  second.set_optional_int32(11);
+  std::string element = first.SerializeAsString() + second.SerializeAsString();
+  {
+    io::StringOutputStream output(&element);
+    io::CodedOutputStream coded(&output);
+    WireFormatLite::WriteEnum(TestAllTypes::kOptionalNestedEnumFieldNumber, 99,
+                              &coded);
+  }
+  AppendElement(element, &data);
+
+  TestParsingMerge parsed;
+  ASSERT_TRUE(parsed.ParsePartialFromString(data));
+  ASSERT_EQ(parsed.repeated_all_types_size(), 4);
+
+  ColumnarView view(RepeatedAllTypes(),
+                    {TestAllTypes::kOptionalInt32FieldNumber,
+                     TestAllTypes::kOptionalSint64FieldNumber,
+                     TestAllTypes::kOptionalFixed32FieldNumber,
+                     TestAllTypes::kOptionalFloatFieldNumber,
+                     TestAllTypes::kOptionalDoubleFieldNumber,
+                     TestAllTypes::kOptionalBoolFieldNumber,
+                     TestAllTypes::kOptionalNestedEnumFieldNumber,
+                     TestAllTypes::kDefaultInt64FieldNumber});
+  ASSERT_TRUE(view.ParseFromString(data));
+  ASSERT_EQ(view.rows(), 4);
+  ASSERT_EQ(view.columns(), 8);
+  EXPECT_EQ(view.column_field(1)->name(), "optional_sint64");
+
+  for (int i = 0; i < view.rows(); ++i) {
+    SCOPED_TRACE(i);
+    const TestAllTypes& expected = parsed.repeated_all_types(i);
+    EXPECT_EQ(view.column<int32_t>(0)[i], expected.optional_int32());
+    EXPECT_EQ(view.column<int64_t>(1)[i], expected.optional_sint64());
+    EXPECT_EQ(view.column<uint32_t>(2)[i], expected.optional_fixed32());
+    EXPECT_EQ(view.column<float>(3)[i], expected.optional_float());
+    EXPECT_EQ(view.column<double>(4)[i], expected.optional_double());
+    EXPECT_EQ(view.column<bool>(5)[i], expected.optional_bool());
+    EXPECT_EQ(view.column<int>(6)[i], expected.optional_nested_enum());
+    EXPECT_EQ(view.column<int64_t>(7)[i], expected.default_int64());
+  }
+  EXPECT_EQ(view.column<int32_t>(0)[3], 11);
+  EXPECT_EQ(view.column<int>(6)[3], TestAllTypes::BAR);
+  EXPECT_EQ(view.column<int64_t>(7)[0], 42);
+}
+
+TEST(ColumnarViewTest, ParseReplacesRows) {
+  TestParsingMerge source;
+  for (int i = 0; i < 1000; ++i) {
+    source.add_repeated_all_types()->set_optional_uint64(i);
+  }
+
+  ColumnarView view(RepeatedAllTypes(),
+                    {TestAllTypes::kOptionalUint64FieldNumber});
+  ASSERT_TRUE(view.ParseFromString(source.SerializePartialAsString()));
+  ASSERT_EQ(view.rows(), 1000);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(view.column<uint64_t>(0)[i], static_cast<uint64_t>(i));
+  }
+
+  source.mutable_repeated_all_types()->DeleteSubrange(1, 999);
+  ASSERT_TRUE(view.ParseFromString(source.SerializePartialAsString()));
+  EXPECT_EQ(view.rows(), 1);
+  EXPECT_EQ(view.column<uint64_t>(0).size(), 1);
+
+  view.Clear();
+  EXPECT_EQ(view.rows(), 0);
+  EXPECT_EQ(view.column<uint64_t>(0).size(), 0);
+}
+
+TEST(ColumnarViewTest, RejectsMalformedInput) {
+  TestParsingMerge source;
+  source.add_repeated_all_types()->set_optional_int64(1234567);
+  const std::string data = source.SerializePartialAsString();
+
+  ColumnarView view(RepeatedAllTypes(),
+                    {TestAllTypes::kOptionalInt64FieldNumber});
+  EXPECT_FALSE(view.ParseFromString(data.substr(0, data.size() - 1)));
+  EXPECT_FALSE(view.ParseFromString(data + "\x0c"));
+  EXPECT_TRUE(view.ParseFromString(data));
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
@@ -125,6 +125,12 @@ class PROTOC_EXPORT CodeGenerator {
   // proto files with an edition after this will result in an error.
   virtual Edition GetMaximumEdition() const { return Edition::EDITION_UNKNOWN; }
 
+  // Implement this to return true if Generate() may be called concurrently for
+  // different files, as protoc does when given --jobs.  Such a generator must
+  // not override GenerateAll(), and the output of Generate() for one file must
+  // not append to or insert into the output written for another.
+  virtual bool SupportsConcurrentGeneration() const { return false; }
+
   // Builds a default feature set mapping for this generator.
   //
   // This will use the extensions specified by GetFeatureExtensions(), with the
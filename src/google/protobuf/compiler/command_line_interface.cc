@@ -12,6 +12,7 @@
 #include "google/protobuf/compiler/command_line_interface.h"
 
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 
 #include "absl/algorithm/container.h"
@@ -43,14 +44,20 @@
 #endif
 #include <ctype.h>
 #include <errno.h>
+#include <signal.h>
 
 #include <fstream>
+#include <iterator>
+#include <random>
 #include <iostream>
 
 #include <limits.h>  // For PATH_MAX
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -65,11 +72,13 @@
 #include "absl/log/absl_log.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/compiler/code_generator.h"
 #include "google/protobuf/compiler/importer.h"
 #include "google/protobuf/compiler/plugin.pb.h"
@@ -295,6 +304,128 @@ bool GetBootstrapParam(const std::string& parameter) {
   return false;
 }
 
+// A cache of compilation results in a directory, shared by the protoc runs
+// given the same --cache_dir.  Entries are named after a hash of their key and
+// start with the key itself, so that colliding hashes only cost a miss.  They
+// are written to a temporary file that is then renamed, so that concurrent
+// runs never read a partial entry.  Failures to write entries are ignored.
+class CompileCache {
+ public:
+  explicit CompileCache(std::string directory)
+      : directory_(std::move(directory)) {
+    AddTrailingSlash(&directory_);
+  }
+
+  bool Lookup(absl::string_view kind, absl::string_view key,
+              std::string* value) const {
+    const std::string full_key = FullKey(kind, key);
+    std::ifstream input(EntryPath(kind, full_key), std::ios::binary);
+    if (!input) return false;
+    std::string entry((std::istreambuf_iterator<char>(input)),
+                      std::istreambuf_iterator<char>());
+    if (!absl::StartsWith(entry, full_key)) return false;
+    value->assign(entry, full_key.size(), std::string::npos);
+    return true;
+  }
+
+  void Store(absl::string_view kind, absl::string_view key,
+             absl::string_view value) const {
+    const std::string full_key = FullKey(kind, key);
+    const std::string path = EntryPath(kind, full_key);
+    const std::string temp_path =
+        absl::StrCat(path, ".", absl::Hex(std::random_device()()), ".tmp");
+    {
+      std::ofstream output(temp_path, std::ios::binary | std::ios::trunc);
+      output << full_key << value;
+      if (!output.flush()) {
+        output.close();
+        std::remove(temp_path.c_str());
+        return;
+      }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+      std::remove(temp_path.c_str());
+    }
+  }
+
+ private:
+  // Entries made by other versions of protoc never match.
+  static std::string FullKey(absl::string_view kind, absl::string_view key) {
+    return absl::StrCat(PROTOBUF_VERSION, "\n", kind, "\n", key.size(), "\n",
+                        key);
+  }
+
+  std::string EntryPath(absl::string_view kind,
+                        absl::string_view full_key) const {
+    // 64-bit FNV-1a.
+    uint64_t hash = 0xcbf29ce484222325u;
+    for (char c : full_key) {
+      hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3u;
+    }
+    return absl::StrCat(directory_, kind, "-",
+                        absl::Hex(hash, absl::kZeroPad16));
+  }
+
+  std::string directory_;
+};
+
+// Serves the files of a source tree from a CompileCache, keyed by their name
+// and content, and parses them with `database` when they are not cached.  As
+// cached files are not parsed, errors found while building them are reported
+// without a line number.  `kind` tells apart the entries of databases that
+// parse files differently.
+class CachedSourceTreeDatabase : public DescriptorDatabase {
+ public:
+  CachedSourceTreeDatabase(SourceTree* source_tree,
+                           DescriptorDatabase* database,
+                           const CompileCache* cache, absl::string_view kind)
+      : source_tree_(source_tree),
+        database_(database),
+        cache_(cache),
+        kind_(kind) {}
+
+  bool FindFileByName(const std::string& filename,
+                      FileDescriptorProto* output) override {
+    std::string key;
+    std::unique_ptr<io::ZeroCopyInputStream> input(
+        source_tree_->Open(filename));
+    if (input != nullptr) {
+      key = absl::StrCat(filename, "\n");
+      const void* data;
+      int size;
+      while (input->Next(&data, &size)) {
+        key.append(static_cast<const char*>(data), size);
+      }
+      std::string value;
+      if (cache_->Lookup(kind_, key, &value) &&
+          output->ParseFromString(value)) {
+        return true;
+      }
+    }
+    if (!database_->FindFileByName(filename, output)) return false;
+    if (!key.empty()) {
+      cache_->Store(kind_, key, output->SerializeAsString());
+    }
+    return true;
+  }
+  bool FindFileContainingSymbol(const std::string& symbol_name,
+                                FileDescriptorProto* output) override {
+    return database_->FindFileContainingSymbol(symbol_name, output);
+  }
+  bool FindFileContainingExtension(const std::string& containing_type,
+                                   int field_number,
+                                   FileDescriptorProto* output) override {
+    return database_->FindFileContainingExtension(containing_type,
+                                                  field_number, output);
+  }
+
+ private:
+  SourceTree* source_tree_;
+  DescriptorDatabase* database_;
+  const CompileCache* cache_;
+  std::string kind_;
+};
+
 
 }  // namespace
 
@@ -437,8 +568,10 @@ class CommandLineInterface::GeneratorContextImpl : public GeneratorContext {
   bool WriteAllToDisk(const std::string& prefix);
 
   // Write the contents of this directory to a ZIP-format archive with the
-  // given name.
-  bool WriteAllToZip(const std::string& filename);
+  // given name, compressing the files with deflate on `jobs` threads if
+  // `deflate` is set. The contents of the files are released as they are
+  // written.
+  bool WriteAllToZip(const std::string& filename, bool deflate, int jobs);
 
   // Add a boilerplate META-INF/MANIFEST.MF file as required by the Java JAR
   // format, unless one has already been written.
@@ -446,6 +579,14 @@ class CommandLineInterface::GeneratorContextImpl : public GeneratorContext {
 
   // Get name of all output files.
   void GetOutputFilenames(std::vector<std::string>* output_filenames);
+
+  // Returns true if no file was written yet.
+  bool IsEmpty() const { return files_.empty(); }
+  // Serializes the files written, as a CodeGeneratorResponse.  Returns false
+  // if writing any of them failed.
+  bool SerializeFiles(std::string* output) const;
+  // Adds the files serialized by SerializeFiles().
+  bool AddSerializedFiles(absl::string_view files);
   // implements GeneratorContext --------------------------------------
   io::ZeroCopyOutputStream* Open(const std::string& filename) override;
   io::ZeroCopyOutputStream* OpenForAppend(const std::string& filename) override;
@@ -461,6 +602,11 @@ class CommandLineInterface::GeneratorContextImpl : public GeneratorContext {
  private:
   friend class MemoryOutputStream;
 
+  // Held by MemoryOutputStream while it adds a generated file to files_ or
+  // sets had_error_, as generators supporting concurrent generation write
+  // their files from several threads. All other accesses happen once
+  // generation has finished, and do not take it.
+  absl::Mutex mutex_;
   // The files_ field maps from path keys to file content values. It's a map
   // instead of an unordered_map so that files are written in order (good when
   // writing zips).
@@ -608,7 +754,7 @@ bool CommandLineInterface::GeneratorContextImpl::WriteAllToDisk(
 }
 
 bool CommandLineInterface::GeneratorContextImpl::WriteAllToZip(
-    const std::string& filename) {
+    const std::string& filename, bool deflate, int jobs) {
   if (had_error_) {
     return false;
   }
@@ -630,8 +776,40 @@ bool CommandLineInterface::GeneratorContextImpl::WriteAllToZip(
   io::FileOutputStream stream(file_descriptor);
   ZipWriter zip_writer(&stream);
 
-  for (const auto& pair : files_) {
-    zip_writer.Write(pair.first, pair.second);
+  // Files are compressed a few per thread at a time, and written in order as
+  // soon as their batch is done, so that at most one batch of compressed
+  // files is held at once.
+  const size_t batch_size = deflate ? 4 * static_cast<size_t>(jobs) : 1;
+  std::vector<std::pair<const std::string*, std::string*>> batch;
+  std::vector<ZipWriter::Entry> entries;
+  for (auto it = files_.begin(); it != files_.end();) {
+    batch.clear();
+    for (; it != files_.end() && batch.size() < batch_size; ++it) {
+      batch.emplace_back(&it->first, &it->second);
+    }
+    entries.clear();
+    entries.resize(batch.size());
+    std::atomic<size_t> next_file{0};
+    auto make_entries = [&] {
+      for (size_t i = next_file++; i < batch.size(); i = next_file++) {
+        entries[i] = ZipWriter::MakeEntry(*batch[i].first,
+                                          std::move(*batch[i].second), deflate);
+      }
+    };
+    std::vector<std::thread> threads;
+    const size_t num_threads =
+        std::min(batch.size(), static_cast<size_t>(jobs));
+    for (size_t i = 1; i < num_threads; ++i) {
+      threads.emplace_back(make_entries);
+    }
+    make_entries();
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    for (ZipWriter::Entry& entry : entries) {
+      zip_writer.Write(entry);
+      entry = ZipWriter::Entry();
+    }
   }
 
   zip_writer.WriteDirectory();
@@ -666,6 +844,28 @@ void CommandLineInterface::GeneratorContextImpl::GetOutputFilenames(
   }
 }
 
+bool CommandLineInterface::GeneratorContextImpl::SerializeFiles(
+    std::string* output) const {
+  if (had_error_) return false;
+  CodeGeneratorResponse response;
+  for (const auto& pair : files_) {
+    CodeGeneratorResponse::File* file = response.add_file();
+    file->set_name(pair.first);
+    file->set_content(pair.second);
+  }
+  return response.SerializeToString(output);
+}
+
+bool CommandLineInterface::GeneratorContextImpl::AddSerializedFiles(
+    absl::string_view files) {
+  CodeGeneratorResponse response;
+  if (!response.ParseFromString(files)) return false;
+  for (const CodeGeneratorResponse::File& file : response.file()) {
+    files_[file.name()] = file.content();
+  }
+  return true;
+}
+
 io::ZeroCopyOutputStream* CommandLineInterface::GeneratorContextImpl::Open(
     const std::string& filename) {
   return new MemoryOutputStream(this, filename, false);
@@ -825,6 +1025,7 @@ CommandLineInterface::MemoryOutputStream::~MemoryOutputStream() {
   inner_.reset();
 
   // Insert into the directory.
+  absl::MutexLock lock(&directory_->mutex_);
   auto pair = directory_->files_.insert({filename_, ""});
   auto it = pair.first;
   bool already_present = !pair.second;
@@ -942,6 +1143,18 @@ const char* const CommandLineInterface::kPathSeparator = ";";
 const char* const CommandLineInterface::kPathSeparator = ":";
 #endif
 
+struct CommandLineInterface::PluginRun {
+  Subprocess subprocess;
+  std::string request;
+  CodeGeneratorResponse response;
+  std::string error;
+  bool succeeded = false;
+
+  void Communicate() {
+    succeeded = subprocess.CommunicateSerialized(request, &response, &error);
+  }
+};
+
 CommandLineInterface::CommandLineInterface()
     : direct_dependencies_violation_msg_(
           kDefaultDirectDependenciesViolationMsg) {}
@@ -1185,6 +1398,14 @@ int CommandLineInterface::Run(int argc, const char* const argv[]) {
   std::unique_ptr<MergedDescriptorDatabase> descriptor_set_in_database;
 
   std::unique_ptr<SourceTreeDescriptorDatabase> source_tree_database;
+  std::unique_ptr<CompileCache> compile_cache;
+  std::unique_ptr<CachedSourceTreeDatabase> cached_database;
+  if (!cache_dir_.empty()) {
+    if (!VerifyDirectoryExists(cache_dir_)) {
+      return 1;
+    }
+    compile_cache = std::make_unique<CompileCache>(cache_dir_);
+  }
 
   // Any --descriptor_set_in FileDescriptorSet objects will be used as a
   // fallback to input_files on command line, so create that db first.
@@ -1234,10 +1455,25 @@ int CommandLineInterface::Run(int argc, const char* const argv[]) {
     source_tree_database.reset(new SourceTreeDescriptorDatabase(
         disk_source_tree.get(), descriptor_set_in_database.get()));
     source_tree_database->RecordErrorsTo(error_collector.get());
-
+    // Only generators and --include_source_info use the source code info.
+    const bool skip_source_code_info =
+        output_directives_.empty() && !source_info_in_descriptor_set_;
+    source_tree_database->SetSkipSourceCodeInfo(skip_source_code_info);
+    // Files found in the cache are not parsed at all, so imports are only
+    // parsed ahead without one.
+    if (compile_cache == nullptr) {
+      source_tree_database->SetPrefetchThreads(jobs_);
+    }
+
+    DescriptorDatabase* database = source_tree_database.get();
+    if (compile_cache != nullptr) {
+      cached_database = std::make_unique<CachedSourceTreeDatabase>(
+          disk_source_tree.get(), database, compile_cache.get(),
+          skip_source_code_info ? "parse_without_source_info" : "parse");
+      database = cached_database.get();
+    }
     descriptor_pool.reset(new DescriptorPool(
-        source_tree_database.get(),
-        source_tree_database->GetValidationErrorCollector()));
+        database, source_tree_database->GetValidationErrorCollector()));
   }
 
   descriptor_pool->EnforceWeakDependencies(true);
@@ -1317,6 +1553,18 @@ int CommandLineInterface::Run(int argc, const char* const argv[]) {
 
   // Generate output.
   if (mode_ == MODE_COMPILE) {
+    plugin_request_.clear();
+    bootstrap_plugin_request_.clear();
+    plugin_runs_.clear();
+    // Plugins only see the request, not the output of other generators, so
+    // they can all run up front.  Their output is still written in order.
+    if (jobs_ > 1 &&
+        absl::c_count_if(output_directives_,
+                         [](const OutputDirective& output_directive) {
+                           return output_directive.generator == nullptr;
+                         }) > 1) {
+      RunPluginsConcurrently(parsed_files);
+    }
     for (int i = 0; i < output_directives_.size(); i++) {
       std::string output_location = output_directives_[i].output_location;
       if (!absl::EndsWith(output_location, ".zip") &&
@@ -1332,10 +1580,28 @@ int CommandLineInterface::Run(int argc, const char* const argv[]) {
         generator = std::make_unique<GeneratorContextImpl>(parsed_files);
       }
 
+      // Only the output of built-in generators is cached, and only when they
+      // write to a fresh location, as it then depends only on the key.
+      std::string cache_key;
+      if (compile_cache != nullptr &&
+          output_directives_[i].generator != nullptr && generator->IsEmpty()) {
+        cache_key = GetOutputCacheKey(parsed_files, output_directives_[i]);
+        std::string files;
+        if (compile_cache->Lookup("output", cache_key, &files) &&
+            generator->AddSerializedFiles(files)) {
+          continue;
+        }
+      }
+
       if (!GenerateOutput(parsed_files, output_directives_[i],
                           generator.get())) {
         return 1;
       }
+
+      std::string files;
+      if (!cache_key.empty() && generator->SerializeFiles(&files)) {
+        compile_cache->Store("output", cache_key, files);
+      }
     }
   }
 
@@ -1351,7 +1617,7 @@ int CommandLineInterface::Run(int argc, const char* const argv[]) {
         directory->AddJarManifest();
       }
 
-      if (!directory->WriteAllToZip(location)) {
+      if (!directory->WriteAllToZip(location, compress_zip_output_, jobs_)) {
         return 1;
       }
     }
@@ -1985,7 +2251,8 @@ bool CommandLineInterface::ParseArgument(const char* arg, std::string* name,
       *name == "--experimental_editions" ||
       *name == "--print_free_field_numbers" ||
       *name == "--experimental_allow_proto3_optional" ||
-      *name == "--deterministic_output" || *name == "--fatal_warnings") {
+      *name == "--deterministic_output" || *name == "--fatal_warnings" ||
+      *name == "--compress_zip_output") {
     // HACK:  These are the only flags that don't take a value.
     //   They probably should not be hard-coded like this but for now it's
     //   not worth doing better.
@@ -2247,6 +2514,23 @@ CommandLineInterface::InterpretArgument(const std::string& name,
       return PARSE_ARGUMENT_FAIL;
     }
 
+  } else if (name == "--cache_dir") {
+    if (value.empty()) {
+      std::cerr << name << " requires a directory." << std::endl;
+      return PARSE_ARGUMENT_FAIL;
+    }
+    cache_dir_ = value;
+
+  } else if (name == "--compress_zip_output") {
+    compress_zip_output_ = true;
+
+  } else if (name == "-j" || name == "--jobs") {
+    if (!absl::SimpleAtoi(value, &jobs_) || jobs_ < 1) {
+      std::cerr << name << " must be a positive number of jobs, got: " << value
+                << std::endl;
+      return PARSE_ARGUMENT_FAIL;
+    }
+
   } else if (name == "--fatal_warnings") {
     if (fatal_warnings_) {
       std::cerr << name << " may only be passed once." << std::endl;
@@ -2480,6 +2764,18 @@ Parse PROTO_FILES and generate output based on the options given:
                               gcc). This flag will make protoc return
                               with a non-zero exit code if any warnings
                               are generated.
+  -jN, --jobs=N               Parse imported files, and generate code with
+                              the code generators that support it, on N
+                              threads. The output does not depend on N.
+  --compress_zip_output       Compress the files of .zip, .jar and .srcjar
+                              outputs with deflate, on the threads given by
+                              --jobs. Files are stored uncompressed if protoc
+                              was built without zlib.
+  --cache_dir=DIR             Cache parsed files and the output of built-in
+                              generators in DIR, which must exist, to reuse
+                              them in later runs on the same inputs. Errors
+                              found in cached files are reported without a
+                              line number.
   --print_free_field_numbers  Print the free field numbers of the messages
                               defined in the given proto files. Extension ranges
                               are counted as occupied fields numbers.
@@ -2591,15 +2887,18 @@ bool CommandLineInterface::GenerateOutput(
         << "Bad name for plugin generator: " << output_directive.name;
 
     std::string plugin_name = PluginName(plugin_prefix_, output_directive.name);
-    std::string parameters = output_directive.parameter;
-    if (!plugin_parameters_[plugin_name].empty()) {
-      if (!parameters.empty()) {
-        parameters.append(",");
-      }
-      parameters.append(plugin_parameters_[plugin_name]);
+    std::unique_ptr<PluginRun> run;
+    auto it = plugin_runs_.find(&output_directive);
+    if (it != plugin_runs_.end()) {
+      run = std::move(it->second);
+      plugin_runs_.erase(it);
+    } else {
+      run = StartPlugin(parsed_files, plugin_name,
+                        GetPluginParameter(output_directive));
+      run->Communicate();
     }
-    if (!GeneratePluginOutput(parsed_files, plugin_name, parameters,
-                              generator_context, &error)) {
+    if (!WritePluginOutput(parsed_files, plugin_name, *run, generator_context,
+                           &error)) {
       std::cerr << output_directive.name << ": " << error << std::endl;
       return false;
     }
@@ -2624,8 +2923,14 @@ bool CommandLineInterface::GenerateOutput(
       return false;
     }
 
-    if (!output_directive.generator->GenerateAll(parsed_files, parameters,
-                                                 generator_context, &error)) {
+    const bool succeeded =
+        jobs_ > 1 && parsed_files.size() > 1 &&
+                output_directive.generator->SupportsConcurrentGeneration()
+            ? GenerateConcurrently(parsed_files, output_directive.generator,
+                                   parameters, generator_context, &error)
+            : output_directive.generator->GenerateAll(
+                  parsed_files, parameters, generator_context, &error);
+    if (!succeeded) {
       // Generator returned an error.
       std::cerr << output_directive.name << ": " << error << std::endl;
       return false;
@@ -2635,6 +2940,72 @@ bool CommandLineInterface::GenerateOutput(
   return true;
 }
 
+std::string CommandLineInterface::GetOutputCacheKey(
+    const std::vector<const FileDescriptor*>& parsed_files,
+    const OutputDirective& output_directive) {
+  std::string key = absl::StrCat(output_directive.name, "\n",
+                                 output_directive.parameter, "\n",
+                                 generator_parameters_[output_directive.name],
+                                 "\n", parsed_files.size(), "\n");
+  FileDescriptorSet file_set;
+  absl::flat_hash_set<const FileDescriptor*> already_seen;
+  TransitiveDependencyOptions options;
+  options.include_json_name = true;
+  options.include_source_code_info = true;
+  options.retain_options = true;
+  for (const FileDescriptor* file : parsed_files) {
+    absl::StrAppend(&key, file->name(), "\n");
+    GetTransitiveDependencies(file, &already_seen, file_set.mutable_file(),
+                              options);
+  }
+  file_set.AppendToString(&key);
+  return key;
+}
+
+bool CommandLineInterface::GenerateConcurrently(
+    const std::vector<const FileDescriptor*>& parsed_files,
+    const CodeGenerator* generator, const std::string& parameter,
+    GeneratorContext* generator_context, std::string* error) {
+  // Each file records its own error, so that the error reported is the one
+  // GenerateAll() would have reported, whatever the order in which the files
+  // were generated.
+  std::vector<std::string> errors(parsed_files.size());
+  std::vector<char> succeeded(parsed_files.size(), false);
+  std::atomic<size_t> next_file{0};
+  auto generate = [&] {
+    for (size_t i = next_file++; i < parsed_files.size(); i = next_file++) {
+      succeeded[i] = generator->Generate(parsed_files[i], parameter,
+                                         generator_context, &errors[i]);
+    }
+  };
+  std::vector<std::thread> threads;
+  const size_t num_threads =
+      std::min(parsed_files.size(), static_cast<size_t>(jobs_));
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(generate);
+  }
+  generate();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  // Like GenerateAll(), the first file with an error or a failure decides the
+  // result, so an error set by a generator that still returned true does not
+  // fail the run.
+  for (size_t i = 0; i < parsed_files.size(); ++i) {
+    if (!succeeded[i] || !errors[i].empty()) {
+      if (errors[i].empty()) {
+        errors[i] =
+            "Code generator returned false but provided no error "
+            "description.";
+      }
+      *error = absl::StrCat(parsed_files[i]->name(), ": ", errors[i]);
+      return succeeded[i];
+    }
+  }
+  return true;
+}
+
 bool CommandLineInterface::GenerateDependencyManifestFile(
     const std::vector<const FileDescriptor*>& parsed_files,
     const GeneratorContextMap& output_directories,
@@ -2716,26 +3087,52 @@ bool CommandLineInterface::GenerateDependencyManifestFile(
   return true;
 }
 
-bool CommandLineInterface::GeneratePluginOutput(
+std::string CommandLineInterface::GetPluginParameter(
+    const OutputDirective& output_directive) {
+  std::string plugin_name = PluginName(plugin_prefix_, output_directive.name);
+  std::string parameters = output_directive.parameter;
+  if (!plugin_parameters_[plugin_name].empty()) {
+    if (!parameters.empty()) {
+      parameters.append(",");
+    }
+    parameters.append(plugin_parameters_[plugin_name]);
+  }
+  return parameters;
+}
+
+std::string CommandLineInterface::GetPluginRequest(
     const std::vector<const FileDescriptor*>& parsed_files,
-    const std::string& plugin_name, const std::string& parameter,
-    GeneratorContext* generator_context, std::string* error) {
-  CodeGeneratorRequest request;
-  CodeGeneratorResponse response;
+    const std::string& parameter) {
   std::string processed_parameter = parameter;
-
   bool bootstrap = GetBootstrapParam(processed_parameter);
 
-  // Build the request.
-  if (!processed_parameter.empty()) {
-    request.set_parameter(processed_parameter);
+  std::string& serialized_request =
+      bootstrap ? bootstrap_plugin_request_ : plugin_request_;
+  if (serialized_request.empty()) {
+    CodeGeneratorRequest request;
+    BuildPluginRequest(parsed_files, bootstrap, &request);
+    request.SerializeToString(&serialized_request);
   }
 
+  // Parsing concatenated messages merges them, so the parameter is appended
+  // to the shared request instead of serializing it again for each plugin.
+  std::string result = serialized_request;
+  if (!processed_parameter.empty()) {
+    CodeGeneratorRequest parameter_request;
+    parameter_request.set_parameter(processed_parameter);
+    parameter_request.AppendToString(&result);
+  }
+  return result;
+}
 
+void CommandLineInterface::BuildPluginRequest(
+    const std::vector<const FileDescriptor*>& parsed_files, bool bootstrap,
+    CodeGeneratorRequest* request) {
   absl::flat_hash_set<const FileDescriptor*> already_seen;
   for (const FileDescriptor* file : parsed_files) {
-    request.add_file_to_generate(file->name());
-    GetTransitiveDependencies(file, &already_seen, request.mutable_proto_file(),
+    request->add_file_to_generate(file->name());
+    GetTransitiveDependencies(file, &already_seen,
+                              request->mutable_proto_file(),
                               {/*.include_json_name =*/true,
                                /*.include_source_code_info =*/true,
                                /*.retain_options =*/true});
@@ -2747,10 +3144,10 @@ bool CommandLineInterface::GeneratePluginOutput(
   const DescriptorPool* pool = parsed_files[0]->pool();
   absl::flat_hash_set<std::string> files_to_generate(input_files_.begin(),
                                                      input_files_.end());
-  for (FileDescriptorProto& file_proto : *request.mutable_proto_file()) {
+  for (FileDescriptorProto& file_proto : *request->mutable_proto_file()) {
     if (files_to_generate.contains(file_proto.name())) {
       const FileDescriptor* file = pool->FindFileByName(file_proto.name());
-      *request.add_source_file_descriptors() = std::move(file_proto);
+      *request->add_source_file_descriptors() = std::move(file_proto);
       file->CopyTo(&file_proto);
       // Don't populate source code info or json_name for bootstrap protos.
       if (!bootstrap) {
@@ -2762,26 +3159,78 @@ bool CommandLineInterface::GeneratePluginOutput(
   }
 
   google::protobuf::compiler::Version* version =
-      request.mutable_compiler_version();
+      request->mutable_compiler_version();
   version->set_major(PROTOBUF_VERSION / 1000000);
   version->set_minor(PROTOBUF_VERSION / 1000 % 1000);
   version->set_patch(PROTOBUF_VERSION % 1000);
   version->set_suffix(PROTOBUF_VERSION_SUFFIX);
+}
 
-  // Invoke the plugin.
-  Subprocess subprocess;
+std::unique_ptr<CommandLineInterface::PluginRun>
+CommandLineInterface::StartPlugin(
+    const std::vector<const FileDescriptor*>& parsed_files,
+    const std::string& plugin_name, const std::string& parameter) {
+  auto run = std::make_unique<PluginRun>();
+  run->request = GetPluginRequest(parsed_files, parameter);
 
   if (plugins_.count(plugin_name) > 0) {
-    subprocess.Start(plugins_[plugin_name], Subprocess::EXACT_NAME);
+    run->subprocess.Start(plugins_[plugin_name], Subprocess::EXACT_NAME);
   } else {
-    subprocess.Start(plugin_name, Subprocess::SEARCH_PATH);
+    run->subprocess.Start(plugin_name, Subprocess::SEARCH_PATH);
   }
+  return run;
+}
 
-  std::string communicate_error;
-  if (!subprocess.Communicate(request, &response, &communicate_error)) {
-    *error = absl::Substitute("$0: $1", plugin_name, communicate_error);
+void CommandLineInterface::RunPluginsConcurrently(
+    const std::vector<const FileDescriptor*>& parsed_files) {
+  // The plugins are all started from this thread, since Subprocess::Start()
+  // forks, before any other thread is.
+  std::vector<PluginRun*> runs;
+  for (const OutputDirective& output_directive : output_directives_) {
+    if (output_directive.generator != nullptr) continue;
+    std::unique_ptr<PluginRun>& run = plugin_runs_[&output_directive];
+    run = StartPlugin(parsed_files,
+                      PluginName(plugin_prefix_, output_directive.name),
+                      GetPluginParameter(output_directive));
+    runs.push_back(run.get());
+  }
+
+#ifndef _WIN32
+  // Communicate() ignores SIGPIPE and then restores the previous handler,
+  // which is only safe across threads if that handler ignores it too.
+  typedef void SignalHandler(int);
+  SignalHandler* old_pipe_handler = signal(SIGPIPE, SIG_IGN);
+#endif  // !_WIN32
+  std::atomic<size_t> next_run{0};
+  auto communicate = [&] {
+    for (size_t i = next_run++; i < runs.size(); i = next_run++) {
+      runs[i]->Communicate();
+    }
+  };
+  std::vector<std::thread> threads;
+  const size_t num_threads =
+      std::min(runs.size(), static_cast<size_t>(jobs_));
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(communicate);
+  }
+  communicate();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+#ifndef _WIN32
+  signal(SIGPIPE, old_pipe_handler);
+#endif  // !_WIN32
+}
+
+bool CommandLineInterface::WritePluginOutput(
+    const std::vector<const FileDescriptor*>& parsed_files,
+    const std::string& plugin_name, const PluginRun& run,
+    GeneratorContext* generator_context, std::string* error) {
+  if (!run.succeeded) {
+    *error = absl::Substitute("$0: $1", plugin_name, run.error);
     return false;
   }
+  const CodeGeneratorResponse& response = run.response;
 
   // Write the files.  We do this even if there was a generator error in order
   // to match the behavior of a compiled-in generator.
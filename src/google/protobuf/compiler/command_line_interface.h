@@ -47,9 +47,10 @@ class SimpleDescriptorDatabase;  // descriptor_database.h
 
 namespace compiler {
 
-class CodeGenerator;     // code_generator.h
-class GeneratorContext;  // code_generator.h
-class DiskSourceTree;    // importer.h
+class CodeGenerator;          // code_generator.h
+class CodeGeneratorRequest;   // plugin.pb.h
+class GeneratorContext;       // code_generator.h
+class DiskSourceTree;         // importer.h
 
 struct TransitiveDependencyOptions {
   bool include_json_name = false;
@@ -281,9 +282,39 @@ class PROTOC_EXPORT CommandLineInterface {
   bool GenerateOutput(const std::vector<const FileDescriptor*>& parsed_files,
                       const OutputDirective& output_directive,
                       GeneratorContext* generator_context);
-  bool GeneratePluginOutput(
+  // Returns the key of the output of `output_directive` for `parsed_files` in
+  // the --cache_dir cache.
+  std::string GetOutputCacheKey(
       const std::vector<const FileDescriptor*>& parsed_files,
-      const std::string& plugin_name, const std::string& parameter,
+      const OutputDirective& output_directive);
+  // Calls generator->Generate() for each of `parsed_files` on jobs_ threads.
+  bool GenerateConcurrently(
+      const std::vector<const FileDescriptor*>& parsed_files,
+      const CodeGenerator* generator, const std::string& parameter,
+      GeneratorContext* generator_context, std::string* error);
+  // A plugin subprocess, with its request and its response.
+  struct PluginRun;  // defined in command_line_interface.cc
+  // Returns the parameter passed to the plugin of `output_directive`.
+  std::string GetPluginParameter(const OutputDirective& output_directive);
+  // Returns the serialized CodeGeneratorRequest for `parsed_files`, which is
+  // only built once for all the plugins.
+  std::string GetPluginRequest(
+      const std::vector<const FileDescriptor*>& parsed_files,
+      const std::string& parameter);
+  void BuildPluginRequest(
+      const std::vector<const FileDescriptor*>& parsed_files, bool bootstrap,
+      CodeGeneratorRequest* request);
+  std::unique_ptr<PluginRun> StartPlugin(
+      const std::vector<const FileDescriptor*>& parsed_files,
+      const std::string& plugin_name, const std::string& parameter);
+  // Starts the plugins of all output directives, and communicates with them
+  // on jobs_ threads, filling plugin_runs_.
+  void RunPluginsConcurrently(
+      const std::vector<const FileDescriptor*>& parsed_files);
+  // Writes the files in the response of a plugin which has run.
+  bool WritePluginOutput(
+      const std::vector<const FileDescriptor*>& parsed_files,
+      const std::string& plugin_name, const PluginRun& run,
       GeneratorContext* generator_context, std::string* error);
 
   // Implements --encode and --decode.
@@ -363,6 +394,15 @@ class PROTOC_EXPORT CommandLineInterface {
   // Similar to generator_parameters_, but stores the parameters for plugins.
   absl::flat_hash_map<std::string, std::string> plugin_parameters_;
 
+  // The CodeGeneratorRequest sent to plugins, serialized without its
+  // parameter, and the same request for plugins bootstrapping protoc.  They
+  // are built for the first plugin of a compilation.
+  std::string plugin_request_;
+  std::string bootstrap_plugin_request_;
+  // The plugins run by RunPluginsConcurrently(), by output directive.
+  absl::flat_hash_map<const OutputDirective*, std::unique_ptr<PluginRun>>
+      plugin_runs_;
+
   // See AllowPlugins().  If this is empty, plugins aren't allowed.
   std::string plugin_prefix_;
 
@@ -462,6 +502,17 @@ class PROTOC_EXPORT CommandLineInterface {
 
   // When using --encode, this will be passed to SetSerializationDeterministic.
   bool deterministic_output_ = false;
+
+  // Number of threads generating code with the generators that support it, as
+  // given by --jobs.
+  int jobs_ = 1;
+
+  // Was the --compress_zip_output flag used?
+  bool compress_zip_output_ = false;
+
+  // Directory of the cache of parsed files and generated code, from
+  // --cache_dir. Empty if there is no cache.
+  std::string cache_dir_;
 };
 
 }  // namespace compiler
@@ -13,10 +13,12 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <atomic>
 #include <cstdint>
 
 #include <gmock/gmock.h>
 #include "absl/log/absl_check.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "google/protobuf/compiler/command_line_interface_tester.h"
@@ -46,6 +48,8 @@
 #include "google/protobuf/compiler/plugin.pb.h"
 #include "google/protobuf/compiler/subprocess.h"
 #include "google/protobuf/io/io_win32.h"
+#include "google/protobuf/io/printer.h"
+#include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/test_textproto.h"
 #include "google/protobuf/test_util2.h"
 #include "google/protobuf/unittest.pb.h"
@@ -3059,6 +3063,167 @@ TEST_F(CommandLineInterfaceTest, InvalidErrorFormat) {
   ExpectErrorText("Unknown error format: invalid\n");
 }
 
+// Writes the names of the messages of each file to "<file>.messages", and fails
+// for the files whose names start with "bad". For the files whose names start
+// with "warn", it sets an error but still succeeds.
+class ConcurrentCodeGenerator : public CodeGenerator {
+ public:
+  bool Generate(const FileDescriptor* file, const std::string& parameter,
+                GeneratorContext* context, std::string* error) const override {
+    if (absl::StartsWith(file->name(), "bad")) {
+      *error = "Bad file.";
+      return false;
+    }
+    if (absl::StartsWith(file->name(), "warn")) {
+      *error = "Suspicious file.";
+    }
+    std::unique_ptr<io::ZeroCopyOutputStream> output(
+        context->Open(absl::StrCat(file->name(), ".messages")));
+    io::Printer printer(output.get(), '$');
+    for (int i = 0; i < file->message_type_count(); ++i) {
+      printer.PrintRaw(absl::StrCat(file->message_type(i)->name(), "\n"));
+    }
+    return true;
+  }
+
+  bool SupportsConcurrentGeneration() const override { return true; }
+};
+
+TEST_F(CommandLineInterfaceTest, ConcurrentGeneration) {
+  RegisterGenerator("--concurrent_out",
+                    std::make_unique<ConcurrentCodeGenerator>(),
+                    "Concurrent output.");
+  std::string files;
+  for (int i = 0; i < 10; ++i) {
+    CreateTempFile(absl::StrCat("foo", i, ".proto"),
+                   absl::StrCat("syntax = \"proto2\";\n"
+                                "message Foo",
+                                i, " {}\n"));
+    absl::StrAppend(&files, " foo", i, ".proto");
+  }
+
+  Run(absl::StrCat("protocol_compiler --concurrent_out=$tmpdir "
+                   "--proto_path=$tmpdir --jobs=4",
+                   files));
+
+  ExpectNoErrors();
+  for (int i = 0; i < 10; ++i) {
+    ExpectFileContent(absl::StrCat("foo", i, ".proto.messages"),
+                      absl::StrCat("Foo", i, "\n"));
+  }
+}
+
+TEST_F(CommandLineInterfaceTest, ConcurrentGenerationReportsFirstError) {
+  RegisterGenerator("--concurrent_out",
+                    std::make_unique<ConcurrentCodeGenerator>(),
+                    "Concurrent output.");
+  CreateTempFile("foo.proto", "syntax = \"proto2\";\n");
+  CreateTempFile("bad1.proto", "syntax = \"proto2\";\n");
+  CreateTempFile("bad2.proto", "syntax = \"proto2\";\n");
+
+  Run("protocol_compiler --concurrent_out=$tmpdir --proto_path=$tmpdir -j3 "
+      "foo.proto bad1.proto bad2.proto");
+
+  ExpectErrorText("--concurrent_out: bad1.proto: Bad file.\n");
+}
+
+TEST_F(CommandLineInterfaceTest, ConcurrentGenerationIgnoresErrorOnSuccess) {
+  // A generator that sets an error but returns true does not fail the serial
+  // GenerateAll(), so it must not fail concurrent generation either.
+  RegisterGenerator("--concurrent_out",
+                    std::make_unique<ConcurrentCodeGenerator>(),
+                    "Concurrent output.");
+  CreateTempFile("foo.proto", "syntax = \"proto2\";\n");
+  CreateTempFile("warn.proto", "syntax = \"proto2\";\n");
+
+  for (const char* jobs : {"-j1", "-j2"}) {
+    Run(absl::StrCat("protocol_compiler --concurrent_out=$tmpdir "
+                     "--proto_path=$tmpdir ",
+                     jobs, " foo.proto warn.proto"));
+    ExpectNoErrors();
+  }
+}
+
+TEST_F(CommandLineInterfaceTest, ConcurrentPlugins) {
+  // The plugins run together, but their output is still written in order,
+  // so that they can insert into the output of earlier ones.
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Foo {}\n");
+
+  Run("protocol_compiler --jobs=2 "
+      "--test_out=TestParameter:$tmpdir "
+      "--plug_out=TestPluginParameter:$tmpdir "
+      "--test_out=insert=test_generator,test_plugin:$tmpdir "
+      "--plug_out=insert=test_generator,test_plugin:$tmpdir "
+      "--proto_path=$tmpdir foo.proto");
+
+  ExpectNoErrors();
+  ExpectGeneratedWithInsertions("test_generator", "TestParameter",
+                                "test_generator,test_plugin", "foo.proto",
+                                "Foo");
+  ExpectGeneratedWithInsertions("test_plugin", "TestPluginParameter",
+                                "test_generator,test_plugin", "foo.proto",
+                                "Foo");
+}
+
+TEST_F(CommandLineInterfaceTest, InvalidJobs) {
+  CreateTempFile("foo.proto", "syntax = \"proto2\";\n");
+
+  Run("protocol_compiler --test_out=$tmpdir --proto_path=$tmpdir --jobs=0 "
+      "foo.proto");
+
+  ExpectErrorText("--jobs must be a positive number of jobs, got: 0\n");
+}
+
+// Counts the calls to ConcurrentCodeGenerator::Generate().
+class CountingCodeGenerator : public ConcurrentCodeGenerator {
+ public:
+  bool Generate(const FileDescriptor* file, const std::string& parameter,
+                GeneratorContext* context, std::string* error) const override {
+    ++calls_;
+    return ConcurrentCodeGenerator::Generate(file, parameter, context, error);
+  }
+
+  int calls() const { return calls_; }
+
+ private:
+  mutable std::atomic<int> calls_{0};
+};
+
+TEST_F(CommandLineInterfaceTest, CacheDir) {
+  auto generator = std::make_unique<CountingCodeGenerator>();
+  CountingCodeGenerator* counting_generator = generator.get();
+  RegisterGenerator("--counting_out", std::move(generator), "Counting output.");
+  CreateTempDir("cache");
+  CreateTempDir("out");
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Foo {}\n");
+  const std::string command =
+      "protocol_compiler --counting_out=$tmpdir/out --proto_path=$tmpdir "
+      "--cache_dir=$tmpdir/cache foo.proto";
+
+  Run(command);
+  ExpectNoErrors();
+  EXPECT_EQ(counting_generator->calls(), 1);
+  ExpectFileContent("out/foo.proto.messages", "Foo\n");
+
+  // The output of unchanged inputs comes from the cache.
+  Run(command);
+  ExpectNoErrors();
+  EXPECT_EQ(counting_generator->calls(), 1);
+  ExpectFileContent("out/foo.proto.messages", "Foo\n");
+
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Bar {}\n");
+  Run(command);
+  ExpectNoErrors();
+  EXPECT_EQ(counting_generator->calls(), 2);
+  ExpectFileContent("out/foo.proto.messages", "Bar\n");
+}
+
 TEST_F(CommandLineInterfaceTest, Warnings) {
   // Test --fatal_warnings.
 
@@ -106,6 +106,10 @@ class CordFieldGenerator : public FieldGeneratorBase {
       $field$ = ::$proto_ns$::Arena::Create<absl::Cord>(arena, *from.$field$);
     )cc");
   }
+
+ protected:
+  // Generates the setters that take a moved Cord or std::string.
+  void GenerateMoveSetters(io::Printer* printer) const;
 };
 
 class CordOneofFieldGenerator : public CordFieldGenerator {
@@ -157,7 +161,12 @@ void CordFieldGenerator::GenerateAccessorDeclarations(
          descriptor_);
   format(
       "$deprecated_attr$void ${1$set_$name$$}$(const ::absl::Cord& value);\n"
-      "$deprecated_attr$void ${1$set_$name$$}$(::absl::string_view value);\n",
+      "$deprecated_attr$void ${1$set_$name$$}$(::absl::Cord&& value);\n"
+      "$deprecated_attr$void ${1$set_$name$$}$(::absl::string_view value);\n"
+      "template <typename String,\n"
+      "          typename = typename std::enable_if<\n"
+      "              std::is_same<String, std::string>::value>::type>\n"
+      "$deprecated_attr$void ${1$set_$name$$}$(String&& value);\n",
       std::make_tuple(descriptor_, GeneratedCodeInfo::Annotation::SET));
   format(
       "private:\n"
@@ -212,6 +221,27 @@ void CordFieldGenerator::GenerateInlineAccessorDefinitions(
       return &$field$;
     }
   )cc");
+  GenerateMoveSetters(printer);
+}
+
+void CordFieldGenerator::GenerateMoveSetters(io::Printer* printer) const {
+  auto v = printer->WithVars(variables_);
+  printer->Emit(R"cc(
+    inline void $classname$::set_$name$(::absl::Cord&& value) {
+      *_internal_mutable_$name$() = std::move(value);
+      $annotate_set$;
+      // @@protoc_insertion_point(field_set:$full_name$)
+    }
+  )cc");
+  // Cord takes over the buffer of a large string instead of copying it.
+  printer->Emit(R"cc(
+    template <typename String, typename>
+    inline void $classname$::set_$name$(String&& value) {
+      *_internal_mutable_$name$() = std::move(value);
+      $annotate_set$;
+      // @@protoc_insertion_point(field_set:$full_name$)
+    }
+  )cc");
 }
 
 void CordFieldGenerator::GenerateClearingCode(io::Printer* printer) const {
@@ -394,6 +424,7 @@ void CordOneofFieldGenerator::GenerateInlineAccessorDefinitions(
       return $field$;
     }
   )cc");
+  GenerateMoveSetters(printer);
 }
 
 void CordOneofFieldGenerator::GenerateNonInlineAccessorDefinitions(
@@ -409,6 +440,8 @@ void CordOneofFieldGenerator::GenerateNonInlineAccessorDefinitions(
 }
 
 void CordOneofFieldGenerator::GenerateClearingCode(io::Printer* printer) const {
+  // The arena destroys the cords of arena-only messages.
+  if (IsArenaOnly(descriptor_->containing_type(), options_)) return;
   Formatter format(printer, variables_);
   format(
       "if (GetArena() == nullptr) {\n"
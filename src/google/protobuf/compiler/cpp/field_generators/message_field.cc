@@ -46,16 +46,19 @@ std::vector<Sub> Vars(const FieldDescriptor* field, const Options& opts,
   std::string default_ptr =
       QualifiedDefaultInstancePtr(field->message_type(), opts);
   absl::string_view base = "::google::protobuf::MessageLite";
+  // Placeholders left in implicit weak fields before their type was linked are
+  // parsed into it when accessed.
+  std::string weak_default =
+      absl::Substitute("reinterpret_cast<const $0*>($1)", base, default_ptr);
+  std::string resolve_weak =
+      "::google::protobuf::internal::ImplicitWeakMessage::Resolve";
 
   return {
       {"Submsg", qualified_type},
       {"MemberType", !weak ? qualified_type : base},
       {"CompleteType", !is_foreign ? qualified_type : base},
       {"kDefault", default_ref},
-      {"kDefaultPtr", !weak
-                          ? default_ptr
-                          : absl::Substitute("reinterpret_cast<const $0*>($1)",
-                                             base, default_ptr)},
+      {"kDefaultPtr", !weak ? default_ptr : weak_default},
       {"base_cast", !is_foreign && !weak
                         ? ""
                         : absl::Substitute("reinterpret_cast<$0*>", base)},
@@ -65,9 +68,16 @@ std::vector<Sub> Vars(const FieldDescriptor* field, const Options& opts,
       Sub{"foreign_cast",
           !is_foreign ? "" : absl::Substitute("reinterpret_cast<$0*>", base)}
           .ConditionalFunctionCall(),
-      {"cast_field_", !weak ? field_name
-                            : absl::Substitute("reinterpret_cast<$0*>($1)",
-                                               qualified_type, field_name)},
+      {"cast_field_",
+       !weak ? field_name
+             : absl::Substitute("reinterpret_cast<$0*>($1Mutable(&$2, $3))",
+                                qualified_type, resolve_weak, field_name,
+                                weak_default)},
+      {"const_cast_field_",
+       !weak ? field_name
+             : absl::Substitute("reinterpret_cast<const $0*>($1($2, $3))",
+                                qualified_type, resolve_weak, field_name,
+                                weak_default)},
       {"Weak", weak ? "Weak" : ""},
       {".weak", weak ? ".weak" : ""},
       {"_weak", weak ? "_weak" : ""},
@@ -88,7 +98,8 @@ class SingularMessage : public FieldGeneratorBase {
         field_(field),
         opts_(&opts),
         has_required_(scc->HasRequiredFields(field->message_type())),
-        has_hasbit_(HasHasbit(field)) {}
+        has_hasbit_(HasHasbit(field)),
+        arena_only_(IsArenaOnly(field->containing_type(), opts)) {}
 
   ~SingularMessage() override = default;
 
@@ -147,6 +158,9 @@ class SingularMessage : public FieldGeneratorBase {
   const Options* opts_;
   bool has_required_;
   bool has_hasbit_;
+  // The containing message is only ever on an arena, so it never owns its
+  // submessages.
+  bool arena_only_;
 };
 
 void SingularMessage::GenerateAccessorDeclarations(io::Printer* p) const {
@@ -195,12 +209,60 @@ void SingularMessage::GenerateInlineAccessorDefinitions(io::Printer* p) const {
                }
              )cc");
            }},
+          {"delete_old",
+           [&] {
+             if (arena_only_) return;
+             p->Emit(R"cc(
+               if (GetArena() == nullptr) {
+                 delete reinterpret_cast<$pb$::MessageLite*>($field_$);
+               }
+             )cc");
+           }},
+          {"force_copy_released",
+           [&] {
+             if (arena_only_) {
+               p->Emit(R"cc(
+                 released = $pbi$::DuplicateIfNonNull(released);
+               )cc");
+               return;
+             }
+             p->Emit(R"cc(
+               auto* old = reinterpret_cast<$pb$::MessageLite*>(released);
+               released = $pbi$::DuplicateIfNonNull(released);
+               if (GetArena() == nullptr) {
+                 delete old;
+               }
+             )cc");
+           }},
+          {"copy_released",
+           [&] {
+             if (arena_only_) {
+               p->Emit(R"cc(
+                 released = $pbi$::DuplicateIfNonNull(released);
+               )cc");
+               return;
+             }
+             p->Emit(R"cc(
+               if (GetArena() != nullptr) {
+                 released = $pbi$::DuplicateIfNonNull(released);
+               }
+             )cc");
+           }},
+          {"delete_previous",
+           [&] {
+             if (arena_only_) return;
+             p->Emit(R"cc(
+               if (message_arena == nullptr) {
+                 delete $base_cast$($field_$);
+               }
+             )cc");
+           }},
       },
       R"cc(
         inline const $Submsg$& $Msg$::_internal_$name$() const {
           $TsanDetectConcurrentRead$;
           $StrongRef$;
-          const $Submsg$* p = $cast_field_$;
+          const $Submsg$* p = $const_cast_field_$;
           return p != nullptr ? *p : reinterpret_cast<const $Submsg$&>($kDefault$);
         }
         inline const $Submsg$& $Msg$::$name$() const ABSL_ATTRIBUTE_LIFETIME_BOUND {
@@ -213,9 +275,7 @@ void SingularMessage::GenerateInlineAccessorDefinitions(io::Printer* p) const {
           $PrepareSplitMessageForWrite$;
           //~ If we're not on an arena, free whatever we were holding before.
           //~ (If we are on arena, we can just forget the earlier pointer.)
-          if (GetArena() == nullptr) {
-            delete reinterpret_cast<$pb$::MessageLite*>($field_$);
-          }
+          $delete_old$;
           $field_$ = reinterpret_cast<$MemberType$*>(value);
           $update_hasbit$;
           $annotate_set$;
@@ -231,15 +291,9 @@ void SingularMessage::GenerateInlineAccessorDefinitions(io::Printer* p) const {
           $Submsg$* released = $cast_field_$;
           $field_$ = nullptr;
 #ifdef PROTOBUF_FORCE_COPY_IN_RELEASE
-          auto* old = reinterpret_cast<$pb$::MessageLite*>(released);
-          released = $pbi$::DuplicateIfNonNull(released);
-          if (GetArena() == nullptr) {
-            delete old;
-          }
+          $force_copy_released$;
 #else   // PROTOBUF_FORCE_COPY_IN_RELEASE
-          if (GetArena() != nullptr) {
-            released = $pbi$::DuplicateIfNonNull(released);
-          }
+          $copy_released$;
 #endif  // !PROTOBUF_FORCE_COPY_IN_RELEASE
           return released;
         }
@@ -280,9 +334,7 @@ void SingularMessage::GenerateInlineAccessorDefinitions(io::Printer* p) const {
           $pb$::Arena* message_arena = GetArena();
           $TsanDetectConcurrentMutation$;
           $PrepareSplitMessageForWrite$;
-          if (message_arena == nullptr) {
-            delete $base_cast$($field_$);
-          }
+          $delete_previous$;
 
           if (value != nullptr) {
             //~ When $Submsg$ is a cross-file type, have to read the arena
@@ -380,7 +432,8 @@ void SingularMessage::GenerateInternalAccessorDefinitions(
             $clear_oneof$;
             msg->$field_$ = $kDefaultPtr$->New(msg->GetArena());
           }
-          return msg->$field_$;
+          return $pbi$::ImplicitWeakMessage::ResolveMutable(&msg->$field_$,
+                                                             $kDefaultPtr$);
         }
       )cc");
 }
@@ -389,11 +442,13 @@ void SingularMessage::GenerateClearingCode(io::Printer* p) const {
   if (!has_hasbit_) {
     // If we don't have has-bits, message presence is indicated only by ptr !=
     // nullptr. Thus on clear, we need to delete the object.
-    p->Emit(
-        "if (GetArena() == nullptr && $field_$ != nullptr) {\n"
-        "  delete $field_$;\n"
-        "}\n"
-        "$field_$ = nullptr;\n");
+    if (!arena_only_) {
+      p->Emit(
+          "if (GetArena() == nullptr && $field_$ != nullptr) {\n"
+          "  delete $field_$;\n"
+          "}\n");
+    }
+    p->Emit("$field_$ = nullptr;\n");
   } else {
     p->Emit("if ($field_$ != nullptr) $field_$->Clear();\n");
   }
@@ -403,11 +458,13 @@ void SingularMessage::GenerateMessageClearingCode(io::Printer* p) const {
   if (!has_hasbit_) {
     // If we don't have has-bits, message presence is indicated only by ptr !=
     // nullptr. Thus on clear, we need to delete the object.
-    p->Emit(
-        "if (GetArena() == nullptr && $field_$ != nullptr) {\n"
-        "  delete $field_$;\n"
-        "}\n"
-        "$field_$ = nullptr;\n");
+    if (!arena_only_) {
+      p->Emit(
+          "if (GetArena() == nullptr && $field_$ != nullptr) {\n"
+          "  delete $field_$;\n"
+          "}\n");
+    }
+    p->Emit("$field_$ = nullptr;\n");
   } else {
     p->Emit(
         "$DCHK$($field_$ != nullptr);\n"
@@ -419,7 +476,8 @@ void SingularMessage::GenerateMergingCode(io::Printer* p) const {
   if (is_weak()) {
     p->Emit(
         "_Internal::mutable_$name$(_this)->CheckTypeAndMergeFrom(\n"
-        "    _Internal::$name$(&from));\n");
+        "    *$pbi$::ImplicitWeakMessage::Resolve(&_Internal::$name$(&from),\n"
+        "                                         $kDefaultPtr$));\n");
   } else {
     p->Emit(
         "_this->_internal_mutable_$name$()->$Submsg$::MergeFrom(\n"
@@ -570,28 +628,40 @@ void OneofMessage::GenerateInlineAccessorDefinitions(io::Printer* p) const {
       p->WithVars({{"release_name", SafeFunctionName(field_->containing_type(),
                                                      field_, "release_")}});
 
-  p->Emit(R"cc(
-    inline $Submsg$* $Msg$::$release_name$() {
-      $annotate_release$;
-      // @@protoc_insertion_point(field_release:$pkg.Msg.field$)
-      $StrongRef$;
-      if ($has_field$) {
-        clear_has_$oneof_name$();
-        auto* temp = $cast_field_$;
-        if (GetArena() != nullptr) {
-          temp = $pbi$::DuplicateIfNonNull(temp);
-        }
-        $field_$ = nullptr;
-        return temp;
-      } else {
-        return nullptr;
-      }
-    }
-  )cc");
+  p->Emit({{"copy_temp",
+            [&] {
+              if (arena_only_) {
+                p->Emit(R"cc(
+                  temp = $pbi$::DuplicateIfNonNull(temp);
+                )cc");
+                return;
+              }
+              p->Emit(R"cc(
+                if (GetArena() != nullptr) {
+                  temp = $pbi$::DuplicateIfNonNull(temp);
+                }
+              )cc");
+            }}},
+          R"cc(
+            inline $Submsg$* $Msg$::$release_name$() {
+              $annotate_release$;
+              // @@protoc_insertion_point(field_release:$pkg.Msg.field$)
+              $StrongRef$;
+              if ($has_field$) {
+                clear_has_$oneof_name$();
+                auto* temp = $cast_field_$;
+                $copy_temp$;
+                $field_$ = nullptr;
+                return temp;
+              } else {
+                return nullptr;
+              }
+            }
+          )cc");
   p->Emit(R"cc(
     inline const $Submsg$& $Msg$::_internal_$name$() const {
       $StrongRef$;
-      return $has_field$ ? *$cast_field_$ : reinterpret_cast<$Submsg$&>($kDefault$);
+      return $has_field$ ? *$const_cast_field_$ : reinterpret_cast<$Submsg$&>($kDefault$);
     }
   )cc");
   p->Emit(R"cc(
@@ -652,6 +722,7 @@ void OneofMessage::GenerateInlineAccessorDefinitions(io::Printer* p) const {
 }
 
 void OneofMessage::GenerateClearingCode(io::Printer* p) const {
+  if (arena_only_) return;
   p->Emit(R"cc(
     if (GetArena() == nullptr) {
       delete $field_$;
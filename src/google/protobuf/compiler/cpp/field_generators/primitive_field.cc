@@ -17,6 +17,7 @@
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
 #include "google/protobuf/compiler/cpp/field.h"
 #include "google/protobuf/compiler/cpp/field_generators/generators.h"
@@ -458,6 +459,23 @@ void RepeatedPrimitive::GenerateAccessorDeclarations(io::Printer* p) const {
 
     public:
   )cc");
+
+  if (!UseSpanAccessors(field_, *opts_)) return;
+  auto vr = p->WithVars(AnnotatedAccessors(field_, {"resize_uninitialized_"},
+                                           Semantic::kAlias));
+  p->Emit({Sub("name_span", absl::StrCat(FieldName(field_), "_span"))
+               .AnnotatedAs(field_),
+           Sub("mutable_name_span",
+               absl::StrCat("mutable_", FieldName(field_), "_span"))
+               .AnnotatedAs({field_, Semantic::kAlias})},
+          R"cc(
+            $DEPRECATED$ ::absl::Span<const $Type$> $name_span$() const;
+            $DEPRECATED$ ::absl::Span<$Type$> $mutable_name_span$();
+            //~ Resizes the field to `size` elements. Elements past the old
+            //~ size are left uninitialized, to be filled through the span.
+            $DEPRECATED$ ::absl::Span<$Type$> $resize_uninitialized_name$(
+                int size);
+          )cc");
 }
 
 void RepeatedPrimitive::GenerateInlineAccessorDefinitions(
@@ -502,6 +520,37 @@ void RepeatedPrimitive::GenerateInlineAccessorDefinitions(
     }
   )cc");
 
+  if (UseSpanAccessors(field_, *opts_)) {
+    p->Emit(R"cc(
+      inline ::absl::Span<const $Type$> $Msg$::$name$_span() const
+          ABSL_ATTRIBUTE_LIFETIME_BOUND {
+        $annotate_list$;
+        const auto& field = _internal_$name$();
+        return ::absl::MakeConstSpan(field.data(), field.size());
+      }
+      inline ::absl::Span<$Type$> $Msg$::mutable_$name$_span()
+          ABSL_ATTRIBUTE_LIFETIME_BOUND {
+        $annotate_mutable_list$;
+        $TsanDetectConcurrentMutation$;
+        auto* field = _internal_mutable_$name$();
+        return ::absl::MakeSpan(field->mutable_data(), field->size());
+      }
+      inline ::absl::Span<$Type$> $Msg$::resize_uninitialized_$name$(int size)
+          ABSL_ATTRIBUTE_LIFETIME_BOUND {
+        $annotate_mutable_list$;
+        $TsanDetectConcurrentMutation$;
+        auto* field = _internal_mutable_$name$();
+        if (size <= field->size()) {
+          field->Truncate(size);
+        } else {
+          field->Reserve(size);
+          field->AddNAlreadyReserved(size - field->size());
+        }
+        return ::absl::MakeSpan(field->mutable_data(), size);
+      }
+    )cc");
+  }
+
   if (should_split()) {
     p->Emit(R"cc(
       inline const $pb$::RepeatedField<$Type$>& $Msg$::_internal_$name$()
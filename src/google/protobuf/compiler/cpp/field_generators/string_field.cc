@@ -982,18 +982,35 @@ void RepeatedString::GenerateInlineAccessorDefinitions(io::Printer* p) const {
 
 void RepeatedString::GenerateSerializeWithCachedSizesToArray(
     io::Printer* p) const {
+  bool has_utf8_check =
+      field_->type() == FieldDescriptor::TYPE_STRING &&
+      internal::cpp::GetUtf8CheckMode(
+          field_, GetOptimizeFor(field_->file(), options_) ==
+                      FileOptions::LITE_RUNTIME) !=
+          internal::cpp::Utf8CheckMode::kNone;
+  // The elements are checked first so that the stream can write all of them
+  // in one call.
   p->Emit({{"utf8_check",
             [&] {
-              GenerateUtf8CheckCodeForString(
-                  p, field_, options_, false,
-                  "s.data(), static_cast<int>(s.length()),");
+              if (!has_utf8_check) return;
+              p->Emit(
+                  {{"check",
+                    [&] {
+                      GenerateUtf8CheckCodeForString(
+                          p, field_, options_, false,
+                          "s.data(), static_cast<int>(s.length()),");
+                    }}},
+                  R"cc(
+                    for (int i = 0, n = this->_internal_$name$_size(); i < n; ++i) {
+                      const auto& s = this->_internal_$name$().Get(i);
+                      $check$;
+                    }
+                  )cc");
             }}},
           R"cc(
-            for (int i = 0, n = this->_internal_$name$_size(); i < n; ++i) {
-              const auto& s = this->_internal_$name$().Get(i);
-              $utf8_check$;
-              target = stream->Write$DeclaredType$($number$, s, target);
-            }
+            $utf8_check$;
+            target = stream->WriteRepeated$DeclaredType$MaybeAliased(
+                $number$, this->_internal_$name$(), target);
           )cc");
 }
 }  // namespace
@@ -980,6 +980,20 @@ void FileGenerator::GenerateGlobalSource(io::Printer* p) {
   }
 }
 
+void FileGenerator::GenerateLayoutReport(io::Printer* p) {
+  p->Print(absl::StrCat(
+      "# Estimated memory layout of the messages of ", file_->name(),
+      ", assuming 64-bit pointers.\n"
+      "# message <name> sizeof=<bytes> padding=<bytes> has_bit_words=<n> "
+      "split_sizeof=<bytes>\n"
+      "# field <message> <number> <name> offset=<bytes> size=<bytes> "
+      "[oneof] [split] [inlined] [hit_ratio=<r>] [split_candidate] "
+      "[inline_candidate]\n"));
+  for (const auto& generator : message_generators_) {
+    generator->GenerateLayoutReport(p);
+  }
+}
+
 void FileGenerator::GenerateSource(io::Printer* p) {
   auto v = p->WithVars(FileVars(file_, options_));
 
@@ -1312,12 +1326,21 @@ void FileGenerator::GenerateReflectionInitializationCode(io::Printer* p) {
   // pull in a lot of unnecessary code that can't be stripped by --gc-sections.
   // Descriptor initialization will still be performed lazily when it's needed.
   if (!IsLazilyInitializedFile(file_->name())) {
-    p->Emit({{"dummy", UniqueName("dynamic_init_dummy", file_, options_)}},
-            R"cc(
-              // Force running AddDescriptors() at dynamic initialization time.
-              PROTOBUF_ATTRIBUTE_INIT_PRIORITY2
-              static ::_pbi::AddDescriptorsRunner $dummy$(&$desc_table$);
-            )cc");
+    if (options_.lazy_descriptor_registration) {
+      p->Emit({{"dummy", UniqueName("dynamic_init_dummy", file_, options_)}},
+              R"cc(
+                // Link the file, to be added when the pool is first used.
+                PROTOBUF_ATTRIBUTE_INIT_PRIORITY2
+                static ::_pbi::LazyAddDescriptorsRunner $dummy$(&$desc_table$);
+              )cc");
+    } else {
+      p->Emit({{"dummy", UniqueName("dynamic_init_dummy", file_, options_)}},
+              R"cc(
+                // Force running AddDescriptors() at dynamic initialization time.
+                PROTOBUF_ATTRIBUTE_INIT_PRIORITY2
+                static ::_pbi::AddDescriptorsRunner $dummy$(&$desc_table$);
+              )cc");
+    }
   }
 
   // However, we must provide a way to force initialize the default instances
@@ -1513,6 +1536,11 @@ void FileGenerator::GenerateLibraryIncludes(io::Printer* p) {
   if (ShouldVerify(file_, options_, &scc_analyzer_)) {
     IncludeFile("third_party/protobuf/wire_format_verify.h", p);
   }
+  // Field listeners are enabled per file, so all messages agree.
+  if (file_->message_type_count() > 0 &&
+      HasTracker(file_->message_type(0), options_)) {
+    IncludeFile("third_party/protobuf/field_access_listener.h", p);
+  }
 
   if (options_.opensource_runtime) {
     // Verify the protobuf library header version is compatible with the protoc
@@ -69,6 +69,9 @@ class PROTOC_EXPORT FileGenerator {
   // Generates a source file containing everything except messages and
   // extensions.
   void GenerateGlobalSource(io::Printer* p);
+  // Generates the memory layout report requested by the layout_report
+  // option; see MessageGenerator::GenerateLayoutReport().
+  void GenerateLayoutReport(io::Printer* p);
 
  private:
   // Generates a file, setting up the necessary accoutrements that start and
@@ -11,7 +11,10 @@
 
 #include "google/protobuf/compiler/cpp/generator.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
+#include <fstream>
 #include <memory>
 #include <string>
 #include <utility>
@@ -19,7 +22,9 @@
 
 #include "absl/status/status.h"
 #include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/compiler/cpp/file.h"
 #include "google/protobuf/compiler/cpp/helpers.h"
@@ -78,6 +83,47 @@ absl::flat_hash_map<absl::string_view, std::string> CommonVars(
   };
 }
 
+// Reads a dump of TcParser::DumpFieldStats(): lines of
+// "<message full name> <field number> <hits>".
+bool ReadFieldHitStats(const std::string& path, FieldHitStats* stats,
+                       std::string* error) {
+  std::ifstream input(path);
+  if (!input) {
+    *error = absl::StrCat("Could not open field_hit_stats file: ", path);
+    return false;
+  }
+  absl::flat_hash_map<std::string, absl::flat_hash_map<int, uint64_t>> hits;
+  std::string line;
+  for (int line_number = 1; std::getline(input, line); ++line_number) {
+    std::vector<absl::string_view> parts =
+        absl::StrSplit(line, ' ', absl::SkipWhitespace());
+    if (parts.empty()) continue;
+    int number;
+    uint64_t count;
+    if (parts.size() != 3 || !absl::SimpleAtoi(parts[1], &number) ||
+        !absl::SimpleAtoi(parts[2], &count)) {
+      *error = absl::StrCat(path, ":", line_number,
+                            ": expected \"<message> <field number> <hits>\"");
+      return false;
+    }
+    hits[parts[0]][number] += count;
+  }
+
+  for (const auto& message : hits) {
+    uint64_t max_hits = 0;
+    for (const auto& field : message.second) {
+      max_hits = std::max(max_hits, field.second);
+    }
+    if (max_hits == 0) continue;
+    auto& fields = (*stats)[message.first];
+    for (const auto& field : message.second) {
+      fields[field.first] = static_cast<float>(
+          static_cast<double>(field.second) / static_cast<double>(max_hits));
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
 bool CppGenerator::Generate(const FileDescriptor* file,
@@ -108,7 +154,67 @@ bool CppGenerator::Generate(const FileDescriptor* file,
   //
   // If the lite option is passed to the compiler, we will generate the
   // current files and all transitive dependencies using the LITE runtime.
+  //
+  // If the field_hit_stats option names a file written from
+  // TcParser::DumpFieldStats(), the fields parsed most often get the fast
+  // table entries of their messages when tags collide, and are laid out first.
+  // With split_field_hit_ratio=R, the fields of the profiled messages that are
+  // parsed less than R times as often as the most frequent field of their
+  // message are moved to a separately allocated split struct. For example:
+  //   TcParser::SetFieldStatsSamplingPeriod(100);  // In the profiled binary.
+  //   ... write TcParser::DumpFieldStats() to stats.txt ...
+  //   protoc --cpp_out=field_hit_stats=stats.txt,split_field_hit_ratio=0.01:out
+  //
+  // With inline_string_hit_ratio=R, the singular string fields of the
+  // profiled messages that are parsed at least R times as often as the most
+  // frequent field of their message are stored in the message, as
+  // InlinedStringField, instead of behind a pointer. On arenas, values which
+  // fit in the string's inline buffer are parsed without allocating and
+  // without registering a destructor for the message.
+  //
+  // If the expected_order_parse option lists messages, as colon-separated full
+  // names, their _InternalParse parses the scalar fields that lead the message
+  // in field number order with straight-line code, and leaves the rest of the
+  // input to the table-driven parser from the first tag that is not the next
+  // expected one. This is meant for very hot messages whose producers write
+  // fields in field number order, as protobuf serializers do. Only parses that
+  // start at the message go through _InternalParse: where the message is a
+  // submessage, or the element of a repeated field, the table-driven parser
+  // reads it directly and the inline prefix is not used.
+  //
+  // If the arena_only option lists messages, as colon-separated full names,
+  // they may only be created on an arena: constructing one on the heap fails a
+  // debug check. Their destructors do nothing, and their accessors and Clear()
+  // drop the branches that delete submessages owned on the heap.
+  //
+  // If the lazy_descriptor_registration option is passed, the file does not
+  // add its descriptors to the generated pool when the program starts.  It
+  // only links its descriptor table into a list, without locking or
+  // allocating, and is added when reflection is first used on one of its
+  // messages, when a file importing it is added, or on the next call to
+  // DescriptorPool::generated_pool(), so that lookups by name still find it.
+  // Programs which never use reflection never add it.
+  //
+  // If the span_accessors option is passed, repeated numeric and bool fields
+  // get accessors that view their elements as absl::Span, e.g. for a field
+  // `values`:
+  //   absl::Span<const double> values_span() const;
+  //   absl::Span<double> mutable_values_span();
+  //   absl::Span<double> resize_uninitialized_values(int size);
+  // resize_uninitialized_*() leaves new elements uninitialized, so that they
+  // can be filled in place without Add() calls or zeroing them first. The
+  // spans are invalidated by anything that changes the size of the field.
+  //
+  // If the layout_report option is passed, a <basename>.pb.layout file is
+  // written next to the generated code. It lists, one per line, the estimated
+  // sizeof, padding, has-bit words and split struct size of each message, and
+  // the offset and size of each of its fields. With field_hit_stats, fields
+  // are also marked as split_candidate or inline_candidate when the profile
+  // would split or inline them at split_field_hit_ratio and
+  // inline_string_hit_ratio (0.01 and 0.5 if not set). For example:
+  //   protoc --cpp_out=layout_report,field_hit_stats=stats.txt:out foo.proto
   Options file_options;
+  bool layout_report = false;
 
   file_options.opensource_runtime = opensource_runtime_;
   file_options.runtime_include_base = runtime_include_base_;
@@ -170,12 +276,59 @@ bool CppGenerator::Generate(const FileDescriptor* file,
       file_options.force_eagerly_verified_lazy = true;
     } else if (key == "experimental_strip_nonfunctional_codegen") {
       file_options.strip_nonfunctional_codegen = true;
+    } else if (key == "field_hit_stats") {
+      auto stats = std::make_shared<FieldHitStats>();
+      if (!ReadFieldHitStats(value, stats.get(), error)) return false;
+      file_options.field_hit_stats = std::move(stats);
+    } else if (key == "lazy_descriptor_registration") {
+      file_options.lazy_descriptor_registration = true;
+    } else if (key == "span_accessors") {
+      file_options.span_accessors = true;
+    } else if (key == "layout_report") {
+      layout_report = true;
+    } else if (key == "expected_order_parse") {
+      for (absl::string_view message : absl::StrSplit(value, ':')) {
+        file_options.expected_order_parse_messages.emplace(message);
+      }
+    } else if (key == "arena_only") {
+      for (absl::string_view message : absl::StrSplit(value, ':')) {
+        file_options.arena_only_messages.emplace(message);
+      }
+    } else if (key == "split_field_hit_ratio") {
+      if (!absl::SimpleAtof(value, &file_options.split_field_hit_ratio) ||
+          file_options.split_field_hit_ratio < 0 ||
+          file_options.split_field_hit_ratio > 1) {
+        *error = absl::StrCat(
+            "split_field_hit_ratio must be a number between 0 and 1, got: ",
+            value);
+        return false;
+      }
+    } else if (key == "inline_string_hit_ratio") {
+      if (!absl::SimpleAtof(value, &file_options.inline_string_hit_ratio) ||
+          file_options.inline_string_hit_ratio < 0 ||
+          file_options.inline_string_hit_ratio > 1) {
+        *error = absl::StrCat(
+            "inline_string_hit_ratio must be a number between 0 and 1, got: ",
+            value);
+        return false;
+      }
     } else {
       *error = absl::StrCat("Unknown generator option: ", key);
       return false;
     }
   }
 
+  if (file_options.split_field_hit_ratio > 0 &&
+      file_options.field_hit_stats == nullptr) {
+    *error = "The split_field_hit_ratio option requires field_hit_stats.";
+    return false;
+  }
+  if (file_options.inline_string_hit_ratio > 0 &&
+      file_options.field_hit_stats == nullptr) {
+    *error = "The inline_string_hit_ratio option requires field_hit_stats.";
+    return false;
+  }
+
   // The safe_boundary_check option controls behavior for Google-internal
   // protobuf APIs.
   if (file_options.safe_boundary_check && file_options.opensource_runtime) {
@@ -325,6 +478,13 @@ bool CppGenerator::Generate(const FileDescriptor* file,
     file_generator.GenerateSource(&p);
   }
 
+  if (layout_report) {
+    auto output = absl::WrapUnique(
+        generator_context->Open(absl::StrCat(basename, ".pb.layout")));
+    io::Printer p(output.get());
+    file_generator.GenerateLayoutReport(&p);
+  }
+
   return true;
 }
 
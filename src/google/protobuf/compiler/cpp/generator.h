@@ -76,6 +76,8 @@ class PROTOC_EXPORT CppGenerator : public CodeGenerator {
   Edition GetMinimumEdition() const override { return Edition::EDITION_PROTO2; }
   Edition GetMaximumEdition() const override { return Edition::EDITION_2023; }
 
+  bool SupportsConcurrentGeneration() const override { return true; }
+
   std::vector<const FieldDescriptor*> GetFeatureExtensions() const override {
     return {GetExtensionReflection(pb::cpp)};
   }
@@ -8,11 +8,15 @@
 #include "google/protobuf/compiler/cpp/generator.h"
 
 #include <memory>
+#include <string>
 
 #include "google/protobuf/descriptor.pb.h"
 #include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
 #include "google/protobuf/compiler/command_line_interface_tester.h"
 #include "google/protobuf/cpp_features.pb.h"
+#include "google/protobuf/generated_message_tctable_impl.h"
+#include "google/protobuf/testing/file.h"
 
 namespace google {
 namespace protobuf {
@@ -64,6 +68,468 @@ TEST_F(CppGeneratorTest, BasicError) {
       "foo.proto:4:7: Expected \"required\", \"optional\", or \"repeated\"");
 }
 
+TEST_F(CppGeneratorTest, FieldHitStats) {
+  CreateTempFile("foo.proto",
+                 R"schema(
+    syntax = "proto2";
+    message Foo {
+      optional int32 bar = 1;
+      optional int32 baz = 17;
+    })schema");
+  CreateTempFile("stats.txt", "Foo 17 1000\nFoo 1 3\nOther 1 5\n");
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=field_hit_stats=$tmpdir/stats.txt:$tmpdir foo.proto");
+  ExpectNoErrors();
+
+  std::string source;
+  ASSERT_TRUE(File::GetContents(absl::StrCat(temp_directory(), "/foo.pb.cc"),
+                                &source, true)
+                  .ok());
+  // Tags 1 and 17 share a fast-table slot. Without a profile the first field
+  // keeps it; the profile hands it to the hotter one, which has a 2-byte tag.
+  EXPECT_NE(source.find("FastV32S2"), std::string::npos);
+  EXPECT_EQ(source.find("FastV32S1"), std::string::npos);
+}
+
+TEST_F(CppGeneratorTest, FieldHitStatsFromDumpFieldStats) {
+#if !defined(PROTOBUF_TC_FIELD_STATS)
+  GTEST_SKIP() << "Field hit statistics are not collected in this build.";
+#endif  // !PROTOBUF_TC_FIELD_STATS
+  internal::TcParser::SetFieldStatsSamplingPeriod(1);
+  internal::TcParser::ResetFieldStats();
+  FileDescriptorProto file;
+  file.set_name("foo.proto");
+  file.set_package("foo");
+  file.add_message_type()->set_name("Foo");
+  FileDescriptorProto parsed;
+  ASSERT_TRUE(parsed.ParseFromString(file.SerializeAsString()));
+  const std::string dump = internal::TcParser::DumpFieldStats();
+  internal::TcParser::SetFieldStatsSamplingPeriod(64);
+  EXPECT_NE(dump.find("google.protobuf.FileDescriptorProto 4 1\n"),
+            std::string::npos);
+  CreateTempFile("stats.txt", dump);
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=layout_report,field_hit_stats=$tmpdir/stats.txt:$tmpdir "
+      "google/protobuf/descriptor.proto");
+  ExpectNoErrors();
+
+  std::string report;
+  ASSERT_TRUE(File::GetContents(
+                  absl::StrCat(temp_directory(),
+                               "/google/protobuf/descriptor.pb.layout"),
+                  &report, true)
+                  .ok());
+  const auto line = [&](const std::string& prefix) {
+    const size_t start = report.find(prefix);
+    if (start == std::string::npos) return std::string();
+    return report.substr(start, report.find('\n', start) - start);
+  };
+  EXPECT_NE(line("field google.protobuf.FileDescriptorProto 4 message_type ")
+                .find(" hit_ratio=1"),
+            std::string::npos);
+  EXPECT_NE(line("field google.protobuf.FileDescriptorProto 3 dependency ")
+                .find(" hit_ratio=0"),
+            std::string::npos);
+}
+
+TEST_F(CppGeneratorTest, FieldHitStatsPlaceHotFieldsFirst) {
+  CreateTempFile("foo.proto",
+                 R"schema(
+    syntax = "proto2";
+    message Foo {
+      optional int64 cold = 1;
+      repeated string warm = 2;
+      optional string unseen = 3;
+      optional int32 hot = 17;
+    })schema");
+  CreateTempFile("stats.txt", "Foo 17 1000\nFoo 2 10\nFoo 1 1\n");
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=field_hit_stats=$tmpdir/stats.txt:$tmpdir foo.proto");
+  ExpectNoErrors();
+
+  std::string header;
+  ASSERT_TRUE(File::GetContents(absl::StrCat(temp_directory(), "/foo.pb.h"),
+                                &header, true)
+                  .ok());
+  // Without a profile, repeated and string fields would come first.
+  const size_t hot = header.find(" hot_;");
+  const size_t warm = header.find(" warm_;");
+  const size_t cold = header.find(" cold_;");
+  const size_t unseen = header.find(" unseen_;");
+  ASSERT_NE(hot, std::string::npos);
+  ASSERT_NE(warm, std::string::npos);
+  ASSERT_NE(cold, std::string::npos);
+  ASSERT_NE(unseen, std::string::npos);
+  EXPECT_LT(hot, warm);
+  EXPECT_LT(warm, unseen);
+  EXPECT_LT(cold, unseen);
+}
+
+TEST_F(CppGeneratorTest, FieldHitStatsSplitColdFields) {
+  CreateTempFile("foo.proto",
+                 R"schema(
+    syntax = "proto2";
+    message Foo {
+      optional int32 hot = 1;
+      optional string cold = 2;
+      repeated int64 unseen = 3;
+    }
+    message Other {
+      optional int32 bar = 1;
+    })schema");
+  CreateTempFile("stats.txt", "Foo 1 1000\nFoo 2 1\n");
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=field_hit_stats=$tmpdir/stats.txt,"
+      "split_field_hit_ratio=0.01:$tmpdir foo.proto");
+  ExpectNoErrors();
+
+  std::string header;
+  ASSERT_TRUE(File::GetContents(absl::StrCat(temp_directory(), "/foo.pb.h"),
+                                &header, true)
+                  .ok());
+  // Only Foo is profiled, so only Foo has a split struct.
+  const size_t split = header.find("struct Split {");
+  ASSERT_NE(split, std::string::npos);
+  EXPECT_EQ(header.find("struct Split {", split + 1), std::string::npos);
+  const size_t split_end = header.find("};", split);
+  const size_t hot = header.find(" hot_;");
+  const size_t cold = header.find(" cold_;");
+  const size_t unseen = header.find(" unseen_;");
+  EXPECT_FALSE(hot > split && hot < split_end);
+  EXPECT_TRUE(cold > split && cold < split_end);
+  EXPECT_TRUE(unseen > split && unseen < split_end);
+}
+
+TEST_F(CppGeneratorTest, LayoutReport) {
+  CreateTempFile("foo.proto",
+                 R"schema(
+    syntax = "proto2";
+    message Foo {
+      optional bool flag = 1;
+      optional int64 id = 2;
+      optional string hot = 3;
+      optional string cold = 4;
+      oneof kind {
+        int32 number = 5;
+        string text = 6;
+      }
+    })schema");
+  CreateTempFile("stats.txt",
+                 "Foo 1 1000\nFoo 2 1000\nFoo 3 1000\nFoo 4 1\n");
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=layout_report,field_hit_stats=$tmpdir/stats.txt:$tmpdir "
+      "foo.proto");
+  ExpectNoErrors();
+
+  std::string report;
+  ASSERT_TRUE(
+      File::GetContents(absl::StrCat(temp_directory(), "/foo.pb.layout"),
+                        &report, true)
+          .ok());
+  EXPECT_NE(report.find("message Foo sizeof="), std::string::npos);
+  EXPECT_NE(report.find(" has_bit_words=1 split_sizeof=0\n"),
+            std::string::npos);
+  EXPECT_NE(report.find("field Foo 3 hot offset="), std::string::npos);
+  EXPECT_NE(report.find(" hit_ratio=1 inline_candidate\n"), std::string::npos);
+  EXPECT_NE(report.find(" hit_ratio=0.001 split_candidate\n"),
+            std::string::npos);
+  EXPECT_NE(report.find("field Foo 6 text offset="), std::string::npos);
+  EXPECT_NE(report.find(" size=8 oneof"), std::string::npos);
+}
+
+TEST_F(CppGeneratorTest, SplitFieldHitRatioRequiresFieldHitStats) {
+  CreateTempFile("foo.proto",
+                 R"schema(
+    syntax = "proto2";
+    message Foo {
+      optional int32 bar = 1;
+    })schema");
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=split_field_hit_ratio=0.01:$tmpdir foo.proto");
+
+  ExpectErrorSubstring("split_field_hit_ratio option requires field_hit_stats");
+}
+
+TEST_F(CppGeneratorTest, FieldHitStatsInlineHotStrings) {
+  CreateTempFile("foo.proto",
+                 R"schema(
+    syntax = "proto2";
+    message Foo {
+      optional string hot = 1;
+      optional string cold = 2;
+      repeated string list = 3;
+      optional string named = 4 [default = "x"];
+    }
+    message Other {
+      optional string bar = 1;
+    })schema");
+  CreateTempFile("stats.txt", "Foo 1 1000\nFoo 2 1\nFoo 3 1000\nFoo 4 1000\n");
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=field_hit_stats=$tmpdir/stats.txt,"
+      "inline_string_hit_ratio=0.5:$tmpdir foo.proto");
+  ExpectNoErrors();
+
+  std::string header;
+  ASSERT_TRUE(File::GetContents(absl::StrCat(temp_directory(), "/foo.pb.h"),
+                                &header, true)
+                  .ok());
+  // Only singular strings with empty defaults can be inlined, and Other is not
+  // profiled.
+  EXPECT_NE(header.find("InlinedStringField hot_;"), std::string::npos);
+  EXPECT_NE(header.find("ArenaStringPtr cold_;"), std::string::npos);
+  EXPECT_NE(header.find("ArenaStringPtr named_;"), std::string::npos);
+  EXPECT_NE(header.find("ArenaStringPtr bar_;"), std::string::npos);
+  EXPECT_EQ(header.find("InlinedStringField list_;"), std::string::npos);
+}
+
+TEST_F(CppGeneratorTest, InlineStringHitRatioRequiresFieldHitStats) {
+  CreateTempFile("foo.proto",
+                 R"schema(
+    syntax = "proto2";
+    message Foo {
+      optional string bar = 1;
+    })schema");
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=inline_string_hit_ratio=0.5:$tmpdir foo.proto");
+
+  ExpectErrorSubstring(
+      "inline_string_hit_ratio option requires field_hit_stats");
+}
+
+TEST_F(CppGeneratorTest, ImplicitWeakFieldsResolvePlaceholders) {
+  CreateTempFile("bar.proto",
+                 R"schema(
+    syntax = "proto2";
+    message Bar {
+      optional int32 x = 1;
+    })schema");
+  CreateTempFile("foo.proto",
+                 R"schema(
+    syntax = "proto2";
+    import "bar.proto";
+    message Foo {
+      optional Bar bar = 1;
+    })schema");
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=lite_implicit_weak_fields:$tmpdir foo.proto");
+  ExpectNoErrors();
+
+  std::string header;
+  std::string source;
+  ASSERT_TRUE(File::GetContents(absl::StrCat(temp_directory(), "/foo.pb.h"),
+                                &header, true)
+                  .ok());
+  // With lite_implicit_weak_fields, the message code goes to foo.out/.
+  ASSERT_TRUE(
+      File::GetContents(absl::StrCat(temp_directory(), "/foo.out/0.cc"),
+                        &source, true)
+          .ok());
+  EXPECT_NE(header.find("ImplicitWeakMessage::Resolve("), std::string::npos);
+  EXPECT_NE(header.find("ImplicitWeakMessage::ResolveMutable("),
+            std::string::npos);
+  EXPECT_NE(source.find("ImplicitWeakMessage::ResolveMutable("),
+            std::string::npos);
+}
+
+TEST_F(CppGeneratorTest, SpanAccessors) {
+  CreateTempFile("foo.proto",
+                 R"schema(
+    syntax = "proto3";
+    message Foo {
+      repeated double values = 1;
+      repeated string names = 2;
+    })schema");
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=span_accessors:$tmpdir foo.proto");
+  ExpectNoErrors();
+
+  std::string header;
+  ASSERT_TRUE(File::GetContents(absl::StrCat(temp_directory(), "/foo.pb.h"),
+                                &header, true)
+                  .ok());
+  EXPECT_NE(header.find("::absl::Span<const double> values_span() const"),
+            std::string::npos);
+  EXPECT_NE(header.find("::absl::Span<double> mutable_values_span()"),
+            std::string::npos);
+  EXPECT_NE(header.find("resize_uninitialized_values("), std::string::npos);
+  EXPECT_EQ(header.find("names_span"), std::string::npos);
+}
+
+TEST_F(CppGeneratorTest, ArenaOnly) {
+  CreateTempFile("foo.proto",
+                 R"schema(
+    syntax = "proto2";
+    package pkg;
+    message Foo {
+      optional Foo child = 1;
+      oneof kind {
+        Foo other = 2;
+      }
+    })schema");
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=arena_only=pkg.Foo:$tmpdir foo.proto");
+  ExpectNoErrors();
+
+  std::string header;
+  std::string source;
+  ASSERT_TRUE(File::GetContents(absl::StrCat(temp_directory(), "/foo.pb.h"),
+                                &header, true)
+                  .ok());
+  ASSERT_TRUE(File::GetContents(absl::StrCat(temp_directory(), "/foo.pb.cc"),
+                                &source, true)
+                  .ok());
+  EXPECT_EQ(header.find("GetArena() == nullptr"), std::string::npos);
+  EXPECT_EQ(source.find("GetArena() == nullptr"), std::string::npos);
+  EXPECT_EQ(source.find("SharedDtor();"), std::string::npos);
+  EXPECT_NE(source.find("pkg.Foo may only be created on an arena"),
+            std::string::npos);
+}
+
+TEST_F(CppGeneratorTest, HasWordChecks) {
+  std::string fields;
+  for (int i = 1; i <= 130; ++i) {
+    absl::StrAppend(&fields, "optional int32 f", i, " = ", i, ";\n");
+  }
+  CreateTempFile("foo.proto",
+                 absl::StrCat(R"schema(
+    syntax = "proto2";
+    message Sparse {)schema",
+                              fields, R"schema(
+    }
+    message Dense {
+      optional int32 a = 1;
+      optional int32 b = 2;
+      optional int32 c = 3;
+      optional int32 d = 4;
+      optional int32 e = 5;
+      optional int32 f = 6;
+      optional int32 g = 7;
+      optional int32 h = 8;
+    })schema"));
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir --cpp_out=$tmpdir foo.proto");
+  ExpectNoErrors();
+
+  std::string source;
+  ASSERT_TRUE(File::GetContents(absl::StrCat(temp_directory(), "/foo.pb.cc"),
+                                &source, true)
+                  .ok());
+  // Sparse sizes only its set fields; Dense serializes nothing when its has-bit
+  // word is clear.
+  EXPECT_NE(source.find("::absl::countr_zero(bits)"), std::string::npos);
+  EXPECT_NE(source.find("if ((cached_has_bits & 0x000000ffu) != 0) {"),
+            std::string::npos);
+}
+
+TEST_F(CppGeneratorTest, ExpectedOrderParse) {
+  CreateTempFile("foo.proto",
+                 R"schema(
+    syntax = "proto2";
+    message Foo {
+      optional int32 first = 1;
+      optional fixed64 second = 2;
+      optional string third = 3;
+      optional int32 fourth = 4;
+    }
+    message Other {
+      optional int32 bar = 1;
+    })schema");
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=expected_order_parse=Foo:$tmpdir foo.proto");
+  ExpectNoErrors();
+
+  std::string source;
+  ASSERT_TRUE(File::GetContents(absl::StrCat(temp_directory(), "/foo.pb.cc"),
+                                &source, true)
+                  .ok());
+  // Foo's fields are parsed inline up to the string field.
+  const size_t foo = source.find("Foo::_InternalParse(");
+  const size_t other = source.find("Other::_InternalParse(");
+  ASSERT_NE(foo, std::string::npos);
+  ASSERT_NE(other, std::string::npos);
+  const size_t first = source.find("(*ptr) == 8)", foo);
+  const size_t second = source.find("(*ptr) == 17)", foo);
+  const size_t fourth = source.find("(*ptr) == 32)", foo);
+  EXPECT_LT(first, second);
+  EXPECT_LT(second, source.find("TcParser::ParseLoop", foo));
+  EXPECT_EQ(fourth, std::string::npos);
+  // Other did not opt in.
+  EXPECT_EQ(source.find("(*ptr) == 8)", other), std::string::npos);
+}
+
+TEST_F(CppGeneratorTest, LazyDescriptorRegistration) {
+  CreateTempFile("foo.proto",
+                 R"schema(
+    syntax = "proto2";
+    message Foo {
+      optional string bar = 1 [default = "bar"];
+    })schema");
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir --cpp_out=$tmpdir foo.proto");
+  ExpectNoErrors();
+  std::string source;
+  ASSERT_TRUE(File::GetContents(absl::StrCat(temp_directory(), "/foo.pb.cc"),
+                                &source, true)
+                  .ok());
+  EXPECT_NE(source.find("::_pbi::AddDescriptorsRunner"), std::string::npos);
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=lazy_descriptor_registration:$tmpdir foo.proto");
+  ExpectNoErrors();
+  std::string lazy_source;
+  ASSERT_TRUE(File::GetContents(absl::StrCat(temp_directory(), "/foo.pb.cc"),
+                                &lazy_source, true)
+                  .ok());
+  EXPECT_EQ(lazy_source.find("::_pbi::AddDescriptorsRunner"),
+            std::string::npos);
+  EXPECT_NE(lazy_source.find("::_pbi::LazyAddDescriptorsRunner"),
+            std::string::npos);
+}
+
+TEST_F(CppGeneratorTest, FieldHitStatsMalformed) {
+  CreateTempFile("foo.proto",
+                 R"schema(
+    syntax = "proto2";
+    message Foo {
+      optional int32 bar = 1;
+    })schema");
+  CreateTempFile("stats.txt", "Foo 1 1000\nFoo bar\n");
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=field_hit_stats=$tmpdir/stats.txt:$tmpdir foo.proto");
+
+  ExpectErrorSubstring(
+      "stats.txt:2: expected \"<message> <field number> <hits>\"");
+}
+
 TEST_F(CppGeneratorTest, LegacyClosedEnumOnNonEnumField) {
   CreateTempFile("foo.proto",
                  R"schema(
@@ -914,11 +914,17 @@ bool IsLikelyPresent(const FieldDescriptor* field, const Options& options) {
 
 float GetPresenceProbability(const FieldDescriptor* field,
                              const Options& options) {
-  return 1.f;
+  if (options.field_hit_stats == nullptr) return 1.f;
+  auto message = options.field_hit_stats->find(
+      field->containing_type()->full_name());
+  if (message == options.field_hit_stats->end()) return 1.f;
+  auto hits = message->second.find(field->number());
+  return hits == message->second.end() ? 0.f : hits->second;
 }
 
 bool IsStringInliningEnabled(const Options& options) {
-  return options.force_inline_string || IsProfileDriven(options);
+  return options.force_inline_string || IsProfileDriven(options) ||
+         options.inline_string_hit_ratio > 0;
 }
 
 bool CanStringBeInlined(const FieldDescriptor* field) {
@@ -939,9 +945,18 @@ bool CanStringBeInlined(const FieldDescriptor* field) {
 }
 
 bool IsStringInlined(const FieldDescriptor* field, const Options& options) {
-  (void)field;
-  (void)options;
-  return false;
+  if (options.bootstrap || options.field_hit_stats == nullptr ||
+      options.inline_string_hit_ratio <= 0 || !CanStringBeInlined(field) ||
+      ShouldSplit(field, options)) {
+    return false;
+  }
+  // Fields of messages without a profile are not known to be set often.
+  if (!options.field_hit_stats->contains(
+          field->containing_type()->full_name())) {
+    return false;
+  }
+  return GetPresenceProbability(field, options) >=
+         options.inline_string_hit_ratio;
 }
 
 static bool HasLazyFields(const Descriptor* descriptor, const Options& options,
@@ -1007,8 +1022,43 @@ VerifySimpleType ShouldVerifySimple(const Descriptor* descriptor) {
   return VerifySimpleType::kCustom;
 }
 
-bool ShouldSplit(const Descriptor*, const Options&) { return false; }
-bool ShouldSplit(const FieldDescriptor*, const Options&) { return false; }
+// Returns true if `field` is hit rarely enough in the profile to be moved to
+// the split struct, and can be.
+static bool IsColdSplittableField(const FieldDescriptor* field,
+                                  const Options& options) {
+  if (field->is_extension() || field->real_containing_oneof() != nullptr ||
+      field->is_map() || field->options().weak() || field->options().lazy() ||
+      field->options().unverified_lazy()) {
+    return false;
+  }
+  return GetPresenceProbability(field, options) <
+         options.split_field_hit_ratio;
+}
+
+bool ShouldSplit(const Descriptor* desc, const Options& options) {
+  if (options.bootstrap || options.field_hit_stats == nullptr ||
+      options.split_field_hit_ratio <= 0 || desc->options().map_entry()) {
+    return false;
+  }
+  for (int i = 0; i < desc->field_count(); ++i) {
+    if (IsColdSplittableField(desc->field(i), options)) return true;
+  }
+  return false;
+}
+
+bool ShouldSplit(const FieldDescriptor* field, const Options& options) {
+  return ShouldSplit(field->containing_type(), options) &&
+         IsColdSplittableField(field, options);
+}
+
+bool UseSpanAccessors(const FieldDescriptor* field, const Options& options) {
+  return options.span_accessors && !IsBootstrapProto(options, field->file());
+}
+
+bool IsArenaOnly(const Descriptor* desc, const Options& options) {
+  return !options.bootstrap &&
+         options.arena_only_messages.contains(desc->full_name());
+}
 
 bool ShouldForceAllocationOnConstruction(const Descriptor* desc,
                                          const Options& options) {
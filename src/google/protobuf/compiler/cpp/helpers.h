@@ -358,7 +358,9 @@ bool IsStringInliningEnabled(const Options& options);
 // Returns true if the provided field is a singular string and can be inlined.
 bool CanStringBeInlined(const FieldDescriptor* field);
 
-// Returns true if `field` should be inlined based on PDProto profile.
+// Returns true if `field` should be inlined, because it is set at least
+// `Options::inline_string_hit_ratio` times as often as the most frequent field
+// of its message in `Options::field_hit_stats`.
 bool IsStringInlined(const FieldDescriptor* field, const Options& options);
 
 // Does the given FileDescriptor use lazy fields?
@@ -406,12 +408,22 @@ enum class VerifySimpleType {
 VerifySimpleType ShouldVerifySimple(const Descriptor* descriptor);
 
 
-// Is the given message being split (go/pdsplit)?
+// Is the given message being split (go/pdsplit)? Messages are split when
+// `Options::split_field_hit_ratio` is set and some of their fields are hit
+// less often than that in `Options::field_hit_stats`.
 bool ShouldSplit(const Descriptor* desc, const Options& options);
 
 // Is the given field being split out?
 bool ShouldSplit(const FieldDescriptor* field, const Options& options);
 
+// Does the given repeated scalar field get span accessors, as requested by the
+// span_accessors option?
+bool UseSpanAccessors(const FieldDescriptor* field, const Options& options);
+
+// Is the given message listed in the arena_only option? Such messages are
+// only ever created on an arena, so their generated code never frees fields.
+bool IsArenaOnly(const Descriptor* desc, const Options& options);
+
 // Should we generate code that force creating an allocation in the constructor
 // of the given message?
 bool ShouldForceAllocationOnConstruction(const Descriptor* desc,
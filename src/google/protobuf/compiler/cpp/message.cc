@@ -39,9 +39,11 @@
 #include "google/protobuf/compiler/cpp/names.h"
 #include "google/protobuf/compiler/cpp/padding_optimizer.h"
 #include "google/protobuf/compiler/cpp/parse_function_generator.h"
+#include "google/protobuf/compiler/cpp/profile_guided_optimizer.h"
 #include "google/protobuf/compiler/cpp/tracker.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/extension_set.h"
 #include "google/protobuf/io/printer.h"
 #include "google/protobuf/wire_format.h"
 #include "google/protobuf/wire_format_lite.h"
@@ -508,7 +510,11 @@ MessageGenerator::MessageGenerator(
       scc_analyzer_(scc_analyzer) {
 
   if (!message_layout_helper_) {
-    message_layout_helper_ = std::make_unique<PaddingOptimizer>();
+    if (options_.field_hit_stats != nullptr) {
+      message_layout_helper_ = std::make_unique<ProfileGuidedOptimizer>();
+    } else {
+      message_layout_helper_ = std::make_unique<PaddingOptimizer>();
+    }
   }
 
   // Compute optimized field order to be used for layout and initialization
@@ -2494,8 +2500,17 @@ void MessageGenerator::GenerateInitDefaultSplitInstance(io::Printer* p) {
   }
 }
 
+void MessageGenerator::GenerateArenaOnlyCheck(io::Printer* p) {
+  if (!IsArenaOnly(descriptor_, options_)) return;
+  p->Emit(R"cc(
+    $DCHK$(arena != nullptr) << "$full_name$ may only be created on an arena";
+  )cc");
+}
+
 void MessageGenerator::GenerateSharedDestructorCode(io::Printer* p) {
   if (HasSimpleBaseClass(descriptor_, options_)) return;
+  // Arena-only messages have nothing to destroy.
+  if (IsArenaOnly(descriptor_, options_)) return;
   auto emit_field_dtors = [&](bool split_fields) {
     // Write the destructors for each field except oneof members.
     // optimized_order_ does not contain oneof fields.
@@ -3091,7 +3106,8 @@ void MessageGenerator::GenerateArenaEnabledCopyConstructor(io::Printer* p) {
     }
   };
 
-  p->Emit({{"copy_construct_impl", copy_construct_impl},
+  p->Emit({{"check_arena", [&] { GenerateArenaOnlyCheck(p); }},
+           {"copy_construct_impl", copy_construct_impl},
            {"copy_init_fields", [&] { GenerateCopyInitFields(p); }},
            {"force_allocation", force_allocation},
            {"maybe_register_arena_dtor", maybe_register_arena_dtor}},
@@ -3102,6 +3118,7 @@ void MessageGenerator::GenerateArenaEnabledCopyConstructor(io::Printer* p) {
                 //~ force alignment
                 const $classname$& from)
                 : $superclass$(arena) {
+              $check_arena$;
               $classname$* const _this = this;
               (void)_this;
               _internal_metadata_.MergeFrom<$unknown_fields_type$>(
@@ -3122,6 +3139,7 @@ void MessageGenerator::GenerateStructors(io::Printer* p) {
           {"superclass", SuperClassName(descriptor_, options_)},
           {"ctor_body",
            [&] {
+             GenerateArenaOnlyCheck(p);
              if (HasSimpleBaseClass(descriptor_, options_)) return;
              p->Emit(R"cc(SharedCtor(arena);)cc");
              if (NeedsArenaDestructor() == ArenaDtorNeeds::kRequired) {
@@ -3178,6 +3196,15 @@ void MessageGenerator::GenerateStructors(io::Printer* p) {
     // message with a simple base class.  This works only as long as
     // we have no fields needing destruction, of course.  (No strings
     // or extensions)
+  } else if (IsArenaOnly(descriptor_, options_)) {
+    // Arena-only messages are never destroyed: the arena frees their fields
+    // and unknown fields along with them.
+    p->Emit(
+        R"cc(
+          $classname$::~$classname$() {
+            // @@protoc_insertion_point(destructor:$full_name$)
+          }
+        )cc");
   } else {
     p->Emit(
         R"cc(
@@ -3236,6 +3263,10 @@ void MessageGenerator::GenerateClear(io::Printer* p) {
   // The maximum number of bytes we will memset to zero without checking their
   // hasbit to see if a zero-init is necessary.
   const int kMaxUnconditionalPrimitiveBytesClear = 4;
+  // Runs of zero-initializable fields laid out together are cleared with one
+  // unconditional memset if they take at most this many bytes: that is
+  // cheaper than testing their has-bits, even when few of them are set.
+  const int kMaxUnconditionalRunBytesClear = 128;
 
   format(
       "PROTOBUF_NOINLINE void $classname$::Clear() {\n"
@@ -3255,10 +3286,36 @@ void MessageGenerator::GenerateClear(io::Printer* p) {
     format("$extensions$.Clear();\n");
   }
 
+  // Clear small runs of zero-initializable fields up front, and leave the
+  // remaining fields to the chunks below.
+  std::vector<const FieldDescriptor*> chunked_fields;
+  for (auto it = optimized_order_.begin(); it != optimized_order_.end();) {
+    auto run_end = it;
+    int run_bytes = 0;
+    while (run_end != optimized_order_.end() && CanClearByZeroing(*run_end) &&
+           !ShouldSplit(*run_end, options_)) {
+      run_bytes += EstimateAlignmentSize(*run_end);
+      ++run_end;
+    }
+    if (run_end - it >= 2 && run_bytes <= kMaxUnconditionalRunBytesClear) {
+      format(
+          "::memset(&$1$, 0, static_cast<::size_t>(\n"
+          "    reinterpret_cast<char*>(&$2$) -\n"
+          "    reinterpret_cast<char*>(&$1$)) + sizeof($2$));\n",
+          FieldMemberName(*it, false), FieldMemberName(*(run_end - 1), false));
+      it = run_end;
+    } else if (run_end != it) {
+      chunked_fields.insert(chunked_fields.end(), it, run_end);
+      it = run_end;
+    } else {
+      chunked_fields.push_back(*it++);
+    }
+  }
+
   // Collect fields into chunks. Each chunk may have an if() condition that
   // checks all hasbits in the chunk and skips it if none are set.
   int zero_init_bytes = 0;
-  for (const auto& field : optimized_order_) {
+  for (const auto& field : chunked_fields) {
     if (CanClearByZeroing(field)) {
       zero_init_bytes += EstimateAlignmentSize(field);
     }
@@ -3267,7 +3324,7 @@ void MessageGenerator::GenerateClear(io::Printer* p) {
   int chunk_count = 0;
 
   std::vector<FieldChunk> chunks = CollectFields(
-      optimized_order_, options_,
+      chunked_fields, options_,
       [&](const FieldDescriptor* a, const FieldDescriptor* b) -> bool {
         chunk_count++;
         // This predicate guarantees that there is only a single zero-init
@@ -4120,6 +4177,19 @@ void MessageGenerator::GenerateSerializeWithCachedSizesBody(io::Printer* p) {
       }
     }
 
+    // Loads _has_bits_[index] into cached_has_bits ahead of a run of fields
+    // that are checked against it.
+    void LoadHasWord(int index) {
+      Flush();
+      if (cached_has_bit_index_ != index) {
+        p_->Emit({{"index", index}},
+                 R"cc(
+                   cached_has_bits = _impl_._has_bits_[$index$];
+                 )cc");
+        cached_has_bit_index_ = index;
+      }
+    }
+
    private:
     // If we have multiple fields in v_ then they all must be from the same
     // oneof.  Would adding field to v_ break that invariant?
@@ -4217,6 +4287,27 @@ void MessageGenerator::GenerateSerializeWithCachedSizesBody(io::Printer* p) {
              LazySerializerEmitter e(this, p);
              LazyExtensionRangeEmitter re(this, p);
              LargestWeakFieldHolder largest_weak_field;
+             constexpr int kMinFieldsForHasWordCheck = 8;
+             // Runs of fields whose has-bits share a word are skipped as a
+             // whole when none of them is set.  Weak fields are written by a
+             // FieldWriter that must see every field, so they opt out.
+             const bool group_words = num_weak_fields_ == 0;
+             auto has_word = [&](const FieldDescriptor* field) {
+               if (!HasHasbit(field) || !field->has_presence()) return -1;
+               return has_bit_indices_[field->index()] / 32;
+             };
+             // Index one past the end of the has-bit run that begins at
+             // `begin`, stopping short of the next extension range.
+             auto word_run_end = [&](int begin, int limit) {
+               int word = has_word(ordered_fields[begin]);
+               int end = begin;
+               while (end < ordered_fields.size() &&
+                      ordered_fields[end]->number() < limit &&
+                      has_word(ordered_fields[end]) == word) {
+                 ++end;
+               }
+               return end;
+             };
              int i, j;
              for (i = 0, j = 0;
                   i < ordered_fields.size() || j < sorted_extensions.size();) {
@@ -4224,8 +4315,36 @@ void MessageGenerator::GenerateSerializeWithCachedSizesBody(io::Printer* p) {
                    (i < descriptor_->field_count() &&
                     ordered_fields[i]->number() <
                         sorted_extensions[j]->start_number())) {
-                 const FieldDescriptor* field = ordered_fields[i++];
                  re.Flush();
+                 int word = has_word(ordered_fields[i]);
+                 if (group_words && word >= 0) {
+                   int limit = j == sorted_extensions.size()
+                                   ? std::numeric_limits<int>::max()
+                                   : sorted_extensions[j]->start_number();
+                   int end = word_run_end(i, limit);
+                   if (end - i >= kMinFieldsForHasWordCheck) {
+                     uint32_t mask = 0;
+                     for (int k = i; k < end; ++k) {
+                       int index = has_bit_indices_[ordered_fields[k]->index()];
+                       mask |= uint32_t{1} << (index % 32);
+                     }
+                     e.LoadHasWord(word);
+                     p->Emit(
+                         {{"mask", absl::StrCat(
+                                       absl::Hex(mask, absl::kZeroPad8))},
+                          {"fields",
+                           [&] {
+                             for (; i < end; ++i) e.Emit(ordered_fields[i]);
+                           }}},
+                         R"cc(
+                           if ((cached_has_bits & 0x$mask$u) != 0) {
+                             $fields$;
+                           }
+                         )cc");
+                     continue;
+                   }
+                 }
+                 const FieldDescriptor* field = ordered_fields[i++];
                  if (field->options().weak()) {
                    largest_weak_field.ReplaceIfLarger(field);
                    PrintFieldComment(Formatter{p}, field, options_);
@@ -4382,6 +4501,50 @@ std::vector<uint32_t> MessageGenerator::RequiredFieldsBitMask() const {
   return masks;
 }
 
+bool MessageGenerator::UseSparseByteSize() const {
+  // Below this many has-bit words, checking chunks of fields is cheaper than
+  // dispatching on each set has-bit.
+  constexpr size_t kMinHasWordsForSparseByteSize = 4;
+  return HasBitsSize() >= kMinHasWordsForSparseByteSize &&
+         !IsProfileDriven(options_);
+}
+
+void MessageGenerator::GenerateSparseByteSize(io::Printer* p) {
+  p->Emit(
+      {{"num_words", HasBitsSize()},
+       {"cases",
+        [&] {
+          for (const auto* field : optimized_order_) {
+            if (!HasHasbit(field)) continue;
+            auto comment = [&] {
+              PrintFieldComment(Formatter{p}, field, options_);
+            };
+            auto byte_size = [&] {
+              field_generators_.get(field).GenerateByteSize(p);
+            };
+            p->Emit({{"has_bit_index", HasBitIndex(field)},
+                     {"comment", comment},
+                     {"byte_size", byte_size}},
+                    R"cc(
+                      case $has_bit_index$: {
+                        $comment$;
+                        $byte_size$;
+                        break;
+                      }
+                    )cc");
+          }
+        }}},
+      R"cc(
+        for (int i = 0; i < $num_words$; ++i) {
+          for ($uint32$ bits = $has_bits$[i]; bits != 0; bits &= bits - 1) {
+            switch (i * 32 + ::absl::countr_zero(bits)) {
+              $cases$;
+            }
+          }
+        }
+      )cc");
+}
+
 void MessageGenerator::GenerateByteSize(io::Printer* p) {
   if (HasSimpleBaseClass(descriptor_, options_)) return;
 
@@ -4419,22 +4582,39 @@ void MessageGenerator::GenerateByteSize(io::Printer* p) {
         "\n");
   }
 
+  format(
+      "$uint32$ cached_has_bits = 0;\n"
+      "// Prevent compiler warnings about cached_has_bits being unused\n"
+      "(void) cached_has_bits;\n\n");
+
+  // The fields of very large messages are counted by visiting the set
+  // has-bits only, since such messages are usually sparse. The remaining
+  // fields, without has-bits, are counted in chunks below.
+  std::vector<const FieldDescriptor*> chunked_fields;
+  if (UseSparseByteSize()) {
+    GenerateSparseByteSize(p);
+    for (const auto* field : optimized_order_) {
+      if (!HasHasbit(field)) chunked_fields.push_back(field);
+    }
+  } else {
+    chunked_fields = optimized_order_;
+  }
+
   std::vector<FieldChunk> chunks = CollectFields(
-      optimized_order_, options_,
+      chunked_fields, options_,
       [&](const FieldDescriptor* a, const FieldDescriptor* b) -> bool {
         return a->label() == b->label() && HasByteIndex(a) == HasByteIndex(b) &&
                IsLikelyPresent(a, options_) == IsLikelyPresent(b, options_) &&
                ShouldSplit(a, options_) == ShouldSplit(b, options_);
       });
 
-  auto it = chunks.begin();
-  auto end = chunks.end();
+  ChunkIterator it = chunks.begin();
+  ChunkIterator end = chunks.end();
   int cached_has_word_index = -1;
 
-  format(
-      "$uint32$ cached_has_bits = 0;\n"
-      "// Prevent compiler warnings about cached_has_bits being unused\n"
-      "(void) cached_has_bits;\n\n");
+  auto is_same_hasword = [&](const FieldChunk& a, const FieldChunk& b) {
+    return HasWordIndex(a.fields.front()) == HasWordIndex(b.fields.front());
+  };
 
   while (it != end) {
     auto next = FindNextUnequalChunk(it, end, MayGroupChunksForHaswordsCheck);
@@ -4442,68 +4622,95 @@ void MessageGenerator::GenerateByteSize(io::Printer* p) {
         it, next, options_, has_bit_indices_, cached_has_word_index, "", p);
 
     while (it != next) {
-      const std::vector<const FieldDescriptor*>& fields = it->fields;
-      const bool check_has_byte = fields.size() > 1 &&
-                                  HasWordIndex(fields[0]) != kNoHasbit &&
-                                  !IsLikelyPresent(fields.back(), options_);
-
-      if (check_has_byte) {
-        // Emit an if() that will let us skip the whole chunk if none are set.
-        uint32_t chunk_mask = GenChunkMask(fields, has_bit_indices_);
-        std::string chunk_mask_str =
-            absl::StrCat(absl::Hex(chunk_mask, absl::kZeroPad8));
-
-        // Check (up to) 8 has_bits at a time if we have more than one field in
-        // this chunk.  Due to field layout ordering, we may check
-        // _has_bits_[last_chunk * 8 / 32] multiple times.
-        ABSL_DCHECK_LE(2, popcnt(chunk_mask));
-        ABSL_DCHECK_GE(8, popcnt(chunk_mask));
-
-        if (cached_has_word_index != HasWordIndex(fields.front())) {
-          cached_has_word_index = HasWordIndex(fields.front());
+      // Emit an if() that will let us skip all the chunks of a has-bit word
+      // with one check if none of their fields are set.
+      auto word_end = std::next(it);
+      bool check_has_word = false;
+      if (!has_haswords_check && it->has_hasbit) {
+        word_end = FindNextUnequalChunk(it, next, is_same_hasword);
+        check_has_word = std::distance(it, word_end) > 1;
+      }
+      if (check_has_word) {
+        if (cached_has_word_index != HasWordIndex(it->fields.front())) {
+          cached_has_word_index = HasWordIndex(it->fields.front());
           format("cached_has_bits = $has_bits$[$1$];\n", cached_has_word_index);
         }
-        format("if (cached_has_bits & 0x$1$u) {\n", chunk_mask_str);
+        format("if (cached_has_bits & 0x$1$u) {\n",
+               absl::StrCat(
+                   absl::Hex(GenChunkMask(it, word_end, has_bit_indices_),
+                             absl::kZeroPad8)));
         format.Indent();
       }
 
-      // Go back and emit checks for each of the fields we processed.
-      for (const auto* field : fields) {
-        bool have_enclosing_if = false;
+      for (; it != word_end; ++it) {
+        const std::vector<const FieldDescriptor*>& fields = it->fields;
+        const bool check_has_byte = fields.size() > 1 &&
+                                    HasWordIndex(fields[0]) != kNoHasbit &&
+                                    !IsLikelyPresent(fields.back(), options_);
+
+        if (check_has_byte) {
+          // Emit an if() that will let us skip the whole chunk if none are
+          // set.
+          uint32_t chunk_mask = GenChunkMask(fields, has_bit_indices_);
+          std::string chunk_mask_str =
+              absl::StrCat(absl::Hex(chunk_mask, absl::kZeroPad8));
+
+          // Check (up to) 8 has_bits at a time if we have more than one field
+          // in this chunk.  Due to field layout ordering, we may check
+          // _has_bits_[last_chunk * 8 / 32] multiple times.
+          ABSL_DCHECK_LE(2, popcnt(chunk_mask));
+          ABSL_DCHECK_GE(8, popcnt(chunk_mask));
+
+          if (cached_has_word_index != HasWordIndex(fields.front())) {
+            cached_has_word_index = HasWordIndex(fields.front());
+            format("cached_has_bits = $has_bits$[$1$];\n",
+                   cached_has_word_index);
+          }
+          format("if (cached_has_bits & 0x$1$u) {\n", chunk_mask_str);
+          format.Indent();
+        }
 
-        PrintFieldComment(format, field, options_);
+        // Go back and emit checks for each of the fields we processed.
+        for (const auto* field : fields) {
+          bool have_enclosing_if = false;
 
-        if (field->is_repeated()) {
-          // No presence check is required.
-        } else if (HasHasbit(field)) {
-          PrintPresenceCheck(field, has_bit_indices_, p,
-                             &cached_has_word_index);
-          have_enclosing_if = true;
-        } else {
-          // Without field presence: field is serialized only if it has a
-          // non-default value.
-          have_enclosing_if = EmitFieldNonDefaultCondition(p, "this->", field);
-        }
+          PrintFieldComment(format, field, options_);
 
-        if (have_enclosing_if) format.Indent();
+          if (field->is_repeated()) {
+            // No presence check is required.
+          } else if (HasHasbit(field)) {
+            PrintPresenceCheck(field, has_bit_indices_, p,
+                               &cached_has_word_index);
+            have_enclosing_if = true;
+          } else {
+            // Without field presence: field is serialized only if it has a
+            // non-default value.
+            have_enclosing_if =
+                EmitFieldNonDefaultCondition(p, "this->", field);
+          }
 
-        field_generators_.get(field).GenerateByteSize(p);
+          if (have_enclosing_if) format.Indent();
 
-        if (have_enclosing_if) {
+          field_generators_.get(field).GenerateByteSize(p);
+
+          if (have_enclosing_if) {
+            format.Outdent();
+            format(
+                "}\n"
+                "\n");
+          }
+        }
+
+        if (check_has_byte) {
           format.Outdent();
-          format(
-              "}\n"
-              "\n");
+          format("}\n");
         }
       }
 
-      if (check_has_byte) {
+      if (check_has_word) {
         format.Outdent();
         format("}\n");
       }
-
-      // To next chunk.
-      ++it;
     }
 
     if (has_haswords_check) {
@@ -4668,6 +4875,148 @@ void MessageGenerator::GenerateIsInitialized(io::Printer* p) {
       )cc");
 }
 
+namespace {
+
+// Lays out struct members in order, as compilers do, to estimate the size and
+// padding of generated classes.
+class LayoutEstimate {
+ public:
+  // Adds a member and returns its offset.
+  size_t Add(size_t size, size_t alignment) {
+    size_t offset = (size_ + alignment - 1) / alignment * alignment;
+    padding_ += offset - size_;
+    size_ = offset + size;
+    alignment_ = std::max(alignment_, alignment);
+    return offset;
+  }
+
+  // Adds the tail padding and returns the size of the struct.
+  size_t Finish() {
+    Add(0, alignment_);
+    return size_;
+  }
+
+  size_t padding() const { return padding_; }
+
+ private:
+  size_t size_ = 0;
+  size_t padding_ = 0;
+  size_t alignment_ = 1;
+};
+
+size_t EstimateMemberSize(const FieldDescriptor* field,
+                          const Options& options) {
+  if (IsStringInlined(field, options)) return sizeof(std::string);
+  return EstimateSize(field);
+}
+
+}  // namespace
+
+void MessageGenerator::GenerateLayoutReport(io::Printer* p) const {
+  if (descriptor_->options().map_entry()) return;
+
+  // The options that the profile would need for a field to be split or
+  // inlined, when the options in use do not already ask for it.
+  Options candidate_options = options_;
+  if (candidate_options.split_field_hit_ratio <= 0) {
+    candidate_options.split_field_hit_ratio = 0.01f;
+  }
+  if (candidate_options.inline_string_hit_ratio <= 0) {
+    candidate_options.inline_string_hit_ratio = 0.5f;
+  }
+  const bool profiled =
+      options_.field_hit_stats != nullptr &&
+      options_.field_hit_stats->contains(descriptor_->full_name());
+
+  // Same member order as GenerateClassDefinition(): the MessageLite vtable
+  // pointer and metadata, then Impl_.
+  LayoutEstimate layout;
+  layout.Add(2 * sizeof(void*), alignof(void*));
+  if (descriptor_->extension_range_count() > 0) {
+    layout.Add(sizeof(internal::ExtensionSet), alignof(internal::ExtensionSet));
+  }
+  if (!inlined_string_indices_.empty()) {
+    layout.Add(InlinedStringDonatedSize() * 4, 4);
+  }
+  const bool has_cached_size = !HasSimpleBaseClass(descriptor_, options_);
+  if (!has_bit_indices_.empty()) {
+    layout.Add(HasBitsSize() * 4, 4);
+    if (has_cached_size) layout.Add(4, 4);
+  }
+
+  struct FieldLayout {
+    const FieldDescriptor* field;
+    size_t offset;
+    size_t size;
+  };
+  std::vector<FieldLayout> fields;
+  LayoutEstimate split_layout;
+  for (const FieldDescriptor* field : optimized_order_) {
+    size_t size = EstimateMemberSize(field, options_);
+    size_t alignment = EstimateAlignmentSize(field);
+    LayoutEstimate& target =
+        ShouldSplit(field, options_) ? split_layout : layout;
+    fields.push_back({field, target.Add(size, alignment), size});
+  }
+  size_t split_size = 0;
+  if (ShouldSplit(descriptor_, options_)) {
+    split_size = split_layout.Finish();
+    layout.Add(sizeof(void*), alignof(void*));
+  }
+  for (const OneofDescriptor* oneof : OneOfRange(descriptor_)) {
+    size_t size = 1;
+    size_t alignment = 1;
+    for (const FieldDescriptor* field : FieldRange(oneof)) {
+      size = std::max(size, static_cast<size_t>(EstimateSize(field)));
+      alignment = std::max(alignment,
+                           static_cast<size_t>(EstimateAlignmentSize(field)));
+    }
+    size_t offset = layout.Add(size, alignment);
+    for (const FieldDescriptor* field : FieldRange(oneof)) {
+      fields.push_back(
+          {field, offset, static_cast<size_t>(EstimateSize(field))});
+    }
+  }
+  if (has_bit_indices_.empty() && has_cached_size) layout.Add(4, 4);
+  if (descriptor_->real_oneof_decl_count() > 0) {
+    layout.Add(4 * descriptor_->real_oneof_decl_count(), 4);
+  }
+  if (IsAnyMessage(descriptor_)) {
+    layout.Add(2 * sizeof(void*), alignof(void*));
+  }
+  const size_t size = layout.Finish();
+
+  p->Print(absl::StrCat("message ", descriptor_->full_name(),
+                        " sizeof=", size, " padding=", layout.padding(),
+                        " has_bit_words=", HasBitsSize(),
+                        " split_sizeof=", split_size, "\n"));
+  for (const FieldLayout& entry : fields) {
+    const FieldDescriptor* field = entry.field;
+    std::string line =
+        absl::StrCat("field ", descriptor_->full_name(), " ", field->number(),
+                     " ", field->name(), " offset=", entry.offset,
+                     " size=", entry.size);
+    if (field->real_containing_oneof() != nullptr) {
+      absl::StrAppend(&line, " oneof");
+    }
+    const bool split = ShouldSplit(field, options_);
+    const bool inlined = IsStringInlined(field, options_);
+    if (split) absl::StrAppend(&line, " split");
+    if (inlined) absl::StrAppend(&line, " inlined");
+    if (profiled) {
+      absl::StrAppend(&line, " hit_ratio=",
+                      GetPresenceProbability(field, options_));
+      if (!split && ShouldSplit(field, candidate_options)) {
+        absl::StrAppend(&line, " split_candidate");
+      }
+      if (!inlined && IsStringInlined(field, candidate_options)) {
+        absl::StrAppend(&line, " inline_candidate");
+      }
+    }
+    p->Print(absl::StrCat(line, "\n"));
+  }
+}
+
 }  // namespace cpp
 }  // namespace compiler
 }  // namespace protobuf
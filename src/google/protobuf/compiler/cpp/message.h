@@ -77,6 +77,12 @@ class MessageGenerator {
   // of entries generated and the index of the first has_bit entry.
   std::pair<size_t, size_t> GenerateOffsets(io::Printer* p);
 
+  // Generates the lines of the layout_report output for this message: its
+  // estimated size, padding and has-bit words, and for each field its offset
+  // and size, whether it is split or inlined, and whether the profile in
+  // `Options::field_hit_stats` makes it a candidate for splitting or inlining.
+  void GenerateLayoutReport(io::Printer* p) const;
+
   const Descriptor* descriptor() const { return descriptor_; }
 
  private:
@@ -102,6 +108,8 @@ class MessageGenerator {
   //
   // Generate the shared constructor code.
   void GenerateSharedConstructorCode(io::Printer* p);
+  // Checks in constructors that arena-only messages are given an arena.
+  void GenerateArenaOnlyCheck(io::Printer* p);
 
   // Generate the shared destructor code.
   void GenerateSharedDestructorCode(io::Printer* p);
@@ -174,6 +182,10 @@ class MessageGenerator {
   int HasBitIndex(const FieldDescriptor* field) const;
   int HasByteIndex(const FieldDescriptor* field) const;
   int HasWordIndex(const FieldDescriptor* field) const;
+  // Returns true if ByteSizeLong() counts the fields with has-bits by
+  // iterating over the set bits, which GenerateSparseByteSize() emits.
+  bool UseSparseByteSize() const;
+  void GenerateSparseByteSize(io::Printer* p);
   std::vector<uint32_t> RequiredFieldsBitMask() const;
 
   const Descriptor* descriptor_;
@@ -10,8 +10,10 @@
 #ifndef GOOGLE_PROTOBUF_COMPILER_CPP_OPTIONS_H__
 #define GOOGLE_PROTOBUF_COMPILER_CPP_OPTIONS_H__
 
+#include <memory>
 #include <string>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 
 namespace google {
@@ -34,10 +36,32 @@ struct FieldListenerOptions {
   absl::flat_hash_set<std::string> forbidden_field_listener_events;
 };
 
+// Relative frequency of each field of a message in parsed input, keyed by the
+// message's full name and then by field number. The most frequent field of
+// each message has 1.
+using FieldHitStats =
+    absl::flat_hash_map<std::string, absl::flat_hash_map<int, float>>;
+
 // Generator options (see generator.cc for a description of each):
 struct Options {
   const AccessInfoMap* access_info_map = nullptr;
   const SplitMap* split_map = nullptr;
+  std::shared_ptr<const FieldHitStats> field_hit_stats;
+  // Fields of the messages in `field_hit_stats` that are hit less often than
+  // this, relative to the most frequent field of the message, are moved to
+  // the message's split struct. 0 disables splitting.
+  float split_field_hit_ratio = 0;
+  // String fields of the messages in `field_hit_stats` that are hit at least
+  // this often, relative to the most frequent field of the message, are stored
+  // inline as InlinedStringField. 0 disables inlining.
+  float inline_string_hit_ratio = 0;
+  // Full names of the messages whose _InternalParse parses their leading
+  // scalar fields inline, expecting them in field number order. Submessages
+  // are parsed through their table, not _InternalParse, so this only applies
+  // to top-level parses of these messages.
+  absl::flat_hash_set<std::string> expected_order_parse_messages;
+  // Full names of the messages that are only ever created on an arena.
+  absl::flat_hash_set<std::string> arena_only_messages;
   std::string dllexport_decl;
   std::string runtime_include_base;
   std::string annotation_pragma_name;
@@ -62,6 +86,8 @@ struct Options {
   bool force_inline_string = false;
 #endif  // !PROTOBUF_STABLE_EXPERIMENTS
   bool strip_nonfunctional_codegen = false;
+  bool lazy_descriptor_registration = false;
+  bool span_accessors = false;
 };
 
 }  // namespace cpp
@@ -110,6 +110,7 @@ ParseFunctionGenerator::ParseFunctionGenerator(
       scc_analyzer_(scc_analyzer),
       options_(options),
       variables_(vars),
+      has_bit_indices_(has_bit_indices),
       inlined_string_indices_(inlined_string_indices),
       ordered_fields_(GetOrderedFields(descriptor_, options_)),
       num_hasbits_(max_has_bit_index) {
@@ -182,7 +183,9 @@ void ParseFunctionGenerator::GenerateTailcallParseFunction(Formatter& format) {
   format(
       "const char* $classname$::_InternalParse(\n"
       "    const char* ptr, ::_pbi::ParseContext* ctx) {\n"
-      "$annotate_deserialize$"
+      "$annotate_deserialize$");
+  GenerateExpectedOrderParse(format);
+  format(
       "  ptr = ::_pbi::TcParser::ParseLoop(this, ptr, ctx, "
       "&_table_.header);\n");
   format(
@@ -190,6 +193,103 @@ void ParseFunctionGenerator::GenerateTailcallParseFunction(Formatter& format) {
       "}\n\n");
 }
 
+std::vector<const FieldDescriptor*>
+ParseFunctionGenerator::GetExpectedOrderFields() const {
+  std::vector<const FieldDescriptor*> fields;
+  if (!options_.expected_order_parse_messages.contains(
+          descriptor_->full_name()) ||
+      HasTracker(descriptor_, options_)) {
+    return fields;
+  }
+  for (const FieldDescriptor* field : ordered_fields_) {
+    // Only singular scalars with one byte tags are parsed inline: anything
+    // else ends the expected sequence.
+    if (field->number() >= 16 || field->is_repeated() ||
+        field->real_containing_oneof() != nullptr ||
+        ShouldSplit(field, options_)) {
+      break;
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING ||
+        field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE ||
+        (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM &&
+         !internal::cpp::HasPreservingUnknownEnumSemantics(field))) {
+      break;
+    }
+    fields.push_back(field);
+  }
+  return fields;
+}
+
+void ParseFunctionGenerator::GenerateExpectedOrderParse(Formatter& format) {
+  const std::vector<const FieldDescriptor*> fields = GetExpectedOrderFields();
+  if (fields.empty()) return;
+
+  format.Indent();
+  format(
+      "// Fields are expected in field number order: parse the leading ones\n"
+      "// inline, and leave the rest to the table from the first other tag.\n"
+      "if (ctx->Done(&ptr)) return ptr;\n");
+  for (const FieldDescriptor* field : fields) {
+    const std::string member = FieldMemberName(field, /*split=*/false);
+    format("if (static_cast<::uint8_t>(*ptr) == $1$) {\n",
+           WireFormat::MakeTag(field));
+    format.Indent();
+    format("++ptr;\n");
+    bool varint = true;
+    switch (field->type()) {
+      case FieldDescriptor::TYPE_INT32:
+        format("$1$ = static_cast<::int32_t>(::_pbi::ReadVarint64(&ptr));\n",
+               member);
+        break;
+      case FieldDescriptor::TYPE_INT64:
+        format("$1$ = static_cast<::int64_t>(::_pbi::ReadVarint64(&ptr));\n",
+               member);
+        break;
+      case FieldDescriptor::TYPE_UINT32:
+        format("$1$ = ::_pbi::ReadVarint32(&ptr);\n", member);
+        break;
+      case FieldDescriptor::TYPE_UINT64:
+        format("$1$ = ::_pbi::ReadVarint64(&ptr);\n", member);
+        break;
+      case FieldDescriptor::TYPE_SINT32:
+        format("$1$ = ::_pbi::ReadVarintZigZag32(&ptr);\n", member);
+        break;
+      case FieldDescriptor::TYPE_SINT64:
+        format("$1$ = ::_pbi::ReadVarintZigZag64(&ptr);\n", member);
+        break;
+      case FieldDescriptor::TYPE_BOOL:
+        format("$1$ = ::_pbi::ReadVarint64(&ptr) != 0;\n", member);
+        break;
+      case FieldDescriptor::TYPE_ENUM:
+        format("$1$ = static_cast<int>(::_pbi::ReadVarint64(&ptr));\n",
+               member);
+        break;
+      default: {
+        std::string type = PrimitiveTypeName(options_, field->cpp_type());
+        format(
+            "$1$ = ::_pbi::UnalignedLoad<$2$>(ptr);\n"
+            "ptr += sizeof($2$);\n",
+            member, type);
+        varint = false;
+        break;
+      }
+    }
+    if (varint) {
+      format("if (ptr == nullptr) return nullptr;\n");
+    }
+    const int has_bit_index =
+        has_bit_indices_.empty() ? -1 : has_bit_indices_[field->index()];
+    if (has_bit_index >= 0) {
+      format("_impl_._has_bits_[$1$] |= 0x$2$u;\n", has_bit_index / 32,
+             absl::Hex(1u << (has_bit_index % 32), absl::kZeroPad8));
+    }
+    format("if (ctx->Done(&ptr)) return ptr;\n");
+    format.Outdent();
+    format("}\n");
+  }
+  format.Outdent();
+}
+
 struct SkipEntry16 {
   uint16_t skipmap;
   uint16_t field_entry_offset;
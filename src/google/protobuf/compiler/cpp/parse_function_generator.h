@@ -56,6 +56,15 @@ class ParseFunctionGenerator {
   // Generates a tail-calling `_InternalParse` function.
   void GenerateTailcallParseFunction(Formatter& format);
 
+  // Returns the leading fields that `GenerateExpectedOrderParse` parses
+  // inline, which is empty unless the message opted in.
+  std::vector<const FieldDescriptor*> GetExpectedOrderFields() const;
+
+  // Generates straight-line code parsing the expected order fields. It is only
+  // emitted into `_InternalParse`, which the table-driven parser bypasses for
+  // submessages.
+  void GenerateExpectedOrderParse(Formatter& format);
+
   // Generates the tail-call table definition.
   void GenerateTailCallTable(io::Printer* printer);
   void GenerateFastFieldEntries(Formatter& format);
@@ -67,6 +76,7 @@ class ParseFunctionGenerator {
   const Options& options_;
   absl::flat_hash_map<absl::string_view, std::string> variables_;
   std::unique_ptr<internal::TailCallTableInfo> tc_table_info_;
+  std::vector<int> has_bit_indices_;
   std::vector<int> inlined_string_indices_;
   const std::vector<const FieldDescriptor*> ordered_fields_;
   int num_hasbits_;
@@ -0,0 +1,53 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/compiler/cpp/profile_guided_optimizer.h"
+
+#include <vector>
+
+#include "google/protobuf/compiler/cpp/helpers.h"
+#include "google/protobuf/compiler/cpp/padding_optimizer.h"
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace cpp {
+
+constexpr float ProfileGuidedOptimizer::kHotFieldRatio;
+
+void ProfileGuidedOptimizer::OptimizeLayout(
+    std::vector<const FieldDescriptor*>* fields, const Options& options,
+    MessageSCCAnalyzer* scc_analyzer) {
+  enum Tier { kHot, kWarm, kCold, kSplit, kNumTiers };
+  std::vector<const FieldDescriptor*> tiers[kNumTiers];
+  for (const auto* field : *fields) {
+    if (ShouldSplit(field, options)) {
+      tiers[kSplit].push_back(field);
+      continue;
+    }
+    const float probability = GetPresenceProbability(field, options);
+    if (probability >= kHotFieldRatio) {
+      tiers[kHot].push_back(field);
+    } else if (probability > 0) {
+      tiers[kWarm].push_back(field);
+    } else {
+      tiers[kCold].push_back(field);
+    }
+  }
+
+  PaddingOptimizer padding_optimizer;
+  fields->clear();
+  for (auto& tier : tiers) {
+    padding_optimizer.OptimizeLayout(&tier, options, scc_analyzer);
+    fields->insert(fields->end(), tier.begin(), tier.end());
+  }
+}
+
+}  // namespace cpp
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,50 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef GOOGLE_PROTOBUF_COMPILER_CPP_PROFILE_GUIDED_OPTIMIZER_H__
+#define GOOGLE_PROTOBUF_COMPILER_CPP_PROFILE_GUIDED_OPTIMIZER_H__
+
+#include <vector>
+
+#include "google/protobuf/compiler/cpp/message_layout_helper.h"
+#include "google/protobuf/compiler/cpp/options.h"
+#include "google/protobuf/descriptor.h"
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace cpp {
+
+// Rearranges the fields of a message so that the fields that are hit most
+// often, according to `Options::field_hit_stats`, share the first cache lines
+// of the message. Since has-bits are assigned in layout order, the has-bits of
+// hot fields end up in the same words too.
+//
+// Fields are divided into tiers by how often they are hit: hot, warm, and
+// never hit. Each tier is laid out by PaddingOptimizer, so there is no more
+// padding than within a PaddingOptimizer layout, besides that at the end of
+// each tier. Split fields are placed at the end, as PaddingOptimizer does.
+class ProfileGuidedOptimizer : public MessageLayoutHelper {
+ public:
+  // Fields hit at least this often, relative to the most frequent field of
+  // the message, are hot.
+  static constexpr float kHotFieldRatio = 0.5f;
+
+  ProfileGuidedOptimizer() {}
+  ~ProfileGuidedOptimizer() override {}
+
+  void OptimizeLayout(std::vector<const FieldDescriptor*>* fields,
+                      const Options& options,
+                      MessageSCCAnalyzer* scc_analyzer) override;
+};
+
+}  // namespace cpp
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // GOOGLE_PROTOBUF_COMPILER_CPP_PROFILE_GUIDED_OPTIMIZER_H__
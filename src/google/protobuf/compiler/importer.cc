@@ -22,15 +22,20 @@
 #include <sys/types.h>
 
 #include <algorithm>
+#include <deque>
 #include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/compiler/parser.h"
 #include "google/protobuf/io/io_win32.h"
 #include "google/protobuf/io/tokenizer.h"
@@ -96,6 +101,39 @@ class SourceTreeDescriptorDatabase::SingleFileErrorCollector
   bool had_errors_;
 };
 
+// A file parsed by Prefetch() before it was requested.  Its parse errors are
+// held until it is requested.  Its source locations are recorded against
+// `proto`, whose contents are then swapped into the FileDescriptorProto the
+// DescriptorPool asked for: the nested messages keep their addresses, and
+// only the file itself moves, to `returned_as`.
+struct SourceTreeDescriptorDatabase::PrefetchedFile {
+  struct Error {
+    int line;
+    int column;
+    std::string message;
+  };
+
+  class ErrorBuffer : public io::ErrorCollector {
+   public:
+    explicit ErrorBuffer(std::vector<Error>* errors) : errors_(errors) {}
+    ~ErrorBuffer() override {}
+
+    // implements ErrorCollector -------------------------------------
+    void RecordError(int line, int column, absl::string_view message) override {
+      errors_->push_back({line, column, std::string(message)});
+    }
+
+   private:
+    std::vector<Error>* errors_;
+  };
+
+  FileDescriptorProto proto;
+  SourceLocationTable source_locations;
+  std::vector<Error> errors;
+  bool parsed = false;
+  const Message* returned_as = nullptr;
+};
+
 // ===================================================================
 
 SourceTreeDescriptorDatabase::SourceTreeDescriptorDatabase(
@@ -118,6 +156,31 @@ SourceTreeDescriptorDatabase::~SourceTreeDescriptorDatabase() {}
 
 bool SourceTreeDescriptorDatabase::FindFileByName(const std::string& filename,
                                                   FileDescriptorProto* output) {
+  if (prefetch_threads_ > 1) {
+    if (!prefetched_files_.contains(filename)) Prefetch(filename);
+    auto it = prefetched_files_.find(filename);
+    if (it != prefetched_files_.end()) {
+      std::unique_ptr<PrefetchedFile> file = std::move(it->second);
+      prefetched_files_.erase(it);
+      requested_files_.insert(filename);
+      if (error_collector_ != nullptr) {
+        for (const PrefetchedFile::Error& error : file->errors) {
+          error_collector_->RecordError(filename, error.line, error.column,
+                                        error.message);
+        }
+      }
+      output->Swap(&file->proto);
+      file->returned_as = output;
+      const bool parsed = file->parsed && file->errors.empty();
+      returned_files_[filename] = std::move(file);
+      return parsed;
+    }
+    // Files which cannot be opened are looked up as usual, so that the
+    // fallback database is checked and the error is reported.
+  }
+  requested_files_.insert(filename);
+  returned_files_.erase(filename);
+
   std::unique_ptr<io::ZeroCopyInputStream> input(source_tree_->Open(filename));
   if (input == nullptr) {
     if (fallback_database_ != nullptr &&
@@ -142,12 +205,116 @@ bool SourceTreeDescriptorDatabase::FindFileByName(const std::string& filename,
   if (using_validation_error_collector_) {
     parser.RecordSourceLocationsTo(&source_locations_);
   }
+  parser.SetSkipSourceCodeInfo(skip_source_code_info_);
 
   // Parse it.
   output->set_name(filename);
   return parser.Parse(&tokenizer, output) && !file_error_collector.had_errors();
 }
 
+void SourceTreeDescriptorDatabase::Prefetch(const std::string& filename) {
+  struct Queue {
+    std::deque<std::string> pending;
+    int parsing = 0;
+  };
+  absl::Mutex mutex;
+  Queue queue;
+  queue.pending.push_back(filename);
+  absl::flat_hash_set<std::string> seen = {filename};
+
+  // Each thread takes the next file to parse, and queues its imports once it
+  // is parsed, until no file is left to parse or being parsed.
+  auto parse = [&] {
+    mutex.Lock();
+    while (true) {
+      mutex.Await(absl::Condition(
+          +[](Queue* queue) {
+            return !queue->pending.empty() || queue->parsing == 0;
+          },
+          &queue));
+      if (queue.pending.empty()) break;
+      std::string name = std::move(queue.pending.front());
+      queue.pending.pop_front();
+      ++queue.parsing;
+      mutex.Unlock();
+      std::unique_ptr<PrefetchedFile> file = ParseForPrefetch(name);
+      mutex.Lock();
+      --queue.parsing;
+      if (file == nullptr) continue;
+      for (const std::string& dependency : file->proto.dependency()) {
+        if (!requested_files_.contains(dependency) &&
+            !prefetched_files_.contains(dependency) &&
+            seen.insert(dependency).second) {
+          queue.pending.push_back(dependency);
+        }
+      }
+      prefetched_files_[name] = std::move(file);
+    }
+    mutex.Unlock();
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < prefetch_threads_; ++i) {
+    threads.emplace_back(parse);
+  }
+  parse();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+std::unique_ptr<SourceTreeDescriptorDatabase::PrefetchedFile>
+SourceTreeDescriptorDatabase::ParseForPrefetch(const std::string& filename) {
+  // The SourceTree need not be thread-safe, so the file is read whole under
+  // the lock and parsed outside of it.
+  std::string contents;
+  {
+    absl::MutexLock lock(&source_tree_mutex_);
+    std::unique_ptr<io::ZeroCopyInputStream> input(
+        source_tree_->Open(filename));
+    if (input == nullptr) return nullptr;
+    const void* data;
+    int size;
+    while (input->Next(&data, &size)) {
+      contents.append(static_cast<const char*>(data), size);
+    }
+  }
+
+  auto file = std::make_unique<PrefetchedFile>();
+  io::ArrayInputStream input(contents.data(),
+                             static_cast<int>(contents.size()));
+  PrefetchedFile::ErrorBuffer error_buffer(&file->errors);
+  io::Tokenizer tokenizer(&input, &error_buffer);
+
+  Parser parser;
+  parser.RecordErrorsTo(&error_buffer);
+  if (using_validation_error_collector_) {
+    parser.RecordSourceLocationsTo(&file->source_locations);
+  }
+  parser.SetSkipSourceCodeInfo(skip_source_code_info_);
+
+  file->proto.set_name(filename);
+  file->parsed = parser.Parse(&tokenizer, &file->proto);
+  return file;
+}
+
+void SourceTreeDescriptorDatabase::FindLocation(
+    absl::string_view filename, absl::string_view element_name,
+    const Message* descriptor,
+    DescriptorPool::ErrorCollector::ErrorLocation location, int* line,
+    int* column) const {
+  const SourceLocationTable* source_locations = &source_locations_;
+  auto it = returned_files_.find(filename);
+  if (it != returned_files_.end()) {
+    source_locations = &it->second->source_locations;
+    if (descriptor == it->second->returned_as) descriptor = &it->second->proto;
+  }
+  if (location == DescriptorPool::ErrorCollector::IMPORT) {
+    source_locations->FindImport(descriptor, element_name, line, column);
+  } else {
+    source_locations->Find(descriptor, location, line, column);
+  }
+}
+
 bool SourceTreeDescriptorDatabase::FindFileContainingSymbol(
     const std::string& symbol_name, FileDescriptorProto* output) {
   return false;
@@ -175,12 +342,8 @@ void SourceTreeDescriptorDatabase::ValidationErrorCollector::RecordError(
   if (owner_->error_collector_ == nullptr) return;
 
   int line, column;
-  if (location == DescriptorPool::ErrorCollector::IMPORT) {
-    owner_->source_locations_.FindImport(descriptor, element_name, &line,
-                                         &column);
-  } else {
-    owner_->source_locations_.Find(descriptor, location, &line, &column);
-  }
+  owner_->FindLocation(filename, element_name, descriptor, location, &line,
+                       &column);
   owner_->error_collector_->RecordError(filename, line, column, message);
 }
 
@@ -191,12 +354,8 @@ void SourceTreeDescriptorDatabase::ValidationErrorCollector::RecordWarning(
   if (owner_->error_collector_ == nullptr) return;
 
   int line, column;
-  if (location == DescriptorPool::ErrorCollector::IMPORT) {
-    owner_->source_locations_.FindImport(descriptor, element_name, &line,
-                                         &column);
-  } else {
-    owner_->source_locations_.Find(descriptor, location, &line, &column);
-  }
+  owner_->FindLocation(filename, element_name, descriptor, location, &line,
+                       &column);
   owner_->error_collector_->RecordWarning(filename, line, column, message);
 }
 
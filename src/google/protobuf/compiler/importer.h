@@ -14,11 +14,15 @@
 #ifndef GOOGLE_PROTOBUF_COMPILER_IMPORTER_H__
 #define GOOGLE_PROTOBUF_COMPILER_IMPORTER_H__
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/compiler/parser.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/descriptor_database.h"
@@ -83,6 +87,18 @@ class PROTOBUF_EXPORT SourceTreeDescriptorDatabase : public DescriptorDatabase {
     return &validation_error_collector_;
   }
 
+  // Leaves the source_code_info of the files parsed empty.  See
+  // Parser::SetSkipSourceCodeInfo().
+  void SetSkipSourceCodeInfo(bool value) { skip_source_code_info_ = value; }
+
+  // Makes FindFileByName() parse the files that the requested file imports,
+  // transitively, on up to num_threads threads before returning, so that the
+  // DescriptorPool finds them already parsed when it asks for them while
+  // building the file.  Parse errors are still reported when, and in the
+  // order in which, the files are requested.  The SourceTree is only used by
+  // one thread at a time.  The default, 1, parses each file when requested.
+  void SetPrefetchThreads(int num_threads) { prefetch_threads_ = num_threads; }
+
   // implements DescriptorDatabase -----------------------------------
   bool FindFileByName(const std::string& filename,
                       FileDescriptorProto* output) override;
@@ -94,6 +110,17 @@ class PROTOBUF_EXPORT SourceTreeDescriptorDatabase : public DescriptorDatabase {
 
  private:
   class SingleFileErrorCollector;
+  struct PrefetchedFile;
+
+  // Parses filename and the files it imports into prefetched_files_.
+  void Prefetch(const std::string& filename);
+  // Parses one file for Prefetch(), or returns null if it cannot be opened.
+  std::unique_ptr<PrefetchedFile> ParseForPrefetch(const std::string& filename);
+  // Finds the location of an error reported to the ValidationErrorCollector.
+  void FindLocation(absl::string_view filename, absl::string_view element_name,
+                    const Message* descriptor,
+                    DescriptorPool::ErrorCollector::ErrorLocation location,
+                    int* line, int* column) const;
 
   SourceTree* source_tree_;
   DescriptorDatabase* fallback_database_;
@@ -121,8 +148,21 @@ class PROTOBUF_EXPORT SourceTreeDescriptorDatabase : public DescriptorDatabase {
   friend class ValidationErrorCollector;
 
   bool using_validation_error_collector_;
+  bool skip_source_code_info_ = false;
   SourceLocationTable source_locations_;
   ValidationErrorCollector validation_error_collector_;
+
+  int prefetch_threads_ = 1;
+  absl::Mutex source_tree_mutex_;
+  // Files parsed ahead of being requested.
+  absl::flat_hash_map<std::string, std::unique_ptr<PrefetchedFile>>
+      prefetched_files_;
+  // Prefetched files that were returned by FindFileByName(), kept for the
+  // source locations recorded while parsing them.
+  absl::flat_hash_map<std::string, std::unique_ptr<PrefetchedFile>>
+      returned_files_;
+  // Files returned by FindFileByName(), which are not prefetched again.
+  absl::flat_hash_set<std::string> requested_files_;
 };
 
 // Simple interface for parsing .proto files.  This wraps the process
@@ -159,6 +199,13 @@ class PROTOBUF_EXPORT Importer {
   // contents are stored.
   inline const DescriptorPool* pool() const { return &pool_; }
 
+  // Parses the files imported by the file being imported on up to
+  // num_threads threads.  See
+  // SourceTreeDescriptorDatabase::SetPrefetchThreads().
+  void SetPrefetchThreads(int num_threads) {
+    database_.SetPrefetchThreads(num_threads);
+  }
+
   void AddUnusedImportTrackFile(const std::string& file_name,
                                 bool is_error = false);
   void ClearUnusedImportTrackFiles();
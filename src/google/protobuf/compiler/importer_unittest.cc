@@ -231,6 +231,69 @@ TEST_F(ImporterTest, LiteRuntimeImport) {
       error_collector_.text_);
 }
 
+TEST_F(ImporterTest, PrefetchImports) {
+  importer_.SetPrefetchThreads(4);
+  AddFile("foo.proto",
+          "syntax = \"proto2\";\n"
+          "import \"bar.proto\";\n"
+          "import \"baz.proto\";\n"
+          "message Foo {\n"
+          "  optional Bar bar = 1;\n"
+          "  optional Baz baz = 2;\n"
+          "}\n");
+  AddFile("bar.proto",
+          "syntax = \"proto2\";\n"
+          "import \"qux.proto\";\n"
+          "message Bar { optional Qux qux = 1; }\n");
+  AddFile("baz.proto",
+          "syntax = \"proto2\";\n"
+          "import \"qux.proto\";\n"
+          "message Baz { optional Qux qux = 1; }\n");
+  AddFile("qux.proto",
+          "syntax = \"proto2\";\n"
+          "message Qux {}\n");
+
+  const FileDescriptor* foo = importer_.Import("foo.proto");
+  EXPECT_EQ("", error_collector_.text_);
+  ASSERT_TRUE(foo != nullptr);
+  ASSERT_EQ(2, foo->dependency_count());
+  EXPECT_EQ(foo->dependency(0)->dependency(0),
+            foo->dependency(1)->dependency(0));
+  EXPECT_EQ(importer_.pool()->FindFileByName("qux.proto"),
+            foo->dependency(0)->dependency(0));
+}
+
+TEST_F(ImporterTest, PrefetchImportsReportsErrors) {
+  importer_.SetPrefetchThreads(4);
+  AddFile("foo.proto",
+          "syntax = \"proto2\";\n"
+          "import \"bar.proto\";\n"
+          "import \"baz.proto\";\n"
+          "import \"missing.proto\";\n");
+  AddFile("bar.proto",
+          "syntax = \"proto2\";\n"
+          "message Bar {\n"
+          "  optional Undefined field = 1;\n"
+          "}\n");
+  AddFile("baz.proto",
+          "syntax = \"proto2\";\n"
+          "message Baz {\n");
+
+  // The errors are the ones, in the order and at the locations, that
+  // importing without prefetching reports.
+  EXPECT_TRUE(importer_.Import("foo.proto") == nullptr);
+  EXPECT_EQ(
+      "bar.proto:2:11: \"Undefined\" is not defined.\n"
+      "baz.proto:2:0: Reached end of input in message definition (missing "
+      "'}').\n"
+      "missing.proto:-1:0: File not found.\n"
+      "foo.proto:1:0: Import \"bar.proto\" was not found or had errors.\n"
+      "foo.proto:2:0: Import \"baz.proto\" was not found or had errors.\n"
+      "foo.proto:3:0: Import \"missing.proto\" was not found or had "
+      "errors.\n",
+      error_collector_.text_);
+}
+
 
 // ===================================================================
 
@@ -447,6 +447,16 @@ void Parser::LocationRecorder::Init(const LocationRecorder& parent,
 }
 
 Parser::LocationRecorder::~LocationRecorder() {
+  if (parser_->skip_source_code_info_) {
+    // The location was only needed while recording: reuse it for the next one.
+    RepeatedPtrField<SourceCodeInfo::Location>* locations =
+        source_code_info_->mutable_location();
+    if (!locations->empty() &&
+        &(*locations)[locations->size() - 1] == location_) {
+      locations->RemoveLast();
+    }
+    return;
+  }
   if (location_->span_size() <= 2) {
     EndAt(parser_->input_->previous());
   }
@@ -704,7 +714,11 @@ bool Parser::Parse(io::Tokenizer* input, FileDescriptorProto* file) {
   input_ = nullptr;
   source_code_info_ = nullptr;
   assert(file != nullptr);
-  source_code_info.Swap(file->mutable_source_code_info());
+  if (skip_source_code_info_) {
+    file->clear_source_code_info();
+  } else {
+    source_code_info.Swap(file->mutable_source_code_info());
+  }
   return !had_errors_;
 }
 
@@ -100,6 +100,12 @@ class PROTOBUF_EXPORT Parser {
     stop_after_syntax_identifier_ = value;
   }
 
+  // Call SetSkipSourceCodeInfo(true) to leave the source_code_info of the
+  // FileDescriptorProto empty, which saves the time and memory spent building
+  // it when neither comments nor source spans are needed.  Locations are still
+  // recorded to the table given to RecordSourceLocationsTo().
+  void SetSkipSourceCodeInfo(bool value) { skip_source_code_info_ = value; }
+
  private:
   class LocationRecorder;
   struct MapField;
@@ -529,6 +535,7 @@ class PROTOBUF_EXPORT Parser {
   bool had_errors_;
   bool require_syntax_identifier_;
   bool stop_after_syntax_identifier_;
+  bool skip_source_code_info_ = false;
   std::string syntax_identifier_;
   Edition edition_ = Edition::EDITION_UNKNOWN;
 
@@ -2844,6 +2844,37 @@ TEST_F(ParseDescriptorDebugTest, TestMaps) {
   EXPECT_EQ(original.DebugString(), parsed.DebugString());
 }
 
+TEST_F(ParserTest, SkipSourceCodeInfo) {
+  const char* text =
+      "syntax = \"proto2\";\n"
+      "message Foo {\n"
+      "  // Comment.\n"
+      "  optional int32 bar = 1;\n"
+      "}\n";
+  SetupParser(text);
+  FileDescriptorProto full;
+  ASSERT_TRUE(parser_->Parse(input_.get(), &full));
+  EXPECT_TRUE(full.has_source_code_info());
+
+  SetupParser(text);
+  SourceLocationTable source_locations;
+  parser_->RecordSourceLocationsTo(&source_locations);
+  parser_->SetSkipSourceCodeInfo(true);
+  FileDescriptorProto skipped;
+  ASSERT_TRUE(parser_->Parse(input_.get(), &skipped));
+  EXPECT_FALSE(skipped.has_source_code_info());
+  full.clear_source_code_info();
+  EXPECT_EQ(full.DebugString(), skipped.DebugString());
+
+  // Locations for errors are still recorded.
+  int line, column;
+  ASSERT_TRUE(source_locations.Find(&skipped.message_type(0),
+                                    DescriptorPool::ErrorCollector::NAME,
+                                    &line, &column));
+  EXPECT_EQ(line, 1);
+  EXPECT_EQ(column, 8);
+}
+
 // ===================================================================
 // SourceCodeInfo tests.
 
@@ -388,15 +388,13 @@ PROTOBUF_NOINLINE void Version::Clear() {
   // Prevent compiler warnings about cached_has_bits being unused
   (void) cached_has_bits;
 
+  ::memset(&_impl_.major_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.patch_) -
+      reinterpret_cast<char*>(&_impl_.major_)) + sizeof(_impl_.patch_));
   cached_has_bits = _impl_._has_bits_[0];
   if (cached_has_bits & 0x00000001u) {
     _impl_.suffix_.ClearNonDefaultToEmpty();
   }
-  if (cached_has_bits & 0x0000000eu) {
-    ::memset(&_impl_.major_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.patch_) -
-        reinterpret_cast<char*>(&_impl_.major_)) + sizeof(_impl_.patch_));
-  }
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
@@ -799,8 +797,9 @@ const ::_pbi::TcParseTable<3, 5, 3, 79, 2> CodeGeneratorRequest::_table_ = {
     const auto& s = this->_internal_file_to_generate().Get(i);
     ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(s.data(), static_cast<int>(s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
                                 "google.protobuf.compiler.CodeGeneratorRequest.file_to_generate");
-    target = stream->WriteString(1, s, target);
   }
+  target = stream->WriteRepeatedStringMaybeAliased(
+      1, this->_internal_file_to_generate(), target);
 
   cached_has_bits = _impl_._has_bits_[0];
   // optional string parameter = 2;
@@ -71,6 +71,41 @@ void MessageSerialize(Context<Descriptor> msg) {
   ABSL_LOG(FATAL) << "unreachable";
 }
 
+void MessageSerializeInto(Context<Descriptor> msg) {
+  switch (msg.opts().kernel) {
+    case Kernel::kCpp:
+      // The thunk writes straight into the spare capacity of `out`.  It only
+      // needs to be called twice if that capacity is too small.
+      msg.Emit({{"serialize_into_thunk", Thunk(msg, "serialize_into")}}, R"rs(
+        let spare = out.spare_capacity_mut();
+        let mut len = unsafe {
+          $serialize_into_thunk$(
+            self.inner.msg, spare.as_mut_ptr() as *mut u8, spare.len())
+        };
+        if len > spare.len() {
+          out.reserve(len);
+          let spare = out.spare_capacity_mut();
+          len = unsafe {
+            $serialize_into_thunk$(
+              self.inner.msg, spare.as_mut_ptr() as *mut u8, spare.len())
+          };
+          assert!(len <= spare.len(), "message changed size while serializing");
+        }
+        // SAFETY: the thunk initialized the first `len` spare bytes.
+        unsafe { out.set_len(out.len() + len) }
+      )rs");
+      return;
+
+    case Kernel::kUpb:
+      msg.Emit(R"rs(
+        out.extend_from_slice(&self.serialize())
+      )rs");
+      return;
+  }
+
+  ABSL_LOG(FATAL) << "unreachable";
+}
+
 void MessageDeserialize(Context<Descriptor> msg) {
   switch (msg.opts().kernel) {
     case Kernel::kCpp:
@@ -79,14 +114,7 @@ void MessageDeserialize(Context<Descriptor> msg) {
               {"deserialize_thunk", Thunk(msg, "deserialize")},
           },
           R"rs(
-          let success = unsafe {
-            let data = $pbr$::SerializedData::from_raw_parts(
-              $NonNull$::new(data.as_ptr() as *mut _).unwrap(),
-              data.len(),
-            );
-
-            $deserialize_thunk$(self.inner.msg, data)
-          };
+          let success = unsafe { $deserialize_thunk$(self.inner.msg, data.into()) };
           success.then_some(()).ok_or($pb$::ParseError)
         )rs");
       return;
@@ -123,13 +151,15 @@ void MessageExterns(Context<Descriptor> msg) {
               {"new_thunk", Thunk(msg, "new")},
               {"delete_thunk", Thunk(msg, "delete")},
               {"serialize_thunk", Thunk(msg, "serialize")},
+              {"serialize_into_thunk", Thunk(msg, "serialize_into")},
               {"deserialize_thunk", Thunk(msg, "deserialize")},
           },
           R"rs(
           fn $new_thunk$() -> $pbi$::RawMessage;
           fn $delete_thunk$(raw_msg: $pbi$::RawMessage);
           fn $serialize_thunk$(raw_msg: $pbi$::RawMessage) -> $pbr$::SerializedData;
-          fn $deserialize_thunk$(raw_msg: $pbi$::RawMessage, data: $pbr$::SerializedData) -> bool;
+          fn $serialize_into_thunk$(raw_msg: $pbi$::RawMessage, buf: *mut u8, capacity: usize) -> usize;
+          fn $deserialize_thunk$(raw_msg: $pbi$::RawMessage, data: $pbi$::PtrAndLen) -> bool;
         )rs");
       return;
 
@@ -206,6 +236,7 @@ void GenerateRs(Context<Descriptor> msg) {
           {"Msg", msg.desc().name()},
           {"Msg::new", [&] { MessageNew(msg); }},
           {"Msg::serialize", [&] { MessageSerialize(msg); }},
+          {"Msg::serialize_into", [&] { MessageSerializeInto(msg); }},
           {"Msg::deserialize", [&] { MessageDeserialize(msg); }},
           {"Msg::drop", [&] { MessageDrop(msg); }},
           {"Msg_externs", [&] { MessageExterns(msg); }},
@@ -387,6 +418,13 @@ void GenerateRs(Context<Descriptor> msg) {
           pub fn serialize(&self) -> $pbr$::SerializedData {
             $Msg::serialize$
           }
+          /// Appends the serialized message to `out`.
+          ///
+          /// Reusing `out` across calls avoids allocating a new buffer for
+          /// each message.
+          pub fn serialize_into(&self, out: &mut $std$::vec::Vec<u8>) {
+            $Msg::serialize_into$
+          }
           pub fn deserialize(&mut self, data: &[u8]) -> Result<(), $pb$::ParseError> {
             $Msg::deserialize$
           }
@@ -445,6 +483,7 @@ void GenerateThunksCc(Context<Descriptor> msg) {
        {"new_thunk", Thunk(msg, "new")},
        {"delete_thunk", Thunk(msg, "delete")},
        {"serialize_thunk", Thunk(msg, "serialize")},
+       {"serialize_into_thunk", Thunk(msg, "serialize_into")},
        {"deserialize_thunk", Thunk(msg, "deserialize")},
        {"nested_msg_thunks",
         [&] {
@@ -477,9 +516,12 @@ void GenerateThunksCc(Context<Descriptor> msg) {
         google::protobuf::rust_internal::SerializedData $serialize_thunk$($QualifiedMsg$* msg) {
           return google::protobuf::rust_internal::SerializeMsg(msg);
         }
+        size_t $serialize_into_thunk$($QualifiedMsg$* msg, void* buf, size_t capacity) {
+          return google::protobuf::rust_internal::SerializeMsgInto(msg, buf, capacity);
+        }
         bool $deserialize_thunk$($QualifiedMsg$* msg,
-                                 google::protobuf::rust_internal::SerializedData data) {
-          return msg->ParseFromArray(data.data, data.len);
+                                 google::protobuf::rust_internal::PtrAndLen data) {
+          return msg->ParseFromArray(data.ptr, data.len);
         }
 
         $accessor_thunks$
@@ -15,6 +15,7 @@
 
 #ifndef _WIN32
 #include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <sys/select.h>
 #include <sys/wait.h>
@@ -141,8 +142,8 @@ void Subprocess::Start(const std::string& program, SearchMode search_mode) {
   free(wcommand_line_copy);
 }
 
-bool Subprocess::Communicate(const Message& input, Message* output,
-                             std::string* error) {
+bool Subprocess::CommunicateSerialized(const std::string& input_data,
+                                       Message* output, std::string* error) {
   if (process_start_error_ != ERROR_SUCCESS) {
     *error = Win32ErrorMessage(process_start_error_);
     return false;
@@ -150,11 +151,6 @@ bool Subprocess::Communicate(const Message& input, Message* output,
 
   ABSL_CHECK(child_handle_ != nullptr) << "Must call Start() first.";
 
-  std::string input_data;
-  if (!input.SerializeToString(&input_data)) {
-    *error = "Failed to serialize request.";
-    return false;
-  }
   std::string output_data;
 
   int input_pos = 0;
@@ -288,6 +284,10 @@ Subprocess::~Subprocess() {
 }
 
 namespace {
+#ifdef F_SETPIPE_SZ
+constexpr int kPipeSize = 1 << 20;
+#endif  // F_SETPIPE_SZ
+
 char* portable_strdup(const char* s) {
   char* ns = (char*)malloc(strlen(s) + 1);
   if (ns != nullptr) {
@@ -354,11 +354,22 @@ void Subprocess::Start(const std::string& program, SearchMode search_mode) {
 
     child_stdin_ = stdin_pipe[1];
     child_stdout_ = stdout_pipe[0];
+
+    // Keeps our ends of the pipes out of subprocesses started later, which
+    // would otherwise hold them open while this one runs.
+    fcntl(child_stdin_, F_SETFD, FD_CLOEXEC);
+    fcntl(child_stdout_, F_SETFD, FD_CLOEXEC);
+#ifdef F_SETPIPE_SZ
+    // Larger pipes take fewer round trips for large requests and responses.
+    // This is only a hint, and failing to resize them is harmless.
+    fcntl(child_stdin_, F_SETPIPE_SZ, kPipeSize);
+    fcntl(child_stdout_, F_SETPIPE_SZ, kPipeSize);
+#endif  // F_SETPIPE_SZ
   }
 }
 
-bool Subprocess::Communicate(const Message& input, Message* output,
-                             std::string* error) {
+bool Subprocess::CommunicateSerialized(const std::string& input_data,
+                                       Message* output, std::string* error) {
   ABSL_CHECK_NE(child_stdin_, -1) << "Must call Start() first.";
 
   // The "sighandler_t" typedef is GNU-specific, so define our own.
@@ -367,11 +378,6 @@ bool Subprocess::Communicate(const Message& input, Message* output,
   // Make sure SIGPIPE is disabled so that if the child dies it doesn't kill us.
   SignalHandler* old_pipe_handler = signal(SIGPIPE, SIG_IGN);
 
-  std::string input_data;
-  if (!input.SerializeToString(&input_data)) {
-    *error = "Failed to serialize request.";
-    return false;
-  }
   std::string output_data;
 
   int input_pos = 0;
@@ -417,7 +423,7 @@ bool Subprocess::Communicate(const Message& input, Message* output,
     }
 
     if (child_stdout_ != -1 && FD_ISSET(child_stdout_, &read_fds)) {
-      char buffer[4096];
+      char buffer[65536];
       int n = read(child_stdout_, buffer, sizeof(buffer));
 
       if (n > 0) {
@@ -474,6 +480,16 @@ bool Subprocess::Communicate(const Message& input, Message* output,
 
 #endif  // !_WIN32
 
+bool Subprocess::Communicate(const Message& input, Message* output,
+                             std::string* error) {
+  std::string input_data;
+  if (!input.SerializeToString(&input_data)) {
+    *error = "Failed to serialize request.";
+    return false;
+  }
+  return CommunicateSerialized(input_data, output, error);
+}
+
 }  // namespace compiler
 }  // namespace protobuf
 }  // namespace google
@@ -55,6 +55,11 @@ class PROTOC_EXPORT Subprocess {
   // *error to a description of the problem.
   bool Communicate(const Message& input, Message* output, std::string* error);
 
+  // Like Communicate(), but pipes input_data, which is already serialized, so
+  // that the same request can be sent to several subprocesses.
+  bool CommunicateSerialized(const std::string& input_data, Message* output,
+                             std::string* error);
+
 #ifdef _WIN32
   // Given an error code, returns a human-readable error message.  This is
   // defined here so that CommandLineInterface can share it.
@@ -52,6 +52,22 @@ else
   echo "Warning:  'unzip' command not available.  Skipping test."
 fi
 
+echo "Testing compressed output to zip..."
+$PROTOC --compress_zip_output -j2 \
+    --cpp_out=$TEST_TMPDIR/testzip_deflated.zip -I$TEST_TMPDIR testzip.proto \
+    || fail 'protoc failed.'
+if $UNZIP -h > /dev/null; then
+  $UNZIP -t $TEST_TMPDIR/testzip_deflated.zip > $TEST_TMPDIR/testzip.list \
+    || fail 'unzip failed.'
+
+  grep 'testing: testzip\.pb\.cc *OK$' $TEST_TMPDIR/testzip.list > /dev/null \
+    || fail 'testzip.pb.cc not found in compressed output zip.'
+  grep 'testing: testzip\.pb\.h *OK$' $TEST_TMPDIR/testzip.list > /dev/null \
+    || fail 'testzip.pb.h not found in compressed output zip.'
+else
+  echo "Warning:  'unzip' command not available.  Skipping test."
+fi
+
 echo "Testing output to jar..."
 if $JAR c $TEST_TMPDIR/testzip.proto > /dev/null; then
   $JAR tf $TEST_TMPDIR/testzip.jar > $TEST_TMPDIR/testzip.list \
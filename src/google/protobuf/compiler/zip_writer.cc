@@ -13,9 +13,16 @@
 #include "google/protobuf/compiler/zip_writer.h"
 
 #include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
 
 #include "google/protobuf/io/coded_stream.h"
 
+#if HAVE_ZLIB
+#include "zlib.h"
+#endif  // HAVE_ZLIB
+
 namespace google {
 namespace protobuf {
 namespace compiler {
@@ -85,37 +92,90 @@ static void WriteShort(io::CodedOutputStream* out, uint16_t val) {
   out->WriteRaw(p, 2);
 }
 
+// Compresses `data` into a raw deflate stream, as stored in zip files.
+static bool Deflate(const std::string& data, std::string* out) {
+#if HAVE_ZLIB
+  if (data.size() > std::numeric_limits<uInt>::max()) return false;
+  z_stream zs = {};
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS,
+                   /*memLevel=*/8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  out->resize(deflateBound(&zs, data.size()));
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  zs.avail_in = static_cast<uInt>(data.size());
+  zs.next_out = reinterpret_cast<Bytef*>(&(*out)[0]);
+  zs.avail_out = static_cast<uInt>(out->size());
+  int result = deflate(&zs, Z_FINISH);
+  out->resize(zs.total_out);
+  deflateEnd(&zs);
+  return result == Z_STREAM_END;
+#else
+  return false;
+#endif  // HAVE_ZLIB
+}
+
 ZipWriter::ZipWriter(io::ZeroCopyOutputStream* raw_output)
     : raw_output_(raw_output) {}
 ZipWriter::~ZipWriter() {}
 
+ZipWriter::Entry ZipWriter::MakeEntry(std::string filename,
+                                      std::string contents, bool deflate) {
+  Entry entry;
+  entry.name = std::move(filename);
+  entry.size = contents.size();
+  entry.crc32 = ComputeCRC32(contents);
+  std::string deflated;
+  if (deflate && Deflate(contents, &deflated) &&
+      deflated.size() < contents.size()) {
+    entry.data = std::move(deflated);
+    entry.deflated = true;
+  } else {
+    entry.data = std::move(contents);
+  }
+  return entry;
+}
+
 bool ZipWriter::Write(const std::string& filename,
                       const std::string& contents) {
+  return WriteFile(filename, contents, contents.size(), ComputeCRC32(contents),
+                   /*deflated=*/false);
+}
+
+bool ZipWriter::Write(const Entry& entry) {
+  return WriteFile(entry.name, entry.data, entry.size, entry.crc32,
+                   entry.deflated);
+}
+
+bool ZipWriter::WriteFile(const std::string& filename, const std::string& data,
+                          uint32_t size, uint32_t crc32, bool deflated) {
   FileInfo info;
 
   info.name = filename;
   uint16_t filename_size = filename.size();
   info.offset = raw_output_->ByteCount();
-  info.size = contents.size();
-  info.crc32 = ComputeCRC32(contents);
+  info.size = size;
+  info.compressed_size = data.size();
+  info.crc32 = crc32;
+  info.deflated = deflated;
 
   files_.push_back(info);
 
   // write file header
   io::CodedOutputStream output(raw_output_);
   output.WriteLittleEndian32(0x04034b50);  // magic
-  WriteShort(&output, 10);                 // version needed to extract
-  WriteShort(&output, 0);                  // flags
-  WriteShort(&output, 0);                  // compression method: stored
-  WriteShort(&output, 0);                  // last modified time
-  WriteShort(&output, kDosEpoch);          // last modified date
-  output.WriteLittleEndian32(info.crc32);  // crc-32
-  output.WriteLittleEndian32(info.size);   // compressed size
-  output.WriteLittleEndian32(info.size);   // uncompressed size
-  WriteShort(&output, filename_size);      // file name length
-  WriteShort(&output, 0);                  // extra field length
-  output.WriteString(filename);            // file name
-  output.WriteString(contents);            // file data
+  WriteShort(&output, deflated ? 20 : 10);  // version needed to extract
+  WriteShort(&output, 0);                   // flags
+  WriteShort(&output, deflated ? 8 : 0);    // compression method
+  WriteShort(&output, 0);                   // last modified time
+  WriteShort(&output, kDosEpoch);           // last modified date
+  output.WriteLittleEndian32(info.crc32);   // crc-32
+  output.WriteLittleEndian32(info.compressed_size);  // compressed size
+  output.WriteLittleEndian32(info.size);             // uncompressed size
+  WriteShort(&output, filename_size);       // file name length
+  WriteShort(&output, 0);                   // extra field length
+  output.WriteString(filename);             // file name
+  output.WriteString(data);                 // file data
 
   return !output.HadError();
 }
@@ -131,18 +191,20 @@ bool ZipWriter::WriteDirectory() {
     uint16_t filename_size = filename.size();
     uint32_t crc32 = files_[i].crc32;
     uint32_t size = files_[i].size;
+    uint32_t compressed_size = files_[i].compressed_size;
     uint32_t offset = files_[i].offset;
-
-    output.WriteLittleEndian32(0x02014b50);  // magic
-    WriteShort(&output, 10);                 // version made by
-    WriteShort(&output, 10);                 // version needed to extract
-    WriteShort(&output, 0);                  // flags
-    WriteShort(&output, 0);                  // compression method: stored
-    WriteShort(&output, 0);                  // last modified time
-    WriteShort(&output, kDosEpoch);          // last modified date
-    output.WriteLittleEndian32(crc32);       // crc-32
-    output.WriteLittleEndian32(size);        // compressed size
-    output.WriteLittleEndian32(size);        // uncompressed size
+    bool deflated = files_[i].deflated;
+
+    output.WriteLittleEndian32(0x02014b50);   // magic
+    WriteShort(&output, 10);                  // version made by
+    WriteShort(&output, deflated ? 20 : 10);  // version needed to extract
+    WriteShort(&output, 0);                   // flags
+    WriteShort(&output, deflated ? 8 : 0);    // compression method
+    WriteShort(&output, 0);                   // last modified time
+    WriteShort(&output, kDosEpoch);           // last modified date
+    output.WriteLittleEndian32(crc32);        // crc-32
+    output.WriteLittleEndian32(compressed_size);  // compressed size
+    output.WriteLittleEndian32(size);             // uncompressed size
     WriteShort(&output, filename_size);      // file name length
     WriteShort(&output, 0);                  // extra field length
     WriteShort(&output, 0);                  // file comment length
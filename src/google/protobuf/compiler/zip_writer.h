@@ -10,6 +10,7 @@
 #define GOOGLE_PROTOBUF_COMPILER_ZIP_WRITER_H__
 
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include "google/protobuf/stubs/common.h"
@@ -21,10 +22,29 @@ namespace compiler {
 
 class ZipWriter {
  public:
+  // A file prepared for Write(). Entries may be made on other threads, e.g.
+  // to compress several files at once.
+  struct Entry {
+    std::string name;
+    // The contents of the file, compressed if `deflated`.
+    std::string data;
+    // The uncompressed size and CRC-32 of the contents.
+    uint32_t size = 0;
+    uint32_t crc32 = 0;
+    bool deflated = false;
+  };
+
   ZipWriter(io::ZeroCopyOutputStream* raw_output);
   ~ZipWriter();
 
+  // Makes the entry of a file. If `deflate` is true, its contents are
+  // compressed with deflate, unless protoc was built without zlib or that
+  // would not make them smaller.
+  static Entry MakeEntry(std::string filename, std::string contents,
+                         bool deflate);
+
   bool Write(const std::string& filename, const std::string& contents);
+  bool Write(const Entry& entry);
   bool WriteDirectory();
 
  private:
@@ -32,9 +52,14 @@ class ZipWriter {
     std::string name;
     uint32_t offset;
     uint32_t size;
+    uint32_t compressed_size;
     uint32_t crc32;
+    bool deflated;
   };
 
+  bool WriteFile(const std::string& filename, const std::string& data,
+                 uint32_t size, uint32_t crc32, bool deflated);
+
   io::ZeroCopyOutputStream* raw_output_;
   std::vector<FileInfo> files_;
 };
@@ -20,6 +20,7 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -47,6 +48,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"
 #include "absl/strings/substitute.h"
+#include "absl/synchronization/blocking_counter.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
 #include "google/protobuf/any.h"
@@ -58,6 +60,7 @@
 #include "google/protobuf/descriptor_visitor.h"
 #include "google/protobuf/dynamic_message.h"
 #include "google/protobuf/feature_resolver.h"
+#include "google/protobuf/generated_message_reflection.h"
 #include "google/protobuf/generated_message_util.h"
 #include "google/protobuf/io/strtod.h"
 #include "google/protobuf/io/tokenizer.h"
@@ -266,6 +269,18 @@ class FlatAllocation {
   template <int I>
   using type = typename std::tuple_element<I, std::tuple<T...>>::type;
 
+  // The bytes of the allocation, and of the heap storage of its strings.
+  size_t SpaceUsed() const {
+    static const size_t inline_capacity = std::string().capacity();
+    size_t total = total_bytes();
+    for (const std::string *it = Begin<std::string>(),
+                           *end = End<std::string>();
+         it != end; ++it) {
+      if (it->capacity() > inline_capacity) total += it->capacity() + 1;
+    }
+    return total;
+  }
+
   // Gets a tuple of the head pointers for the arrays
   TypeMap<PointerT, T...> Pointers() const {
     TypeMap<PointerT, T...> out;
@@ -1178,8 +1193,125 @@ const FeatureSet& GetParentFeatures(const ServiceDescriptor* service) {
 const FeatureSet& GetParentFeatures(const MethodDescriptor* method) {
   return internal::InternalFeatureHelper::GetFeatures(*method->service());
 }
+
+// An estimate of the memory used by the slots of a hash table.
+template <typename Table>
+size_t HashTableBytes(const Table& table) {
+  // One control byte per slot.
+  return table.capacity() * (sizeof(typename Table::value_type) + 1);
+}
 }  // anonymous namespace
 
+namespace internal {
+
+// Finds the fields of one message by number and by name. The file's tables
+// hold the fields of all its messages, so consecutive lookups in one message
+// touch unrelated cache lines; this index keeps a message's fields together,
+// in arrays sized for that message.
+class FieldLookupIndex {
+ public:
+  explicit FieldLookupIndex(const Descriptor* descriptor) {
+    const int count = descriptor->field_count();
+    int min_number = std::numeric_limits<int>::max();
+    int max_number = std::numeric_limits<int>::min();
+    for (int i = 0; i < count; ++i) {
+      min_number = std::min(min_number, descriptor->field(i)->number());
+      max_number = std::max(max_number, descriptor->field(i)->number());
+    }
+    // Numbers are indexed directly when at most about half of the range is
+    // unused, and searched otherwise.
+    if (count > 0 && static_cast<int64_t>(max_number) - min_number <
+                         2 * static_cast<int64_t>(count) + kMaxDenseGap) {
+      min_number_ = min_number;
+      by_number_.resize(max_number - min_number + 1);
+      for (int i = 0; i < count; ++i) {
+        by_number_[descriptor->field(i)->number() - min_number] = i + 1;
+      }
+    } else {
+      sorted_numbers_.reserve(count);
+      for (int i = 0; i < count; ++i) {
+        sorted_numbers_.emplace_back(descriptor->field(i)->number(), i);
+      }
+      std::sort(sorted_numbers_.begin(), sorted_numbers_.end());
+    }
+
+    size_t slots = 2;
+    while (slots < 2 * static_cast<size_t>(count)) slots *= 2;
+    by_name_.resize(slots);
+    for (int i = 0; i < count; ++i) {
+      const size_t hash = absl::HashOf(descriptor->field(i)->name());
+      size_t slot = hash & (slots - 1);
+      while (by_name_[slot].field != 0) slot = (slot + 1) & (slots - 1);
+      by_name_[slot] = {static_cast<uint32_t>(i + 1), Tag(hash)};
+    }
+  }
+
+  const FieldDescriptor* FindByNumber(const Descriptor* descriptor,
+                                      int number) const {
+    if (!sorted_numbers_.empty()) {
+      auto it = std::lower_bound(sorted_numbers_.begin(), sorted_numbers_.end(),
+                                 std::make_pair(number, 0));
+      return it != sorted_numbers_.end() && it->first == number
+                 ? descriptor->field(it->second)
+                 : nullptr;
+    }
+    // Unsigned, so that numbers below the range are out of range too.
+    const uint64_t offset = static_cast<uint64_t>(
+        static_cast<int64_t>(number) - static_cast<int64_t>(min_number_));
+    if (offset >= by_number_.size() || by_number_[offset] == 0) return nullptr;
+    return descriptor->field(by_number_[offset] - 1);
+  }
+
+  const FieldDescriptor* FindByName(const Descriptor* descriptor,
+                                    absl::string_view name) const {
+    const size_t hash = absl::HashOf(name);
+    const uint32_t tag = Tag(hash);
+    const size_t mask = by_name_.size() - 1;
+    for (size_t slot = hash & mask; by_name_[slot].field != 0;
+         slot = (slot + 1) & mask) {
+      if (by_name_[slot].tag != tag) continue;
+      const FieldDescriptor* field = descriptor->field(by_name_[slot].field - 1);
+      if (field->name() == name) return field;
+    }
+    return nullptr;
+  }
+
+  size_t SpaceUsedExcludingSelf() const {
+    return by_number_.capacity() * sizeof(by_number_[0]) +
+           sorted_numbers_.capacity() * sizeof(sorted_numbers_[0]) +
+           by_name_.capacity() * sizeof(by_name_[0]);
+  }
+
+ private:
+  // Ranges of numbers are indexed directly if they have at most this many
+  // more unused numbers than fields.
+  static constexpr int64_t kMaxDenseGap = 16;
+
+  struct NameSlot {
+    // 1 + the index of the field, or 0 for an empty slot.
+    uint32_t field;
+    // Other bits of the hash of the name, so that most mismatches are found
+    // without reading the field.
+    uint32_t tag;
+  };
+
+  // The high half of the hash; the low bits pick the slot.
+  static uint32_t Tag(size_t hash) {
+    return static_cast<uint32_t>(hash >> (sizeof(size_t) * 4));
+  }
+
+  // 1 + the index of the field numbered `min_number_ + i`, or 0 if there is
+  // none. Empty if the numbers are too sparse for a direct index.
+  int min_number_ = 0;
+  std::vector<uint32_t> by_number_;
+  // (number, index) of each field, sorted, if `by_number_` is not used.
+  std::vector<std::pair<int, int>> sorted_numbers_;
+  // An open-addressed table of the fields by name, at most half full.
+  std::vector<NameSlot> by_name_;
+};
+
+}  // namespace internal
+
 // Contains tables specific to a particular file.  These tables are not
 // modified once the file has been constructed, so they need not be
 // protected by a mutex.  This makes operations that depend only on the
@@ -1214,6 +1346,8 @@ class FileDescriptorTables {
       const void* parent, absl::string_view lowercase_name) const;
   inline const FieldDescriptor* FindFieldByCamelcaseName(
       const void* parent, absl::string_view camelcase_name) const;
+  inline const FieldDescriptor* FindFieldByJsonName(
+      const Descriptor* parent, absl::string_view json_name) const;
   inline const EnumValueDescriptor* FindEnumValueByNumber(
       const EnumDescriptor* parent, int number) const;
   // This creates a new EnumValueDescriptor if not found, in a thread-safe way.
@@ -1246,6 +1380,14 @@ class FileDescriptorTables {
   // we are going to roll back to the last checkpoint.
   void FinalizeTables();
 
+  // The memory held by the tables, not counting the object itself.
+  size_t SpaceUsedExcludingSelf() const;
+
+  // Returns the field index of `descriptor`, a message of this file, building
+  // it on first use.
+  const internal::FieldLookupIndex& GetFieldLookupIndex(
+      const Descriptor* descriptor) const;
+
  private:
   const void* FindParentForFieldsByMap(const FieldDescriptor* field) const;
   static void FieldsByLowercaseNamesLazyInitStatic(
@@ -1254,15 +1396,21 @@ class FileDescriptorTables {
   static void FieldsByCamelcaseNamesLazyInitStatic(
       const FileDescriptorTables* tables);
   void FieldsByCamelcaseNamesLazyInitInternal() const;
+  static void FieldsByJsonNamesLazyInitStatic(
+      const FileDescriptorTables* tables);
+  void FieldsByJsonNamesLazyInitInternal() const;
 
   SymbolsByParentSet symbols_by_parent_;
   mutable absl::once_flag fields_by_lowercase_name_once_;
   mutable absl::once_flag fields_by_camelcase_name_once_;
+  mutable absl::once_flag fields_by_json_name_once_;
   // Make these fields atomic to avoid race conditions with
   // GetEstimatedOwnedMemoryBytesSize. Once the pointer is set the map won't
   // change anymore.
   mutable std::atomic<const FieldsByNameMap*> fields_by_lowercase_name_{};
   mutable std::atomic<const FieldsByNameMap*> fields_by_camelcase_name_{};
+  // Every name the JSON parser accepts for a field, not including extensions.
+  mutable std::atomic<const FieldsByNameMap*> fields_by_json_name_{};
   FieldsByNumberSet fields_by_number_;  // Not including extensions.
   EnumValuesByNumberSet enum_values_by_number_;
   mutable EnumValuesByNumberSet unknown_enum_values_by_number_
@@ -1275,6 +1423,11 @@ class FileDescriptorTables {
   // Mutex to protect the unknown-enum-value map due to dynamic
   // EnumValueDescriptor creation on unknown values.
   mutable absl::Mutex unknown_enum_values_mu_;
+
+  // Owns the indexes pointed to by Descriptor::field_lookup_index_.
+  mutable absl::Mutex field_lookup_indexes_mu_;
+  mutable std::vector<std::unique_ptr<const internal::FieldLookupIndex>>
+      field_lookup_indexes_ ABSL_GUARDED_BY(field_lookup_indexes_mu_);
 };
 
 namespace internal {
@@ -1409,6 +1562,24 @@ class DescriptorPool::Tables {
   // allocation owned by the pool.
   const FeatureSet* InternFeatureSet(FeatureSet&& features);
 
+  // Merged feature sets, keyed by edition, merged parent features and the
+  // unmerged child features, all interned.  Lets descriptors with the same
+  // features under the same parent share one merge.
+  using MergedFeaturesKey =
+      std::tuple<Edition, const FeatureSet*, const FeatureSet*>;
+  absl::flat_hash_map<MergedFeaturesKey, const FeatureSet*>
+      merged_features_cache_;
+
+  // Returns the first options message interned that is equal to `options`,
+  // which must be owned by the pool.  If that is not `options` itself,
+  // `options` is cleared.  Used by compact descriptors.
+  template <typename OptionsT>
+  const OptionsT* InternOptions(OptionsT* options);
+
+  // For DescriptorPool::GetMemoryUsage().
+  size_t DescriptorBytes() const;
+  void ListFiles(std::vector<const FileDescriptor*>* files) const;
+
   // -----------------------------------------------------------------
   // Allocating memory.
 
@@ -1460,6 +1631,12 @@ class DescriptorPool::Tables {
   absl::flat_hash_map<std::string, std::unique_ptr<FeatureSet>>
       feature_set_cache_;
 
+  // The options shared by compact descriptors, keyed by the default instance
+  // of their type and their serialization.  The messages live in the flat
+  // allocations of the files that first had them.
+  using OptionsKey = std::pair<const Message*, std::string>;
+  absl::flat_hash_map<OptionsKey, const Message*> options_cache_;
+
   struct CheckPoint {
     explicit CheckPoint(const Tables* tables)
         : flat_allocations_before_checkpoint(
@@ -1471,17 +1648,21 @@ class DescriptorPool::Tables {
           pending_files_before_checkpoint(
               tables->files_after_checkpoint_.size()),
           pending_extensions_before_checkpoint(
-              tables->extensions_after_checkpoint_.size()) {}
+              tables->extensions_after_checkpoint_.size()),
+          pending_options_before_checkpoint(
+              tables->options_after_checkpoint_.size()) {}
     int flat_allocations_before_checkpoint;
     int misc_allocations_before_checkpoint;
     int pending_symbols_before_checkpoint;
     int pending_files_before_checkpoint;
     int pending_extensions_before_checkpoint;
+    int pending_options_before_checkpoint;
   };
   std::vector<CheckPoint> checkpoints_;
   std::vector<Symbol> symbols_after_checkpoint_;
   std::vector<const FileDescriptor*> files_after_checkpoint_;
   std::vector<std::pair<const Descriptor*, int>> extensions_after_checkpoint_;
+  std::vector<OptionsKey> options_after_checkpoint_;
 };
 
 DescriptorPool::Tables::Tables() {
@@ -1512,6 +1693,7 @@ FileDescriptorTables::FileDescriptorTables() {}
 FileDescriptorTables::~FileDescriptorTables() {
   delete fields_by_lowercase_name_.load(std::memory_order_acquire);
   delete fields_by_camelcase_name_.load(std::memory_order_acquire);
+  delete fields_by_json_name_.load(std::memory_order_acquire);
 }
 
 inline const FileDescriptorTables& FileDescriptorTables::GetEmptyInstance() {
@@ -1533,6 +1715,7 @@ void DescriptorPool::Tables::ClearLastCheckpoint() {
     symbols_after_checkpoint_.clear();
     files_after_checkpoint_.clear();
     extensions_after_checkpoint_.clear();
+    options_after_checkpoint_.clear();
   }
 }
 
@@ -1552,12 +1735,18 @@ void DescriptorPool::Tables::RollbackToLastCheckpoint() {
        i < extensions_after_checkpoint_.size(); i++) {
     extensions_.erase(extensions_after_checkpoint_[i]);
   }
+  for (size_t i = checkpoint.pending_options_before_checkpoint;
+       i < options_after_checkpoint_.size(); i++) {
+    options_cache_.erase(options_after_checkpoint_[i]);
+  }
 
   symbols_after_checkpoint_.resize(
       checkpoint.pending_symbols_before_checkpoint);
   files_after_checkpoint_.resize(checkpoint.pending_files_before_checkpoint);
   extensions_after_checkpoint_.resize(
       checkpoint.pending_extensions_before_checkpoint);
+  options_after_checkpoint_.resize(
+      checkpoint.pending_options_before_checkpoint);
 
   flat_allocs_.resize(checkpoint.flat_allocations_before_checkpoint);
   misc_allocs_.resize(checkpoint.misc_allocations_before_checkpoint);
@@ -1703,6 +1892,55 @@ inline const FieldDescriptor* FileDescriptorTables::FindFieldByCamelcaseName(
   return it->second;
 }
 
+void FileDescriptorTables::FieldsByJsonNamesLazyInitStatic(
+    const FileDescriptorTables* tables) {
+  tables->FieldsByJsonNamesLazyInitInternal();
+}
+
+void FileDescriptorTables::FieldsByJsonNamesLazyInitInternal() const {
+  std::vector<const FieldDescriptor*> fields;
+  for (Symbol symbol : symbols_by_parent_) {
+    const FieldDescriptor* field = symbol.field_descriptor();
+    if (field != nullptr && !field->is_extension()) fields.push_back(field);
+  }
+  // When names collide, camel-case names win over names, which win over
+  // custom json_names, as if they were looked up one kind after the other.
+  // Among equal camel-case names the smallest field number wins, like in
+  // fields_by_camelcase_name_, and among equal json_names the first field.
+  std::sort(fields.begin(), fields.end(),
+            [](const FieldDescriptor* a, const FieldDescriptor* b) {
+              return a->number() < b->number();
+            });
+  auto* map = new FieldsByNameMap;
+  for (const FieldDescriptor* field : fields) {
+    map->try_emplace({field->containing_type(), field->camelcase_name()},
+                     field);
+  }
+  for (const FieldDescriptor* field : fields) {
+    map->try_emplace({field->containing_type(), field->name()}, field);
+  }
+  std::sort(fields.begin(), fields.end(),
+            [](const FieldDescriptor* a, const FieldDescriptor* b) {
+              return a->index() < b->index();
+            });
+  for (const FieldDescriptor* field : fields) {
+    if (field->has_json_name()) {
+      map->try_emplace({field->containing_type(), field->json_name()}, field);
+    }
+  }
+  fields_by_json_name_.store(map, std::memory_order_release);
+}
+
+inline const FieldDescriptor* FileDescriptorTables::FindFieldByJsonName(
+    const Descriptor* parent, absl::string_view json_name) const {
+  absl::call_once(fields_by_json_name_once_,
+                  FileDescriptorTables::FieldsByJsonNamesLazyInitStatic, this);
+  auto* fields = fields_by_json_name_.load(std::memory_order_acquire);
+  auto it = fields->find({parent, json_name});
+  if (it == fields->end()) return nullptr;
+  return it->second;
+}
+
 inline const EnumValueDescriptor* FileDescriptorTables::FindEnumValueByNumber(
     const EnumDescriptor* parent, int number) const {
   // If `number` is within the sequential range, just index into the parent
@@ -1825,6 +2063,40 @@ bool DescriptorPool::Tables::AddFile(const FileDescriptor* file) {
 
 void FileDescriptorTables::FinalizeTables() {}
 
+size_t FileDescriptorTables::SpaceUsedExcludingSelf() const {
+  size_t total = HashTableBytes(symbols_by_parent_) +
+                 HashTableBytes(fields_by_number_) +
+                 HashTableBytes(enum_values_by_number_);
+  for (const FieldsByNameMap* map : {fields_by_lowercase_name_.load(),
+                                     fields_by_camelcase_name_.load(),
+                                     fields_by_json_name_.load()}) {
+    if (map != nullptr) total += sizeof(*map) + HashTableBytes(*map);
+  }
+  {
+    absl::MutexLock lock(&field_lookup_indexes_mu_);
+    for (const auto& index : field_lookup_indexes_) {
+      total += sizeof(*index) + index->SpaceUsedExcludingSelf();
+    }
+  }
+  absl::ReaderMutexLock lock(&unknown_enum_values_mu_);
+  return total + HashTableBytes(unknown_enum_values_by_number_);
+}
+
+const internal::FieldLookupIndex& FileDescriptorTables::GetFieldLookupIndex(
+    const Descriptor* descriptor) const {
+  const internal::FieldLookupIndex* index =
+      descriptor->field_lookup_index_.load(std::memory_order_acquire);
+  if (index != nullptr) return *index;
+  absl::MutexLock lock(&field_lookup_indexes_mu_);
+  index = descriptor->field_lookup_index_.load(std::memory_order_relaxed);
+  if (index != nullptr) return *index;
+  field_lookup_indexes_.push_back(
+      std::make_unique<internal::FieldLookupIndex>(descriptor));
+  index = field_lookup_indexes_.back().get();
+  descriptor->field_lookup_index_.store(index, std::memory_order_release);
+  return *index;
+}
+
 bool FileDescriptorTables::AddFieldByNumber(FieldDescriptor* field) {
   // Skip fields that are at the start of the sequence.
   if (field->containing_type() != nullptr && field->number() >= 1 &&
@@ -1874,6 +2146,44 @@ const FeatureSet* DescriptorPool::Tables::InternFeatureSet(
   return result.get();
 }
 
+template <typename OptionsT>
+const OptionsT* DescriptorPool::Tables::InternOptions(OptionsT* options) {
+  // The default instance tells the options types apart without reflection,
+  // which could deadlock while the pool is locked.
+  OptionsKey key(&OptionsT::default_instance(), options->SerializeAsString());
+  auto it_inserted = options_cache_.try_emplace(key, options);
+  if (it_inserted.second) {
+    options_after_checkpoint_.push_back(std::move(key));
+    return options;
+  }
+  options->Clear();
+  return static_cast<const OptionsT*>(it_inserted.first->second);
+}
+
+size_t DescriptorPool::Tables::DescriptorBytes() const {
+  size_t total = 0;
+  for (const auto& alloc : flat_allocs_) total += alloc->SpaceUsed();
+  for (const auto& alloc : misc_allocs_) {
+    total += *alloc + RoundUpTo<8>(sizeof(int));
+  }
+  for (const FileDescriptor* file : files_by_name_) {
+    total += file->tables_->SpaceUsedExcludingSelf();
+  }
+  total += HashTableBytes(symbols_by_name_) + HashTableBytes(files_by_name_) +
+           HashTableBytes(options_cache_) +
+           extensions_.size() *
+               sizeof(ExtensionsGroupedByDescriptorMap::value_type);
+  for (const auto& entry : options_cache_) {
+    total += entry.first.second.capacity();
+  }
+  return total;
+}
+
+void DescriptorPool::Tables::ListFiles(
+    std::vector<const FileDescriptor*>* files) const {
+  files->insert(files->end(), files_by_name_.begin(), files_by_name_.end());
+}
+
 // -------------------------------------------------------------------
 
 template <typename Type>
@@ -2055,6 +2365,23 @@ bool DescriptorPool::InternalIsFileLoaded(absl::string_view filename) const {
 namespace {
 
 
+// Set while this thread adds the lazily registered files to the generated
+// pool, or builds a file in the generated pool and so holds its lock.  Adding
+// a file takes that lock, so generated_pool() leaves the files to a later call.
+PROTOBUF_THREAD_LOCAL bool updating_generated_pool = false;
+
+class GeneratedPoolUpdateScope {
+ public:
+  explicit GeneratedPoolUpdateScope(bool active)
+      : previous_(updating_generated_pool) {
+    if (active) updating_generated_pool = true;
+  }
+  ~GeneratedPoolUpdateScope() { updating_generated_pool = previous_; }
+
+ private:
+  bool previous_;
+};
+
 EncodedDescriptorDatabase* GeneratedDatabase() {
   static auto generated_database =
       internal::OnShutdownDelete(new EncodedDescriptorDatabase());
@@ -2081,6 +2408,14 @@ DescriptorPool* DescriptorPool::internal_generated_pool() {
 
 const DescriptorPool* DescriptorPool::generated_pool() {
   const DescriptorPool* pool = internal_generated_pool();
+  // Add the files generated with lazy_descriptor_registration.  This is left
+  // to a later call when this thread is already updating the pool, as it is
+  // when building one of its files, since adding a file locks it.  Other
+  // threads holding the lock only delay this one.
+  if (internal::HasLazyDescriptors() && !updating_generated_pool) {
+    GeneratedPoolUpdateScope scope(true);
+    internal::AddLazyDescriptors();
+  }
   // Ensure that descriptor.proto and cpp_features.proto get registered in the
   // generated pool. They're special cases because they're included in the full
   // runtime. We have to avoid registering it pre-main, because we need to
@@ -2329,16 +2664,129 @@ void DescriptorPool::FindAllExtensions(
   }
 }
 
+bool DescriptorPool::PreloadAllFiles(
+    const std::function<void(std::function<void()> task)>& executor) const {
+  if (fallback_database_ == nullptr) return true;
+
+  std::vector<std::string> names;
+  std::vector<FileDescriptorProto> protos;
+  std::vector<char> found;
+  // Fetches files [begin, end) from the database.
+  const auto fetch = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      found[i] = fallback_database_->FindFileByName(names[i], &protos[i]);
+    }
+  };
+  size_t fetched = 0;
+  {
+    absl::MutexLock lock(mutex_);
+    if (!fallback_database_->FindAllFileNames(&names)) return false;
+    protos.resize(names.size());
+    found.resize(names.size());
+    // Without an executor, fetch everything here.  Otherwise fetch one file,
+    // so that databases which index lazily do so before the concurrent
+    // lookups.
+    fetched = executor == nullptr ? names.size() : std::min<size_t>(
+                                                       1, names.size());
+    fetch(0, fetched);
+  }
+  if (fetched < names.size()) {
+    constexpr size_t kFilesPerTask = 16;
+    const size_t num_tasks =
+        (names.size() - fetched + kFilesPerTask - 1) / kFilesPerTask;
+    absl::BlockingCounter done(static_cast<int>(num_tasks));
+    for (size_t begin = fetched; begin < names.size();
+         begin += kFilesPerTask) {
+      const size_t end = std::min(names.size(), begin + kFilesPerTask);
+      executor([&fetch, &done, begin, end] {
+        fetch(begin, end);
+        done.DecrementCount();
+      });
+    }
+    done.Wait();
+  }
+
+  absl::MutexLock lock(mutex_);
+  tables_->known_bad_symbols_.clear();
+  tables_->known_bad_files_.clear();
+  absl::flat_hash_map<absl::string_view, const FileDescriptorProto*> by_name;
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (found[i]) by_name.emplace(protos[i].name(), &protos[i]);
+  }
+  bool success = true;
+  absl::flat_hash_set<absl::string_view> visited;
+  // Builds `proto` after the dependencies that were fetched, so that building
+  // it doesn't go back to the database for them.
+  const auto build = [&](const auto& build,
+                         const FileDescriptorProto& proto) -> void {
+    if (!visited.insert(proto.name()).second) return;
+    for (const std::string& dependency : proto.dependency()) {
+      auto it = by_name.find(dependency);
+      if (it != by_name.end()) build(build, *it->second);
+    }
+    if (tables_->FindFile(proto.name()) != nullptr ||
+        (underlay_ != nullptr &&
+         underlay_->FindFileByName(proto.name()) != nullptr)) {
+      return;
+    }
+    if (BuildFileFromDatabase(proto) == nullptr) success = false;
+  };
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (!found[i]) {
+      success = false;
+      continue;
+    }
+    build(build, protos[i]);
+  }
+  return success;
+}
+
+DescriptorPool::MemoryUsage DescriptorPool::GetMemoryUsage() const {
+  MemoryUsage usage;
+  // Options and source code info are measured by reflection, which may need
+  // the generated pool, so that happens once this pool is unlocked.  Their
+  // own size is part of descriptor_bytes already.
+  std::vector<std::pair<const Message*, size_t>> options;
+  std::vector<const SourceCodeInfo*> source_code_infos;
+  {
+    absl::MutexLockMaybe lock(mutex_);
+    usage.descriptor_bytes = tables_->DescriptorBytes();
+    absl::flat_hash_set<const Message*> seen;
+    std::vector<const FileDescriptor*> files;
+    tables_->ListFiles(&files);
+    for (const FileDescriptor* file : files) {
+      if (file->source_code_info_ != &SourceCodeInfo::default_instance()) {
+        source_code_infos.push_back(file->source_code_info_);
+      }
+      internal::VisitDescriptors(*file, [&](const auto& descriptor) {
+        using OptionsT = std::decay_t<decltype(descriptor.options())>;
+        const Message* message = &descriptor.options();
+        if (message == &OptionsT::default_instance()) return;
+        if (seen.insert(message).second) {
+          options.emplace_back(message, sizeof(OptionsT));
+        } else {
+          ++usage.shared_options;
+        }
+      });
+    }
+  }
+  for (const auto& entry : options) {
+    usage.options_bytes += entry.first->SpaceUsedLong() - entry.second;
+  }
+  for (const SourceCodeInfo* info : source_code_infos) {
+    usage.source_code_info_bytes += info->SpaceUsedLong() - sizeof(*info);
+  }
+  return usage;
+}
+
 
 // -------------------------------------------------------------------
 
 const FieldDescriptor* Descriptor::FindFieldByNumber(int key) const {
-  const FieldDescriptor* result = file()->tables_->FindFieldByNumber(this, key);
-  if (result == nullptr || result->is_extension()) {
-    return nullptr;
-  } else {
-    return result;
-  }
+  if (1 <= key && key <= sequential_field_limit_) return field(key - 1);
+  // All fields are in the sequential range.
+  if (sequential_field_limit_ == field_count_) return nullptr;
+  return file()->tables_->GetFieldLookupIndex(this).FindByNumber(this, key);
 }
 
 const FieldDescriptor* Descriptor::FindFieldByLowercaseName(
@@ -2363,11 +2811,17 @@ const FieldDescriptor* Descriptor::FindFieldByCamelcaseName(
   }
 }
 
+namespace internal {
+const FieldDescriptor* FindFieldByJsonKey(const Descriptor* message,
+                                          absl::string_view key) {
+  return message->file()->tables_->FindFieldByJsonName(message, key);
+}
+}  // namespace internal
+
 const FieldDescriptor* Descriptor::FindFieldByName(
     absl::string_view key) const {
-  const FieldDescriptor* field =
-      file()->tables_->FindNestedSymbol(this, key).field_descriptor();
-  return field != nullptr && !field->is_extension() ? field : nullptr;
+  if (field_count_ == 0) return nullptr;
+  return file()->tables_->GetFieldLookupIndex(this).FindByName(this, key);
 }
 
 const OneofDescriptor* Descriptor::FindOneofByName(
@@ -4181,6 +4635,11 @@ class DescriptorBuilder {
       absl::Span<const int> options_path, absl::string_view option_name,
       internal::FlatAllocator& alloc);
 
+  // For compact descriptors, replaces the options of `descriptor`, once they
+  // are interpreted and validated, by an equal message shared in the pool.
+  template <class DescriptorT>
+  void InternOptions(const DescriptorT& descriptor);
+
   // Allocates and resolves any feature sets that need to be owned by a given
   // descriptor. This also strips features out of the mutable options message to
   // prevent leaking of unresolved features.
@@ -4972,6 +5431,8 @@ Symbol DescriptorPool::NewPlaceholderWithMutexHeld(
     placeholder_message->merged_features_ = &FeatureSet::default_instance();
     placeholder_message->is_placeholder_ = true;
     placeholder_message->is_unqualified_placeholder_ = (name[0] != '.');
+    placeholder_message->generated_prototype_ = nullptr;
+    placeholder_message->field_lookup_index_ = nullptr;
 
     if (placeholder_type == PLACEHOLDER_EXTENDABLE_MESSAGE) {
       placeholder_message->extension_range_count_ = 1;
@@ -5240,6 +5701,17 @@ typename DescriptorT::OptionsType* DescriptorBuilder::AllocateOptionsImpl(
   return options;
 }
 
+template <class DescriptorT>
+void DescriptorBuilder::InternOptions(const DescriptorT& descriptor) {
+  using OptionsT = typename DescriptorT::OptionsType;
+  if (descriptor.options_ == nullptr ||
+      descriptor.options_ == &OptionsT::default_instance()) {
+    return;
+  }
+  const_cast<DescriptorT&>(descriptor).options_ =
+      tables_->InternOptions(const_cast<OptionsT*>(descriptor.options_));
+}
+
 template <class ProtoT, class OptionsT>
 static void InferLegacyProtoFeatures(const ProtoT& proto,
                                      const OptionsT& options,
@@ -5317,6 +5789,19 @@ void DescriptorBuilder::ResolveFeaturesImpl(
     return;
   }
 
+  // Under editions nothing was inferred, so the merge only depends on the
+  // edition and the interned parent and child features.
+  const FeatureSet** cached = nullptr;
+  if (GetDescriptorSyntax(descriptor) ==
+      FileDescriptorLegacy::SYNTAX_EDITIONS) {
+    cached = &tables_->merged_features_cache_[{
+        file_->edition_, &parent_features, descriptor->proto_features_}];
+    if (*cached != nullptr) {
+      descriptor->merged_features_ = *cached;
+      return;
+    }
+  }
+
   // Calculate the merged features for this target.
   absl::StatusOr<FeatureSet> merged =
       feature_resolver_->MergeFeatures(parent_features, base_features);
@@ -5327,6 +5812,7 @@ void DescriptorBuilder::ResolveFeaturesImpl(
   }
 
   descriptor->merged_features_ = tables_->InternFeatureSet(*std::move(merged));
+  if (cached != nullptr) *cached = descriptor->merged_features_;
 }
 
 template <class DescriptorT>
@@ -5542,12 +6028,15 @@ static void PlanAllocationSize(
 }
 
 static void PlanAllocationSize(const FileDescriptorProto& proto,
+                               bool keep_source_code_info,
                                internal::FlatAllocator& alloc) {
   alloc.PlanArray<FileDescriptor>(1);
   alloc.PlanArray<FileDescriptorTables>(1);
   alloc.PlanArray<std::string>(2);  // name + package
   if (proto.has_options()) alloc.PlanArray<FileOptions>(1);
-  if (proto.has_source_code_info()) alloc.PlanArray<SourceCodeInfo>(1);
+  if (proto.has_source_code_info() && keep_source_code_info) {
+    alloc.PlanArray<SourceCodeInfo>(1);
+  }
 
   PlanAllocationSize(proto.service(), alloc);
   PlanAllocationSize(proto.message_type(), alloc);
@@ -5561,6 +6050,8 @@ static void PlanAllocationSize(const FileDescriptorProto& proto,
 
 const FileDescriptor* DescriptorBuilder::BuildFile(
     const FileDescriptorProto& original_proto) {
+  GeneratedPoolUpdateScope scope(pool_ ==
+                                 DescriptorPool::internal_generated_pool());
   filename_ = original_proto.name();
 
   const FileDescriptorProto& proto = original_proto;
@@ -5627,7 +6118,7 @@ const FileDescriptor* DescriptorBuilder::BuildFile(
   tables_->AddCheckpoint();
 
   auto alloc = absl::make_unique<internal::FlatAllocator>();
-  PlanAllocationSize(proto, *alloc);
+  PlanAllocationSize(proto, !pool_->compact_descriptors_, *alloc);
   alloc->FinalizePlanning(tables_);
   FileDescriptor* result = BuildFileImpl(proto, *alloc);
 
@@ -5684,7 +6175,7 @@ FileDescriptor* DescriptorBuilder::BuildFileImpl(
   result->is_placeholder_ = false;
   result->finished_building_ = false;
   SourceCodeInfo* info = nullptr;
-  if (proto.has_source_code_info()) {
+  if (proto.has_source_code_info() && !pool_->compact_descriptors_) {
     info = alloc.AllocateArray<SourceCodeInfo>(1);
     info->CopyFrom(proto.source_code_info());
     result->source_code_info_ = info;
@@ -5962,9 +6453,12 @@ FileDescriptor* DescriptorBuilder::BuildFileImpl(
 
   if (had_errors_) {
     return nullptr;
-  } else {
-    return result;
   }
+  if (pool_->compact_descriptors_) {
+    internal::VisitDescriptors(
+        *result, [&](const auto& descriptor) { InternOptions(descriptor); });
+  }
+  return result;
 }
 
 
@@ -6016,6 +6510,8 @@ void DescriptorBuilder::BuildMessage(const DescriptorProto& proto,
   result->is_unqualified_placeholder_ = false;
   result->well_known_type_ = Descriptor::WELLKNOWNTYPE_UNSPECIFIED;
   result->options_ = nullptr;  // Set to default_instance later if necessary.
+  result->generated_prototype_ = nullptr;
+  result->field_lookup_index_ = nullptr;
 
   auto it = pool_->tables_->well_known_types_.find(result->full_name());
   if (it != pool_->tables_->well_known_types_.end()) {
@@ -9064,7 +9560,8 @@ bool DescriptorBuilder::OptionInterpreter::SetOptionValue(
       const std::string& value_name = uninterpreted_option_->identifier_value();
       const EnumValueDescriptor* enum_value = nullptr;
 
-      if (enum_type->file()->pool() != DescriptorPool::generated_pool()) {
+      if (enum_type->file()->pool() !=
+          DescriptorPool::internal_generated_pool()) {
         // Note that the enum value's fully-qualified name is a sibling of the
         // enum's name, not a child of it.
         std::string fully_qualified_name = enum_type->full_name();
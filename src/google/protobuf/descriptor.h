@@ -33,6 +33,7 @@
 
 #include <atomic>
 #include <cstdint>
+#include <functional>
 #include <iterator>
 #include <memory>
 #include <string>
@@ -114,10 +115,26 @@ class MessageLite;
 class Message;
 class Reflection;
 
+// Defined in message.cc
+namespace internal {
+class GeneratedMessageFactory;
+}  // namespace internal
+
 // Defined in descriptor.cc
 class DescriptorBuilder;
 class FileDescriptorTables;
 class Symbol;
+namespace internal {
+class FieldLookupIndex;
+
+// Looks up a field of `message` by a key of a JSON object, for the JSON
+// parser.  The key may be the field's camel-case name, its name, or its
+// custom json_name; if several fields match, they are preferred in that
+// order.  Extensions are not found.  The names of all fields of the file are
+// indexed on the first call.
+PROTOBUF_EXPORT const FieldDescriptor* FindFieldByJsonKey(
+    const Descriptor* message, absl::string_view key);
+}  // namespace internal
 
 // Defined in unknown_field_set.h.
 class UnknownField;
@@ -703,6 +720,15 @@ class PROTOBUF_EXPORT Descriptor : private internal::SymbolBase {
   int reserved_range_count_;
   int reserved_name_count_;
 
+  // The prototype of a generated message type, cached here by the generated
+  // MessageFactory once the type is registered so that later GetPrototype()
+  // calls skip the factory's lock and map.
+  mutable std::atomic<const Message*> generated_prototype_;
+
+  // Index of the fields by number and name, built by FileDescriptorTables on
+  // the first lookup that the sequential range does not answer.
+  mutable std::atomic<const internal::FieldLookupIndex*> field_lookup_index_;
+
   // IMPORTANT:  If you add a new field, make sure to search for all instances
   // of Allocate<Descriptor>() and AllocateArray<Descriptor>() in descriptor.cc
   // and update them to initialize the field.
@@ -717,9 +743,10 @@ class PROTOBUF_EXPORT Descriptor : private internal::SymbolBase {
   friend class OneofDescriptor;
   friend class MethodDescriptor;
   friend class FileDescriptor;
+  friend class internal::GeneratedMessageFactory;
 };
 
-PROTOBUF_INTERNAL_CHECK_CLASS_SIZE(Descriptor, 152);
+PROTOBUF_INTERNAL_CHECK_CLASS_SIZE(Descriptor, 168);
 
 // Describes a single field of a message.  To get the descriptor for a given
 // field, first get the Descriptor for the message in which it is defined,
@@ -1995,6 +2022,9 @@ class PROTOBUF_EXPORT FileDescriptor : private internal::SymbolBase {
   const FeatureSet& features() const { return *merged_features_; }
   friend class internal::InternalFeatureHelper;
 
+  friend const FieldDescriptor* internal::FindFieldByJsonKey(
+      const Descriptor* message, absl::string_view key);
+
   // dependencies_once_ contain a once_flag followed by N NUL terminated
   // strings. Dependencies that do not need to be loaded will be empty. ie just
   // {'\0'}
@@ -2159,6 +2189,23 @@ class PROTOBUF_EXPORT DescriptorPool {
   void FindAllExtensions(const Descriptor* extendee,
                          std::vector<const FieldDescriptor*>* out) const;
 
+  // Builds every file of the fallback database that is not built yet, each
+  // after its dependencies, so that later lookups don't go to the database.
+  // Servers can call this during warmup instead of paying for cold lookups
+  // one at a time.  Returns false if the database can't list its files, see
+  // DescriptorDatabase::FindAllFileNames(), or if any file fails to build.
+  // Returns true for pools without a fallback database.
+  //
+  // If `executor` is given, it is called with tasks that fetch and parse the
+  // files from the database in parallel; building them into the pool then
+  // takes the pool's lock once.  The database must then support concurrent
+  // calls to FindFileByName(), which EncodedDescriptorDatabase,
+  // SimpleDescriptorDatabase and SnapshotDescriptorDatabase do as long as no
+  // files are added to them.  This returns once all tasks have run.
+  bool PreloadAllFiles(
+      const std::function<void(std::function<void()> task)>& executor =
+          nullptr) const;
+
   // Building descriptors --------------------------------------------
 
   // When converting a FileDescriptorProto to a FileDescriptor, various
@@ -2294,6 +2341,30 @@ class PROTOBUF_EXPORT DescriptorPool {
   void EnforceExtensionDeclarations(bool enforce) {
     enforce_extension_declarations_ = enforce;
   }
+
+  // Makes the descriptors built from now on smaller, for processes that hold
+  // many of them.  Source code info is dropped, so GetSourceLocation() finds
+  // nothing, and descriptors with equal options share one options message.
+  // GetMemoryUsage() reports the effect.
+  void UseCompactDescriptors(bool compact) { compact_descriptors_ = compact; }
+
+  // The memory held by the files built in a pool, not counting its underlay.
+  struct MemoryUsage {
+    // The descriptors, their names and the pool's lookup tables.
+    size_t descriptor_bytes = 0;
+    // The memory options messages and source code info hold beyond their
+    // part of descriptor_bytes.  Shared options messages count once.
+    size_t options_bytes = 0;
+    size_t source_code_info_bytes = 0;
+    // The number of descriptors whose options are shared with another one.
+    int shared_options = 0;
+
+    size_t total_bytes() const {
+      return descriptor_bytes + options_bytes + source_code_info_bytes;
+    }
+  };
+  MemoryUsage GetMemoryUsage() const;
+
   // Internal stuff --------------------------------------------------
   // These methods MUST NOT be called from outside the proto2 library.
   // These methods may contain hidden pitfalls and may be removed in a
@@ -2468,6 +2539,7 @@ class PROTOBUF_EXPORT DescriptorPool {
   bool disallow_enforce_utf8_;
   bool deprecated_legacy_json_field_conflicts_;
   mutable bool build_started_ = false;
+  bool compact_descriptors_ = false;
 
   // Set of files to track for unused imports. The bool value when true means
   // unused imports are treated as errors (and as warnings when false).
@@ -2838,8 +2838,9 @@ constexpr ::_pbi::TcParseTable<4, 13, 7, 79, 2> FileDescriptorProto::_table_ = {
     const auto& s = this->_internal_dependency().Get(i);
     ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(s.data(), static_cast<int>(s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
                                 "google.protobuf.FileDescriptorProto.dependency");
-    target = stream->WriteString(3, s, target);
   }
+  target = stream->WriteRepeatedStringMaybeAliased(
+      3, this->_internal_dependency(), target);
 
   // repeated .google.protobuf.DescriptorProto message_type = 4;
   for (unsigned i = 0,
@@ -3221,16 +3222,14 @@ PROTOBUF_NOINLINE void DescriptorProto_ExtensionRange::Clear() {
   // Prevent compiler warnings about cached_has_bits being unused
   (void) cached_has_bits;
 
+  ::memset(&_impl_.start_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.end_) -
+      reinterpret_cast<char*>(&_impl_.start_)) + sizeof(_impl_.end_));
   cached_has_bits = _impl_._has_bits_[0];
   if (cached_has_bits & 0x00000001u) {
     ABSL_DCHECK(_impl_.options_ != nullptr);
     _impl_.options_->Clear();
   }
-  if (cached_has_bits & 0x00000006u) {
-    ::memset(&_impl_.start_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.end_) -
-        reinterpret_cast<char*>(&_impl_.start_)) + sizeof(_impl_.end_));
-  }
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
@@ -3477,12 +3476,9 @@ PROTOBUF_NOINLINE void DescriptorProto_ReservedRange::Clear() {
   // Prevent compiler warnings about cached_has_bits being unused
   (void) cached_has_bits;
 
-  cached_has_bits = _impl_._has_bits_[0];
-  if (cached_has_bits & 0x00000003u) {
-    ::memset(&_impl_.start_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.end_) -
-        reinterpret_cast<char*>(&_impl_.start_)) + sizeof(_impl_.end_));
-  }
+  ::memset(&_impl_.start_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.end_) -
+      reinterpret_cast<char*>(&_impl_.start_)) + sizeof(_impl_.end_));
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
@@ -3951,8 +3947,9 @@ constexpr ::_pbi::TcParseTable<4, 10, 8, 65, 2> DescriptorProto::_table_ = {
     const auto& s = this->_internal_reserved_name().Get(i);
     ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(s.data(), static_cast<int>(s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
                                 "google.protobuf.DescriptorProto.reserved_name");
-    target = stream->WriteString(10, s, target);
   }
+  target = stream->WriteRepeatedStringMaybeAliased(
+      10, this->_internal_reserved_name(), target);
 
   if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
     target =
@@ -4224,6 +4221,9 @@ PROTOBUF_NOINLINE void ExtensionRangeOptions_Declaration::Clear() {
   // Prevent compiler warnings about cached_has_bits being unused
   (void) cached_has_bits;
 
+  ::memset(&_impl_.number_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.repeated_) -
+      reinterpret_cast<char*>(&_impl_.number_)) + sizeof(_impl_.repeated_));
   cached_has_bits = _impl_._has_bits_[0];
   if (cached_has_bits & 0x00000003u) {
     if (cached_has_bits & 0x00000001u) {
@@ -4233,11 +4233,6 @@ PROTOBUF_NOINLINE void ExtensionRangeOptions_Declaration::Clear() {
       _impl_.type_.ClearNonDefaultToEmpty();
     }
   }
-  if (cached_has_bits & 0x0000001cu) {
-    ::memset(&_impl_.number_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.repeated_) -
-        reinterpret_cast<char*>(&_impl_.number_)) + sizeof(_impl_.repeated_));
-  }
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
@@ -4933,6 +4928,9 @@ PROTOBUF_NOINLINE void FieldDescriptorProto::Clear() {
   // Prevent compiler warnings about cached_has_bits being unused
   (void) cached_has_bits;
 
+  ::memset(&_impl_.number_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.proto3_optional_) -
+      reinterpret_cast<char*>(&_impl_.number_)) + sizeof(_impl_.proto3_optional_));
   cached_has_bits = _impl_._has_bits_[0];
   if (cached_has_bits & 0x0000003fu) {
     if (cached_has_bits & 0x00000001u) {
@@ -4955,13 +4953,7 @@ PROTOBUF_NOINLINE void FieldDescriptorProto::Clear() {
       _impl_.options_->Clear();
     }
   }
-  if (cached_has_bits & 0x000000c0u) {
-    ::memset(&_impl_.number_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.oneof_index_) -
-        reinterpret_cast<char*>(&_impl_.number_)) + sizeof(_impl_.oneof_index_));
-  }
-  if (cached_has_bits & 0x00000700u) {
-    _impl_.proto3_optional_ = false;
+  if (cached_has_bits & 0x00000600u) {
     _impl_.label_ = 1;
     _impl_.type_ = 1;
   }
@@ -5085,88 +5077,90 @@ constexpr ::_pbi::TcParseTable<4, 11, 3, 96, 2> FieldDescriptorProto::_table_ =
   (void)cached_has_bits;
 
   cached_has_bits = _impl_._has_bits_[0];
-  // optional string name = 1;
-  if (cached_has_bits & 0x00000001u) {
-    const std::string& _s = this->_internal_name();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FieldDescriptorProto.name");
-    target = stream->WriteStringMaybeAliased(1, _s, target);
-  }
+  if ((cached_has_bits & 0x000007ffu) != 0) {
+    // optional string name = 1;
+    if (cached_has_bits & 0x00000001u) {
+      const std::string& _s = this->_internal_name();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FieldDescriptorProto.name");
+      target = stream->WriteStringMaybeAliased(1, _s, target);
+    }
 
-  // optional string extendee = 2;
-  if (cached_has_bits & 0x00000002u) {
-    const std::string& _s = this->_internal_extendee();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FieldDescriptorProto.extendee");
-    target = stream->WriteStringMaybeAliased(2, _s, target);
-  }
+    // optional string extendee = 2;
+    if (cached_has_bits & 0x00000002u) {
+      const std::string& _s = this->_internal_extendee();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FieldDescriptorProto.extendee");
+      target = stream->WriteStringMaybeAliased(2, _s, target);
+    }
 
-  // optional int32 number = 3;
-  if (cached_has_bits & 0x00000040u) {
-    target = ::google::protobuf::internal::WireFormatLite::
-        WriteInt32ToArrayWithField<3>(
-            stream, this->_internal_number(), target);
-  }
+    // optional int32 number = 3;
+    if (cached_has_bits & 0x00000040u) {
+      target = ::google::protobuf::internal::WireFormatLite::
+          WriteInt32ToArrayWithField<3>(
+              stream, this->_internal_number(), target);
+    }
 
-  // optional .google.protobuf.FieldDescriptorProto.Label label = 4;
-  if (cached_has_bits & 0x00000200u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteEnumToArray(
-        4, this->_internal_label(), target);
-  }
+    // optional .google.protobuf.FieldDescriptorProto.Label label = 4;
+    if (cached_has_bits & 0x00000200u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteEnumToArray(
+          4, this->_internal_label(), target);
+    }
 
-  // optional .google.protobuf.FieldDescriptorProto.Type type = 5;
-  if (cached_has_bits & 0x00000400u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteEnumToArray(
-        5, this->_internal_type(), target);
-  }
+    // optional .google.protobuf.FieldDescriptorProto.Type type = 5;
+    if (cached_has_bits & 0x00000400u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteEnumToArray(
+          5, this->_internal_type(), target);
+    }
 
-  // optional string type_name = 6;
-  if (cached_has_bits & 0x00000004u) {
-    const std::string& _s = this->_internal_type_name();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FieldDescriptorProto.type_name");
-    target = stream->WriteStringMaybeAliased(6, _s, target);
-  }
+    // optional string type_name = 6;
+    if (cached_has_bits & 0x00000004u) {
+      const std::string& _s = this->_internal_type_name();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FieldDescriptorProto.type_name");
+      target = stream->WriteStringMaybeAliased(6, _s, target);
+    }
 
-  // optional string default_value = 7;
-  if (cached_has_bits & 0x00000008u) {
-    const std::string& _s = this->_internal_default_value();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FieldDescriptorProto.default_value");
-    target = stream->WriteStringMaybeAliased(7, _s, target);
-  }
+    // optional string default_value = 7;
+    if (cached_has_bits & 0x00000008u) {
+      const std::string& _s = this->_internal_default_value();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FieldDescriptorProto.default_value");
+      target = stream->WriteStringMaybeAliased(7, _s, target);
+    }
 
-  // optional .google.protobuf.FieldOptions options = 8;
-  if (cached_has_bits & 0x00000020u) {
-    target = ::google::protobuf::internal::WireFormatLite::InternalWriteMessage(
-        8, _Internal::options(this),
-        _Internal::options(this).GetCachedSize(), target, stream);
-  }
+    // optional .google.protobuf.FieldOptions options = 8;
+    if (cached_has_bits & 0x00000020u) {
+      target = ::google::protobuf::internal::WireFormatLite::InternalWriteMessage(
+          8, _Internal::options(this),
+          _Internal::options(this).GetCachedSize(), target, stream);
+    }
 
-  // optional int32 oneof_index = 9;
-  if (cached_has_bits & 0x00000080u) {
-    target = ::google::protobuf::internal::WireFormatLite::
-        WriteInt32ToArrayWithField<9>(
-            stream, this->_internal_oneof_index(), target);
-  }
+    // optional int32 oneof_index = 9;
+    if (cached_has_bits & 0x00000080u) {
+      target = ::google::protobuf::internal::WireFormatLite::
+          WriteInt32ToArrayWithField<9>(
+              stream, this->_internal_oneof_index(), target);
+    }
 
-  // optional string json_name = 10;
-  if (cached_has_bits & 0x00000010u) {
-    const std::string& _s = this->_internal_json_name();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FieldDescriptorProto.json_name");
-    target = stream->WriteStringMaybeAliased(10, _s, target);
-  }
+    // optional string json_name = 10;
+    if (cached_has_bits & 0x00000010u) {
+      const std::string& _s = this->_internal_json_name();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FieldDescriptorProto.json_name");
+      target = stream->WriteStringMaybeAliased(10, _s, target);
+    }
 
-  // optional bool proto3_optional = 17;
-  if (cached_has_bits & 0x00000100u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        17, this->_internal_proto3_optional(), target);
-  }
+    // optional bool proto3_optional = 17;
+    if (cached_has_bits & 0x00000100u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          17, this->_internal_proto3_optional(), target);
+    }
 
+  }
   if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
     target =
         ::_pbi::WireFormat::InternalSerializeUnknownFieldsToArray(
@@ -5185,74 +5179,76 @@ constexpr ::_pbi::TcParseTable<4, 11, 3, 96, 2> FieldDescriptorProto::_table_ =
   (void) cached_has_bits;
 
   cached_has_bits = _impl_._has_bits_[0];
-  if (cached_has_bits & 0x000000ffu) {
-    // optional string name = 1;
-    if (cached_has_bits & 0x00000001u) {
-      total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_name());
-    }
-
-    // optional string extendee = 2;
-    if (cached_has_bits & 0x00000002u) {
-      total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_extendee());
-    }
-
-    // optional string type_name = 6;
-    if (cached_has_bits & 0x00000004u) {
-      total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_type_name());
-    }
-
-    // optional string default_value = 7;
-    if (cached_has_bits & 0x00000008u) {
-      total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_default_value());
-    }
-
-    // optional string json_name = 10;
-    if (cached_has_bits & 0x00000010u) {
-      total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_json_name());
-    }
-
-    // optional .google.protobuf.FieldOptions options = 8;
-    if (cached_has_bits & 0x00000020u) {
-      total_size +=
-          1 + ::google::protobuf::internal::WireFormatLite::MessageSize(*_impl_.options_);
-    }
-
-    // optional int32 number = 3;
-    if (cached_has_bits & 0x00000040u) {
-      total_size += ::_pbi::WireFormatLite::Int32SizePlusOne(
-          this->_internal_number());
-    }
-
-    // optional int32 oneof_index = 9;
-    if (cached_has_bits & 0x00000080u) {
-      total_size += ::_pbi::WireFormatLite::Int32SizePlusOne(
-          this->_internal_oneof_index());
-    }
+  if (cached_has_bits & 0x000007ffu) {
+    if (cached_has_bits & 0x000000ffu) {
+      // optional string name = 1;
+      if (cached_has_bits & 0x00000001u) {
+        total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_name());
+      }
+
+      // optional string extendee = 2;
+      if (cached_has_bits & 0x00000002u) {
+        total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_extendee());
+      }
+
+      // optional string type_name = 6;
+      if (cached_has_bits & 0x00000004u) {
+        total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_type_name());
+      }
+
+      // optional string default_value = 7;
+      if (cached_has_bits & 0x00000008u) {
+        total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_default_value());
+      }
+
+      // optional string json_name = 10;
+      if (cached_has_bits & 0x00000010u) {
+        total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_json_name());
+      }
+
+      // optional .google.protobuf.FieldOptions options = 8;
+      if (cached_has_bits & 0x00000020u) {
+        total_size +=
+            1 + ::google::protobuf::internal::WireFormatLite::MessageSize(*_impl_.options_);
+      }
+
+      // optional int32 number = 3;
+      if (cached_has_bits & 0x00000040u) {
+        total_size += ::_pbi::WireFormatLite::Int32SizePlusOne(
+            this->_internal_number());
+      }
+
+      // optional int32 oneof_index = 9;
+      if (cached_has_bits & 0x00000080u) {
+        total_size += ::_pbi::WireFormatLite::Int32SizePlusOne(
+            this->_internal_oneof_index());
+      }
+
+    }
+    if (cached_has_bits & 0x00000700u) {
+      // optional bool proto3_optional = 17;
+      if (cached_has_bits & 0x00000100u) {
+        total_size += 3;
+      }
+
+      // optional .google.protobuf.FieldDescriptorProto.Label label = 4;
+      if (cached_has_bits & 0x00000200u) {
+        total_size += 1 +
+                      ::_pbi::WireFormatLite::EnumSize(this->_internal_label());
+      }
+
+      // optional .google.protobuf.FieldDescriptorProto.Type type = 5;
+      if (cached_has_bits & 0x00000400u) {
+        total_size += 1 +
+                      ::_pbi::WireFormatLite::EnumSize(this->_internal_type());
+      }
 
-  }
-  if (cached_has_bits & 0x00000700u) {
-    // optional bool proto3_optional = 17;
-    if (cached_has_bits & 0x00000100u) {
-      total_size += 3;
-    }
-
-    // optional .google.protobuf.FieldDescriptorProto.Label label = 4;
-    if (cached_has_bits & 0x00000200u) {
-      total_size += 1 +
-                    ::_pbi::WireFormatLite::EnumSize(this->_internal_label());
-    }
-
-    // optional .google.protobuf.FieldDescriptorProto.Type type = 5;
-    if (cached_has_bits & 0x00000400u) {
-      total_size += 1 +
-                    ::_pbi::WireFormatLite::EnumSize(this->_internal_type());
     }
-
   }
   return MaybeComputeUnknownFieldsSize(total_size, &_impl_._cached_size_);
 }
@@ -5668,12 +5664,9 @@ PROTOBUF_NOINLINE void EnumDescriptorProto_EnumReservedRange::Clear() {
   // Prevent compiler warnings about cached_has_bits being unused
   (void) cached_has_bits;
 
-  cached_has_bits = _impl_._has_bits_[0];
-  if (cached_has_bits & 0x00000003u) {
-    ::memset(&_impl_.start_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.end_) -
-        reinterpret_cast<char*>(&_impl_.start_)) + sizeof(_impl_.end_));
-  }
+  ::memset(&_impl_.start_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.end_) -
+      reinterpret_cast<char*>(&_impl_.start_)) + sizeof(_impl_.end_));
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
@@ -6049,8 +6042,9 @@ constexpr ::_pbi::TcParseTable<3, 5, 3, 61, 2> EnumDescriptorProto::_table_ = {
     const auto& s = this->_internal_reserved_name().Get(i);
     ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(s.data(), static_cast<int>(s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
                                 "google.protobuf.EnumDescriptorProto.reserved_name");
-    target = stream->WriteString(5, s, target);
   }
+  target = stream->WriteRepeatedStringMaybeAliased(
+      5, this->_internal_reserved_name(), target);
 
   if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
     target =
@@ -6859,6 +6853,9 @@ PROTOBUF_NOINLINE void MethodDescriptorProto::Clear() {
   // Prevent compiler warnings about cached_has_bits being unused
   (void) cached_has_bits;
 
+  ::memset(&_impl_.client_streaming_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.server_streaming_) -
+      reinterpret_cast<char*>(&_impl_.client_streaming_)) + sizeof(_impl_.server_streaming_));
   cached_has_bits = _impl_._has_bits_[0];
   if (cached_has_bits & 0x0000000fu) {
     if (cached_has_bits & 0x00000001u) {
@@ -6875,9 +6872,6 @@ PROTOBUF_NOINLINE void MethodDescriptorProto::Clear() {
       _impl_.options_->Clear();
     }
   }
-  ::memset(&_impl_.client_streaming_, 0, static_cast<::size_t>(
-      reinterpret_cast<char*>(&_impl_.server_streaming_) -
-      reinterpret_cast<char*>(&_impl_.client_streaming_)) + sizeof(_impl_.server_streaming_));
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
@@ -7326,6 +7320,9 @@ PROTOBUF_NOINLINE void FileOptions::Clear() {
   (void) cached_has_bits;
 
   _impl_._extensions_.Clear();
+  ::memset(&_impl_.java_multiple_files_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.deprecated_) -
+      reinterpret_cast<char*>(&_impl_.java_multiple_files_)) + sizeof(_impl_.deprecated_));
   _impl_.uninterpreted_option_.Clear();
   cached_has_bits = _impl_._has_bits_[0];
   if (cached_has_bits & 0x000000ffu) {
@@ -7366,15 +7363,7 @@ PROTOBUF_NOINLINE void FileOptions::Clear() {
       _impl_.features_->Clear();
     }
   }
-  if (cached_has_bits & 0x0000f800u) {
-    ::memset(&_impl_.java_multiple_files_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.java_generic_services_) -
-        reinterpret_cast<char*>(&_impl_.java_multiple_files_)) + sizeof(_impl_.java_generic_services_));
-  }
-  if (cached_has_bits & 0x001f0000u) {
-    ::memset(&_impl_.py_generic_services_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.deprecated_) -
-        reinterpret_cast<char*>(&_impl_.py_generic_services_)) + sizeof(_impl_.deprecated_));
+  if (cached_has_bits & 0x00180000u) {
     _impl_.optimize_for_ = 1;
     _impl_.cc_enable_arenas_ = true;
   }
@@ -7571,322 +7560,326 @@ constexpr ::_pbi::TcParseTable<5, 22, 3, 202, 12> FileOptions::_table_ = {
   (void)cached_has_bits;
 
   cached_has_bits = _impl_._has_bits_[0];
-  // optional string java_package = 1;
-  if (cached_has_bits & 0x00000001u) {
-    const std::string& _s = this->_internal_java_package();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FileOptions.java_package");
-    target = stream->WriteStringMaybeAliased(1, _s, target);
-  }
-
-  // optional string java_outer_classname = 8;
-  if (cached_has_bits & 0x00000002u) {
-    const std::string& _s = this->_internal_java_outer_classname();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FileOptions.java_outer_classname");
-    target = stream->WriteStringMaybeAliased(8, _s, target);
-  }
-
-  // optional .google.protobuf.FileOptions.OptimizeMode optimize_for = 9 [default = SPEED];
-  if (cached_has_bits & 0x00080000u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteEnumToArray(
-        9, this->_internal_optimize_for(), target);
-  }
-
-  // optional bool java_multiple_files = 10 [default = false];
-  if (cached_has_bits & 0x00000800u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        10, this->_internal_java_multiple_files(), target);
-  }
-
-  // optional string go_package = 11;
-  if (cached_has_bits & 0x00000004u) {
-    const std::string& _s = this->_internal_go_package();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FileOptions.go_package");
-    target = stream->WriteStringMaybeAliased(11, _s, target);
-  }
-
-  // optional bool cc_generic_services = 16 [default = false];
-  if (cached_has_bits & 0x00004000u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        16, this->_internal_cc_generic_services(), target);
-  }
-
-  // optional bool java_generic_services = 17 [default = false];
-  if (cached_has_bits & 0x00008000u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        17, this->_internal_java_generic_services(), target);
-  }
-
-  // optional bool py_generic_services = 18 [default = false];
-  if (cached_has_bits & 0x00010000u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        18, this->_internal_py_generic_services(), target);
-  }
-
-  // optional bool java_generate_equals_and_hash = 20 [deprecated = true];
-  if (cached_has_bits & 0x00001000u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        20, this->_internal_java_generate_equals_and_hash(), target);
-  }
-
-  // optional bool deprecated = 23 [default = false];
-  if (cached_has_bits & 0x00040000u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        23, this->_internal_deprecated(), target);
-  }
-
-  // optional bool java_string_check_utf8 = 27 [default = false];
-  if (cached_has_bits & 0x00002000u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        27, this->_internal_java_string_check_utf8(), target);
-  }
-
-  // optional bool cc_enable_arenas = 31 [default = true];
-  if (cached_has_bits & 0x00100000u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        31, this->_internal_cc_enable_arenas(), target);
-  }
-
-  // optional string objc_class_prefix = 36;
-  if (cached_has_bits & 0x00000008u) {
-    const std::string& _s = this->_internal_objc_class_prefix();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FileOptions.objc_class_prefix");
-    target = stream->WriteStringMaybeAliased(36, _s, target);
-  }
-
-  // optional string csharp_namespace = 37;
-  if (cached_has_bits & 0x00000010u) {
-    const std::string& _s = this->_internal_csharp_namespace();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FileOptions.csharp_namespace");
-    target = stream->WriteStringMaybeAliased(37, _s, target);
-  }
-
-  // optional string swift_prefix = 39;
-  if (cached_has_bits & 0x00000020u) {
-    const std::string& _s = this->_internal_swift_prefix();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FileOptions.swift_prefix");
-    target = stream->WriteStringMaybeAliased(39, _s, target);
-  }
-
-  // optional string php_class_prefix = 40;
-  if (cached_has_bits & 0x00000040u) {
-    const std::string& _s = this->_internal_php_class_prefix();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FileOptions.php_class_prefix");
-    target = stream->WriteStringMaybeAliased(40, _s, target);
-  }
-
-  // optional string php_namespace = 41;
-  if (cached_has_bits & 0x00000080u) {
-    const std::string& _s = this->_internal_php_namespace();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FileOptions.php_namespace");
-    target = stream->WriteStringMaybeAliased(41, _s, target);
-  }
-
-  // optional bool php_generic_services = 42 [default = false];
-  if (cached_has_bits & 0x00020000u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        42, this->_internal_php_generic_services(), target);
-  }
+  if ((cached_has_bits & 0x001fffffu) != 0) {
+    // optional string java_package = 1;
+    if (cached_has_bits & 0x00000001u) {
+      const std::string& _s = this->_internal_java_package();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FileOptions.java_package");
+      target = stream->WriteStringMaybeAliased(1, _s, target);
+    }
 
-  // optional string php_metadata_namespace = 44;
-  if (cached_has_bits & 0x00000100u) {
-    const std::string& _s = this->_internal_php_metadata_namespace();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FileOptions.php_metadata_namespace");
-    target = stream->WriteStringMaybeAliased(44, _s, target);
-  }
+    // optional string java_outer_classname = 8;
+    if (cached_has_bits & 0x00000002u) {
+      const std::string& _s = this->_internal_java_outer_classname();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FileOptions.java_outer_classname");
+      target = stream->WriteStringMaybeAliased(8, _s, target);
+    }
 
-  // optional string ruby_package = 45;
-  if (cached_has_bits & 0x00000200u) {
-    const std::string& _s = this->_internal_ruby_package();
-    ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
-                                "google.protobuf.FileOptions.ruby_package");
-    target = stream->WriteStringMaybeAliased(45, _s, target);
-  }
+    // optional .google.protobuf.FileOptions.OptimizeMode optimize_for = 9 [default = SPEED];
+    if (cached_has_bits & 0x00080000u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteEnumToArray(
+          9, this->_internal_optimize_for(), target);
+    }
 
-  // optional .google.protobuf.FeatureSet features = 50;
-  if (cached_has_bits & 0x00000400u) {
-    target = ::google::protobuf::internal::WireFormatLite::InternalWriteMessage(
-        50, _Internal::features(this),
-        _Internal::features(this).GetCachedSize(), target, stream);
-  }
+    // optional bool java_multiple_files = 10 [default = false];
+    if (cached_has_bits & 0x00000800u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          10, this->_internal_java_multiple_files(), target);
+    }
 
-  // repeated .google.protobuf.UninterpretedOption uninterpreted_option = 999;
-  for (unsigned i = 0,
-      n = static_cast<unsigned>(this->_internal_uninterpreted_option_size()); i < n; i++) {
-    const auto& repfield = this->_internal_uninterpreted_option().Get(i);
-    target = ::google::protobuf::internal::WireFormatLite::
-        InternalWriteMessage(999, repfield, repfield.GetCachedSize(), target, stream);
-  }
+    // optional string go_package = 11;
+    if (cached_has_bits & 0x00000004u) {
+      const std::string& _s = this->_internal_go_package();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FileOptions.go_package");
+      target = stream->WriteStringMaybeAliased(11, _s, target);
+    }
 
-  // Extension range [1000, 536870912)
-  target = _impl_._extensions_._InternalSerialize(
-      internal_default_instance(), 1000, 536870912, target, stream);
-  if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
-    target =
-        ::_pbi::WireFormat::InternalSerializeUnknownFieldsToArray(
-            _internal_metadata_.unknown_fields<::google::protobuf::UnknownFieldSet>(::google::protobuf::UnknownFieldSet::default_instance), target, stream);
-  }
-  // @@protoc_insertion_point(serialize_to_array_end:google.protobuf.FileOptions)
-  return target;
-}
+    // optional bool cc_generic_services = 16 [default = false];
+    if (cached_has_bits & 0x00004000u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          16, this->_internal_cc_generic_services(), target);
+    }
 
-::size_t FileOptions::ByteSizeLong() const {
-// @@protoc_insertion_point(message_byte_size_start:google.protobuf.FileOptions)
-  ::size_t total_size = 0;
+    // optional bool java_generic_services = 17 [default = false];
+    if (cached_has_bits & 0x00008000u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          17, this->_internal_java_generic_services(), target);
+    }
 
-  total_size += _impl_._extensions_.ByteSize();
+    // optional bool py_generic_services = 18 [default = false];
+    if (cached_has_bits & 0x00010000u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          18, this->_internal_py_generic_services(), target);
+    }
 
-  ::uint32_t cached_has_bits = 0;
-  // Prevent compiler warnings about cached_has_bits being unused
-  (void) cached_has_bits;
+    // optional bool java_generate_equals_and_hash = 20 [deprecated = true];
+    if (cached_has_bits & 0x00001000u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          20, this->_internal_java_generate_equals_and_hash(), target);
+    }
 
-  // repeated .google.protobuf.UninterpretedOption uninterpreted_option = 999;
-  total_size += 2UL * this->_internal_uninterpreted_option_size();
-  for (const auto& msg : this->_internal_uninterpreted_option()) {
-    total_size +=
-      ::google::protobuf::internal::WireFormatLite::MessageSize(msg);
-  }
-  cached_has_bits = _impl_._has_bits_[0];
-  if (cached_has_bits & 0x000000ffu) {
-    // optional string java_package = 1;
-    if (cached_has_bits & 0x00000001u) {
-      total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_java_package());
+    // optional bool deprecated = 23 [default = false];
+    if (cached_has_bits & 0x00040000u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          23, this->_internal_deprecated(), target);
     }
 
-    // optional string java_outer_classname = 8;
-    if (cached_has_bits & 0x00000002u) {
-      total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_java_outer_classname());
+    // optional bool java_string_check_utf8 = 27 [default = false];
+    if (cached_has_bits & 0x00002000u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          27, this->_internal_java_string_check_utf8(), target);
     }
 
-    // optional string go_package = 11;
-    if (cached_has_bits & 0x00000004u) {
-      total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_go_package());
+    // optional bool cc_enable_arenas = 31 [default = true];
+    if (cached_has_bits & 0x00100000u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          31, this->_internal_cc_enable_arenas(), target);
     }
 
     // optional string objc_class_prefix = 36;
     if (cached_has_bits & 0x00000008u) {
-      total_size += 2 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_objc_class_prefix());
+      const std::string& _s = this->_internal_objc_class_prefix();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FileOptions.objc_class_prefix");
+      target = stream->WriteStringMaybeAliased(36, _s, target);
     }
 
     // optional string csharp_namespace = 37;
     if (cached_has_bits & 0x00000010u) {
-      total_size += 2 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_csharp_namespace());
+      const std::string& _s = this->_internal_csharp_namespace();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FileOptions.csharp_namespace");
+      target = stream->WriteStringMaybeAliased(37, _s, target);
     }
 
     // optional string swift_prefix = 39;
     if (cached_has_bits & 0x00000020u) {
-      total_size += 2 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_swift_prefix());
+      const std::string& _s = this->_internal_swift_prefix();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FileOptions.swift_prefix");
+      target = stream->WriteStringMaybeAliased(39, _s, target);
     }
 
     // optional string php_class_prefix = 40;
     if (cached_has_bits & 0x00000040u) {
-      total_size += 2 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_php_class_prefix());
+      const std::string& _s = this->_internal_php_class_prefix();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FileOptions.php_class_prefix");
+      target = stream->WriteStringMaybeAliased(40, _s, target);
     }
 
     // optional string php_namespace = 41;
     if (cached_has_bits & 0x00000080u) {
-      total_size += 2 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_php_namespace());
+      const std::string& _s = this->_internal_php_namespace();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FileOptions.php_namespace");
+      target = stream->WriteStringMaybeAliased(41, _s, target);
+    }
+
+    // optional bool php_generic_services = 42 [default = false];
+    if (cached_has_bits & 0x00020000u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          42, this->_internal_php_generic_services(), target);
     }
 
-  }
-  if (cached_has_bits & 0x0000ff00u) {
     // optional string php_metadata_namespace = 44;
     if (cached_has_bits & 0x00000100u) {
-      total_size += 2 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_php_metadata_namespace());
+      const std::string& _s = this->_internal_php_metadata_namespace();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FileOptions.php_metadata_namespace");
+      target = stream->WriteStringMaybeAliased(44, _s, target);
     }
 
     // optional string ruby_package = 45;
     if (cached_has_bits & 0x00000200u) {
-      total_size += 2 + ::google::protobuf::internal::WireFormatLite::StringSize(
-                                      this->_internal_ruby_package());
+      const std::string& _s = this->_internal_ruby_package();
+      ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(_s.data(), static_cast<int>(_s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
+                                  "google.protobuf.FileOptions.ruby_package");
+      target = stream->WriteStringMaybeAliased(45, _s, target);
     }
 
     // optional .google.protobuf.FeatureSet features = 50;
     if (cached_has_bits & 0x00000400u) {
-      total_size +=
-          2 + ::google::protobuf::internal::WireFormatLite::MessageSize(*_impl_.features_);
+      target = ::google::protobuf::internal::WireFormatLite::InternalWriteMessage(
+          50, _Internal::features(this),
+          _Internal::features(this).GetCachedSize(), target, stream);
     }
 
-    // optional bool java_multiple_files = 10 [default = false];
-    if (cached_has_bits & 0x00000800u) {
-      total_size += 2;
-    }
+  }
+  // repeated .google.protobuf.UninterpretedOption uninterpreted_option = 999;
+  for (unsigned i = 0,
+      n = static_cast<unsigned>(this->_internal_uninterpreted_option_size()); i < n; i++) {
+    const auto& repfield = this->_internal_uninterpreted_option().Get(i);
+    target = ::google::protobuf::internal::WireFormatLite::
+        InternalWriteMessage(999, repfield, repfield.GetCachedSize(), target, stream);
+  }
 
-    // optional bool java_generate_equals_and_hash = 20 [deprecated = true];
-    if (cached_has_bits & 0x00001000u) {
-      total_size += 3;
-    }
+  // Extension range [1000, 536870912)
+  target = _impl_._extensions_._InternalSerialize(
+      internal_default_instance(), 1000, 536870912, target, stream);
+  if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
+    target =
+        ::_pbi::WireFormat::InternalSerializeUnknownFieldsToArray(
+            _internal_metadata_.unknown_fields<::google::protobuf::UnknownFieldSet>(::google::protobuf::UnknownFieldSet::default_instance), target, stream);
+  }
+  // @@protoc_insertion_point(serialize_to_array_end:google.protobuf.FileOptions)
+  return target;
+}
 
-    // optional bool java_string_check_utf8 = 27 [default = false];
-    if (cached_has_bits & 0x00002000u) {
-      total_size += 3;
-    }
+::size_t FileOptions::ByteSizeLong() const {
+// @@protoc_insertion_point(message_byte_size_start:google.protobuf.FileOptions)
+  ::size_t total_size = 0;
 
-    // optional bool cc_generic_services = 16 [default = false];
-    if (cached_has_bits & 0x00004000u) {
-      total_size += 3;
-    }
+  total_size += _impl_._extensions_.ByteSize();
 
-    // optional bool java_generic_services = 17 [default = false];
-    if (cached_has_bits & 0x00008000u) {
-      total_size += 3;
-    }
+  ::uint32_t cached_has_bits = 0;
+  // Prevent compiler warnings about cached_has_bits being unused
+  (void) cached_has_bits;
 
+  // repeated .google.protobuf.UninterpretedOption uninterpreted_option = 999;
+  total_size += 2UL * this->_internal_uninterpreted_option_size();
+  for (const auto& msg : this->_internal_uninterpreted_option()) {
+    total_size +=
+      ::google::protobuf::internal::WireFormatLite::MessageSize(msg);
   }
-  if (cached_has_bits & 0x001f0000u) {
-    // optional bool py_generic_services = 18 [default = false];
-    if (cached_has_bits & 0x00010000u) {
-      total_size += 3;
-    }
-
-    // optional bool php_generic_services = 42 [default = false];
-    if (cached_has_bits & 0x00020000u) {
-      total_size += 3;
-    }
-
-    // optional bool deprecated = 23 [default = false];
-    if (cached_has_bits & 0x00040000u) {
-      total_size += 3;
-    }
-
-    // optional .google.protobuf.FileOptions.OptimizeMode optimize_for = 9 [default = SPEED];
-    if (cached_has_bits & 0x00080000u) {
-      total_size += 1 +
-                    ::_pbi::WireFormatLite::EnumSize(this->_internal_optimize_for());
-    }
+  cached_has_bits = _impl_._has_bits_[0];
+  if (cached_has_bits & 0x001fffffu) {
+    if (cached_has_bits & 0x000000ffu) {
+      // optional string java_package = 1;
+      if (cached_has_bits & 0x00000001u) {
+        total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_java_package());
+      }
+
+      // optional string java_outer_classname = 8;
+      if (cached_has_bits & 0x00000002u) {
+        total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_java_outer_classname());
+      }
+
+      // optional string go_package = 11;
+      if (cached_has_bits & 0x00000004u) {
+        total_size += 1 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_go_package());
+      }
+
+      // optional string objc_class_prefix = 36;
+      if (cached_has_bits & 0x00000008u) {
+        total_size += 2 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_objc_class_prefix());
+      }
+
+      // optional string csharp_namespace = 37;
+      if (cached_has_bits & 0x00000010u) {
+        total_size += 2 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_csharp_namespace());
+      }
+
+      // optional string swift_prefix = 39;
+      if (cached_has_bits & 0x00000020u) {
+        total_size += 2 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_swift_prefix());
+      }
+
+      // optional string php_class_prefix = 40;
+      if (cached_has_bits & 0x00000040u) {
+        total_size += 2 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_php_class_prefix());
+      }
+
+      // optional string php_namespace = 41;
+      if (cached_has_bits & 0x00000080u) {
+        total_size += 2 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_php_namespace());
+      }
+
+    }
+    if (cached_has_bits & 0x0000ff00u) {
+      // optional string php_metadata_namespace = 44;
+      if (cached_has_bits & 0x00000100u) {
+        total_size += 2 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_php_metadata_namespace());
+      }
+
+      // optional string ruby_package = 45;
+      if (cached_has_bits & 0x00000200u) {
+        total_size += 2 + ::google::protobuf::internal::WireFormatLite::StringSize(
+                                        this->_internal_ruby_package());
+      }
+
+      // optional .google.protobuf.FeatureSet features = 50;
+      if (cached_has_bits & 0x00000400u) {
+        total_size +=
+            2 + ::google::protobuf::internal::WireFormatLite::MessageSize(*_impl_.features_);
+      }
+
+      // optional bool java_multiple_files = 10 [default = false];
+      if (cached_has_bits & 0x00000800u) {
+        total_size += 2;
+      }
+
+      // optional bool java_generate_equals_and_hash = 20 [deprecated = true];
+      if (cached_has_bits & 0x00001000u) {
+        total_size += 3;
+      }
+
+      // optional bool java_string_check_utf8 = 27 [default = false];
+      if (cached_has_bits & 0x00002000u) {
+        total_size += 3;
+      }
+
+      // optional bool cc_generic_services = 16 [default = false];
+      if (cached_has_bits & 0x00004000u) {
+        total_size += 3;
+      }
+
+      // optional bool java_generic_services = 17 [default = false];
+      if (cached_has_bits & 0x00008000u) {
+        total_size += 3;
+      }
+
+    }
+    if (cached_has_bits & 0x001f0000u) {
+      // optional bool py_generic_services = 18 [default = false];
+      if (cached_has_bits & 0x00010000u) {
+        total_size += 3;
+      }
+
+      // optional bool php_generic_services = 42 [default = false];
+      if (cached_has_bits & 0x00020000u) {
+        total_size += 3;
+      }
+
+      // optional bool deprecated = 23 [default = false];
+      if (cached_has_bits & 0x00040000u) {
+        total_size += 3;
+      }
+
+      // optional .google.protobuf.FileOptions.OptimizeMode optimize_for = 9 [default = SPEED];
+      if (cached_has_bits & 0x00080000u) {
+        total_size += 1 +
+                      ::_pbi::WireFormatLite::EnumSize(this->_internal_optimize_for());
+      }
+
+      // optional bool cc_enable_arenas = 31 [default = true];
+      if (cached_has_bits & 0x00100000u) {
+        total_size += 3;
+      }
 
-    // optional bool cc_enable_arenas = 31 [default = true];
-    if (cached_has_bits & 0x00100000u) {
-      total_size += 3;
     }
-
   }
   return MaybeComputeUnknownFieldsSize(total_size, &_impl_._cached_size_);
 }
@@ -8142,17 +8135,15 @@ PROTOBUF_NOINLINE void MessageOptions::Clear() {
   (void) cached_has_bits;
 
   _impl_._extensions_.Clear();
+  ::memset(&_impl_.message_set_wire_format_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.deprecated_legacy_json_field_conflicts_) -
+      reinterpret_cast<char*>(&_impl_.message_set_wire_format_)) + sizeof(_impl_.deprecated_legacy_json_field_conflicts_));
   _impl_.uninterpreted_option_.Clear();
   cached_has_bits = _impl_._has_bits_[0];
   if (cached_has_bits & 0x00000001u) {
     ABSL_DCHECK(_impl_.features_ != nullptr);
     _impl_.features_->Clear();
   }
-  if (cached_has_bits & 0x0000003eu) {
-    ::memset(&_impl_.message_set_wire_format_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.deprecated_legacy_json_field_conflicts_) -
-        reinterpret_cast<char*>(&_impl_.message_set_wire_format_)) + sizeof(_impl_.deprecated_legacy_json_field_conflicts_));
-  }
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
@@ -8795,6 +8786,9 @@ PROTOBUF_NOINLINE void FieldOptions::Clear() {
   (void) cached_has_bits;
 
   _impl_._extensions_.Clear();
+  ::memset(&_impl_.ctype_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.retention_) -
+      reinterpret_cast<char*>(&_impl_.ctype_)) + sizeof(_impl_.retention_));
   _impl_.targets_.Clear();
   _impl_.edition_defaults_.Clear();
   _impl_.uninterpreted_option_.Clear();
@@ -8803,16 +8797,6 @@ PROTOBUF_NOINLINE void FieldOptions::Clear() {
     ABSL_DCHECK(_impl_.features_ != nullptr);
     _impl_.features_->Clear();
   }
-  if (cached_has_bits & 0x000000feu) {
-    ::memset(&_impl_.ctype_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.weak_) -
-        reinterpret_cast<char*>(&_impl_.ctype_)) + sizeof(_impl_.weak_));
-  }
-  if (cached_has_bits & 0x00000300u) {
-    ::memset(&_impl_.debug_redact_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.retention_) -
-        reinterpret_cast<char*>(&_impl_.debug_redact_)) + sizeof(_impl_.retention_));
-  }
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
@@ -8938,69 +8922,71 @@ constexpr ::_pbi::TcParseTable<4, 13, 7, 0, 7> FieldOptions::_table_ = {
   (void)cached_has_bits;
 
   cached_has_bits = _impl_._has_bits_[0];
-  // optional .google.protobuf.FieldOptions.CType ctype = 1 [default = STRING];
-  if (cached_has_bits & 0x00000002u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteEnumToArray(
-        1, this->_internal_ctype(), target);
-  }
+  if ((cached_has_bits & 0x000003feu) != 0) {
+    // optional .google.protobuf.FieldOptions.CType ctype = 1 [default = STRING];
+    if (cached_has_bits & 0x00000002u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteEnumToArray(
+          1, this->_internal_ctype(), target);
+    }
 
-  // optional bool packed = 2;
-  if (cached_has_bits & 0x00000008u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        2, this->_internal_packed(), target);
-  }
+    // optional bool packed = 2;
+    if (cached_has_bits & 0x00000008u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          2, this->_internal_packed(), target);
+    }
 
-  // optional bool deprecated = 3 [default = false];
-  if (cached_has_bits & 0x00000040u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        3, this->_internal_deprecated(), target);
-  }
+    // optional bool deprecated = 3 [default = false];
+    if (cached_has_bits & 0x00000040u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          3, this->_internal_deprecated(), target);
+    }
 
-  // optional bool lazy = 5 [default = false];
-  if (cached_has_bits & 0x00000010u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        5, this->_internal_lazy(), target);
-  }
+    // optional bool lazy = 5 [default = false];
+    if (cached_has_bits & 0x00000010u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          5, this->_internal_lazy(), target);
+    }
 
-  // optional .google.protobuf.FieldOptions.JSType jstype = 6 [default = JS_NORMAL];
-  if (cached_has_bits & 0x00000004u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteEnumToArray(
-        6, this->_internal_jstype(), target);
-  }
+    // optional .google.protobuf.FieldOptions.JSType jstype = 6 [default = JS_NORMAL];
+    if (cached_has_bits & 0x00000004u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteEnumToArray(
+          6, this->_internal_jstype(), target);
+    }
 
-  // optional bool weak = 10 [default = false];
-  if (cached_has_bits & 0x00000080u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        10, this->_internal_weak(), target);
-  }
+    // optional bool weak = 10 [default = false];
+    if (cached_has_bits & 0x00000080u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          10, this->_internal_weak(), target);
+    }
 
-  // optional bool unverified_lazy = 15 [default = false];
-  if (cached_has_bits & 0x00000020u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        15, this->_internal_unverified_lazy(), target);
-  }
+    // optional bool unverified_lazy = 15 [default = false];
+    if (cached_has_bits & 0x00000020u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          15, this->_internal_unverified_lazy(), target);
+    }
 
-  // optional bool debug_redact = 16 [default = false];
-  if (cached_has_bits & 0x00000100u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteBoolToArray(
-        16, this->_internal_debug_redact(), target);
-  }
+    // optional bool debug_redact = 16 [default = false];
+    if (cached_has_bits & 0x00000100u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteBoolToArray(
+          16, this->_internal_debug_redact(), target);
+    }
 
-  // optional .google.protobuf.FieldOptions.OptionRetention retention = 17;
-  if (cached_has_bits & 0x00000200u) {
-    target = stream->EnsureSpace(target);
-    target = ::_pbi::WireFormatLite::WriteEnumToArray(
-        17, this->_internal_retention(), target);
-  }
+    // optional .google.protobuf.FieldOptions.OptionRetention retention = 17;
+    if (cached_has_bits & 0x00000200u) {
+      target = stream->EnsureSpace(target);
+      target = ::_pbi::WireFormatLite::WriteEnumToArray(
+          17, this->_internal_retention(), target);
+    }
 
+  }
   // repeated .google.protobuf.FieldOptions.OptionTargetType targets = 19;
   for (int i = 0, n = this->_internal_targets_size(); i < n; ++i) {
     target = stream->EnsureSpace(target);
@@ -9079,63 +9065,65 @@ constexpr ::_pbi::TcParseTable<4, 13, 7, 0, 7> FieldOptions::_table_ = {
       ::google::protobuf::internal::WireFormatLite::MessageSize(msg);
   }
   cached_has_bits = _impl_._has_bits_[0];
-  if (cached_has_bits & 0x000000ffu) {
-    // optional .google.protobuf.FeatureSet features = 21;
-    if (cached_has_bits & 0x00000001u) {
-      total_size +=
-          2 + ::google::protobuf::internal::WireFormatLite::MessageSize(*_impl_.features_);
-    }
-
-    // optional .google.protobuf.FieldOptions.CType ctype = 1 [default = STRING];
-    if (cached_has_bits & 0x00000002u) {
-      total_size += 1 +
-                    ::_pbi::WireFormatLite::EnumSize(this->_internal_ctype());
-    }
-
-    // optional .google.protobuf.FieldOptions.JSType jstype = 6 [default = JS_NORMAL];
-    if (cached_has_bits & 0x00000004u) {
-      total_size += 1 +
-                    ::_pbi::WireFormatLite::EnumSize(this->_internal_jstype());
-    }
-
-    // optional bool packed = 2;
-    if (cached_has_bits & 0x00000008u) {
-      total_size += 2;
-    }
-
-    // optional bool lazy = 5 [default = false];
-    if (cached_has_bits & 0x00000010u) {
-      total_size += 2;
-    }
-
-    // optional bool unverified_lazy = 15 [default = false];
-    if (cached_has_bits & 0x00000020u) {
-      total_size += 2;
-    }
-
-    // optional bool deprecated = 3 [default = false];
-    if (cached_has_bits & 0x00000040u) {
-      total_size += 2;
-    }
-
-    // optional bool weak = 10 [default = false];
-    if (cached_has_bits & 0x00000080u) {
-      total_size += 2;
-    }
-
-  }
-  if (cached_has_bits & 0x00000300u) {
-    // optional bool debug_redact = 16 [default = false];
-    if (cached_has_bits & 0x00000100u) {
-      total_size += 3;
-    }
+  if (cached_has_bits & 0x000003ffu) {
+    if (cached_has_bits & 0x000000ffu) {
+      // optional .google.protobuf.FeatureSet features = 21;
+      if (cached_has_bits & 0x00000001u) {
+        total_size +=
+            2 + ::google::protobuf::internal::WireFormatLite::MessageSize(*_impl_.features_);
+      }
+
+      // optional .google.protobuf.FieldOptions.CType ctype = 1 [default = STRING];
+      if (cached_has_bits & 0x00000002u) {
+        total_size += 1 +
+                      ::_pbi::WireFormatLite::EnumSize(this->_internal_ctype());
+      }
+
+      // optional .google.protobuf.FieldOptions.JSType jstype = 6 [default = JS_NORMAL];
+      if (cached_has_bits & 0x00000004u) {
+        total_size += 1 +
+                      ::_pbi::WireFormatLite::EnumSize(this->_internal_jstype());
+      }
+
+      // optional bool packed = 2;
+      if (cached_has_bits & 0x00000008u) {
+        total_size += 2;
+      }
+
+      // optional bool lazy = 5 [default = false];
+      if (cached_has_bits & 0x00000010u) {
+        total_size += 2;
+      }
+
+      // optional bool unverified_lazy = 15 [default = false];
+      if (cached_has_bits & 0x00000020u) {
+        total_size += 2;
+      }
+
+      // optional bool deprecated = 3 [default = false];
+      if (cached_has_bits & 0x00000040u) {
+        total_size += 2;
+      }
+
+      // optional bool weak = 10 [default = false];
+      if (cached_has_bits & 0x00000080u) {
+        total_size += 2;
+      }
+
+    }
+    if (cached_has_bits & 0x00000300u) {
+      // optional bool debug_redact = 16 [default = false];
+      if (cached_has_bits & 0x00000100u) {
+        total_size += 3;
+      }
+
+      // optional .google.protobuf.FieldOptions.OptionRetention retention = 17;
+      if (cached_has_bits & 0x00000200u) {
+        total_size += 2 +
+                      ::_pbi::WireFormatLite::EnumSize(this->_internal_retention());
+      }
 
-    // optional .google.protobuf.FieldOptions.OptionRetention retention = 17;
-    if (cached_has_bits & 0x00000200u) {
-      total_size += 2 +
-                    ::_pbi::WireFormatLite::EnumSize(this->_internal_retention());
     }
-
   }
   return MaybeComputeUnknownFieldsSize(total_size, &_impl_._cached_size_);
 }
@@ -9599,15 +9587,15 @@ PROTOBUF_NOINLINE void EnumOptions::Clear() {
   (void) cached_has_bits;
 
   _impl_._extensions_.Clear();
+  ::memset(&_impl_.allow_alias_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.deprecated_legacy_json_field_conflicts_) -
+      reinterpret_cast<char*>(&_impl_.allow_alias_)) + sizeof(_impl_.deprecated_legacy_json_field_conflicts_));
   _impl_.uninterpreted_option_.Clear();
   cached_has_bits = _impl_._has_bits_[0];
   if (cached_has_bits & 0x00000001u) {
     ABSL_DCHECK(_impl_.features_ != nullptr);
     _impl_.features_->Clear();
   }
-  ::memset(&_impl_.allow_alias_, 0, static_cast<::size_t>(
-      reinterpret_cast<char*>(&_impl_.deprecated_legacy_json_field_conflicts_) -
-      reinterpret_cast<char*>(&_impl_.allow_alias_)) + sizeof(_impl_.deprecated_legacy_json_field_conflicts_));
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
@@ -9949,15 +9937,15 @@ PROTOBUF_NOINLINE void EnumValueOptions::Clear() {
   (void) cached_has_bits;
 
   _impl_._extensions_.Clear();
+  ::memset(&_impl_.deprecated_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.debug_redact_) -
+      reinterpret_cast<char*>(&_impl_.deprecated_)) + sizeof(_impl_.debug_redact_));
   _impl_.uninterpreted_option_.Clear();
   cached_has_bits = _impl_._has_bits_[0];
   if (cached_has_bits & 0x00000001u) {
     ABSL_DCHECK(_impl_.features_ != nullptr);
     _impl_.features_->Clear();
   }
-  ::memset(&_impl_.deprecated_, 0, static_cast<::size_t>(
-      reinterpret_cast<char*>(&_impl_.debug_redact_) -
-      reinterpret_cast<char*>(&_impl_.deprecated_)) + sizeof(_impl_.debug_redact_));
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
@@ -10579,17 +10567,15 @@ PROTOBUF_NOINLINE void MethodOptions::Clear() {
   (void) cached_has_bits;
 
   _impl_._extensions_.Clear();
+  ::memset(&_impl_.deprecated_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.idempotency_level_) -
+      reinterpret_cast<char*>(&_impl_.deprecated_)) + sizeof(_impl_.idempotency_level_));
   _impl_.uninterpreted_option_.Clear();
   cached_has_bits = _impl_._has_bits_[0];
   if (cached_has_bits & 0x00000001u) {
     ABSL_DCHECK(_impl_.features_ != nullptr);
     _impl_.features_->Clear();
   }
-  if (cached_has_bits & 0x00000006u) {
-    ::memset(&_impl_.deprecated_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.idempotency_level_) -
-        reinterpret_cast<char*>(&_impl_.deprecated_)) + sizeof(_impl_.idempotency_level_));
-  }
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
@@ -11164,6 +11150,9 @@ PROTOBUF_NOINLINE void UninterpretedOption::Clear() {
   // Prevent compiler warnings about cached_has_bits being unused
   (void) cached_has_bits;
 
+  ::memset(&_impl_.positive_int_value_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.double_value_) -
+      reinterpret_cast<char*>(&_impl_.positive_int_value_)) + sizeof(_impl_.double_value_));
   _impl_.name_.Clear();
   cached_has_bits = _impl_._has_bits_[0];
   if (cached_has_bits & 0x00000007u) {
@@ -11177,11 +11166,6 @@ PROTOBUF_NOINLINE void UninterpretedOption::Clear() {
       _impl_.aggregate_value_.ClearNonDefaultToEmpty();
     }
   }
-  if (cached_has_bits & 0x00000038u) {
-    ::memset(&_impl_.positive_int_value_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.double_value_) -
-        reinterpret_cast<char*>(&_impl_.positive_int_value_)) + sizeof(_impl_.double_value_));
-  }
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
@@ -11560,12 +11544,9 @@ PROTOBUF_NOINLINE void FeatureSet::Clear() {
   (void) cached_has_bits;
 
   _impl_._extensions_.Clear();
-  cached_has_bits = _impl_._has_bits_[0];
-  if (cached_has_bits & 0x0000003fu) {
-    ::memset(&_impl_.field_presence_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.json_format_) -
-        reinterpret_cast<char*>(&_impl_.field_presence_)) + sizeof(_impl_.json_format_));
-  }
+  ::memset(&_impl_.field_presence_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.json_format_) -
+      reinterpret_cast<char*>(&_impl_.field_presence_)) + sizeof(_impl_.json_format_));
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
@@ -12165,13 +12146,10 @@ PROTOBUF_NOINLINE void FeatureSetDefaults::Clear() {
   // Prevent compiler warnings about cached_has_bits being unused
   (void) cached_has_bits;
 
+  ::memset(&_impl_.minimum_edition_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.maximum_edition_) -
+      reinterpret_cast<char*>(&_impl_.minimum_edition_)) + sizeof(_impl_.maximum_edition_));
   _impl_.defaults_.Clear();
-  cached_has_bits = _impl_._has_bits_[0];
-  if (cached_has_bits & 0x00000003u) {
-    ::memset(&_impl_.minimum_edition_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.maximum_edition_) -
-        reinterpret_cast<char*>(&_impl_.minimum_edition_)) + sizeof(_impl_.maximum_edition_));
-  }
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
@@ -12569,8 +12547,9 @@ constexpr ::_pbi::TcParseTable<3, 5, 0, 106, 2> SourceCodeInfo_Location::_table_
     const auto& s = this->_internal_leading_detached_comments().Get(i);
     ::google::protobuf::internal::WireFormat::VerifyUTF8StringNamedField(s.data(), static_cast<int>(s.length()), ::google::protobuf::internal::WireFormat::SERIALIZE,
                                 "google.protobuf.SourceCodeInfo.Location.leading_detached_comments");
-    target = stream->WriteString(6, s, target);
   }
+  target = stream->WriteRepeatedStringMaybeAliased(
+      6, this->_internal_leading_detached_comments(), target);
 
   if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
     target =
@@ -12973,16 +12952,14 @@ PROTOBUF_NOINLINE void GeneratedCodeInfo_Annotation::Clear() {
   // Prevent compiler warnings about cached_has_bits being unused
   (void) cached_has_bits;
 
+  ::memset(&_impl_.begin_, 0, static_cast<::size_t>(
+      reinterpret_cast<char*>(&_impl_.semantic_) -
+      reinterpret_cast<char*>(&_impl_.begin_)) + sizeof(_impl_.semantic_));
   _impl_.path_.Clear();
   cached_has_bits = _impl_._has_bits_[0];
   if (cached_has_bits & 0x00000001u) {
     _impl_.source_file_.ClearNonDefaultToEmpty();
   }
-  if (cached_has_bits & 0x0000000eu) {
-    ::memset(&_impl_.begin_, 0, static_cast<::size_t>(
-        reinterpret_cast<char*>(&_impl_.semantic_) -
-        reinterpret_cast<char*>(&_impl_.begin_)) + sizeof(_impl_.semantic_));
-  }
   _impl_._has_bits_.Clear();
   _internal_metadata_.Clear<::google::protobuf::UnknownFieldSet>();
 }
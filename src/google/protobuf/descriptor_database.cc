@@ -12,16 +12,22 @@
 #include "google/protobuf/descriptor_database.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "absl/container/btree_set.h"
+#include "absl/hash/hash.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/io/coded_stream.h"
 
 
 namespace google {
@@ -415,6 +421,49 @@ class EncodedDescriptorDatabase::DescriptorIndex {
 
   void EnsureFlat();
 
+  // An open-addressing hash table of positions in one of the flat vectors,
+  // for the lookups of exact keys.  Each slot is a 32-bit position, so the
+  // table takes a few bytes per entry, which a hash map keyed by strings
+  // could not.
+  class HashIndex {
+   public:
+    // Indexes positions [0, size); `hash(i)` is the hash of the key at i.
+    template <typename Hash>
+    void Build(size_t size, Hash hash) {
+      size_t num_slots = 0;
+      if (size > 0) {
+        // At most half full, so that probe sequences stay short.
+        num_slots = 1;
+        while (num_slots < 2 * size) num_slots *= 2;
+      }
+      slots_.assign(num_slots, kEmpty);
+      for (size_t i = 0; i < size; ++i) {
+        size_t slot = hash(i) & mask();
+        while (slots_[slot] != kEmpty) slot = (slot + 1) & mask();
+        slots_[slot] = static_cast<uint32_t>(i);
+      }
+    }
+
+    // Returns the position of the key with `hash` for which `matches` is
+    // true, or -1.
+    template <typename Matches>
+    int Find(size_t hash, Matches matches) const {
+      if (slots_.empty()) return -1;
+      for (size_t slot = hash & mask(); slots_[slot] != kEmpty;
+           slot = (slot + 1) & mask()) {
+        if (matches(slots_[slot])) return static_cast<int>(slots_[slot]);
+      }
+      return -1;
+    }
+
+   private:
+    static constexpr uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+
+    size_t mask() const { return slots_.size() - 1; }
+
+    std::vector<uint32_t> slots_;
+  };
+
   using String = std::string;
 
   String EncodeString(absl::string_view str) const { return String(str); }
@@ -471,6 +520,16 @@ class EncodedDescriptorDatabase::DescriptorIndex {
       auto p = package(index);
       return absl::StrCat(p, p.empty() ? "" : ".", symbol(index));
     }
+
+    // Whether this is the symbol `name`, without building AsString().
+    bool Is(const DescriptorIndex& index, absl::string_view name) const {
+      auto p = package(index);
+      auto s = symbol(index);
+      if (p.empty()) return name == s;
+      return name.size() == p.size() + 1 + s.size() &&
+             absl::StartsWith(name, p) && name[p.size()] == '.' &&
+             absl::EndsWith(name, s);
+    }
   };
 
   struct SymbolCompare {
@@ -539,6 +598,13 @@ class EncodedDescriptorDatabase::DescriptorIndex {
   absl::btree_set<ExtensionEntry, ExtensionCompare> by_extension_{
       ExtensionCompare{*this}};
   std::vector<ExtensionEntry> by_extension_flat_;
+
+  // Hash indexes of the flat vectors, rebuilt by EnsureFlat() whenever it
+  // merges new entries in.  The vectors stay sorted for the lookups that
+  // need an order: conflict checks and FindAllExtensionNumbers().
+  HashIndex by_name_index_;
+  HashIndex by_symbol_index_;
+  HashIndex by_extension_index_;
 };
 
 bool EncodedDescriptorDatabase::Add(const void* encoded_file_descriptor,
@@ -769,13 +835,18 @@ EncodedDescriptorDatabase::DescriptorIndex::FindSymbol(absl::string_view name) {
 std::pair<const void*, int>
 EncodedDescriptorDatabase::DescriptorIndex::FindSymbolOnlyFlat(
     absl::string_view name) const {
-  auto iter =
-      FindLastLessOrEqual(&by_symbol_flat_, name, by_symbol_.key_comp());
-
-  return iter != by_symbol_flat_.end() &&
-                 IsSubSymbol(iter->AsString(*this), name)
-             ? all_values_[iter->data_offset].value()
-             : Value();
+  // No indexed symbol is a sub-symbol of another, so the one containing
+  // `name` is `name` itself or the first of its enclosing scopes that is
+  // indexed: "pkg.Message.field" is found as "pkg.Message".
+  for (absl::string_view scope = name;;) {
+    int i = by_symbol_index_.Find(absl::HashOf(scope), [&](uint32_t i) {
+      return by_symbol_flat_[i].Is(*this, scope);
+    });
+    if (i >= 0) return all_values_[by_symbol_flat_[i].data_offset].value();
+    size_t dot = scope.rfind('.');
+    if (dot == absl::string_view::npos) return Value();
+    scope = scope.substr(0, dot);
+  }
 }
 
 std::pair<const void*, int>
@@ -783,14 +854,13 @@ EncodedDescriptorDatabase::DescriptorIndex::FindExtension(
     absl::string_view containing_type, int field_number) {
   EnsureFlat();
 
-  auto it = std::lower_bound(
-      by_extension_flat_.begin(), by_extension_flat_.end(),
-      std::make_tuple(containing_type, field_number), by_extension_.key_comp());
-  return it == by_extension_flat_.end() ||
-                 it->extendee(*this) != containing_type ||
-                 it->extension_number != field_number
-             ? std::make_pair(nullptr, 0)
-             : all_values_[it->data_offset].value();
+  int i = by_extension_index_.Find(
+      absl::HashOf(containing_type, field_number), [&](uint32_t i) {
+        return by_extension_flat_[i].extension_number == field_number &&
+               by_extension_flat_[i].extendee(*this) == containing_type;
+      });
+  return i < 0 ? std::make_pair(nullptr, 0)
+               : all_values_[by_extension_flat_[i].data_offset].value();
 }
 
 template <typename T, typename Less>
@@ -804,11 +874,30 @@ static void MergeIntoFlat(absl::btree_set<T, Less>* s, std::vector<T>* flat) {
 }
 
 void EncodedDescriptorDatabase::DescriptorIndex::EnsureFlat() {
+  // Once flat, lookups only read the index, so they may run concurrently.
+  if (by_name_.empty() && by_symbol_.empty() && by_extension_.empty()) return;
   all_values_.shrink_to_fit();
-  // Merge each of the sets into their flat counterpart.
-  MergeIntoFlat(&by_name_, &by_name_flat_);
-  MergeIntoFlat(&by_symbol_, &by_symbol_flat_);
-  MergeIntoFlat(&by_extension_, &by_extension_flat_);
+  // Merge each of the sets into their flat counterpart, and index it.
+  if (!by_name_.empty()) {
+    MergeIntoFlat(&by_name_, &by_name_flat_);
+    by_name_index_.Build(by_name_flat_.size(), [&](size_t i) {
+      return absl::HashOf(by_name_flat_[i].name(*this));
+    });
+  }
+  if (!by_symbol_.empty()) {
+    MergeIntoFlat(&by_symbol_, &by_symbol_flat_);
+    by_symbol_index_.Build(by_symbol_flat_.size(), [&](size_t i) {
+      return absl::HashOf(
+          absl::string_view(by_symbol_flat_[i].AsString(*this)));
+    });
+  }
+  if (!by_extension_.empty()) {
+    MergeIntoFlat(&by_extension_, &by_extension_flat_);
+    by_extension_index_.Build(by_extension_flat_.size(), [&](size_t i) {
+      return absl::HashOf(by_extension_flat_[i].extendee(*this),
+                          by_extension_flat_[i].extension_number);
+    });
+  }
 }
 
 bool EncodedDescriptorDatabase::DescriptorIndex::FindAllExtensionNumbers(
@@ -848,11 +937,11 @@ EncodedDescriptorDatabase::DescriptorIndex::FindFile(
     absl::string_view filename) {
   EnsureFlat();
 
-  auto it = std::lower_bound(by_name_flat_.begin(), by_name_flat_.end(),
-                             filename, by_name_.key_comp());
-  return it == by_name_flat_.end() || it->name(*this) != filename
-             ? std::make_pair(nullptr, 0)
-             : all_values_[it->data_offset].value();
+  int i = by_name_index_.Find(absl::HashOf(filename), [&](uint32_t i) {
+    return by_name_flat_[i].name(*this) == filename;
+  });
+  return i < 0 ? std::make_pair(nullptr, 0)
+               : all_values_[by_name_flat_[i].data_offset].value();
 }
 
 
@@ -881,6 +970,370 @@ EncodedDescriptorDatabase::~EncodedDescriptorDatabase() {
 
 // ===================================================================
 
+namespace {
+
+// The layout of a snapshot.  All integers are little-endian uint32_t, and
+// all offsets are relative to the start of the snapshot.
+//
+//   magic            "PBDSNAP1"
+//   num_files, files_offset
+//   num_symbols, symbols_offset
+//   num_extensions, extensions_offset
+//   files            {name_offset, name_size, proto_offset, proto_size},
+//                    sorted by name
+//   symbols          {name_offset, name_size, file}, sorted by name
+//   extensions       {extendee_offset, extendee_size, number, file}, sorted by
+//                    extendee and number
+//   data             the file names, encoded files, symbols and extendees
+constexpr absl::string_view kSnapshotMagic = "PBDSNAP1";
+constexpr size_t kSnapshotHeaderSize = 32;
+constexpr size_t kFileRecordSize = 16;
+constexpr size_t kSymbolRecordSize = 12;
+constexpr size_t kExtensionRecordSize = 16;
+
+uint32_t LoadUint32(const char* p) {
+  uint32_t value;
+  io::CodedInputStream::ReadLittleEndian32FromArray(
+      reinterpret_cast<const uint8_t*>(p), &value);
+  return value;
+}
+
+void AppendUint32(uint32_t value, std::string* output) {
+  uint8_t buffer[sizeof(value)];
+  io::CodedOutputStream::WriteLittleEndian32ToArray(value, buffer);
+  output->append(reinterpret_cast<const char*>(buffer), sizeof(buffer));
+}
+
+// Collects the extensions of `message_type` and its nested types.
+void CollectNestedExtensions(
+    const DescriptorProto& message_type,
+    std::vector<const FieldDescriptorProto*>* extensions) {
+  for (const DescriptorProto& nested : message_type.nested_type()) {
+    CollectNestedExtensions(nested, extensions);
+  }
+  for (const FieldDescriptorProto& field : message_type.extension()) {
+    extensions->push_back(&field);
+  }
+}
+
+// Returns the index of the first of `n` records for which `less` is false,
+// where `less` is true for a prefix of the records.
+template <typename Less>
+uint32_t PartitionPoint(uint32_t n, Less less) {
+  uint32_t begin = 0;
+  while (n > 0) {
+    uint32_t half = n / 2;
+    if (less(begin + half)) {
+      begin += half + 1;
+      n -= half + 1;
+    } else {
+      n = half;
+    }
+  }
+  return begin;
+}
+
+}  // namespace
+
+SnapshotDescriptorDatabase::SnapshotDescriptorDatabase() = default;
+SnapshotDescriptorDatabase::~SnapshotDescriptorDatabase() = default;
+
+bool SnapshotDescriptorDatabase::WriteSnapshot(
+    absl::Span<const FileDescriptorProto* const> files, std::string* output) {
+  // Reject the conflicts that SimpleDescriptorDatabase rejects, so that
+  // lookups in the snapshot are unambiguous.
+  SimpleDescriptorDatabase check;
+  for (const FileDescriptorProto* file : files) {
+    if (!check.AddUnowned(file)) return false;
+  }
+
+  struct Symbol {
+    std::string name;
+    uint32_t file;
+  };
+  struct Extension {
+    std::string extendee;
+    int number;
+    uint32_t file;
+  };
+  std::vector<uint32_t> by_name(files.size());
+  std::vector<Symbol> symbols;
+  std::vector<Extension> extensions;
+  for (uint32_t i = 0; i < files.size(); ++i) {
+    const FileDescriptorProto& file = *files[i];
+    by_name[i] = i;
+    std::string path = file.has_package() ? file.package() : std::string();
+    if (!path.empty()) path += '.';
+
+    std::vector<const FieldDescriptorProto*> file_extensions;
+    for (const DescriptorProto& message_type : file.message_type()) {
+      symbols.push_back({path + message_type.name(), i});
+      CollectNestedExtensions(message_type, &file_extensions);
+    }
+    for (const EnumDescriptorProto& enum_type : file.enum_type()) {
+      symbols.push_back({path + enum_type.name(), i});
+    }
+    for (const FieldDescriptorProto& extension : file.extension()) {
+      symbols.push_back({path + extension.name(), i});
+      file_extensions.push_back(&extension);
+    }
+    for (const ServiceDescriptorProto& service : file.service()) {
+      symbols.push_back({path + service.name(), i});
+    }
+    for (const FieldDescriptorProto* extension : file_extensions) {
+      // Like SimpleDescriptorDatabase, only index extensions of
+      // fully-qualified types.
+      if (!extension->extendee().empty() && extension->extendee()[0] == '.') {
+        extensions.push_back(
+            {extension->extendee().substr(1), extension->number(), i});
+      }
+    }
+  }
+  std::sort(by_name.begin(), by_name.end(), [&](uint32_t a, uint32_t b) {
+    return files[a]->name() < files[b]->name();
+  });
+  std::sort(symbols.begin(), symbols.end(),
+            [](const Symbol& a, const Symbol& b) { return a.name < b.name; });
+  std::sort(extensions.begin(), extensions.end(),
+            [](const Extension& a, const Extension& b) {
+              return std::tie(a.extendee, a.number) <
+                     std::tie(b.extendee, b.number);
+            });
+
+  const size_t files_offset = kSnapshotHeaderSize;
+  const size_t symbols_offset = files_offset + files.size() * kFileRecordSize;
+  const size_t extensions_offset =
+      symbols_offset + symbols.size() * kSymbolRecordSize;
+  const size_t data_offset =
+      extensions_offset + extensions.size() * kExtensionRecordSize;
+  std::string tables;
+  std::string data;
+  // Appends `bytes` to the data, and its offset and size to the tables.
+  auto append_data = [&](absl::string_view bytes) {
+    AppendUint32(static_cast<uint32_t>(data_offset + data.size()), &tables);
+    AppendUint32(static_cast<uint32_t>(bytes.size()), &tables);
+    data.append(bytes.data(), bytes.size());
+  };
+
+  std::string encoded;
+  for (uint32_t i : by_name) {
+    append_data(files[i]->name());
+    encoded.clear();
+    if (!files[i]->SerializeToString(&encoded)) {
+      ABSL_LOG(ERROR) << "Could not serialize file: " << files[i]->name();
+      return false;
+    }
+    append_data(encoded);
+  }
+  // Symbols and extensions refer to files by their position in the sorted
+  // file table.
+  std::vector<uint32_t> position(files.size());
+  for (uint32_t i = 0; i < by_name.size(); ++i) position[by_name[i]] = i;
+  for (const Symbol& symbol : symbols) {
+    append_data(symbol.name);
+    AppendUint32(position[symbol.file], &tables);
+  }
+  for (const Extension& extension : extensions) {
+    append_data(extension.extendee);
+    AppendUint32(static_cast<uint32_t>(extension.number), &tables);
+    AppendUint32(position[extension.file], &tables);
+  }
+  if (data_offset + data.size() > std::numeric_limits<uint32_t>::max()) {
+    ABSL_LOG(ERROR) << "Descriptor snapshot exceeds 4GB.";
+    return false;
+  }
+
+  output->clear();
+  output->reserve(data_offset + data.size());
+  output->append(kSnapshotMagic.data(), kSnapshotMagic.size());
+  AppendUint32(static_cast<uint32_t>(files.size()), output);
+  AppendUint32(static_cast<uint32_t>(files_offset), output);
+  AppendUint32(static_cast<uint32_t>(symbols.size()), output);
+  AppendUint32(static_cast<uint32_t>(symbols_offset), output);
+  AppendUint32(static_cast<uint32_t>(extensions.size()), output);
+  AppendUint32(static_cast<uint32_t>(extensions_offset), output);
+  ABSL_DCHECK_EQ(output->size(), kSnapshotHeaderSize);
+  output->append(tables);
+  ABSL_DCHECK_EQ(output->size(), data_offset);
+  output->append(data);
+  return true;
+}
+
+bool SnapshotDescriptorDatabase::WriteSnapshot(DescriptorDatabase* database,
+                                               std::string* output) {
+  std::vector<std::string> names;
+  if (!database->FindAllFileNames(&names)) {
+    ABSL_LOG(ERROR) << "Database does not support listing its files.";
+    return false;
+  }
+  std::vector<FileDescriptorProto> files(names.size());
+  std::vector<const FileDescriptorProto*> pointers;
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (!database->FindFileByName(names[i], &files[i])) {
+      ABSL_LOG(ERROR) << "File not found in database (unexpected): "
+                      << names[i];
+      return false;
+    }
+    pointers.push_back(&files[i]);
+  }
+  return WriteSnapshot(pointers, output);
+}
+
+bool SnapshotDescriptorDatabase::Load(absl::string_view snapshot) {
+  snapshot_ = absl::string_view();
+  num_files_ = num_symbols_ = num_extensions_ = 0;
+
+  if (snapshot.size() < kSnapshotHeaderSize ||
+      !absl::StartsWith(snapshot, kSnapshotMagic)) {
+    ABSL_LOG(ERROR) << "Not a descriptor snapshot.";
+    return false;
+  }
+  const char* header = snapshot.data() + kSnapshotMagic.size();
+  // Checks that `count` records of `record_size` bytes, starting at the
+  // offset read from the header, and the data each record points to in its
+  // first two fields, lie within the snapshot.
+  auto table = [&](int i, size_t record_size, int data_ranges,
+                   uint32_t* count) -> const char* {
+    *count = LoadUint32(header + 8 * i);
+    uint64_t offset = LoadUint32(header + 8 * i + 4);
+    if (offset + uint64_t{*count} * record_size > snapshot.size()) {
+      return nullptr;
+    }
+    const char* records = snapshot.data() + offset;
+    for (uint32_t r = 0; r < *count; ++r) {
+      for (int d = 0; d < data_ranges; ++d) {
+        const char* range = records + r * record_size + 8 * d;
+        if (uint64_t{LoadUint32(range)} + LoadUint32(range + 4) >
+            snapshot.size()) {
+          return nullptr;
+        }
+      }
+    }
+    return records;
+  };
+  uint32_t num_files, num_symbols, num_extensions;
+  const char* files = table(0, kFileRecordSize, 2, &num_files);
+  const char* symbols = table(1, kSymbolRecordSize, 1, &num_symbols);
+  const char* extensions = table(2, kExtensionRecordSize, 1, &num_extensions);
+  if (files == nullptr || symbols == nullptr || extensions == nullptr) {
+    ABSL_LOG(ERROR) << "Corrupt descriptor snapshot.";
+    return false;
+  }
+  // Checks the file indexes, stored at `field` in each record.
+  auto valid_files = [&](const char* records, uint32_t count,
+                         size_t record_size, size_t field) {
+    for (uint32_t r = 0; r < count; ++r) {
+      if (LoadUint32(records + r * record_size + field) >= num_files) {
+        return false;
+      }
+    }
+    return true;
+  };
+  if (!valid_files(symbols, num_symbols, kSymbolRecordSize, 8) ||
+      !valid_files(extensions, num_extensions, kExtensionRecordSize, 12)) {
+    ABSL_LOG(ERROR) << "Corrupt descriptor snapshot.";
+    return false;
+  }
+
+  snapshot_ = snapshot;
+  files_ = files;
+  symbols_ = symbols;
+  extensions_ = extensions;
+  num_files_ = num_files;
+  num_symbols_ = num_symbols;
+  num_extensions_ = num_extensions;
+  return true;
+}
+
+absl::string_view SnapshotDescriptorDatabase::FileName(uint32_t file) const {
+  const char* record = files_ + file * kFileRecordSize;
+  return snapshot_.substr(LoadUint32(record), LoadUint32(record + 4));
+}
+
+absl::string_view SnapshotDescriptorDatabase::SymbolName(
+    uint32_t symbol) const {
+  const char* record = symbols_ + symbol * kSymbolRecordSize;
+  return snapshot_.substr(LoadUint32(record), LoadUint32(record + 4));
+}
+
+absl::string_view SnapshotDescriptorDatabase::Extendee(
+    uint32_t extension) const {
+  const char* record = extensions_ + extension * kExtensionRecordSize;
+  return snapshot_.substr(LoadUint32(record), LoadUint32(record + 4));
+}
+
+int SnapshotDescriptorDatabase::ExtensionNumber(uint32_t extension) const {
+  return static_cast<int>(
+      LoadUint32(extensions_ + extension * kExtensionRecordSize + 8));
+}
+
+bool SnapshotDescriptorDatabase::ParseFile(uint32_t file,
+                                           FileDescriptorProto* output) const {
+  const char* record = files_ + file * kFileRecordSize;
+  return internal::ParseNoReflection(
+      snapshot_.substr(LoadUint32(record + 8), LoadUint32(record + 12)),
+      *output);
+}
+
+bool SnapshotDescriptorDatabase::FindFileByName(const std::string& filename,
+                                                FileDescriptorProto* output) {
+  uint32_t i = PartitionPoint(
+      num_files_, [&](uint32_t file) { return FileName(file) < filename; });
+  return i < num_files_ && FileName(i) == filename && ParseFile(i, output);
+}
+
+bool SnapshotDescriptorDatabase::FindFileContainingSymbol(
+    const std::string& symbol_name, FileDescriptorProto* output) {
+  // The last symbol that sorts less than or equal to the name.
+  uint32_t i = PartitionPoint(num_symbols_, [&](uint32_t symbol) {
+    return SymbolName(symbol) <= symbol_name;
+  });
+  if (i == 0 || !IsSubSymbol(SymbolName(i - 1), symbol_name)) return false;
+  return ParseFile(LoadUint32(symbols_ + (i - 1) * kSymbolRecordSize + 8),
+                   output);
+}
+
+bool SnapshotDescriptorDatabase::FindFileContainingExtension(
+    const std::string& containing_type, int field_number,
+    FileDescriptorProto* output) {
+  uint32_t i = PartitionPoint(num_extensions_, [&](uint32_t extension) {
+    absl::string_view extendee = Extendee(extension);
+    return extendee < containing_type ||
+           (extendee == containing_type &&
+            ExtensionNumber(extension) < field_number);
+  });
+  if (i == num_extensions_ || Extendee(i) != containing_type ||
+      ExtensionNumber(i) != field_number) {
+    return false;
+  }
+  return ParseFile(LoadUint32(extensions_ + i * kExtensionRecordSize + 12),
+                   output);
+}
+
+bool SnapshotDescriptorDatabase::FindAllExtensionNumbers(
+    const std::string& extendee_type, std::vector<int>* output) {
+  uint32_t i = PartitionPoint(num_extensions_, [&](uint32_t extension) {
+    return Extendee(extension) < extendee_type;
+  });
+  bool success = false;
+  for (; i < num_extensions_ && Extendee(i) == extendee_type; ++i) {
+    output->push_back(ExtensionNumber(i));
+    success = true;
+  }
+  return success;
+}
+
+bool SnapshotDescriptorDatabase::FindAllFileNames(
+    std::vector<std::string>* output) {
+  output->reserve(output->size() + num_files_);
+  for (uint32_t i = 0; i < num_files_; ++i) {
+    output->emplace_back(FileName(i));
+  }
+  return true;
+}
+
+// ===================================================================
+
 DescriptorPoolDatabase::DescriptorPoolDatabase(const DescriptorPool& pool)
     : pool_(pool) {}
 DescriptorPoolDatabase::~DescriptorPoolDatabase() {}
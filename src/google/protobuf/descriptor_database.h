@@ -14,11 +14,14 @@
 #ifndef GOOGLE_PROTOBUF_DESCRIPTOR_DATABASE_H__
 #define GOOGLE_PROTOBUF_DESCRIPTOR_DATABASE_H__
 
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/container/btree_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/port.h"
 
@@ -36,6 +39,7 @@ namespace protobuf {
 class DescriptorDatabase;
 class SimpleDescriptorDatabase;
 class EncodedDescriptorDatabase;
+class SnapshotDescriptorDatabase;
 class DescriptorPoolDatabase;
 class MergedDescriptorDatabase;
 
@@ -311,6 +315,72 @@ class PROTOBUF_EXPORT EncodedDescriptorDatabase : public DescriptorDatabase {
                   FileDescriptorProto* output);
 };
 
+// A read-only DescriptorDatabase backed by a snapshot: a single buffer
+// holding a set of encoded files together with their indexes by file name,
+// symbol and extension, sorted for binary search.  The snapshot contains no
+// pointers, so it can be written at build time, then mapped into memory or
+// embedded in the binary at startup, and shared between processes.
+// Loading it only validates the tables; unlike EncodedDescriptorDatabase,
+// nothing is parsed or indexed until a file is looked up.
+//
+// Wrap the database in a DescriptorPool to build the descriptors of the files
+// actually used, on demand.
+//
+// The same caveats regarding FindFileContainingExtension() apply as with
+// SimpleDescriptorDatabase.
+class PROTOBUF_EXPORT SnapshotDescriptorDatabase : public DescriptorDatabase {
+ public:
+  SnapshotDescriptorDatabase();
+  SnapshotDescriptorDatabase(const SnapshotDescriptorDatabase&) = delete;
+  SnapshotDescriptorDatabase& operator=(const SnapshotDescriptorDatabase&) =
+      delete;
+  ~SnapshotDescriptorDatabase() override;
+
+  // Writes a snapshot of `files` into `output`.  Returns false and logs an
+  // error if the files conflict with each other, as
+  // SimpleDescriptorDatabase::Add() would.
+  static bool WriteSnapshot(absl::Span<const FileDescriptorProto* const> files,
+                            std::string* output);
+  // Writes a snapshot of all files in `database`, which must support
+  // FindAllFileNames(), such as DescriptorPool::internal_generated_database().
+  static bool WriteSnapshot(DescriptorDatabase* database, std::string* output);
+
+  // Uses the snapshot in `snapshot`, replacing the previous one if any.  The
+  // data is not copied; it's up to the caller to make sure it remains valid
+  // for the life of the database.  Returns false and logs an error if the
+  // data is not a valid snapshot, leaving the database empty.
+  bool Load(absl::string_view snapshot);
+
+  // implements DescriptorDatabase -----------------------------------
+  bool FindFileByName(const std::string& filename,
+                      FileDescriptorProto* output) override;
+  bool FindFileContainingSymbol(const std::string& symbol_name,
+                                FileDescriptorProto* output) override;
+  bool FindFileContainingExtension(const std::string& containing_type,
+                                   int field_number,
+                                   FileDescriptorProto* output) override;
+  bool FindAllExtensionNumbers(const std::string& extendee_type,
+                               std::vector<int>* output) override;
+  bool FindAllFileNames(std::vector<std::string>* output) override;
+
+ private:
+  // The tables, each an array of little-endian uint32_t records.
+  absl::string_view snapshot_;
+  const char* files_ = nullptr;
+  const char* symbols_ = nullptr;
+  const char* extensions_ = nullptr;
+  uint32_t num_files_ = 0;
+  uint32_t num_symbols_ = 0;
+  uint32_t num_extensions_ = 0;
+
+  absl::string_view FileName(uint32_t file) const;
+  absl::string_view SymbolName(uint32_t symbol) const;
+  absl::string_view Extendee(uint32_t extension) const;
+  int ExtensionNumber(uint32_t extension) const;
+  // Parses file `file` into *output.
+  bool ParseFile(uint32_t file, FileDescriptorProto* output) const;
+};
+
 // A DescriptorDatabase that fetches files from a given pool.
 class PROTOBUF_EXPORT DescriptorPoolDatabase : public DescriptorDatabase {
  public:
@@ -14,12 +14,16 @@
 #include "google/protobuf/descriptor_database.h"
 
 #include <algorithm>
+#include <deque>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "google/protobuf/descriptor.pb.h"
 #include <gmock/gmock.h>
 #include "google/protobuf/testing/googletest.h"
 #include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/text_format.h"
 
@@ -124,6 +128,34 @@ class DescriptorPoolDatabaseTestCase : public DescriptorDatabaseTestCase {
   DescriptorPoolDatabase database_;
 };
 
+// Specialization for SnapshotDescriptorDatabase.  Writes a new snapshot of
+// all files each time one is added.
+class SnapshotDescriptorDatabaseTestCase : public DescriptorDatabaseTestCase {
+ public:
+  static DescriptorDatabaseTestCase* New() {
+    return new SnapshotDescriptorDatabaseTestCase;
+  }
+
+  virtual ~SnapshotDescriptorDatabaseTestCase() {}
+
+  virtual DescriptorDatabase* GetDatabase() { return &database_; }
+  virtual bool AddToDatabase(const FileDescriptorProto& file) {
+    files_.push_back(file);
+    std::vector<const FileDescriptorProto*> files;
+    for (const FileDescriptorProto& f : files_) files.push_back(&f);
+    if (!SnapshotDescriptorDatabase::WriteSnapshot(files, &snapshot_)) {
+      files_.pop_back();
+      return false;
+    }
+    return database_.Load(snapshot_);
+  }
+
+ private:
+  std::deque<FileDescriptorProto> files_;
+  std::string snapshot_;
+  SnapshotDescriptorDatabase database_;
+};
+
 // -------------------------------------------------------------------
 
 class DescriptorDatabaseTest
@@ -455,9 +487,59 @@ INSTANTIATE_TEST_CASE_P(
     testing::Values(&EncodedDescriptorDatabaseTestCase::New));
 INSTANTIATE_TEST_CASE_P(Pool, DescriptorDatabaseTest,
                         testing::Values(&DescriptorPoolDatabaseTestCase::New));
+INSTANTIATE_TEST_CASE_P(
+    Snapshot, DescriptorDatabaseTest,
+    testing::Values(&SnapshotDescriptorDatabaseTestCase::New));
 
 #endif  // GTEST_HAS_PARAM_TEST
 
+TEST(SnapshotDescriptorDatabaseExtraTest, GeneratedFiles) {
+  // Generated files are only added to the database once the generated pool
+  // is used.
+  ASSERT_NE(FileDescriptorProto::descriptor(), nullptr);
+  std::string snapshot;
+  ASSERT_TRUE(SnapshotDescriptorDatabase::WriteSnapshot(
+      DescriptorPool::internal_generated_database(), &snapshot));
+  SnapshotDescriptorDatabase database;
+  ASSERT_TRUE(database.Load(snapshot));
+
+  // Descriptors are built from the snapshot on demand.
+  DescriptorPool pool(&database);
+  const Descriptor* descriptor =
+      pool.FindMessageTypeByName("google.protobuf.FileDescriptorProto");
+  ASSERT_NE(descriptor, nullptr);
+  EXPECT_EQ(descriptor->DebugString(),
+            FileDescriptorProto::descriptor()->DebugString());
+  EXPECT_NE(pool.FindFieldByName(
+                "google.protobuf.FieldDescriptorProto.json_name"),
+            nullptr);
+  EXPECT_EQ(pool.FindMessageTypeByName("google.protobuf.NoSuchMessage"),
+            nullptr);
+}
+
+TEST(SnapshotDescriptorDatabaseExtraTest, RejectsCorruptSnapshots) {
+  FileDescriptorProto file;
+  file.set_name("foo.proto");
+  file.add_message_type()->set_name("Foo");
+  const FileDescriptorProto* files[] = {&file};
+  std::string snapshot;
+  ASSERT_TRUE(SnapshotDescriptorDatabase::WriteSnapshot(files, &snapshot));
+
+  SnapshotDescriptorDatabase database;
+  EXPECT_FALSE(database.Load(""));
+  EXPECT_FALSE(database.Load(snapshot.substr(0, snapshot.size() - 1)));
+  std::string bad_magic = snapshot;
+  bad_magic[0] = 'X';
+  EXPECT_FALSE(database.Load(bad_magic));
+
+  // A failed load leaves the database empty.
+  FileDescriptorProto output;
+  EXPECT_FALSE(database.FindFileByName("foo.proto", &output));
+  ASSERT_TRUE(database.Load(snapshot));
+  EXPECT_TRUE(database.FindFileByName("foo.proto", &output));
+  EXPECT_EQ(output.DebugString(), file.DebugString());
+}
+
 TEST(EncodedDescriptorDatabaseExtraTest, FindNameOfFileContainingSymbol) {
   // Create two files, one of which is in two parts.
   FileDescriptorProto file1, file2a, file2b;
@@ -492,6 +574,61 @@ TEST(EncodedDescriptorDatabaseExtraTest, FindNameOfFileContainingSymbol) {
   EXPECT_FALSE(db.FindNameOfFileContainingSymbol("baz.Baz", &filename));
 }
 
+TEST(EncodedDescriptorDatabaseExtraTest, ManyFilesAddedBetweenLookups) {
+  EncodedDescriptorDatabase db;
+  std::vector<std::string> data;
+  data.reserve(1000);
+  for (int i = 0; i < 1000; ++i) {
+    FileDescriptorProto file;
+    file.set_name(absl::StrCat("file", i, ".proto"));
+    if (i % 2 == 0) file.set_package(absl::StrCat("pkg", i));
+    file.add_message_type()->set_name(absl::StrCat("Message", i));
+    FieldDescriptorProto* extension = file.add_extension();
+    extension->set_name(absl::StrCat("ext", i));
+    extension->set_extendee(".Extendee");
+    extension->set_number(i + 1);
+    data.push_back(file.SerializeAsString());
+    ASSERT_TRUE(db.Add(data.back().data(), data.back().size()));
+
+    // Lookups in between flatten the index again and again.
+    if (i % 100 != 0) continue;
+    FileDescriptorProto output;
+    EXPECT_TRUE(db.FindFileByName(absl::StrCat("file", i / 2, ".proto"),
+                                  &output));
+    EXPECT_FALSE(db.FindFileByName(absl::StrCat("file", i + 1, ".proto"),
+                                   &output));
+  }
+
+  for (int i = 0; i < 1000; ++i) {
+    const std::string file_name = absl::StrCat("file", i, ".proto");
+    const std::string message_name =
+        i % 2 == 0 ? absl::StrCat("pkg", i, ".Message", i)
+                   : absl::StrCat("Message", i);
+    FileDescriptorProto output;
+    ASSERT_TRUE(db.FindFileByName(file_name, &output));
+    EXPECT_EQ(file_name, output.name());
+    ASSERT_TRUE(db.FindFileContainingSymbol(message_name, &output));
+    EXPECT_EQ(file_name, output.name());
+    ASSERT_TRUE(db.FindFileContainingSymbol(
+        absl::StrCat(message_name, ".Nested.field"), &output));
+    EXPECT_EQ(file_name, output.name());
+    ASSERT_TRUE(db.FindFileContainingExtension("Extendee", i + 1, &output));
+    EXPECT_EQ(file_name, output.name());
+  }
+
+  FileDescriptorProto output;
+  EXPECT_FALSE(db.FindFileContainingSymbol("pkg0", &output));
+  EXPECT_FALSE(db.FindFileContainingSymbol("pkg0.Message1", &output));
+  EXPECT_FALSE(db.FindFileContainingSymbol("Message10", &output));
+  EXPECT_FALSE(db.FindFileContainingSymbol("", &output));
+  EXPECT_FALSE(db.FindFileContainingExtension("Extendee", 1001, &output));
+  EXPECT_FALSE(db.FindFileContainingExtension("Other", 1, &output));
+
+  std::vector<int> numbers;
+  EXPECT_TRUE(db.FindAllExtensionNumbers("Extendee", &numbers));
+  EXPECT_EQ(1000, numbers.size());
+}
+
 TEST(SimpleDescriptorDatabaseExtraTest, FindAllFileNames) {
   FileDescriptorProto f;
   f.set_name("foo.proto");
@@ -14,9 +14,11 @@
 #include "google/protobuf/descriptor.h"
 
 #include <cstdlib>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -36,6 +38,7 @@
 #include "absl/log/scoped_mock_log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
@@ -930,6 +933,47 @@ TEST_F(DescriptorTest, FindFieldByNumber) {
   EXPECT_TRUE(message2_->FindFieldByNumber(500000000) == nullptr);
 }
 
+TEST(DescriptorFieldLookupTest, FindsFieldsOfLargeMessages) {
+  // Fields 100 to 299 in reverse order, without multiples of 7, and a nested
+  // extension whose name and number must not be found as fields.
+  FileDescriptorProto file_proto;
+  file_proto.set_name("lookup.proto");
+  DescriptorProto* message = AddMessage(&file_proto, "Message");
+  AddExtensionRange(message, 1000, 2000);
+  for (int number = 299; number >= 100; --number) {
+    if (number % 7 == 0) continue;
+    AddField(message, absl::StrCat("field_", number), number,
+             FieldDescriptorProto::LABEL_OPTIONAL,
+             FieldDescriptorProto::TYPE_INT32);
+  }
+  AddNestedExtension(message, "Message", "extension", 1000,
+                     FieldDescriptorProto::LABEL_OPTIONAL,
+                     FieldDescriptorProto::TYPE_INT32);
+
+  DescriptorPool pool;
+  const FileDescriptor* file = pool.BuildFile(file_proto);
+  ASSERT_NE(file, nullptr);
+  const Descriptor* descriptor = file->message_type(0);
+
+  for (int number = 0; number < 2100; ++number) {
+    const FieldDescriptor* by_number = descriptor->FindFieldByNumber(number);
+    const FieldDescriptor* by_name =
+        descriptor->FindFieldByName(absl::StrCat("field_", number));
+    if (number >= 100 && number < 300 && number % 7 != 0) {
+      ASSERT_NE(by_number, nullptr) << number;
+      EXPECT_EQ(by_number->number(), number);
+      EXPECT_EQ(by_name, by_number);
+    } else {
+      EXPECT_EQ(by_number, nullptr) << number;
+      EXPECT_EQ(by_name, nullptr) << number;
+    }
+  }
+  EXPECT_EQ(descriptor->FindFieldByNumber(-100), nullptr);
+  EXPECT_EQ(descriptor->FindFieldByName(""), nullptr);
+  EXPECT_EQ(descriptor->FindFieldByName("extension"), nullptr);
+  EXPECT_NE(descriptor->FindExtensionByName("extension"), nullptr);
+}
+
 TEST_F(DescriptorTest, FieldName) {
   EXPECT_EQ("foo", foo_->name());
   EXPECT_EQ("bar", bar_->name());
@@ -976,6 +1020,26 @@ TEST_F(DescriptorTest, PrintableNameIsExtendingTypeForMessageSetExtension) {
                 ->PrintableNameForExtension());
 }
 
+TEST_F(DescriptorTest, FindFieldByJsonKey) {
+  EXPECT_EQ(message4_->field(0),
+            internal::FindFieldByJsonKey(message4_, "fieldName1"));
+  EXPECT_EQ(message4_->field(0),
+            internal::FindFieldByJsonKey(message4_, "field_name1"));
+  EXPECT_EQ(message4_->field(2),
+            internal::FindFieldByJsonKey(message4_, "FieldName3"));
+  EXPECT_EQ(message4_->field(5),
+            internal::FindFieldByJsonKey(message4_, "@type"));
+  EXPECT_EQ(message4_->field(5),
+            internal::FindFieldByJsonKey(message4_, "fieldName6"));
+  EXPECT_EQ(message4_->field(5),
+            internal::FindFieldByJsonKey(message4_, "field_name6"));
+  EXPECT_EQ(message4_->field(6),
+            internal::FindFieldByJsonKey(message4_, "fieldname7"));
+  EXPECT_EQ(nullptr, internal::FindFieldByJsonKey(message4_, "FIELDNAME5x"));
+  EXPECT_EQ(nullptr, internal::FindFieldByJsonKey(message4_, "nosuchfield"));
+  EXPECT_EQ(nullptr, internal::FindFieldByJsonKey(message_, "fieldName1"));
+}
+
 TEST_F(DescriptorTest, FieldJsonName) {
   EXPECT_EQ("fieldName1", message4_->field(0)->json_name());
   EXPECT_EQ("fieldName2", message4_->field(1)->json_name());
@@ -1496,6 +1560,24 @@ TEST_F(StylizedFieldNamesTest, FindByCamelcaseName) {
   EXPECT_TRUE(file_->FindExtensionByCamelcaseName("nosuchfield") == nullptr);
 }
 
+TEST_F(StylizedFieldNamesTest, FindByJsonKey) {
+  // Camel-case names win over names: "fooFoo" is the camel-case name of
+  // foo_foo, and the name of field 4.
+  EXPECT_EQ(message_->field(0),
+            internal::FindFieldByJsonKey(message_, "fooFoo"));
+  EXPECT_EQ(message_->field(0),
+            internal::FindFieldByJsonKey(message_, "foo_foo"));
+  EXPECT_EQ(message_->field(1),
+            internal::FindFieldByJsonKey(message_, "fooBar"));
+  EXPECT_EQ(message_->field(1),
+            internal::FindFieldByJsonKey(message_, "FooBar"));
+  EXPECT_EQ(message_->field(4),
+            internal::FindFieldByJsonKey(message_, "foobar"));
+  EXPECT_TRUE(internal::FindFieldByJsonKey(message_, "barFoo") == nullptr);
+  EXPECT_TRUE(internal::FindFieldByJsonKey(message_, "bar_foo") == nullptr);
+  EXPECT_TRUE(internal::FindFieldByJsonKey(message_, "nosuchfield") == nullptr);
+}
+
 // ===================================================================
 
 // Test enum descriptors.
@@ -7822,6 +7904,66 @@ TEST_F(FeaturesTest, ReusesFeaturesFromDifferentFile) {
   EXPECT_EQ(&GetFeatures(file1), &GetFeatures(file2));
 }
 
+TEST_F(FeaturesTest, ReusesMergedFeaturesPerParent) {
+  BuildDescriptorMessagesInTestPool();
+  const FileDescriptor* file1 = BuildFile(R"pb(
+    name: "foo.proto"
+    syntax: "editions"
+    edition: EDITION_2023
+    options { features { field_presence: IMPLICIT } }
+    message_type {
+      name: "Foo"
+      field {
+        name: "str"
+        number: 1
+        label: LABEL_OPTIONAL
+        type: TYPE_STRING
+        options { features { utf8_validation: NONE } }
+      }
+    }
+  )pb");
+  const FileDescriptor* file2 = BuildFile(R"pb(
+    name: "bar.proto"
+    syntax: "editions"
+    edition: EDITION_2023
+    message_type {
+      name: "Bar"
+      field {
+        name: "str"
+        number: 1
+        label: LABEL_OPTIONAL
+        type: TYPE_STRING
+        options { features { utf8_validation: NONE } }
+      }
+    }
+  )pb");
+  const FileDescriptor* file3 = BuildFile(R"pb(
+    name: "baz.proto"
+    syntax: "editions"
+    edition: EDITION_2023
+    message_type {
+      name: "Baz"
+      field {
+        name: "str"
+        number: 1
+        label: LABEL_OPTIONAL
+        type: TYPE_STRING
+        options { features { utf8_validation: NONE } }
+      }
+    }
+  )pb");
+  const FieldDescriptor* foo_field = file1->message_type(0)->field(0);
+  const FieldDescriptor* bar_field = file2->message_type(0)->field(0);
+  const FieldDescriptor* baz_field = file3->message_type(0)->field(0);
+  // The same child features merge differently under different parents.
+  EXPECT_EQ(GetFeatures(foo_field).field_presence(), FeatureSet::IMPLICIT);
+  EXPECT_EQ(GetFeatures(bar_field).field_presence(), FeatureSet::EXPLICIT);
+  EXPECT_EQ(GetFeatures(foo_field).utf8_validation(), FeatureSet::NONE);
+  EXPECT_EQ(GetFeatures(bar_field).utf8_validation(), FeatureSet::NONE);
+  EXPECT_NE(&GetFeatures(foo_field), &GetFeatures(bar_field));
+  EXPECT_EQ(&GetFeatures(bar_field), &GetFeatures(baz_field));
+}
+
 TEST_F(FeaturesTest, ReusesFeaturesExtension) {
   BuildDescriptorMessagesInTestPool();
   BuildFileInTestPool(pb::TestFeatures::descriptor()->file());
@@ -11128,6 +11270,10 @@ class DatabaseBackedPoolTest : public testing::Test {
       return wrapped_db_->FindFileContainingExtension(containing_type,
                                                       field_number, output);
     }
+    bool FindAllFileNames(std::vector<std::string>* output) override {
+      ++call_count_;
+      return wrapped_db_->FindAllFileNames(output);
+    }
   };
 
   // A DescriptorDatabase which falsely always returns foo.proto when searching
@@ -11389,6 +11535,86 @@ TEST_F(DatabaseBackedPoolTest, DoesntRetryDbUnnecessarily) {
   EXPECT_EQ(0, call_counter.call_count_);
 }
 
+TEST_F(DatabaseBackedPoolTest, PreloadAllFiles) {
+  // baz.proto doesn't build, see PreloadAllFilesReportsErrors.
+  SimpleDescriptorDatabase database;
+  AddToDatabase(&database, "name: 'bar.proto' dependency: 'foo.proto' "
+                           "message_type { name:'Bar' }");
+  AddToDatabase(&database, "name: 'foo.proto' message_type { name:'Foo' }");
+  CallCountingDatabase call_counter(&database);
+  DescriptorPool pool(&call_counter);
+
+  ASSERT_TRUE(pool.PreloadAllFiles());
+
+  call_counter.Clear();
+  const FileDescriptor* foo = pool.FindFileByName("foo.proto");
+  const FileDescriptor* bar = pool.FindFileByName("bar.proto");
+  ASSERT_TRUE(foo != nullptr);
+  ASSERT_TRUE(bar != nullptr);
+  ASSERT_EQ(1, bar->dependency_count());
+  EXPECT_EQ(foo, bar->dependency(0));
+  EXPECT_TRUE(pool.FindMessageTypeByName("Bar") != nullptr);
+  EXPECT_EQ(0, call_counter.call_count_);
+
+  // Files already built are skipped.
+  EXPECT_TRUE(pool.PreloadAllFiles());
+  EXPECT_EQ(foo, pool.FindFileByName("foo.proto"));
+}
+
+TEST_F(DatabaseBackedPoolTest, PreloadAllFilesWithExecutor) {
+  SimpleDescriptorDatabase database;
+  AddToDatabase(&database, "name: 'foo.proto' message_type { name:'Foo' }");
+  for (int i = 0; i < 40; ++i) {
+    AddToDatabase(&database,
+                  absl::Substitute("name: 'file$0.proto' "
+                                   "dependency: 'foo.proto' "
+                                   "package: 'pkg$0' "
+                                   "message_type { name:'Message' "
+                                   "  field { name:'foo' number:1 "
+                                   "          label:LABEL_OPTIONAL "
+                                   "          type_name:'.Foo' } }",
+                                   i)
+                      .c_str());
+  }
+  DescriptorPool pool(&database);
+
+  std::vector<std::thread> threads;
+  ASSERT_TRUE(pool.PreloadAllFiles([&threads](std::function<void()> task) {
+    threads.emplace_back(std::move(task));
+  }));
+  EXPECT_GT(threads.size(), 1);
+  for (std::thread& thread : threads) thread.join();
+
+  const Descriptor* foo = pool.FindMessageTypeByName("Foo");
+  ASSERT_TRUE(foo != nullptr);
+  for (int i = 0; i < 40; ++i) {
+    const Descriptor* message =
+        pool.FindMessageTypeByName(absl::StrCat("pkg", i, ".Message"));
+    ASSERT_TRUE(message != nullptr);
+    EXPECT_EQ(foo, message->field(0)->message_type());
+  }
+}
+
+TEST_F(DatabaseBackedPoolTest, PreloadAllFilesReportsErrors) {
+  // ErrorDescriptorDatabase can't list its files.
+  ErrorDescriptorDatabase error_database;
+  DescriptorPool error_pool(&error_database);
+  EXPECT_FALSE(error_pool.PreloadAllFiles());
+
+  // baz.proto uses Foo without importing foo.proto.
+  MockErrorCollector error_collector;
+  DescriptorPool pool(&database_, &error_collector);
+  EXPECT_FALSE(pool.PreloadAllFiles());
+  EXPECT_EQ(
+      "baz.proto: Baz.foo: TYPE: \"Foo\" seems to be defined in "
+      "\"foo.proto\", which is not imported by \"baz.proto\".  To use it "
+      "here, please add the necessary import.\n",
+      error_collector.text_);
+  // The other files were still built.
+  EXPECT_TRUE(pool.FindMessageTypeByName("Bar") != nullptr);
+  EXPECT_TRUE(pool.FindExtensionByName("foo_ext") != nullptr);
+}
+
 TEST_F(DatabaseBackedPoolTest, DoesntReloadFilesUncesessarily) {
   // If FindFileContainingSymbol() or FindFileContainingExtension() return a
   // file that is already in the DescriptorPool, it should not attempt to
@@ -12192,6 +12418,87 @@ TEST_F(CopySourceCodeInfoToTest, CopySourceCodeInfoTo) {
 
 // ===================================================================
 
+constexpr absl::string_view kCompactDescriptorsTestInput = R"schema(
+  syntax = "proto2";
+  package pkg;
+  option java_package = "com.example.compact.descriptors";
+  message Foo {
+    optional int32 a = 1 [deprecated = true];
+    optional int32 b = 2 [deprecated = true];
+    repeated int32 c = 3 [packed = true];
+  }
+  message Bar {
+    option deprecated = true;
+    optional int32 a = 1 [deprecated = true];
+  }
+)schema";
+
+class CompactDescriptorsTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    io::ArrayInputStream input_stream(kCompactDescriptorsTestInput.data(),
+                                      kCompactDescriptorsTestInput.size());
+    SimpleErrorCollector error_collector;
+    io::Tokenizer tokenizer(&input_stream, &error_collector);
+    compiler::Parser parser;
+    parser.RecordErrorsTo(&error_collector);
+    ASSERT_TRUE(parser.Parse(&tokenizer, &proto_))
+        << error_collector.last_error();
+    proto_.set_name("foo.proto");
+    ASSERT_TRUE(proto_.has_source_code_info());
+  }
+
+  FileDescriptorProto proto_;
+};
+
+TEST_F(CompactDescriptorsTest, SharesOptionsAndDropsSourceCodeInfo) {
+  DescriptorPool pool;
+  pool.UseCompactDescriptors(true);
+  const FileDescriptor* file = pool.BuildFile(proto_);
+  ASSERT_TRUE(file != nullptr);
+
+  const Descriptor* foo = file->FindMessageTypeByName("Foo");
+  const Descriptor* bar = file->FindMessageTypeByName("Bar");
+  EXPECT_TRUE(foo->field(0)->options().deprecated());
+  EXPECT_EQ(&foo->field(0)->options(), &foo->field(1)->options());
+  EXPECT_EQ(&foo->field(0)->options(), &bar->field(0)->options());
+  EXPECT_NE(&foo->field(0)->options(), &foo->field(2)->options());
+  EXPECT_TRUE(foo->field(2)->is_packed());
+  EXPECT_TRUE(bar->options().deprecated());
+
+  SourceLocation location;
+  EXPECT_FALSE(foo->GetSourceLocation(&location));
+
+  // Nothing but the source code info is lost.
+  FileDescriptorProto copy;
+  file->CopyTo(&copy);
+  FileDescriptorProto expected;
+  DescriptorPool().BuildFile(proto_)->CopyTo(&expected);
+  EXPECT_EQ(expected.DebugString(), copy.DebugString());
+}
+
+TEST_F(CompactDescriptorsTest, MemoryUsage) {
+  DescriptorPool full_pool;
+  ASSERT_TRUE(full_pool.BuildFile(proto_) != nullptr);
+  DescriptorPool compact_pool;
+  compact_pool.UseCompactDescriptors(true);
+  ASSERT_TRUE(compact_pool.BuildFile(proto_) != nullptr);
+
+  DescriptorPool::MemoryUsage full = full_pool.GetMemoryUsage();
+  DescriptorPool::MemoryUsage compact = compact_pool.GetMemoryUsage();
+  EXPECT_GT(full.descriptor_bytes, 0);
+  EXPECT_GT(full.options_bytes, 0);
+  EXPECT_GT(full.source_code_info_bytes, 0);
+  EXPECT_EQ(full.shared_options, 0);
+  EXPECT_EQ(compact.source_code_info_bytes, 0);
+  EXPECT_EQ(compact.shared_options, 2);
+  EXPECT_LT(compact.total_bytes(), full.total_bytes());
+
+  EXPECT_EQ(DescriptorPool().GetMemoryUsage().options_bytes, 0);
+}
+
+// ===================================================================
+
 class LazilyBuildDependenciesTest : public testing::Test {
  public:
   LazilyBuildDependenciesTest() : pool_(&db_, nullptr) {
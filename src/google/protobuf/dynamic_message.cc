@@ -43,9 +43,14 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <new>
+#include <string>
+#include <vector>
 
+#include "absl/strings/cord.h"
 #include "google/protobuf/arenastring.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/descriptor.pb.h"
@@ -74,6 +79,8 @@ using internal::MapField;
 
 
 using internal::ArenaStringPtr;
+using internal::WireFormat;
+using internal::WireFormatLite;
 
 // ===================================================================
 // Some helper tables and functions...
@@ -147,8 +154,10 @@ int FieldSpaceUsed(const FieldDescriptor* field) {
         return sizeof(Message*);
 
       case FD::CPPTYPE_STRING:
-        switch (field->options().ctype()) {
-          default:  // TODO:  Support other string reps.
+        switch (internal::cpp::EffectiveStringCType(field)) {
+          case FieldOptions::CORD:
+            return sizeof(absl::Cord);
+          default:
           case FieldOptions::STRING:
             return sizeof(ArenaStringPtr);
         }
@@ -175,6 +184,344 @@ inline int AlignOffset(int offset) { return AlignTo(offset, kSafeAlignment); }
 
 #define bitsizeof(T) (sizeof(T) * 8)
 
+// ===================================================================
+// Serialization specialized per type.
+//
+// When asked to, the factory looks at each field of a type once and picks
+// routines made for the field's type and cardinality, with the tag encoded
+// ahead of time.  Serializing a message then calls them one after the other,
+// without the per-field dispatch on the type of the table-driven path.
+
+// A field as its specialized routines see it.
+struct SerializedField {
+  // Writes the field if it is set.
+  uint8_t* (*serialize)(const SerializedField& field, const uint8_t* base,
+                        uint8_t* target, io::EpsCopyOutputStream* stream);
+  // Returns the size of the field as serialize() writes it.
+  size_t (*byte_size)(const SerializedField& field, const uint8_t* base);
+
+  // How a singular field tells whether it is set.
+  enum Presence : uint8_t {
+    kImplicit,  // Set if the value is not zero or empty.
+    kHasBit,    // Set if bit `has_mask` of the word at `presence_offset` is.
+    kOneof,     // Set if the oneof case at `presence_offset` is its number.
+  };
+
+  const FieldDescriptor* descriptor;
+  uint32_t offset;
+  Presence presence;
+  uint32_t presence_offset;
+  uint32_t has_mask;
+  uint8_t tag[5];
+  uint8_t tag_size;
+
+  // Whether a singular field stored as a T is set.  Its value is only read
+  // if it has no has-bit, as the union of an unset oneof may hold another
+  // type.
+  template <typename T>
+  bool Has(const uint8_t* base) const {
+    uint32_t word;
+    switch (presence) {
+      case kImplicit:
+        return !IsZero(Get<T>(base));
+      case kHasBit:
+        memcpy(&word, base + presence_offset, sizeof(word));
+        return (word & has_mask) != 0;
+      case kOneof:
+        memcpy(&word, base + presence_offset, sizeof(word));
+        return word == static_cast<uint32_t>(descriptor->number());
+    }
+    return false;
+  }
+
+  template <typename T>
+  static bool IsZero(const T& value) {
+    // Compares the bits, so that -0.0 is set like in reflection.
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(value));
+    return bits == 0;
+  }
+  static bool IsZero(const ArenaStringPtr& value) {
+    return value.Get().empty();
+  }
+
+  uint8_t* WriteTag(uint8_t* target) const {
+    memcpy(target, tag, sizeof(tag));
+    return target + tag_size;
+  }
+
+  template <typename T>
+  const T& Get(const uint8_t* base) const {
+    return *reinterpret_cast<const T*>(base + offset);
+  }
+};
+
+// How values of each scalar type are written.
+template <WireFormatLite::FieldType kType>
+struct ScalarCodec;
+
+#define DEFINE_CODEC(TYPE, CPPTYPE, NAME, SIZE)                                \
+  template <>                                                                  \
+  struct ScalarCodec<WireFormatLite::TYPE_##TYPE> {                            \
+    using Type = CPPTYPE;                                                      \
+    static uint8_t* Write(Type value, uint8_t* target) {                       \
+      return WireFormatLite::Write##NAME##NoTagToArray(value, target);         \
+    }                                                                          \
+    static size_t Size(Type value) { return SIZE; }                            \
+  };
+#define DEFINE_VARINT_CODEC(TYPE, CPPTYPE, NAME)                               \
+  DEFINE_CODEC(TYPE, CPPTYPE, NAME, WireFormatLite::NAME##Size(value))
+#define DEFINE_FIXED_CODEC(TYPE, CPPTYPE, NAME)                                \
+  DEFINE_CODEC(TYPE, CPPTYPE, NAME, sizeof(value))
+
+DEFINE_VARINT_CODEC(INT32, int32_t, Int32)
+DEFINE_VARINT_CODEC(INT64, int64_t, Int64)
+DEFINE_VARINT_CODEC(UINT32, uint32_t, UInt32)
+DEFINE_VARINT_CODEC(UINT64, uint64_t, UInt64)
+DEFINE_VARINT_CODEC(SINT32, int32_t, SInt32)
+DEFINE_VARINT_CODEC(SINT64, int64_t, SInt64)
+DEFINE_VARINT_CODEC(ENUM, int, Enum)
+DEFINE_FIXED_CODEC(FIXED32, uint32_t, Fixed32)
+DEFINE_FIXED_CODEC(FIXED64, uint64_t, Fixed64)
+DEFINE_FIXED_CODEC(SFIXED32, int32_t, SFixed32)
+DEFINE_FIXED_CODEC(SFIXED64, int64_t, SFixed64)
+DEFINE_FIXED_CODEC(FLOAT, float, Float)
+DEFINE_FIXED_CODEC(DOUBLE, double, Double)
+DEFINE_FIXED_CODEC(BOOL, bool, Bool)
+
+#undef DEFINE_VARINT_CODEC
+#undef DEFINE_FIXED_CODEC
+#undef DEFINE_CODEC
+
+template <WireFormatLite::FieldType kType>
+uint8_t* SerializeScalar(const SerializedField& field, const uint8_t* base,
+                         uint8_t* target, io::EpsCopyOutputStream* stream) {
+  using Codec = ScalarCodec<kType>;
+  using Type = typename Codec::Type;
+  if (!field.Has<Type>(base)) return target;
+  target = stream->EnsureSpace(target);
+  return Codec::Write(field.Get<Type>(base), field.WriteTag(target));
+}
+
+template <WireFormatLite::FieldType kType>
+size_t ScalarByteSize(const SerializedField& field, const uint8_t* base) {
+  using Codec = ScalarCodec<kType>;
+  using Type = typename Codec::Type;
+  if (!field.Has<Type>(base)) return 0;
+  return field.tag_size + Codec::Size(field.Get<Type>(base));
+}
+
+template <WireFormatLite::FieldType kType>
+uint8_t* SerializeRepeatedScalar(const SerializedField& field,
+                                 const uint8_t* base, uint8_t* target,
+                                 io::EpsCopyOutputStream* stream) {
+  using Codec = ScalarCodec<kType>;
+  for (const auto value :
+       field.Get<RepeatedField<typename Codec::Type>>(base)) {
+    target = stream->EnsureSpace(target);
+    target = Codec::Write(value, field.WriteTag(target));
+  }
+  return target;
+}
+
+template <WireFormatLite::FieldType kType>
+size_t RepeatedScalarByteSize(const SerializedField& field,
+                              const uint8_t* base) {
+  using Codec = ScalarCodec<kType>;
+  const auto& values = field.Get<RepeatedField<typename Codec::Type>>(base);
+  size_t size = field.tag_size * static_cast<size_t>(values.size());
+  for (const auto value : values) size += Codec::Size(value);
+  return size;
+}
+
+template <WireFormatLite::FieldType kType>
+size_t PackedDataSize(const RepeatedField<typename ScalarCodec<kType>::Type>&
+                          values) {
+  size_t size = 0;
+  for (const auto value : values) size += ScalarCodec<kType>::Size(value);
+  return size;
+}
+
+template <WireFormatLite::FieldType kType>
+uint8_t* SerializePackedScalar(const SerializedField& field,
+                               const uint8_t* base, uint8_t* target,
+                               io::EpsCopyOutputStream* stream) {
+  using Codec = ScalarCodec<kType>;
+  const auto& values = field.Get<RepeatedField<typename Codec::Type>>(base);
+  if (values.empty()) return target;
+  target = stream->EnsureSpace(target);
+  target = io::CodedOutputStream::WriteVarint32ToArray(
+      static_cast<uint32_t>(PackedDataSize<kType>(values)),
+      field.WriteTag(target));
+  for (const auto value : values) {
+    target = stream->EnsureSpace(target);
+    target = Codec::Write(value, target);
+  }
+  return target;
+}
+
+template <WireFormatLite::FieldType kType>
+size_t PackedScalarByteSize(const SerializedField& field,
+                            const uint8_t* base) {
+  const auto& values =
+      field.Get<RepeatedField<typename ScalarCodec<kType>::Type>>(base);
+  if (values.empty()) return 0;
+  return field.tag_size +
+         WireFormatLite::LengthDelimitedSize(PackedDataSize<kType>(values));
+}
+
+// Reports invalid UTF-8 in string fields like WireFormat does.
+void VerifyUtf8(const SerializedField& field, const std::string& value) {
+  if (field.descriptor->type() != FieldDescriptor::TYPE_STRING) return;
+  if (field.descriptor->requires_utf8_validation()) {
+    WireFormatLite::VerifyUtf8String(value.data(), value.length(),
+                                     WireFormatLite::SERIALIZE,
+                                     field.descriptor->full_name().c_str());
+  } else {
+    WireFormat::VerifyUTF8StringNamedField(
+        value.data(), value.length(), WireFormat::SERIALIZE,
+        field.descriptor->full_name().c_str());
+  }
+}
+
+uint8_t* SerializeString(const SerializedField& field, const uint8_t* base,
+                         uint8_t* target, io::EpsCopyOutputStream* stream) {
+  if (!field.Has<ArenaStringPtr>(base)) return target;
+  const std::string& value = field.Get<ArenaStringPtr>(base).Get();
+  VerifyUtf8(field, value);
+  return stream->WriteStringMaybeAliased(field.descriptor->number(), value,
+                                         target);
+}
+
+size_t StringByteSize(const SerializedField& field, const uint8_t* base) {
+  if (!field.Has<ArenaStringPtr>(base)) return 0;
+  return field.tag_size +
+         WireFormatLite::BytesSize(field.Get<ArenaStringPtr>(base).Get());
+}
+
+uint8_t* SerializeRepeatedString(const SerializedField& field,
+                                 const uint8_t* base, uint8_t* target,
+                                 io::EpsCopyOutputStream* stream) {
+  for (const std::string& value :
+       field.Get<RepeatedPtrField<std::string>>(base)) {
+    VerifyUtf8(field, value);
+    target = stream->WriteString(field.descriptor->number(), value, target);
+  }
+  return target;
+}
+
+size_t RepeatedStringByteSize(const SerializedField& field,
+                              const uint8_t* base) {
+  const auto& values = field.Get<RepeatedPtrField<std::string>>(base);
+  size_t size = field.tag_size * static_cast<size_t>(values.size());
+  for (const std::string& value : values) {
+    size += WireFormatLite::BytesSize(value);
+  }
+  return size;
+}
+
+// Submessages are written with the sizes cached by the preceding
+// MessageByteSize() call, as in generated code.
+uint8_t* SerializeMessage(const SerializedField& field, const uint8_t* base,
+                          uint8_t* target, io::EpsCopyOutputStream* stream) {
+  if (!field.Has<const Message*>(base)) return target;
+  const Message& value = *field.Get<const Message*>(base);
+  target = stream->EnsureSpace(target);
+  return WireFormatLite::InternalWriteMessage(field.descriptor->number(),
+                                              value, value.GetCachedSize(),
+                                              target, stream);
+}
+
+size_t MessageByteSize(const SerializedField& field, const uint8_t* base) {
+  if (!field.Has<const Message*>(base)) return 0;
+  return field.tag_size + WireFormatLite::LengthDelimitedSize(
+                              field.Get<const Message*>(base)->ByteSizeLong());
+}
+
+uint8_t* SerializeRepeatedMessage(const SerializedField& field,
+                                  const uint8_t* base, uint8_t* target,
+                                  io::EpsCopyOutputStream* stream) {
+  for (const Message& value : field.Get<RepeatedPtrField<Message>>(base)) {
+    target = stream->EnsureSpace(target);
+    target = WireFormatLite::InternalWriteMessage(
+        field.descriptor->number(), value, value.GetCachedSize(), target,
+        stream);
+  }
+  return target;
+}
+
+size_t RepeatedMessageByteSize(const SerializedField& field,
+                               const uint8_t* base) {
+  const auto& values = field.Get<RepeatedPtrField<Message>>(base);
+  size_t size = field.tag_size * static_cast<size_t>(values.size());
+  for (const Message& value : values) {
+    size += WireFormatLite::LengthDelimitedSize(value.ByteSizeLong());
+  }
+  return size;
+}
+
+// Picks the routines for `field`.  Returns false for the kinds of fields
+// that are left to the table-driven path.
+bool SpecializeField(const FieldDescriptor* field, SerializedField* result) {
+  if (field->is_map() || field->options().weak() || field->options().lazy() ||
+      field->options().unverified_lazy()) {
+    return false;
+  }
+  const bool repeated = field->is_repeated();
+  const bool packed = field->is_packed();
+  switch (field->type()) {
+#define HANDLE_TYPE(TYPE)                                                      \
+  case FieldDescriptor::TYPE_##TYPE: {                                         \
+    constexpr auto kType = WireFormatLite::TYPE_##TYPE;                        \
+    if (!repeated) {                                                           \
+      result->serialize = SerializeScalar<kType>;                              \
+      result->byte_size = ScalarByteSize<kType>;                               \
+    } else if (packed) {                                                       \
+      result->serialize = SerializePackedScalar<kType>;                        \
+      result->byte_size = PackedScalarByteSize<kType>;                         \
+    } else {                                                                   \
+      result->serialize = SerializeRepeatedScalar<kType>;                      \
+      result->byte_size = RepeatedScalarByteSize<kType>;                       \
+    }                                                                          \
+    return true;                                                               \
+  }
+
+    HANDLE_TYPE(INT32)
+    HANDLE_TYPE(INT64)
+    HANDLE_TYPE(UINT32)
+    HANDLE_TYPE(UINT64)
+    HANDLE_TYPE(SINT32)
+    HANDLE_TYPE(SINT64)
+    HANDLE_TYPE(ENUM)
+    HANDLE_TYPE(FIXED32)
+    HANDLE_TYPE(FIXED64)
+    HANDLE_TYPE(SFIXED32)
+    HANDLE_TYPE(SFIXED64)
+    HANDLE_TYPE(FLOAT)
+    HANDLE_TYPE(DOUBLE)
+    HANDLE_TYPE(BOOL)
+#undef HANDLE_TYPE
+
+    case FieldDescriptor::TYPE_STRING:
+    case FieldDescriptor::TYPE_BYTES:
+      if (internal::cpp::EffectiveStringCType(field) == FieldOptions::CORD) {
+        return false;
+      }
+      result->serialize = repeated ? SerializeRepeatedString : SerializeString;
+      result->byte_size = repeated ? RepeatedStringByteSize : StringByteSize;
+      return true;
+
+    case FieldDescriptor::TYPE_MESSAGE:
+      result->serialize = repeated ? SerializeRepeatedMessage : SerializeMessage;
+      result->byte_size = repeated ? RepeatedMessageByteSize : MessageByteSize;
+      return true;
+
+    case FieldDescriptor::TYPE_GROUP:
+      return false;
+  }
+  return false;
+}
+
 }  // namespace
 
 // ===================================================================
@@ -210,6 +557,11 @@ class DynamicMessage final : public Message {
 
   Metadata GetMetadata() const override;
 
+  // Use the routines the factory specialized for the type, if any.
+  size_t ByteSizeLong() const override;
+  uint8_t* _InternalSerialize(uint8_t* target,
+                              io::EpsCopyOutputStream* stream) const override;
+
 #if defined(__cpp_lib_destroying_delete) && defined(__cpp_sized_deallocation)
   static void operator delete(DynamicMessage* msg, std::destroying_delete_t);
 #else
@@ -274,6 +626,11 @@ struct DynamicMessageFactory::TypeInfo {
   const DynamicMessage* prototype;
   int weak_field_map_offset;  // The offset for the weak_field_map;
 
+  // If the factory specialized serialization for the type, all its fields in
+  // number order.
+  bool specialized_serialization = false;
+  std::vector<SerializedField> serialized_fields;
+
   TypeInfo() : prototype(nullptr) {}
 
   ~TypeInfo() {
@@ -390,8 +747,16 @@ void DynamicMessage::SharedCtor(bool lock_factory) {
         break;
 
       case FieldDescriptor::CPPTYPE_STRING:
-        switch (field->options().ctype()) {
-          default:  // TODO:  Support other string reps.
+        switch (internal::cpp::EffectiveStringCType(field)) {
+          case FieldOptions::CORD: {
+            // Reflection and the parser store singular `bytes` fields with
+            // ctype=CORD as an absl::Cord holding the default value.
+            auto* cord = new (field_ptr) absl::Cord(
+                absl::string_view(field->default_value_string()));
+            if (GetArena() != nullptr) GetArena()->OwnDestructor(cord);
+            break;
+          }
+          default:
           case FieldOptions::STRING:
             if (!field->is_repeated()) {
               ArenaStringPtr* asp = new (field_ptr) ArenaStringPtr();
@@ -482,7 +847,10 @@ DynamicMessage::~DynamicMessage() {
       if (*(reinterpret_cast<const int32_t*>(field_ptr)) == field->number()) {
         field_ptr = MutableOneofFieldRaw(field);
         if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
-          switch (field->options().ctype()) {
+          switch (internal::cpp::EffectiveStringCType(field)) {
+            case FieldOptions::CORD:
+              delete *reinterpret_cast<absl::Cord**>(field_ptr);
+              break;
             default:
             case FieldOptions::STRING: {
               reinterpret_cast<ArenaStringPtr*>(field_ptr)->Destroy();
@@ -536,8 +904,11 @@ DynamicMessage::~DynamicMessage() {
       }
 
     } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
-      switch (field->options().ctype()) {
-        default:  // TODO:  Support other string reps.
+      switch (internal::cpp::EffectiveStringCType(field)) {
+        case FieldOptions::CORD:
+          reinterpret_cast<absl::Cord*>(field_ptr)->~Cord();
+          break;
+        default:
         case FieldOptions::STRING: {
           reinterpret_cast<ArenaStringPtr*>(field_ptr)->Destroy();
           break;
@@ -590,6 +961,38 @@ Message* DynamicMessage::New(Arena* arena) const {
   }
 }
 
+size_t DynamicMessage::ByteSizeLong() const {
+  if (!type_info_->specialized_serialization) return Message::ByteSizeLong();
+  const uint8_t* base = reinterpret_cast<const uint8_t*>(this);
+  size_t size = 0;
+  for (const SerializedField& field : type_info_->serialized_fields) {
+    size += field.byte_size(field, base);
+  }
+  if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
+    return ComputeUnknownFieldsSize(size, &cached_byte_size_);
+  }
+  cached_byte_size_.Set(internal::ToCachedSize(size));
+  return size;
+}
+
+uint8_t* DynamicMessage::_InternalSerialize(
+    uint8_t* target, io::EpsCopyOutputStream* stream) const {
+  if (!type_info_->specialized_serialization) {
+    return Message::_InternalSerialize(target, stream);
+  }
+  const uint8_t* base = reinterpret_cast<const uint8_t*>(this);
+  for (const SerializedField& field : type_info_->serialized_fields) {
+    target = field.serialize(field, base, target, stream);
+  }
+  if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
+    target = WireFormat::InternalSerializeUnknownFieldsToArray(
+        _internal_metadata_.unknown_fields<UnknownFieldSet>(
+            UnknownFieldSet::default_instance),
+        target, stream);
+  }
+  return target;
+}
+
 Metadata DynamicMessage::GetMetadata() const {
   Metadata metadata;
   metadata.descriptor = type_info_->type;
@@ -600,10 +1003,14 @@ Metadata DynamicMessage::GetMetadata() const {
 // ===================================================================
 
 DynamicMessageFactory::DynamicMessageFactory()
-    : pool_(nullptr), delegate_to_generated_factory_(false) {}
+    : pool_(nullptr),
+      delegate_to_generated_factory_(false),
+      specialize_serialization_(false) {}
 
 DynamicMessageFactory::DynamicMessageFactory(const DescriptorPool* pool)
-    : pool_(pool), delegate_to_generated_factory_(false) {}
+    : pool_(pool),
+      delegate_to_generated_factory_(false),
+      specialize_serialization_(false) {}
 
 DynamicMessageFactory::~DynamicMessageFactory() {
   for (auto iter = prototypes_.begin(); iter != prototypes_.end(); ++iter) {
@@ -616,6 +1023,53 @@ const Message* DynamicMessageFactory::GetPrototype(const Descriptor* type) {
   return GetPrototypeNoLock(type);
 }
 
+void DynamicMessageFactory::SpecializeSerialization(TypeInfo* type_info) {
+  const Descriptor* type = type_info->type;
+  if (type->options().map_entry() ||
+      type->options().message_set_wire_format() ||
+      type->extension_range_count() > 0) {
+    return;
+  }
+  std::vector<SerializedField> fields(type->field_count());
+  for (int i = 0; i < type->field_count(); i++) {
+    const FieldDescriptor* descriptor = type->field(i);
+    SerializedField& field = fields[i];
+    if (!SpecializeField(descriptor, &field)) return;
+    field.descriptor = descriptor;
+    field.presence = SerializedField::kImplicit;
+    field.presence_offset = 0;
+    field.has_mask = 0;
+    if (const OneofDescriptor* oneof = descriptor->real_containing_oneof()) {
+      field.offset = type_info->offsets[type->field_count() + oneof->index()];
+      field.presence = SerializedField::kOneof;
+      field.presence_offset = type_info->oneof_case_offset +
+                              sizeof(uint32_t) * oneof->index();
+    } else {
+      field.offset = type_info->offsets[i];
+      if (internal::cpp::HasHasbit(descriptor)) {
+        const uint32_t has_bit = type_info->has_bits_indices[i];
+        field.presence = SerializedField::kHasBit;
+        field.presence_offset =
+            type_info->has_bits_offset + has_bit / 32 * sizeof(uint32_t);
+        field.has_mask = uint32_t{1} << (has_bit % 32);
+      }
+    }
+    const auto wire_type =
+        descriptor->is_packed()
+            ? WireFormatLite::WIRETYPE_LENGTH_DELIMITED
+            : WireFormat::WireTypeForFieldType(descriptor->type());
+    uint8_t* tag_end = WireFormatLite::WriteTagToArray(descriptor->number(),
+                                                       wire_type, field.tag);
+    field.tag_size = static_cast<uint8_t>(tag_end - field.tag);
+  }
+  std::sort(fields.begin(), fields.end(),
+            [](const SerializedField& a, const SerializedField& b) {
+              return a.descriptor->number() < b.descriptor->number();
+            });
+  type_info->serialized_fields = std::move(fields);
+  type_info->specialized_serialization = true;
+}
+
 const Message* DynamicMessageFactory::GetPrototypeNoLock(
     const Descriptor* type) {
   if (delegate_to_generated_factory_ &&
@@ -703,18 +1157,27 @@ const Message* DynamicMessageFactory::GetPrototypeNoLock(
     type_info->extensions_offset = -1;
   }
 
-  // All the fields.
-  //
-  // TODO:  Optimize the order of fields to minimize padding.
+  // All the fields.  Oneof fields do not use any space.  Going from the most
+  // aligned fields to the least, each field starts where the previous one
+  // ends, so there is no padding between them.  Within an alignment, fields
+  // keep their declaration order.
+  std::vector<const FieldDescriptor*> laid_out_fields;
+  laid_out_fields.reserve(static_cast<size_t>(type->field_count()));
   for (int i = 0; i < type->field_count(); i++) {
+    if (!InRealOneof(type->field(i))) laid_out_fields.push_back(type->field(i));
+  }
+  const auto field_alignment = [](const FieldDescriptor* field) {
+    return std::min(kSafeAlignment, FieldSpaceUsed(field));
+  };
+  std::stable_sort(laid_out_fields.begin(), laid_out_fields.end(),
+                   [&](const FieldDescriptor* a, const FieldDescriptor* b) {
+                     return field_alignment(a) > field_alignment(b);
+                   });
+  for (const FieldDescriptor* field : laid_out_fields) {
     // Make sure field is aligned to avoid bus errors.
-    // Oneof fields do not use any space.
-    if (!InRealOneof(type->field(i))) {
-      int field_size = FieldSpaceUsed(type->field(i));
-      size = AlignTo(size, std::min(kSafeAlignment, field_size));
-      offsets[i] = size;
-      size += field_size;
-    }
+    size = AlignTo(size, field_alignment(field));
+    offsets[field->index()] = size;
+    size += FieldSpaceUsed(field);
   }
 
   // The oneofs.
@@ -728,6 +1191,8 @@ const Message* DynamicMessageFactory::GetPrototypeNoLock(
 
   type_info->weak_field_map_offset = -1;
 
+  if (specialize_serialization_) SpecializeSerialization(type_info);
+
   // Align the final size to make sure no clever allocators think that
   // alignment is not necessary.
   type_info->size = size;
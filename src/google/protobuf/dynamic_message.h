@@ -92,6 +92,17 @@ class PROTOBUF_EXPORT DynamicMessageFactory : public MessageFactory {
     delegate_to_generated_factory_ = enable;
   }
 
+  // Call this to have the DynamicMessageFactory specialize serialization for
+  // the types it constructs from then on.  For each type, it picks routines
+  // made for the type of each field up front, so that serializing and sizing
+  // messages skips the per-field dispatch of the table-driven path.  This
+  // pays off for the few types that are serialized over and over.  Types
+  // with extensions, maps, groups, or weak, lazy or cord fields are
+  // serialized as usual.
+  void SetSpecializeSerialization(bool enable) {
+    specialize_serialization_ = enable;
+  }
+
   // implements MessageFactory ---------------------------------------
 
   // Given a Descriptor, constructs the default (prototype) Message of that
@@ -114,6 +125,7 @@ class PROTOBUF_EXPORT DynamicMessageFactory : public MessageFactory {
  private:
   const DescriptorPool* pool_;
   bool delegate_to_generated_factory_;
+  bool specialize_serialization_;
 
   struct TypeInfo;
   absl::flat_hash_map<const Descriptor*, const TypeInfo*> prototypes_;
@@ -121,6 +133,7 @@ class PROTOBUF_EXPORT DynamicMessageFactory : public MessageFactory {
 
   friend class DynamicMessage;
   const Message* GetPrototypeNoLock(const Descriptor* type);
+  void SpecializeSerialization(TypeInfo* type_info);
 };
 
 // Helper for computing a sorted list of map entries via reflection.
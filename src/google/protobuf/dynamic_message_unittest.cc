@@ -20,7 +20,11 @@
 #include "google/protobuf/dynamic_message.h"
 
 #include <memory>
+#include <string>
 
+#include "absl/strings/cord.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "google/protobuf/descriptor.pb.h"
 #include "google/protobuf/testing/googletest.h"
 #include <gtest/gtest.h>
@@ -246,6 +250,167 @@ TEST_P(DynamicMessageTest, SpaceUsed) {
   }
 }
 
+TEST_P(DynamicMessageTest, SerializesLikeGeneratedCode) {
+  // Dynamic messages serialize through their parse tables. Round trip
+  // messages filled by generated code and check the bytes don't change.
+  Arena arena;
+  auto expect_same_bytes = [&](const Message& generated,
+                               const Message* prototype) {
+    SCOPED_TRACE(generated.GetTypeName());
+    const std::string data = generated.SerializeAsString();
+    Message* message = prototype->New(GetParam() ? &arena : nullptr);
+    ASSERT_TRUE(message->ParseFromString(data));
+    EXPECT_EQ(message->ByteSizeLong(), data.size());
+    EXPECT_EQ(message->SerializeAsString(), data);
+    if (!GetParam()) {
+      delete message;
+    }
+  };
+
+  unittest::TestAllTypes all_types;
+  TestUtil::SetAllFields(&all_types);
+  all_types.set_optional_int32(-1);
+  all_types.mutable_repeated_sint64()->Add(-5);
+  all_types.GetReflection()
+      ->MutableUnknownFields(&all_types)
+      ->AddLengthDelimited(12345, "unknown");
+  expect_same_bytes(all_types, prototype_);
+
+  unittest::TestAllExtensions extensions;
+  TestUtil::SetAllExtensions(&extensions);
+  expect_same_bytes(extensions, extensions_prototype_);
+
+  unittest::TestPackedTypes packed;
+  TestUtil::SetPackedFields(&packed);
+  packed.mutable_packed_int32()->Add(-1);
+  expect_same_bytes(packed, packed_prototype_);
+
+  unittest::TestOneof2 oneof;
+  oneof.mutable_foo_message()->add_corge_int(1);
+  oneof.set_bar_string("bar");
+  oneof.set_baz_int(5);
+  expect_same_bytes(oneof, oneof_prototype_);
+
+  proto2_nofieldpresence_unittest::TestAllTypes proto3;
+  proto3.set_optional_int64(-2);
+  proto3.set_optional_uint32(0);
+  proto3.set_optional_double(-0.0);
+  proto3.set_optional_bool(true);
+  proto3.set_optional_string("string");
+  proto3.set_optional_bytes("");
+  proto3.mutable_optional_nested_message();
+  proto3.set_optional_nested_enum(
+      proto2_nofieldpresence_unittest::TestAllTypes::BAZ);
+  proto3.add_repeated_int32(1);
+  proto3.add_repeated_int32(-1);
+  proto3.add_repeated_string("a");
+  expect_same_bytes(proto3, proto3_prototype_);
+}
+
+TEST_P(DynamicMessageTest, SpecializedSerializationLikeGeneratedCode) {
+  // Lazy fields are left to the table-driven path, so they are dropped to
+  // have the whole proto3 type specialized.
+  FileDescriptorProto unittest_file;
+  FileDescriptorProto unittest_import_file;
+  FileDescriptorProto unittest_import_public_file;
+  FileDescriptorProto unittest_no_field_presence_file;
+  unittest::TestAllTypes::descriptor()->file()->CopyTo(&unittest_file);
+  unittest_import::ImportMessage::descriptor()->file()->CopyTo(
+      &unittest_import_file);
+  unittest_import::PublicImportMessage::descriptor()->file()->CopyTo(
+      &unittest_import_public_file);
+  proto2_nofieldpresence_unittest::TestAllTypes::descriptor()->file()->CopyTo(
+      &unittest_no_field_presence_file);
+  for (FieldDescriptorProto& field :
+       *unittest_no_field_presence_file.mutable_message_type(0)
+            ->mutable_field()) {
+    field.mutable_options()->clear_lazy();
+  }
+  DescriptorPool pool;
+  ASSERT_TRUE(pool.BuildFile(unittest_import_public_file) != nullptr);
+  ASSERT_TRUE(pool.BuildFile(unittest_import_file) != nullptr);
+  ASSERT_TRUE(pool.BuildFile(unittest_file) != nullptr);
+  ASSERT_TRUE(pool.BuildFile(unittest_no_field_presence_file) != nullptr);
+  DynamicMessageFactory factory(&pool);
+  factory.SetSpecializeSerialization(true);
+
+  Arena arena;
+  auto expect_same_bytes = [&](const Message& generated) {
+    SCOPED_TRACE(generated.GetTypeName());
+    const std::string data = generated.SerializeAsString();
+    const Descriptor* type =
+        pool.FindMessageTypeByName(generated.GetDescriptor()->full_name());
+    ASSERT_TRUE(type != nullptr);
+    Message* message =
+        factory.GetPrototype(type)->New(GetParam() ? &arena : nullptr);
+    ASSERT_TRUE(message->ParseFromString(data));
+    EXPECT_EQ(message->ByteSizeLong(), data.size());
+    EXPECT_EQ(message->SerializeAsString(), data);
+    if (!GetParam()) {
+      delete message;
+    }
+  };
+
+  proto2_nofieldpresence_unittest::TestAllTypes proto3;
+  proto3.set_optional_int32(-1);
+  proto3.set_optional_int64(-2);
+  proto3.set_optional_uint32(0);
+  proto3.set_optional_sint64(-3);
+  proto3.set_optional_fixed32(4);
+  proto3.set_optional_sfixed64(-5);
+  proto3.set_optional_float(1.5);
+  proto3.set_optional_double(-0.0);
+  proto3.set_optional_bool(true);
+  proto3.set_optional_string("string");
+  proto3.set_optional_bytes("");
+  proto3.mutable_optional_nested_message()->set_bb(6);
+  proto3.mutable_optional_foreign_message();
+  TestUtil::SetAllFields(proto3.mutable_optional_proto2_message());
+  proto3.set_optional_nested_enum(
+      proto2_nofieldpresence_unittest::TestAllTypes::BAZ);
+  proto3.mutable_optional_lazy_message()->set_bb(7);
+  proto3.add_repeated_int32(1);
+  proto3.add_repeated_int32(-1);
+  proto3.add_repeated_sint32(-8);
+  proto3.add_repeated_fixed64(9);
+  proto3.add_repeated_double(10.5);
+  proto3.add_repeated_bool(false);
+  proto3.add_repeated_string("a");
+  proto3.add_repeated_string("");
+  proto3.add_repeated_bytes("b");
+  proto3.add_repeated_nested_message()->set_bb(11);
+  proto3.add_repeated_nested_message();
+  proto3.add_repeated_nested_enum(
+      proto2_nofieldpresence_unittest::TestAllTypes::BAR);
+  proto3.GetReflection()
+      ->MutableUnknownFields(&proto3)
+      ->AddVarint(12345, 12);
+  proto3.set_oneof_string("oneof");
+  expect_same_bytes(proto3);
+  proto3.mutable_oneof_nested_message()->set_bb(13);
+  expect_same_bytes(proto3);
+  proto3.set_oneof_uint32(0);
+  expect_same_bytes(proto3);
+
+  unittest::TestPackedTypes packed;
+  TestUtil::SetPackedFields(&packed);
+  packed.mutable_packed_int32()->Add(-1);
+  expect_same_bytes(packed);
+
+  unittest::TestUnpackedTypes unpacked;
+  TestUtil::SetUnpackedFields(&unpacked);
+  expect_same_bytes(unpacked);
+
+  // Groups and extensions are serialized through the tables.
+  unittest::TestAllTypes all_types;
+  TestUtil::SetAllFields(&all_types);
+  expect_same_bytes(all_types);
+
+  unittest::TestAllExtensions extensions;
+  TestUtil::SetAllExtensions(&extensions);
+  expect_same_bytes(extensions);
+}
+
 TEST_F(DynamicMessageTest, Arena) {
   Arena arena;
   Message* message = prototype_->New(&arena);
@@ -261,6 +426,86 @@ TEST_F(DynamicMessageTest, Arena) {
   // Return without freeing: should not leak.
 }
 
+TEST_P(DynamicMessageTest, CordFields) {
+  // A schema built at runtime that stores chosen bytes fields as cords.
+  FileDescriptorProto file;
+  file.set_name("dynamic_cord.proto");
+  file.set_package("dynamic_cord");
+  DescriptorProto* type = file.add_message_type();
+  type->set_name("Blob");
+  type->add_oneof_decl()->set_name("choice");
+  const auto add_field = [type](const char* name, int number,
+                                FieldDescriptorProto::Type field_type) {
+    FieldDescriptorProto* field = type->add_field();
+    field->set_name(name);
+    field->set_number(number);
+    field->set_label(FieldDescriptorProto::LABEL_OPTIONAL);
+    field->set_type(field_type);
+    return field;
+  };
+  add_field("payload", 1, FieldDescriptorProto::TYPE_BYTES)
+      ->mutable_options()
+      ->set_ctype(FieldOptions::CORD);
+  FieldDescriptorProto* with_default =
+      add_field("with_default", 2, FieldDescriptorProto::TYPE_BYTES);
+  with_default->set_default_value("default");
+  with_default->mutable_options()->set_ctype(FieldOptions::CORD);
+  FieldDescriptorProto* in_oneof =
+      add_field("in_oneof", 3, FieldDescriptorProto::TYPE_BYTES);
+  in_oneof->set_oneof_index(0);
+  in_oneof->mutable_options()->set_ctype(FieldOptions::CORD);
+  add_field("after", 4, FieldDescriptorProto::TYPE_INT64);
+  ASSERT_TRUE(pool_.BuildFile(file) != nullptr);
+
+  const Descriptor* descriptor =
+      pool_.FindMessageTypeByName("dynamic_cord.Blob");
+  const FieldDescriptor* payload = descriptor->FindFieldByName("payload");
+  const FieldDescriptor* default_field =
+      descriptor->FindFieldByName("with_default");
+  const FieldDescriptor* oneof_field = descriptor->FindFieldByName("in_oneof");
+  const FieldDescriptor* after = descriptor->FindFieldByName("after");
+
+  Arena arena;
+  Message* message =
+      factory_.GetPrototype(descriptor)->New(GetParam() ? &arena : nullptr);
+  const Reflection* reflection = message->GetReflection();
+  EXPECT_EQ(reflection->GetCord(*message, default_field), "default");
+  reflection->SetInt64(message, after, 42);
+  reflection->SetString(message, payload, std::string(10000, 'p'));
+  reflection->SetString(message, oneof_field, std::string(1000, 'o'));
+  EXPECT_EQ(reflection->GetInt64(*message, after), 42);
+
+  // Parsing from a cord shares its chunks with the cord fields.
+  const std::string data = message->SerializeAsString();
+  const absl::Cord input = absl::MakeCordFromExternal(data, [] {});
+  const auto in_data = [&data](const absl::Cord& cord) {
+    for (absl::string_view chunk : cord.Chunks()) {
+      if (chunk.data() < data.data() ||
+          chunk.data() + chunk.size() > data.data() + data.size()) {
+        return false;
+      }
+    }
+    return true;
+  };
+  Message* parsed = message->New(GetParam() ? &arena : nullptr);
+  ASSERT_TRUE(parsed->ParseFromCord(input));
+  EXPECT_EQ(reflection->GetCord(*parsed, payload), std::string(10000, 'p'));
+  EXPECT_TRUE(in_data(reflection->GetCord(*parsed, payload)));
+  EXPECT_EQ(reflection->GetCord(*parsed, oneof_field), std::string(1000, 'o'));
+  EXPECT_TRUE(in_data(reflection->GetCord(*parsed, oneof_field)));
+  EXPECT_EQ(reflection->GetInt64(*parsed, after), 42);
+  EXPECT_EQ(parsed->SerializeAsString(), data);
+
+  reflection->ClearField(parsed, default_field);
+  reflection->ClearField(parsed, oneof_field);
+  EXPECT_EQ(reflection->GetCord(*parsed, default_field), "default");
+  EXPECT_FALSE(reflection->HasField(*parsed, oneof_field));
+
+  if (!GetParam()) {
+    delete message;
+    delete parsed;
+  }
+}
 
 TEST_F(DynamicMessageTest, Proto3) {
   Message* message = proto3_prototype_->New();
@@ -296,6 +541,63 @@ TEST_F(DynamicMessageTest, Proto3) {
   delete message;
 }
 
+// Declares `name` with the fields "b1", "i1", "b2", "i2", ... in the given
+// order, where "b" fields are bools and "i" fields are int64s.
+void AddInterleavedMessage(FileDescriptorProto* file, absl::string_view name,
+                           absl::string_view order) {
+  DescriptorProto* message = file->add_message_type();
+  message->set_name(std::string(name));
+  int number = 0;
+  for (char c : order) {
+    FieldDescriptorProto* field = message->add_field();
+    field->set_name(absl::StrCat(std::string(1, c), ++number));
+    field->set_number(number);
+    field->set_label(FieldDescriptorProto::LABEL_OPTIONAL);
+    field->set_type(c == 'b' ? FieldDescriptorProto::TYPE_BOOL
+                             : FieldDescriptorProto::TYPE_INT64);
+  }
+}
+
+TEST(DynamicMessageLayoutTest, FieldOrderDoesNotAddPadding) {
+  FileDescriptorProto file;
+  file.set_name("layout.proto");
+  file.set_package("layout");
+  AddInterleavedMessage(&file, "Interleaved", "bibibibi");
+  AddInterleavedMessage(&file, "Grouped", "iiiibbbb");
+  DescriptorPool pool;
+  ASSERT_TRUE(pool.BuildFile(file) != nullptr);
+  DynamicMessageFactory factory(&pool);
+
+  const Descriptor* interleaved =
+      pool.FindMessageTypeByName("layout.Interleaved");
+  const Descriptor* grouped = pool.FindMessageTypeByName("layout.Grouped");
+  std::unique_ptr<Message> interleaved_message(
+      factory.GetPrototype(interleaved)->New());
+  std::unique_ptr<Message> grouped_message(
+      factory.GetPrototype(grouped)->New());
+  EXPECT_EQ(interleaved_message->SpaceUsedLong(),
+            grouped_message->SpaceUsedLong());
+
+  // Fields still read back what was written to them after reordering.
+  const Reflection* reflection = interleaved_message->GetReflection();
+  for (int i = 0; i < interleaved->field_count(); i++) {
+    const FieldDescriptor* field = interleaved->field(i);
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_BOOL) {
+      reflection->SetBool(interleaved_message.get(), field, i % 4 == 0);
+    } else {
+      reflection->SetInt64(interleaved_message.get(), field, -1000 * i);
+    }
+  }
+  for (int i = 0; i < interleaved->field_count(); i++) {
+    const FieldDescriptor* field = interleaved->field(i);
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_BOOL) {
+      EXPECT_EQ(reflection->GetBool(*interleaved_message, field), i % 4 == 0);
+    } else {
+      EXPECT_EQ(reflection->GetInt64(*interleaved_message, field), -1000 * i);
+    }
+  }
+}
+
 INSTANTIATE_TEST_SUITE_P(UseArena, DynamicMessageTest, ::testing::Bool());
 
 }  // namespace protobuf
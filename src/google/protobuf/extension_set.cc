@@ -11,6 +11,7 @@
 
 #include "google/protobuf/extension_set.h"
 
+#include <cstdint>
 #include <string>
 #include <tuple>
 #include <type_traits>
@@ -95,7 +96,20 @@ const ExtensionInfo* FindRegisteredExtension(const MessageLite* extendee,
 }  // namespace
 
 bool GeneratedExtensionFinder::Find(int number, ExtensionInfo* output) {
-  const ExtensionInfo* extension = FindRegisteredExtension(extendee_, number);
+  const ExtensionInfo* extension;
+  if (cache_ == nullptr) {
+    extension = FindRegisteredExtension(extendee_, number);
+  } else {
+    // Registry entries do not move once registration is over, so the cache
+    // can hold pointers to them for the duration of a parse.
+    int index = ExtensionInfoCache::Index(extendee_, number);
+    extension = cache_->Get(index);
+    if (extension == nullptr || extension->message != extendee_ ||
+        extension->number != number) {
+      extension = FindRegisteredExtension(extendee_, number);
+      if (extension != nullptr) cache_->Set(index, extension);
+    }
+  }
   if (extension == nullptr) {
     return false;
   } else {
@@ -1205,7 +1219,7 @@ const char* ExtensionSet::ParseField(uint64_t tag, const char* ptr,
                                      const MessageLite* extendee,
                                      internal::InternalMetadata* metadata,
                                      internal::ParseContext* ctx) {
-  GeneratedExtensionFinder finder(extendee);
+  GeneratedExtensionFinder finder(extendee, ctx->extension_info_cache());
   int number = tag >> 3;
   bool was_packed_on_wire;
   ExtensionInfo extension;
@@ -1568,14 +1582,34 @@ const ExtensionSet::Extension* ExtensionSet::FindOrNull(int key) const {
   if (flat_size_ == 0) {
     return nullptr;
   } else if (PROTOBUF_PREDICT_TRUE(!is_large())) {
-    auto it = std::lower_bound(flat_begin(), flat_end() - 1, key,
-                               KeyValue::FirstComparator());
-    return it->first == key ? &it->second : nullptr;
+    const KeyValue* it = FindOrNullInFlatMap(key);
+    return it == nullptr ? nullptr : &it->second;
   } else {
     return FindOrNullInLargeMap(key);
   }
 }
 
+const ExtensionSet::KeyValue* ExtensionSet::FindOrNullInFlatMap(
+    int key) const {
+  ABSL_DCHECK(flat_size_ != 0 && !is_large());
+  const KeyValue* begin = flat_begin();
+  if (find_hint_ < flat_size_ && begin[find_hint_].first == key) {
+    return begin + find_hint_;
+  }
+  // Keys are unique and sorted, so `key` can only be at `key - first_key` or
+  // before it. That slot holds `key` whenever the preceding numbers are all
+  // present, and otherwise bounds the binary search.
+  int64_t offset = static_cast<int64_t>(key) - begin->first;
+  if (offset < 0) return nullptr;
+  const KeyValue* it =
+      begin + std::min<int64_t>(offset, static_cast<int64_t>(flat_size_) - 1);
+  if (it->first != key) {
+    it = std::lower_bound(begin, it, key, KeyValue::FirstComparator());
+    if (it->first != key) return nullptr;
+  }
+  return it;
+}
+
 const ExtensionSet::Extension* ExtensionSet::FindOrNullInLargeMap(
     int key) const {
   assert(is_large());
@@ -1587,6 +1621,12 @@ const ExtensionSet::Extension* ExtensionSet::FindOrNullInLargeMap(
 }
 
 ExtensionSet::Extension* ExtensionSet::FindOrNull(int key) {
+  if (PROTOBUF_PREDICT_TRUE(flat_size_ != 0 && !is_large())) {
+    const KeyValue* it = FindOrNullInFlatMap(key);
+    if (it == nullptr) return nullptr;
+    find_hint_ = static_cast<uint16_t>(it - flat_begin());
+    return const_cast<ExtensionSet::Extension*>(&it->second);
+  }
   const auto* const_this = this;
   return const_cast<ExtensionSet::Extension*>(const_this->FindOrNull(key));
 }
@@ -1606,6 +1646,7 @@ std::pair<ExtensionSet::Extension*, bool> ExtensionSet::Insert(int key) {
   KeyValue* it =
       std::lower_bound(flat_begin(), end, key, KeyValue::FirstComparator());
   if (it != end && it->first == key) {
+    find_hint_ = static_cast<uint16_t>(it - flat_begin());
     return {&it->second, false};
   }
   if (flat_size_ < flat_capacity_) {
@@ -1613,6 +1654,7 @@ std::pair<ExtensionSet::Extension*, bool> ExtensionSet::Insert(int key) {
     ++flat_size_;
     it->first = key;
     it->second = Extension();
+    find_hint_ = static_cast<uint16_t>(it - flat_begin());
     return {&it->second, true};
   }
   GrowCapacity(flat_size_ + 1);
@@ -142,12 +142,17 @@ class PROTOBUF_EXPORT GeneratedExtensionFinder {
  public:
   explicit GeneratedExtensionFinder(const MessageLite* extendee)
       : extendee_(extendee) {}
+  // If `cache` is not null, lookups are served from and recorded in it.
+  GeneratedExtensionFinder(const MessageLite* extendee,
+                           ExtensionInfoCache* cache)
+      : extendee_(extendee), cache_(cache) {}
 
   // Returns true and fills in *output if found, otherwise returns false.
   bool Find(int number, ExtensionInfo* output);
 
  private:
   const MessageLite* extendee_;
+  ExtensionInfoCache* cache_ = nullptr;
 };
 
 // Note:  extension_set_heavy.cc defines DescriptorPoolExtensionFinder for
@@ -684,9 +689,18 @@ class PROTOBUF_EXPORT ExtensionSet {
   // Wrapper API that switches between flat-map and LargeMap.
 
   // Finds a key (if present) in the ExtensionSet.
+  //
+  // Before falling back to a binary search, a flat-map lookup tries the slot of
+  // the key last found or inserted by a non-const call (so repeated accessor
+  // calls for one extension are O(1)) and the slot `key - first_key` (so
+  // extensions with dense numbers are found directly). The const overload
+  // never updates that slot, so concurrent readers do not write to the set.
   const Extension* FindOrNull(int key) const;
   Extension* FindOrNull(int key);
 
+  // Helper-function that only inspects the flat map, which must not be empty.
+  const KeyValue* FindOrNullInFlatMap(int key) const;
+
   // Helper-functions that only inspect the LargeMap.
   const Extension* FindOrNullInLargeMap(int key) const;
   Extension* FindOrNullInLargeMap(int key);
@@ -826,15 +840,15 @@ class PROTOBUF_EXPORT ExtensionSet {
   Extension* MaybeNewRepeatedExtension(const FieldDescriptor* descriptor);
 
   bool FindExtension(int wire_type, uint32_t field, const MessageLite* extendee,
-                     const internal::ParseContext* /*ctx*/,
-                     ExtensionInfo* extension, bool* was_packed_on_wire) {
-    GeneratedExtensionFinder finder(extendee);
+                     internal::ParseContext* ctx, ExtensionInfo* extension,
+                     bool* was_packed_on_wire) {
+    GeneratedExtensionFinder finder(extendee, ctx->extension_info_cache());
     return FindExtensionInfoFromFieldNumber(wire_type, field, &finder,
                                             extension, was_packed_on_wire);
   }
   inline bool FindExtension(int wire_type, uint32_t field,
                             const Message* extendee,
-                            const internal::ParseContext* ctx,
+                            internal::ParseContext* ctx,
                             ExtensionInfo* extension, bool* was_packed_on_wire);
   // Used for MessageSet only
   const char* ParseFieldMaybeLazily(uint64_t tag, const char* ptr,
@@ -901,6 +915,11 @@ class PROTOBUF_EXPORT ExtensionSet {
   // [map_.flat, map_.flat + flat_size_) is the currently-in-use prefix.
   uint16_t flat_capacity_;
   uint16_t flat_size_;  // negative int16_t(flat_size_) indicates is_large()
+  // Index into map_.flat of the last key found by the non-const FindOrNull()
+  // or by Insert(). It is only a hint: it is validated against flat_size_ and
+  // the key before use, so it needs no maintenance when the flat map changes.
+  // It occupies what would otherwise be padding.
+  uint16_t find_hint_;
   union AllocatedData {
     KeyValue* flat;
 
@@ -913,7 +932,11 @@ class PROTOBUF_EXPORT ExtensionSet {
 };
 
 constexpr ExtensionSet::ExtensionSet(Arena* arena)
-    : arena_(arena), flat_capacity_(0), flat_size_(0), map_{nullptr} {}
+    : arena_(arena),
+      flat_capacity_(0),
+      flat_size_(0),
+      find_hint_(0),
+      map_{nullptr} {}
 
 // These are just for convenience...
 inline void ExtensionSet::SetString(int number, FieldType type,
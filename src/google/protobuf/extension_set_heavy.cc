@@ -283,11 +283,11 @@ bool DescriptorPoolExtensionFinder::Find(int number, ExtensionInfo* output) {
 
 bool ExtensionSet::FindExtension(int wire_type, uint32_t field,
                                  const Message* extendee,
-                                 const internal::ParseContext* ctx,
+                                 internal::ParseContext* ctx,
                                  ExtensionInfo* extension,
                                  bool* was_packed_on_wire) {
   if (ctx->data().pool == nullptr) {
-    GeneratedExtensionFinder finder(extendee);
+    GeneratedExtensionFinder finder(extendee, ctx->extension_info_cache());
     if (!FindExtensionInfoFromFieldNumber(wire_type, field, &finder, extension,
                                           was_packed_on_wire)) {
       return false;
@@ -11,12 +11,15 @@
 
 #include "google/protobuf/extension_set.h"
 
+#include <limits>
+
 #include "google/protobuf/descriptor.pb.h"
 #include "google/protobuf/testing/googletest.h"
 #include <gtest/gtest.h>
 #include "absl/base/casts.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "google/protobuf/arena.h"
 #include "google/protobuf/cpp_features.pb.h"
 #include "google/protobuf/descriptor.h"
@@ -1396,6 +1399,100 @@ TEST(ExtensionSetTest, ConstInit) {
   EXPECT_EQ(set.NumExtensions(), 0);
 }
 
+TEST(ExtensionSetTest, ManyExtensionsLookup) {
+  ExtensionSet set;
+  // Dense numbers, then sparse ones above them, inserted out of order.
+  for (int i = 150; i >= 1; --i) {
+    set.SetInt32(i, WireFormatLite::TYPE_INT32, i * 10, nullptr);
+  }
+  for (int i = 1000; i < 1000 + 7 * 50; i += 7) {
+    set.SetInt32(i, WireFormatLite::TYPE_INT32, i * 10, nullptr);
+  }
+  EXPECT_EQ(set.NumExtensions(), 200);
+
+  auto check = [&] {
+    for (int i = 1; i <= 150; ++i) {
+      ASSERT_TRUE(set.Has(i)) << i;
+      ASSERT_EQ(set.GetInt32(i, -1), i * 10) << i;
+      // Repeated reads of the same number.
+      ASSERT_EQ(set.GetInt32(i, -1), i * 10) << i;
+    }
+    for (int i = 1000 + 7 * 49; i >= 1000; i -= 7) {
+      ASSERT_EQ(set.GetInt32(i, -1), i * 10) << i;
+      ASSERT_FALSE(set.Has(i + 1)) << i;
+      ASSERT_EQ(set.GetInt32(i - 1, -1), -1) << i;
+    }
+    ASSERT_FALSE(set.Has(0));
+    ASSERT_FALSE(set.Has(-5));
+    ASSERT_FALSE(set.Has(151));
+    ASSERT_FALSE(set.Has(999));
+    ASSERT_FALSE(set.Has(std::numeric_limits<int>::max()));
+  };
+  check();
+
+  // Inserting into a gap shifts the later slots; stale lookup hints must not
+  // return the wrong extension.
+  EXPECT_EQ(set.GetInt32(500, -1), -1);
+  set.SetInt32(500, WireFormatLite::TYPE_INT32, 5000, nullptr);
+  EXPECT_EQ(set.GetInt32(500, -1), 5000);
+  check();
+
+  ExtensionSet other;
+  other.SetInt32(2, WireFormatLite::TYPE_INT32, 7, nullptr);
+  EXPECT_EQ(other.GetInt32(2, -1), 7);
+  set.InternalSwap(&other);
+  EXPECT_EQ(set.GetInt32(2, -1), 7);
+  EXPECT_EQ(set.GetInt32(1, -1), -1);
+  EXPECT_EQ(other.GetInt32(2, -1), 20);
+  EXPECT_EQ(other.GetInt32(500, -1), 5000);
+}
+
+TEST(ExtensionSetTest, ExtensionInfoCache) {
+  ExtensionInfoCache cache;
+  const MessageLite* extendee = &unittest::TestAllExtensions::default_instance();
+  ExtensionInfo first(extendee, 1, WireFormatLite::TYPE_INT32, false, false,
+                      nullptr);
+  ExtensionInfo second(extendee, 2, WireFormatLite::TYPE_INT32, false, false,
+                       nullptr);
+  int first_index = ExtensionInfoCache::Index(extendee, 1);
+  int second_index = ExtensionInfoCache::Index(extendee, 2);
+  // Consecutive numbers of one extendee use distinct slots.
+  EXPECT_NE(first_index, second_index);
+  EXPECT_EQ(cache.Get(first_index), nullptr);
+
+  cache.Set(first_index, &first);
+  cache.Set(second_index, &second);
+  EXPECT_EQ(cache.Get(first_index), &first);
+  EXPECT_EQ(cache.Get(second_index), &second);
+  cache.Set(first_index, &second);
+  EXPECT_EQ(cache.Get(first_index), &second);
+}
+
+TEST(ExtensionSetTest, ParseRepeatedExtensionTags) {
+  unittest::TestAllExtensions source;
+  TestUtil::SetAllExtensions(&source);
+  for (int i = 0; i < 100; ++i) {
+    source.AddExtension(unittest::repeated_int32_extension, i);
+    source.AddExtension(unittest::repeated_string_extension, absl::StrCat(i));
+  }
+  // Concatenating the payload repeats every extension tag, so later ones are
+  // found through the parse's lookup cache.
+  std::string data = source.SerializeAsString();
+  data += data;
+  unittest::TestAllExtensions expected = source;
+  expected.MergeFrom(source);
+
+  unittest::TestAllExtensions parsed;
+  ASSERT_TRUE(parsed.ParseFromString(data));
+  EXPECT_TRUE(EqualsToSerialized(parsed, expected.SerializeAsString()));
+  EXPECT_EQ(parsed.ExtensionSize(unittest::repeated_int32_extension), 204);
+
+  // Also with extensions unknown to the generated registry.
+  unittest::TestEmptyMessageWithExtensions unknown;
+  ASSERT_TRUE(unknown.ParseFromString(data));
+  EXPECT_EQ(unknown.SerializeAsString(), data);
+}
+
 TEST(ExtensionSetTest, ExtensionSetSpaceUsed) {
   unittest::TestAllExtensions msg;
   size_t l = msg.SpaceUsedLong();
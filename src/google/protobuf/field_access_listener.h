@@ -140,12 +140,25 @@ struct NoOpAccessListener {
 }  // namespace google
 
 #ifndef REPLACE_PROTO_LISTENER_IMPL
+#if defined(PROTOBUF_SAMPLED_ACCESS_LISTENER)
+// Counts sampled field accesses, see sampled_access_listener.h.
+namespace google {
+namespace protobuf {
+template <typename Proto>
+struct SampledAccessListener;
+template <class T>
+using AccessListener = SampledAccessListener<T>;
+}  // namespace protobuf
+}  // namespace google
+#include "google/protobuf/sampled_access_listener.h"
+#else   // PROTOBUF_SAMPLED_ACCESS_LISTENER
 namespace google {
 namespace protobuf {
 template <class T>
 using AccessListener = NoOpAccessListener<T>;
 }  // namespace protobuf
 }  // namespace google
+#endif  // PROTOBUF_SAMPLED_ACCESS_LISTENER
 #else
 // You can put your implementations of hooks/listeners here.
 // All hooks are subject to approval by protobuf-team@.
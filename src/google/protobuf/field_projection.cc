@@ -0,0 +1,144 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/field_projection.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/log/absl_check.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/generated_message_tctable_impl.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/parse_context.h"
+#include "google/protobuf/repeated_ptr_field.h"
+#include "google/protobuf/unknown_field_set.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+const FieldProjection& FieldProjection::Get(
+    const Descriptor* descriptor, absl::Span<const int> field_numbers) {
+  std::vector<int> numbers;
+  numbers.reserve(field_numbers.size());
+  for (int number : field_numbers) {
+    if (descriptor->FindFieldByNumber(number) != nullptr) {
+      numbers.push_back(number);
+    }
+  }
+  std::sort(numbers.begin(), numbers.end());
+  numbers.erase(std::unique(numbers.begin(), numbers.end()), numbers.end());
+  return GetImpl(descriptor, std::move(numbers), false);
+}
+
+const FieldProjection& FieldProjection::Deferring(
+    const Descriptor* descriptor,
+    absl::Span<const int> deferred_field_numbers) {
+  std::vector<int> numbers;
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    const int number = descriptor->field(i)->number();
+    if (std::find(deferred_field_numbers.begin(), deferred_field_numbers.end(),
+                  number) == deferred_field_numbers.end()) {
+      numbers.push_back(number);
+    }
+  }
+  std::sort(numbers.begin(), numbers.end());
+  return GetImpl(descriptor, std::move(numbers), true);
+}
+
+const FieldProjection& FieldProjection::GetImpl(const Descriptor* descriptor,
+                                                std::vector<int> field_numbers,
+                                                bool keep_skipped_fields) {
+  using Key = std::tuple<const Descriptor*, std::vector<int>, bool>;
+  static absl::Mutex mutex(absl::kConstInit);
+  static auto* projections =
+      new absl::flat_hash_map<Key, const FieldProjection*>();
+
+  absl::MutexLock lock(&mutex);
+  Key key(descriptor, std::move(field_numbers), keep_skipped_fields);
+  auto it = projections->find(key);
+  if (it != projections->end()) return *it->second;
+
+  const Message* prototype =
+      MessageFactory::generated_factory()->GetPrototype(descriptor);
+  ABSL_CHECK(prototype != nullptr)
+      << "FieldProjection requires a generated message type, got "
+      << descriptor->full_name();
+  const Reflection* reflection = prototype->GetReflection();
+  const internal::TcParseTableBase* table = reflection->CreateTcParseTable(
+      &std::get<1>(key), keep_skipped_fields);
+  auto* projection = new FieldProjection(descriptor, std::get<1>(key),
+                                         keep_skipped_fields, table);
+  projections->emplace(std::move(key), projection);
+  return *projection;
+}
+
+const FieldProjection& FieldProjection::FromPaths(
+    const Descriptor* descriptor, const RepeatedPtrField<std::string>& paths) {
+  std::vector<int> numbers;
+  numbers.reserve(paths.size());
+  for (const std::string& path : paths) {
+    absl::string_view name = path;
+    name = name.substr(0, name.find('.'));
+    const FieldDescriptor* field = descriptor->FindFieldByName(name);
+    if (field != nullptr) numbers.push_back(field->number());
+  }
+  return Get(descriptor, numbers);
+}
+
+bool FieldProjection::MergePartialFromString(absl::string_view data,
+                                             Message* message) const {
+  ABSL_DCHECK_EQ(message->GetDescriptor(), descriptor_);
+  const char* ptr;
+  internal::ParseContext ctx(io::CodedInputStream::GetDefaultRecursionLimit(),
+                             false, &ptr, data);
+  ptr = internal::TcParser::ParseLoop(message, ptr, &ctx, table_);
+  return ptr != nullptr && ctx.EndedAtLimit();
+}
+
+bool FieldProjection::ParseDeferredFields(Message* message) {
+  const Descriptor* descriptor = message->GetDescriptor();
+  const Reflection* reflection = message->GetReflection();
+  if (reflection->GetUnknownFields(*message).empty()) return true;
+
+  UnknownFieldSet* unknown_fields = reflection->MutableUnknownFields(message);
+  UnknownFieldSet deferred;
+  for (int i = 0; i < unknown_fields->field_count(); ++i) {
+    const UnknownField& field = unknown_fields->field(i);
+    if (descriptor->FindFieldByNumber(field.number()) != nullptr) {
+      deferred.AddField(field);
+    }
+  }
+  if (deferred.empty()) return true;
+  for (int i = 0; i < deferred.field_count(); ++i) {
+    unknown_fields->DeleteByNumber(deferred.field(i).number());
+  }
+
+  std::string data;
+  deferred.SerializeToString(&data);
+  io::CodedInputStream input(reinterpret_cast<const uint8_t*>(data.data()),
+                             static_cast<int>(data.size()));
+  return message->MergePartialFromCodedStream(&input) &&
+         input.ConsumedEntireMessage();
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
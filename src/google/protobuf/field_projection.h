@@ -0,0 +1,137 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines FieldProjection, which parses only selected fields of a
+// message.
+
+#ifndef GOOGLE_PROTOBUF_FIELD_PROJECTION_H__
+#define GOOGLE_PROTOBUF_FIELD_PROJECTION_H__
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/repeated_ptr_field.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+struct TcParseTableBase;
+}  // namespace internal
+
+// A FieldProjection parses only a subset of the top-level fields of a message
+// type. All other fields are skipped over on the wire: they are neither
+// allocated nor stored in the unknown field set. Readers that only need a few
+// fields of a large message avoid paying for parsing the rest.
+//
+// Projected fields are parsed as usual, including all of their submessages.
+// Parsing through a projection is always partial: required fields that are
+// not projected are obviously missing.
+//
+// Projections are built once per message type and set of fields, and cached
+// for the lifetime of the program:
+//
+//   const FieldProjection& projection =
+//       FieldProjection::Get(MyMessage::descriptor(), {1, 7, 42});
+//   MyMessage message;
+//   if (!projection.ParsePartialFromString(data, &message)) { ... }
+//
+// Only generated message types, i.e. descriptors from
+// DescriptorPool::generated_pool(), can be projected. Get(), FromPaths() and
+// Deferring() crash for any other descriptor, e.g. one built into a dynamic
+// pool for DynamicMessage. Message types using message set wire format or weak
+// fields cannot be projected; their projections parse every field.
+//
+// Deferred parsing
+//
+// A projection made with Deferring() instead parses every field except the
+// deferred ones, whose bytes are kept undecoded in the message's unknown field
+// set. Serializing the message writes them back out unchanged, so proxies can
+// forward large nested payloads without ever decoding them. Readers that do
+// need the deferred fields decode them with ParseDeferredFields().
+class PROTOBUF_EXPORT FieldProjection {
+ public:
+  // Returns the projection of `descriptor` onto the fields with the given
+  // numbers. Numbers that are not fields of `descriptor` are ignored.
+  // `descriptor` must belong to a generated message type.
+  static const FieldProjection& Get(const Descriptor* descriptor,
+                                    absl::Span<const int> field_numbers);
+
+  // Returns the projection of `descriptor` onto the fields named by `paths`,
+  // e.g. the paths of a google.protobuf.FieldMask. Only the first component of
+  // each path is used: "a.b" projects the whole field "a". Names that are not
+  // fields of `descriptor` are ignored.
+  static const FieldProjection& FromPaths(
+      const Descriptor* descriptor, const RepeatedPtrField<std::string>& paths);
+
+  // Returns the projection of `descriptor` onto all fields except those with
+  // the given numbers, which are kept as unknown fields instead of skipped.
+  static const FieldProjection& Deferring(
+      const Descriptor* descriptor,
+      absl::Span<const int> deferred_field_numbers);
+
+  // Decodes the fields of `message` deferred by a Deferring() projection, i.e.
+  // all unknown fields whose numbers belong to known fields, and removes them
+  // from the unknown field set. Deferred values are merged as if they came
+  // last on the wire, so this should be called before modifying the deferred
+  // fields. Returns false if their bytes do not parse.
+  static bool ParseDeferredFields(Message* message);
+
+  FieldProjection(const FieldProjection&) = delete;
+  FieldProjection& operator=(const FieldProjection&) = delete;
+
+  const Descriptor* descriptor() const { return descriptor_; }
+  // Sorted numbers of the projected fields.
+  const std::vector<int>& field_numbers() const { return field_numbers_; }
+  // True for projections made with Deferring().
+  bool keeps_skipped_fields() const { return keep_skipped_fields_; }
+
+  // Merges the projected fields of the serialized message in `data` into
+  // `message`, which must be of the projected type. Missing required fields
+  // are not an error.
+  bool MergePartialFromString(absl::string_view data, Message* message) const;
+
+  // Like Message::ParsePartialFromString(), but only sets projected fields.
+  // `message` must be of the projected type.
+  bool ParsePartialFromString(absl::string_view data, Message* message) const {
+    message->Clear();
+    return MergePartialFromString(data, message);
+  }
+
+ private:
+  FieldProjection(const Descriptor* descriptor, std::vector<int> field_numbers,
+                  bool keep_skipped_fields,
+                  const internal::TcParseTableBase* table)
+      : descriptor_(descriptor),
+        field_numbers_(std::move(field_numbers)),
+        keep_skipped_fields_(keep_skipped_fields),
+        table_(table) {}
+
+  // `field_numbers` must be sorted, unique and valid for `descriptor`.
+  static const FieldProjection& GetImpl(const Descriptor* descriptor,
+                                        std::vector<int> field_numbers,
+                                        bool keep_skipped_fields);
+
+  const Descriptor* descriptor_;
+  std::vector<int> field_numbers_;
+  bool keep_skipped_fields_;
+  const internal::TcParseTableBase* table_;
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_FIELD_PROJECTION_H__
@@ -0,0 +1,159 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/field_projection.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/repeated_ptr_field.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+
+namespace google {
+namespace protobuf {
+namespace {
+
+TEST(FieldProjectionTest, ParsesOnlyProjectedFields) {
+  unittest::TestAllTypes source;
+  TestUtil::SetAllFields(&source);
+  const std::string data = source.SerializeAsString();
+
+  const FieldProjection& projection = FieldProjection::Get(
+      unittest::TestAllTypes::descriptor(),
+      {unittest::TestAllTypes::kOptionalNestedMessageFieldNumber,
+       unittest::TestAllTypes::kOptionalInt32FieldNumber,
+       unittest::TestAllTypes::kRepeatedStringFieldNumber});
+
+  unittest::TestAllTypes message;
+  ASSERT_TRUE(projection.ParsePartialFromString(data, &message));
+
+  EXPECT_EQ(message.optional_int32(), source.optional_int32());
+  EXPECT_EQ(message.optional_nested_message().bb(),
+            source.optional_nested_message().bb());
+  ASSERT_EQ(message.repeated_string_size(), source.repeated_string_size());
+  EXPECT_EQ(message.repeated_string(1), source.repeated_string(1));
+
+  EXPECT_FALSE(message.has_optional_int64());
+  EXPECT_FALSE(message.has_optional_string());
+  EXPECT_FALSE(message.has_optionalgroup());
+  EXPECT_EQ(message.repeated_int32_size(), 0);
+  EXPECT_EQ(message.repeated_nested_message_size(), 0);
+  EXPECT_FALSE(message.has_oneof_string());
+  // Skipped fields are not kept as unknown fields either.
+  EXPECT_EQ(message.GetReflection()->GetUnknownFields(message).field_count(),
+            0);
+}
+
+TEST(FieldProjectionTest, IsCached) {
+  const Descriptor* descriptor = unittest::TestAllTypes::descriptor();
+  const FieldProjection& a = FieldProjection::Get(descriptor, {3, 1, 2});
+  const FieldProjection& b = FieldProjection::Get(descriptor, {1, 2, 3, 1});
+  EXPECT_EQ(&a, &b);
+  EXPECT_EQ(a.field_numbers(), (std::vector<int>{1, 2, 3}));
+}
+
+TEST(FieldProjectionTest, FromPaths) {
+  unittest::TestAllTypes source;
+  TestUtil::SetAllFields(&source);
+
+  RepeatedPtrField<std::string> paths;
+  paths.Add("optional_string");
+  paths.Add("optional_foreign_message.c");
+  paths.Add("no_such_field");
+  const FieldProjection& projection =
+      FieldProjection::FromPaths(unittest::TestAllTypes::descriptor(), paths);
+  EXPECT_EQ(projection.field_numbers(),
+            (std::vector<int>{
+                unittest::TestAllTypes::kOptionalStringFieldNumber,
+                unittest::TestAllTypes::kOptionalForeignMessageFieldNumber}));
+
+  unittest::TestAllTypes message;
+  ASSERT_TRUE(
+      projection.ParsePartialFromString(source.SerializeAsString(), &message));
+  EXPECT_EQ(message.optional_string(), source.optional_string());
+  EXPECT_EQ(message.optional_foreign_message().c(),
+            source.optional_foreign_message().c());
+  EXPECT_FALSE(message.has_optional_int32());
+  EXPECT_FALSE(message.has_optional_nested_message());
+}
+
+TEST(FieldProjectionTest, MergeKeepsExistingFields) {
+  unittest::TestAllTypes source;
+  source.set_optional_int32(1);
+  source.set_optional_int64(2);
+
+  unittest::TestAllTypes message;
+  message.set_optional_uint32(3);
+  const FieldProjection& projection = FieldProjection::Get(
+      unittest::TestAllTypes::descriptor(),
+      {unittest::TestAllTypes::kOptionalInt32FieldNumber});
+  ASSERT_TRUE(
+      projection.MergePartialFromString(source.SerializeAsString(), &message));
+  EXPECT_EQ(message.optional_int32(), 1);
+  EXPECT_FALSE(message.has_optional_int64());
+  EXPECT_EQ(message.optional_uint32(), 3);
+}
+
+TEST(FieldProjectionTest, DeferredFieldsRoundTrip) {
+  unittest::TestAllTypes source;
+  TestUtil::SetAllFields(&source);
+
+  const FieldProjection& projection = FieldProjection::Deferring(
+      unittest::TestAllTypes::descriptor(),
+      {unittest::TestAllTypes::kOptionalNestedMessageFieldNumber,
+       unittest::TestAllTypes::kRepeatedForeignMessageFieldNumber});
+  EXPECT_TRUE(projection.keeps_skipped_fields());
+
+  unittest::TestAllTypes message;
+  ASSERT_TRUE(
+      projection.ParsePartialFromString(source.SerializeAsString(), &message));
+  EXPECT_EQ(message.optional_int32(), source.optional_int32());
+  EXPECT_EQ(message.optional_string(), source.optional_string());
+  EXPECT_FALSE(message.has_optional_nested_message());
+  EXPECT_EQ(message.repeated_foreign_message_size(), 0);
+  // The deferred bytes are kept and forwarded on serialization.
+  EXPECT_EQ(message.GetReflection()->GetUnknownFields(message).field_count(),
+            1 + source.repeated_foreign_message_size());
+
+  unittest::TestAllTypes forwarded;
+  ASSERT_TRUE(forwarded.ParseFromString(message.SerializeAsString()));
+  TestUtil::ExpectAllFieldsSet(forwarded);
+
+  ASSERT_TRUE(FieldProjection::ParseDeferredFields(&message));
+  EXPECT_TRUE(message.GetReflection()->GetUnknownFields(message).empty());
+  TestUtil::ExpectAllFieldsSet(message);
+}
+
+TEST(FieldProjectionTest, ParseDeferredFieldsKeepsUnknownFields) {
+  unittest::TestAllTypes message;
+  message.set_optional_int32(1);
+  message.GetReflection()->MutableUnknownFields(&message)->AddVarint(12345, 7);
+  ASSERT_TRUE(FieldProjection::ParseDeferredFields(&message));
+  EXPECT_EQ(message.optional_int32(), 1);
+  EXPECT_EQ(message.GetReflection()->GetUnknownFields(message).field_count(),
+            1);
+}
+
+TEST(FieldProjectionTest, RejectsMalformedInput) {
+  unittest::TestAllTypes source;
+  TestUtil::SetAllFields(&source);
+  std::string data = source.SerializeAsString();
+  data.resize(data.size() - 1);
+
+  const FieldProjection& projection = FieldProjection::Get(
+      unittest::TestAllTypes::descriptor(),
+      {unittest::TestAllTypes::kOptionalInt32FieldNumber});
+  unittest::TestAllTypes message;
+  EXPECT_FALSE(projection.ParsePartialFromString(data, &message));
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
@@ -16,6 +16,7 @@
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <vector>
 
 #include "absl/base/call_once.h"
 #include "absl/base/casts.h"
@@ -27,6 +28,8 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "google/protobuf/arena_align.h"
+#include "google/protobuf/arena_cleanup.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/descriptor.pb.h"
 #include "google/protobuf/descriptor_legacy.h"
@@ -56,6 +59,7 @@ using google::protobuf::internal::GenericTypeHandler;
 using google::protobuf::internal::GetEmptyString;
 using google::protobuf::internal::InlinedStringField;
 using google::protobuf::internal::InternalMetadata;
+using google::protobuf::internal::LazyAddDescriptorsRunner;
 using google::protobuf::internal::LazyField;
 using google::protobuf::internal::MapFieldBase;
 using google::protobuf::internal::MigrationSchema;
@@ -316,6 +320,9 @@ Reflection::~Reflection() {
   // No need to use sized delete. This code path is uncommon and it would not be
   // worth saving or recalculating the size.
   ::operator delete(const_cast<internal::TcParseTableBase*>(tcparse_table_));
+  delete merge_plan_;
+  delete space_used_plan_;
+  delete fields_by_number_;
 }
 
 const UnknownFieldSet& Reflection::GetUnknownFields(
@@ -353,25 +360,282 @@ bool Reflection::IsInlined(const FieldDescriptor* field) const {
   return schema_.IsFieldInlined(field);
 }
 
-size_t Reflection::SpaceUsedLong(const Message& message) const {
+namespace internal {
+
+// The fields of a message type that hold memory outside of the message
+// object, and how Reflection::SpaceUsedImpl() counts it.  Singular scalars
+// are left out, as the object size accounts for them.
+struct SpaceUsedPlan {
+  enum Kind : uint8_t {
+    kRepeatedField,  // A RepeatedField of `cpp_type`.
+    kRepeatedString,
+    kRepeatedMessage,
+    kMap,
+    kString,  // An ArenaStringPtr.
+    kInlinedString,
+    kCord,
+    kMessage,
+  };
+  struct Entry {
+    const FieldDescriptor* field;
+    Kind kind;
+    bool in_oneof;
+    FieldDescriptor::CppType cpp_type;
+  };
+  std::vector<Entry> entries;
+};
+
+}  // namespace internal
+
+const internal::SpaceUsedPlan& Reflection::GetSpaceUsedPlan() const {
+  absl::call_once(space_used_plan_once_, [&] {
+    using internal::SpaceUsedPlan;
+    auto* plan = new SpaceUsedPlan;
+    for (int i = 0; i <= last_non_weak_field_index_; i++) {
+      const FieldDescriptor* field = descriptor_->field(i);
+      SpaceUsedPlan::Kind kind;
+      if (field->is_repeated()) {
+        switch (field->cpp_type()) {
+          case FieldDescriptor::CPPTYPE_STRING:
+            // TODO:  Support other string reps.
+            kind = SpaceUsedPlan::kRepeatedString;
+            break;
+          case FieldDescriptor::CPPTYPE_MESSAGE:
+            kind = IsMapFieldInApi(field) ? SpaceUsedPlan::kMap
+                                          : SpaceUsedPlan::kRepeatedMessage;
+            break;
+          default:
+            kind = SpaceUsedPlan::kRepeatedField;
+            break;
+        }
+      } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
+        if (internal::cpp::EffectiveStringCType(field) == FieldOptions::CORD) {
+          kind = SpaceUsedPlan::kCord;
+        } else if (IsInlined(field)) {
+          kind = SpaceUsedPlan::kInlinedString;
+        } else {
+          kind = SpaceUsedPlan::kString;
+        }
+      } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+        kind = SpaceUsedPlan::kMessage;
+      } else {
+        // Field is inline, so the object size counts it.
+        continue;
+      }
+      plan->entries.push_back(
+          {field, kind, schema_.InRealOneof(field), field->cpp_type()});
+    }
+    space_used_plan_ = plan;
+  });
+  return *space_used_plan_;
+}
+
+size_t Reflection::SpaceUsedImpl(const Message& message,
+                                 bool heap_only) const {
+  using internal::SpaceUsedPlan;
+  // When counting only the heap memory of a message on an arena, the message
+  // object, its repeated field arrays and string objects are left out, but
+  // not the buffers of the strings, which are allocated on the heap.
+  const bool count_arena = !heap_only || message.GetArena() == nullptr;
+  const auto sub_message_space = [heap_only](const Message& sub_message) {
+    return heap_only ? sub_message.HeapSpaceUsedLong()
+                     : sub_message.SpaceUsedLong();
+  };
+
   // object_size_ already includes the in-memory representation of each field
   // in the message, so we only need to account for additional memory used by
   // the fields.
-  size_t total_size = schema_.GetObjectSize();
+  size_t total_size = 0;
+  if (count_arena) {
+    total_size += schema_.GetObjectSize();
+    total_size += GetUnknownFields(message).SpaceUsedExcludingSelfLong();
+    if (schema_.HasExtensionSet()) {
+      total_size += GetExtensionSet(message).SpaceUsedExcludingSelfLong();
+    }
+  }
+
+  // The default instance holds no memory besides its object.
+  if (schema_.IsDefaultInstance(message)) return total_size;
+
+  for (const SpaceUsedPlan::Entry& entry : GetSpaceUsedPlan().entries) {
+    const FieldDescriptor* field = entry.field;
+    if (entry.in_oneof && !HasOneofField(message, field)) continue;
+    switch (entry.kind) {
+      case SpaceUsedPlan::kRepeatedField:
+        if (!count_arena) break;
+        switch (entry.cpp_type) {
+#define HANDLE_TYPE(UPPERCASE, LOWERCASE)                           \
+  case FieldDescriptor::CPPTYPE_##UPPERCASE:                        \
+    total_size += GetRaw<RepeatedField<LOWERCASE> >(message, field) \
+                      .SpaceUsedExcludingSelfLong();                \
+    break
+
+          HANDLE_TYPE(INT32, int32_t);
+          HANDLE_TYPE(INT64, int64_t);
+          HANDLE_TYPE(UINT32, uint32_t);
+          HANDLE_TYPE(UINT64, uint64_t);
+          HANDLE_TYPE(DOUBLE, double);
+          HANDLE_TYPE(FLOAT, float);
+          HANDLE_TYPE(BOOL, bool);
+          HANDLE_TYPE(ENUM, int);
+#undef HANDLE_TYPE
+
+          default:
+            break;
+        }
+        break;
+
+      case SpaceUsedPlan::kRepeatedString: {
+        const auto& strings =
+            GetRaw<RepeatedPtrField<std::string> >(message, field);
+        if (count_arena) {
+          total_size += strings.SpaceUsedExcludingSelfLong();
+        } else {
+          for (const std::string& str : strings) {
+            total_size += StringSpaceUsedExcludingSelfLong(str);
+          }
+        }
+        break;
+      }
+
+      case SpaceUsedPlan::kRepeatedMessage: {
+        // We don't know which subclass of RepeatedPtrFieldBase the type is,
+        // so we use RepeatedPtrFieldBase directly.
+        const auto& messages = GetRaw<RepeatedPtrFieldBase>(message, field);
+        if (!heap_only) {
+          total_size += messages.SpaceUsedExcludingSelfLong<
+              GenericTypeHandler<Message> >();
+          break;
+        }
+        if (count_arena && !messages.using_sso()) {
+          total_size +=
+              static_cast<size_t>(messages.Capacity()) * sizeof(void*) +
+              RepeatedPtrFieldBase::kRepHeaderSize;
+        }
+        const int n = messages.allocated_size();
+        void* const* elems = messages.elements();
+        for (int i = 0; i < n; ++i) {
+          total_size += static_cast<const Message*>(elems[i])
+                            ->HeapSpaceUsedLong();
+        }
+        break;
+      }
+
+      case SpaceUsedPlan::kMap:
+        if (count_arena) {
+          total_size += GetRaw<internal::MapFieldBase>(message, field)
+                            .SpaceUsedExcludingSelfLong();
+        }
+        break;
+
+      case SpaceUsedPlan::kString: {
+        // Initially, the string points to the default value stored in the
+        // prototype. Only count the string if it has been changed from the
+        // default value.  Except oneof fields, those never point to a default
+        // instance, and there is no default instance to point to.
+        const auto& str = GetRaw<ArenaStringPtr>(message, field);
+        if (!str.IsDefault() || entry.in_oneof) {
+          // string fields are represented by just a pointer, so also
+          // include sizeof(string) as well.
+          if (count_arena) total_size += sizeof(std::string);
+          total_size += StringSpaceUsedExcludingSelfLong(str.Get());
+        }
+        break;
+      }
+
+      case SpaceUsedPlan::kInlinedString:
+        total_size += StringSpaceUsedExcludingSelfLong(
+            GetRaw<InlinedStringField>(message, field).GetNoArena());
+        break;
+
+      case SpaceUsedPlan::kCord:
+        if (entry.in_oneof) {
+          total_size +=
+              GetRaw<absl::Cord*>(message, field)->EstimatedMemoryUsage();
+        } else {
+          // sizeof(absl::Cord) is included to self.
+          total_size += GetRaw<absl::Cord>(message, field)
+                            .EstimatedMemoryUsage() -
+                        sizeof(absl::Cord);
+        }
+        break;
+
+      case SpaceUsedPlan::kMessage: {
+        const Message* sub_message = GetRaw<const Message*>(message, field);
+        if (sub_message != nullptr) {
+          total_size += sub_message_space(*sub_message);
+        }
+        break;
+      }
+    }
+  }
+  return total_size;
+}
+
+size_t Reflection::SpaceUsedLong(const Message& message) const {
+  const size_t total_size = SpaceUsedImpl(message, /*heap_only=*/false);
+#ifndef PROTOBUF_FUZZ_MESSAGE_SPACE_USED_LONG
+  return total_size;
+#else
+  // Use both `this` and `dummy` to generate the seed so that the scale factor
+  // is both per-object and non-predictable, but consistent across multiple
+  // calls in the same binary.
+  static bool dummy;
+  uintptr_t seed =
+      reinterpret_cast<uintptr_t>(&dummy) ^ reinterpret_cast<uintptr_t>(this);
+  // Fuzz the size by +/- 50%.
+  double scale = (static_cast<double>(seed % 10000) / 10000) + 0.5;
+  return total_size * scale;
+#endif
+}
 
-  total_size += GetUnknownFields(message).SpaceUsedExcludingSelfLong();
+size_t Reflection::HeapSpaceUsedLong(const Message& message) const {
+  return SpaceUsedImpl(message, /*heap_only=*/true);
+}
+
+size_t Reflection::ArenaSpaceUsedLong(const Message& message) const {
+  Arena* arena = message.GetArena();
+  if (arena == nullptr) return 0;
+  using internal::ArenaAlignDefault;
+
+  // Messages are allocated with the default arena alignment.
+  size_t total_size = ArenaAlignDefault::Ceil(schema_.GetObjectSize());
 
   if (schema_.HasExtensionSet()) {
+    // Extensions are estimated the same way SpaceUsedLong() does.
     total_size += GetExtensionSet(message).SpaceUsedExcludingSelfLong();
   }
+  const auto sub_message_space = [arena](const Message* sub_message) {
+    // A submessage may be on another arena (or the heap) after
+    // unsafe_arena_set_allocated_*; its bytes are not held by `arena` then.
+    return sub_message->GetArena() == arena ? sub_message->ArenaSpaceUsedLong()
+                                            : 0;
+  };
+  // Counts the element array of a repeated pointer field including its unused
+  // capacity, and every allocated element including cleared ones.
+  const auto repeated_ptr_space = [](const internal::RepeatedPtrFieldBase& rep,
+                                     auto element_space) {
+    size_t size = 0;
+    if (!rep.using_sso()) {
+      size = ArenaAlignDefault::Ceil(
+          static_cast<size_t>(rep.Capacity()) * sizeof(void*) +
+          internal::RepeatedPtrFieldBase::kRepHeaderSize);
+    }
+    const int n = rep.allocated_size();
+    void* const* elems = rep.elements();
+    for (int i = 0; i < n; ++i) size += element_space(elems[i]);
+    return size;
+  };
+
   for (int i = 0; i <= last_non_weak_field_index_; i++) {
     const FieldDescriptor* field = descriptor_->field(i);
     if (field->is_repeated()) {
       switch (field->cpp_type()) {
-#define HANDLE_TYPE(UPPERCASE, LOWERCASE)                           \
-  case FieldDescriptor::CPPTYPE_##UPPERCASE:                        \
-    total_size += GetRaw<RepeatedField<LOWERCASE> >(message, field) \
-                      .SpaceUsedExcludingSelfLong();                \
+#define HANDLE_TYPE(UPPERCASE, LOWERCASE)                        \
+  case FieldDescriptor::CPPTYPE_##UPPERCASE:                     \
+    total_size += ArenaAlignDefault::Ceil(                        \
+        GetRaw<RepeatedField<LOWERCASE> >(message, field)         \
+            .SpaceUsedExcludingSelfLong());                       \
     break
 
         HANDLE_TYPE(INT32, int32_t);
@@ -385,14 +649,11 @@ size_t Reflection::SpaceUsedLong(const Message& message) const {
 #undef HANDLE_TYPE
 
         case FieldDescriptor::CPPTYPE_STRING:
-          switch (field->options().ctype()) {
-            default:  // TODO:  Support other string reps.
-            case FieldOptions::STRING:
-              total_size +=
-                  GetRaw<RepeatedPtrField<std::string> >(message, field)
-                      .SpaceUsedExcludingSelfLong();
-              break;
-          }
+          // Arena strings are carved out of StringBlocks; their out-of-line
+          // buffers live on the heap.
+          total_size += repeated_ptr_space(
+              GetRaw<internal::RepeatedPtrFieldBase>(message, field),
+              [](void*) { return sizeof(std::string); });
           break;
 
         case FieldDescriptor::CPPTYPE_MESSAGE:
@@ -400,13 +661,12 @@ size_t Reflection::SpaceUsedLong(const Message& message) const {
             total_size += GetRaw<internal::MapFieldBase>(message, field)
                               .SpaceUsedExcludingSelfLong();
           } else {
-            // We don't know which subclass of RepeatedPtrFieldBase the type is,
-            // so we use RepeatedPtrFieldBase directly.
-            total_size +=
-                GetRaw<RepeatedPtrFieldBase>(message, field)
-                    .SpaceUsedExcludingSelfLong<GenericTypeHandler<Message> >();
+            total_size += repeated_ptr_space(
+                GetRaw<internal::RepeatedPtrFieldBase>(message, field),
+                [&](void* elem) {
+                  return sub_message_space(static_cast<const Message*>(elem));
+                });
           }
-
           break;
       }
     } else {
@@ -414,83 +674,45 @@ size_t Reflection::SpaceUsedLong(const Message& message) const {
         continue;
       }
       switch (field->cpp_type()) {
-        case FieldDescriptor::CPPTYPE_INT32:
-        case FieldDescriptor::CPPTYPE_INT64:
-        case FieldDescriptor::CPPTYPE_UINT32:
-        case FieldDescriptor::CPPTYPE_UINT64:
-        case FieldDescriptor::CPPTYPE_DOUBLE:
-        case FieldDescriptor::CPPTYPE_FLOAT:
-        case FieldDescriptor::CPPTYPE_BOOL:
-        case FieldDescriptor::CPPTYPE_ENUM:
-          // Field is inline, so we've already counted it.
-          break;
-
-        case FieldDescriptor::CPPTYPE_STRING: {
+        case FieldDescriptor::CPPTYPE_STRING:
           switch (internal::cpp::EffectiveStringCType(field)) {
             case FieldOptions::CORD:
+              // Oneof cords are created on the arena together with their
+              // cleanup node; other cords are part of the message.
               if (schema_.InRealOneof(field)) {
-                total_size += GetField<absl::Cord*>(message, field)
-                                  ->EstimatedMemoryUsage();
-
-              } else {
-                // sizeof(absl::Cord) is included to self.
-                total_size += GetField<absl::Cord>(message, field)
-                                  .EstimatedMemoryUsage() -
-                              sizeof(absl::Cord);
+                total_size += ArenaAlignDefault::Ceil(sizeof(absl::Cord)) +
+                              internal::cleanup::Size(
+                                  &internal::cleanup::arena_destruct_object<
+                                      absl::Cord>);
               }
               break;
             default:
             case FieldOptions::STRING:
-              if (IsInlined(field)) {
-                const std::string* ptr =
-                    &GetField<InlinedStringField>(message, field).GetNoArena();
-                total_size += StringSpaceUsedExcludingSelfLong(*ptr);
-              } else {
-                // Initially, the string points to the default value stored
-                // in the prototype. Only count the string if it has been
-                // changed from the default value.
-                // Except oneof fields, those never point to a default instance,
-                // and there is no default instance to point to.
-                const auto& str = GetField<ArenaStringPtr>(message, field);
-                if (!str.IsDefault() || schema_.InRealOneof(field)) {
-                  // string fields are represented by just a pointer, so also
-                  // include sizeof(string) as well.
-                  total_size += sizeof(std::string) +
-                                StringSpaceUsedExcludingSelfLong(str.Get());
-                }
+              if (!IsInlined(field) &&
+                  (!GetField<ArenaStringPtr>(message, field).IsDefault() ||
+                   schema_.InRealOneof(field))) {
+                total_size += sizeof(std::string);
               }
               break;
           }
           break;
-        }
 
         case FieldDescriptor::CPPTYPE_MESSAGE:
-          if (schema_.IsDefaultInstance(message)) {
-            // For singular fields, the prototype just stores a pointer to the
-            // external type's prototype, so there is no extra memory usage.
-          } else {
+          if (!schema_.IsDefaultInstance(message)) {
             const Message* sub_message = GetRaw<const Message*>(message, field);
             if (sub_message != nullptr) {
-              total_size += sub_message->SpaceUsedLong();
+              total_size += sub_message_space(sub_message);
             }
           }
           break;
+
+        default:
+          // Field is inline, so we've already counted it.
+          break;
       }
     }
   }
-#ifndef PROTOBUF_FUZZ_MESSAGE_SPACE_USED_LONG
   return total_size;
-#else
-  // Use both `this` and `dummy` to generate the seed so that the scale factor
-  // is both per-object and non-predictable, but consistent across multiple
-  // calls in the same binary.
-  static bool dummy;
-  uintptr_t seed =
-      reinterpret_cast<uintptr_t>(&dummy) ^ reinterpret_cast<uintptr_t>(this);
-  // Fuzz the size by +/- 50%.
-  double scale = (static_cast<double>(seed % 10000) / 10000) + 0.5;
-  return total_size * scale;
-#endif
 }
 
 namespace {
@@ -1185,6 +1407,257 @@ void Reflection::UnsafeArenaSwapFields(
 
 // -------------------------------------------------------------------
 
+namespace internal {
+bool FieldAccessorOps<std::string>::IsSet(const ArenaStringPtr& value) {
+  return !value.Get().empty();
+}
+
+const std::string* FieldAccessorOps<std::string>::Get(
+    const ArenaStringPtr& value) {
+  return value.IsDefault() ? nullptr : &value.Get();
+}
+
+void FieldAccessorOps<std::string>::Set(ArenaStringPtr* value,
+                                        absl::string_view new_value,
+                                        Arena* arena) {
+  value->Set(new_value, arena);
+}
+}  // namespace internal
+
+internal::FieldAccessorLayout Reflection::GetFieldAccessorLayout(
+    const FieldDescriptor* field, FieldDescriptor::CppType cpp_type) const {
+  USAGE_CHECK_MESSAGE_TYPE(GetFieldAccessor);
+  USAGE_CHECK_SINGULAR(GetFieldAccessor);
+  if (field->cpp_type() != cpp_type &&
+      !(cpp_type == FieldDescriptor::CPPTYPE_INT32 &&
+        field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM)) {
+    ReportReflectionUsageTypeError(descriptor_, field, "GetFieldAccessor",
+                                   cpp_type);
+  }
+  if (cpp_type == FieldDescriptor::CPPTYPE_STRING) {
+    USAGE_CHECK_NE(internal::cpp::EffectiveStringCType(field),
+                   FieldOptions::CORD, GetFieldAccessor,
+                   "Field is a cord; use GetCord() and SetString().");
+  }
+
+  internal::FieldAccessorLayout layout;
+  layout.set_through_reflection =
+      field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM &&
+      !CreateUnknownEnumValues(field);
+  if (field->is_extension() || schema_.IsSplit(field) || IsInlined(field)) {
+    return layout;
+  }
+  layout.offset = schema_.GetFieldOffset(field);
+  if (schema_.InRealOneof(field)) {
+    layout.kind = internal::FieldAccessorLayout::kOneof;
+    layout.presence_offset =
+        schema_.GetOneofCaseOffset(field->containing_oneof());
+    layout.presence_value = static_cast<uint32_t>(field->number());
+  } else if (schema_.HasBitIndex(field) != static_cast<uint32_t>(-1)) {
+    const uint32_t index = schema_.HasBitIndex(field);
+    layout.kind = internal::FieldAccessorLayout::kHasBit;
+    layout.presence_offset = static_cast<uint32_t>(
+        schema_.HasBitsOffset() + index / 32 * sizeof(uint32_t));
+    layout.presence_value = static_cast<uint32_t>(1) << (index % 32);
+  } else {
+    layout.kind = internal::FieldAccessorLayout::kImplicit;
+  }
+  return layout;
+}
+
+namespace {
+
+// How GetColumns() reads one column.
+struct ColumnPlan {
+  const Reflection::FieldColumn* column;
+  internal::FieldAccessorLayout layout;
+  // The size of a value in the column, or 0 for strings.
+  uint32_t size;
+  // For kHasBit, which of the has-bit words loaded per message holds the bit.
+  uint32_t word;
+  // For kOneof, the value of messages that do not have the field.
+  char default_value[8];
+  absl::string_view default_string;
+};
+
+template <typename T>
+void SetColumnValue(ColumnPlan& plan, T value) {
+  static_assert(sizeof(T) <= sizeof(plan.default_value), "");
+  plan.size = sizeof(T);
+  memcpy(plan.default_value, &value, sizeof(T));
+}
+
+template <typename T>
+void StoreColumnValue(const Reflection::FieldColumn& column, size_t i,
+                      T value) {
+  static_cast<T*>(column.values)[i] = value;
+}
+
+// Reads the field of `column` in message `i` through `reflection`.
+void ReadColumnThroughReflection(const Reflection& reflection,
+                                 const Message& message,
+                                 const Reflection::FieldColumn& column,
+                                 size_t i) {
+  const FieldDescriptor* field = column.field;
+  if (column.has != nullptr) {
+    column.has[i] = reflection.HasField(message, field);
+  }
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+      return StoreColumnValue(column, i, reflection.GetInt32(message, field));
+    case FieldDescriptor::CPPTYPE_ENUM:
+      return StoreColumnValue(column, i,
+                              reflection.GetEnumValue(message, field));
+    case FieldDescriptor::CPPTYPE_INT64:
+      return StoreColumnValue(column, i, reflection.GetInt64(message, field));
+    case FieldDescriptor::CPPTYPE_UINT32:
+      return StoreColumnValue(column, i, reflection.GetUInt32(message, field));
+    case FieldDescriptor::CPPTYPE_UINT64:
+      return StoreColumnValue(column, i, reflection.GetUInt64(message, field));
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      return StoreColumnValue(column, i, reflection.GetFloat(message, field));
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      return StoreColumnValue(column, i, reflection.GetDouble(message, field));
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return StoreColumnValue(column, i, reflection.GetBool(message, field));
+    case FieldDescriptor::CPPTYPE_STRING:
+      return StoreColumnValue(
+          column, i,
+          absl::string_view(
+              reflection.GetStringReference(message, field, nullptr)));
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      break;
+  }
+  ABSL_LOG(FATAL) << "Can't get here.";
+}
+
+}  // namespace
+
+void Reflection::GetColumns(absl::Span<const Message* const> messages,
+                            absl::Span<const FieldColumn> columns) const {
+  using Layout = internal::FieldAccessorLayout;
+
+  std::vector<ColumnPlan> plans(columns.size());
+  // The offsets of the has-bit words that any column needs.
+  std::vector<uint32_t> word_offsets;
+  for (size_t i = 0; i < columns.size(); ++i) {
+    const FieldDescriptor* field = columns[i].field;
+    ABSL_DCHECK(columns[i].values != nullptr);
+    USAGE_CHECK_MESSAGE_TYPE(GetColumns);
+    USAGE_CHECK_SINGULAR(GetColumns);
+    USAGE_CHECK_NE(field->cpp_type(), FieldDescriptor::CPPTYPE_MESSAGE,
+                   GetColumns, "Field is a message.");
+    ColumnPlan& plan = plans[i];
+    plan.column = &columns[i];
+    plan.layout = GetFieldAccessorLayout(field, field->cpp_type());
+    plan.word = 0;
+    switch (field->cpp_type()) {
+      case FieldDescriptor::CPPTYPE_INT32:
+        SetColumnValue(plan, field->default_value_int32());
+        break;
+      case FieldDescriptor::CPPTYPE_ENUM:
+        SetColumnValue(plan, field->default_value_enum()->number());
+        break;
+      case FieldDescriptor::CPPTYPE_INT64:
+        SetColumnValue(plan, field->default_value_int64());
+        break;
+      case FieldDescriptor::CPPTYPE_UINT32:
+        SetColumnValue(plan, field->default_value_uint32());
+        break;
+      case FieldDescriptor::CPPTYPE_UINT64:
+        SetColumnValue(plan, field->default_value_uint64());
+        break;
+      case FieldDescriptor::CPPTYPE_FLOAT:
+        SetColumnValue(plan, field->default_value_float());
+        break;
+      case FieldDescriptor::CPPTYPE_DOUBLE:
+        SetColumnValue(plan, field->default_value_double());
+        break;
+      case FieldDescriptor::CPPTYPE_BOOL:
+        SetColumnValue(plan, field->default_value_bool());
+        break;
+      default:
+        plan.size = 0;
+        plan.default_string = field->default_value_string();
+        break;
+    }
+    if (plan.layout.kind == Layout::kHasBit) {
+      auto it = std::find(word_offsets.begin(), word_offsets.end(),
+                          plan.layout.presence_offset);
+      plan.word = static_cast<uint32_t>(it - word_offsets.begin());
+      if (it == word_offsets.end()) {
+        word_offsets.push_back(plan.layout.presence_offset);
+      }
+    }
+  }
+  // Read the fields in the order they are laid out in, and those that can
+  // only be read through reflection last.
+  std::stable_sort(plans.begin(), plans.end(),
+                   [](const ColumnPlan& a, const ColumnPlan& b) {
+                     auto key = [](const ColumnPlan& plan) {
+                       return plan.layout.kind == Layout::kReflection
+                                  ? UINT32_MAX
+                                  : plan.layout.offset;
+                     };
+                     return key(a) < key(b);
+                   });
+
+  std::vector<uint32_t> words(word_offsets.size());
+  for (size_t i = 0; i < messages.size(); ++i) {
+    const Message& message = *messages[i];
+    ABSL_DCHECK_EQ(message.GetReflection(), this);
+    for (size_t w = 0; w < word_offsets.size(); ++w) {
+      words[w] = internal::GetConstRefAtOffset<uint32_t>(message,
+                                                         word_offsets[w]);
+    }
+    for (const ColumnPlan& plan : plans) {
+      const FieldColumn& column = *plan.column;
+      bool has;
+      switch (plan.layout.kind) {
+        case Layout::kImplicit:
+          has = true;  // Decided from the value below.
+          break;
+        case Layout::kHasBit:
+          has = (words[plan.word] & plan.layout.presence_value) != 0;
+          break;
+        case Layout::kOneof:
+          has = internal::GetConstRefAtOffset<uint32_t>(
+                    message, plan.layout.presence_offset) ==
+                plan.layout.presence_value;
+          break;
+        default:
+          ReadColumnThroughReflection(*this, message, column, i);
+          continue;
+      }
+      const void* raw = has || plan.layout.kind != Layout::kOneof
+                            ? internal::GetConstPointerAtOffset<void>(
+                                  &message, plan.layout.offset)
+                            : nullptr;
+      if (plan.size == 0) {
+        absl::string_view value = plan.default_string;
+        if (raw != nullptr) {
+          const auto& str = *static_cast<const internal::ArenaStringPtr*>(raw);
+          // The default string of the field may not be the empty one.
+          if (!str.IsDefault()) value = str.Get();
+        }
+        if (plan.layout.kind == Layout::kImplicit) has = !value.empty();
+        static_cast<absl::string_view*>(column.values)[i] = value;
+      } else {
+        if (raw == nullptr) raw = plan.default_value;
+        if (plan.layout.kind == Layout::kImplicit) {
+          // Like HasField(), compares the bits so that -0.0 is set.
+          uint64_t bits = 0;
+          memcpy(&bits, raw, plan.size);
+          has = bits != 0;
+        }
+        memcpy(static_cast<char*>(column.values) + i * plan.size, raw,
+               plan.size);
+      }
+      if (column.has != nullptr) column.has[i] = has;
+    }
+  }
+}
+
 bool Reflection::HasField(const Message& message,
                           const FieldDescriptor* field) const {
   USAGE_CHECK_MESSAGE(HasField, &message);
@@ -1627,40 +2100,15 @@ void Reflection::ListFields(const Message& message,
   // seems more trouble than it is worth.
   const uint32_t* const has_bits =
       schema_.HasHasbits() ? GetHasBits(message) : nullptr;
-  const uint32_t* const has_bits_indices = schema_.has_bit_indices_;
   output->reserve(descriptor_->field_count());
   const int last_non_weak_field_index = last_non_weak_field_index_;
   // Fields in messages are usually added with the increasing tags.
   uint32_t last = 0;  // UINT32_MAX if out-of-order
-  auto append_to_output = [&last, &output](const FieldDescriptor* field) {
-    CheckInOrder(field, &last);
-    output->push_back(field);
-  };
   for (int i = 0; i <= last_non_weak_field_index; i++) {
     const FieldDescriptor* field = descriptor_->field(i);
-    if (field->is_repeated()) {
-      if (FieldSize(message, field) > 0) {
-        append_to_output(field);
-      }
-    } else {
-      const OneofDescriptor* containing_oneof = field->containing_oneof();
-      if (schema_.InRealOneof(field)) {
-        const uint32_t* const oneof_case_array =
-            GetConstPointerAtOffset<uint32_t>(&message,
-                                              schema_.oneof_case_offset_);
-        // Equivalent to: HasOneofField(message, field)
-        if (static_cast<int64_t>(oneof_case_array[containing_oneof->index()]) ==
-            field->number()) {
-          append_to_output(field);
-        }
-      } else if (has_bits && has_bits_indices[i] != static_cast<uint32_t>(-1)) {
-        // Equivalent to: HasBit(message, field)
-        if (IsIndexInHasBitSet(has_bits, has_bits_indices[i])) {
-          append_to_output(field);
-        }
-      } else if (HasBit(message, field)) {  // Fall back on proto3-style HasBit.
-        append_to_output(field);
-      }
+    if (IsFieldListed(message, field, has_bits)) {
+      CheckInOrder(field, &last);
+      output->push_back(field);
     }
   }
   // Descriptors of ExtensionSet are appended in their increasing tag
@@ -1690,6 +2138,355 @@ void Reflection::ListFields(const Message& message,
   }
 }
 
+bool Reflection::IsFieldListed(const Message& message,
+                               const FieldDescriptor* field,
+                               const uint32_t* has_bits) const {
+  if (field->is_repeated()) {
+    return FieldSize(message, field) > 0;
+  }
+  if (schema_.InRealOneof(field)) {
+    const uint32_t* const oneof_case_array =
+        GetConstPointerAtOffset<uint32_t>(&message, schema_.oneof_case_offset_);
+    // Equivalent to: HasOneofField(message, field)
+    return static_cast<int64_t>(
+               oneof_case_array[field->containing_oneof()->index()]) ==
+           field->number();
+  }
+  if (has_bits && schema_.has_bit_indices_[field->index()] !=
+                      static_cast<uint32_t>(-1)) {
+    // Equivalent to: HasBit(message, field)
+    return IsIndexInHasBitSet(has_bits,
+                              schema_.has_bit_indices_[field->index()]);
+  }
+  // Fall back on proto3-style HasBit.
+  return HasBit(message, field);
+}
+
+const std::vector<int>& Reflection::GetFieldsByNumber() const {
+  absl::call_once(fields_by_number_once_, [&] {
+    auto* fields = new std::vector<int>(last_non_weak_field_index_ + 1);
+    for (int i = 0; i <= last_non_weak_field_index_; i++) {
+      (*fields)[i] = i;
+    }
+    std::sort(fields->begin(), fields->end(), [&](int left, int right) {
+      return descriptor_->field(left)->number() <
+             descriptor_->field(right)->number();
+    });
+    fields_by_number_ = fields;
+  });
+  return *fields_by_number_;
+}
+
+namespace {
+
+// Returns true if `descriptor` or a message type it refers to has required
+// fields or extension ranges. Types in `visited` are skipped, so that each
+// type is only looked at once even in recursive schemas.
+bool MayHaveRequiredFields(const Descriptor* descriptor,
+                           absl::flat_hash_set<const Descriptor*>* visited) {
+  if (!visited->insert(descriptor).second) return false;
+  if (descriptor->extension_range_count() > 0) return true;
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const FieldDescriptor* field = descriptor->field(i);
+    if (field->is_required()) return true;
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
+        MayHaveRequiredFields(field->message_type(), visited)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+bool Reflection::MayBeUninitialized() const {
+  absl::call_once(may_be_uninitialized_once_, [&] {
+    absl::flat_hash_set<const Descriptor*> visited;
+    may_be_uninitialized_ = MayHaveRequiredFields(descriptor_, &visited);
+  });
+  return may_be_uninitialized_;
+}
+
+void Reflection::ForEachListedField(
+    const Message& message,
+    absl::FunctionRef<void(const FieldDescriptor*)> visitor) const {
+  if (schema_.IsDefaultInstance(message)) return;
+  if (schema_.HasExtensionSet() &&
+      GetExtensionSet(message).NumExtensions() > 0) {
+    // Extensions may be numbered in between fields; let ListFields() merge
+    // them.
+    std::vector<const FieldDescriptor*> fields;
+    ListFields(message, &fields);
+    for (const FieldDescriptor* field : fields) {
+      visitor(field);
+    }
+    return;
+  }
+
+  const uint32_t* const has_bits =
+      schema_.HasHasbits() ? GetHasBits(message) : nullptr;
+  for (int index : GetFieldsByNumber()) {
+    const FieldDescriptor* field = descriptor_->field(index);
+    if (IsFieldListed(message, field, has_bits)) {
+      visitor(field);
+    }
+  }
+}
+
+namespace internal {
+
+// The fields of a message type, grouped by how
+// Reflection::MergeInPlaceFields() merges them.
+struct MergePlan {
+  // A singular scalar field, kept at `offset`.
+  struct Scalar {
+    uint32_t offset;
+    uint32_t size;
+    // Its bit in the has-bit word of the run, or 0 for implicit presence.
+    uint32_t has_mask;
+  };
+  // Scalar fields laid out back to back, whose has-bits are all in the word
+  // at `has_offset`, or which all have implicit presence.
+  struct Run {
+    uint32_t offset;
+    uint32_t size;
+    uint32_t has_offset;
+    // The has-bits of all fields of the run, or 0 for implicit presence.
+    uint32_t has_mask;
+    // The fields of the run are scalars[begin, end).
+    uint32_t begin;
+    uint32_t end;
+  };
+  // A singular ArenaStringPtr field.
+  struct String {
+    uint32_t offset;
+    uint32_t has_offset;
+    uint32_t has_mask;
+    const std::string* default_value;
+  };
+  // A RepeatedField or RepeatedPtrField<std::string>.
+  struct Repeated {
+    uint32_t offset;
+    void (*merge)(const void* from, void* to);
+  };
+
+  std::vector<Scalar> scalars;
+  std::vector<Run> runs;
+  std::vector<String> strings;
+  std::vector<Repeated> repeated;
+  std::vector<const OneofDescriptor*> oneofs;
+  // Merged field by field by the caller.
+  std::vector<const FieldDescriptor*> other_fields;
+};
+
+}  // namespace internal
+
+namespace {
+
+template <typename T>
+void MergeRepeated(const void* from, void* to) {
+  static_cast<T*>(to)->MergeFrom(*static_cast<const T*>(from));
+}
+
+// The size of the C++ type of a scalar field.
+uint32_t ScalarSize(const FieldDescriptor* field) {
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return sizeof(bool);
+    case FieldDescriptor::CPPTYPE_INT64:
+    case FieldDescriptor::CPPTYPE_UINT64:
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      return sizeof(uint64_t);
+    default:
+      return sizeof(uint32_t);
+  }
+}
+
+}  // namespace
+
+const internal::MergePlan& Reflection::GetMergePlan() const {
+  absl::call_once(merge_plan_once_, [&] {
+    using internal::MergePlan;
+    auto* plan = new MergePlan;
+    struct Candidate {
+      MergePlan::Scalar scalar;
+      uint32_t has_offset;
+    };
+    std::vector<Candidate> candidates;
+    for (int i = 0; i <= last_non_weak_field_index_; ++i) {
+      const FieldDescriptor* field = descriptor_->field(i);
+      if (schema_.InRealOneof(field)) continue;
+      const uint32_t has_bit = schema_.HasBitIndex(field);
+      uint32_t has_offset = 0;
+      uint32_t has_mask = 0;
+      if (has_bit != static_cast<uint32_t>(-1)) {
+        has_offset = static_cast<uint32_t>(schema_.HasBitsOffset() +
+                                           has_bit / 32 * sizeof(uint32_t));
+        has_mask = static_cast<uint32_t>(1) << (has_bit % 32);
+      }
+      const bool in_place =
+          !schema_.IsSplit(field) && !field->is_map() && !IsLazyField(field) &&
+          !IsInlined(field) &&
+          (field->cpp_type() != FieldDescriptor::CPPTYPE_STRING ||
+           internal::cpp::EffectiveStringCType(field) == FieldOptions::STRING);
+      const uint32_t offset = schema_.GetFieldOffset(field);
+      if (!in_place || field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+        plan->other_fields.push_back(field);
+      } else if (field->is_repeated()) {
+        void (*merge)(const void*, void*);
+        switch (field->cpp_type()) {
+#define HANDLE_TYPE(CPPTYPE, TYPE)               \
+  case FieldDescriptor::CPPTYPE_##CPPTYPE:       \
+    merge = &MergeRepeated<RepeatedField<TYPE>>; \
+    break;
+          HANDLE_TYPE(INT32, int32_t);
+          HANDLE_TYPE(INT64, int64_t);
+          HANDLE_TYPE(UINT32, uint32_t);
+          HANDLE_TYPE(UINT64, uint64_t);
+          HANDLE_TYPE(FLOAT, float);
+          HANDLE_TYPE(DOUBLE, double);
+          HANDLE_TYPE(BOOL, bool);
+          HANDLE_TYPE(ENUM, int);
+#undef HANDLE_TYPE
+          default:
+            merge = &MergeRepeated<RepeatedPtrField<std::string>>;
+            break;
+        }
+        plan->repeated.push_back({offset, merge});
+      } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
+        plan->strings.push_back(
+            {offset, has_offset, has_mask, &field->default_value_string()});
+      } else {
+        candidates.push_back(
+            {{offset, ScalarSize(field), has_mask}, has_offset});
+      }
+    }
+    for (int i = 0; i < descriptor_->real_oneof_decl_count(); ++i) {
+      plan->oneofs.push_back(descriptor_->real_oneof_decl(i));
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& a, const Candidate& b) {
+                return a.scalar.offset < b.scalar.offset;
+              });
+    for (const Candidate& candidate : candidates) {
+      MergePlan::Run* run = plan->runs.empty() ? nullptr : &plan->runs.back();
+      if (run == nullptr ||
+          run->offset + run->size != candidate.scalar.offset ||
+          (run->has_mask == 0) != (candidate.scalar.has_mask == 0) ||
+          run->has_offset != candidate.has_offset) {
+        const uint32_t begin = static_cast<uint32_t>(plan->scalars.size());
+        plan->runs.push_back({candidate.scalar.offset, 0,
+                              candidate.has_offset, 0, begin, begin});
+        run = &plan->runs.back();
+      }
+      run->size += candidate.scalar.size;
+      run->has_mask |= candidate.scalar.has_mask;
+      ++run->end;
+      plan->scalars.push_back(candidate.scalar);
+    }
+    merge_plan_ = plan;
+  });
+  return *merge_plan_;
+}
+
+void Reflection::MergeInPlaceFields(
+    const Message& from, Message* to, bool to_is_clear,
+    std::vector<const FieldDescriptor*>* other_fields) const {
+  ABSL_DCHECK_EQ(from.GetReflection(), this);
+  ABSL_DCHECK_EQ(to->GetReflection(), this);
+  other_fields->clear();
+  // The default instance never has any fields set.
+  if (schema_.IsDefaultInstance(from)) return;
+
+  const internal::MergePlan& plan = GetMergePlan();
+  const char* const from_base = reinterpret_cast<const char*>(&from);
+  char* const to_base = reinterpret_cast<char*>(to);
+  auto has_word = [](const char* base, uint32_t offset) {
+    uint32_t word;
+    memcpy(&word, base + offset, sizeof(word));
+    return word;
+  };
+  auto set_has_bits = [to_base](uint32_t offset, uint32_t mask) {
+    *reinterpret_cast<uint32_t*>(to_base + offset) |= mask;
+  };
+
+  using Scalar = internal::MergePlan::Scalar;
+  for (const internal::MergePlan::Run& run : plan.runs) {
+    const Scalar* const begin = plan.scalars.data() + run.begin;
+    const Scalar* const end = plan.scalars.data() + run.end;
+    if (run.has_mask != 0) {
+      const uint32_t has = has_word(from_base, run.has_offset) & run.has_mask;
+      if (has == 0) continue;
+      // Fields that are not set hold their default value, which is all that
+      // a clear `to` holds too.
+      if (to_is_clear || has == run.has_mask) {
+        memcpy(to_base + run.offset, from_base + run.offset, run.size);
+      } else {
+        for (const Scalar* scalar = begin; scalar != end; ++scalar) {
+          if (has & scalar->has_mask) {
+            memcpy(to_base + scalar->offset, from_base + scalar->offset,
+                   scalar->size);
+          }
+        }
+      }
+      set_has_bits(run.has_offset, has);
+    } else if (to_is_clear) {
+      memcpy(to_base + run.offset, from_base + run.offset, run.size);
+    } else {
+      for (const Scalar* scalar = begin; scalar != end; ++scalar) {
+        // Like HasField(), compares the bits so that -0.0 is set.
+        uint64_t bits = 0;
+        memcpy(&bits, from_base + scalar->offset, scalar->size);
+        if (bits != 0) {
+          memcpy(to_base + scalar->offset, from_base + scalar->offset,
+                 scalar->size);
+        }
+      }
+    }
+  }
+
+  for (const internal::MergePlan::String& string : plan.strings) {
+    const auto& from_string =
+        *reinterpret_cast<const internal::ArenaStringPtr*>(from_base +
+                                                           string.offset);
+    if (string.has_mask != 0) {
+      if ((has_word(from_base, string.has_offset) & string.has_mask) == 0) {
+        continue;
+      }
+      set_has_bits(string.has_offset, string.has_mask);
+    } else if (from_string.Get().empty()) {
+      continue;
+    }
+    // The default string of the field may not be the empty one.
+    const absl::string_view value = from_string.IsDefault()
+                                        ? *string.default_value
+                                        : from_string.Get();
+    reinterpret_cast<internal::ArenaStringPtr*>(to_base + string.offset)
+        ->Set(value, to->GetArena());
+  }
+
+  for (const internal::MergePlan::Repeated& repeated : plan.repeated) {
+    repeated.merge(from_base + repeated.offset, to_base + repeated.offset);
+  }
+
+  for (const FieldDescriptor* field : plan.other_fields) {
+    if (field->is_repeated() ? FieldSize(from, field) > 0
+                             : HasField(from, field)) {
+      other_fields->push_back(field);
+    }
+  }
+  for (const OneofDescriptor* oneof : plan.oneofs) {
+    if (const FieldDescriptor* field = GetOneofFieldDescriptor(from, oneof)) {
+      other_fields->push_back(field);
+    }
+  }
+  if (schema_.HasExtensionSet()) {
+    GetExtensionSet(from).AppendToList(descriptor_, descriptor_pool_,
+                                       other_fields);
+  }
+}
+
 // -------------------------------------------------------------------
 
 #undef DEFINE_PRIMITIVE_ACCESSORS
@@ -3341,7 +4138,9 @@ void Reflection::PopulateTcParseFieldAux(
   }
 }
 
-const internal::TcParseTableBase* Reflection::CreateTcParseTable() const {
+const internal::TcParseTableBase* Reflection::CreateTcParseTable(
+    const std::vector<int>* projected_field_numbers,
+    bool keep_skipped_fields) const {
   using TcParseTableBase = internal::TcParseTableBase;
 
   if (descriptor_->options().message_set_wire_format()) {
@@ -3361,7 +4160,11 @@ const internal::TcParseTableBase* Reflection::CreateTcParseTable() const {
   std::vector<int> inlined_string_indices = has_bit_indices;
   for (int i = 0; i < descriptor_->field_count(); ++i) {
     auto* field = descriptor_->field(i);
-    fields.push_back(field);
+    if (projected_field_numbers == nullptr ||
+        std::binary_search(projected_field_numbers->begin(),
+                           projected_field_numbers->end(), field->number())) {
+      fields.push_back(field);
+    }
     has_bit_indices[static_cast<size_t>(field->index())] =
         static_cast<int>(schema_.HasBitIndex(field));
 
@@ -3448,7 +4251,9 @@ const internal::TcParseTableBase* Reflection::CreateTcParseTable() const {
       static_cast<uint16_t>(table_info.aux_entries.size()),
       aux_offset,
       schema_.default_instance_,
-      &internal::TcParser::ReflectionFallback};
+      projected_field_numbers == nullptr ? &internal::TcParser::ReflectionFallback
+      : keep_skipped_fields ? &internal::TcParser::DeferredFieldFallback
+                            : &internal::TcParser::ProjectionFallback};
 
   // Now copy the rest of the payloads
   PopulateTcParseFastEntries(table_info, res->fast_entry(0));
@@ -3588,15 +4393,20 @@ struct MetadataOwner {
 
 void AddDescriptors(const DescriptorTable* table);
 
+// Serializes the calls to AddDescriptors() after startup.
+ABSL_CONST_INIT absl::Mutex add_descriptors_mutex(absl::kConstInit);
+
+// The files linked by LazyAddDescriptorsRunner and not yet added.
+ABSL_CONST_INIT std::atomic<LazyAddDescriptorsRunner*> lazy_descriptors{
+    nullptr};
+
 void AssignDescriptorsImpl(const DescriptorTable* table, bool eager) {
   // Ensure the file descriptor is added to the pool.
   {
     // This only happens once per proto file. So a global mutex to serialize
     // calls to AddDescriptors.
-    static absl::Mutex mu{absl::kConstInit};
-    mu.Lock();
+    absl::MutexLock lock(&add_descriptors_mutex);
     AddDescriptors(table);
-    mu.Unlock();
   }
   if (eager) {
     // Normally we do not want to eagerly build descriptors of our deps.
@@ -3719,6 +4529,39 @@ AddDescriptorsRunner::AddDescriptorsRunner(const DescriptorTable* table) {
   AddDescriptors(table);
 }
 
+LazyAddDescriptorsRunner::LazyAddDescriptorsRunner(
+    const DescriptorTable* table)
+    : table(table), next(lazy_descriptors.load(std::memory_order_relaxed)) {
+  while (!lazy_descriptors.compare_exchange_weak(
+      next, this, std::memory_order_release, std::memory_order_relaxed)) {
+  }
+}
+
+bool HasLazyDescriptors() {
+  return lazy_descriptors.load(std::memory_order_acquire) != nullptr;
+}
+
+void AddLazyDescriptors() {
+  absl::MutexLock lock(&add_descriptors_mutex);
+  // The list is only emptied once its files are added, so that other threads
+  // keep calling this, and wait for the lock, until they are.  Files linked
+  // meanwhile are added by walking the list again; AddDescriptors() skips the
+  // files it already added.
+  LazyAddDescriptorsRunner* head =
+      lazy_descriptors.load(std::memory_order_acquire);
+  while (head != nullptr) {
+    for (LazyAddDescriptorsRunner* runner = head; runner != nullptr;
+         runner = runner->next) {
+      AddDescriptors(runner->table);
+    }
+    if (lazy_descriptors.compare_exchange_strong(head, nullptr,
+                                                 std::memory_order_acq_rel,
+                                                 std::memory_order_acquire)) {
+      break;
+    }
+  }
+}
+
 void RegisterFileLevelMetadata(const DescriptorTable* table) {
   AssignDescriptors(table);
   RegisterAllTypesInternal(table->file_level_metadata, table->num_messages);
@@ -337,6 +337,25 @@ struct PROTOBUF_EXPORT AddDescriptorsRunner {
   explicit AddDescriptorsRunner(const DescriptorTable* table);
 };
 
+// Used instead of AddDescriptorsRunner by files generated with the
+// lazy_descriptor_registration option.  Only links the file into a list, which
+// takes no lock and allocates nothing; the files in the list are added to the
+// generated pool by the first call to DescriptorPool::generated_pool() after
+// they were linked, or when their reflection is first used.
+struct PROTOBUF_EXPORT LazyAddDescriptorsRunner {
+  explicit LazyAddDescriptorsRunner(const DescriptorTable* table);
+
+  const DescriptorTable* table;
+  LazyAddDescriptorsRunner* next;
+};
+
+// Returns whether files linked by LazyAddDescriptorsRunner are not yet added,
+// including while another thread is adding them in AddLazyDescriptors().
+PROTOBUF_EXPORT bool HasLazyDescriptors();
+// Adds the files linked by LazyAddDescriptorsRunner to the generated pool.
+// Must not be called with the generated pool locked.
+PROTOBUF_EXPORT void AddLazyDescriptors();
+
 struct DenseEnumCacheInfo {
   std::atomic<const std::string**> cache;
   int min_val;
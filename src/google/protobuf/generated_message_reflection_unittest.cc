@@ -22,6 +22,7 @@
 #include "google/protobuf/generated_message_reflection.h"
 
 #include <memory>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include "google/protobuf/testing/googletest.h"
@@ -37,6 +38,7 @@
 #include "google/protobuf/unittest.pb.h"
 #include "google/protobuf/unittest_mset.pb.h"
 #include "google/protobuf/unittest_mset_wire_format.pb.h"
+#include "google/protobuf/unittest_proto3.pb.h"
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
@@ -119,6 +121,220 @@ TEST(GeneratedMessageReflectionTest, Accessors) {
   TestUtil::ExpectRepeatedFieldsModified(message);
 }
 
+TEST(GeneratedMessageReflectionTest, FieldAccessor) {
+  const Reflection* reflection = unittest::TestAllTypes::GetReflection();
+  auto int64_field = reflection->GetFieldAccessor<int64_t>(F("optional_int64"));
+  auto double_field =
+      reflection->GetFieldAccessor<double>(F("optional_double"));
+  auto bool_field = reflection->GetFieldAccessor<bool>(F("optional_bool"));
+  auto string_field =
+      reflection->GetFieldAccessor<std::string>(F("optional_string"));
+  auto default_string_field =
+      reflection->GetFieldAccessor<std::string>(F("default_string"));
+  auto enum_field =
+      reflection->GetFieldAccessor<int32_t>(F("optional_nested_enum"));
+  EXPECT_EQ(int64_field.field(), F("optional_int64"));
+
+  unittest::TestAllTypes message;
+  EXPECT_FALSE(int64_field.Has(message));
+  EXPECT_EQ(int64_field.Get(message), 0);
+  EXPECT_EQ(default_string_field.Get(message), "hello");
+  EXPECT_EQ(enum_field.Get(message), unittest::TestAllTypes::FOO);
+
+  int64_field.Set(&message, -5);
+  double_field.Set(&message, 1.5);
+  bool_field.Set(&message, true);
+  string_field.Set(&message, "foo");
+  default_string_field.Set(&message, "bar");
+  enum_field.Set(&message, unittest::TestAllTypes::BAZ);
+  EXPECT_TRUE(message.has_optional_int64());
+  EXPECT_EQ(message.optional_int64(), -5);
+  EXPECT_EQ(message.optional_double(), 1.5);
+  EXPECT_TRUE(message.optional_bool());
+  EXPECT_EQ(message.optional_string(), "foo");
+  EXPECT_EQ(message.default_string(), "bar");
+  EXPECT_EQ(message.optional_nested_enum(), unittest::TestAllTypes::BAZ);
+
+  message.set_optional_int64(7);
+  message.set_optional_string("baz");
+  EXPECT_TRUE(int64_field.Has(message));
+  EXPECT_EQ(int64_field.Get(message), 7);
+  EXPECT_EQ(&string_field.Get(message), &message.optional_string());
+
+  // Values unknown to a closed enum go to the unknown fields, as with
+  // SetEnumValue().
+  enum_field.Set(&message, 12345);
+  EXPECT_EQ(message.optional_nested_enum(), unittest::TestAllTypes::BAZ);
+  EXPECT_EQ(message.GetReflection()->GetUnknownFields(message).field_count(),
+            1);
+
+  message.clear_optional_int64();
+  EXPECT_FALSE(int64_field.Has(message));
+}
+
+TEST(GeneratedMessageReflectionTest, FieldAccessorOneof) {
+  const Reflection* reflection = unittest::TestAllTypes::GetReflection();
+  auto uint32_field = reflection->GetFieldAccessor<uint32_t>(F("oneof_uint32"));
+  auto string_field =
+      reflection->GetFieldAccessor<std::string>(F("oneof_string"));
+
+  Arena arena;
+  auto* message = Arena::CreateMessage<unittest::TestAllTypes>(&arena);
+  message->mutable_oneof_nested_message()->set_bb(1);
+  EXPECT_FALSE(uint32_field.Has(*message));
+  EXPECT_EQ(uint32_field.Get(*message), 0);
+  EXPECT_EQ(string_field.Get(*message), "");
+
+  string_field.Set(message, "foo");
+  EXPECT_EQ(message->oneof_string(), "foo");
+  string_field.Set(message, "bar");
+  EXPECT_EQ(string_field.Get(*message), "bar");
+  EXPECT_TRUE(string_field.Has(*message));
+
+  uint32_field.Set(message, 5);
+  EXPECT_TRUE(message->has_oneof_uint32());
+  EXPECT_EQ(uint32_field.Get(*message), 5);
+  EXPECT_FALSE(string_field.Has(*message));
+}
+
+TEST(GeneratedMessageReflectionTest, FieldAccessorImplicitPresence) {
+  const Descriptor* descriptor = proto3_unittest::TestAllTypes::descriptor();
+  const Reflection* reflection = proto3_unittest::TestAllTypes::GetReflection();
+  auto float_field = reflection->GetFieldAccessor<float>(
+      descriptor->FindFieldByName("optional_float"));
+  auto string_field = reflection->GetFieldAccessor<std::string>(
+      descriptor->FindFieldByName("optional_string"));
+  auto enum_field = reflection->GetFieldAccessor<int32_t>(
+      descriptor->FindFieldByName("optional_nested_enum"));
+
+  proto3_unittest::TestAllTypes message;
+  EXPECT_FALSE(float_field.Has(message));
+  EXPECT_FALSE(string_field.Has(message));
+  float_field.Set(&message, -0.0f);
+  string_field.Set(&message, "foo");
+  // Open enums keep unknown values.
+  enum_field.Set(&message, 12345);
+  EXPECT_TRUE(float_field.Has(message));
+  EXPECT_TRUE(string_field.Has(message));
+  EXPECT_EQ(message.optional_string(), "foo");
+  EXPECT_EQ(message.optional_nested_enum(), 12345);
+  EXPECT_EQ(enum_field.Get(message), 12345);
+}
+
+TEST(GeneratedMessageReflectionTest, FieldAccessorExtension) {
+  const DescriptorPool* pool = DescriptorPool::generated_pool();
+  const Reflection* reflection = unittest::TestAllExtensions::GetReflection();
+  auto int32_field = reflection->GetFieldAccessor<int32_t>(
+      pool->FindExtensionByName("protobuf_unittest.optional_int32_extension"));
+  auto string_field = reflection->GetFieldAccessor<std::string>(
+      pool->FindExtensionByName("protobuf_unittest.optional_string_extension"));
+
+  unittest::TestAllExtensions message;
+  EXPECT_FALSE(int32_field.Has(message));
+  int32_field.Set(&message, 3);
+  string_field.Set(&message, "foo");
+  EXPECT_EQ(message.GetExtension(unittest::optional_int32_extension), 3);
+  EXPECT_EQ(int32_field.Get(message), 3);
+  EXPECT_EQ(string_field.Get(message), "foo");
+  EXPECT_TRUE(int32_field.Has(message));
+}
+
+TEST(GeneratedMessageReflectionTest, GetColumns) {
+  std::vector<unittest::TestAllTypes> messages(3);
+  messages[0].set_optional_int32(1);
+  messages[0].set_optional_string("foo");
+  messages[0].set_oneof_uint32(7);
+  messages[1].set_optional_double(2.5);
+  messages[1].set_default_string("bar");
+  messages[1].set_oneof_string("baz");
+  messages[2].set_optional_bool(true);
+  messages[2].set_optional_nested_enum(unittest::TestAllTypes::BAZ);
+  messages[2].set_default_int32(0);
+  std::vector<const Message*> pointers;
+  for (const auto& message : messages) pointers.push_back(&message);
+
+  int32_t int32_values[3];
+  bool int32_has[3];
+  double double_values[3];
+  bool bool_values[3];
+  absl::string_view string_values[3];
+  absl::string_view default_string_values[3];
+  int32_t enum_values[3];
+  int32_t default_int32_values[3];
+  bool default_int32_has[3];
+  uint32_t oneof_uint32_values[3];
+  bool oneof_uint32_has[3];
+  absl::string_view oneof_string_values[3];
+  const Reflection::FieldColumn columns[] = {
+      {F("optional_string"), string_values},
+      {F("optional_int32"), int32_values, int32_has},
+      {F("oneof_string"), oneof_string_values},
+      {F("optional_double"), double_values},
+      {F("default_string"), default_string_values},
+      {F("optional_bool"), bool_values},
+      {F("optional_nested_enum"), enum_values},
+      {F("default_int32"), default_int32_values, default_int32_has},
+      {F("oneof_uint32"), oneof_uint32_values, oneof_uint32_has},
+  };
+  unittest::TestAllTypes::GetReflection()->GetColumns(pointers, columns);
+
+  EXPECT_THAT(int32_values, ElementsAre(1, 0, 0));
+  EXPECT_THAT(int32_has, ElementsAre(true, false, false));
+  EXPECT_THAT(double_values, ElementsAre(0, 2.5, 0));
+  EXPECT_THAT(bool_values, ElementsAre(false, false, true));
+  EXPECT_THAT(string_values, ElementsAre("foo", "", ""));
+  EXPECT_THAT(default_string_values, ElementsAre("hello", "bar", "hello"));
+  EXPECT_THAT(enum_values, ElementsAre(unittest::TestAllTypes::FOO,
+                                       unittest::TestAllTypes::FOO,
+                                       unittest::TestAllTypes::BAZ));
+  EXPECT_THAT(default_int32_values, ElementsAre(41, 41, 0));
+  EXPECT_THAT(default_int32_has, ElementsAre(false, false, true));
+  EXPECT_THAT(oneof_uint32_values, ElementsAre(7, 0, 0));
+  EXPECT_THAT(oneof_uint32_has, ElementsAre(true, false, false));
+  EXPECT_THAT(oneof_string_values, ElementsAre("", "baz", ""));
+  // Strings are read in place.
+  EXPECT_EQ(string_values[0].data(), messages[0].optional_string().data());
+}
+
+TEST(GeneratedMessageReflectionTest, GetColumnsImplicitPresenceAndExtensions) {
+  proto3_unittest::TestAllTypes proto3;
+  proto3.set_optional_float(-0.0f);
+  proto3.set_optional_string("foo");
+  const Message* proto3_messages[] = {&proto3,
+                                      &proto3_unittest::TestAllTypes::
+                                          default_instance()};
+  const Descriptor* descriptor = proto3_unittest::TestAllTypes::descriptor();
+  float float_values[2];
+  bool float_has[2];
+  absl::string_view string_values[2];
+  bool string_has[2];
+  const Reflection::FieldColumn proto3_columns[] = {
+      {descriptor->FindFieldByName("optional_float"), float_values, float_has},
+      {descriptor->FindFieldByName("optional_string"), string_values,
+       string_has},
+  };
+  proto3_unittest::TestAllTypes::GetReflection()->GetColumns(proto3_messages,
+                                                             proto3_columns);
+  EXPECT_THAT(float_has, ElementsAre(true, false));
+  EXPECT_THAT(string_values, ElementsAre("foo", ""));
+  EXPECT_THAT(string_has, ElementsAre(true, false));
+
+  unittest::TestAllExtensions extensions;
+  extensions.SetExtension(unittest::optional_int32_extension, 3);
+  const Message* extension_messages[] = {&extensions};
+  int32_t int32_value;
+  bool int32_has;
+  const Reflection::FieldColumn extension_columns[] = {
+      {DescriptorPool::generated_pool()->FindExtensionByName(
+           "protobuf_unittest.optional_int32_extension"),
+       &int32_value, &int32_has},
+  };
+  unittest::TestAllExtensions::GetReflection()->GetColumns(extension_messages,
+                                                           extension_columns);
+  EXPECT_EQ(int32_value, 3);
+  EXPECT_TRUE(int32_has);
+}
+
 TEST(GeneratedMessageReflectionTest, GetStringReference) {
   // Test that GetStringReference() returns the underlying string when it
   // is a normal string field.
@@ -1274,6 +1490,33 @@ TEST(GeneratedMessageReflectionTest, ArenaReleaseOneofMessageTest) {
 
 #if GTEST_HAS_DEATH_TEST
 
+TEST(GeneratedMessageReflectionTest, FieldAccessorUsageErrors) {
+  const Reflection* reflection = unittest::TestAllTypes::GetReflection();
+  EXPECT_DEATH(reflection->GetFieldAccessor<int64_t>(F("optional_int32")),
+               "GetFieldAccessor");
+  EXPECT_DEATH(reflection->GetFieldAccessor<int32_t>(F("repeated_int32")),
+               "GetFieldAccessor");
+  EXPECT_DEATH(reflection->GetFieldAccessor<int32_t>(
+                   unittest::ForeignMessage::descriptor()->field(0)),
+               "GetFieldAccessor");
+  EXPECT_DEATH(
+      unittest::TestCord::GetReflection()->GetFieldAccessor<std::string>(
+          unittest::TestCord::descriptor()->FindFieldByName(
+              "optional_bytes_cord")),
+      "cord");
+}
+
+TEST(GeneratedMessageReflectionTest, GetColumnsUsageErrors) {
+  const Reflection* reflection = unittest::TestAllTypes::GetReflection();
+  const Message* messages[] = {&unittest::TestAllTypes::default_instance()};
+  int32_t values[1];
+  const Reflection::FieldColumn repeated[] = {{F("repeated_int32"), values}};
+  EXPECT_DEATH(reflection->GetColumns(messages, repeated), "GetColumns");
+  const Reflection::FieldColumn message[] = {
+      {F("optional_nested_message"), values}};
+  EXPECT_DEATH(reflection->GetColumns(messages, message), "GetColumns");
+}
+
 TEST(GeneratedMessageReflectionTest, UsageErrors) {
   unittest::TestAllTypes message;
   unittest::ForeignMessage foreign;
@@ -28,13 +28,22 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <string>
 
+#include "absl/numeric/bits.h"
+#include "absl/strings/cord.h"
+#include "google/protobuf/arenastring.h"
+#include "google/protobuf/descriptor.h"
 #include "google/protobuf/extension_set.h"
 #include "google/protobuf/generated_message_tctable_impl.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/parse_context.h"
 #include "google/protobuf/port.h"
+#include "google/protobuf/repeated_field.h"
+#include "google/protobuf/repeated_ptr_field.h"
 #include "google/protobuf/unknown_field_set.h"
 #include "google/protobuf/wire_format.h"
 
@@ -83,6 +92,45 @@ const char* TcParser::ReflectionFallback(PROTOBUF_TC_PARAM_DECL) {
                                                  reflection, field);
 }
 
+const char* TcParser::ProjectionFallback(PROTOBUF_TC_PARAM_DECL) {
+  if (PROTOBUF_PREDICT_FALSE(ptr == nullptr)) {
+    PROTOBUF_MUSTTAIL return GenericFallback(PROTOBUF_TC_PARAM_PASS);
+  }
+
+  uint32_t tag = data.tag();
+  // Fields that are part of the projection but that the table cannot handle
+  // go through reflection, just like in a regular reflection table.
+  if (tag == 0 || (tag & 7) == WireFormatLite::WIRETYPE_END_GROUP ||
+      FindFieldEntry(table, tag >> 3) != nullptr) {
+    PROTOBUF_MUSTTAIL return ReflectionFallback(PROTOBUF_TC_PARAM_PASS);
+  }
+
+  // Everything else, including extensions, is skipped without being stored.
+  SyncHasbits(msg, hasbits, table);
+  return UnknownFieldParse(tag, static_cast<std::string*>(nullptr), ptr, ctx);
+}
+
+const char* TcParser::DeferredFieldFallback(PROTOBUF_TC_PARAM_DECL) {
+  if (PROTOBUF_PREDICT_FALSE(ptr == nullptr)) {
+    PROTOBUF_MUSTTAIL return GenericFallback(PROTOBUF_TC_PARAM_PASS);
+  }
+
+  uint32_t tag = data.tag();
+  if (tag == 0 || (tag & 7) == WireFormatLite::WIRETYPE_END_GROUP ||
+      FindFieldEntry(table, tag >> 3) != nullptr ||
+      DownCast<Message*>(msg)->GetDescriptor()->FindFieldByNumber(
+          WireFormatLite::GetTagFieldNumber(tag)) == nullptr) {
+    PROTOBUF_MUSTTAIL return ReflectionFallback(PROTOBUF_TC_PARAM_PASS);
+  }
+
+  // A known field left out of the table: keep its bytes undecoded in the
+  // unknown field set.
+  SyncHasbits(msg, hasbits, table);
+  return UnknownFieldParse(
+      tag, msg->_internal_metadata_.mutable_unknown_fields<UnknownFieldSet>(),
+      ptr, ctx);
+}
+
 const char* TcParser::ReflectionParseLoop(PROTOBUF_TC_PARAM_DECL) {
   (void)data;
   (void)table;
@@ -91,6 +139,489 @@ const char* TcParser::ReflectionParseLoop(PROTOBUF_TC_PARAM_DECL) {
   return WireFormat::_InternalParse(DownCast<Message*>(msg), ptr, ctx);
 }
 
+namespace {
+
+using FieldEntry = TcParseTableBase::FieldEntry;
+
+// Calls `f(field_num, entry)` for each field entry of `table`, in order of
+// field number.
+template <typename F>
+void ForEachFieldEntry(const TcParseTableBase* table, F f) {
+  const FieldEntry* const field_entries = table->field_entries_begin();
+  // Field numbers 1 to 32 are only described by skipmap32.
+  const FieldEntry* entry = field_entries;
+  for (uint32_t present = ~table->skipmap32; present != 0;
+       present &= present - 1) {
+    f(static_cast<uint32_t>(absl::countr_zero(present)) + 1, *entry++);
+  }
+  // The other ones are in blocks of skip entries. See FindFieldEntry().
+  const uint16_t* lookup_table = table->field_lookup_begin();
+  for (;;) {
+    const uint32_t fstart =
+        lookup_table[0] | (static_cast<uint32_t>(lookup_table[1]) << 16);
+    if (fstart == 0xFFFFFFFF) break;
+    const uint32_t num_skip_entries = lookup_table[2];
+    lookup_table += 3;
+    for (uint32_t i = 0; i < num_skip_entries; ++i, lookup_table += 2) {
+      entry = field_entries + lookup_table[1];
+      for (uint32_t present = static_cast<uint16_t>(~lookup_table[0]);
+           present != 0; present &= present - 1) {
+        f(fstart + 16 * i + static_cast<uint32_t>(absl::countr_zero(present)),
+          *entry++);
+      }
+    }
+  }
+}
+
+// Whether the serializer handles the field itself, or leaves it to
+// WireFormat.
+bool IsTableSerializable(uint16_t type_card) {
+  namespace fl = field_layout;
+  if ((type_card & fl::kSplitMask) != fl::kSplitFalse) return false;
+  const uint16_t card = type_card & fl::kFcMask;
+  const uint16_t rep = type_card & fl::kRepMask;
+  switch (type_card & fl::kFkMask) {
+    case fl::kFkVarint:
+    case fl::kFkPackedVarint:
+    case fl::kFkFixed:
+    case fl::kFkPackedFixed:
+      return true;
+    case fl::kFkString:
+      if (card == fl::kFcRepeated) return rep == fl::kRepSString;
+      return rep == fl::kRepAString ||
+             (rep == fl::kRepCord && card != fl::kFcOneof);
+    case fl::kFkMessage:
+      return (rep == fl::kRepMessage || rep == fl::kRepGroup) &&
+             (type_card & fl::kTvMask) != fl::kTvWeakPtr;
+    default:
+      // Entries of unsupported fields (kFkNone) and maps.
+      return false;
+  }
+}
+
+size_t TagSize(uint32_t field_num) {
+  return io::CodedOutputStream::VarintSize32(field_num << 3);
+}
+
+// Varint values, stored at `p` as `type_card` describes.
+uint8_t* WriteVarintValue(uint16_t type_card, const void* p, uint8_t* target) {
+  namespace fl = field_layout;
+  const bool zigzag = (type_card & fl::kTvMask) == fl::kTvZigZag;
+  switch (type_card & fl::kRepMask) {
+    case fl::kRep8Bits:
+      return WireFormatLite::WriteBoolNoTagToArray(
+          *static_cast<const bool*>(p), target);
+    case fl::kRep32Bits: {
+      uint32_t value;
+      memcpy(&value, p, sizeof(value));
+      if (zigzag) {
+        return WireFormatLite::WriteSInt32NoTagToArray(
+            static_cast<int32_t>(value), target);
+      }
+      // Negative int32 and enum values are sign extended.
+      if ((type_card & fl::kFmtMask) == fl::kFmtUnsigned) {
+        return WireFormatLite::WriteUInt32NoTagToArray(value, target);
+      }
+      return WireFormatLite::WriteInt32NoTagToArray(static_cast<int32_t>(value),
+                                                    target);
+    }
+    default: {
+      uint64_t value;
+      memcpy(&value, p, sizeof(value));
+      if (zigzag) {
+        return WireFormatLite::WriteSInt64NoTagToArray(
+            static_cast<int64_t>(value), target);
+      }
+      return WireFormatLite::WriteUInt64NoTagToArray(value, target);
+    }
+  }
+}
+
+size_t VarintValueSize(uint16_t type_card, const void* p) {
+  namespace fl = field_layout;
+  const bool zigzag = (type_card & fl::kTvMask) == fl::kTvZigZag;
+  switch (type_card & fl::kRepMask) {
+    case fl::kRep8Bits:
+      return 1;
+    case fl::kRep32Bits: {
+      uint32_t value;
+      memcpy(&value, p, sizeof(value));
+      if (zigzag) return WireFormatLite::SInt32Size(static_cast<int32_t>(value));
+      if ((type_card & fl::kFmtMask) == fl::kFmtUnsigned) {
+        return WireFormatLite::UInt32Size(value);
+      }
+      return WireFormatLite::Int32Size(static_cast<int32_t>(value));
+    }
+    default: {
+      uint64_t value;
+      memcpy(&value, p, sizeof(value));
+      if (zigzag) return WireFormatLite::SInt64Size(static_cast<int64_t>(value));
+      return WireFormatLite::UInt64Size(value);
+    }
+  }
+}
+
+size_t ValueSize(uint16_t type_card) {
+  namespace fl = field_layout;
+  switch (type_card & fl::kRepMask) {
+    case fl::kRep8Bits:
+      return 1;
+    case fl::kRep32Bits:
+      return 4;
+    default:
+      return 8;
+  }
+}
+
+// The elements of a repeated numeric field, whatever their type.
+struct RepeatedNumbers {
+  const char* data;
+  int size;
+  size_t value_size;
+};
+
+template <typename T>
+RepeatedNumbers MakeRepeatedNumbers(const void* field) {
+  const auto& r = *static_cast<const RepeatedField<T>*>(field);
+  return {reinterpret_cast<const char*>(r.data()), r.size(), sizeof(T)};
+}
+
+RepeatedNumbers GetRepeatedNumbers(uint16_t type_card, const void* field) {
+  switch (ValueSize(type_card)) {
+    case 1:
+      return MakeRepeatedNumbers<bool>(field);
+    case 4:
+      return MakeRepeatedNumbers<uint32_t>(field);
+    default:
+      return MakeRepeatedNumbers<uint64_t>(field);
+  }
+}
+
+size_t PackedVarintDataSize(uint16_t type_card, const RepeatedNumbers& r) {
+  if (ValueSize(type_card) == 1) return static_cast<size_t>(r.size);
+  size_t size = 0;
+  for (int i = 0; i < r.size; ++i) {
+    size += VarintValueSize(type_card, r.data + i * r.value_size);
+  }
+  return size;
+}
+
+// Whether a field without explicit presence has a non-default value. Floating
+// point values are compared by their bits, so -0.0 is present.
+bool HasImplicitPresence(const Message& msg, const TcParseTableBase* table,
+                         const FieldEntry& entry) {
+  namespace fl = field_layout;
+  const uint16_t rep = entry.type_card & fl::kRepMask;
+  switch (entry.type_card & fl::kFkMask) {
+    case fl::kFkString:
+      if (rep == fl::kRepCord) {
+        return !TcParser::RefAt<absl::Cord>(&msg, entry.offset).empty();
+      }
+      return !TcParser::RefAt<ArenaStringPtr>(&msg, entry.offset)
+                  .Get()
+                  .empty();
+    case fl::kFkMessage:
+      return &msg != table->default_instance &&
+             TcParser::RefAt<const MessageLite*>(&msg, entry.offset) !=
+                 nullptr;
+    default:
+      switch (ValueSize(entry.type_card)) {
+        case 1:
+          return TcParser::RefAt<uint8_t>(&msg, entry.offset) != 0;
+        case 4:
+          return TcParser::RefAt<uint32_t>(&msg, entry.offset) != 0;
+        default:
+          return TcParser::RefAt<uint64_t>(&msg, entry.offset) != 0;
+      }
+  }
+}
+
+bool IsPresent(const Message& msg, const TcParseTableBase* table,
+               uint32_t field_num, const FieldEntry& entry) {
+  namespace fl = field_layout;
+  switch (entry.type_card & fl::kFcMask) {
+    case fl::kFcOptional:
+      return (TcParser::RefAt<uint32_t>(&msg, entry.has_idx / 32 * 4) >>
+              (entry.has_idx % 32)) &
+             1;
+    case fl::kFcOneof:
+      return TcParser::RefAt<uint32_t>(&msg, entry.has_idx) == field_num;
+    default:
+      return HasImplicitPresence(msg, table, entry);
+  }
+}
+
+// The field to hand to WireFormat, or nullptr if it is not set.
+// WireFormat::FieldByteSize() expects the fields that ListFields() returns.
+const FieldDescriptor* FindFallbackField(const Message& msg,
+                                         uint32_t field_num) {
+  const FieldDescriptor* field =
+      msg.GetDescriptor()->FindFieldByNumber(static_cast<int>(field_num));
+  const Reflection* reflection = msg.GetReflection();
+  const bool present = field->is_repeated()
+                           ? reflection->FieldSize(msg, field) > 0
+                           : reflection->HasField(msg, field);
+  return present ? field : nullptr;
+}
+
+}  // namespace
+
+uint8_t* TcParser::SerializeTableField(const Message& msg,
+                                       const TcParseTableBase* table,
+                                       uint32_t field_num,
+                                       const FieldEntry& entry,
+                                       uint8_t* target,
+                                       io::EpsCopyOutputStream* stream) {
+  namespace fl = field_layout;
+  const uint16_t type_card = entry.type_card;
+  if (!IsTableSerializable(type_card)) {
+    const FieldDescriptor* field = FindFallbackField(msg, field_num);
+    return field == nullptr
+               ? target
+               : WireFormat::InternalSerializeField(field, msg, target, stream);
+  }
+  const int num = static_cast<int>(field_num);
+  const void* field = &RefAt<char>(&msg, entry.offset);
+  const bool is_repeated = (type_card & fl::kFcMask) == fl::kFcRepeated;
+  if (!is_repeated && !IsPresent(msg, table, field_num, entry)) return target;
+
+  switch (type_card & fl::kFkMask) {
+    case fl::kFkVarint: {
+      if (!is_repeated) {
+        target = stream->EnsureSpace(target);
+        target = WireFormatLite::WriteTagToArray(
+            num, WireFormatLite::WIRETYPE_VARINT, target);
+        return WriteVarintValue(type_card, field, target);
+      }
+      const RepeatedNumbers r = GetRepeatedNumbers(type_card, field);
+      for (int i = 0; i < r.size; ++i) {
+        target = stream->EnsureSpace(target);
+        target = WireFormatLite::WriteTagToArray(
+            num, WireFormatLite::WIRETYPE_VARINT, target);
+        target = WriteVarintValue(type_card, r.data + i * r.value_size, target);
+      }
+      return target;
+    }
+    case fl::kFkFixed: {
+      const bool is_64 = ValueSize(type_card) == 8;
+      const auto wire_type = is_64 ? WireFormatLite::WIRETYPE_FIXED64
+                                   : WireFormatLite::WIRETYPE_FIXED32;
+      const RepeatedNumbers r =
+          is_repeated ? GetRepeatedNumbers(type_card, field)
+                      : RepeatedNumbers{static_cast<const char*>(field), 1,
+                                        ValueSize(type_card)};
+      for (int i = 0; i < r.size; ++i) {
+        target = stream->EnsureSpace(target);
+        target = WireFormatLite::WriteTagToArray(num, wire_type, target);
+        const char* p = r.data + i * r.value_size;
+        if (is_64) {
+          uint64_t value;
+          memcpy(&value, p, sizeof(value));
+          target = WireFormatLite::WriteFixed64NoTagToArray(value, target);
+        } else {
+          uint32_t value;
+          memcpy(&value, p, sizeof(value));
+          target = WireFormatLite::WriteFixed32NoTagToArray(value, target);
+        }
+      }
+      return target;
+    }
+    case fl::kFkPackedVarint: {
+      const RepeatedNumbers r = GetRepeatedNumbers(type_card, field);
+      if (r.size == 0) return target;
+      target = stream->EnsureSpace(target);
+      target = WireFormatLite::WriteTagToArray(
+          num, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, target);
+      target = io::CodedOutputStream::WriteVarint32ToArray(
+          static_cast<uint32_t>(PackedVarintDataSize(type_card, r)), target);
+      for (int i = 0; i < r.size; ++i) {
+        target = stream->EnsureSpace(target);
+        target = WriteVarintValue(type_card, r.data + i * r.value_size, target);
+      }
+      return target;
+    }
+    case fl::kFkPackedFixed:
+      if (ValueSize(type_card) == 8) {
+        const auto& r = *static_cast<const RepeatedField<uint64_t>*>(field);
+        return r.empty() ? target : stream->WriteFixedPacked(num, r, target);
+      } else {
+        const auto& r = *static_cast<const RepeatedField<uint32_t>*>(field);
+        return r.empty() ? target : stream->WriteFixedPacked(num, r, target);
+      }
+    case fl::kFkString: {
+      if ((type_card & fl::kRepMask) == fl::kRepCord) {
+        return stream->WriteString(
+            num, *static_cast<const absl::Cord*>(field), target);
+      }
+      if (!is_repeated) {
+        const std::string& value =
+            static_cast<const ArenaStringPtr*>(field)->Get();
+        VerifyUtf8ForSerialize(value, table, entry);
+        return stream->WriteStringMaybeAliased(num, value, target);
+      }
+      for (const std::string& value :
+           *static_cast<const RepeatedPtrField<std::string>*>(field)) {
+        VerifyUtf8ForSerialize(value, table, entry);
+        target = stream->WriteString(num, value, target);
+      }
+      return target;
+    }
+    case fl::kFkMessage: {
+      const bool is_group = (type_card & fl::kRepMask) == fl::kRepGroup;
+      auto write = [&](const MessageLite& value) {
+        target = stream->EnsureSpace(target);
+        target = is_group ? WireFormatLite::InternalWriteGroup(
+                                num, value, target, stream)
+                          : WireFormatLite::InternalWriteMessage(
+                                num, value, value.GetCachedSize(), target,
+                                stream);
+      };
+      if (!is_repeated) {
+        write(**static_cast<const MessageLite* const*>(field));
+        return target;
+      }
+      const auto& r = *static_cast<const RepeatedPtrFieldBase*>(field);
+      for (int i = 0; i < r.size(); ++i) {
+        write(r.Get<GenericTypeHandler<MessageLite>>(i));
+      }
+      return target;
+    }
+    default:
+      PROTOBUF_ASSUME(false);
+  }
+}
+
+size_t TcParser::TableFieldByteSize(const Message& msg,
+                                    const TcParseTableBase* table,
+                                    uint32_t field_num,
+                                    const FieldEntry& entry) {
+  namespace fl = field_layout;
+  const uint16_t type_card = entry.type_card;
+  if (!IsTableSerializable(type_card)) {
+    const FieldDescriptor* field = FindFallbackField(msg, field_num);
+    return field == nullptr ? 0 : WireFormat::FieldByteSize(field, msg);
+  }
+  const void* field = &RefAt<char>(&msg, entry.offset);
+  const bool is_repeated = (type_card & fl::kFcMask) == fl::kFcRepeated;
+  if (!is_repeated && !IsPresent(msg, table, field_num, entry)) return 0;
+  const size_t tag_size = TagSize(field_num);
+
+  switch (type_card & fl::kFkMask) {
+    case fl::kFkVarint: {
+      if (!is_repeated) return tag_size + VarintValueSize(type_card, field);
+      const RepeatedNumbers r = GetRepeatedNumbers(type_card, field);
+      return tag_size * static_cast<size_t>(r.size) +
+             PackedVarintDataSize(type_card, r);
+    }
+    case fl::kFkFixed: {
+      const size_t count = is_repeated
+                               ? static_cast<size_t>(
+                                     GetRepeatedNumbers(type_card, field).size)
+                               : 1;
+      return count * (tag_size + ValueSize(type_card));
+    }
+    case fl::kFkPackedVarint:
+    case fl::kFkPackedFixed: {
+      const RepeatedNumbers r = GetRepeatedNumbers(type_card, field);
+      if (r.size == 0) return 0;
+      const size_t data_size =
+          (type_card & fl::kFkMask) == fl::kFkPackedVarint
+              ? PackedVarintDataSize(type_card, r)
+              : static_cast<size_t>(r.size) * r.value_size;
+      return tag_size + WireFormatLite::LengthDelimitedSize(data_size);
+    }
+    case fl::kFkString: {
+      if ((type_card & fl::kRepMask) == fl::kRepCord) {
+        return tag_size +
+               WireFormatLite::BytesSize(*static_cast<const absl::Cord*>(field));
+      }
+      if (!is_repeated) {
+        return tag_size + WireFormatLite::BytesSize(
+                              static_cast<const ArenaStringPtr*>(field)->Get());
+      }
+      const auto& r = *static_cast<const RepeatedPtrField<std::string>*>(field);
+      size_t size = tag_size * static_cast<size_t>(r.size());
+      for (const std::string& value : r) {
+        size += WireFormatLite::BytesSize(value);
+      }
+      return size;
+    }
+    case fl::kFkMessage: {
+      const bool is_group = (type_card & fl::kRepMask) == fl::kRepGroup;
+      auto value_size = [&](const MessageLite& value) {
+        return is_group ? 2 * tag_size + value.ByteSizeLong()
+                        : tag_size + WireFormatLite::LengthDelimitedSize(
+                                         value.ByteSizeLong());
+      };
+      if (!is_repeated) {
+        return value_size(**static_cast<const MessageLite* const*>(field));
+      }
+      const auto& r = *static_cast<const RepeatedPtrFieldBase*>(field);
+      size_t size = 0;
+      for (int i = 0; i < r.size(); ++i) {
+        size += value_size(r.Get<GenericTypeHandler<MessageLite>>(i));
+      }
+      return size;
+    }
+    default:
+      PROTOBUF_ASSUME(false);
+  }
+}
+
+uint8_t* TcParser::SerializeWithTable(const Message& msg,
+                                      const TcParseTableBase* table,
+                                      uint8_t* target,
+                                      io::EpsCopyOutputStream* stream) {
+  // Only full reflection tables describe all the fields of the message.
+  if (table->fallback != &ReflectionFallback) {
+    return WireFormat::_InternalSerialize(msg, target, stream);
+  }
+  const ExtensionSet* extensions =
+      table->extension_offset != 0
+          ? &RefAt<ExtensionSet>(&msg, table->extension_offset)
+          : nullptr;
+  int next_extension = 0;
+  ForEachFieldEntry(table, [&](uint32_t field_num, const FieldEntry& entry) {
+    if (extensions != nullptr) {
+      target = extensions->_InternalSerialize(table->default_instance,
+                                              next_extension, field_num,
+                                              target, stream);
+      next_extension = static_cast<int>(field_num) + 1;
+    }
+    target = SerializeTableField(msg, table, field_num, entry, target, stream);
+  });
+  if (extensions != nullptr) {
+    target = extensions->_InternalSerialize(
+        table->default_instance, next_extension,
+        FieldDescriptor::kMaxNumber + 1, target, stream);
+  }
+  if (PROTOBUF_PREDICT_FALSE(msg._internal_metadata_.have_unknown_fields())) {
+    target = WireFormat::InternalSerializeUnknownFieldsToArray(
+        msg._internal_metadata_.unknown_fields<UnknownFieldSet>(
+            UnknownFieldSet::default_instance),
+        target, stream);
+  }
+  return target;
+}
+
+size_t TcParser::ByteSizeWithTable(const Message& msg,
+                                   const TcParseTableBase* table) {
+  if (table->fallback != &ReflectionFallback) return WireFormat::ByteSize(msg);
+  size_t size = 0;
+  ForEachFieldEntry(table, [&](uint32_t field_num, const FieldEntry& entry) {
+    size += TableFieldByteSize(msg, table, field_num, entry);
+  });
+  if (table->extension_offset != 0) {
+    size += RefAt<ExtensionSet>(&msg, table->extension_offset).ByteSize();
+  }
+  if (PROTOBUF_PREDICT_FALSE(msg._internal_metadata_.have_unknown_fields())) {
+    size += WireFormat::ComputeUnknownFieldsSize(
+        msg._internal_metadata_.unknown_fields<UnknownFieldSet>(
+            UnknownFieldSet::default_instance));
+  }
+  return size;
+}
+
 }  // namespace internal
 }  // namespace protobuf
 }  // namespace google
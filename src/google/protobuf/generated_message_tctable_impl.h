@@ -21,6 +21,7 @@
 #include "google/protobuf/message_lite.h"
 #include "google/protobuf/metadata_lite.h"
 #include "google/protobuf/parse_context.h"
+#include "google/protobuf/parse_stats.h"
 #include "google/protobuf/port.h"
 #include "google/protobuf/raw_ptr.h"
 #include "google/protobuf/repeated_field.h"
@@ -33,6 +34,7 @@
 namespace google {
 namespace protobuf {
 
+class ColumnarView;
 class Message;
 class UnknownFieldSet;
 
@@ -360,6 +362,12 @@ inline void AlignFail(std::integral_constant<size_t, 1>,
 enum class TcParseFunction : uint8_t { kNone, PROTOBUF_TC_PARSE_FUNCTION_LIST };
 #undef PROTOBUF_TC_PARSE_FUNCTION_X
 
+#if defined(PROTOBUF_TC_FIELD_STATS)
+// Number of tags this thread may dispatch before the next one is sampled for
+// the field hit statistics.
+extern PROTOBUF_THREAD_LOCAL int32_t tc_field_stats_countdown;
+#endif  // PROTOBUF_TC_FIELD_STATS
+
 // TcParser implements most of the parsing logic for tailcall tables.
 class PROTOBUF_EXPORT TcParser final {
  public:
@@ -388,6 +396,12 @@ class PROTOBUF_EXPORT TcParser final {
   static const char* GenericFallback(PROTOBUF_TC_PARAM_DECL);
   static const char* GenericFallbackLite(PROTOBUF_TC_PARAM_DECL);
   static const char* ReflectionFallback(PROTOBUF_TC_PARAM_DECL);
+  // Fallback of the tables built for a FieldProjection: skips the fields that
+  // are not projected.
+  static const char* ProjectionFallback(PROTOBUF_TC_PARAM_DECL);
+  // Like ProjectionFallback, but keeps the bytes of known fields that are not
+  // projected in the unknown field set.
+  static const char* DeferredFieldFallback(PROTOBUF_TC_PARAM_DECL);
   static const char* ReflectionParseLoop(PROTOBUF_TC_PARAM_DECL);
 
   PROTOBUF_NOINLINE
@@ -395,6 +409,36 @@ class PROTOBUF_EXPORT TcParser final {
                                ParseContext* ctx,
                                const TcParseTableBase* table);
 
+  // Table-driven counterparts of Message::_InternalSerialize() and
+  // WireFormat::ByteSize() for tables built by Reflection::CreateTcParseTable.
+  // Fields are written in field number order, interleaved with extensions, as
+  // generated code does. Fields whose entries the tables can't describe (maps,
+  // lazy and split fields, validated enums, ...) go through WireFormat, and so
+  // do whole messages whose table has no field entries, e.g. message sets.
+  //
+  // As with generated code, SerializeWithTable() expects the cached sizes of
+  // submessages to have been set by a preceding ByteSizeWithTable() call.
+  static uint8_t* SerializeWithTable(const Message& msg,
+                                     const TcParseTableBase* table,
+                                     uint8_t* target,
+                                     io::EpsCopyOutputStream* stream);
+  static size_t ByteSizeWithTable(const Message& msg,
+                                  const TcParseTableBase* table);
+
+  // Field hit statistics, used to lay out fast tables for the hottest fields
+  // (see the `field_hit_stats` option of the C++ code generator). They are
+  // only collected in builds with PROTOBUF_TC_FIELD_STATS defined; otherwise
+  // these functions do nothing and the dump is empty.
+  //
+  // Samples one in every `period` tags dispatched through a fast table, on
+  // each thread. The default period is 64. The calling thread uses the new
+  // period right away; other threads pick it up after their next sample.
+  static void SetFieldStatsSamplingPeriod(int32_t period);
+  // Returns one "<message type name> <field number> <samples>" line per
+  // sampled field, sorted by type name and field number.
+  static std::string DumpFieldStats();
+  static void ResetFieldStats();
+
   // Functions referenced by generated fast tables (numeric types):
   //   F: fixed      V: varint     Z: zigzag
   //   8/32/64: storage type width (bits)
@@ -710,6 +754,8 @@ class PROTOBUF_EXPORT TcParser final {
   }
 
   static const char* TagDispatch(PROTOBUF_TC_PARAM_NO_DATA_DECL);
+  PROTOBUF_NOINLINE static void SampleFieldHit(const TcParseTableBase* table,
+                                               const char* ptr);
   static const char* ToTagDispatch(PROTOBUF_TC_PARAM_NO_DATA_DECL);
   static const char* ToParseLoop(PROTOBUF_TC_PARAM_NO_DATA_DECL);
   PROTOBUF_NOINLINE static const char* Error(PROTOBUF_TC_PARAM_NO_DATA_DECL);
@@ -760,6 +806,9 @@ class PROTOBUF_EXPORT TcParser final {
       ctx->SetLastTag(tag);
       return ptr;
     }
+#if defined(PROTOBUF_TC_PARSE_STATS)
+    if (parse_stats_sample != nullptr) ++parse_stats_sample->unknown_fields;
+#endif  // PROTOBUF_TC_PARSE_STATS
 
     if (table->extension_offset != 0) {
       // We don't need to check the extension ranges. If it is not an extension
@@ -843,6 +892,11 @@ class PROTOBUF_EXPORT TcParser final {
   PROTOBUF_NOINLINE
   static void DestroyMapNode(NodeBase* node, MapAuxInfo map_info,
                              UntypedMapBase& map);
+  // Inserts the `count` parsed nodes of the list `head`, linked through
+  // `next`, into `map`. Later nodes replace earlier ones with the same key.
+  PROTOBUF_NOINLINE
+  static void InsertMapNodes(NodeBase* head, size_t count, MapAuxInfo map_info,
+                             UntypedMapBase& map);
   static const char* ParseOneMapEntry(NodeBase* node, const char* ptr,
                                       ParseContext* ctx,
                                       const TcParseTableBase::FieldAux* aux,
@@ -873,6 +927,23 @@ class PROTOBUF_EXPORT TcParser final {
                            const TcParseTableBase::FieldEntry& entry,
                            uint16_t xform_val);
 
+  // Table-driven serialization of a single field:
+  static uint8_t* SerializeTableField(const Message& msg,
+                                      const TcParseTableBase* table,
+                                      uint32_t field_num,
+                                      const TcParseTableBase::FieldEntry& entry,
+                                      uint8_t* target,
+                                      io::EpsCopyOutputStream* stream);
+  static size_t TableFieldByteSize(const Message& msg,
+                                   const TcParseTableBase* table,
+                                   uint32_t field_num,
+                                   const TcParseTableBase::FieldEntry& entry);
+  static void VerifyUtf8ForSerialize(absl::string_view value,
+                                     const TcParseTableBase* table,
+                                     const TcParseTableBase::FieldEntry& entry);
+
+  // Reuses the field entries of element types to decode columns:
+  friend class ::google::protobuf::ColumnarView;
   // For FindFieldEntry tests:
   friend class FindFieldEntryTest;
   friend struct ParseFunctionGeneratorTestPeer;
@@ -913,6 +984,16 @@ class PROTOBUF_EXPORT TcParser final {
 // Dispatch to the designated parse function
 inline PROTOBUF_ALWAYS_INLINE const char* TcParser::TagDispatch(
     PROTOBUF_TC_PARAM_NO_DATA_DECL) {
+#if defined(PROTOBUF_TC_FIELD_STATS)
+  if (PROTOBUF_PREDICT_FALSE(--tc_field_stats_countdown <= 0)) {
+    SampleFieldHit(table, ptr);
+  }
+#endif  // PROTOBUF_TC_FIELD_STATS
+#if defined(PROTOBUF_TC_PARSE_STATS)
+  if (PROTOBUF_PREDICT_FALSE(parse_stats_sample != nullptr)) {
+    ++parse_stats_sample->fields;
+  }
+#endif  // PROTOBUF_TC_PARSE_STATS
   const auto coded_tag = UnalignedLoad<uint16_t>(ptr);
   const size_t idx = coded_tag & table->fast_idx_mask;
   PROTOBUF_ASSUME((idx & 7) == 0);
@@ -6,6 +6,7 @@
 // https://developers.google.com/open-source/licenses/bsd
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
@@ -13,12 +14,17 @@
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "absl/base/optimization.h"
+#include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/numeric/bits.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/generated_message_tctable_decl.h"
 #include "google/protobuf/generated_message_tctable_impl.h"
 #include "google/protobuf/inlined_string_field.h"
@@ -28,9 +34,9 @@
 #include "google/protobuf/parse_context.h"
 #include "google/protobuf/repeated_field.h"
 #include "google/protobuf/repeated_ptr_field.h"
+#include "google/protobuf/utf8_util.h"
 #include "google/protobuf/varint_shuffle.h"
 #include "google/protobuf/wire_format_lite.h"
-#include "utf8_validity.h"
 
 
 // clang-format off
@@ -80,6 +86,12 @@ PROTOBUF_NOINLINE const char* TcParser::ParseLoop(
   // need during dispatch.  It turns out that "table + 1" points exactly to
   // fast_entries, so we just increment table by 1 here, to get the register
   // holding the value we want.
+#if defined(PROTOBUF_TC_PARSE_STATS)
+  if (PROTOBUF_PREDICT_FALSE(parse_stats_sample != nullptr) &&
+      parse_stats_sample->table == nullptr) {
+    parse_stats_sample->table = table;
+  }
+#endif  // PROTOBUF_TC_PARSE_STATS
   table += 1;
   while (!ctx->Done(&ptr)) {
 #if defined(__GNUC__)
@@ -343,6 +355,83 @@ PROTOBUF_NOINLINE TcParser::TestMiniParseResult TcParser::TestMiniParse(
   return result;
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Field hit statistics
+//////////////////////////////////////////////////////////////////////////////
+
+#if defined(PROTOBUF_TC_FIELD_STATS)
+namespace {
+
+struct FieldStats {
+  std::atomic<int32_t> period{64};
+  absl::Mutex mutex;
+  absl::flat_hash_map<std::pair<const TcParseTableBase*, uint32_t>, uint64_t>
+      samples ABSL_GUARDED_BY(mutex);
+};
+
+FieldStats& GetFieldStats() {
+  static auto* stats = new FieldStats();
+  return *stats;
+}
+
+}  // namespace
+
+PROTOBUF_THREAD_LOCAL int32_t tc_field_stats_countdown = 0;
+
+void TcParser::SampleFieldHit(const TcParseTableBase* table,
+                              const char* ptr) {
+  FieldStats& stats = GetFieldStats();
+  tc_field_stats_countdown = stats.period.load(std::memory_order_relaxed);
+  uint32_t tag;
+  if (ReadTag(ptr, &tag) == nullptr || tag == 0) return;
+  absl::MutexLock lock(&stats.mutex);
+  ++stats.samples[{table, tag >> 3}];
+}
+
+void TcParser::SetFieldStatsSamplingPeriod(int32_t period) {
+  GetFieldStats().period.store(std::max(period, 1), std::memory_order_relaxed);
+  // Sample the next tag on this thread, which then counts down from `period`.
+  tc_field_stats_countdown = 0;
+}
+
+std::string TcParser::DumpFieldStats() {
+  // Several tables may parse the same type, e.g. generated and reflection
+  // tables.
+  absl::btree_map<std::pair<std::string, uint32_t>, uint64_t> by_type;
+  std::vector<std::pair<std::pair<const TcParseTableBase*, uint32_t>, uint64_t>>
+      samples;
+  {
+    FieldStats& stats = GetFieldStats();
+    absl::MutexLock lock(&stats.mutex);
+    samples.assign(stats.samples.begin(), stats.samples.end());
+  }
+  // GetTypeName() may build descriptors, which parses and so samples, so it
+  // must not run under the mutex.
+  for (const auto& entry : samples) {
+    const MessageLite* prototype = entry.first.first->default_instance;
+    if (prototype == nullptr) continue;
+    by_type[{prototype->GetTypeName(), entry.first.second}] += entry.second;
+  }
+  std::string out;
+  for (const auto& entry : by_type) {
+    absl::StrAppend(&out, entry.first.first, " ", entry.first.second, " ",
+                    entry.second, "\n");
+  }
+  return out;
+}
+
+void TcParser::ResetFieldStats() {
+  FieldStats& stats = GetFieldStats();
+  absl::MutexLock lock(&stats.mutex);
+  stats.samples.clear();
+}
+#else   // PROTOBUF_TC_FIELD_STATS
+void TcParser::SampleFieldHit(const TcParseTableBase*, const char*) {}
+void TcParser::SetFieldStatsSamplingPeriod(int32_t) {}
+std::string TcParser::DumpFieldStats() { return ""; }
+void TcParser::ResetFieldStats() {}
+#endif  // PROTOBUF_TC_FIELD_STATS
+
 PROTOBUF_NOINLINE const char* TcParser::MpFallback(PROTOBUF_TC_PARAM_DECL) {
   PROTOBUF_MUSTTAIL return table->fallback(PROTOBUF_TC_PARAM_PASS);
 }
@@ -470,8 +559,7 @@ inline PROTOBUF_ALWAYS_INLINE const char* TcParser::RepeatedParseMessageAuxImpl(
       aux_is_table ? aux.table->default_instance : aux.message_default();
   do {
     ptr += sizeof(TagType);
-    MessageLite* submsg =
-        field.Add<GenericTypeHandler<MessageLite>>(default_instance);
+    MessageLite* submsg = field.AddMessage(default_instance);
     if (aux_is_table) {
       if (group_coding) {
         ptr = ctx->ParseGroup<TcParser>(submsg, ptr,
@@ -537,6 +625,44 @@ PROTOBUF_NOINLINE const char* TcParser::FastGtR2(PROTOBUF_TC_PARAM_DECL) {
       PROTOBUF_TC_PARAM_PASS);
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Runs of unpacked repeated fields
+//////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Called when `field` is full in the middle of a run of elements of an
+// unpacked repeated field, with `ptr` at the tag of the next one. Reserves room
+// for the rest of the run that is in the current buffer, so that the field
+// grows once per run instead of doubling repeatedly while the run is parsed.
+// `skip_value` returns the end of the value that starts at its argument, or
+// nullptr if the value is malformed.
+template <typename Element, typename TagType, typename SkipValue>
+PROTOBUF_NOINLINE void ReserveRepeatedRun(RepeatedField<Element>& field,
+                                          const char* ptr, ParseContext* ctx,
+                                          SkipValue skip_value) {
+  const auto tag = UnalignedLoad<TagType>(ptr);
+  int count = 0;
+  do {
+    ptr = skip_value(ptr + sizeof(TagType));
+    ++count;
+  } while (ptr != nullptr && ctx->DataAvailable(ptr) &&
+           UnalignedLoad<TagType>(ptr) == tag);
+  field.Reserve(field.size() + count);
+}
+
+// Returns the end of the varint at `ptr`, or nullptr if it is longer than ten
+// bytes. The caller is within the slop bytes of the buffer, so all ten bytes
+// can be read.
+inline const char* SkipVarint(const char* ptr) {
+  for (int i = 0; i < 10; ++i) {
+    if (static_cast<uint8_t>(ptr[i]) < 0x80) return ptr + i + 1;
+  }
+  return nullptr;
+}
+
+}  // namespace
+
 //////////////////////////////////////////////////////////////////////////////
 // Fixed fields
 //////////////////////////////////////////////////////////////////////////////
@@ -580,7 +706,11 @@ PROTOBUF_ALWAYS_INLINE const char* TcParser::RepeatedFixed(
   auto& field = RefAt<RepeatedField<LayoutType>>(msg, data.offset());
   const auto tag = UnalignedLoad<TagType>(ptr);
   do {
-    field.Add(UnalignedLoad<LayoutType>(ptr + sizeof(TagType)));
+    if (PROTOBUF_PREDICT_FALSE(field.size() == field.Capacity())) {
+      ReserveRepeatedRun<LayoutType, TagType>(
+          field, ptr, ctx, [](const char* p) { return p + sizeof(LayoutType); });
+    }
+    field.AddAlreadyReserved(UnalignedLoad<LayoutType>(ptr + sizeof(TagType)));
     ptr += sizeof(TagType) + sizeof(LayoutType);
     if (PROTOBUF_PREDICT_FALSE(!ctx->DataAvailable(ptr))) {
       PROTOBUF_MUSTTAIL return ToParseLoop(PROTOBUF_TC_PARAM_NO_DATA_PASS);
@@ -918,13 +1048,16 @@ PROTOBUF_ALWAYS_INLINE const char* TcParser::RepeatedVarint(
   auto& field = RefAt<RepeatedField<FieldType>>(msg, data.offset());
   const auto expected_tag = UnalignedLoad<TagType>(ptr);
   do {
+    if (PROTOBUF_PREDICT_FALSE(field.size() == field.Capacity())) {
+      ReserveRepeatedRun<FieldType, TagType>(field, ptr, ctx, SkipVarint);
+    }
     ptr += sizeof(TagType);
     FieldType tmp;
     ptr = ParseVarint(ptr, &tmp);
     if (PROTOBUF_PREDICT_FALSE(ptr == nullptr)) {
       PROTOBUF_MUSTTAIL return Error(PROTOBUF_TC_PARAM_NO_DATA_PASS);
     }
-    field.Add(ZigZagDecodeHelper<FieldType, zigzag>(tmp));
+    field.AddAlreadyReserved(ZigZagDecodeHelper<FieldType, zigzag>(tmp));
     if (PROTOBUF_PREDICT_FALSE(!ctx->DataAvailable(ptr))) {
       PROTOBUF_MUSTTAIL return ToParseLoop(PROTOBUF_TC_PARAM_NO_DATA_PASS);
     }
@@ -985,19 +1118,22 @@ PROTOBUF_ALWAYS_INLINE const char* TcParser::PackedVarint(
   // pending hasbits now:
   SyncHasbits(msg, hasbits, table);
   auto* field = &RefAt<RepeatedField<FieldType>>(msg, data.offset());
-  return ctx->ReadPackedVarint(ptr, [field](uint64_t varint) {
-    FieldType val;
-    if (zigzag) {
-      if (sizeof(FieldType) == 8) {
-        val = WireFormatLite::ZigZagDecode64(varint);
-      } else {
-        val = WireFormatLite::ZigZagDecode32(varint);
-      }
-    } else {
-      val = varint;
-    }
-    field->Add(val);
-  });
+  return ctx->ReadPackedVarintReserved(
+      ptr,
+      [field](uint64_t varint) {
+        FieldType val;
+        if (zigzag) {
+          if (sizeof(FieldType) == 8) {
+            val = WireFormatLite::ZigZagDecode64(varint);
+          } else {
+            val = WireFormatLite::ZigZagDecode32(varint);
+          }
+        } else {
+          val = varint;
+        }
+        field->Add(val);
+      },
+      [field](int count) { field->Reserve(field->size() + count); });
 }
 
 PROTOBUF_NOINLINE const char* TcParser::FastV8P1(PROTOBUF_TC_PARAM_DECL) {
@@ -1184,13 +1320,18 @@ PROTOBUF_ALWAYS_INLINE const char* TcParser::PackedEnum(
   auto* field = &RefAt<RepeatedField<int32_t>>(msg, data.offset());
   const TcParseTableBase::FieldAux aux = *table->field_aux(data.aux_idx());
   PrefetchEnumData(xform_val, aux);
-  return ctx->ReadPackedVarint(ptr, [=](int32_t value) {
-    if (!EnumIsValidAux(value, xform_val, aux)) {
-      AddUnknownEnum(msg, table, FastDecodeTag(saved_tag), value);
-    } else {
-      field->Add(value);
-    }
-  });
+  // Unknown values are rare, so the varint count is a tight upper bound for
+  // the number of values added.
+  return ctx->ReadPackedVarintReserved(
+      ptr,
+      [=](int32_t value) {
+        if (!EnumIsValidAux(value, xform_val, aux)) {
+          AddUnknownEnum(msg, table, FastDecodeTag(saved_tag), value);
+        } else {
+          field->Add(value);
+        }
+      },
+      [=](int count) { field->Reserve(field->size() + count); });
 }
 
 PROTOBUF_NOINLINE const char* TcParser::FastErR1(PROTOBUF_TC_PARAM_DECL) {
@@ -1395,6 +1536,10 @@ void TcParser::ReportFastUtf8Error(uint32_t decoded_tag,
 
 namespace {
 
+PROTOBUF_ALWAYS_INLINE inline bool IsValidUTF8(absl::string_view str) {
+  return IsValidUtf8(str);
+}
+
 // Here are overloads of ReadStringIntoArena, ReadStringNoArena and IsValidUTF8
 // for every string class for which we provide fast-table parser support.
 
@@ -1416,9 +1561,35 @@ const char* ReadStringNoArena(MessageLite* /*msg*/, const char* ptr,
 }
 
 PROTOBUF_ALWAYS_INLINE inline bool IsValidUTF8(ArenaStringPtr& field) {
-  return utf8_range::IsStructurallyValid(field.Get());
+  return IsValidUTF8(field.Get());
 }
 
+// For inlined strings, `aux_idx` is the index of the field's donated bit.
+PROTOBUF_ALWAYS_INLINE inline const char* ReadStringIntoArena(
+    MessageLite* msg, const char* ptr, ParseContext* ctx, uint32_t aux_idx,
+    const TcParseTableBase* table, InlinedStringField& field, Arena* arena) {
+  int size = ReadSize(&ptr);
+  if (!ptr) return nullptr;
+  uint32_t* donating_states = &TcParser::RefAt<uint32_t>(
+      msg, table->field_aux(kInlinedStringAuxIdx)->offset);
+  return ctx->ReadString(
+      ptr, size,
+      field.MutableForParse(size, arena, donating_states, aux_idx, msg));
+}
+
+PROTOBUF_NOINLINE
+const char* ReadStringNoArena(MessageLite* /*msg*/, const char* ptr,
+                              ParseContext* ctx, uint32_t /*aux_idx*/,
+                              const TcParseTableBase* /*table*/,
+                              InlinedStringField& field) {
+  int size = ReadSize(&ptr);
+  if (!ptr) return nullptr;
+  return ctx->ReadString(ptr, size, field.MutableNoCopy(nullptr));
+}
+
+PROTOBUF_ALWAYS_INLINE inline bool IsValidUTF8(InlinedStringField& field) {
+  return IsValidUTF8(field.Get());
+}
 
 }  // namespace
 
@@ -1491,23 +1662,31 @@ PROTOBUF_NOINLINE const char* TcParser::FastUS2(PROTOBUF_TC_PARAM_DECL) {
 
 // Inlined string variants:
 
-const char* TcParser::FastBiS1(PROTOBUF_TC_PARAM_DECL) {
-  PROTOBUF_MUSTTAIL return MiniParse(PROTOBUF_TC_PARAM_NO_DATA_PASS);
+PROTOBUF_NOINLINE const char* TcParser::FastBiS1(PROTOBUF_TC_PARAM_DECL) {
+  PROTOBUF_MUSTTAIL return SingularString<uint8_t, InlinedStringField, kNoUtf8>(
+      PROTOBUF_TC_PARAM_PASS);
 }
-const char* TcParser::FastBiS2(PROTOBUF_TC_PARAM_DECL) {
-  PROTOBUF_MUSTTAIL return MiniParse(PROTOBUF_TC_PARAM_NO_DATA_PASS);
+PROTOBUF_NOINLINE const char* TcParser::FastBiS2(PROTOBUF_TC_PARAM_DECL) {
+  PROTOBUF_MUSTTAIL return SingularString<uint16_t, InlinedStringField,
+                                          kNoUtf8>(PROTOBUF_TC_PARAM_PASS);
 }
-const char* TcParser::FastSiS1(PROTOBUF_TC_PARAM_DECL) {
-  PROTOBUF_MUSTTAIL return MiniParse(PROTOBUF_TC_PARAM_NO_DATA_PASS);
+PROTOBUF_NOINLINE const char* TcParser::FastSiS1(PROTOBUF_TC_PARAM_DECL) {
+  PROTOBUF_MUSTTAIL return SingularString<uint8_t, InlinedStringField,
+                                          kUtf8ValidateOnly>(
+      PROTOBUF_TC_PARAM_PASS);
 }
-const char* TcParser::FastSiS2(PROTOBUF_TC_PARAM_DECL) {
-  PROTOBUF_MUSTTAIL return MiniParse(PROTOBUF_TC_PARAM_NO_DATA_PASS);
+PROTOBUF_NOINLINE const char* TcParser::FastSiS2(PROTOBUF_TC_PARAM_DECL) {
+  PROTOBUF_MUSTTAIL return SingularString<uint16_t, InlinedStringField,
+                                          kUtf8ValidateOnly>(
+      PROTOBUF_TC_PARAM_PASS);
 }
-const char* TcParser::FastUiS1(PROTOBUF_TC_PARAM_DECL) {
-  PROTOBUF_MUSTTAIL return MiniParse(PROTOBUF_TC_PARAM_NO_DATA_PASS);
+PROTOBUF_NOINLINE const char* TcParser::FastUiS1(PROTOBUF_TC_PARAM_DECL) {
+  PROTOBUF_MUSTTAIL return SingularString<uint8_t, InlinedStringField, kUtf8>(
+      PROTOBUF_TC_PARAM_PASS);
 }
-const char* TcParser::FastUiS2(PROTOBUF_TC_PARAM_DECL) {
-  PROTOBUF_MUSTTAIL return MiniParse(PROTOBUF_TC_PARAM_NO_DATA_PASS);
+PROTOBUF_NOINLINE const char* TcParser::FastUiS2(PROTOBUF_TC_PARAM_DECL) {
+  PROTOBUF_MUSTTAIL return SingularString<uint16_t, InlinedStringField, kUtf8>(
+      PROTOBUF_TC_PARAM_PASS);
 }
 
 // Corded string variants:
@@ -1548,7 +1727,7 @@ PROTOBUF_ALWAYS_INLINE const char* TcParser::RepeatedString(
         return true;
       default:
         if (PROTOBUF_PREDICT_TRUE(
-                utf8_range::IsStructurallyValid(field[field.size() - 1]))) {
+                IsValidUTF8(field[field.size() - 1]))) {
           return true;
         }
         ReportFastUtf8Error(FastDecodeTag(expected_tag), table);
@@ -1630,6 +1809,54 @@ inline void SetHas(const FieldEntry& entry, MessageLite* msg) {
   hasblock |= uint32_t{1} << (has_idx % 32);
 #endif
 }
+
+// Oneof members which own memory are destroyed through a table indexed by the
+// kind and representation of their type card, instead of by switching on
+// both. Members which own nothing have no entry.
+using OneofDestroyFn = void (*)(MessageLite* msg, uint32_t offset);
+
+constexpr uint32_t OneofDestroyIndex(uint16_t type_card) {
+  return (type_card & field_layout::kFkMask) |
+         (type_card & field_layout::kRepMask) >>
+             (field_layout::kRepShift - field_layout::kFkBits);
+}
+
+void DestroyOneofString(MessageLite* msg, uint32_t offset) {
+  TcParser::RefAt<ArenaStringPtr>(msg, offset).Destroy();
+}
+
+void DestroyOneofCord(MessageLite* msg, uint32_t offset) {
+  // Arena-allocated cords are destroyed by the arena.
+  if (msg->GetArena() == nullptr) {
+    delete TcParser::RefAt<absl::Cord*>(msg, offset);
+  }
+}
+
+void DestroyOneofMessage(MessageLite* msg, uint32_t offset) {
+  if (msg->GetArena() == nullptr) {
+    delete TcParser::RefAt<MessageLite*>(msg, offset);
+  }
+}
+
+struct OneofDestroyTable {
+  OneofDestroyFn fns[1 << (field_layout::kFkBits + field_layout::kRepBits)];
+};
+
+constexpr OneofDestroyTable MakeOneofDestroyTable() {
+  OneofDestroyTable table{};
+  table.fns[OneofDestroyIndex(field_layout::kFkString |
+                              field_layout::kRepAString)] = &DestroyOneofString;
+  table.fns[OneofDestroyIndex(field_layout::kFkString |
+                              field_layout::kRepCord)] = &DestroyOneofCord;
+  table.fns[OneofDestroyIndex(field_layout::kFkMessage |
+                              field_layout::kRepMessage)] =
+      &DestroyOneofMessage;
+  table.fns[OneofDestroyIndex(field_layout::kFkMessage |
+                              field_layout::kRepGroup)] = &DestroyOneofMessage;
+  return table;
+}
+
+constexpr OneofDestroyTable kOneofDestroyTable = MakeOneofDestroyTable();
 }  // namespace
 
 // Destroys any existing oneof union member (if necessary). Returns true if the
@@ -1655,38 +1882,9 @@ bool TcParser::ChangeOneof(const TcParseTableBase* table,
   }
   // Look up the value that is already stored, and dispose of it if necessary.
   const FieldEntry* current_entry = FindFieldEntry(table, current_case);
-  uint16_t current_kind = current_entry->type_card & field_layout::kFkMask;
-  uint16_t current_rep = current_entry->type_card & field_layout::kRepMask;
-  if (current_kind == field_layout::kFkString) {
-    switch (current_rep) {
-      case field_layout::kRepAString: {
-        auto& field = RefAt<ArenaStringPtr>(msg, current_entry->offset);
-        field.Destroy();
-        break;
-      }
-      case field_layout::kRepSString:
-      case field_layout::kRepIString:
-      default:
-        ABSL_DLOG(FATAL) << "string rep not handled: "
-                         << (current_rep >> field_layout::kRepShift);
-        return true;
-    }
-  } else if (current_kind == field_layout::kFkMessage) {
-    switch (current_rep) {
-      case field_layout::kRepMessage:
-      case field_layout::kRepGroup: {
-        auto& field = RefAt<MessageLite*>(msg, current_entry->offset);
-        if (!msg->GetArena()) {
-          delete field;
-        }
-        break;
-      }
-      default:
-        ABSL_DLOG(FATAL) << "message rep not handled: "
-                         << (current_rep >> field_layout::kRepShift);
-        break;
-    }
-  }
+  const OneofDestroyFn destroy =
+      kOneofDestroyTable.fns[OneofDestroyIndex(current_entry->type_card)];
+  if (destroy != nullptr) destroy(msg, current_entry->offset);
   return true;
 }
 
@@ -2042,21 +2240,27 @@ const char* TcParser::MpPackedVarintT(PROTOBUF_TC_PARAM_DECL) {
   if (is_validated_enum) {
     const TcParseTableBase::FieldAux aux = *table->field_aux(entry.aux_idx);
     PrefetchEnumData(xform_val, aux);
-    return ctx->ReadPackedVarint(ptr, [=](int32_t value) {
-      if (!EnumIsValidAux(value, xform_val, aux)) {
-        AddUnknownEnum(msg, table, data.tag(), value);
-      } else {
-        field->Add(value);
-      }
-    });
+    return ctx->ReadPackedVarintReserved(
+        ptr,
+        [=](int32_t value) {
+          if (!EnumIsValidAux(value, xform_val, aux)) {
+            AddUnknownEnum(msg, table, data.tag(), value);
+          } else {
+            field->Add(value);
+          }
+        },
+        [=](int count) { field->Reserve(field->size() + count); });
   } else {
-    return ctx->ReadPackedVarint(ptr, [=](uint64_t value) {
-      field->Add(is_zigzag ? (sizeof(FieldType) == 8
-                                  ? WireFormatLite::ZigZagDecode64(value)
-                                  : WireFormatLite::ZigZagDecode32(
-                                        static_cast<uint32_t>(value)))
-                           : value);
-    });
+    return ctx->ReadPackedVarintReserved(
+        ptr,
+        [=](uint64_t value) {
+          field->Add(is_zigzag ? (sizeof(FieldType) == 8
+                                      ? WireFormatLite::ZigZagDecode64(value)
+                                      : WireFormatLite::ZigZagDecode32(
+                                            static_cast<uint32_t>(value)))
+                               : value);
+        },
+        [=](int count) { field->Reserve(field->size() + count); });
   }
 }
 
@@ -2126,7 +2330,7 @@ bool TcParser::MpVerifyUtf8(absl::string_view wire_bytes,
                             const TcParseTableBase* table,
                             const FieldEntry& entry, uint16_t xform_val) {
   if (xform_val == field_layout::kTvUtf8) {
-    if (!utf8_range::IsStructurallyValid(wire_bytes)) {
+    if (!IsValidUTF8(wire_bytes)) {
       PrintUTF8ErrorLog(MessageName(table), FieldName(table, &entry), "parsing",
                         false);
       return false;
@@ -2135,7 +2339,7 @@ bool TcParser::MpVerifyUtf8(absl::string_view wire_bytes,
   }
 #ifndef NDEBUG
   if (xform_val == field_layout::kTvUtf8Debug) {
-    if (!utf8_range::IsStructurallyValid(wire_bytes)) {
+    if (!IsValidUTF8(wire_bytes)) {
       PrintUTF8ErrorLog(MessageName(table), FieldName(table, &entry), "parsing",
                         false);
     }
@@ -2153,6 +2357,21 @@ bool TcParser::MpVerifyUtf8(const absl::Cord& wire_bytes,
   }
 }
 
+void TcParser::VerifyUtf8ForSerialize(absl::string_view value,
+                                      const TcParseTableBase* table,
+                                      const FieldEntry& entry) {
+  // Like generated code, invalid strings are reported but still serialized.
+  const uint16_t xform_val = entry.type_card & field_layout::kTvMask;
+  bool verify = xform_val == field_layout::kTvUtf8;
+#ifndef NDEBUG
+  verify |= xform_val == field_layout::kTvUtf8Debug;
+#endif  // NDEBUG
+  if (verify && !IsValidUTF8(value)) {
+    PrintUTF8ErrorLog(MessageName(table), FieldName(table, &entry),
+                      "serializing", false);
+  }
+}
+
 template <bool is_split>
 PROTOBUF_NOINLINE const char* TcParser::MpString(PROTOBUF_TC_PARAM_DECL) {
   const auto& entry = RefAt<FieldEntry>(table, data.entry_offset());
@@ -2196,6 +2415,23 @@ PROTOBUF_NOINLINE const char* TcParser::MpString(PROTOBUF_TC_PARAM_DECL) {
       break;
     }
 
+    case field_layout::kRepIString: {
+      // Inlined strings have hasbits, so they are never in oneofs.
+      ABSL_DCHECK(!is_oneof);
+      auto& field = RefAt<InlinedStringField>(base, entry.offset);
+      Arena* arena = msg->GetArena();
+      if (arena) {
+        ptr = ReadStringIntoArena(msg, ptr, ctx,
+                                  table->field_aux(&entry)->offset, table,
+                                  field, arena);
+      } else {
+        std::string* str = field.MutableNoCopy(nullptr);
+        ptr = InlineGreedyStringParser(str, ptr, ctx);
+      }
+      if (!ptr) break;
+      is_valid = MpVerifyUtf8(field.Get(), table, entry, xform_val);
+      break;
+    }
 
     case field_layout::kRepCord: {
       absl::Cord* field;
@@ -2426,8 +2662,7 @@ const char* TcParser::MpRepeatedMessageOrGroup(PROTOBUF_TC_PARAM_DECL) {
     const char* ptr2 = ptr;
     uint32_t next_tag;
     do {
-      MessageLite* value =
-          field.template Add<GenericTypeHandler<MessageLite>>(default_instance);
+      MessageLite* value = field.AddMessage(default_instance);
       ptr = is_group ? ctx->ParseGroup<TcParser>(value, ptr2, decoded_tag,
                                                  inner_table)
                      : ctx->ParseMessage<TcParser>(value, ptr2, inner_table);
@@ -2448,8 +2683,7 @@ const char* TcParser::MpRepeatedMessageOrGroup(PROTOBUF_TC_PARAM_DECL) {
     const char* ptr2 = ptr;
     uint32_t next_tag;
     do {
-      MessageLite* value =
-          field.template Add<GenericTypeHandler<MessageLite>>(default_instance);
+      MessageLite* value = field.AddMessage(default_instance);
       ptr = is_group ? ctx->ParseGroup(value, ptr2, decoded_tag)
                      : ctx->ParseMessage(value, ptr2);
       if (PROTOBUF_PREDICT_FALSE(ptr == nullptr)) goto error;
@@ -2589,6 +2823,39 @@ PROTOBUF_NOINLINE void TcParser::DestroyMapNode(NodeBase* node,
   map.DeallocNode(node, map_info.node_size_info);
 }
 
+PROTOBUF_NOINLINE void TcParser::InsertMapNodes(NodeBase* head, size_t count,
+                                                MapAuxInfo map_info,
+                                                UntypedMapBase& map) {
+  NodeBase* replaced;
+  switch (map_info.key_type_card.cpp_type()) {
+    case MapTypeCard::kBool:
+      replaced = static_cast<KeyMapBase<bool>&>(map).InsertOrReplaceNodes(
+          static_cast<KeyMapBase<bool>::KeyNode*>(head), count);
+      break;
+    case MapTypeCard::k32:
+      replaced = static_cast<KeyMapBase<uint32_t>&>(map).InsertOrReplaceNodes(
+          static_cast<KeyMapBase<uint32_t>::KeyNode*>(head), count);
+      break;
+    case MapTypeCard::k64:
+      replaced = static_cast<KeyMapBase<uint64_t>&>(map).InsertOrReplaceNodes(
+          static_cast<KeyMapBase<uint64_t>::KeyNode*>(head), count);
+      break;
+    case MapTypeCard::kString:
+      replaced =
+          static_cast<KeyMapBase<std::string>&>(map).InsertOrReplaceNodes(
+              static_cast<KeyMapBase<std::string>::KeyNode*>(head), count);
+      break;
+    default:
+      PROTOBUF_ASSUME(false);
+  }
+  if (map.arena() != nullptr) return;
+  while (replaced != nullptr) {
+    NodeBase* next = replaced->next;
+    DestroyMapNode(replaced, map_info, map);
+    replaced = next;
+  }
+}
+
 template <typename T>
 const char* ReadFixed(void* obj, const char* ptr) {
   auto v = UnalignedLoad<T>(ptr);
@@ -2683,7 +2950,7 @@ const char* TcParser::ParseOneMapEntry(
           do_utf8_check |= map_info.log_debug_utf8_failure;
 #endif
           if (type_card.is_utf8() && do_utf8_check &&
-              !utf8_range::IsStructurallyValid(*str)) {
+              !IsValidUTF8(*str)) {
             PrintUTF8ErrorLog(MessageName(table), FieldName(table, &entry),
                               "parsing", false);
             if (map_info.fail_on_utf8_failure) {
@@ -2733,6 +3000,13 @@ PROTOBUF_NOINLINE const char* TcParser::MpMap(PROTOBUF_TC_PARAM_DECL) {
 
   const uint32_t saved_tag = data.tag();
 
+  // Parsed nodes are staged in a list linked through `next` and inserted
+  // together once the run of entries ends. The table then grows at most once,
+  // instead of being rehashed every time it doubles.
+  NodeBase* staged = nullptr;
+  NodeBase** staged_tail = &staged;
+  size_t staged_count = 0;
+
   while (true) {
     NodeBase* node = map.AllocNode(map_info.node_size_info);
 
@@ -2753,46 +3027,24 @@ PROTOBUF_NOINLINE const char* TcParser::MpMap(PROTOBUF_TC_PARAM_DECL) {
                                      aux[1].enum_data))) {
         WriteMapEntryAsUnknown(msg, table, saved_tag, node, map_info);
       } else {
-        // Done parsing the node, try to insert it.
-        // If it overwrites something we get old node back to destroy it.
-        switch (map_info.key_type_card.cpp_type()) {
-          case MapTypeCard::kBool:
-            node = static_cast<KeyMapBase<bool>&>(map).InsertOrReplaceNode(
-                static_cast<KeyMapBase<bool>::KeyNode*>(node));
-            break;
-          case MapTypeCard::k32:
-            node = static_cast<KeyMapBase<uint32_t>&>(map).InsertOrReplaceNode(
-                static_cast<KeyMapBase<uint32_t>::KeyNode*>(node));
-            break;
-          case MapTypeCard::k64:
-            node = static_cast<KeyMapBase<uint64_t>&>(map).InsertOrReplaceNode(
-                static_cast<KeyMapBase<uint64_t>::KeyNode*>(node));
-            break;
-          case MapTypeCard::kString:
-            node =
-                static_cast<KeyMapBase<std::string>&>(map).InsertOrReplaceNode(
-                    static_cast<KeyMapBase<std::string>::KeyNode*>(node));
-            break;
-          default:
-            PROTOBUF_ASSUME(false);
-        }
+        // Done parsing the node, stage it for insertion.
+        node->next = nullptr;
+        *staged_tail = node;
+        staged_tail = &node->next;
+        ++staged_count;
+        node = nullptr;
       }
     }
 
     // Destroy the node if we have it.
-    // It could be because we failed to parse, or because insertion returned
-    // an overwritten node.
+    // It could be because we failed to parse, or because it was written as an
+    // unknown field.
     if (PROTOBUF_PREDICT_FALSE(node != nullptr && map.arena() == nullptr)) {
       DestroyMapNode(node, map_info, map);
     }
 
-    if (PROTOBUF_PREDICT_FALSE(ptr == nullptr)) {
-      PROTOBUF_MUSTTAIL return Error(PROTOBUF_TC_PARAM_NO_DATA_PASS);
-    }
-
-    if (PROTOBUF_PREDICT_FALSE(!ctx->DataAvailable(ptr))) {
-      PROTOBUF_MUSTTAIL return ToParseLoop(PROTOBUF_TC_PARAM_NO_DATA_PASS);
-    }
+    if (PROTOBUF_PREDICT_FALSE(ptr == nullptr)) break;
+    if (PROTOBUF_PREDICT_FALSE(!ctx->DataAvailable(ptr))) break;
 
     uint32_t next_tag;
     const char* ptr2 = ReadTagInlined(ptr, &next_tag);
@@ -2800,6 +3052,18 @@ PROTOBUF_NOINLINE const char* TcParser::MpMap(PROTOBUF_TC_PARAM_DECL) {
     ptr = ptr2;
   }
 
+  // Entries that parsed before an error are kept, as if they were inserted
+  // one by one.
+  if (staged != nullptr) InsertMapNodes(staged, staged_count, map_info, map);
+
+  if (PROTOBUF_PREDICT_FALSE(ptr == nullptr)) {
+    PROTOBUF_MUSTTAIL return Error(PROTOBUF_TC_PARAM_NO_DATA_PASS);
+  }
+
+  if (PROTOBUF_PREDICT_FALSE(!ctx->DataAvailable(ptr))) {
+    PROTOBUF_MUSTTAIL return ToParseLoop(PROTOBUF_TC_PARAM_NO_DATA_PASS);
+  }
+
   PROTOBUF_MUSTTAIL return ToTagDispatch(PROTOBUF_TC_PARAM_NO_DATA_PASS);
 }
 
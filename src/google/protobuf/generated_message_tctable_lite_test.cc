@@ -6,12 +6,19 @@
 // https://developers.google.com/open-source/licenses/bsd
 
 #include <cstddef>
+#include <cstdint>
+#include <string>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/strings/cord.h"
+#include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/generated_message_tctable_impl.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unittest_proto3.pb.h"
 #include "google/protobuf/wire_format_lite.h"
 
 namespace google {
@@ -20,6 +27,7 @@ namespace internal {
 
 namespace {
 
+using ::testing::ElementsAreArray;
 using ::testing::Eq;
 using ::testing::Not;
 using ::testing::Optional;
@@ -824,6 +832,217 @@ TEST(GeneratedMessageTctableLiteTest, PackedEnumSmallRange) {
   EXPECT_EQ(new_proto.vals().Capacity(), empty_proto.vals().Capacity());
 }
 
+TEST(GeneratedMessageTctableLiteTest, PackedClosedEnum) {
+  // FOREIGN_BAX is not contiguous with the other values, so the field is
+  // validated against the enum data rather than a range.
+  constexpr int kNumVals = 1023;
+  protobuf_unittest::TestPackedTypes proto;
+  for (int i = 0; i < kNumVals; i++) {
+    proto.add_packed_enum(i % 2 == 0 ? protobuf_unittest::FOREIGN_BAX
+                                     : protobuf_unittest::FOREIGN_FOO);
+  }
+  protobuf_unittest::TestPackedTypes new_proto;
+  ASSERT_TRUE(new_proto.ParseFromString(proto.SerializeAsString()));
+  EXPECT_THAT(new_proto.packed_enum(), ElementsAreArray(proto.packed_enum()));
+  // The field was reserved once rather than grown on demand.
+  protobuf_unittest::TestPackedTypes empty_proto;
+  empty_proto.mutable_packed_enum()->Reserve(kNumVals);
+  EXPECT_EQ(new_proto.packed_enum().Capacity(),
+            empty_proto.packed_enum().Capacity());
+
+  // Unknown values are kept out of the field.
+  std::string payload;
+  payload.push_back(protobuf_unittest::FOREIGN_FOO);
+  payload.push_back(100);
+  payload.push_back(protobuf_unittest::FOREIGN_BAX);
+  uint8_t header[8];
+  uint8_t* header_end = WireFormatLite::WriteTagToArray(
+      protobuf_unittest::TestPackedTypes::kPackedEnumFieldNumber,
+      WireFormatLite::WIRETYPE_LENGTH_DELIMITED, header);
+  header_end = WireFormatLite::WriteUInt32NoTagToArray(
+      static_cast<uint32_t>(payload.size()), header_end);
+  std::string serialized(reinterpret_cast<char*>(header),
+                         static_cast<size_t>(header_end - header));
+  serialized += payload;
+  ASSERT_TRUE(new_proto.ParseFromString(serialized));
+  EXPECT_THAT(new_proto.packed_enum(),
+              ElementsAreArray({protobuf_unittest::FOREIGN_FOO,
+                                protobuf_unittest::FOREIGN_BAX}));
+  EXPECT_EQ(
+      new_proto.GetReflection()->GetUnknownFields(new_proto).field_count(), 1);
+}
+
+TEST(GeneratedMessageTctableLiteTest, PackedVarintsOfMixedLengths) {
+  // Cover every varint length, in runs and interleaved, so that values end at
+  // every offset of the words loaded by the batch decoder.
+  protobuf_unittest::TestPackedTypes proto;
+  for (int i = 0; i < 300; i++) {
+    const int shift = (i * 7) % 64;
+    const uint64_t value = (uint64_t{1} << shift) | (i % 3);
+    proto.add_packed_uint64(value);
+    proto.add_packed_int64(i % 5 == 0 ? -static_cast<int64_t>(value)
+                                      : static_cast<int64_t>(i % 11));
+    proto.add_packed_int32(i % 4 == 0 ? -i : i * 1000);
+    proto.add_packed_sint64(i % 2 == 0 ? -static_cast<int64_t>(value >> 1)
+                                       : static_cast<int64_t>(value >> 1));
+  }
+
+  protobuf_unittest::TestPackedTypes new_proto;
+  ASSERT_TRUE(new_proto.ParseFromString(proto.SerializeAsString()));
+  EXPECT_THAT(new_proto.packed_uint64(),
+              ElementsAreArray(proto.packed_uint64()));
+  EXPECT_THAT(new_proto.packed_int64(),
+              ElementsAreArray(proto.packed_int64()));
+  EXPECT_THAT(new_proto.packed_int32(),
+              ElementsAreArray(proto.packed_int32()));
+  EXPECT_THAT(new_proto.packed_sint64(),
+              ElementsAreArray(proto.packed_sint64()));
+}
+
+TEST(GeneratedMessageTctableLiteTest, PackedVarintsOfUniformLengthPrefix) {
+  // The length of the first varints picks the decoder for the rest of the
+  // array. Values that change length after that must still decode.
+  protobuf_unittest::TestPackedTypes proto;
+  for (int length = 1; length <= 10; length++) {
+    proto.Clear();
+    const uint64_t first = length == 10 ? ~uint64_t{0}
+                                        : uint64_t{1} << (7 * (length - 1));
+    for (int i = 0; i < 20; i++) proto.add_packed_uint64(first | i);
+    for (int i = 0; i < 100; i++) {
+      proto.add_packed_uint64(uint64_t{1} << ((i * 7) % 64));
+    }
+
+    protobuf_unittest::TestPackedTypes new_proto;
+    ASSERT_TRUE(new_proto.ParseFromString(proto.SerializeAsString()));
+    EXPECT_THAT(new_proto.packed_uint64(),
+                ElementsAreArray(proto.packed_uint64()))
+        << "length: " << length;
+  }
+}
+
+TEST(GeneratedMessageTctableLiteTest, PackedVarintsTruncated) {
+  // A packed array whose last varint is cut off by the end of the array,
+  // while the bytes that follow would complete it.
+  std::string payload;
+  for (int i = 0; i < 40; i++) payload.push_back(static_cast<char>(i));
+  payload.append("\x80\x80\x80");
+  uint8_t header[8];
+  uint8_t* header_end = WireFormatLite::WriteTagToArray(
+      protobuf_unittest::TestPackedTypes::kPackedUint64FieldNumber,
+      WireFormatLite::WIRETYPE_LENGTH_DELIMITED, header);
+  header_end = WireFormatLite::WriteUInt32NoTagToArray(
+      static_cast<uint32_t>(payload.size()), header_end);
+  std::string serialized(reinterpret_cast<char*>(header),
+                         static_cast<size_t>(header_end - header));
+  serialized += payload;
+  // Field 1 varint 0: completes the dangling varint if read past the array.
+  serialized.append("\x08\x00", 2);
+
+  protobuf_unittest::TestPackedTypes proto;
+  EXPECT_FALSE(proto.ParseFromString(serialized));
+}
+
+TEST(GeneratedMessageTctableLiteTest, PackedFixedAcrossBuffers) {
+  protobuf_unittest::TestPackedTypes proto;
+  for (int i = 0; i < 1000; i++) {
+    proto.add_packed_fixed32(static_cast<uint32_t>(i) * 0x01020304u);
+    proto.add_packed_sfixed64(-int64_t{i} * 0x010203040506);
+    proto.add_packed_float(i * 0.5f);
+    proto.add_packed_double(i * -0.25);
+  }
+  const std::string serialized = proto.SerializeAsString();
+
+  // Small blocks make every field span many buffers.
+  for (int block_size : {7, 64, 1000}) {
+    SCOPED_TRACE(block_size);
+    io::ArrayInputStream input(serialized.data(),
+                               static_cast<int>(serialized.size()),
+                               block_size);
+    protobuf_unittest::TestPackedTypes new_proto;
+    ASSERT_TRUE(new_proto.ParseFromZeroCopyStream(&input));
+    EXPECT_THAT(new_proto.packed_fixed32(),
+                ElementsAreArray(proto.packed_fixed32()));
+    EXPECT_THAT(new_proto.packed_sfixed64(),
+                ElementsAreArray(proto.packed_sfixed64()));
+    EXPECT_THAT(new_proto.packed_float(),
+                ElementsAreArray(proto.packed_float()));
+    EXPECT_THAT(new_proto.packed_double(),
+                ElementsAreArray(proto.packed_double()));
+  }
+}
+
+TEST(GeneratedMessageTctableLiteTest, PackedFixedLongerThanInput) {
+  // A packed fixed64 field claiming far more bytes than the input holds.
+  uint8_t header[16];
+  uint8_t* header_end = WireFormatLite::WriteTagToArray(
+      protobuf_unittest::TestPackedTypes::kPackedFixed64FieldNumber,
+      WireFormatLite::WIRETYPE_LENGTH_DELIMITED, header);
+  header_end = WireFormatLite::WriteUInt32NoTagToArray(1 << 30, header_end);
+  std::string serialized(reinterpret_cast<char*>(header),
+                         static_cast<size_t>(header_end - header));
+  serialized.append(64, '\x01');
+
+  protobuf_unittest::TestPackedTypes proto;
+  EXPECT_FALSE(proto.ParseFromString(serialized));
+  io::ArrayInputStream input(serialized.data(),
+                             static_cast<int>(serialized.size()), 8);
+  EXPECT_FALSE(proto.ParseFromZeroCopyStream(&input));
+}
+
+TEST(GeneratedMessageTctableLiteTest, Utf8ValidationOfShortStrings) {
+  // Put an invalid byte at every offset of strings around the sizes that are
+  // checked inline.
+  for (size_t size = 1; size <= 20; size++) {
+    proto3_unittest::TestAllTypes proto;
+    proto.set_optional_string(std::string(size, 'a'));
+    proto.add_repeated_string(std::string(size, 'b'));
+    const std::string valid = proto.SerializeAsString();
+    ASSERT_TRUE(proto3_unittest::TestAllTypes().ParseFromString(valid));
+
+    for (size_t i = 0; i < size; i++) {
+      SCOPED_TRACE(absl::StrCat("size ", size, ", offset ", i));
+      std::string invalid = valid;
+      // The singular string's tag and length take the first two bytes.
+      invalid[2 + i] = '\xff';
+      EXPECT_FALSE(proto3_unittest::TestAllTypes().ParseFromString(invalid));
+      invalid = valid;
+      invalid[invalid.size() - size + i] = '\xc0';
+      EXPECT_FALSE(proto3_unittest::TestAllTypes().ParseFromString(invalid));
+    }
+  }
+}
+
+TEST(GeneratedMessageTctableLiteTest, OneofMemberChanges) {
+  // Every change of member destroys the previous one, which leaks under
+  // sanitizers if a member that owns memory is missed.
+  protobuf_unittest::TestOneof2 cord;
+  cord.set_foo_bytes_cord(absl::Cord(std::string(100, 'c')));
+  protobuf_unittest::TestOneof2 str;
+  str.set_foo_string(std::string(100, 's'));
+  protobuf_unittest::TestOneof2 message;
+  message.mutable_foo_message()->set_moo_int(1);
+  protobuf_unittest::TestOneof2 group;
+  group.mutable_foogroup()->set_a(2);
+  protobuf_unittest::TestOneof2 scalar;
+  scalar.set_foo_int(3);
+  const std::string input =
+      absl::StrCat(cord.SerializeAsString(), str.SerializeAsString(),
+                   message.SerializeAsString(), group.SerializeAsString(),
+                   cord.SerializeAsString(), scalar.SerializeAsString());
+
+  for (bool use_arena : {false, true}) {
+    Arena arena;
+    auto* proto = Arena::CreateMessage<protobuf_unittest::TestOneof2>(
+        use_arena ? &arena : nullptr);
+    ASSERT_TRUE(proto->ParseFromString(input));
+    EXPECT_EQ(proto->foo_int(), 3);
+    ASSERT_TRUE(proto->ParseFromString(
+        absl::StrCat(input, message.SerializeAsString())));
+    EXPECT_EQ(proto->foo_message().moo_int(), 1);
+    if (!use_arena) delete proto;
+  }
+}
+
 // Create a serialized proto which falsely claims to have a packed array of
 // enums of length a little less than 2^31.  We merge this with a proto that
 // already has a few elements in this array.
@@ -899,6 +1118,61 @@ TEST(GeneratedMessageTctableLiteTest,
   EXPECT_LE(proto.vals().Capacity(), 2048);
 }
 
+// Forwards to an ArrayInputStream, counting the bytes handed out by Next().
+class CountingInputStream final : public io::ZeroCopyInputStream {
+ public:
+  CountingInputStream(absl::string_view data, int block_size)
+      : input_(data.data(), static_cast<int>(data.size()), block_size) {}
+
+  bool Next(const void** data, int* size) override {
+    if (!input_.Next(data, size)) return false;
+    bytes_returned_ += *size;
+    return true;
+  }
+  void BackUp(int count) override {
+    input_.BackUp(count);
+    bytes_returned_ -= count;
+  }
+  bool Skip(int count) override { return input_.Skip(count); }
+  int64_t ByteCount() const override { return input_.ByteCount(); }
+
+  int64_t bytes_returned() const { return bytes_returned_; }
+
+ private:
+  io::ArrayInputStream input_;
+  int64_t bytes_returned_ = 0;
+};
+
+TEST(GeneratedMessageTctableLiteTest, LargeSkipIsLeftToStream) {
+  std::string data = "ab";
+  data.append(100000, 'x');
+  data.append("cd");
+
+  for (int block_size : {8, 100, 1024}) {
+    SCOPED_TRACE(block_size);
+    CountingInputStream input(data, block_size);
+    const char* ptr;
+    ParseContext ctx(io::CodedInputStream::GetDefaultRecursionLimit(),
+                     /* aliasing= */ false, &ptr, &input);
+    ASSERT_EQ(absl::string_view(ptr, 2), "ab");
+    ptr = ctx.Skip(ptr + 2, 100000);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(absl::string_view(ptr, 2), "cd");
+    EXPECT_LT(input.bytes_returned(), 3 * 1024);
+    ctx.BackUp(ptr + 2);
+    EXPECT_EQ(input.ByteCount(), static_cast<int64_t>(data.size()));
+  }
+}
+
+TEST(GeneratedMessageTctableLiteTest, LargeSkipPastEndOfStream) {
+  std::string data(10000, 'x');
+  CountingInputStream input(data, 100);
+  const char* ptr;
+  ParseContext ctx(io::CodedInputStream::GetDefaultRecursionLimit(),
+                   /* aliasing= */ false, &ptr, &input);
+  EXPECT_EQ(ctx.Skip(ptr, 10001), nullptr);
+}
+
 }  // namespace internal
 }  // namespace protobuf
 }  // namespace google
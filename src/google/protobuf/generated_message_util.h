@@ -210,51 +210,119 @@ struct MapSorterLessThan {
   }
 };
 
-// MapSorterFlat stores keys inline with pointers to map entries, so that
-// keys can be compared without indirection. This type is used for maps with
-// keys that are not strings.
+// Maps with at least this many entries and integer keys are radix sorted.
+constexpr size_t kMapSorterMinRadixSortSize = 64;
+
+template <typename KeyT>
+void MapSorterSort(std::false_type /* radix_sortable */,
+                   std::pair<KeyT, const void*>* items,
+                   std::pair<KeyT, const void*>*, size_t size) {
+  std::sort(items, items + size, MapSorterLessThan<KeyT>{});
+}
+
+// Sorts `items` by key with an LSD radix sort over bytes, using `scratch`,
+// which holds `size` more items. Bytes that all keys share are skipped, so
+// maps with small keys take one or two passes.
+template <typename KeyT>
+void MapSorterSort(std::true_type /* radix_sortable */,
+                   std::pair<KeyT, const void*>* items,
+                   std::pair<KeyT, const void*>* scratch, size_t size) {
+  if (size < kMapSorterMinRadixSortSize) {
+    MapSorterSort(std::false_type{}, items, scratch, size);
+    return;
+  }
+  using UnsignedKey = typename std::make_unsigned<KeyT>::type;
+  constexpr int kBits = static_cast<int>(sizeof(UnsignedKey) * 8);
+  // Flipping the sign bit orders signed keys as their unsigned images.
+  constexpr UnsignedKey kFlip = std::is_signed<KeyT>::value
+                                    ? UnsignedKey{1} << (kBits - 1)
+                                    : UnsignedKey{0};
+  auto* const out = items;
+  for (int shift = 0; shift < kBits; shift += 8) {
+    const auto digit = [&](KeyT key) {
+      return static_cast<size_t>(
+          ((static_cast<UnsignedKey>(key) ^ kFlip) >> shift) & 0xff);
+    };
+    size_t offsets[256] = {};
+    for (size_t i = 0; i < size; ++i) ++offsets[digit(items[i].first)];
+    if (offsets[digit(items[0].first)] == size) continue;
+    size_t sum = 0;
+    for (size_t& offset : offsets) {
+      const size_t count = offset;
+      offset = sum;
+      sum += count;
+    }
+    for (size_t i = 0; i < size; ++i) {
+      scratch[offsets[digit(items[i].first)]++] = items[i];
+    }
+    std::swap(items, scratch);
+  }
+  if (items != out) std::copy(items, items + size, out);
+}
+
+// MapSorterFlat sorts copies of the keys stored inline with pointers to map
+// entries, so that keys can be compared without indirection. This type is
+// used for maps with keys that are not strings.
+//
+// The order is cached on the map until it is next modified, so serializing an
+// unchanged map again does not sort it again. Maps on an arena are sorted for
+// every serialization.
 template <typename MapT>
 class MapSorterFlat {
  public:
   using value_type = typename MapT::value_type;
-  // To avoid code bloat we don't put `value_type` in `storage_type`. It is not
-  // necessary for the call to sort, and avoiding it prevents unnecessary
-  // separate instantiations of sort.
-  using storage_type = std::pair<typename MapT::key_type, const void*>;
+  using key_type = typename MapT::key_type;
+  using storage_type = const void*;
 
-  // This const_iterator dereferenes to the map entry stored in the sorting
-  // array pairs. This is the same interface as the Map::const_iterator type,
-  // and allows generated code to use the same loop body with either form:
+  // This const_iterator dereferenes the map entry pointer stored in the sorted
+  // array. This is the same interface as the Map::const_iterator type, and
+  // allows generated code to use the same loop body with either form:
   //   for (const auto& entry : map) { ... }
   //   for (const auto& entry : MapSorterFlat(map)) { ... }
-  struct const_iterator : public MapSorterIt<storage_type> {
+  struct const_iterator : public MapSorterIt<const storage_type> {
     using pointer = const typename MapT::value_type*;
     using reference = const typename MapT::value_type&;
-    using MapSorterIt<storage_type>::MapSorterIt;
+    using MapSorterIt<const storage_type>::MapSorterIt;
 
     pointer operator->() const {
-      return static_cast<const value_type*>(this->ptr->second);
+      return static_cast<const value_type*>(*this->ptr);
     }
     reference operator*() const { return *this->operator->(); }
   };
 
   explicit MapSorterFlat(const MapT& m)
-      : size_(m.size()), items_(size_ ? new storage_type[size_] : nullptr) {
-    if (!size_) return;
-    storage_type* it = &items_[0];
+      : size_(m.size()), items_(m.sorted_entries()) {
+    if (items_ != nullptr || !size_) return;
+    using radix_sortable =
+        std::integral_constant<bool, std::is_integral<key_type>::value &&
+                                         !std::is_same<key_type, bool>::value>;
+    // To avoid code bloat we don't put `value_type` in the sorted pairs. It is
+    // not necessary for the call to sort, and avoiding it prevents
+    // unnecessary separate instantiations of sort.
+    using pair_type = std::pair<key_type, const void*>;
+    const size_t num_pairs = radix_sortable::value &&
+                                     size_ >= kMapSorterMinRadixSortSize
+                                 ? 2 * size_
+                                 : size_;
+    std::unique_ptr<pair_type[]> pairs(new pair_type[num_pairs]);
+    pair_type* it = &pairs[0];
     for (const auto& entry : m) {
       *it++ = {entry.first, &entry};
     }
-    std::sort(&items_[0], &items_[size_],
-              MapSorterLessThan<typename MapT::key_type>{});
+    MapSorterSort(radix_sortable{}, &pairs[0], &pairs[0] + size_, size_);
+    owned_.reset(new storage_type[size_]);
+    for (size_t i = 0; i < size_; ++i) owned_[i] = pairs[i].second;
+    items_ = m.CacheSortedEntries(owned_);
   }
   size_t size() const { return size_; }
-  const_iterator begin() const { return {items_.get()}; }
-  const_iterator end() const { return {items_.get() + size_}; }
+  const_iterator begin() const { return {items_}; }
+  const_iterator end() const { return {items_ + size_}; }
 
  private:
   size_t size_;
-  std::unique_ptr<storage_type[]> items_;
+  const storage_type* items_;
+  // The sorted array if the map did not take it.
+  std::unique_ptr<storage_type[]> owned_;
 };
 
 // Defined outside of MapSorterPtr to only be templatized on the key.
@@ -269,7 +337,8 @@ struct MapSorterPtrLessThan {
 };
 
 // MapSorterPtr stores and sorts pointers to map entries. This type is used for
-// maps with keys that are strings.
+// maps with keys that are strings. Like MapSorterFlat, it caches the order on
+// the map.
 template <typename MapT>
 class MapSorterPtr {
  public:
@@ -284,10 +353,10 @@ class MapSorterPtr {
   // allows generated code to use the same loop body with either form:
   //   for (const auto& entry : map) { ... }
   //   for (const auto& entry : MapSorterPtr(map)) { ... }
-  struct const_iterator : public MapSorterIt<storage_type> {
+  struct const_iterator : public MapSorterIt<const storage_type> {
     using pointer = const typename MapT::value_type*;
     using reference = const typename MapT::value_type&;
-    using MapSorterIt<storage_type>::MapSorterIt;
+    using MapSorterIt<const storage_type>::MapSorterIt;
 
     pointer operator->() const {
       return static_cast<const value_type*>(*this->ptr);
@@ -296,24 +365,28 @@ class MapSorterPtr {
   };
 
   explicit MapSorterPtr(const MapT& m)
-      : size_(m.size()), items_(size_ ? new storage_type[size_] : nullptr) {
-    if (!size_) return;
-    storage_type* it = &items_[0];
+      : size_(m.size()), items_(m.sorted_entries()) {
+    if (items_ != nullptr || !size_) return;
+    owned_.reset(new storage_type[size_]);
+    storage_type* it = &owned_[0];
     for (const auto& entry : m) {
       *it++ = &entry;
     }
     static_assert(PROTOBUF_FIELD_OFFSET(typename MapT::value_type, first) == 0,
                   "Must hold for MapSorterPtrLessThan to work.");
-    std::sort(&items_[0], &items_[size_],
+    std::sort(&owned_[0], &owned_[size_],
               MapSorterPtrLessThan<typename MapT::key_type>{});
+    items_ = m.CacheSortedEntries(owned_);
   }
   size_t size() const { return size_; }
-  const_iterator begin() const { return {items_.get()}; }
-  const_iterator end() const { return {items_.get() + size_}; }
+  const_iterator begin() const { return {items_}; }
+  const_iterator end() const { return {items_ + size_}; }
 
  private:
   size_t size_;
-  std::unique_ptr<storage_type[]> items_;
+  const storage_type* items_;
+  // The sorted array if the map did not take it.
+  std::unique_ptr<storage_type[]> owned_;
 };
 
 }  // namespace internal
@@ -22,9 +22,59 @@ namespace internal {
 
 const char* ImplicitWeakMessage::_InternalParse(const char* ptr,
                                                 ParseContext* ctx) {
+  ClearResolved();
   return ctx->AppendString(ptr, data_);
 }
 
+PROTOBUF_CONSTINIT const MessageLite::ClassData
+    ImplicitWeakMessage::kClassData = {nullptr, nullptr};
+
+void ImplicitWeakMessage::ClearResolved() {
+  MessageLite* resolved =
+      resolved_.exchange(nullptr, std::memory_order_relaxed);
+  if (GetArena() == nullptr) delete resolved;
+}
+
+const MessageLite* ImplicitWeakMessage::Resolve(const MessageLite* value,
+                                                const MessageLite* prototype) {
+  if (value == nullptr || !IsPlaceholder(*value) || IsPlaceholder(*prototype)) {
+    return value;
+  }
+  const auto* weak = static_cast<const ImplicitWeakMessage*>(value);
+  MessageLite* resolved = weak->resolved_.load(std::memory_order_acquire);
+  if (resolved != nullptr) return resolved;
+
+  Arena* arena = weak->GetArena();
+  MessageLite* parsed = prototype->New(arena);
+  if (weak->data_ != nullptr) parsed->ParsePartialFromString(*weak->data_);
+  if (weak->resolved_.compare_exchange_strong(resolved, parsed,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_acquire)) {
+    return parsed;
+  }
+  // Another thread resolved it first.
+  if (arena == nullptr) delete parsed;
+  return resolved;
+}
+
+MessageLite* ImplicitWeakMessage::ResolveMutable(MessageLite** field,
+                                                 const MessageLite* prototype) {
+  MessageLite* value = *field;
+  const MessageLite* resolved = Resolve(value, prototype);
+  if (resolved == value) return value;
+  auto* weak = static_cast<ImplicitWeakMessage*>(value);
+  // The parsed message now belongs to the field.
+  weak->resolved_.store(nullptr, std::memory_order_relaxed);
+  if (weak->GetArena() == nullptr) delete weak;
+  *field = const_cast<MessageLite*>(resolved);
+  return *field;
+}
+
+void LinkImplicitWeakType(const void** default_instance_ptr,
+                          const MessageLite* prototype) {
+  *default_instance_ptr = prototype;
+}
+
 struct ImplicitWeakMessageDefaultType {
   constexpr ImplicitWeakMessageDefaultType()
       : instance(ConstantInitialized{}) {}
@@ -8,6 +8,7 @@
 #ifndef GOOGLE_PROTOBUF_IMPLICIT_WEAK_MESSAGE_H__
 #define GOOGLE_PROTOBUF_IMPLICIT_WEAK_MESSAGE_H__
 
+#include <atomic>
 #include <string>
 
 #include "google/protobuf/arena.h"
@@ -36,7 +37,7 @@ class PROTOBUF_EXPORT ImplicitWeakMessage : public MessageLite {
  public:
   ImplicitWeakMessage() : ImplicitWeakMessage(nullptr) {}
   explicit constexpr ImplicitWeakMessage(ConstantInitialized)
-      : data_(nullptr) {}
+      : data_(nullptr), resolved_(nullptr) {}
   ImplicitWeakMessage(const ImplicitWeakMessage&) = delete;
   ImplicitWeakMessage& operator=(const ImplicitWeakMessage&) = delete;
 
@@ -46,12 +47,13 @@ class PROTOBUF_EXPORT ImplicitWeakMessage : public MessageLite {
 
   // TODO: make this constructor private
   explicit ImplicitWeakMessage(Arena* arena)
-      : MessageLite(arena), data_(new std::string) {}
+      : MessageLite(arena), data_(new std::string), resolved_(nullptr) {}
 
   ~ImplicitWeakMessage() override {
     // data_ will be null in the default instance, but we can safely call delete
     // here because the default instance will never be destroyed.
     delete data_;
+    ClearResolved();
   }
 
   static const ImplicitWeakMessage* default_instance();
@@ -62,7 +64,10 @@ class PROTOBUF_EXPORT ImplicitWeakMessage : public MessageLite {
     return Arena::CreateMessage<ImplicitWeakMessage>(arena);
   }
 
-  void Clear() override { data_->clear(); }
+  void Clear() override {
+    data_->clear();
+    ClearResolved();
+  }
 
   bool IsInitialized() const override { return true; }
 
@@ -71,6 +76,7 @@ class PROTOBUF_EXPORT ImplicitWeakMessage : public MessageLite {
         static_cast<const ImplicitWeakMessage&>(other).data_;
     if (other_data != nullptr) {
       data_->append(*other_data);
+      ClearResolved();
     }
   }
 
@@ -91,13 +97,53 @@ class PROTOBUF_EXPORT ImplicitWeakMessage : public MessageLite {
 
   typedef void InternalArenaConstructable_;
 
+  // Returns `value`, or, if `value` is a placeholder and `prototype` is not,
+  // its contents parsed as `prototype`'s type. This happens once the true type
+  // of an implicit weak field is linked with LinkImplicitWeakType(). The parsed
+  // message is cached in the placeholder, and dropped when the placeholder is
+  // modified. Concurrent calls are safe.
+  static const MessageLite* Resolve(const MessageLite* value,
+                                    const MessageLite* prototype);
+
+  // Like Resolve(), but replaces a placeholder in `*field` with the message
+  // parsed from it, so that it can be modified.
+  static MessageLite* ResolveMutable(MessageLite** field,
+                                     const MessageLite* prototype);
+
  private:
+  static const ClassData kClassData;
+
+  const ClassData* GetClassData() const final { return &kClassData; }
+
+  static bool IsPlaceholder(const MessageLite& msg) {
+    return msg.GetClassData() == &kClassData;
+  }
+
+  void ClearResolved();
+
   // This std::string is allocated on the heap, but we use a raw pointer so that
   // the default instance can be constant-initialized. In the const methods, we
   // have to handle the possibility of data_ being null.
   std::string* data_;
+  // The contents of data_, parsed by Resolve(), on the arena of this message.
+  mutable std::atomic<MessageLite*> resolved_;
 };
 
+// Makes the implicit weak fields that refer to a message type through
+// `default_instance_ptr`, the weak `_Foo_default_instance_ptr_` of type Foo,
+// hold `prototype`'s type. This is for types that were not linked in when the
+// fields were, for example because they come with a shared library loaded
+// later:
+//
+//   LinkImplicitWeakType(&_Foo_default_instance_ptr_,
+//                        &Foo::default_instance());
+//
+// Fields parsed afterwards hold the true type. Fields that were parsed before
+// keep their bytes in a placeholder, and are parsed from them when they are
+// next accessed. Must not be called concurrently with parsing.
+PROTOBUF_EXPORT void LinkImplicitWeakType(const void** default_instance_ptr,
+                                          const MessageLite* prototype);
+
 struct ImplicitWeakMessageDefaultType;
 extern ImplicitWeakMessageDefaultType implicit_weak_message_default_instance;
 
@@ -68,26 +68,34 @@ std::string* InlinedStringField::MutableSlow(::google::protobuf::Arena* arena,
                                              bool donated,
                                              uint32_t* donating_states,
                                              uint32_t mask, MessageLite* msg) {
-  (void)mask;
-  (void)msg;
+  Undonate(arena, donated, donating_states, mask, msg);
   return UnsafeMutablePointer();
 }
 
+void InlinedStringField::Undonate(Arena* arena, bool donated,
+                                  uint32_t* donating_states, uint32_t mask,
+                                  MessageLite* msg) {
+  if (arena == nullptr || !donated) return;
+  *donating_states &= mask;
+  msg->OnDemandRegisterArenaDtor(arena);
+}
+
 void InlinedStringField::SetAllocated(const std::string* default_value,
                                       std::string* value, Arena* arena,
                                       bool donated, uint32_t* donating_states,
                                       uint32_t mask, MessageLite* msg) {
-  (void)mask;
-  (void)msg;
+  if (value != nullptr && value->capacity() > get_const()->capacity()) {
+    Undonate(arena, donated, donating_states, mask, msg);
+  }
   SetAllocatedNoArena(default_value, value);
 }
 
 void InlinedStringField::Set(std::string&& value, Arena* arena, bool donated,
                              uint32_t* donating_states, uint32_t mask,
                              MessageLite* msg) {
-  (void)donating_states;
-  (void)mask;
-  (void)msg;
+  if (value.capacity() > get_const()->capacity()) {
+    Undonate(arena, donated, donating_states, mask, msg);
+  }
   SetNoArena(std::move(value));
 }
 
@@ -109,7 +109,8 @@ class PROTOBUF_EXPORT InlinedStringField {
   //
   //   `donated == ((donating_states & ~mask) != 0)`
   //
-  // This method never changes the `donating_states`.
+  // This method only undonates this field if `value` does not fit in the
+  // string's current buffer.
   void Set(absl::string_view value, Arena* arena, bool donated,
            uint32_t* donating_states, uint32_t mask, MessageLite* msg);
 
@@ -170,6 +171,16 @@ class PROTOBUF_EXPORT InlinedStringField {
   std::string* Mutable(std::nullptr_t);
   std::string* MutableNoCopy(std::nullptr_t);
 
+  // Parser only! Returns the string to read a value of `size` bytes into. The
+  // field stays donated if the value fits in the string's current buffer, so
+  // that parsing short values never registers the arena destructor of `msg`.
+  // `index` is the position of this field's bit in the donated array
+  // `donating_states`.
+  PROTOBUF_NDEBUG_INLINE std::string* MutableForParse(size_t size, Arena* arena,
+                                                      uint32_t* donating_states,
+                                                      uint32_t index,
+                                                      MessageLite* msg);
+
   // Takes a std::string that is heap-allocated, and takes ownership. The
   // std::string's destructor is registered with the arena. Used to implement
   // set_allocated_<field> in generated classes.
@@ -352,6 +363,12 @@ class PROTOBUF_EXPORT InlinedStringField {
                            uint32_t* donating_states, uint32_t mask,
                            MessageLite* msg);
 
+  // String buffers are not allocated on the arena, so before the string of a
+  // donated field may take one, the field is undonated and the arena
+  // destructor of `msg` is registered to free it.
+  static void Undonate(Arena* arena, bool donated, uint32_t* donating_states,
+                       uint32_t mask, MessageLite* msg);
+
 
   // When constructed in an Arena, we want our destructor to be skipped.
   friend class ::google::protobuf::Arena;
@@ -415,28 +432,22 @@ inline PROTOBUF_NDEBUG_INLINE void InlinedStringField::InternalSwap(
     MessageLite* lhs_msg,  //
     InlinedStringField* rhs, bool rhs_arena_dtor_registered,
     MessageLite* rhs_msg, Arena* arena) {
-#ifdef GOOGLE_PROTOBUF_INTERNAL_DONATE_STEAL_INLINE
+  // The donated bits are swapped with the strings, so the message receiving
+  // an undonated string must have its arena destructor registered.
   lhs->get_mutable()->swap(*rhs->get_mutable());
   if (!lhs_arena_dtor_registered && rhs_arena_dtor_registered) {
     lhs_msg->OnDemandRegisterArenaDtor(arena);
   } else if (lhs_arena_dtor_registered && !rhs_arena_dtor_registered) {
     rhs_msg->OnDemandRegisterArenaDtor(arena);
   }
-#else
-  (void)arena;
-  (void)lhs_arena_dtor_registered;
-  (void)rhs_arena_dtor_registered;
-  (void)lhs_msg;
-  (void)rhs_msg;
-  lhs->get_mutable()->swap(*rhs->get_mutable());
-#endif
 }
 
 inline void InlinedStringField::Set(absl::string_view value, Arena* arena,
-                                    bool donated, uint32_t* /*donating_states*/,
-                                    uint32_t /*mask*/, MessageLite* /*msg*/) {
-  (void)arena;
-  (void)donated;
+                                    bool donated, uint32_t* donating_states,
+                                    uint32_t mask, MessageLite* msg) {
+  if (value.size() > get_const()->capacity()) {
+    Undonate(arena, donated, donating_states, mask, msg);
+  }
   SetNoArena(value);
 }
 
@@ -510,6 +521,18 @@ inline std::string* InlinedStringField::MutableNoCopy(std::nullptr_t) {
   return get_mutable();
 }
 
+inline std::string* InlinedStringField::MutableForParse(
+    size_t size, Arena* arena, uint32_t* donating_states, uint32_t index,
+    MessageLite* msg) {
+  std::string* str = get_mutable();
+  if (arena != nullptr && size > str->capacity()) {
+    uint32_t* states = &donating_states[index / 32];
+    const uint32_t bit = uint32_t{1} << (index % 32);
+    Undonate(arena, (*states & bit) != 0, states, ~bit, msg);
+  }
+  return str;
+}
+
 }  // namespace internal
 }  // namespace protobuf
 }  // namespace google
@@ -8,6 +8,7 @@
 #include "google/protobuf/inlined_string_field.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
@@ -18,10 +19,12 @@
 #include <gtest/gtest.h>
 #include "absl/log/absl_check.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/arenastring.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
 #include "google/protobuf/message.h"
+#include "google/protobuf/unittest.pb.h"
 
 
 namespace google {
@@ -31,6 +34,70 @@ using internal::ArenaStringPtr;
 using internal::InlinedStringField;
 
 namespace {
+
+// The donated bit of the field under test, after bit 0 which tracks whether
+// the arena destructor of the message is registered.
+constexpr uint32_t kIndex = 1;
+constexpr uint32_t kBit = 1u << kIndex;
+
+TEST(InlinedStringFieldTest, ParsingShortValuesKeepsFieldDonated) {
+  Arena arena;
+  auto* msg = Arena::CreateMessage<protobuf_unittest::TestAllTypes>(&arena);
+  InlinedStringField field;
+  uint32_t donating_states[] = {~0u};
+
+  std::string* str =
+      field.MutableForParse(3, &arena, donating_states, kIndex, msg);
+  EXPECT_EQ(str, field.UnsafeMutablePointer());
+  str->assign("foo");
+  EXPECT_EQ(donating_states[0], ~0u);
+
+  // A value longer than the inline buffer takes a heap buffer, which the
+  // message must free.
+  const size_t long_size = str->capacity() + 1;
+  field.MutableForParse(long_size, &arena, donating_states, kIndex, msg)
+      ->assign(long_size, 'x');
+  EXPECT_EQ(donating_states[0], ~kBit);
+  EXPECT_EQ(field.Get(), std::string(long_size, 'x'));
+}
+
+TEST(InlinedStringFieldTest, ParsingWithoutArenaNeverUndonates) {
+  InlinedStringField field;
+  uint32_t donating_states[] = {~0u};
+  field.MutableForParse(1000, nullptr, donating_states, kIndex, nullptr)
+      ->assign(1000, 'x');
+  EXPECT_EQ(donating_states[0], ~0u);
+}
+
+TEST(InlinedStringFieldTest, SetUndonatesOnlyToAllocate) {
+  Arena arena;
+  auto* msg = Arena::CreateMessage<protobuf_unittest::TestAllTypes>(&arena);
+  InlinedStringField field;
+  uint32_t donating_states[] = {~0u};
+
+  field.Set("foo", &arena, true, donating_states, ~kBit, msg);
+  EXPECT_EQ(donating_states[0], ~0u);
+  field.Set(std::string("bar"), &arena, true, donating_states, ~kBit, msg);
+  EXPECT_EQ(donating_states[0], ~0u);
+  EXPECT_EQ(field.Get(), "bar");
+
+  const std::string long_value(field.Get().capacity() + 1, 'x');
+  field.Set(long_value, &arena, true, donating_states, ~kBit, msg);
+  EXPECT_EQ(donating_states[0], ~kBit);
+  EXPECT_EQ(field.Get(), long_value);
+}
+
+TEST(InlinedStringFieldTest, MutableUndonates) {
+  Arena arena;
+  auto* msg = Arena::CreateMessage<protobuf_unittest::TestAllTypes>(&arena);
+  InlinedStringField field;
+  uint32_t donating_states[] = {~0u};
+
+  field.Mutable(&arena, true, donating_states, ~kBit, msg)->assign("foo");
+  EXPECT_EQ(donating_states[0], ~kBit);
+  EXPECT_EQ(field.Get(), "foo");
+}
+
 }  // namespace
 }  // namespace protobuf
 }  // namespace google
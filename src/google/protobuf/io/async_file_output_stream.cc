@@ -0,0 +1,205 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/io/async_file_output_stream.h"
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+#include <errno.h>
+#include <string.h>
+
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/io/io_win32.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+#ifdef _WIN32
+using google::protobuf::io::win32::close;
+using google::protobuf::io::win32::write;
+#endif
+
+AsyncFileOutputStream::AsyncFileOutputStream(int file_descriptor,
+                                             int buffer_size,
+                                             int buffer_count)
+    : file_(file_descriptor), buffer_size_(buffer_size) {
+  ABSL_CHECK_GT(buffer_size, 0);
+  ABSL_CHECK_GT(buffer_count, 0);
+  buffers_.reserve(buffer_count);
+  free_.reserve(buffer_count);
+  for (int i = 0; i < buffer_count; ++i) {
+    buffers_.emplace_back(new char[buffer_size]);
+    free_.push_back(buffers_.back().get());
+  }
+  writer_ = std::thread([this] { WriterLoop(); });
+}
+
+AsyncFileOutputStream::~AsyncFileOutputStream() {
+  if (is_closed_) return;
+  if (close_on_delete_) {
+    if (!Close()) {
+      ABSL_LOG(ERROR) << "close() failed: " << strerror(GetErrno());
+    }
+  } else {
+    Shutdown();
+  }
+}
+
+int AsyncFileOutputStream::GetErrno() const {
+  absl::MutexLock lock(&mutex_);
+  return errno_;
+}
+
+bool AsyncFileOutputStream::BufferAvailable() const {
+  return !free_.empty() || errno_ != 0;
+}
+
+bool AsyncFileOutputStream::Drained() const {
+  return (queue_.empty() && in_flight_ == 0) || errno_ != 0;
+}
+
+bool AsyncFileOutputStream::HasWork() const { return !queue_.empty() || stop_; }
+
+void AsyncFileOutputStream::Submit() {
+  if (current_ == nullptr) return;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (current_used_ == 0) {
+      free_.push_back(current_);
+    } else {
+      queue_.push_back({current_, current_used_});
+    }
+  }
+  submitted_bytes_ += current_used_;
+  current_ = nullptr;
+  current_used_ = 0;
+}
+
+bool AsyncFileOutputStream::Next(void** data, int* size) {
+  ABSL_CHECK(!is_closed_);
+
+  if (current_ != nullptr && current_used_ < buffer_size_) {
+    *data = current_ + current_used_;
+    *size = buffer_size_ - current_used_;
+    current_used_ = buffer_size_;
+    return true;
+  }
+  Submit();
+  {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(
+        absl::Condition(this, &AsyncFileOutputStream::BufferAvailable));
+    if (errno_ != 0) return false;
+    current_ = free_.back();
+    free_.pop_back();
+  }
+  *data = current_;
+  *size = buffer_size_;
+  current_used_ = buffer_size_;
+  return true;
+}
+
+void AsyncFileOutputStream::BackUp(int count) {
+  ABSL_CHECK(current_ != nullptr)
+      << " BackUp() can only be called after Next().";
+  ABSL_CHECK_LE(count, current_used_)
+      << " Can't back up over more bytes than were returned by the last call"
+         " to Next().";
+  ABSL_CHECK_GE(count, 0) << " Parameter to BackUp() can't be negative.";
+  current_used_ -= count;
+}
+
+int64_t AsyncFileOutputStream::ByteCount() const {
+  return submitted_bytes_ + current_used_;
+}
+
+bool AsyncFileOutputStream::Flush() {
+  ABSL_CHECK(!is_closed_);
+
+  Submit();
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(this, &AsyncFileOutputStream::Drained));
+  return errno_ == 0;
+}
+
+bool AsyncFileOutputStream::Shutdown() {
+  bool flushed = Flush();
+  {
+    absl::MutexLock lock(&mutex_);
+    stop_ = true;
+  }
+  writer_.join();
+  is_closed_ = true;
+  return flushed;
+}
+
+bool AsyncFileOutputStream::Close() {
+  bool flushed = Shutdown();
+  int result;
+  do {
+    result = close(file_);
+  } while (result < 0 && errno == EINTR);
+  if (result != 0) {
+    absl::MutexLock lock(&mutex_);
+    if (errno_ == 0) errno_ = errno;
+    return false;
+  }
+  return flushed;
+}
+
+void AsyncFileOutputStream::WriterLoop() {
+  absl::MutexLock lock(&mutex_);
+  while (true) {
+    mutex_.Await(absl::Condition(this, &AsyncFileOutputStream::HasWork));
+    if (queue_.empty()) return;
+    Chunk chunk = queue_.front();
+    queue_.pop_front();
+    ++in_flight_;
+    int error = 0;
+    // After an error, queued data is dropped.
+    if (errno_ == 0) {
+      // Write without holding the lock, so the caller can keep filling the
+      // other buffers.
+      mutex_.Unlock();
+      const char* data = chunk.data;
+      int remaining = chunk.size;
+      while (remaining > 0) {
+        int bytes;
+        do {
+          bytes = write(file_, data, remaining);
+        } while (bytes < 0 && errno == EINTR);
+        if (bytes <= 0) {
+          error = bytes < 0 ? errno : EIO;
+          break;
+        }
+        data += bytes;
+        remaining -= bytes;
+      }
+      mutex_.Lock();
+    }
+    if (error != 0 && errno_ == 0) errno_ = error;
+    --in_flight_;
+    free_.push_back(chunk.data);
+  }
+}
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
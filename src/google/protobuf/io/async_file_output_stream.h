@@ -0,0 +1,130 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file defines AsyncFileOutputStream, a ZeroCopyOutputStream that writes
+// to a file descriptor on a background thread.
+
+#ifndef GOOGLE_PROTOBUF_IO_ASYNC_FILE_OUTPUT_STREAM_H__
+#define GOOGLE_PROTOBUF_IO_ASYNC_FILE_OUTPUT_STREAM_H__
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+// A ZeroCopyOutputStream which writes to a file descriptor without blocking
+// the caller on each write.
+//
+// The stream owns `buffer_count` buffers of `buffer_size` bytes, allocated
+// once. Next() hands them out in turn; each full buffer is queued to a
+// background thread that write()s it, while the caller fills the next one.
+// The caller only waits when every buffer is queued or in flight, so
+// serialization and I/O overlap instead of alternating. Bytes reach the file
+// in the order they were written to the stream.
+//
+// Like FileOutputStream, the stream keeps the descriptor open unless
+// SetCloseOnDelete(true) is called. The destructor flushes.
+class PROTOBUF_EXPORT AsyncFileOutputStream final
+    : public ZeroCopyOutputStream {
+ public:
+  static constexpr int kDefaultBufferSize = 1 << 20;
+  static constexpr int kDefaultBufferCount = 2;
+
+  // Creates a stream that writes to the given Unix file descriptor.
+  explicit AsyncFileOutputStream(int file_descriptor,
+                                 int buffer_size = kDefaultBufferSize,
+                                 int buffer_count = kDefaultBufferCount);
+  AsyncFileOutputStream(const AsyncFileOutputStream&) = delete;
+  AsyncFileOutputStream& operator=(const AsyncFileOutputStream&) = delete;
+  ~AsyncFileOutputStream() override;
+
+  // Queues the buffered data and waits until everything written so far has
+  // reached the file descriptor. Returns false if an I/O error has occurred.
+  bool Flush();
+
+  // Flushes, stops the background thread and closes the file descriptor.
+  // Returns false if an error occurs during the process; use GetErrno() to
+  // examine the error. Even if an error occurs, the file descriptor is closed
+  // when this returns.
+  bool Close();
+
+  // By default, the file descriptor is not closed when the stream is
+  // destroyed.  Call SetCloseOnDelete(true) to change that.  WARNING:
+  // This leaves no way for the caller to detect if close() fails.  If
+  // detecting close() errors is important to you, you should arrange
+  // to close the descriptor yourself.
+  void SetCloseOnDelete(bool value) { close_on_delete_ = value; }
+
+  // If an I/O error has occurred on this file descriptor, this is the
+  // errno from that error.  Otherwise, this is zero.  Once an error
+  // occurs, the stream is broken and all subsequent operations will
+  // fail. Errors of queued writes are reported once they complete.
+  int GetErrno() const;
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  struct Chunk {
+    char* data;
+    int size;
+  };
+
+  // Queues the bytes of the current buffer, if any.
+  void Submit();
+  // Stops and joins the background thread after flushing.
+  bool Shutdown();
+  void WriterLoop();
+
+  // Conditions for absl::Mutex::Await().
+  bool BufferAvailable() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool Drained() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const int file_;
+  const int buffer_size_;
+  bool close_on_delete_ = false;
+  bool is_closed_ = false;
+
+  std::vector<std::unique_ptr<char[]>> buffers_;
+  // The buffer handed out by Next(), and how much of it holds data.
+  char* current_ = nullptr;
+  int current_used_ = 0;
+  // Bytes in buffers that have been submitted.
+  int64_t submitted_bytes_ = 0;
+
+  mutable absl::Mutex mutex_;
+  std::vector<char*> free_ ABSL_GUARDED_BY(mutex_);
+  std::deque<Chunk> queue_ ABSL_GUARDED_BY(mutex_);
+  int in_flight_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool stop_ ABSL_GUARDED_BY(mutex_) = false;
+  int errno_ ABSL_GUARDED_BY(mutex_) = 0;
+
+  std::thread writer_;
+};
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_IO_ASYNC_FILE_OUTPUT_STREAM_H__
@@ -0,0 +1,137 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/io/async_file_output_stream.h"
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <errno.h>
+
+#include <cstring>
+#include <string>
+
+#include "google/protobuf/testing/file.h"
+#include "google/protobuf/testing/googletest.h"
+#include <gtest/gtest.h>
+#include "absl/log/absl_check.h"
+#include "absl/strings/str_cat.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/io_win32.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace io {
+namespace {
+
+#ifdef _WIN32
+using google::protobuf::io::win32::close;
+using google::protobuf::io::win32::open;
+#endif
+
+#ifndef O_BINARY
+#ifdef _O_BINARY
+#define O_BINARY _O_BINARY
+#else
+#define O_BINARY 0  // If this isn't defined, the platform doesn't need it.
+#endif
+#endif
+
+std::string TestFile() {
+  return absl::StrCat(TestTempDir(), "/async_file_output_stream_test_file");
+}
+
+std::string ReadTestFile() {
+  std::string contents;
+  ABSL_CHECK_OK(File::GetContents(TestFile(), &contents, true));
+  return contents;
+}
+
+TEST(AsyncFileOutputStreamTest, WritesInOrder) {
+  std::string expected;
+  for (int i = 0; i < 10000; ++i) absl::StrAppend(&expected, i, ",");
+
+  for (int buffer_size : {1, 7, 64, 4096}) {
+    for (int buffer_count : {1, 2, 4}) {
+      int file = open(TestFile().c_str(),
+                      O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+      ASSERT_GE(file, 0);
+      {
+        AsyncFileOutputStream output(file, buffer_size, buffer_count);
+        output.SetCloseOnDelete(true);
+        {
+          CodedOutputStream coded(&output);
+          // Mix small writes with ones that span several buffers.
+          coded.WriteRaw(expected.data(), 100);
+          coded.WriteRaw(expected.data() + 100, expected.size() - 200);
+          coded.WriteString(expected.substr(expected.size() - 100));
+        }
+        EXPECT_EQ(output.ByteCount(), expected.size());
+      }
+      EXPECT_EQ(ReadTestFile(), expected)
+          << buffer_size << " x " << buffer_count;
+    }
+  }
+}
+
+TEST(AsyncFileOutputStreamTest, FlushAndBackUp) {
+  int file =
+      open(TestFile().c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+  ASSERT_GE(file, 0);
+  AsyncFileOutputStream output(file, 16);
+  void* data;
+  int size;
+  ASSERT_TRUE(output.Next(&data, &size));
+  ASSERT_EQ(size, 16);
+  memcpy(data, "hello, world!!!!", 16);
+  output.BackUp(10);
+  EXPECT_EQ(output.ByteCount(), 6);
+  ASSERT_TRUE(output.Flush());
+  EXPECT_EQ(ReadTestFile(), "hello,");
+
+  ASSERT_TRUE(output.Next(&data, &size));
+  memcpy(data, " again", 6);
+  output.BackUp(size - 6);
+  EXPECT_TRUE(output.Close());
+  EXPECT_EQ(output.GetErrno(), 0);
+  EXPECT_EQ(ReadTestFile(), "hello, again");
+}
+
+TEST(AsyncFileOutputStreamTest, SerializesMessages) {
+  protobuf_unittest::TestAllTypes message;
+  message.set_optional_string(std::string(100000, 'x'));
+  message.add_repeated_int32(1);
+  int file =
+      open(TestFile().c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+  ASSERT_GE(file, 0);
+  {
+    AsyncFileOutputStream output(file, 4096, 3);
+    ASSERT_TRUE(message.SerializeToZeroCopyStream(&output));
+    ASSERT_TRUE(output.Close());
+  }
+  EXPECT_EQ(ReadTestFile(), message.SerializeAsString());
+}
+
+TEST(AsyncFileOutputStreamTest, ReportsWriteErrors) {
+  int file = open(TestFile().c_str(), O_RDONLY | O_CREAT | O_BINARY, 0777);
+  ASSERT_GE(file, 0);
+  AsyncFileOutputStream output(file, 4);
+  void* data;
+  int size;
+  ASSERT_TRUE(output.Next(&data, &size));
+  EXPECT_FALSE(output.Flush());
+  EXPECT_EQ(output.GetErrno(), EBADF);
+  EXPECT_FALSE(output.Next(&data, &size));
+  close(file);
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
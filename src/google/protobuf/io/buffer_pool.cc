@@ -0,0 +1,148 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/io/buffer_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+namespace {
+
+// The capacity of a default-constructed string, which needs no allocation.
+size_t InlineCapacity() {
+  static const size_t capacity = std::string().capacity();
+  return capacity;
+}
+
+struct ThreadPool {
+  ~ThreadPool() {
+    // Buffers released from destructors of other thread locals, which may
+    // run after this one, are freed rather than pooled.
+    destroyed = true;
+  }
+
+  // Frees buffers, oldest first, until the pool is within its limits.
+  void Trim() {
+    size_t evict = 0;
+    while (evict < buffers.size() &&
+           (buffers.size() - evict > max_buffers || total_bytes > max_bytes)) {
+      total_bytes -= buffers[evict].capacity();
+      ++evict;
+    }
+    buffers.erase(buffers.begin(), buffers.begin() + evict);
+  }
+
+  // Ordered by release, the most recently released last.
+  std::vector<std::string> buffers;
+  size_t total_bytes = 0;
+  size_t max_buffers = 16;
+  size_t max_bytes = size_t{64} << 20;
+
+  static thread_local bool destroyed;
+};
+
+thread_local bool ThreadPool::destroyed = false;
+
+ThreadPool* GetThreadPool() {
+  static thread_local ThreadPool pool;
+  if (ThreadPool::destroyed) return nullptr;
+  return &pool;
+}
+
+}  // namespace
+
+std::string BufferPool::Acquire(size_t min_capacity) {
+  std::string result;
+  ThreadPool* pool = GetThreadPool();
+  if (pool != nullptr && !pool->buffers.empty()) {
+    // Prefer the most recently released buffer, whose memory is most likely
+    // still in cache, among those that are large enough.
+    size_t chosen = pool->buffers.size();
+    size_t largest = pool->buffers.size() - 1;
+    for (size_t i = pool->buffers.size(); i-- > 0;) {
+      size_t capacity = pool->buffers[i].capacity();
+      if (capacity >= min_capacity) {
+        chosen = i;
+        break;
+      }
+      if (capacity > pool->buffers[largest].capacity()) largest = i;
+    }
+    if (chosen == pool->buffers.size()) chosen = largest;
+    result = std::move(pool->buffers[chosen]);
+    pool->buffers.erase(pool->buffers.begin() + chosen);
+    pool->total_bytes -= result.capacity();
+    result.clear();
+  }
+  if (result.capacity() < min_capacity) result.reserve(min_capacity);
+  return result;
+}
+
+void BufferPool::Release(std::string buffer) {
+  if (buffer.capacity() <= InlineCapacity()) return;
+  ThreadPool* pool = GetThreadPool();
+  if (pool == nullptr || pool->max_buffers == 0 ||
+      buffer.capacity() > pool->max_bytes) {
+    return;
+  }
+  pool->total_bytes += buffer.capacity();
+  pool->buffers.push_back(std::move(buffer));
+  pool->Trim();
+}
+
+void BufferPool::SetLimits(size_t max_buffers, size_t max_bytes) {
+  ThreadPool* pool = GetThreadPool();
+  if (pool == nullptr) return;
+  pool->max_buffers = max_buffers;
+  pool->max_bytes = max_bytes;
+  pool->Trim();
+}
+
+void BufferPool::Clear() {
+  ThreadPool* pool = GetThreadPool();
+  if (pool == nullptr) return;
+  pool->buffers.clear();
+  pool->total_bytes = 0;
+}
+
+size_t BufferPool::NumBuffers() {
+  ThreadPool* pool = GetThreadPool();
+  return pool == nullptr ? 0 : pool->buffers.size();
+}
+
+size_t BufferPool::TotalBytes() {
+  ThreadPool* pool = GetThreadPool();
+  return pool == nullptr ? 0 : pool->total_bytes;
+}
+
+PooledOutputStream::PooledOutputStream(size_t size_hint)
+    : buffer_(PooledBuffer::Acquire(size_hint)),
+      output_(buffer_.mutable_string()) {}
+
+PooledBuffer PooledOutputStream::Finish() { return std::move(buffer_); }
+
+bool PooledOutputStream::Next(void** data, int* size) {
+  return output_.Next(data, size);
+}
+
+void PooledOutputStream::BackUp(int count) { output_.BackUp(count); }
+
+int64_t PooledOutputStream::ByteCount() const { return output_.ByteCount(); }
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
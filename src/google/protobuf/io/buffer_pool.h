@@ -0,0 +1,153 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Reuse of serialization buffers.
+//
+// Serializing every response into a fresh std::string allocates, and for
+// large messages touches fresh pages, once per response.  A PooledBuffer
+// takes its storage from a pool owned by the calling thread and gives it back
+// when it is destroyed, so a server that serializes similar responses over
+// and over stops allocating once the pool is warm:
+//
+//   io::PooledBuffer buffer;
+//   if (!response.SerializeToPooledBuffer(&buffer)) ...
+//   Send(buffer.contents());
+//   // The storage returns to the pool when `buffer` goes out of scope.
+
+#ifndef GOOGLE_PROTOBUF_IO_BUFFER_POOL_H__
+#define GOOGLE_PROTOBUF_IO_BUFFER_POOL_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+// The pools of buffers.  Each thread has its own pool, so taking and
+// returning buffers needs no synchronization.  A buffer released on another
+// thread than the one that acquired it joins the releasing thread's pool.
+// The pool of a thread is freed when the thread exits.
+class PROTOBUF_EXPORT BufferPool {
+ public:
+  BufferPool() = delete;
+
+  // Returns an empty string whose capacity, if the calling thread's pool has
+  // a suitable buffer, comes from a released buffer.  The buffer chosen is
+  // the most recently released one with at least `min_capacity` bytes, or
+  // else the largest one, grown to `min_capacity`.
+  static std::string Acquire(size_t min_capacity = 0);
+
+  // Keeps the storage of `buffer` in the calling thread's pool.  Buffers are
+  // freed instead if the pool is full, or if they fit in the string's inline
+  // storage anyway.
+  static void Release(std::string buffer);
+
+  // Limits the pool of the calling thread to `max_buffers` buffers holding
+  // at most `max_bytes` in total.  The defaults are 16 buffers and 64MB.
+  // Buffers beyond the new limits are freed.
+  static void SetLimits(size_t max_buffers, size_t max_bytes);
+
+  // Frees all buffers in the calling thread's pool.
+  static void Clear();
+
+  // The number of buffers, and their total capacity, in the calling thread's
+  // pool.
+  static size_t NumBuffers();
+  static size_t TotalBytes();
+};
+
+// A move-only handle for a buffer taken from the BufferPool.  The storage
+// goes back to the pool when the handle is destroyed or Reset().
+class PROTOBUF_EXPORT PooledBuffer {
+ public:
+  // No storage is taken from the pool until the buffer is written to.
+  PooledBuffer() = default;
+  PooledBuffer(PooledBuffer&& other) noexcept
+      : buffer_(std::move(other.buffer_)) {
+    other.buffer_.clear();
+  }
+  PooledBuffer& operator=(PooledBuffer&& other) noexcept {
+    if (this != &other) {
+      Reset();
+      buffer_ = std::move(other.buffer_);
+      other.buffer_.clear();
+    }
+    return *this;
+  }
+  PooledBuffer(const PooledBuffer&) = delete;
+  PooledBuffer& operator=(const PooledBuffer&) = delete;
+  ~PooledBuffer() { Reset(); }
+
+  // Returns a handle for a buffer with room for at least `min_capacity`
+  // bytes.
+  static PooledBuffer Acquire(size_t min_capacity) {
+    PooledBuffer result;
+    result.buffer_ = BufferPool::Acquire(min_capacity);
+    return result;
+  }
+
+  absl::string_view contents() const { return buffer_; }
+  const char* data() const { return buffer_.data(); }
+  size_t size() const { return buffer_.size(); }
+  bool empty() const { return buffer_.empty(); }
+
+  // The string holding the data, for writing.  Its storage also goes back
+  // to the pool, so it must not be moved out.
+  std::string* mutable_string() { return &buffer_; }
+
+  // Returns the storage to the pool and leaves the buffer empty.
+  void Reset() {
+    if (buffer_.capacity() > 0) BufferPool::Release(std::move(buffer_));
+    buffer_.clear();
+  }
+
+ private:
+  std::string buffer_;
+};
+
+// A ZeroCopyOutputStream which writes into a PooledBuffer, like
+// StringOutputStream writes into a string.
+class PROTOBUF_EXPORT PooledOutputStream final : public ZeroCopyOutputStream {
+ public:
+  // `size_hint` is the expected number of bytes, if known; the buffer taken
+  // from the pool will have room for at least that many.
+  explicit PooledOutputStream(size_t size_hint = 0);
+  PooledOutputStream(const PooledOutputStream&) = delete;
+  PooledOutputStream& operator=(const PooledOutputStream&) = delete;
+  ~PooledOutputStream() override = default;
+
+  // Returns the data written so far.  The stream must not be written to
+  // afterwards.
+  PooledBuffer Finish();
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  PooledBuffer buffer_;
+  StringOutputStream output_;
+};
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_IO_BUFFER_POOL_H__
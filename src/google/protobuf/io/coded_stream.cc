@@ -987,6 +987,37 @@ uint8_t* EpsCopyOutputStream::WriteStringOutline(uint32_t num, absl::string_view
   return WriteRaw(s.data(), size, ptr);
 }
 
+uint8_t* EpsCopyOutputStream::WriteRepeatedStringMaybeAliasedOutline(
+    uint32_t num, const std::string* const* s, int n, uint8_t* ptr) {
+  const uint32_t tag = (num << 3) | 2;
+  const std::ptrdiff_t tag_size = TagSize(tag);
+  int i = 0;
+  while (true) {
+    // Write the run of elements that fits in what is left of the buffer,
+    // including the slop region, with one bounds check per element instead
+    // of one per write.
+    std::ptrdiff_t space = GetSize(ptr);
+    for (; i < n; ++i) {
+      const uint32_t size = s[i]->size();
+      const std::ptrdiff_t element_size =
+          tag_size + CodedOutputStream::VarintSize32(size) + size;
+      if (element_size > space) break;
+      space -= element_size;
+      ptr = UnsafeVarint(tag, ptr);
+      ptr = UnsafeWriteSize(size, ptr);
+      std::memcpy(ptr, s[i]->data(), size);
+      ptr += size;
+    }
+    if (i == n) return ptr;
+    // This element spans buffers.
+    ptr = EnsureSpace(ptr);
+    const uint32_t size = s[i]->size();
+    ptr = WriteLengthDelim(num, size, ptr);
+    ptr = WriteRawMaybeAliased(s[i]->data(), size, ptr);
+    ++i;
+  }
+}
+
 uint8_t* EpsCopyOutputStream::WriteCordOutline(const absl::Cord& c, uint8_t* ptr) {
   uint32_t size = c.size();
   ptr = UnsafeWriteSize(size, ptr);
@@ -16,6 +16,7 @@
 #include <limits.h>
 
 #include <algorithm>
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <vector>
@@ -337,6 +338,48 @@ TEST_2D(CodedStreamTest, WriteVarint64, kVarintCases, kBlockSizes) {
             memcmp(buffer_, kVarintCases_case.bytes, kVarintCases_case.size));
 }
 
+TEST_1D(CodedStreamTest, WriteVarintPacked, kBlockSizes) {
+  std::vector<uint64_t> values;
+  std::string expected_data;
+  for (int i = 0; i < 20; i++) {
+    for (const VarintCase& varint_case : kVarintCases) {
+      values.push_back(varint_case.value);
+      expected_data.append(reinterpret_cast<const char*>(varint_case.bytes),
+                           varint_case.size);
+    }
+  }
+  // Every size from 1 to 10 bytes.
+  for (int shift = 0; shift < 64; shift++) {
+    const uint64_t value = uint64_t{0xfedcba9876543210} >> shift;
+    values.push_back(value);
+    uint8_t bytes[10];
+    expected_data.append(reinterpret_cast<const char*>(bytes),
+                         CodedOutputStream::WriteVarint64ToArray(value, bytes) -
+                             bytes);
+  }
+  const int data_size = static_cast<int>(expected_data.size());
+  uint8_t header[10];
+  uint8_t* header_end =
+      CodedOutputStream::WriteTagToArray((7 << 3) | 2, header);
+  header_end = CodedOutputStream::WriteVarint32ToArray(data_size, header_end);
+  const std::string expected =
+      std::string(reinterpret_cast<const char*>(header), header_end - header) +
+      expected_data;
+
+  std::string buffer(expected.size() + 100, '\0');
+  ArrayOutputStream output(&buffer[0], static_cast<int>(buffer.size()),
+                           kBlockSizes_case);
+  {
+    CodedOutputStream coded_output(&output);
+    coded_output.SetCur(coded_output.EpsCopy()->WriteUInt64Packed(
+        7, values, data_size, coded_output.Cur()));
+    EXPECT_FALSE(coded_output.HadError());
+    EXPECT_EQ(expected.size(), coded_output.ByteCount());
+  }
+  EXPECT_EQ(expected.size(), output.ByteCount());
+  EXPECT_EQ(buffer.substr(0, expected.size()), expected);
+}
+
 // This test causes gcc 3.3.5 (and earlier?) to give the cryptic error:
 //   "sorry, unimplemented: `method_call_expr' not supported by dump_expr"
 #if !defined(__GNUC__) || __GNUC__ > 3 || (__GNUC__ == 3 && __GNUC_MINOR__ > 3)
@@ -1063,6 +1106,102 @@ TEST_F(CodedStreamTest, WriteLargeCord) {
   EXPECT_EQ(large_cord, output_cord);
 }
 
+// The parts of RepeatedPtrField<std::string> used by
+// WriteRepeatedStringMaybeAliased().
+class StringList {
+ public:
+  explicit StringList(const std::vector<std::string>& strings) {
+    for (const std::string& s : strings) pointers_.push_back(&s);
+  }
+  bool empty() const { return pointers_.empty(); }
+  int size() const { return static_cast<int>(pointers_.size()); }
+  const std::string* const* data() const { return pointers_.data(); }
+
+ private:
+  std::vector<const std::string*> pointers_;
+};
+
+// The encoding of `strings` as a repeated field `num`, one element at a time.
+std::string EncodeRepeatedString(uint32_t num,
+                                 const std::vector<std::string>& strings) {
+  std::string expected;
+  {
+    StringOutputStream output(&expected);
+    CodedOutputStream coded_output(&output);
+    for (const std::string& s : strings) {
+      coded_output.WriteTag((num << 3) | 2);
+      coded_output.WriteVarint32(static_cast<uint32_t>(s.size()));
+      coded_output.WriteString(s);
+    }
+  }
+  return expected;
+}
+
+const uint32_t kRepeatedStringFieldNumbers[] = {1, 16, (1 << 28) - 1};
+
+TEST_2D(CodedStreamTest, WriteRepeatedString, kRepeatedStringFieldNumbers,
+        kBlockSizes) {
+  // Sizes on both sides of the one-byte length limit and of the slop region.
+  std::vector<std::string> strings;
+  for (int size : {0, 1, 5, 15, 16, 17, 100, 127, 128, 300, 5000, 3, 0, 20}) {
+    strings.push_back(std::string(size, static_cast<char>('a' + size % 26)));
+  }
+  const std::string expected =
+      EncodeRepeatedString(kRepeatedStringFieldNumbers_case, strings);
+
+  ArrayOutputStream output(buffer_, sizeof(buffer_), kBlockSizes_case);
+  {
+    CodedOutputStream coded_output(&output);
+    coded_output.SetCur(coded_output.EpsCopy()->WriteRepeatedStringMaybeAliased(
+        kRepeatedStringFieldNumbers_case, StringList(strings),
+        coded_output.Cur()));
+    EXPECT_FALSE(coded_output.HadError());
+    EXPECT_EQ(expected.size(), coded_output.ByteCount());
+  }
+  EXPECT_EQ(expected.size(), output.ByteCount());
+  EXPECT_EQ(absl::string_view(reinterpret_cast<const char*>(buffer_),
+                              expected.size()),
+            expected);
+}
+
+TEST_F(CodedStreamTest, WriteRepeatedStringToArray) {
+  std::vector<std::string> strings;
+  for (int i = 0; i < 100; ++i) strings.push_back(std::string(i, 'x'));
+  const std::string expected = EncodeRepeatedString(3, strings);
+
+  std::string buffer(expected.size(), '\0');
+  uint8_t* start = reinterpret_cast<uint8_t*>(&buffer[0]);
+  EpsCopyOutputStream stream(start, static_cast<int>(buffer.size()),
+                             /*deterministic=*/false);
+  uint8_t* end =
+      stream.WriteRepeatedStringMaybeAliased(3, StringList(strings), start);
+  EXPECT_EQ(end - start, static_cast<std::ptrdiff_t>(expected.size()));
+  EXPECT_EQ(buffer, expected);
+}
+
+TEST_F(CodedStreamTest, WriteRepeatedStringAliasesLongStrings) {
+  const std::vector<std::string> strings = {"short", std::string(10000, 'x'),
+                                            "also short"};
+
+  CordOutputStream output;
+  output.EnableAliasing(true);
+  {
+    CodedOutputStream coded_output(&output);
+    coded_output.EnableAliasing(true);
+    coded_output.SetCur(coded_output.EpsCopy()->WriteRepeatedStringMaybeAliased(
+        1, StringList(strings), coded_output.Cur()));
+    EXPECT_FALSE(coded_output.HadError());
+  }
+  absl::Cord cord = output.Consume();
+  EXPECT_EQ(cord, EncodeRepeatedString(1, strings));
+
+  bool aliased = false;
+  for (absl::string_view chunk : cord.Chunks()) {
+    aliased |= chunk.data() == strings[1].data();
+  }
+  EXPECT_TRUE(aliased);
+}
+
 TEST_F(CodedStreamTest, Trim) {
   CordOutputStream cord_output;
   CodedOutputStream coded_output(&cord_output);
@@ -14,9 +14,22 @@
 #if HAVE_ZLIB
 #include "google/protobuf/io/gzip_stream.h"
 
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
 #include "google/protobuf/stubs/common.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/port.h"
 
 namespace google {
@@ -24,6 +37,9 @@ namespace protobuf {
 namespace io {
 
 static const int kDefaultBufferSize = 65536;
+static const int kDefaultParallelBlockSize = 128 * 1024;
+// The deflate window, and how much input primes each parallel block.
+static const int kWindowSize = 32 * 1024;
 
 GzipInputStream::GzipInputStream(ZeroCopyInputStream* sub_stream, Format format,
                                  int buffer_size)
@@ -179,7 +195,403 @@ GzipOutputStream::Options::Options()
     : format(GZIP),
       buffer_size(kDefaultBufferSize),
       compression_level(Z_DEFAULT_COMPRESSION),
-      compression_strategy(Z_DEFAULT_STRATEGY) {}
+      compression_strategy(Z_DEFAULT_STRATEGY),
+      num_threads(0),
+      parallel_block_size(kDefaultParallelBlockSize) {}
+
+// Compresses blocks of input concurrently, like pigz.  Each block becomes a
+// raw deflate stream primed with the preceding 32kB of input, ending with a
+// sync flush or, for the last block, the final deflate block.  The blocks
+// therefore concatenate into a single deflate stream, which is wrapped in the
+// gzip or zlib header and trailer here.
+class GzipOutputStream::ParallelDeflater {
+ public:
+  ParallelDeflater(ZeroCopyOutputStream* sub_stream, const Options& options);
+  ParallelDeflater(const ParallelDeflater&) = delete;
+  ParallelDeflater& operator=(const ParallelDeflater&) = delete;
+  ~ParallelDeflater();
+
+  bool Next(void** data, int* size);
+  void BackUp(int count);
+  int64_t ByteCount() const { return byte_count_ + current_used_; }
+  bool Flush();
+  bool Close();
+  int error() const { return error_; }
+
+ private:
+  struct Block {
+    z_stream zcontext;
+    std::unique_ptr<char[]> input;
+    size_t input_size;
+    // The input preceding this block, at most kWindowSize bytes.
+    std::string dictionary;
+    int flush;
+    std::string output;
+    uLong check;
+    int error;
+    // Set by the thread compressing the block; guarded by mutex_.
+    bool done;
+  };
+
+  enum Wait { kNoWait, kWaitOne, kWaitAll };
+
+  // Returns a block for new input, first writing out compressed blocks if
+  // too many are in flight.
+  bool NewBlock();
+  // Queues current_ for compression.
+  void Submit(int flush);
+  // Writes compressed blocks in order, waiting for them as requested.
+  bool WriteBlocks(Wait wait);
+  bool WriteToSubStream(const void* data, size_t size);
+  void WriteHeader();
+  void Compress(Block* block) const;
+  void RunPending();
+  void WorkerLoop();
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool Idle() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  ZeroCopyOutputStream* const sub_stream_;
+  const Format format_;
+  const int compression_level_;
+  const int compression_strategy_;
+  const size_t block_size_;
+  const size_t max_blocks_;
+  const std::function<void(std::function<void()>)> executor_;
+
+  int error_ = Z_OK;
+  bool closed_ = false;
+  bool header_written_ = false;
+  int64_t byte_count_ = 0;
+  uLong check_;
+  std::string window_;
+
+  // The block receiving input, and how much of it is used.
+  Block* current_ = nullptr;
+  size_t current_used_ = 0;
+  std::vector<std::unique_ptr<Block>> blocks_;
+  std::vector<Block*> free_blocks_;
+  // Submitted blocks, in stream order.
+  std::deque<Block*> in_order_;
+
+  absl::Mutex mutex_;
+  std::deque<Block*> pending_ ABSL_GUARDED_BY(mutex_);
+  // Tasks passed to executor_ that have not finished.
+  int scheduled_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool stop_ ABSL_GUARDED_BY(mutex_) = false;
+  std::vector<std::thread> threads_;
+};
+
+GzipOutputStream::ParallelDeflater::ParallelDeflater(
+    ZeroCopyOutputStream* sub_stream, const Options& options)
+    : sub_stream_(sub_stream),
+      format_(options.format),
+      compression_level_(options.compression_level),
+      compression_strategy_(options.compression_strategy),
+      block_size_(options.parallel_block_size),
+      max_blocks_(2 * options.num_threads),
+      executor_(options.executor) {
+  ABSL_CHECK_GT(options.parallel_block_size, 0);
+  check_ = format_ == ZLIB ? adler32(0L, Z_NULL, 0) : crc32(0L, Z_NULL, 0);
+  if (executor_ == nullptr) {
+    for (int i = 0; i < options.num_threads; ++i) {
+      threads_.emplace_back([this] { WorkerLoop(); });
+    }
+  }
+}
+
+GzipOutputStream::ParallelDeflater::~ParallelDeflater() {
+  {
+    absl::MutexLock lock(&mutex_);
+    // Whatever was not written out is dropped.
+    pending_.clear();
+    stop_ = true;
+    mutex_.Await(absl::Condition(this, &ParallelDeflater::Idle));
+  }
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+  for (const std::unique_ptr<Block>& block : blocks_) {
+    deflateEnd(&block->zcontext);
+  }
+}
+
+bool GzipOutputStream::ParallelDeflater::HasWork() const {
+  return !pending_.empty() || stop_;
+}
+
+bool GzipOutputStream::ParallelDeflater::Idle() const {
+  return scheduled_ == 0;
+}
+
+void GzipOutputStream::ParallelDeflater::Compress(Block* block) const {
+  z_stream* zcontext = &block->zcontext;
+  int error = deflateReset(zcontext);
+  if (error == Z_OK && !block->dictionary.empty()) {
+    error = deflateSetDictionary(
+        zcontext, reinterpret_cast<const Bytef*>(block->dictionary.data()),
+        block->dictionary.size());
+  }
+  // Room for the sync flush marker too.
+  block->output.resize(deflateBound(zcontext, block->input_size) + 16);
+  zcontext->next_in = reinterpret_cast<Bytef*>(block->input.get());
+  zcontext->avail_in = block->input_size;
+  zcontext->next_out = reinterpret_cast<Bytef*>(&block->output[0]);
+  zcontext->avail_out = block->output.size();
+  while (error == Z_OK) {
+    error = deflate(zcontext, block->flush);
+    if (block->flush == Z_FINISH ? error == Z_STREAM_END
+                                 : error == Z_OK && zcontext->avail_out != 0) {
+      error = Z_OK;
+      break;
+    }
+    if (error == Z_OK || error == Z_BUF_ERROR) {
+      // Out of space; deflate continues where it stopped.
+      size_t used = zcontext->total_out;
+      block->output.resize(2 * block->output.size());
+      zcontext->next_out = reinterpret_cast<Bytef*>(&block->output[used]);
+      zcontext->avail_out = block->output.size() - used;
+      error = Z_OK;
+    }
+  }
+  block->output.resize(zcontext->total_out);
+  const Bytef* input = reinterpret_cast<const Bytef*>(block->input.get());
+  block->check = format_ == ZLIB
+                     ? adler32(adler32(0L, Z_NULL, 0), input, block->input_size)
+                     : crc32(crc32(0L, Z_NULL, 0), input, block->input_size);
+  block->error = error;
+}
+
+void GzipOutputStream::ParallelDeflater::RunPending() {
+  Block* block = nullptr;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (!pending_.empty()) {
+      block = pending_.front();
+      pending_.pop_front();
+    }
+  }
+  if (block != nullptr) {
+    Compress(block);
+  }
+  absl::MutexLock lock(&mutex_);
+  if (block != nullptr) {
+    block->done = true;
+  }
+  --scheduled_;
+}
+
+void GzipOutputStream::ParallelDeflater::WorkerLoop() {
+  absl::MutexLock lock(&mutex_);
+  while (true) {
+    mutex_.Await(absl::Condition(this, &ParallelDeflater::HasWork));
+    if (pending_.empty()) return;
+    Block* block = pending_.front();
+    pending_.pop_front();
+    mutex_.Unlock();
+    Compress(block);
+    mutex_.Lock();
+    block->done = true;
+  }
+}
+
+bool GzipOutputStream::ParallelDeflater::NewBlock() {
+  if (in_order_.size() >= max_blocks_ && !WriteBlocks(kWaitOne)) {
+    return false;
+  }
+  if (free_blocks_.empty()) {
+    auto block = std::make_unique<Block>();
+    memset(&block->zcontext, 0, sizeof(block->zcontext));
+    int error = deflateInit2(&block->zcontext, compression_level_, Z_DEFLATED,
+                             /* windowBits (raw deflate) */ -15,
+                             /* memLevel (default) */ 8, compression_strategy_);
+    if (error != Z_OK) {
+      error_ = error;
+      return false;
+    }
+    block->input.reset(new char[block_size_]);
+    free_blocks_.push_back(block.get());
+    blocks_.push_back(std::move(block));
+  }
+  current_ = free_blocks_.back();
+  free_blocks_.pop_back();
+  current_used_ = 0;
+  return true;
+}
+
+void GzipOutputStream::ParallelDeflater::Submit(int flush) {
+  Block* block = current_;
+  block->input_size = current_used_;
+  block->flush = flush;
+  block->done = false;
+  block->dictionary = window_;
+  if (current_used_ >= static_cast<size_t>(kWindowSize)) {
+    window_.assign(block->input.get() + current_used_ - kWindowSize,
+                   kWindowSize);
+  } else {
+    window_.append(block->input.get(), current_used_);
+    if (window_.size() > static_cast<size_t>(kWindowSize)) {
+      window_.erase(0, window_.size() - kWindowSize);
+    }
+  }
+  byte_count_ += current_used_;
+  current_ = nullptr;
+  current_used_ = 0;
+
+  in_order_.push_back(block);
+  {
+    absl::MutexLock lock(&mutex_);
+    pending_.push_back(block);
+    if (executor_ != nullptr) ++scheduled_;
+  }
+  if (executor_ != nullptr) {
+    executor_([this] { RunPending(); });
+  }
+}
+
+bool GzipOutputStream::ParallelDeflater::WriteToSubStream(const void* data,
+                                                          size_t size) {
+  const char* in = static_cast<const char*>(data);
+  while (size > 0) {
+    void* out;
+    int out_size;
+    if (!sub_stream_->Next(&out, &out_size)) {
+      error_ = Z_BUF_ERROR;
+      return false;
+    }
+    size_t n = std::min(size, static_cast<size_t>(out_size));
+    memcpy(out, in, n);
+    in += n;
+    size -= n;
+    if (n < static_cast<size_t>(out_size)) {
+      sub_stream_->BackUp(out_size - static_cast<int>(n));
+    }
+  }
+  return true;
+}
+
+void GzipOutputStream::ParallelDeflater::WriteHeader() {
+  header_written_ = true;
+  if (format_ == ZLIB) {
+    // CMF and FLG as deflateInit2() writes them; see RFC 1950.
+    int level = compression_level_ == Z_DEFAULT_COMPRESSION
+                    ? 6
+                    : compression_level_;
+    int level_flags;
+    if (compression_strategy_ >= Z_HUFFMAN_ONLY || level < 2) {
+      level_flags = 0;
+    } else if (level < 6) {
+      level_flags = 1;
+    } else if (level == 6) {
+      level_flags = 2;
+    } else {
+      level_flags = 3;
+    }
+    int header = (0x78 << 8) | (level_flags << 6);
+    header += 31 - header % 31;
+    const unsigned char bytes[] = {static_cast<unsigned char>(header >> 8),
+                                   static_cast<unsigned char>(header)};
+    WriteToSubStream(bytes, sizeof(bytes));
+  } else {
+    // No file name or modification time, unknown operating system; see
+    // RFC 1952.
+    const unsigned char xfl = compression_level_ == 9   ? 2
+                              : compression_level_ == 1 ? 4
+                                                        : 0;
+    const unsigned char bytes[] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, xfl, 255};
+    WriteToSubStream(bytes, sizeof(bytes));
+  }
+}
+
+bool GzipOutputStream::ParallelDeflater::WriteBlocks(Wait wait) {
+  while (!in_order_.empty()) {
+    Block* block = in_order_.front();
+    {
+      absl::MutexLock lock(&mutex_);
+      if (wait == kNoWait) {
+        if (!block->done) break;
+      } else {
+        mutex_.Await(absl::Condition(&block->done));
+      }
+    }
+    if (wait == kWaitOne) wait = kNoWait;
+    in_order_.pop_front();
+    free_blocks_.push_back(block);
+    if (error_ != Z_OK) continue;
+    if (block->error != Z_OK) {
+      error_ = block->error;
+      continue;
+    }
+    if (!header_written_) WriteHeader();
+    check_ = format_ == ZLIB
+                 ? adler32_combine(check_, block->check, block->input_size)
+                 : crc32_combine(check_, block->check, block->input_size);
+    WriteToSubStream(block->output.data(), block->output.size());
+  }
+  return error_ == Z_OK;
+}
+
+bool GzipOutputStream::ParallelDeflater::Next(void** data, int* size) {
+  if (closed_ || error_ != Z_OK) {
+    return false;
+  }
+  if (current_ != nullptr && current_used_ == block_size_) {
+    Submit(Z_SYNC_FLUSH);
+  }
+  if (current_ == nullptr && !(WriteBlocks(kNoWait) && NewBlock())) {
+    return false;
+  }
+  *data = current_->input.get() + current_used_;
+  *size = static_cast<int>(block_size_ - current_used_);
+  current_used_ = block_size_;
+  return true;
+}
+
+void GzipOutputStream::ParallelDeflater::BackUp(int count) {
+  ABSL_CHECK(current_ != nullptr);
+  ABSL_CHECK_GE(count, 0);
+  ABSL_CHECK_LE(static_cast<size_t>(count), current_used_);
+  current_used_ -= count;
+}
+
+bool GzipOutputStream::ParallelDeflater::Flush() {
+  if (closed_ || error_ != Z_OK) {
+    return false;
+  }
+  if (current_ != nullptr && current_used_ != 0) {
+    Submit(Z_SYNC_FLUSH);
+  }
+  return WriteBlocks(kWaitAll);
+}
+
+bool GzipOutputStream::ParallelDeflater::Close() {
+  if (closed_) {
+    return false;
+  }
+  closed_ = true;
+  if (error_ != Z_OK || (current_ == nullptr && !NewBlock())) {
+    return false;
+  }
+  // The last block ends the deflate stream, even if it is empty.
+  Submit(Z_FINISH);
+  if (!WriteBlocks(kWaitAll)) {
+    return false;
+  }
+  unsigned char trailer[8];
+  size_t trailer_size;
+  if (format_ == ZLIB) {
+    for (int i = 0; i < 4; ++i) {
+      trailer[i] = static_cast<unsigned char>(check_ >> (24 - 8 * i));
+    }
+    trailer_size = 4;
+  } else {
+    for (int i = 0; i < 4; ++i) {
+      trailer[i] = static_cast<unsigned char>(check_ >> (8 * i));
+      trailer[4 + i] = static_cast<unsigned char>(byte_count_ >> (8 * i));
+    }
+    trailer_size = 8;
+  }
+  return WriteToSubStream(trailer, trailer_size);
+}
 
 GzipOutputStream::GzipOutputStream(ZeroCopyOutputStream* sub_stream) {
   Init(sub_stream, Options());
@@ -196,10 +608,6 @@ void GzipOutputStream::Init(ZeroCopyOutputStream* sub_stream,
   sub_data_ = NULL;
   sub_data_size_ = 0;
 
-  input_buffer_length_ = options.buffer_size;
-  input_buffer_ = operator new(input_buffer_length_);
-  ABSL_CHECK(input_buffer_ != NULL);
-
   zcontext_.zalloc = Z_NULL;
   zcontext_.zfree = Z_NULL;
   zcontext_.opaque = Z_NULL;
@@ -210,6 +618,19 @@ void GzipOutputStream::Init(ZeroCopyOutputStream* sub_stream,
   zcontext_.avail_in = 0;
   zcontext_.total_in = 0;
   zcontext_.msg = NULL;
+
+  if (options.num_threads > 0) {
+    input_buffer_length_ = 0;
+    input_buffer_ = NULL;
+    zerror_ = Z_OK;
+    parallel_ = std::make_unique<ParallelDeflater>(sub_stream, options);
+    return;
+  }
+
+  input_buffer_length_ = options.buffer_size;
+  input_buffer_ = operator new(input_buffer_length_);
+  ABSL_CHECK(input_buffer_ != NULL);
+
   // default to GZIP format
   int windowBitsFormat = 16;
   if (options.format == ZLIB) {
@@ -255,6 +676,11 @@ int GzipOutputStream::Deflate(int flush) {
 
 // implements ZeroCopyOutputStream ---------------------------------
 bool GzipOutputStream::Next(void** data, int* size) {
+  if (parallel_ != NULL) {
+    bool ok = parallel_->Next(data, size);
+    zerror_ = parallel_->error();
+    return ok;
+  }
   if ((zerror_ != Z_OK) && (zerror_ != Z_BUF_ERROR)) {
     return false;
   }
@@ -277,14 +703,26 @@ bool GzipOutputStream::Next(void** data, int* size) {
   return true;
 }
 void GzipOutputStream::BackUp(int count) {
+  if (parallel_ != NULL) {
+    parallel_->BackUp(count);
+    return;
+  }
   ABSL_CHECK_GE(zcontext_.avail_in, static_cast<uInt>(count));
   zcontext_.avail_in -= count;
 }
 int64_t GzipOutputStream::ByteCount() const {
+  if (parallel_ != NULL) {
+    return parallel_->ByteCount();
+  }
   return zcontext_.total_in + zcontext_.avail_in;
 }
 
 bool GzipOutputStream::Flush() {
+  if (parallel_ != NULL) {
+    bool ok = parallel_->Flush();
+    zerror_ = parallel_->error();
+    return ok;
+  }
   zerror_ = Deflate(Z_FULL_FLUSH);
   // Return true if the flush succeeded or if it was a no-op.
   return (zerror_ == Z_OK) ||
@@ -293,6 +731,11 @@ bool GzipOutputStream::Flush() {
 }
 
 bool GzipOutputStream::Close() {
+  if (parallel_ != NULL) {
+    bool ok = parallel_->Close();
+    zerror_ = ok ? Z_STREAM_END : parallel_->error();
+    return ok;
+  }
   if ((zerror_ != Z_OK) && (zerror_ != Z_BUF_ERROR)) {
     return false;
   }
@@ -20,6 +20,9 @@
 #ifndef GOOGLE_PROTOBUF_IO_GZIP_STREAM_H__
 #define GOOGLE_PROTOBUF_IO_GZIP_STREAM_H__
 
+#include <functional>
+#include <memory>
+
 #include "google/protobuf/stubs/common.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/port.h"
@@ -108,6 +111,23 @@ class PROTOBUF_EXPORT GzipOutputStream final : public ZeroCopyOutputStream {
     // zlib.h for definitions of these constants.
     int compression_strategy;
 
+    // If positive, the input is split into blocks of parallel_block_size
+    // bytes that are compressed concurrently on this many threads, like
+    // pigz does.  Each block is primed with the last 32kB of input before
+    // it, so the output is nearly as small as with serial compression, and
+    // it is still a single gzip or zlib stream that GzipInputStream decodes
+    // as usual.  Defaults to 0, which compresses on the calling thread.
+    int num_threads;
+
+    // The size of the blocks compressed in parallel.  Defaults to 128kB.
+    int parallel_block_size;
+
+    // If set, runs the compression of blocks instead of threads owned by the
+    // stream, and num_threads only limits how many blocks are in flight.  Each
+    // task passed to it must eventually run; the stream waits for them when
+    // destroyed.
+    std::function<void(std::function<void()>)> executor;
+
     Options();  // Initializes with default values.
   };
 
@@ -129,6 +149,7 @@ class PROTOBUF_EXPORT GzipOutputStream final : public ZeroCopyOutputStream {
   // It is the caller's responsibility to flush the underlying stream if
   // necessary.
   // Compression may be less efficient stopping and starting around flushes.
+  // In parallel mode, this waits for all blocks written so far.
   // Returns true if no error.
   //
   // Please ensure that block size is > 6. Here is an excerpt from the zlib
@@ -151,6 +172,8 @@ class PROTOBUF_EXPORT GzipOutputStream final : public ZeroCopyOutputStream {
   int64_t ByteCount() const override;
 
  private:
+  class ParallelDeflater;
+
   ZeroCopyOutputStream* sub_stream_;
   // Result from calling Next() on sub_stream_
   void* sub_data_;
@@ -161,6 +184,9 @@ class PROTOBUF_EXPORT GzipOutputStream final : public ZeroCopyOutputStream {
   void* input_buffer_;
   size_t input_buffer_length_;
 
+  // Set when compressing in parallel, which bypasses zcontext_.
+  std::unique_ptr<ParallelDeflater> parallel_;
+
   // Shared constructor code.
   void Init(ZeroCopyOutputStream* sub_stream, const Options& options);
 
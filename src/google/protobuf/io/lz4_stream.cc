@@ -0,0 +1,375 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file contains the implementation of classes Lz4InputStream and
+// Lz4OutputStream.
+
+#if HAVE_LZ4
+#include "google/protobuf/io/lz4_stream.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/log/absl_check.h"
+#include "lz4.h"
+#include "lz4frame.h"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+static const int kDefaultBufferSize = 65536;
+static const char kTruncatedFrame[] = "Truncated lz4 frame";
+static const char kSubStreamFailed[] = "Underlying stream failed";
+
+// Frame dictionaries are part of the stable lz4frame.h API since 1.10.0.
+#if LZ4_VERSION_NUMBER < 11000
+static const char kNoDictionarySupport[] =
+    "lz4 dictionaries require liblz4 1.10 or later";
+#endif
+
+Lz4InputStream::Options::Options() : buffer_size(kDefaultBufferSize) {}
+
+Lz4InputStream::Lz4InputStream(ZeroCopyInputStream* sub_stream,
+                               int buffer_size) {
+  Options options;
+  if (buffer_size != -1) {
+    options.buffer_size = buffer_size;
+  }
+  Init(sub_stream, options);
+}
+
+Lz4InputStream::Lz4InputStream(ZeroCopyInputStream* sub_stream,
+                               const Options& options) {
+  Init(sub_stream, options);
+}
+
+void Lz4InputStream::Init(ZeroCopyInputStream* sub_stream,
+                          const Options& options) {
+  sub_stream_ = sub_stream;
+  dictionary_ = std::string(options.dictionary);
+  error_message_ = nullptr;
+  input_ = nullptr;
+  input_length_ = 0;
+  ABSL_CHECK_GT(options.buffer_size, 0);
+  output_buffer_length_ = options.buffer_size;
+  output_buffer_ = new char[output_buffer_length_];
+  output_end_ = 0;
+  output_position_ = 0;
+  output_pending_ = false;
+  frame_done_ = true;
+  byte_count_ = 0;
+
+  size_t result = LZ4F_createDecompressionContext(&dctx_, LZ4F_VERSION);
+  if (LZ4F_isError(result)) {
+    dctx_ = nullptr;
+    error_message_ = LZ4F_getErrorName(result);
+  }
+#if LZ4_VERSION_NUMBER < 11000
+  if (!dictionary_.empty()) {
+    error_message_ = kNoDictionarySupport;
+  }
+#endif
+}
+
+Lz4InputStream::~Lz4InputStream() {
+  LZ4F_freeDecompressionContext(dctx_);
+  delete[] output_buffer_;
+}
+
+bool Lz4InputStream::Decompress() {
+  output_end_ = 0;
+  output_position_ = 0;
+  while (output_end_ == 0) {
+    // lz4 may still hold decompressed data after filling the buffer, so only
+    // read more input once it has room to spare.
+    if (input_length_ == 0 && !output_pending_) {
+      const void* in;
+      int in_size;
+      if (!sub_stream_->Next(&in, &in_size)) {
+        if (!frame_done_) {
+          error_message_ = kTruncatedFrame;
+        }
+        return false;
+      }
+      input_ = static_cast<const char*>(in);
+      input_length_ = in_size;
+      if (in_size == 0) continue;
+    }
+    size_t output_size = output_buffer_length_;
+    size_t input_size = input_length_;
+#if LZ4_VERSION_NUMBER >= 11000
+    size_t result =
+        dictionary_.empty()
+            ? LZ4F_decompress(dctx_, output_buffer_, &output_size, input_,
+                              &input_size, nullptr)
+            : LZ4F_decompress_usingDict(dctx_, output_buffer_, &output_size,
+                                        input_, &input_size,
+                                        dictionary_.data(),
+                                        dictionary_.size(), nullptr);
+#else
+    size_t result = LZ4F_decompress(dctx_, output_buffer_, &output_size,
+                                    input_, &input_size, nullptr);
+#endif
+    if (LZ4F_isError(result)) {
+      error_message_ = LZ4F_getErrorName(result);
+      return false;
+    }
+    input_ += input_size;
+    input_length_ -= input_size;
+    // The next frame, if any, starts automatically.  Without input, lz4
+    // reports what the next frame needs even if there is none.
+    if (output_size != 0 || input_size != 0) {
+      frame_done_ = result == 0;
+    }
+    output_pending_ = output_size == output_buffer_length_;
+    output_end_ = output_size;
+  }
+  byte_count_ += output_end_;
+  return true;
+}
+
+// implements ZeroCopyInputStream ----------------------------------
+bool Lz4InputStream::Next(const void** data, int* size) {
+  if (output_position_ == output_end_) {
+    if (error_message_ != nullptr || !Decompress()) {
+      return false;
+    }
+  }
+  *data = output_buffer_ + output_position_;
+  *size = static_cast<int>(output_end_ - output_position_);
+  output_position_ = output_end_;
+  return true;
+}
+
+void Lz4InputStream::BackUp(int count) {
+  ABSL_CHECK_GE(count, 0);
+  ABSL_CHECK_LE(static_cast<size_t>(count), output_position_);
+  output_position_ -= count;
+}
+
+bool Lz4InputStream::Skip(int count) {
+  const void* data;
+  int size = 0;
+  bool ok = Next(&data, &size);
+  while (ok && (size < count)) {
+    count -= size;
+    ok = Next(&data, &size);
+  }
+  if (size > count) {
+    BackUp(size - count);
+  }
+  return ok;
+}
+
+int64_t Lz4InputStream::ByteCount() const {
+  return byte_count_ - static_cast<int64_t>(output_end_ - output_position_);
+}
+
+// =========================================================================
+
+Lz4OutputStream::Options::Options()
+    : buffer_size(kDefaultBufferSize), compression_level(0), checksum(false) {}
+
+Lz4OutputStream::Lz4OutputStream(ZeroCopyOutputStream* sub_stream) {
+  Init(sub_stream, Options());
+}
+
+Lz4OutputStream::Lz4OutputStream(ZeroCopyOutputStream* sub_stream,
+                                 const Options& options) {
+  Init(sub_stream, options);
+}
+
+void Lz4OutputStream::Init(ZeroCopyOutputStream* sub_stream,
+                           const Options& options) {
+  sub_stream_ = sub_stream;
+  error_message_ = nullptr;
+  closed_ = false;
+  ABSL_CHECK_GT(options.buffer_size, 0);
+  input_buffer_length_ = options.buffer_size;
+  input_buffer_ = new char[input_buffer_length_];
+  input_length_ = 0;
+  byte_count_ = 0;
+  frame_open_ = false;
+  wrote_frame_ = false;
+
+  memset(&preferences_, 0, sizeof(preferences_));
+  preferences_.compressionLevel = options.compression_level;
+  preferences_.frameInfo.contentChecksumFlag =
+      options.checksum ? LZ4F_contentChecksumEnabled : LZ4F_noContentChecksum;
+  // Enough for any single call, including the frame header and end mark.
+  output_buffer_length_ =
+      std::max<size_t>(LZ4F_compressBound(input_buffer_length_, &preferences_),
+                       LZ4F_HEADER_SIZE_MAX);
+  output_buffer_ = new char[output_buffer_length_];
+
+  dictionary_ = std::string(options.dictionary);
+  size_t result = LZ4F_createCompressionContext(&cctx_, LZ4F_VERSION);
+  if (LZ4F_isError(result)) {
+    cctx_ = nullptr;
+    error_message_ = LZ4F_getErrorName(result);
+  }
+#if LZ4_VERSION_NUMBER < 11000
+  if (!dictionary_.empty()) {
+    error_message_ = kNoDictionarySupport;
+  }
+#endif
+}
+
+Lz4OutputStream::~Lz4OutputStream() {
+  Close();
+  LZ4F_freeCompressionContext(cctx_);
+  delete[] output_buffer_;
+  delete[] input_buffer_;
+}
+
+// private
+bool Lz4OutputStream::Write(size_t result) {
+  if (LZ4F_isError(result)) {
+    error_message_ = LZ4F_getErrorName(result);
+    return false;
+  }
+  const char* data = output_buffer_;
+  size_t remaining = result;
+  while (remaining > 0) {
+    void* out;
+    int out_size;
+    if (!sub_stream_->Next(&out, &out_size)) {
+      error_message_ = kSubStreamFailed;
+      return false;
+    }
+    size_t n = std::min(remaining, static_cast<size_t>(out_size));
+    memcpy(out, data, n);
+    data += n;
+    remaining -= n;
+    if (n < static_cast<size_t>(out_size)) {
+      sub_stream_->BackUp(out_size - static_cast<int>(n));
+    }
+  }
+  return true;
+}
+
+bool Lz4OutputStream::BeginFrame() {
+  if (frame_open_) {
+    return true;
+  }
+#if LZ4_VERSION_NUMBER >= 11000
+  size_t result =
+      dictionary_.empty()
+          ? LZ4F_compressBegin(cctx_, output_buffer_, output_buffer_length_,
+                               &preferences_)
+          : LZ4F_compressBegin_usingDict(
+                cctx_, output_buffer_, output_buffer_length_,
+                dictionary_.data(), dictionary_.size(), &preferences_);
+#else
+  size_t result = LZ4F_compressBegin(cctx_, output_buffer_,
+                                     output_buffer_length_, &preferences_);
+#endif
+  if (!Write(result)) {
+    return false;
+  }
+  frame_open_ = true;
+  return true;
+}
+
+bool Lz4OutputStream::Compress() {
+  if (input_length_ == 0) {
+    return true;
+  }
+  if (!BeginFrame()) {
+    return false;
+  }
+  size_t result =
+      LZ4F_compressUpdate(cctx_, output_buffer_, output_buffer_length_,
+                          input_buffer_, input_length_, nullptr);
+  byte_count_ += input_length_;
+  input_length_ = 0;
+  return Write(result);
+}
+
+bool Lz4OutputStream::FinishFrame() {
+  if (!Compress() || !BeginFrame() ||
+      !Write(LZ4F_compressEnd(cctx_, output_buffer_, output_buffer_length_,
+                              nullptr))) {
+    return false;
+  }
+  frame_open_ = false;
+  wrote_frame_ = true;
+  return true;
+}
+
+// implements ZeroCopyOutputStream ---------------------------------
+bool Lz4OutputStream::Next(void** data, int* size) {
+  if (closed_ || error_message_ != nullptr) {
+    return false;
+  }
+  if (!Compress()) {
+    return false;
+  }
+  input_length_ = input_buffer_length_;
+  *data = input_buffer_;
+  *size = static_cast<int>(input_buffer_length_);
+  return true;
+}
+
+void Lz4OutputStream::BackUp(int count) {
+  ABSL_CHECK_GE(count, 0);
+  ABSL_CHECK_LE(static_cast<size_t>(count), input_length_);
+  input_length_ -= count;
+}
+
+int64_t Lz4OutputStream::ByteCount() const {
+  return byte_count_ + static_cast<int64_t>(input_length_);
+}
+
+bool Lz4OutputStream::Flush() {
+  if (closed_ || error_message_ != nullptr) {
+    return false;
+  }
+  // Flushing before any data would start a frame with only a header.
+  if (!frame_open_ && input_length_ == 0) {
+    return true;
+  }
+  return Compress() &&
+         Write(LZ4F_flush(cctx_, output_buffer_, output_buffer_length_,
+                          nullptr));
+}
+
+bool Lz4OutputStream::EndFrame() {
+  if (closed_ || error_message_ != nullptr) {
+    return false;
+  }
+  if (!frame_open_ && input_length_ == 0) {
+    return true;
+  }
+  return FinishFrame();
+}
+
+bool Lz4OutputStream::Close() {
+  if (closed_) {
+    return false;
+  }
+  closed_ = true;
+  if (error_message_ != nullptr) {
+    return false;
+  }
+  // Write an empty frame for empty input, so the output is a valid lz4
+  // stream.
+  if (!frame_open_ && input_length_ == 0 && wrote_frame_) {
+    return true;
+  }
+  return FinishFrame();
+}
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // HAVE_LZ4
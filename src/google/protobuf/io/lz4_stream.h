@@ -0,0 +1,198 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file contains the definition for classes Lz4InputStream and
+// Lz4OutputStream.
+//
+// Lz4InputStream decompresses data from an underlying ZeroCopyInputStream
+// holding one or more LZ4 frames and provides the decompressed data as a
+// ZeroCopyInputStream.
+//
+// Lz4OutputStream is a ZeroCopyOutputStream that compresses data to an
+// underlying ZeroCopyOutputStream in the LZ4 frame format.
+
+#ifndef GOOGLE_PROTOBUF_IO_LZ4_STREAM_H__
+#define GOOGLE_PROTOBUF_IO_LZ4_STREAM_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "lz4frame.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+// A ZeroCopyInputStream that reads compressed data through lz4.
+// Concatenated frames are decompressed as one stream.
+class PROTOBUF_EXPORT Lz4InputStream final : public ZeroCopyInputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    // What size buffer to use internally.  Defaults to 64kB.
+    int buffer_size;
+
+    // The dictionary the data was compressed with, if any.  The stream
+    // keeps its own copy.  Requires liblz4 1.10 or later; otherwise the
+    // stream fails with an error.
+    absl::string_view dictionary;
+
+    Options();  // Initializes with default values.
+  };
+
+  // buffer_size may be -1 for the default.
+  explicit Lz4InputStream(ZeroCopyInputStream* sub_stream,
+                          int buffer_size = -1);
+  Lz4InputStream(ZeroCopyInputStream* sub_stream, const Options& options);
+  Lz4InputStream(const Lz4InputStream&) = delete;
+  Lz4InputStream& operator=(const Lz4InputStream&) = delete;
+  ~Lz4InputStream() override;
+
+  // Return last error message or NULL if no error.  Input that ends in the
+  // middle of a frame is an error.
+  inline const char* Lz4ErrorMessage() const { return error_message_; }
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  ZeroCopyInputStream* sub_stream_;
+  LZ4F_dctx* dctx_;
+  std::string dictionary_;
+  const char* error_message_;
+
+  const char* input_;
+  size_t input_length_;
+  char* output_buffer_;
+  size_t output_buffer_length_;
+  // Decompressed bytes in output_buffer_, and how many were returned.
+  size_t output_end_;
+  size_t output_position_;
+  // The last call filled the output buffer, so lz4 may hold more output.
+  bool output_pending_;
+  // The last frame has been fully decompressed.
+  bool frame_done_;
+  int64_t byte_count_;
+
+  void Init(ZeroCopyInputStream* sub_stream, const Options& options);
+  bool Decompress();
+};
+
+class PROTOBUF_EXPORT Lz4OutputStream final : public ZeroCopyOutputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    // What size buffer to use internally.  Defaults to 64kB.
+    int buffer_size;
+
+    // 0 selects the fast compressor; LZ4HC_CLEVEL_MIN (3) through
+    // LZ4HC_CLEVEL_MAX (12) select the slower, stronger LZ4HC compressor.
+    // Negative levels trade compression for even more speed.  Defaults to 0.
+    int compression_level;
+
+    // Whether each frame carries a checksum of its content.  Defaults to
+    // false.
+    bool checksum;
+
+    // A dictionary to compress with, such as one trained with
+    // ZDICT_trainFromBuffer().  Only the last 64kB are used.  Readers need
+    // the same dictionary.  The stream keeps its own copy.  Requires liblz4
+    // 1.10 or later; otherwise the stream fails with an error.
+    absl::string_view dictionary;
+
+    Options();  // Initializes with default values.
+  };
+
+  // Create a Lz4OutputStream with default options.
+  explicit Lz4OutputStream(ZeroCopyOutputStream* sub_stream);
+
+  // Create a Lz4OutputStream with the given options.
+  Lz4OutputStream(ZeroCopyOutputStream* sub_stream, const Options& options);
+  Lz4OutputStream(const Lz4OutputStream&) = delete;
+  Lz4OutputStream& operator=(const Lz4OutputStream&) = delete;
+
+  ~Lz4OutputStream() override;
+
+  // Return last error message or NULL if no error.
+  inline const char* Lz4ErrorMessage() const { return error_message_; }
+
+  // Flushes data written so far to compressed data in the underlying stream,
+  // within the current frame.  It is the caller's responsibility to flush the
+  // underlying stream if necessary.
+  // Returns true if no error.
+  bool Flush();
+
+  // Ends the current frame after the data written so far; later data starts
+  // a new frame that can be decompressed on its own.  See
+  // ZstdOutputStream::EndFrame() for aligning frames with delimited messages.
+  // Does nothing if no data was written since the last frame ended.
+  // Returns true if no error.
+  bool EndFrame();
+
+  // Writes out all data and ends the last frame.
+  // It is the caller's responsibility to close the underlying stream if
+  // necessary.
+  // Returns true if no error.
+  bool Close();
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  ZeroCopyOutputStream* sub_stream_;
+  LZ4F_cctx* cctx_;
+  std::string dictionary_;
+  LZ4F_preferences_t preferences_;
+  const char* error_message_;
+  bool closed_;
+
+  char* input_buffer_;
+  size_t input_buffer_length_;
+  // Bytes of input_buffer_ holding data not yet passed to lz4.
+  size_t input_length_;
+  // Bytes passed to lz4.
+  int64_t byte_count_;
+  // lz4 writes whole blocks at once, so it compresses into this buffer,
+  // which is then copied to sub_stream_.
+  char* output_buffer_;
+  size_t output_buffer_length_;
+  // A frame header was written and the frame has not ended yet.
+  bool frame_open_;
+  // A frame has been ended.
+  bool wrote_frame_;
+
+  // Shared constructor code.
+  void Init(ZeroCopyOutputStream* sub_stream, const Options& options);
+
+  // Starts a frame unless one is open.
+  bool BeginFrame();
+  // Passes the buffered input to lz4.
+  bool Compress();
+  // Compresses the buffered input and ends the frame, starting one first if
+  // none is open.
+  bool FinishFrame();
+  // Checks the result of an lz4 call, the number of bytes it wrote to
+  // output_buffer_, and copies them to sub_stream_.
+  bool Write(size_t result);
+};
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_IO_LZ4_STREAM_H__
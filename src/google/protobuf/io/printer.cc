@@ -13,8 +13,10 @@
 
 #include <stdlib.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <functional>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -251,6 +253,28 @@ Printer::Format Printer::TokenizeFormat(absl::string_view format_string,
   return format;
 }
 
+// A tokenized format string, along with the copy of the string that its chunks
+// point into.
+struct Printer::CachedFormat {
+  std::string text;
+  Format format;
+};
+
+const Printer::Format& Printer::TokenizeFormatCached(
+    absl::string_view format_string, const PrintOptions& options) {
+  auto& cached = format_cache_[{format_string.data(), format_string.size()}];
+  if (cached == nullptr) {
+    cached = std::make_unique<CachedFormat>();
+  } else if (cached->text == format_string) {
+    return cached->format;
+  }
+  // Either a new format string, or a temporary one that reused the storage of
+  // an earlier one.
+  cached->text = std::string(format_string);
+  cached->format = TokenizeFormat(cached->text, options);
+  return cached->format;
+}
+
 constexpr absl::string_view Printer::kProtocCodegenTrace;
 
 Printer::Printer(ZeroCopyOutputStream* output) : Printer(output, Options{}) {}
@@ -271,6 +295,8 @@ Printer::Printer(ZeroCopyOutputStream* output, char variable_delimiter,
                  AnnotationCollector* annotation_collector)
     : Printer(output, Options{variable_delimiter, annotation_collector}) {}
 
+Printer::~Printer() = default;
+
 absl::string_view Printer::LookupVar(absl::string_view var) {
   auto result = LookupInFrameStack(var, absl::MakeSpan(var_lookups_));
   ABSL_CHECK(result.has_value()) << "could not find " << var;
@@ -433,8 +459,12 @@ void Printer::IndentIfAtStart() {
     return;
   }
 
-  for (size_t i = 0; i < indent_; ++i) {
-    sink_.Write(" ");
+  static constexpr absl::string_view kSpaces =
+      "                                                                ";
+  for (size_t left = indent_; left > 0;) {
+    size_t n = std::min(left, kSpaces.size());
+    sink_.Append(kSpaces.data(), n);
+    left -= n;
   }
   at_start_of_line_ = false;
 }
@@ -497,7 +527,12 @@ void Printer::PrintImpl(absl::string_view format,
     substitutions_.clear();
   }
 
-  auto fmt = TokenizeFormat(format, opts);
+  // Only Emit() sets `loc`; the format strings of the older entry points are
+  // often built at runtime, and not worth keeping.
+  Format uncached;
+  const Format& fmt = opts.loc.has_value()
+                          ? TokenizeFormatCached(format, opts)
+                          : (uncached = TokenizeFormat(format, opts));
   PrintCodegenTrace(opts.loc);
 
   size_t arg_index = 0;
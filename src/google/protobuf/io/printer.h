@@ -17,6 +17,7 @@
 #include <cstddef>
 #include <functional>
 #include <initializer_list>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <utility>
@@ -509,6 +510,7 @@ class PROTOBUF_EXPORT Printer {
 
   Printer(const Printer&) = delete;
   Printer& operator=(const Printer&) = delete;
+  ~Printer();
 
   // Pushes a new variable lookup frame that stores `vars` by reference.
   //
@@ -658,6 +660,7 @@ class PROTOBUF_EXPORT Printer {
  private:
   struct PrintOptions;
   struct Format;
+  struct CachedFormat;
 
   // Helper type for wrapping a variable substitution expansion result.
   template <bool owned>
@@ -692,6 +695,11 @@ class PROTOBUF_EXPORT Printer {
   Format TokenizeFormat(absl::string_view format_string,
                         const PrintOptions& options);
 
+  // Like TokenizeFormat(), but reuses the result of an earlier call with the
+  // same format string, as compared by address, size and contents.
+  const Format& TokenizeFormatCached(absl::string_view format_string,
+                                     const PrintOptions& options);
+
   // Emit an annotation for the range defined by the given substitution
   // variables, as set by the most recent call to PrintImpl() that set
   // `use_substitution_map` to true.
@@ -761,6 +769,13 @@ class PROTOBUF_EXPORT Printer {
   // indents are inserted. These are keys that refer to the beginning of the
   // current line.
   std::vector<std::string> line_start_variables_;
+
+  // The tokenized format strings of Emit() calls, by the address and size of
+  // the format string. These are almost always string literals, which are
+  // emitted many times per file.
+  absl::flat_hash_map<std::pair<const char*, size_t>,
+                      std::unique_ptr<CachedFormat>>
+      format_cache_;
 };
 
 // Options for PrintImpl().
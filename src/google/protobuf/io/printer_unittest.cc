@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 #include "absl/container/flat_hash_map.h"
 #include "absl/log/absl_check.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
@@ -684,6 +685,34 @@ TEST_F(PrinterTest, EmitWithIndent) {
             "  };\n");
 }
 
+TEST_F(PrinterTest, EmitWithDeepIndent) {
+  {
+    Printer printer(output());
+    for (int i = 0; i < 50; ++i) printer.Indent();
+    printer.Emit("x;\n");
+  }
+
+  EXPECT_EQ(written(), absl::StrCat(std::string(100, ' '), "x;\n"));
+}
+
+TEST_F(PrinterTest, EmitReusedFormatStorage) {
+  {
+    Printer printer(output());
+    std::string format = "int $f$;\n";
+    for (int i = 0; i < 2; ++i) {
+      printer.Emit({{"f", "x"}}, format);
+    }
+    // Same address and size, different contents.
+    format[0] = 'I';
+    printer.Emit({{"f", "y"}}, format);
+  }
+
+  EXPECT_EQ(written(),
+            "int x;\n"
+            "int x;\n"
+            "Int y;\n");
+}
+
 
 TEST_F(PrinterTest, EmitSameNameAnnotation) {
   FakeAnnotationCollector collector;
@@ -67,6 +67,8 @@
 
 #include "google/protobuf/io/tokenizer.h"
 
+#include <utility>
+
 #include "google/protobuf/stubs/common.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
@@ -94,10 +96,29 @@ namespace {
 // Note:  No class is allowed to contain '\0', since this is used to mark end-
 //   of-input and is handled specially.
 
-#define CHARACTER_CLASS(NAME, EXPRESSION)                     \
-  class NAME {                                                \
-   public:                                                    \
-    static inline bool InClass(char c) { return EXPRESSION; } \
+// Whether each character is in CharacterClass, so that testing one takes a
+// single load rather than the comparisons of CharacterClass::Test().
+template <typename CharacterClass>
+struct CharacterClassTable {
+  constexpr CharacterClassTable() : in_class() {
+    for (int i = 0; i < 256; ++i) {
+      in_class[i] = CharacterClass::Test(static_cast<char>(i));
+    }
+  }
+  bool in_class[256];
+};
+
+template <typename CharacterClass>
+constexpr CharacterClassTable<CharacterClass> kCharacterClassTable{};
+
+#define CHARACTER_CLASS(NAME, EXPRESSION)                             \
+  class NAME {                                                        \
+   public:                                                            \
+    static constexpr bool Test(char c) { return EXPRESSION; }         \
+    static inline bool InClass(char c) {                              \
+      return kCharacterClassTable<NAME>                               \
+          .in_class[static_cast<unsigned char>(c)];                   \
+    }                                                                 \
   }
 
 CHARACTER_CLASS(Whitespace, c == ' ' || c == '\n' || c == '\t' || c == '\r' ||
@@ -356,7 +377,7 @@ inline bool Tokenizer::TryConsume(char c) {
 template <typename CharacterClass>
 inline void Tokenizer::ConsumeZeroOrMore() {
   while (CharacterClass::InClass(current_char_)) {
-    NextChar();
+    ConsumeRun(&CharacterClass::InClass);
   }
 }
 
@@ -365,9 +386,30 @@ inline void Tokenizer::ConsumeOneOrMore(const char* error) {
   if (!CharacterClass::InClass(current_char_)) {
     AddError(error);
   } else {
-    do {
-      NextChar();
-    } while (CharacterClass::InClass(current_char_));
+    ConsumeZeroOrMore<CharacterClass>();
+  }
+}
+
+template <typename Predicate>
+inline void Tokenizer::ConsumeRun(Predicate in_run) {
+  if (current_char_ == '\n' || current_char_ == '\t') {
+    NextChar();
+    return;
+  }
+
+  // Other characters just advance the column, so the run is consumed at once
+  // rather than through NextChar() for each character.
+  int pos = buffer_pos_ + 1;
+  while (pos < buffer_size_ && buffer_[pos] != '\n' && buffer_[pos] != '\t' &&
+         in_run(buffer_[pos])) {
+    ++pos;
+  }
+  column_ += pos - buffer_pos_;
+  buffer_pos_ = pos;
+  if (buffer_pos_ < buffer_size_) {
+    current_char_ = buffer_[buffer_pos_];
+  } else {
+    Refresh();
   }
 }
 
@@ -433,7 +475,9 @@ void Tokenizer::ConsumeString(char delimiter) {
           NextChar();
           return;
         }
-        NextChar();
+        ConsumeRun([delimiter](char c) {
+          return c != delimiter && c != '\\' && c != '\0' && c != '\n';
+        });
         break;
       }
     }
@@ -499,7 +543,7 @@ void Tokenizer::ConsumeLineComment(std::string* content) {
   if (content != NULL) RecordTo(content);
 
   while (current_char_ != '\0' && current_char_ != '\n') {
-    NextChar();
+    ConsumeRun([](char c) { return c != '\0' && c != '\n'; });
   }
   TryConsume('\n');
 
@@ -515,7 +559,9 @@ void Tokenizer::ConsumeBlockComment(std::string* content) {
   while (true) {
     while (current_char_ != '\0' && current_char_ != '*' &&
            current_char_ != '/' && current_char_ != '\n') {
-      NextChar();
+      ConsumeRun([](char c) {
+        return c != '\0' && c != '*' && c != '/' && c != '\n';
+      });
     }
 
     if (TryConsume('\n')) {
@@ -607,7 +653,9 @@ bool Tokenizer::TryConsumeNewline() {
 // -------------------------------------------------------------------
 
 bool Tokenizer::Next() {
-  previous_ = current_;
+  // Swapping rather than copying keeps the capacity of both texts for reuse;
+  // every path below resets current_.
+  std::swap(previous_, current_);
 
   while (!read_error_) {
     StartToken();
@@ -1228,7 +1276,13 @@ void Tokenizer::ParseStringAppend(const std::string& text,
     } else if (*ptr == text[0] && ptr[1] == '\0') {
       // Ignore final quote matching the starting quote.
     } else {
-      output->push_back(*ptr);
+      // Copies the characters up to the next escape sequence, or up to the
+      // final quote, at once.
+      const char* run_end = ptr + 1;
+      while (*run_end != '\0' && *run_end != '\\') ++run_end;
+      if (*run_end == '\0' && run_end[-1] == text[0]) --run_end;
+      output->append(ptr, static_cast<size_t>(run_end - ptr));
+      ptr = run_end - 1;  // Because we're about to ++ptr.
     }
   }
 }
@@ -421,6 +421,13 @@ class PROTOBUF_EXPORT Tokenizer {
   // e.g. ConsumeOneOrMore<Digit>("Expected digits.");
   template <typename CharacterClass>
   inline void ConsumeOneOrMore(const char* error);
+
+  // Consumes the current character, which `in_run` must return true for, and
+  // the characters after it in the buffer for as long as `in_run` does.
+  // Stops before tabs and newlines, which are consumed one at a time so that
+  // the column is tracked; the caller loops until the run really ends.
+  template <typename Predicate>
+  inline void ConsumeRun(Predicate in_run);
 };
 
 // inline methods ====================================================
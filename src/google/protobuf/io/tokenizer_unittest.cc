@@ -404,6 +404,20 @@ MultiTokenCase kMultiTokenCases[] = {
          {Tokenizer::TYPE_END, "", 0, 16, 16},
      }},
 
+    // Test that long runs, consumed in bulk, track columns across tabs.
+    {"identifier_with_many_characters\t\"a long\tstring\\\"literal\" "
+     "1234567890 // comment\twith tab\n"
+     "/* block\tcomment */ z",
+     {
+         {Tokenizer::TYPE_IDENTIFIER, "identifier_with_many_characters", 0, 0,
+          31},
+         {Tokenizer::TYPE_STRING, "\"a long\tstring\\\"literal\"", 0, 32,
+          56},
+         {Tokenizer::TYPE_INTEGER, "1234567890", 0, 57, 67},
+         {Tokenizer::TYPE_IDENTIFIER, "z", 1, 27, 28},
+         {Tokenizer::TYPE_END, "", 1, 28, 28},
+     }},
+
     // Test that line comments are ignored.
     {"foo // This is a comment\n"
      "bar // This is another comment",
@@ -1051,6 +1065,9 @@ TEST_F(TokenizerTest, ParseString) {
   EXPECT_EQ("\x20\x4", output);
   Tokenizer::ParseString("'\\X20\\X4'", &output);
   EXPECT_EQ("\x20\x4", output);
+  Tokenizer::ParseString("'some text \\n more text \\\" and the end'",
+                         &output);
+  EXPECT_EQ("some text \n more text \" and the end", output);
 
   // Test invalid strings that may still be tokenized as strings.
   Tokenizer::ParseString("\"\\a\\l\\v\\t", &output);  // \l is invalid
@@ -15,10 +15,15 @@
 #include <sys/types.h>
 #include <unistd.h>
 #endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 #include <errno.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <limits>
 
 #include "google/protobuf/stubs/common.h"
 #include "absl/log/absl_check.h"
@@ -145,6 +150,124 @@ int FileInputStream::CopyingFileInputStream::Skip(int count) {
   }
 }
 
+#ifndef _WIN32
+// ===================================================================
+
+MappedFileInputStream::MappedFileInputStream(int file_descriptor,
+                                             int64_t window_size,
+                                             int block_size)
+    : file_(file_descriptor),
+      block_size_(block_size > 0 ? block_size
+                                 : std::numeric_limits<int>::max()),
+      window_size_(window_size) {
+  int64_t page_size = sysconf(_SC_PAGESIZE);
+  window_size_ = std::max(window_size_, page_size);
+  window_size_ = (window_size_ + page_size - 1) / page_size * page_size;
+}
+
+MappedFileInputStream::~MappedFileInputStream() {
+  Unmap();
+  if (close_on_delete_ && !is_closed_) {
+    if (!Close()) {
+      ABSL_LOG(ERROR) << "close() failed: " << strerror(errno_);
+    }
+  }
+}
+
+bool MappedFileInputStream::Close() {
+  ABSL_CHECK(!is_closed_);
+
+  Unmap();
+  is_closed_ = true;
+  if (close_no_eintr(file_) != 0) {
+    errno_ = errno;
+    return false;
+  }
+  return true;
+}
+
+bool MappedFileInputStream::Init() {
+  initialized_ = true;
+  struct stat info;
+  if (fstat(file_, &info) != 0) {
+    errno_ = errno;
+    return false;
+  }
+  if (!S_ISREG(info.st_mode)) {
+    errno_ = ENODEV;
+    return false;
+  }
+  file_size_ = info.st_size;
+  return true;
+}
+
+bool MappedFileInputStream::MapWindow() {
+  Unmap();
+  // Mappings must start at a page boundary, which window_size_ is a multiple
+  // of.
+  window_offset_ = position_ / window_size_ * window_size_;
+  window_length_ = std::min(window_size_, file_size_ - window_offset_);
+  void* mapping =
+      mmap(nullptr, static_cast<size_t>(window_length_), PROT_READ,
+           MAP_PRIVATE, file_, static_cast<off_t>(window_offset_));
+  if (mapping == MAP_FAILED) {
+    errno_ = errno;
+    window_length_ = 0;
+    return false;
+  }
+  // Only a hint; failure is harmless.
+  madvise(mapping, static_cast<size_t>(window_length_), MADV_SEQUENTIAL);
+  window_ = static_cast<const char*>(mapping);
+  return true;
+}
+
+void MappedFileInputStream::Unmap() {
+  if (window_ != nullptr) {
+    munmap(const_cast<char*>(window_), static_cast<size_t>(window_length_));
+    window_ = nullptr;
+  }
+}
+
+bool MappedFileInputStream::Next(const void** data, int* size) {
+  ABSL_CHECK(!is_closed_);
+
+  last_returned_size_ = 0;
+  if (errno_ != 0 || (!initialized_ && !Init())) return false;
+  if (position_ >= file_size_) return false;
+  if (window_ == nullptr || position_ < window_offset_ ||
+      position_ >= window_offset_ + window_length_) {
+    if (!MapWindow()) return false;
+  }
+  int64_t offset = position_ - window_offset_;
+  last_returned_size_ = static_cast<int>(
+      std::min<int64_t>(window_length_ - offset, block_size_));
+  *data = window_ + offset;
+  *size = last_returned_size_;
+  position_ += last_returned_size_;
+  return true;
+}
+
+void MappedFileInputStream::BackUp(int count) {
+  ABSL_CHECK_LE(count, last_returned_size_)
+      << "BackUp() can not exceed the size of the last Next() call.";
+  ABSL_CHECK_GE(count, 0);
+  position_ -= count;
+  last_returned_size_ -= count;
+}
+
+bool MappedFileInputStream::Skip(int count) {
+  ABSL_CHECK_GE(count, 0);
+  last_returned_size_ = 0;
+  if (errno_ != 0 || (!initialized_ && !Init())) return false;
+  if (count > file_size_ - position_) {
+    position_ = file_size_;
+    return false;
+  }
+  position_ += count;
+  return true;
+}
+#endif  // !_WIN32
+
 // ===================================================================
 
 FileOutputStream::FileOutputStream(int file_descriptor, int block_size)
@@ -17,6 +17,7 @@
 #ifndef GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_H__
 #define GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_H__
 
+#include <cstdint>
 #include <iosfwd>
 #include <string>
 
@@ -67,6 +68,18 @@ class PROTOBUF_EXPORT FileInputStream final : public ZeroCopyInputStream {
   // fail.
   int GetErrno() const { return copying_input_.GetErrno(); }
 
+  // See CopyingInputStreamAdaptor::SetAdaptiveBlockSize().
+  void SetAdaptiveBlockSize(int max_block_size) {
+    impl_.SetAdaptiveBlockSize(max_block_size);
+  }
+
+  // Aligns the buffer and reads as needed for a descriptor opened with
+  // O_DIRECT, which is usually 4096; see
+  // CopyingInputStreamAdaptor::SetBufferAlignment().
+  void SetBufferAlignment(int alignment) {
+    impl_.SetBufferAlignment(alignment);
+  }
+
   // implements ZeroCopyInputStream ----------------------------------
   bool Next(const void** data, int* size) override;
   void BackUp(int count) override;
@@ -108,6 +121,89 @@ class PROTOBUF_EXPORT FileInputStream final : public ZeroCopyInputStream {
   CopyingInputStreamAdaptor impl_;
 };
 
+#ifndef _WIN32
+// ===================================================================
+
+// A ZeroCopyInputStream which reads a regular file by mapping it into memory.
+//
+// Unlike FileInputStream, Next() returns the mapped bytes of the file itself,
+// so nothing is copied into an intermediate buffer. At most `window_size`
+// bytes of the file are mapped at a time; the mapping is replaced as the
+// stream advances, so files larger than the address space budget can be read
+// too. Mappings are advised for sequential access.
+//
+// Data returned by Next() stays valid until the stream moves to another
+// window, or is destroyed. A parse that aliases its input (for example with
+// ParseFlags::kMergeWithAliasing) may therefore only be used when the whole
+// file fits in one window.
+//
+// The file must not be truncated while it is mapped; accessing pages past its
+// new end raises SIGBUS. Descriptors that cannot be mapped, such as pipes,
+// fail on the first call to Next() with GetErrno() set.
+class PROTOBUF_EXPORT MappedFileInputStream final
+    : public ZeroCopyInputStream {
+ public:
+  static constexpr int64_t kDefaultWindowSize = int64_t{1} << 30;
+
+  // Creates a stream that reads the file open as the given Unix file
+  // descriptor, from its start. `window_size` is rounded up to a multiple of
+  // the page size. If a `block_size` is given, Next() returns at most that
+  // many bytes at a time.
+  explicit MappedFileInputStream(int file_descriptor,
+                                 int64_t window_size = kDefaultWindowSize,
+                                 int block_size = -1);
+  MappedFileInputStream(const MappedFileInputStream&) = delete;
+  MappedFileInputStream& operator=(const MappedFileInputStream&) = delete;
+  ~MappedFileInputStream() override;
+
+  // Unmaps the file and closes the file descriptor. Returns false if an error
+  // occurs; use GetErrno() to examine the error.
+  bool Close();
+
+  // By default, the file descriptor is not closed when the stream is
+  // destroyed.  Call SetCloseOnDelete(true) to change that.
+  void SetCloseOnDelete(bool value) { close_on_delete_ = value; }
+
+  // If an I/O error has occurred on this file descriptor, this is the
+  // errno from that error.  Otherwise, this is zero.  Once an error
+  // occurs, the stream is broken and all subsequent operations will
+  // fail.
+  int GetErrno() const { return errno_; }
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override { return position_; }
+
+ private:
+  // Stats the file on first use. Returns false on error.
+  bool Init();
+  // Maps the window containing file offset `position_`.
+  bool MapWindow();
+  void Unmap();
+
+  const int file_;
+  const int block_size_;
+  int64_t window_size_;
+  bool close_on_delete_ = false;
+  bool is_closed_ = false;
+  bool initialized_ = false;
+  int errno_ = 0;
+
+  int64_t file_size_ = 0;
+  // Offset of the next byte Next() returns.
+  int64_t position_ = 0;
+  // Bytes [window_offset_, window_offset_ + window_length_) of the file are
+  // mapped at window_.
+  const char* window_ = nullptr;
+  int64_t window_offset_ = 0;
+  int64_t window_length_ = 0;
+  // Size of the last chunk returned by Next(), for BackUp().
+  int last_returned_size_ = 0;
+};
+#endif  // !_WIN32
+
 // ===================================================================
 
 // A ZeroCopyOutputStream which writes to a file descriptor.
@@ -193,6 +289,11 @@ class PROTOBUF_EXPORT IstreamInputStream final : public ZeroCopyInputStream {
   IstreamInputStream(const IstreamInputStream&) = delete;
   IstreamInputStream& operator=(const IstreamInputStream&) = delete;
 
+  // See CopyingInputStreamAdaptor::SetAdaptiveBlockSize().
+  void SetAdaptiveBlockSize(int max_block_size) {
+    impl_.SetAdaptiveBlockSize(max_block_size);
+  }
+
   // implements ZeroCopyInputStream ----------------------------------
   bool Next(const void** data, int* size) override;
   void BackUp(int count) override;
@@ -239,6 +340,11 @@ class PROTOBUF_EXPORT OstreamOutputStream final : public ZeroCopyOutputStream {
   OstreamOutputStream& operator=(const OstreamOutputStream&) = delete;
   ~OstreamOutputStream() override;
 
+  // See CopyingOutputStreamAdaptor::SetAdaptiveBlockSize().
+  void SetAdaptiveBlockSize(int max_block_size) {
+    impl_.SetAdaptiveBlockSize(max_block_size);
+  }
+
   // implements ZeroCopyOutputStream ---------------------------------
   bool Next(void** data, int* size) override;
   void BackUp(int count) override;
@@ -12,6 +12,7 @@
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <limits>
 #include <utility>
 
@@ -81,6 +82,26 @@ bool ArrayInputStream::Skip(int count) {
 
 int64_t ArrayInputStream::ByteCount() const { return position_; }
 
+// ===================================================================
+
+bool SpanChainInputStream::Skip(int count) {
+  ABSL_CHECK_GE(count, 0);
+  last_returned_size_ = 0;  // Don't let caller back up.
+  while (index_ < fragments_.size()) {
+    const size_t available = fragments_[index_].size() - position_;
+    if (static_cast<size_t>(count) <= available) {
+      position_ += count;
+      byte_count_ += count;
+      return true;
+    }
+    count -= static_cast<int>(available);
+    byte_count_ += available;
+    ++index_;
+    position_ = 0;
+  }
+  return count == 0;
+}
+
 
 // ===================================================================
 
@@ -182,6 +203,8 @@ CopyingInputStreamAdaptor::CopyingInputStreamAdaptor(
       failed_(false),
       position_(0),
       buffer_size_(block_size > 0 ? block_size : kDefaultBlockSize),
+      max_buffer_size_(buffer_size_),
+      alignment_(0),
       buffer_used_(0),
       backup_bytes_(0) {}
 
@@ -191,24 +214,50 @@ CopyingInputStreamAdaptor::~CopyingInputStreamAdaptor() {
   }
 }
 
+void CopyingInputStreamAdaptor::SetAdaptiveBlockSize(int max_block_size) {
+  max_buffer_size_ = std::max(buffer_size_, max_block_size);
+  if (alignment_ > 0) {
+    max_buffer_size_ = std::max(
+        buffer_size_, max_buffer_size_ / alignment_ * alignment_);
+  }
+}
+
+void CopyingInputStreamAdaptor::SetBufferAlignment(int alignment) {
+  ABSL_CHECK(buffer_ == nullptr)
+      << " SetBufferAlignment() must be called before Next().";
+  ABSL_CHECK(alignment > 0 && (alignment & (alignment - 1)) == 0)
+      << " Alignment must be a power of two.";
+  alignment_ = alignment;
+  // Round the sizes up to a multiple of the alignment.
+  buffer_size_ = (buffer_size_ + alignment - 1) & ~(alignment - 1);
+  SetAdaptiveBlockSize(max_buffer_size_);
+}
+
 bool CopyingInputStreamAdaptor::Next(const void** data, int* size) {
   if (failed_) {
     // Already failed on a previous read.
     return false;
   }
 
-  AllocateBufferIfNeeded();
-
   if (backup_bytes_ > 0) {
     // We have data left over from a previous BackUp(), so just return that.
-    *data = buffer_.get() + buffer_used_ - backup_bytes_;
+    *data = buffer() + buffer_used_ - backup_bytes_;
     *size = backup_bytes_;
     backup_bytes_ = 0;
     return true;
   }
 
+  if (buffer_used_ == buffer_size_ && buffer_size_ < max_buffer_size_) {
+    // The last read filled the buffer, so the stream may well have more
+    // ready.  Read more at once.  Doubling keeps the buffer aligned.
+    buffer_size_ = static_cast<int>(std::min<int64_t>(
+        int64_t{buffer_size_} * 2, max_buffer_size_));
+    buffer_.reset();
+  }
+  AllocateBufferIfNeeded();
+
   // Read new data into the buffer.
-  buffer_used_ = copying_stream_->Read(buffer_.get(), buffer_size_);
+  buffer_used_ = copying_stream_->Read(buffer(), buffer_size_);
   if (buffer_used_ <= 0) {
     // EOF or read error.  We don't need the buffer anymore.
     if (buffer_used_ < 0) {
@@ -221,7 +270,7 @@ bool CopyingInputStreamAdaptor::Next(const void** data, int* size) {
   position_ += buffer_used_;
 
   *size = buffer_used_;
-  *data = buffer_.get();
+  *data = buffer();
   return true;
 }
 
@@ -254,6 +303,21 @@ bool CopyingInputStreamAdaptor::Skip(int count) {
   count -= backup_bytes_;
   backup_bytes_ = 0;
 
+  if (alignment_ > 0) {
+    // Seeking would make the following reads unaligned; read instead.
+    const void* data;
+    int size;
+    while (count > 0) {
+      if (!Next(&data, &size)) return false;
+      if (size > count) {
+        BackUp(size - count);
+        return true;
+      }
+      count -= size;
+    }
+    return true;
+  }
+
   int skipped = copying_stream_->Skip(count);
   position_ += skipped;
   return skipped == count;
@@ -265,10 +329,17 @@ int64_t CopyingInputStreamAdaptor::ByteCount() const {
 
 void CopyingInputStreamAdaptor::AllocateBufferIfNeeded() {
   if (buffer_.get() == NULL) {
-    buffer_.reset(new uint8_t[buffer_size_]);
+    buffer_.reset(new uint8_t[buffer_size_ + alignment_]);
   }
 }
 
+uint8_t* CopyingInputStreamAdaptor::buffer() const {
+  if (alignment_ == 0) return buffer_.get();
+  uintptr_t address = reinterpret_cast<uintptr_t>(buffer_.get());
+  address = (address + alignment_ - 1) & ~static_cast<uintptr_t>(alignment_ - 1);
+  return reinterpret_cast<uint8_t*>(address);
+}
+
 void CopyingInputStreamAdaptor::FreeBuffer() {
   ABSL_CHECK_EQ(backup_bytes_, 0);
   buffer_used_ = 0;
@@ -284,6 +355,7 @@ CopyingOutputStreamAdaptor::CopyingOutputStreamAdaptor(
       failed_(false),
       position_(0),
       buffer_size_(block_size > 0 ? block_size : kDefaultBlockSize),
+      max_buffer_size_(buffer_size_),
       buffer_used_(0) {}
 
 CopyingOutputStreamAdaptor::~CopyingOutputStreamAdaptor() {
@@ -295,9 +367,19 @@ CopyingOutputStreamAdaptor::~CopyingOutputStreamAdaptor() {
 
 bool CopyingOutputStreamAdaptor::Flush() { return WriteBuffer(); }
 
+void CopyingOutputStreamAdaptor::SetAdaptiveBlockSize(int max_block_size) {
+  max_buffer_size_ = std::max(buffer_size_, max_block_size);
+}
+
 bool CopyingOutputStreamAdaptor::Next(void** data, int* size) {
   if (buffer_used_ == buffer_size_) {
     if (!WriteBuffer()) return false;
+    if (buffer_size_ < max_buffer_size_) {
+      // A full buffer was written; continue with a larger one.
+      buffer_size_ = static_cast<int>(std::min<int64_t>(
+          int64_t{buffer_size_} * 2, max_buffer_size_));
+      buffer_.reset();
+    }
   }
 
   AllocateBufferIfNeeded();
@@ -666,6 +748,23 @@ int64_t CordOutputStream::ByteCount() const {
   return static_cast<int64_t>(cord_.size() + buffer_.length());
 }
 
+bool CordOutputStream::WriteAliasedRaw(const void* data, int size) {
+  ABSL_DCHECK(aliasing_enabled_);
+  // Like Cord::Append(), copy small data rather than adding a node for it.
+  static const int kMaxBytesToCopy = 511;
+
+  cord_.Append(std::move(buffer_));
+  absl::string_view view(static_cast<const char*>(data),
+                         static_cast<size_t>(size));
+  if (size <= kMaxBytesToCopy) {
+    cord_.Append(view);
+  } else {
+    cord_.Append(absl::MakeCordFromExternal(view, [] {}));
+  }
+  state_ = State::kSteal;  // Attempt to utilize existing capacity in `cord'
+  return true;
+}
+
 bool CordOutputStream::WriteCord(const absl::Cord& cord) {
   cord_.Append(std::move(buffer_));
   cord_.Append(cord);
@@ -21,6 +21,10 @@
 #ifndef GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_LITE_H__
 #define GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_LITE_H__
 
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
 #include <memory>
 #include <string>
@@ -29,8 +33,11 @@
 #include "google/protobuf/stubs/callback.h"
 #include "google/protobuf/stubs/common.h"
 #include "absl/base/attributes.h"
+#include "absl/log/absl_check.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/cord_buffer.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/port.h"
 
@@ -80,6 +87,74 @@ class PROTOBUF_EXPORT ArrayInputStream final : public ZeroCopyInputStream {
 
 // ===================================================================
 
+// A ZeroCopyInputStream over a chain of borrowed buffers, such as the
+// fragments of a message received from the network.  Each call to Next()
+// returns (the rest of) one fragment; empty fragments are skipped.
+//
+// Unlike a ConcatenatingInputStream of ArrayInputStreams this needs no
+// stream object per fragment.  The parser recognizes this class statically
+// (see MessageLite::ParseFromZeroCopyStream()) and moves between fragments
+// without virtual calls.
+class PROTOBUF_EXPORT SpanChainInputStream final : public ZeroCopyInputStream {
+ public:
+  // Neither the span nor the bytes the fragments point to are copied; both
+  // remain the property of the caller and must remain valid until the stream
+  // is destroyed.
+  explicit SpanChainInputStream(absl::Span<const absl::string_view> fragments)
+      : fragments_(fragments) {}
+  ~SpanChainInputStream() override = default;
+
+  // `SpanChainInputStream` is neither copiable nor assignable
+  SpanChainInputStream(const SpanChainInputStream&) = delete;
+  SpanChainInputStream& operator=(const SpanChainInputStream&) = delete;
+
+  // implements ZeroCopyInputStream ----------------------------------
+  // Next() and BackUp() are defined inline so that callers holding a
+  // SpanChainInputStream* can inline them.
+  bool Next(const void** data, int* size) override {
+    while (index_ < fragments_.size()) {
+      const absl::string_view fragment = fragments_[index_];
+      const size_t available = fragment.size() - position_;
+      if (available > 0) {
+        last_returned_size_ =
+            static_cast<int>((std::min)(available, size_t{INT_MAX}));
+        *data = fragment.data() + position_;
+        *size = last_returned_size_;
+        position_ += last_returned_size_;
+        byte_count_ += last_returned_size_;
+        return true;
+      }
+      ++index_;
+      position_ = 0;
+    }
+    // We're at the end of the chain.
+    last_returned_size_ = 0;  // Don't let caller back up.
+    return false;
+  }
+  void BackUp(int count) override {
+    ABSL_DCHECK_GT(last_returned_size_, 0)
+        << "BackUp() can only be called after a successful Next().";
+    ABSL_DCHECK_LE(count, last_returned_size_);
+    ABSL_DCHECK_GE(count, 0);
+    position_ -= count;
+    byte_count_ -= count;
+    last_returned_size_ = 0;  // Don't let caller back up further.
+  }
+  bool Skip(int count) override;
+  int64_t ByteCount() const override { return byte_count_; }
+
+ private:
+  const absl::Span<const absl::string_view> fragments_;
+
+  size_t index_ = 0;     // The fragment holding the next byte, if any.
+  size_t position_ = 0;  // Offset of the next byte in fragments_[index_].
+  int64_t byte_count_ = 0;
+  int last_returned_size_ = 0;  // How many bytes we returned last time Next()
+                                // was called (used for error checking only).
+};
+
+// ===================================================================
+
 // A ZeroCopyOutputStream backed by an in-memory array of bytes.
 class PROTOBUF_EXPORT ArrayOutputStream final : public ZeroCopyOutputStream {
  public:
@@ -206,6 +281,21 @@ class PROTOBUF_EXPORT CopyingInputStreamAdaptor : public ZeroCopyInputStream {
   // delete the underlying CopyingInputStream when it is destroyed.
   void SetOwnsCopyingStream(bool value) { owns_copying_stream_ = value; }
 
+  // Call SetAdaptiveBlockSize(max_block_size) to let the buffer grow past
+  // block_size:  whenever a read fills the whole buffer, the next read uses
+  // one twice as large, up to max_block_size.  Reads that come back short, as
+  // from pipes and sockets, leave the size alone.  This saves reads of the
+  // underlying stream when it has a lot of data available at once, such as a
+  // file on a fast disk, without making small inputs allocate large buffers.
+  void SetAdaptiveBlockSize(int max_block_size);
+
+  // Call SetBufferAlignment(alignment) to align the buffer and the sizes read
+  // to `alignment` bytes, a power of two, as required by files opened with
+  // O_DIRECT.  Skip() then reads the skipped bytes instead of calling
+  // CopyingInputStream::Skip(), so that reads stay at aligned offsets.  Must
+  // be called before the first call to Next().
+  void SetBufferAlignment(int alignment);
+
   // implements ZeroCopyInputStream ----------------------------------
   bool Next(const void** data, int* size) override;
   void BackUp(int count) override;
@@ -217,6 +307,8 @@ class PROTOBUF_EXPORT CopyingInputStreamAdaptor : public ZeroCopyInputStream {
   void AllocateBufferIfNeeded();
   // Frees the buffer and resets buffer_used_.
   void FreeBuffer();
+  // The start of the buffer, aligned as requested.
+  uint8_t* buffer() const;
 
   // The underlying copying stream.
   CopyingInputStream* copying_stream_;
@@ -230,9 +322,14 @@ class PROTOBUF_EXPORT CopyingInputStreamAdaptor : public ZeroCopyInputStream {
   int64_t position_;
 
   // Data is read into this buffer.  It may be NULL if no buffer is currently
-  // in use.  Otherwise, it points to an array of size buffer_size_.
+  // in use.  Otherwise, it points to an array of size buffer_size_, plus
+  // alignment_ bytes of slack if the buffer is aligned.
   std::unique_ptr<uint8_t[]> buffer_;
-  const int buffer_size_;
+  int buffer_size_;
+  // buffer_size_ grows up to this size; see SetAdaptiveBlockSize().
+  int max_buffer_size_;
+  // 0 if the buffer need not be aligned.
+  int alignment_;
 
   // Number of valid bytes currently in the buffer (i.e. the size last
   // returned by Next()).  0 <= buffer_used_ <= buffer_size_.
@@ -296,6 +393,12 @@ class PROTOBUF_EXPORT CopyingOutputStreamAdaptor : public ZeroCopyOutputStream {
   // delete the underlying CopyingOutputStream when it is destroyed.
   void SetOwnsCopyingStream(bool value) { owns_copying_stream_ = value; }
 
+  // Call SetAdaptiveBlockSize(max_block_size) to let the buffer grow past
+  // block_size:  whenever a full buffer is written, the next one is twice as
+  // large, up to max_block_size.  Large outputs then take fewer writes to the
+  // underlying stream, while small ones keep a small buffer.
+  void SetAdaptiveBlockSize(int max_block_size);
+
   // implements ZeroCopyOutputStream ---------------------------------
   bool Next(void** data, int* size) override;
   void BackUp(int count) override;
@@ -326,7 +429,9 @@ class PROTOBUF_EXPORT CopyingOutputStreamAdaptor : public ZeroCopyOutputStream {
   // Data is written from this buffer.  It may be NULL if no buffer is
   // currently in use.  Otherwise, it points to an array of size buffer_size_.
   std::unique_ptr<uint8_t[]> buffer_;
-  const int buffer_size_;
+  int buffer_size_;
+  // buffer_size_ grows up to this size; see SetAdaptiveBlockSize().
+  int max_buffer_size_;
 
   // Number of valid bytes currently in the buffer (i.e. the size last
   // returned by Next()).  When BackUp() is called, we just reduce this.
@@ -458,10 +563,18 @@ class PROTOBUF_EXPORT CordOutputStream final : public ZeroCopyOutputStream {
   CordOutputStream(const CordOutputStream&) = delete;
   CordOutputStream& operator=(const CordOutputStream&) = delete;
 
+  // Enables WriteAliasedRaw(), which then makes the cord reference the
+  // written data in place rather than copying it, unless it is small. The
+  // caller must keep that data alive and unmodified for as long as the cord
+  // or any copy of it is alive.
+  void EnableAliasing(bool enabled) { aliasing_enabled_ = enabled; }
+
   // implements `ZeroCopyOutputStream` ---------------------------------
   bool Next(void** data, int* size) final;
   void BackUp(int count) final;
   int64_t ByteCount() const final;
+  bool WriteAliasedRaw(const void* data, int size) final;
+  bool AllowsAliasing() const final { return aliasing_enabled_; }
   bool WriteCord(const absl::Cord& cord) final;
 
   // Consumes the serialized data as a cord value. `Consume()` internally
@@ -487,6 +600,7 @@ class PROTOBUF_EXPORT CordOutputStream final : public ZeroCopyOutputStream {
   size_t size_hint_;
   State state_ = State::kEmpty;
   absl::CordBuffer buffer_;
+  bool aliasing_enabled_ = false;
 };
 
 
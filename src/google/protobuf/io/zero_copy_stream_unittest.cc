@@ -35,6 +35,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <functional>
 #include <iterator>
 #include <memory>
 #include <sstream>
@@ -46,6 +47,7 @@
 #include "google/protobuf/testing/file.h"
 #include "google/protobuf/testing/file.h"
 #include "google/protobuf/testing/googletest.h"
+#include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
@@ -54,6 +56,7 @@
 #include "absl/strings/cord_buffer.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/io/buffer_pool.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/io_win32.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
@@ -62,6 +65,13 @@
 #if HAVE_ZLIB
 #include "google/protobuf/io/gzip_stream.h"
 #endif
+#if HAVE_ZSTD
+#include "google/protobuf/io/zstd_stream.h"
+#endif
+#if HAVE_LZ4
+#include "google/protobuf/io/lz4_stream.h"
+#include "lz4.h"
+#endif
 
 
 // Must be included last.
@@ -689,8 +699,443 @@ TEST_F(IoTest, GzipInputByteCountAfterClosedConcatenatedStreams) {
     EXPECT_EQ(total_size, gz_input.ByteCount());
   }
 }
+
+TEST_F(IoTest, GzipIoParallel) {
+  std::string data;
+  for (int i = 0; i < 20000; i++) {
+    absl::StrAppend(&data, "line ", i % 1000, ": ", i * 7919 % 65536, "\n");
+  }
+  for (GzipOutputStream::Format format :
+       {GzipOutputStream::GZIP, GzipOutputStream::ZLIB}) {
+    GzipOutputStream::Options options;
+    options.format = format;
+    std::string serial = Compress(data, options);
+    for (int block_size : {1, 7, 1000, 40 * 1024, 128 * 1024}) {
+      options.num_threads = 3;
+      options.parallel_block_size = block_size;
+      std::string parallel = Compress(data, options);
+      EXPECT_TRUE(Uncompress(parallel) == data) << block_size;
+      if (block_size >= 40 * 1024) {
+        // Priming with the previous block keeps the cost of splitting low.
+        EXPECT_LT(parallel.size(), serial.size() * 1.02) << block_size;
+      }
+    }
+  }
+}
+
+TEST_F(IoTest, GzipIoParallelStuff) {
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    for (int z = 0; z < kBlockSizeCount; z++) {
+      std::string compressed;
+      {
+        StringOutputStream output(&compressed);
+        GzipOutputStream::Options options;
+        options.num_threads = 2;
+        if (kBlockSizes[z] != -1) {
+          options.parallel_block_size = kBlockSizes[z];
+        }
+        GzipOutputStream gzout(&output, options);
+        WriteStuff(&gzout);
+        EXPECT_TRUE(gzout.Flush());
+        // A flush without new data is a no-op.
+        EXPECT_TRUE(gzout.Flush());
+        EXPECT_TRUE(gzout.Close());
+      }
+      ArrayInputStream input(compressed.data(), compressed.size(),
+                             kBlockSizes[i]);
+      GzipInputStream gzin(&input, GzipInputStream::GZIP);
+      ReadStuff(&gzin);
+    }
+  }
+}
+
+TEST_F(IoTest, GzipIoParallelReadAfterFlush) {
+  std::string compressed;
+  StringOutputStream output(&compressed);
+  GzipOutputStream::Options options;
+  options.num_threads = 4;
+  options.parallel_block_size = 3;
+  GzipOutputStream gzout(&output, options);
+  WriteStuff(&gzout);
+  EXPECT_TRUE(gzout.Flush());
+
+  ArrayInputStream input(compressed.data(), compressed.size());
+  GzipInputStream gzin(&input, GzipInputStream::GZIP);
+  ReadStuff(&gzin, false);
+  EXPECT_TRUE(gzout.Close());
+}
+
+TEST_F(IoTest, GzipIoParallelEmpty) {
+  GzipOutputStream::Options options;
+  options.num_threads = 2;
+  std::string compressed = Compress("", options);
+  EXPECT_FALSE(compressed.empty());
+  EXPECT_EQ(Uncompress(compressed), "");
+}
+
+TEST_F(IoTest, GzipIoParallelWithExecutor) {
+  std::string data;
+  for (int i = 0; i < 20000; i++) {
+    absl::StrAppend(&data, "line ", i, "\n");
+  }
+
+  // Runs each task right away.
+  int tasks = 0;
+  GzipOutputStream::Options options;
+  options.num_threads = 4;
+  options.parallel_block_size = 4096;
+  options.executor = [&tasks](std::function<void()> task) {
+    ++tasks;
+    task();
+  };
+  EXPECT_TRUE(Uncompress(Compress(data, options)) == data);
+  EXPECT_EQ(tasks, data.size() / 4096 + 1);
+
+  // Runs each task on its own thread.
+  std::vector<std::thread> threads;
+  options.executor = [&threads](std::function<void()> task) {
+    threads.emplace_back(std::move(task));
+  };
+  std::string compressed = Compress(data, options);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_TRUE(Uncompress(compressed) == data);
+}
 #endif
 
+#if HAVE_ZSTD
+TEST_F(IoTest, ZstdIo) {
+  const int kBufferSize = 2 * 1024;
+  std::unique_ptr<uint8_t[]> buffer(new uint8_t[kBufferSize]);
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    for (int j = 0; j < kBlockSizeCount; j++) {
+      for (int z = 0; z < kBlockSizeCount; z++) {
+        int zstd_buffer_size = kBlockSizes[z];
+        int size;
+        {
+          ArrayOutputStream output(buffer.get(), kBufferSize, kBlockSizes[i]);
+          ZstdOutputStream::Options options;
+          if (zstd_buffer_size != -1) {
+            options.buffer_size = zstd_buffer_size;
+          }
+          ZstdOutputStream zout(&output, options);
+          WriteStuff(&zout);
+          EXPECT_TRUE(zout.Flush());
+          EXPECT_TRUE(zout.Close());
+          EXPECT_EQ(zout.ZstdErrorMessage(), nullptr);
+          size = output.ByteCount();
+        }
+        {
+          ArrayInputStream input(buffer.get(), size, kBlockSizes[j]);
+          ZstdInputStream zin(&input, zstd_buffer_size);
+          ReadStuff(&zin);
+          EXPECT_EQ(zin.ZstdErrorMessage(), nullptr);
+        }
+      }
+    }
+  }
+}
+
+TEST_F(IoTest, ZstdIoLargeWithOptions) {
+  ZstdOutputStream::Options options;
+  options.compression_level = 1;
+  options.checksum = true;
+  // Use background threads if this libzstd supports them.
+  if (ZSTD_cParam_getBounds(ZSTD_c_nbWorkers).upperBound > 0) {
+    options.num_workers = 2;
+  }
+  std::string compressed;
+  {
+    StringOutputStream output(&compressed);
+    ZstdOutputStream zout(&output, options);
+    WriteStuffLarge(&zout);
+    EXPECT_TRUE(zout.Close());
+  }
+  EXPECT_LT(compressed.size(), 1000);
+  ArrayInputStream input(compressed.data(), compressed.size());
+  ZstdInputStream zin(&input);
+  ReadStuffLarge(&zin);
+  EXPECT_EQ(zin.ZstdErrorMessage(), nullptr);
+}
+
+TEST_F(IoTest, ZstdEmptyStream) {
+  std::string compressed;
+  {
+    StringOutputStream output(&compressed);
+    ZstdOutputStream zout(&output);
+    EXPECT_TRUE(zout.Flush());
+    EXPECT_TRUE(zout.Close());
+  }
+  // An empty frame, so the output is valid zstd.
+  EXPECT_FALSE(compressed.empty());
+  ArrayInputStream input(compressed.data(), compressed.size());
+  ZstdInputStream zin(&input);
+  uint8_t byte;
+  EXPECT_EQ(ReadFromInput(&zin, &byte, 1), 0);
+  EXPECT_EQ(zin.ZstdErrorMessage(), nullptr);
+}
+
+TEST_F(IoTest, ZstdFramesAtMessageBoundaries) {
+  std::string compressed;
+  std::vector<int64_t> frame_offsets;
+  {
+    StringOutputStream output(&compressed);
+    ZstdOutputStream zout(&output);
+    for (int batch = 0; batch < 3; batch++) {
+      frame_offsets.push_back(output.ByteCount());
+      {
+        CodedOutputStream coded(&zout);
+        for (int i = 0; i < 100; i++) {
+          std::string record = absl::StrCat("record ", batch, " ", i);
+          coded.WriteVarint32(record.size());
+          coded.WriteString(record);
+        }
+      }
+      EXPECT_TRUE(zout.EndFrame());
+      // Nothing was written since the frame ended.
+      EXPECT_TRUE(zout.EndFrame());
+    }
+    EXPECT_TRUE(zout.Close());
+  }
+
+  // Each frame decompresses on its own, starting at a record.
+  for (int batch = 0; batch < 3; batch++) {
+    ArrayInputStream input(compressed.data() + frame_offsets[batch],
+                           compressed.size() - frame_offsets[batch], 7);
+    ZstdInputStream zin(&input);
+    CodedInputStream coded(&zin);
+    for (int b = batch; b < 3; b++) {
+      for (int i = 0; i < 100; i++) {
+        uint32_t size;
+        std::string record;
+        ASSERT_TRUE(coded.ReadVarint32(&size));
+        ASSERT_TRUE(coded.ReadString(&record, size));
+        EXPECT_EQ(record, absl::StrCat("record ", b, " ", i));
+      }
+    }
+    uint32_t size;
+    EXPECT_FALSE(coded.ReadVarint32(&size));
+    EXPECT_EQ(zin.ZstdErrorMessage(), nullptr);
+  }
+}
+
+TEST_F(IoTest, ZstdDictionary) {
+  const std::string dictionary =
+      "field_name: \"value\" other_field: 12345 repeated_field: [1, 2, 3]";
+  std::string data;
+  for (int i = 0; i < 50; i++) {
+    absl::StrAppend(&data, dictionary, i);
+  }
+
+  ZstdOutputStream::Options options;
+  options.dictionary = dictionary;
+  std::string compressed;
+  {
+    StringOutputStream output(&compressed);
+    ZstdOutputStream zout(&output, options);
+    WriteString(&zout, data);
+    EXPECT_TRUE(zout.EndFrame());
+    WriteString(&zout, data);
+    EXPECT_TRUE(zout.Close());
+  }
+
+  ZstdInputStream::Options input_options;
+  input_options.dictionary = dictionary;
+  {
+    ArrayInputStream input(compressed.data(), compressed.size());
+    ZstdInputStream zin(&input, input_options);
+    ReadString(&zin, data + data);
+    uint8_t byte;
+    EXPECT_EQ(ReadFromInput(&zin, &byte, 1), 0);
+    EXPECT_EQ(zin.ZstdErrorMessage(), nullptr);
+  }
+  {
+    ArrayInputStream input(compressed.data(), compressed.size());
+    ZstdInputStream zin(&input);
+    const void* out;
+    int size;
+    EXPECT_FALSE(zin.Next(&out, &size));
+    EXPECT_NE(zin.ZstdErrorMessage(), nullptr);
+  }
+}
+
+TEST_F(IoTest, ZstdTruncatedInput) {
+  std::string compressed;
+  {
+    StringOutputStream output(&compressed);
+    ZstdOutputStream zout(&output);
+    WriteStuffLarge(&zout);
+    EXPECT_TRUE(zout.Close());
+  }
+  ArrayInputStream input(compressed.data(), compressed.size() - 1);
+  ZstdInputStream zin(&input);
+  const void* out;
+  int size;
+  while (zin.Next(&out, &size)) {
+  }
+  EXPECT_NE(zin.ZstdErrorMessage(), nullptr);
+  EXPECT_LT(zin.ByteCount(), 200055);
+}
+#endif  // HAVE_ZSTD
+
+#if HAVE_LZ4
+TEST_F(IoTest, Lz4Io) {
+  const int kBufferSize = 2 * 1024;
+  std::unique_ptr<uint8_t[]> buffer(new uint8_t[kBufferSize]);
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    for (int j = 0; j < kBlockSizeCount; j++) {
+      for (int z = 0; z < kBlockSizeCount; z++) {
+        int lz4_buffer_size = kBlockSizes[z];
+        int size;
+        {
+          ArrayOutputStream output(buffer.get(), kBufferSize, kBlockSizes[i]);
+          Lz4OutputStream::Options options;
+          if (lz4_buffer_size != -1) {
+            options.buffer_size = lz4_buffer_size;
+          }
+          Lz4OutputStream lzout(&output, options);
+          WriteStuff(&lzout);
+          EXPECT_TRUE(lzout.Flush());
+          EXPECT_TRUE(lzout.Close());
+          EXPECT_EQ(lzout.Lz4ErrorMessage(), nullptr);
+          size = output.ByteCount();
+        }
+        {
+          ArrayInputStream input(buffer.get(), size, kBlockSizes[j]);
+          Lz4InputStream lzin(&input, lz4_buffer_size);
+          ReadStuff(&lzin);
+          EXPECT_EQ(lzin.Lz4ErrorMessage(), nullptr);
+        }
+      }
+    }
+  }
+}
+
+TEST_F(IoTest, Lz4IoLargeWithOptions) {
+  for (int level : {0, 9}) {
+    Lz4OutputStream::Options options;
+    options.compression_level = level;
+    options.checksum = true;
+    std::string compressed;
+    {
+      StringOutputStream output(&compressed);
+      Lz4OutputStream lzout(&output, options);
+      WriteStuffLarge(&lzout);
+      EXPECT_TRUE(lzout.Close());
+    }
+    EXPECT_LT(compressed.size(), 10000);
+    ArrayInputStream input(compressed.data(), compressed.size());
+    Lz4InputStream lzin(&input);
+    ReadStuffLarge(&lzin);
+    EXPECT_EQ(lzin.Lz4ErrorMessage(), nullptr);
+  }
+}
+
+TEST_F(IoTest, Lz4FramesAtMessageBoundaries) {
+  std::string compressed;
+  std::vector<int64_t> frame_offsets;
+  {
+    StringOutputStream output(&compressed);
+    Lz4OutputStream lzout(&output);
+    for (int batch = 0; batch < 3; batch++) {
+      frame_offsets.push_back(output.ByteCount());
+      {
+        CodedOutputStream coded(&lzout);
+        for (int i = 0; i < 100; i++) {
+          std::string record = absl::StrCat("record ", batch, " ", i);
+          coded.WriteVarint32(record.size());
+          coded.WriteString(record);
+        }
+      }
+      EXPECT_TRUE(lzout.EndFrame());
+      EXPECT_TRUE(lzout.EndFrame());
+    }
+    EXPECT_TRUE(lzout.Close());
+  }
+
+  for (int batch = 0; batch < 3; batch++) {
+    ArrayInputStream input(compressed.data() + frame_offsets[batch],
+                           compressed.size() - frame_offsets[batch], 7);
+    Lz4InputStream lzin(&input);
+    CodedInputStream coded(&lzin);
+    for (int b = batch; b < 3; b++) {
+      for (int i = 0; i < 100; i++) {
+        uint32_t size;
+        std::string record;
+        ASSERT_TRUE(coded.ReadVarint32(&size));
+        ASSERT_TRUE(coded.ReadString(&record, size));
+        EXPECT_EQ(record, absl::StrCat("record ", b, " ", i));
+      }
+    }
+    uint32_t size;
+    EXPECT_FALSE(coded.ReadVarint32(&size));
+    EXPECT_EQ(lzin.Lz4ErrorMessage(), nullptr);
+  }
+}
+
+TEST_F(IoTest, Lz4Dictionary) {
+  const std::string dictionary =
+      "field_name: \"value\" other_field: 12345 repeated_field: [1, 2, 3]";
+  std::string data;
+  for (int i = 0; i < 50; i++) {
+    absl::StrAppend(&data, dictionary, i);
+  }
+
+  Lz4OutputStream::Options options;
+  options.dictionary = dictionary;
+  std::string compressed;
+  {
+    StringOutputStream output(&compressed);
+    Lz4OutputStream lzout(&output, options);
+#if LZ4_VERSION_NUMBER >= 11000
+    WriteString(&lzout, data);
+    EXPECT_TRUE(lzout.EndFrame());
+    WriteString(&lzout, data);
+    EXPECT_TRUE(lzout.Close());
+#else
+    EXPECT_NE(lzout.Lz4ErrorMessage(), nullptr);
+    EXPECT_FALSE(lzout.Close());
+#endif
+  }
+
+  Lz4InputStream::Options input_options;
+  input_options.dictionary = dictionary;
+  ArrayInputStream input(compressed.data(), compressed.size());
+  Lz4InputStream lzin(&input, input_options);
+#if LZ4_VERSION_NUMBER >= 11000
+  ReadString(&lzin, data + data);
+  uint8_t byte;
+  EXPECT_EQ(ReadFromInput(&lzin, &byte, 1), 0);
+  EXPECT_EQ(lzin.Lz4ErrorMessage(), nullptr);
+#else
+  // Older versions of liblz4 have no stable dictionary API.
+  EXPECT_TRUE(compressed.empty());
+  const void* out;
+  int size;
+  EXPECT_FALSE(lzin.Next(&out, &size));
+  EXPECT_NE(lzin.Lz4ErrorMessage(), nullptr);
+#endif
+}
+
+TEST_F(IoTest, Lz4TruncatedInput) {
+  std::string compressed;
+  {
+    StringOutputStream output(&compressed);
+    Lz4OutputStream lzout(&output);
+    WriteStuffLarge(&lzout);
+    EXPECT_TRUE(lzout.Close());
+  }
+  ArrayInputStream input(compressed.data(), compressed.size() - 1);
+  Lz4InputStream lzin(&input);
+  const void* out;
+  int size;
+  while (lzin.Next(&out, &size)) {
+  }
+  EXPECT_NE(lzin.Lz4ErrorMessage(), nullptr);
+}
+#endif  // HAVE_LZ4
+
 // There is no string input, only string output.  Also, it doesn't support
 // explicit block sizes.  So, we'll only run one test and we'll use
 // ArrayInput to read back the results.
@@ -1325,6 +1770,36 @@ TEST(CordOutputStreamTest, SizeDoublesWithoutHint) {
   }
 }
 
+TEST(CordOutputStreamTest, AliasesLargeWrites) {
+  EXPECT_FALSE(CordOutputStream().AllowsAliasing());
+
+  const std::string small(100, 's');
+  const std::string large(10000, 'l');
+  CordOutputStream output(absl::Cord("existing:"));
+  output.EnableAliasing(true);
+  ASSERT_TRUE(output.AllowsAliasing());
+  EXPECT_TRUE(output.WriteAliasedRaw(small.data(), small.size()));
+  EXPECT_TRUE(output.WriteAliasedRaw(large.data(), large.size()));
+  void* data;
+  int size;
+  ASSERT_TRUE(output.Next(&data, &size));
+  memset(data, 'n', static_cast<size_t>(size));
+  output.BackUp(size - 1);
+  EXPECT_EQ(output.ByteCount(), 9 + small.size() + large.size() + 1);
+
+  absl::Cord cord = output.Consume();
+  EXPECT_EQ(cord, absl::StrCat("existing:", small, large, "n"));
+  int aliased_chunks = 0;
+  for (absl::string_view chunk : cord.Chunks()) {
+    EXPECT_NE(chunk.data(), small.data());
+    if (chunk.data() == large.data()) {
+      EXPECT_EQ(chunk.size(), large.size());
+      ++aliased_chunks;
+    }
+  }
+  EXPECT_EQ(aliased_chunks, 1);
+}
+
 TEST_F(IoTest, WriteSmallCord) {
   absl::Cord source;
   source.Append("foo bar");
@@ -1432,6 +1907,291 @@ TEST_F(IoTest, FileIo) {
   }
 }
 
+TEST_F(IoTest, AdaptiveFileIo) {
+  std::string filename =
+      absl::StrCat(TestTempDir(), "/zero_copy_stream_test_file");
+
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    int file =
+        open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+    ASSERT_GE(file, 0);
+
+    {
+      FileOutputStream output(file, kBlockSizes[i]);
+      output.SetAdaptiveBlockSize(1 << 16);
+      WriteStuff(&output);
+      EXPECT_EQ(0, output.GetErrno());
+    }
+
+    ASSERT_NE(lseek(file, 0, SEEK_SET), (off_t)-1);
+
+    {
+      FileInputStream input(file, kBlockSizes[i]);
+      input.SetBufferAlignment(512);
+      input.SetAdaptiveBlockSize(1 << 16);
+      ReadStuff(&input);
+      EXPECT_EQ(0, input.GetErrno());
+    }
+
+    close(file);
+  }
+}
+
+// Returns up to `available` bytes per read, and records the sizes asked for.
+class RecordingInputStream : public CopyingInputStream {
+ public:
+  RecordingInputStream(int total, int available)
+      : remaining_(total), available_(available) {}
+
+  int Read(void* buffer, int size) override {
+    sizes_.push_back(size);
+    int n = std::min({size, available_, remaining_});
+    memset(buffer, 'x', n);
+    remaining_ -= n;
+    return n;
+  }
+
+  const std::vector<int>& sizes() const { return sizes_; }
+
+ private:
+  int remaining_;
+  int available_;
+  std::vector<int> sizes_;
+};
+
+TEST(CopyingInputStreamAdaptorTest, AdaptiveBlockSizeGrowsOnFullReads) {
+  RecordingInputStream stream(100000, 1 << 20);
+  CopyingInputStreamAdaptor input(&stream, 1024);
+  input.SetAdaptiveBlockSize(8192);
+  const void* data;
+  int size;
+  int64_t total = 0;
+  while (input.Next(&data, &size)) total += size;
+  EXPECT_EQ(total, 100000);
+  ASSERT_GE(stream.sizes().size(), 5);
+  EXPECT_EQ(stream.sizes()[0], 1024);
+  EXPECT_EQ(stream.sizes()[1], 2048);
+  EXPECT_EQ(stream.sizes()[2], 4096);
+  EXPECT_EQ(stream.sizes()[3], 8192);
+  EXPECT_EQ(stream.sizes()[4], 8192);
+}
+
+TEST(CopyingInputStreamAdaptorTest, AdaptiveBlockSizeKeepsSizeOnShortReads) {
+  RecordingInputStream stream(10000, 1000);
+  CopyingInputStreamAdaptor input(&stream, 1024);
+  input.SetAdaptiveBlockSize(8192);
+  const void* data;
+  int size;
+  while (input.Next(&data, &size)) {
+  }
+  for (int requested : stream.sizes()) EXPECT_EQ(requested, 1024);
+}
+
+TEST(CopyingInputStreamAdaptorTest, AlignedBuffer) {
+  RecordingInputStream stream(10000, 1 << 20);
+  CopyingInputStreamAdaptor input(&stream, 1000);
+  input.SetBufferAlignment(512);
+  const void* data;
+  int size;
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(data) % 512, 0);
+  EXPECT_EQ(size, 1024);
+  input.BackUp(24);
+  // Skipping reads whole aligned blocks rather than seeking.
+  EXPECT_TRUE(input.Skip(2000));
+  EXPECT_EQ(input.ByteCount(), 3000);
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ(size, 72);
+  for (int requested : stream.sizes()) EXPECT_EQ(requested, 1024);
+}
+
+class RecordingOutputStream : public CopyingOutputStream {
+ public:
+  bool Write(const void* buffer, int size) override {
+    sizes_.push_back(size);
+    return true;
+  }
+
+  const std::vector<int>& sizes() const { return sizes_; }
+
+ private:
+  std::vector<int> sizes_;
+};
+
+TEST(CopyingOutputStreamAdaptorTest, AdaptiveBlockSize) {
+  RecordingOutputStream stream;
+  {
+    CopyingOutputStreamAdaptor output(&stream, 1024);
+    output.SetAdaptiveBlockSize(4096);
+    void* data;
+    int size;
+    for (int i = 0; i < 5; i++) ASSERT_TRUE(output.Next(&data, &size));
+    output.BackUp(10);
+  }
+  EXPECT_THAT(stream.sizes(), testing::ElementsAre(1024, 2048, 4096, 4096,
+                                                   4096 - 10));
+}
+
+TEST_F(IoTest, PooledIo) {
+  BufferPool::Clear();
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    PooledBuffer buffer;
+    {
+      PooledOutputStream output;
+      WriteStuff(&output);
+      buffer = output.Finish();
+    }
+    {
+      ArrayInputStream input(buffer.data(), buffer.size(), kBlockSizes[i]);
+      ReadStuff(&input);
+    }
+  }
+}
+
+TEST(BufferPoolTest, ReusesReleasedBuffers) {
+  BufferPool::Clear();
+  const char* data;
+  {
+    PooledBuffer buffer = PooledBuffer::Acquire(10000);
+    buffer.mutable_string()->assign(5000, 'x');
+    data = buffer.data();
+  }
+  EXPECT_EQ(BufferPool::NumBuffers(), 1);
+  EXPECT_GE(BufferPool::TotalBytes(), 10000);
+
+  // Smaller and equal requests reuse the storage.
+  PooledBuffer buffer = PooledBuffer::Acquire(8000);
+  EXPECT_EQ(buffer.data(), data);
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(BufferPool::NumBuffers(), 0);
+  EXPECT_EQ(BufferPool::TotalBytes(), 0);
+
+  // Moving the handle does not release the buffer.
+  PooledBuffer moved = std::move(buffer);
+  EXPECT_EQ(moved.data(), data);
+  EXPECT_EQ(BufferPool::NumBuffers(), 0);
+  moved.Reset();
+  EXPECT_EQ(BufferPool::NumBuffers(), 1);
+  BufferPool::Clear();
+}
+
+TEST(BufferPoolTest, PrefersRecentLargeEnoughBuffers) {
+  BufferPool::Clear();
+  std::string small;
+  small.reserve(1000);
+  std::string large;
+  large.reserve(100000);
+  const char* large_data = large.data();
+  BufferPool::Release(std::move(large));
+  BufferPool::Release(std::move(small));
+
+  // The most recent buffer is too small, so the larger one is taken.
+  std::string buffer = BufferPool::Acquire(50000);
+  EXPECT_EQ(buffer.data(), large_data);
+  EXPECT_EQ(BufferPool::NumBuffers(), 1);
+  BufferPool::Clear();
+}
+
+TEST(BufferPoolTest, Limits) {
+  BufferPool::Clear();
+  BufferPool::SetLimits(2, 30000);
+  for (int i = 0; i < 4; i++) {
+    std::string buffer;
+    buffer.reserve(10000);
+    BufferPool::Release(std::move(buffer));
+  }
+  EXPECT_EQ(BufferPool::NumBuffers(), 2);
+
+  // Too large to keep at all.
+  std::string buffer;
+  buffer.reserve(40000);
+  BufferPool::Release(std::move(buffer));
+  EXPECT_EQ(BufferPool::NumBuffers(), 2);
+
+  BufferPool::SetLimits(16, 15000);
+  EXPECT_EQ(BufferPool::NumBuffers(), 1);
+  BufferPool::SetLimits(16, size_t{64} << 20);
+  BufferPool::Clear();
+}
+
+TEST(BufferPoolTest, ThreadsHaveOwnPools) {
+  BufferPool::Clear();
+  std::thread thread([] {
+    PooledBuffer buffer = PooledBuffer::Acquire(10000);
+    buffer.mutable_string()->assign("x");
+  });
+  thread.join();
+  EXPECT_EQ(BufferPool::NumBuffers(), 0);
+}
+
+#ifndef _WIN32
+TEST_F(IoTest, MappedFileIo) {
+  std::string filename =
+      absl::StrCat(TestTempDir(), "/zero_copy_stream_test_file");
+  int file =
+      open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+  ASSERT_GE(file, 0);
+  {
+    FileOutputStream output(file);
+    WriteStuffLarge(&output);
+    EXPECT_EQ(0, output.GetErrno());
+  }
+
+  // Windows of one page and of a few pages are remapped many times over the
+  // ~200KB file; the default window maps it once.
+  const int64_t page_size = sysconf(_SC_PAGESIZE);
+  for (int64_t window_size :
+       {int64_t{1}, 3 * page_size, MappedFileInputStream::kDefaultWindowSize}) {
+    for (int i = 0; i < kBlockSizeCount; i++) {
+      MappedFileInputStream input(file, window_size, kBlockSizes[i]);
+      ReadStuffLarge(&input);
+      EXPECT_EQ(0, input.GetErrno());
+    }
+  }
+
+  {
+    MappedFileInputStream input(file);
+    const void* data;
+    int size;
+    ASSERT_TRUE(input.Next(&data, &size));
+    EXPECT_EQ(size, 200055);
+    input.BackUp(55);
+    EXPECT_FALSE(input.Skip(56));
+    EXPECT_EQ(input.ByteCount(), 200055);
+    EXPECT_FALSE(input.Next(&data, &size));
+  }
+
+  MappedFileInputStream input(file);
+  input.SetCloseOnDelete(true);
+}
+
+TEST_F(IoTest, MappedFileIoEmptyAndUnmappable) {
+  std::string filename =
+      absl::StrCat(TestTempDir(), "/zero_copy_stream_test_file");
+  int file =
+      open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+  ASSERT_GE(file, 0);
+  const void* data;
+  int size;
+  {
+    MappedFileInputStream input(file);
+    EXPECT_FALSE(input.Next(&data, &size));
+    EXPECT_EQ(0, input.GetErrno());
+    EXPECT_TRUE(input.Close());
+  }
+
+  int fd[2];
+  ASSERT_EQ(pipe(fd), 0);
+  {
+    MappedFileInputStream input(fd[0]);
+    EXPECT_FALSE(input.Next(&data, &size));
+    EXPECT_EQ(ENODEV, input.GetErrno());
+  }
+  close(fd[0]);
+  close(fd[1]);
+}
+#endif  // !_WIN32
+
 #ifndef _WIN32
 // This tests the FileInputStream with a non blocking file. It opens a pipe in
 // non blocking mode, then starts reading it. The writing thread starts writing
@@ -1697,6 +2457,50 @@ TEST_F(IoTest, ConcatenatingInputStream) {
   ReadStuff(&input);
 }
 
+// Splits the same buffer as above into fragments of a SpanChainInputStream.
+TEST_F(IoTest, SpanChainInputStream) {
+  const int kBufferSize = 256;
+  char buffer[kBufferSize];
+
+  ArrayOutputStream output(buffer, kBufferSize);
+  WriteStuff(&output);
+
+  ASSERT_EQ(68, output.ByteCount());  // Test depends on this.
+  absl::string_view fragments[] = {
+      absl::string_view(buffer, 12),      absl::string_view(buffer + 12, 7),
+      absl::string_view(buffer + 19, 6),  absl::string_view(buffer + 25, 15),
+      absl::string_view(buffer + 40, 0),  absl::string_view(buffer + 40, 10),
+      absl::string_view(buffer + 50, 18),
+  };
+
+  SpanChainInputStream input(fragments);
+  ReadStuff(&input);
+}
+
+TEST_F(IoTest, SpanChainInputStreamBackUpAndSkip) {
+  absl::string_view fragments[] = {"", "abc", "", "defgh", "ij"};
+  SpanChainInputStream input(fragments);
+
+  const void* data;
+  int size;
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ("abc", absl::string_view(static_cast<const char*>(data), size));
+  input.BackUp(1);
+  EXPECT_EQ(2, input.ByteCount());
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ("c", absl::string_view(static_cast<const char*>(data), size));
+
+  // Skip across a fragment boundary.
+  EXPECT_TRUE(input.Skip(6));
+  EXPECT_EQ(9, input.ByteCount());
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ("j", absl::string_view(static_cast<const char*>(data), size));
+  EXPECT_FALSE(input.Next(&data, &size));
+  EXPECT_TRUE(input.Skip(0));
+  EXPECT_FALSE(input.Skip(1));
+  EXPECT_EQ(10, input.ByteCount());
+}
+
 // To test LimitingInputStream, we write our golden text to a buffer, then
 // create an ArrayInputStream that contains the whole buffer (not just the
 // bytes written), then use a LimitingInputStream to limit it just to the
@@ -0,0 +1,316 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file contains the implementation of classes ZstdInputStream and
+// ZstdOutputStream.
+
+#if HAVE_ZSTD
+#include "google/protobuf/io/zstd_stream.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/log/absl_check.h"
+#include "zstd.h"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+static const char kTruncatedFrame[] = "Truncated zstd frame";
+static const char kSubStreamFailed[] = "Underlying stream failed";
+
+ZstdInputStream::Options::Options()
+    : buffer_size(static_cast<int>(ZSTD_DStreamOutSize())) {}
+
+ZstdInputStream::ZstdInputStream(ZeroCopyInputStream* sub_stream,
+                                 int buffer_size) {
+  Options options;
+  if (buffer_size != -1) {
+    options.buffer_size = buffer_size;
+  }
+  Init(sub_stream, options);
+}
+
+ZstdInputStream::ZstdInputStream(ZeroCopyInputStream* sub_stream,
+                                 const Options& options) {
+  Init(sub_stream, options);
+}
+
+void ZstdInputStream::Init(ZeroCopyInputStream* sub_stream,
+                           const Options& options) {
+  sub_stream_ = sub_stream;
+  error_message_ = nullptr;
+  input_ = {nullptr, 0, 0};
+  ABSL_CHECK_GT(options.buffer_size, 0);
+  output_buffer_length_ = options.buffer_size;
+  output_buffer_ = new char[output_buffer_length_];
+  output_end_ = 0;
+  output_position_ = 0;
+  output_pending_ = false;
+  frame_done_ = true;
+  byte_count_ = 0;
+
+  dctx_ = ZSTD_createDCtx();
+  ABSL_CHECK(dctx_ != nullptr);
+  if (!options.dictionary.empty()) {
+    size_t result = ZSTD_DCtx_loadDictionary(dctx_, options.dictionary.data(),
+                                             options.dictionary.size());
+    if (ZSTD_isError(result)) {
+      error_message_ = ZSTD_getErrorName(result);
+    }
+  }
+}
+
+ZstdInputStream::~ZstdInputStream() {
+  ZSTD_freeDCtx(dctx_);
+  delete[] output_buffer_;
+}
+
+bool ZstdInputStream::Decompress() {
+  output_end_ = 0;
+  output_position_ = 0;
+  while (output_end_ == 0) {
+    // zstd may still hold decompressed data after filling the buffer, so
+    // only read more input once it has room to spare.
+    if (input_.pos == input_.size && !output_pending_) {
+      const void* in;
+      int in_size;
+      if (!sub_stream_->Next(&in, &in_size)) {
+        if (!frame_done_) {
+          error_message_ = kTruncatedFrame;
+        }
+        return false;
+      }
+      input_ = {in, static_cast<size_t>(in_size), 0};
+      if (in_size == 0) continue;
+    }
+    ZSTD_outBuffer output = {output_buffer_, output_buffer_length_, 0};
+    size_t input_position = input_.pos;
+    size_t result = ZSTD_decompressStream(dctx_, &output, &input_);
+    if (ZSTD_isError(result)) {
+      error_message_ = ZSTD_getErrorName(result);
+      return false;
+    }
+    // The next frame, if any, starts automatically.  Without input, zstd
+    // reports what the next frame needs even if there is none.
+    if (output.pos != 0 || input_.pos != input_position) {
+      frame_done_ = result == 0;
+    }
+    output_pending_ = output.pos == output.size;
+    output_end_ = output.pos;
+  }
+  byte_count_ += output_end_;
+  return true;
+}
+
+// implements ZeroCopyInputStream ----------------------------------
+bool ZstdInputStream::Next(const void** data, int* size) {
+  if (output_position_ == output_end_) {
+    if (error_message_ != nullptr || !Decompress()) {
+      return false;
+    }
+  }
+  *data = output_buffer_ + output_position_;
+  *size = static_cast<int>(output_end_ - output_position_);
+  output_position_ = output_end_;
+  return true;
+}
+
+void ZstdInputStream::BackUp(int count) {
+  ABSL_CHECK_GE(count, 0);
+  ABSL_CHECK_LE(static_cast<size_t>(count), output_position_);
+  output_position_ -= count;
+}
+
+bool ZstdInputStream::Skip(int count) {
+  const void* data;
+  int size = 0;
+  bool ok = Next(&data, &size);
+  while (ok && (size < count)) {
+    count -= size;
+    ok = Next(&data, &size);
+  }
+  if (size > count) {
+    BackUp(size - count);
+  }
+  return ok;
+}
+
+int64_t ZstdInputStream::ByteCount() const {
+  return byte_count_ - static_cast<int64_t>(output_end_ - output_position_);
+}
+
+// =========================================================================
+
+ZstdOutputStream::Options::Options()
+    : buffer_size(static_cast<int>(ZSTD_CStreamInSize())),
+      compression_level(ZSTD_CLEVEL_DEFAULT),
+      num_workers(0),
+      checksum(false) {}
+
+ZstdOutputStream::ZstdOutputStream(ZeroCopyOutputStream* sub_stream) {
+  Init(sub_stream, Options());
+}
+
+ZstdOutputStream::ZstdOutputStream(ZeroCopyOutputStream* sub_stream,
+                                   const Options& options) {
+  Init(sub_stream, options);
+}
+
+void ZstdOutputStream::Init(ZeroCopyOutputStream* sub_stream,
+                            const Options& options) {
+  sub_stream_ = sub_stream;
+  error_message_ = nullptr;
+  closed_ = false;
+  output_ = {nullptr, 0, 0};
+  ABSL_CHECK_GT(options.buffer_size, 0);
+  input_buffer_length_ = options.buffer_size;
+  input_buffer_ = new char[input_buffer_length_];
+  input_length_ = 0;
+  byte_count_ = 0;
+  frame_open_ = false;
+  wrote_frame_ = false;
+
+  cctx_ = ZSTD_createCCtx();
+  ABSL_CHECK(cctx_ != nullptr);
+  // Parameters and the dictionary stay in effect for every frame.
+  size_t result = ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel,
+                                         options.compression_level);
+  if (!ZSTD_isError(result)) {
+    result = ZSTD_CCtx_setParameter(cctx_, ZSTD_c_checksumFlag,
+                                    options.checksum ? 1 : 0);
+  }
+  if (!ZSTD_isError(result) && options.num_workers > 0) {
+    result = ZSTD_CCtx_setParameter(cctx_, ZSTD_c_nbWorkers,
+                                    options.num_workers);
+  }
+  if (!ZSTD_isError(result) && !options.dictionary.empty()) {
+    result = ZSTD_CCtx_loadDictionary(cctx_, options.dictionary.data(),
+                                      options.dictionary.size());
+  }
+  if (ZSTD_isError(result)) {
+    error_message_ = ZSTD_getErrorName(result);
+  }
+}
+
+ZstdOutputStream::~ZstdOutputStream() {
+  Close();
+  ZSTD_freeCCtx(cctx_);
+  delete[] input_buffer_;
+}
+
+// private
+bool ZstdOutputStream::Compress(ZSTD_EndDirective directive) {
+  ZSTD_inBuffer input = {input_buffer_, input_length_, 0};
+  while (true) {
+    if (output_.pos == output_.size) {
+      void* data;
+      int size;
+      if (!sub_stream_->Next(&data, &size)) {
+        output_ = {nullptr, 0, 0};
+        error_message_ = kSubStreamFailed;
+        return false;
+      }
+      output_ = {data, static_cast<size_t>(size), 0};
+      if (size == 0) continue;
+    }
+    size_t remaining =
+        ZSTD_compressStream2(cctx_, &output_, &input, directive);
+    if (ZSTD_isError(remaining)) {
+      error_message_ = ZSTD_getErrorName(remaining);
+      return false;
+    }
+    if (directive == ZSTD_e_continue ? input.pos == input.size
+                                     : remaining == 0) {
+      break;
+    }
+  }
+  if (input_length_ != 0) {
+    frame_open_ = true;
+  }
+  byte_count_ += input_length_;
+  input_length_ = 0;
+  if (directive != ZSTD_e_continue) {
+    // Notify lower layer of data.
+    sub_stream_->BackUp(static_cast<int>(output_.size - output_.pos));
+    // We don't own the buffer anymore.
+    output_ = {nullptr, 0, 0};
+  }
+  if (directive == ZSTD_e_end) {
+    frame_open_ = false;
+    wrote_frame_ = true;
+  }
+  return true;
+}
+
+// implements ZeroCopyOutputStream ---------------------------------
+bool ZstdOutputStream::Next(void** data, int* size) {
+  if (closed_ || error_message_ != nullptr) {
+    return false;
+  }
+  if (input_length_ != 0 && !Compress(ZSTD_e_continue)) {
+    return false;
+  }
+  input_length_ = input_buffer_length_;
+  *data = input_buffer_;
+  *size = static_cast<int>(input_buffer_length_);
+  return true;
+}
+
+void ZstdOutputStream::BackUp(int count) {
+  ABSL_CHECK_GE(count, 0);
+  ABSL_CHECK_LE(static_cast<size_t>(count), input_length_);
+  input_length_ -= count;
+}
+
+int64_t ZstdOutputStream::ByteCount() const {
+  return byte_count_ + static_cast<int64_t>(input_length_);
+}
+
+bool ZstdOutputStream::Flush() {
+  if (closed_ || error_message_ != nullptr) {
+    return false;
+  }
+  // Flushing before any data would start a frame with only a header.
+  if (!frame_open_ && input_length_ == 0) {
+    return true;
+  }
+  return Compress(ZSTD_e_flush);
+}
+
+bool ZstdOutputStream::EndFrame() {
+  if (closed_ || error_message_ != nullptr) {
+    return false;
+  }
+  if (!frame_open_ && input_length_ == 0) {
+    return true;
+  }
+  return Compress(ZSTD_e_end);
+}
+
+bool ZstdOutputStream::Close() {
+  if (closed_) {
+    return false;
+  }
+  closed_ = true;
+  if (error_message_ != nullptr) {
+    return false;
+  }
+  // Write an empty frame for empty input, so the output is a valid zstd
+  // stream.
+  if (!frame_open_ && input_length_ == 0 && wrote_frame_) {
+    return true;
+  }
+  return Compress(ZSTD_e_end);
+}
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // HAVE_ZSTD
@@ -0,0 +1,203 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file contains the definition for classes ZstdInputStream and
+// ZstdOutputStream.
+//
+// ZstdInputStream decompresses data from an underlying ZeroCopyInputStream
+// holding one or more Zstandard frames and provides the decompressed data as
+// a ZeroCopyInputStream.
+//
+// ZstdOutputStream is a ZeroCopyOutputStream that compresses data to an
+// underlying ZeroCopyOutputStream.
+
+#ifndef GOOGLE_PROTOBUF_IO_ZSTD_STREAM_H__
+#define GOOGLE_PROTOBUF_IO_ZSTD_STREAM_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "zstd.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+// A ZeroCopyInputStream that reads compressed data through zstd.
+// Concatenated frames are decompressed as one stream.
+class PROTOBUF_EXPORT ZstdInputStream final : public ZeroCopyInputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    // What size buffer to use internally.  Defaults to
+    // ZSTD_DStreamOutSize(), 128kB.
+    int buffer_size;
+
+    // The dictionary the data was compressed with, if any.  The stream
+    // keeps its own copy.
+    absl::string_view dictionary;
+
+    Options();  // Initializes with default values.
+  };
+
+  // buffer_size may be -1 for the default.
+  explicit ZstdInputStream(ZeroCopyInputStream* sub_stream,
+                           int buffer_size = -1);
+  ZstdInputStream(ZeroCopyInputStream* sub_stream, const Options& options);
+  ZstdInputStream(const ZstdInputStream&) = delete;
+  ZstdInputStream& operator=(const ZstdInputStream&) = delete;
+  ~ZstdInputStream() override;
+
+  // Return last error message or NULL if no error.  Input that ends in the
+  // middle of a frame is an error.
+  inline const char* ZstdErrorMessage() const { return error_message_; }
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  ZeroCopyInputStream* sub_stream_;
+  ZSTD_DCtx* dctx_;
+  const char* error_message_;
+
+  ZSTD_inBuffer input_;
+  char* output_buffer_;
+  size_t output_buffer_length_;
+  // Decompressed bytes in output_buffer_, and how many were returned.
+  size_t output_end_;
+  size_t output_position_;
+  // The last call filled the output buffer, so zstd may hold more output.
+  bool output_pending_;
+  // The last frame has been fully decompressed.
+  bool frame_done_;
+  int64_t byte_count_;
+
+  void Init(ZeroCopyInputStream* sub_stream, const Options& options);
+  bool Decompress();
+};
+
+class PROTOBUF_EXPORT ZstdOutputStream final : public ZeroCopyOutputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    // What size buffer to use internally.  Defaults to
+    // ZSTD_CStreamInSize(), 128kB.
+    int buffer_size;
+
+    // A number between ZSTD_minCLevel() and ZSTD_maxCLevel(), where higher
+    // levels compress better and slower.  Defaults to ZSTD_CLEVEL_DEFAULT.
+    int compression_level;
+
+    // Number of background threads compressing in parallel.  With 0, the
+    // default, all compression happens on the calling thread.  Requires a
+    // libzstd built with multithreading support; otherwise the stream fails
+    // with an error.
+    int num_workers;
+
+    // Whether each frame carries a checksum of its content.  Defaults to
+    // false.
+    bool checksum;
+
+    // A raw or trained (see ZDICT_trainFromBuffer()) dictionary to compress
+    // with.  Readers need the same dictionary.  The stream keeps its own
+    // copy.
+    absl::string_view dictionary;
+
+    Options();  // Initializes with default values.
+  };
+
+  // Create a ZstdOutputStream with default options.
+  explicit ZstdOutputStream(ZeroCopyOutputStream* sub_stream);
+
+  // Create a ZstdOutputStream with the given options.
+  ZstdOutputStream(ZeroCopyOutputStream* sub_stream, const Options& options);
+  ZstdOutputStream(const ZstdOutputStream&) = delete;
+  ZstdOutputStream& operator=(const ZstdOutputStream&) = delete;
+
+  ~ZstdOutputStream() override;
+
+  // Return last error message or NULL if no error.
+  inline const char* ZstdErrorMessage() const { return error_message_; }
+
+  // Flushes data written so far to compressed data in the underlying stream,
+  // within the current frame.  It is the caller's responsibility to flush the
+  // underlying stream if necessary.
+  // Compression may be less efficient stopping and starting around flushes.
+  // Returns true if no error.
+  bool Flush();
+
+  // Ends the current frame after the data written so far; later data starts
+  // a new frame.  Each frame can be decompressed on its own, so ending frames
+  // right after writing delimited messages lets readers start decompressing
+  // at any frame, e.g. at offsets recorded from the underlying stream's
+  // ByteCount() after each EndFrame():
+  //
+  //   for (const std::vector<Record>& batch : batches) {
+  //     index.push_back(file_stream.ByteCount());
+  //     for (const Record& record : batch) {
+  //       util::SerializeDelimitedToZeroCopyStream(record, &zstd_stream);
+  //     }
+  //     zstd_stream.EndFrame();
+  //   }
+  //
+  // Does nothing if no data was written since the last frame ended.
+  // Returns true if no error.
+  bool EndFrame();
+
+  // Writes out all data and ends the last frame.
+  // It is the caller's responsibility to close the underlying stream if
+  // necessary.
+  // Returns true if no error.
+  bool Close();
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  ZeroCopyOutputStream* sub_stream_;
+  ZSTD_CCtx* cctx_;
+  const char* error_message_;
+  bool closed_;
+
+  // Result from calling Next() on sub_stream_, and how much of it is used.
+  ZSTD_outBuffer output_;
+
+  char* input_buffer_;
+  size_t input_buffer_length_;
+  // Bytes of input_buffer_ holding data not yet passed to zstd.
+  size_t input_length_;
+  // Bytes passed to zstd.
+  int64_t byte_count_;
+  // Data was passed to zstd since the current frame started.
+  bool frame_open_;
+  // A frame has been ended.
+  bool wrote_frame_;
+
+  // Shared constructor code.
+  void Init(ZeroCopyOutputStream* sub_stream, const Options& options);
+
+  // Passes the buffered input to zstd with the given directive, returning
+  // the unused part of the output to sub_stream_ unless it's
+  // ZSTD_e_continue.  Returns false on error.
+  bool Compress(ZSTD_EndDirective directive);
+};
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_IO_ZSTD_STREAM_H__
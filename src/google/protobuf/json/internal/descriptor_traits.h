@@ -168,21 +168,9 @@ struct Proto2Descriptor {
 
   static absl::optional<Field> FieldByName(const Desc& d,
                                            absl::string_view name) {
-    if (const auto* field = d.FindFieldByCamelcaseName(name)) {
+    if (const auto* field = internal::FindFieldByJsonKey(&d, name)) {
       return field;
     }
-
-    if (const auto* field = d.FindFieldByName(name)) {
-      return field;
-    }
-
-    for (int i = 0; i < d.field_count(); ++i) {
-      const auto* field = d.field(i);
-      if (field->has_json_name() && field->json_name() == name) {
-        return field;
-      }
-    }
-
     return absl::nullopt;
   }
 
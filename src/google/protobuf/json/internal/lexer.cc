@@ -13,6 +13,7 @@
 #include <cfloat>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <limits>
 #include <ostream>
@@ -20,8 +21,9 @@
 #include <utility>
 
 #include "absl/algorithm/container.h"
+#include "absl/base/attributes.h"
+#include "absl/base/config.h"
 #include "absl/log/absl_check.h"
-#include "absl/numeric/bits.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/ascii.h"
@@ -29,6 +31,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/utf8_util.h"
 #include "google/protobuf/stubs/status_macros.h"
 
 // Must be included last.
@@ -75,6 +78,70 @@ void HardenAgainstHyrumsLaw(absl::string_view to_obfuscate, std::string& out) {
     }
   }
 }
+
+// Returns whether `c` can be copied as is from a string literal: it is
+// printable ASCII and neither a quote nor a backslash.
+bool IsPlainStringChar(char c) {
+  uint8_t uc = static_cast<uint8_t>(c);
+  return uc >= 0x20 && uc < 0x80 && c != '"' && c != '\\' && c != '\'';
+}
+
+// Returns the length of the prefix of `data` made of plain string characters,
+// see IsPlainStringChar().  Most string literals are all plain, so they are
+// scanned eight bytes at a time.
+size_t PlainStringPrefix(absl::string_view data) {
+  size_t i = 0;
+#ifdef ABSL_IS_LITTLE_ENDIAN
+  constexpr uint64_t kOnes = ~uint64_t{0} / 0xff;
+  constexpr uint64_t kHighBits = kOnes * 0x80;
+  for (; i + sizeof(uint64_t) <= data.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data.data() + i, sizeof(word));
+    // Sets the high bit of each byte that is below 0x20, or equal to one of
+    // the quotes or the backslash, or is not ASCII.  Bytes above the first
+    // such byte may be set spuriously, but the first one is always exact.
+    auto has_zero_byte = [&](uint64_t x) { return (x - kOnes) & ~x; };
+    uint64_t special = ((word - kOnes * 0x20) & ~word) |
+                       has_zero_byte(word ^ (kOnes * '"')) |
+                       has_zero_byte(word ^ (kOnes * '\\')) |
+                       has_zero_byte(word ^ (kOnes * '\'')) | word;
+    special &= kHighBits;
+    if (special != 0) {
+      return i + static_cast<size_t>(absl::countr_zero(special)) / 8;
+    }
+  }
+#endif  // ABSL_IS_LITTLE_ENDIAN
+  while (i < data.size() && IsPlainStringChar(data[i])) ++i;
+  return i;
+}
+
+// Returns the index of the first quote or backslash in `data` at or after
+// `i`, or `data.size()` if there is none.  Like PlainStringPrefix(), this
+// scans eight bytes at a time.
+size_t FindQuoteOrBackslash(absl::string_view data, size_t i) {
+#ifdef ABSL_IS_LITTLE_ENDIAN
+  constexpr uint64_t kOnes = ~uint64_t{0} / 0xff;
+  constexpr uint64_t kHighBits = kOnes * 0x80;
+  for (; i + sizeof(uint64_t) <= data.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data.data() + i, sizeof(word));
+    auto has_zero_byte = [&](uint64_t x) { return (x - kOnes) & ~x; };
+    uint64_t special = (has_zero_byte(word ^ (kOnes * '"')) |
+                        has_zero_byte(word ^ (kOnes * '\\'))) &
+                       kHighBits;
+    if (special != 0) {
+      return i + static_cast<size_t>(absl::countr_zero(special)) / 8;
+    }
+  }
+#endif  // ABSL_IS_LITTLE_ENDIAN
+  while (i < data.size() && data[i] != '"' && data[i] != '\\') ++i;
+  return i;
+}
+
+// Returns whether `c` can be part of a number or a literal.
+bool IsScalarChar(char c) {
+  return absl::ascii_isalnum(c) || c == '-' || c == '+' || c == '.';
+}
 }  // namespace
 
 constexpr size_t ParseOptions::kDefaultDepth;
@@ -139,6 +206,12 @@ absl::Status JsonLexer::SkipValue() {
   absl::StatusOr<Kind> kind = PeekKind();
   RETURN_IF_ERROR(kind.status());
 
+  if (!options_.allow_legacy_syntax &&
+      (*kind == JsonLexer::kObj || *kind == JsonLexer::kArr ||
+       (*kind == JsonLexer::kStr && stream_.PeekChar() == '"'))) {
+    return SkipUndecoded();
+  }
+
   switch (*kind) {
     case JsonLexer::kObj:
       return VisitObject(
@@ -165,6 +238,145 @@ absl::Status JsonLexer::SkipValue() {
   return absl::OkStatus();
 }
 
+absl::Status JsonLexer::AdvanceOver(absl::string_view consumed) {
+  RETURN_IF_ERROR(stream_.Advance(consumed.size()));
+  json_loc_.offset += consumed.size();
+  size_t last_line = consumed.rfind('\n');
+  if (last_line == absl::string_view::npos) {
+    json_loc_.col += consumed.size();
+  } else {
+    json_loc_.line += absl::c_count(consumed, '\n');
+    json_loc_.col = consumed.size() - last_line - 1;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status JsonLexer::SkipUndecoded() {
+  enum State {
+    kValue,         // After ':' or ',' in an array.
+    kValueOrClose,  // After '['.
+    kKey,           // After ',' in an object.
+    kKeyOrClose,    // After '{'.
+    kColon,         // After a key.
+    kAfterValue,    // After a value inside an array or object.
+  };
+  State state = kValue;
+  // The open brackets.
+  std::string stack;
+  bool in_string = false;
+  bool in_key = false;
+  bool in_scalar = false;
+  // The last byte of the buffer was a backslash in a string.
+  bool escaped = false;
+  bool done = false;
+
+  while (true) {
+    RETURN_IF_ERROR(stream_.BufferAtLeast(1).status());
+    absl::string_view buf = stream_.Unread();
+    size_t i = 0;
+    if (escaped) {
+      escaped = false;
+      ++i;
+    }
+    // Consumes the first `i` bytes, so that errors point at the byte that
+    // caused them.
+    auto invalid = [&](absl::string_view message) -> absl::Status {
+      RETURN_IF_ERROR(AdvanceOver(buf.substr(0, i)));
+      return Invalid(message);
+    };
+    while (i < buf.size() && !done) {
+      if (in_string) {
+        i = FindQuoteOrBackslash(buf, i);
+        if (i == buf.size()) break;
+        if (buf[i] == '\\') {
+          if (i + 1 == buf.size()) {
+            escaped = true;
+            i = buf.size();
+            break;
+          }
+          i += 2;
+          continue;
+        }
+        ++i;
+        in_string = false;
+        state = in_key ? kColon : kAfterValue;
+        done = stack.empty();
+        continue;
+      }
+
+      char c = buf[i];
+      if (in_scalar) {
+        if (IsScalarChar(c)) {
+          ++i;
+          continue;
+        }
+        in_scalar = false;
+        state = kAfterValue;
+      }
+      if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+        ++i;
+        continue;
+      }
+
+      switch (state) {
+        case kValueOrClose:
+          if (c == ']') break;
+          ABSL_FALLTHROUGH_INTENDED;
+        case kValue:
+          if (c == '{' || c == '[') {
+            if (stack.size() >= static_cast<size_t>(options_.recursion_depth)) {
+              return invalid("JSON content was too deeply nested");
+            }
+            stack.push_back(c);
+            state = c == '{' ? kKeyOrClose : kValueOrClose;
+          } else if (c == '"') {
+            in_string = true;
+            in_key = false;
+          } else if (IsScalarChar(c)) {
+            in_scalar = true;
+          } else {
+            return invalid(absl::StrFormat("unexpected character: '%c'", c));
+          }
+          ++i;
+          continue;
+        case kKeyOrClose:
+          if (c == '}') break;
+          ABSL_FALLTHROUGH_INTENDED;
+        case kKey:
+          if (c != '"') return invalid("expected '\"'");
+          in_string = true;
+          in_key = true;
+          ++i;
+          continue;
+        case kColon:
+          if (c != ':') return invalid("expected ':'");
+          state = kValue;
+          ++i;
+          continue;
+        case kAfterValue:
+          if (c == ',') {
+            state = stack.back() == '{' ? kKey : kValue;
+            ++i;
+            continue;
+          }
+          break;
+      }
+
+      // Only closing brackets are left.
+      if ((c != '}' && c != ']') || stack.back() != (c == '}' ? '{' : '[')) {
+        return invalid(stack.back() == '{' ? "expected ',' or '}'"
+                                           : "expected ',' or ']'");
+      }
+      stack.pop_back();
+      state = kAfterValue;
+      done = stack.empty();
+      ++i;
+    }
+    RETURN_IF_ERROR(AdvanceOver(buf.substr(0, i)));
+    if (done) return absl::OkStatus();
+  }
+}
+
 absl::StatusOr<uint16_t> JsonLexer::ParseU16HexCodepoint() {
   absl::StatusOr<LocationWith<MaybeOwnedString>> escape = Take(4);
   RETURN_IF_ERROR(escape.status());
@@ -190,24 +402,40 @@ absl::StatusOr<uint16_t> JsonLexer::ParseU16HexCodepoint() {
 absl::Status JsonLexer::SkipToToken() {
   while (true) {
     RETURN_IF_ERROR(stream_.BufferAtLeast(1).status());
-    switch (stream_.PeekChar()) {
-      case '\n':
-        RETURN_IF_ERROR(Advance(1));
+    // Skips all the whitespace in the buffer at once.
+    absl::string_view unread = stream_.Unread();
+    size_t skipped = 0;
+    size_t line_start = 0;
+    bool new_line = false;
+    for (; skipped < unread.size(); ++skipped) {
+      char c = unread[skipped];
+      if (c == '\n') {
         ++json_loc_.line;
-        json_loc_.col = 0;
+        new_line = true;
+        line_start = skipped + 1;
+      } else if (c != '\r' && c != '\t' && c != ' ') {
         break;
-      case '\r':
-      case '\t':
-      case ' ':
-        RETURN_IF_ERROR(Advance(1));
-        break;
-      default:
-        return absl::OkStatus();
+      }
+    }
+    if (skipped == 0) return absl::OkStatus();
+    RETURN_IF_ERROR(stream_.Advance(skipped));
+    json_loc_.offset += skipped;
+    if (new_line) {
+      json_loc_.col = skipped - line_start;
+    } else {
+      json_loc_.col += skipped;
     }
+    if (skipped < unread.size()) return absl::OkStatus();
   }
 }
 
 absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseRawNumber() {
+  double d;
+  return ParseRawNumber(&d);
+}
+
+absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseRawNumber(
+    double* value) {
   RETURN_IF_ERROR(SkipToToken());
 
   enum { kInt, kFraction, kExponent } state = kInt;
@@ -260,8 +488,7 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseRawNumber() {
     return number->loc.Invalid("number cannot have trailing period");
   }
 
-  double d;
-  if (!absl::SimpleAtod(number_text, &d) || !std::isfinite(d)) {
+  if (!absl::SimpleAtod(number_text, value) || !std::isfinite(*value)) {
     return number->loc.Invalid(
         absl::StrFormat("invalid number: '%s'", number_text));
   }
@@ -285,15 +512,11 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseRawNumber() {
 }
 
 absl::StatusOr<LocationWith<double>> JsonLexer::ParseNumber() {
-  auto number = ParseRawNumber();
-  RETURN_IF_ERROR(number.status());
-
+  // ParseRawNumber() has already turned the number into a double, to check
+  // it; no need to parse it twice.
   double d;
-  if (!absl::SimpleAtod(number->value.AsView(), &d) || !std::isfinite(d)) {
-    return number->loc.Invalid(
-        absl::StrFormat("invalid number: '%s'", number->value.AsView()));
-  }
-
+  auto number = ParseRawNumber(&d);
+  RETURN_IF_ERROR(number.status());
   return LocationWith<double>{d, number->loc};
 }
 
@@ -392,6 +615,17 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseUtf8() {
   while (true) {
     RETURN_IF_ERROR(stream_.BufferAtLeast(1).status());
 
+    // Consumes the run of characters that need no checks at once.
+    absl::string_view unread = stream_.Unread();
+    size_t plain = PlainStringPrefix(unread);
+    if (plain != 0) {
+      if (!on_heap.empty()) {
+        on_heap.append(unread.data(), plain);
+      }
+      RETURN_IF_ERROR(Advance(plain));
+      continue;
+    }
+
     char c = stream_.PeekChar();
     RETURN_IF_ERROR(Advance(1));
     switch (c) {
@@ -401,12 +635,21 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseUtf8() {
           goto normal_character;
         }
 
+        // Non-ASCII characters are copied as is, and validated once the
+        // whole string is known; escapes always decode to valid UTF-8.
         if (!on_heap.empty()) {
+          if (!internal::IsValidUtf8(on_heap)) {
+            return Invalid("invalid UTF-8 in string");
+          }
           return LocationWith<MaybeOwnedString>{
               MaybeOwnedString(std::move(on_heap)), loc};
         }
         // NOTE: the 1 below clips off the " from the end of the string.
-        return LocationWith<MaybeOwnedString>{mark.value.UpToUnread(1), loc};
+        MaybeOwnedString str = mark.value.UpToUnread(1);
+        if (!internal::IsValidUtf8(str.AsView())) {
+          return Invalid("invalid UTF-8 in string");
+        }
+        return LocationWith<MaybeOwnedString>{std::move(str), loc};
       }
       case '\\': {
         if (on_heap.empty()) {
@@ -450,46 +693,9 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseUtf8() {
               "invalid control character 0x%02x in string", uc));
         }
 
-        // Verify this is valid UTF-8. UTF-8 is a varint encoding satisfying
-        // one of the following (big-endian) patterns:
-        //
-        // 0b0xxxxxxx
-        // 0b110xxxxx'10xxxxxx
-        // 0b1110xxxx'10xxxxxx'10xxxxxx
-        // 0b11110xxx'10xxxxxx'10xxxxxx'10xxxxxx
-        //
-        // We don't need to decode it; just validate it.
-        size_t lookahead = 0;
-        switch (absl::countl_one(uc)) {
-          case 0:
-            break;
-          case 2:
-            lookahead = 1;
-            break;
-          case 3:
-            lookahead = 2;
-            break;
-          case 4:
-            lookahead = 3;
-            break;
-          default:
-            return Invalid("invalid UTF-8 in string");
-        }
-
         if (!on_heap.empty()) {
           on_heap.push_back(c);
         }
-        for (int i = 0; i < lookahead; ++i) {
-          RETURN_IF_ERROR(stream_.BufferAtLeast(1).status());
-          uint8_t uc = static_cast<uint8_t>(stream_.PeekChar());
-          if ((uc >> 6) != 2) {
-            return Invalid("invalid UTF-8 in string");
-          }
-          if (!on_heap.empty()) {
-            on_heap.push_back(stream_.PeekChar());
-          }
-          RETURN_IF_ERROR(Advance(1));
-        }
         break;
       }
     }
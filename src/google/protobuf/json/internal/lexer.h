@@ -172,6 +172,9 @@ class JsonLexer {
 
   // Parses a number as a string, without turning it into an integer.
   absl::StatusOr<LocationWith<MaybeOwnedString>> ParseRawNumber();
+  // Like ParseRawNumber(), but also returns the number as a double in
+  // `value`.
+  absl::StatusOr<LocationWith<MaybeOwnedString>> ParseRawNumber(double* value);
 
   // Parses a UTF-8 string. If the contents of the string happen to actually be
   // UTF-8, it will return a zero-copy view; otherwise it will allocate.
@@ -190,6 +193,11 @@ class JsonLexer {
   absl::Status VisitObject(F f);
 
   // Parses a single value and discards it.
+  //
+  // Unless legacy syntax is allowed, strings, arrays and objects are skipped
+  // by scanning for their end: nesting, commas and colons are checked, but
+  // strings are not decoded and numbers and literals inside arrays and
+  // objects are not validated.
   absl::Status SkipValue();
 
   // Forwards of functions from ZeroCopyBufferedStream.
@@ -245,6 +253,13 @@ class JsonLexer {
   // "unquoted keys" extension.
   absl::StatusOr<LocationWith<MaybeOwnedString>> ParseBareWord();
 
+  // The fast path of SkipValue() for strings, arrays and objects.
+  absl::Status SkipUndecoded();
+
+  // Advances past `consumed`, the next bytes of the stream, updating the line
+  // and column.
+  absl::Status AdvanceOver(absl::string_view consumed);
+
   absl::Status Advance(size_t bytes) {
     RETURN_IF_ERROR(stream_.Advance(bytes));
     json_loc_.offset += static_cast<int>(bytes);
@@ -291,6 +291,21 @@ TEST(LexerTest, SimpleString) {
   });
 }
 
+TEST(LexerTest, LongStringWithEscapes) {
+  Do(R"json("0123456789abcdef\"0123456789\\abcdef0123456789\u00e9)json"
+     "'\xc3\xa9 0123456789abcdef\x7f\"",
+     [](io::ZeroCopyInputStream* stream) {
+       EXPECT_THAT(Value::Parse(stream),
+                   IsOkAndHolds(ValueIs<std::string>(
+                       "0123456789abcdef\"0123456789\\abcdef0123456789\xc3\xa9"
+                       "'\xc3\xa9 0123456789abcdef\x7f")));
+     });
+  BadInner("\"0123456789abcdef0123456789\x01"
+           "abcdef\"");
+  BadInner("\"0123456789abcdef0123456789\xff"
+           "abcdef\"");
+}
+
 TEST(LexerTest, UTFBoundaries) {
   Do(R"json("\u0001\u07FF\uFFFF\uDBFF\uDFFF")json",
      [](io::ZeroCopyInputStream* stream) {
@@ -596,6 +611,16 @@ TEST(LexerTest, RejectNonUtf8String) {
 
 TEST(LexerTest, RejectNonUtf8Prefix) { Bad("\xff{}"); }
 
+TEST(LexerTest, RejectMalformedUtf8String) {
+  // Overlong encoding of '/'.
+  Bad("\"\xc0\xaf\"");
+  // Encoded surrogate.
+  Bad("\"\xed\xa0\x80\"");
+  // Truncated sequence, with and without an escape in the same string.
+  Bad("\"\xe6\x96\"");
+  Bad("\"\\n\xe6\x96\"");
+}
+
 TEST(LexerTest, SurrogateEscape) {
   absl::string_view json = R"json(
     [ "\ud83d\udc08\u200D\u2b1B\ud83d\uDdA4" ]
@@ -664,6 +689,41 @@ TEST(NonStandard, TrailingCommas) {
 // These strings are enormous; so that the test actually finishes in a
 // reasonable time, we skip using Do().
 
+TEST(LexerTest, SkipValue) {
+  Do(R"json([{"a": [1, -2.5e3, true, null, {}],
+  "b\"\\": "xé\\", "c": []}, "tail"])json",
+     [](io::ZeroCopyInputStream* stream) {
+       JsonLexer lex(stream, {});
+       ASSERT_TRUE(lex.Expect("[").ok());
+       ASSERT_TRUE(lex.SkipValue().ok());
+       ASSERT_TRUE(lex.Expect(",").ok());
+       ASSERT_TRUE(lex.SkipValue().ok());
+       ASSERT_TRUE(lex.Expect("]").ok());
+     });
+}
+
+TEST(LexerTest, SkipValueRejectsMalformedNesting) {
+  for (absl::string_view json : {
+           R"json([1, 2})json",
+           R"json({"a": 1])json",
+           R"json({"a" 1})json",
+           R"json({1: 2})json",
+           R"json([1,, 2])json",
+           R"json([1 2])json",
+           R"json({"a": [})json",
+           R"json(["unterminated])json",
+           R"json([1, 2)json",
+       }) {
+    Do(
+        json,
+        [](io::ZeroCopyInputStream* stream) {
+          JsonLexer lex(stream, {});
+          EXPECT_FALSE(lex.SkipValue().ok());
+        },
+        false);
+  }
+}
+
 TEST(LexerTest, ArrayRecursion) {
   std::string ok = std::string(ParseOptions::kDefaultDepth, '[') +
                    std::string(ParseOptions::kDefaultDepth, ']');
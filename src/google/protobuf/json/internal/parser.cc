@@ -178,19 +178,15 @@ absl::StatusOr<LocationWith<T>> ParseIntInner(JsonLexer& lex, double lo,
   LocationWith<T> n;
   switch (*kind) {
     case JsonLexer::kNum: {
-      absl::StatusOr<LocationWith<MaybeOwnedString>> x = lex.ParseRawNumber();
+      double d;
+      absl::StatusOr<LocationWith<MaybeOwnedString>> x =
+          lex.ParseRawNumber(&d);
       RETURN_IF_ERROR(x.status());
       n.loc = x->loc;
       if (absl::SimpleAtoi(x->value.AsView(), &n.value)) {
         break;
       }
 
-      double d;
-      if (!absl::SimpleAtod(x->value.AsView(), &d) || !std::isfinite(d)) {
-        return x->loc.Invalid(
-            absl::StrFormat("invalid number: '%s'", x->value.AsView()));
-      }
-
       // Conversion overflow here would be UB.
       if (lo > d || d > hi) {
         return lex.Invalid("JSON number out of range for int");
@@ -498,7 +494,7 @@ absl::Status ParseSingular(JsonLexer& lex, Field<Traits> field,
     case FieldDescriptor::TYPE_BYTES: {
       auto x = ParseStrOrBytes<Traits>(lex, field);
       RETURN_IF_ERROR(x.status());
-      Traits::SetString(field, msg, *x);
+      Traits::TakeString(field, msg, *std::move(x));
       break;
     }
     case FieldDescriptor::TYPE_ENUM: {
@@ -1075,7 +1071,7 @@ absl::Status ParseValue(JsonLexer& lex, const Desc<Traits>& desc,
 
       auto str = lex.ParseUtf8();
       RETURN_IF_ERROR(str.status());
-      Traits::SetString(field, msg, std::move(str->value.ToString()));
+      Traits::TakeString(field, msg, std::move(str->value.ToString()));
       break;
     }
     case JsonLexer::kFalse:
@@ -1303,6 +1299,60 @@ absl::Status JsonStringToMessage(absl::string_view input, Message* message,
   return s;
 }
 
+absl::Status JsonMessageStreamParser::EndArray() {
+  state_ = State::kDone;
+  if (!lex_.AtEof()) {
+    return lex_.Invalid("extraneous characters after end of JSON array");
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<bool> JsonMessageStreamParser::Next(Message* message) {
+  switch (state_) {
+    case State::kDone:
+      return false;
+    case State::kStart:
+      if (lex_.AtEof()) {
+        state_ = State::kDone;
+        return false;
+      }
+      if (!lex_.Peek("[")) {
+        state_ = State::kSequence;
+        break;
+      }
+      state_ = State::kArray;
+      if (lex_.Peek("]")) {
+        RETURN_IF_ERROR(EndArray());
+        return false;
+      }
+      break;
+    case State::kArray:
+      if (lex_.Peek("]")) {
+        RETURN_IF_ERROR(EndArray());
+        return false;
+      }
+      RETURN_IF_ERROR(lex_.Expect(","));
+      if (lex_.options().allow_legacy_syntax && lex_.Peek("]")) {
+        RETURN_IF_ERROR(EndArray());
+        return false;
+      }
+      break;
+    case State::kSequence:
+      if (lex_.AtEof()) {
+        state_ = State::kDone;
+        return false;
+      }
+      break;
+  }
+
+  message->Clear();
+  path_ = MessagePath(message->GetDescriptor()->full_name());
+  ParseProto2Descriptor::Msg msg(message);
+  RETURN_IF_ERROR(ParseMessage<ParseProto2Descriptor>(
+      lex_, *message->GetDescriptor(), msg, /*any_reparse=*/false));
+  return true;
+}
+
 absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
                                 const std::string& type_url,
                                 io::ZeroCopyInputStream* json_input,
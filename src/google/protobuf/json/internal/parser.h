@@ -10,8 +10,11 @@
 
 #include <string>
 
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/json/internal/lexer.h"
+#include "google/protobuf/json/internal/message_path.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/util/type_resolver.h"
 
@@ -29,6 +32,34 @@ absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
                                 io::ZeroCopyInputStream* json_input,
                                 io::ZeroCopyOutputStream* binary_output,
                                 json_internal::ParseOptions options);
+
+// Internal version of google::protobuf::json::JsonMessageReader; see json.h for
+// details.
+class JsonMessageStreamParser {
+ public:
+  JsonMessageStreamParser(io::ZeroCopyInputStream* json_input,
+                          json_internal::ParseOptions options)
+      : path_(""), lex_(json_input, options, &path_) {}
+
+  // Clears `message` and parses the next object into it.  Returns false at
+  // the end of the input.
+  absl::StatusOr<bool> Next(Message* message);
+
+ private:
+  enum class State {
+    kStart,     // Nothing was read yet.
+    kArray,     // Inside a top-level array, after an element.
+    kSequence,  // Between objects that are not in an array.
+    kDone,
+  };
+
+  // Consumes the end of the input after the top-level array.
+  absl::Status EndArray();
+
+  MessagePath path_;
+  JsonLexer lex_;
+  State state_ = State::kStart;
+};
 }  // namespace json_internal
 }  // namespace protobuf
 }  // namespace google
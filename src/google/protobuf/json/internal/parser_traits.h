@@ -14,8 +14,11 @@
 #include <limits>
 #include <memory>
 #include <string>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 
+#include "google/protobuf/descriptor.pb.h"
 #include "google/protobuf/type.pb.h"
 #include "absl/base/attributes.h"
 #include "absl/base/casts.h"
@@ -28,6 +31,7 @@
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/json/internal/descriptor_traits.h"
+#include "google/protobuf/message.h"
 #include "google/protobuf/wire_format_lite.h"
 #include "google/protobuf/stubs/status_macros.h"
 
@@ -51,14 +55,32 @@ template <typename Traits>
 using Msg = typename Traits::Msg;
 
 struct ParseProto2Descriptor : Proto2Descriptor {
+  // Handles for the singular scalar fields written so far, shared by all
+  // messages of one parse, so that each field is looked up once per parse
+  // rather than once per value.  Keyed by Reflection as well, as messages of
+  // one type from different factories have different layouts.
+  template <typename T>
+  using AccessorMap =
+      absl::flat_hash_map<std::pair<const Reflection*, Field>,
+                          FieldAccessor<T>>;
+  using Accessors =
+      std::tuple<AccessorMap<int32_t>, AccessorMap<int64_t>,
+                 AccessorMap<uint32_t>, AccessorMap<uint64_t>,
+                 AccessorMap<float>, AccessorMap<double>, AccessorMap<bool>,
+                 AccessorMap<std::string>>;
+
   // A message value that fields can be written to, but not read from.
   class Msg {
    public:
-    explicit Msg(Message* msg) : msg_(msg) {}
+    explicit Msg(Message* msg) : Msg(msg, std::make_shared<Accessors>()) {}
 
    private:
     friend ParseProto2Descriptor;
+    Msg(Message* msg, std::shared_ptr<Accessors> accessors)
+        : msg_(msg), accessors_(std::move(accessors)) {}
+
     Message* msg_;
+    std::shared_ptr<Accessors> accessors_;
     // Because `msg` might already have oneofs set, we need to track which were
     // set *during* the parse separately.
     absl::flat_hash_set<int> parsed_oneofs_indices_;
@@ -87,7 +109,9 @@ struct ParseProto2Descriptor : Proto2Descriptor {
   // as when parsing a repeated field.
   static void RecordAsSeen(Field f, Msg& msg) {
     bool inserted = msg.parsed_fields_.insert(f->number()).second;
-    if (inserted) {
+    // Setting a singular scalar overwrites the old value anyway.
+    if (inserted && (f->is_repeated() ||
+                     f->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE)) {
       msg.msg_->GetReflection()->ClearField(msg.msg_, f);
     }
 
@@ -109,7 +133,7 @@ struct ParseProto2Descriptor : Proto2Descriptor {
     } else {
       new_msg = msg.msg_->GetReflection()->MutableMessage(msg.msg_, f);
     }
-    Msg wrapper(new_msg);
+    Msg wrapper(new_msg, msg.accessors_);
     return body(*f->message_type(), wrapper);
   }
 
@@ -143,7 +167,7 @@ struct ParseProto2Descriptor : Proto2Descriptor {
     if (f->is_repeated()) {
       msg.msg_->GetReflection()->AddFloat(msg.msg_, f, x);
     } else {
-      msg.msg_->GetReflection()->SetFloat(msg.msg_, f, x);
+      SetSingular<float>(f, msg, x);
     }
   }
 
@@ -151,7 +175,7 @@ struct ParseProto2Descriptor : Proto2Descriptor {
     if (f->is_repeated()) {
       msg.msg_->GetReflection()->AddDouble(msg.msg_, f, x);
     } else {
-      msg.msg_->GetReflection()->SetDouble(msg.msg_, f, x);
+      SetSingular<double>(f, msg, x);
     }
   }
 
@@ -160,7 +184,7 @@ struct ParseProto2Descriptor : Proto2Descriptor {
     if (f->is_repeated()) {
       msg.msg_->GetReflection()->AddInt64(msg.msg_, f, x);
     } else {
-      msg.msg_->GetReflection()->SetInt64(msg.msg_, f, x);
+      SetSingular<int64_t>(f, msg, x);
     }
   }
 
@@ -169,7 +193,7 @@ struct ParseProto2Descriptor : Proto2Descriptor {
     if (f->is_repeated()) {
       msg.msg_->GetReflection()->AddUInt64(msg.msg_, f, x);
     } else {
-      msg.msg_->GetReflection()->SetUInt64(msg.msg_, f, x);
+      SetSingular<uint64_t>(f, msg, x);
     }
   }
 
@@ -178,7 +202,7 @@ struct ParseProto2Descriptor : Proto2Descriptor {
     if (f->is_repeated()) {
       msg.msg_->GetReflection()->AddInt32(msg.msg_, f, x);
     } else {
-      msg.msg_->GetReflection()->SetInt32(msg.msg_, f, x);
+      SetSingular<int32_t>(f, msg, x);
     }
   }
 
@@ -187,7 +211,7 @@ struct ParseProto2Descriptor : Proto2Descriptor {
     if (f->is_repeated()) {
       msg.msg_->GetReflection()->AddUInt32(msg.msg_, f, x);
     } else {
-      msg.msg_->GetReflection()->SetUInt32(msg.msg_, f, x);
+      SetSingular<uint32_t>(f, msg, x);
     }
   }
 
@@ -196,7 +220,7 @@ struct ParseProto2Descriptor : Proto2Descriptor {
     if (f->is_repeated()) {
       msg.msg_->GetReflection()->AddBool(msg.msg_, f, x);
     } else {
-      msg.msg_->GetReflection()->SetBool(msg.msg_, f, x);
+      SetSingular<bool>(f, msg, x);
     }
   }
 
@@ -205,7 +229,20 @@ struct ParseProto2Descriptor : Proto2Descriptor {
     if (f->is_repeated()) {
       msg.msg_->GetReflection()->AddString(msg.msg_, f, std::string(x));
     } else {
-      msg.msg_->GetReflection()->SetString(msg.msg_, f, std::string(x));
+      SetSingularString(f, msg, x);
+    }
+  }
+
+  // Like SetString(), but moves `x` into the field where possible, so that
+  // large values such as decoded bytes are not copied.
+  static void TakeString(Field f, Msg& msg, std::string x) {
+    RecordAsSeen(f, msg);
+    if (f->is_repeated()) {
+      msg.msg_->GetReflection()->AddString(msg.msg_, f, std::move(x));
+    } else if (x.size() <= kCopiedStringSize) {
+      SetSingularString(f, msg, x);
+    } else {
+      msg.msg_->GetReflection()->SetString(msg.msg_, f, std::move(x));
     }
   }
 
@@ -214,9 +251,41 @@ struct ParseProto2Descriptor : Proto2Descriptor {
     if (f->is_repeated()) {
       msg.msg_->GetReflection()->AddEnumValue(msg.msg_, f, x);
     } else {
-      msg.msg_->GetReflection()->SetEnumValue(msg.msg_, f, x);
+      SetSingular<int32_t>(f, msg, x);
     }
   }
+
+ private:
+  // Strings up to this size are copied into singular fields through their
+  // FieldAccessor, which is cheaper than moving them through Reflection.
+  static constexpr size_t kCopiedStringSize = 64;
+
+  // Sets a singular field through its FieldAccessor, writing to the message
+  // directly where the field's layout allows.
+  template <typename T>
+  static void SetSingular(Field f, Msg& msg,
+                          typename FieldAccessor<T>::SetType x) {
+    const Reflection* reflection = msg.msg_->GetReflection();
+    auto& accessors = std::get<AccessorMap<T>>(*msg.accessors_);
+    auto it = accessors.find({reflection, f});
+    if (it == accessors.end()) {
+      it = accessors
+               .try_emplace({reflection, f},
+                            reflection->GetFieldAccessor<T>(f))
+               .first;
+    }
+    it->second.Set(msg.msg_, x);
+  }
+
+  // Like SetSingular<std::string>(), but cords, which have no FieldAccessor,
+  // are set through Reflection.
+  static void SetSingularString(Field f, Msg& msg, absl::string_view x) {
+    if (internal::cpp::EffectiveStringCType(f) == FieldOptions::CORD) {
+      msg.msg_->GetReflection()->SetString(msg.msg_, f, std::string(x));
+      return;
+    }
+    SetSingular<std::string>(f, msg, x);
+  }
 };
 
 // Traits for proto3-ish deserialization.
@@ -335,6 +404,10 @@ struct ParseProto3Type : Proto3Type {
     msg.stream_.WriteRaw(&b, 1);
   }
 
+  static void TakeString(Field f, Msg& msg, std::string x) {
+    SetString(f, msg, x);
+  }
+
   static void SetString(Field f, Msg& msg, absl::string_view x) {
     RecordAsSeen(f, msg);
     msg.stream_.WriteTag(f->proto().number() << 3 |
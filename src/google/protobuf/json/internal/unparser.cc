@@ -31,6 +31,7 @@
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/dynamic_message.h"
 #include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_sink.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/json/internal/descriptor_traits.h"
 #include "google/protobuf/json/internal/unparser_traits.h"
@@ -355,30 +356,26 @@ absl::Status WriteMap(JsonWriter& writer, const Msg<Traits>& msg,
   writer.Write("{");
   writer.Push();
 
-  size_t count = Traits::GetSize(field, msg);
   bool first = true;
-  for (size_t i = 0; i < count; ++i) {
-    absl::StatusOr<const Msg<Traits>*> entry =
-        Traits::GetMessage(field, msg, i);
-    RETURN_IF_ERROR(entry.status());
-    const Desc<Traits>& type = Traits::GetDesc(**entry);
-
-    auto is_empty = IsEmptyValue<Traits>(**entry, Traits::ValueField(type));
-    RETURN_IF_ERROR(is_empty.status());
-    if (*is_empty) {
-      // Empty google.protobuf.Values are silently discarded.
-      continue;
-    }
+  RETURN_IF_ERROR(Traits::ForEachMapEntry(
+      field, msg, [&](const Msg<Traits>& entry) -> absl::Status {
+        const Desc<Traits>& type = Traits::GetDesc(entry);
+
+        auto is_empty = IsEmptyValue<Traits>(entry, Traits::ValueField(type));
+        RETURN_IF_ERROR(is_empty.status());
+        if (*is_empty) {
+          // Empty google.protobuf.Values are silently discarded.
+          return absl::OkStatus();
+        }
 
-    writer.WriteComma(first);
-    writer.NewLine();
-    RETURN_IF_ERROR(
-        WriteMapKey<Traits>(writer, **entry, Traits::KeyField(type)));
-    writer.Write(":");
-    writer.Whitespace(" ");
-    RETURN_IF_ERROR(
-        WriteSingular<Traits>(writer, Traits::ValueField(type), **entry));
-  }
+        writer.WriteComma(first);
+        writer.NewLine();
+        RETURN_IF_ERROR(
+            WriteMapKey<Traits>(writer, entry, Traits::KeyField(type)));
+        writer.Write(":");
+        writer.Whitespace(" ");
+        return WriteSingular<Traits>(writer, Traits::ValueField(type), entry);
+      }));
 
   writer.Pop();
   if (!first) {
@@ -404,28 +401,32 @@ absl::Status WriteField(JsonWriter& writer, const Msg<Traits>& msg,
   writer.WriteComma(first);
   writer.NewLine();
 
-  if (Traits::IsExtension(field)) {
-    writer.Write(MakeQuoted("[", Traits::FieldFullName(field), "]"), ":");
-  } else if (writer.options().preserve_proto_field_names) {
-    writer.Write(MakeQuoted(Traits::FieldName(field)), ":");
-  } else {
-    // The generator for type.proto and the internals of descriptor.cc disagree
-    // on what the json name of a PascalCase field is supposed to be; type.proto
-    // seems to (incorrectly?) capitalize the first letter, which is the
-    // behavior ESF defaults to. To fix this, if the original field name starts
-    // with an uppercase letter, and the Json name does not, we uppercase it.
+  // The key depends only on the field and the writer's options, so it is
+  // escaped once per field and writer.
+  writer.WriteFieldKey(field, [&]() -> std::string {
+    if (Traits::IsExtension(field)) {
+      return absl::StrCat("[", Traits::FieldFullName(field), "]");
+    }
     absl::string_view original_name = Traits::FieldName(field);
+    if (writer.options().preserve_proto_field_names) {
+      return std::string(original_name);
+    }
+    // The generator for type.proto and the internals of descriptor.cc
+    // disagree on what the json name of a PascalCase field is supposed to be;
+    // type.proto seems to (incorrectly?) capitalize the first letter, which is
+    // the behavior ESF defaults to. To fix this, if the original field name
+    // starts with an uppercase letter, and the Json name does not, we
+    // uppercase it.
     absl::string_view json_name = Traits::FieldJsonName(field);
     if (writer.options().allow_legacy_syntax &&
         absl::ascii_isupper(original_name[0]) &&
         !absl::ascii_isupper(json_name[0])) {
-      writer.Write(MakeQuoted(absl::ascii_toupper(original_name[0]),
-                              original_name.substr(1)),
-                   ":");
-    } else {
-      writer.Write(MakeQuoted(json_name), ":");
+      return absl::StrCat(
+          std::string(1, absl::ascii_toupper(original_name[0])),
+          original_name.substr(1));
     }
-  }
+    return std::string(json_name);
+  });
   writer.Whitespace(" ");
 
   if (Traits::IsMap(field)) {
@@ -23,12 +23,15 @@
 #include "absl/status/status.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "absl/types/variant.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/json/internal/descriptor_traits.h"
+#include "google/protobuf/map_field.h"
+#include "google/protobuf/message.h"
 #include "google/protobuf/stubs/status_macros.h"
 
 // Must be included last.
@@ -209,6 +212,105 @@ struct UnparseProto2Descriptor : Proto2Descriptor {
     return &msg.GetReflection()->GetRepeatedMessage(msg, f, idx);
   }
 
+  // Calls `body` on each entry of map field `f`. Entries are read through
+  // MapIterator and copied into one scratch entry message; indexing them with
+  // GetRepeatedMessage() would instead build the RepeatedPtrField that mirrors
+  // the map for reflection, holding a copy of every entry.
+  template <typename F>
+  static absl::Status ForEachMapEntry(Field f, const Msg& msg, F body) {
+    const Reflection* reflection = msg.GetReflection();
+    Message* mutable_msg = const_cast<Message*>(&msg);
+    MapIterator it = reflection->MapBegin(mutable_msg, f);
+    MapIterator end = reflection->MapEnd(mutable_msg, f);
+    if (it == end) return absl::OkStatus();
+
+    const Message* prototype =
+        reflection->GetMessageFactory()->GetPrototype(f->message_type());
+    std::unique_ptr<Message> entry(prototype->New());
+    const Reflection* entry_reflection = entry->GetReflection();
+    Field key_field = f->message_type()->map_key();
+    Field value_field = f->message_type()->map_value();
+    for (; it != end; ++it) {
+      entry->Clear();
+      const MapKey& key = it.GetKey();
+      switch (key_field->cpp_type()) {
+        case FieldDescriptor::CPPTYPE_INT32:
+          entry_reflection->SetInt32(entry.get(), key_field,
+                                     key.GetInt32Value());
+          break;
+        case FieldDescriptor::CPPTYPE_INT64:
+          entry_reflection->SetInt64(entry.get(), key_field,
+                                     key.GetInt64Value());
+          break;
+        case FieldDescriptor::CPPTYPE_UINT32:
+          entry_reflection->SetUInt32(entry.get(), key_field,
+                                      key.GetUInt32Value());
+          break;
+        case FieldDescriptor::CPPTYPE_UINT64:
+          entry_reflection->SetUInt64(entry.get(), key_field,
+                                      key.GetUInt64Value());
+          break;
+        case FieldDescriptor::CPPTYPE_BOOL:
+          entry_reflection->SetBool(entry.get(), key_field, key.GetBoolValue());
+          break;
+        case FieldDescriptor::CPPTYPE_STRING:
+          entry_reflection->SetString(entry.get(), key_field,
+                                      std::string(key.GetStringValue()));
+          break;
+        default:
+          return absl::InvalidArgumentError(
+              absl::StrCat("unsupported map key type: ", key_field->type()));
+      }
+
+      const MapValueRef& value = it.GetValueRef();
+      switch (value_field->cpp_type()) {
+        case FieldDescriptor::CPPTYPE_INT32:
+          entry_reflection->SetInt32(entry.get(), value_field,
+                                     value.GetInt32Value());
+          break;
+        case FieldDescriptor::CPPTYPE_INT64:
+          entry_reflection->SetInt64(entry.get(), value_field,
+                                     value.GetInt64Value());
+          break;
+        case FieldDescriptor::CPPTYPE_UINT32:
+          entry_reflection->SetUInt32(entry.get(), value_field,
+                                      value.GetUInt32Value());
+          break;
+        case FieldDescriptor::CPPTYPE_UINT64:
+          entry_reflection->SetUInt64(entry.get(), value_field,
+                                      value.GetUInt64Value());
+          break;
+        case FieldDescriptor::CPPTYPE_FLOAT:
+          entry_reflection->SetFloat(entry.get(), value_field,
+                                     value.GetFloatValue());
+          break;
+        case FieldDescriptor::CPPTYPE_DOUBLE:
+          entry_reflection->SetDouble(entry.get(), value_field,
+                                      value.GetDoubleValue());
+          break;
+        case FieldDescriptor::CPPTYPE_BOOL:
+          entry_reflection->SetBool(entry.get(), value_field,
+                                    value.GetBoolValue());
+          break;
+        case FieldDescriptor::CPPTYPE_ENUM:
+          entry_reflection->SetEnumValue(entry.get(), value_field,
+                                         value.GetEnumValue());
+          break;
+        case FieldDescriptor::CPPTYPE_STRING:
+          entry_reflection->SetString(entry.get(), value_field,
+                                      std::string(value.GetStringValue()));
+          break;
+        case FieldDescriptor::CPPTYPE_MESSAGE:
+          entry_reflection->MutableMessage(entry.get(), value_field)
+              ->CopyFrom(value.GetMessageValue());
+          break;
+      }
+
+      RETURN_IF_ERROR(body(static_cast<const Msg&>(*entry)));
+    }
+    return absl::OkStatus();
+  }
+
   template <typename F>
   static absl::Status WithDecodedMessage(const Desc& desc,
                                          absl::string_view data, F body) {
@@ -393,6 +495,15 @@ struct UnparseProto3Type : Proto3Type {
     return &msg.Get<Msg>(f->proto().number())[idx];
   }
 
+  // Calls `body` on each entry of map field `f`.
+  template <typename F>
+  static absl::Status ForEachMapEntry(Field f, const Msg& msg, F body) {
+    for (const Msg& entry : msg.Get<Msg>(f->proto().number())) {
+      RETURN_IF_ERROR(body(entry));
+    }
+    return absl::OkStatus();
+  }
+
   template <typename F>
   static absl::Status WithDecodedMessage(const Desc& desc,
                                          absl::string_view data, F body) {
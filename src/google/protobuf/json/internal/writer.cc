@@ -7,13 +7,31 @@
 
 #include "google/protobuf/json/internal/writer.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <initializer_list>
 #include <limits>
+#include <string>
+#include <system_error>  // NOLINT(build/c++11)
 #include <utility>
 
 #include "absl/algorithm/container.h"
+#include "absl/base/config.h"
 #include "absl/log/absl_check.h"
+#include "absl/numeric/bits.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/strtod.h"
+
+// <charconv> is C++17; MSVC warns (STL4038) when it is included in C++14.
+#if ABSL_INTERNAL_CPLUSPLUS_LANG >= 201703L
+#include <charconv>
+#endif
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
@@ -21,6 +39,142 @@
 namespace google {
 namespace protobuf {
 namespace json_internal {
+namespace {
+
+// A finite number as d[.ddd] * 10^exponent, with the fewest digits that
+// parse back to the number.
+struct ShortestDecimal {
+  bool negative = false;
+  char digits[20];
+  int num_digits = 0;
+  int exponent = 0;
+};
+
+// Reads printf-style "[-]d[.ddd]e(+|-)dd[d]" into `dec`.  Any non-digit
+// before the 'e' is taken to be the radix, whatever the locale made it.
+void ParseScientific(absl::string_view text, ShortestDecimal& dec) {
+  size_t e = text.find('e');
+  absl::string_view mantissa = text.substr(0, e);
+  dec.negative = mantissa[0] == '-';
+  dec.num_digits = 0;
+  for (char c : mantissa) {
+    if ('0' <= c && c <= '9') dec.digits[dec.num_digits++] = c;
+  }
+  dec.exponent = 0;
+  for (char c : text.substr(e + 2)) {
+    dec.exponent = dec.exponent * 10 + (c - '0');
+  }
+  if (text[e + 1] == '-') dec.exponent = -dec.exponent;
+}
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+template <typename T>
+void FindShortest(T val, ShortestDecimal& dec) {
+  char sci[32];
+  std::to_chars_result result = std::to_chars(
+      sci, sci + sizeof(sci), val, std::chars_format::scientific);
+  ABSL_DCHECK(result.ec == std::errc());
+  ParseScientific(absl::string_view(sci, static_cast<size_t>(result.ptr - sci)),
+                  dec);
+}
+#else   // __cpp_lib_to_chars
+double ParseBack(const char* str, double) {
+  return io::NoLocaleStrtod(str, nullptr);
+}
+float ParseBack(const char* str, float) { return std::strtof(str, nullptr); }
+
+// Without to_chars(), tries each precision in turn.  printf() rounds
+// correctly, so the first precision that round-trips gives the same digits
+// as to_chars(): the nearest ones among the shortest.
+template <typename T>
+void FindShortest(T val, ShortestDecimal& dec) {
+  char sci[32];
+  for (int precision = 1;; ++precision) {
+    absl::SNPrintF(sci, sizeof(sci), "%.*e", precision - 1, val);
+    ParseScientific(sci, dec);
+    if (precision == std::numeric_limits<T>::max_digits10) return;
+    // Parse back "[-]ddde<exp>", which has no radix to be misread.
+    std::string check = absl::StrCat(
+        dec.negative ? "-" : "",
+        absl::string_view(dec.digits, static_cast<size_t>(dec.num_digits)),
+        "e", dec.exponent - dec.num_digits + 1);
+    if (ParseBack(check.c_str(), val) == val) return;
+  }
+}
+#endif  // __cpp_lib_to_chars
+
+// Writes the shortest digits that parse back to `val` into `buf`, laid out
+// the way io::SimpleDtoa() and io::SimpleFtoa() print: like printf's "%.*g"
+// with `short_precision` if the digits fit in it, and with `long_precision`
+// otherwise.  `val` must be finite.  The output does not depend on whether
+// the standard library has to_chars().
+template <typename T>
+absl::string_view FormatShortest(T val, int short_precision,
+                                 int long_precision, char (&buf)[48]) {
+  ShortestDecimal dec;
+  FindShortest(val, dec);
+  const char* digits = dec.digits;
+  int num_digits = dec.num_digits;
+  int exponent = dec.exponent;
+
+  char* out = buf;
+  if (dec.negative) *out++ = '-';
+  int precision =
+      num_digits <= short_precision ? short_precision : long_precision;
+  if (exponent < -4 || exponent >= precision) {
+    // printf()'s exponential notation: at least two exponent digits.
+    *out++ = digits[0];
+    if (num_digits > 1) {
+      *out++ = '.';
+      memcpy(out, digits + 1, num_digits - 1);
+      out += num_digits - 1;
+    }
+    *out++ = 'e';
+    *out++ = exponent < 0 ? '-' : '+';
+    int abs_exponent = exponent < 0 ? -exponent : exponent;
+    if (abs_exponent >= 100) {
+      *out++ = static_cast<char>('0' + abs_exponent / 100);
+    }
+    *out++ = static_cast<char>('0' + abs_exponent / 10 % 10);
+    *out++ = static_cast<char>('0' + abs_exponent % 10);
+  } else if (exponent < 0) {
+    *out++ = '0';
+    *out++ = '.';
+    for (int i = -1; i > exponent; --i) *out++ = '0';
+    memcpy(out, digits, num_digits);
+    out += num_digits;
+  } else if (num_digits <= exponent + 1) {
+    memcpy(out, digits, num_digits);
+    out += num_digits;
+    for (int i = num_digits; i <= exponent; ++i) *out++ = '0';
+  } else {
+    memcpy(out, digits, exponent + 1);
+    out += exponent + 1;
+    *out++ = '.';
+    memcpy(out, digits + exponent + 1, num_digits - exponent - 1);
+    out += num_digits - exponent - 1;
+  }
+  return absl::string_view(buf, static_cast<size_t>(out - buf));
+}
+
+// This is the regular base64, not the "web-safe" version.
+constexpr absl::string_view kBase64 =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// The two base64 characters for each 12-bit value, so that three input bytes
+// are encoded with two lookups.
+struct Base64PairTable {
+  constexpr Base64PairTable() : pairs() {
+    for (int i = 0; i < 4096; ++i) {
+      pairs[2 * i] = kBase64[i >> 6];
+      pairs[2 * i + 1] = kBase64[i & 0x3f];
+    }
+  }
+  char pairs[2 * 4096];
+};
+constexpr Base64PairTable kBase64Pairs;
+
+}  // namespace
 
 // Tries to write a non-finite double if necessary; returns false if
 // nothing was written.
@@ -37,10 +191,19 @@ bool JsonWriter::MaybeWriteSpecialFp(double val) {
   return true;
 }
 
+void JsonWriter::Write(double val) {
+  if (MaybeWriteSpecialFp(val)) return;
+  char buf[48];
+  Write(FormatShortest(val, DBL_DIG, DBL_DIG + 2, buf));
+}
+
+void JsonWriter::Write(float val) {
+  if (MaybeWriteSpecialFp(val)) return;
+  char buf[48];
+  Write(FormatShortest(val, FLT_DIG, FLT_DIG + 3, buf));
+}
+
 void JsonWriter::WriteBase64(absl::string_view str) {
-  // This is the regular base64, not the "web-safe" version.
-  constexpr absl::string_view kBase64 =
-      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
   const char* ptr = str.data();
   const char* end = ptr + str.size();
 
@@ -50,33 +213,40 @@ void JsonWriter::WriteBase64(absl::string_view str) {
     return static_cast<size_t>(static_cast<uint8_t>(ptr[n]));
   };
 
-  char buf[4];
-  absl::string_view view(buf, sizeof(buf));
+  // Encodes into a local buffer and writes it whenever it fills up, rather
+  // than writing every four characters to the sink on their own.
+  char buf[1024];
+  char* out = buf;
   Write("\"");
 
   while (end - ptr >= 3) {
-    buf[0] = kBase64[read(0) >> 2];
-    buf[1] = kBase64[((read(0) & 0x3) << 4) | (read(1) >> 4)];
-    buf[2] = kBase64[((read(1) & 0xf) << 2) | (read(2) >> 6)];
-    buf[3] = kBase64[read(2) & 0x3f];
-    Write(view);
+    if (out == buf + sizeof(buf)) {
+      Write(absl::string_view(buf, sizeof(buf)));
+      out = buf;
+    }
+    size_t word = read(0) << 16 | read(1) << 8 | read(2);
+    memcpy(out, &kBase64Pairs.pairs[2 * (word >> 12)], 2);
+    memcpy(out + 2, &kBase64Pairs.pairs[2 * (word & 0xfff)], 2);
+    out += 4;
     ptr += 3;
   }
+  Write(absl::string_view(buf, static_cast<size_t>(out - buf)));
 
+  char tail[4];
   switch (end - ptr) {
     case 2:
-      buf[0] = kBase64[read(0) >> 2];
-      buf[1] = kBase64[((read(0) & 0x3) << 4) | (read(1) >> 4)];
-      buf[2] = kBase64[(read(1) & 0xf) << 2];
-      buf[3] = '=';
-      Write(view);
+      tail[0] = kBase64[read(0) >> 2];
+      tail[1] = kBase64[((read(0) & 0x3) << 4) | (read(1) >> 4)];
+      tail[2] = kBase64[(read(1) & 0xf) << 2];
+      tail[3] = '=';
+      Write(absl::string_view(tail, sizeof(tail)));
       break;
     case 1:
-      buf[0] = kBase64[read(0) >> 2];
-      buf[1] = kBase64[((read(0) & 0x3) << 4)];
-      buf[2] = '=';
-      buf[3] = '=';
-      Write(view);
+      tail[0] = kBase64[read(0) >> 2];
+      tail[1] = kBase64[((read(0) & 0x3) << 4)];
+      tail[2] = '=';
+      tail[3] = '=';
+      Write(absl::string_view(tail, sizeof(tail)));
       break;
   }
 
@@ -266,23 +436,82 @@ static bool MustEscape(uint32_t scalar, absl::string_view& custom_escape) {
   }
 }
 
-void JsonWriter::WriteEscapedUtf8(absl::string_view str) {
+// Returns the length of the prefix of `str` made of printable ASCII
+// characters that MustEscape() lets through.  Most strings are all such
+// characters, so they are scanned eight bytes at a time.
+static size_t UnescapedPrefix(absl::string_view str) {
+  size_t i = 0;
+#ifdef ABSL_IS_LITTLE_ENDIAN
+  constexpr uint64_t kOnes = ~uint64_t{0} / 0xff;
+  constexpr uint64_t kHighBits = kOnes * 0x80;
+  for (; i + sizeof(uint64_t) <= str.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, str.data() + i, sizeof(word));
+    // Sets the high bit of each byte that is a control character, one of the
+    // characters below, or not ASCII.  Bytes above the first such byte may be
+    // set spuriously, but the first one is always exact.
+    auto has_zero_byte = [&](uint64_t x) { return (x - kOnes) & ~x; };
+    uint64_t special = ((word - kOnes * 0x20) & ~word) |
+                       has_zero_byte(word ^ (kOnes * '"')) |
+                       has_zero_byte(word ^ (kOnes * '\\')) |
+                       has_zero_byte(word ^ (kOnes * '<')) |
+                       has_zero_byte(word ^ (kOnes * '>')) |
+                       has_zero_byte(word ^ (kOnes * 0x7f)) | word;
+    special &= kHighBits;
+    if (special != 0) {
+      return i + static_cast<size_t>(absl::countr_zero(special)) / 8;
+    }
+  }
+#endif  // ABSL_IS_LITTLE_ENDIAN
+  for (; i < str.size(); ++i) {
+    uint8_t c = static_cast<uint8_t>(str[i]);
+    if (c < 0x20 || c >= 0x7f || c == '"' || c == '\\' || c == '<' ||
+        c == '>') {
+      break;
+    }
+  }
+  return i;
+}
+
+// Passes a \u escape of `val` to `out`.
+template <typename Out>
+static void UEscape(uint16_t val, Out& out) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  char hex[6] = {'\\',
+                 'u',
+                 kHex[val >> 12],
+                 kHex[(val >> 8) & 0xf],
+                 kHex[(val >> 4) & 0xf],
+                 kHex[val & 0xf]};
+  out(absl::string_view(hex, sizeof(hex)));
+}
+
+// Escapes `str`, passing the result to `out` in pieces.
+template <typename Out>
+static void EscapeUtf8(absl::string_view str, Out out) {
   while (!str.empty()) {
+    size_t unescaped = UnescapedPrefix(str);
+    if (unescaped != 0) {
+      out(str.substr(0, unescaped));
+      str.remove_prefix(unescaped);
+      continue;
+    }
+
     auto scalar = ConsumeUtf8Scalar(str);
     absl::string_view custom_escape;
 
     if (!MustEscape(scalar.u32, custom_escape)) {
-      Write(scalar.utf8);
+      out(scalar.utf8);
       continue;
     }
 
     if (!custom_escape.empty()) {
-      Write(custom_escape);
+      out(custom_escape);
       continue;
     }
 
     if (scalar.u32 < 0x10000) {
-      WriteUEscape(scalar.u32);
+      UEscape(scalar.u32, out);
       continue;
     }
 
@@ -290,15 +519,41 @@ void JsonWriter::WriteEscapedUtf8(absl::string_view str) {
         (scalar.u32 & (kMaxLowSurrogate - kMinLowSurrogate)) + kMinLowSurrogate;
     uint16_t hi = (scalar.u32 >> 10) +
                   (kMinHighSurrogate - (kMinSupplementaryCodePoint >> 10));
-    WriteUEscape(hi);
-    WriteUEscape(lo);
+    UEscape(hi, out);
+    UEscape(lo, out);
   }
 }
 
-void JsonWriter::WriteUEscape(uint16_t val) {
-  char hex[7];
-  int len = absl::SNPrintF(hex, sizeof(hex), R"(\u%04x)", val);
-  Write(absl::string_view(hex, static_cast<size_t>(len)));
+void JsonWriter::WriteEscapedUtf8(absl::string_view str) {
+  EscapeUtf8(str, [this](absl::string_view piece) { Write(piece); });
+}
+
+void JsonWriter::AppendEscapedUtf8(absl::string_view str, std::string& out) {
+  EscapeUtf8(str, [&out](absl::string_view piece) {
+    out.append(piece.data(), piece.size());
+  });
+}
+
+void JsonWriter::WriteSlow(absl::string_view str) {
+  while (!failed_ && !str.empty()) {
+    if (ptr_ == end_) {
+      void* data;
+      int size;
+      if (!stream_->Next(&data, &size)) {
+        // There isn't a way for the writer to report errors.
+        failed_ = true;
+        ptr_ = end_ = nullptr;
+        return;
+      }
+      ptr_ = static_cast<char*>(data);
+      end_ = ptr_ + size;
+    }
+
+    size_t n = std::min(str.size(), static_cast<size_t>(end_ - ptr_));
+    memcpy(ptr_, str.data(), n);
+    ptr_ += n;
+    str.remove_prefix(n);
+  }
 }
 }  // namespace json_internal
 }  // namespace protobuf
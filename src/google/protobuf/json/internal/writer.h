@@ -10,7 +10,9 @@
 
 #include <cfloat>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <limits>
 #include <ostream>
@@ -19,10 +21,12 @@
 #include <type_traits>
 #include <utility>
 
+#include "absl/base/optimization.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/io/strtod.h"
-#include "google/protobuf/io/zero_copy_sink.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/stubs/status_macros.h"
 
@@ -84,10 +88,17 @@ static Quoted<T...> MakeQuoted(T... t) {
   return Quoted<T...>{std::make_tuple(t...)};
 }
 
+// Writes JSON text directly into the buffers of a ZeroCopyOutputStream.
 class JsonWriter {
  public:
   JsonWriter(io::ZeroCopyOutputStream* out, WriterOptions options)
-      : sink_(out), options_(options) {}
+      : stream_(out), options_(options) {}
+  JsonWriter(const JsonWriter&) = delete;
+  JsonWriter& operator=(const JsonWriter&) = delete;
+  // Returns the unused part of the last buffer to the stream.
+  ~JsonWriter() {
+    if (ptr_ != end_) stream_->BackUp(static_cast<int>(end_ - ptr_));
+  }
 
   const WriterOptions& options() const { return options_; }
 
@@ -101,51 +112,35 @@ class JsonWriter {
   // Note that Write() is not implemented for 64-bit integers, since they
   // cannot be crisply represented without quotes; use MakeQuoted for that.
 
-  void Write(absl::string_view str) { sink_.Append(str.data(), str.size()); }
-
-  void Write(char c) { sink_.Append(&c, 1); }
-
-  // The precision on this and the following function are completely made-up,
-  // in an attempt to match the behavior of the ESF parser.
-  void Write(double val) {
-    if (!MaybeWriteSpecialFp(val)) {
-      Write(io::SimpleDtoa(val));
+  void Write(absl::string_view str) {
+    if (ABSL_PREDICT_TRUE(str.size() < static_cast<size_t>(end_ - ptr_))) {
+      memcpy(ptr_, str.data(), str.size());
+      ptr_ += str.size();
+      return;
     }
+    WriteSlow(str);
   }
 
-  void Write(float val) {
-    if (!MaybeWriteSpecialFp(val)) {
-      Write(io::SimpleFtoa(val));
+  void Write(char c) {
+    if (ABSL_PREDICT_TRUE(ptr_ != end_)) {
+      *ptr_++ = c;
+      return;
     }
+    WriteSlow(absl::string_view(&c, 1));
   }
 
-  void Write(int32_t val) {
-    char buf[22];
-    int len = absl::SNPrintF(buf, sizeof(buf), "%d", val);
-    absl::string_view view(buf, static_cast<size_t>(len));
-    Write(view);
-  }
+  // The precision on this and the following function are completely made-up,
+  // in an attempt to match the behavior of the ESF parser.
+  void Write(double val);
+  void Write(float val);
 
-  void Write(uint32_t val) {
-    char buf[22];
-    int len = absl::SNPrintF(buf, sizeof(buf), "%d", val);
-    absl::string_view view(buf, static_cast<size_t>(len));
-    Write(view);
-  }
+  void Write(int32_t val) { Write(absl::AlphaNum(val).Piece()); }
 
-  void Write(int64_t val) {
-    char buf[22];
-    int len = absl::SNPrintF(buf, sizeof(buf), "%d", val);
-    absl::string_view view(buf, static_cast<size_t>(len));
-    Write(view);
-  }
+  void Write(uint32_t val) { Write(absl::AlphaNum(val).Piece()); }
 
-  void Write(uint64_t val) {
-    char buf[22];
-    int len = absl::SNPrintF(buf, sizeof(buf), "%d", val);
-    absl::string_view view(buf, static_cast<size_t>(len));
-    Write(view);
-  }
+  void Write(int64_t val) { Write(absl::AlphaNum(val).Piece()); }
+
+  void Write(uint64_t val) { Write(absl::AlphaNum(val).Piece()); }
 
   template <typename... Ts>
   void Write(Quoted<Ts...> val) {
@@ -185,6 +180,21 @@ class JsonWriter {
 
   void WriteBase64(absl::string_view str);
 
+  // Writes the quoted object key `"name":` for `field`.  The escaped key is
+  // computed by `name()`, which returns the unescaped name, the first time
+  // each field is written and is reused afterwards.
+  template <typename Field, typename F>
+  void WriteFieldKey(const Field* field, F name) {
+    auto it = field_keys_.find(field);
+    if (ABSL_PREDICT_FALSE(it == field_keys_.end())) {
+      std::string key = "\"";
+      AppendEscapedUtf8(name(), key);
+      key += "\":";
+      it = field_keys_.emplace(field, std::move(key)).first;
+    }
+    Write(it->second);
+  }
+
   // Returns a buffer that can be re-used throughout a writing session as
   // variable-length scratch space.
   std::string& ScratchBuf() { return scratch_buf_; }
@@ -201,13 +211,24 @@ class JsonWriter {
   // nothing was written.
   bool MaybeWriteSpecialFp(double val);
 
-  void WriteEscapedUtf8(absl::string_view str);
-  void WriteUEscape(uint16_t val);
+  // Writes `str`, asking the stream for more buffers as needed.
+  void WriteSlow(absl::string_view str);
 
-  io::zc_sink_internal::ZeroCopyStreamByteSink sink_;
+  void WriteEscapedUtf8(absl::string_view str);
+  static void AppendEscapedUtf8(absl::string_view str, std::string& out);
+
+  io::ZeroCopyOutputStream* stream_;
+  // The unused part of the stream's current buffer.
+  char* ptr_ = nullptr;
+  char* end_ = nullptr;
+  // Set if the stream failed; no more output is written.
+  bool failed_ = false;
   WriterOptions options_;
   int indent_ = 0;
 
+  // See WriteFieldKey().
+  absl::flat_hash_map<const void*, std::string> field_keys_;
+
   std::string scratch_buf_;
 };
 }  // namespace json_internal
@@ -7,9 +7,11 @@
 
 #include "google/protobuf/json/json.h"
 
+#include <memory>
 #include <string>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/json/internal/parser.h"
@@ -107,6 +109,34 @@ absl::Status JsonStringToMessage(absl::string_view input, Message* message,
 
   return google::protobuf::json_internal::JsonStringToMessage(input, message, opts);
 }
+
+JsonMessageReader::JsonMessageReader(io::ZeroCopyInputStream* json_input)
+    : JsonMessageReader(json_input, ParseOptions()) {}
+
+JsonMessageReader::JsonMessageReader(io::ZeroCopyInputStream* json_input,
+                                     const ParseOptions& options) {
+  google::protobuf::json_internal::ParseOptions opts;
+  opts.ignore_unknown_fields = options.ignore_unknown_fields;
+  opts.case_insensitive_enum_parsing = options.case_insensitive_enum_parsing;
+
+  // TODO: Drop this setting.
+  opts.allow_legacy_syntax = true;
+
+  parser_ = std::make_unique<google::protobuf::json_internal::JsonMessageStreamParser>(
+      json_input, opts);
+}
+
+JsonMessageReader::~JsonMessageReader() = default;
+
+bool JsonMessageReader::Next(Message* message) {
+  if (!status_.ok()) return false;
+  absl::StatusOr<bool> read = parser_->Next(message);
+  if (!read.ok()) {
+    status_ = read.status();
+    return false;
+  }
+  return *read;
+}
 }  // namespace json
 }  // namespace protobuf
 }  // namespace google
@@ -10,10 +10,12 @@
 #ifndef GOOGLE_PROTOBUF_JSON_JSON_H__
 #define GOOGLE_PROTOBUF_JSON_JSON_H__
 
+#include <memory>
 #include <string>
 
 #include "absl/status/status.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/util/type_resolver.h"
 
@@ -22,6 +24,10 @@
 
 namespace google {
 namespace protobuf {
+namespace json_internal {
+class JsonMessageStreamParser;
+}  // namespace json_internal
+
 namespace json {
 struct ParseOptions {
   // Whether to ignore unknown JSON fields during parsing
@@ -152,6 +158,45 @@ inline absl::Status JsonToBinaryString(google::protobuf::util::TypeResolver* res
   return JsonToBinaryString(resolver, type_url, json_input, binary_output,
                             ParseOptions());
 }
+
+// Reads messages one at a time from JSON input that holds either an array of
+// objects, or objects separated by whitespace such as newline-delimited JSON.
+// Only the input of the object being parsed is buffered, so memory use is
+// bounded by the largest object rather than by the size of the input.
+//
+// Usage example:
+//   json::JsonMessageReader reader(&input);
+//   MyMessage message;  // Reused for every object; may live on an arena.
+//   while (reader.Next(&message)) {
+//     Process(message);
+//   }
+//   if (!reader.status().ok()) ...
+class PROTOBUF_EXPORT JsonMessageReader {
+ public:
+  // `json_input` is not owned and must outlive the reader.
+  explicit JsonMessageReader(io::ZeroCopyInputStream* json_input);
+  JsonMessageReader(io::ZeroCopyInputStream* json_input,
+                    const ParseOptions& options);
+  JsonMessageReader(const JsonMessageReader&) = delete;
+  JsonMessageReader& operator=(const JsonMessageReader&) = delete;
+  ~JsonMessageReader();
+
+  // Clears `message` and parses the next object into it; the memory of
+  // `message` is reused.  Returns false at the end of the input or on an
+  // error, after which status() tells which.  Objects may be read into
+  // messages of different types.
+  bool Next(Message* message);
+
+  // The error that stopped reading, if any.
+  //
+  // Please note that non-OK statuses are not a stable output of this API and
+  // subject to change without notice.
+  const absl::Status& status() const { return status_; }
+
+ private:
+  std::unique_ptr<json_internal::JsonMessageStreamParser> parser_;
+  absl::Status status_;
+};
 }  // namespace json
 }  // namespace protobuf
 }  // namespace google
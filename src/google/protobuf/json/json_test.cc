@@ -8,6 +8,7 @@
 #include "google/protobuf/json/json.h"
 
 #include <algorithm>
+#include <cfloat>
 #include <cstdint>
 #include <list>
 #include <memory>
@@ -49,6 +50,7 @@ using ::proto3::TestAny;
 using ::proto3::TestEnumValue;
 using ::proto3::TestMap;
 using ::proto3::TestMessage;
+using ::proto3::TestNestedMap;
 using ::proto3::TestOneof;
 using ::proto3::TestWrapper;
 using ::testing::ContainsRegex;
@@ -392,6 +394,22 @@ TEST_P(JsonTest, WebSafeBytes) {
   EXPECT_EQ(m->bytes_value(), "\xfb");
 }
 
+TEST_P(JsonTest, LongBytes) {
+  // Longer than the writer's encoding buffer, and not a multiple of three.
+  std::string bytes;
+  for (int i = 0; i < 10000; ++i) bytes.push_back(static_cast<char>(i * 7));
+  TestMessage m;
+  m.set_bytes_value(bytes);
+  m.add_repeated_bytes_value(bytes.substr(1));
+
+  auto json = ToJson(m);
+  ASSERT_OK(json);
+  auto parsed = ToProto<TestMessage>(*json);
+  ASSERT_OK(parsed);
+  EXPECT_EQ(parsed->bytes_value(), bytes);
+  EXPECT_THAT(parsed->repeated_bytes_value(), ElementsAre(bytes.substr(1)));
+}
+
 TEST_P(JsonTest, ParseMessage) {
   auto m = ToProto<TestMessage>(R"json(
     {
@@ -479,8 +497,33 @@ TEST_P(JsonTest, FloatPrecision) {
   v.mutable_list_value()->add_values()->set_number_value(0.9900000095367432);
   v.mutable_list_value()->add_values()->set_number_value(0.8799999952316284);
 
+  // Doubles are printed with the shortest digits that parse back to them.
   EXPECT_THAT(ToJson(v),
-              IsOkAndHolds("[0.99000000953674316,0.87999999523162842]"));
+              IsOkAndHolds("[0.9900000095367432,0.8799999952316284]"));
+}
+
+TEST_P(JsonTest, FloatingPointGolden) {
+  // The exact text is part of the output format: it must not depend on
+  // whether the standard library provides std::to_chars().
+  TestMessage m;
+  for (double d : {0.0, -0.0, 0.1, 100.0, 1e15, 1e17, 1e21, 1e-5, 1.5e-7,
+                   0.30000000000000004, 1234567890123456.8,
+                   123456789012345680.0, 5e-324, 1.7976931348623157e308}) {
+    m.add_repeated_double_value(d);
+  }
+  for (float f : {0.1f, 0.99f, 2e8f, -8e-28f, 16777216.0f, 123456789.0f,
+                  1e-45f, FLT_MAX}) {
+    m.add_repeated_float_value(f);
+  }
+
+  EXPECT_THAT(
+      ToJson(m),
+      IsOkAndHolds(
+          R"({"repeatedFloatValue":[0.1,0.99,2e+08,-8e-28,16777216,)"
+          R"(123456790,1e-45,3.4028235e+38],)"
+          R"("repeatedDoubleValue":[0,-0,0.1,100,1e+15,1e+17,1e+21,1e-05,)"
+          R"(1.5e-07,0.30000000000000004,1234567890123456.8,)"
+          R"(1.2345678901234568e+17,5e-324,1.7976931348623157e+308]})"));
 }
 
 TEST_P(JsonTest, FloatMinMaxValue) {
@@ -543,6 +586,22 @@ TEST_P(JsonTest, ParseMap) {
   EXPECT_EQ(other->DebugString(), message.DebugString());
 }
 
+TEST_P(JsonTest, PrintNestedMap) {
+  TestNestedMap message;
+  (*message.mutable_int64_map())[-5] = 6;
+  (*message.mutable_bool_map())[true] = 1;
+  TestNestedMap& inner = (*message.mutable_map_map())["inner"];
+  (*inner.mutable_uint32_map())[7] = 8;
+  auto printed = ToJson(message);
+  ASSERT_THAT(printed,
+              IsOkAndHolds(R"({"boolMap":{"true":1},"int64Map":{"-5":6},)"
+                           R"("mapMap":{"inner":{"uint32Map":{"7":8}}}})"));
+
+  auto other = ToProto<TestNestedMap>(*printed);
+  ASSERT_OK(other);
+  EXPECT_EQ(other->DebugString(), message.DebugString());
+}
+
 TEST_P(JsonTest, RepeatedMapKey) {
   EXPECT_THAT(ToProto<TestMap>(R"json({
     "string_map": {
@@ -589,6 +648,28 @@ TEST_P(JsonTest, ParseOverOneof) {
   EXPECT_EQ(m.oneof_int32_value(), 5);
 }
 
+TEST_P(JsonTest, ParseOverSetFields) {
+  // The resolver codec parses the binary output into a cleared message.
+  if (GetParam() == Codec::kResolver) {
+    GTEST_SKIP();
+  }
+
+  TestMessage m;
+  m.set_int32_value(1);
+  m.set_string_value("foo");
+  m.set_bool_value(true);
+  m.add_repeated_int32_value(7);
+  ASSERT_OK(ToProto(m, R"json({
+    "int32Value": 5,
+    "stringValue": "",
+    "repeatedInt32Value": [8],
+  })json"));
+  EXPECT_EQ(m.int32_value(), 5);
+  EXPECT_EQ(m.string_value(), "");
+  EXPECT_TRUE(m.bool_value());
+  EXPECT_THAT(m.repeated_int32_value(), ElementsAre(8));
+}
+
 TEST_P(JsonTest, RepeatedSingularKeys) {
   auto m = ToProto<TestMessage>(R"json({
     "int32Value": 1,
@@ -1308,6 +1389,20 @@ TEST_P(JsonTest, HtmlEscape) {
           R"("\"\u003cscript\u003ealert('hello!);\u003c/script\u003e":0})"));
 }
 
+TEST_P(JsonTest, EscapeInLongString) {
+  TestMessage m;
+  // Characters to escape before, across and after eight-byte boundaries.
+  m.set_string_value("0123456<89abc\"ef0123456789\x7f\xc3\xa9\n0123456789>");
+  m.add_repeated_message_value()->set_value(1);
+  m.add_repeated_message_value()->set_value(2);
+  EXPECT_THAT(ToJson(m), IsOkAndHolds(R"({"stringValue":)"
+                                      R"("0123456\u003c89abc\"ef0123456789)"
+                                      "\\u007f\xc3\xa9"
+                                      R"(\n0123456789\u003e",)"
+                                      R"("repeatedMessageValue":)"
+                                      R"([{"value":1},{"value":2}]})"));
+}
+
 TEST_P(JsonTest, FieldOrder) {
   // $ protoscope -s <<< "3: 3 22: 2 1: 1 22: 2"
   std::string out;
@@ -1351,6 +1446,59 @@ TEST(JsonErrorTest, FieldNameAndSyntaxErrorInSeparateChunks) {
                     "*@ *bool_value"));
 }
 
+TEST(JsonMessageReaderTest, Array) {
+  io::internal::TestZeroCopyInputStream input_stream(
+      {" [{\"int32Value\": 1}, {\"stri", "ngValue\": \"foo\"},", "{}] "});
+  JsonMessageReader reader(&input_stream);
+  TestMessage m;
+  ASSERT_TRUE(reader.Next(&m));
+  EXPECT_EQ(m.int32_value(), 1);
+  ASSERT_TRUE(reader.Next(&m));
+  EXPECT_EQ(m.int32_value(), 0);
+  EXPECT_EQ(m.string_value(), "foo");
+  ASSERT_TRUE(reader.Next(&m));
+  EXPECT_EQ(m.ByteSizeLong(), 0);
+  EXPECT_FALSE(reader.Next(&m));
+  EXPECT_OK(reader.status());
+}
+
+TEST(JsonMessageReaderTest, NewlineDelimited) {
+  io::internal::TestZeroCopyInputStream input_stream(
+      {"{\"int32Value\": 1}\n{\"int32V", "alue\": 2}\n", "\n"});
+  JsonMessageReader reader(&input_stream);
+  std::vector<int32_t> values;
+  TestMessage m;
+  while (reader.Next(&m)) values.push_back(m.int32_value());
+  EXPECT_OK(reader.status());
+  EXPECT_THAT(values, ElementsAre(1, 2));
+}
+
+TEST(JsonMessageReaderTest, Empty) {
+  for (absl::string_view json : {"", " \n", "[]", " [ ] "}) {
+    io::ArrayInputStream input_stream(json.data(), json.size());
+    JsonMessageReader reader(&input_stream);
+    TestMessage m;
+    EXPECT_FALSE(reader.Next(&m)) << json;
+    EXPECT_OK(reader.status()) << json;
+  }
+}
+
+TEST(JsonMessageReaderTest, Errors) {
+  for (absl::string_view json :
+       {R"([{"int32Value": 1} {}])", R"([{"int32Value": 1}, {"nope": 1}])",
+        R"([{"int32Value": 1}] {})", R"({"int32Value": 1} [)",
+        R"([{"int32Value": 1})"}) {
+    io::ArrayInputStream input_stream(json.data(), json.size());
+    JsonMessageReader reader(&input_stream);
+    TestMessage m;
+    EXPECT_TRUE(reader.Next(&m)) << json;
+    EXPECT_FALSE(reader.Next(&m)) << json;
+    EXPECT_THAT(reader.status(), StatusIs(absl::StatusCode::kInvalidArgument))
+        << json;
+    EXPECT_FALSE(reader.Next(&m)) << json;
+  }
+}
+
 }  // namespace
 }  // namespace json
 }  // namespace protobuf
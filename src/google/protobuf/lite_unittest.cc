@@ -20,6 +20,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/arena_test_util.h"
+#include "google/protobuf/implicit_weak_message.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
@@ -1324,6 +1325,46 @@ TEST(LiteBasicTest, CodedInputStreamRollback) {
   }
 }
 
+TEST(LiteBasicTest, ImplicitWeakMessageResolvesOnceLinked) {
+  using internal::ImplicitWeakMessage;
+
+  unittest::TestAllTypesLite message;
+  TestUtilLite::SetAllFields(&message);
+  for (Arena* arena : {static_cast<Arena*>(nullptr), new Arena}) {
+    MessageLite* field = Arena::CreateMessage<ImplicitWeakMessage>(arena);
+    ASSERT_TRUE(field->ParseFromString(message.SerializeAsString()));
+
+    // The true type is not linked yet, so the field stays a placeholder.
+    const void* default_instance_ptr = ImplicitWeakMessage::default_instance();
+    auto prototype = [&] {
+      return static_cast<const MessageLite*>(default_instance_ptr);
+    };
+    EXPECT_EQ(ImplicitWeakMessage::Resolve(field, prototype()), field);
+
+    internal::LinkImplicitWeakType(
+        &default_instance_ptr, &unittest::TestAllTypesLite::default_instance());
+    const MessageLite* resolved =
+        ImplicitWeakMessage::Resolve(field, prototype());
+    ASSERT_NE(resolved, field);
+    EXPECT_EQ(ImplicitWeakMessage::Resolve(field, prototype()), resolved);
+    EXPECT_EQ(resolved->GetArena(), arena);
+    TestUtilLite::ExpectAllFieldsSet(
+        static_cast<const unittest::TestAllTypesLite&>(*resolved));
+
+    EXPECT_EQ(ImplicitWeakMessage::ResolveMutable(&field, prototype()),
+              resolved);
+    EXPECT_EQ(field, resolved);
+    EXPECT_EQ(ImplicitWeakMessage::ResolveMutable(&field, prototype()),
+              resolved);
+
+    if (arena == nullptr) {
+      delete field;
+    } else {
+      delete arena;
+    }
+  }
+}
+
 }  // namespace
 }  // namespace protobuf
 }  // namespace google
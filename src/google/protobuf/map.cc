@@ -8,8 +8,10 @@
 #include "google/protobuf/map.h"
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
 #include <iterator>
+#include <memory>
 #include <string>
 #include <type_traits>
 
@@ -25,7 +27,7 @@ namespace google {
 namespace protobuf {
 namespace internal {
 
-const TableEntryPtr kGlobalEmptyTable[kGlobalEmptyTableSize] = {};
+const TableEntryPtr kGlobalEmptyTable[1 + kGlobalEmptyTableSize] = {};
 
 NodeBase* UntypedMapBase::DestroyTree(Tree* tree) {
   NodeBase* head = tree->empty() ? nullptr : tree->begin()->second;
@@ -81,8 +83,13 @@ void UntypedMapBase::TransferTree(Tree* tree, GetKey get_key) {
   do {
     NodeBase* next = node->next;
 
-    map_index_t b = VariantBucketNumber(get_key(node));
+    // Shrinking can move the nodes of a tree into a small table.
+    const BucketAndTag bt = IsSmallTable()
+                                ? BucketAndTag{FindEmptySlot(), 0}
+                                : BucketAndTagFromHash(get_key(node).Hash());
+    const map_index_t b = bt.bucket;
     // This is similar to InsertUnique, but with erasure.
+    AddToBucketFilter(b, bt.tag);
     if (TableEntryIsEmpty(b)) {
       InsertUniqueInList(b, node);
       index_of_first_non_null_ = (std::min)(index_of_first_non_null_, b);
@@ -118,6 +125,7 @@ TableEntryPtr UntypedMapBase::ConvertToTree(NodeBase* node, GetKey get_key) {
 
 void UntypedMapBase::ClearTable(const ClearInput input) {
   ABSL_DCHECK_NE(num_buckets_, kGlobalEmptyTableSize);
+  DropSortedEntries();
 
   if (alloc_.arena() == nullptr) {
     const auto loop = [=](auto destroy_node) {
@@ -198,12 +206,31 @@ auto UntypedMapBase::FindFromTree(map_index_t b, VariantKey key,
   return {nullptr, b};
 }
 
+const void* const* UntypedMapBase::CacheSortedEntries(
+    std::unique_ptr<const void*[]>& entries) const {
+  ABSL_DCHECK_NE(num_buckets_, kGlobalEmptyTableSize);
+  if (alloc_.arena() != nullptr) return entries.get();
+  const void** cached = nullptr;
+  if (SortedEntriesSlot().compare_exchange_strong(cached, entries.get(),
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_acquire)) {
+    return entries.release();
+  }
+  return cached;
+}
+
+void UntypedMapBase::DropSortedEntriesSlow() {
+  delete[] SortedEntriesSlot().exchange(nullptr, std::memory_order_relaxed);
+}
+
 size_t UntypedMapBase::SpaceUsedInTable(size_t sizeof_node) const {
   size_t size = 0;
-  // The size of the table.
-  size += sizeof(void*) * num_buckets_;
+  // The size of the table, including the bucket filters.
+  size += sizeof(TableEntryPtr) * TableAllocationSize(num_buckets_);
   // All the nodes.
   size += sizeof_node * num_elements_;
+  // The cached key order, if any.
+  if (sorted_entries() != nullptr) size += sizeof(void*) * num_elements_;
   // For each tree, count the overhead of those nodes.
   // Two buckets at a time because we only care about trees.
   for (map_index_t b = 0; b < num_buckets_; ++b) {
@@ -15,11 +15,14 @@
 #define GOOGLE_PROTOBUF_MAP_H__
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <functional>
 #include <initializer_list>
 #include <iterator>
 #include <limits>  // To support Visual Studio 2008
+#include <memory>
+#include <new>
 #include <string>
 #include <type_traits>
 #include <utility>
@@ -30,10 +33,12 @@
 
 #include "google/protobuf/stubs/common.h"
 #include "absl/base/attributes.h"
+#include "absl/base/prefetch.h"
 #include "absl/container/btree_map.h"
 #include "absl/hash/hash.h"
 #include "absl/meta/type_traits.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "google/protobuf/arena.h"
 #include "google/protobuf/generated_enum_util.h"
 #include "google/protobuf/internal_visibility.h"
@@ -72,6 +77,11 @@ class MapField;
 struct MapTestPeer;
 struct MapBenchmarkPeer;
 
+template <typename MapT>
+class MapSorterFlat;
+template <typename MapT>
+class MapSorterPtr;
+
 template <typename Key, typename T>
 class TypeDefinedMapFieldBase;
 
@@ -122,6 +132,8 @@ class MapAllocator {
     if (arena_ == nullptr) {
       return static_cast<pointer>(::operator new(n * sizeof(value_type)));
     } else {
+      internal::RecordArenaAllocation<value_type>(
+          internal::ArenaAllocationKind::kMap, n * sizeof(value_type));
       return reinterpret_cast<pointer>(
           Arena::CreateArray<uint8_t>(arena_, n * sizeof(value_type)));
     }
@@ -438,8 +450,10 @@ size_t MapValueSpaceUsedExcludingSelfLong(const T& message) {
 }
 
 constexpr size_t kGlobalEmptyTableSize = 1;
+// Preceded by the sorted entries slot of the empty table, which is always null.
+// See UntypedMapBase::SortedEntriesSlot().
 PROTOBUF_EXPORT extern const TableEntryPtr
-    kGlobalEmptyTable[kGlobalEmptyTableSize];
+    kGlobalEmptyTable[1 + kGlobalEmptyTableSize];
 
 template <typename Map,
           typename = typename std::enable_if<
@@ -529,14 +543,17 @@ class PROTOBUF_EXPORT UntypedMapBase {
         num_buckets_(internal::kGlobalEmptyTableSize),
         seed_(0),
         index_of_first_non_null_(internal::kGlobalEmptyTableSize),
-        table_(const_cast<TableEntryPtr*>(internal::kGlobalEmptyTable)),
+        table_(const_cast<TableEntryPtr*>(internal::kGlobalEmptyTable + 1)),
         alloc_(arena) {}
 
   UntypedMapBase(const UntypedMapBase&) = delete;
   UntypedMapBase& operator=(const UntypedMapBase&) = delete;
 
  protected:
-  enum { kMinTableSize = 8 };
+  // Tables with at most kMaxSmallTableSize buckets are small. Their buckets
+  // are slots that hold one node each, in no particular order: lookups scan
+  // all of them instead of hashing, and there are no bucket filters.
+  enum { kMinTableSize = 2, kMaxSmallTableSize = 8 };
 
  public:
   Arena* arena() const { return this->alloc_.arena(); }
@@ -570,6 +587,13 @@ class PROTOBUF_EXPORT UntypedMapBase {
   struct NodeAndBucket {
     NodeBase* node;
     map_index_t bucket;
+    // The filter bit of the key that was looked up. See BucketFilter().
+    uint8_t tag = 0;
+  };
+
+  struct BucketAndTag {
+    map_index_t bucket;
+    uint8_t tag;
   };
 
   // Returns whether we should insert after the head of the list. For
@@ -599,6 +623,51 @@ class PROTOBUF_EXPORT UntypedMapBase {
     }
   }
 
+  // Every bucket has a one byte filter, stored right after the table in the
+  // same allocation. Each key hashes to one bit of it (its `tag`), and the
+  // filter of a non-empty bucket has the tags of all its nodes set. Lookups of
+  // absent keys can then often skip the bucket without loading any node.
+  // Erasing a node leaves its bit behind; the filter is reset when a node is
+  // inserted into an empty bucket.
+  // Small tables have no filters.
+  uint8_t& BucketFilter(map_index_t b) const {
+    ABSL_DCHECK(!IsSmallTable());
+    return reinterpret_cast<uint8_t*>(table_ + num_buckets_)[b];
+  }
+
+  // Must be called before `node` with `tag` is inserted in bucket b.
+  void AddToBucketFilter(map_index_t b, uint8_t tag) {
+    if (IsSmallTable()) return;
+    uint8_t& filter = BucketFilter(b);
+    filter = TableEntryIsEmpty(b) ? tag : static_cast<uint8_t>(filter | tag);
+  }
+
+  // Size of the table in TableEntryPtr units, including the sorted entries
+  // slot and the bucket filters.
+  static size_t TableAllocationSize(map_index_t n) {
+    static_assert((2 * kMaxSmallTableSize) % sizeof(TableEntryPtr) == 0, "");
+    return 1 + (n <= static_cast<map_index_t>(kMaxSmallTableSize)
+                    ? n
+                    : n + n / sizeof(TableEntryPtr));
+  }
+
+  // The global empty table counts as small.
+  bool IsSmallTable() const {
+    return num_buckets_ <= static_cast<map_index_t>(kMaxSmallTableSize);
+  }
+
+  // Returns an empty slot of a small table, which must have one. The search
+  // starts at a slot picked by the seed, so that the iteration order of small
+  // maps is not deterministic. The low bits of the seed are not very random,
+  // so it is mixed like a hash value first.
+  map_index_t FindEmptySlot() const {
+    ABSL_DCHECK(IsSmallTable());
+    const map_index_t mask = num_buckets_ - 1;
+    map_index_t b = BucketAndTagFromHash(0).bucket;
+    while (!TableEntryIsEmpty(b)) b = (b + 1) & mask;
+    return b;
+  }
+
   bool TableEntryIsEmpty(map_index_t b) const {
     return internal::TableEntryIsEmpty(table_[b]);
   }
@@ -649,7 +718,8 @@ class PROTOBUF_EXPORT UntypedMapBase {
   }
 
   void DeleteTable(TableEntryPtr* table, map_index_t n) {
-    AllocFor<TableEntryPtr>(alloc_).deallocate(table, n);
+    AllocFor<TableEntryPtr>(alloc_).deallocate(table - 1,
+                                               TableAllocationSize(n));
   }
 
   NodeBase* DestroyTree(Tree* tree);
@@ -661,7 +731,7 @@ class PROTOBUF_EXPORT UntypedMapBase {
 
   map_index_t VariantBucketNumber(VariantKey key) const;
 
-  map_index_t BucketNumberFromHash(uint64_t h) const {
+  BucketAndTag BucketAndTagFromHash(uint64_t h) const {
     // We xor the hash value against the random seed so that we effectively
     // have a random hash function.
     h ^= seed_;
@@ -670,13 +740,26 @@ class PROTOBUF_EXPORT UntypedMapBase {
     // the hash value. The constant kPhi (suggested by Knuth) is roughly
     // (sqrt(5) - 1) / 2 * 2^64.
     constexpr uint64_t kPhi = uint64_t{0x9e3779b97f4a7c15};
-    return (MultiplyWithOverflow(kPhi, h) >> 32) & (num_buckets_ - 1);
+    const uint64_t mixed = MultiplyWithOverflow(kPhi, h);
+    // The tag uses the three bits just below the bucket number, so keys of the
+    // same bucket still spread over all the bits of its filter.
+    return {static_cast<map_index_t>((mixed >> 32) & (num_buckets_ - 1)),
+            static_cast<uint8_t>(1u << ((mixed >> 29) & 7))};
+  }
+
+  map_index_t BucketNumberFromHash(uint64_t h) const {
+    return BucketAndTagFromHash(h).bucket;
   }
 
   TableEntryPtr* CreateEmptyTable(map_index_t n) {
     ABSL_DCHECK_GE(n, map_index_t{kMinTableSize});
     ABSL_DCHECK_EQ(n & (n - 1), 0u);
-    TableEntryPtr* result = AllocFor<TableEntryPtr>(alloc_).allocate(n);
+    // The filters, if any, don't need to be cleared: they are reset on the
+    // first insert into each bucket.
+    TableEntryPtr* result =
+        AllocFor<TableEntryPtr>(alloc_).allocate(TableAllocationSize(n));
+    ::new (result) std::atomic<const void**>(nullptr);
+    ++result;
     memset(result, 0, n * sizeof(result[0]));
     return result;
   }
@@ -761,6 +844,38 @@ class PROTOBUF_EXPORT UntypedMapBase {
   NodeAndBucket FindFromTree(map_index_t b, VariantKey key,
                              Tree::iterator* it) const;
 
+  // The entries in key order cached by deterministic serialization live in the
+  // word right before the table, in the same allocation, so that maps do not
+  // grow by a pointer for it. Set by const methods, so that concurrent
+  // deterministic serializations of the same map may race to fill it.
+  std::atomic<const void**>& SortedEntriesSlot() const {
+    static_assert(sizeof(std::atomic<const void**>) == sizeof(TableEntryPtr),
+                  "");
+    return *reinterpret_cast<std::atomic<const void**>*>(table_ - 1);
+  }
+
+  // Returns the entries in key order if deterministic serialization cached
+  // them since the map was last modified, otherwise nullptr.
+  const void* const* sorted_entries() const {
+    return SortedEntriesSlot().load(std::memory_order_acquire);
+  }
+
+  // Caches `entries`, which holds the size() entries in key order, and returns
+  // the cached array. Takes ownership of `entries` unless the map is on an
+  // arena, where the cache could not be freed, or another thread cached the
+  // same order first. The map must not be empty.
+  const void* const* CacheSortedEntries(
+      std::unique_ptr<const void*[]>& entries) const;
+
+  // Drops the cached order. Called on every insertion and erasure.
+  void DropSortedEntries() {
+    if (PROTOBUF_PREDICT_FALSE(SortedEntriesSlot().load(
+            std::memory_order_relaxed) != nullptr)) {
+      DropSortedEntriesSlow();
+    }
+  }
+  void DropSortedEntriesSlow();
+
   // Space used for the table, trees, and nodes.
   // Does not include the indirect space used. Eg the data of a std::string.
   size_t SpaceUsedInTable(size_t sizeof_node) const;
@@ -905,6 +1020,7 @@ class KeyMapBase : public UntypedMapBase {
   friend struct MapBenchmarkPeer;
 
   PROTOBUF_NOINLINE void erase_no_destroy(map_index_t b, KeyNode* node) {
+    DropSortedEntries();
     TreeIterator tree_it;
     const bool is_list = revalidate_if_necessary(b, node, &tree_it);
     if (is_list) {
@@ -926,20 +1042,51 @@ class KeyMapBase : public UntypedMapBase {
 
   NodeAndBucket FindHelper(typename TS::ViewType k,
                            TreeIterator* it = nullptr) const {
-    map_index_t b = BucketNumber(k);
+    if (IsSmallTable()) return FindInSmallTable(k);
+    return FindHelper(k, BucketAndTagFor(k), it);
+  }
+
+  // Like above, but `bt` must be the bucket and tag of `k`.
+  NodeAndBucket FindHelper(typename TS::ViewType k, BucketAndTag bt,
+                           TreeIterator* it = nullptr) const {
+    if (IsSmallTable()) return FindInSmallTable(k);
+    const map_index_t b = bt.bucket;
+    if (TableEntryIsEmpty(b) ||
+        PROTOBUF_PREDICT_FALSE((BucketFilter(b) & bt.tag) == 0)) {
+      return {nullptr, b, bt.tag};
+    }
     if (TableEntryIsNonEmptyList(b)) {
       auto* node = internal::TableEntryToNode(table_[b]);
       do {
         if (TS::Equals(static_cast<KeyNode*>(node)->key(), k)) {
-          return {node, b};
+          return {node, b, bt.tag};
         } else {
           node = node->next;
         }
       } while (node != nullptr);
-    } else if (TableEntryIsTree(b)) {
-      return FindFromTree(b, internal::RealKeyToVariantKey<Key>{}(k), it);
+      return {nullptr, b, bt.tag};
+    }
+    NodeAndBucket res =
+        FindFromTree(b, internal::RealKeyToVariantKey<Key>{}(k), it);
+    res.tag = bt.tag;
+    return res;
+  }
+
+  // Scans all the slots of a small table. If `k` is not found, the returned
+  // bucket is an empty slot, if there is one.
+  NodeAndBucket FindInSmallTable(typename TS::ViewType k) const {
+    map_index_t empty = 0;
+    for (map_index_t b = 0; b < num_buckets_; ++b) {
+      // Slots hold a single node, but the lists are walked regardless.
+      for (NodeBase* node = TableEntryToNode(table_[b]); node != nullptr;
+           node = node->next) {
+        if (TS::Equals(static_cast<KeyNode*>(node)->key(), k)) {
+          return {node, b};
+        }
+      }
     }
-    return {nullptr, b};
+    if (num_elements_ < num_buckets_) empty = FindEmptySlot();
+    return {nullptr, empty};
   }
 
   // Insert the given node.
@@ -955,17 +1102,58 @@ class KeyMapBase : public UntypedMapBase {
     } else if (ResizeIfLoadIsOutOfRange(num_elements_ + 1)) {
       p = FindHelper(node->key());
     }
-    const map_index_t b = p.bucket;  // bucket number
-    InsertUnique(b, node);
+    InsertUnique({p.bucket, p.tag}, node);
     ++num_elements_;
     return to_erase;
   }
 
+  // Inserts the `count` nodes of the list `head`, linked through `next`, in
+  // order, as if by calling InsertOrReplaceNode for each one. The table is
+  // grown at most once, up front, to fit all of them, and shrunk at most once
+  // afterwards if duplicate keys left it oversized.
+  // Returns the list of the nodes that were replaced, giving ownership to the
+  // caller.
+  KeyNode* InsertOrReplaceNodes(KeyNode* head, size_type count) {
+    const map_index_t old_num_buckets = num_buckets_;
+    ReserveForInsert(num_elements_ + count);
+    KeyNode* replaced = nullptr;
+    while (head != nullptr) {
+      auto* next = static_cast<KeyNode*>(head->next);
+      auto p = this->FindHelper(head->key());
+      if (p.node != nullptr) {
+        erase_no_destroy(p.bucket, static_cast<KeyNode*>(p.node));
+        p.node->next = replaced;
+        replaced = static_cast<KeyNode*>(p.node);
+      }
+      InsertUnique({p.bucket, p.tag}, head);
+      ++num_elements_;
+      head = next;
+    }
+    if (replaced != nullptr) ShrinkAfterReplacing(old_num_buckets);
+    return replaced;
+  }
+
+  // Gives back the room reserved for keys that turned out to be replaced.
+  // ResizeIfLoadIsOutOfRange never shrinks small tables, so those go back to
+  // the size that inserting the nodes one by one would have reached.
+  void ShrinkAfterReplacing(map_index_t old_num_buckets) {
+    const auto max_small = static_cast<map_index_t>(kMaxSmallTableSize);
+    if (old_num_buckets > max_small || num_elements_ > max_small) {
+      ResizeIfLoadIsOutOfRange(num_elements_);
+      return;
+    }
+    map_index_t new_num_buckets =
+        (std::max)(static_cast<map_index_t>(kMinTableSize), old_num_buckets);
+    while (new_num_buckets < num_elements_) new_num_buckets *= 2;
+    if (new_num_buckets != num_buckets_) Resize(new_num_buckets);
+  }
+
   // Insert the given Node in bucket b.  If that would make bucket b too big,
   // and bucket b is not a tree, create a tree for buckets b.
-  // Requires count(*KeyPtrFromNodePtr(node)) == 0 and that b is the correct
-  // bucket.  num_elements_ is not modified.
-  void InsertUnique(map_index_t b, KeyNode* node) {
+  // Requires count(*KeyPtrFromNodePtr(node)) == 0 and that bt is the correct
+  // bucket and tag.  num_elements_ is not modified.
+  void InsertUnique(BucketAndTag bt, KeyNode* node) {
+    const map_index_t b = bt.bucket;
     ABSL_DCHECK(index_of_first_non_null_ == num_buckets_ ||
                 !TableEntryIsEmpty(index_of_first_non_null_));
     // In practice, the code that led to this point may have already
@@ -973,6 +1161,8 @@ class KeyMapBase : public UntypedMapBase {
     // or whatever.  But it's probably cheap enough to recompute that here;
     // it's likely that we're inserting into an empty or short list.
     ABSL_DCHECK(FindHelper(node->key()).node == nullptr);
+    DropSortedEntries();
+    AddToBucketFilter(b, bt.tag);
     if (TableEntryIsEmpty(b)) {
       InsertUniqueInList(b, node);
       index_of_first_non_null_ = (std::min)(index_of_first_non_null_, b);
@@ -997,9 +1187,9 @@ class KeyMapBase : public UntypedMapBase {
   // policy that sometimes we resize down as well as up, clients can easily
   // keep O(size()) = O(number of buckets) if they want that.
   bool ResizeIfLoadIsOutOfRange(size_type new_size) {
-    const size_type kMaxMapLoadTimes16 = 12;  // controls RAM vs CPU tradeoff
-    const size_type hi_cutoff = num_buckets_ * kMaxMapLoadTimes16 / 16;
-    const size_type lo_cutoff = hi_cutoff / 4;
+    const size_type hi_cutoff = CalculateHiCutoff(num_buckets_);
+    // Small tables are never shrunk.
+    const size_type lo_cutoff = IsSmallTable() ? 0 : hi_cutoff / 4;
     // We don't care how many elements are in trees.  If a lot are,
     // we may resize even though there are many empty buckets.  In
     // practice, this seems fine.
@@ -1020,6 +1210,8 @@ class KeyMapBase : public UntypedMapBase {
       }
       size_type new_num_buckets = std::max<size_type>(
           kMinTableSize, num_buckets_ >> lg2_of_size_reduction_factor);
+      // A small table must have a slot for every element.
+      while (new_num_buckets < new_size) new_num_buckets *= 2;
       if (new_num_buckets != num_buckets_) {
         Resize(new_num_buckets);
         return true;
@@ -1028,18 +1220,43 @@ class KeyMapBase : public UntypedMapBase {
     return false;
   }
 
+  // Grows the table, if needed, so that it can hold `new_size` elements
+  // without resizing again. Unlike ResizeIfLoadIsOutOfRange, it never shrinks.
+  void ReserveForInsert(size_type new_size) {
+    if (PROTOBUF_PREDICT_TRUE(new_size < CalculateHiCutoff(num_buckets_))) {
+      return;
+    }
+    map_index_t new_num_buckets = TableSize(num_buckets_);
+    while (new_size >= CalculateHiCutoff(new_num_buckets) &&
+           new_num_buckets <= max_size() / 2) {
+      new_num_buckets *= 2;
+    }
+    if (new_num_buckets != num_buckets_) Resize(new_num_buckets);
+  }
+
+  // Returns the number of elements for which a table of `num_buckets` has to
+  // grow.
+  static size_type CalculateHiCutoff(size_type num_buckets) {
+    if (num_buckets == kGlobalEmptyTableSize) return 0;
+    // Small tables can be filled up.
+    if (num_buckets <= kMaxSmallTableSize) return num_buckets + 1;
+    const size_type kMaxMapLoadTimes16 = 12;  // controls RAM vs CPU tradeoff
+    return num_buckets * kMaxMapLoadTimes16 / 16;
+  }
+
   // Resize to the given number of buckets.
   void Resize(map_index_t new_num_buckets) {
     if (num_buckets_ == kGlobalEmptyTableSize) {
       // This is the global empty array.
       // Just overwrite with a new one. No need to transfer or free anything.
-      num_buckets_ = index_of_first_non_null_ = kMinTableSize;
+      num_buckets_ = index_of_first_non_null_ = TableSize(new_num_buckets);
       table_ = CreateEmptyTable(num_buckets_);
       seed_ = Seed();
       return;
     }
 
     ABSL_DCHECK_GE(new_num_buckets, kMinTableSize);
+    DropSortedEntries();
     const auto old_table = table_;
     const map_index_t old_table_size = num_buckets_;
     num_buckets_ = new_num_buckets;
@@ -1060,15 +1277,36 @@ class KeyMapBase : public UntypedMapBase {
   void TransferList(KeyNode* node) {
     do {
       auto* next = static_cast<KeyNode*>(node->next);
-      InsertUnique(BucketNumber(node->key()), node);
+      InsertUnique(IsSmallTable() ? BucketAndTag{FindEmptySlot(), 0}
+                                  : BucketAndTagFor(node->key()),
+                   node);
       node = next;
     } while (node != nullptr);
   }
 
   map_index_t BucketNumber(typename TS::ViewType k) const {
+    return BucketAndTagFor(k).bucket;
+  }
+
+  BucketAndTag BucketAndTagFor(typename TS::ViewType k) const {
     ABSL_DCHECK_EQ(BucketNumberFromHash(hash_function()(k)),
                    VariantBucketNumber(RealKeyToVariantKey<Key>{}(k)));
-    return BucketNumberFromHash(hash_function()(k));
+    return BucketAndTagFromHash(hash_function()(k));
+  }
+
+  // Prefetches the table entry and filter of bucket `b`.
+  void PrefetchBucket(map_index_t b) const {
+    absl::PrefetchToLocalCache(&table_[b]);
+    if (!IsSmallTable()) absl::PrefetchToLocalCache(&BucketFilter(b));
+  }
+
+  // Prefetches the first node of bucket `b`, if it is a list. Best called a
+  // while after PrefetchBucket(b).
+  void PrefetchBucketHead(map_index_t b) const {
+    const TableEntryPtr entry = table_[b];
+    if (internal::TableEntryIsNonEmptyList(entry)) {
+      absl::PrefetchToLocalCache(TableEntryToNode(entry));
+    }
   }
 
   // Assumes node_ and m_ are correct and non-null, but other fields may be
@@ -1393,6 +1631,62 @@ class Map : private internal::KeyMapBase<internal::KeyForBase<Key>> {
     return find(key) != end();
   }
 
+  // A lookup key together with its hash. The hash does not depend on the map,
+  // so a PrehashedKey can look up the same key in many maps while hashing it
+  // only once. For string keys it refers to the characters of the key, which
+  // must outlive it.
+  class PrehashedKey {
+   public:
+    template <typename K = key_type>
+    explicit PrehashedKey(const key_arg<K>& key)
+        : key_(TS::ToView(key)), hash_(hasher()(key_)) {}
+
+   private:
+    friend class Map;
+
+    typename TS::ViewType key_;
+    uint64_t hash_;
+  };
+
+  const_iterator find(const PrehashedKey& key) const
+      ABSL_ATTRIBUTE_LIFETIME_BOUND {
+    return const_cast<Map*>(this)->find(key);
+  }
+  iterator find(const PrehashedKey& key) ABSL_ATTRIBUTE_LIFETIME_BOUND {
+    auto res = this->FindHelper(key.key_, this->BucketAndTagFromHash(key.hash_));
+    return iterator(static_cast<Node*>(res.node), this, res.bucket);
+  }
+
+  bool contains(const PrehashedKey& key) const { return find(key) != end(); }
+
+  // Looks up each of `keys`, storing an iterator to its element, or end(), in
+  // the corresponding element of `results`, which must have the same size.
+  // The buckets of the following keys are prefetched while looking up each
+  // key, which hides most of the memory latency of lookups in large maps.
+  void find(absl::Span<const PrehashedKey> keys,
+            absl::Span<const_iterator> results) const {
+    ABSL_DCHECK_EQ(keys.size(), results.size());
+    // How many keys ahead the table entry, and then the first node, of a
+    // bucket is prefetched.
+    constexpr size_t kPrefetchDistance = 8;
+    const size_t size = keys.size();
+    const auto bucket = [&](size_t i) {
+      return this->BucketAndTagFromHash(keys[i].hash_).bucket;
+    };
+    for (size_t i = 0; i < (std::min)(size, 2 * kPrefetchDistance); ++i) {
+      this->PrefetchBucket(bucket(i));
+    }
+    for (size_t i = 0; i < size; ++i) {
+      if (i + 2 * kPrefetchDistance < size) {
+        this->PrefetchBucket(bucket(i + 2 * kPrefetchDistance));
+      }
+      if (i + kPrefetchDistance < size) {
+        this->PrefetchBucketHead(bucket(i + kPrefetchDistance));
+      }
+      results[i] = find(keys[i]);
+    }
+  }
+
   template <typename K = key_type>
   std::pair<const_iterator, const_iterator> equal_range(
       const key_arg<K>& key) const ABSL_ATTRIBUTE_LIFETIME_BOUND {
@@ -1591,6 +1885,7 @@ class Map : private internal::KeyMapBase<internal::KeyForBase<Key>> {
       p = this->FindHelper(TS::ToView(k));
     }
     const auto b = p.bucket;  // bucket number
+    const auto tag = p.tag;
     // If K is not key_type, make the conversion to key_type explicit.
     using TypeToInit = typename std::conditional<
         std::is_same<typename std::decay<K>::type, key_type>::value, K&&,
@@ -1611,7 +1906,7 @@ class Map : private internal::KeyMapBase<internal::KeyForBase<Key>> {
     Arena::CreateInArenaStorage(&node->kv.second, this->alloc_.arena(),
                                 std::forward<Args>(args)...);
 
-    this->InsertUnique(b, node);
+    this->InsertUnique({b, tag}, node);
     ++this->num_elements_;
     return std::make_pair(iterator(node, this, b), true);
   }
@@ -1669,6 +1964,10 @@ class Map : private internal::KeyMapBase<internal::KeyForBase<Key>> {
   friend class internal::TcParser;
   friend struct internal::MapTestPeer;
   friend struct internal::MapBenchmarkPeer;
+  template <typename MapT>
+  friend class internal::MapSorterFlat;
+  template <typename MapT>
+  friend class internal::MapSorterPtr;
 };
 
 namespace internal {
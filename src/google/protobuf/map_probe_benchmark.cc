@@ -5,6 +5,7 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 
+#include <chrono>  // NOLINT(build/c++11)
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
@@ -12,6 +13,7 @@
 #include <string>
 #include <vector>
 
+#include "absl/numeric/bits.h"
 #include "absl/random/random.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
@@ -49,6 +51,33 @@ struct MapBenchmarkPeer {
     return total_probe_cost / map.size();
   }
 
+  // Returns the mean number of keys compared when looking up a key that is
+  // not in the map. With `use_filter`, buckets whose filter rejects the key
+  // are not probed.
+  template <typename T>
+  static double GetMeanMissProbeLength(const T& map, bool use_filter) {
+    double total_probe_cost = 0;
+    for (map_index_t b = 0; b < map.num_buckets_; ++b) {
+      if (map.TableEntryIsEmpty(b)) continue;
+      double cost;
+      if (map.TableEntryIsList(b)) {
+        cost = 0;
+        for (auto* node = internal::TableEntryToNode(map.table_[b]);
+             node != nullptr; node = node->next) {
+          ++cost;
+        }
+      } else {
+        size_t tree_size = TableEntryToTree(map.table_[b])->size();
+        cost = std::log2(tree_size);
+      }
+      // A missing key has each of the 8 tags with the same probability.
+      const double probe_probability =
+          use_filter ? absl::popcount(map.BucketFilter(b)) / 8.0 : 1.0;
+      total_probe_cost += cost * probe_probability;
+    }
+    return total_probe_cost / map.num_buckets_;
+  }
+
   template <typename T>
   static double GetPercentTree(const T& map) {
     size_t total_tree_size = 0;
@@ -61,8 +90,7 @@ struct MapBenchmarkPeer {
            static_cast<double>(map.size());
   }
 };
-}  // namespace protobuf
-}  // namespace google::internal
+}  // namespace google::protobuf::internal
 
 namespace {
 
@@ -112,8 +140,31 @@ struct Ratios {
   double avg_load;
   double max_load;
   double percent_tree;
+  // Mean keys compared on a lookup miss at max load, with and without the
+  // bucket filters.
+  double miss_filtered;
+  double miss_unfiltered;
+  // Nanoseconds per lookup at max load.
+  double hit_latency;
+  double miss_latency;
 };
 
+// Returns the mean time in nanoseconds of looking up each of `keys` in `t`.
+template <typename Key>
+double MeasureLookupLatency(const Table<Key>& t, const std::vector<Key>& keys) {
+  constexpr int kRounds = 10;
+  size_t found = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < kRounds; ++round) {
+    for (const Key& key : keys) found += t.find(key) != t.end();
+  }
+  const auto end = std::chrono::steady_clock::now();
+  // Keep the lookups from being optimized away.
+  if (found == ~size_t{0}) absl::PrintF("");
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         static_cast<double>(kRounds * keys.size());
+}
+
 template <class ElemFn>
 Ratios CollectMeanProbeLengths() {
   const auto min_max_sizes = GetMinMaxLoadSizes();
@@ -133,6 +184,18 @@ Ratios CollectMeanProbeLengths() {
   while (t.size() < min_max_sizes.max_load) t[elem()];
   result.max_load = Peer::GetMeanProbeLength(t);
   result.percent_tree = Peer::GetPercentTree(t);
+  result.miss_filtered = Peer::GetMeanMissProbeLength(t, true);
+  result.miss_unfiltered = Peer::GetMeanMissProbeLength(t, false);
+
+  std::vector<Key> hits;
+  for (const auto& entry : t) hits.push_back(entry.first);
+  std::vector<Key> misses;
+  while (misses.size() < hits.size()) {
+    Key key = elem();
+    if (!t.contains(key)) misses.push_back(key);
+  }
+  result.hit_latency = MeasureLookupLatency(t, hits);
+  result.miss_latency = MeasureLookupLatency(t, misses);
 
   return result;
 }
@@ -280,13 +343,16 @@ int main(int argc, char** argv) {
   absl::PrintF("  \"benchmarks\": [\n");
   absl::string_view comma;
   for (const auto& result : results) {
-    auto print = [&](absl::string_view stat, double Ratios::*val) {
+    auto print = [&](absl::string_view stat, double Ratios::*val,
+                     bool is_time = false) {
       std::string name =
           absl::StrCat(result.name, "/", result.dist_name, "/", stat);
+      const double time = is_time ? result.ratios.*val : 0;
       absl::PrintF("    %s{\n", comma);
-      absl::PrintF("      \"cpu_time\": 0,\n");
-      absl::PrintF("      \"real_time\": 0,\n");
-      absl::PrintF("      \"allocs_per_iter\": %f,\n", result.ratios.*val);
+      absl::PrintF("      \"cpu_time\": %f,\n", time);
+      absl::PrintF("      \"real_time\": %f,\n", time);
+      absl::PrintF("      \"allocs_per_iter\": %f,\n",
+                   is_time ? 0 : result.ratios.*val);
 
       absl::PrintF("      \"iterations\": 1,\n");
       absl::PrintF("      \"name\": \"%s\",\n", name);
@@ -298,6 +364,10 @@ int main(int argc, char** argv) {
     print("avg", &Ratios::avg_load);
     print("max", &Ratios::max_load);
     print("tree_percent", &Ratios::percent_tree);
+    print("miss_filtered", &Ratios::miss_filtered);
+    print("miss_unfiltered", &Ratios::miss_unfiltered);
+    print("hit_latency", &Ratios::hit_latency, true);
+    print("miss_latency", &Ratios::miss_latency, true);
   }
   absl::PrintF("  ],\n");
   absl::PrintF("  \"context\": {\n");
@@ -126,6 +126,9 @@ class MapTypeHandler<WireFormatLite::TYPE_MESSAGE, Type> {
     static inline uint8_t* Write(int field, const MapEntryAccessorType& value, \
                                  uint8_t* ptr,                                 \
                                  io::EpsCopyOutputStream* stream);             \
+    /* Like Write, but the caller must have ensured there is enough space. */  \
+    static inline uint8_t* WriteToArray(                                       \
+        int field, const MapEntryAccessorType& value, uint8_t* ptr);           \
     static inline const MapEntryAccessorType& GetExternalReference(            \
         const TypeOnMemory& value);                                            \
     static inline void DeleteNoArena(const TypeOnMemory& x);                   \
@@ -292,6 +295,33 @@ WRITE_METHOD(BOOL, Bool)
 
 #undef WRITE_METHOD
 
+#define WRITE_TO_ARRAY_METHOD(FieldType, DeclaredType)                      \
+  template <typename Type>                                                  \
+  inline uint8_t*                                                           \
+  MapTypeHandler<WireFormatLite::TYPE_##FieldType, Type>::WriteToArray(     \
+      int field, const MapEntryAccessorType& value, uint8_t* ptr) {         \
+    return WireFormatLite::Write##DeclaredType##ToArray(field, value, ptr); \
+  }
+
+WRITE_TO_ARRAY_METHOD(STRING, String)
+WRITE_TO_ARRAY_METHOD(BYTES, Bytes)
+WRITE_TO_ARRAY_METHOD(INT64, Int64)
+WRITE_TO_ARRAY_METHOD(UINT64, UInt64)
+WRITE_TO_ARRAY_METHOD(INT32, Int32)
+WRITE_TO_ARRAY_METHOD(UINT32, UInt32)
+WRITE_TO_ARRAY_METHOD(SINT64, SInt64)
+WRITE_TO_ARRAY_METHOD(SINT32, SInt32)
+WRITE_TO_ARRAY_METHOD(ENUM, Enum)
+WRITE_TO_ARRAY_METHOD(DOUBLE, Double)
+WRITE_TO_ARRAY_METHOD(FLOAT, Float)
+WRITE_TO_ARRAY_METHOD(FIXED64, Fixed64)
+WRITE_TO_ARRAY_METHOD(FIXED32, Fixed32)
+WRITE_TO_ARRAY_METHOD(SFIXED64, SFixed64)
+WRITE_TO_ARRAY_METHOD(SFIXED32, SFixed32)
+WRITE_TO_ARRAY_METHOD(BOOL, Bool)
+
+#undef WRITE_TO_ARRAY_METHOD
+
 template <typename Type>
 inline bool MapTypeHandler<WireFormatLite::TYPE_MESSAGE, Type>::Read(
     io::CodedInputStream* input, MapEntryAccessorType* value) {
@@ -577,14 +607,10 @@ struct MapEntryFuncs {
   static uint8_t* InternalSerialize(int field_number, const Key& key,
                                     const Value& value, uint8_t* ptr,
                                     io::EpsCopyOutputStream* stream) {
-    ptr = stream->EnsureSpace(ptr);
-    ptr = WireFormatLite::WriteTagToArray(
-        field_number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, ptr);
-    ptr = io::CodedOutputStream::WriteVarint32ToArray(GetCachedSize(key, value),
-                                                      ptr);
-
-    ptr = KeyTypeHandler::Write(kKeyFieldNumber, key, ptr, stream);
-    return ValueTypeHandler::Write(kValueFieldNumber, value, ptr, stream);
+    return InternalSerialize(
+        field_number, key, value, ptr, stream,
+        std::integral_constant<bool, kValueFieldType ==
+                                         WireFormatLite::TYPE_MESSAGE>());
   }
 
   static size_t ByteSizeLong(const Key& key, const Value& value) {
@@ -600,6 +626,47 @@ struct MapEntryFuncs {
     return 2 + KeyTypeHandler::GetCachedSize(key) +
            ValueTypeHandler::GetCachedSize(value);
   }
+
+ private:
+  // Message values.
+  static uint8_t* InternalSerialize(int field_number, const Key& key,
+                                    const Value& value, uint8_t* ptr,
+                                    io::EpsCopyOutputStream* stream,
+                                    std::true_type) {
+    ptr = stream->EnsureSpace(ptr);
+    ptr = WireFormatLite::WriteTagToArray(
+        field_number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, ptr);
+    ptr = io::CodedOutputStream::WriteVarint32ToArray(GetCachedSize(key, value),
+                                                      ptr);
+
+    ptr = KeyTypeHandler::Write(kKeyFieldNumber, key, ptr, stream);
+    return ValueTypeHandler::Write(kValueFieldNumber, value, ptr, stream);
+  }
+
+  // Scalar and string values. Most such entries, with their tag and length,
+  // fit in the slop bytes, so the whole entry is written after checking for
+  // space once.
+  static uint8_t* InternalSerialize(int field_number, const Key& key,
+                                    const Value& value, uint8_t* ptr,
+                                    io::EpsCopyOutputStream* stream,
+                                    std::false_type) {
+    const uint32_t entry_size = static_cast<uint32_t>(GetCachedSize(key, value));
+    const uint32_t tag = WireFormatLite::MakeTag(
+        field_number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+    ptr = stream->EnsureSpace(ptr);
+    const bool fits =
+        io::CodedOutputStream::VarintSize32(tag) +
+            io::CodedOutputStream::VarintSize32(entry_size) + entry_size <=
+        io::EpsCopyOutputStream::kSlopBytes;
+    ptr = io::CodedOutputStream::WriteVarint32ToArray(tag, ptr);
+    ptr = io::CodedOutputStream::WriteVarint32ToArray(entry_size, ptr);
+    if (fits) {
+      ptr = KeyTypeHandler::WriteToArray(kKeyFieldNumber, key, ptr);
+      return ValueTypeHandler::WriteToArray(kValueFieldNumber, value, ptr);
+    }
+    ptr = KeyTypeHandler::Write(kKeyFieldNumber, key, ptr, stream);
+    return ValueTypeHandler::Write(kValueFieldNumber, value, ptr, stream);
+  }
 };
 
 }  // namespace internal
@@ -11,11 +11,11 @@
 
 #include "google/protobuf/message.h"
 
+#include <atomic>
 #include <iostream>
 #include <stack>
 
 #include "absl/base/casts.h"
-#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
@@ -144,11 +144,28 @@ const char* Message::_InternalParse(const char* ptr,
 
 uint8_t* Message::_InternalSerialize(uint8_t* target,
                                      io::EpsCopyOutputStream* stream) const {
+#if defined(PROTOBUF_USE_TABLE_PARSER_ON_REFLECTION)
+  // Map entries always serialize their key and value, which the table can't
+  // express.
+  auto meta = GetMetadata();
+  if (!meta.descriptor->options().map_entry()) {
+    return internal::TcParser::SerializeWithTable(
+        *this, meta.reflection->GetTcParseTable(), target, stream);
+  }
+#endif
   return WireFormat::_InternalSerialize(*this, target, stream);
 }
 
 size_t Message::ByteSizeLong() const {
+#if defined(PROTOBUF_USE_TABLE_PARSER_ON_REFLECTION)
+  auto meta = GetMetadata();
+  size_t size = meta.descriptor->options().map_entry()
+                    ? WireFormat::ByteSize(*this)
+                    : internal::TcParser::ByteSizeWithTable(
+                          *this, meta.reflection->GetTcParseTable());
+#else
   size_t size = WireFormat::ByteSize(*this);
+#endif
 
   auto* cached_size = AccessCachedSize();
   ABSL_CHECK(cached_size != nullptr)
@@ -182,6 +199,14 @@ size_t Message::SpaceUsedLong() const {
   return GetReflection()->SpaceUsedLong(*this);
 }
 
+size_t Message::ArenaSpaceUsedLong() const {
+  return GetReflection()->ArenaSpaceUsedLong(*this);
+}
+
+size_t Message::HeapSpaceUsedLong() const {
+  return GetReflection()->HeapSpaceUsedLong(*this);
+}
+
 namespace internal {
 void* CreateSplitMessageGeneric(Arena* arena, const void* default_split,
                                 size_t size, const void* message,
@@ -199,7 +224,7 @@ void* CreateSplitMessageGeneric(Arena* arena, const void* default_split,
 
 MessageFactory::~MessageFactory() {}
 
-namespace {
+namespace internal {
 
 class GeneratedMessageFactory final : public MessageFactory {
  public:
@@ -212,12 +237,10 @@ class GeneratedMessageFactory final : public MessageFactory {
   const Message* GetPrototype(const Descriptor* type) override;
 
  private:
-  const Message* FindInTypeMap(const Descriptor* type)
-      ABSL_SHARED_LOCKS_REQUIRED(mutex_)
-  {
-    auto it = type_map_.find(type);
-    if (it == type_map_.end()) return nullptr;
-    return it->second;
+  // Registered types are published in their descriptor, so lookups of them
+  // are a single atomic load.
+  static const Message* FindRegistered(const Descriptor* type) {
+    return type->generated_prototype_.load(std::memory_order_acquire);
   }
 
   const google::protobuf::internal::DescriptorTable* FindInFileMap(
@@ -261,9 +284,8 @@ class GeneratedMessageFactory final : public MessageFactory {
                       DescriptorByNameHash, DescriptorByNameEq>
       files_;
 
+  // Serializes the registration of files.
   absl::Mutex mutex_;
-  absl::flat_hash_map<const Descriptor*, const Message*> type_map_
-      ABSL_GUARDED_BY(mutex_);
 };
 
 GeneratedMessageFactory* GeneratedMessageFactory::singleton() {
@@ -289,19 +311,19 @@ void GeneratedMessageFactory::RegisterType(const Descriptor* descriptor,
   // function during GetPrototype(), in which case we already have locked
   // the mutex.
   mutex_.AssertHeld();
-  if (!type_map_.try_emplace(descriptor, prototype).second) {
+  if (descriptor->generated_prototype_.load(std::memory_order_relaxed) !=
+      nullptr) {
     ABSL_DLOG(FATAL) << "Type is already registered: "
                      << descriptor->full_name();
+    return;
   }
+  descriptor->generated_prototype_.store(prototype, std::memory_order_release);
 }
 
 
 const Message* GeneratedMessageFactory::GetPrototype(const Descriptor* type) {
-  {
-    absl::ReaderMutexLock lock(&mutex_);
-    const Message* result = FindInTypeMap(type);
-    if (result != nullptr) return result;
-  }
+  const Message* result = FindRegistered(type);
+  if (result != nullptr) return result;
 
   // If the type is not in the generated pool, then we can't possibly handle
   // it.
@@ -320,12 +342,12 @@ const Message* GeneratedMessageFactory::GetPrototype(const Descriptor* type) {
   absl::WriterMutexLock lock(&mutex_);
 
   // Check if another thread preempted us.
-  const Message* result = FindInTypeMap(type);
+  result = FindRegistered(type);
   if (result == nullptr) {
     // Nope.  OK, register everything.
     internal::RegisterFileLevelMetadata(registration_data);
     // Should be here now.
-    result = FindInTypeMap(type);
+    result = FindRegistered(type);
   }
 
   if (result == nullptr) {
@@ -336,20 +358,21 @@ const Message* GeneratedMessageFactory::GetPrototype(const Descriptor* type) {
   return result;
 }
 
-}  // namespace
+}  // namespace internal
 
 MessageFactory* MessageFactory::generated_factory() {
-  return GeneratedMessageFactory::singleton();
+  return internal::GeneratedMessageFactory::singleton();
 }
 
 void MessageFactory::InternalRegisterGeneratedFile(
     const google::protobuf::internal::DescriptorTable* table) {
-  GeneratedMessageFactory::singleton()->RegisterFile(table);
+  internal::GeneratedMessageFactory::singleton()->RegisterFile(table);
 }
 
 void MessageFactory::InternalRegisterGeneratedMessage(
     const Descriptor* descriptor, const Message* prototype) {
-  GeneratedMessageFactory::singleton()->RegisterType(descriptor, prototype);
+  internal::GeneratedMessageFactory::singleton()->RegisterType(descriptor,
+                                                               prototype);
 }
 
 
@@ -87,6 +87,8 @@
 #ifndef GOOGLE_PROTOBUF_MESSAGE_H__
 #define GOOGLE_PROTOBUF_MESSAGE_H__
 
+#include <cstdint>
+#include <cstring>
 #include <iosfwd>
 #include <string>
 #include <type_traits>
@@ -101,6 +103,7 @@
 #include "absl/log/absl_log.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "google/protobuf/arena.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/generated_message_reflection.h"
@@ -128,7 +131,9 @@ class MessageFactory;
 
 // Defined in other files.
 class AssignDescriptorsHelper;
+class ColumnarView;
 class DynamicMessageFactory;
+class FieldProjection;
 class GeneratedMessageReflectionTestHelper;
 class MapKey;
 class MapValueConstRef;
@@ -159,6 +164,9 @@ class MessageReflectionFriend;
 namespace expr {
 class CelMapReflectionFriend;  // field_backed_map_impl.cc
 }
+namespace json_internal {
+struct UnparseProto2Descriptor;  // unparser_traits.h
+}
 
 namespace internal {
 class MapFieldPrinterHelper;  // text_format.cc
@@ -188,6 +196,9 @@ class RepeatedField;  // repeated_field.h
 template <typename T>
 class RepeatedPtrField;  // repeated_field.h
 
+template <typename T>
+class FieldAccessor;  // below
+
 // A container to hold message metadata.
 struct Metadata {
   const Descriptor* descriptor;
@@ -213,6 +224,60 @@ const To& GetConstRefAtOffset(const Message& message, uint32_t offset) {
 
 bool CreateUnknownEnumValues(const FieldDescriptor* field);
 
+// Where a FieldAccessor finds its field in messages.
+struct FieldAccessorLayout {
+  enum Kind : uint8_t {
+    kImplicit,    // At `offset`, set if not zero or empty.
+    kHasBit,      // At `offset`, set if bit `presence_value` of the word at
+                  // `presence_offset` is.
+    kOneof,       // At `offset` while the oneof case at `presence_offset` is
+                  // `presence_value`, the field number.
+    kReflection,  // Only reachable through Reflection.
+  };
+  Kind kind = kReflection;
+  // Whether Set() goes through Reflection anyway, to check the value.
+  bool set_through_reflection = false;
+  uint32_t offset = 0;
+  uint32_t presence_offset = 0;
+  uint32_t presence_value = 0;
+};
+
+struct ArenaStringPtr;
+
+// How a FieldAccessor<T> reads and writes a field at its offset in messages.
+template <typename T>
+struct FieldAccessorOps {
+  using Storage = T;
+  // Whether a field without presence is set.  Like reflection, compares the
+  // bits so that -0.0 is set.
+  static bool IsSet(const T& value) {
+    std::conditional_t<sizeof(T) == 8, uint64_t,
+                       std::conditional_t<sizeof(T) == 4, uint32_t, bool>>
+        bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits != 0;
+  }
+  // The value of a present field, or nullptr to ask Reflection for it.
+  static const T* Get(const T& value) { return &value; }
+  static void Set(T* value, T new_value, Arena*) { *value = new_value; }
+};
+
+// Strings are ArenaStringPtrs, defined in generated_message_reflection.cc.
+template <>
+struct PROTOBUF_EXPORT FieldAccessorOps<std::string> {
+  using Storage = ArenaStringPtr;
+  static bool IsSet(const ArenaStringPtr& value);
+  // Returns nullptr for the default value, which is not always empty.
+  static const std::string* Get(const ArenaStringPtr& value);
+  static void Set(ArenaStringPtr* value, absl::string_view new_value,
+                  Arena* arena);
+};
+
+// How Reflection merges two messages of its type, and counts the memory they
+// hold; see generated_message_reflection.cc.
+struct MergePlan;
+struct SpaceUsedPlan;
+
 // Returns true if "message" is a descendant of "root".
 PROTOBUF_EXPORT bool IsDescendant(Message& root, const Message& message);
 }  // namespace internal
@@ -303,6 +368,28 @@ class PROTOBUF_EXPORT Message : public MessageLite {
     return internal::ToIntSize(SpaceUsedLong());
   }
 
+  // Returns the number of bytes of arena memory held by this message and its
+  // subtree: the message objects, repeated field arrays including their
+  // unused capacity, cleared repeated elements and string objects, with
+  // allocation padding. Heap memory such as out-of-line string buffers is not
+  // included, and submessages owned by a different arena are skipped. Returns
+  // 0 for messages that are not allocated on an arena.
+  //
+  // This is meant for finding which parts of a message dominate the memory
+  // of an arena; like SpaceUsedLong() it is implemented using reflection.
+  size_t ArenaSpaceUsedLong() const;
+
+  // Returns (an estimate of) the number of bytes of heap memory held by this
+  // message and its subtree.  For messages not on an arena this is what
+  // SpaceUsedLong() returns, without the fuzz factor of debug builds.  For
+  // messages on an arena, memory allocated on the arena, such as the message
+  // objects and repeated field arrays, is left out but the out-of-line
+  // buffers of strings and cords, and submessages on the heap, are counted.
+  //
+  // Like SpaceUsedLong(), this reads only the fields that hold memory outside
+  // of the message object, as found once per message type.
+  size_t HeapSpaceUsedLong() const;
+
   // Debugging & Testing----------------------------------------------
 
   // Generates a human-readable form of this message for debugging purposes.
@@ -439,6 +526,12 @@ class PROTOBUF_EXPORT Reflection final {
   // Estimate the amount of memory used by the message object.
   size_t SpaceUsedLong(const Message& message) const;
 
+  // See Message::ArenaSpaceUsedLong().
+  size_t ArenaSpaceUsedLong(const Message& message) const;
+
+  // See Message::HeapSpaceUsedLong().
+  size_t HeapSpaceUsedLong(const Message& message) const;
+
   [[deprecated("Please use SpaceUsedLong() instead")]] int SpaceUsed(
       const Message& message) const {
     return internal::ToIntSize(SpaceUsedLong(message));
@@ -818,6 +911,36 @@ class PROTOBUF_EXPORT Reflection final {
   MutableRepeatedFieldRef<T> GetMutableRepeatedFieldRef(
       Message* message, const FieldDescriptor* field) const;
 
+  // Returns a handle for reading and writing the singular, non-message
+  // `field` of messages of this type.  The checks that the accessors above
+  // make on every call, and the lookup of where messages keep the field, are
+  // done once here; see FieldAccessor.  T is as for GetRepeatedFieldRef(),
+  // with int32_t for enum fields.  Singular cord fields are not supported.
+  template <typename T>
+  FieldAccessor<T> GetFieldAccessor(const FieldDescriptor* field) const;
+
+  // A field to read with GetColumns().
+  struct FieldColumn {
+    // A singular, non-message field of this type.  Cord fields are not
+    // supported.
+    const FieldDescriptor* field;
+    // Receives one value per message, as Get*() would return it: an array of
+    // the field's C++ type as for GetFieldAccessor(), except that string
+    // fields are read as absl::string_view.  The strings point into the
+    // messages, or at the field's default value.
+    void* values;
+    // If not null, receives one HasField() result per message.
+    bool* has = nullptr;
+  };
+
+  // Reads the fields of `columns` from each of `messages`, which must all be
+  // of this type, so that columns[i].values[j] holds the value of field i in
+  // message j.  Like a FieldAccessor for each column, but the fields are
+  // looked up once per call, read in the order messages keep them in and
+  // their has-bits loaded a word at a time.
+  void GetColumns(absl::Span<const Message* const> messages,
+                  absl::Span<const FieldColumn> columns) const;
+
   // DEPRECATED. Please use Get(Mutable)RepeatedFieldRef() for repeated field
   // access. The following repeated field accessors will be removed in the
   // future.
@@ -1034,7 +1157,66 @@ class PROTOBUF_EXPORT Reflection final {
     return tcparse_table_;
   }
 
-  const TcParseTableBase* CreateTcParseTable() const;
+  // How MergeInPlaceFields() merges messages of this type, built on demand.
+  mutable absl::once_flag merge_plan_once_;
+  mutable const internal::MergePlan* merge_plan_ = nullptr;
+
+  const internal::MergePlan& GetMergePlan() const;
+
+  // Merges the fields of `from` that messages of this type keep in place,
+  // such as singular scalars and strings and repeated scalars, into `to`,
+  // which must have this reflection too.  Scalars laid out next to each other
+  // are copied together.  The other fields that `from` has are appended to
+  // `other_fields`, for the caller to merge.  If `to_is_clear`, `to` has no
+  // fields set, which allows copying scalars that `from` does not have.
+  void MergeInPlaceFields(
+      const Message& from, Message* to, bool to_is_clear,
+      std::vector<const FieldDescriptor*>* other_fields) const;
+
+  // The fields that SpaceUsedImpl() looks at, found on demand.
+  mutable absl::once_flag space_used_plan_once_;
+  mutable const internal::SpaceUsedPlan* space_used_plan_ = nullptr;
+
+  const internal::SpaceUsedPlan& GetSpaceUsedPlan() const;
+
+  // The indices of the non-weak fields of this type in field number order,
+  // found on demand.
+  mutable absl::once_flag fields_by_number_once_;
+  mutable const std::vector<int>* fields_by_number_ = nullptr;
+
+  const std::vector<int>& GetFieldsByNumber() const;
+
+  // Returns true if ListFields() lists the non-weak field `field`.
+  // `has_bits` are the has-bits of `message`, or null if it has none.
+  bool IsFieldListed(const Message& message, const FieldDescriptor* field,
+                     const uint32_t* has_bits) const;
+
+  // Calls `visitor` with each field that ListFields() would list, in the same
+  // order. Unlike ListFields(), this does not allocate unless the message has
+  // extensions set.
+  void ForEachListedField(
+      const Message& message,
+      absl::FunctionRef<void(const FieldDescriptor*)> visitor) const;
+
+  // Whether messages of this type can be uninitialized, that is whether they
+  // or any message they may contain have required fields or extensions. Found
+  // on demand.
+  mutable absl::once_flag may_be_uninitialized_once_;
+  mutable bool may_be_uninitialized_ = true;
+
+  bool MayBeUninitialized() const;
+
+  // SpaceUsedLong() without the fuzz factor if `heap_only` is false, or else
+  // HeapSpaceUsedLong().
+  size_t SpaceUsedImpl(const Message& message, bool heap_only) const;
+
+  // If `projected_field_numbers` is not null, the table only parses the fields
+  // whose (sorted) numbers it contains and skips all others. Skipped fields
+  // that are known to the descriptor are kept in the unknown field set if
+  // `keep_skipped_fields` is true. See FieldProjection.
+  const TcParseTableBase* CreateTcParseTable(
+      const std::vector<int>* projected_field_numbers = nullptr,
+      bool keep_skipped_fields = false) const;
   const TcParseTableBase* CreateTcParseTableReflectionOnly() const;
   void PopulateTcParseFastEntries(
       const internal::TailCallTableInfo& table_info,
@@ -1051,7 +1233,9 @@ class PROTOBUF_EXPORT Reflection final {
   friend class Message;
   friend class MessageLayoutInspector;
   friend class AssignDescriptorsHelper;
+  friend class ColumnarView;
   friend class DynamicMessageFactory;
+  friend class FieldProjection;
   friend class GeneratedMessageReflectionTestHelper;
   friend class python::MapReflectionFriend;
   friend class python::MessageReflectionFriend;
@@ -1067,6 +1251,8 @@ class PROTOBUF_EXPORT Reflection final {
   friend struct internal::FuzzPeer;
   // Needed for implementing text format for map.
   friend class internal::MapFieldPrinterHelper;
+  // Needed for printing JSON maps without syncing the repeated mirror.
+  friend struct json_internal::UnparseProto2Descriptor;
 
   Reflection(const Descriptor* descriptor,
              const internal::ReflectionSchema& schema,
@@ -1130,6 +1316,9 @@ class PROTOBUF_EXPORT Reflection final {
   const internal::MapFieldBase* GetMapData(const Message& message,
                                            const FieldDescriptor* field) const;
 
+  internal::FieldAccessorLayout GetFieldAccessorLayout(
+      const FieldDescriptor* field, FieldDescriptor::CppType cpp_type) const;
+
   template <class T>
   const T& GetRawNonOneof(const Message& message,
                           const FieldDescriptor* field) const;
@@ -1278,6 +1467,79 @@ class PROTOBUF_EXPORT Reflection final {
                                              internal::ParseContext* ctx);
 };
 
+// A handle for one singular, non-message field of a message type, as
+// returned by Reflection::GetFieldAccessor().  Generic code that reads or
+// writes the same few fields of many messages can use it in place of
+// Reflection::GetInt64(), SetString() and friends: reading a field is a load
+// and a branch, as the field was checked and found once.  Fields that
+// messages do not keep at a fixed offset, such as extensions, are accessed
+// through Reflection.
+//
+// Usage example:
+//   FieldAccessor<int64_t> size = reflection->GetFieldAccessor<int64_t>(
+//       descriptor->FindFieldByName("size"));
+//   for (const Message* message : messages) total += size.Get(*message);
+//
+// The messages passed in must be of the type of the Reflection.  A handle is
+// cheap to copy and can be used as long as the Reflection exists.
+template <typename T>
+class FieldAccessor {
+  static constexpr bool kIsString = std::is_same<T, std::string>::value;
+  static_assert(std::is_same<T, int32_t>::value ||
+                    std::is_same<T, int64_t>::value ||
+                    std::is_same<T, uint32_t>::value ||
+                    std::is_same<T, uint64_t>::value ||
+                    std::is_same<T, float>::value ||
+                    std::is_same<T, double>::value ||
+                    std::is_same<T, bool>::value || kIsString,
+                "T must be the C++ type of a singular, non-message field.");
+
+ public:
+  using GetType = std::conditional_t<kIsString, const std::string&, T>;
+  using SetType = std::conditional_t<kIsString, absl::string_view, T>;
+
+  // A handle for no field, to be assigned before use.
+  FieldAccessor() = default;
+
+  const FieldDescriptor* field() const { return field_; }
+
+  // Like Reflection::HasField().
+  bool Has(const Message& message) const;
+  // Like Reflection::GetInt32(), GetEnumValue(), GetStringReference(), etc.
+  GetType Get(const Message& message) const;
+  // Like Reflection::SetInt32(), SetEnumValue(), SetString(), etc.
+  void Set(Message* message, SetType value) const;
+
+ private:
+  friend class Reflection;
+  using Layout = internal::FieldAccessorLayout;
+  using Ops = internal::FieldAccessorOps<T>;
+  // How the field is stored in messages.
+  using Storage = typename Ops::Storage;
+
+  FieldAccessor(const Reflection* reflection, const FieldDescriptor* field,
+                Layout layout)
+      : reflection_(reflection), field_(field), layout_(layout) {}
+
+  uint32_t PresenceWord(const Message& message) const {
+    return internal::GetConstRefAtOffset<uint32_t>(message,
+                                                   layout_.presence_offset);
+  }
+  const Storage& Raw(const Message& message) const {
+    return internal::GetConstRefAtOffset<Storage>(message, layout_.offset);
+  }
+  Storage* MutableRaw(Message* message) const {
+    return internal::GetPointerAtOffset<Storage>(message, layout_.offset);
+  }
+
+  GetType GetThroughReflection(const Message& message) const;
+  void SetThroughReflection(Message* message, SetType value) const;
+
+  const Reflection* reflection_ = nullptr;
+  const FieldDescriptor* field_ = nullptr;
+  Layout layout_;
+};
+
 // Abstract interface for a factory for message objects.
 //
 // The thread safety for this class is implementation dependent, see comments
@@ -1594,6 +1856,163 @@ MutableRepeatedFieldRef<T> Reflection::GetMutableRepeatedFieldRef(
     Message* message, const FieldDescriptor* field) const {
   return MutableRepeatedFieldRef<T>(message, field);
 }
+
+template <typename T>
+FieldAccessor<T> Reflection::GetFieldAccessor(
+    const FieldDescriptor* field) const {
+  const FieldDescriptor::CppType cpp_type =
+      std::is_same<T, int32_t>::value    ? FieldDescriptor::CPPTYPE_INT32
+      : std::is_same<T, int64_t>::value  ? FieldDescriptor::CPPTYPE_INT64
+      : std::is_same<T, uint32_t>::value ? FieldDescriptor::CPPTYPE_UINT32
+      : std::is_same<T, uint64_t>::value ? FieldDescriptor::CPPTYPE_UINT64
+      : std::is_same<T, float>::value    ? FieldDescriptor::CPPTYPE_FLOAT
+      : std::is_same<T, double>::value   ? FieldDescriptor::CPPTYPE_DOUBLE
+      : std::is_same<T, bool>::value     ? FieldDescriptor::CPPTYPE_BOOL
+                                         : FieldDescriptor::CPPTYPE_STRING;
+  return FieldAccessor<T>(this, field, GetFieldAccessorLayout(field, cpp_type));
+}
+
+template <typename T>
+bool FieldAccessor<T>::Has(const Message& message) const {
+  ABSL_DCHECK_EQ(message.GetReflection(), reflection_);
+  switch (layout_.kind) {
+    case Layout::kImplicit:
+      return Ops::IsSet(Raw(message));
+    case Layout::kHasBit:
+      return (PresenceWord(message) & layout_.presence_value) != 0;
+    case Layout::kOneof:
+      return PresenceWord(message) == layout_.presence_value;
+    case Layout::kReflection:
+      break;
+  }
+  return reflection_->HasField(message, field_);
+}
+
+template <typename T>
+typename FieldAccessor<T>::GetType FieldAccessor<T>::Get(
+    const Message& message) const {
+  ABSL_DCHECK_EQ(message.GetReflection(), reflection_);
+  if (PROTOBUF_PREDICT_TRUE(layout_.kind <= Layout::kHasBit) ||
+      (layout_.kind == Layout::kOneof &&
+       PresenceWord(message) == layout_.presence_value)) {
+    if (const T* value = Ops::Get(Raw(message))) return *value;
+  }
+  return GetThroughReflection(message);
+}
+
+template <typename T>
+void FieldAccessor<T>::Set(Message* message, SetType value) const {
+  ABSL_DCHECK_EQ(message->GetReflection(), reflection_);
+  if (PROTOBUF_PREDICT_FALSE(layout_.set_through_reflection)) {
+    return SetThroughReflection(message, value);
+  }
+  switch (layout_.kind) {
+    case Layout::kImplicit:
+      break;
+    case Layout::kHasBit:
+      *internal::GetPointerAtOffset<uint32_t>(message,
+                                              layout_.presence_offset) |=
+          layout_.presence_value;
+      break;
+    case Layout::kOneof:
+      // Switching the oneof to this field destroys the previous one.
+      if (PresenceWord(*message) == layout_.presence_value) break;
+      return SetThroughReflection(message, value);
+    case Layout::kReflection:
+      return SetThroughReflection(message, value);
+  }
+  Ops::Set(MutableRaw(message), value, message->GetArena());
+}
+
+namespace internal {
+// The Reflection accessors for FieldAccessor<T>, picked by the type of the
+// last argument.
+inline int32_t GetThroughReflection(const Reflection* r, const Message& m,
+                                    const FieldDescriptor* f, int32_t*) {
+  return f->cpp_type() == FieldDescriptor::CPPTYPE_ENUM ? r->GetEnumValue(m, f)
+                                                        : r->GetInt32(m, f);
+}
+inline int64_t GetThroughReflection(const Reflection* r, const Message& m,
+                                    const FieldDescriptor* f, int64_t*) {
+  return r->GetInt64(m, f);
+}
+inline uint32_t GetThroughReflection(const Reflection* r, const Message& m,
+                                     const FieldDescriptor* f, uint32_t*) {
+  return r->GetUInt32(m, f);
+}
+inline uint64_t GetThroughReflection(const Reflection* r, const Message& m,
+                                     const FieldDescriptor* f, uint64_t*) {
+  return r->GetUInt64(m, f);
+}
+inline float GetThroughReflection(const Reflection* r, const Message& m,
+                                  const FieldDescriptor* f, float*) {
+  return r->GetFloat(m, f);
+}
+inline double GetThroughReflection(const Reflection* r, const Message& m,
+                                   const FieldDescriptor* f, double*) {
+  return r->GetDouble(m, f);
+}
+inline bool GetThroughReflection(const Reflection* r, const Message& m,
+                                 const FieldDescriptor* f, bool*) {
+  return r->GetBool(m, f);
+}
+inline const std::string& GetThroughReflection(const Reflection* r,
+                                               const Message& m,
+                                               const FieldDescriptor* f,
+                                               std::string*) {
+  // Cord fields, the only ones that need the scratch string, have no
+  // accessor.
+  return r->GetStringReference(m, f, nullptr);
+}
+
+inline void SetThroughReflection(const Reflection* r, Message* m,
+                                 const FieldDescriptor* f, int32_t value) {
+  f->cpp_type() == FieldDescriptor::CPPTYPE_ENUM ? r->SetEnumValue(m, f, value)
+                                                 : r->SetInt32(m, f, value);
+}
+inline void SetThroughReflection(const Reflection* r, Message* m,
+                                 const FieldDescriptor* f, int64_t value) {
+  r->SetInt64(m, f, value);
+}
+inline void SetThroughReflection(const Reflection* r, Message* m,
+                                 const FieldDescriptor* f, uint32_t value) {
+  r->SetUInt32(m, f, value);
+}
+inline void SetThroughReflection(const Reflection* r, Message* m,
+                                 const FieldDescriptor* f, uint64_t value) {
+  r->SetUInt64(m, f, value);
+}
+inline void SetThroughReflection(const Reflection* r, Message* m,
+                                 const FieldDescriptor* f, float value) {
+  r->SetFloat(m, f, value);
+}
+inline void SetThroughReflection(const Reflection* r, Message* m,
+                                 const FieldDescriptor* f, double value) {
+  r->SetDouble(m, f, value);
+}
+inline void SetThroughReflection(const Reflection* r, Message* m,
+                                 const FieldDescriptor* f, bool value) {
+  r->SetBool(m, f, value);
+}
+inline void SetThroughReflection(const Reflection* r, Message* m,
+                                 const FieldDescriptor* f,
+                                 absl::string_view value) {
+  r->SetString(m, f, std::string(value));
+}
+}  // namespace internal
+
+template <typename T>
+typename FieldAccessor<T>::GetType FieldAccessor<T>::GetThroughReflection(
+    const Message& message) const {
+  return internal::GetThroughReflection(reflection_, message, field_,
+                                        static_cast<T*>(nullptr));
+}
+
+template <typename T>
+void FieldAccessor<T>::SetThroughReflection(Message* message,
+                                            SetType value) const {
+  internal::SetThroughReflection(reflection_, message, field_, value);
+}
 }  // namespace protobuf
 }  // namespace google
 
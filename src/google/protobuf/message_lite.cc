@@ -31,11 +31,13 @@
 #include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
 #include "google/protobuf/arena.h"
+#include "google/protobuf/io/buffer_pool.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/parse_context.h"
+#include "google/protobuf/parse_stats.h"
 
 
 // Must be included last.
@@ -118,6 +120,17 @@ inline bool CheckFieldPresence(const internal::ParseContext& ctx,
   return msg.IsInitializedWithErrors();
 }
 
+// Parses a whole message, as opposed to a submessage.
+inline const char* InternalParseTopLevel(MessageLite* msg, const char* ptr,
+                                         internal::ParseContext* ctx) {
+#if defined(PROTOBUF_TC_PARSE_STATS)
+  if (PROTOBUF_PREDICT_FALSE(--internal::parse_stats_countdown <= 0)) {
+    return internal::SampledInternalParse(msg, ptr, ctx);
+  }
+#endif  // PROTOBUF_TC_PARSE_STATS
+  return msg->_InternalParse(ptr, ctx);
+}
+
 }  // namespace
 
 void MessageLite::LogInitializationErrorMessage() const {
@@ -132,7 +145,7 @@ bool MergeFromImpl(absl::string_view input, MessageLite* msg,
   const char* ptr;
   internal::ParseContext ctx(io::CodedInputStream::GetDefaultRecursionLimit(),
                              aliasing, &ptr, input);
-  ptr = msg->_InternalParse(ptr, &ctx);
+  ptr = InternalParseTopLevel(msg, ptr, &ctx);
   // ctx has an explicit limit set (length of string_view).
   if (PROTOBUF_PREDICT_TRUE(ptr && ctx.EndedAtLimit())) {
     return CheckFieldPresence(ctx, *msg, parse_flags);
@@ -146,7 +159,7 @@ bool MergeFromImpl(io::ZeroCopyInputStream* input, MessageLite* msg,
   const char* ptr;
   internal::ParseContext ctx(io::CodedInputStream::GetDefaultRecursionLimit(),
                              aliasing, &ptr, input);
-  ptr = msg->_InternalParse(ptr, &ctx);
+  ptr = InternalParseTopLevel(msg, ptr, &ctx);
   // ctx has no explicit limit (hence we end on end of stream)
   if (PROTOBUF_PREDICT_TRUE(ptr && ctx.EndedAtEndOfStream())) {
     return CheckFieldPresence(ctx, *msg, parse_flags);
@@ -154,13 +167,26 @@ bool MergeFromImpl(io::ZeroCopyInputStream* input, MessageLite* msg,
   return false;
 }
 
+template <bool aliasing>
+bool MergeFromImpl(io::SpanChainInputStream* input, MessageLite* msg,
+                   MessageLite::ParseFlags parse_flags) {
+  const char* ptr;
+  internal::ParseContext ctx(io::CodedInputStream::GetDefaultRecursionLimit(),
+                             aliasing, &ptr, input);
+  ptr = InternalParseTopLevel(msg, ptr, &ctx);
+  if (PROTOBUF_PREDICT_TRUE(ptr && ctx.EndedAtEndOfStream())) {
+    return CheckFieldPresence(ctx, *msg, parse_flags);
+  }
+  return false;
+}
+
 template <bool aliasing>
 bool MergeFromImpl(BoundedZCIS input, MessageLite* msg,
                    MessageLite::ParseFlags parse_flags) {
   const char* ptr;
   internal::ParseContext ctx(io::CodedInputStream::GetDefaultRecursionLimit(),
                              aliasing, &ptr, input.zcis, input.limit);
-  ptr = msg->_InternalParse(ptr, &ctx);
+  ptr = InternalParseTopLevel(msg, ptr, &ctx);
   if (PROTOBUF_PREDICT_FALSE(!ptr)) return false;
   ctx.BackUp(ptr);
   if (PROTOBUF_PREDICT_TRUE(ctx.EndedAtLimit())) {
@@ -179,6 +205,12 @@ template bool MergeFromImpl<false>(io::ZeroCopyInputStream* input,
 template bool MergeFromImpl<true>(io::ZeroCopyInputStream* input,
                                   MessageLite* msg,
                                   MessageLite::ParseFlags parse_flags);
+template bool MergeFromImpl<false>(io::SpanChainInputStream* input,
+                                   MessageLite* msg,
+                                   MessageLite::ParseFlags parse_flags);
+template bool MergeFromImpl<true>(io::SpanChainInputStream* input,
+                                  MessageLite* msg,
+                                  MessageLite::ParseFlags parse_flags);
 template bool MergeFromImpl<false>(BoundedZCIS input, MessageLite* msg,
                                    MessageLite::ParseFlags parse_flags);
 template bool MergeFromImpl<true>(BoundedZCIS input, MessageLite* msg,
@@ -226,7 +258,7 @@ bool MessageLite::MergeFromImpl(io::CodedInputStream* input,
   ctx.TrackCorrectEnding();
   ctx.data().pool = input->GetExtensionPool();
   ctx.data().factory = input->GetExtensionFactory();
-  ptr = _InternalParse(ptr, &ctx);
+  ptr = InternalParseTopLevel(this, ptr, &ctx);
   if (PROTOBUF_PREDICT_FALSE(!ptr)) return false;
   ctx.BackUp(ptr);
   if (!ctx.EndedAtEndOfStream()) {
@@ -266,6 +298,15 @@ bool MessageLite::ParsePartialFromZeroCopyStream(
   return ParseFrom<kParsePartial>(input);
 }
 
+bool MessageLite::ParseFromZeroCopyStream(io::SpanChainInputStream* input) {
+  return ParseFrom<kParse>(input);
+}
+
+bool MessageLite::ParsePartialFromZeroCopyStream(
+    io::SpanChainInputStream* input) {
+  return ParseFrom<kParsePartial>(input);
+}
+
 bool MessageLite::ParseFromFileDescriptor(int file_descriptor) {
   io::FileInputStream input(file_descriptor);
   return ParseFromZeroCopyStream(&input) && input.GetErrno() == 0;
@@ -500,6 +541,31 @@ bool MessageLite::AppendPartialToString(std::string* output) const {
   return true;
 }
 
+bool MessageLite::SerializeToPooledBuffer(io::PooledBuffer* output) const {
+  ABSL_DCHECK(IsInitialized())
+      << InitializationErrorMessage("serialize", *this);
+  return SerializePartialToPooledBuffer(output);
+}
+
+bool MessageLite::SerializePartialToPooledBuffer(
+    io::PooledBuffer* output) const {
+  size_t byte_size = ByteSizeLong();
+  if (byte_size > INT_MAX) {
+    ABSL_LOG(ERROR) << GetTypeName()
+                    << " exceeded maximum protobuf size of 2GB: " << byte_size;
+    return false;
+  }
+
+  if (output->mutable_string()->capacity() < byte_size) {
+    *output = io::PooledBuffer::Acquire(byte_size);
+  }
+  std::string* buffer = output->mutable_string();
+  absl::strings_internal::STLStringResizeUninitialized(buffer, byte_size);
+  uint8_t* start = reinterpret_cast<uint8_t*>(io::mutable_string_data(buffer));
+  SerializeToArrayImpl(*this, start, byte_size);
+  return true;
+}
+
 bool MessageLite::SerializeToString(std::string* output) const {
   output->clear();
   return AppendToString(output);
@@ -597,6 +663,29 @@ bool MessageLite::AppendPartialToCord(absl::Cord* output) const {
   return true;
 }
 
+bool MessageLite::AppendPartialToCordWithAliasing(absl::Cord* output) const {
+  const size_t size = ByteSizeLong();  // Force size to be cached.
+  if (size > INT_MAX) {
+    ABSL_LOG(ERROR) << "Exceeded maximum protobuf size of 2GB.";
+    return false;
+  }
+
+  // No size hint: buffers stay below a flat's worth of bytes, and fields that
+  // do not fit in them are aliased.
+  io::CordOutputStream output_stream(std::move(*output));
+  output_stream.EnableAliasing(true);
+  uint8_t* target;
+  io::EpsCopyOutputStream out(
+      &output_stream,
+      io::CodedOutputStream::IsDefaultSerializationDeterministic(), &target);
+  out.EnableAliasing(true);
+  target = _InternalSerialize(target, &out);
+  out.Trim(target);
+  if (out.HadError()) return false;
+  *output = output_stream.Consume();
+  return true;
+}
+
 bool MessageLite::SerializeToCord(absl::Cord* output) const {
   output->Clear();
   return AppendToCord(output);
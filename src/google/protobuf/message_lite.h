@@ -56,6 +56,8 @@ namespace io {
 
 class CodedInputStream;
 class CodedOutputStream;
+class PooledBuffer;
+class SpanChainInputStream;
 class ZeroCopyInputStream;
 class ZeroCopyOutputStream;
 
@@ -124,6 +126,7 @@ class SwapFieldHelper;
 class ParseContext;
 
 class ExtensionSet;
+class ImplicitWeakMessage;
 class LazyField;
 class RepeatedPtrFieldBase;
 class TcParser;
@@ -287,6 +290,12 @@ class PROTOBUF_EXPORT MessageLite {
   // required fields.
   ABSL_ATTRIBUTE_REINITIALIZES bool ParsePartialFromZeroCopyStream(
       io::ZeroCopyInputStream* input);
+  // Overloads of the above for a chain of borrowed buffers.  The parser
+  // moves between fragments of the chain without virtual calls.
+  ABSL_ATTRIBUTE_REINITIALIZES bool ParseFromZeroCopyStream(
+      io::SpanChainInputStream* input);
+  ABSL_ATTRIBUTE_REINITIALIZES bool ParsePartialFromZeroCopyStream(
+      io::SpanChainInputStream* input);
   // Parse a protocol buffer from a file descriptor.  If successful, the entire
   // input will be consumed.
   ABSL_ATTRIBUTE_REINITIALIZES bool ParseFromFileDescriptor(
@@ -411,6 +420,15 @@ class PROTOBUF_EXPORT MessageLite {
   // Like AppendToString(), but allows missing required fields.
   bool AppendPartialToString(std::string* output) const;
 
+  // Serialize the message into `output`, replacing its contents.  If the
+  // buffer is too small, one is taken from the calling thread's
+  // io::BufferPool, which `output` returns it to when released.  Repeatedly
+  // serializing responses of similar size then allocates nothing.  All
+  // required fields must be set.  See io/buffer_pool.h.
+  bool SerializeToPooledBuffer(io::PooledBuffer* output) const;
+  // Like SerializeToPooledBuffer(), but allows missing required fields.
+  bool SerializePartialToPooledBuffer(io::PooledBuffer* output) const;
+
   // Reads a protocol buffer from a Cord and merges it into this message.
   bool MergeFromCord(const absl::Cord& cord);
   // Like MergeFromCord(), but accepts messages that are missing
@@ -441,6 +459,11 @@ class PROTOBUF_EXPORT MessageLite {
   bool AppendToCord(absl::Cord* output) const;
   // Like AppendToCord(), but allows missing required fields.
   bool AppendPartialToCord(absl::Cord* output) const;
+  // Like AppendPartialToCord(), but the Cord references large string, bytes
+  // and Cord fields of the message in place instead of copying them, so that
+  // its chunks can be handed to e.g. writev(). The message must outlive the
+  // Cord and all copies of it, and must not be modified while they are alive.
+  bool AppendPartialToCordWithAliasing(absl::Cord* output) const;
 
   // Computes the serialized size of the message.  This recursively calls
   // ByteSizeLong() on all embedded messages.
@@ -542,6 +565,11 @@ class PROTOBUF_EXPORT MessageLite {
   virtual internal::CachedSize* AccessCachedSize() const;
 
  public:
+  // Flags for ParseFrom(). Parsing "with aliasing" from an array requires the
+  // array to stay alive and unchanged for as long as the message, and any
+  // absl::Cord copied out of it, is used: large `bytes` fields with
+  // ctype=CORD then refer to the array instead of copying it. Cords never
+  // write to the array; mutating such a field copies it first.
   enum ParseFlags {
     kMerge = 0,
     kParse = 1,
@@ -574,6 +602,7 @@ class PROTOBUF_EXPORT MessageLite {
   friend class Message;
   friend class Reflection;
   friend class internal::ExtensionSet;
+  friend class internal::ImplicitWeakMessage;
   friend class internal::LazyField;
   friend class internal::SwapFieldHelper;
   friend class internal::TcParser;
@@ -612,6 +641,16 @@ extern template bool MergeFromImpl<true>(io::ZeroCopyInputStream* input,
                                          MessageLite* msg,
                                          MessageLite::ParseFlags parse_flags);
 
+template <bool alias>
+bool MergeFromImpl(io::SpanChainInputStream* input, MessageLite* msg,
+                   MessageLite::ParseFlags parse_flags);
+extern template bool MergeFromImpl<false>(io::SpanChainInputStream* input,
+                                          MessageLite* msg,
+                                          MessageLite::ParseFlags parse_flags);
+extern template bool MergeFromImpl<true>(io::SpanChainInputStream* input,
+                                         MessageLite* msg,
+                                         MessageLite::ParseFlags parse_flags);
+
 struct BoundedZCIS {
   io::ZeroCopyInputStream* zcis;
   int limit;
@@ -0,0 +1,98 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/parse_batch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message_lite.h"
+#include "google/protobuf/parse_context.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+namespace {
+
+// Batches are only split into runs of at least this many inputs, so that each
+// task does enough work to be worth scheduling.
+constexpr size_t kMinInputsPerTask = 256;
+
+// Parses `inputs[i]` into `message(first + i)` for each i, with one context.
+bool ParseRun(absl::Span<const absl::string_view> inputs, size_t first,
+              absl::FunctionRef<MessageLite*(size_t)> message, bool partial) {
+  if (inputs.empty()) return true;
+  const int depth = io::CodedInputStream::GetDefaultRecursionLimit();
+  const char* ptr;
+  ParseContext ctx(depth, /*aliasing=*/false, &ptr, inputs[0]);
+  bool ok = true;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    if (i > 0) ptr = ctx.Reset(depth, /*aliasing=*/false, inputs[i]);
+    MessageLite* msg = message(first + i);
+    ptr = msg->_InternalParse(ptr, &ctx);
+    // ctx has an explicit limit set (length of the input).
+    if (PROTOBUF_PREDICT_FALSE(ptr == nullptr || !ctx.EndedAtLimit() ||
+                               (!partial && !msg->IsInitialized()))) {
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+}  // namespace
+
+bool ParseBatchImpl(absl::Span<const absl::string_view> inputs,
+                    absl::FunctionRef<MessageLite*(size_t)> message,
+                    const ParseBatchOptions& options) {
+  const size_t max_tasks =
+      options.executor
+          ? std::min<size_t>(std::max(options.max_tasks, 1),
+                             inputs.size() / kMinInputsPerTask)
+          : 0;
+  if (max_tasks < 2) {
+    return ParseRun(inputs, 0, message, options.partial);
+  }
+
+  // Contiguous runs of inputs, each parsed by one task.  Rounding the run size
+  // up can leave fewer runs than `max_tasks`.
+  const size_t run_size = (inputs.size() + max_tasks - 1) / max_tasks;
+  const size_t num_tasks = (inputs.size() + run_size - 1) / run_size;
+  std::vector<char> run_ok(num_tasks, true);
+  absl::Mutex mutex;
+  size_t running = num_tasks;
+  for (size_t task = 0; task < num_tasks; ++task) {
+    options.executor([&, task] {
+      const size_t first = task * run_size;
+      const size_t size = std::min(run_size, inputs.size() - first);
+      run_ok[task] =
+          ParseRun(inputs.subspan(first, size), first, message, options.partial);
+      absl::MutexLock lock(&mutex);
+      --running;
+    });
+  }
+  {
+    absl::MutexLock lock(&mutex);
+    mutex.Await(absl::Condition(
+        +[](size_t* running) { return *running == 0; }, &running));
+  }
+  return std::all_of(run_ok.begin(), run_ok.end(), [](char ok) { return ok; });
+}
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,92 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines ParseBatch(), which parses many serialized messages of one
+// type at once.
+
+#ifndef GOOGLE_PROTOBUF_PARSE_BATCH_H__
+#define GOOGLE_PROTOBUF_PARSE_BATCH_H__
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "google/protobuf/message_lite.h"
+#include "google/protobuf/repeated_ptr_field.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+struct ParseBatchOptions {
+  // If true, missing required fields are not an error, as with
+  // ParsePartialFromString().
+  bool partial = false;
+
+  // If set, large batches are split into up to `max_tasks` runs of inputs,
+  // which are parsed by tasks passed to `executor`, typically running them on
+  // a thread pool.  All tasks are waited for before ParseBatch() returns, so
+  // the executor must not run them on the calling thread after it blocks.
+  std::function<void(std::function<void()> task)> executor;
+  int max_tasks = 8;
+};
+
+namespace internal {
+
+// Parses `inputs[i]` into `message(i)` for each i.  `message` is called once
+// per input, possibly concurrently if `options.executor` is set.
+PROTOBUF_EXPORT bool ParseBatchImpl(
+    absl::Span<const absl::string_view> inputs,
+    absl::FunctionRef<MessageLite*(size_t)> message,
+    const ParseBatchOptions& options);
+
+}  // namespace internal
+
+// Parses each of `inputs` as a serialized T, as ParseFromString() would, into
+// a new element appended to `output`:
+//
+//   RepeatedPtrField<MyRecord> records;  // Or on an arena.
+//   if (!ParseBatch(serialized_records, &records)) { ... }
+//
+// Parsing tiny messages one at a time spends much of the time outside the
+// parser itself; a batch reserves `output` once and parses every input with
+// the same parse context.  Elements are created on the arena of `output`, if
+// any, and elements retained by output->Clear() are reused, so a field that is
+// cleared between batches does not allocate in steady state.
+//
+// Returns false if any input fails to parse, or lacks required fields unless
+// `options.partial`.  An element is appended for every input regardless; the
+// elements of inputs that failed are in an unspecified state.  Unlike
+// ParseFromString(), missing required fields are not logged.
+template <typename T>
+bool ParseBatch(absl::Span<const absl::string_view> inputs,
+                RepeatedPtrField<T>* output,
+                const ParseBatchOptions& options = ParseBatchOptions()) {
+  static_assert(std::is_base_of<MessageLite, T>::value,
+                "ParseBatch() parses messages");
+  const int start = output->size();
+  output->Reserve(start + static_cast<int>(inputs.size()));
+  for (size_t i = 0; i < inputs.size(); ++i) output->Add();
+  return internal::ParseBatchImpl(
+      inputs,
+      [output, start](size_t i) -> MessageLite* {
+        return output->Mutable(start + static_cast<int>(i));
+      },
+      options);
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_PARSE_BATCH_H__
@@ -0,0 +1,176 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/parse_batch.h"
+
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestRequired;
+
+// Serialized messages of a range of sizes: both shorter and longer than the
+// parser's slop region, and one with every field set.
+std::vector<std::string> SerializedMessages(int count) {
+  std::vector<std::string> data;
+  for (int i = 0; i < count; ++i) {
+    TestAllTypes message;
+    if (i % 7 == 0) {
+      TestUtil::SetAllFields(&message);
+    } else {
+      message.set_optional_int32(i);
+      message.set_optional_string(std::string(i % 40, 'x'));
+      if (i % 3 == 0) message.mutable_optional_nested_message()->set_bb(i);
+    }
+    data.push_back(message.SerializeAsString());
+  }
+  return data;
+}
+
+std::vector<absl::string_view> Views(const std::vector<std::string>& data) {
+  return std::vector<absl::string_view>(data.begin(), data.end());
+}
+
+void ExpectParsed(const std::vector<std::string>& data,
+                  const RepeatedPtrField<TestAllTypes>& output, int start) {
+  ASSERT_EQ(output.size(), start + static_cast<int>(data.size()));
+  for (size_t i = 0; i < data.size(); ++i) {
+    EXPECT_EQ(output.Get(start + static_cast<int>(i)).SerializeAsString(),
+              data[i])
+        << i;
+  }
+}
+
+TEST(ParseBatchTest, AppendsEveryInput) {
+  const std::vector<std::string> data = SerializedMessages(50);
+  RepeatedPtrField<TestAllTypes> output;
+  output.Add()->set_optional_int32(-1);
+  EXPECT_TRUE(ParseBatch(Views(data), &output));
+  EXPECT_EQ(output.Get(0).optional_int32(), -1);
+  ExpectParsed(data, output, 1);
+
+  EXPECT_TRUE(ParseBatch({}, &output));
+  EXPECT_EQ(output.size(), 51);
+}
+
+TEST(ParseBatchTest, ParsesOnTheArenaOfOutput) {
+  const std::vector<std::string> data = SerializedMessages(20);
+  Arena arena;
+  auto* output = Arena::CreateMessage<RepeatedPtrField<TestAllTypes>>(&arena);
+  EXPECT_TRUE(ParseBatch(Views(data), output));
+  ExpectParsed(data, *output, 0);
+  for (const TestAllTypes& message : *output) {
+    EXPECT_EQ(message.GetArena(), &arena);
+  }
+}
+
+TEST(ParseBatchTest, ReusesClearedElements) {
+  const std::vector<std::string> data = SerializedMessages(20);
+  RepeatedPtrField<TestAllTypes> output;
+  ASSERT_TRUE(ParseBatch(Views(data), &output));
+  const TestAllTypes* first = &output.Get(0);
+  output.Clear();
+  ASSERT_TRUE(ParseBatch(Views(data), &output));
+  EXPECT_EQ(&output.Get(0), first);
+  ExpectParsed(data, output, 0);
+}
+
+TEST(ParseBatchTest, ReportsFailuresAndParsesTheRest) {
+  std::vector<std::string> data = SerializedMessages(10);
+  TestAllTypes nested;
+  nested.mutable_optional_nested_message()->set_bb(1);
+  std::string truncated = nested.SerializeAsString();
+  truncated.pop_back();
+  const std::vector<std::string> invalid = {"\xff", truncated};
+
+  for (const std::string& bad : invalid) {
+    std::vector<std::string> batch = data;
+    batch.insert(batch.begin() + 5, bad);
+    RepeatedPtrField<TestAllTypes> output;
+    EXPECT_FALSE(ParseBatch(Views(batch), &output));
+    ASSERT_EQ(output.size(), 11);
+    // The inputs after the one that failed are parsed as usual.
+    for (int i = 6; i < 11; ++i) {
+      EXPECT_EQ(output.Get(i).SerializeAsString(), batch[i]);
+    }
+  }
+}
+
+TEST(ParseBatchTest, ChecksRequiredFieldsUnlessPartial) {
+  TestRequired complete;
+  complete.set_a(1);
+  complete.set_b(2);
+  complete.set_c(3);
+  TestRequired incomplete;
+  incomplete.set_a(1);
+  const std::vector<std::string> data = {
+      complete.SerializeAsString(), incomplete.SerializePartialAsString()};
+
+  RepeatedPtrField<TestRequired> output;
+  EXPECT_FALSE(ParseBatch(Views(data), &output));
+  ParseBatchOptions options;
+  options.partial = true;
+  EXPECT_TRUE(ParseBatch(Views(data), &output, options));
+  EXPECT_EQ(output.size(), 4);
+  EXPECT_EQ(output.Get(3).a(), 1);
+}
+
+TEST(ParseBatchTest, ParsesInParallel) {
+  const std::vector<std::string> data = SerializedMessages(2000);
+  std::vector<std::thread> threads;
+  ParseBatchOptions options;
+  options.executor = [&threads](std::function<void()> task) {
+    threads.emplace_back(std::move(task));
+  };
+  options.max_tasks = 4;
+  RepeatedPtrField<TestAllTypes> output;
+  EXPECT_TRUE(ParseBatch(Views(data), &output, options));
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_EQ(threads.size(), 4);
+  ExpectParsed(data, output, 0);
+
+  // Small batches are parsed on the calling thread.
+  threads.clear();
+  EXPECT_TRUE(ParseBatch(Views(SerializedMessages(10)), &output, options));
+  EXPECT_TRUE(threads.empty());
+}
+
+TEST(ParseBatchTest, SplitsIntoNoMoreRunsThanInputsFill) {
+  // 256500 inputs in 1000 tasks would take runs of 257, which only fill 999.
+  const std::vector<std::string> data = SerializedMessages(10);
+  std::vector<absl::string_view> inputs;
+  for (int i = 0; i < 256500; ++i) inputs.push_back(data[i % data.size()]);
+  int tasks = 0;
+  ParseBatchOptions options;
+  options.executor = [&tasks](std::function<void()> task) {
+    ++tasks;
+    task();
+  };
+  options.max_tasks = 1000;
+  RepeatedPtrField<TestAllTypes> output;
+  EXPECT_TRUE(ParseBatch(inputs, &output, options));
+  EXPECT_EQ(tasks, 999);
+  ASSERT_EQ(output.size(), 256500);
+  EXPECT_EQ(output.Get(256499).SerializeAsString(), data[256499 % 10]);
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
@@ -14,8 +14,8 @@
 #include "absl/strings/string_view.h"
 #include "google/protobuf/message_lite.h"
 #include "google/protobuf/repeated_field.h"
+#include "google/protobuf/utf8_util.h"
 #include "google/protobuf/wire_format_lite.h"
-#include "utf8_validity.h"
 
 
 // Must be included last.
@@ -182,7 +182,24 @@ std::pair<const char*, bool> EpsCopyInputStream::DoneFallback(int overrun,
 }
 
 const char* EpsCopyInputStream::SkipFallback(const char* ptr, int size) {
-  return AppendSize(ptr, size, [](const char* /*p*/, int /*s*/) {});
+  if (zcis_ == nullptr || size < kMinBytesToSkipInStream) {
+    return AppendSize(ptr, size, [](const char* /*p*/, int /*s*/) {});
+  }
+  // Let the stream skip the bytes we have not buffered yet, which for files
+  // means seeking over them instead of reading them.
+  int new_limit = buffer_end_ - ptr + limit_;
+  if (size > new_limit) return nullptr;
+  new_limit -= size;
+  int bytes_from_buffer = HandBackToStream(ptr);
+  if (bytes_from_buffer < 0) return nullptr;
+  size -= bytes_from_buffer;
+  if (size > overall_limit_) return nullptr;
+  overall_limit_ -= size;
+  if (!zcis_->Skip(size)) return nullptr;
+  ptr = InitFrom(zcis_);
+  limit_ = new_limit - static_cast<int>(buffer_end_ - ptr);
+  limit_end_ = buffer_end_ + (std::min)(0, limit_);
+  return ptr;
 }
 
 const char* EpsCopyInputStream::ReadStringFallback(const char* ptr, int size,
@@ -210,12 +227,53 @@ const char* EpsCopyInputStream::AppendStringFallback(const char* ptr, int size,
                     [str](const char* p, int s) { str->append(p, s); });
 }
 
+int EpsCopyInputStream::HandBackToStream(const char* ptr) {
+  int bytes_from_buffer = buffer_end_ - ptr + kSlopBytes;
+  const bool in_patch_buf = reinterpret_cast<uintptr_t>(ptr) -
+                                reinterpret_cast<uintptr_t>(patch_buffer_) <=
+                            kPatchBufferSize;
+  if (bytes_from_buffer > kPatchBufferSize || !in_patch_buf) {
+    StreamBackUp(bytes_from_buffer);
+    return 0;
+  }
+  if (bytes_from_buffer == kSlopBytes && next_chunk_ != nullptr &&
+      // Only backup if next_chunk_ points to a valid buffer returned by
+      // ZeroCopyInputStream. This happens when NextStream() returns a
+      // chunk that's smaller than or equal to kSlopBytes.
+      next_chunk_ != patch_buffer_) {
+    StreamBackUp(size_);
+    return 0;
+  }
+  if (next_chunk_ == patch_buffer_) {
+    // We have read to end of the last buffer returned by
+    // ZeroCopyInputStream. So the stream is in the right position.
+  } else if (next_chunk_ == nullptr) {
+    // There is no remaining chunks. We can't read size.
+    SetEndOfStream();
+    return -1;
+  } else {
+    // Next chunk is already loaded
+    ABSL_DCHECK(size_ > kSlopBytes);
+    StreamBackUp(size_ - kSlopBytes);
+  }
+  return bytes_from_buffer;
+}
+
 const char* EpsCopyInputStream::ReadCordFallback(const char* ptr, int size,
                                                  absl::Cord* cord) {
   if (zcis_ == nullptr) {
     int bytes_from_buffer = buffer_end_ - ptr + kSlopBytes;
     if (size <= bytes_from_buffer) {
-      *cord = absl::string_view(ptr, size);
+      const char* aliased = FlatInputPtr(ptr);
+      if (aliased != nullptr) {
+        // With aliasing the caller keeps the input alive and unchanged for as
+        // long as the message and its cords, and cords never write to
+        // external memory, so the field can simply refer to the input.
+        *cord = absl::MakeCordFromExternal(absl::string_view(aliased, size),
+                                           [] {});
+      } else {
+        *cord = absl::string_view(ptr, size);
+      }
       return ptr + size;
     }
     return AppendSize(ptr, size, [cord](const char* p, int s) {
@@ -225,36 +283,14 @@ const char* EpsCopyInputStream::ReadCordFallback(const char* ptr, int size,
   int new_limit = buffer_end_ - ptr + limit_;
   if (size > new_limit) return nullptr;
   new_limit -= size;
-  int bytes_from_buffer = buffer_end_ - ptr + kSlopBytes;
-  const bool in_patch_buf = reinterpret_cast<uintptr_t>(ptr) -
-                                reinterpret_cast<uintptr_t>(patch_buffer_) <=
-                            kPatchBufferSize;
-  if (bytes_from_buffer > kPatchBufferSize || !in_patch_buf) {
+  int bytes_from_buffer = HandBackToStream(ptr);
+  if (bytes_from_buffer < 0) return nullptr;
+  if (bytes_from_buffer == 0) {
     cord->Clear();
-    StreamBackUp(bytes_from_buffer);
-  } else if (bytes_from_buffer == kSlopBytes && next_chunk_ != nullptr &&
-             // Only backup if next_chunk_ points to a valid buffer returned by
-             // ZeroCopyInputStream. This happens when NextStream() returns a
-             // chunk that's smaller than or equal to kSlopBytes.
-             next_chunk_ != patch_buffer_) {
-    cord->Clear();
-    StreamBackUp(size_);
   } else {
     size -= bytes_from_buffer;
     ABSL_DCHECK_GT(size, 0);
     *cord = absl::string_view(ptr, bytes_from_buffer);
-    if (next_chunk_ == patch_buffer_) {
-      // We have read to end of the last buffer returned by
-      // ZeroCopyInputStream. So the stream is in the right position.
-    } else if (next_chunk_ == nullptr) {
-      // There is no remaining chunks. We can't read size.
-      SetEndOfStream();
-      return nullptr;
-    } else {
-      // Next chunk is already loaded
-      ABSL_DCHECK(size_ > kSlopBytes);
-      StreamBackUp(size_ - kSlopBytes);
-    }
   }
   if (size > overall_limit_) return nullptr;
   overall_limit_ -= size;
@@ -408,7 +444,7 @@ void PrintUTF8ErrorLog(absl::string_view message_name,
                        bool emit_stacktrace);
 
 bool VerifyUTF8(absl::string_view str, const char* field_name) {
-  if (!utf8_range::IsStructurallyValid(str)) {
+  if (!IsValidUtf8(str)) {
     PrintUTF8ErrorLog("", field_name, "parsing", false);
     return false;
   }
@@ -425,19 +461,23 @@ const char* InlineGreedyStringParser(std::string* s, const char* ptr,
 
 template <typename T, bool sign>
 const char* VarintParser(void* object, const char* ptr, ParseContext* ctx) {
-  return ctx->ReadPackedVarint(ptr, [object](uint64_t varint) {
-    T val;
-    if (sign) {
-      if (sizeof(T) == 8) {
-        val = WireFormatLite::ZigZagDecode64(varint);
-      } else {
-        val = WireFormatLite::ZigZagDecode32(varint);
-      }
-    } else {
-      val = varint;
-    }
-    static_cast<RepeatedField<T>*>(object)->Add(val);
-  });
+  auto* field = static_cast<RepeatedField<T>*>(object);
+  return ctx->ReadPackedVarintReserved(
+      ptr,
+      [field](uint64_t varint) {
+        T val;
+        if (sign) {
+          if (sizeof(T) == 8) {
+            val = WireFormatLite::ZigZagDecode64(varint);
+          } else {
+            val = WireFormatLite::ZigZagDecode32(varint);
+          }
+        } else {
+          val = varint;
+        }
+        field->Add(val);
+      },
+      [field](int count) { field->Reserve(field->size() + count); });
 }
 
 const char* PackedInt32Parser(void* object, const char* ptr,
@@ -17,6 +17,7 @@
 #include "absl/base/config.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
+#include "absl/numeric/bits.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/internal/resize_uninitialized.h"
 #include "absl/strings/string_view.h"
@@ -28,6 +29,7 @@
 #include "google/protobuf/inlined_string_field.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/metadata_lite.h"
 #include "google/protobuf/port.h"
 #include "google/protobuf/repeated_field.h"
@@ -97,6 +99,9 @@ inline void WriteLengthDelimited(uint32_t num, absl::string_view val,
 class PROTOBUF_EXPORT EpsCopyInputStream {
  public:
   enum { kMaxCordBytesToCopy = 512 };
+  // Skips of at least this many bytes are handed to the ZeroCopyInputStream,
+  // which may seek rather than read.
+  enum { kMinBytesToSkipInStream = 4096 };
   explicit EpsCopyInputStream(bool enable_aliasing)
       : aliasing_(enable_aliasing ? kOnPatch : kNoAliasing) {}
 
@@ -229,6 +234,13 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
   template <typename Add, typename SizeCb>
   PROTOBUF_NODISCARD const char* ReadPackedVarint(const char* ptr, Add add,
                                                   SizeCb size_callback);
+  // Like ReadPackedVarint, but first calls `reserve(count)` with the exact
+  // number of varints in the payload if it is all in the current buffer. This
+  // lets RepeatedField callers allocate once instead of growing repeatedly.
+  template <typename Add, typename ReserveCb>
+  PROTOBUF_NODISCARD const char* ReadPackedVarintReserved(const char* ptr,
+                                                          Add add,
+                                                          ReserveCb reserve);
 
   uint32_t LastTag() const { return last_tag_minus_1_ + 1; }
   bool ConsumeEndGroup(uint32_t start_tag) {
@@ -300,8 +312,26 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
     }
   }
 
+  // Like InitFrom(flat), for a stream that may have parsed other input before.
+  const char* ReinitFrom(absl::string_view flat, bool enable_aliasing) {
+    aliasing_ = enable_aliasing ? kOnPatch : kNoAliasing;
+    last_tag_minus_1_ = 0;
+    zcis_ = nullptr;
+    chain_ = nullptr;
+    // A new stream sees zeros after input that is copied to the patch buffer.
+    std::memset(patch_buffer_, 0, sizeof(patch_buffer_));
+    return InitFrom(flat);
+  }
+
   const char* InitFrom(io::ZeroCopyInputStream* zcis);
 
+  // Like InitFrom(ZeroCopyInputStream*), but later fragments are fetched
+  // through the stream's non-virtual inline methods.
+  const char* InitFrom(io::SpanChainInputStream* chain) {
+    chain_ = chain;
+    return InitFrom(static_cast<io::ZeroCopyInputStream*>(chain));
+  }
+
   const char* InitFrom(io::ZeroCopyInputStream* zcis, int limit) {
     if (limit == -1) return InitFrom(zcis);
     overall_limit_ = limit;
@@ -324,6 +354,8 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
   int size_;
   int limit_;  // relative to buffer_end_;
   io::ZeroCopyInputStream* zcis_ = nullptr;
+  // Set if zcis_ is a SpanChainInputStream, to skip virtual dispatch.
+  io::SpanChainInputStream* chain_ = nullptr;
   char patch_buffer_[kPatchBufferSize] = {};
   enum { kNoAliasing = 0, kOnPatch = 1, kNoDelta = 2 };
   std::uintptr_t aliasing_ = kNoAliasing;
@@ -367,17 +399,42 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
   // groups (or negative if the use case does not need careful tracking).
   inline const char* NextBuffer(int overrun, int depth);
   const char* SkipFallback(const char* ptr, int size);
+  // Backs the stream up to `ptr`, for reading the rest of a field directly
+  // from zcis_. Bytes from `ptr` on that only exist in the patch buffer cannot
+  // be handed back: the stream is then positioned after them and their count
+  // is returned. Returns -1 if the input ends there.
+  int HandBackToStream(const char* ptr);
   const char* AppendStringFallback(const char* ptr, int size, std::string* str);
   const char* ReadStringFallback(const char* ptr, int size, std::string* str);
   const char* ReadCordFallback(const char* ptr, int size, absl::Cord* cord);
+  // Returns the address in the flat input array of the byte at `ptr`, or
+  // nullptr if aliasing is disabled. Only valid when parsing an array.
+  const char* FlatInputPtr(const char* ptr) const {
+    if (aliasing_ == kNoAliasing) return nullptr;
+    if (reinterpret_cast<std::uintptr_t>(ptr) -
+            reinterpret_cast<std::uintptr_t>(patch_buffer_) >=
+        kPatchBufferSize) {
+      return ptr;
+    }
+    // Bytes in the patch buffer were copied from the array; `aliasing_` holds
+    // the delta back once it is known.
+    if (aliasing_ <= kNoDelta) return nullptr;
+    return reinterpret_cast<const char*>(reinterpret_cast<std::uintptr_t>(ptr) +
+                                         aliasing_);
+  }
   static bool ParseEndsInSlopRegion(const char* begin, int overrun, int depth);
   bool StreamNext(const void** data) {
-    bool res = zcis_->Next(data, &size_);
+    bool res = chain_ != nullptr ? chain_->Next(data, &size_)
+                                 : zcis_->Next(data, &size_);
     if (res) overall_limit_ -= size_;
     return res;
   }
   void StreamBackUp(int count) {
-    zcis_->BackUp(count);
+    if (chain_ != nullptr) {
+      chain_->BackUp(count);
+    } else {
+      zcis_->BackUp(count);
+    }
     overall_limit_ += count;
   }
 
@@ -429,6 +486,11 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
     return AppendUntilEnd(
         ptr, [str](const char* p, ptrdiff_t s) { str->append(p, s); });
   }
+
+  // Parses `size` bytes of packed varints starting at `ptr`, which points just
+  // past the length prefix.
+  template <typename Add>
+  const char* ReadPackedVarintPayload(const char* ptr, int size, Add add);
   friend class ImplicitWeakMessage;
 
   // Needs access to kSlopBytes.
@@ -440,6 +502,45 @@ using LazyEagerVerifyFnType = const char* (*)(const char* ptr,
                                               ParseContext* ctx);
 using LazyEagerVerifyFnRef = std::remove_pointer<LazyEagerVerifyFnType>::type&;
 
+struct ExtensionInfo;
+
+// A direct-mapped cache of extension registry entries, indexed by extendee (the
+// default instance of the extended message) and field number. Each
+// ParseContext owns one, so a payload that repeats the same extensions looks
+// each of them up in the global registry only once per parse. Slots hold
+// registry entries, which record their own extendee and number; callers
+// compare those to detect conflicting slots.
+//
+// Only the valid-bit mask is initialized, so constructing a cache costs a
+// single store.
+class ExtensionInfoCache {
+ public:
+  static int Index(const MessageLite* extendee, int number) {
+    // Extension numbers tend to be dense, so the low bits of the number spread
+    // one extendee's extensions over distinct slots.
+    auto bits = reinterpret_cast<uintptr_t>(extendee) >> 4;
+    return static_cast<int>((static_cast<uintptr_t>(number) ^ bits) &
+                            (kSize - 1));
+  }
+
+  // Returns the entry in slot `index`, or null if it is empty.
+  const ExtensionInfo* Get(int index) const {
+    return (valid_ >> index) & 1 ? entries_[index] : nullptr;
+  }
+
+  void Set(int index, const ExtensionInfo* info) {
+    entries_[index] = info;
+    valid_ |= uint64_t{1} << index;
+  }
+
+ private:
+  static constexpr int kSize = 64;
+  static_assert(kSize <= 64, "valid_ is too narrow");
+
+  uint64_t valid_ = 0;
+  const ExtensionInfo* entries_[kSize];
+};
+
 // ParseContext holds all data that is global to the entire parse. Most
 // importantly it contains the input stream, but also recursion depth and also
 // stores the end group tag, in case a parser ended on a endgroup, to verify
@@ -481,6 +582,15 @@ class PROTOBUF_EXPORT ParseContext : public EpsCopyInputStream {
   ParseContext& operator=(ParseContext&&) = delete;
   ParseContext& operator=(const ParseContext&) = delete;
 
+  // Starts parsing `flat` as a new top-level message, as a context constructed
+  // from it would, but keeps data() and the extension info cache.  Lets one
+  // context parse a batch of messages.
+  const char* Reset(int depth, bool aliasing, absl::string_view flat) {
+    depth_ = depth;
+    group_depth_ = INT_MIN;
+    return ReinitFrom(flat, aliasing);
+  }
+
   void TrackCorrectEnding() { group_depth_ = 0; }
 
   // Done should only be called when the parsing pointer is pointing to the
@@ -492,6 +602,10 @@ class PROTOBUF_EXPORT ParseContext : public EpsCopyInputStream {
   Data& data() { return data_; }
   const Data& data() const { return data_; }
 
+  // Cache of the extension registry lookups made by this parse. A spawned
+  // context starts with an empty cache.
+  ExtensionInfoCache* extension_info_cache() { return &extension_info_cache_; }
+
   const char* ParseMessage(MessageLite* msg, const char* ptr);
 
   // This overload supports those few cases where ParseMessage is called
@@ -586,6 +700,7 @@ class PROTOBUF_EXPORT ParseContext : public EpsCopyInputStream {
   // in the last kSlopBytes of a ZeroCopyInputStream chunk.
   int group_depth_ = INT_MIN;
   Data data_;
+  ExtensionInfoCache extension_info_cache_;
 };
 
 template <int>
@@ -1167,23 +1282,35 @@ const char* EpsCopyInputStream::ReadRepeatedFixed(const char* ptr,
 #define GOOGLE_PROTOBUF_PARSER_ASSERT(predicate) \
   GOOGLE_PROTOBUF_ASSERT_RETURN(predicate, nullptr)
 
+// Copies `num` little-endian values of type T from `ptr` to `dst`.
+template <typename T>
+inline void CopyPackedFixed(T* dst, const char* ptr, int num) {
+#ifdef ABSL_IS_LITTLE_ENDIAN
+  std::memcpy(dst, ptr, num * sizeof(T));
+#else
+  for (int i = 0; i < num; i++) dst[i] = UnalignedLoad<T>(ptr + i * sizeof(T));
+#endif
+}
+
 template <typename T>
 const char* EpsCopyInputStream::ReadPackedFixed(const char* ptr, int size,
                                                 RepeatedField<T>* out) {
   GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
+  // The field cannot extend past the limit. Computed in 64 bits: for streams
+  // the limit can be close to INT_MAX, so an int sum could overflow.
+  GOOGLE_PROTOBUF_PARSER_ASSERT(size <= static_cast<int64_t>(limit_) +
+                                            (buffer_end_ - ptr));
+  // Reserve for the whole field at once instead of growing the field for
+  // every buffer it spans. The size is bounded for streams, whose limit may be
+  // far beyond the actual end of the input.
+  out->Reserve(out->size() + std::min<int>(size, kSafeStringSize) /
+                                 static_cast<int>(sizeof(T)));
   int nbytes = static_cast<int>(buffer_end_ + kSlopBytes - ptr);
   while (size > nbytes) {
     int num = nbytes / sizeof(T);
-    int old_entries = out->size();
-    out->Reserve(old_entries + num);
     int block_size = num * sizeof(T);
-    auto dst = out->AddNAlreadyReserved(num);
-#ifdef ABSL_IS_LITTLE_ENDIAN
-    std::memcpy(dst, ptr, block_size);
-#else
-    for (int i = 0; i < num; i++)
-      dst[i] = UnalignedLoad<T>(ptr + i * sizeof(T));
-#endif
+    out->Reserve(out->size() + num);
+    CopyPackedFixed(out->AddNAlreadyReserved(num), ptr, num);
     size -= block_size;
     if (limit_ <= kSlopBytes) return nullptr;
     ptr = Next();
@@ -1194,22 +1321,78 @@ const char* EpsCopyInputStream::ReadPackedFixed(const char* ptr, int size,
   int num = size / sizeof(T);
   int block_size = num * sizeof(T);
   if (num == 0) return size == block_size ? ptr : nullptr;
-  int old_entries = out->size();
-  out->Reserve(old_entries + num);
-  auto dst = out->AddNAlreadyReserved(num);
-#ifdef ABSL_IS_LITTLE_ENDIAN
-  ABSL_CHECK(dst != nullptr) << out << "," << num;
-  std::memcpy(dst, ptr, block_size);
-#else
-  for (int i = 0; i < num; i++) dst[i] = UnalignedLoad<T>(ptr + i * sizeof(T));
-#endif
+  out->Reserve(out->size() + num);
+  CopyPackedFixed(out->AddNAlreadyReserved(num), ptr, num);
   ptr += block_size;
   if (size != block_size) return nullptr;
   return ptr;
 }
 
+// Returns the value of a varint of at most 8 bytes, given its little-endian
+// encoded bytes in `bytes`. Bytes past the varint must be zero.
+inline PROTOBUF_ALWAYS_INLINE uint64_t CompactVarintBytes(uint64_t bytes) {
+  bytes &= 0x7f7f7f7f7f7f7f7f;
+  bytes = ((bytes & 0x7f007f007f007f00) >> 1) | (bytes & 0x007f007f007f007f);
+  bytes = ((bytes & 0x3fff00003fff0000) >> 2) | (bytes & 0x00003fff00003fff);
+  return ((bytes & 0x0fffffff00000000) >> 4) | (bytes & 0x000000000fffffff);
+}
+
 template <typename Add>
 const char* ReadPackedVarintArray(const char* ptr, const char* end, Add add) {
+#ifdef ABSL_IS_LITTLE_ENDIAN
+  // The scalar parser predicts well when all varints have the same length, and
+  // beats the word-at-a-time decoder below for 2 to 6 byte values. The first
+  // few varints are parsed one by one to tell such arrays apart.
+  int min_size = 16;
+  int max_size = 0;
+  for (int i = 0; i < 8 && ptr < end; ++i) {
+    uint64_t varint;
+    const char* next = VarintParse(ptr, &varint);
+    if (next == nullptr) return nullptr;
+    const int size = static_cast<int>(next - ptr);
+    min_size = std::min(min_size, size);
+    max_size = std::max(max_size, size);
+    add(varint);
+    ptr = next;
+  }
+  const bool decode_words =
+      min_size != max_size || min_size == 1 || min_size == 7 || min_size == 8;
+  // Decode a word at a time: the cleared continuation bits of 8 loaded bytes
+  // locate the varints ending within them, which are then decoded without
+  // branching on their length. Varints longer than 8 bytes and the last few
+  // bytes of the array use the scalar parser.
+  constexpr uint64_t kMsbs = 0x8080808080808080;
+  while (decode_words && end - ptr >= 8) {
+    uint64_t word;
+    std::memcpy(&word, ptr, sizeof(word));
+    uint64_t stops = ~word & kMsbs;
+    if (stops == kMsbs) {
+      // Eight single byte varints, the common case for small values.
+      for (int i = 0; i < 8; ++i) add(static_cast<uint64_t>(ptr[i]));
+      ptr += 8;
+      continue;
+    }
+    if (PROTOBUF_PREDICT_FALSE(stops == 0)) {
+      uint64_t varint;
+      ptr = VarintParse(ptr, &varint);
+      if (ptr == nullptr) return nullptr;
+      add(varint);
+      continue;
+    }
+    // Decode at most two varints per load: a fixed trip count keeps the
+    // branches predictable for runs of same-length values.
+    uint64_t upto = stops ^ (stops - 1);  // Bits through the first stop bit.
+    add(CompactVarintBytes(word & upto));
+    int consumed_bits = absl::countr_zero(stops) + 1;
+    stops &= stops - 1;
+    if (stops != 0) {
+      upto = stops ^ (stops - 1);
+      add(CompactVarintBytes((word & upto) >> consumed_bits));
+      consumed_bits = absl::countr_zero(stops) + 1;
+    }
+    ptr += consumed_bits / 8;
+  }
+#endif
   while (ptr < end) {
     uint64_t varint;
     ptr = VarintParse(ptr, &varint);
@@ -1226,6 +1409,32 @@ const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add,
   size_callback(size);
 
   GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
+  return ReadPackedVarintPayload(ptr, size, add);
+}
+
+template <typename Add, typename ReserveCb>
+const char* EpsCopyInputStream::ReadPackedVarintReserved(const char* ptr,
+                                                         Add add,
+                                                         ReserveCb reserve) {
+  int size = ReadSize(&ptr);
+  GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
+  // Bytes up to buffer_end_ + kSlopBytes are always readable. Each varint ends
+  // with exactly one byte that has the continuation bit clear, so counting
+  // those gives the number of elements. A payload that crosses the buffer is
+  // left to grow as usual rather than peeking into the next chunk.
+  if (size > 0 && size <= buffer_end_ + kSlopBytes - ptr) {
+    int count = 0;
+    for (int i = 0; i < size; ++i) {
+      count += static_cast<uint8_t>(ptr[i]) < 0x80;
+    }
+    reserve(count);
+  }
+  return ReadPackedVarintPayload(ptr, size, add);
+}
+
+template <typename Add>
+const char* EpsCopyInputStream::ReadPackedVarintPayload(const char* ptr,
+                                                        int size, Add add) {
   int chunk_size = static_cast<int>(buffer_end_ - ptr);
   while (size > chunk_size) {
     ptr = ReadPackedVarintArray(ptr, buffer_end_, add);
@@ -1368,14 +1577,17 @@ PROTOBUF_NODISCARD const char* PackedEnumParser(void* object, const char* ptr,
                                                 bool (*is_valid)(int),
                                                 InternalMetadata* metadata,
                                                 int field_num) {
-  return ctx->ReadPackedVarint(
-      ptr, [object, is_valid, metadata, field_num](int32_t val) {
+  auto* field = static_cast<RepeatedField<int>*>(object);
+  return ctx->ReadPackedVarintReserved(
+      ptr,
+      [field, is_valid, metadata, field_num](int32_t val) {
         if (is_valid(val)) {
-          static_cast<RepeatedField<int>*>(object)->Add(val);
+          field->Add(val);
         } else {
           WriteVarint(field_num, val, metadata->mutable_unknown_fields<T>());
         }
-      });
+      },
+      [field](int count) { field->Reserve(field->size() + count); });
 }
 
 template <typename T>
@@ -1383,14 +1595,17 @@ PROTOBUF_NODISCARD const char* PackedEnumParserArg(
     void* object, const char* ptr, ParseContext* ctx,
     bool (*is_valid)(const void*, int), const void* data,
     InternalMetadata* metadata, int field_num) {
-  return ctx->ReadPackedVarint(
-      ptr, [object, is_valid, data, metadata, field_num](int32_t val) {
+  auto* field = static_cast<RepeatedField<int>*>(object);
+  return ctx->ReadPackedVarintReserved(
+      ptr,
+      [field, is_valid, data, metadata, field_num](int32_t val) {
         if (is_valid(data, val)) {
-          static_cast<RepeatedField<int>*>(object)->Add(val);
+          field->Add(val);
         } else {
           WriteVarint(field_num, val, metadata->mutable_unknown_fields<T>());
         }
-      });
+      },
+      [field](int count) { field->Reserve(field->size() + count); });
 }
 
 PROTOBUF_NODISCARD PROTOBUF_EXPORT const char* PackedBoolParser(
@@ -0,0 +1,154 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/parse_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <string>
+
+#include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
+#include "absl/numeric/bits.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/generated_message_tctable_decl.h"
+#include "google/protobuf/message_lite.h"
+#include "google/protobuf/parse_context.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+#if defined(PROTOBUF_TC_PARSE_STATS)
+namespace {
+
+struct Registry {
+  std::atomic<int32_t> period{1000};
+  absl::Mutex mutex;
+  // Type names are only looked up when reporting: doing it while parsing
+  // could deadlock in parses that build descriptors.
+  absl::flat_hash_map<const internal::TcParseTableBase*, ParseStats> stats
+      ABSL_GUARDED_BY(mutex);
+};
+
+Registry& GetRegistry() {
+  static auto* registry = new Registry();
+  return *registry;
+}
+
+void AddToHistogram(uint64_t value, ParseStats::Histogram& histogram) {
+  ++histogram[absl::bit_width(value)];
+}
+
+void Add(const ParseStats& from, ParseStats& to) {
+  to.parses += from.parses;
+  to.errors += from.errors;
+  to.bytes += from.bytes;
+  to.fields += from.fields;
+  to.unknown_fields += from.unknown_fields;
+  to.nanoseconds += from.nanoseconds;
+  for (int i = 0; i < ParseStats::kNumBuckets; ++i) {
+    to.bytes_histogram[i] += from.bytes_histogram[i];
+    to.nanoseconds_histogram[i] += from.nanoseconds_histogram[i];
+  }
+}
+
+}  // namespace
+
+namespace internal {
+
+PROTOBUF_THREAD_LOCAL ParseStatsSample* parse_stats_sample = nullptr;
+PROTOBUF_THREAD_LOCAL int32_t parse_stats_countdown = 0;
+
+const char* SampledInternalParse(MessageLite* msg, const char* ptr,
+                                 ParseContext* ctx) {
+  Registry& registry = GetRegistry();
+  parse_stats_countdown = registry.period.load(std::memory_order_relaxed);
+  if (parse_stats_sample != nullptr) return msg->_InternalParse(ptr, ctx);
+
+  ParseStatsSample sample;
+  parse_stats_sample = &sample;
+  const int bytes_before = ctx->BytesUntilLimit(ptr);
+  const auto start = std::chrono::steady_clock::now();
+  ptr = msg->_InternalParse(ptr, ctx);
+  const auto end = std::chrono::steady_clock::now();
+  parse_stats_sample = nullptr;
+
+  const uint64_t nanoseconds = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+          .count());
+  const uint64_t bytes =
+      ptr == nullptr
+          ? 0
+          : static_cast<uint64_t>(bytes_before - ctx->BytesUntilLimit(ptr));
+  if (sample.table == nullptr) return ptr;
+
+  absl::MutexLock lock(&registry.mutex);
+  ParseStats& stats = registry.stats[sample.table];
+  ++stats.parses;
+  if (ptr == nullptr) {
+    ++stats.errors;
+  } else {
+    stats.bytes += bytes;
+    AddToHistogram(bytes, stats.bytes_histogram);
+  }
+  stats.fields += sample.fields;
+  stats.unknown_fields += sample.unknown_fields;
+  stats.nanoseconds += nanoseconds;
+  AddToHistogram(nanoseconds, stats.nanoseconds_histogram);
+  return ptr;
+}
+
+}  // namespace internal
+
+void ParseStatsRegistry::SetSamplingPeriod(int32_t period) {
+  GetRegistry().period.store(std::max(period, 1), std::memory_order_relaxed);
+}
+
+void ParseStatsRegistry::ForEach(
+    absl::FunctionRef<void(absl::string_view type_name,
+                           const ParseStats& stats)>
+        f) {
+  Registry& registry = GetRegistry();
+  absl::flat_hash_map<const internal::TcParseTableBase*, ParseStats> by_table;
+  {
+    absl::MutexLock lock(&registry.mutex);
+    by_table = registry.stats;
+  }
+  // Several tables may parse the same type, e.g. generated and reflection
+  // tables.
+  absl::btree_map<std::string, ParseStats> by_type;
+  for (const auto& entry : by_table) {
+    const MessageLite* prototype = entry.first->default_instance;
+    if (prototype == nullptr) continue;
+    Add(entry.second, by_type[prototype->GetTypeName()]);
+  }
+  for (const auto& entry : by_type) f(entry.first, entry.second);
+}
+
+void ParseStatsRegistry::Reset() {
+  Registry& registry = GetRegistry();
+  absl::MutexLock lock(&registry.mutex);
+  registry.stats.clear();
+}
+#else   // PROTOBUF_TC_PARSE_STATS
+void ParseStatsRegistry::SetSamplingPeriod(int32_t) {}
+void ParseStatsRegistry::ForEach(
+    absl::FunctionRef<void(absl::string_view, const ParseStats&)>) {}
+void ParseStatsRegistry::Reset() {}
+#endif  // PROTOBUF_TC_PARSE_STATS
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
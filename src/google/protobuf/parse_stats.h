@@ -0,0 +1,113 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines ParseStatsRegistry, which collects per-message-type
+// statistics of sampled parses.
+
+#ifndef GOOGLE_PROTOBUF_PARSE_STATS_H__
+#define GOOGLE_PROTOBUF_PARSE_STATS_H__
+
+#include <array>
+#include <cstdint>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+class MessageLite;
+
+namespace internal {
+class ParseContext;
+struct TcParseTableBase;
+
+#if defined(PROTOBUF_TC_PARSE_STATS)
+// Counters of the sampled parse running on this thread, if any.
+struct ParseStatsSample {
+  // The table of the top-level message, set by its ParseLoop.
+  const TcParseTableBase* table = nullptr;
+  uint64_t fields = 0;
+  uint64_t unknown_fields = 0;
+};
+
+extern PROTOBUF_THREAD_LOCAL ParseStatsSample* parse_stats_sample;
+// Number of top-level parses this thread may start before the next one is
+// sampled.
+extern PROTOBUF_THREAD_LOCAL int32_t parse_stats_countdown;
+
+// Runs msg->_InternalParse(ptr, ctx) and records it.
+PROTOBUF_EXPORT const char* SampledInternalParse(MessageLite* msg,
+                                                 const char* ptr,
+                                                 ParseContext* ctx);
+#endif  // PROTOBUF_TC_PARSE_STATS
+
+}  // namespace internal
+
+// Totals over the sampled parses of one message type.
+struct ParseStats {
+  // Bucket `i` of a histogram counts the parses whose value has a bit width
+  // of `i`: bucket 0 counts zeros, bucket 1 ones, bucket 2 values in [2, 4),
+  // bucket 3 values in [4, 8), and so on.
+  static constexpr int kNumBuckets = 65;
+  using Histogram = std::array<uint64_t, kNumBuckets>;
+
+  uint64_t parses = 0;
+  // Parses that failed. Their bytes are not counted.
+  uint64_t errors = 0;
+  uint64_t bytes = 0;
+  // Fields of the message and all of its submessages, including unknown
+  // fields.
+  uint64_t fields = 0;
+  // Fields that were not handled by the parse tables: unknown fields and
+  // extensions.
+  uint64_t unknown_fields = 0;
+  uint64_t nanoseconds = 0;
+  Histogram bytes_histogram = {};
+  Histogram nanoseconds_histogram = {};
+};
+
+// Collects statistics of top-level parses, i.e. calls like ParseFromString(),
+// by message type. The statistics are only collected in builds with
+// PROTOBUF_TC_PARSE_STATS defined, which cost nothing otherwise. Each thread
+// then samples one in every `period` top-level parses. Only parses through
+// TcParser tables are recorded.
+//
+// Nested parses started while a sampled parse runs, e.g. of Any payloads, are
+// counted as part of it.
+class PROTOBUF_EXPORT ParseStatsRegistry {
+ public:
+  static constexpr bool enabled() {
+#if defined(PROTOBUF_TC_PARSE_STATS)
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // Sets the sampling period, which defaults to 1000. Threads pick up the new
+  // period after their next sample.
+  static void SetSamplingPeriod(int32_t period);
+
+  // Calls `f` with the statistics of each message type that has samples, in
+  // order of type name.
+  static void ForEach(
+      absl::FunctionRef<void(absl::string_view type_name,
+                             const ParseStats& stats)>
+          f);
+
+  static void Reset();
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_PARSE_STATS_H__
@@ -0,0 +1,89 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/parse_stats.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/container/flat_hash_map.h"
+#include "absl/numeric/bits.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+absl::flat_hash_map<std::string, ParseStats> Snapshot() {
+  absl::flat_hash_map<std::string, ParseStats> snapshot;
+  ParseStatsRegistry::ForEach(
+      [&](absl::string_view type_name, const ParseStats& stats) {
+        snapshot.emplace(type_name, stats);
+      });
+  return snapshot;
+}
+
+uint64_t Sum(const ParseStats::Histogram& histogram) {
+  uint64_t sum = 0;
+  for (uint64_t count : histogram) sum += count;
+  return sum;
+}
+
+TEST(ParseStatsTest, RecordsSampledParses) {
+  ParseStatsRegistry::SetSamplingPeriod(1);
+  // Let this thread's countdown from any earlier sample run out.
+  for (int i = 0; i < 1000; i++) {
+    protobuf_unittest::TestEmptyMessage().ParseFromString("");
+  }
+  ParseStatsRegistry::Reset();
+
+  protobuf_unittest::TestAllTypes source;
+  TestUtil::SetAllFields(&source);
+  const std::string data = source.SerializeAsString();
+  for (int i = 0; i < 3; i++) {
+    protobuf_unittest::TestAllTypes message;
+    ASSERT_TRUE(message.ParseFromString(data));
+  }
+  protobuf_unittest::TestAllTypes message;
+  EXPECT_FALSE(message.ParseFromString("\x08"));
+  protobuf_unittest::TestEmptyMessage empty;
+  ASSERT_TRUE(empty.ParseFromString(data));
+
+  const auto snapshot = Snapshot();
+  if (!ParseStatsRegistry::enabled()) {
+    EXPECT_TRUE(snapshot.empty());
+    return;
+  }
+  ASSERT_EQ(snapshot.count("protobuf_unittest.TestAllTypes"), 1);
+  const ParseStats& stats = snapshot.at("protobuf_unittest.TestAllTypes");
+  EXPECT_EQ(stats.parses, 4);
+  EXPECT_EQ(stats.errors, 1);
+  EXPECT_EQ(stats.bytes, 3 * data.size());
+  EXPECT_EQ(stats.bytes_histogram[absl::bit_width(data.size())], 3);
+  EXPECT_EQ(Sum(stats.bytes_histogram), 3);
+  EXPECT_EQ(Sum(stats.nanoseconds_histogram), 4);
+  std::vector<const FieldDescriptor*> set_fields;
+  source.GetReflection()->ListFields(source, &set_fields);
+  EXPECT_GE(stats.fields, 3 * set_fields.size());
+  EXPECT_EQ(stats.unknown_fields, 0);
+
+  const ParseStats& empty_stats =
+      snapshot.at("protobuf_unittest.TestEmptyMessage");
+  EXPECT_EQ(empty_stats.parses, 1);
+  EXPECT_EQ(empty_stats.fields, empty_stats.unknown_fields);
+  EXPECT_GT(empty_stats.unknown_fields, 0);
+  ParseStatsRegistry::SetSamplingPeriod(1000);
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
@@ -44,10 +44,14 @@ static const Reflection* GetReflectionOrDie(const Message& m) {
 void ReflectionOps::Copy(const Message& from, Message* to) {
   if (&from == to) return;
   Clear(to);
-  Merge(from, to);
+  Merge(from, to, /*to_is_clear=*/true);
 }
 
 void ReflectionOps::Merge(const Message& from, Message* to) {
+  Merge(from, to, /*to_is_clear=*/false);
+}
+
+void ReflectionOps::Merge(const Message& from, Message* to, bool to_is_clear) {
   ABSL_CHECK_NE(&from, to);
 
   const Descriptor* descriptor = from.GetDescriptor();
@@ -64,7 +68,13 @@ void ReflectionOps::Merge(const Message& from, Message* to) {
                           google::protobuf::MessageFactory::generated_factory());
 
   std::vector<const FieldDescriptor*> fields;
-  from_reflection->ListFields(from, &fields);
+  if (from_reflection == to_reflection) {
+    // Both messages have the same layout, so most fields can be copied
+    // directly; only the rest are merged below.
+    from_reflection->MergeInPlaceFields(from, to, to_is_clear, &fields);
+  } else {
+    from_reflection->ListFields(from, &fields);
+  }
   for (const FieldDescriptor* field : fields) {
     if (field->is_repeated()) {
       // Use map reflection if both are in map status and have the
@@ -158,11 +168,10 @@ void ReflectionOps::Merge(const Message& from, Message* to) {
 void ReflectionOps::Clear(Message* message) {
   const Reflection* reflection = GetReflectionOrDie(*message);
 
-  std::vector<const FieldDescriptor*> fields;
-  reflection->ListFields(*message, &fields);
-  for (const FieldDescriptor* field : fields) {
+  // Clearing a field does not affect whether the fields after it are listed.
+  reflection->ForEachListedField(*message, [&](const FieldDescriptor* field) {
     reflection->ClearField(message, field);
-  }
+  });
 
   if (reflection->GetInternalMetadata(*message).have_unknown_fields()) {
     reflection->MutableUnknownFields(message)->Clear();
@@ -173,6 +182,7 @@ bool ReflectionOps::IsInitialized(const Message& message, bool check_fields,
                                   bool check_descendants) {
   const Descriptor* descriptor = message.GetDescriptor();
   const Reflection* reflection = GetReflectionOrDie(message);
+  if (!reflection->MayBeUninitialized()) return true;
   if (const int field_count = descriptor->field_count()) {
     const FieldDescriptor* begin = descriptor->field(0);
     const FieldDescriptor* end = begin + field_count;
@@ -245,6 +255,9 @@ bool ReflectionOps::IsInitialized(const Message& message, bool check_fields,
 bool ReflectionOps::IsInitialized(const Message& message) {
   const Descriptor* descriptor = message.GetDescriptor();
   const Reflection* reflection = GetReflectionOrDie(message);
+  // Avoids walking the whole tree of messages of types that can't have
+  // required fields.
+  if (!reflection->MayBeUninitialized()) return true;
 
   // Check required fields of this message.
   {
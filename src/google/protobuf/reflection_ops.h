@@ -56,6 +56,10 @@ class PROTOBUF_EXPORT ReflectionOps {
   static void FindInitializationErrors(const Message& message,
                                        const std::string& prefix,
                                        std::vector<std::string>* errors);
+
+ private:
+  // Like Merge().  If `to_is_clear`, `to` has no fields set.
+  static void Merge(const Message& from, Message* to, bool to_is_clear);
 };
 
 }  // namespace internal
@@ -11,11 +11,16 @@
 
 #include "google/protobuf/reflection_ops.h"
 
+#include <cmath>
+#include <memory>
+
 #include <gtest/gtest.h>
 #include "absl/strings/str_join.h"
 #include "google/protobuf/descriptor.h"
+#include "google/protobuf/dynamic_message.h"
 #include "google/protobuf/test_util.h"
 #include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unittest_proto3.pb.h"
 
 
 namespace google {
@@ -161,6 +166,78 @@ TEST(ReflectionOpsTest, MergeOneof) {
   TestUtil::ExpectOneofSet2(message2);
 }
 
+TEST(ReflectionOpsTest, MergeKeepsFieldsNotSetInSource) {
+  unittest::TestAllTypes message, message2;
+  TestUtil::SetAllFields(&message);
+
+  // Scalars laid out next to each other, only some of which are set.
+  message2.set_optional_int64(5);
+  message2.set_optional_double(1.5);
+  message2.set_default_string("abc");
+  ReflectionOps::Merge(message2, &message);
+
+  EXPECT_EQ(message.optional_int32(), 101);
+  EXPECT_EQ(message.optional_int64(), 5);
+  EXPECT_EQ(message.optional_uint32(), 103);
+  EXPECT_EQ(message.optional_double(), 1.5);
+  EXPECT_EQ(message.optional_float(), 111);
+  EXPECT_EQ(message.optional_string(), "115");
+  EXPECT_EQ(message.default_string(), "abc");
+  EXPECT_EQ(message.repeated_int32_size(), 2);
+
+  // Fields that are not set keep their defaults.
+  unittest::TestAllTypes message3;
+  message3.set_optional_int32(1);
+  ReflectionOps::Copy(message3, &message2);
+  EXPECT_FALSE(message2.has_optional_int64());
+  EXPECT_FALSE(message2.has_default_int32());
+  EXPECT_EQ(message2.default_int32(), 41);
+  EXPECT_FALSE(message2.has_default_string());
+  EXPECT_EQ(message2.default_string(), "hello");
+  EXPECT_EQ(message2.optional_int32(), 1);
+}
+
+TEST(ReflectionOpsTest, MergeImplicitPresence) {
+  proto3_unittest::TestAllTypes message, message2;
+  message.set_optional_int32(1);
+  message.set_optional_int64(2);
+  message.set_optional_string("foo");
+  message2.set_optional_int64(3);
+  message2.set_optional_float(-0.0f);
+  message2.add_repeated_int32(4);
+  ReflectionOps::Merge(message2, &message);
+
+  EXPECT_EQ(message.optional_int32(), 1);
+  EXPECT_EQ(message.optional_int64(), 3);
+  EXPECT_TRUE(std::signbit(message.optional_float()));
+  EXPECT_EQ(message.optional_string(), "foo");
+  EXPECT_EQ(message.repeated_int32_size(), 1);
+
+  ReflectionOps::Copy(message2, &message);
+  EXPECT_EQ(message.optional_int32(), 0);
+  EXPECT_EQ(message.optional_int64(), 3);
+  EXPECT_EQ(message.optional_string(), "");
+}
+
+TEST(ReflectionOpsTest, MergeDynamicMessages) {
+  const Descriptor* descriptor = unittest::TestAllTypes::descriptor();
+  DynamicMessageFactory factory;
+  const Message* prototype = factory.GetPrototype(descriptor);
+  std::unique_ptr<Message> message(prototype->New());
+  std::unique_ptr<Message> message2(prototype->New());
+  TestUtil::ReflectionTester reflection_tester(descriptor);
+  reflection_tester.SetAllFieldsViaReflection(message.get());
+
+  ReflectionOps::Copy(*message, message2.get());
+  reflection_tester.ExpectAllFieldsSetViaReflection(*message2);
+
+  ReflectionOps::Merge(*message, message2.get());
+  const FieldDescriptor* repeated_int32 =
+      descriptor->FindFieldByName("repeated_int32");
+  EXPECT_EQ(message2->GetReflection()->FieldSize(*message2, repeated_int32),
+            4);
+}
+
 #if GTEST_HAS_DEATH_TEST
 
 TEST(ReflectionOpsTest, MergeFromSelf) {
@@ -330,6 +407,23 @@ TEST(ReflectionOpsTest, IsInitialized) {
   EXPECT_TRUE(ReflectionOps::IsInitialized(message, false, true));
 }
 
+TEST(ReflectionOpsTest, RecursiveIsInitialized) {
+  // Recursive types are initialized unless a type they may contain has
+  // required fields.
+  unittest::NestedTestAllTypes nested;
+  nested.mutable_child()->mutable_child()->mutable_payload();
+  EXPECT_TRUE(ReflectionOps::IsInitialized(nested));
+  EXPECT_TRUE(ReflectionOps::IsInitialized(nested, true, true));
+
+  unittest::TestNestedRequiredForeign message;
+  message.mutable_child()->mutable_child()->mutable_payload();
+  EXPECT_TRUE(ReflectionOps::IsInitialized(message));
+  message.mutable_child()->mutable_child()->mutable_payload()
+      ->mutable_optional_message();
+  EXPECT_FALSE(ReflectionOps::IsInitialized(message));
+  EXPECT_FALSE(ReflectionOps::IsInitialized(message, false, true));
+}
+
 TEST(ReflectionOpsTest, ForeignIsInitialized) {
   unittest::TestRequiredForeign message;
 
@@ -37,6 +37,7 @@
 #include "absl/log/absl_log.h"
 #include "absl/meta/type_traits.h"
 #include "absl/strings/cord.h"
+#include "absl/types/span.h"
 #include "google/protobuf/arena.h"
 #include "google/protobuf/generated_enum_util.h"
 #include "google/protobuf/internal_visibility.h"
@@ -194,6 +195,9 @@ class RepeatedField final
   // the appropriate number of elements.
   template <typename Iter>
   void Add(Iter begin, Iter end);
+  // Appends all of `values` with a single capacity check and copy. `values`
+  // must not alias this field's own elements.
+  void Append(absl::Span<const Element> values);
 
   // Removes the last element in the array.
   void RemoveLast();
@@ -211,6 +215,9 @@ class RepeatedField final
   // Replaces the contents with RepeatedField(begin, end).
   template <typename Iter>
   ABSL_ATTRIBUTE_REINITIALIZES void Assign(Iter begin, Iter end);
+  // Replaces the contents with `values`, which must not alias this field's own
+  // elements.
+  ABSL_ATTRIBUTE_REINITIALIZES void Assign(absl::Span<const Element> values);
 
   // Reserves space to expand the field to at least the given size.  If the
   // array is grown, it will always be at least doubled in size.
@@ -731,6 +738,18 @@ inline void RepeatedField<Element>::Add(Iter begin, Iter end) {
   }
 }
 
+template <typename Element>
+inline void RepeatedField<Element>::Append(absl::Span<const Element> values) {
+  if (values.empty()) return;
+  ABSL_DCHECK(values.data() + values.size() <= unsafe_elements() ||
+              values.data() >= unsafe_elements() + total_size_)
+      << "Append() does not support aliasing the field's own elements.";
+  const int size = static_cast<int>(values.size());
+  Reserve(current_size_ + size);
+  Element* dst = unsafe_elements() + ExchangeCurrentSize(current_size_ + size);
+  UninitializedCopyN(values.data(), size, dst);
+}
+
 template <typename Element>
 inline void RepeatedField<Element>::RemoveLast() {
   ABSL_DCHECK_GT(current_size_, 0);
@@ -788,6 +807,12 @@ inline void RepeatedField<Element>::Assign(Iter begin, Iter end) {
   Add(begin, end);
 }
 
+template <typename Element>
+inline void RepeatedField<Element>::Assign(absl::Span<const Element> values) {
+  Clear();
+  Append(values);
+}
+
 template <typename Element>
 inline typename RepeatedField<Element>::iterator RepeatedField<Element>::erase(
     const_iterator position) ABSL_ATTRIBUTE_LIFETIME_BOUND {
@@ -962,6 +987,8 @@ PROTOBUF_NOINLINE void RepeatedField<Element>::GrowNoAnnotate(int current_size,
     new_size = static_cast<int>(num_available);
     new_rep = static_cast<Rep*>(res.p);
   } else {
+    internal::RecordArenaAllocation<Element>(
+        internal::ArenaAllocationKind::kRepeated, bytes);
     new_rep = reinterpret_cast<Rep*>(Arena::CreateArray<char>(arena, bytes));
   }
   new_rep->arena = arena;
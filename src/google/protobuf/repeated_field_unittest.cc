@@ -56,6 +56,7 @@ using ::protobuf_unittest::TestAllTypes;
 using ::protobuf_unittest::TestMessageWithManyRepeatedPtrFields;
 using ::testing::AllOf;
 using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
 using ::testing::Ge;
 using ::testing::Le;
 
@@ -691,6 +692,58 @@ TEST(RepeatedField, AddAndAssignRanges) {
   EXPECT_EQ(field.Get(7), 609250);
 }
 
+TEST(RepeatedField, AppendAndAssignSpans) {
+  RepeatedField<int> field;
+  field.Append({});
+  EXPECT_TRUE(field.empty());
+
+  const int vals[] = {2, 27, 2875, 609250};
+  field.Assign(vals);
+  EXPECT_THAT(field, ElementsAre(2, 27, 2875, 609250));
+
+  field.Append(vals);
+  EXPECT_THAT(field, ElementsAre(2, 27, 2875, 609250, 2, 27, 2875, 609250));
+
+  std::vector<int> large(1000);
+  for (int i = 0; i < 1000; ++i) large[i] = i;
+  field.Assign(large);
+  ASSERT_EQ(field.size(), 1000);
+  EXPECT_GE(field.Capacity(), 1000);
+  EXPECT_TRUE(std::equal(field.begin(), field.end(), large.begin()));
+}
+
+TEST(RepeatedField, AppendSpanOfCords) {
+  RepeatedField<absl::Cord> field;
+  field.Add(absl::Cord("a"));
+  const absl::Cord vals[] = {absl::Cord("b"), absl::Cord("c")};
+  field.Append(vals);
+  EXPECT_THAT(field, ElementsAre("a", "b", "c"));
+  field.Assign(vals);
+  EXPECT_THAT(field, ElementsAre("b", "c"));
+}
+
+TEST(RepeatedField, PackedVarintParseReservesExactly) {
+  protobuf_unittest::TestPackedTypes source;
+  for (int i = 0; i < 1000; ++i) {
+    // Mix one and multi byte varints.
+    source.add_packed_int32(i % 3 == 0 ? i * 1000 : i % 100);
+    source.add_packed_sint64(-i);
+  }
+  const std::string data = source.SerializeAsString();
+
+  Arena arena;
+  auto* parsed =
+      Arena::CreateMessage<protobuf_unittest::TestPackedTypes>(&arena);
+  ASSERT_TRUE(parsed->ParseFromString(data));
+  EXPECT_THAT(parsed->packed_int32(), ElementsAreArray(source.packed_int32()));
+  EXPECT_THAT(parsed->packed_sint64(),
+              ElementsAreArray(source.packed_sint64()));
+  // Arena allocations are exact, so a single reserve from the payload leaves
+  // no slack.
+  EXPECT_EQ(parsed->packed_int32().Capacity(), 1000);
+  EXPECT_EQ(parsed->packed_sint64().Capacity(), 1000);
+}
+
 TEST(RepeatedField, CopyConstructIntegers) {
   auto token = internal::InternalVisibilityForTesting{};
   using RepeatedType = RepeatedField<int>;
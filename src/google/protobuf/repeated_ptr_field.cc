@@ -20,6 +20,7 @@
 #include "absl/log/absl_check.h"
 #include "google/protobuf/arena.h"
 #include "google/protobuf/implicit_weak_message.h"
+#include "google/protobuf/message_lite.h"
 #include "google/protobuf/port.h"
 #include "google/protobuf/repeated_field.h"
 
@@ -51,6 +52,8 @@ void** RepeatedPtrFieldBase::InternalExtend(int extend_amount) {
     new_capacity = static_cast<int>((res.n - kRepHeaderSize) / ptr_size);
     new_rep = reinterpret_cast<Rep*>(res.p);
   } else {
+    internal::RecordArenaAllocation<void*>(
+        internal::ArenaAllocationKind::kRepeated, bytes);
     new_rep = reinterpret_cast<Rep*>(Arena::CreateArray<char>(arena, bytes));
   }
 
@@ -142,6 +145,10 @@ void* RepeatedPtrFieldBase::AddOutOfLineHelper(ElementFactory factory) {
       return r->elements[ExchangeCurrentSize(current_size_ + 1)];
     }
   }
+  if (PROTOBUF_PREDICT_FALSE(BatchesNewElements())) {
+    AddElementBatch(factory);
+    return rep()->elements[ExchangeCurrentSize(current_size_ + 1)];
+  }
   Rep* r = rep();
   ++r->allocated_size;
   void*& result = r->elements[ExchangeCurrentSize(current_size_ + 1)];
@@ -149,6 +156,46 @@ void* RepeatedPtrFieldBase::AddOutOfLineHelper(ElementFactory factory) {
   return result;
 }
 
+bool RepeatedPtrFieldBase::BatchesNewElements() const {
+  return arena_ != nullptr && arena_->ContiguousRepeatedElements();
+}
+
+template <typename Factory>
+void RepeatedPtrFieldBase::AddElementBatch(Factory factory) {
+  // Batches grow with the field, like its capacity, so that at most half of
+  // the elements are spare.
+  constexpr int kMinBatchSize = 4;
+  Rep* r = rep();
+  const int begin = r->allocated_size;
+  ABSL_DCHECK_LT(begin, total_size_);
+  const int end =
+      begin + std::min(total_size_ - begin, std::max(begin, kMinBatchSize));
+  for (int i = begin; i < end; ++i) {
+    r->elements[i] = factory(arena_);
+  }
+  r->allocated_size = end;
+}
+
+MessageLite* RepeatedPtrFieldBase::AddNewMessage(
+    const MessageLite* prototype) {
+  ABSL_DCHECK_EQ(current_size_, allocated_size());
+  // The first element is kept inline without a batch: most repeated fields
+  // are small.
+  if (PROTOBUF_PREDICT_FALSE(tagged_rep_or_elem_ != nullptr &&
+                             BatchesNewElements())) {
+    if (using_sso() || allocated_size() == total_size_) {
+      InternalExtend(1);
+    }
+    AddElementBatch([prototype](Arena* arena) {
+      return static_cast<void*>(NewFromPrototypeHelper(prototype, arena));
+    });
+    return static_cast<MessageLite*>(
+        rep()->elements[ExchangeCurrentSize(current_size_ + 1)]);
+  }
+  return static_cast<MessageLite*>(
+      AddOutOfLineHelper(NewFromPrototypeHelper(prototype, arena_)));
+}
+
 void RepeatedPtrFieldBase::CloseGap(int start, int num) {
   if (using_sso()) {
     if (start == 0 && num == 1) {
@@ -298,6 +298,16 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
   // an ImplicitWeakMessage will be used as a placeholder.
   MessageLite* AddWeak(const MessageLite* prototype);
 
+  // Like Add<GenericTypeHandler<MessageLite>>(prototype), but creates new
+  // elements in batches on arenas with contiguous_repeated_elements set.
+  MessageLite* AddMessage(const MessageLite* prototype) {
+    if (current_size_ < allocated_size()) {
+      return reinterpret_cast<MessageLite*>(
+          element_at(ExchangeCurrentSize(current_size_ + 1)));
+    }
+    return AddNewMessage(prototype);
+  }
+
   template <typename TypeHandler>
   void Clear() {
     const int n = current_size_;
@@ -827,6 +837,19 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
   void* AddOutOfLineHelper(void* obj);
   void* AddOutOfLineHelper(ElementFactory factory);
 
+  // Out-of-line part of AddMessage() for when there are no cleared elements.
+  MessageLite* AddNewMessage(const MessageLite* prototype);
+
+  // True if new elements are created in batches, see
+  // ArenaOptions::contiguous_repeated_elements.
+  bool BatchesNewElements() const;
+
+  // Fills part of the spare capacity, which must not be empty, with new
+  // elements made by `factory`. They become cleared elements, i.e. they are
+  // counted in allocated_size() but not in size().
+  template <typename Factory>
+  void AddElementBatch(Factory factory);
+
   // A few notes on internal representation:
   //
   // We use an indirected approach, with struct Rep, to keep
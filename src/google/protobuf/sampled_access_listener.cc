@@ -0,0 +1,156 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/sampled_access_listener.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/descriptor.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+// Number of samples a thread counts before adding them to the totals.
+constexpr int kFlushInterval = 4096;
+
+using FieldKey = std::pair<const internal::MessageNameExtractor*, int>;
+using CountsMap = absl::flat_hash_map<FieldKey, FieldAccessCounts>;
+
+void Add(const FieldAccessCounts& from, FieldAccessCounts& to) {
+  to.reads += from.reads;
+  to.writes += from.writes;
+}
+
+struct Registry {
+  std::atomic<int32_t> period{64};
+  absl::Mutex mutex;
+  CountsMap counts ABSL_GUARDED_BY(mutex);
+};
+
+Registry& GetRegistry() {
+  static auto* registry = new Registry();
+  return *registry;
+}
+
+// The samples of a thread which are not in the totals yet.
+struct ThreadCounts {
+  ~ThreadCounts() { Flush(); }
+
+  void Flush() {
+    if (counts.empty()) return;
+    Registry& registry = GetRegistry();
+    {
+      absl::MutexLock lock(&registry.mutex);
+      for (const auto& entry : counts) {
+        Add(entry.second, registry.counts[entry.first]);
+      }
+    }
+    counts.clear();
+    pending = 0;
+  }
+
+  CountsMap counts;
+  int pending = 0;
+};
+
+ThreadCounts& GetThreadCounts() {
+  static thread_local ThreadCounts counts;
+  return counts;
+}
+
+}  // namespace
+
+namespace internal {
+
+PROTOBUF_THREAD_LOCAL int32_t field_access_countdown = 0;
+
+void SampleFieldAccess(const MessageNameExtractor* type, int field_index,
+                       bool write) {
+  field_access_countdown =
+      GetRegistry().period.load(std::memory_order_relaxed);
+  ThreadCounts& local = GetThreadCounts();
+  FieldAccessCounts& counts = local.counts[{type, field_index}];
+  ++(write ? counts.writes : counts.reads);
+  if (++local.pending >= kFlushInterval) local.Flush();
+}
+
+}  // namespace internal
+
+void SampledAccessStats::SetSamplingPeriod(int32_t period) {
+  GetRegistry().period.store(std::max(period, 1), std::memory_order_relaxed);
+}
+
+void SampledAccessStats::Flush() { GetThreadCounts().Flush(); }
+
+void SampledAccessStats::ForEach(
+    absl::FunctionRef<void(absl::string_view type_name, int field_number,
+                           const FieldAccessCounts& counts)>
+        f) {
+  Flush();
+  Registry& registry = GetRegistry();
+  CountsMap by_index;
+  {
+    absl::MutexLock lock(&registry.mutex);
+    by_index = registry.counts;
+  }
+  absl::btree_map<std::pair<std::string, int>, FieldAccessCounts> by_number;
+  for (const auto& entry : by_index) {
+    internal::MessageNameExtractor name_extractor = *entry.first.first;
+    if (name_extractor == nullptr) continue;
+    const Descriptor* descriptor =
+        DescriptorPool::generated_pool()->FindMessageTypeByName(
+            name_extractor());
+    if (descriptor == nullptr || entry.first.second < 0 ||
+        entry.first.second >= descriptor->field_count()) {
+      continue;
+    }
+    Add(entry.second,
+        by_number[{descriptor->full_name(),
+                   descriptor->field(entry.first.second)->number()}]);
+  }
+  for (const auto& entry : by_number) {
+    f(entry.first.first, entry.first.second, entry.second);
+  }
+}
+
+std::string SampledAccessStats::DumpFieldHitStats() {
+  std::string out;
+  ForEach([&](absl::string_view type_name, int field_number,
+              const FieldAccessCounts& counts) {
+    absl::StrAppend(&out, type_name, " ", field_number, " ",
+                    counts.reads + counts.writes, "\n");
+  });
+  return out;
+}
+
+void SampledAccessStats::Reset() {
+  ThreadCounts& local = GetThreadCounts();
+  local.counts.clear();
+  local.pending = 0;
+  Registry& registry = GetRegistry();
+  absl::MutexLock lock(&registry.mutex);
+  registry.counts.clear();
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,175 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines SampledAccessListener, a field access listener which
+// counts sampled reads and writes of the fields of generated messages.
+
+#ifndef GOOGLE_PROTOBUF_SAMPLED_ACCESS_LISTENER_H__
+#define GOOGLE_PROTOBUF_SAMPLED_ACCESS_LISTENER_H__
+
+#include <cstdint>
+#include <string>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/field_access_listener.h"
+#include "google/protobuf/message_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+using MessageNameExtractor = absl::string_view (*)();
+
+// Number of field accesses this thread may make before the next one is
+// sampled.
+extern PROTOBUF_THREAD_LOCAL int32_t field_access_countdown;
+
+// Counts an access to the field with index `field_index` of the message type
+// named by `*type`.
+PROTOBUF_EXPORT void SampleFieldAccess(const MessageNameExtractor* type,
+                                       int field_index, bool write);
+
+}  // namespace internal
+
+// Sampled accesses of one field.
+struct FieldAccessCounts {
+  // Getters, has_ and size accessors, and const views of repeated fields.
+  uint64_t reads = 0;
+  // Setters, mutable accessors, adds, clears and releases.
+  uint64_t writes = 0;
+};
+
+// A field access listener which samples one in every `period` accessor calls
+// of each thread, and counts them per field. Accessors only decrement a
+// thread-local countdown; sampled calls are counted in thread-local counters,
+// which are added to the process-wide totals every few thousand samples, when
+// their thread exits, and by SampledAccessStats::Flush().
+//
+// Generated messages report their accesses to AccessListener<T>, which is
+// SampledAccessListener<T> when PROTOBUF_SAMPLED_ACCESS_LISTENER is defined,
+// in files generated with the inject_field_listener_events option of the C++
+// code generator. SampledAccessStats::DumpFieldHitStats() then writes the
+// totals in the format of the generator's field_hit_stats option, which lays
+// out and splits messages by how often their fields are used:
+//
+//   SampledAccessStats::SetSamplingPeriod(100);  // In the profiled binary.
+//   ... write SampledAccessStats::DumpFieldHitStats() to stats.txt ...
+//   protoc --cpp_out=field_hit_stats=stats.txt,split_field_hit_ratio=0.01:out
+//
+// Extensions and whole-message events (serialization, parsing, ...) are not
+// counted.
+template <typename Proto>
+struct SampledAccessListener : NoOpAccessListener<Proto> {
+  explicit SampledAccessListener(absl::string_view (*name_extractor)())
+      : NoOpAccessListener<Proto>(name_extractor) {
+    name_extractor_ = name_extractor;
+  }
+
+  template <int kFieldNum>
+  static void OnAdd(const MessageLite*, const void*) {
+    Write(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnAddMutable(const MessageLite*, const void*) {
+    Write(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnGet(const MessageLite*, const void*) {
+    Read(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnClear(const MessageLite*, const void*) {
+    Write(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnHas(const MessageLite*, const void*) {
+    Read(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnList(const MessageLite*, const void*) {
+    Read(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnMutable(const MessageLite*, const void*) {
+    Write(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnMutableList(const MessageLite*, const void*) {
+    Write(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnRelease(const MessageLite*, const void*) {
+    Write(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnSet(const MessageLite*, const void*) {
+    Write(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnSize(const MessageLite*, const void*) {
+    Read(kFieldNum);
+  }
+
+ private:
+  static void Read(int field_index) {
+    if (PROTOBUF_PREDICT_FALSE(--internal::field_access_countdown <= 0)) {
+      internal::SampleFieldAccess(&name_extractor_, field_index, false);
+    }
+  }
+  static void Write(int field_index) {
+    if (PROTOBUF_PREDICT_FALSE(--internal::field_access_countdown <= 0)) {
+      internal::SampleFieldAccess(&name_extractor_, field_index, true);
+    }
+  }
+
+  // Its address identifies the message type while sampling; the name is only
+  // looked up when reporting.
+  static internal::MessageNameExtractor name_extractor_;
+};
+
+template <typename Proto>
+internal::MessageNameExtractor SampledAccessListener<Proto>::name_extractor_ =
+    nullptr;
+
+// The totals counted by SampledAccessListener.
+class PROTOBUF_EXPORT SampledAccessStats {
+ public:
+  // Sets the sampling period, which defaults to 64. Threads pick up the new
+  // period after their next sample.
+  static void SetSamplingPeriod(int32_t period);
+
+  // Adds the samples of the calling thread to the totals.
+  static void Flush();
+
+  // Flushes the calling thread and calls `f` with the totals of each field
+  // with samples, in order of message type name and field number. Fields of
+  // types which are not in the generated pool are skipped.
+  static void ForEach(
+      absl::FunctionRef<void(absl::string_view type_name, int field_number,
+                             const FieldAccessCounts& counts)>
+          f);
+
+  // Flushes the calling thread and returns one "<message type name> <field
+  // number> <reads + writes>" line per field with samples, as read by the
+  // field_hit_stats option of the C++ code generator.
+  static std::string DumpFieldHitStats();
+
+  // Clears the totals and the samples of the calling thread. Samples that
+  // other threads have not flushed yet are kept.
+  static void Reset();
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_SAMPLED_ACCESS_LISTENER_H__
@@ -0,0 +1,98 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/sampled_access_listener.h"
+
+#include <cstdint>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+
+#include <gtest/gtest.h>
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+// Stands in for a generated message class: the listener only needs the field
+// count, and its name to report.
+struct FakeTestAllTypes {
+  static constexpr int _kInternalFieldNumber = 3;
+};
+
+absl::string_view TestAllTypesName() {
+  return protobuf_unittest::TestAllTypes::descriptor()->full_name();
+}
+
+SampledAccessListener<FakeTestAllTypes> listener(&TestAllTypesName);
+
+absl::flat_hash_map<int, std::pair<uint64_t, uint64_t>> Snapshot() {
+  absl::flat_hash_map<int, std::pair<uint64_t, uint64_t>> snapshot;
+  SampledAccessStats::ForEach([&](absl::string_view type_name,
+                                  int field_number,
+                                  const FieldAccessCounts& counts) {
+    EXPECT_EQ(type_name, TestAllTypesName());
+    snapshot[field_number] = {counts.reads, counts.writes};
+  });
+  return snapshot;
+}
+
+class SampledAccessListenerTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    SampledAccessStats::SetSamplingPeriod(1);
+    // Let this thread's countdown from any earlier sample run out.
+    for (int i = 0; i < 1000; ++i) listener.OnGet<0>(nullptr, nullptr);
+    SampledAccessStats::Reset();
+  }
+};
+
+TEST_F(SampledAccessListenerTest, CountsReadsAndWritesByFieldNumber) {
+  for (int i = 0; i < 3; ++i) listener.OnGet<0>(nullptr, nullptr);
+  listener.OnHas<0>(nullptr, nullptr);
+  listener.OnSet<1>(nullptr, nullptr);
+  listener.OnMutable<1>(nullptr, nullptr);
+  listener.OnSize<2>(nullptr, nullptr);
+
+  auto snapshot = Snapshot();
+  EXPECT_EQ(snapshot.size(), 3);
+  // Field indices 0, 1 and 2 of TestAllTypes are field numbers 1, 2 and 3.
+  EXPECT_EQ(snapshot[1], std::make_pair(uint64_t{4}, uint64_t{0}));
+  EXPECT_EQ(snapshot[2], std::make_pair(uint64_t{0}, uint64_t{2}));
+  EXPECT_EQ(snapshot[3], std::make_pair(uint64_t{1}, uint64_t{0}));
+
+  EXPECT_EQ(SampledAccessStats::DumpFieldHitStats(),
+            "protobuf_unittest.TestAllTypes 1 4\n"
+            "protobuf_unittest.TestAllTypes 2 2\n"
+            "protobuf_unittest.TestAllTypes 3 1\n");
+}
+
+TEST_F(SampledAccessListenerTest, FlushesExitingThreads) {
+  std::thread thread([] {
+    for (int i = 0; i < 10; ++i) listener.OnAdd<2>(nullptr, nullptr);
+  });
+  thread.join();
+
+  auto snapshot = Snapshot();
+  EXPECT_EQ(snapshot.size(), 1);
+  EXPECT_EQ(snapshot[3], std::make_pair(uint64_t{0}, uint64_t{10}));
+}
+
+TEST_F(SampledAccessListenerTest, SamplesOneInPeriod) {
+  SampledAccessStats::SetSamplingPeriod(10);
+  for (int i = 0; i < 1000; ++i) listener.OnGet<0>(nullptr, nullptr);
+
+  auto snapshot = Snapshot();
+  EXPECT_EQ(snapshot[1].first, 100);
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
@@ -68,6 +68,28 @@ struct ArenaBlock {
 
 enum class AllocationClient { kDefault, kArray };
 
+// Breakdown of the memory held by an arena, see Arena::GetMemoryReport().
+struct ArenaMemoryReport {
+  // Total size of all blocks, as returned by Arena::SpaceAllocated().
+  uint64_t space_allocated = 0;
+  // Bytes handed out to objects, as returned by Arena::SpaceUsed().
+  uint64_t space_used = 0;
+  // Bytes taken by the cleanup nodes of objects with destructors.
+  uint64_t cleanup_bytes = 0;
+  // Bytes left unused at the end of blocks that are no longer allocated from,
+  // because a request did not fit in the remaining space, or because Reset()
+  // kept a larger block to allocate from.
+  uint64_t block_tail_wasted_bytes = 0;
+  // Bytes still available at the end of the blocks currently allocated from,
+  // one per thread that allocated. This does not include memory returned by
+  // repeated fields for reuse, which stays counted in space_used.
+  uint64_t current_block_free_bytes = 0;
+  // Bytes of the std::string slots not yet handed out by StringBlocks.
+  uint64_t string_block_unused_bytes = 0;
+  // Number of blocks of each size, ordered by size.
+  std::vector<std::pair<size_t, size_t>> block_size_counts;
+};
+
 class ThreadSafeArena;
 
 // Tag type used to invoke the constructor of the first SerialArena.
@@ -101,6 +123,14 @@ class PROTOBUF_EXPORT SerialArena {
     return space_allocated_.load(std::memory_order_relaxed);
   }
   uint64_t SpaceUsed() const;
+  // Adds the cleanup, waste and free bytes of this arena to `report` and the
+  // size of each of its blocks to `block_sizes`.
+  void AddToMemoryReport(ArenaMemoryReport& report,
+                         std::vector<size_t>& block_sizes) const;
+
+  // NUMA node the blocks of this arena are requested from, or -1 if the
+  // allocation policy is not NUMA-aware.
+  int numa_node() const { return numa_node_; }
 
   // See comments on `cached_blocks_` member for details.
   PROTOBUF_ALWAYS_INLINE void* TryAllocateFromCachedBlock(size_t size) {
@@ -342,7 +372,8 @@ class PROTOBUF_EXPORT SerialArena {
   // future allocations.
   // The `parent` arena must outlive the serial arena, which is guaranteed
   // because the parent manages the lifetime of the serial arenas.
-  static SerialArena* New(SizedPtr mem, ThreadSafeArena& parent);
+  static SerialArena* New(SizedPtr mem, ThreadSafeArena& parent,
+                          int numa_node);
   // Free SerialArena returning the memory passed in to New
   template <typename Deallocator>
   SizedPtr Free(Deallocator deallocator);
@@ -355,6 +386,13 @@ class PROTOBUF_EXPORT SerialArena {
                       std::memory_order_relaxed);
   }
 
+  // Adds 'wasted` to space_wasted_ in relaxed atomic order.
+  void AddSpaceWasted(size_t space_wasted) {
+    space_wasted_.store(
+        space_wasted_.load(std::memory_order_relaxed) + space_wasted,
+        std::memory_order_relaxed);
+  }
+
   // Adds 'allocated` to space_allocated_ in relaxed atomic order.
   void AddSpaceAllocated(size_t space_allocated) {
     space_allocated_.store(
@@ -388,6 +426,8 @@ class PROTOBUF_EXPORT SerialArena {
   std::atomic<ArenaBlock*> head_{nullptr};  // Head of linked list of blocks.
   std::atomic<size_t> space_used_{0};       // Necessary for metrics.
   std::atomic<size_t> space_allocated_{0};
+  // Bytes left at the end of retired blocks, for memory reports.
+  std::atomic<size_t> space_wasted_{0};
   ThreadSafeArena& parent_;
 
   // Repeated*Field and Arena play together to reduce memory consumption by
@@ -402,6 +442,8 @@ class PROTOBUF_EXPORT SerialArena {
     CachedBlock* next;
   };
   uint8_t cached_block_length_ = 0;
+  // See numa_node().
+  int numa_node_ = -1;
   CachedBlock** cached_blocks_ = nullptr;
 
   // Helper getters/setters to handle relaxed operations on atomic variables.
@@ -421,11 +463,12 @@ class PROTOBUF_EXPORT SerialArena {
   }
 
   // Constructor is private as only New() should be used.
-  inline SerialArena(ArenaBlock* b, ThreadSafeArena& parent);
+  inline SerialArena(ArenaBlock* b, ThreadSafeArena& parent, int numa_node);
 
   // Constructors to handle the first SerialArena.
   inline explicit SerialArena(ThreadSafeArena& parent);
-  inline SerialArena(FirstSerialArena, ArenaBlock* b, ThreadSafeArena& parent);
+  inline SerialArena(FirstSerialArena, ArenaBlock* b, ThreadSafeArena& parent,
+                     int numa_node);
 
   void* AllocateAlignedFallback(size_t n);
   void* AllocateAlignedWithCleanupFallback(size_t n, size_t align,
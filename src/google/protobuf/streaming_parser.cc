@@ -0,0 +1,183 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/streaming_parser.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/message_lite.h"
+#include "google/protobuf/wire_format_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+using ::google::protobuf::internal::WireFormatLite;
+
+// A tag and a length prefix.
+constexpr size_t kMaxFieldHeaderSize = 5 + 10;
+
+enum class ScanResult { kComplete, kIncomplete, kMalformed };
+
+ScanResult ReadVarint(const char** ptr, const char* end, uint64_t* value) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 70; shift += 7) {
+    if (*ptr == end) return ScanResult::kIncomplete;
+    const uint8_t byte = static_cast<uint8_t>(*(*ptr)++);
+    result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (byte < 0x80) {
+      *value = result;
+      return ScanResult::kComplete;
+    }
+  }
+  return ScanResult::kMalformed;
+}
+
+// Finds the end of the field starting at `begin`. If it is complete, sets
+// `size` to its size. If it is not, sets `size` to the size it will have, or
+// 0 if that is not known yet.
+ScanResult ScanField(const char* begin, const char* end, size_t* size) {
+  const char* ptr = begin;
+  int depth = 0;
+  *size = 0;
+  do {
+    uint64_t tag;
+    ScanResult result = ReadVarint(&ptr, end, &tag);
+    if (result != ScanResult::kComplete) return result;
+    if (tag > UINT32_MAX || WireFormatLite::GetTagFieldNumber(tag) == 0) {
+      return ScanResult::kMalformed;
+    }
+    size_t value_size;
+    switch (WireFormatLite::GetTagWireType(tag)) {
+      case WireFormatLite::WIRETYPE_VARINT: {
+        uint64_t value;
+        result = ReadVarint(&ptr, end, &value);
+        if (result != ScanResult::kComplete) return result;
+        continue;
+      }
+      case WireFormatLite::WIRETYPE_FIXED64:
+        value_size = 8;
+        break;
+      case WireFormatLite::WIRETYPE_FIXED32:
+        value_size = 4;
+        break;
+      case WireFormatLite::WIRETYPE_LENGTH_DELIMITED: {
+        uint64_t length;
+        result = ReadVarint(&ptr, end, &length);
+        if (result != ScanResult::kComplete) return result;
+        if (length > INT_MAX) return ScanResult::kMalformed;
+        value_size = static_cast<size_t>(length);
+        break;
+      }
+      case WireFormatLite::WIRETYPE_START_GROUP:
+        ++depth;
+        continue;
+      case WireFormatLite::WIRETYPE_END_GROUP:
+        // Mismatched field numbers are left for the parser to reject.
+        if (depth == 0) return ScanResult::kMalformed;
+        --depth;
+        continue;
+      default:
+        return ScanResult::kMalformed;
+    }
+    if (static_cast<size_t>(end - ptr) < value_size) {
+      if (depth == 0) *size = static_cast<size_t>(ptr - begin) + value_size;
+      return ScanResult::kIncomplete;
+    }
+    ptr += value_size;
+  } while (depth > 0);
+  *size = static_cast<size_t>(ptr - begin);
+  return ScanResult::kComplete;
+}
+
+}  // namespace
+
+size_t StreamingParser::Consume(absl::string_view data) {
+  const char* ptr = data.data();
+  const char* end = ptr + data.size();
+  pending_size_ = 0;
+  while (ptr < end) {
+    size_t size;
+    const ScanResult result = ScanField(ptr, end, &size);
+    if (result == ScanResult::kMalformed) return kUnknownSize;
+    if (result == ScanResult::kIncomplete) {
+      pending_size_ = size;
+      break;
+    }
+    ptr += size;
+  }
+  const size_t consumed = static_cast<size_t>(ptr - data.data());
+  // Parsing the serialized fields separately merges them just like parsing
+  // them together would.
+  if (consumed > 0 && !message_->ParseFrom<MessageLite::kMergePartial>(
+                          data.substr(0, consumed))) {
+    return kUnknownSize;
+  }
+  return consumed;
+}
+
+StreamingParser::Status StreamingParser::Feed(absl::string_view chunk) {
+  if (status_ != kNeedMoreData) return chunk.empty() ? status_ : Fail();
+  if (remaining_ != kUnknownSize) {
+    if (chunk.size() > remaining_) return Fail();
+    remaining_ -= chunk.size();
+  }
+
+  // Complete the buffered field first, copying no more of `chunk` than it
+  // needs.
+  while (!buffer_.empty() && !chunk.empty()) {
+    size_t take;
+    if (pending_size_ > 0) {
+      take = std::min(pending_size_ - buffer_.size(), chunk.size());
+    } else if (buffer_.size() < kMaxFieldHeaderSize) {
+      take = std::min(kMaxFieldHeaderSize - buffer_.size(), chunk.size());
+    } else {
+      // A group, whose size is only known once its end is found.
+      take = chunk.size();
+    }
+    buffer_.append(chunk.data(), take);
+    chunk.remove_prefix(take);
+    if (buffer_.size() < pending_size_) break;
+
+    const size_t consumed = Consume(buffer_);
+    if (consumed == kUnknownSize) return Fail();
+    buffer_.erase(0, consumed);
+  }
+
+  if (!chunk.empty()) {
+    const size_t consumed = Consume(chunk);
+    if (consumed == kUnknownSize) return Fail();
+    buffer_.assign(chunk.data() + consumed, chunk.size() - consumed);
+  }
+
+  if (remaining_ == 0) return Complete();
+  return status_;
+}
+
+StreamingParser::Status StreamingParser::Finish() {
+  if (status_ != kNeedMoreData) return status_;
+  if (remaining_ != kUnknownSize && remaining_ != 0) return Fail();
+  return Complete();
+}
+
+StreamingParser::Status StreamingParser::Complete() {
+  if (!buffer_.empty()) return Fail();
+  if (!partial_ && !message_->IsInitialized()) return Fail();
+  return status_ = kDone;
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
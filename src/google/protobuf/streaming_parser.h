@@ -0,0 +1,105 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines StreamingParser, which parses a message from chunks of
+// input as they arrive.
+
+#ifndef GOOGLE_PROTOBUF_STREAMING_PARSER_H__
+#define GOOGLE_PROTOBUF_STREAMING_PARSER_H__
+
+#include <cstddef>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/message_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+// A StreamingParser merges a serialized message into `message` from chunks
+// of input pushed with Feed(), so that event-driven callers never have to
+// block for more data or buffer the whole payload:
+//
+//   StreamingParser parser(&message);
+//   for (absl::string_view chunk : chunks) {
+//     if (parser.Feed(chunk) == StreamingParser::kError) { ... }
+//   }
+//   if (parser.Finish() != StreamingParser::kDone) { ... }
+//
+// Every top-level field is parsed as soon as its last byte arrives; only the
+// bytes of the top-level field that is still incomplete are copied and kept
+// between calls. Memory use is thus bounded by the largest top-level field,
+// e.g. one element of a large repeated field, rather than by the message.
+//
+// A StreamingParser is not thread-safe, and `message` must not be accessed
+// until parsing has finished.
+class PROTOBUF_EXPORT StreamingParser {
+ public:
+  enum Status {
+    // All input so far was consumed; more is expected.
+    kNeedMoreData,
+    // The message is complete and was parsed successfully.
+    kDone,
+    // The input is malformed. Further calls keep returning kError.
+    kError,
+  };
+
+  static constexpr size_t kUnknownSize = static_cast<size_t>(-1);
+
+  // Parses into `message`, which is not cleared first. If `size` is not
+  // kUnknownSize, the message is exactly `size` bytes long, e.g. from a
+  // length prefix, and Feed() returns kDone once they have all been fed.
+  // Otherwise the end of the message is signaled with Finish().
+  explicit StreamingParser(MessageLite* message, size_t size = kUnknownSize)
+      : message_(message), remaining_(size) {}
+
+  StreamingParser(const StreamingParser&) = delete;
+  StreamingParser& operator=(const StreamingParser&) = delete;
+
+  // Parses as much of `chunk` as possible. `chunk` does not need to outlive
+  // the call. Returns kError for any input after kDone.
+  Status Feed(absl::string_view chunk);
+
+  // Signals the end of the input. Returns kDone if it ended on a field
+  // boundary (after exactly `size` bytes, if given) and the message has all
+  // of its required fields, unless parsing partially.
+  Status Finish();
+
+  // If true, missing required fields are not an error. Defaults to false.
+  void set_partial(bool partial) { partial_ = partial; }
+
+  Status status() const { return status_; }
+
+ private:
+  // Parses the complete fields at the start of `data` and returns how many
+  // bytes they span, or kUnknownSize if the input is malformed. Sets
+  // `pending_size_` to the size of the incomplete field after them, if known.
+  size_t Consume(absl::string_view data);
+  Status Fail() { return status_ = kError; }
+  Status Complete();
+
+  MessageLite* message_;
+  // Bytes of the message that have not been fed yet, or kUnknownSize.
+  size_t remaining_;
+  // The start of the incomplete field, if any.
+  std::string buffer_;
+  // The size of the incomplete field, or 0 if its header is incomplete too or
+  // it is a group.
+  size_t pending_size_ = 0;
+  bool partial_ = false;
+  Status status_ = kNeedMoreData;
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_STREAMING_PARSER_H__
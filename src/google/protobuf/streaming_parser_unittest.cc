@@ -0,0 +1,137 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/streaming_parser.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestRequired;
+
+// Feeds `data` in chunks of `chunk_size` bytes.
+StreamingParser::Status FeedInChunks(StreamingParser& parser,
+                                     absl::string_view data,
+                                     size_t chunk_size) {
+  StreamingParser::Status status = StreamingParser::kNeedMoreData;
+  while (!data.empty() && status == StreamingParser::kNeedMoreData) {
+    const size_t size = std::min(chunk_size, data.size());
+    status = parser.Feed(data.substr(0, size));
+    data.remove_prefix(size);
+  }
+  return status;
+}
+
+TEST(StreamingParserTest, ParsesInChunksOfAnySize) {
+  TestAllTypes source;
+  TestUtil::SetAllFields(&source);
+  source.add_repeated_string(std::string(5000, 'y'));
+  const std::string data = source.SerializeAsString();
+
+  for (size_t chunk_size : {size_t{1}, size_t{2}, size_t{7}, size_t{100},
+                            data.size()}) {
+    SCOPED_TRACE(chunk_size);
+    TestAllTypes message;
+    StreamingParser parser(&message);
+    EXPECT_EQ(FeedInChunks(parser, data, chunk_size),
+              StreamingParser::kNeedMoreData);
+    EXPECT_EQ(parser.Finish(), StreamingParser::kDone);
+    EXPECT_EQ(message.SerializeAsString(), data);
+  }
+}
+
+TEST(StreamingParserTest, KnownSizeEndsWithoutFinish) {
+  TestAllTypes source;
+  TestUtil::SetAllFields(&source);
+  const std::string data = source.SerializeAsString();
+
+  TestAllTypes message;
+  StreamingParser parser(&message, data.size());
+  EXPECT_EQ(FeedInChunks(parser, data, 3), StreamingParser::kDone);
+  EXPECT_EQ(parser.Finish(), StreamingParser::kDone);
+  EXPECT_EQ(parser.Feed("\x08\x01"), StreamingParser::kError);
+  TestUtil::ExpectAllFieldsSet(message);
+}
+
+TEST(StreamingParserTest, MergesIntoMessage) {
+  TestAllTypes source;
+  source.set_optional_int32(1);
+  source.add_repeated_int32(2);
+
+  TestAllTypes message;
+  message.set_optional_string("kept");
+  message.add_repeated_int32(1);
+  StreamingParser parser(&message);
+  EXPECT_EQ(parser.Feed(source.SerializeAsString()),
+            StreamingParser::kNeedMoreData);
+  EXPECT_EQ(parser.Finish(), StreamingParser::kDone);
+  EXPECT_EQ(message.optional_string(), "kept");
+  EXPECT_EQ(message.optional_int32(), 1);
+  EXPECT_EQ(message.repeated_int32_size(), 2);
+}
+
+TEST(StreamingParserTest, RejectsTruncatedInput) {
+  TestAllTypes source;
+  source.set_optional_string("hello");
+  const std::string data = source.SerializeAsString();
+
+  TestAllTypes message;
+  StreamingParser parser(&message);
+  EXPECT_EQ(parser.Feed(absl::string_view(data).substr(0, data.size() - 1)),
+            StreamingParser::kNeedMoreData);
+  EXPECT_EQ(parser.Finish(), StreamingParser::kError);
+
+  StreamingParser sized_parser(&message, data.size() + 1);
+  EXPECT_EQ(sized_parser.Feed(data), StreamingParser::kNeedMoreData);
+  EXPECT_EQ(sized_parser.Finish(), StreamingParser::kError);
+}
+
+TEST(StreamingParserTest, RejectsMalformedInput) {
+  TestAllTypes message;
+  StreamingParser parser(&message);
+  // An end group tag outside of any group.
+  EXPECT_EQ(parser.Feed("\x08\x01\x0c"), StreamingParser::kError);
+  EXPECT_EQ(parser.Feed("\x08\x01"), StreamingParser::kError);
+  EXPECT_EQ(parser.Finish(), StreamingParser::kError);
+
+  // A submessage field whose contents do not parse.
+  StreamingParser nested_parser(&message);
+  EXPECT_EQ(nested_parser.Feed("\x92\x01\x02\x08"),
+            StreamingParser::kNeedMoreData);
+  EXPECT_EQ(nested_parser.Feed("\x80"), StreamingParser::kError);
+}
+
+TEST(StreamingParserTest, ChecksRequiredFields) {
+  TestRequired source;
+  source.set_a(1);
+  const std::string data = source.SerializePartialAsString();
+
+  TestRequired message;
+  StreamingParser parser(&message);
+  EXPECT_EQ(parser.Feed(data), StreamingParser::kNeedMoreData);
+  EXPECT_EQ(parser.Finish(), StreamingParser::kError);
+
+  StreamingParser partial_parser(&message);
+  partial_parser.set_partial(true);
+  EXPECT_EQ(partial_parser.Feed(data), StreamingParser::kNeedMoreData);
+  EXPECT_EQ(partial_parser.Finish(), StreamingParser::kDone);
+  EXPECT_EQ(message.a(), 1);
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,55 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/string_intern_table.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+StringInternTable::StringInternTable(size_t max_string_size,
+                                     size_t max_strings)
+    : max_string_size_(max_string_size), max_strings_(max_strings) {}
+
+StringInternTable::~StringInternTable() = default;
+
+const std::string* StringInternTable::Intern(absl::string_view value) {
+  if (value.size() > max_string_size_) return nullptr;
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    auto it = strings_.find(value);
+    if (it != strings_.end()) return it->second.get();
+    if (strings_.size() >= max_strings_) return nullptr;
+  }
+  absl::MutexLock lock(&mutex_);
+  auto it = strings_.find(value);
+  if (it != strings_.end()) return it->second.get();
+  if (strings_.size() >= max_strings_) return nullptr;
+  auto str = std::make_unique<std::string>(value);
+  const std::string* res = str.get();
+  strings_.emplace(*res, std::move(str));
+  return res;
+}
+
+size_t StringInternTable::size() const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return strings_.size();
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
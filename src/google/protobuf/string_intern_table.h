@@ -0,0 +1,89 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines StringInternTable, a dictionary of immutable strings that
+// string fields parsed into an arena can share.
+
+#ifndef GOOGLE_PROTOBUF_STRING_INTERN_TABLE_H__
+#define GOOGLE_PROTOBUF_STRING_INTERN_TABLE_H__
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+// StringInternTable holds one immutable copy of each distinct string added to
+// it. When an arena is created with `ArenaOptions::string_intern_table`,
+// singular string and bytes fields parsed into that arena point to the table's
+// copy of their value instead of allocating a string of their own. Workloads
+// whose messages repeat a bounded set of values (host names, metric names,
+// enum-like strings) then neither allocate nor copy those values per message.
+//
+// Interned values are read through the usual accessors. Any mutation of the
+// field (`mutable_*()`, `set_*()`, `clear_*()`, ...) first gives the field a
+// private copy, so the shared value is never modified.
+//
+// Only values of at most `max_string_size` bytes are interned, and at most
+// `max_strings` values are added; once the table is full, values that are not
+// already in it are parsed as usual. A table is thread-safe and may be shared
+// by any number of arenas. It must outlive every arena that uses it, and every
+// message that was parsed into such an arena.
+//
+// Example:
+//
+//   static StringInternTable* table = new StringInternTable();
+//   ArenaOptions options;
+//   options.string_intern_table = table;
+//   Arena arena(options);
+//   auto* message = Arena::CreateMessage<MyMessage>(&arena);
+//   message->ParseFromString(data);
+class PROTOBUF_EXPORT StringInternTable {
+ public:
+  static constexpr size_t kDefaultMaxStringSize = 128;
+  static constexpr size_t kDefaultMaxStrings = 1 << 16;
+
+  explicit StringInternTable(size_t max_string_size = kDefaultMaxStringSize,
+                             size_t max_strings = kDefaultMaxStrings);
+  StringInternTable(const StringInternTable&) = delete;
+  StringInternTable& operator=(const StringInternTable&) = delete;
+  ~StringInternTable();
+
+  // Returns the table's copy of `value`, adding it if needed. Returns nullptr
+  // if `value` is longer than `max_string_size` or is not in the table and the
+  // table is full. The returned string lives as long as the table.
+  const std::string* Intern(absl::string_view value);
+
+  // Returns the number of strings in the table.
+  size_t size() const;
+
+  size_t max_string_size() const { return max_string_size_; }
+
+ private:
+  const size_t max_string_size_;
+  const size_t max_strings_;
+  mutable absl::Mutex mutex_;
+  // Keys point into the mapped strings.
+  absl::flat_hash_map<absl::string_view, std::unique_ptr<std::string>> strings_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_STRING_INTERN_TABLE_H__
@@ -0,0 +1,133 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/string_intern_table.h"
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/arena.h"
+#include "google/protobuf/unittest.pb.h"
+
+
+namespace google {
+namespace protobuf {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+
+std::string SerializedValues(const std::string& str, const std::string& bytes) {
+  TestAllTypes message;
+  message.set_optional_string(str);
+  message.set_optional_bytes(bytes);
+  message.set_default_string(str);
+  return message.SerializeAsString();
+}
+
+TEST(StringInternTableTest, Intern) {
+  StringInternTable table(/*max_string_size=*/8, /*max_strings=*/2);
+  const std::string* foo = table.Intern("foo");
+  ASSERT_NE(foo, nullptr);
+  EXPECT_EQ(*foo, "foo");
+  EXPECT_EQ(table.Intern(std::string("foo")), foo);
+  EXPECT_EQ(table.Intern("too long value"), nullptr);
+
+  const std::string* bar = table.Intern("bar");
+  ASSERT_NE(bar, nullptr);
+  EXPECT_NE(bar, foo);
+  EXPECT_EQ(table.size(), 2);
+
+  // The table is full: new values are rejected, known ones are still found.
+  EXPECT_EQ(table.Intern("baz"), nullptr);
+  EXPECT_EQ(table.Intern("bar"), bar);
+  EXPECT_EQ(table.size(), 2);
+}
+
+TEST(StringInternTableTest, ParsedFieldsShareValues) {
+  StringInternTable table;
+  ArenaOptions options;
+  options.string_intern_table = &table;
+  Arena arena(options);
+  const std::string long_value(StringInternTable::kDefaultMaxStringSize + 1,
+                               'x');
+  const std::string data = SerializedValues("host-1", long_value);
+
+  auto* first = Arena::CreateMessage<TestAllTypes>(&arena);
+  auto* second = Arena::CreateMessage<TestAllTypes>(&arena);
+  ASSERT_TRUE(first->ParseFromString(data));
+  ASSERT_TRUE(second->ParseFromString(data));
+  EXPECT_EQ(&first->optional_string(), table.Intern("host-1"));
+  EXPECT_EQ(&second->optional_string(), &first->optional_string());
+  EXPECT_EQ(&second->default_string(), &first->optional_string());
+  EXPECT_EQ(first->optional_bytes(), long_value);
+  EXPECT_NE(&second->optional_bytes(), &first->optional_bytes());
+  EXPECT_EQ(first->SerializeAsString(), data);
+
+  TestAllTypes oneof;
+  oneof.set_oneof_string("host-1");
+  auto* parsed = Arena::CreateMessage<TestAllTypes>(&arena);
+  ASSERT_TRUE(parsed->ParseFromString(oneof.SerializeAsString()));
+  EXPECT_EQ(&parsed->oneof_string(), &first->optional_string());
+
+  // Arenas without a table and heap messages are not affected.
+  Arena plain_arena;
+  auto* plain = Arena::CreateMessage<TestAllTypes>(&plain_arena);
+  ASSERT_TRUE(plain->ParseFromString(data));
+  EXPECT_NE(&plain->optional_string(), &first->optional_string());
+  TestAllTypes heap;
+  ASSERT_TRUE(heap.ParseFromString(data));
+  EXPECT_NE(&heap.optional_string(), &first->optional_string());
+  EXPECT_EQ(table.size(), 1);
+}
+
+TEST(StringInternTableTest, MutationsCopyValues) {
+  StringInternTable table;
+  ArenaOptions options;
+  options.string_intern_table = &table;
+  Arena arena(options);
+  const std::string data = SerializedValues("metric", "bytes");
+  const std::string* metric = table.Intern("metric");
+
+  auto* message = Arena::CreateMessage<TestAllTypes>(&arena);
+  ASSERT_TRUE(message->ParseFromString(data));
+  message->mutable_optional_string()->append("-suffix");
+  EXPECT_EQ(message->optional_string(), "metric-suffix");
+  message->set_optional_bytes("other");
+  EXPECT_EQ(message->optional_bytes(), "other");
+  message->clear_default_string();
+  EXPECT_EQ(message->default_string(), "hello");
+
+  ASSERT_TRUE(message->ParseFromString(data));
+  std::string* released = message->release_optional_string();
+  ASSERT_NE(released, nullptr);
+  EXPECT_EQ(*released, "metric");
+  EXPECT_NE(released, metric);
+  delete released;
+  message->Clear();
+  EXPECT_EQ(message->optional_bytes(), "");
+  EXPECT_EQ(message->default_string(), "hello");
+
+  ASSERT_TRUE(message->ParseFromString(data));
+  TestAllTypes copy(*message);
+  copy.mutable_optional_string()->clear();
+  auto* swapped = Arena::CreateMessage<TestAllTypes>(&arena);
+  swapped->Swap(message);
+  swapped->set_optional_string("set");
+  message->CopyFrom(*swapped);
+  message->mutable_default_string()->assign("assigned");
+
+  EXPECT_EQ(*metric, "metric");
+  EXPECT_EQ(*table.Intern("bytes"), "bytes");
+  EXPECT_EQ(message->optional_string(), "set");
+  EXPECT_EQ(message->default_string(), "assigned");
+  EXPECT_EQ(swapped->default_string(), "metric");
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
@@ -19,11 +19,13 @@
 #include <climits>
 #include <cmath>
 #include <limits>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/escaping.h"
@@ -31,6 +33,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/any.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/descriptor.pb.h"
@@ -374,6 +377,7 @@ class TextFormat::Parser::ParserImpl {
   // false if an error occurs (an error will also be logged to
   // ABSL_LOG(ERROR)).
   bool Parse(Message* output) {
+    top_level_message_ = output;
     // Consume fields until we cannot do so anymore.
     while (true) {
       if (LookingAtType(io::Tokenizer::TYPE_END)) {
@@ -403,6 +407,12 @@ class TextFormat::Parser::ParserImpl {
     return suc && LookingAtType(io::Tokenizer::TYPE_END);
   }
 
+  // Has Parse() append each field it sets directly in its output to
+  // `fields`, in the order they appear.
+  void RecordTopLevelFieldsTo(std::vector<const FieldDescriptor*>* fields) {
+    top_level_fields_ = fields;
+  }
+
   void ReportError(int line, int col, absl::string_view message) {
     had_errors_ = true;
     if (error_collector_ == nullptr) {
@@ -530,6 +540,8 @@ class TextFormat::Parser::ParserImpl {
           return false;
         }
       }
+      RecordTopLevelField(message, any_type_url_field);
+      RecordTopLevelField(message, any_value_field);
       reflection->SetString(message, any_type_url_field,
                             std::move(prefix_and_full_type_name));
       reflection->SetString(message, any_value_field,
@@ -641,6 +653,8 @@ class TextFormat::Parser::ParserImpl {
       return SkipFieldMessage();
     }
 
+    RecordTopLevelField(message, field);
+
     if (field->options().deprecated()) {
       ReportWarning(absl::StrCat("text format contains deprecated field \"",
                                  field_name, "\""));
@@ -836,7 +850,7 @@ class TextFormat::Parser::ParserImpl {
 // not the default, setting it to the default should not be treated as a no-op.
 #define SET_FIELD(CPPTYPE, CPPTYPELCASE, VALUE)                   \
   if (field->is_repeated()) {                                     \
-    reflection->Add##CPPTYPE(message, field, VALUE);              \
+    reflection->Add##CPPTYPE(message, field, std::move(VALUE));   \
   } else {                                                        \
     if (error_on_no_op_fields_ && !field->has_presence() &&       \
         field->default_value_##CPPTYPELCASE() ==                  \
@@ -1060,8 +1074,16 @@ class TextFormat::Parser::ParserImpl {
     return true;
   }
 
+  // See RecordTopLevelFieldsTo().
+  void RecordTopLevelField(const Message* message,
+                           const FieldDescriptor* field) {
+    if (top_level_fields_ != nullptr && message == top_level_message_) {
+      top_level_fields_->push_back(field);
+    }
+  }
+
   // Returns true if the current token's text is equal to that specified.
-  bool LookingAt(const std::string& text) {
+  bool LookingAt(absl::string_view text) {
     return tokenizer_.current().text == text;
   }
 
@@ -1330,7 +1352,7 @@ class TextFormat::Parser::ParserImpl {
   // Consumes a token and confirms that it matches that specified in the
   // value parameter. Returns false if the token found does not match that
   // which was specified.
-  bool Consume(const std::string& value) {
+  bool Consume(absl::string_view value) {
     const std::string& current_value = tokenizer_.current().text;
 
     if (current_value != value) {
@@ -1346,7 +1368,7 @@ class TextFormat::Parser::ParserImpl {
 
   // Similar to `Consume`, but the following token may be tokenized as
   // TYPE_WHITESPACE.
-  bool ConsumeBeforeWhitespace(const std::string& value) {
+  bool ConsumeBeforeWhitespace(absl::string_view value) {
     // Report whitespace after this token, but only once.
     tokenizer_.set_report_whitespace(true);
     bool result = Consume(value);
@@ -1356,7 +1378,7 @@ class TextFormat::Parser::ParserImpl {
 
   // Attempts to consume the supplied value. Returns false if a the
   // token found does not match the value specified.
-  bool TryConsume(const std::string& value) {
+  bool TryConsume(absl::string_view value) {
     if (tokenizer_.current().text == value) {
       tokenizer_.Next();
       return true;
@@ -1367,7 +1389,7 @@ class TextFormat::Parser::ParserImpl {
 
   // Similar to `TryConsume`, but the following token may be tokenized as
   // TYPE_WHITESPACE.
-  bool TryConsumeBeforeWhitespace(const std::string& value) {
+  bool TryConsumeBeforeWhitespace(absl::string_view value) {
     // Report whitespace after this token, but only once.
     tokenizer_.set_report_whitespace(true);
     bool result = TryConsume(value);
@@ -1378,8 +1400,9 @@ class TextFormat::Parser::ParserImpl {
   bool TryConsumeWhitespace() {
     had_silent_marker_ = false;
     if (LookingAtType(io::Tokenizer::TYPE_WHITESPACE)) {
-      if (tokenizer_.current().text ==
-          absl::StrCat(" ", internal::kDebugStringSilentMarkerForDetection)) {
+      absl::string_view text = tokenizer_.current().text;
+      if (!text.empty() && text[0] == ' ' &&
+          text.substr(1) == internal::kDebugStringSilentMarkerForDetection) {
         had_silent_marker_ = true;
       }
       tokenizer_.Next();
@@ -1430,7 +1453,8 @@ class TextFormat::Parser::ParserImpl {
   bool had_silent_marker_;
   bool had_errors_;
   bool error_on_no_op_fields_;
-
+  const Message* top_level_message_ = nullptr;
+  std::vector<const FieldDescriptor*>* top_level_fields_ = nullptr;
 };
 
 // ===========================================================================
@@ -1654,6 +1678,161 @@ class TextFormat::Printer::FastFieldValuePrinterUtf8Escaping
   }
 };
 
+// ===========================================================================
+// Internal class that prints a message like Print(message, generator) does
+// with the builtin field value printers, but without a virtual call per
+// field value.  Text is appended to a single growing buffer that is copied
+// into the output stream in large chunks, and names of extensions are only
+// computed once.  It is a BaseTextGenerator itself, so that the rare cases
+// (unknown fields, expanded Any, redacted fields, messages without
+// reflection) go through the regular Printer methods and produce the same
+// output.
+class TextFormat::Printer::FastPrinter : public TextFormat::BaseTextGenerator {
+ public:
+  FastPrinter(const Printer& printer, io::ZeroCopyOutputStream* output)
+      : printer_(printer),
+        output_(output),
+        output_buffer_(nullptr),
+        output_buffer_size_(0),
+        at_start_of_line_(true),
+        failed_(false),
+        insert_silent_marker_(printer.insert_silent_marker_),
+        indent_level_(printer.initial_indent_level_),
+        initial_indent_level_(printer.initial_indent_level_) {}
+
+  FastPrinter(const FastPrinter&) = delete;
+  FastPrinter& operator=(const FastPrinter&) = delete;
+  ~FastPrinter() override {
+    // Only BackUp() if we're sure we've successfully called Next() at least
+    // once.
+    if (!failed_) {
+      output_->BackUp(output_buffer_size_);
+    }
+  }
+
+  // Prints the message and copies what is left in the buffer to the output
+  // stream.  Returns false if writing to the stream failed.
+  bool Print(const Message& message);
+
+  void Indent() override { ++indent_level_; }
+
+  void Outdent() override {
+    if (indent_level_ == 0 || indent_level_ < initial_indent_level_) {
+      ABSL_DLOG(FATAL) << " Outdent() without matching Indent().";
+      return;
+    }
+
+    --indent_level_;
+  }
+
+  size_t GetCurrentIndentationSize() const override {
+    return 2 * indent_level_;
+  }
+
+  // Same as TextGenerator::Print().
+  void Print(const char* text, size_t size) override {
+    if (indent_level_ > 0) {
+      size_t pos = 0;
+      for (size_t i = 0; i < size; i++) {
+        if (text[i] == '\n') {
+          Write(text + pos, i - pos + 1);
+          pos = i + 1;
+          at_start_of_line_ = true;
+        }
+      }
+      Write(text + pos, size - pos);
+    } else {
+      Write(text, size);
+      if (size > 0 && text[size - 1] == '\n') {
+        at_start_of_line_ = true;
+      }
+    }
+  }
+
+  void PrintMaybeWithMarker(MarkerToken, absl::string_view text) override {
+    PrintString(text);
+    MaybeWriteSilentMarker();
+  }
+
+  void PrintMaybeWithMarker(MarkerToken, absl::string_view text_head,
+                            absl::string_view text_tail) override {
+    PrintString(text_head);
+    MaybeWriteSilentMarker();
+    PrintString(text_tail);
+  }
+
+ private:
+  // Chunk size at which the buffer is copied to the output stream.
+  static constexpr size_t kFlushThreshold = 64 << 10;
+
+  void PrintMessage(const Message& message);
+  void PrintField(const Message& message, const Reflection* reflection,
+                  const FieldDescriptor* field);
+  void PrintShortRepeatedField(const Message& message,
+                               const Reflection* reflection,
+                               const FieldDescriptor* field);
+  void PrintFieldValue(const Message& message, const Reflection* reflection,
+                       const FieldDescriptor* field, int index);
+  absl::string_view FieldName(const FieldDescriptor* field);
+  void Flush();
+
+  // Appends text that does not contain a newline, indenting it if it starts
+  // a line.
+  void Write(const char* data, size_t size) {
+    if (size == 0) return;
+    if (at_start_of_line_) {
+      at_start_of_line_ = false;
+      buffer_.append(2 * indent_level_, ' ');
+    }
+    buffer_.append(data, size);
+  }
+  void Write(absl::string_view text) { Write(text.data(), text.size()); }
+
+  // Appends text that ends with its only newline.
+  void WriteLine(absl::string_view text) {
+    Write(text);
+    at_start_of_line_ = true;
+  }
+
+  template <typename T>
+  void WriteInt(T value) {
+    char digits[absl::numbers_internal::kFastToBufferSize];
+    char* end = absl::numbers_internal::FastIntToBuffer(value, digits);
+    Write(digits, end - digits);
+  }
+
+  // Ends the line of a field, or separates it from the next one in single
+  // line mode.
+  void EndField() {
+    if (printer_.single_line_mode_) {
+      Write(" ", 1);
+    } else {
+      WriteLine("\n");
+    }
+    if (buffer_.size() >= kFlushThreshold) Flush();
+  }
+
+  void MaybeWriteSilentMarker() {
+    if (insert_silent_marker_) {
+      insert_silent_marker_ = false;
+      PrintLiteral(internal::kDebugStringSilentMarker);
+    }
+  }
+
+  const Printer& printer_;
+  io::ZeroCopyOutputStream* const output_;
+  char* output_buffer_;
+  int output_buffer_size_;
+  std::string buffer_;
+  bool at_start_of_line_;
+  bool failed_;
+  bool insert_silent_marker_;
+  int indent_level_;
+  int initial_indent_level_;
+  // Names of extensions, or all field numbers when use_field_number_ is set.
+  absl::flat_hash_map<const FieldDescriptor*, std::string> field_names_;
+};
+
 // ===========================================================================
 // Implementation of the default Finder for extensions.
 TextFormat::Finder::~Finder() {}
@@ -1712,8 +1891,261 @@ bool CheckParseInputSize(T& input, io::ErrorCollector* error_collector) {
   return true;
 }
 
+// Pieces of input parsed in parallel are at least this large.
+constexpr size_t kMinParallelChunkSize = 256 << 10;
+
+// A piece of text format input, starting at the beginning of line `line`.
+struct TextChunk {
+  absl::string_view text;
+  int line;
+};
+
+// Splits `input` into up to `max_chunks` pieces of similar size that can be
+// parsed on their own.  Pieces start only at the beginning of a line where
+// a top-level field follows the value of a top-level message field, which is
+// found with a scan that skips strings and comments.  Returns a single piece
+// if there is no such place.
+std::vector<TextChunk> SplitAtTopLevelFields(absl::string_view input,
+                                             int max_chunks) {
+  const size_t target_size = std::max(
+      input.size() / static_cast<size_t>(max_chunks), kMinParallelChunkSize);
+  std::vector<TextChunk> chunks;
+  size_t chunk_start = 0;
+  int chunk_line = 0;
+
+  int depth = 0;
+  int line = 0;
+  size_t line_start = 0;
+  // Whether the current line holds only whitespace so far.
+  bool blank_line = true;
+  // Whether the last token at depth 0 closed a message value.
+  bool after_message = false;
+  for (size_t i = 0; i < input.size(); ++i) {
+    const char c = input[i];
+    switch (c) {
+      case '\n':
+        ++line;
+        line_start = i + 1;
+        blank_line = true;
+        continue;
+      case ' ':
+      case '\t':
+      case '\r':
+      case '\v':
+      case '\f':
+        continue;
+      case '#':
+        i = std::min(input.find('\n', i), input.size()) - 1;
+        continue;
+    }
+
+    if (depth == 0 && after_message && blank_line &&
+        (absl::ascii_isalnum(c) || c == '_' || c == '[') &&
+        line_start - chunk_start >= target_size &&
+        chunks.size() + 1 < static_cast<size_t>(max_chunks)) {
+      chunks.push_back(
+          {input.substr(chunk_start, line_start - chunk_start), chunk_line});
+      chunk_start = line_start;
+      chunk_line = line;
+    }
+    blank_line = false;
+
+    switch (c) {
+      case '{':
+      case '<':
+      case '[':
+        ++depth;
+        after_message = false;
+        break;
+      case '}':
+      case '>':
+      case ']':
+        if (--depth < 0) return {{input, 0}};
+        after_message = depth == 0 && c != ']';
+        break;
+      case '"':
+      case '\'':
+        for (++i; i < input.size() && input[i] != c; ++i) {
+          if (input[i] == '\\' && i + 1 < input.size()) ++i;
+          if (input[i] == '\n') {
+            ++line;
+            line_start = i + 1;
+          }
+        }
+        after_message = false;
+        break;
+      case ';':
+      case ',':
+        // Optional separators between fields.
+        break;
+      default:
+        after_message = false;
+        break;
+    }
+  }
+  chunks.push_back({input.substr(chunk_start), chunk_line});
+  return chunks;
+}
+
+// Keeps the warnings of a piece parsed in parallel, and whether it failed.
+class ChunkErrorCollector : public io::ErrorCollector {
+ public:
+  struct Warning {
+    int line;
+    int column;
+    std::string message;
+  };
+
+  void RecordError(int, int, absl::string_view) override { failed_ = true; }
+  void RecordWarning(int line, int column,
+                     absl::string_view message) override {
+    warnings_.push_back({line, column, std::string(message)});
+  }
+
+  bool failed() const { return failed_; }
+  const std::vector<Warning>& warnings() const { return warnings_; }
+
+ private:
+  bool failed_ = false;
+  std::vector<Warning> warnings_;
+};
+
 }  // namespace
 
+bool TextFormat::Parser::MergeInParallel(absl::string_view input,
+                                         Message* output,
+                                         bool forbid_overwrites) {
+  auto parse_serially = [&] {
+    io::ArrayInputStream input_stream(input.data(), input.size());
+    return forbid_overwrites ? Parse(&input_stream, output)
+                             : Merge(&input_stream, output);
+  };
+  if (max_chunks_ < 2 || parse_info_tree_ != nullptr ||
+      error_on_no_op_fields_ || input.size() < 2 * kMinParallelChunkSize) {
+    return parse_serially();
+  }
+  const std::vector<TextChunk> chunks =
+      SplitAtTopLevelFields(input, max_chunks_);
+  if (chunks.size() < 2) return parse_serially();
+
+  const ParserImpl::SingularOverwritePolicy overwrites_policy =
+      forbid_overwrites ? ParserImpl::FORBID_SINGULAR_OVERWRITES
+                        : ParserImpl::ALLOW_SINGULAR_OVERWRITES;
+  struct Piece {
+    std::unique_ptr<Message> message;
+    std::vector<const FieldDescriptor*> fields;
+    ChunkErrorCollector errors;
+  };
+  std::vector<Piece> pieces(chunks.size());
+  absl::Mutex mutex;
+  int running = 0;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    Piece& piece = pieces[i];
+    piece.message.reset(output->New());
+    {
+      absl::MutexLock lock(&mutex);
+      ++running;
+    }
+    executor_([this, &mutex, &running, &piece, &chunk = chunks[i],
+               overwrites_policy] {
+      io::ArrayInputStream input_stream(chunk.text.data(),
+                                        static_cast<int>(chunk.text.size()));
+      ParserImpl parser(piece.message->GetDescriptor(), &input_stream,
+                        &piece.errors, finder_, nullptr, overwrites_policy,
+                        allow_case_insensitive_field_, allow_unknown_field_,
+                        allow_unknown_extension_, allow_unknown_enum_,
+                        allow_field_number_, allow_relaxed_whitespace_,
+                        allow_partial_, recursion_limit_,
+                        error_on_no_op_fields_);
+      parser.RecordTopLevelFieldsTo(&piece.fields);
+      parser.Parse(piece.message.get());
+      absl::MutexLock lock(&mutex);
+      --running;
+    });
+  }
+  {
+    absl::MutexLock lock(&mutex);
+    mutex.Await(absl::Condition(
+        +[](int* running) { return *running == 0; }, &running));
+  }
+
+  // Pieces that failed, or that would have failed together, are parsed again
+  // as a whole to report errors where a serial parse reports them.
+  absl::flat_hash_set<const FieldDescriptor*> earlier_fields;
+  absl::flat_hash_set<const OneofDescriptor*> earlier_oneofs;
+  for (const Piece& piece : pieces) {
+    if (piece.errors.failed()) return parse_serially();
+    if (!forbid_overwrites) continue;
+    for (const FieldDescriptor* field : piece.fields) {
+      if (field->is_repeated()) continue;
+      const OneofDescriptor* oneof = field->containing_oneof();
+      if (earlier_fields.contains(field) ||
+          (oneof != nullptr && earlier_oneofs.contains(oneof))) {
+        return parse_serially();
+      }
+    }
+    for (const FieldDescriptor* field : piece.fields) {
+      if (field->is_repeated()) continue;
+      earlier_fields.insert(field);
+      if (field->containing_oneof() != nullptr) {
+        earlier_oneofs.insert(field->containing_oneof());
+      }
+    }
+  }
+
+  // Reports warnings and merges the pieces in order.
+  io::ArrayInputStream no_input(nullptr, 0);
+  ParserImpl reporter(output->GetDescriptor(), &no_input, error_collector_,
+                      finder_, nullptr, overwrites_policy,
+                      allow_case_insensitive_field_, allow_unknown_field_,
+                      allow_unknown_extension_, allow_unknown_enum_,
+                      allow_field_number_, allow_relaxed_whitespace_,
+                      allow_partial_, recursion_limit_, error_on_no_op_fields_);
+  const Reflection* reflection = output->GetReflection();
+  for (size_t i = 0; i < pieces.size(); ++i) {
+    Piece& piece = pieces[i];
+    for (const ChunkErrorCollector::Warning& warning :
+         piece.errors.warnings()) {
+      reporter.ReportWarning(
+          warning.line < 0 ? warning.line : warning.line + chunks[i].line,
+          warning.column, warning.message);
+    }
+    for (const FieldDescriptor* field : piece.fields) {
+      if (field->is_repeated()) {
+        if (field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE ||
+            field->is_map() ||
+            reflection->FieldSize(*piece.message, field) == 0) {
+          continue;
+        }
+        // Moves the messages rather than copying them in MergeFrom() below.
+        std::vector<Message*> messages;
+        while (reflection->FieldSize(*piece.message, field) > 0) {
+          messages.push_back(
+              reflection->ReleaseLast(piece.message.get(), field));
+        }
+        for (auto it = messages.rbegin(); it != messages.rend(); ++it) {
+          reflection->AddAllocatedMessage(output, field, *it);
+        }
+      } else if (field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) {
+        // The piece's value replaces the current one, even if it is a
+        // default that MergeFrom() would not copy.
+        reflection->ClearField(output, field);
+      }
+    }
+    output->MergeFrom(*piece.message);
+  }
+
+  if (!allow_partial_ && !output->IsInitialized()) {
+    std::vector<std::string> missing_fields;
+    output->FindInitializationErrors(&missing_fields);
+    reporter.ReportError(-1, 0,
+                         absl::StrCat("Message missing required fields: ",
+                                      absl::StrJoin(missing_fields, ", ")));
+    return false;
+  }
+  return true;
+}
+
 bool TextFormat::Parser::Parse(io::ZeroCopyInputStream* input,
                                Message* output) {
   output->Clear();
@@ -1734,6 +2166,10 @@ bool TextFormat::Parser::Parse(io::ZeroCopyInputStream* input,
 bool TextFormat::Parser::ParseFromString(absl::string_view input,
                                          Message* output) {
   DO(CheckParseInputSize(input, error_collector_));
+  if (executor_) {
+    output->Clear();
+    return MergeInParallel(input, output, !allow_singular_overwrites_);
+  }
   io::ArrayInputStream input_stream(input.data(), input.size());
   return Parse(&input_stream, output);
 }
@@ -1759,6 +2195,7 @@ bool TextFormat::Parser::Merge(io::ZeroCopyInputStream* input,
 bool TextFormat::Parser::MergeFromString(absl::string_view input,
                                          Message* output) {
   DO(CheckParseInputSize(input, error_collector_));
+  if (executor_) return MergeInParallel(input, output, false);
   io::ArrayInputStream input_stream(input.data(), input.size());
   return Merge(&input_stream, output);
 }
@@ -2097,6 +2534,8 @@ TextFormat::Printer::Printer()
       print_message_fields_in_index_order_(false),
       expand_any_(false),
       truncate_string_field_longer_than_(0LL),
+      builtin_field_value_printer_(false),
+      utf8_string_escaping_(false),
       finder_(nullptr) {
   SetUseUtf8StringEscaping(false);
 }
@@ -2104,16 +2543,20 @@ TextFormat::Printer::Printer()
 void TextFormat::Printer::SetUseUtf8StringEscaping(bool as_utf8) {
   SetDefaultFieldValuePrinter(as_utf8 ? new FastFieldValuePrinterUtf8Escaping()
                                       : new DebugStringFieldValuePrinter());
+  builtin_field_value_printer_ = true;
+  utf8_string_escaping_ = as_utf8;
 }
 
 void TextFormat::Printer::SetDefaultFieldValuePrinter(
     const FieldValuePrinter* printer) {
   default_field_value_printer_.reset(new FieldValuePrinterWrapper(printer));
+  builtin_field_value_printer_ = false;
 }
 
 void TextFormat::Printer::SetDefaultFieldValuePrinter(
     const FastFieldValuePrinter* printer) {
   default_field_value_printer_.reset(printer);
+  builtin_field_value_printer_ = false;
 }
 
 bool TextFormat::Printer::RegisterFieldValuePrinter(
@@ -2189,6 +2632,11 @@ bool TextFormat::Printer::Print(const Message& message,
 bool TextFormat::Printer::Print(const Message& message,
                                 io::ZeroCopyOutputStream* output,
                                 internal::FieldReporterLevel reporter) const {
+  if (CanPrintFast()) {
+    FastPrinter printer(*this, output);
+    return printer.Print(message);
+  }
+
   TextGenerator generator(output, insert_silent_marker_, initial_indent_level_);
 
 
@@ -2721,6 +3169,287 @@ void TextFormat::Printer::PrintFieldValue(const Message& message,
   }
 }
 
+bool TextFormat::Printer::FastPrinter::Print(const Message& message) {
+  if (message.GetReflection() == nullptr) {
+    printer_.Print(message, this);
+  } else {
+    PrintMessage(message);
+  }
+  Flush();
+  return !failed_;
+}
+
+void TextFormat::Printer::FastPrinter::PrintMessage(const Message& message) {
+  const Descriptor* descriptor = message.GetDescriptor();
+  if (printer_.expand_any_ &&
+      descriptor->full_name() == internal::kAnyFullTypeName &&
+      printer_.PrintAny(message, this)) {
+    return;
+  }
+  const Reflection* reflection = message.GetReflection();
+  std::vector<const FieldDescriptor*> fields;
+  if (descriptor->options().map_entry()) {
+    fields.push_back(descriptor->field(0));
+    fields.push_back(descriptor->field(1));
+  } else {
+    reflection->ListFields(message, &fields);
+  }
+
+  if (printer_.print_message_fields_in_index_order_) {
+    std::sort(fields.begin(), fields.end(), FieldIndexSorter());
+  }
+  for (const FieldDescriptor* field : fields) {
+    PrintField(message, reflection, field);
+  }
+  if (!printer_.hide_unknown_fields_) {
+    const UnknownFieldSet& unknown_fields =
+        reflection->GetUnknownFields(message);
+    if (!unknown_fields.empty()) {
+      printer_.PrintUnknownFields(unknown_fields, this,
+                                  kUnknownFieldRecursionLimit);
+    }
+  }
+}
+
+absl::string_view TextFormat::Printer::FastPrinter::FieldName(
+    const FieldDescriptor* field) {
+  if (!printer_.use_field_number_ && !field->is_extension()) {
+    // Groups must be serialized with their original capitalization.
+    return field->type() == FieldDescriptor::TYPE_GROUP
+               ? field->message_type()->name()
+               : field->name();
+  }
+  auto it = field_names_.find(field);
+  if (it == field_names_.end()) {
+    it = field_names_
+             .emplace(field,
+                      printer_.use_field_number_
+                          ? absl::StrCat(field->number())
+                          : absl::StrCat("[",
+                                         field->PrintableNameForExtension(),
+                                         "]"))
+             .first;
+  }
+  return it->second;
+}
+
+void TextFormat::Printer::FastPrinter::PrintField(
+    const Message& message, const Reflection* reflection,
+    const FieldDescriptor* field) {
+  if (printer_.redact_debug_string_ && internal::ShouldRedactField(field)) {
+    printer_.PrintField(message, reflection, field, this);
+    return;
+  }
+  if (printer_.use_short_repeated_primitives_ && field->is_repeated() &&
+      field->cpp_type() != FieldDescriptor::CPPTYPE_STRING &&
+      field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) {
+    PrintShortRepeatedField(message, reflection, field);
+    return;
+  }
+
+  int count = 0;
+  if (field->is_repeated()) {
+    count = reflection->FieldSize(message, field);
+  } else if (reflection->HasField(message, field) ||
+             field->containing_type()->options().map_entry()) {
+    count = 1;
+  }
+
+  std::vector<const Message*> sorted_map_field;
+  bool need_release = false;
+  bool is_map = field->is_map();
+  if (is_map) {
+    need_release = internal::MapFieldPrinterHelper::SortMap(
+        message, reflection, field, &sorted_map_field);
+  }
+
+  const absl::string_view name = FieldName(field);
+  const bool single_line_mode = printer_.single_line_mode_;
+  for (int j = 0; j < count; ++j) {
+    const int field_index = field->is_repeated() ? j : -1;
+    Write(name);
+
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      const Message& sub_message =
+          field->is_repeated()
+              ? (is_map ? *sorted_map_field[j]
+                        : reflection->GetRepeatedMessage(message, field, j))
+              : reflection->GetMessage(message, field);
+      Write(" ", 1);
+      MaybeWriteSilentMarker();
+      if (single_line_mode) {
+        Write("{ ", 2);
+      } else {
+        WriteLine("{\n");
+      }
+      Indent();
+      if (sub_message.GetReflection() == nullptr) {
+        printer_.Print(sub_message, this);
+      } else {
+        PrintMessage(sub_message);
+      }
+      Outdent();
+      if (single_line_mode) {
+        Write("} ", 2);
+      } else {
+        WriteLine("}\n");
+      }
+      if (buffer_.size() >= kFlushThreshold) Flush();
+    } else {
+      Write(": ", 2);
+      MaybeWriteSilentMarker();
+      PrintFieldValue(message, reflection, field, field_index);
+      EndField();
+    }
+  }
+
+  if (need_release) {
+    for (const Message* message_to_delete : sorted_map_field) {
+      delete message_to_delete;
+    }
+  }
+}
+
+void TextFormat::Printer::FastPrinter::PrintShortRepeatedField(
+    const Message& message, const Reflection* reflection,
+    const FieldDescriptor* field) {
+  int size = reflection->FieldSize(message, field);
+  Write(FieldName(field));
+  Write(": ", 2);
+  MaybeWriteSilentMarker();
+  Write("[", 1);
+  for (int i = 0; i < size; i++) {
+    if (i > 0) Write(", ", 2);
+    PrintFieldValue(message, reflection, field, i);
+  }
+  if (printer_.single_line_mode_) {
+    Write("] ", 2);
+  } else {
+    WriteLine("]\n");
+  }
+}
+
+void TextFormat::Printer::FastPrinter::PrintFieldValue(
+    const Message& message, const Reflection* reflection,
+    const FieldDescriptor* field, int index) {
+  switch (field->cpp_type()) {
+#define OUTPUT_INT(CPPTYPE, METHOD)                                           \
+  case FieldDescriptor::CPPTYPE_##CPPTYPE:                                    \
+    WriteInt(field->is_repeated()                                             \
+                 ? reflection->GetRepeated##METHOD(message, field, index)     \
+                 : reflection->Get##METHOD(message, field));                  \
+    break
+
+    OUTPUT_INT(INT32, Int32);
+    OUTPUT_INT(INT64, Int64);
+    OUTPUT_INT(UINT32, UInt32);
+    OUTPUT_INT(UINT64, UInt64);
+#undef OUTPUT_INT
+
+    case FieldDescriptor::CPPTYPE_FLOAT: {
+      float value = field->is_repeated()
+                        ? reflection->GetRepeatedFloat(message, field, index)
+                        : reflection->GetFloat(message, field);
+      Write(!std::isnan(value) ? io::SimpleFtoa(value) : "nan");
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_DOUBLE: {
+      double value = field->is_repeated()
+                         ? reflection->GetRepeatedDouble(message, field, index)
+                         : reflection->GetDouble(message, field);
+      Write(!std::isnan(value) ? io::SimpleDtoa(value) : "nan");
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_BOOL: {
+      bool value = field->is_repeated()
+                       ? reflection->GetRepeatedBool(message, field, index)
+                       : reflection->GetBool(message, field);
+      if (value) {
+        Write("true", 4);
+      } else {
+        Write("false", 5);
+      }
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_STRING: {
+      std::string scratch;
+      const std::string& value =
+          field->is_repeated()
+              ? reflection->GetRepeatedStringReference(message, field, index,
+                                                       &scratch)
+              : reflection->GetStringReference(message, field, &scratch);
+      absl::string_view value_to_print = value;
+      const int64_t truncate_at = printer_.truncate_string_field_longer_than_;
+      const bool truncated =
+          truncate_at > 0 && static_cast<size_t>(truncate_at) < value.size();
+      if (truncated) {
+        value_to_print = value_to_print.substr(0, truncate_at);
+      }
+      Write("\"", 1);
+      if (printer_.utf8_string_escaping_ &&
+          field->type() == FieldDescriptor::TYPE_STRING) {
+        Write(absl::Utf8SafeCEscape(value_to_print));
+      } else {
+        Write(absl::CEscape(value_to_print));
+      }
+      // The truncation marker needs no escaping.
+      if (truncated) Write("...<truncated>...");
+      Write("\"", 1);
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_ENUM: {
+      int enum_value =
+          field->is_repeated()
+              ? reflection->GetRepeatedEnumValue(message, field, index)
+              : reflection->GetEnumValue(message, field);
+      const EnumValueDescriptor* enum_desc =
+          field->enum_type()->FindValueByNumber(enum_value);
+      if (enum_desc != nullptr) {
+        Write(enum_desc->name());
+      } else {
+        WriteInt(enum_value);
+      }
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      // Messages are printed by PrintField().
+      break;
+  }
+}
+
+void TextFormat::Printer::FastPrinter::Flush() {
+  const char* data = buffer_.data();
+  size_t size = failed_ ? 0 : buffer_.size();
+  while (static_cast<int64_t>(size) > output_buffer_size_) {
+    // Data exceeds space in the output buffer.  Copy what we can and request
+    // a new buffer.
+    if (output_buffer_size_ > 0) {
+      memcpy(output_buffer_, data, output_buffer_size_);
+      data += output_buffer_size_;
+      size -= output_buffer_size_;
+    }
+    void* void_buffer = nullptr;
+    failed_ = !output_->Next(&void_buffer, &output_buffer_size_);
+    if (failed_) {
+      size = 0;
+      break;
+    }
+    output_buffer_ = reinterpret_cast<char*>(void_buffer);
+  }
+
+  if (size > 0) {
+    memcpy(output_buffer_, data, size);
+    output_buffer_ += size;
+    output_buffer_size_ -= size;
+  }
+  buffer_.clear();
+}
+
 /* static */ bool TextFormat::Print(const Message& message,
                                     io::ZeroCopyOutputStream* output) {
   return Printer().Print(message, output);
@@ -16,8 +16,10 @@
 #define GOOGLE_PROTOBUF_TEXT_FORMAT_H__
 
 #include <atomic>
+#include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
@@ -468,6 +470,19 @@ class PROTOBUF_EXPORT TextFormat {
     // strings (see text_format.cc for implementation).
     class FastFieldValuePrinterUtf8Escaping;
 
+    // Forward declaration of an internal class that prints messages straight
+    // into the output stream when no custom printers are registered (see
+    // text_format.cc for implementation).
+    class FastPrinter;
+
+    // True if FastPrinter produces the output of Print(message, generator)
+    // for the current options, which it does unless custom printers were
+    // set or registered.
+    bool CanPrintFast() const {
+      return builtin_field_value_printer_ && custom_printers_.empty() &&
+             custom_message_printers_.empty();
+    }
+
     // Internal Print method, used for writing to the OutputStream via
     // the TextGenerator class.
     void Print(const Message& message, BaseTextGenerator* generator) const;
@@ -533,6 +548,10 @@ class PROTOBUF_EXPORT TextFormat {
     int64_t truncate_string_field_longer_than_;
 
     std::unique_ptr<const FastFieldValuePrinter> default_field_value_printer_;
+    // Whether default_field_value_printer_ was set by
+    // SetUseUtf8StringEscaping(), and to which of the two internal printers.
+    bool builtin_field_value_printer_;
+    bool utf8_string_escaping_;
     absl::flat_hash_map<const FieldDescriptor*,
                         std::unique_ptr<const FastFieldValuePrinter>>
         custom_printers_;
@@ -726,6 +745,26 @@ class PROTOBUF_EXPORT TextFormat {
       error_on_no_op_fields_ = return_error;
     }
 
+    // Lets ParseFromString() and MergeFromString() use several threads on
+    // large inputs.  The input is split at top-level fields into up to
+    // `max_chunks` pieces, which are parsed by tasks passed to `executor`,
+    // typically running them on a thread pool, and then merged into the
+    // output in order.  The result is the same as parsing on one thread: if
+    // a piece fails to parse, or the pieces set the same non-repeated field
+    // while singular overwrites are forbidden, the whole input is parsed
+    // again on the calling thread, which reports errors as usual.
+    //
+    // All tasks are waited for before parsing returns, so the executor must
+    // not run them on the calling thread after it blocks.  The Finder, if
+    // any, is called concurrently.  Input is parsed on one thread when
+    // locations are recorded with WriteLocationsTo() or ErrorOnNoOpFields()
+    // is set.
+    void SetExecutor(std::function<void(std::function<void()> task)> executor,
+                     int max_chunks = 8) {
+      executor_ = std::move(executor);
+      max_chunks_ = max_chunks;
+    }
+
    private:
     // Forward declaration of an internal class used to parse text
     // representations (see text_format.cc for implementation).
@@ -736,6 +775,12 @@ class PROTOBUF_EXPORT TextFormat {
     bool MergeUsingImpl(io::ZeroCopyInputStream* input, Message* output,
                         ParserImpl* parser_impl);
 
+    // Like MergeFromString(), or ParseFromString() into a cleared `output`
+    // if `forbid_overwrites`, but parses pieces of `input` concurrently.  See
+    // SetExecutor().
+    bool MergeInParallel(absl::string_view input, Message* output,
+                         bool forbid_overwrites);
+
     io::ErrorCollector* error_collector_;
     const Finder* finder_;
     ParseInfoTree* parse_info_tree_;
@@ -749,6 +794,8 @@ class PROTOBUF_EXPORT TextFormat {
     bool allow_singular_overwrites_;
     int recursion_limit_;
     bool error_on_no_op_fields_ = false;
+    std::function<void(std::function<void()> task)> executor_;
+    int max_chunks_ = 8;
   };
 
 
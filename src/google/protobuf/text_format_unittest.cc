@@ -15,9 +15,13 @@
 #include <stdlib.h>
 
 #include <atomic>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "google/protobuf/testing/file.h"
 #include "google/protobuf/testing/file.h"
@@ -25,6 +29,7 @@
 #include <gmock/gmock.h>
 #include "google/protobuf/testing/googletest.h"
 #include <gtest/gtest.h>
+#include "absl/algorithm/container.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/die_if_null.h"
 #include "absl/log/scoped_mock_log.h"
@@ -936,6 +941,89 @@ TEST_F(TextFormatTest, CustomMessagePrinter) {
   EXPECT_EQ("optional_nested_message {\n  // custom\n  bb: 1\n}\n", text);
 }
 
+// Printers without custom field value printers take a faster path, which must
+// produce the same output as the one taken once a printer is registered.
+void ExpectSameOutputWithCustomPrinter(
+    const Message& message,
+    const std::function<void(TextFormat::Printer*)>& configure) {
+  TextFormat::Printer fast_printer;
+  TextFormat::Printer printer;
+  configure(&fast_printer);
+  configure(&printer);
+  // Prints like the default printer, so only the path taken differs.
+  ASSERT_TRUE(printer.RegisterFieldValuePrinter(
+      unittest::ForeignMessage::descriptor()->FindFieldByName("c"),
+      new TextFormat::FastFieldValuePrinter));
+
+  std::string fast_text;
+  std::string text;
+  EXPECT_TRUE(fast_printer.PrintToString(message, &fast_text));
+  EXPECT_TRUE(printer.PrintToString(message, &text));
+  EXPECT_EQ(text, fast_text);
+}
+
+TEST_F(TextFormatTest, FastPrinterMatchesCustomizablePrinter) {
+  unittest::TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  message.add_repeated_string(std::string(kEscapeTestString));
+  message.add_repeated_string("\350\260\267\346\255\214");
+  message.add_repeated_bytes("\350\260\267\346\255\214");
+  message.add_repeated_double(std::numeric_limits<double>::quiet_NaN());
+  message.add_repeated_int64(std::numeric_limits<int64_t>::min());
+  message.GetReflection()->MutableUnknownFields(&message)->AddVarint(123, 456);
+  message.GetReflection()
+      ->MutableUnknownFields(&message)
+      ->AddLengthDelimited(124, "\010\001");
+
+  std::vector<std::function<void(TextFormat::Printer*)>> configurations = {
+      [](TextFormat::Printer*) {},
+      [](TextFormat::Printer* p) { p->SetSingleLineMode(true); },
+      [](TextFormat::Printer* p) { p->SetInitialIndentLevel(2); },
+      [](TextFormat::Printer* p) {
+        p->SetSingleLineMode(true);
+        p->SetInitialIndentLevel(1);
+      },
+      [](TextFormat::Printer* p) { p->SetUseFieldNumber(true); },
+      [](TextFormat::Printer* p) { p->SetUseShortRepeatedPrimitives(true); },
+      [](TextFormat::Printer* p) { p->SetUseUtf8StringEscaping(true); },
+      [](TextFormat::Printer* p) { p->SetHideUnknownFields(true); },
+      [](TextFormat::Printer* p) { p->SetPrintMessageFieldsInIndexOrder(true); },
+      [](TextFormat::Printer* p) { p->SetTruncateStringFieldLongerThan(3); },
+  };
+  for (const auto& configure : configurations) {
+    ExpectSameOutputWithCustomPrinter(message, configure);
+  }
+
+  unittest::TestAllExtensions extensions;
+  TestUtil::SetAllExtensions(&extensions);
+  for (const auto& configure : configurations) {
+    ExpectSameOutputWithCustomPrinter(extensions, configure);
+  }
+
+  unittest::TestMap map;
+  (*map.mutable_map_int32_int32())[2] = 3;
+  (*map.mutable_map_int32_int32())[1] = 4;
+  (*map.mutable_map_string_string())["b"] = "a\n";
+  (*map.mutable_map_int32_foreign_message())[5].set_c(6);
+  for (const auto& configure : configurations) {
+    ExpectSameOutputWithCustomPrinter(map, configure);
+  }
+}
+
+TEST_F(TextFormatTest, FastPrinterFlushesLargeOutput) {
+  unittest::TestAllTypes message;
+  for (int i = 0; i < 20000; ++i) {
+    message.add_repeated_int32(i);
+    message.add_repeated_nested_message()->set_bb(i);
+  }
+  ExpectSameOutputWithCustomPrinter(message, [](TextFormat::Printer*) {});
+
+  // A failing stream is reported like with the regular printer.
+  char buffer[1024];
+  io::ArrayOutputStream output(buffer, sizeof(buffer));
+  EXPECT_FALSE(TextFormat::Print(message, &output));
+}
+
 TEST_F(TextFormatTest, ParseBasic) {
   io::ArrayInputStream input_stream(proto_text_format_.data(),
                                     proto_text_format_.size());
@@ -2301,6 +2389,80 @@ TEST_F(TextFormatParserTest, ParseSkippedFieldWithAdditionalWhiteSpaces) {
   EXPECT_EQ(text, "optional_int32: 321\n");
 }
 
+// Returns the text of a TestAllTypes of about `size` bytes, with the given
+// optional_int32 before the repeated entries and `last` after them.
+std::string LargeTextMessage(size_t size, absl::string_view last) {
+  std::string text = "optional_int32: 1\n";
+  for (int i = 0; text.size() < size; ++i) {
+    absl::StrAppend(&text, "repeated_nested_message {\n  bb: ", i,
+                    "\n}\n# comment with \"quote and } brace\n",
+                    "repeated_string: \"entry\\\" { ", i, "\"\n");
+  }
+  absl::StrAppend(&text, "optional_nested_message { bb: 7 }\n", last);
+  return text;
+}
+
+TEST_F(TextFormatParserTest, ParseInParallel) {
+  const std::string text = LargeTextMessage(4 << 20, "optional_string: \"x\"");
+  unittest::TestAllTypes expected;
+  ASSERT_TRUE(TextFormat::ParseFromString(text, &expected));
+
+  std::vector<std::thread> threads;
+  parser_.SetExecutor([&threads](std::function<void()> task) {
+    threads.emplace_back(std::move(task));
+  });
+  unittest::TestAllTypes message;
+  message.set_optional_bool(true);
+  EXPECT_TRUE(parser_.ParseFromString(text, &message));
+  EXPECT_GT(threads.size(), 1);
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_EQ(message.SerializeAsString(), expected.SerializeAsString());
+  EXPECT_EQ(message.repeated_nested_message_size(),
+            message.repeated_string_size());
+}
+
+TEST_F(TextFormatParserTest, MergeInParallel) {
+  const std::string text = LargeTextMessage(4 << 20, "optional_int32: 2");
+  std::vector<std::thread> threads;
+  parser_.SetExecutor(
+      [&threads](std::function<void()> task) {
+        threads.emplace_back(std::move(task));
+      },
+      4);
+  unittest::TestAllTypes message;
+  message.add_repeated_string("before");
+  EXPECT_TRUE(parser_.MergeFromString(text, &message));
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_EQ(threads.size(), 4);
+  EXPECT_EQ(message.optional_int32(), 2);
+  EXPECT_EQ(message.repeated_string(0), "before");
+  EXPECT_EQ(message.repeated_string(1), "entry\" { 0");
+  EXPECT_EQ(message.optional_nested_message().bb(), 7);
+}
+
+TEST_F(TextFormatParserTest, ParseInParallelReportsErrors) {
+  std::vector<std::thread> threads;
+  parser_.SetExecutor([&threads](std::function<void()> task) {
+    threads.emplace_back(std::move(task));
+  });
+  // Errors are found in the last piece, or only when merging the pieces, and
+  // are reported at their position in the whole input.
+  std::string text = LargeTextMessage(2 << 20, "optional_int32: 2");
+  const int lines = static_cast<int>(absl::c_count(text, '\n'));
+  unittest::TestAllTypes message;
+  ExpectFailure(text,
+                "Non-repeated field \"optional_int32\" is specified multiple "
+                "times.",
+                lines + 1, 15, &message);
+
+  text = LargeTextMessage(2 << 20, "no_such_field: 1");
+  ExpectFailure(text,
+                "Message type \"protobuf_unittest.TestAllTypes\" has no field "
+                "named \"no_such_field\".",
+                lines + 1, 14, &message);
+  for (std::thread& thread : threads) thread.join();
+}
+
 class TextFormatMessageSetTest : public testing::Test {
  protected:
   static const char proto_text_format_[];
@@ -63,6 +63,10 @@ class PROTOBUF_EXPORT ThreadSafeArena {
 
   uint64_t SpaceAllocated() const;
   uint64_t SpaceUsed() const;
+  uint64_t SpaceAllocatedOnNumaNode(int numa_node) const;
+  // Walks all SerialArenas and blocks. Must not be called concurrently with
+  // allocations on this arena to get exact numbers.
+  ArenaMemoryReport GetMemoryReport() const;
 
   template <AllocationClient alloc_client = AllocationClient::kDefault>
   void* AllocateAligned(size_t n) {
@@ -102,6 +106,18 @@ class PROTOBUF_EXPORT ThreadSafeArena {
 
   void* AllocateFromStringBlock();
 
+  // See ArenaOptions::contiguous_repeated_elements.
+  bool ContiguousRepeatedElements() const {
+    const AllocationPolicy* policy = AllocPolicy();
+    return policy != nullptr && policy->contiguous_repeated_elements;
+  }
+
+  // See ArenaOptions::string_intern_table.
+  StringInternTable* GetStringInternTable() const {
+    const AllocationPolicy* policy = AllocPolicy();
+    return policy != nullptr ? policy->string_intern_table : nullptr;
+  }
+
   std::vector<void*> PeekCleanupListForTesting();
 
  private:
@@ -161,9 +177,19 @@ class PROTOBUF_EXPORT ThreadSafeArena {
   // Delete or Destruct all objects owned by the arena.
   void CleanupList();
 
+  // Adds the memory report of this arena to its sampled stats, if any.
+  void RecordMemoryReportStats();
+
+  // Makes `serial` the most recently used entry of this thread's cache,
+  // evicting the least recently used one.
   inline void CacheSerialArena(SerialArena* serial) {
-    thread_cache().last_serial_arena = serial;
-    thread_cache().last_lifecycle_id_seen = tag_and_id_;
+    ThreadCache& tc = thread_cache();
+    for (size_t i = ThreadCache::kWays - 1; i > 0; --i) {
+      tc.lifecycle_ids_seen[i] = tc.lifecycle_ids_seen[i - 1];
+      tc.serial_arenas[i] = tc.serial_arenas[i - 1];
+    }
+    tc.lifecycle_ids_seen[0] = tag_and_id_;
+    tc.serial_arenas[0] = serial;
   }
 
   PROTOBUF_NDEBUG_INLINE bool GetSerialArenaFast(SerialArena** arena) {
@@ -171,8 +197,28 @@ class PROTOBUF_EXPORT ThreadSafeArena {
     // This fast path optimizes the case where multiple threads allocate from
     // the same arena.
     ThreadCache* tc = &thread_cache();
-    if (PROTOBUF_PREDICT_TRUE(tc->last_lifecycle_id_seen == tag_and_id_)) {
-      *arena = tc->last_serial_arena;
+    if (PROTOBUF_PREDICT_TRUE(tc->lifecycle_ids_seen[0] == tag_and_id_)) {
+      *arena = tc->serial_arenas[0];
+      return true;
+    }
+    return GetSerialArenaFromOtherWays(arena);
+  }
+
+  // Looks for this arena in the less recently used entries of the thread cache
+  // and moves it to the front if found. This keeps threads alternating
+  // between a few arenas off the GetSerialArenaFallback() path.
+  inline bool GetSerialArenaFromOtherWays(SerialArena** arena) {
+    ThreadCache* tc = &thread_cache();
+    for (size_t i = 1; i < ThreadCache::kWays; ++i) {
+      if (tc->lifecycle_ids_seen[i] != tag_and_id_) continue;
+      SerialArena* serial = tc->serial_arenas[i];
+      for (; i > 0; --i) {
+        tc->lifecycle_ids_seen[i] = tc->lifecycle_ids_seen[i - 1];
+        tc->serial_arenas[i] = tc->serial_arenas[i - 1];
+      }
+      tc->lifecycle_ids_seen[0] = tag_and_id_;
+      tc->serial_arenas[0] = serial;
+      *arena = serial;
       return true;
     }
     return false;
@@ -205,10 +251,19 @@ class PROTOBUF_EXPORT ThreadSafeArena {
   // block might be owned by the user and thus need some extra checks before
   // deleting.
   SizedPtr Free(size_t* space_allocated);
+  // Same as above, but keeps the largest released block whose size is between
+  // `min_retained_size` and the policy's `reset_retained_bytes` in `retained`.
+  SizedPtr Free(size_t* space_allocated, size_t min_retained_size,
+                SizedPtr* retained);
+  template <typename Deallocator>
+  SizedPtr Free(Deallocator deallocator, size_t* space_allocated);
+
+  // Reset() for policies with a non-zero `reset_retained_bytes`.
+  uint64_t ResetRetainingBlock(AllocationPolicy& policy);
 
   // ThreadCache is accessed very frequently, so we align it such that it's
   // located within a single cache line.
-  static constexpr size_t kThreadCacheAlignment = 32;
+  static constexpr size_t kThreadCacheAlignment = 64;
 
 #ifdef _MSC_VER
 #pragma warning(disable : 4324)
@@ -222,10 +277,18 @@ class PROTOBUF_EXPORT ThreadSafeArena {
     // Next lifecycle ID available to this thread. We need to reserve a new
     // batch, if `next_lifecycle_id & (kPerThreadIds - 1) == 0`.
     uint64_t next_lifecycle_id{0};
-    // The ThreadCache is considered valid as long as this matches the
-    // lifecycle_id of the arena being used.
-    uint64_t last_lifecycle_id_seen{static_cast<uint64_t>(-1)};
-    SerialArena* last_serial_arena{nullptr};
+    // Number of arenas cached per thread, so that a thread interleaving
+    // allocations on a few live arenas (e.g. request, response and session)
+    // does not have to look up its SerialArena on every switch.
+    static constexpr size_t kWays = 3;
+    // Entry `i` is valid as long as `lifecycle_ids_seen[i]` matches the
+    // lifecycle_id of the arena being used. Entries are kept in most recently
+    // used order. Lifecycle ids are never reused, so entries of destroyed or
+    // reset arenas simply never match again.
+    uint64_t lifecycle_ids_seen[kWays] = {static_cast<uint64_t>(-1),
+                                          static_cast<uint64_t>(-1),
+                                          static_cast<uint64_t>(-1)};
+    SerialArena* serial_arenas[kWays] = {};
   };
   static_assert(sizeof(ThreadCache) <= kThreadCacheAlignment,
                 "ThreadCache may span several cache lines");
@@ -31,6 +31,41 @@
 
 namespace google {
 namespace protobuf {
+namespace {
+
+constexpr int kMaxVarintBytes = 10;
+constexpr int kMaxVarint32Bytes = 5;
+
+void AppendTag(uint32_t number, internal::WireFormatLite::WireType type,
+               std::string* raw) {
+  uint8_t buffer[kMaxVarint32Bytes];
+  uint8_t* end = io::CodedOutputStream::WriteTagToArray(
+      internal::WireFormatLite::MakeTag(number, type), buffer);
+  raw->append(reinterpret_cast<const char*>(buffer), end - buffer);
+}
+
+void AppendVarint(uint32_t number, uint64_t value, std::string* raw) {
+  AppendTag(number, internal::WireFormatLite::WIRETYPE_VARINT, raw);
+  uint8_t buffer[kMaxVarintBytes];
+  uint8_t* end = io::CodedOutputStream::WriteVarint64ToArray(value, buffer);
+  raw->append(reinterpret_cast<const char*>(buffer), end - buffer);
+}
+
+void AppendFixed32(uint32_t number, uint32_t value, std::string* raw) {
+  AppendTag(number, internal::WireFormatLite::WIRETYPE_FIXED32, raw);
+  uint8_t buffer[sizeof(value)];
+  io::CodedOutputStream::WriteLittleEndian32ToArray(value, buffer);
+  raw->append(reinterpret_cast<const char*>(buffer), sizeof(buffer));
+}
+
+void AppendFixed64(uint32_t number, uint64_t value, std::string* raw) {
+  AppendTag(number, internal::WireFormatLite::WIRETYPE_FIXED64, raw);
+  uint8_t buffer[sizeof(value)];
+  io::CodedOutputStream::WriteLittleEndian64ToArray(value, buffer);
+  raw->append(reinterpret_cast<const char*>(buffer), sizeof(buffer));
+}
+
+}  // namespace
 
 const UnknownFieldSet& UnknownFieldSet::default_instance() {
   static auto instance = internal::OnShutdownDelete(new UnknownFieldSet());
@@ -38,16 +73,49 @@ const UnknownFieldSet& UnknownFieldSet::default_instance() {
 }
 
 void UnknownFieldSet::ClearFallback() {
-  ABSL_DCHECK(!fields_.empty());
+  ABSL_DCHECK(!fields_.empty() || !raw_.empty());
   int n = fields_.size();
-  do {
+  while (n > 0) {
     (fields_)[--n].Delete();
-  } while (n > 0);
+  }
   fields_.clear();
+  raw_.clear();
+  ResetParsedRawFields();
+}
+
+const UnknownFieldSet& UnknownFieldSet::ParsedRawFields() const {
+  UnknownFieldSet* parsed = parsed_raw_.load(std::memory_order_acquire);
+  if (parsed != nullptr) return *parsed;
+  auto* fields = new UnknownFieldSet;
+  // raw_ only holds fields that were parsed successfully before.
+  bool ok = fields->ParseFromArray(raw_.data(), static_cast<int>(raw_.size()));
+  ABSL_DCHECK(ok);
+  (void)ok;
+  // Concurrent readers may race to parse; the first one wins.
+  if (!parsed_raw_.compare_exchange_strong(parsed, fields,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+    delete fields;
+    return *parsed;
+  }
+  return *fields;
+}
+
+void UnknownFieldSet::CommitRawFields() {
+  ParsedRawFields();
+  UnknownFieldSet* parsed =
+      parsed_raw_.exchange(nullptr, std::memory_order_relaxed);
+  raw_.clear();
+  MergeFromAndDestroy(parsed);
+  delete parsed;
+}
+
+void UnknownFieldSet::ResetParsedRawFields() {
+  delete parsed_raw_.exchange(nullptr, std::memory_order_relaxed);
 }
 
 void UnknownFieldSet::InternalMergeFrom(const UnknownFieldSet& other) {
-  int other_field_count = other.field_count();
+  int other_field_count = static_cast<int>(other.fields_.size());
   if (other_field_count > 0) {
     fields_.reserve(fields_.size() + other_field_count);
     for (int i = 0; i < other_field_count; i++) {
@@ -55,10 +123,19 @@ void UnknownFieldSet::InternalMergeFrom(const UnknownFieldSet& other) {
       fields_.back().DeepCopy((other.fields_)[i]);
     }
   }
+  raw_.append(other.raw_);
 }
 
 void UnknownFieldSet::MergeFrom(const UnknownFieldSet& other) {
-  int other_field_count = other.field_count();
+  if (!raw_.empty() && !other.fields_.empty()) {
+    // The fields of `other` go after raw_, so they are appended to it too.
+    std::string other_raw;
+    other.SerializeToString(&other_raw);
+    ResetParsedRawFields();
+    raw_.append(other_raw);
+    return;
+  }
+  int other_field_count = static_cast<int>(other.fields_.size());
   if (other_field_count > 0) {
     fields_.reserve(fields_.size() + other_field_count);
     for (int i = 0; i < other_field_count; i++) {
@@ -66,11 +143,20 @@ void UnknownFieldSet::MergeFrom(const UnknownFieldSet& other) {
       fields_.back().DeepCopy((other.fields_)[i]);
     }
   }
+  if (!other.raw_.empty()) {
+    ResetParsedRawFields();
+    raw_.append(other.raw_);
+  }
 }
 
 // A specialized MergeFrom for performance when we are merging from an UFS that
 // is temporary and can be destroyed in the process.
 void UnknownFieldSet::MergeFromAndDestroy(UnknownFieldSet* other) {
+  if (!raw_.empty() && !other->fields_.empty()) {
+    MergeFrom(*other);
+    other->Clear();
+    return;
+  }
   if (fields_.empty()) {
     fields_ = std::move(other->fields_);
   } else {
@@ -79,6 +165,16 @@ void UnknownFieldSet::MergeFromAndDestroy(UnknownFieldSet* other) {
                    std::make_move_iterator(other->fields_.end()));
   }
   other->fields_.clear();
+  if (!other->raw_.empty()) {
+    ResetParsedRawFields();
+    if (raw_.empty()) {
+      raw_.swap(other->raw_);
+    } else {
+      raw_.append(other->raw_);
+    }
+    other->raw_.clear();
+    other->ResetParsedRawFields();
+  }
 }
 
 void UnknownFieldSet::MergeToInternalMetadata(
@@ -87,9 +183,14 @@ void UnknownFieldSet::MergeToInternalMetadata(
 }
 
 size_t UnknownFieldSet::SpaceUsedExcludingSelfLong() const {
-  if (fields_.empty()) return 0;
+  if (fields_.empty() && raw_.empty()) return 0;
 
-  size_t total_size = sizeof(UnknownField) * fields_.capacity();
+  size_t total_size = sizeof(UnknownField) * fields_.capacity() +
+                      internal::StringSpaceUsedExcludingSelfLong(raw_);
+  if (const UnknownFieldSet* parsed =
+          parsed_raw_.load(std::memory_order_acquire)) {
+    total_size += parsed->SpaceUsedLong();
+  }
 
   for (const UnknownField& field : fields_) {
     switch (field.type()) {
@@ -113,6 +214,11 @@ size_t UnknownFieldSet::SpaceUsedLong() const {
 }
 
 void UnknownFieldSet::AddVarint(int number, uint64_t value) {
+  if (!raw_.empty()) {
+    ResetParsedRawFields();
+    AppendVarint(number, value, &raw_);
+    return;
+  }
   fields_.emplace_back();
   auto& field = fields_.back();
   field.number_ = number;
@@ -121,6 +227,11 @@ void UnknownFieldSet::AddVarint(int number, uint64_t value) {
 }
 
 void UnknownFieldSet::AddFixed32(int number, uint32_t value) {
+  if (!raw_.empty()) {
+    ResetParsedRawFields();
+    AppendFixed32(number, value, &raw_);
+    return;
+  }
   fields_.emplace_back();
   auto& field = fields_.back();
   field.number_ = number;
@@ -129,6 +240,11 @@ void UnknownFieldSet::AddFixed32(int number, uint32_t value) {
 }
 
 void UnknownFieldSet::AddFixed64(int number, uint64_t value) {
+  if (!raw_.empty()) {
+    ResetParsedRawFields();
+    AppendFixed64(number, value, &raw_);
+    return;
+  }
   fields_.emplace_back();
   auto& field = fields_.back();
   field.number_ = number;
@@ -137,6 +253,7 @@ void UnknownFieldSet::AddFixed64(int number, uint64_t value) {
 }
 
 std::string* UnknownFieldSet::AddLengthDelimited(int number) {
+  if (!raw_.empty()) CommitRawFields();
   fields_.emplace_back();
   auto& field = fields_.back();
   field.number_ = number;
@@ -147,6 +264,7 @@ std::string* UnknownFieldSet::AddLengthDelimited(int number) {
 
 
 UnknownFieldSet* UnknownFieldSet::AddGroup(int number) {
+  if (!raw_.empty()) CommitRawFields();
   fields_.emplace_back();
   auto& field = fields_.back();
   field.number_ = number;
@@ -156,11 +274,13 @@ UnknownFieldSet* UnknownFieldSet::AddGroup(int number) {
 }
 
 void UnknownFieldSet::AddField(const UnknownField& field) {
+  if (!raw_.empty()) CommitRawFields();
   fields_.push_back(field);
   fields_.back().DeepCopy(field);
 }
 
 void UnknownFieldSet::DeleteSubrange(int start, int num) {
+  if (!raw_.empty()) CommitRawFields();
   // Delete the specified fields.
   for (int i = 0; i < num; ++i) {
     (fields_)[i + start].Delete();
@@ -176,6 +296,7 @@ void UnknownFieldSet::DeleteSubrange(int start, int num) {
 }
 
 void UnknownFieldSet::DeleteByNumber(int number) {
+  if (!raw_.empty()) CommitRawFields();
   size_t left = 0;  // The number of fields left after deletion.
   for (size_t i = 0; i < fields_.size(); ++i) {
     UnknownField* field = &(fields_)[i];
@@ -318,10 +439,68 @@ class UnknownFieldParserHelper {
     return WireFormatParser(*this, ptr, ctx);
   }
 
+  // Parses the field with the given tag into the raw bytes of `unknown`.
+  static const char* ParseRaw(uint64_t tag, UnknownFieldSet* unknown,
+                              const char* ptr, ParseContext* ctx);
+
  private:
   UnknownFieldSet* unknown_;
 };
 
+// Copies the fields it parses to a buffer in wire format, without creating
+// UnknownField entries.
+class RawUnknownFieldParserHelper {
+ public:
+  explicit RawUnknownFieldParserHelper(std::string* raw) : raw_(raw) {}
+
+  void AddVarint(uint32_t num, uint64_t value) {
+    AppendVarint(num, value, raw_);
+  }
+  void AddFixed64(uint32_t num, uint64_t value) {
+    AppendFixed64(num, value, raw_);
+  }
+  const char* ParseLengthDelimited(uint32_t num, const char* ptr,
+                                   ParseContext* ctx) {
+    int size = ReadSize(&ptr);
+    GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
+    AppendTag(num, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, raw_);
+    uint8_t buffer[kMaxVarint32Bytes];
+    uint8_t* end = io::CodedOutputStream::WriteVarint32ToArray(size, buffer);
+    raw_->append(reinterpret_cast<const char*>(buffer), end - buffer);
+    return ctx->AppendString(ptr, size, raw_);
+  }
+  const char* ParseGroup(uint32_t num, const char* ptr, ParseContext* ctx) {
+    AppendTag(num, WireFormatLite::WIRETYPE_START_GROUP, raw_);
+    ptr = ctx->ParseGroup(this, ptr, num * 8 + 3);
+    GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
+    AppendTag(num, WireFormatLite::WIRETYPE_END_GROUP, raw_);
+    return ptr;
+  }
+  void AddFixed32(uint32_t num, uint32_t value) {
+    AppendFixed32(num, value, raw_);
+  }
+
+  const char* _InternalParse(const char* ptr, ParseContext* ctx) {
+    return WireFormatParser(*this, ptr, ctx);
+  }
+
+ private:
+  std::string* raw_;
+};
+
+const char* UnknownFieldParserHelper::ParseRaw(uint64_t tag,
+                                               UnknownFieldSet* unknown,
+                                               const char* ptr,
+                                               ParseContext* ctx) {
+  unknown->ResetParsedRawFields();
+  const size_t size = unknown->raw_.size();
+  RawUnknownFieldParserHelper field_parser(&unknown->raw_);
+  ptr = FieldParser(tag, field_parser, ptr, ctx);
+  // Drop a partially copied field so that raw_ stays parseable.
+  if (ptr == nullptr) unknown->raw_.resize(size);
+  return ptr;
+}
+
 const char* UnknownGroupParse(UnknownFieldSet* unknown, const char* ptr,
                               ParseContext* ctx) {
   UnknownFieldParserHelper field_parser(unknown);
@@ -330,8 +509,7 @@ const char* UnknownGroupParse(UnknownFieldSet* unknown, const char* ptr,
 
 const char* UnknownFieldParse(uint64_t tag, UnknownFieldSet* unknown,
                               const char* ptr, ParseContext* ctx) {
-  UnknownFieldParserHelper field_parser(unknown);
-  return FieldParser(tag, field_parser, ptr, ctx);
+  return UnknownFieldParserHelper::ParseRaw(tag, unknown, ptr, ctx);
 }
 
 }  // namespace internal
@@ -17,6 +17,7 @@
 
 #include <assert.h>
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -42,6 +43,7 @@ class InternalMetadata;           // metadata_lite.h
 class WireFormat;                 // wire_format.h
 class MessageSetFieldSkipperUsingCord;
 // extension_set_heavy.cc
+class UnknownFieldParserHelper;   // unknown_field_set.cc
 }  // namespace internal
 
 class Message;       // message.h
@@ -57,6 +59,12 @@ class UnknownField;  // below
 // To get the UnknownFieldSet attached to any message, call
 // Reflection::GetUnknownFields().
 //
+// Fields parsed from the wire are kept as the raw bytes they were parsed
+// from, in one buffer, and are serialized again by copying that buffer. They
+// are turned into UnknownField entries when first read through field_count()
+// or field(), or when mutable_field(), AddLengthDelimited(), AddGroup(),
+// AddField() or one of the Delete methods is called.
+//
 // This class is necessarily tied to the protocol buffer wire format, unlike
 // the Reflection interface which is independent of any serialization scheme.
 class PROTOBUF_EXPORT UnknownFieldSet {
@@ -161,11 +169,22 @@ class PROTOBUF_EXPORT UnknownFieldSet {
  private:
   // For InternalMergeFrom
   friend class UnknownField;
+  // For raw_
+  friend class internal::UnknownFieldParserHelper;
+  friend class internal::WireFormat;
   // Merges from other UnknownFieldSet. This method assumes, that this object
   // is newly created and has no fields.
   void InternalMergeFrom(const UnknownFieldSet& other);
   void ClearFallback();
 
+  // Returns the fields in raw_, parsing them on first use. The result is
+  // cached in parsed_raw_ until raw_ changes.
+  const UnknownFieldSet& ParsedRawFields() const;
+  // Moves the fields in raw_ to the end of fields_.
+  void CommitRawFields();
+  // Drops the fields parsed from raw_; raw_ is about to change.
+  void ResetParsedRawFields();
+
   template <typename MessageType,
             typename std::enable_if<
                 std::is_base_of<Message, MessageType>::value, int>::type = 0>
@@ -187,7 +206,11 @@ class PROTOBUF_EXPORT UnknownFieldSet {
     return MergeFromCodedStream(&coded_stream);
   }
 
+  // The fields of the set are fields_ followed by the fields encoded in raw_,
+  // in wire format.
   std::vector<UnknownField> fields_;
+  std::string raw_;
+  mutable std::atomic<UnknownFieldSet*> parsed_raw_{nullptr};
 };
 
 namespace internal {
@@ -282,24 +305,38 @@ inline UnknownFieldSet::~UnknownFieldSet() { Clear(); }
 inline void UnknownFieldSet::ClearAndFreeMemory() { Clear(); }
 
 inline void UnknownFieldSet::Clear() {
-  if (!fields_.empty()) {
+  if (!fields_.empty() || !raw_.empty()) {
     ClearFallback();
   }
 }
 
-inline bool UnknownFieldSet::empty() const { return fields_.empty(); }
+inline bool UnknownFieldSet::empty() const {
+  return fields_.empty() && raw_.empty();
+}
 
 inline void UnknownFieldSet::Swap(UnknownFieldSet* x) {
   fields_.swap(x->fields_);
+  raw_.swap(x->raw_);
+  UnknownFieldSet* parsed_raw = parsed_raw_.load(std::memory_order_relaxed);
+  parsed_raw_.store(x->parsed_raw_.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+  x->parsed_raw_.store(parsed_raw, std::memory_order_relaxed);
 }
 
 inline int UnknownFieldSet::field_count() const {
-  return static_cast<int>(fields_.size());
+  if (PROTOBUF_PREDICT_TRUE(raw_.empty())) {
+    return static_cast<int>(fields_.size());
+  }
+  return static_cast<int>(fields_.size()) + ParsedRawFields().field_count();
 }
 inline const UnknownField& UnknownFieldSet::field(int index) const {
-  return (fields_)[static_cast<size_t>(index)];
+  if (static_cast<size_t>(index) < fields_.size()) {
+    return (fields_)[static_cast<size_t>(index)];
+  }
+  return ParsedRawFields().field(index - static_cast<int>(fields_.size()));
 }
 inline UnknownField* UnknownFieldSet::mutable_field(int index) {
+  if (!raw_.empty()) CommitRawFields();
   return &(fields_)[static_cast<size_t>(index)];
 }
 
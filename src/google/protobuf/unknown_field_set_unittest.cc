@@ -15,6 +15,7 @@
 #include "google/protobuf/unknown_field_set.h"
 
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "google/protobuf/stubs/callback.h"
@@ -731,6 +732,63 @@ TEST_F(UnknownFieldSetTest, SerializeToCord_TestPackedTypes) {
   EXPECT_THAT(message.packed_uint64(), ElementsAre(5, 6, 7));
 }
 
+TEST_F(UnknownFieldSetTest, ParsedFieldsKeepOrderWithAddedFields) {
+  const int count = unknown_fields_->field_count();
+  unknown_fields_->AddVarint(123456, 1);
+  unknown_fields_->AddLengthDelimited(123457, "foo");
+  ASSERT_EQ(unknown_fields_->field_count(), count + 2);
+  EXPECT_EQ(unknown_fields_->field(count).number(), 123456);
+  EXPECT_EQ(unknown_fields_->field(count).varint(), 1);
+  EXPECT_EQ(unknown_fields_->field(count + 1).length_delimited(), "foo");
+
+  std::string data = empty_message_.SerializeAsString();
+  EXPECT_EQ(data.substr(0, all_fields_data_.size()), all_fields_data_);
+  unittest::TestEmptyMessage parsed;
+  ASSERT_TRUE(parsed.ParseFromString(data));
+  ASSERT_EQ(parsed.unknown_fields().field_count(), count + 2);
+  for (int i = 0; i < count + 2; ++i) {
+    EXPECT_EQ(parsed.unknown_fields().field(i).number(),
+              unknown_fields_->field(i).number());
+  }
+}
+
+TEST_F(UnknownFieldSetTest, MergeParsedAndAddedFields) {
+  UnknownFieldSet added;
+  added.AddVarint(123456, 1);
+  added.AddGroup(123457)->AddFixed32(1, 2);
+
+  // Parsed fields followed by added fields, and the other way around.
+  unittest::TestEmptyMessage parsed_first;
+  ASSERT_TRUE(parsed_first.ParseFromString(all_fields_data_));
+  parsed_first.mutable_unknown_fields()->MergeFrom(added);
+  unittest::TestEmptyMessage added_first;
+  added_first.mutable_unknown_fields()->MergeFrom(added);
+  added_first.mutable_unknown_fields()->MergeFrom(
+      empty_message_.unknown_fields());
+
+  std::string added_data;
+  ASSERT_TRUE(added.SerializeToString(&added_data));
+  EXPECT_EQ(parsed_first.SerializeAsString(), all_fields_data_ + added_data);
+  EXPECT_EQ(added_first.SerializeAsString(), added_data + all_fields_data_);
+  EXPECT_EQ(parsed_first.unknown_fields().field_count(),
+            added_first.unknown_fields().field_count());
+}
+
+TEST_F(UnknownFieldSetTest, ConcurrentFieldAccess) {
+  unittest::TestEmptyMessage message;
+  ASSERT_TRUE(message.ParseFromString(all_fields_data_));
+  const int count = unknown_fields_->field_count();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&] {
+      EXPECT_EQ(message.unknown_fields().field_count(), count);
+      EXPECT_EQ(message.unknown_fields().field(count - 1).number(),
+                unknown_fields_->field(count - 1).number());
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+}
+
 }  // namespace
 
 }  // namespace protobuf
@@ -0,0 +1,63 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file is internal to the protobuf runtime.  It defines the UTF-8 check
+// that all string validation goes through.
+
+#ifndef GOOGLE_PROTOBUF_UTF8_UTIL_H__
+#define GOOGLE_PROTOBUF_UTF8_UTIL_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "absl/strings/string_view.h"
+#include "utf8_validity.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+// Returns whether `str` is structurally valid UTF-8.
+//
+// Most strings are short and ASCII, so they are checked inline with a couple
+// of overlapping word loads. Everything else goes to utf8_range, which
+// vectorizes longer inputs but costs an out-of-line call.
+PROTOBUF_ALWAYS_INLINE inline bool IsValidUtf8(absl::string_view str) {
+  const char* p = str.data();
+  const size_t size = str.size();
+  if (size >= sizeof(uint64_t)) {
+    if (size <= 2 * sizeof(uint64_t)) {
+      uint64_t head, tail;
+      std::memcpy(&head, p, sizeof(head));
+      std::memcpy(&tail, p + size - sizeof(tail), sizeof(tail));
+      if (((head | tail) & 0x8080808080808080) == 0) return true;
+    }
+  } else if (size >= sizeof(uint32_t)) {
+    uint32_t head, tail;
+    std::memcpy(&head, p, sizeof(head));
+    std::memcpy(&tail, p + size - sizeof(tail), sizeof(tail));
+    if (((head | tail) & 0x80808080) == 0) return true;
+  } else if (size > 0) {
+    // Covers every byte of strings of 1 to 3 bytes.
+    if (((p[0] | p[size / 2] | p[size - 1]) & 0x80) == 0) return true;
+  } else {
+    return true;
+  }
+  return utf8_range::IsStructurallyValid(str);
+}
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTF8_UTIL_H__
@@ -0,0 +1,42 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/arena_clone.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+Message* CloneOntoNewArena(const Message& root, std::unique_ptr<Arena>* arena) {
+  ArenaOptions options;
+  if (const Arena* source = root.GetArena()) {
+    Arena::MemoryReport report = source->GetMemoryReport();
+    // Everything but the free space of the source blocks, plus some headroom
+    // for block headers and differences in alignment padding.
+    uint64_t needed = report.space_allocated -
+                      report.current_block_free_bytes -
+                      report.block_tail_wasted_bytes;
+    needed += needed / 8 + 1024;
+    options.start_block_size =
+        std::max(options.start_block_size, static_cast<size_t>(needed));
+    options.max_block_size =
+        std::max(options.max_block_size, options.start_block_size);
+  }
+  *arena = std::make_unique<Arena>(options);
+  Message* clone = root.New(arena->get());
+  clone->CopyFrom(root);
+  return clone;
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,51 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Defines utilities for snapshotting an arena message tree onto a new arena.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_ARENA_CLONE_H__
+#define GOOGLE_PROTOBUF_UTIL_ARENA_CLONE_H__
+
+#include <memory>
+
+#include "google/protobuf/arena.h"
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+// Copies `root` onto a new arena, stored in `*arena`, and returns the copy.
+//
+// The new arena is sized up front from the arena of `root`, so that the whole
+// copy usually lands in a single block: copying a large tree does not walk
+// through a series of growing blocks and allocator calls, and the copy ends up
+// contiguous in memory. This is meant for arenas that hold one root message,
+// e.g. to snapshot state for copy-on-write readers; other objects on the arena
+// of `root` only make the new block larger than needed.
+//
+// If `root` is not on an arena, the new arena uses the default options.
+PROTOBUF_EXPORT Message* CloneOntoNewArena(const Message& root,
+                                           std::unique_ptr<Arena>* arena);
+
+// As above, returning the copy with the type of `root`.
+template <typename T>
+T* CloneOntoNewArena(const T& root, std::unique_ptr<Arena>* arena) {
+  return static_cast<T*>(
+      CloneOntoNewArena(static_cast<const Message&>(root), arena));
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_ARENA_CLONE_H__
@@ -0,0 +1,58 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/arena_clone.h"
+
+#include <memory>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/arena.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+
+TEST(ArenaCloneTest, ClonesIntoOneBlock) {
+  Arena source;
+  auto* root = Arena::CreateMessage<TestAllTypes>(&source);
+  TestUtil::SetAllFields(root);
+  for (int i = 0; i < 10000; ++i) {
+    root->add_repeated_nested_message()->set_bb(i);
+    root->add_repeated_string("a value that does not fit in SSO");
+  }
+
+  std::unique_ptr<Arena> arena;
+  TestAllTypes* clone = CloneOntoNewArena(*root, &arena);
+  ASSERT_NE(arena, nullptr);
+  EXPECT_EQ(clone->GetArena(), arena.get());
+  EXPECT_EQ(clone->SerializeAsString(), root->SerializeAsString());
+
+  Arena::MemoryReport report = arena->GetMemoryReport();
+  ASSERT_EQ(report.block_size_counts.size(), 1);
+  EXPECT_EQ(report.block_size_counts[0].second, 1);
+}
+
+TEST(ArenaCloneTest, ClonesHeapMessage) {
+  TestAllTypes root;
+  TestUtil::SetAllFields(&root);
+
+  std::unique_ptr<Arena> arena;
+  const Message& message = root;
+  Message* clone = CloneOntoNewArena(message, &arena);
+  EXPECT_EQ(clone->GetArena(), arena.get());
+  TestUtil::ExpectAllFieldsSet(*static_cast<TestAllTypes*>(clone));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,73 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/arena_size_history.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+// Ratios are stored in fixed point with this many fractional bits.
+constexpr int kRatioShift = 8;
+// Each recorded parse moves a ratio down by at most 1/kDecay of its value.
+constexpr uint64_t kDecay = 16;
+// Covers block headers and the arena's own bookkeeping.
+constexpr size_t kBlockOverhead = 1024;
+
+}  // namespace
+
+ArenaOptions ArenaSizeHistory::OptionsFor(const Descriptor* type,
+                                          size_t input_size) const {
+  ArenaOptions options;
+  uint64_t ratio;
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    auto it = ratios_.find(type);
+    if (it == ratios_.end()) return options;
+    ratio = it->second;
+  }
+  size_t needed =
+      static_cast<size_t>((ratio * input_size) >> kRatioShift) + kBlockOverhead;
+  options.start_block_size = std::max(options.start_block_size, needed);
+  options.max_block_size =
+      std::max(options.max_block_size, options.start_block_size);
+  return options;
+}
+
+void ArenaSizeHistory::Record(const Descriptor* type, size_t input_size,
+                              const Arena& arena) {
+  if (input_size == 0) return;
+  Arena::MemoryReport report = arena.GetMemoryReport();
+  uint64_t used = report.space_allocated - report.current_block_free_bytes -
+                  report.block_tail_wasted_bytes;
+  uint64_t sample = (used << kRatioShift) / input_size + 1;
+
+  absl::MutexLock lock(&mutex_);
+  uint64_t& ratio = ratios_[type];
+  ratio = std::max(sample, ratio - ratio / kDecay);
+}
+
+Message* ArenaSizeHistory::Parse(const Message& prototype,
+                                 absl::string_view data,
+                                 std::unique_ptr<Arena>* arena) {
+  const Descriptor* type = prototype.GetDescriptor();
+  *arena = std::make_unique<Arena>(OptionsFor(type, data.size()));
+  Message* message = prototype.New(arena->get());
+  if (!message->ParseFromString(data)) return nullptr;
+  Record(type, data.size(), **arena);
+  return message;
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,89 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Defines ArenaSizeHistory, which sizes the arenas of parsed messages from the
+// sizes of earlier parses of the same type.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_ARENA_SIZE_HISTORY_H__
+#define GOOGLE_PROTOBUF_UTIL_ARENA_SIZE_HISTORY_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+// Records, per message type, how many arena bytes a parse uses per input byte,
+// and sizes the first block of the arena of the next parse to match. A fresh
+// arena otherwise grows through a series of blocks of doubling size while the
+// message is parsed; with a history, most parses allocate a single block.
+//
+// The recorded ratio follows the largest recent parses and decays slowly, so
+// that occasional smaller messages do not make the next larger one overflow
+// its block.
+//
+// Example:
+//
+//   static auto* history = new util::ArenaSizeHistory;
+//   std::unique_ptr<Arena> arena;
+//   Request* request = history->Parse<Request>(data, &arena);
+//   if (request == nullptr) { ... }
+//
+// ArenaSizeHistory is thread-safe.
+class PROTOBUF_EXPORT ArenaSizeHistory {
+ public:
+  ArenaSizeHistory() = default;
+  ArenaSizeHistory(const ArenaSizeHistory&) = delete;
+  ArenaSizeHistory& operator=(const ArenaSizeHistory&) = delete;
+
+  // Returns options for an arena that will hold a message of type `type`
+  // parsed from `input_size` bytes. Options are the defaults until a parse of
+  // the type has been recorded.
+  ArenaOptions OptionsFor(const Descriptor* type, size_t input_size) const;
+
+  // Records that parsing `input_size` bytes of a message of type `type` used
+  // the space of `arena`, which should hold nothing else.
+  void Record(const Descriptor* type, size_t input_size, const Arena& arena);
+
+  // Parses `data` into a new message of the type of `prototype` on a new arena,
+  // stored in `*arena`, sized by OptionsFor() and then recorded. Returns
+  // nullptr if `data` is not a valid message.
+  Message* Parse(const Message& prototype, absl::string_view data,
+                 std::unique_ptr<Arena>* arena);
+
+  template <typename T>
+  T* Parse(absl::string_view data, std::unique_ptr<Arena>* arena) {
+    return static_cast<T*>(Parse(T::default_instance(), data, arena));
+  }
+
+ private:
+  mutable absl::Mutex mutex_;
+  // Arena bytes used per input byte, in 1/256ths.
+  absl::flat_hash_map<const Descriptor*, uint64_t> ratios_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_ARENA_SIZE_HISTORY_H__
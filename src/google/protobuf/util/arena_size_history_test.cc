@@ -0,0 +1,73 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/arena_size_history.h"
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/arena.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+
+std::string MakeLargeMessage() {
+  TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  for (int i = 0; i < 10000; ++i) {
+    message.add_repeated_nested_message()->set_bb(i);
+    message.add_repeated_string("a value that does not fit in SSO");
+  }
+  return message.SerializeAsString();
+}
+
+size_t CountBlocks(const Arena& arena) {
+  size_t blocks = 0;
+  for (const auto& size_count : arena.GetMemoryReport().block_size_counts) {
+    blocks += size_count.second;
+  }
+  return blocks;
+}
+
+TEST(ArenaSizeHistoryTest, SizesLaterParsesFromHistory) {
+  const std::string data = MakeLargeMessage();
+  ArenaSizeHistory history;
+  EXPECT_EQ(history.OptionsFor(TestAllTypes::descriptor(), data.size())
+                .start_block_size,
+            ArenaOptions().start_block_size);
+
+  std::unique_ptr<Arena> arena;
+  TestAllTypes* message = history.Parse<TestAllTypes>(data, &arena);
+  ASSERT_NE(message, nullptr);
+  EXPECT_EQ(message->GetArena(), arena.get());
+  EXPECT_GT(CountBlocks(*arena), 1);
+
+  message = history.Parse<TestAllTypes>(data, &arena);
+  ASSERT_NE(message, nullptr);
+  EXPECT_EQ(message->SerializeAsString(), data);
+  EXPECT_EQ(CountBlocks(*arena), 1);
+}
+
+TEST(ArenaSizeHistoryTest, RejectsMalformedInput) {
+  ArenaSizeHistory history;
+  std::unique_ptr<Arena> arena;
+  EXPECT_EQ(history.Parse<TestAllTypes>("\xff", &arena), nullptr);
+  EXPECT_EQ(history.OptionsFor(TestAllTypes::descriptor(), 1).start_block_size,
+            ArenaOptions().start_block_size);
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,90 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Defines CachedAny, which unpacks the payload of an Any at most once and packs
+// it back only if it was modified.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_CACHED_ANY_H__
+#define GOOGLE_PROTOBUF_UTIL_CACHED_ANY_H__
+
+#include "google/protobuf/any.pb.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+// Caches the payload of type `T` of an Any.
+//
+// Code that unpacks an Any, reads a field or two, and packs it back pays for a
+// parse and a serialization on every round trip. CachedAny parses the payload
+// on first access, and serializes it back into the Any only when Flush() is
+// called after the payload was modified through Mutable(). Reading alone never
+// touches the Any, so its bytes are passed on unchanged.
+//
+// The Any must outlive the CachedAny and must not be modified by other means
+// while it is cached. Modifications that have not been flushed are lost when
+// the CachedAny is destroyed.
+//
+// Example:
+//
+//   util::CachedAny<Envelope> envelope(request.mutable_payload());
+//   if (envelope.Get() == nullptr) return;  // Not an Envelope.
+//   if (envelope.Get()->ttl() == 0) {
+//     envelope.Mutable()->set_ttl(kDefaultTtl);
+//   }
+//   envelope.Flush();
+template <typename T>
+class CachedAny {
+ public:
+  explicit CachedAny(Any* any) : any_(any) {}
+  CachedAny(const CachedAny&) = delete;
+  CachedAny& operator=(const CachedAny&) = delete;
+
+  // Returns the payload, unpacking it on first use. Returns nullptr if the Any
+  // does not hold a `T` or its value fails to parse.
+  const T* Get() {
+    if (state_ == kUnparsed) {
+      state_ = any_->UnpackTo(&payload_) ? kClean : kInvalid;
+    }
+    return state_ == kInvalid ? nullptr : &payload_;
+  }
+
+  // Like Get(), but marks the payload as modified so that Flush() packs it
+  // back into the Any.
+  T* Mutable() {
+    if (Get() == nullptr) return nullptr;
+    state_ = kDirty;
+    return &payload_;
+  }
+
+  // Serializes the payload into the value of the Any if it was modified since
+  // the last flush; the type URL is kept as is. Returns false if serialization
+  // failed.
+  bool Flush() {
+    if (state_ != kDirty) return true;
+    state_ = kClean;
+    return payload_.SerializeToString(any_->mutable_value());
+  }
+
+ private:
+  enum State { kUnparsed, kClean, kDirty, kInvalid };
+
+  Any* any_;
+  T payload_;
+  State state_ = kUnparsed;
+};
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_CACHED_ANY_H__
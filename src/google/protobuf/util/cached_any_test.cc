@@ -0,0 +1,81 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/cached_any.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/any.pb.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestEmptyMessage;
+
+TEST(CachedAnyTest, ReadDoesNotRepack) {
+  TestAllTypes first;
+  first.set_optional_int32(1);
+  TestAllTypes second;
+  second.set_optional_int32(2);
+  Any any;
+  ASSERT_TRUE(any.PackFrom(first));
+  // Not what serializing the payload again would produce.
+  std::string value = first.SerializeAsString() + second.SerializeAsString();
+  any.set_value(value);
+
+  CachedAny<TestAllTypes> cached(&any);
+  ASSERT_NE(cached.Get(), nullptr);
+  EXPECT_EQ(cached.Get()->optional_int32(), 2);
+  EXPECT_EQ(cached.Get(), cached.Get());
+  EXPECT_TRUE(cached.Flush());
+  EXPECT_EQ(any.value(), value);
+}
+
+TEST(CachedAnyTest, FlushPacksModifiedPayload) {
+  TestAllTypes payload;
+  payload.set_optional_int32(1);
+  Any any;
+  ASSERT_TRUE(any.PackFrom(payload, "type.googleprod.com"));
+
+  CachedAny<TestAllTypes> cached(&any);
+  cached.Mutable()->set_optional_string("hello");
+  cached.Mutable()->set_optional_int32(5);
+  // Nothing is written until the flush.
+  EXPECT_EQ(any.value(), payload.SerializeAsString());
+  EXPECT_TRUE(cached.Flush());
+
+  TestAllTypes unpacked;
+  ASSERT_TRUE(any.UnpackTo(&unpacked));
+  EXPECT_EQ(unpacked.optional_int32(), 5);
+  EXPECT_EQ(unpacked.optional_string(), "hello");
+  EXPECT_EQ(any.type_url(),
+            "type.googleprod.com/protobuf_unittest.TestAllTypes");
+}
+
+TEST(CachedAnyTest, WrongType) {
+  TestAllTypes payload;
+  payload.set_optional_int32(1);
+  Any any;
+  ASSERT_TRUE(any.PackFrom(payload));
+  std::string value = any.value();
+
+  CachedAny<TestEmptyMessage> cached(&any);
+  EXPECT_EQ(cached.Get(), nullptr);
+  EXPECT_EQ(cached.Mutable(), nullptr);
+  EXPECT_TRUE(cached.Flush());
+  EXPECT_EQ(any.value(), value);
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,674 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/compact_struct.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/json/internal/lexer.h"
+#include "google/protobuf/json/internal/message_path.h"
+#include "google/protobuf/message_lite.h"
+#include "google/protobuf/struct.pb.h"
+#include "google/protobuf/utf8_util.h"
+#include "google/protobuf/wire_format_lite.h"
+#include "google/protobuf/stubs/status_macros.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::google::protobuf::internal::WireFormatLite;
+using ::google::protobuf::io::CodedInputStream;
+using ::google::protobuf::io::CodedOutputStream;
+
+// Tags of the fields of Struct, its map entries, ListValue and Value.
+constexpr uint32_t kFieldsTag = 0x0a;
+constexpr uint32_t kKeyTag = 0x0a;
+constexpr uint32_t kValueTag = 0x12;
+constexpr uint32_t kValuesTag = 0x0a;
+constexpr uint32_t kNullValueTag = 0x08;
+constexpr uint32_t kNumberValueTag = 0x11;
+constexpr uint32_t kStringValueTag = 0x1a;
+constexpr uint32_t kBoolValueTag = 0x20;
+constexpr uint32_t kStructValueTag = 0x2a;
+constexpr uint32_t kListValueTag = 0x32;
+
+// The name of nodes that are not fields of a struct.
+constexpr uint32_t kNoName = 0;
+
+// Returns the size of a length-delimited field with a one-byte tag.
+size_t DelimitedSize(size_t size) {
+  return 1 + CodedOutputStream::VarintSize64(size) + size;
+}
+
+uint8_t* WriteDelimitedHeader(uint32_t tag, size_t size, uint8_t* target) {
+  *target++ = static_cast<uint8_t>(tag);
+  return CodedOutputStream::WriteVarint64ToArray(size, target);
+}
+
+// Reads the contents of a length-delimited field of `data`, which `input`
+// reads, into `out`.
+bool ReadDelimited(CodedInputStream& input, absl::string_view data,
+                   absl::string_view* out) {
+  uint32_t size;
+  if (!input.ReadVarint32(&size)) return false;
+  size_t offset = static_cast<size_t>(input.CurrentPosition());
+  if (size > data.size() - offset) return false;
+  *out = data.substr(offset, size);
+  return input.Skip(static_cast<int>(size));
+}
+
+const uint8_t* Bytes(absl::string_view data) {
+  return reinterpret_cast<const uint8_t*>(data.data());
+}
+
+}  // namespace
+
+// Appends nodes to a CompactStruct in pre-order.
+class CompactStruct::Builder {
+ public:
+  explicit Builder(CompactStruct& out) : out_(out) {
+    out_.nodes_.clear();
+    out_.names_.clear();
+    out_.chars_.clear();
+  }
+
+  absl::Status ParseJson(json_internal::JsonLexer& lex, uint32_t name);
+  absl::Status ParseJsonStruct(json_internal::JsonLexer& lex, uint32_t name);
+
+  // Parses the serialized Structs in `chunks` into a new struct, merging them
+  // as the generated parser would.
+  bool ParseWireStruct(uint32_t name,
+                       const std::vector<absl::string_view>& chunks, int depth);
+  // Parses a serialized Value.
+  bool ParseWireValue(uint32_t name, absl::string_view data, int depth);
+
+  void FromStruct(uint32_t name, const Struct& message);
+  void FromValue(uint32_t name, const Value& value);
+
+ private:
+  uint32_t Intern(absl::string_view name) {
+    auto it = name_index_.find(name);
+    if (it != name_index_.end()) return it->second;
+    uint32_t index = static_cast<uint32_t>(out_.names_.size());
+    out_.names_.push_back(AppendChars(name));
+    name_index_.emplace(name, index);
+    return index;
+  }
+
+  Chars AppendChars(absl::string_view value) {
+    Chars range = {static_cast<uint32_t>(out_.chars_.size()),
+                   static_cast<uint32_t>(value.size())};
+    out_.chars_.append(value.data(), value.size());
+    return range;
+  }
+
+  Node& Add(Kind kind, uint32_t name) {
+    out_.nodes_.emplace_back();
+    Node& node = out_.nodes_.back();
+    node.kind = kind;
+    node.name = name;
+    return node;
+  }
+
+  void AddString(uint32_t name, absl::string_view value) {
+    Chars range = AppendChars(value);
+    Add(Kind::kString, name).string = range;
+  }
+
+  // Adds a struct or list, whose children are the nodes added until Close().
+  uint32_t Open(Kind kind, uint32_t name) {
+    uint32_t index = static_cast<uint32_t>(out_.nodes_.size());
+    Add(kind, name).children = {0, 0};
+    return index;
+  }
+
+  void Close(uint32_t index) {
+    uint32_t end = static_cast<uint32_t>(out_.nodes_.size());
+    uint32_t size = 0;
+    for (uint32_t i = index + 1; i < end; i = out_.Next(i)) ++size;
+    out_.nodes_[index].children = {size, end};
+  }
+
+  // Removes the field named `name` from the open struct `index`. Its strings
+  // stay in `chars_`.
+  void RemoveField(uint32_t index, uint32_t name) {
+    std::vector<Node>& nodes = out_.nodes_;
+    for (uint32_t i = index + 1; i < nodes.size(); i = out_.Next(i)) {
+      if (nodes[i].name != name) continue;
+      uint32_t end = out_.Next(i);
+      nodes.erase(nodes.begin() + i, nodes.begin() + end);
+      for (uint32_t j = i; j < nodes.size(); ++j) {
+        if (nodes[j].kind == Kind::kStruct || nodes[j].kind == Kind::kList) {
+          nodes[j].children.end -= end - i;
+        }
+      }
+      return;
+    }
+  }
+
+  bool ParseWireStructInto(uint32_t index, absl::string_view data,
+                           absl::flat_hash_set<uint32_t>& seen, int depth);
+  bool ParseWireList(uint32_t name,
+                     const std::vector<absl::string_view>& chunks, int depth);
+
+  CompactStruct& out_;
+  absl::flat_hash_map<std::string, uint32_t> name_index_;
+};
+
+absl::Status CompactStruct::Builder::ParseJson(json_internal::JsonLexer& lex,
+                                               uint32_t name) {
+  auto kind = lex.PeekKind();
+  RETURN_IF_ERROR(kind.status());
+  switch (*kind) {
+    case json_internal::JsonLexer::kNull:
+      RETURN_IF_ERROR(lex.Expect("null"));
+      Add(Kind::kNull, name);
+      break;
+    case json_internal::JsonLexer::kNum: {
+      auto number = lex.ParseNumber();
+      RETURN_IF_ERROR(number.status());
+      Add(Kind::kNumber, name).number = number->value;
+      break;
+    }
+    case json_internal::JsonLexer::kStr: {
+      auto str = lex.ParseUtf8();
+      RETURN_IF_ERROR(str.status());
+      AddString(name, str->value.AsView());
+      break;
+    }
+    case json_internal::JsonLexer::kTrue:
+      RETURN_IF_ERROR(lex.Expect("true"));
+      Add(Kind::kBool, name).boolean = true;
+      break;
+    case json_internal::JsonLexer::kFalse:
+      RETURN_IF_ERROR(lex.Expect("false"));
+      Add(Kind::kBool, name).boolean = false;
+      break;
+    case json_internal::JsonLexer::kObj:
+      return ParseJsonStruct(lex, name);
+    case json_internal::JsonLexer::kArr: {
+      uint32_t index = Open(Kind::kList, name);
+      RETURN_IF_ERROR(lex.VisitArray([&] { return ParseJson(lex, kNoName); }));
+      Close(index);
+      break;
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status CompactStruct::Builder::ParseJsonStruct(
+    json_internal::JsonLexer& lex, uint32_t name) {
+  uint32_t index = Open(Kind::kStruct, name);
+  absl::flat_hash_set<uint32_t> seen;
+  RETURN_IF_ERROR(lex.VisitObject(
+      [&](json_internal::LocationWith<json_internal::MaybeOwnedString>& key)
+          -> absl::Status {
+        uint32_t field = Intern(key.value.AsView());
+        if (!seen.insert(field).second) {
+          return key.loc.Invalid(
+              absl::StrFormat("got unexpectedly-repeated repeated map key: '%s'",
+                              key.value.AsView()));
+        }
+        return ParseJson(lex, field);
+      }));
+  Close(index);
+  return absl::OkStatus();
+}
+
+bool CompactStruct::Builder::ParseWireStruct(
+    uint32_t name, const std::vector<absl::string_view>& chunks, int depth) {
+  if (depth > CodedInputStream::GetDefaultRecursionLimit()) return false;
+  uint32_t index = Open(Kind::kStruct, name);
+  absl::flat_hash_set<uint32_t> seen;
+  for (absl::string_view chunk : chunks) {
+    if (!ParseWireStructInto(index, chunk, seen, depth)) return false;
+  }
+  Close(index);
+  return true;
+}
+
+bool CompactStruct::Builder::ParseWireStructInto(
+    uint32_t index, absl::string_view data,
+    absl::flat_hash_set<uint32_t>& seen, int depth) {
+  CodedInputStream input(Bytes(data), static_cast<int>(data.size()));
+  while (uint32_t tag = input.ReadTag()) {
+    if (tag != kFieldsTag) {
+      if (!WireFormatLite::SkipField(&input, tag)) return false;
+      continue;
+    }
+    absl::string_view entry;
+    if (!ReadDelimited(input, data, &entry)) return false;
+    absl::string_view key;
+    absl::string_view value;
+    CodedInputStream entry_input(Bytes(entry), static_cast<int>(entry.size()));
+    while (uint32_t entry_tag = entry_input.ReadTag()) {
+      if (entry_tag == kKeyTag) {
+        if (!ReadDelimited(entry_input, entry, &key)) return false;
+      } else if (entry_tag == kValueTag) {
+        if (!ReadDelimited(entry_input, entry, &value)) return false;
+      } else if (!WireFormatLite::SkipField(&entry_input, entry_tag)) {
+        return false;
+      }
+    }
+    if (!entry_input.ConsumedEntireMessage()) return false;
+    if (!internal::IsValidUtf8(key)) return false;
+    // A later entry with the same key replaces the earlier one.
+    uint32_t field = Intern(key);
+    if (!seen.insert(field).second) RemoveField(index, field);
+    if (!ParseWireValue(field, value, depth + 1)) return false;
+  }
+  return input.ConsumedEntireMessage();
+}
+
+bool CompactStruct::Builder::ParseWireList(
+    uint32_t name, const std::vector<absl::string_view>& chunks, int depth) {
+  if (depth > CodedInputStream::GetDefaultRecursionLimit()) return false;
+  uint32_t index = Open(Kind::kList, name);
+  for (absl::string_view chunk : chunks) {
+    CodedInputStream input(Bytes(chunk), static_cast<int>(chunk.size()));
+    while (uint32_t tag = input.ReadTag()) {
+      if (tag != kValuesTag) {
+        if (!WireFormatLite::SkipField(&input, tag)) return false;
+        continue;
+      }
+      absl::string_view value;
+      if (!ReadDelimited(input, chunk, &value)) return false;
+      if (!ParseWireValue(kNoName, value, depth + 1)) return false;
+    }
+    if (!input.ConsumedEntireMessage()) return false;
+  }
+  Close(index);
+  return true;
+}
+
+bool CompactStruct::Builder::ParseWireValue(uint32_t name,
+                                            absl::string_view data, int depth) {
+  if (depth > CodedInputStream::GetDefaultRecursionLimit()) return false;
+  // The last member of the kind oneof wins. Repeated struct_value or
+  // list_value members are merged.
+  Kind kind = Kind::kNull;
+  double number = 0;
+  bool boolean = false;
+  absl::string_view string;
+  std::vector<absl::string_view> chunks;
+  CodedInputStream input(Bytes(data), static_cast<int>(data.size()));
+  while (uint32_t tag = input.ReadTag()) {
+    switch (tag) {
+      case kNullValueTag: {
+        uint64_t unused;
+        if (!input.ReadVarint64(&unused)) return false;
+        kind = Kind::kNull;
+        break;
+      }
+      case kNumberValueTag: {
+        uint64_t bits;
+        if (!input.ReadLittleEndian64(&bits)) return false;
+        number = WireFormatLite::DecodeDouble(bits);
+        kind = Kind::kNumber;
+        break;
+      }
+      case kStringValueTag:
+        if (!ReadDelimited(input, data, &string)) return false;
+        kind = Kind::kString;
+        break;
+      case kBoolValueTag: {
+        uint64_t value;
+        if (!input.ReadVarint64(&value)) return false;
+        boolean = value != 0;
+        kind = Kind::kBool;
+        break;
+      }
+      case kStructValueTag:
+      case kListValueTag: {
+        Kind chunk_kind = tag == kStructValueTag ? Kind::kStruct : Kind::kList;
+        if (kind != chunk_kind) chunks.clear();
+        kind = chunk_kind;
+        chunks.emplace_back();
+        if (!ReadDelimited(input, data, &chunks.back())) return false;
+        break;
+      }
+      default:
+        if (!WireFormatLite::SkipField(&input, tag)) return false;
+        break;
+    }
+  }
+  if (!input.ConsumedEntireMessage()) return false;
+  switch (kind) {
+    case Kind::kNull:
+      Add(Kind::kNull, name);
+      break;
+    case Kind::kNumber:
+      Add(Kind::kNumber, name).number = number;
+      break;
+    case Kind::kString:
+      if (!internal::IsValidUtf8(string)) return false;
+      AddString(name, string);
+      break;
+    case Kind::kBool:
+      Add(Kind::kBool, name).boolean = boolean;
+      break;
+    case Kind::kStruct:
+      return ParseWireStruct(name, chunks, depth + 1);
+    case Kind::kList:
+      return ParseWireList(name, chunks, depth + 1);
+  }
+  return true;
+}
+
+void CompactStruct::Builder::FromStruct(uint32_t name, const Struct& message) {
+  uint32_t index = Open(Kind::kStruct, name);
+  for (const auto& field : message.fields()) {
+    FromValue(Intern(field.first), field.second);
+  }
+  Close(index);
+}
+
+void CompactStruct::Builder::FromValue(uint32_t name, const Value& value) {
+  switch (value.kind_case()) {
+    case Value::kNullValue:
+    case Value::KIND_NOT_SET:
+      Add(Kind::kNull, name);
+      break;
+    case Value::kNumberValue:
+      Add(Kind::kNumber, name).number = value.number_value();
+      break;
+    case Value::kStringValue:
+      AddString(name, value.string_value());
+      break;
+    case Value::kBoolValue:
+      Add(Kind::kBool, name).boolean = value.bool_value();
+      break;
+    case Value::kStructValue:
+      FromStruct(name, value.struct_value());
+      break;
+    case Value::kListValue: {
+      uint32_t index = Open(Kind::kList, name);
+      for (const Value& element : value.list_value().values()) {
+        FromValue(kNoName, element);
+      }
+      Close(index);
+      break;
+    }
+  }
+}
+
+CompactStruct::CompactStruct() {
+  Node root = {};
+  root.kind = Kind::kStruct;
+  root.children = {0, 1};
+  nodes_.push_back(root);
+}
+
+absl::StatusOr<CompactStruct> CompactStruct::ParseJson(absl::string_view json) {
+  json_internal::MessagePath path(Struct::descriptor()->full_name());
+  io::ArrayInputStream in(json.data(), static_cast<int>(json.size()));
+  json_internal::JsonLexer lex(&in, json_internal::ParseOptions(), &path);
+  CompactStruct result;
+  Builder builder(result);
+  RETURN_IF_ERROR(builder.ParseJsonStruct(lex, kNoName));
+  if (!lex.AtEof()) {
+    return absl::InvalidArgumentError(
+        "extraneous characters after end of JSON object");
+  }
+  return result;
+}
+
+absl::StatusOr<CompactStruct> CompactStruct::ParseFromString(
+    absl::string_view data) {
+  CompactStruct result;
+  Builder builder(result);
+  if (!builder.ParseWireStruct(kNoName, {data}, 0)) {
+    return absl::InvalidArgumentError(
+        "failed to parse serialized google.protobuf.Struct");
+  }
+  return result;
+}
+
+CompactStruct CompactStruct::FromStruct(const Struct& message) {
+  CompactStruct result;
+  Builder(result).FromStruct(kNoName, message);
+  return result;
+}
+
+void CompactStruct::ToStruct(Struct* message) const { ToStruct(0, message); }
+
+void CompactStruct::ToStruct(uint32_t index, Struct* message) const {
+  message->Clear();
+  auto& fields = *message->mutable_fields();
+  for (uint32_t i = index + 1; i < nodes_[index].children.end; i = Next(i)) {
+    ToValue(i, &fields[std::string(chars(names_[nodes_[i].name]))]);
+  }
+}
+
+void CompactStruct::ToValue(uint32_t index, Value* value) const {
+  const Node& node = nodes_[index];
+  switch (node.kind) {
+    case Kind::kNull:
+      value->set_null_value(NULL_VALUE);
+      break;
+    case Kind::kNumber:
+      value->set_number_value(node.number);
+      break;
+    case Kind::kString:
+      value->set_string_value(std::string(chars(node.string)));
+      break;
+    case Kind::kBool:
+      value->set_bool_value(node.boolean);
+      break;
+    case Kind::kStruct:
+      ToStruct(index, value->mutable_struct_value());
+      break;
+    case Kind::kList: {
+      ListValue* list = value->mutable_list_value();
+      list->Clear();
+      list->mutable_values()->Reserve(static_cast<int>(node.children.size));
+      for (uint32_t i = index + 1; i < node.children.end; i = Next(i)) {
+        ToValue(i, list->add_values());
+      }
+      break;
+    }
+  }
+}
+
+size_t CompactStruct::ValueSize(uint32_t index,
+                                const std::vector<size_t>& sizes) const {
+  const Node& node = nodes_[index];
+  switch (node.kind) {
+    case Kind::kNull:
+    case Kind::kBool:
+      return 2;
+    case Kind::kNumber:
+      return 1 + sizeof(uint64_t);
+    case Kind::kString:
+      return DelimitedSize(node.string.size);
+    case Kind::kStruct:
+    case Kind::kList:
+      return DelimitedSize(sizes[index]);
+  }
+  return 0;
+}
+
+size_t CompactStruct::ComputeSizes(uint32_t index,
+                                   std::vector<size_t>& sizes) const {
+  const Node& node = nodes_[index];
+  if (node.kind != Kind::kStruct && node.kind != Kind::kList) {
+    return ValueSize(index, sizes);
+  }
+  size_t size = 0;
+  for (uint32_t i = index + 1; i < node.children.end; i = Next(i)) {
+    size_t value_size = DelimitedSize(ComputeSizes(i, sizes));
+    if (node.kind == Kind::kStruct) {
+      size_t entry_size =
+          DelimitedSize(names_[nodes_[i].name].size) + value_size;
+      size += DelimitedSize(entry_size);
+    } else {
+      size += value_size;
+    }
+  }
+  sizes[index] = size;
+  return ValueSize(index, sizes);
+}
+
+uint8_t* CompactStruct::WriteChildren(uint32_t index,
+                                      const std::vector<size_t>& sizes,
+                                      uint8_t* target) const {
+  const Node& node = nodes_[index];
+  for (uint32_t i = index + 1; i < node.children.end; i = Next(i)) {
+    size_t value_size = ValueSize(i, sizes);
+    if (node.kind == Kind::kStruct) {
+      absl::string_view name = chars(names_[nodes_[i].name]);
+      target = WriteDelimitedHeader(
+          kFieldsTag, DelimitedSize(name.size()) + DelimitedSize(value_size),
+          target);
+      target = WriteDelimitedHeader(kKeyTag, name.size(), target);
+      std::memcpy(target, name.data(), name.size());
+      target += name.size();
+      target = WriteDelimitedHeader(kValueTag, value_size, target);
+    } else {
+      target = WriteDelimitedHeader(kValuesTag, value_size, target);
+    }
+    target = WriteValue(i, sizes, target);
+  }
+  return target;
+}
+
+uint8_t* CompactStruct::WriteValue(uint32_t index,
+                                   const std::vector<size_t>& sizes,
+                                   uint8_t* target) const {
+  const Node& node = nodes_[index];
+  switch (node.kind) {
+    case Kind::kNull:
+      *target++ = kNullValueTag;
+      *target++ = 0;
+      return target;
+    case Kind::kNumber:
+      *target++ = kNumberValueTag;
+      return CodedOutputStream::WriteLittleEndian64ToArray(
+          WireFormatLite::EncodeDouble(node.number), target);
+    case Kind::kString: {
+      absl::string_view value = chars(node.string);
+      target = WriteDelimitedHeader(kStringValueTag, value.size(), target);
+      std::memcpy(target, value.data(), value.size());
+      return target + value.size();
+    }
+    case Kind::kBool:
+      *target++ = kBoolValueTag;
+      *target++ = node.boolean ? 1 : 0;
+      return target;
+    case Kind::kStruct:
+    case Kind::kList:
+      target = WriteDelimitedHeader(
+          node.kind == Kind::kStruct ? kStructValueTag : kListValueTag,
+          sizes[index], target);
+      return WriteChildren(index, sizes, target);
+  }
+  return target;
+}
+
+std::string CompactStruct::SerializeAsString() const {
+  std::vector<size_t> sizes(nodes_.size());
+  ComputeSizes(0, sizes);
+  std::string result;
+  result.resize(sizes[0]);
+  uint8_t* end = WriteChildren(
+      0, sizes, reinterpret_cast<uint8_t*>(&result[0]));
+  ABSL_DCHECK_EQ(end - reinterpret_cast<uint8_t*>(&result[0]),
+                 static_cast<ptrdiff_t>(result.size()));
+  return result;
+}
+
+size_t CompactStruct::ByteSizeLong() const {
+  std::vector<size_t> sizes(nodes_.size());
+  ComputeSizes(0, sizes);
+  return sizes[0];
+}
+
+size_t CompactStruct::SpaceUsedExcludingSelfLong() const {
+  return nodes_.capacity() * sizeof(Node) + names_.capacity() * sizeof(Chars) +
+         internal::StringSpaceUsedExcludingSelfLong(chars_);
+}
+
+CompactStruct::Kind CompactStruct::ValueView::kind() const {
+  return owner_ == nullptr ? Kind::kNull : owner_->nodes_[index_].kind;
+}
+
+double CompactStruct::ValueView::number_value() const {
+  return kind() == Kind::kNumber ? owner_->nodes_[index_].number : 0;
+}
+
+absl::string_view CompactStruct::ValueView::string_value() const {
+  return kind() == Kind::kString ? owner_->chars(owner_->nodes_[index_].string)
+                                 : absl::string_view();
+}
+
+bool CompactStruct::ValueView::bool_value() const {
+  return kind() == Kind::kBool && owner_->nodes_[index_].boolean;
+}
+
+size_t CompactStruct::ValueView::size() const {
+  Kind k = kind();
+  return k == Kind::kStruct || k == Kind::kList
+             ? owner_->nodes_[index_].children.size
+             : 0;
+}
+
+void CompactStruct::ValueView::ForEachField(
+    absl::FunctionRef<void(absl::string_view name, ValueView value)> f) const {
+  if (kind() != Kind::kStruct) return;
+  const std::vector<Node>& nodes = owner_->nodes_;
+  for (uint32_t i = index_ + 1; i < nodes[index_].children.end;
+       i = owner_->Next(i)) {
+    f(owner_->chars(owner_->names_[nodes[i].name]), ValueView(owner_, i));
+  }
+}
+
+void CompactStruct::ValueView::ForEachElement(
+    absl::FunctionRef<void(ValueView value)> f) const {
+  if (kind() != Kind::kList) return;
+  const std::vector<Node>& nodes = owner_->nodes_;
+  for (uint32_t i = index_ + 1; i < nodes[index_].children.end;
+       i = owner_->Next(i)) {
+    f(ValueView(owner_, i));
+  }
+}
+
+CompactStruct::ValueView CompactStruct::ValueView::Find(
+    absl::string_view name) const {
+  if (kind() != Kind::kStruct) return ValueView();
+  const std::vector<Node>& nodes = owner_->nodes_;
+  for (uint32_t i = index_ + 1; i < nodes[index_].children.end;
+       i = owner_->Next(i)) {
+    if (owner_->chars(owner_->names_[nodes[i].name]) == name) {
+      return ValueView(owner_, i);
+    }
+  }
+  return ValueView();
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,197 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Defines CompactStruct, an immutable google.protobuf.Struct stored in a few
+// flat arrays instead of a tree of map entries and Value messages.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_COMPACT_STRUCT_H__
+#define GOOGLE_PROTOBUF_UTIL_COMPACT_STRUCT_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/struct.pb.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+// A google.protobuf.Struct held as an array of 16-byte nodes in pre-order, a
+// table of distinct field names, and one buffer of string values. A Struct
+// message allocates a map node, a key string and a Value message per field,
+// plus a map or ListValue per nested object or array; a CompactStruct makes a
+// handful of allocations regardless of its size, and stores each distinct
+// field name once however many objects use it.
+//
+// A CompactStruct is parsed from JSON or from the wire format of Struct, or
+// converted from a Struct, and serializes to the wire format of Struct without
+// building the message. ToStruct() converts it back where the generated API is
+// needed. Values with no kind set are read as null values, and unknown fields
+// are dropped.
+//
+// Example:
+//
+//   absl::StatusOr<util::CompactStruct> doc =
+//       util::CompactStruct::ParseJson(R"({"id": 7, "tags": ["a", "b"]})");
+//   if (!doc.ok()) { ... }
+//   double id = doc->root().Find("id").number_value();
+//   std::string bytes = doc->SerializeAsString();  // A serialized Struct.
+class PROTOBUF_EXPORT CompactStruct {
+ public:
+  // The kinds of google.protobuf.Value.
+  enum class Kind : uint8_t {
+    kNull,
+    kNumber,
+    kString,
+    kBool,
+    kStruct,
+    kList,
+  };
+
+  // A read-only view of one value of a CompactStruct. A default-constructed
+  // view, or one returned by a failed Find(), is a null value.
+  class ValueView {
+   public:
+    ValueView() = default;
+
+    Kind kind() const;
+
+    // The value, or zero, empty or false if the value is of another kind.
+    double number_value() const;
+    absl::string_view string_value() const;
+    bool bool_value() const;
+
+    // The number of fields of a struct or elements of a list, or zero.
+    size_t size() const;
+
+    // Calls `f` with each field of a struct, in order.
+    void ForEachField(
+        absl::FunctionRef<void(absl::string_view name, ValueView value)> f)
+        const;
+
+    // Calls `f` with each element of a list, in order.
+    void ForEachElement(absl::FunctionRef<void(ValueView value)> f) const;
+
+    // Returns the field named `name` of a struct, or a null value if there is
+    // none. Takes time linear in the number of fields.
+    ValueView Find(absl::string_view name) const;
+
+   private:
+    friend class CompactStruct;
+
+    ValueView(const CompactStruct* owner, uint32_t index)
+        : owner_(owner), index_(index) {}
+
+    const CompactStruct* owner_ = nullptr;
+    uint32_t index_ = 0;
+  };
+
+  // An empty struct.
+  CompactStruct();
+
+  // Parses a JSON object, as JsonStringToMessage() would into a Struct.
+  static absl::StatusOr<CompactStruct> ParseJson(absl::string_view json);
+
+  // Parses a serialized google.protobuf.Struct.
+  static absl::StatusOr<CompactStruct> ParseFromString(absl::string_view data);
+
+  static CompactStruct FromStruct(const Struct& message);
+
+  // The top-level struct.
+  ValueView root() const { return ValueView(this, 0); }
+
+  // Replaces the contents of `message` with this struct. `message` may be on
+  // an arena.
+  void ToStruct(Struct* message) const;
+
+  // Returns the struct serialized as a google.protobuf.Struct, with fields in
+  // the order they were added.
+  std::string SerializeAsString() const;
+  size_t ByteSizeLong() const;
+
+  // The memory used by the struct, not counting sizeof(CompactStruct).
+  size_t SpaceUsedExcludingSelfLong() const;
+
+ private:
+  class Builder;
+
+  // A range of `chars_`.
+  struct Chars {
+    uint32_t offset;
+    uint32_t size;
+  };
+
+  // The fields of a struct or the elements of a list directly follow it.
+  struct Children {
+    // The number of fields or elements.
+    uint32_t size;
+    // The index of the first node after the container and its children.
+    uint32_t end;
+  };
+
+  struct Node {
+    Kind kind;
+    // For fields of a struct, the index of the field name in `names_`.
+    uint32_t name;
+    union {
+      double number;
+      bool boolean;
+      Chars string;
+      Children children;
+    };
+  };
+  static_assert(sizeof(Node) == 16, "");
+
+  absl::string_view chars(Chars range) const {
+    return absl::string_view(chars_).substr(range.offset, range.size);
+  }
+  // The index of the node after node `index` and its children.
+  uint32_t Next(uint32_t index) const {
+    const Node& node = nodes_[index];
+    return node.kind == Kind::kStruct || node.kind == Kind::kList
+               ? node.children.end
+               : index + 1;
+  }
+
+  void ToStruct(uint32_t index, Struct* message) const;
+  void ToValue(uint32_t index, Value* value) const;
+
+  // Returns the serialized size of node `index` as a Value, given the sizes
+  // computed by ComputeSizes().
+  size_t ValueSize(uint32_t index, const std::vector<size_t>& sizes) const;
+  // Sets `sizes[i]` to the serialized size of the fields or elements of each
+  // struct or list node i at or under `index`, and returns the serialized size
+  // of node `index` as a Value.
+  size_t ComputeSizes(uint32_t index, std::vector<size_t>& sizes) const;
+  // Writes the fields or elements of struct or list node `index`.
+  uint8_t* WriteChildren(uint32_t index, const std::vector<size_t>& sizes,
+                         uint8_t* target) const;
+  // Writes node `index` as a Value.
+  uint8_t* WriteValue(uint32_t index, const std::vector<size_t>& sizes,
+                      uint8_t* target) const;
+
+  std::vector<Node> nodes_;
+  // The distinct field names.
+  std::vector<Chars> names_;
+  std::string chars_;
+};
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_COMPACT_STRUCT_H__
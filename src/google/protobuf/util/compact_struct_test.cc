@@ -0,0 +1,144 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/compact_struct.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "google/protobuf/json/json.h"
+#include "google/protobuf/struct.pb.h"
+#include "google/protobuf/util/message_differencer.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+constexpr absl::string_view kJson = R"json({
+  "id": 7,
+  "name": "document",
+  "draft": false,
+  "parent": null,
+  "tags": ["a", "b", 3, [true], {}],
+  "items": [{"id": 1, "name": "x"}, {"id": 2, "name": "y"}],
+  "meta": {"owner": {"id": 9}, "empty": []}
+})json";
+
+Struct ParseStruct(absl::string_view json) {
+  Struct message;
+  EXPECT_TRUE(json::JsonStringToMessage(json, &message).ok());
+  return message;
+}
+
+TEST(CompactStructTest, ParsesJsonLikeStruct) {
+  absl::StatusOr<CompactStruct> compact = CompactStruct::ParseJson(kJson);
+  ASSERT_TRUE(compact.ok()) << compact.status();
+  Struct message;
+  compact->ToStruct(&message);
+  EXPECT_TRUE(MessageDifferencer::Equals(message, ParseStruct(kJson)));
+}
+
+TEST(CompactStructTest, ReadsValues) {
+  absl::StatusOr<CompactStruct> compact = CompactStruct::ParseJson(kJson);
+  ASSERT_TRUE(compact.ok()) << compact.status();
+  CompactStruct::ValueView root = compact->root();
+  EXPECT_EQ(root.kind(), CompactStruct::Kind::kStruct);
+  EXPECT_EQ(root.size(), 7);
+  EXPECT_EQ(root.Find("id").number_value(), 7);
+  EXPECT_EQ(root.Find("name").string_value(), "document");
+  EXPECT_EQ(root.Find("draft").kind(), CompactStruct::Kind::kBool);
+  EXPECT_EQ(root.Find("parent").kind(), CompactStruct::Kind::kNull);
+  EXPECT_EQ(root.Find("missing").kind(), CompactStruct::Kind::kNull);
+  EXPECT_EQ(root.Find("meta").Find("owner").Find("id").number_value(), 9);
+
+  std::vector<std::string> names;
+  root.ForEachField([&](absl::string_view name, CompactStruct::ValueView) {
+    names.emplace_back(name);
+  });
+  EXPECT_EQ(names, (std::vector<std::string>{"id", "name", "draft", "parent",
+                                             "tags", "items", "meta"}));
+
+  std::vector<CompactStruct::Kind> kinds;
+  root.Find("tags").ForEachElement(
+      [&](CompactStruct::ValueView value) { kinds.push_back(value.kind()); });
+  EXPECT_EQ(kinds, (std::vector<CompactStruct::Kind>{
+                       CompactStruct::Kind::kString,
+                       CompactStruct::Kind::kString,
+                       CompactStruct::Kind::kNumber,
+                       CompactStruct::Kind::kList,
+                       CompactStruct::Kind::kStruct,
+                   }));
+}
+
+TEST(CompactStructTest, SerializesAsStruct) {
+  absl::StatusOr<CompactStruct> compact = CompactStruct::ParseJson(kJson);
+  ASSERT_TRUE(compact.ok()) << compact.status();
+  std::string data = compact->SerializeAsString();
+  EXPECT_EQ(data.size(), compact->ByteSizeLong());
+
+  Struct message;
+  ASSERT_TRUE(message.ParseFromString(data));
+  EXPECT_TRUE(MessageDifferencer::Equals(message, ParseStruct(kJson)));
+}
+
+TEST(CompactStructTest, ParsesSerializedStruct) {
+  Struct expected = ParseStruct(kJson);
+  absl::StatusOr<CompactStruct> compact =
+      CompactStruct::ParseFromString(expected.SerializeAsString());
+  ASSERT_TRUE(compact.ok()) << compact.status();
+  Struct message;
+  compact->ToStruct(&message);
+  EXPECT_TRUE(MessageDifferencer::Equals(message, expected));
+
+  EXPECT_FALSE(CompactStruct::ParseFromString("\x0a\x05\x0a").ok());
+}
+
+TEST(CompactStructTest, LaterSerializedFieldsReplaceEarlierOnes) {
+  Struct first = ParseStruct(R"({"a": {"x": 1}, "b": [1, 2], "c": "c"})");
+  Struct second = ParseStruct(R"({"a": "replaced", "b": [3]})");
+  std::string data = first.SerializeAsString() + second.SerializeAsString();
+
+  Struct expected;
+  ASSERT_TRUE(expected.ParseFromString(data));
+  absl::StatusOr<CompactStruct> compact = CompactStruct::ParseFromString(data);
+  ASSERT_TRUE(compact.ok()) << compact.status();
+  EXPECT_EQ(compact->root().size(), 3);
+  Struct message;
+  compact->ToStruct(&message);
+  EXPECT_TRUE(MessageDifferencer::Equals(message, expected));
+}
+
+TEST(CompactStructTest, ConvertsFromStruct) {
+  Struct expected = ParseStruct(kJson);
+  CompactStruct compact = CompactStruct::FromStruct(expected);
+  Struct message;
+  compact.ToStruct(&message);
+  EXPECT_TRUE(MessageDifferencer::Equals(message, expected));
+}
+
+TEST(CompactStructTest, RejectsInvalidJson) {
+  EXPECT_FALSE(CompactStruct::ParseJson("[]").ok());
+  EXPECT_FALSE(CompactStruct::ParseJson(R"({"a": 1, "a": 2})").ok());
+  EXPECT_FALSE(CompactStruct::ParseJson(R"({"a": 1} x)").ok());
+}
+
+TEST(CompactStructTest, EmptyStruct) {
+  CompactStruct compact;
+  EXPECT_EQ(compact.root().size(), 0);
+  EXPECT_EQ(compact.SerializeAsString(), "");
+  Struct message = ParseStruct(R"({"a": 1})");
+  compact.ToStruct(&message);
+  EXPECT_EQ(message.fields_size(), 0);
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
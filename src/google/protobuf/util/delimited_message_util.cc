@@ -10,6 +10,17 @@
 
 #include "google/protobuf/util/delimited_message_util.h"
 
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "absl/base/prefetch.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/types/span.h"
 #include "google/protobuf/io/coded_stream.h"
 
 namespace google {
@@ -101,6 +112,194 @@ bool SerializeDelimitedToCodedStream(const MessageLite& message,
   return true;
 }
 
+// ===================================================================
+
+DelimitedReader::DelimitedReader(io::ZeroCopyInputStream* input,
+                                 const MessageLite& prototype)
+    : DelimitedReader(input, prototype, Options()) {}
+
+DelimitedReader::DelimitedReader(io::ZeroCopyInputStream* input,
+                                 const MessageLite& prototype, Options options)
+    : input_(input), prototype_(prototype), options_(std::move(options)) {}
+
+DelimitedReader::~DelimitedReader() {
+  // Give back the bytes we have not consumed.
+  if (ptr_ != end_) input_->BackUp(static_cast<int>(end_ - ptr_));
+}
+
+bool DelimitedReader::Refill() {
+  const void* data;
+  int size;
+  do {
+    if (!input_->Next(&data, &size)) {
+      ptr_ = end_ = nullptr;
+      at_end_ = true;
+      return false;
+    }
+  } while (size == 0);
+  ptr_ = static_cast<const char*>(data);
+  end_ = ptr_ + size;
+  return true;
+}
+
+bool DelimitedReader::FillScratch(size_t size) {
+  while (scratch_.size() < size) {
+    if (ptr_ == end_ && !Refill()) return false;
+    size_t n = std::min(size - scratch_.size(), static_cast<size_t>(end_ - ptr_));
+    scratch_.append(ptr_, n);
+    ptr_ += n;
+  }
+  return true;
+}
+
+bool DelimitedReader::ScanRecord(bool may_refill) {
+  if (ptr_ == end_) {
+    if (!may_refill || at_end_ || !Refill()) return false;
+  }
+
+  // Fast path: the size and the record are both in the current buffer.
+  const char* p = ptr_;
+  uint64_t size = 0;
+  for (int shift = 0; p < end_ && shift < 35; shift += 7) {
+    uint8_t byte = static_cast<uint8_t>(*p++);
+    size |= uint64_t{byte & 0x7fu} << shift;
+    if (byte < 0x80) {
+      if (size <= static_cast<uint64_t>(end_ - p)) {
+        records_.push_back(absl::string_view(p, static_cast<size_t>(size)));
+        ptr_ = p + size;
+        return true;
+      }
+      break;
+    }
+  }
+  return may_refill && ScanSplitRecord();
+}
+
+bool DelimitedReader::ScanSplitRecord() {
+  // The input does not end here, so any failure below is an error.
+  error_ = true;
+  uint64_t size = 0;
+  for (int shift = 0;; shift += 7) {
+    if (shift == 35 || (ptr_ == end_ && !Refill())) return false;
+    uint8_t byte = static_cast<uint8_t>(*ptr_++);
+    size |= uint64_t{byte & 0x7fu} << shift;
+    if (byte < 0x80) break;
+  }
+  if (size > INT_MAX) return false;
+  if (size <= static_cast<uint64_t>(end_ - ptr_)) {
+    records_.push_back(absl::string_view(ptr_, static_cast<size_t>(size)));
+    ptr_ += size;
+  } else {
+    scratch_.clear();
+    if (!FillScratch(static_cast<size_t>(size))) return false;
+    records_.push_back(scratch_);
+  }
+  error_ = false;
+  return true;
+}
+
+bool DelimitedReader::ParseBatch() {
+  while (messages_.size() < records_.size()) {
+    messages_.push_back(prototype_.New(&arena_));
+  }
+  batch_ = absl::MakeConstSpan(messages_.data(), records_.size());
+
+  // Parses records [begin, end), each while the next one is being fetched
+  // into the cache.
+  auto parse = [this](size_t begin, size_t end) {
+    bool ok = true;
+    for (size_t i = begin; i < end; ++i) {
+      if (i + 1 < end) absl::PrefetchToLocalCache(records_[i + 1].data());
+      ok &= batch_[i]->ParseFromString(records_[i]);
+    }
+    return ok;
+  };
+
+  const size_t size = records_.size();
+  const size_t num_tasks =
+      options_.executor
+          ? size / static_cast<size_t>(std::max(1, options_.min_records_per_task))
+          : 1;
+  if (num_tasks < 2) return parse(0, size);
+
+  // Keep the first range for the calling thread.
+  const size_t per_task = (size + num_tasks - 1) / num_tasks;
+  const size_t num_ranges = (size + per_task - 1) / per_task;
+  std::atomic<bool> ok{true};
+  absl::BlockingCounter pending(static_cast<int>(num_ranges) - 1);
+  for (size_t begin = per_task; begin < size; begin += per_task) {
+    options_.executor([&parse, &ok, &pending, begin,
+                       end = std::min(begin + per_task, size)] {
+      if (!parse(begin, end)) ok.store(false, std::memory_order_relaxed);
+      pending.DecrementCount();
+    });
+  }
+  bool first_ok = parse(0, per_task);
+  pending.Wait();
+  return first_ok && ok.load(std::memory_order_relaxed);
+}
+
+bool DelimitedReader::NextBatch() {
+  batch_ = {};
+  records_.clear();
+  eof_ = false;
+  // Reusing messages is cheaper than creating them, but fields that grow
+  // leave garbage behind on the arena.
+  if (arena_.SpaceUsed() > options_.max_arena_size) {
+    messages_.clear();
+    arena_.Reset();
+  }
+  if (error_) return false;
+
+  const size_t max_batch_size =
+      static_cast<size_t>(std::max(1, options_.max_batch_size));
+  // Only the first record may make us move to the next buffer.
+  while (records_.size() < max_batch_size && ScanRecord(records_.empty())) {
+  }
+  if (records_.empty()) {
+    eof_ = !error_;
+    return false;
+  }
+  if (!ParseBatch()) {
+    error_ = true;
+    batch_ = {};
+    return false;
+  }
+  return true;
+}
+
+bool DelimitedReader::Next(MessageLite* message) {
+  batch_ = {};
+  records_.clear();
+  eof_ = false;
+  if (error_) return false;
+
+  if (!ScanRecord(true)) {
+    eof_ = !error_;
+    return false;
+  }
+  if (!message->MergeFromString(records_[0])) {
+    error_ = true;
+    return false;
+  }
+  return true;
+}
+
+// ===================================================================
+
+bool DelimitedWriter::Write(const MessageLite& message) {
+  return !output_.HadError() &&
+         SerializeDelimitedToCodedStream(message, &output_) &&
+         !output_.HadError();
+}
+
+bool DelimitedWriter::WriteBatch(absl::Span<const MessageLite* const> messages) {
+  for (const MessageLite* message : messages) {
+    if (!Write(*message)) return false;
+  }
+  return true;
+}
+
 }  // namespace util
 }  // namespace protobuf
 }  // namespace google
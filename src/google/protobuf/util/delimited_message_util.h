@@ -11,8 +11,15 @@
 #ifndef GOOGLE_PROTOBUF_UTIL_DELIMITED_MESSAGE_UTIL_H__
 #define GOOGLE_PROTOBUF_UTIL_DELIMITED_MESSAGE_UTIL_H__
 
+#include <cstddef>
+#include <functional>
 #include <ostream>
+#include <string>
+#include <vector>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
 #include "google/protobuf/message_lite.h"
@@ -76,6 +83,130 @@ bool PROTOBUF_EXPORT SerializeDelimitedToZeroCopyStream(
 bool PROTOBUF_EXPORT SerializeDelimitedToCodedStream(
     const MessageLite& message, io::CodedOutputStream* output);
 
+// Reads a long sequence of size-delimited messages, as written by
+// SerializeDelimitedToZeroCopyStream(), in batches.
+//
+// Unlike repeated calls to ParseDelimitedFromZeroCopyStream(), the reader
+// keeps its position in the stream's current buffer between messages, so no
+// CodedInputStream is created per message and records that lie within one
+// buffer are parsed in place.  The length prefixes of a batch are scanned
+// before any of its records is parsed, so each record's bytes are prefetched
+// while the previous record is being parsed, and with an executor set the
+// records of a batch are parsed concurrently.
+//
+// Typical usage:
+//   DelimitedReader reader(&input, MyRecord::default_instance());
+//   while (reader.NextBatch()) {
+//     for (const MessageLite* record : reader.batch()) {
+//       Process(static_cast<const MyRecord&>(*record));
+//     }
+//   }
+//   if (!reader.eof()) HandleError();
+class PROTOBUF_EXPORT DelimitedReader {
+ public:
+  struct Options {
+    // The most records NextBatch() returns at once.  Batches also end at
+    // buffer boundaries of the input stream.
+    int max_batch_size = 1024;
+
+    // If set, runs `task`, typically on another thread, so that the records
+    // of a batch are parsed concurrently.  All tasks are waited for before
+    // NextBatch() returns, so the executor must not run them on the calling
+    // thread after it blocks.
+    std::function<void(std::function<void()> task)> executor;
+
+    // Batches are split into tasks of at least this many records.  Smaller
+    // batches are parsed on the calling thread.
+    int min_records_per_task = 64;
+
+    // The messages of a batch are reused by later batches.  If the arena
+    // holding them has grown beyond this many bytes when a batch starts, it
+    // is reset and the messages are created anew.
+    size_t max_arena_size = size_t{8} << 20;
+  };
+
+  // Reads messages of the type of `prototype` from `input`.  Neither is
+  // owned; both must outlive the reader.  Once the reader is destroyed,
+  // `input` is positioned right after the last record that was read.
+  DelimitedReader(io::ZeroCopyInputStream* input, const MessageLite& prototype);
+  DelimitedReader(io::ZeroCopyInputStream* input, const MessageLite& prototype,
+                  Options options);
+  DelimitedReader(const DelimitedReader&) = delete;
+  DelimitedReader& operator=(const DelimitedReader&) = delete;
+  ~DelimitedReader();
+
+  // Reads and parses the next batch of records into messages owned by the
+  // reader, which are reused by the next call to NextBatch().  Returns false
+  // if no record could be read, at the end of the input or on an error; see
+  // eof().  A batch is discarded if any of its records fails to parse.
+  bool NextBatch();
+
+  // The messages read by the last successful call to NextBatch().
+  absl::Span<MessageLite* const> batch() const { return batch_; }
+
+  // Reads the next record into `message`, like
+  // ParseDelimitedFromZeroCopyStream().  Invalidates batch().
+  bool Next(MessageLite* message);
+
+  // True if the last read returned false because the input ended cleanly
+  // between records.
+  bool eof() const { return eof_; }
+
+ private:
+  // Scans the next record and adds it to records_.  Only fetches a new
+  // buffer from input_ if `may_refill`, since that invalidates the records
+  // found so far.  Returns false, and leaves records_ alone, if the batch
+  // must end before the next record.
+  bool ScanRecord(bool may_refill);
+  // Copies a record that crosses buffer boundaries into scratch_.
+  bool ScanSplitRecord();
+  // Moves bytes from the stream to scratch_ until it holds `size` bytes.
+  bool FillScratch(size_t size);
+  // Advances input_ to its next non-empty buffer.
+  bool Refill();
+  bool ParseBatch();
+
+  io::ZeroCopyInputStream* const input_;
+  const MessageLite& prototype_;
+  const Options options_;
+
+  // The unread part of input_'s current buffer.
+  const char* ptr_ = nullptr;
+  const char* end_ = nullptr;
+  // Set once input_ is exhausted.
+  bool at_end_ = false;
+  // Set once an error was found; all further reads fail.
+  bool error_ = false;
+  bool eof_ = false;
+
+  std::vector<absl::string_view> records_;
+  // Holds the one record per batch that crosses buffer boundaries.
+  std::string scratch_;
+  Arena arena_;
+  // Messages on arena_, reused from batch to batch.
+  std::vector<MessageLite*> messages_;
+  absl::Span<MessageLite* const> batch_;
+};
+
+// Writes size-delimited messages to one stream.  Cheaper than repeated calls
+// to SerializeDelimitedToZeroCopyStream(), which create a CodedOutputStream
+// for every message.
+class PROTOBUF_EXPORT DelimitedWriter {
+ public:
+  // `output` is not owned and must outlive the writer.  Data may stay
+  // buffered until the writer is destroyed.
+  explicit DelimitedWriter(io::ZeroCopyOutputStream* output) : output_(output) {}
+  DelimitedWriter(const DelimitedWriter&) = delete;
+  DelimitedWriter& operator=(const DelimitedWriter&) = delete;
+
+  // Returns false on error; all further writes then fail too.
+  bool Write(const MessageLite& message);
+  bool WriteBatch(absl::Span<const MessageLite* const> messages);
+
+ private:
+  io::CodedOutputStream output_;
+};
+
 }  // namespace util
 }  // namespace protobuf
 }  // namespace google
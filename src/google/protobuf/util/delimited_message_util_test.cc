@@ -10,10 +10,15 @@
 
 #include "google/protobuf/util/delimited_message_util.h"
 
+#include <functional>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "google/protobuf/testing/googletest.h"
 #include <gtest/gtest.h>
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/test_util.h"
 #include "google/protobuf/unittest.pb.h"
 
@@ -88,6 +93,113 @@ TEST(DelimitedMessageUtilTest, FailsAtEndOfStream) {
   }
 }
 
+// Writes `count` records of varying sizes.
+std::string WriteRecords(int count) {
+  std::string data;
+  {
+    io::StringOutputStream output(&data);
+    DelimitedWriter writer(&output);
+    for (int i = 0; i < count; ++i) {
+      protobuf_unittest::TestAllTypes message;
+      message.set_optional_int32(i);
+      message.set_optional_string(std::string(i % 50, 'x'));
+      EXPECT_TRUE(writer.Write(message));
+    }
+  }
+  return data;
+}
+
+TEST(DelimitedMessageUtilTest, DelimitedReaderBatches) {
+  const std::string data = WriteRecords(1000);
+  // Small blocks split many records across buffers.
+  for (int block_size : {1, 7, 64, 4096, -1}) {
+    SCOPED_TRACE(block_size);
+    io::ArrayInputStream input(data.data(), static_cast<int>(data.size()),
+                               block_size);
+    DelimitedReader::Options options;
+    options.max_batch_size = 100;
+    DelimitedReader reader(
+        &input, protobuf_unittest::TestAllTypes::default_instance(), options);
+    int count = 0;
+    while (reader.NextBatch()) {
+      EXPECT_LE(reader.batch().size(), 100);
+      for (const MessageLite* record : reader.batch()) {
+        const auto& message =
+            static_cast<const protobuf_unittest::TestAllTypes&>(*record);
+        EXPECT_EQ(count, message.optional_int32());
+        EXPECT_EQ(count % 50, message.optional_string().size());
+        ++count;
+      }
+    }
+    EXPECT_TRUE(reader.eof());
+    EXPECT_EQ(1000, count);
+  }
+}
+
+TEST(DelimitedMessageUtilTest, DelimitedReaderParallel) {
+  const std::string data = WriteRecords(1000);
+  io::ArrayInputStream input(data.data(), static_cast<int>(data.size()));
+  std::vector<std::thread> threads;
+  DelimitedReader::Options options;
+  options.min_records_per_task = 16;
+  options.executor = [&threads](std::function<void()> task) {
+    threads.emplace_back(std::move(task));
+  };
+  DelimitedReader reader(
+      &input, protobuf_unittest::TestAllTypes::default_instance(), options);
+  int count = 0;
+  while (reader.NextBatch()) {
+    for (const MessageLite* record : reader.batch()) {
+      EXPECT_EQ(count++,
+                static_cast<const protobuf_unittest::TestAllTypes&>(*record)
+                    .optional_int32());
+    }
+  }
+  EXPECT_TRUE(reader.eof());
+  EXPECT_EQ(1000, count);
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_GT(threads.size(), 0);
+}
+
+TEST(DelimitedMessageUtilTest, DelimitedReaderLeavesStreamAfterLastRecord) {
+  const std::string data = WriteRecords(3);
+  io::ArrayInputStream input(data.data(), static_cast<int>(data.size()));
+  {
+    DelimitedReader reader(
+        &input, protobuf_unittest::TestAllTypes::default_instance());
+    protobuf_unittest::TestAllTypes message;
+    EXPECT_TRUE(reader.Next(&message));
+    EXPECT_EQ(0, message.optional_int32());
+  }
+  protobuf_unittest::TestAllTypes message;
+  bool clean_eof;
+  EXPECT_TRUE(ParseDelimitedFromZeroCopyStream(&message, &input, &clean_eof));
+  EXPECT_EQ(1, message.optional_int32());
+}
+
+TEST(DelimitedMessageUtilTest, DelimitedReaderFailsOnTruncatedRecord) {
+  std::string data = WriteRecords(10);
+  data.resize(data.size() - 1);
+  io::ArrayInputStream input(data.data(), static_cast<int>(data.size()), 13);
+  DelimitedReader reader(&input,
+                         protobuf_unittest::TestAllTypes::default_instance());
+  int count = 0;
+  while (reader.NextBatch()) count += reader.batch().size();
+  EXPECT_FALSE(reader.eof());
+  EXPECT_EQ(9, count);
+  EXPECT_FALSE(reader.NextBatch());
+}
+
+TEST(DelimitedMessageUtilTest, DelimitedReaderFailsOnInvalidRecord) {
+  std::string data = WriteRecords(2);
+  data += "\x02\xff\xff";
+  io::ArrayInputStream input(data.data(), static_cast<int>(data.size()));
+  DelimitedReader reader(&input,
+                         protobuf_unittest::TestAllTypes::default_instance());
+  EXPECT_FALSE(reader.NextBatch());
+  EXPECT_FALSE(reader.eof());
+}
+
 }  // namespace util
 }  // namespace protobuf
 }  // namespace google
@@ -7,6 +7,8 @@
 
 #include "google/protobuf/util/field_mask_util.h"
 
+#include <climits>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -17,11 +19,19 @@
 #include "absl/log/absl_log.h"
 #include "absl/log/die_if_null.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/internal/resize_uninitialized.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/message.h"
+#include "google/protobuf/unknown_field_set.h"
+#include "google/protobuf/wire_format.h"
+#include "google/protobuf/wire_format_lite.h"
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
@@ -199,17 +209,6 @@ class FieldMaskTree {
   // the intersection field path into out.
   void IntersectPath(absl::string_view path, FieldMaskTree* out);
 
-  // Merge all fields specified by this tree from one message to another.
-  void MergeMessage(const Message& source,
-                    const FieldMaskUtil::MergeOptions& options,
-                    Message* destination) {
-    // Do nothing if the tree is empty.
-    if (root_.children.empty()) {
-      return;
-    }
-    MergeMessage(&root_, source, options, destination);
-  }
-
   // Add required field path of the message to this tree based on current tree
   // structure. If a message is present in the tree, add the path of its
   // required field to the tree. This is to make sure that after trimming a
@@ -222,17 +221,10 @@ class FieldMaskTree {
     AddRequiredFieldPath(&root_, descriptor);
   }
 
-  // Trims all fields not specified by this tree from the given message.
-  // Returns true if the message is modified.
-  bool TrimMessage(Message* message) {
-    // Do nothing if the tree is empty.
-    if (root_.children.empty()) {
-      return false;
-    }
-    return TrimMessage(&root_, message);
-  }
+  bool IsEmpty() const { return root_.children.empty(); }
 
- private:
+  // A node of the tree. Its children are keyed by field name, and it is a
+  // leaf if it has none.
   struct Node {
     Node() = default;
     Node(const Node&) = delete;
@@ -247,6 +239,9 @@ class FieldMaskTree {
     absl::btree_map<std::string, std::unique_ptr<Node>> children;
   };
 
+  const Node& root() const { return root_; }
+
+ private:
   // Merge a sub-tree to mask. This method adds the field paths represented
   // by all leaf nodes descended from "node" to mask.
   void MergeToFieldMask(absl::string_view prefix, const Node* node,
@@ -256,21 +251,12 @@ class FieldMaskTree {
   void MergeLeafNodesToTree(absl::string_view prefix, const Node* node,
                             FieldMaskTree* out);
 
-  // Merge all fields specified by a sub-tree from one message to another.
-  void MergeMessage(const Node* node, const Message& source,
-                    const FieldMaskUtil::MergeOptions& options,
-                    Message* destination);
-
   // Add required field path of the message to this tree based on current tree
   // structure. If a message is present in the tree, add the path of its
   // required field to the tree. This is to make sure that after trimming a
   // message with required fields are set, check IsInitialized() will not fail.
   void AddRequiredFieldPath(Node* node, const Descriptor* descriptor);
 
-  // Trims all fields not specified by this sub-tree from the given message.
-  // Returns true if the message is actually modified
-  bool TrimMessage(const Node* node, Message* message);
-
   Node root_;
 };
 
@@ -424,34 +410,148 @@ void FieldMaskTree::MergeLeafNodesToTree(absl::string_view prefix,
   }
 }
 
-void FieldMaskTree::MergeMessage(const Node* node, const Message& source,
-                                 const FieldMaskUtil::MergeOptions& options,
-                                 Message* destination) {
-  ABSL_DCHECK(!node->children.empty());
-  const Reflection* source_reflection = source.GetReflection();
-  const Reflection* destination_reflection = destination->GetReflection();
-  const Descriptor* descriptor = source.GetDescriptor();
-  for (const auto& kv : node->children) {
+void FieldMaskTree::AddRequiredFieldPath(Node* node,
+                                         const Descriptor* descriptor) {
+  const int32_t field_count = descriptor->field_count();
+  for (int index = 0; index < field_count; ++index) {
+    const FieldDescriptor* field = descriptor->field(index);
+    if (field->is_required()) {
+      absl::string_view node_name = field->name();
+      std::unique_ptr<Node>& child = node->children[node_name];
+      if (child == nullptr) {
+        // Add required field path to the tree
+        child = absl::make_unique<Node>();
+      } else if (child->children.empty()) {
+        // If the required field is in the tree and does not have any children,
+        // do nothing.
+        continue;
+      }
+      // Add required field in the children to the tree if the field is message.
+      if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+        AddRequiredFieldPath(child.get(), field->message_type());
+      }
+    } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      auto it = node->children.find(field->name());
+      if (it != node->children.end()) {
+        // Add required fields in the children to the
+        // tree if the field is a message and present in the tree.
+        Node* child = it->second.get();
+        if (!child->children.empty()) {
+          AddRequiredFieldPath(child, field->message_type());
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+// A compiled node holds the fields of one message type that a sub-tree of a
+// FieldMaskTree keeps, as a table indexed by field index, so that applying it
+// looks up no field names.
+struct FieldMaskUtil::CompiledFieldMask::Node {
+  struct Field {
+    const FieldDescriptor* field;
+    // The sub-fields kept, or nullptr if the field is kept whole.
+    std::unique_ptr<Node> child;
+  };
+
+  // Compiles a sub-tree for messages of type "descriptor". When merging, the
+  // sub-fields of fields other than singular message fields cannot be
+  // selected: such fields are skipped and reported, like unknown names. When
+  // trimming, these fields are kept whole, except for repeated message
+  // fields, whose elements are each trimmed.
+  static std::unique_ptr<Node> Compile(const FieldMaskTree::Node& tree,
+                                       const Descriptor* descriptor,
+                                       bool for_merge);
+
+  // Returns the entry of a field of the message type, or nullptr if the field
+  // is not kept.
+  const Field* Find(const FieldDescriptor* field) const {
+    const int position = positions[field->index()];
+    return position < 0 ? nullptr : &fields[position];
+  }
+
+  // Merges the fields kept from one message to another.
+  void Merge(const Message& source, const MergeOptions& options,
+             Message* destination) const;
+
+  // Clears the fields not kept. Returns true if the message is modified.
+  bool Trim(Message* message) const;
+
+  // Returns whether Trim() keeps "field" and sets "child" to the node its
+  // sub-fields are trimmed with, or nullptr if it is kept whole.
+  bool IsFieldKept(const FieldDescriptor* field, const Node** child) const;
+
+  // Computes the size of the message trimmed by this node. The sizes of the
+  // trimmed sub-messages are appended to "sizes" in the order that
+  // SerializeTrimmed() visits them.
+  size_t TrimmedByteSize(const Message& message,
+                         std::vector<size_t>* sizes) const;
+
+  // Serializes the message trimmed by this node, reading the sizes of its
+  // trimmed sub-messages from "sizes".
+  uint8_t* SerializeTrimmed(const Message& message, const size_t** sizes,
+                            uint8_t* target,
+                            io::EpsCopyOutputStream* stream) const;
+
+  // The fields kept, in the order of their names, which is the order they are
+  // merged in.
+  std::vector<Field> fields;
+  // The position in "fields" of each field of the message type, by field
+  // index, or -1 for fields that are not kept.
+  std::vector<int> positions;
+};
+
+std::unique_ptr<FieldMaskUtil::CompiledFieldMask::Node>
+FieldMaskUtil::CompiledFieldMask::Node::Compile(const FieldMaskTree::Node& tree,
+                                                const Descriptor* descriptor,
+                                                bool for_merge) {
+  auto node = absl::make_unique<Node>();
+  node->positions.assign(descriptor->field_count(), -1);
+  for (const auto& kv : tree.children) {
     absl::string_view field_name = kv.first;
-    const Node* child = kv.second.get();
+    const FieldMaskTree::Node& child = *kv.second;
     const FieldDescriptor* field = descriptor->FindFieldByName(field_name);
     if (field == nullptr) {
-      ABSL_LOG(ERROR) << "Cannot find field \"" << field_name
-                      << "\" in message " << descriptor->full_name();
+      if (for_merge) {
+        ABSL_LOG(ERROR) << "Cannot find field \"" << field_name
+                        << "\" in message " << descriptor->full_name();
+      }
       continue;
     }
-    if (!child->children.empty()) {
-      // Sub-paths are only allowed for singular message fields.
-      if (field->is_repeated() ||
-          field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) {
+    std::unique_ptr<Node> compiled_child;
+    if (!child.children.empty()) {
+      const bool is_message =
+          field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE;
+      if (for_merge && (field->is_repeated() || !is_message)) {
         ABSL_LOG(ERROR) << "Field \"" << field_name << "\" in message "
                         << descriptor->full_name()
                         << " is not a singular message field and cannot "
                         << "have sub-fields.";
         continue;
       }
-      MergeMessage(child, source_reflection->GetMessage(source, field), options,
-                   destination_reflection->MutableMessage(destination, field));
+      if (is_message && !field->is_map()) {
+        compiled_child = Compile(child, field->message_type(), for_merge);
+      }
+    }
+    node->positions[field->index()] = static_cast<int>(node->fields.size());
+    node->fields.push_back({field, std::move(compiled_child)});
+  }
+  return node;
+}
+
+void FieldMaskUtil::CompiledFieldMask::Node::Merge(
+    const Message& source, const MergeOptions& options,
+    Message* destination) const {
+  const Reflection* source_reflection = source.GetReflection();
+  const Reflection* destination_reflection = destination->GetReflection();
+  for (const Field& entry : fields) {
+    const FieldDescriptor* field = entry.field;
+    if (entry.child != nullptr) {
+      entry.child->Merge(
+          source_reflection->GetMessage(source, field), options,
+          destination_reflection->MutableMessage(destination, field));
       continue;
     }
     if (!field->is_repeated()) {
@@ -526,75 +626,173 @@ void FieldMaskTree::MergeMessage(const Node* node, const Message& source,
   }
 }
 
-void FieldMaskTree::AddRequiredFieldPath(Node* node,
-                                         const Descriptor* descriptor) {
+bool FieldMaskUtil::CompiledFieldMask::Node::Trim(Message* message) const {
+  const Reflection* reflection = message->GetReflection();
+  const Descriptor* descriptor = message->GetDescriptor();
   const int32_t field_count = descriptor->field_count();
+  bool modified = false;
   for (int index = 0; index < field_count; ++index) {
     const FieldDescriptor* field = descriptor->field(index);
-    if (field->is_required()) {
-      absl::string_view node_name = field->name();
-      std::unique_ptr<Node>& child = node->children[node_name];
-      if (child == nullptr) {
-        // Add required field path to the tree
-        child = absl::make_unique<Node>();
-      } else if (child->children.empty()) {
-        // If the required field is in the tree and does not have any children,
-        // do nothing.
-        continue;
-      }
-      // Add required field in the children to the tree if the field is message.
-      if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
-        AddRequiredFieldPath(child.get(), field->message_type());
+    const int position = positions[index];
+    if (position < 0) {
+      if (field->is_repeated() ? reflection->FieldSize(*message, field) != 0
+                               : reflection->HasField(*message, field)) {
+        reflection->ClearField(message, field);
+        modified = true;
       }
-    } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
-      auto it = node->children.find(field->name());
-      if (it != node->children.end()) {
-        // Add required fields in the children to the
-        // tree if the field is a message and present in the tree.
-        Node* child = it->second.get();
-        if (!child->children.empty()) {
-          AddRequiredFieldPath(child, field->message_type());
+      continue;
+    }
+    const Node* child = fields[position].child.get();
+    if (child == nullptr) continue;
+    if (field->is_repeated()) {
+      const int size = reflection->FieldSize(*message, field);
+      for (int i = 0; i < size; ++i) {
+        if (child->Trim(
+                reflection->MutableRepeatedMessage(message, field, i))) {
+          modified = true;
         }
       }
+    } else if (reflection->HasField(*message, field)) {
+      if (child->Trim(reflection->MutableMessage(message, field))) {
+        modified = true;
+      }
     }
   }
+  return modified;
 }
 
-bool FieldMaskTree::TrimMessage(const Node* node, Message* message) {
-  ABSL_DCHECK(!node->children.empty());
-  const Reflection* reflection = message->GetReflection();
-  const Descriptor* descriptor = message->GetDescriptor();
-  const int32_t field_count = descriptor->field_count();
-  bool modified = false;
-  for (int index = 0; index < field_count; ++index) {
-    const FieldDescriptor* field = descriptor->field(index);
-    auto it = node->children.find(field->name());
-    if (it == node->children.end()) {
-      if (field->is_repeated()) {
-        if (reflection->FieldSize(*message, field) != 0) {
-          modified = true;
-        }
+bool FieldMaskUtil::CompiledFieldMask::Node::IsFieldKept(
+    const FieldDescriptor* field, const Node** child) const {
+  *child = nullptr;
+  // Trim() only clears regular fields.
+  if (field->is_extension()) {
+    return true;
+  }
+  const Field* entry = Find(field);
+  if (entry == nullptr) {
+    return false;
+  }
+  *child = entry->child.get();
+  return true;
+}
+
+size_t FieldMaskUtil::CompiledFieldMask::Node::TrimmedByteSize(
+    const Message& message, std::vector<size_t>* sizes) const {
+  const Descriptor* descriptor = message.GetDescriptor();
+  // Message sets only have extensions, which are kept.
+  if (descriptor->options().message_set_wire_format()) {
+    return message.ByteSizeLong();
+  }
+  const Reflection* reflection = message.GetReflection();
+  std::vector<const FieldDescriptor*> present_fields;
+  reflection->ListFields(message, &present_fields);
+  size_t size = 0;
+  for (const FieldDescriptor* field : present_fields) {
+    const Node* child;
+    if (!IsFieldKept(field, &child)) {
+      continue;
+    }
+    if (child == nullptr) {
+      size += internal::WireFormat::FieldByteSize(field, message);
+      continue;
+    }
+    const size_t tag_size =
+        internal::WireFormat::TagSize(field->number(), field->type());
+    const int count =
+        field->is_repeated() ? reflection->FieldSize(message, field) : 1;
+    for (int i = 0; i < count; ++i) {
+      const Message& sub_message =
+          field->is_repeated()
+              ? reflection->GetRepeatedMessage(message, field, i)
+              : reflection->GetMessage(message, field);
+      const size_t index = sizes->size();
+      sizes->push_back(0);
+      const size_t sub_size = child->TrimmedByteSize(sub_message, sizes);
+      (*sizes)[index] = sub_size;
+      size += tag_size;
+      size += field->type() == FieldDescriptor::TYPE_GROUP
+                  ? sub_size
+                  : internal::WireFormatLite::LengthDelimitedSize(sub_size);
+    }
+  }
+  return size + internal::WireFormat::ComputeUnknownFieldsSize(
+                    reflection->GetUnknownFields(message));
+}
+
+uint8_t* FieldMaskUtil::CompiledFieldMask::Node::SerializeTrimmed(
+    const Message& message, const size_t** sizes, uint8_t* target,
+    io::EpsCopyOutputStream* stream) const {
+  using internal::WireFormatLite;
+  const Descriptor* descriptor = message.GetDescriptor();
+  if (descriptor->options().message_set_wire_format()) {
+    return message._InternalSerialize(target, stream);
+  }
+  const Reflection* reflection = message.GetReflection();
+  std::vector<const FieldDescriptor*> present_fields;
+  reflection->ListFields(message, &present_fields);
+  for (const FieldDescriptor* field : present_fields) {
+    const Node* child;
+    if (!IsFieldKept(field, &child)) {
+      continue;
+    }
+    if (child == nullptr) {
+      target = internal::WireFormat::InternalSerializeField(field, message,
+                                                            target, stream);
+      continue;
+    }
+    const bool is_group = field->type() == FieldDescriptor::TYPE_GROUP;
+    const int count =
+        field->is_repeated() ? reflection->FieldSize(message, field) : 1;
+    for (int i = 0; i < count; ++i) {
+      const Message& sub_message =
+          field->is_repeated()
+              ? reflection->GetRepeatedMessage(message, field, i)
+              : reflection->GetMessage(message, field);
+      const size_t sub_size = *(*sizes)++;
+      target = stream->EnsureSpace(target);
+      if (is_group) {
+        target = WireFormatLite::WriteTagToArray(
+            field->number(), WireFormatLite::WIRETYPE_START_GROUP, target);
       } else {
-        if (reflection->HasField(*message, field)) {
-          modified = true;
-        }
+        target = WireFormatLite::WriteTagToArray(
+            field->number(), WireFormatLite::WIRETYPE_LENGTH_DELIMITED,
+            target);
+        target = io::CodedOutputStream::WriteVarint32ToArray(
+            static_cast<uint32_t>(sub_size), target);
       }
-      reflection->ClearField(message, field);
-    } else {
-      if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
-        Node* child = it->second.get();
-        if (!child->children.empty() && reflection->HasField(*message, field)) {
-          bool nestedMessageChanged =
-              TrimMessage(child, reflection->MutableMessage(message, field));
-          modified = nestedMessageChanged || modified;
-        }
+      target = child->SerializeTrimmed(sub_message, sizes, target, stream);
+      if (is_group) {
+        target = stream->EnsureSpace(target);
+        target = WireFormatLite::WriteTagToArray(
+            field->number(), WireFormatLite::WIRETYPE_END_GROUP, target);
       }
     }
   }
-  return modified;
+  return internal::WireFormat::InternalSerializeUnknownFieldsToArray(
+      reflection->GetUnknownFields(message), target, stream);
 }
 
-}  // namespace
+FieldMaskUtil::CompiledFieldMask::CompiledFieldMask(
+    const Descriptor* descriptor, const FieldMask& mask,
+    const TrimOptions& options)
+    : descriptor_(ABSL_DIE_IF_NULL(descriptor)) {
+  FieldMaskTree tree;
+  tree.MergeFromFieldMask(mask);
+  empty_ = tree.IsEmpty();
+  merge_root_ = Node::Compile(tree.root(), descriptor, /*for_merge=*/true);
+  // If keep_required_fields is true, implicitly add required fields of
+  // a message present in the tree to prevent from trimming.
+  if (options.keep_required_fields()) {
+    tree.AddRequiredFieldPath(descriptor);
+  }
+  trim_root_ = Node::Compile(tree.root(), descriptor, /*for_merge=*/false);
+}
+
+FieldMaskUtil::CompiledFieldMask::CompiledFieldMask(
+    CompiledFieldMask&&) noexcept = default;
+FieldMaskUtil::CompiledFieldMask& FieldMaskUtil::CompiledFieldMask::operator=(
+    CompiledFieldMask&&) noexcept = default;
+FieldMaskUtil::CompiledFieldMask::~CompiledFieldMask() = default;
 
 void FieldMaskUtil::ToCanonicalForm(const FieldMask& mask, FieldMask* out) {
   FieldMaskTree tree;
@@ -660,34 +858,83 @@ bool FieldMaskUtil::IsPathInFieldMask(absl::string_view path,
 void FieldMaskUtil::MergeMessageTo(const Message& source, const FieldMask& mask,
                                    const MergeOptions& options,
                                    Message* destination) {
-  ABSL_CHECK(source.GetDescriptor() == destination->GetDescriptor());
-  // Build a FieldMaskTree and walk through the tree to merge all specified
-  // fields.
-  FieldMaskTree tree;
-  tree.MergeFromFieldMask(mask);
-  tree.MergeMessage(source, options, destination);
+  MergeMessageTo(source, CompiledFieldMask(source.GetDescriptor(), mask),
+                 options, destination);
 }
 
 bool FieldMaskUtil::TrimMessage(const FieldMask& mask, Message* message) {
-  // Build a FieldMaskTree and walk through the tree to merge all specified
-  // fields.
-  FieldMaskTree tree;
-  tree.MergeFromFieldMask(mask);
-  return tree.TrimMessage(ABSL_DIE_IF_NULL(message));
+  return TrimMessage(mask, message, TrimOptions());
 }
 
 bool FieldMaskUtil::TrimMessage(const FieldMask& mask, Message* message,
                                 const TrimOptions& options) {
-  // Build a FieldMaskTree and walk through the tree to merge all specified
-  // fields.
-  FieldMaskTree tree;
-  tree.MergeFromFieldMask(mask);
-  // If keep_required_fields is true, implicitly add required fields of
-  // a message present in the tree to prevent from trimming.
-  if (options.keep_required_fields()) {
-    tree.AddRequiredFieldPath(ABSL_DIE_IF_NULL(message->GetDescriptor()));
+  return TrimMessage(
+      CompiledFieldMask(ABSL_DIE_IF_NULL(message)->GetDescriptor(), mask,
+                        options),
+      message);
+}
+
+bool FieldMaskUtil::SerializeTrimmedToString(const FieldMask& mask,
+                                             const Message& message,
+                                             std::string* output) {
+  return SerializeTrimmedToString(mask, message, TrimOptions(), output);
+}
+
+bool FieldMaskUtil::SerializeTrimmedToString(const FieldMask& mask,
+                                             const Message& message,
+                                             const TrimOptions& options,
+                                             std::string* output) {
+  return SerializeTrimmedToString(
+      CompiledFieldMask(message.GetDescriptor(), mask, options), message,
+      output);
+}
+
+void FieldMaskUtil::MergeMessageTo(const Message& source,
+                                   const CompiledFieldMask& mask,
+                                   const MergeOptions& options,
+                                   Message* destination) {
+  ABSL_CHECK(source.GetDescriptor() == destination->GetDescriptor());
+  ABSL_CHECK(source.GetDescriptor() == mask.descriptor());
+  mask.merge_root_->Merge(source, options, destination);
+}
+
+bool FieldMaskUtil::TrimMessage(const CompiledFieldMask& mask,
+                                Message* message) {
+  ABSL_CHECK(ABSL_DIE_IF_NULL(message)->GetDescriptor() == mask.descriptor());
+  // An empty mask trims nothing.
+  if (mask.empty_) {
+    return false;
+  }
+  return mask.trim_root_->Trim(message);
+}
+
+bool FieldMaskUtil::SerializeTrimmedToString(const CompiledFieldMask& mask,
+                                             const Message& message,
+                                             std::string* output) {
+  ABSL_CHECK(message.GetDescriptor() == mask.descriptor());
+  // An empty mask trims nothing.
+  if (mask.empty_) {
+    return message.SerializePartialToString(output);
+  }
+  std::vector<size_t> sizes;
+  const size_t byte_size = mask.trim_root_->TrimmedByteSize(message, &sizes);
+  if (byte_size > INT_MAX) {
+    ABSL_LOG(ERROR) << message.GetTypeName()
+                    << " exceeded maximum protobuf size of 2GB: " << byte_size;
+    return false;
   }
-  return tree.TrimMessage(ABSL_DIE_IF_NULL(message));
+  output->clear();
+  absl::strings_internal::STLStringResizeUninitialized(output, byte_size);
+  uint8_t* start = reinterpret_cast<uint8_t*>(io::mutable_string_data(output));
+  io::EpsCopyOutputStream stream(
+      start, static_cast<int>(byte_size),
+      io::CodedOutputStream::IsDefaultSerializationDeterministic());
+  const size_t* next_size = sizes.data();
+  uint8_t* end =
+      mask.trim_root_->SerializeTrimmed(message, &next_size, start, &stream);
+  ABSL_DCHECK_EQ(end, start + byte_size);
+  ABSL_DCHECK_EQ(next_size, sizes.data() + sizes.size());
+  return true;
 }
 
 }  // namespace util
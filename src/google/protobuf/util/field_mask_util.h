@@ -11,6 +11,7 @@
 #define GOOGLE_PROTOBUF_UTIL_FIELD_MASK_UTIL_H__
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -158,6 +159,37 @@ class PROTOBUF_EXPORT FieldMaskUtil {
   static bool TrimMessage(const FieldMask& mask, Message* message,
                           const TrimOptions& options);
 
+  // Serializes 'message' as if it had been trimmed by TrimMessage() first,
+  // without copying or modifying it. Extensions and unknown fields are kept,
+  // as TrimMessage() does, and paths below a repeated message field apply to
+  // each of its elements. Like SerializePartialToString(), this does not
+  // check required fields. If the FieldMask is empty, the whole message is
+  // serialized.
+  // Returns false if the serialized message is too large.
+  static bool SerializeTrimmedToString(const FieldMask& mask,
+                                       const Message& message,
+                                       std::string* output);
+
+  // Same as above, with customized TrimOptions.
+  static bool SerializeTrimmedToString(const FieldMask& mask,
+                                       const Message& message,
+                                       const TrimOptions& options,
+                                       std::string* output);
+
+  class CompiledFieldMask;
+  // Same as MergeMessageTo(), TrimMessage() and SerializeTrimmedToString()
+  // above, with a FieldMask compiled for the type of the messages, which saves
+  // parsing its paths and looking up its fields on every call. The TrimOptions
+  // are the ones the mask was compiled with. Sub-paths of repeated message
+  // fields apply to each of their elements when trimming.
+  static void MergeMessageTo(const Message& source,
+                             const CompiledFieldMask& mask,
+                             const MergeOptions& options, Message* destination);
+  static bool TrimMessage(const CompiledFieldMask& mask, Message* message);
+  static bool SerializeTrimmedToString(const CompiledFieldMask& mask,
+                                       const Message& message,
+                                       std::string* output);
+
  private:
   friend class SnakeCaseCamelCaseTest;
   // Converts a field name from snake_case to camelCase:
@@ -233,6 +265,33 @@ class PROTOBUF_EXPORT FieldMaskUtil::TrimOptions {
   bool keep_required_fields_;
 };
 
+// A FieldMask resolved against a message type, for applying the same mask to
+// many messages of that type, e.g. a read mask to each element of a list
+// response. It is immutable once built, so it can be shared between threads.
+class PROTOBUF_EXPORT FieldMaskUtil::CompiledFieldMask {
+ public:
+  // Compiles "mask" for messages of type "descriptor". Invalid paths are
+  // handled like MergeMessageTo() and TrimMessage() handle them. "options"
+  // only apply when trimming.
+  CompiledFieldMask(const Descriptor* descriptor, const FieldMask& mask,
+                    const TrimOptions& options = TrimOptions());
+  CompiledFieldMask(CompiledFieldMask&&) noexcept;
+  CompiledFieldMask& operator=(CompiledFieldMask&&) noexcept;
+  ~CompiledFieldMask();
+
+  const Descriptor* descriptor() const { return descriptor_; }
+
+ private:
+  friend class FieldMaskUtil;
+  struct Node;
+
+  const Descriptor* descriptor_;
+  // Whether the mask has no paths, in which case trimming does nothing.
+  bool empty_;
+  std::unique_ptr<const Node> merge_root_;
+  std::unique_ptr<const Node> trim_root_;
+};
+
 }  // namespace util
 }  // namespace protobuf
 }  // namespace google
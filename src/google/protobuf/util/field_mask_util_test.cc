@@ -9,6 +9,8 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "google/protobuf/field_mask.pb.h"
@@ -805,6 +807,181 @@ TEST(FieldMaskUtilTest, TrimMessageReturnValue) {
 }
 
 
+// Checks that serializing with the mask gives the bytes of the trimmed message.
+void ExpectSerializesTrimmed(const FieldMask& mask, const Message& message,
+                             const FieldMaskUtil::TrimOptions& options =
+                                 FieldMaskUtil::TrimOptions()) {
+  SCOPED_TRACE(mask.DebugString());
+  std::unique_ptr<Message> trimmed(message.New());
+  trimmed->CopyFrom(message);
+  FieldMaskUtil::TrimMessage(mask, trimmed.get(), options);
+  std::string output = "garbage";
+  ASSERT_TRUE(
+      FieldMaskUtil::SerializeTrimmedToString(mask, message, options, &output));
+  EXPECT_EQ(output, trimmed->SerializePartialAsString());
+}
+
+TEST(FieldMaskUtilTest, SerializeTrimmedToString) {
+  NestedTestAllTypes msg;
+  TestUtil::SetAllFields(msg.mutable_payload());
+  TestUtil::SetAllFields(msg.mutable_child()->mutable_payload());
+  msg.mutable_child()->mutable_child()->mutable_payload()->set_optional_int32(
+      1);
+  msg.GetReflection()->MutableUnknownFields(&msg)->AddVarint(1000, 1);
+  msg.mutable_payload()
+      ->GetReflection()
+      ->MutableUnknownFields(msg.mutable_payload())
+      ->AddFixed32(1001, 2);
+
+  FieldMask mask;
+  ExpectSerializesTrimmed(mask, msg);
+  FieldMaskUtil::FromString("payload", &mask);
+  ExpectSerializesTrimmed(mask, msg);
+  FieldMaskUtil::FromString(
+      "payload.optional_int32,payload.optional_nested_message,"
+      "payload.repeated_string,payload.optionalgroup.a",
+      &mask);
+  ExpectSerializesTrimmed(mask, msg);
+  FieldMaskUtil::FromString(
+      "child.payload.optional_string,child.child.payload,"
+      "payload.optional_foreign_message.c,payload.repeated_int32",
+      &mask);
+  ExpectSerializesTrimmed(mask, msg);
+  FieldMaskUtil::FromString("child.child,no_such_field", &mask);
+  ExpectSerializesTrimmed(mask, msg);
+
+  // Extensions are kept.
+  protobuf_unittest::TestAllExtensions extensions;
+  TestUtil::SetAllExtensions(&extensions);
+  FieldMaskUtil::FromString("optional_int32", &mask);
+  ExpectSerializesTrimmed(mask, extensions);
+
+  // Required fields may be kept.
+  TestRequiredMessage required;
+  required.mutable_optional_message()->set_a(1);
+  required.mutable_optional_message()->set_b(2);
+  required.mutable_optional_message()->set_c(3);
+  required.mutable_required_message()->set_dummy2(4);
+  FieldMaskUtil::FromString("optional_message.dummy2,required_message", &mask);
+  ExpectSerializesTrimmed(mask, required);
+  FieldMaskUtil::TrimOptions options;
+  options.set_keep_required_fields(true);
+  ExpectSerializesTrimmed(mask, required, options);
+}
+
+TEST(FieldMaskUtilTest, SerializeTrimmedToStringTrimsRepeatedMessages) {
+  NestedTestAllTypes msg;
+  NestedTestAllTypes expected;
+  for (int i = 0; i < 3; ++i) {
+    TestAllTypes* payload = msg.add_repeated_child()->mutable_payload();
+    TestUtil::SetAllFields(payload);
+    payload->set_optional_int32(i);
+    expected.add_repeated_child()->mutable_payload()->set_optional_int32(i);
+  }
+  msg.mutable_child()->mutable_payload()->set_optional_int32(5);
+
+  FieldMask mask;
+  FieldMaskUtil::FromString("repeated_child.payload.optional_int32", &mask);
+  std::string output;
+  ASSERT_TRUE(FieldMaskUtil::SerializeTrimmedToString(mask, msg, &output));
+  EXPECT_EQ(output, expected.SerializeAsString());
+}
+
+TEST(FieldMaskUtilTest, CompiledFieldMask) {
+  NestedTestAllTypes msg;
+  for (int i = 0; i < 3; ++i) {
+    NestedTestAllTypes* child = msg.add_repeated_child();
+    TestUtil::SetAllFields(child->mutable_payload());
+    child->mutable_payload()->set_optional_int32(i);
+    child->mutable_child()->mutable_payload()->set_optional_int64(i);
+  }
+  TestUtil::SetAllFields(msg.mutable_payload());
+  msg.mutable_child()->mutable_payload()->set_optional_int32(5);
+  msg.mutable_child()->mutable_payload()->set_optional_string("x");
+
+  FieldMask mask;
+  FieldMaskUtil::FromString(
+      "payload.optional_int32,payload.repeated_string,child.payload.no_such,"
+      "payload.optional_nested_message.bb,repeated_child,no_such_field",
+      &mask);
+  const FieldMaskUtil::CompiledFieldMask compiled(
+      NestedTestAllTypes::descriptor(), mask);
+  EXPECT_EQ(compiled.descriptor(), NestedTestAllTypes::descriptor());
+
+  // Applying the mask to several messages gives the results of the FieldMask
+  // flavors.
+  for (int i = 0; i < 2; ++i) {
+    FieldMaskUtil::MergeOptions options;
+    options.set_replace_repeated_fields(i == 1);
+    NestedTestAllTypes expected = msg.repeated_child(i);
+    NestedTestAllTypes merged = msg.repeated_child(i);
+    FieldMaskUtil::MergeMessageTo(msg, mask, options, &expected);
+    FieldMaskUtil::MergeMessageTo(msg, compiled, options, &merged);
+    EXPECT_EQ(expected.DebugString(), merged.DebugString());
+
+    NestedTestAllTypes trimmed = msg;
+    expected = msg;
+    FieldMaskUtil::TrimMessage(mask, &expected);
+    EXPECT_TRUE(FieldMaskUtil::TrimMessage(compiled, &trimmed));
+    EXPECT_EQ(expected.DebugString(), trimmed.DebugString());
+    EXPECT_FALSE(FieldMaskUtil::TrimMessage(compiled, &trimmed));
+
+    std::string output;
+    ASSERT_TRUE(
+        FieldMaskUtil::SerializeTrimmedToString(compiled, msg, &output));
+    EXPECT_EQ(output, expected.SerializeAsString());
+  }
+
+  // Sub-paths of repeated message fields apply to each element.
+  FieldMaskUtil::FromString("repeated_child.payload.optional_int32", &mask);
+  const FieldMaskUtil::CompiledFieldMask repeated_compiled(
+      NestedTestAllTypes::descriptor(), mask);
+  NestedTestAllTypes expected;
+  for (int i = 0; i < 3; ++i) {
+    expected.add_repeated_child()->mutable_payload()->set_optional_int32(i);
+  }
+  NestedTestAllTypes trimmed = msg;
+  EXPECT_TRUE(FieldMaskUtil::TrimMessage(repeated_compiled, &trimmed));
+  EXPECT_EQ(expected.DebugString(), trimmed.DebugString());
+
+  // An empty mask trims nothing.
+  const FieldMaskUtil::CompiledFieldMask empty_compiled(
+      NestedTestAllTypes::descriptor(), FieldMask());
+  trimmed = msg;
+  EXPECT_FALSE(FieldMaskUtil::TrimMessage(empty_compiled, &trimmed));
+  EXPECT_EQ(msg.DebugString(), trimmed.DebugString());
+}
+
+TEST(FieldMaskUtilTest, CompiledFieldMaskKeepsRequiredFields) {
+  TestRequiredMessage msg;
+  msg.mutable_optional_message()->set_a(1);
+  msg.mutable_optional_message()->set_b(2);
+  msg.mutable_optional_message()->set_c(3);
+  msg.mutable_required_message()->set_dummy2(4);
+  FieldMask mask;
+  FieldMaskUtil::FromString("optional_message.dummy2", &mask);
+  FieldMaskUtil::TrimOptions options;
+  options.set_keep_required_fields(true);
+  const FieldMaskUtil::CompiledFieldMask compiled(
+      TestRequiredMessage::descriptor(), mask, options);
+
+  TestRequiredMessage expected = msg;
+  FieldMaskUtil::TrimMessage(mask, &expected, options);
+  TestRequiredMessage trimmed = msg;
+  FieldMaskUtil::TrimMessage(compiled, &trimmed);
+  EXPECT_EQ(expected.DebugString(), trimmed.DebugString());
+  std::string output;
+  ASSERT_TRUE(FieldMaskUtil::SerializeTrimmedToString(compiled, msg, &output));
+  EXPECT_EQ(output, expected.SerializePartialAsString());
+
+  // Merging ignores the TrimOptions.
+  TestRequiredMessage merged;
+  FieldMaskUtil::MergeMessageTo(msg, compiled, FieldMaskUtil::MergeOptions(),
+                                &merged);
+  EXPECT_FALSE(merged.optional_message().has_a());
+  EXPECT_TRUE(merged.has_optional_message());
+}
+
 }  // namespace
 }  // namespace util
 }  // namespace protobuf
@@ -0,0 +1,92 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/frozen_message.h"
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "absl/strings/internal/resize_uninitialized.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+constexpr char kModifiedError[] = " was modified after it was frozen.";
+
+bool CheckSize(const MessageLite& message, size_t byte_size) {
+  if (byte_size > INT_MAX) {
+    ABSL_LOG(ERROR) << message.GetTypeName()
+                    << " exceeded maximum protobuf size of 2GB: " << byte_size;
+    return false;
+  }
+  ABSL_DCHECK_EQ(static_cast<size_t>(message.GetCachedSize()), byte_size)
+      << message.GetTypeName() << kModifiedError;
+  return true;
+}
+
+}  // namespace
+
+bool FrozenMessage::SerializeToArray(void* data, int size) const {
+  if (!CheckSize(message_, byte_size_)) return false;
+  if (size < static_cast<int64_t>(byte_size_)) return false;
+  uint8_t* start = static_cast<uint8_t*>(data);
+  uint8_t* end = message_.SerializeWithCachedSizesToArray(start);
+  ABSL_DCHECK_EQ(static_cast<size_t>(end - start), byte_size_)
+      << message_.GetTypeName() << kModifiedError;
+  (void)end;
+  return true;
+}
+
+bool FrozenMessage::SerializeToString(std::string* output) const {
+  output->clear();
+  return AppendToString(output);
+}
+
+bool FrozenMessage::AppendToString(std::string* output) const {
+  if (!CheckSize(message_, byte_size_)) return false;
+  size_t old_size = output->size();
+  absl::strings_internal::STLStringResizeUninitializedAmortized(
+      output, old_size + byte_size_);
+  return SerializeToArray(&(*output)[old_size], static_cast<int>(byte_size_));
+}
+
+std::string FrozenMessage::SerializeAsString() const {
+  std::string output;
+  if (!AppendToString(&output)) output.clear();
+  return output;
+}
+
+bool FrozenMessage::SerializeToCodedStream(
+    io::CodedOutputStream* output) const {
+  if (!CheckSize(message_, byte_size_)) return false;
+  int original_byte_count = output->ByteCount();
+  message_.SerializeWithCachedSizes(output);
+  if (output->HadError()) return false;
+  ABSL_DCHECK_EQ(
+      static_cast<size_t>(output->ByteCount() - original_byte_count),
+      byte_size_)
+      << message_.GetTypeName() << kModifiedError;
+  return true;
+}
+
+bool FrozenMessage::SerializeToZeroCopyStream(
+    io::ZeroCopyOutputStream* output) const {
+  io::CodedOutputStream coded_output(output);
+  return SerializeToCodedStream(&coded_output);
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
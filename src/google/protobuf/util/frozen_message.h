@@ -0,0 +1,80 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Defines FrozenMessage, which serializes a message that is no longer
+// modified from many threads without writing to it.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_FROZEN_MESSAGE_H__
+#define GOOGLE_PROTOBUF_UTIL_FROZEN_MESSAGE_H__
+
+#include <cstddef>
+#include <string>
+
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/message_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+// Serializes a message whose sizes were computed once, up front.
+//
+// MessageLite::SerializeToString() and friends call ByteSizeLong(), which
+// stores the size of every submessage in the message. When many threads
+// serialize the same shared message, these stores make the cache lines of the
+// message bounce between cores. FrozenMessage computes the sizes when it is
+// constructed; its serialization methods only read the message, so they can
+// be called concurrently at no extra cost.
+//
+// The message must outlive the FrozenMessage and must not be modified while
+// the FrozenMessage is in use; this includes serializing it by other means,
+// which recomputes the sizes. In debug builds, serialization checks that the
+// sizes still match the message. Like the Serialize*Partial*() methods of
+// MessageLite, FrozenMessage does not check for missing required fields.
+//
+// Example:
+//
+//   const util::FrozenMessage frozen(config);
+//   // On any number of threads:
+//   std::string bytes = frozen.SerializeAsString();
+class PROTOBUF_EXPORT FrozenMessage {
+ public:
+  explicit FrozenMessage(const MessageLite& message)
+      : message_(message), byte_size_(message.ByteSizeLong()) {}
+  FrozenMessage(const FrozenMessage&) = delete;
+  FrozenMessage& operator=(const FrozenMessage&) = delete;
+
+  const MessageLite& message() const { return message_; }
+
+  // The size of the message when it was frozen.
+  size_t ByteSizeLong() const { return byte_size_; }
+
+  // Same as the MessageLite methods of the same name. All of them return false
+  // if the message is larger than 2GB.
+  bool SerializeToArray(void* data, int size) const;
+  bool SerializeToString(std::string* output) const;
+  bool AppendToString(std::string* output) const;
+  std::string SerializeAsString() const;
+  bool SerializeToCodedStream(io::CodedOutputStream* output) const;
+  bool SerializeToZeroCopyStream(io::ZeroCopyOutputStream* output) const;
+
+ private:
+  const MessageLite& message_;
+  const size_t byte_size_;
+};
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_FROZEN_MESSAGE_H__
@@ -0,0 +1,76 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/frozen_message.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+
+TEST(FrozenMessageTest, SerializesLikeMessage) {
+  TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  const std::string expected = message.SerializeAsString();
+
+  const FrozenMessage frozen(message);
+  EXPECT_EQ(frozen.ByteSizeLong(), expected.size());
+  EXPECT_EQ(frozen.SerializeAsString(), expected);
+
+  std::string output = "prefix";
+  EXPECT_TRUE(frozen.AppendToString(&output));
+  EXPECT_EQ(output, "prefix" + expected);
+  EXPECT_TRUE(frozen.SerializeToString(&output));
+  EXPECT_EQ(output, expected);
+
+  std::string array(expected.size(), '\0');
+  EXPECT_FALSE(frozen.SerializeToArray(&array[0],
+                                       static_cast<int>(array.size()) - 1));
+  EXPECT_TRUE(
+      frozen.SerializeToArray(&array[0], static_cast<int>(array.size())));
+  EXPECT_EQ(array, expected);
+
+  output.clear();
+  {
+    io::StringOutputStream stream(&output);
+    EXPECT_TRUE(frozen.SerializeToZeroCopyStream(&stream));
+  }
+  EXPECT_EQ(output, expected);
+}
+
+TEST(FrozenMessageTest, ConcurrentSerialization) {
+  TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  const std::string expected = message.SerializeAsString();
+  const FrozenMessage frozen(message);
+
+  std::vector<std::string> outputs(8);
+  std::vector<std::thread> threads;
+  for (std::string& output : outputs) {
+    threads.emplace_back([&frozen, &output] {
+      for (int i = 0; i < 100; ++i) output = frozen.SerializeAsString();
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  for (const std::string& output : outputs) EXPECT_EQ(output, expected);
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
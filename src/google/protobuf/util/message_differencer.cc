@@ -12,25 +12,34 @@
 #include "google/protobuf/util/message_differencer.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <limits>
 #include <memory>
+#include <string>
 #include <utility>
 
 #include "google/protobuf/descriptor.pb.h"
+#include "absl/base/const_init.h"
 #include "absl/container/fixed_array.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/dynamic_message.h"
 #include "google/protobuf/generated_enum_reflection.h"
+#include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/printer.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
@@ -65,6 +74,150 @@ std::string PrintShortTextFormat(const google::protobuf::Message& message) {
   return debug_string;
 }
 
+// Returns true if deterministic serializations of messages of the given type
+// can stand in for Compare() with default options: equal bytes imply that the
+// messages are equal, and different sizes that they are not.  This does not
+// hold once floating point fields (NaN != NaN, 0.0 == -0.0), Any messages
+// (compared unpacked) or extensions (of arbitrary types) are reachable.
+bool SupportsSerializedComparison(
+    const Descriptor* descriptor,
+    absl::flat_hash_set<const Descriptor*>* visited) {
+  if (!visited->insert(descriptor).second) return true;
+  if (descriptor->full_name() == internal::kAnyFullTypeName ||
+      descriptor->extension_range_count() > 0) {
+    return false;
+  }
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    const FieldDescriptor* field = descriptor->field(i);
+    switch (field->cpp_type()) {
+      case FieldDescriptor::CPPTYPE_FLOAT:
+      case FieldDescriptor::CPPTYPE_DOUBLE:
+        return false;
+      case FieldDescriptor::CPPTYPE_MESSAGE:
+        if (!SupportsSerializedComparison(field->message_type(), visited)) {
+          return false;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return true;
+}
+
+// Returns a hash that is the same for floating point values that compare
+// equal, which is only known for exact comparisons.
+size_t HashFloatingPoint(double value, bool exact) {
+  if (!exact) return 0;
+  // NaN only equals NaN with treat_nan_as_equal.
+  if (std::isnan(value)) return 1;
+  // -0.0 equals 0.0.
+  if (value == 0) value = 0;
+  return absl::HashOf(value);
+}
+
+// Results of SupportsSerializedComparison() for generated types, which live
+// as long as the process.
+ABSL_CONST_INIT absl::Mutex generated_serialized_comparison_mutex(
+    absl::kConstInit);
+
+bool SupportsSerializedComparison(const Descriptor* descriptor) {
+  const bool generated =
+      descriptor->file()->pool() == DescriptorPool::generated_pool();
+  static auto* const generated_results =
+      new absl::flat_hash_map<const Descriptor*, bool>();
+  if (generated) {
+    absl::MutexLock lock(&generated_serialized_comparison_mutex);
+    auto it = generated_results->find(descriptor);
+    if (it != generated_results->end()) return it->second;
+  }
+  absl::flat_hash_set<const Descriptor*> visited;
+  bool result = SupportsSerializedComparison(descriptor, &visited);
+  if (generated) {
+    absl::MutexLock lock(&generated_serialized_comparison_mutex);
+    generated_results->emplace(descriptor, result);
+  }
+  return result;
+}
+
+// A ZeroCopyOutputStream that compares what is written to it with an expected
+// serialization, one chunk at a time, instead of storing it.
+class ComparingOutputStream : public io::ZeroCopyOutputStream {
+ public:
+  explicit ComparingOutputStream(absl::string_view expected)
+      : expected_(expected) {}
+
+  bool Next(void** data, int* size) override {
+    CompareChunk();
+    // Once a difference is found, the rest of the output does not matter.
+    if (!equal_) return false;
+    *data = chunk_;
+    *size = chunk_size_ = sizeof(chunk_);
+    return true;
+  }
+  void BackUp(int count) override { chunk_size_ -= count; }
+  int64_t ByteCount() const override { return position_ + chunk_size_; }
+
+  // Returns true if everything written equals the expected serialization.
+  bool Equal() {
+    CompareChunk();
+    return equal_ && position_ == expected_.size();
+  }
+
+ private:
+  void CompareChunk() {
+    if (equal_ && chunk_size_ > 0) {
+      equal_ = expected_.substr(position_, chunk_size_) ==
+               absl::string_view(chunk_, chunk_size_);
+    }
+    position_ += chunk_size_;
+    chunk_size_ = 0;
+  }
+
+  const absl::string_view expected_;
+  char chunk_[8192];
+  int chunk_size_ = 0;
+  size_t position_ = 0;
+  bool equal_ = true;
+};
+
+// Elements of repeated and map fields are compared in parallel in ranges of at
+// least this many elements.
+constexpr int kMinElementsPerTask = 64;
+
+// While a worker compares elements on behalf of another differencer in
+// CompareInParallel(), key comparators created by that differencer compare
+// through the worker.
+PROTOBUF_CONSTINIT PROTOBUF_THREAD_LOCAL const MessageDifferencer*
+    parallel_parent = nullptr;
+PROTOBUF_CONSTINIT PROTOBUF_THREAD_LOCAL MessageDifferencer* parallel_worker =
+    nullptr;
+
+// Lets a worker use the IgnoreCriteria owned by the differencer it works for.
+class SharedIgnoreCriteria : public MessageDifferencer::IgnoreCriteria {
+ public:
+  explicit SharedIgnoreCriteria(IgnoreCriteria* criteria)
+      : criteria_(criteria) {}
+
+  bool IsIgnored(const Message& message1, const Message& message2,
+                 const FieldDescriptor* field,
+                 const std::vector<MessageDifferencer::SpecificField>&
+                     parent_fields) override {
+    return criteria_->IsIgnored(message1, message2, field, parent_fields);
+  }
+  bool IsUnknownFieldIgnored(
+      const Message& message1, const Message& message2,
+      const MessageDifferencer::SpecificField& field,
+      const std::vector<MessageDifferencer::SpecificField>& parent_fields)
+      override {
+    return criteria_->IsUnknownFieldIgnored(message1, message2, field,
+                                            parent_fields);
+  }
+
+ private:
+  IgnoreCriteria* const criteria_;
+};
+
 }  // namespace
 
 // A reporter to report the total number of diffs.
@@ -149,6 +302,15 @@ class MessageDifferencer::MultipleFieldsMapKeyComparator
     return true;
   }
 
+  // Returns a hash that is the same for elements that IsMatch() matches.
+  size_t Hash(const Message& element) const {
+    size_t hash = 0;
+    for (const auto& path : key_field_paths_) {
+      hash = absl::HashOf(hash, HashInternal(element, path, 0));
+    }
+    return hash;
+  }
+
  private:
   bool IsMatchInternal(
       const Message& message1, const Message& message2, int unpacked_any,
@@ -159,13 +321,13 @@ class MessageDifferencer::MultipleFieldsMapKeyComparator
     std::vector<SpecificField> current_parent_fields(parent_fields);
     if (path_index == static_cast<int64_t>(key_field_path.size() - 1)) {
       if (field->is_map()) {
-        return message_differencer_->CompareMapField(
+        return differencer()->CompareMapField(
             message1, message2, unpacked_any, field, &current_parent_fields);
       } else if (field->is_repeated()) {
-        return message_differencer_->CompareRepeatedField(
+        return differencer()->CompareRepeatedField(
             message1, message2, unpacked_any, field, &current_parent_fields);
       } else {
-        return message_differencer_->CompareFieldValueUsingParentFields(
+        return differencer()->CompareFieldValueUsingParentFields(
             message1, message2, unpacked_any, field, -1, -1,
             &current_parent_fields);
       }
@@ -192,6 +354,29 @@ class MessageDifferencer::MultipleFieldsMapKeyComparator
                              key_field_path, path_index + 1);
     }
   }
+  // Returns what HashFieldValues() returns for the key at the end of the
+  // path, or a hash of the missing message in the path.
+  size_t HashInternal(const Message& message,
+                      const std::vector<const FieldDescriptor*>& key_field_path,
+                      int path_index) const {
+    const FieldDescriptor* field = key_field_path[path_index];
+    if (path_index == static_cast<int64_t>(key_field_path.size() - 1)) {
+      return differencer()->HashFieldValues(message, field);
+    }
+    const Reflection* reflection = message.GetReflection();
+    if (!reflection->HasField(message, field)) return 0;
+    return absl::HashOf(
+        true, HashInternal(reflection->GetMessage(message, field),
+                           key_field_path, path_index + 1));
+  }
+
+  // Returns the differencer to compare keys with: the one this comparator
+  // was created for, or the worker comparing elements for it on this thread.
+  MessageDifferencer* differencer() const {
+    return message_differencer_ == parallel_parent ? parallel_worker
+                                                   : message_differencer_;
+  }
+
   MessageDifferencer* message_differencer_;
   std::vector<std::vector<const FieldDescriptor*> > key_field_paths_;
 };
@@ -529,6 +714,9 @@ bool MessageDifferencer::FieldBefore(const FieldDescriptor* field1,
 
 bool MessageDifferencer::Compare(const Message& message1,
                                  const Message& message2) {
+  bool equal;
+  if (CompareSerialized(message1, message2, &equal)) return equal;
+
   std::vector<SpecificField> parent_fields;
   force_compare_no_presence_fields_.clear();
   force_compare_failure_triggering_fields_.clear();
@@ -548,6 +736,62 @@ bool MessageDifferencer::Compare(const Message& message1,
   return result;
 }
 
+bool MessageDifferencer::CompareSerialized(const Message& message1,
+                                           const Message& message2,
+                                           bool* equal) {
+  if (reporter_ != nullptr || output_string_ != nullptr ||
+      message_field_comparison_ != EQUAL || scope_ != FULL ||
+      repeated_field_comparison_ != AS_LIST ||
+      !repeated_field_comparisons_.empty() ||
+      !map_field_key_comparator_.empty() || !ignored_fields_.empty() ||
+      !ignore_criteria_.empty() || field_comparator_kind_ != kFCDefault) {
+    return false;
+  }
+  const Descriptor* descriptor = message1.GetDescriptor();
+  if (descriptor != message2.GetDescriptor()) return false;
+  auto it = serialized_comparison_support_.find(descriptor);
+  if (it == serialized_comparison_support_.end()) {
+    it = serialized_comparison_support_
+             .emplace(descriptor, SupportsSerializedComparison(descriptor))
+             .first;
+  }
+  if (!it->second) return false;
+
+  // Computes and caches the sizes used by SerializeWithCachedSizes() below.
+  const size_t size1 = message1.ByteSizeLong();
+  const size_t size2 = message2.ByteSizeLong();
+  if (size1 != size2) {
+    *equal = false;
+    return true;
+  }
+  if (size1 > static_cast<size_t>(std::numeric_limits<int>::max())) {
+    return false;
+  }
+
+  std::string serialized1;
+  serialized1.resize(size1);
+  {
+    io::ArrayOutputStream array_stream(&serialized1[0],
+                                       static_cast<int>(size1));
+    io::CodedOutputStream coded_stream(&array_stream);
+    coded_stream.SetSerializationDeterministic(true);
+    message1.SerializeWithCachedSizes(&coded_stream);
+  }
+  ComparingOutputStream comparing_stream(serialized1);
+  {
+    io::CodedOutputStream coded_stream(&comparing_stream);
+    coded_stream.SetSerializationDeterministic(true);
+    message2.SerializeWithCachedSizes(&coded_stream);
+  }
+  if (comparing_stream.Equal()) {
+    *equal = true;
+    return true;
+  }
+  // Equal messages may still differ in the order of their unknown fields, so
+  // only the reflective comparison can tell.
+  return false;
+}
+
 bool MessageDifferencer::CompareWithFields(
     const Message& message1, const Message& message2,
     const std::vector<const FieldDescriptor*>& message1_fields_arg,
@@ -1099,6 +1343,41 @@ bool MessageDifferencer::CompareMapFieldByMapReflection(
     HANDLE_TYPE(ENUM, EnumValue, Int32);
 #undef HANDLE_TYPE
     case FieldDescriptor::CPPTYPE_MESSAGE: {
+      if (CanCompareInParallel(count1)) {
+        // The first pass found all the keys, so the values can be paired up
+        // and compared on the executor.
+        std::vector<std::pair<const Message*, const Message*>> values;
+        values.reserve(count1);
+        for (MapIterator it = reflection1->MapBegin(
+                 const_cast<Message*>(&message1), map_field);
+             it !=
+             reflection1->MapEnd(const_cast<Message*>(&message1), map_field);
+             ++it) {
+          MapValueConstRef value2;
+          reflection2->LookupMapValue(message2, map_field, it.GetKey(),
+                                      &value2);
+          values.emplace_back(&it.GetValueRef().GetMessageValue(),
+                              &value2.GetMessageValue());
+        }
+        SpecificField specific_value_field;
+        specific_value_field.message1 = &message1;
+        specific_value_field.message2 = &message2;
+        specific_value_field.unpacked_any = unpacked_any;
+        specific_value_field.field = val_des;
+        parent_fields->push_back(specific_value_field);
+        const std::vector<char> equal_values = CompareInParallel(
+            count1, *parent_fields, /*stop_at_difference=*/true,
+            [&values](MessageDifferencer* worker,
+                      std::vector<SpecificField>* task_parent_fields,
+                      int index) {
+              return worker->Compare(*values[index].first,
+                                     *values[index].second, false,
+                                     task_parent_fields);
+            });
+        parent_fields->pop_back();
+        return std::find(equal_values.begin(), equal_values.end(), false) ==
+               equal_values.end();
+      }
       for (MapIterator it = reflection1->MapBegin(
                const_cast<Message*>(&message1), map_field);
            it !=
@@ -1232,6 +1511,30 @@ bool MessageDifferencer::CompareRepeatedRep(
     }
   }
 
+  // Elements of large message fields may be compared on the executor first.
+  // Those found equal are not compared again below, while the others are, to
+  // report their differences.
+  std::vector<char> equal_elements;
+  if (repeated_field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
+      CanCompareInParallel(count1)) {
+    equal_elements = CompareInParallel(
+        count1, *parent_fields, /*stop_at_difference=*/reporter_ == nullptr,
+        [&](MessageDifferencer* worker,
+            std::vector<SpecificField>* task_parent_fields, int index) {
+          const int new_index = simple_list ? index : match_list1[index];
+          if (new_index < 0 || new_index >= count2) return false;
+          return worker->CompareFieldValueUsingParentFields(
+              message1, message2, unpacked_any, repeated_field, index,
+              new_index, task_parent_fields);
+        });
+    // Elements without an equal peer make the fields different.
+    if (reporter_ == nullptr &&
+        std::find(equal_elements.begin(), equal_elements.end(), false) !=
+            equal_elements.end()) {
+      return false;
+    }
+  }
+
   bool fieldDifferent = false;
   SpecificField specific_field;
   specific_field.message1 = &message1;
@@ -1282,9 +1585,12 @@ bool MessageDifferencer::CompareRepeatedRep(
       next_unmatched_index = match_list1[i] + 1;
     }
 
-    const bool result = CompareFieldValueUsingParentFields(
-        message1, message2, unpacked_any, repeated_field, i,
-        specific_field.new_index, parent_fields);
+    const bool result =
+        (!equal_elements.empty() && equal_elements[i]) ||
+        CompareFieldValueUsingParentFields(message1, message2, unpacked_any,
+                                           repeated_field, i,
+                                           specific_field.new_index,
+                                           parent_fields);
 
     // If we have found differences, either report them or terminate if
     // no reporter is present. Note that ReportModified, ReportMoved, and
@@ -1923,68 +2229,116 @@ bool MessageDifferencer::MatchRepeatedFieldIndices(
         }
       }
     }
-    for (int i = start_offset; i < count1; ++i) {
-      // Indicates any matched elements for this repeated field.
-      bool match = false;
-      int matched_j = -1;
-
-      for (int j = start_offset; j < count2; j++) {
-        if (match_list2->at(j) != -1) {
-          if (!is_treated_as_smart_set || num_diffs_list1[i] == 0 ||
-              num_diffs_list1[match_list2->at(j)] == 0) {
-            continue;
+    if (hash_repeated_field_matching_ && !is_treated_as_smart_set &&
+        CanHashRepeatedFieldElements(key_comparator)) {
+      // Elements that match have the same hash, so only elements in the same
+      // bucket need to be compared.  Buckets list their indices in increasing
+      // order, so the first match found is the one the loop below finds.
+      struct Bucket {
+        std::vector<int> indices;
+        // Indices before this one are all matched already.
+        size_t first_unmatched = 0;
+      };
+      absl::flat_hash_map<size_t, Bucket> buckets;
+      for (int j = start_offset; j < count2; ++j) {
+        buckets[HashRepeatedFieldElement(message2, repeated_field,
+                                         key_comparator, j)]
+            .indices.push_back(j);
+      }
+      for (int i = start_offset; i < count1; ++i) {
+        int matched_j = -1;
+        auto it = buckets.find(HashRepeatedFieldElement(
+            message1, repeated_field, key_comparator, i));
+        if (it != buckets.end()) {
+          Bucket& bucket = it->second;
+          while (bucket.first_unmatched < bucket.indices.size() &&
+                 match_list2->at(bucket.indices[bucket.first_unmatched]) !=
+                     -1) {
+            ++bucket.first_unmatched;
+          }
+          for (size_t k = bucket.first_unmatched; k < bucket.indices.size();
+               ++k) {
+            const int j = bucket.indices[k];
+            if (match_list2->at(j) == -1 &&
+                IsMatch(repeated_field, key_comparator, &message1, &message2,
+                        unpacked_any, parent_fields, nullptr, i, j)) {
+              matched_j = j;
+              break;
+            }
           }
         }
-
-        if (is_treated_as_smart_set) {
-          num_diffs_reporter.Reset();
-          match =
-              IsMatch(repeated_field, key_comparator, &message1, &message2,
-                      unpacked_any, parent_fields, &num_diffs_reporter, i, j);
-        } else {
-          match = IsMatch(repeated_field, key_comparator, &message1, &message2,
-                          unpacked_any, parent_fields, nullptr, i, j);
+        const bool match = (matched_j != -1);
+        if (match) {
+          match_list1->at(i) = matched_j;
+          match_list2->at(matched_j) = i;
         }
+        if (!match && reporter == nullptr) return false;
+        success = success && match;
+      }
+    } else {
+      for (int i = start_offset; i < count1; ++i) {
+        // Indicates any matched elements for this repeated field.
+        bool match = false;
+        int matched_j = -1;
+
+        for (int j = start_offset; j < count2; j++) {
+          if (match_list2->at(j) != -1) {
+            if (!is_treated_as_smart_set || num_diffs_list1[i] == 0 ||
+                num_diffs_list1[match_list2->at(j)] == 0) {
+              continue;
+            }
+          }
 
-        if (is_treated_as_smart_set) {
-          if (match) {
-            num_diffs_list1[i] = 0;
-          } else if (repeated_field->cpp_type() ==
-                     FieldDescriptor::CPPTYPE_MESSAGE) {
-            // Replace with the one with fewer diffs.
-            const int32_t num_diffs = num_diffs_reporter.GetNumDiffs();
-            if (num_diffs < num_diffs_list1[i]) {
-              // If j has been already matched to some element, ensure the
-              // current num_diffs is smaller.
-              if (match_list2->at(j) == -1 ||
-                  num_diffs < num_diffs_list1[match_list2->at(j)]) {
-                num_diffs_list1[i] = num_diffs;
-                match = true;
+          if (is_treated_as_smart_set) {
+            num_diffs_reporter.Reset();
+            match =
+                IsMatch(repeated_field, key_comparator, &message1, &message2,
+                        unpacked_any, parent_fields, &num_diffs_reporter, i, j);
+          } else {
+            match = IsMatch(repeated_field, key_comparator, &message1, &message2,
+                            unpacked_any, parent_fields, nullptr, i, j);
+          }
+
+          if (is_treated_as_smart_set) {
+            if (match) {
+              num_diffs_list1[i] = 0;
+            } else if (repeated_field->cpp_type() ==
+                       FieldDescriptor::CPPTYPE_MESSAGE) {
+              // Replace with the one with fewer diffs.
+              const int32_t num_diffs = num_diffs_reporter.GetNumDiffs();
+              if (num_diffs < num_diffs_list1[i]) {
+                // If j has been already matched to some element, ensure the
+                // current num_diffs is smaller.
+                if (match_list2->at(j) == -1 ||
+                    num_diffs < num_diffs_list1[match_list2->at(j)]) {
+                  num_diffs_list1[i] = num_diffs;
+                  match = true;
+                }
               }
             }
           }
-        }
 
-        if (match) {
-          matched_j = j;
-          if (!is_treated_as_smart_set || num_diffs_list1[i] == 0) {
-            break;
+          if (match) {
+            matched_j = j;
+            if (!is_treated_as_smart_set || num_diffs_list1[i] == 0) {
+              break;
+            }
           }
         }
-      }
 
-      match = (matched_j != -1);
-      if (match) {
-        if (is_treated_as_smart_set && match_list2->at(matched_j) != -1) {
-          // This is to revert the previously matched index in list2.
-          match_list1->at(match_list2->at(matched_j)) = -1;
-          match = false;
+        match = (matched_j != -1);
+        if (match) {
+          if (is_treated_as_smart_set && match_list2->at(matched_j) != -1) {
+            // This is to revert the previously matched index in list2.
+            match_list1->at(match_list2->at(matched_j)) = -1;
+            match = false;
+          }
+          match_list1->at(i) = matched_j;
+          match_list2->at(matched_j) = i;
         }
-        match_list1->at(i) = matched_j;
-        match_list2->at(matched_j) = i;
+        if (!match && reporter == nullptr) return false;
+        success = success && match;
       }
-      if (!match && reporter == nullptr) return false;
-      success = success && match;
     }
   }
 
@@ -1997,6 +2351,258 @@ bool MessageDifferencer::MatchRepeatedFieldIndices(
   return success;
 }
 
+bool MessageDifferencer::CanHashRepeatedFieldElements(
+    const MapKeyComparator* key_comparator) {
+  // Custom comparators and ignore criteria may find any values equal.
+  if (field_comparator_kind_ != kFCDefault || !ignore_criteria_.empty()) {
+    return false;
+  }
+  return key_comparator == nullptr ||
+         key_comparator == &map_entry_key_comparator_ ||
+         std::find(owned_key_comparators_.begin(), owned_key_comparators_.end(),
+                   key_comparator) != owned_key_comparators_.end();
+}
+
+size_t MessageDifferencer::HashRepeatedFieldElement(
+    const Message& message, const FieldDescriptor* repeated_field,
+    const MapKeyComparator* key_comparator, int index) {
+  if (key_comparator == nullptr) {
+    return HashFieldValue(message, repeated_field, index);
+  }
+  const Message& element = message.GetReflection()->GetRepeatedMessage(
+      message, repeated_field, index);
+  if (key_comparator == &map_entry_key_comparator_) {
+    const FieldDescriptor* key = element.GetDescriptor()->FindFieldByNumber(1);
+    // Entries are compared whole if their key is ignored.
+    if (ignored_fields_.contains(key)) return HashMessage(element);
+    return HashFieldValue(element, key, -1);
+  }
+  // Owned key comparators are all created by TreatAsMap*().
+  return static_cast<const MultipleFieldsMapKeyComparator*>(key_comparator)
+      ->Hash(element);
+}
+
+size_t MessageDifferencer::HashMessage(const Message& message) {
+  const Descriptor* descriptor = message.GetDescriptor();
+  // Any payloads are compared unpacked, so they are left out.
+  if (descriptor->full_name() == internal::kAnyFullTypeName) return 0;
+
+  std::vector<const FieldDescriptor*> fields;
+  if (descriptor->options().map_entry()) {
+    fields.push_back(descriptor->field(0));
+    fields.push_back(descriptor->field(1));
+  } else {
+    message.GetReflection()->ListFields(message, &fields);
+  }
+  // Unknown fields are left out, so is everything ignored.
+  size_t hash = 0;
+  for (const FieldDescriptor* field : fields) {
+    if (ignored_fields_.contains(field)) continue;
+    const size_t field_hash = HashFieldValues(message, field);
+    // Singular fields set to their default are equivalent to unset ones, and
+    // equivalent values hash the same.
+    if (message_field_comparison_ == EQUIVALENT && !field->is_repeated() &&
+        field_hash == HashDefaultValue(field)) {
+      continue;
+    }
+    hash = absl::HashOf(hash, field->number(), field_hash);
+  }
+  return hash;
+}
+
+size_t MessageDifferencer::HashFieldValues(const Message& message,
+                                           const FieldDescriptor* field) {
+  if (!field->is_repeated()) return HashFieldValue(message, field, -1);
+
+  const int count = message.GetReflection()->FieldSize(message, field);
+  size_t hash = count;
+  if (IsTreatedAsSet(field) || IsTreatedAsSmartSet(field) ||
+      IsTreatedAsSmartList(field) || GetMapKeyComparator(field) != nullptr) {
+    // Matching elements can be at any index.
+    for (int i = 0; i < count; ++i) {
+      hash += HashFieldValue(message, field, i);
+    }
+  } else {
+    for (int i = 0; i < count; ++i) {
+      hash = absl::HashOf(hash, HashFieldValue(message, field, i));
+    }
+  }
+  return hash;
+}
+
+size_t MessageDifferencer::HashFieldValue(const Message& message,
+                                          const FieldDescriptor* field,
+                                          int index) {
+  const Reflection* reflection = message.GetReflection();
+  const bool exact_floats =
+      field_comparator_.default_impl->float_comparison() ==
+      DefaultFieldComparator::EXACT;
+  switch (field->cpp_type()) {
+#define HASH_FIELD_VALUE(CPPTYPE, METHOD)                                  \
+  case FieldDescriptor::CPPTYPE_##CPPTYPE:                                 \
+    return absl::HashOf(                                                   \
+        index == -1 ? reflection->Get##METHOD(message, field)              \
+                    : reflection->GetRepeated##METHOD(message, field, index))
+
+    HASH_FIELD_VALUE(INT32, Int32);
+    HASH_FIELD_VALUE(INT64, Int64);
+    HASH_FIELD_VALUE(UINT32, UInt32);
+    HASH_FIELD_VALUE(UINT64, UInt64);
+    HASH_FIELD_VALUE(BOOL, Bool);
+    HASH_FIELD_VALUE(ENUM, EnumValue);
+#undef HASH_FIELD_VALUE
+
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      return HashFloatingPoint(
+          index == -1 ? reflection->GetFloat(message, field)
+                      : reflection->GetRepeatedFloat(message, field, index),
+          exact_floats);
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      return HashFloatingPoint(
+          index == -1 ? reflection->GetDouble(message, field)
+                      : reflection->GetRepeatedDouble(message, field, index),
+          exact_floats);
+    case FieldDescriptor::CPPTYPE_STRING: {
+      std::string scratch;
+      const std::string& value =
+          index == -1 ? reflection->GetStringReference(message, field, &scratch)
+                      : reflection->GetRepeatedStringReference(message, field,
+                                                               index, &scratch);
+      return absl::HashOf(absl::string_view(value));
+    }
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      return HashMessage(
+          index == -1 ? reflection->GetMessage(message, field)
+                      : reflection->GetRepeatedMessage(message, field, index));
+  }
+  return 0;
+}
+
+size_t MessageDifferencer::HashDefaultValue(const FieldDescriptor* field) {
+  const bool exact_floats =
+      field_comparator_.default_impl->float_comparison() ==
+      DefaultFieldComparator::EXACT;
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+      return absl::HashOf(field->default_value_int32());
+    case FieldDescriptor::CPPTYPE_INT64:
+      return absl::HashOf(field->default_value_int64());
+    case FieldDescriptor::CPPTYPE_UINT32:
+      return absl::HashOf(field->default_value_uint32());
+    case FieldDescriptor::CPPTYPE_UINT64:
+      return absl::HashOf(field->default_value_uint64());
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return absl::HashOf(field->default_value_bool());
+    case FieldDescriptor::CPPTYPE_ENUM:
+      return absl::HashOf(field->default_value_enum()->number());
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      return HashFloatingPoint(field->default_value_float(), exact_floats);
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      return HashFloatingPoint(field->default_value_double(), exact_floats);
+    case FieldDescriptor::CPPTYPE_STRING:
+      return absl::HashOf(absl::string_view(field->default_value_string()));
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      // What HashMessage() returns for a message without fields.
+      return 0;
+  }
+  return 0;
+}
+
+bool MessageDifferencer::CanCompareInParallel(int count) const {
+  if (!executor_ || max_tasks_ < 2 || count < 2 * kMinElementsPerTask) {
+    return false;
+  }
+  if (reporter_ == nullptr) return true;
+  // Elements found equal are not compared again with the reporter, so nothing
+  // may be reported for them.
+  if (scope_ == PARTIAL || report_matches_) return false;
+  if (report_ignores_ &&
+      (!ignored_fields_.empty() || !ignore_criteria_.empty())) {
+    return false;
+  }
+  if (report_moves_) {
+    if (!map_field_key_comparator_.empty() ||
+        repeated_field_comparison_ == AS_SET ||
+        repeated_field_comparison_ == AS_SMART_SET) {
+      return false;
+    }
+    for (const auto& field_comparison : repeated_field_comparisons_) {
+      if (field_comparison.second == AS_SET ||
+          field_comparison.second == AS_SMART_SET) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+std::vector<char> MessageDifferencer::CompareInParallel(
+    int count, const std::vector<SpecificField>& parent_fields,
+    bool stop_at_difference,
+    const std::function<bool(MessageDifferencer* worker,
+                             std::vector<SpecificField>* parent_fields,
+                             int index)>& compare) {
+  std::vector<char> results(count, false);
+  const int tasks = std::min(max_tasks_, count / kMinElementsPerTask);
+  std::atomic<bool> difference_found{false};
+  absl::Mutex mutex;
+  int running = tasks;
+  for (int task = 0; task < tasks; ++task) {
+    const int begin = static_cast<int>(int64_t{count} * task / tasks);
+    const int end = static_cast<int>(int64_t{count} * (task + 1) / tasks);
+    executor_([&, begin, end] {
+      MessageDifferencer worker;
+      CopyComparisonSettingsTo(&worker);
+      std::vector<SpecificField> task_parent_fields(parent_fields);
+      // The executor may run the task on a thread that is itself comparing.
+      const MessageDifferencer* const outer_parent = parallel_parent;
+      MessageDifferencer* const outer_worker = parallel_worker;
+      parallel_parent = this;
+      parallel_worker = &worker;
+      for (int i = begin; i < end; ++i) {
+        if (stop_at_difference &&
+            difference_found.load(std::memory_order_relaxed)) {
+          break;
+        }
+        results[i] = compare(&worker, &task_parent_fields, i);
+        if (!results[i]) {
+          difference_found.store(true, std::memory_order_relaxed);
+        }
+      }
+      parallel_parent = outer_parent;
+      parallel_worker = outer_worker;
+      absl::MutexLock lock(&mutex);
+      --running;
+    });
+  }
+  absl::MutexLock lock(&mutex);
+  mutex.Await(absl::Condition(
+      +[](int* running) { return *running == 0; }, &running));
+  return results;
+}
+
+void MessageDifferencer::CopyComparisonSettingsTo(
+    MessageDifferencer* worker) const {
+  worker->message_field_comparison_ = message_field_comparison_;
+  worker->scope_ = scope_;
+  worker->force_compare_no_presence_ = force_compare_no_presence_;
+  worker->repeated_field_comparison_ = repeated_field_comparison_;
+  worker->repeated_field_comparisons_ = repeated_field_comparisons_;
+  // Key comparators created by this differencer compare through the worker
+  // while it runs, see MultipleFieldsMapKeyComparator::differencer().
+  worker->map_field_key_comparator_ = map_field_key_comparator_;
+  for (const auto& criteria : ignore_criteria_) {
+    worker->ignore_criteria_.push_back(
+        std::make_unique<SharedIgnoreCriteria>(criteria.get()));
+  }
+  worker->ignored_fields_ = ignored_fields_;
+  worker->field_comparator_ = field_comparator_;
+  worker->field_comparator_kind_ = field_comparator_kind_;
+  worker->hash_repeated_field_matching_ = hash_repeated_field_matching_;
+  worker->match_indices_for_smart_list_callback_ =
+      match_indices_for_smart_list_callback_;
+}
+
 FieldComparator::ComparisonResult MessageDifferencer::GetFieldComparisonResult(
     const Message& message1, const Message& message2,
     const FieldDescriptor* field, int index1, int index2,
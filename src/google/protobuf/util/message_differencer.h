@@ -23,6 +23,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "google/protobuf/stubs/common.h"
@@ -83,6 +84,10 @@ class FieldContext;  // declared below MessageDifferencer
 // - Equals code generator by compiler plugin (net/proto2/contrib/equals_plugin)
 // Downside: more generated code; maintenance overhead for the additional rule
 // (must be in sync with the original proto_library).
+// With the default options and no reporter, Compare() itself first compares
+// the deterministic serializations of messages whose types reach no floating
+// point, Any or extension fields, and only walks the fields through
+// reflection if they differ without differing in size.
 //
 // Note on handling of google.protobuf.Any: MessageDifferencer automatically
 // unpacks Any::value into a Message and compares its individual fields.
@@ -416,9 +421,8 @@ class PROTOBUF_EXPORT MessageDifferencer {
   // not cause the comparison to fail.
   //
   // Note that set comparison is currently O(k * n^2) (where n is the total
-  // number of elements, and k is the average size of each element). In theory
-  // it could be made O(n * k) with a more complex hashing implementation. Feel
-  // free to contribute one if the current implementation is too slow for you.
+  // number of elements, and k is the average size of each element), or
+  // typically O(k * n) with set_hash_repeated_field_matching(true).
   // If partial matching is also enabled, the time complexity will be O(k * n^2
   // + n^3) in which n^3 is the time complexity of the maximum matching
   // algorithm.
@@ -561,6 +565,40 @@ class PROTOBUF_EXPORT MessageDifferencer {
   // a new differencer is true.
   void set_report_moves(bool report_moves) { report_moves_ = report_moves; }
 
+  // Tells the differencer to match the elements of repeated fields treated as
+  // sets or maps by first bucketing them by a hash of what is compared to
+  // match them (the map keys, or the whole elements minus ignored fields), and
+  // to only compare elements within a bucket.  The matches found are the same.
+  // Not used with PARTIAL scope, AS_SMART_SET, ignore criteria, a custom
+  // FieldComparator, or keys compared by a custom MapKeyComparator.  This
+  // method must be called before Compare. The default for a new differencer
+  // is false.
+  void set_hash_repeated_field_matching(bool hash_repeated_field_matching) {
+    hash_repeated_field_matching_ = hash_repeated_field_matching;
+  }
+
+  // Lets Compare() compare the elements of large repeated and map fields on
+  // several threads.  The elements of such a field are split into up to
+  // `max_tasks` ranges, which are compared by tasks passed to `executor`,
+  // typically running them on a thread pool, using differencers with the same
+  // settings but no reporter.  Elements found different are then compared
+  // again on the calling thread to report the differences, so the reporter
+  // sees the same calls in the same order as with a serial comparison.
+  //
+  // All tasks are waited for before Compare() returns, so the executor must
+  // not run them on the calling thread after it blocks.  The FieldComparator,
+  // MapKeyComparators and IgnoreCriteria, if any, are called concurrently.
+  // Fields are compared on one thread while a reporter is set and the scope
+  // is PARTIAL, matches are reported, ignored fields are reported, or moves
+  // within fields treated as sets or maps are reported, since equal elements
+  // then have reports of their own.  This method must be called before
+  // Compare.
+  void set_executor(std::function<void(std::function<void()> task)> executor,
+                    int max_tasks = 8) {
+    executor_ = std::move(executor);
+    max_tasks_ = max_tasks;
+  }
+
   // Tells the differencer whether or not to report ignored values. This method
   // must be called before Compare. The default for a new differencer is true.
   void set_report_ignores(bool report_ignores) {
@@ -779,6 +817,13 @@ class PROTOBUF_EXPORT MessageDifferencer {
   bool Compare(const Message& message1, const Message& message2,
                int unpacked_any, std::vector<SpecificField>* parent_fields);
 
+  // Decides Compare(message1, message2) from deterministic serializations of
+  // the messages when the options are the defaults and no floating point,
+  // Any or extension fields are involved.  Returns false if the reflective
+  // comparison is needed, otherwise sets *equal to the result.
+  bool CompareSerialized(const Message& message1, const Message& message2,
+                         bool* equal);
+
   // Compares all the unknown fields in two messages.
   bool CompareUnknownFields(const Message& message1, const Message& message2,
                             const UnknownFieldSet&, const UnknownFieldSet&,
@@ -910,6 +955,55 @@ class PROTOBUF_EXPORT MessageDifferencer {
       const std::vector<SpecificField>& parent_fields,
       std::vector<int>* match_list1, std::vector<int>* match_list2);
 
+  // Returns true if MatchRepeatedFieldIndices() can bucket the elements of
+  // repeated fields compared with the given key comparator by
+  // HashRepeatedFieldElement().
+  bool CanHashRepeatedFieldElements(const MapKeyComparator* key_comparator);
+
+  // Returns a hash of what IsMatch() compares for the element at `index` of
+  // `repeated_field`: elements that match have the same hash.
+  size_t HashRepeatedFieldElement(const Message& message,
+                                  const FieldDescriptor* repeated_field,
+                                  const MapKeyComparator* key_comparator,
+                                  int index);
+
+  // Returns a hash that is the same for messages that Compare() finds equal.
+  size_t HashMessage(const Message& message);
+
+  // Returns a hash of all the values of `field` in `message`, combined in an
+  // order-insensitive way if the field is not compared as a list.  For
+  // singular fields, unset values are hashed as their defaults.
+  size_t HashFieldValues(const Message& message, const FieldDescriptor* field);
+
+  // Returns a hash of one value of `field`, or of the singular value if
+  // `index` is -1.
+  size_t HashFieldValue(const Message& message, const FieldDescriptor* field,
+                        int index);
+
+  // Returns what HashFieldValue() returns for the default value of a singular
+  // field.
+  size_t HashDefaultValue(const FieldDescriptor* field);
+
+  // Returns true if CompareInParallel() can compare the `count` elements of a
+  // repeated or map field without changing what is reported.
+  bool CanCompareInParallel(int count) const;
+
+  // Calls compare(worker, parent_fields, i) for every i in [0, count) from
+  // tasks passed to the executor, where `worker` compares like this
+  // differencer but reports nothing and `parent_fields` is the task's copy of
+  // the given ones, and returns the results.  Once a result is false, the
+  // remaining ones are left false if `stop_at_difference`.
+  std::vector<char> CompareInParallel(
+      int count, const std::vector<SpecificField>& parent_fields,
+      bool stop_at_difference,
+      const std::function<bool(MessageDifferencer* worker,
+                               std::vector<SpecificField>* parent_fields,
+                               int index)>& compare);
+
+  // Gives `worker` the settings of this differencer that affect the result of
+  // comparisons.
+  void CopyComparisonSettingsTo(MessageDifferencer* worker) const;
+
   // Checks if index is equal to new_index in all the specific fields.
   static bool CheckPathChanged(const std::vector<SpecificField>& parent_fields);
 
@@ -945,6 +1039,9 @@ class PROTOBUF_EXPORT MessageDifferencer {
 
   absl::flat_hash_set<const FieldDescriptor*> ignored_fields_;
 
+  // Whether CompareSerialized() can decide comparisons of each message type.
+  absl::flat_hash_map<const Descriptor*, bool> serialized_comparison_support_;
+
   union {
     DefaultFieldComparator* default_impl;
     FieldComparator* base;
@@ -955,6 +1052,7 @@ class PROTOBUF_EXPORT MessageDifferencer {
   bool report_moves_;
   bool report_ignores_;
   bool force_compare_no_presence_ = false;
+  bool hash_repeated_field_matching_ = false;
 
   std::string* output_string_;
 
@@ -963,6 +1061,10 @@ class PROTOBUF_EXPORT MessageDifferencer {
       match_indices_for_smart_list_callback_;
 
   MessageDifferencer::UnpackAnyField unpack_any_field_;
+
+  // Runs the tasks of CompareInParallel(), if set with set_executor().
+  std::function<void(std::function<void()> task)> executor_;
+  int max_tasks_ = 8;
 };
 
 // This class provides extra information to the FieldComparator::Compare
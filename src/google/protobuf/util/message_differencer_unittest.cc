@@ -14,8 +14,12 @@
 #include "google/protobuf/util/message_differencer.h"
 
 #include <algorithm>
+#include <functional>
+#include <limits>
 #include <random>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "google/protobuf/stubs/common.h"
@@ -104,6 +108,61 @@ TEST(MessageDifferencerTest, BasicInequalityTest) {
   EXPECT_FALSE(util::MessageDifferencer::Equals(msg1, msg2));
 }
 
+TEST(MessageDifferencerTest, SerializedComparisonTest) {
+  // Types without floating point fields are compared by serialization first.
+  unittest::TestCamelCaseFieldNames msg1;
+  msg1.set_primitivefield(1);
+  msg1.set_stringfield("string");
+  msg1.mutable_messagefield()->set_c(2);
+  msg1.add_repeatedstringfield("a");
+  msg1.add_repeatedstringfield("b");
+  unittest::TestCamelCaseFieldNames msg2 = msg1;
+  EXPECT_TRUE(util::MessageDifferencer::Equals(msg1, msg2));
+
+  // Same size, different bytes.
+  msg2.mutable_messagefield()->set_c(3);
+  EXPECT_FALSE(util::MessageDifferencer::Equals(msg1, msg2));
+
+  // Different sizes.
+  msg2 = msg1;
+  msg2.add_repeatedstringfield("c");
+  EXPECT_FALSE(util::MessageDifferencer::Equals(msg1, msg2));
+
+  // Unknown fields in a different order serialize differently but are equal.
+  msg2 = msg1;
+  msg1.GetReflection()->MutableUnknownFields(&msg1)->AddVarint(100, 1);
+  msg1.GetReflection()->MutableUnknownFields(&msg1)->AddVarint(101, 2);
+  msg2.GetReflection()->MutableUnknownFields(&msg2)->AddVarint(101, 2);
+  msg2.GetReflection()->MutableUnknownFields(&msg2)->AddVarint(100, 1);
+  EXPECT_TRUE(util::MessageDifferencer::Equals(msg1, msg2));
+
+  // A reporter still sees every difference.
+  msg2.set_primitivefield(4);
+  msg2.mutable_messagefield()->set_c(3);
+  util::MessageDifferencer differencer;
+  std::string output;
+  differencer.ReportDifferencesToString(&output);
+  EXPECT_FALSE(differencer.Compare(msg1, msg2));
+  EXPECT_EQ(
+      "modified: PrimitiveField: 1 -> 4\n"
+      "modified: MessageField.c: 2 -> 3\n",
+      output);
+}
+
+TEST(MessageDifferencerTest, SerializedComparisonSkipsFloatsTest) {
+  // NaN serializes to the same bytes but never compares equal, and -0.0 and
+  // 0.0 compare equal.
+  unittest::TestAllTypes msg1;
+  unittest::TestAllTypes msg2;
+  msg1.set_optional_double(std::numeric_limits<double>::quiet_NaN());
+  msg2.set_optional_double(std::numeric_limits<double>::quiet_NaN());
+  EXPECT_FALSE(util::MessageDifferencer::Equals(msg1, msg2));
+
+  msg1.set_optional_double(-0.0);
+  msg2.set_optional_double(0.0);
+  EXPECT_TRUE(util::MessageDifferencer::Equals(msg1, msg2));
+}
+
 TEST(MessageDifferencerTest, RepeatedFieldInequalityTest) {
   // Create the testing protos
   unittest::TestAllTypes msg1;
@@ -1679,6 +1738,179 @@ TEST(MessageDifferencerTest, RepeatedFieldSetTest_Combination) {
   EXPECT_TRUE(differencer2.Compare(msg1, msg2));
 }
 
+TEST(MessageDifferencerTest, RepeatedFieldSetTest_HashMatching) {
+  protobuf_unittest::TestDiffMessage msg1;
+  protobuf_unittest::TestDiffMessage msg2;
+  for (int i = 0; i < 200; ++i) {
+    protobuf_unittest::TestDiffMessage::Item* item = msg1.add_item();
+    item->set_a(i % 50);
+    item->set_b(absl::StrCat("b", i));
+    item->add_ra(i);
+    item->add_ra(-i);
+    (*item->mutable_mp())[absl::StrCat(i)] = i;
+    msg1.add_rv(i % 7);
+  }
+  // Reverse the items, their "ra" elements and "rv", and change a few items.
+  for (int i = msg1.item_size() - 1; i >= 0; --i) {
+    protobuf_unittest::TestDiffMessage::Item* item = msg2.add_item();
+    *item = msg1.item(i);
+    item->clear_ra();
+    item->add_ra(-i);
+    item->add_ra(i);
+    msg2.add_rv(msg1.rv(i));
+  }
+  msg2.mutable_item(3)->set_b("changed");
+  msg2.mutable_item(10)->add_ra(1000);
+  (*msg2.mutable_item(20)->mutable_mp())["new"] = 1;
+  msg2.add_rv(1);
+
+  const Descriptor* descriptor = msg1.GetDescriptor();
+  const Descriptor* item_descriptor = msg1.item(0).GetDescriptor();
+  std::vector<std::function<void(util::MessageDifferencer*)>> configurations =
+      {
+          [&](util::MessageDifferencer* differencer) {
+            differencer->set_repeated_field_comparison(
+                util::MessageDifferencer::AS_SET);
+          },
+          [&](util::MessageDifferencer* differencer) {
+            differencer->set_repeated_field_comparison(
+                util::MessageDifferencer::AS_SET);
+            differencer->IgnoreField(item_descriptor->FindFieldByName("b"));
+          },
+          [&](util::MessageDifferencer* differencer) {
+            differencer->TreatAsMap(descriptor->FindFieldByName("item"),
+                                    item_descriptor->FindFieldByName("b"));
+            differencer->TreatAsSet(item_descriptor->FindFieldByName("ra"));
+            differencer->TreatAsSet(descriptor->FindFieldByName("rv"));
+          },
+          [&](util::MessageDifferencer* differencer) {
+            differencer->TreatAsMapWithMultipleFieldsAsKey(
+                descriptor->FindFieldByName("item"),
+                {item_descriptor->FindFieldByName("a"),
+                 item_descriptor->FindFieldByName("mp")});
+            differencer->set_message_field_comparison(
+                util::MessageDifferencer::EQUIVALENT);
+          },
+      };
+  for (const auto& configure : configurations) {
+    std::string output;
+    util::MessageDifferencer differencer;
+    configure(&differencer);
+    differencer.ReportDifferencesToString(&output);
+    EXPECT_FALSE(differencer.Compare(msg1, msg2));
+
+    std::string hash_output;
+    util::MessageDifferencer hash_differencer;
+    configure(&hash_differencer);
+    hash_differencer.set_hash_repeated_field_matching(true);
+    hash_differencer.ReportDifferencesToString(&hash_output);
+    EXPECT_FALSE(hash_differencer.Compare(msg1, msg2));
+    EXPECT_EQ(output, hash_output);
+
+    util::MessageDifferencer equal_differencer;
+    configure(&equal_differencer);
+    equal_differencer.set_hash_repeated_field_matching(true);
+    EXPECT_TRUE(equal_differencer.Compare(msg1, msg1));
+  }
+}
+
+TEST(MessageDifferencerTest, ParallelCompareTest) {
+  protobuf_unittest::TestDiffMessage msg1;
+  for (int i = 0; i < 1000; ++i) {
+    protobuf_unittest::TestDiffMessage::Item* item = msg1.add_item();
+    item->set_a(i);
+    item->set_b(absl::StrCat("b", i));
+    item->add_ra(i);
+    item->add_ra(-i);
+    (*item->mutable_mp())[absl::StrCat(i)] = i;
+  }
+  protobuf_unittest::TestDiffMessage msg2 = msg1;
+  msg2.mutable_item(5)->set_b("changed");
+  msg2.mutable_item(500)->add_ra(1000);
+  msg2.mutable_item(999)->mutable_mp()->clear();
+
+  const Descriptor* descriptor = msg1.GetDescriptor();
+  const Descriptor* item_descriptor = msg1.item(0).GetDescriptor();
+  std::vector<std::function<void(util::MessageDifferencer*)>> configurations =
+      {
+          [](util::MessageDifferencer* differencer) {},
+          [&](util::MessageDifferencer* differencer) {
+            differencer->TreatAsMap(descriptor->FindFieldByName("item"),
+                                    item_descriptor->FindFieldByName("a"));
+            differencer->TreatAsSet(item_descriptor->FindFieldByName("ra"));
+            differencer->set_report_moves(false);
+          },
+          [&](util::MessageDifferencer* differencer) {
+            differencer->set_message_field_comparison(
+                util::MessageDifferencer::EQUIVALENT);
+            differencer->IgnoreField(item_descriptor->FindFieldByName("b"));
+            differencer->set_report_ignores(false);
+          },
+      };
+  std::vector<std::thread> threads;
+  auto executor = [&threads](std::function<void()> task) {
+    threads.emplace_back(std::move(task));
+  };
+  auto join_threads = [&threads] {
+    for (std::thread& thread : threads) thread.join();
+    const size_t count = threads.size();
+    threads.clear();
+    return count;
+  };
+  for (const auto& configure : configurations) {
+    std::string output;
+    util::MessageDifferencer differencer;
+    configure(&differencer);
+    differencer.ReportDifferencesToString(&output);
+    EXPECT_FALSE(differencer.Compare(msg1, msg2));
+
+    std::string parallel_output;
+    util::MessageDifferencer parallel_differencer;
+    configure(&parallel_differencer);
+    parallel_differencer.set_executor(executor, 4);
+    parallel_differencer.ReportDifferencesToString(&parallel_output);
+    EXPECT_FALSE(parallel_differencer.Compare(msg1, msg2));
+    EXPECT_EQ(join_threads(), 4u);
+    EXPECT_EQ(output, parallel_output);
+
+    util::MessageDifferencer boolean_differencer;
+    configure(&boolean_differencer);
+    boolean_differencer.set_executor(executor);
+    EXPECT_FALSE(boolean_differencer.Compare(msg1, msg2));
+    EXPECT_GT(join_threads(), 1);
+    EXPECT_TRUE(boolean_differencer.Compare(msg1, msg1));
+    join_threads();
+  }
+
+  // Matches are reported for equal elements, which are then compared on the
+  // calling thread.
+  util::MessageDifferencer matching_differencer;
+  std::string output;
+  matching_differencer.set_executor(executor);
+  matching_differencer.set_report_matches(true);
+  matching_differencer.ReportDifferencesToString(&output);
+  EXPECT_FALSE(matching_differencer.Compare(msg1, msg2));
+  EXPECT_EQ(join_threads(), 0u);
+}
+
+TEST(MessageDifferencerTest, ParallelCompareMapTest) {
+  unittest::TestMap msg1;
+  for (int i = 0; i < 1000; ++i) {
+    (*msg1.mutable_map_int32_foreign_message())[i].set_c(i);
+  }
+  unittest::TestMap msg2 = msg1;
+  std::vector<std::thread> threads;
+  util::MessageDifferencer differencer;
+  differencer.set_executor([&threads](std::function<void()> task) {
+    threads.emplace_back(std::move(task));
+  });
+  EXPECT_TRUE(differencer.Compare(msg1, msg2));
+  EXPECT_GT(threads.size(), 1);
+  (*msg2.mutable_map_int32_foreign_message())[700].set_c(-1);
+  EXPECT_FALSE(differencer.Compare(msg1, msg2));
+  for (std::thread& thread : threads) thread.join();
+}
+
 TEST(MessageDifferencerTest, RepeatedFieldMapTest_Partial) {
   protobuf_unittest::TestDiffMessage msg1;
   // message msg1 {
@@ -0,0 +1,123 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/message_hash.h"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/hash/hash.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/unknown_field_set.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+absl::HashState HashMessageContents(absl::HashState state,
+                                    const Message& message);
+
+// Hashes element `index` of `field`, or its value if `index` is -1.
+absl::HashState HashFieldValue(absl::HashState state, const Message& message,
+                               const FieldDescriptor* field, int index) {
+  const Reflection* reflection = message.GetReflection();
+  switch (field->cpp_type()) {
+#define HANDLE_TYPE(CPPTYPE, METHOD)                                    \
+  case FieldDescriptor::CPPTYPE_##CPPTYPE:                             \
+    return absl::HashState::combine(                                   \
+        std::move(state),                                              \
+        index < 0 ? reflection->Get##METHOD(message, field)            \
+                  : reflection->GetRepeated##METHOD(message, field, index));
+
+    HANDLE_TYPE(INT32, Int32);
+    HANDLE_TYPE(INT64, Int64);
+    HANDLE_TYPE(UINT32, UInt32);
+    HANDLE_TYPE(UINT64, UInt64);
+    HANDLE_TYPE(FLOAT, Float);
+    HANDLE_TYPE(DOUBLE, Double);
+    HANDLE_TYPE(BOOL, Bool);
+    HANDLE_TYPE(ENUM, EnumValue);
+#undef HANDLE_TYPE
+
+    case FieldDescriptor::CPPTYPE_STRING: {
+      std::string scratch;
+      const std::string& value =
+          index < 0 ? reflection->GetStringReference(message, field, &scratch)
+                    : reflection->GetRepeatedStringReference(message, field,
+                                                             index, &scratch);
+      return absl::HashState::combine(std::move(state),
+                                      absl::string_view(value));
+    }
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      return HashMessageContents(
+          std::move(state),
+          index < 0 ? reflection->GetMessage(message, field)
+                    : reflection->GetRepeatedMessage(message, field, index));
+  }
+  return state;
+}
+
+absl::HashState HashMessageContents(absl::HashState state,
+                                    const Message& message) {
+  const Reflection* reflection = message.GetReflection();
+  // ListFields() returns the set fields in field number order.
+  std::vector<const FieldDescriptor*> fields;
+  reflection->ListFields(message, &fields);
+  for (const FieldDescriptor* field : fields) {
+    state = absl::HashState::combine(std::move(state), field->number());
+    if (field->is_map()) {
+      // Map entries are stored in no particular order, so their hashes are
+      // summed.
+      const int size = reflection->FieldSize(message, field);
+      size_t entries = 0;
+      for (int i = 0; i < size; ++i) {
+        entries += absl::HashOf(
+            HashableMessage(reflection->GetRepeatedMessage(message, field, i)));
+      }
+      state = absl::HashState::combine(std::move(state), size, entries);
+    } else if (field->is_repeated()) {
+      const int size = reflection->FieldSize(message, field);
+      for (int i = 0; i < size; ++i) {
+        state = HashFieldValue(std::move(state), message, field, i);
+      }
+      state = absl::HashState::combine(std::move(state), size);
+    } else {
+      state = HashFieldValue(std::move(state), message, field, -1);
+    }
+  }
+
+  const UnknownFieldSet& unknown_fields = reflection->GetUnknownFields(message);
+  if (!unknown_fields.empty()) {
+    // Parsed unknown fields are held in wire format already.
+    std::string data;
+    unknown_fields.SerializeToString(&data);
+    state = absl::HashState::combine(std::move(state), data);
+  }
+  // Ends the message, so that the fields that follow a submessage are not
+  // taken for its own.
+  return absl::HashState::combine(std::move(state), fields.size());
+}
+
+}  // namespace
+
+void HashMessage(absl::HashState state, const Message& message) {
+  HashMessageContents(std::move(state), message);
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,68 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Defines utilities for hashing the contents of messages with absl::Hash.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_MESSAGE_HASH_H__
+#define GOOGLE_PROTOBUF_UTIL_MESSAGE_HASH_H__
+
+#include "absl/hash/hash.h"
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+// Feeds the contents of `message` into `state`, without serializing it.
+//
+// Set fields are visited in field number order, so the result does not depend
+// on the order in which fields were set or parsed. The elements of map fields
+// are combined without regard to order. Floating point values are hashed by
+// value, so 0.0 and -0.0 hash the same. Unknown fields are hashed as their
+// wire format, in the order in which they are stored.
+//
+// Messages that are equal as compared by a default MessageDifferencer hash the
+// same, except for google.protobuf.Any fields, which are hashed as they are
+// stored rather than unpacked.
+PROTOBUF_EXPORT void HashMessage(absl::HashState state,
+                                 const Message& message);
+
+// Makes a message hashable with absl::Hash, by its contents:
+//
+//   size_t key = absl::HashOf(util::HashableMessage(request));
+//
+//   template <typename H>
+//   friend H AbslHashValue(H state, const CacheKey& key) {
+//     return H::combine(std::move(state), key.shard,
+//                       util::HashableMessage(*key.request));
+//   }
+//
+// The message must outlive the HashableMessage.
+class HashableMessage {
+ public:
+  explicit HashableMessage(const Message& message) : message_(message) {}
+
+  template <typename H>
+  friend H AbslHashValue(H state, const HashableMessage& hashable) {
+    HashMessage(absl::HashState::Create(&state), hashable.message_);
+    return state;
+  }
+
+ private:
+  const Message& message_;
+};
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_MESSAGE_HASH_H__
@@ -0,0 +1,125 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/message_hash.h"
+
+#include <cstddef>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/hash/hash.h"
+#include "google/protobuf/map_unittest.pb.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::NestedTestAllTypes;
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestMap;
+
+size_t Hash(const Message& message) {
+  return absl::HashOf(HashableMessage(message));
+}
+
+TEST(MessageHashTest, EqualMessagesHashTheSame) {
+  TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  TestAllTypes copy = message;
+  EXPECT_EQ(Hash(message), Hash(copy));
+
+  TestAllTypes parsed;
+  ASSERT_TRUE(parsed.ParseFromString(message.SerializeAsString()));
+  EXPECT_EQ(Hash(message), Hash(parsed));
+
+  // The order in which fields are set does not matter.
+  TestAllTypes first;
+  first.set_optional_int32(1);
+  first.set_optional_string("foo");
+  TestAllTypes second;
+  second.set_optional_string("foo");
+  second.set_optional_int32(1);
+  EXPECT_EQ(Hash(first), Hash(second));
+
+  TestAllTypes zero;
+  zero.set_optional_double(0.0);
+  TestAllTypes negative_zero;
+  negative_zero.set_optional_double(-0.0);
+  EXPECT_EQ(Hash(zero), Hash(negative_zero));
+}
+
+TEST(MessageHashTest, DifferentMessagesHashDifferently) {
+  TestAllTypes empty;
+  TestAllTypes message;
+  message.set_optional_int32(1);
+  EXPECT_NE(Hash(empty), Hash(message));
+
+  // Present fields are hashed even when they hold their default value.
+  TestAllTypes default_value;
+  default_value.set_optional_int32(0);
+  EXPECT_NE(Hash(empty), Hash(default_value));
+
+  TestAllTypes repeated;
+  repeated.add_repeated_int32(1);
+  repeated.add_repeated_int32(2);
+  TestAllTypes reversed;
+  reversed.add_repeated_int32(2);
+  reversed.add_repeated_int32(1);
+  EXPECT_NE(Hash(repeated), Hash(reversed));
+
+  // A field after a submessage does not hash like a field within it.
+  NestedTestAllTypes inner;
+  inner.mutable_child()->mutable_payload()->set_optional_int32(1);
+  NestedTestAllTypes outer;
+  outer.mutable_child();
+  outer.mutable_payload()->set_optional_int32(1);
+  EXPECT_NE(Hash(inner), Hash(outer));
+}
+
+TEST(MessageHashTest, MapsHashRegardlessOfOrder) {
+  TestMap first;
+  TestMap second;
+  for (int i = 0; i < 100; ++i) {
+    (*first.mutable_map_int32_int32())[i] = i;
+    (*second.mutable_map_int32_int32())[99 - i] = 99 - i;
+    (*first.mutable_map_string_string())[std::to_string(i)] = "x";
+    (*second.mutable_map_string_string())[std::to_string(99 - i)] = "x";
+  }
+  EXPECT_EQ(Hash(first), Hash(second));
+
+  (*second.mutable_map_int32_int32())[5] = 6;
+  EXPECT_NE(Hash(first), Hash(second));
+}
+
+TEST(MessageHashTest, UnknownFields) {
+  TestAllTypes message;
+  message.set_optional_int32(1);
+  TestAllTypes unknown = message;
+  unknown.mutable_unknown_fields()->AddVarint(123456, 1);
+  EXPECT_NE(Hash(message), Hash(unknown));
+
+  TestAllTypes parsed;
+  ASSERT_TRUE(parsed.ParseFromString(unknown.SerializeAsString()));
+  EXPECT_EQ(Hash(unknown), Hash(parsed));
+}
+
+TEST(MessageHashTest, CombinesWithOtherValues) {
+  TestAllTypes message;
+  message.set_optional_int32(1);
+  EXPECT_EQ(absl::HashOf(1, HashableMessage(message)),
+            absl::HashOf(1, HashableMessage(TestAllTypes(message))));
+  EXPECT_NE(absl::HashOf(1, HashableMessage(message)),
+            absl::HashOf(2, HashableMessage(message)));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,540 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/message_patch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/util/message_differencer.h"
+#include "google/protobuf/wire_format_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using SpecificField = MessageDifferencer::SpecificField;
+
+// A patch is encoded as the following message:
+//
+//   message Patch {
+//     repeated Operation operation = 1;
+//   }
+//
+//   message Operation {
+//     Type type = 1;
+//     // Pairs of (field number, index + 1) from the patched message down to
+//     // the field the operation applies to. The index is 0 for singular
+//     // fields and for operations on a repeated field as a whole.
+//     repeated uint32 path = 2 [packed = true];
+//     // The field, or the element, in the wire format of the message that
+//     // contains it.
+//     bytes value = 3;
+//     // The new size of the field for TRUNCATE.
+//     uint32 size = 4;
+//   }
+//
+// Operations are applied in order.
+constexpr int kOperationFieldNumber = 1;
+constexpr int kTypeFieldNumber = 1;
+constexpr int kPathFieldNumber = 2;
+constexpr int kValueFieldNumber = 3;
+constexpr int kSizeFieldNumber = 4;
+
+enum OperationType : uint32_t {
+  // Replaces the field, or the element, with the one in `value`.
+  kSet = 1,
+  // Clears the field.
+  kClear = 2,
+  // Appends the elements in `value` to the repeated field.
+  kAppend = 3,
+  // Removes the elements of the repeated field from index `size` on.
+  kTruncate = 4,
+  // Replaces the message at `path` with the one in `value`.
+  kReplace = 5,
+};
+
+struct Operation {
+  OperationType type = kSet;
+  std::vector<uint32_t> path;
+  std::string value;
+  uint32_t size = 0;
+};
+
+struct ParsedOperation {
+  uint32_t type = 0;
+  std::vector<uint32_t> path;
+  absl::string_view value;
+  uint32_t size = 0;
+};
+
+void WriteOperation(const Operation& operation,
+                    io::CodedOutputStream* output) {
+  size_t path_size = 0;
+  for (uint32_t step : operation.path) {
+    path_size += io::CodedOutputStream::VarintSize32(step);
+  }
+  size_t size = 1 + io::CodedOutputStream::VarintSize32(operation.type);
+  if (!operation.path.empty()) {
+    size += 1 + io::CodedOutputStream::VarintSize32(path_size) + path_size;
+  }
+  if (!operation.value.empty()) {
+    size += 1 + io::CodedOutputStream::VarintSize32(operation.value.size()) +
+            operation.value.size();
+  }
+  if (operation.size != 0) {
+    size += 1 + io::CodedOutputStream::VarintSize32(operation.size);
+  }
+
+  internal::WireFormatLite::WriteTag(
+      kOperationFieldNumber,
+      internal::WireFormatLite::WIRETYPE_LENGTH_DELIMITED, output);
+  output->WriteVarint32(static_cast<uint32_t>(size));
+  internal::WireFormatLite::WriteUInt32(kTypeFieldNumber, operation.type,
+                                        output);
+  if (!operation.path.empty()) {
+    internal::WireFormatLite::WriteTag(
+        kPathFieldNumber, internal::WireFormatLite::WIRETYPE_LENGTH_DELIMITED,
+        output);
+    output->WriteVarint32(static_cast<uint32_t>(path_size));
+    for (uint32_t step : operation.path) {
+      output->WriteVarint32(step);
+    }
+  }
+  if (!operation.value.empty()) {
+    internal::WireFormatLite::WriteBytes(kValueFieldNumber, operation.value,
+                                         output);
+  }
+  if (operation.size != 0) {
+    internal::WireFormatLite::WriteUInt32(kSizeFieldNumber, operation.size,
+                                          output);
+  }
+}
+
+// Reads the operation that `input` is limited to. `patch` is the buffer that
+// `input` reads from; `value` points into it.
+bool ReadOperation(absl::string_view patch, io::CodedInputStream* input,
+                   ParsedOperation* operation) {
+  while (uint32_t tag = input->ReadTag()) {
+    switch (tag) {
+      case internal::WireFormatLite::MakeTag(
+          kTypeFieldNumber, internal::WireFormatLite::WIRETYPE_VARINT):
+        if (!input->ReadVarint32(&operation->type)) return false;
+        break;
+      case internal::WireFormatLite::MakeTag(
+          kPathFieldNumber,
+          internal::WireFormatLite::WIRETYPE_LENGTH_DELIMITED): {
+        uint32_t length;
+        if (!input->ReadVarint32(&length)) return false;
+        io::CodedInputStream::Limit limit =
+            input->PushLimit(static_cast<int>(length));
+        while (input->BytesUntilLimit() > 0) {
+          uint32_t step;
+          if (!input->ReadVarint32(&step)) return false;
+          operation->path.push_back(step);
+        }
+        input->PopLimit(limit);
+        break;
+      }
+      case internal::WireFormatLite::MakeTag(
+          kValueFieldNumber,
+          internal::WireFormatLite::WIRETYPE_LENGTH_DELIMITED): {
+        uint32_t length;
+        if (!input->ReadVarint32(&length)) return false;
+        const int position = input->CurrentPosition();
+        if (!input->Skip(static_cast<int>(length))) return false;
+        operation->value = patch.substr(position, length);
+        break;
+      }
+      case internal::WireFormatLite::MakeTag(
+          kSizeFieldNumber, internal::WireFormatLite::WIRETYPE_VARINT):
+        if (!input->ReadVarint32(&operation->size)) return false;
+        break;
+      default:
+        if (!internal::WireFormatLite::SkipField(input, tag)) return false;
+        break;
+    }
+  }
+  return input->ConsumedEntireMessage();
+}
+
+// Copies element `index` of `field`, or the whole field if `index` is -1, from
+// `from` to `to`. Elements are appended to repeated fields.
+void CopyField(const Message& from, const FieldDescriptor* field, int index,
+               Message* to) {
+  const Reflection* from_reflection = from.GetReflection();
+  const Reflection* to_reflection = to->GetReflection();
+  if (field->is_repeated() && index < 0) {
+    const int size = from_reflection->FieldSize(from, field);
+    for (int i = 0; i < size; ++i) {
+      CopyField(from, field, i, to);
+    }
+    return;
+  }
+
+  switch (field->cpp_type()) {
+#define HANDLE_TYPE(CPPTYPE, METHOD)                                     \
+  case FieldDescriptor::CPPTYPE_##CPPTYPE:                               \
+    if (field->is_repeated()) {                                          \
+      to_reflection->Add##METHOD(                                        \
+          to, field,                                                     \
+          from_reflection->GetRepeated##METHOD(from, field, index));     \
+    } else {                                                             \
+      to_reflection->Set##METHOD(                                        \
+          to, field, from_reflection->Get##METHOD(from, field));         \
+    }                                                                    \
+    break;
+
+    HANDLE_TYPE(INT32, Int32);
+    HANDLE_TYPE(INT64, Int64);
+    HANDLE_TYPE(UINT32, UInt32);
+    HANDLE_TYPE(UINT64, UInt64);
+    HANDLE_TYPE(FLOAT, Float);
+    HANDLE_TYPE(DOUBLE, Double);
+    HANDLE_TYPE(BOOL, Bool);
+    HANDLE_TYPE(ENUM, EnumValue);
+    HANDLE_TYPE(STRING, String);
+#undef HANDLE_TYPE
+
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      if (field->is_repeated()) {
+        to_reflection->AddMessage(to, field)->CopyFrom(
+            from_reflection->GetRepeatedMessage(from, field, index));
+      } else {
+        to_reflection->MutableMessage(to, field)->CopyFrom(
+            from_reflection->GetMessage(from, field));
+      }
+      break;
+  }
+}
+
+// Returns element `index` of `field`, or the whole field if `index` is -1, in
+// the wire format of `message`.
+std::string SerializeField(const Message& message,
+                           const FieldDescriptor* field, int index) {
+  std::unique_ptr<Message> value(message.New());
+  CopyField(message, field, index, value.get());
+  return value->SerializePartialAsString();
+}
+
+// Turns the differences reported by a MessageDifferencer into operations and
+// writes them to a stream. Consecutive additions to the same repeated field
+// are merged into one APPEND operation, so an operation is held back until the
+// next one is known.
+class PatchWriter : public MessageDifferencer::Reporter {
+ public:
+  // `to` is the message compared as message2.
+  PatchWriter(const Message& to, io::CodedOutputStream* output)
+      : to_(to), output_(output) {}
+
+  // Writes the operation held back, if any.
+  void Finish() {
+    if (has_pending_) WriteOperation(pending_, output_);
+    has_pending_ = false;
+  }
+
+  void ReportAdded(const Message& /* message1 */,
+                   const Message& /* message2 */,
+                   const std::vector<SpecificField>& field_path) override {
+    if (ReportFallback(field_path)) return;
+    const SpecificField& field = field_path.back();
+    if (!field.field->is_repeated()) {
+      Emit(kSet, Path(field_path, field_path.size()),
+           SerializeField(*field.message2, field.field, -1));
+      return;
+    }
+    std::vector<uint32_t> path = Path(field_path, field_path.size());
+    path.back() = 0;
+    Emit(kAppend, std::move(path),
+         SerializeField(*field.message2, field.field, field.new_index));
+  }
+
+  void ReportDeleted(const Message& /* message1 */,
+                     const Message& /* message2 */,
+                     const std::vector<SpecificField>& field_path) override {
+    if (ReportFallback(field_path)) return;
+    const SpecificField& field = field_path.back();
+    if (!field.field->is_repeated()) {
+      Emit(kClear, Path(field_path, field_path.size()));
+      return;
+    }
+    // Deletions are reported in index order, so the first one of a field
+    // gives its new size.
+    std::vector<uint32_t> path = Path(field_path, field_path.size());
+    path.back() = 0;
+    if (has_pending_ && pending_.type == kTruncate && pending_.path == path) {
+      return;
+    }
+    Emit(kTruncate, std::move(path), std::string(),
+         static_cast<uint32_t>(field.index));
+  }
+
+  void ReportModified(const Message& /* message1 */,
+                      const Message& /* message2 */,
+                      const std::vector<SpecificField>& field_path) override {
+    if (ReportFallback(field_path)) return;
+    const SpecificField& field = field_path.back();
+    // The differences within a message field are reported before it.
+    if (field.field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) return;
+    Emit(kSet, Path(field_path, field_path.size()),
+         SerializeField(*field.message2, field.field,
+                        field.field->is_repeated() ? field.new_index : -1));
+  }
+
+ private:
+  // Returns the encoded path of the first `length` fields of `field_path`.
+  static std::vector<uint32_t> Path(
+      const std::vector<SpecificField>& field_path, size_t length) {
+    std::vector<uint32_t> path;
+    path.reserve(2 * length);
+    for (size_t i = 0; i < length; ++i) {
+      const SpecificField& field = field_path[i];
+      path.push_back(static_cast<uint32_t>(field.field->number()));
+      path.push_back(field.field->is_repeated() && !field.field->is_map()
+                         ? static_cast<uint32_t>(field.index + 1)
+                         : 0);
+    }
+    return path;
+  }
+
+  // Handles differences that are not diffed any further: within map fields,
+  // within unpacked Any payloads and in unknown fields. They are patched by
+  // setting the whole map field, the whole Any field, or by replacing the
+  // message that contains the unknown fields. Returns false if `field_path`
+  // contains none of them and is not under a path patched that way.
+  bool ReportFallback(const std::vector<SpecificField>& field_path) {
+    for (size_t i = 0; i < field_path.size(); ++i) {
+      const SpecificField& field = field_path[i];
+      if (field.unpacked_any > 0 || field.field == nullptr) {
+        if (IsCovered(field_path, i)) return true;
+        if (field.unpacked_any > 0 && i > 0) {
+          // The containing message of field_path[i - 1] is not unpacked.
+          const SpecificField& any = field_path[i - 1];
+          Fallback(kSet, Path(field_path, i),
+                   SerializeField(*any.message2, any.field,
+                                  any.field->is_repeated() ? any.new_index
+                                                           : -1));
+        } else {
+          // The containing message of an unknown field, or the root Any.
+          const Message& message =
+              field.unpacked_any > 0 ? to_ : *field.message2;
+          Fallback(kReplace, Path(field_path, i),
+                   message.SerializePartialAsString());
+        }
+        return true;
+      }
+      if (field.field->is_map()) {
+        if (IsCovered(field_path, i + 1)) return true;
+        Fallback(kSet, Path(field_path, i + 1),
+                 SerializeField(*field.message2, field.field, -1));
+        return true;
+      }
+    }
+    return IsCovered(field_path, field_path.size());
+  }
+
+  // Returns whether a fallback operation covers the first `length` fields of
+  // `field_path`.
+  bool IsCovered(const std::vector<SpecificField>& field_path,
+                 size_t length) const {
+    if (covered_.empty()) return false;
+    const std::vector<uint32_t> path = Path(field_path, length);
+    for (const std::vector<uint32_t>& covered : covered_) {
+      if (covered.size() <= path.size() &&
+          std::equal(covered.begin(), covered.end(), path.begin())) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Fallback(OperationType type, std::vector<uint32_t> path,
+                std::string value) {
+    covered_.push_back(path);
+    Emit(type, std::move(path), std::move(value));
+  }
+
+  void Emit(OperationType type, std::vector<uint32_t> path,
+            std::string value = std::string(), uint32_t size = 0) {
+    if (type == kAppend && has_pending_ && pending_.type == kAppend &&
+        pending_.path == path) {
+      // Concatenated encodings merge into one with the elements of both.
+      pending_.value.append(value);
+      return;
+    }
+    if (has_pending_) WriteOperation(pending_, output_);
+    pending_.type = type;
+    pending_.path = std::move(path);
+    pending_.value = std::move(value);
+    pending_.size = size;
+    has_pending_ = true;
+  }
+
+  const Message& to_;
+  io::CodedOutputStream* output_;
+  Operation pending_;
+  bool has_pending_ = false;
+  std::vector<std::vector<uint32_t>> covered_;
+};
+
+const FieldDescriptor* FindField(const Message& message, uint32_t number) {
+  if (number == 0 || number > FieldDescriptor::kMaxNumber) return nullptr;
+  const int field_number = static_cast<int>(number);
+  const FieldDescriptor* field =
+      message.GetDescriptor()->FindFieldByNumber(field_number);
+  if (field == nullptr) {
+    field = message.GetReflection()->FindKnownExtensionByNumber(field_number);
+  }
+  return field;
+}
+
+bool MergeValue(absl::string_view value, Message* message) {
+  io::CodedInputStream input(reinterpret_cast<const uint8_t*>(value.data()),
+                             static_cast<int>(value.size()));
+  return message->MergePartialFromCodedStream(&input) &&
+         input.ConsumedEntireMessage();
+}
+
+bool ApplyOperation(const ParsedOperation& operation, Message* message) {
+  const std::vector<uint32_t>& path = operation.path;
+  if (path.size() % 2 != 0) return false;
+  const size_t steps = path.size() / 2;
+  if (operation.type != kReplace && steps == 0) return false;
+
+  // Find the message that contains the field, or the replaced message.
+  const size_t nested = operation.type == kReplace ? steps : steps - 1;
+  for (size_t i = 0; i < nested; ++i) {
+    const FieldDescriptor* field = FindField(*message, path[2 * i]);
+    if (field == nullptr ||
+        field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE ||
+        field->is_map()) {
+      return false;
+    }
+    const Reflection* reflection = message->GetReflection();
+    const uint32_t index = path[2 * i + 1];
+    if (!field->is_repeated()) {
+      if (index != 0) return false;
+      message = reflection->MutableMessage(message, field);
+    } else {
+      const int size = reflection->FieldSize(*message, field);
+      if (index == 0 || index > static_cast<uint32_t>(size)) return false;
+      message = reflection->MutableRepeatedMessage(message, field, index - 1);
+    }
+  }
+
+  if (operation.type == kReplace) {
+    message->Clear();
+    return MergeValue(operation.value, message);
+  }
+
+  const FieldDescriptor* field = FindField(*message, path[2 * steps - 2]);
+  if (field == nullptr) return false;
+  const Reflection* reflection = message->GetReflection();
+  const uint32_t index = path[2 * steps - 1];
+  if (index != 0 && (!field->is_repeated() || field->is_map())) return false;
+  const int size =
+      field->is_repeated() ? reflection->FieldSize(*message, field) : 0;
+
+  switch (operation.type) {
+    case kSet:
+      if (index == 0) {
+        reflection->ClearField(message, field);
+        return MergeValue(operation.value, message);
+      }
+      // Append the new element, then move it in place of the old one.
+      if (index > static_cast<uint32_t>(size) ||
+          !MergeValue(operation.value, message) ||
+          reflection->FieldSize(*message, field) != size + 1) {
+        return false;
+      }
+      reflection->SwapElements(message, field, static_cast<int>(index - 1),
+                               size);
+      reflection->RemoveLast(message, field);
+      return true;
+    case kClear:
+      if (index != 0) return false;
+      reflection->ClearField(message, field);
+      return true;
+    case kAppend:
+      if (index != 0 || !field->is_repeated()) return false;
+      return MergeValue(operation.value, message);
+    case kTruncate:
+      if (index != 0 || !field->is_repeated() ||
+          operation.size > static_cast<uint32_t>(size)) {
+        return false;
+      }
+      for (int i = static_cast<int>(operation.size); i < size; ++i) {
+        reflection->RemoveLast(message, field);
+      }
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+void CreateMessagePatch(const Message& from, const Message& to,
+                        std::string* patch) {
+  ABSL_CHECK_EQ(from.GetDescriptor(), to.GetDescriptor())
+      << "Cannot patch a " << from.GetTypeName() << " into a "
+      << to.GetTypeName() << ".";
+  patch->clear();
+  io::StringOutputStream stream(patch);
+  io::CodedOutputStream output(&stream);
+  PatchWriter writer(to, &output);
+  MessageDifferencer differencer;
+  differencer.ReportDifferencesTo(&writer);
+  differencer.Compare(from, to);
+  writer.Finish();
+}
+
+bool ApplyMessagePatch(absl::string_view patch, Message* message) {
+  io::CodedInputStream input(reinterpret_cast<const uint8_t*>(patch.data()),
+                             static_cast<int>(patch.size()));
+  while (uint32_t tag = input.ReadTag()) {
+    if (tag != internal::WireFormatLite::MakeTag(
+                   kOperationFieldNumber,
+                   internal::WireFormatLite::WIRETYPE_LENGTH_DELIMITED)) {
+      if (!internal::WireFormatLite::SkipField(&input, tag)) return false;
+      continue;
+    }
+    uint32_t length;
+    if (!input.ReadVarint32(&length)) return false;
+    io::CodedInputStream::Limit limit =
+        input.PushLimit(static_cast<int>(length));
+    ParsedOperation operation;
+    if (!ReadOperation(patch, &input, &operation) ||
+        input.BytesUntilLimit() != 0) {
+      return false;
+    }
+    input.PopLimit(limit);
+    if (!ApplyOperation(operation, message)) return false;
+  }
+  return input.ConsumedEntireMessage();
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
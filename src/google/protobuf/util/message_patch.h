@@ -0,0 +1,62 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Defines utilities for sending the changes between two versions of a message
+// instead of the whole message.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_MESSAGE_PATCH_H__
+#define GOOGLE_PROTOBUF_UTIL_MESSAGE_PATCH_H__
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+// Sets `*patch` to a binary patch that turns `from` into `to`. `from` and `to`
+// must have the same descriptor. The patch is empty if the messages are equal
+// as compared by a default MessageDifferencer.
+//
+// The patch is a list of operations addressed by field path: set a field or
+// an element of a repeated field, clear a field, append elements to a repeated
+// field or truncate it. Values are encoded in the wire format of the message
+// that contains the field, so a patch is about as large as the changed fields.
+// Map fields, Any payloads and unknown fields are not diffed further: a change
+// in one of them sets the whole map field, Any field or containing message.
+//
+// Example:
+//
+//   std::string patch;
+//   util::CreateMessagePatch(previous_state, state, &patch);
+//   ...  // Send `patch` to followers holding `previous_state`.
+//   if (!util::ApplyMessagePatch(patch, &follower_state)) { ... }
+PROTOBUF_EXPORT void CreateMessagePatch(const Message& from, const Message& to,
+                                        std::string* patch);
+
+// Applies a patch created by CreateMessagePatch() to `*message` in place. Only
+// the fields named by the patch are touched, and only the values it carries
+// are parsed. `*message` should be equal to the `from` message of the patch;
+// patching any other message of the same type still succeeds as long as the
+// paths of the patch exist in it. Returns false if the patch is malformed or
+// one of its paths does not exist, in which case `*message` may have been
+// partially patched.
+PROTOBUF_EXPORT bool ApplyMessagePatch(absl::string_view patch,
+                                       Message* message);
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_MESSAGE_PATCH_H__
@@ -0,0 +1,173 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/message_patch.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/map_unittest.pb.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/util/message_differencer.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::NestedTestAllTypes;
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestMap;
+
+// Patches a copy of `from` into `to` and returns the size of the patch.
+template <typename T>
+size_t ExpectPatch(const T& from, const T& to) {
+  std::string patch;
+  CreateMessagePatch(from, to, &patch);
+  T patched = from;
+  EXPECT_TRUE(ApplyMessagePatch(patch, &patched));
+  EXPECT_TRUE(MessageDifferencer::Equals(patched, to))
+      << "from: " << from.DebugString() << "to: " << to.DebugString()
+      << "patched: " << patched.DebugString();
+  return patch.size();
+}
+
+TEST(MessagePatchTest, EqualMessages) {
+  TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  std::string patch = "not empty";
+  CreateMessagePatch(message, message, &patch);
+  EXPECT_EQ(patch, "");
+  EXPECT_TRUE(ApplyMessagePatch(patch, &message));
+  TestUtil::ExpectAllFieldsSet(message);
+}
+
+TEST(MessagePatchTest, SetAndClearFields) {
+  TestAllTypes empty;
+  TestAllTypes all;
+  TestUtil::SetAllFields(&all);
+  ExpectPatch(empty, all);
+  ExpectPatch(all, empty);
+
+  TestAllTypes modified = all;
+  TestUtil::ModifyRepeatedFields(&modified);
+  modified.set_optional_int32(1234);
+  modified.mutable_optional_nested_message()->set_bb(5678);
+  modified.clear_optional_string();
+  ExpectPatch(all, modified);
+  ExpectPatch(modified, all);
+}
+
+TEST(MessagePatchTest, PatchIsSmallForSmallChanges) {
+  NestedTestAllTypes from;
+  for (int i = 0; i < 100; ++i) {
+    TestUtil::SetAllFields(from.add_repeated_child()->mutable_payload());
+  }
+  NestedTestAllTypes to = from;
+  to.mutable_repeated_child(42)->mutable_payload()->set_optional_int32(7);
+  to.mutable_repeated_child(99)->mutable_payload()->add_repeated_string("x");
+  EXPECT_LT(ExpectPatch(from, to), 64u);
+}
+
+TEST(MessagePatchTest, GrowAndShrinkRepeatedFields) {
+  TestAllTypes from;
+  for (int i = 0; i < 5; ++i) {
+    from.add_repeated_int32(i);
+    from.add_repeated_nested_message()->set_bb(i);
+  }
+  TestAllTypes longer = from;
+  for (int i = 5; i < 10; ++i) {
+    longer.add_repeated_int32(i);
+    longer.add_repeated_nested_message()->set_bb(i);
+  }
+  longer.set_repeated_int32(2, 20);
+  TestAllTypes shorter = from;
+  shorter.mutable_repeated_int32()->Truncate(2);
+  shorter.mutable_repeated_nested_message()->DeleteSubrange(3, 2);
+  shorter.mutable_repeated_nested_message(0)->set_bb(100);
+
+  ExpectPatch(from, longer);
+  ExpectPatch(longer, from);
+  ExpectPatch(from, shorter);
+  ExpectPatch(shorter, from);
+  ExpectPatch(longer, shorter);
+}
+
+TEST(MessagePatchTest, Oneof) {
+  TestAllTypes from;
+  from.set_oneof_uint32(1);
+  TestAllTypes to;
+  to.set_oneof_string("foo");
+  ExpectPatch(from, to);
+  ExpectPatch(to, from);
+  to.mutable_oneof_nested_message()->set_bb(2);
+  ExpectPatch(from, to);
+  ExpectPatch(to, from);
+}
+
+TEST(MessagePatchTest, Maps) {
+  TestMap from;
+  (*from.mutable_map_int32_int32())[1] = 1;
+  (*from.mutable_map_int32_int32())[2] = 2;
+  (*from.mutable_map_int32_foreign_message())[1].set_c(1);
+  TestMap to = from;
+  (*to.mutable_map_int32_int32())[2] = 3;
+  (*to.mutable_map_int32_int32())[4] = 4;
+  to.mutable_map_int32_foreign_message()->erase(1);
+  ExpectPatch(from, to);
+  ExpectPatch(to, from);
+}
+
+TEST(MessagePatchTest, UnknownFields) {
+  NestedTestAllTypes from;
+  from.mutable_child()->mutable_payload()->set_optional_int32(1);
+  NestedTestAllTypes to = from;
+  to.mutable_child()->mutable_payload()->mutable_unknown_fields()->AddVarint(
+      12345, 6);
+  to.mutable_child()->mutable_payload()->set_optional_int64(2);
+  ExpectPatch(from, to);
+  ExpectPatch(to, from);
+}
+
+TEST(MessagePatchTest, PatchesOnlyNamedFields) {
+  TestAllTypes from;
+  TestAllTypes to;
+  to.set_optional_int32(1);
+  std::string patch;
+  CreateMessagePatch(from, to, &patch);
+
+  TestAllTypes other;
+  other.set_optional_string("kept");
+  EXPECT_TRUE(ApplyMessagePatch(patch, &other));
+  EXPECT_EQ(other.optional_int32(), 1);
+  EXPECT_EQ(other.optional_string(), "kept");
+}
+
+TEST(MessagePatchTest, RejectsBadPatches) {
+  TestAllTypes from;
+  from.add_repeated_int32(1);
+  from.add_repeated_int32(2);
+  TestAllTypes to = from;
+  to.set_repeated_int32(1, 3);
+  std::string patch;
+  CreateMessagePatch(from, to, &patch);
+
+  // The element to set does not exist.
+  TestAllTypes shorter;
+  shorter.add_repeated_int32(1);
+  EXPECT_FALSE(ApplyMessagePatch(patch, &shorter));
+
+  TestAllTypes message = from;
+  EXPECT_FALSE(ApplyMessagePatch(patch.substr(0, patch.size() - 1), &message));
+  EXPECT_FALSE(ApplyMessagePatch("\x0a\x7f", &message));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,50 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/message_pool.h"
+
+#include <cstddef>
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+// Plain values, which stay usable while the free lists of the thread are
+// destroyed.
+thread_local size_t retained_bytes = 0;
+thread_local size_t max_retained_bytes = size_t{16} << 20;
+
+}  // namespace
+
+void MessagePoolBudget::SetMaxBytes(size_t max_bytes) {
+  max_retained_bytes = max_bytes;
+}
+
+size_t MessagePoolBudget::MaxBytes() { return max_retained_bytes; }
+
+size_t MessagePoolBudget::RetainedBytes() { return retained_bytes; }
+
+bool MessagePoolBudget::TryRetain(size_t bytes) {
+  if (retained_bytes > max_retained_bytes ||
+      bytes > max_retained_bytes - retained_bytes) {
+    return false;
+  }
+  retained_bytes += bytes;
+  return true;
+}
+
+void MessagePoolBudget::Forget(size_t bytes) { retained_bytes -= bytes; }
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
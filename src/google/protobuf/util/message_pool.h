@@ -0,0 +1,208 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Reuse of message objects on the heap.
+//
+// Arenas make short-lived messages cheap, but not every message fits one
+// arena's lifetime.  A MessagePool keeps released messages around instead of
+// deleting them.  They are Clear()ed, which keeps the capacity of their
+// strings and repeated fields and keeps their submessages, so a server that
+// parses similar requests over and over stops allocating once the pool is
+// warm:
+//
+//   util::MessagePool<Request>::Ptr request =
+//       util::MessagePool<Request>::Acquire();
+//   if (!request->ParseFromString(data)) ...
+//   Handle(*request);
+//   // The message returns to the pool when `request` goes out of scope.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_MESSAGE_POOL_H__
+#define GOOGLE_PROTOBUF_UTIL_MESSAGE_POOL_H__
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/message_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+template <typename T>
+class MessagePool;
+
+// The memory kept by the MessagePools of a thread, for all message types
+// together.  Released messages that would exceed the budget are deleted
+// rather than pooled.
+class PROTOBUF_EXPORT MessagePoolBudget {
+ public:
+  MessagePoolBudget() = delete;
+
+  // Limits the memory kept by the calling thread's pools to `max_bytes`.
+  // The default is 16MB.  Messages pooled already are kept until they are
+  // acquired again or their pool is cleared.
+  static void SetMaxBytes(size_t max_bytes);
+  static size_t MaxBytes();
+
+  // The memory kept by the calling thread's pools.
+  static size_t RetainedBytes();
+
+ private:
+  template <typename T>
+  friend class MessagePool;
+
+  // Counts `bytes` as retained, if they fit in the budget.
+  static bool TryRetain(size_t bytes);
+  static void Forget(size_t bytes);
+};
+
+// The pools of messages of type T.  Each thread has its own pool, so taking
+// and returning messages needs no synchronization.  A message released on
+// another thread than the one that acquired it joins the releasing thread's
+// pool.  The pool of a thread is freed when the thread exits.
+//
+// Messages are measured with HeapSpaceUsedLong() when they are released, or
+// by their object size alone for lite messages.
+template <typename T>
+class MessagePool {
+  static_assert(std::is_base_of<MessageLite, T>::value,
+                "MessagePool holds generated message types");
+
+ public:
+  // Returns the message to the pool when the message is destroyed.
+  struct Releaser {
+    void operator()(T* message) const { MessagePool::Release(message); }
+  };
+  using Ptr = std::unique_ptr<T, Releaser>;
+
+  MessagePool() = delete;
+
+  // Returns a cleared message, the most recently released one from the
+  // calling thread's pool if there is one, or else a new one.
+  static Ptr Acquire() {
+    FreeList* list = GetFreeList();
+    if (list == nullptr || list->messages.empty()) {
+      return Ptr(static_cast<T*>(T::default_instance().New(nullptr)));
+    }
+    Entry entry = list->messages.back();
+    list->messages.pop_back();
+    MessagePoolBudget::Forget(entry.bytes);
+    return Ptr(entry.message);
+  }
+
+  // Clears `message` and keeps it in the calling thread's pool.  It is
+  // deleted instead if the pool is full or the message would exceed the
+  // thread's budget.  `message` must have been allocated on the heap.
+  static void Release(T* message) {
+    if (message == nullptr) return;
+    ABSL_DCHECK(message->GetArena() == nullptr)
+        << "messages on an arena cannot be pooled";
+    FreeList* list = GetFreeList();
+    if (list == nullptr || list->messages.size() >= list->max_messages) {
+      delete message;
+      return;
+    }
+    message->Clear();
+    size_t bytes = RetainedSize(*message);
+    if (!MessagePoolBudget::TryRetain(bytes)) {
+      delete message;
+      return;
+    }
+    list->messages.push_back({message, bytes});
+  }
+
+  // Limits the calling thread's pool to `max_messages` messages.  The
+  // default is 64.  Messages beyond the new limit are deleted.
+  static void SetMaxMessages(size_t max_messages) {
+    FreeList* list = GetFreeList();
+    if (list == nullptr) return;
+    list->max_messages = max_messages;
+    while (list->messages.size() > max_messages) {
+      list->DeleteOldest();
+    }
+  }
+
+  // Deletes all messages in the calling thread's pool.
+  static void Clear() {
+    FreeList* list = GetFreeList();
+    if (list != nullptr) list->DeleteAll();
+  }
+
+  // The number of messages in the calling thread's pool.
+  static size_t NumMessages() {
+    FreeList* list = GetFreeList();
+    return list == nullptr ? 0 : list->messages.size();
+  }
+
+ private:
+  struct Entry {
+    T* message;
+    size_t bytes;
+  };
+
+  struct FreeList {
+    ~FreeList() {
+      DeleteAll();
+      // Messages released from destructors of other thread locals, which may
+      // run after this one, are deleted rather than pooled.
+      destroyed = true;
+    }
+
+    void DeleteOldest() {
+      MessagePoolBudget::Forget(messages.front().bytes);
+      delete messages.front().message;
+      messages.erase(messages.begin());
+    }
+
+    void DeleteAll() {
+      for (const Entry& entry : messages) {
+        MessagePoolBudget::Forget(entry.bytes);
+        delete entry.message;
+      }
+      messages.clear();
+    }
+
+    // Ordered by release, the most recently released last.
+    std::vector<Entry> messages;
+    size_t max_messages = 64;
+  };
+
+  static FreeList* GetFreeList() {
+    static thread_local FreeList list;
+    if (destroyed) return nullptr;
+    return &list;
+  }
+
+  static size_t RetainedSize(const T& message) {
+    return RetainedSize(message, std::is_base_of<Message, T>());
+  }
+  static size_t RetainedSize(const T& message, std::true_type) {
+    return message.HeapSpaceUsedLong();
+  }
+  static size_t RetainedSize(const T&, std::false_type) { return sizeof(T); }
+
+  static thread_local bool destroyed;
+};
+
+template <typename T>
+thread_local bool MessagePool<T>::destroyed = false;
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_MESSAGE_POOL_H__
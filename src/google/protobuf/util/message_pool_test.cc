@@ -0,0 +1,124 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/message_pool.h"
+
+#include <cstddef>
+#include <string>
+#include <thread>  // NOLINT
+
+#include <gtest/gtest.h>
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+using Pool = MessagePool<TestAllTypes>;
+
+class MessagePoolTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    Pool::Clear();
+    Pool::SetMaxMessages(64);
+    MessagePoolBudget::SetMaxBytes(size_t{16} << 20);
+  }
+  void TearDown() override { Pool::Clear(); }
+};
+
+TEST_F(MessagePoolTest, ReusesReleasedMessages) {
+  TestAllTypes* first;
+  {
+    Pool::Ptr message = Pool::Acquire();
+    first = message.get();
+    TestUtil::SetAllFields(message.get());
+  }
+  EXPECT_EQ(Pool::NumMessages(), 1);
+  EXPECT_GT(MessagePoolBudget::RetainedBytes(), sizeof(TestAllTypes));
+
+  Pool::Ptr message = Pool::Acquire();
+  EXPECT_EQ(message.get(), first);
+  EXPECT_EQ(Pool::NumMessages(), 0);
+  EXPECT_EQ(MessagePoolBudget::RetainedBytes(), 0);
+  EXPECT_EQ(message->ByteSizeLong(), 0);
+}
+
+TEST_F(MessagePoolTest, KeepsCapacity) {
+  std::string long_string(1000, 'x');
+  const char* string_data;
+  const TestAllTypes::NestedMessage* nested;
+  {
+    Pool::Ptr message = Pool::Acquire();
+    message->set_optional_string(long_string);
+    string_data = message->optional_string().data();
+    for (int i = 0; i < 100; ++i) message->add_repeated_int32(i);
+    nested = message->mutable_optional_nested_message();
+  }
+
+  Pool::Ptr message = Pool::Acquire();
+  EXPECT_FALSE(message->has_optional_string());
+  EXPECT_GE(message->mutable_optional_string()->capacity(), 1000);
+  message->set_optional_string(long_string);
+  EXPECT_EQ(message->optional_string().data(), string_data);
+  EXPECT_EQ(message->repeated_int32_size(), 0);
+  EXPECT_GE(message->repeated_int32().Capacity(), 100);
+  EXPECT_FALSE(message->has_optional_nested_message());
+  EXPECT_EQ(message->mutable_optional_nested_message(), nested);
+}
+
+TEST_F(MessagePoolTest, LimitsMessages) {
+  Pool::SetMaxMessages(2);
+  {
+    Pool::Ptr a = Pool::Acquire();
+    Pool::Ptr b = Pool::Acquire();
+    Pool::Ptr c = Pool::Acquire();
+  }
+  EXPECT_EQ(Pool::NumMessages(), 2);
+
+  Pool::SetMaxMessages(1);
+  EXPECT_EQ(Pool::NumMessages(), 1);
+  Pool::Clear();
+  EXPECT_EQ(Pool::NumMessages(), 0);
+  EXPECT_EQ(MessagePoolBudget::RetainedBytes(), 0);
+}
+
+TEST_F(MessagePoolTest, LimitsBytes) {
+  MessagePoolBudget::SetMaxBytes(sizeof(TestAllTypes) + 100);
+  {
+    Pool::Ptr small = Pool::Acquire();
+    Pool::Ptr large = Pool::Acquire();
+    large->set_optional_string(std::string(1000, 'x'));
+  }
+  EXPECT_EQ(Pool::NumMessages(), 1);
+  EXPECT_LE(MessagePoolBudget::RetainedBytes(), MessagePoolBudget::MaxBytes());
+}
+
+TEST_F(MessagePoolTest, PoolsArePerThread) {
+  { Pool::Ptr message = Pool::Acquire(); }
+  EXPECT_EQ(Pool::NumMessages(), 1);
+
+  TestAllTypes* released = nullptr;
+  std::thread thread([&] {
+    EXPECT_EQ(Pool::NumMessages(), 0);
+    EXPECT_EQ(MessagePoolBudget::RetainedBytes(), 0);
+    Pool::Ptr message = Pool::Acquire();
+    released = message.release();
+  });
+  thread.join();
+
+  // A message from another thread joins the releasing thread's pool.
+  Pool::Release(released);
+  EXPECT_EQ(Pool::NumMessages(), 2);
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,79 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/message_teardown.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/prefetch.h"
+#include "absl/log/absl_check.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+// Returns true if the submessages of `field` can be released from their
+// parent without side effects.
+bool CanDetach(const FieldDescriptor* field) {
+  if (field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) return false;
+  // Map values are owned by the map, and releasing a lazy field would parse it.
+  return !field->is_map() && !field->options().lazy() &&
+         !field->options().unverified_lazy() && !field->options().weak();
+}
+
+// Moves the submessages owned by `message` to `pending`.
+void DetachSubmessages(Message* message, std::vector<Message*>* pending) {
+  const Reflection* reflection = message->GetReflection();
+  std::vector<const FieldDescriptor*> fields;
+  reflection->ListFields(*message, &fields);
+  for (const FieldDescriptor* field : fields) {
+    if (!CanDetach(field)) continue;
+    if (field->is_repeated()) {
+      for (int i = reflection->FieldSize(*message, field); i > 0; --i) {
+        pending->push_back(reflection->ReleaseLast(message, field));
+      }
+    } else {
+      Message* submessage = reflection->ReleaseMessage(message, field);
+      if (submessage != nullptr) pending->push_back(submessage);
+    }
+  }
+}
+
+void DeleteIteratively(Message* root) {
+  std::vector<Message*> pending = {root};
+  while (!pending.empty()) {
+    Message* message = pending.back();
+    pending.pop_back();
+    DetachSubmessages(message, &pending);
+    if (!pending.empty()) absl::PrefetchToLocalCache(pending.back());
+    delete message;
+  }
+}
+
+}  // namespace
+
+void DeleteMessageTree(std::unique_ptr<Message> message,
+                       const MessageTeardownOptions& options) {
+  if (message == nullptr) return;
+  ABSL_CHECK(message->GetArena() == nullptr)
+      << "DeleteMessageTree() called on an arena message.";
+  if (options.executor) {
+    Message* root = message.release();
+    options.executor([root] { DeleteIteratively(root); });
+  } else {
+    DeleteIteratively(message.release());
+  }
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,53 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Defines utilities for deleting large heap-allocated message trees off the
+// latency-critical path.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_MESSAGE_TEARDOWN_H__
+#define GOOGLE_PROTOBUF_UTIL_MESSAGE_TEARDOWN_H__
+
+#include <functional>
+#include <memory>
+
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+struct MessageTeardownOptions {
+  // If set, the tree is deleted by a task run through `executor`, typically on
+  // a background thread, and DeleteMessageTree() returns right away.
+  std::function<void(std::function<void()> task)> executor;
+};
+
+// Deletes `message` and every submessage it owns, like `message.reset()`,
+// but without recursing through the destructors of nested messages.
+//
+// Submessages are detached from their parent through reflection and deleted
+// from an explicit worklist, prefetching the next one while the current one is
+// destroyed. Deep trees thus cannot overflow the stack, and the pointer chase
+// of a large tree overlaps with the deallocation work. Map values and lazy
+// fields are destroyed along with the message that holds them.
+//
+// `message` must not live on an arena: arena messages are freed with their
+// arena, which is already cheap.
+PROTOBUF_EXPORT void DeleteMessageTree(
+    std::unique_ptr<Message> message,
+    const MessageTeardownOptions& options = MessageTeardownOptions());
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_MESSAGE_TEARDOWN_H__
@@ -0,0 +1,76 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/message_teardown.h"
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/map_unittest.pb.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::TestAllExtensions;
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestMap;
+using ::protobuf_unittest::TestRecursiveMessage;
+
+// These tests rely on the sanitizers to catch leaks and double frees.
+
+TEST(MessageTeardownTest, DeletesAllFields) {
+  auto message = std::make_unique<TestAllTypes>();
+  TestUtil::SetAllFields(message.get());
+  for (int i = 0; i < 1000; ++i) {
+    message->add_repeated_nested_message()->set_bb(i);
+  }
+  DeleteMessageTree(std::move(message));
+
+  auto extensions = std::make_unique<TestAllExtensions>();
+  TestUtil::SetAllExtensions(extensions.get());
+  DeleteMessageTree(std::move(extensions));
+
+  auto map = std::make_unique<TestMap>();
+  (*map->mutable_map_int32_foreign_message())[1].set_c(2);
+  DeleteMessageTree(std::move(map));
+
+  DeleteMessageTree(nullptr);
+}
+
+TEST(MessageTeardownTest, DeletesDeepTreeWithoutRecursion) {
+  auto message = std::make_unique<TestRecursiveMessage>();
+  TestRecursiveMessage* leaf = message.get();
+  for (int i = 0; i < 100000; ++i) leaf = leaf->mutable_a();
+  leaf->set_i(1);
+  DeleteMessageTree(std::move(message));
+}
+
+TEST(MessageTeardownTest, DeletesThroughExecutor) {
+  std::vector<std::function<void()>> tasks;
+  MessageTeardownOptions options;
+  options.executor = [&tasks](std::function<void()> task) {
+    tasks.push_back(std::move(task));
+  };
+
+  auto message = std::make_unique<TestAllTypes>();
+  TestUtil::SetAllFields(message.get());
+  DeleteMessageTree(std::move(message), options);
+  ASSERT_EQ(tasks.size(), 1);
+  tasks[0]();
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
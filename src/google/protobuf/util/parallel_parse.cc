@@ -0,0 +1,180 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/parallel_parse.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/log/absl_check.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/wire_format_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::google::protobuf::internal::WireFormatLite;
+
+// The serialized elements of one repeated message field, in wire order.
+struct SplitField {
+  const FieldDescriptor* field;
+  std::vector<absl::string_view> elements;
+};
+
+bool IsSplittable(const FieldDescriptor* field) {
+  return field != nullptr && field->is_repeated() &&
+         field->type() == FieldDescriptor::TYPE_MESSAGE && !field->is_map();
+}
+
+// Scans the top level of `data`. The elements of repeated message fields are
+// collected in `fields`; all other fields are copied to `rest`.
+bool Split(absl::string_view data, const Descriptor* descriptor,
+           std::vector<SplitField>* fields, std::string* rest) {
+  absl::flat_hash_map<const FieldDescriptor*, size_t> field_index;
+  io::CodedInputStream input(reinterpret_cast<const uint8_t*>(data.data()),
+                             static_cast<int>(data.size()));
+  while (true) {
+    const int start = input.CurrentPosition();
+    const uint32_t tag = input.ReadTag();
+    if (tag == 0) return input.ConsumedEntireMessage();
+
+    const FieldDescriptor* field =
+        descriptor->FindFieldByNumber(WireFormatLite::GetTagFieldNumber(tag));
+    if (IsSplittable(field) && WireFormatLite::GetTagWireType(tag) ==
+                                   WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      uint32_t length;
+      if (!input.ReadVarint32(&length)) return false;
+      const int offset = input.CurrentPosition();
+      if (!input.Skip(static_cast<int>(length))) return false;
+      auto it = field_index.try_emplace(field, fields->size()).first;
+      if (it->second == fields->size()) fields->push_back({field, {}});
+      (*fields)[it->second].elements.push_back(data.substr(offset, length));
+      continue;
+    }
+
+    if (!WireFormatLite::SkipField(&input, tag)) return false;
+    rest->append(data.data() + start, input.CurrentPosition() - start);
+  }
+}
+
+}  // namespace
+
+bool MergePartialFromStringParallel(absl::string_view data, Message* message,
+                                    const ParallelParseOptions& options) {
+  ABSL_CHECK(options.executor) << "ParallelParseOptions::executor is not set";
+  const Reflection* reflection = message->GetReflection();
+  Arena* arena = message->GetArena();
+
+  std::vector<SplitField> fields;
+  std::string rest;
+  if (!Split(data, message->GetDescriptor(), &fields, &rest)) return false;
+
+  // Per field, the parsed elements in wire order.
+  std::vector<std::vector<Message*>> parsed(fields.size());
+  struct Task {
+    const Message* prototype;
+    const absl::string_view* elements;
+    Message** out;
+    size_t count;
+  };
+  std::vector<Task> tasks;
+  const size_t min_elements =
+      static_cast<size_t>(std::max(1, options.min_elements_per_task));
+  for (size_t i = 0; i < fields.size(); ++i) {
+    const std::vector<absl::string_view>& elements = fields[i].elements;
+    const size_t num_tasks =
+        std::min(elements.size() / min_elements,
+                 static_cast<size_t>(std::max(1, options.max_tasks_per_field)));
+    if (num_tasks < 2) continue;
+    const Message* prototype = reflection->GetMessageFactory()->GetPrototype(
+        fields[i].field->message_type());
+    parsed[i].resize(elements.size());
+    const size_t per_task = (elements.size() + num_tasks - 1) / num_tasks;
+    for (size_t begin = 0; begin < elements.size(); begin += per_task) {
+      tasks.push_back({prototype, elements.data() + begin,
+                       parsed[i].data() + begin,
+                       std::min(per_task, elements.size() - begin)});
+    }
+  }
+
+  std::atomic<bool> ok{true};
+  auto run = [&ok, arena](const Task& task) {
+    bool task_ok = true;
+    for (size_t i = 0; i < task.count; ++i) {
+      Message* element = task.prototype->New(arena);
+      task_ok &= element->ParsePartialFromString(task.elements[i]);
+      task.out[i] = element;
+    }
+    if (!task_ok) ok.store(false, std::memory_order_relaxed);
+  };
+
+  // Keep the last task for the calling thread.
+  absl::BlockingCounter pending(tasks.empty() ? 0
+                                              : static_cast<int>(tasks.size()) -
+                                                    1);
+  for (size_t i = 0; i + 1 < tasks.size(); ++i) {
+    options.executor([&run, &pending, &task = tasks[i]] {
+      run(task);
+      pending.DecrementCount();
+    });
+  }
+
+  io::CodedInputStream rest_input(
+      reinterpret_cast<const uint8_t*>(rest.data()),
+      static_cast<int>(rest.size()));
+  bool rest_ok = message->MergePartialFromCodedStream(&rest_input) &&
+                 rest_input.ConsumedEntireMessage();
+
+  // Small fields are parsed in place.
+  for (size_t i = 0; i < fields.size(); ++i) {
+    if (!parsed[i].empty()) continue;
+    for (absl::string_view element : fields[i].elements) {
+      rest_ok &= reflection->AddMessage(message, fields[i].field)
+                     ->ParsePartialFromString(element);
+    }
+  }
+
+  if (!tasks.empty()) run(tasks.back());
+  pending.Wait();
+
+  // Splice the elements in. This happens even after errors so that none of
+  // them leak when `message` is not on an arena.
+  for (size_t i = 0; i < fields.size(); ++i) {
+    for (Message* element : parsed[i]) {
+      reflection->UnsafeArenaAddAllocatedMessage(message, fields[i].field,
+                                                 element);
+    }
+  }
+  return rest_ok && ok.load(std::memory_order_relaxed);
+}
+
+bool ParseFromStringParallel(absl::string_view data, Message* message,
+                             const ParallelParseOptions& options) {
+  message->Clear();
+  return MergePartialFromStringParallel(data, message, options) &&
+         message->IsInitialized();
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,66 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Defines utilities for parsing messages with very large repeated message
+// fields on several threads.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_PARALLEL_PARSE_H__
+#define GOOGLE_PROTOBUF_UTIL_PARALLEL_PARSE_H__
+
+#include <functional>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+struct ParallelParseOptions {
+  // Runs `task`, typically on another thread. Must be set. All tasks are
+  // waited for before the parse returns, so the executor must not run them on
+  // the calling thread after it blocks, e.g. from a queue it drains itself.
+  std::function<void(std::function<void()> task)> executor;
+
+  // Repeated message fields are parsed in tasks of at least this many
+  // elements. Fields with fewer elements are parsed on the calling thread.
+  int min_elements_per_task = 4096;
+
+  // Upper bound on the number of tasks scheduled for each field.
+  int max_tasks_per_field = 16;
+};
+
+// Merges the serialized message in `data` into `message`, like
+// MergePartialFromCodedStream() does, except that the elements of large
+// repeated message fields (other than maps) are parsed concurrently through
+// `options.executor`.
+//
+// The top level of `data` is scanned first to find the elements of every
+// repeated message field. Elements are then parsed in contiguous ranges, each
+// into messages allocated on the arena of `message` (or the heap if it has
+// none), and appended to their field in wire order. Everything else is parsed
+// on the calling thread while the tasks run. `message` is left in an
+// unspecified state if false is returned.
+PROTOBUF_EXPORT bool MergePartialFromStringParallel(
+    absl::string_view data, Message* message,
+    const ParallelParseOptions& options);
+
+// Like Message::ParseFromString(), but see MergePartialFromStringParallel().
+PROTOBUF_EXPORT bool ParseFromStringParallel(
+    absl::string_view data, Message* message,
+    const ParallelParseOptions& options);
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_PARALLEL_PARSE_H__
@@ -0,0 +1,130 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/parallel_parse.h"
+
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+// Runs every task on a new thread and joins them on destruction.
+class ThreadExecutor {
+ public:
+  ~ThreadExecutor() {
+    for (std::thread& thread : threads_) thread.join();
+  }
+
+  ParallelParseOptions Options(int min_elements_per_task) {
+    ParallelParseOptions options;
+    options.executor = [this](std::function<void()> task) {
+      absl::MutexLock lock(&mutex_);
+      threads_.emplace_back(std::move(task));
+    };
+    options.min_elements_per_task = min_elements_per_task;
+    options.max_tasks_per_field = 4;
+    return options;
+  }
+
+  int num_tasks() {
+    absl::MutexLock lock(&mutex_);
+    return static_cast<int>(threads_.size());
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<std::thread> threads_;
+};
+
+protobuf_unittest::TestAllTypes MakeLargeMessage() {
+  protobuf_unittest::TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  for (int i = 0; i < 1000; i++) {
+    message.add_repeated_nested_message()->set_bb(i);
+    message.add_repeated_foreign_message()->set_c(-i);
+  }
+  return message;
+}
+
+TEST(ParallelParseTest, MatchesRegularParse) {
+  const protobuf_unittest::TestAllTypes source = MakeLargeMessage();
+  const std::string data = source.SerializeAsString();
+
+  ThreadExecutor executor;
+  protobuf_unittest::TestAllTypes message;
+  ASSERT_TRUE(ParseFromStringParallel(data, &message, executor.Options(100)));
+  EXPECT_GT(executor.num_tasks(), 0);
+  EXPECT_EQ(message.SerializeAsString(), data);
+}
+
+TEST(ParallelParseTest, ParsesOntoArena) {
+  const protobuf_unittest::TestAllTypes source = MakeLargeMessage();
+  const std::string data = source.SerializeAsString();
+
+  ThreadExecutor executor;
+  Arena arena;
+  auto* message = Arena::CreateMessage<protobuf_unittest::TestAllTypes>(&arena);
+  ASSERT_TRUE(ParseFromStringParallel(data, message, executor.Options(100)));
+  EXPECT_EQ(message->SerializeAsString(), data);
+  EXPECT_EQ(message->repeated_nested_message(999).GetArena(), &arena);
+}
+
+TEST(ParallelParseTest, SmallFieldsStayOnCallingThread) {
+  const protobuf_unittest::TestAllTypes source = MakeLargeMessage();
+
+  ThreadExecutor executor;
+  protobuf_unittest::TestAllTypes message;
+  ASSERT_TRUE(ParseFromStringParallel(source.SerializeAsString(), &message,
+                                      executor.Options(100000)));
+  EXPECT_EQ(executor.num_tasks(), 0);
+  EXPECT_EQ(message.SerializeAsString(), source.SerializeAsString());
+}
+
+TEST(ParallelParseTest, MergeAppendsElements) {
+  protobuf_unittest::TestAllTypes source;
+  for (int i = 0; i < 10; i++) source.add_repeated_nested_message()->set_bb(i);
+
+  ThreadExecutor executor;
+  protobuf_unittest::TestAllTypes message;
+  message.add_repeated_nested_message()->set_bb(-1);
+  ASSERT_TRUE(MergePartialFromStringParallel(source.SerializeAsString(),
+                                             &message, executor.Options(2)));
+  ASSERT_EQ(message.repeated_nested_message_size(), 11);
+  for (int i = 0; i < 11; i++) {
+    EXPECT_EQ(message.repeated_nested_message(i).bb(), i - 1);
+  }
+}
+
+TEST(ParallelParseTest, RejectsMalformedElement) {
+  protobuf_unittest::TestAllTypes source;
+  for (int i = 0; i < 10; i++) source.add_repeated_nested_message()->set_bb(i);
+  std::string data = source.SerializeAsString();
+  // Each element is `tag, length 2, 0x08, bb`; make the last one's varint
+  // continue past its end.
+  data.back() = static_cast<char>(0x80);
+
+  ThreadExecutor executor;
+  protobuf_unittest::TestAllTypes message;
+  EXPECT_FALSE(ParseFromStringParallel(data, &message, executor.Options(2)));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
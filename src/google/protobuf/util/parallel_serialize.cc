@@ -0,0 +1,270 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/parallel_serialize.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/wire_format.h"
+#include "google/protobuf/wire_format_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::google::protobuf::internal::WireFormat;
+using ::google::protobuf::internal::WireFormatLite;
+
+// A contiguous range of the elements of a repeated message field.
+struct Range {
+  const FieldDescriptor* field;
+  int begin;
+  int end;
+  size_t size = 0;
+  uint8_t* target = nullptr;
+};
+
+// A top-level field, or the unknown fields if `field` is null. Large
+// repeated message fields are split into `num_ranges` ranges starting at
+// `first_range`.
+struct Part {
+  const FieldDescriptor* field;
+  size_t first_range = 0;
+  size_t num_ranges = 0;
+  size_t size = 0;
+  uint8_t* target = nullptr;
+};
+
+bool IsSplittable(const FieldDescriptor* field) {
+  return field->is_repeated() &&
+         field->type() == FieldDescriptor::TYPE_MESSAGE && !field->is_map();
+}
+
+class ParallelSerializer {
+ public:
+  ParallelSerializer(const Message& message,
+                     const ParallelSerializeOptions& options)
+      : message_(message),
+        options_(options),
+        deterministic_(
+            io::CodedOutputStream::IsDefaultSerializationDeterministic()) {
+    ABSL_CHECK(options.executor)
+        << "ParallelSerializeOptions::executor is not set";
+    const Reflection* reflection = message.GetReflection();
+    if (message.GetDescriptor()->options().message_set_wire_format()) return;
+
+    std::vector<const FieldDescriptor*> fields;
+    reflection->ListFields(message, &fields);
+    const int min_elements = std::max(1, options.min_elements_per_task);
+    for (const FieldDescriptor* field : fields) {
+      Part part{field};
+      if (IsSplittable(field)) {
+        const int count = reflection->FieldSize(message, field);
+        const int num_tasks = std::min(
+            count / min_elements, std::max(1, options.max_tasks_per_field));
+        if (num_tasks >= 2) {
+          part.first_range = ranges_.size();
+          const int per_task = (count + num_tasks - 1) / num_tasks;
+          for (int begin = 0; begin < count; begin += per_task) {
+            ranges_.push_back(
+                {field, begin, std::min(count, begin + per_task)});
+          }
+          part.num_ranges = ranges_.size() - part.first_range;
+        }
+      }
+      parts_.push_back(part);
+    }
+    parts_.push_back({nullptr});
+  }
+
+  // Whether any field is serialized in parallel. If not, the message is best
+  // serialized the usual way.
+  bool parallel() const { return !ranges_.empty(); }
+
+  // Computes the sizes of all parts and returns their sum. This also caches
+  // the sizes of all submessages, as ByteSizeLong() does.
+  size_t ComputeSize() {
+    RunInParallel([this](Range& range) { ComputeRangeSize(range); },
+                  [this] {
+                    for (Part& part : parts_) {
+                      if (part.num_ranges == 0) ComputePartSize(part);
+                    }
+                  });
+    size_t size = 0;
+    for (Part& part : parts_) {
+      for (size_t i = 0; i < part.num_ranges; ++i) {
+        part.size += ranges_[part.first_range + i].size;
+      }
+      size += part.size;
+    }
+    return size;
+  }
+
+  // Writes the message to `target`, which must have room for the size
+  // returned by ComputeSize().
+  void Write(uint8_t* target) {
+    for (Part& part : parts_) {
+      part.target = target;
+      for (size_t i = 0; i < part.num_ranges; ++i) {
+        Range& range = ranges_[part.first_range + i];
+        range.target = target;
+        target += range.size;
+      }
+      if (part.num_ranges == 0) target += part.size;
+    }
+    RunInParallel([this](Range& range) { WriteRange(range); },
+                  [this] {
+                    for (const Part& part : parts_) {
+                      if (part.num_ranges == 0) WritePart(part);
+                    }
+                  });
+  }
+
+ private:
+  // Runs `range_task` on all ranges through the executor, except for the last
+  // range, which is handled on the calling thread after `local_task`.
+  void RunInParallel(absl::FunctionRef<void(Range&)> range_task,
+                     absl::FunctionRef<void()> local_task) {
+    absl::BlockingCounter pending(static_cast<int>(ranges_.size()) - 1);
+    for (size_t i = 0; i + 1 < ranges_.size(); ++i) {
+      options_.executor([&range_task, &pending, &range = ranges_[i]] {
+        range_task(range);
+        pending.DecrementCount();
+      });
+    }
+    local_task();
+    range_task(ranges_.back());
+    pending.Wait();
+  }
+
+  const Message& Element(const Range& range, int i) const {
+    return message_.GetReflection()->GetRepeatedMessage(message_, range.field,
+                                                        i);
+  }
+
+  void ComputeRangeSize(Range& range) const {
+    size_t size = WireFormat::TagSize(range.field->number(),
+                                      FieldDescriptor::TYPE_MESSAGE) *
+                  static_cast<size_t>(range.end - range.begin);
+    for (int i = range.begin; i < range.end; ++i) {
+      size += WireFormatLite::MessageSize(Element(range, i));
+    }
+    range.size = size;
+  }
+
+  void ComputePartSize(Part& part) const {
+    part.size = part.field != nullptr
+                    ? WireFormat::FieldByteSize(part.field, message_)
+                    : WireFormat::ComputeUnknownFieldsSize(
+                          message_.GetReflection()->GetUnknownFields(message_));
+  }
+
+  void WriteRange(const Range& range) const {
+    io::EpsCopyOutputStream stream(range.target, static_cast<int>(range.size),
+                                   deterministic_);
+    uint8_t* ptr = range.target;
+    for (int i = range.begin; i < range.end; ++i) {
+      const Message& element = Element(range, i);
+      ptr = WireFormatLite::InternalWriteMessage(
+          range.field->number(), element, element.GetCachedSize(), ptr,
+          &stream);
+    }
+    ABSL_DCHECK_EQ(ptr, range.target + range.size);
+  }
+
+  void WritePart(const Part& part) const {
+    if (part.size == 0) return;
+    io::EpsCopyOutputStream stream(part.target, static_cast<int>(part.size),
+                                   deterministic_);
+    uint8_t* ptr =
+        part.field != nullptr
+            ? WireFormat::InternalSerializeField(part.field, message_,
+                                                 part.target, &stream)
+            : WireFormat::InternalSerializeUnknownFieldsToArray(
+                  message_.GetReflection()->GetUnknownFields(message_),
+                  part.target, &stream);
+    ABSL_DCHECK_EQ(ptr, part.target + part.size);
+  }
+
+  const Message& message_;
+  const ParallelSerializeOptions& options_;
+  const bool deterministic_;
+  std::vector<Part> parts_;
+  std::vector<Range> ranges_;
+};
+
+bool CheckSize(const Message& message, size_t size) {
+  if (size > INT_MAX) {
+    ABSL_LOG(ERROR) << message.GetTypeName()
+                    << " exceeded maximum protobuf size of 2GB: " << size;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool SerializePartialToArrayParallel(const Message& message, void* data,
+                                     int size,
+                                     const ParallelSerializeOptions& options) {
+  ParallelSerializer serializer(message, options);
+  if (!serializer.parallel()) {
+    return message.SerializePartialToArray(data, size);
+  }
+  const size_t byte_size = serializer.ComputeSize();
+  if (!CheckSize(message, byte_size)) return false;
+  if (size < static_cast<int64_t>(byte_size)) return false;
+  serializer.Write(static_cast<uint8_t*>(data));
+  return true;
+}
+
+bool SerializeToArrayParallel(const Message& message, void* data, int size,
+                              const ParallelSerializeOptions& options) {
+  ABSL_DCHECK(message.IsInitialized())
+      << "Can't serialize message of type \"" << message.GetTypeName()
+      << "\" because it is missing required fields: "
+      << message.InitializationErrorString();
+  return SerializePartialToArrayParallel(message, data, size, options);
+}
+
+bool SerializeToStringParallel(const Message& message, std::string* output,
+                               const ParallelSerializeOptions& options) {
+  ABSL_DCHECK(message.IsInitialized())
+      << "Can't serialize message of type \"" << message.GetTypeName()
+      << "\" because it is missing required fields: "
+      << message.InitializationErrorString();
+  ParallelSerializer serializer(message, options);
+  if (!serializer.parallel()) return message.SerializePartialToString(output);
+  const size_t byte_size = serializer.ComputeSize();
+  if (!CheckSize(message, byte_size)) return false;
+  output->resize(byte_size);
+  serializer.Write(reinterpret_cast<uint8_t*>(&(*output)[0]));
+  return true;
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
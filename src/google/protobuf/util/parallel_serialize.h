@@ -0,0 +1,73 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Defines utilities for serializing messages with very large repeated message
+// fields on several threads.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_PARALLEL_SERIALIZE_H__
+#define GOOGLE_PROTOBUF_UTIL_PARALLEL_SERIALIZE_H__
+
+#include <functional>
+#include <string>
+
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+struct ParallelSerializeOptions {
+  // Runs `task`, typically on another thread. Must be set. All tasks are
+  // waited for before the serialization returns, so the executor must not run
+  // them on the calling thread after it blocks, e.g. from a queue it drains
+  // itself.
+  std::function<void(std::function<void()> task)> executor;
+
+  // Repeated message fields are serialized in tasks of at least this many
+  // elements. Fields with fewer elements are serialized on the calling thread.
+  int min_elements_per_task = 4096;
+
+  // Upper bound on the number of tasks scheduled for each field.
+  int max_tasks_per_field = 16;
+};
+
+// Serializes `message` to the `size` bytes at `data`, producing the same bytes
+// as Message::SerializePartialToArray(), except that the elements of large
+// repeated message fields (other than maps) are serialized concurrently
+// through `options.executor`.
+//
+// The elements are split into contiguous ranges. The sizes of the ranges are
+// computed in parallel first, which gives every range its offset in the
+// output; each range is then written straight into `data` in parallel. The
+// other fields are sized and written on the calling thread meanwhile.
+// `message` must not be modified while this runs. Returns false if `size` is
+// too small or the output would exceed 2GB.
+PROTOBUF_EXPORT bool SerializePartialToArrayParallel(
+    const Message& message, void* data, int size,
+    const ParallelSerializeOptions& options);
+
+// Like Message::SerializeToArray(), but see SerializePartialToArrayParallel().
+PROTOBUF_EXPORT bool SerializeToArrayParallel(
+    const Message& message, void* data, int size,
+    const ParallelSerializeOptions& options);
+
+// Like Message::SerializeToString(), but see
+// SerializePartialToArrayParallel().
+PROTOBUF_EXPORT bool SerializeToStringParallel(
+    const Message& message, std::string* output,
+    const ParallelSerializeOptions& options);
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_PARALLEL_SERIALIZE_H__
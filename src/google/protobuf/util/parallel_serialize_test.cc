@@ -0,0 +1,121 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/parallel_serialize.h"
+
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+// Runs every task on a new thread and joins them on destruction.
+class ThreadExecutor {
+ public:
+  ~ThreadExecutor() {
+    for (std::thread& thread : threads_) thread.join();
+  }
+
+  ParallelSerializeOptions Options(int min_elements_per_task) {
+    ParallelSerializeOptions options;
+    options.executor = [this](std::function<void()> task) {
+      absl::MutexLock lock(&mutex_);
+      threads_.emplace_back(std::move(task));
+    };
+    options.min_elements_per_task = min_elements_per_task;
+    options.max_tasks_per_field = 4;
+    return options;
+  }
+
+  int num_tasks() {
+    absl::MutexLock lock(&mutex_);
+    return static_cast<int>(threads_.size());
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<std::thread> threads_;
+};
+
+protobuf_unittest::TestAllTypes MakeLargeMessage() {
+  protobuf_unittest::TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  for (int i = 0; i < 1000; i++) {
+    message.add_repeated_nested_message()->set_bb(i);
+    message.add_repeated_foreign_message()->set_c(-i);
+  }
+  message.mutable_unknown_fields()->AddVarint(123456, 1);
+  return message;
+}
+
+TEST(ParallelSerializeTest, MatchesRegularSerialization) {
+  const protobuf_unittest::TestAllTypes message = MakeLargeMessage();
+  const std::string expected = message.SerializeAsString();
+
+  ThreadExecutor executor;
+  std::string data;
+  ASSERT_TRUE(
+      SerializeToStringParallel(message, &data, executor.Options(100)));
+  EXPECT_GT(executor.num_tasks(), 0);
+  EXPECT_EQ(data, expected);
+}
+
+TEST(ParallelSerializeTest, SerializesExtensions) {
+  protobuf_unittest::TestAllExtensions message;
+  TestUtil::SetAllExtensions(&message);
+  for (int i = 0; i < 1000; i++) {
+    message.AddExtension(protobuf_unittest::repeated_nested_message_extension)
+        ->set_bb(i);
+  }
+
+  ThreadExecutor executor;
+  std::string data;
+  ASSERT_TRUE(SerializeToStringParallel(message, &data, executor.Options(10)));
+  EXPECT_GT(executor.num_tasks(), 0);
+  EXPECT_EQ(data, message.SerializeAsString());
+}
+
+TEST(ParallelSerializeTest, SerializesToArray) {
+  const protobuf_unittest::TestAllTypes message = MakeLargeMessage();
+  const std::string expected = message.SerializeAsString();
+
+  ThreadExecutor executor;
+  std::string data(expected.size() + 1, '\0');
+  ASSERT_TRUE(SerializeToArrayParallel(message, &data[0],
+                                       static_cast<int>(data.size()),
+                                       executor.Options(100)));
+  EXPECT_EQ(data, expected + '\0');
+  EXPECT_FALSE(SerializeToArrayParallel(message, &data[0],
+                                        static_cast<int>(expected.size()) - 1,
+                                        executor.Options(100)));
+}
+
+TEST(ParallelSerializeTest, SmallFieldsStayOnCallingThread) {
+  const protobuf_unittest::TestAllTypes message = MakeLargeMessage();
+
+  ThreadExecutor executor;
+  std::string data;
+  ASSERT_TRUE(
+      SerializeToStringParallel(message, &data, executor.Options(100000)));
+  EXPECT_EQ(executor.num_tasks(), 0);
+  EXPECT_EQ(data, message.SerializeAsString());
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
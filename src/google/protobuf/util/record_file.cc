@@ -0,0 +1,582 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/record_file.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <string.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/functional/function_ref.h"
+#include "absl/log/absl_check.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/message_lite.h"
+#if HAVE_ZSTD
+#include "google/protobuf/io/zstd_stream.h"
+#endif
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+// The trailer holds the offset and size of the index, then the magic.
+constexpr char kMagic[] = "PBRECIDX";
+constexpr size_t kMagicSize = sizeof(kMagic) - 1;
+constexpr size_t kTrailerSize = 16 + kMagicSize;
+
+// Flags in the index header.
+constexpr uint32_t kHasKeys = 1;
+
+const char kSubStreamFailed[] = "Underlying stream failed";
+const char kCorruptFile[] = "Corrupt record file";
+#if !HAVE_ZSTD
+const char kNoZstd[] = "Record file compression requires zstd support";
+#endif
+
+void AppendVarint(uint64_t value, std::string* out) {
+  uint8_t buffer[10];
+  uint8_t* end = io::CodedOutputStream::WriteVarint64ToArray(value, buffer);
+  out->append(reinterpret_cast<const char*>(buffer), end - buffer);
+}
+
+void AppendDelimited(absl::string_view data, std::string* out) {
+  AppendVarint(data.size(), out);
+  out->append(data.data(), data.size());
+}
+
+// Reads a varint from the front of `data`.
+bool ConsumeVarint(absl::string_view* data, uint64_t* value) {
+  *value = 0;
+  for (size_t i = 0; i < data->size() && i < 10; ++i) {
+    uint8_t byte = static_cast<uint8_t>((*data)[i]);
+    *value |= uint64_t{byte & 0x7fu} << (7 * i);
+    if (byte < 0x80) {
+      data->remove_prefix(i + 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Reads a size-delimited string from the front of `data`.
+bool ConsumeDelimited(absl::string_view* data, absl::string_view* value) {
+  uint64_t size;
+  if (!ConsumeVarint(data, &size) || size > data->size()) return false;
+  *value = data->substr(0, static_cast<size_t>(size));
+  data->remove_prefix(static_cast<size_t>(size));
+  return true;
+}
+
+#if HAVE_ZSTD
+bool WriteAll(absl::string_view data, io::ZeroCopyOutputStream* output) {
+  while (!data.empty()) {
+    void* buffer;
+    int size;
+    if (!output->Next(&buffer, &size)) return false;
+    size_t n = std::min(data.size(), static_cast<size_t>(size));
+    memcpy(buffer, data.data(), n);
+    data.remove_prefix(n);
+    if (n < static_cast<size_t>(size)) {
+      output->BackUp(size - static_cast<int>(n));
+    }
+  }
+  return true;
+}
+#endif  // HAVE_ZSTD
+
+}  // namespace
+
+// ===================================================================
+
+RecordFileWriter::RecordFileWriter(io::ZeroCopyOutputStream* output)
+    : RecordFileWriter(output, Options()) {}
+
+RecordFileWriter::RecordFileWriter(io::ZeroCopyOutputStream* output,
+                                   const Options& options)
+    : output_(output), options_(options) {
+#if !HAVE_ZSTD
+  if (options_.compression == RecordCompression::kZstd) {
+    error_message_ = kNoZstd;
+  }
+#endif
+}
+
+RecordFileWriter::~RecordFileWriter() {
+  if (!closed_) Close();
+}
+
+bool RecordFileWriter::BeginRecord(const absl::string_view* key) {
+  if (closed_ || error_message_ != nullptr) return false;
+  if (num_records_ == 0) {
+    has_keys_ = key != nullptr;
+  } else if (has_keys_ != (key != nullptr)) {
+    error_message_ = "Either all records must have keys or none";
+    return false;
+  }
+  if (key != nullptr) {
+    if (num_records_ > 0 && *key < last_key_) {
+      error_message_ = "Record keys must not decrease";
+      return false;
+    }
+    last_key_.assign(key->data(), key->size());
+    if (block_records_ == 0) block_first_key_ = last_key_;
+    AppendDelimited(*key, &block_);
+  }
+  return true;
+}
+
+bool RecordFileWriter::EndRecord() {
+  ++block_records_;
+  ++num_records_;
+  if (block_.size() > INT_MAX) {
+    error_message_ = "Record too large";
+    return false;
+  }
+  return block_.size() < options_.block_size || FinishBlock();
+}
+
+bool RecordFileWriter::Write(const MessageLite& message) {
+  return WriteMessage(nullptr, message);
+}
+
+bool RecordFileWriter::Write(absl::string_view key,
+                             const MessageLite& message) {
+  return WriteMessage(&key, message);
+}
+
+bool RecordFileWriter::WriteMessage(const absl::string_view* key,
+                                    const MessageLite& message) {
+  if (!BeginRecord(key)) return false;
+  size_t size = message.ByteSizeLong();
+  if (size > INT_MAX) {
+    error_message_ = "Record too large";
+    return false;
+  }
+  AppendVarint(size, &block_);
+  size_t offset = block_.size();
+  block_.resize(offset + size);
+  message.SerializeWithCachedSizesToArray(
+      reinterpret_cast<uint8_t*>(&block_[offset]));
+  return EndRecord();
+}
+
+bool RecordFileWriter::WriteSerialized(absl::string_view record) {
+  if (!BeginRecord(nullptr)) return false;
+  AppendDelimited(record, &block_);
+  return EndRecord();
+}
+
+bool RecordFileWriter::WriteSerialized(absl::string_view key,
+                                       absl::string_view record) {
+  if (!BeginRecord(&key)) return false;
+  AppendDelimited(record, &block_);
+  return EndRecord();
+}
+
+bool RecordFileWriter::FinishBlock() {
+  if (block_records_ == 0) return true;
+  absl::string_view stored = block_;
+  if (options_.compression == RecordCompression::kZstd) {
+#if HAVE_ZSTD
+    compressed_.clear();
+    io::StringOutputStream string_output(&compressed_);
+    io::ZstdOutputStream::Options zstd_options;
+    if (options_.compression_level != 0) {
+      zstd_options.compression_level = options_.compression_level;
+    }
+    io::ZstdOutputStream zstd(&string_output, zstd_options);
+    if (!WriteAll(block_, &zstd) || !zstd.Close()) {
+      error_message_ = zstd.ZstdErrorMessage() != nullptr
+                           ? zstd.ZstdErrorMessage()
+                           : kSubStreamFailed;
+      return false;
+    }
+    stored = compressed_;
+#else
+    error_message_ = kNoZstd;
+    return false;
+#endif
+  }
+
+  AppendVarint(static_cast<uint64_t>(output_.ByteCount()), &index_);
+  AppendVarint(stored.size(), &index_);
+  AppendVarint(block_.size(), &index_);
+  AppendVarint(block_records_, &index_);
+  AppendVarint(static_cast<uint64_t>(options_.compression), &index_);
+  if (has_keys_) {
+    AppendDelimited(block_first_key_, &index_);
+    AppendDelimited(last_key_, &index_);
+  }
+  ++num_blocks_;
+
+  output_.WriteRaw(stored.data(), static_cast<int>(stored.size()));
+  block_.clear();
+  block_records_ = 0;
+  if (output_.HadError()) {
+    error_message_ = kSubStreamFailed;
+    return false;
+  }
+  return true;
+}
+
+bool RecordFileWriter::Close() {
+  if (closed_) return false;
+  if (error_message_ != nullptr || !FinishBlock()) {
+    closed_ = true;
+    return false;
+  }
+  closed_ = true;
+
+  std::string header;
+  AppendVarint(has_keys_ ? kHasKeys : 0, &header);
+  AppendVarint(num_blocks_, &header);
+  const uint64_t index_offset = static_cast<uint64_t>(output_.ByteCount());
+  output_.WriteString(header);
+  output_.WriteString(index_);
+  output_.WriteLittleEndian64(index_offset);
+  output_.WriteLittleEndian64(header.size() + index_.size());
+  output_.WriteRaw(kMagic, kMagicSize);
+  output_.Trim();
+  if (output_.HadError()) {
+    error_message_ = kSubStreamFailed;
+    return false;
+  }
+  return true;
+}
+
+// ===================================================================
+
+RecordFileReader::RecordFileReader(absl::string_view data)
+    : RecordFileReader(data, Options()) {}
+
+RecordFileReader::RecordFileReader(absl::string_view data, Options options)
+    : data_(data), options_(std::move(options)) {
+  if (!ReadIndex()) error_message_ = kCorruptFile;
+}
+
+#ifndef _WIN32
+RecordFileReader::RecordFileReader(int file_descriptor)
+    : RecordFileReader(file_descriptor, Options()) {}
+
+RecordFileReader::RecordFileReader(int file_descriptor, Options options)
+    : options_(std::move(options)) {
+  struct stat info;
+  if (fstat(file_descriptor, &info) != 0 || !S_ISREG(info.st_mode)) {
+    error_message_ = "Cannot map record file";
+    return;
+  }
+  mapping_size_ = static_cast<size_t>(info.st_size);
+  if (mapping_size_ > 0) {
+    void* mapping = mmap(nullptr, mapping_size_, PROT_READ, MAP_PRIVATE,
+                         file_descriptor, 0);
+    if (mapping == MAP_FAILED) {
+      mapping_size_ = 0;
+      error_message_ = "Cannot map record file";
+      return;
+    }
+    // Only a hint; failure is harmless.
+    madvise(mapping, mapping_size_, MADV_RANDOM);
+    mapping_ = mapping;
+    data_ = absl::string_view(static_cast<const char*>(mapping), mapping_size_);
+  }
+  if (!ReadIndex()) error_message_ = kCorruptFile;
+}
+#endif  // !_WIN32
+
+RecordFileReader::~RecordFileReader() {
+#ifndef _WIN32
+  if (mapping_ != nullptr) munmap(mapping_, mapping_size_);
+#endif
+}
+
+bool RecordFileReader::ReadIndex() {
+  if (data_.size() < kTrailerSize ||
+      data_.substr(data_.size() - kMagicSize) !=
+          absl::string_view(kMagic, kMagicSize)) {
+    return false;
+  }
+  const uint8_t* trailer =
+      reinterpret_cast<const uint8_t*>(data_.data() + data_.size()) -
+      kTrailerSize;
+  uint64_t index_offset;
+  uint64_t index_size;
+  trailer = io::CodedInputStream::ReadLittleEndian64FromArray(trailer,
+                                                               &index_offset);
+  io::CodedInputStream::ReadLittleEndian64FromArray(trailer, &index_size);
+  const uint64_t index_end = data_.size() - kTrailerSize;
+  if (index_offset > index_end || index_size != index_end - index_offset) {
+    return false;
+  }
+
+  absl::string_view index = data_.substr(static_cast<size_t>(index_offset),
+                                         static_cast<size_t>(index_size));
+  uint64_t flags;
+  uint64_t num_blocks;
+  if (!ConsumeVarint(&index, &flags) || !ConsumeVarint(&index, &num_blocks) ||
+      num_blocks > index.size()) {
+    return false;
+  }
+  has_keys_ = (flags & kHasKeys) != 0;
+  blocks_.reserve(static_cast<size_t>(num_blocks));
+  uint64_t end_of_blocks = 0;
+  for (uint64_t i = 0; i < num_blocks; ++i) {
+    Block block;
+    uint64_t compression;
+    if (!ConsumeVarint(&index, &block.offset) ||
+        !ConsumeVarint(&index, &block.stored_size) ||
+        !ConsumeVarint(&index, &block.size) ||
+        !ConsumeVarint(&index, &block.num_records) ||
+        !ConsumeVarint(&index, &compression)) {
+      return false;
+    }
+    if (has_keys_ && (!ConsumeDelimited(&index, &block.first_key) ||
+                      !ConsumeDelimited(&index, &block.last_key))) {
+      return false;
+    }
+    // Blocks are stored in order, before the index.
+    if (block.offset < end_of_blocks || block.stored_size > index_offset ||
+        block.offset > index_offset - block.stored_size ||
+        block.size > INT_MAX || block.num_records == 0 ||
+        compression > static_cast<uint64_t>(RecordCompression::kZstd)) {
+      return false;
+    }
+    if (compression == static_cast<uint64_t>(RecordCompression::kNone) &&
+        block.stored_size != block.size) {
+      return false;
+    }
+    end_of_blocks = block.offset + block.stored_size;
+    block.compression = static_cast<RecordCompression>(compression);
+    block.first_record = num_records_;
+    num_records_ += block.num_records;
+    blocks_.push_back(block);
+  }
+  return index.empty();
+}
+
+size_t RecordFileReader::FindBlock(uint64_t index) const {
+  auto it = std::partition_point(
+      blocks_.begin(), blocks_.end(),
+      [index](const Block& block) { return block.first_record <= index; });
+  return static_cast<size_t>(it - blocks_.begin()) - 1;
+}
+
+const char* RecordFileReader::DecodeBlock(const Block& block,
+                                          std::string* buffer,
+                                          absl::string_view* data) const {
+  absl::string_view stored = data_.substr(static_cast<size_t>(block.offset),
+                                          static_cast<size_t>(block.stored_size));
+  if (block.compression == RecordCompression::kNone) {
+    *data = stored;
+    return nullptr;
+  }
+#if HAVE_ZSTD
+  ABSL_DCHECK(block.compression == RecordCompression::kZstd);
+  buffer->resize(static_cast<size_t>(block.size));
+  io::ArrayInputStream input(stored.data(), static_cast<int>(stored.size()));
+  io::ZstdInputStream zstd(&input);
+  size_t position = 0;
+  const void* chunk;
+  int size;
+  while (zstd.Next(&chunk, &size)) {
+    if (static_cast<size_t>(size) > buffer->size() - position) {
+      return kCorruptFile;
+    }
+    memcpy(&(*buffer)[position], chunk, size);
+    position += size;
+  }
+  if (zstd.ZstdErrorMessage() != nullptr) return zstd.ZstdErrorMessage();
+  if (position != buffer->size()) return kCorruptFile;
+  *data = *buffer;
+  return nullptr;
+#else
+  return kNoZstd;
+#endif
+}
+
+bool RecordFileReader::LoadBlock(size_t i) {
+  if (cached_block_ == i) return true;
+  cached_block_ = SIZE_MAX;
+  const char* error = DecodeBlock(blocks_[i], &cached_buffer_, &cached_data_);
+  if (error != nullptr) {
+    error_message_ = error;
+    return false;
+  }
+  cached_block_ = i;
+  return true;
+}
+
+bool RecordFileReader::ReadSerialized(uint64_t index,
+                                      absl::string_view* record,
+                                      absl::string_view* key) {
+  if (index >= num_records_) return false;
+  const size_t i = FindBlock(index);
+  if (!LoadBlock(i)) return false;
+  absl::string_view data = cached_data_;
+  absl::string_view record_key;
+  for (uint64_t n = blocks_[i].first_record; n <= index; ++n) {
+    if ((has_keys_ && !ConsumeDelimited(&data, &record_key)) ||
+        !ConsumeDelimited(&data, record)) {
+      error_message_ = kCorruptFile;
+      return false;
+    }
+  }
+  if (key != nullptr) *key = record_key;
+  return true;
+}
+
+bool RecordFileReader::Read(uint64_t index, MessageLite* message) {
+  absl::string_view record;
+  return ReadSerialized(index, &record) && message->ParseFromString(record);
+}
+
+uint64_t RecordFileReader::LowerBound(absl::string_view key) {
+  ABSL_DCHECK(has_keys_) << "LowerBound() requires a file with keys";
+  auto it = std::partition_point(
+      blocks_.begin(), blocks_.end(),
+      [key](const Block& block) { return block.last_key < key; });
+  if (it == blocks_.end()) return num_records_;
+  const size_t i = static_cast<size_t>(it - blocks_.begin());
+  if (key <= it->first_key || !LoadBlock(i)) return it->first_record;
+  absl::string_view data = cached_data_;
+  absl::string_view record_key;
+  absl::string_view record;
+  for (uint64_t n = 0; n < it->num_records; ++n) {
+    if (!ConsumeDelimited(&data, &record_key) ||
+        !ConsumeDelimited(&data, &record)) {
+      error_message_ = kCorruptFile;
+      break;
+    }
+    if (record_key >= key) return it->first_record + n;
+  }
+  return it->first_record + it->num_records;
+}
+
+bool RecordFileReader::ScanBlock(
+    size_t i, absl::string_view data, uint64_t begin, uint64_t end,
+    absl::FunctionRef<bool(uint64_t index, absl::string_view key,
+                           absl::string_view record)>
+        callback) {
+  const Block& block = blocks_[i];
+  end = std::min(end, block.first_record + block.num_records);
+  absl::string_view key;
+  absl::string_view record;
+  for (uint64_t n = block.first_record; n < end; ++n) {
+    if ((has_keys_ && !ConsumeDelimited(&data, &key)) ||
+        !ConsumeDelimited(&data, &record)) {
+      error_message_ = kCorruptFile;
+      return false;
+    }
+    if (n >= begin && !callback(n, key, record)) return false;
+  }
+  return true;
+}
+
+bool RecordFileReader::Scan(
+    uint64_t begin, uint64_t end,
+    absl::FunctionRef<bool(uint64_t index, absl::string_view key,
+                           absl::string_view record)>
+        callback) {
+  end = std::min(end, num_records_);
+  if (begin >= end) return true;
+  const size_t first = FindBlock(begin);
+  const size_t last = FindBlock(end - 1);
+
+  if (!options_.executor || options_.max_parallel_blocks < 2) {
+    for (size_t i = first; i <= last; ++i) {
+      if (!LoadBlock(i) || !ScanBlock(i, cached_data_, begin, end, callback)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Blocks are decompressed up to max_parallel_blocks ahead of the one
+  // being scanned.
+  struct Slot {
+    std::string buffer;
+    absl::string_view data;
+    const char* error = nullptr;
+    bool done = false;
+  };
+  absl::Mutex mutex;
+  int running = 0;
+  std::deque<std::unique_ptr<Slot>> slots;
+  size_t next = first;
+  auto schedule = [&] {
+    while (next <= last &&
+           slots.size() < static_cast<size_t>(options_.max_parallel_blocks)) {
+      slots.push_back(std::make_unique<Slot>());
+      Slot* slot = slots.back().get();
+      const Block& block = blocks_[next++];
+      if (block.compression == RecordCompression::kNone) {
+        DecodeBlock(block, &slot->buffer, &slot->data);
+        slot->done = true;
+        continue;
+      }
+      {
+        absl::MutexLock lock(&mutex);
+        ++running;
+      }
+      options_.executor([this, &mutex, &running, &block, slot] {
+        const char* error = DecodeBlock(block, &slot->buffer, &slot->data);
+        absl::MutexLock lock(&mutex);
+        slot->error = error;
+        slot->done = true;
+        --running;
+      });
+    }
+  };
+
+  bool ok = true;
+  for (size_t i = first; ok && i <= last; ++i) {
+    schedule();
+    Slot& slot = *slots.front();
+    {
+      absl::MutexLock lock(&mutex);
+      mutex.Await(absl::Condition(&slot.done));
+    }
+    if (slot.error != nullptr) {
+      error_message_ = slot.error;
+      ok = false;
+    } else {
+      ok = ScanBlock(i, slot.data, begin, end, callback);
+    }
+    slots.pop_front();
+  }
+
+  // Wait for the tasks of blocks we did not get to.
+  absl::MutexLock lock(&mutex);
+  mutex.Await(absl::Condition(
+      +[](int* running) { return *running == 0; }, &running));
+  return ok;
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,233 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Defines a file format for sequences of messages that supports random
+// access, and classes to write and read it.
+//
+// A record file is a sequence of blocks followed by an index.  Each block
+// holds consecutive records, each written like
+// SerializeDelimitedToZeroCopyStream() does, and may be compressed on its
+// own.  If the writer was given keys, every record is preceded by its key,
+// delimited the same way.  The index lists, for each block, its position,
+// sizes, number of records and the first and last key.  A fixed-size trailer
+// at the end of the file points at the index.
+//
+// Reading record #N or the records in a key range thus only decodes the
+// blocks holding them.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_RECORD_FILE_H__
+#define GOOGLE_PROTOBUF_UTIL_RECORD_FILE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/message_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+enum class RecordCompression {
+  kNone = 0,
+  // Requires that protobuf was built with zstd, see protobuf_WITH_ZSTD.
+  kZstd = 1,
+};
+
+// Writes a record file to a ZeroCopyOutputStream.
+class PROTOBUF_EXPORT RecordFileWriter {
+ public:
+  struct Options {
+    // A block ends once it holds at least this many uncompressed bytes.
+    // Smaller blocks make random access cheaper and compress worse.
+    size_t block_size = 64 << 10;
+
+    RecordCompression compression = RecordCompression::kNone;
+
+    // Passed to the compressor; 0 selects its default.
+    int compression_level = 0;
+  };
+
+  // `output` is not owned and must outlive the writer.  The file starts at
+  // the stream's current position; offsets in the index are relative to it.
+  explicit RecordFileWriter(io::ZeroCopyOutputStream* output);
+  RecordFileWriter(io::ZeroCopyOutputStream* output, const Options& options);
+  RecordFileWriter(const RecordFileWriter&) = delete;
+  RecordFileWriter& operator=(const RecordFileWriter&) = delete;
+  // Calls Close() unless it was called already.
+  ~RecordFileWriter();
+
+  // Appends a record.  Either all records of a file have keys or none do.
+  // Keys must not decrease from one record to the next.  Returns false on
+  // error; see ErrorMessage().  Once an error occurred, all further calls
+  // fail.
+  bool Write(const MessageLite& message);
+  bool Write(absl::string_view key, const MessageLite& message);
+
+  // Appends a record that is already serialized.
+  bool WriteSerialized(absl::string_view record);
+  bool WriteSerialized(absl::string_view key, absl::string_view record);
+
+  // Ends the last block and writes the index.  The file is incomplete until
+  // this returns true.  It is the caller's responsibility to flush or close
+  // the underlying stream if necessary.
+  bool Close();
+
+  // Return last error message or NULL if no error.
+  const char* ErrorMessage() const { return error_message_; }
+
+ private:
+  // Checks `key`, or the lack of one, and appends it to the block.
+  bool BeginRecord(const absl::string_view* key);
+  // Counts the record appended after BeginRecord(), and ends the block if it
+  // is full.
+  bool EndRecord();
+  bool WriteMessage(const absl::string_view* key, const MessageLite& message);
+  bool FinishBlock();
+
+  io::CodedOutputStream output_;
+  const Options options_;
+  const char* error_message_ = nullptr;
+  bool closed_ = false;
+
+  bool has_keys_ = false;
+  uint64_t num_records_ = 0;
+  std::string last_key_;
+
+  // The current block, uncompressed.
+  std::string block_;
+  std::string block_first_key_;
+  uint64_t block_records_ = 0;
+  std::string compressed_;
+  // The index, for blocks written so far.
+  std::string index_;
+  uint64_t num_blocks_ = 0;
+};
+
+// Reads a record file held in memory, for example a mapped file.
+//
+// Uncompressed records are returned in place.  A RecordFileReader is not
+// thread-safe.
+class PROTOBUF_EXPORT RecordFileReader {
+ public:
+  struct Options {
+    // If set, runs `task`, typically on another thread, so that Scan()
+    // decompresses several blocks concurrently.  All tasks are waited for
+    // before Scan() returns, so the executor must not run them on the
+    // calling thread after it blocks.
+    std::function<void(std::function<void()> task)> executor;
+
+    // How many blocks Scan() decompresses ahead at most.
+    int max_parallel_blocks = 8;
+  };
+
+  // Reads the file in `data`, which must outlive the reader.  Check
+  // ErrorMessage() before using the reader.
+  explicit RecordFileReader(absl::string_view data);
+  RecordFileReader(absl::string_view data, Options options);
+#ifndef _WIN32
+  // Maps the regular file open as `file_descriptor` into memory and reads
+  // it.  The descriptor may be closed once the constructor returns.
+  explicit RecordFileReader(int file_descriptor);
+  RecordFileReader(int file_descriptor, Options options);
+#endif  // !_WIN32
+  RecordFileReader(const RecordFileReader&) = delete;
+  RecordFileReader& operator=(const RecordFileReader&) = delete;
+  ~RecordFileReader();
+
+  // Return last error message or NULL if no error.
+  const char* ErrorMessage() const { return error_message_; }
+
+  uint64_t num_records() const { return num_records_; }
+  bool has_keys() const { return has_keys_; }
+
+  // Parses record `index` into `message`.  Decodes only the block holding
+  // it; consecutive reads from one block decode it once.
+  bool Read(uint64_t index, MessageLite* message);
+
+  // Returns the serialized record `index`, and its key if the file has keys.
+  // The data stays valid until the next call on this reader.
+  bool ReadSerialized(uint64_t index, absl::string_view* record,
+                      absl::string_view* key = nullptr);
+
+  // Returns the index of the first record whose key is not less than `key`,
+  // or num_records() if there is none.  The file must have keys.
+  uint64_t LowerBound(absl::string_view key);
+
+  // Calls `callback` with each record in [begin, end) in order, with an
+  // empty key if the file has none.  The data passed in is only valid
+  // during the call.  Stops early if `callback` returns false.  Returns
+  // false if so or on an error.
+  //
+  // Records in the key range [from, to) are visited with
+  //   Scan(LowerBound(from), LowerBound(to), callback).
+  bool Scan(uint64_t begin, uint64_t end,
+            absl::FunctionRef<bool(uint64_t index, absl::string_view key,
+                                   absl::string_view record)>
+                callback);
+
+ private:
+  struct Block {
+    uint64_t offset;
+    uint64_t stored_size;
+    uint64_t size;
+    uint64_t first_record;
+    uint64_t num_records;
+    RecordCompression compression;
+    absl::string_view first_key;
+    absl::string_view last_key;
+  };
+
+  bool ReadIndex();
+  // The block holding record `index`, which must be less than num_records().
+  size_t FindBlock(uint64_t index) const;
+  // Decodes `block`, into `buffer` if it is compressed.  Returns an error
+  // message, or NULL on success.  Safe to call concurrently.
+  const char* DecodeBlock(const Block& block, std::string* buffer,
+                          absl::string_view* data) const;
+  // Decodes block `i` into cached_data_, unless it is already there.
+  bool LoadBlock(size_t i);
+  // Calls `callback` for the records [begin, end) of the decoded block `i`.
+  bool ScanBlock(size_t i, absl::string_view data, uint64_t begin,
+                 uint64_t end,
+                 absl::FunctionRef<bool(uint64_t index, absl::string_view key,
+                                        absl::string_view record)>
+                     callback);
+
+  absl::string_view data_;
+  const Options options_;
+  const char* error_message_ = nullptr;
+  // The mapping of the file, if the reader mapped it.
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+
+  bool has_keys_ = false;
+  uint64_t num_records_ = 0;
+  std::vector<Block> blocks_;
+
+  // The block decoded last by Read(), ReadSerialized() or LowerBound().
+  size_t cached_block_ = SIZE_MAX;
+  std::string cached_buffer_;
+  absl::string_view cached_data_;
+};
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_RECORD_FILE_H__
@@ -0,0 +1,237 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/record_file.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+
+std::string Key(int i) { return absl::StrCat("key", 100000 + i); }
+
+// Writes `count` records; record i has optional_int32 == i.
+std::string WriteFile(int count, bool keys,
+                      const RecordFileWriter::Options& options) {
+  std::string data;
+  io::StringOutputStream output(&data);
+  RecordFileWriter writer(&output, options);
+  for (int i = 0; i < count; ++i) {
+    TestAllTypes message;
+    message.set_optional_int32(i);
+    message.set_optional_string(std::string(i % 100, 'x'));
+    EXPECT_TRUE(keys ? writer.Write(Key(i), message) : writer.Write(message))
+        << writer.ErrorMessage();
+  }
+  EXPECT_TRUE(writer.Close()) << writer.ErrorMessage();
+  return data;
+}
+
+RecordFileWriter::Options SmallBlocks() {
+  RecordFileWriter::Options options;
+  options.block_size = 1000;
+  return options;
+}
+
+TEST(RecordFileTest, RandomAccess) {
+  const std::string data = WriteFile(5000, false, SmallBlocks());
+  RecordFileReader reader(data);
+  ASSERT_EQ(reader.ErrorMessage(), nullptr);
+  EXPECT_FALSE(reader.has_keys());
+  ASSERT_EQ(reader.num_records(), 5000);
+
+  for (uint64_t i : {4999, 0, 1, 2500, 17, 18, 4000}) {
+    TestAllTypes message;
+    ASSERT_TRUE(reader.Read(i, &message));
+    EXPECT_EQ(message.optional_int32(), i);
+    EXPECT_EQ(message.optional_string().size(), i % 100);
+  }
+  TestAllTypes message;
+  EXPECT_FALSE(reader.Read(5000, &message));
+}
+
+TEST(RecordFileTest, ScanRange) {
+  const std::string data = WriteFile(5000, false, SmallBlocks());
+  RecordFileReader reader(data);
+  uint64_t expected = 1234;
+  EXPECT_TRUE(reader.Scan(1234, 3456,
+                          [&](uint64_t index, absl::string_view key,
+                              absl::string_view record) {
+                            EXPECT_EQ(index, expected++);
+                            EXPECT_TRUE(key.empty());
+                            TestAllTypes message;
+                            EXPECT_TRUE(message.ParseFromString(record));
+                            EXPECT_EQ(message.optional_int32(), index);
+                            return true;
+                          }));
+  EXPECT_EQ(expected, 3456);
+
+  // Stops when the callback returns false.
+  int calls = 0;
+  EXPECT_FALSE(reader.Scan(0, 5000, [&](uint64_t, absl::string_view,
+                                       absl::string_view) {
+    return ++calls < 10;
+  }));
+  EXPECT_EQ(calls, 10);
+}
+
+TEST(RecordFileTest, Keys) {
+  const std::string data = WriteFile(5000, true, SmallBlocks());
+  RecordFileReader reader(data);
+  ASSERT_EQ(reader.ErrorMessage(), nullptr);
+  EXPECT_TRUE(reader.has_keys());
+
+  EXPECT_EQ(reader.LowerBound(""), 0);
+  EXPECT_EQ(reader.LowerBound(Key(0)), 0);
+  EXPECT_EQ(reader.LowerBound(Key(1234)), 1234);
+  EXPECT_EQ(reader.LowerBound(Key(1234) + "a"), 1235);
+  EXPECT_EQ(reader.LowerBound(Key(4999)), 4999);
+  EXPECT_EQ(reader.LowerBound("z"), 5000);
+
+  absl::string_view record;
+  absl::string_view key;
+  ASSERT_TRUE(reader.ReadSerialized(42, &record, &key));
+  EXPECT_EQ(key, Key(42));
+
+  std::vector<uint64_t> indices;
+  EXPECT_TRUE(reader.Scan(reader.LowerBound(Key(100)),
+                          reader.LowerBound(Key(110)),
+                          [&](uint64_t index, absl::string_view key,
+                              absl::string_view) {
+                            EXPECT_EQ(key, Key(index));
+                            indices.push_back(index);
+                            return true;
+                          }));
+  EXPECT_EQ(indices.size(), 10);
+  EXPECT_EQ(indices.front(), 100);
+}
+
+TEST(RecordFileTest, WriterChecksKeys) {
+  std::string data;
+  io::StringOutputStream output(&data);
+  RecordFileWriter writer(&output);
+  EXPECT_TRUE(writer.WriteSerialized("b", ""));
+  EXPECT_TRUE(writer.WriteSerialized("b", ""));
+  EXPECT_FALSE(writer.WriteSerialized("a", ""));
+  EXPECT_NE(writer.ErrorMessage(), nullptr);
+  EXPECT_FALSE(writer.Close());
+}
+
+TEST(RecordFileTest, WriterRequiresKeysOnAllRecords) {
+  std::string data;
+  io::StringOutputStream output(&data);
+  RecordFileWriter writer(&output);
+  EXPECT_TRUE(writer.WriteSerialized(""));
+  EXPECT_FALSE(writer.WriteSerialized("a", ""));
+}
+
+TEST(RecordFileTest, EmptyFile) {
+  const std::string data = WriteFile(0, false, RecordFileWriter::Options());
+  RecordFileReader reader(data);
+  ASSERT_EQ(reader.ErrorMessage(), nullptr);
+  EXPECT_EQ(reader.num_records(), 0);
+  EXPECT_TRUE(reader.Scan(0, 10, [](uint64_t, absl::string_view,
+                                    absl::string_view) { return false; }));
+}
+
+TEST(RecordFileTest, CorruptFile) {
+  std::string data = WriteFile(100, false, SmallBlocks());
+  EXPECT_NE(RecordFileReader(absl::string_view(data).substr(1)).ErrorMessage(),
+            nullptr);
+  EXPECT_NE(RecordFileReader(absl::string_view(data).substr(
+                                 0, data.size() - 1))
+                .ErrorMessage(),
+            nullptr);
+  EXPECT_NE(RecordFileReader("").ErrorMessage(), nullptr);
+}
+
+#if HAVE_ZSTD
+TEST(RecordFileTest, Zstd) {
+  RecordFileWriter::Options options = SmallBlocks();
+  options.compression = RecordCompression::kZstd;
+  const std::string data = WriteFile(5000, true, options);
+  EXPECT_LT(data.size(), WriteFile(5000, true, SmallBlocks()).size());
+
+  RecordFileReader reader(data);
+  ASSERT_EQ(reader.ErrorMessage(), nullptr);
+  TestAllTypes message;
+  ASSERT_TRUE(reader.Read(3333, &message));
+  EXPECT_EQ(message.optional_int32(), 3333);
+  EXPECT_EQ(reader.LowerBound(Key(2000)), 2000);
+}
+
+TEST(RecordFileTest, ParallelScan) {
+  RecordFileWriter::Options writer_options = SmallBlocks();
+  writer_options.compression = RecordCompression::kZstd;
+  const std::string data = WriteFile(5000, false, writer_options);
+
+  std::vector<std::thread> threads;
+  RecordFileReader::Options options;
+  options.executor = [&threads](std::function<void()> task) {
+    threads.emplace_back(std::move(task));
+  };
+  options.max_parallel_blocks = 4;
+  {
+    RecordFileReader reader(data, options);
+    uint64_t expected = 10;
+    EXPECT_TRUE(reader.Scan(10, 4990,
+                            [&](uint64_t index, absl::string_view,
+                                absl::string_view record) {
+                              TestAllTypes message;
+                              EXPECT_TRUE(message.ParseFromString(record));
+                              EXPECT_EQ(message.optional_int32(), expected++);
+                              return true;
+                            }));
+    EXPECT_EQ(expected, 4990);
+
+    // Stopping early waits for the blocks decompressed ahead.
+    EXPECT_FALSE(reader.Scan(0, 5000, [](uint64_t, absl::string_view,
+                                         absl::string_view) { return false; }));
+  }
+  EXPECT_GT(threads.size(), 1);
+  for (std::thread& thread : threads) thread.join();
+}
+#endif  // HAVE_ZSTD
+
+#ifndef _WIN32
+TEST(RecordFileTest, MappedFile) {
+  const std::string data = WriteFile(1000, false, SmallBlocks());
+  FILE* file = tmpfile();
+  ASSERT_NE(file, nullptr);
+  ASSERT_EQ(fwrite(data.data(), 1, data.size(), file), data.size());
+  ASSERT_EQ(fflush(file), 0);
+
+  RecordFileReader reader(fileno(file));
+  fclose(file);
+  ASSERT_EQ(reader.ErrorMessage(), nullptr);
+  TestAllTypes message;
+  ASSERT_TRUE(reader.Read(999, &message));
+  EXPECT_EQ(message.optional_int32(), 999);
+}
+#endif  // !_WIN32
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
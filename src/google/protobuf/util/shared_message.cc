@@ -0,0 +1,100 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/shared_message.h"
+
+#include <memory>
+#include <utility>
+
+#include "absl/log/absl_check.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+void CheckMessageField(const Message& message, const FieldDescriptor* field) {
+  ABSL_CHECK_EQ(field->containing_type(), message.GetDescriptor())
+      << "Field " << field->full_name() << " does not belong to "
+      << message.GetTypeName() << ".";
+  ABSL_CHECK_EQ(field->cpp_type(), FieldDescriptor::CPPTYPE_MESSAGE)
+      << "Field " << field->full_name() << " is not a message field.";
+  ABSL_CHECK(!field->is_map())
+      << "Map field " << field->full_name() << " cannot be shared.";
+}
+
+}  // namespace
+
+void AttachSharedMessage(std::shared_ptr<const Message> shared,
+                         Message* message, const FieldDescriptor* field) {
+  CheckMessageField(*message, field);
+  ABSL_CHECK(shared != nullptr);
+  ABSL_CHECK_EQ(shared->GetDescriptor(), field->message_type())
+      << "Cannot attach a " << shared->GetTypeName() << " to field "
+      << field->full_name() << ".";
+  Arena* arena = message->GetArena();
+  ABSL_CHECK(arena != nullptr)
+      << "AttachSharedMessage() requires a message allocated on an arena.";
+
+  // The field is never written through, per the contract in the header, so it
+  // can point to the shared message. The arena neither deletes nor destroys
+  // messages it does not own, and keeps the reference until it is destroyed.
+  Message* sub_message = const_cast<Message*>(shared.get());
+  Arena::Create<std::shared_ptr<const Message>>(arena, std::move(shared));
+  const Reflection* reflection = message->GetReflection();
+  if (field->is_repeated()) {
+    reflection->UnsafeArenaAddAllocatedMessage(message, field, sub_message);
+  } else {
+    reflection->UnsafeArenaSetAllocatedMessage(message, sub_message, field);
+  }
+}
+
+Message* UnshareMessage(Message* message, const FieldDescriptor* field) {
+  CheckMessageField(*message, field);
+  ABSL_CHECK(!field->is_repeated());
+  const Reflection* reflection = message->GetReflection();
+  if (!reflection->HasField(*message, field)) return nullptr;
+  const Message& current = reflection->GetMessage(*message, field);
+  Message* copy = current.New(message->GetArena());
+  copy->CopyFrom(current);
+  // Without an arena this deletes the previous value, which therefore cannot
+  // have been shared.
+  reflection->UnsafeArenaSetAllocatedMessage(message, copy, field);
+  return copy;
+}
+
+Message* UnshareMessage(Message* message, const FieldDescriptor* field,
+                        int index) {
+  CheckMessageField(*message, field);
+  ABSL_CHECK(field->is_repeated());
+  const Reflection* reflection = message->GetReflection();
+  int size = reflection->FieldSize(*message, field);
+  ABSL_CHECK(index >= 0 && index < size);
+  const Message& current =
+      reflection->GetRepeatedMessage(*message, field, index);
+  Message* copy = current.New(message->GetArena());
+  copy->CopyFrom(current);
+  // Append the copy, move it into place, and drop the previous value without
+  // destroying it.
+  reflection->AddAllocatedMessage(message, field, copy);
+  reflection->SwapElements(message, field, index, size);
+  Message* previous = reflection->UnsafeArenaReleaseLast(message, field);
+  if (message->GetArena() == nullptr) delete previous;
+  return copy;
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,71 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Defines utilities for embedding one immutable message in many arena messages
+// without copying it.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_SHARED_MESSAGE_H__
+#define GOOGLE_PROTOBUF_UTIL_SHARED_MESSAGE_H__
+
+#include <memory>
+
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+// Makes the message field `field` of `*message` refer to `*shared` instead of
+// holding a copy of it. For singular fields, the field is set to `*shared`;
+// for repeated fields, `*shared` is appended. `message` must live on an arena,
+// which keeps a reference to `shared` until the arena is destroyed.
+//
+// Reads, ByteSizeLong() and serialization see the shared message in place, and
+// any number of messages, on any number of arenas, may share it. Serializing
+// those messages concurrently is safe.
+//
+// The shared message must never be mutated through `message`. That includes
+// mutable accessors of the field and mutating `message` as a whole in a way that
+// reaches the field, such as Clear(), MergeFrom() or CopyFrom() into
+// `message`, or parsing into it. Call UnshareMessage() first to give the field
+// a private copy. Copying `message` into another message copies the shared
+// message as usual.
+//
+// Example:
+//
+//   static const auto* entry = new std::shared_ptr<const CatalogEntry>(...);
+//   auto* response = Arena::CreateMessage<Response>(&arena);
+//   util::AttachSharedMessage(
+//       *entry, response,
+//       Response::descriptor()->FindFieldByName("catalog_entry"));
+PROTOBUF_EXPORT void AttachSharedMessage(std::shared_ptr<const Message> shared,
+                                         Message* message,
+                                         const FieldDescriptor* field);
+
+// Replaces the value of the singular message field `field` of `*message` with
+// a copy that `message` owns, and returns the copy. Use it before mutating a
+// field set with AttachSharedMessage(). Returns nullptr if the field is not
+// set; fields that are not shared are copied too.
+PROTOBUF_EXPORT Message* UnshareMessage(Message* message,
+                                        const FieldDescriptor* field);
+
+// As above, for element `index` of the repeated message field `field`.
+PROTOBUF_EXPORT Message* UnshareMessage(Message* message,
+                                        const FieldDescriptor* field,
+                                        int index);
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_SHARED_MESSAGE_H__
@@ -0,0 +1,137 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/shared_message.h"
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::NestedTestAllTypes;
+using ::protobuf_unittest::TestAllTypes;
+
+const FieldDescriptor* Field(absl::string_view name) {
+  return NestedTestAllTypes::descriptor()->FindFieldByName(name);
+}
+
+TEST(SharedMessageTest, AttachSingular) {
+  auto payload = std::make_shared<TestAllTypes>();
+  TestUtil::SetAllFields(payload.get());
+  NestedTestAllTypes expected;
+  *expected.mutable_payload() = *payload;
+  {
+    Arena arena;
+    auto* first = Arena::CreateMessage<NestedTestAllTypes>(&arena);
+    auto* second = Arena::CreateMessage<NestedTestAllTypes>(&arena);
+    AttachSharedMessage(payload, first, Field("payload"));
+    AttachSharedMessage(payload, second, Field("payload"));
+    EXPECT_EQ(payload.use_count(), 3);
+
+    EXPECT_EQ(&first->payload(), payload.get());
+    EXPECT_EQ(&second->payload(), payload.get());
+    EXPECT_TRUE(first->has_payload());
+    EXPECT_EQ(first->ByteSizeLong(), expected.ByteSizeLong());
+    EXPECT_EQ(first->SerializeAsString(), expected.SerializeAsString());
+    EXPECT_EQ(second->SerializeAsString(), expected.SerializeAsString());
+
+    // Copies of the message hold their own payload.
+    NestedTestAllTypes copy(*first);
+    EXPECT_NE(&copy.payload(), payload.get());
+    TestUtil::ExpectAllFieldsSet(copy.payload());
+  }
+  // The arena dropped its references.
+  EXPECT_EQ(payload.use_count(), 1);
+  TestUtil::ExpectAllFieldsSet(*payload);
+}
+
+TEST(SharedMessageTest, AttachRepeated) {
+  auto child = std::make_shared<NestedTestAllTypes>();
+  child->mutable_payload()->set_optional_int32(5);
+  Arena arena;
+  auto* message = Arena::CreateMessage<NestedTestAllTypes>(&arena);
+  message->add_repeated_child()->mutable_payload()->set_optional_int32(1);
+  AttachSharedMessage(child, message, Field("repeated_child"));
+  AttachSharedMessage(child, message, Field("repeated_child"));
+
+  ASSERT_EQ(message->repeated_child_size(), 3);
+  EXPECT_EQ(&message->repeated_child(1), child.get());
+  EXPECT_EQ(&message->repeated_child(2), child.get());
+  NestedTestAllTypes expected;
+  expected.add_repeated_child()->mutable_payload()->set_optional_int32(1);
+  *expected.add_repeated_child() = *child;
+  *expected.add_repeated_child() = *child;
+  EXPECT_EQ(message->SerializeAsString(), expected.SerializeAsString());
+}
+
+TEST(SharedMessageTest, UnshareSingular) {
+  auto payload = std::make_shared<TestAllTypes>();
+  payload->set_optional_int32(1);
+  Arena arena;
+  auto* message = Arena::CreateMessage<NestedTestAllTypes>(&arena);
+  EXPECT_EQ(UnshareMessage(message, Field("payload")), nullptr);
+
+  AttachSharedMessage(payload, message, Field("payload"));
+  Message* copy = UnshareMessage(message, Field("payload"));
+  ASSERT_NE(copy, nullptr);
+  EXPECT_EQ(copy, &message->payload());
+  EXPECT_EQ(copy->GetArena(), &arena);
+  message->mutable_payload()->set_optional_int32(2);
+  message->Clear();
+  EXPECT_EQ(payload->optional_int32(), 1);
+
+  // Heap messages can be unshared too; their fields are never shared.
+  NestedTestAllTypes heap;
+  heap.mutable_payload()->set_optional_int32(3);
+  copy = UnshareMessage(&heap, Field("payload"));
+  EXPECT_EQ(copy, &heap.payload());
+  EXPECT_EQ(heap.payload().optional_int32(), 3);
+}
+
+TEST(SharedMessageTest, UnshareRepeated) {
+  auto child = std::make_shared<NestedTestAllTypes>();
+  child->mutable_payload()->set_optional_int32(5);
+  Arena arena;
+  auto* message = Arena::CreateMessage<NestedTestAllTypes>(&arena);
+  AttachSharedMessage(child, message, Field("repeated_child"));
+  message->add_repeated_child()->mutable_payload()->set_optional_int32(6);
+  AttachSharedMessage(child, message, Field("repeated_child"));
+
+  Message* copy = UnshareMessage(message, Field("repeated_child"), 0);
+  ASSERT_EQ(message->repeated_child_size(), 3);
+  EXPECT_EQ(copy, &message->repeated_child(0));
+  EXPECT_EQ(message->repeated_child(1).payload().optional_int32(), 6);
+  EXPECT_EQ(&message->repeated_child(2), child.get());
+  message->mutable_repeated_child(0)->mutable_payload()->set_optional_int32(7);
+  EXPECT_EQ(child->payload().optional_int32(), 5);
+
+  UnshareMessage(message, Field("repeated_child"), 2);
+  message->Clear();
+  EXPECT_EQ(child->payload().optional_int32(), 5);
+
+  NestedTestAllTypes heap;
+  heap.add_repeated_child()->mutable_payload()->set_optional_int32(8);
+  heap.add_repeated_child();
+  copy = UnshareMessage(&heap, Field("repeated_child"), 0);
+  ASSERT_EQ(heap.repeated_child_size(), 2);
+  EXPECT_EQ(copy, &heap.repeated_child(0));
+  EXPECT_EQ(heap.repeated_child(0).payload().optional_int32(), 8);
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -9,6 +9,7 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <string>
 
 #include "google/protobuf/duration.pb.h"
 #include "google/protobuf/timestamp.pb.h"
@@ -39,6 +40,7 @@ static constexpr int32_t kNanosPerMicrosecond = 1000;
 static constexpr int32_t kSecondsPerMinute =
     60;  // Note that we ignore leap seconds.
 static constexpr int32_t kSecondsPerHour = 3600;
+static constexpr int32_t kSecondsPerDay = 86400;
 
 template <typename T>
 T CreateNormalized(int64_t seconds, int32_t nanos);
@@ -114,7 +116,59 @@ std::string FormatNanos(int32_t nanos) {
   }
 }
 
-std::string FormatTime(int64_t seconds, int32_t nanos) {
+// Converts a count of days since 1970-01-01 to a date in the proleptic
+// Gregorian calendar, and back. See
+// https://howardhinnant.github.io/date_algorithms.html
+void CivilFromDays(int64_t days, int* year, int* month, int* day) {
+  days += 719468;
+  const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  const int64_t day_of_era = days - era * 146097;
+  const int64_t year_of_era =
+      (day_of_era - day_of_era / 1460 + day_of_era / 36524 -
+       day_of_era / 146096) /
+      365;
+  const int64_t day_of_year =
+      day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  const int64_t shifted_month = (5 * day_of_year + 2) / 153;
+  *day = static_cast<int>(day_of_year - (153 * shifted_month + 2) / 5 + 1);
+  *month = static_cast<int>(shifted_month < 10 ? shifted_month + 3
+                                                : shifted_month - 9);
+  *year = static_cast<int>(year_of_era + era * 400 + (*month <= 2 ? 1 : 0));
+}
+
+int64_t DaysFromCivil(int year, int month, int day) {
+  const int64_t shifted_year = year - (month <= 2 ? 1 : 0);
+  const int64_t era =
+      (shifted_year >= 0 ? shifted_year : shifted_year - 399) / 400;
+  const int64_t year_of_era = shifted_year - era * 400;
+  const int64_t day_of_year =
+      (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  const int64_t day_of_era =
+      year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+  return era * 146097 + day_of_era - 719468;
+}
+
+int DaysInMonth(int year, int month) {
+  static constexpr int kDaysInMonth[] = {31, 28, 31, 30, 31, 30,
+                                         31, 31, 30, 31, 30, 31};
+  if (month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)) {
+    return 29;
+  }
+  return kDaysInMonth[month - 1];
+}
+
+// Writes `value` as exactly `width` decimal digits.
+char* WriteDigits(uint32_t value, int width, char* out) {
+  for (int i = width - 1; i >= 0; --i) {
+    out[i] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  }
+  return out + width;
+}
+
+// Formats the seconds part with absl::FormatTime. Only used for values outside
+// of the valid Timestamp range, whose output the fast path below can't match.
+void FormatTimeSlow(int64_t seconds, int32_t nanos, std::string* output) {
   static constexpr absl::string_view kTimestampFormat = "%E4Y-%m-%dT%H:%M:%S";
 
   timespec spec;
@@ -122,18 +176,145 @@ std::string FormatTime(int64_t seconds, int32_t nanos) {
   // We only use absl::FormatTime to format the seconds part because we need
   // finer control over the precision of nanoseconds.
   spec.tv_nsec = 0;
-  std::string result = absl::FormatTime(
-      kTimestampFormat, absl::TimeFromTimespec(spec), absl::UTCTimeZone());
+  *output = absl::FormatTime(kTimestampFormat, absl::TimeFromTimespec(spec),
+                             absl::UTCTimeZone());
   // We format the nanoseconds part separately to meet the precision
   // requirement.
   if (nanos != 0) {
-    absl::StrAppend(&result, ".", FormatNanos(nanos));
+    absl::StrAppend(output, ".", FormatNanos(nanos));
+  }
+  absl::StrAppend(output, "Z");
+}
+
+// Formats a Timestamp as "YYYY-MM-DDTHH:MM:SS[.fraction]Z" into `output`,
+// reusing its storage.
+void FormatTime(int64_t seconds, int32_t nanos, std::string* output) {
+  if (seconds < TimeUtil::kTimestampMinSeconds ||
+      seconds > TimeUtil::kTimestampMaxSeconds || nanos < 0 ||
+      nanos >= kNanosPerSecond) {
+    FormatTimeSlow(seconds, nanos, output);
+    return;
   }
-  absl::StrAppend(&result, "Z");
+
+  // Floor division, so that times before the epoch land on the right day.
+  int64_t days = seconds / kSecondsPerDay;
+  int64_t seconds_of_day = seconds % kSecondsPerDay;
+  if (seconds_of_day < 0) {
+    --days;
+    seconds_of_day += kSecondsPerDay;
+  }
+  int year, month, day;
+  CivilFromDays(days, &year, &month, &day);
+
+  // "YYYY-MM-DDTHH:MM:SS.nnnnnnnnnZ"
+  char buffer[30];
+  char* p = WriteDigits(year, 4, buffer);
+  *p++ = '-';
+  p = WriteDigits(month, 2, p);
+  *p++ = '-';
+  p = WriteDigits(day, 2, p);
+  *p++ = 'T';
+  p = WriteDigits(seconds_of_day / kSecondsPerHour, 2, p);
+  *p++ = ':';
+  p = WriteDigits(seconds_of_day % kSecondsPerHour / kSecondsPerMinute, 2, p);
+  *p++ = ':';
+  p = WriteDigits(seconds_of_day % kSecondsPerMinute, 2, p);
+  // Use 3, 6, or 9 fractional digits as FormatNanos() does.
+  if (nanos != 0) {
+    *p++ = '.';
+    if (nanos % kNanosPerMillisecond == 0) {
+      p = WriteDigits(nanos / kNanosPerMillisecond, 3, p);
+    } else if (nanos % kNanosPerMicrosecond == 0) {
+      p = WriteDigits(nanos / kNanosPerMicrosecond, 6, p);
+    } else {
+      p = WriteDigits(nanos, 9, p);
+    }
+  }
+  *p++ = 'Z';
+  output->assign(buffer, p - buffer);
+}
+
+std::string FormatTime(int64_t seconds, int32_t nanos) {
+  std::string result;
+  FormatTime(seconds, nanos, &result);
   return result;
 }
 
+// Reads exactly `width` decimal digits starting at `p`.
+bool ReadDigits(const char* p, int width, int* value) {
+  int result = 0;
+  for (int i = 0; i < width; ++i) {
+    if (p[i] < '0' || p[i] > '9') return false;
+    result = result * 10 + (p[i] - '0');
+  }
+  *value = result;
+  return true;
+}
+
+// Parses the common "YYYY-MM-DDTHH:MM:SS[.fraction](Z|+HH:MM|-HH:MM)" form of
+// RFC 3339 without going through absl::ParseTime. Returns false for anything
+// else, including unusual input that absl::ParseTime may still accept (such
+// as lowercase separators, leap seconds or more than 9 fractional digits).
+bool ParseTimeFast(absl::string_view value, int64_t* seconds, int32_t* nanos) {
+  // "YYYY-MM-DDTHH:MM:SS" followed by at least "Z".
+  if (value.size() < 20) return false;
+  const char* p = value.data();
+  const char* end = p + value.size();
+  int year, month, day, hour, minute, second;
+  if (!ReadDigits(p, 4, &year) || p[4] != '-' ||
+      !ReadDigits(p + 5, 2, &month) || p[7] != '-' ||
+      !ReadDigits(p + 8, 2, &day) || p[10] != 'T' ||
+      !ReadDigits(p + 11, 2, &hour) || p[13] != ':' ||
+      !ReadDigits(p + 14, 2, &minute) || p[16] != ':' ||
+      !ReadDigits(p + 17, 2, &second)) {
+    return false;
+  }
+  if (month < 1 || month > 12 || day < 1 || day > DaysInMonth(year, month) ||
+      hour > 23 || minute > 59 || second > 59) {
+    return false;
+  }
+  p += 19;
+
+  int32_t fraction = 0;
+  if (*p == '.') {
+    ++p;
+    int digits = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+      if (++digits > 9) return false;
+      fraction = fraction * 10 + (*p++ - '0');
+    }
+    if (digits == 0) return false;
+    for (; digits < 9; ++digits) fraction *= 10;
+  }
+
+  int64_t offset = 0;
+  if (end - p == 1 && *p == 'Z') {
+    // UTC.
+  } else if (end - p == 6 && (*p == '+' || *p == '-') && p[3] == ':') {
+    int offset_hours, offset_minutes;
+    if (!ReadDigits(p + 1, 2, &offset_hours) ||
+        !ReadDigits(p + 4, 2, &offset_minutes) || offset_hours > 23 ||
+        offset_minutes > 59) {
+      return false;
+    }
+    offset =
+        offset_hours * kSecondsPerHour + offset_minutes * kSecondsPerMinute;
+    if (*p == '-') offset = -offset;
+  } else {
+    return false;
+  }
+
+  *seconds = DaysFromCivil(year, month, day) * kSecondsPerDay +
+             hour * kSecondsPerHour + minute * kSecondsPerMinute + second -
+             offset;
+  *nanos = fraction;
+  return true;
+}
+
 bool ParseTime(absl::string_view value, int64_t* seconds, int32_t* nanos) {
+  if (ParseTimeFast(value, seconds, nanos)) {
+    return true;
+  }
   absl::Time result;
   if (!absl::ParseTime(absl::RFC3339_full, value, &result, nullptr)) {
     return false;
@@ -195,6 +376,32 @@ bool TimeUtil::FromString(absl::string_view value, Timestamp* timestamp) {
   return true;
 }
 
+void TimeUtil::ToString(const RepeatedPtrField<Timestamp>& timestamps,
+                        RepeatedPtrField<std::string>* values) {
+  values->Clear();
+  values->Reserve(timestamps.size());
+  for (const Timestamp& timestamp : timestamps) {
+    // Add() reuses the strings left over by Clear(), along with their
+    // capacity.
+    FormatTime(timestamp.seconds(), timestamp.nanos(), values->Add());
+  }
+}
+
+bool TimeUtil::FromString(const RepeatedPtrField<std::string>& values,
+                          RepeatedPtrField<Timestamp>* timestamps) {
+  timestamps->Clear();
+  timestamps->Reserve(values.size());
+  for (const std::string& value : values) {
+    int64_t seconds;
+    int32_t nanos;
+    if (!ParseTime(value, &seconds, &nanos)) {
+      return false;
+    }
+    *timestamps->Add() = CreateNormalized<Timestamp>(seconds, nanos);
+  }
+  return true;
+}
+
 Timestamp TimeUtil::GetCurrentTime() {
   int64_t seconds;
   int32_t nanos;
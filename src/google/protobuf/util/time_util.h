@@ -28,6 +28,7 @@ struct timeval {
 #endif
 
 #include "google/protobuf/duration.pb.h"
+#include "google/protobuf/repeated_ptr_field.h"
 #include "google/protobuf/timestamp.pb.h"
 
 // Must be included last.
@@ -90,6 +91,16 @@ class PROTOBUF_EXPORT TimeUtil {
   static std::string ToString(const Timestamp& timestamp);
   static bool FromString(absl::string_view value, Timestamp* timestamp);
 
+  // Converts many Timestamps at once, in the same format as above. The output
+  // field is cleared first, and its elements are reused, so converting batches
+  // into the same field repeatedly does not allocate once it has grown large
+  // enough. FromString() returns false if any value fails to parse, leaving
+  // `timestamps` with the values that precede it.
+  static void ToString(const RepeatedPtrField<Timestamp>& timestamps,
+                       RepeatedPtrField<std::string>* values);
+  static bool FromString(const RepeatedPtrField<std::string>& values,
+                         RepeatedPtrField<Timestamp>* timestamps);
+
   // Converts Duration to/from string format. The string format will contains
   // 3, 6, or 9 fractional digits depending on the precision required to
   // represent the exact Duration value. For example:
@@ -9,6 +9,7 @@
 
 #include <cstdint>
 #include <ctime>
+#include <string>
 
 #include "google/protobuf/duration.pb.h"
 #include "google/protobuf/timestamp.pb.h"
@@ -69,6 +70,62 @@ TEST(TimeUtilTest, TimestampStringFormat) {
   EXPECT_EQ(8 * 3600, TimeUtil::TimestampToSeconds(time));
 }
 
+TEST(TimeUtilTest, TimestampStringRoundTrip) {
+  // Covers leap years, century boundaries and dates before the epoch.
+  const char* kValues[] = {
+      "0001-01-01T00:00:00Z",        "0004-02-29T12:34:56.789Z",
+      "1600-02-29T23:59:59Z",        "1899-12-31T23:59:59.000001Z",
+      "1900-03-01T00:00:00Z",        "1969-12-31T00:00:01.000000001Z",
+      "2000-02-29T08:00:00Z",        "2023-11-14T22:13:20.123456Z",
+      "2100-02-28T23:59:59.999Z",    "9999-12-31T23:59:59.999999999Z",
+  };
+  for (const char* value : kValues) {
+    Timestamp time;
+    ASSERT_TRUE(TimeUtil::FromString(value, &time)) << value;
+    EXPECT_EQ(value, TimeUtil::ToString(time));
+  }
+
+  Timestamp time;
+  EXPECT_TRUE(TimeUtil::FromString("2023-11-14T22:13:20Z", &time));
+  EXPECT_EQ(1700000000, time.seconds());
+  EXPECT_TRUE(TimeUtil::FromString("2023-11-15T00:43:20.5+02:30", &time));
+  EXPECT_EQ(1700000000, time.seconds());
+  EXPECT_EQ(500000000, time.nanos());
+  EXPECT_TRUE(TimeUtil::FromString("2023-11-14T20:13:20-02:00", &time));
+  EXPECT_EQ(1700000000, time.seconds());
+
+  EXPECT_FALSE(TimeUtil::FromString("2023-13-01T00:00:00Z", &time));
+  EXPECT_FALSE(TimeUtil::FromString("2023-01-01T00:00:00", &time));
+  EXPECT_FALSE(TimeUtil::FromString("2023-01-01 00:00:00Z", &time));
+  EXPECT_FALSE(TimeUtil::FromString("2023-01-01T00:00:00Zjunk", &time));
+}
+
+TEST(TimeUtilTest, TimestampStringBatch) {
+  RepeatedPtrField<Timestamp> timestamps;
+  for (int i = 0; i < 10; ++i) {
+    *timestamps.Add() = TimeUtil::MillisecondsToTimestamp(i * 1001 - 5000);
+  }
+  RepeatedPtrField<std::string> values;
+  values.Add()->assign("left over");
+  TimeUtil::ToString(timestamps, &values);
+  ASSERT_EQ(timestamps.size(), values.size());
+  for (int i = 0; i < timestamps.size(); ++i) {
+    EXPECT_EQ(TimeUtil::ToString(timestamps.Get(i)), values.Get(i));
+  }
+
+  RepeatedPtrField<Timestamp> parsed;
+  parsed.Add()->set_seconds(123);
+  EXPECT_TRUE(TimeUtil::FromString(values, &parsed));
+  ASSERT_EQ(timestamps.size(), parsed.size());
+  for (int i = 0; i < timestamps.size(); ++i) {
+    EXPECT_EQ(timestamps.Get(i), parsed.Get(i));
+  }
+
+  values.Mutable(3)->assign("not a timestamp");
+  EXPECT_FALSE(TimeUtil::FromString(values, &parsed));
+  EXPECT_EQ(3, parsed.size());
+}
+
 TEST(TimeUtilTest, DurationStringFormat) {
   Timestamp begin, end;
   EXPECT_TRUE(TimeUtil::FromString("0001-01-01T00:00:00Z", &begin));
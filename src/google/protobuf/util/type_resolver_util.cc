@@ -7,19 +7,26 @@
 
 #include "google/protobuf/util/type_resolver_util.h"
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "google/protobuf/source_context.pb.h"
 #include "google/protobuf/type.pb.h"
 #include "google/protobuf/wrappers.pb.h"
 #include "google/protobuf/descriptor.pb.h"
+#include "absl/hash/hash.h"
 #include "absl/log/absl_log.h"
 #include "absl/status/status.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/descriptor_legacy.h"
 #include "google/protobuf/io/strtod.h"
 #include "google/protobuf/util/type_resolver.h"
@@ -355,11 +362,147 @@ class DescriptorPoolTypeResolver : public TypeResolver {
 
 }  // namespace
 
+// An insert-only hash table from type URL to resolved type. Lookups only load
+// atomics, while insertions are serialized by CachingTypeResolver::mutex_.
+// Entries and outgrown tables are never freed before the cache itself, so a
+// reader may keep using whatever it has loaded.
+template <typename T>
+class CachingTypeResolver::Cache {
+ public:
+  // Returns the cached value for `key`, or nullptr.
+  const T* Find(absl::string_view key) const {
+    const Table* table = table_.load(std::memory_order_acquire);
+    if (table == nullptr) return nullptr;
+    for (size_t i = absl::HashOf(key) & table->mask;;
+         i = (i + 1) & table->mask) {
+      const Entry* entry = table->slots[i].load(std::memory_order_acquire);
+      if (entry == nullptr) return nullptr;
+      if (entry->key == key) return &entry->value;
+    }
+  }
+
+  // Adds `value` for `key`, unless `key` is cached already.
+  void Insert(absl::string_view key, const T& value) {
+    if (Find(key) != nullptr) return;
+    if (current_ == nullptr || (live_.size() + 1) * 2 > current_->mask + 1) {
+      // Keep the table at most half full. Readers go on using the old table
+      // until the new one, with all live entries in it, is published.
+      tables_.push_back(std::make_unique<Table>(
+          current_ == nullptr ? 16 : 2 * (current_->mask + 1)));
+      current_ = tables_.back().get();
+      for (const Entry* entry : live_) {
+        Place(current_, entry);
+      }
+      table_.store(current_, std::memory_order_release);
+    }
+    entries_.push_back(
+        std::make_unique<Entry>(Entry{std::string(key), value}));
+    live_.push_back(entries_.back().get());
+    Place(current_, live_.back());
+  }
+
+  void Clear() {
+    current_ = nullptr;
+    live_.clear();
+    table_.store(nullptr, std::memory_order_release);
+  }
+
+ private:
+  struct Entry {
+    std::string key;
+    T value;
+  };
+
+  struct Table {
+    explicit Table(size_t capacity) : mask(capacity - 1), slots(capacity) {}
+
+    const size_t mask;
+    std::vector<std::atomic<const Entry*>> slots;
+  };
+
+  static void Place(Table* table, const Entry* entry) {
+    size_t i = absl::HashOf(absl::string_view(entry->key)) & table->mask;
+    while (table->slots[i].load(std::memory_order_relaxed) != nullptr) {
+      i = (i + 1) & table->mask;
+    }
+    // Publishes the entry's contents along with the pointer.
+    table->slots[i].store(entry, std::memory_order_release);
+  }
+
+  std::atomic<const Table*> table_{nullptr};
+  // Everything below is guarded by CachingTypeResolver::mutex_.
+  Table* current_ = nullptr;
+  std::vector<std::unique_ptr<Table>> tables_;
+  std::vector<std::unique_ptr<Entry>> entries_;
+  // The entries added since the last Clear().
+  std::vector<const Entry*> live_;
+};
+
+CachingTypeResolver::CachingTypeResolver(
+    std::unique_ptr<TypeResolver> resolver)
+    : resolver_(std::move(resolver)),
+      message_types_(std::make_unique<Cache<Type>>()),
+      enum_types_(std::make_unique<Cache<Enum>>()) {}
+
+CachingTypeResolver::~CachingTypeResolver() = default;
+
+template <typename T>
+absl::Status CachingTypeResolver::Resolve(
+    const std::string& type_url, Cache<T>* cache,
+    absl::Status (TypeResolver::*resolve)(const std::string&, T*), T* result) {
+  if (const T* cached = cache->Find(type_url)) {
+    *result = *cached;
+    return absl::Status();
+  }
+
+  uint64_t generation;
+  {
+    absl::MutexLock lock(&mutex_);
+    generation = generation_;
+  }
+  // Resolve without holding the lock, so that slow resolutions do not hold up
+  // others. Two threads may then resolve the same type, which is harmless.
+  absl::Status status = (resolver_.get()->*resolve)(type_url, result);
+  if (!status.ok()) {
+    return status;
+  }
+  absl::MutexLock lock(&mutex_);
+  if (generation == generation_) {
+    cache->Insert(type_url, *result);
+  }
+  return status;
+}
+
+absl::Status CachingTypeResolver::ResolveMessageType(
+    const std::string& type_url, Type* message_type) {
+  return Resolve(type_url, message_types_.get(), &TypeResolver::ResolveMessageType,
+                 message_type);
+}
+
+absl::Status CachingTypeResolver::ResolveEnumType(const std::string& type_url,
+                                                  Enum* enum_type) {
+  return Resolve(type_url, enum_types_.get(), &TypeResolver::ResolveEnumType,
+                 enum_type);
+}
+
+void CachingTypeResolver::Invalidate() {
+  absl::MutexLock lock(&mutex_);
+  ++generation_;
+  message_types_->Clear();
+  enum_types_->Clear();
+}
+
 TypeResolver* NewTypeResolverForDescriptorPool(absl::string_view url_prefix,
                                                const DescriptorPool* pool) {
   return new DescriptorPoolTypeResolver(url_prefix, pool);
 }
 
+CachingTypeResolver* NewCachingTypeResolverForDescriptorPool(
+    absl::string_view url_prefix, const DescriptorPool* pool) {
+  return new CachingTypeResolver(
+      std::make_unique<DescriptorPoolTypeResolver>(url_prefix, pool));
+}
+
 // Performs a direct conversion from a descriptor to a type proto.
 Type ConvertDescriptorToType(absl::string_view url_prefix,
                              const Descriptor& descriptor) {
@@ -10,9 +10,17 @@
 #ifndef GOOGLE_PROTOBUF_UTIL_TYPE_RESOLVER_UTIL_H__
 #define GOOGLE_PROTOBUF_UTIL_TYPE_RESOLVER_UTIL_H__
 
+#include <cstdint>
+#include <memory>
+#include <string>
+
 #include "google/protobuf/type.pb.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/descriptor.h"
+#include "google/protobuf/util/type_resolver.h"
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
@@ -21,13 +29,58 @@ namespace google {
 namespace protobuf {
 class DescriptorPool;
 namespace util {
-class TypeResolver;
 
 // Creates a TypeResolver that serves type information in the given descriptor
 // pool. Caller takes ownership of the returned TypeResolver.
 PROTOBUF_EXPORT TypeResolver* NewTypeResolverForDescriptorPool(
     absl::string_view url_prefix, const DescriptorPool* pool);
 
+// A TypeResolver that remembers the types resolved by another TypeResolver, so
+// that each type URL is converted only once. Resolving a cached type copies it
+// out of a lock-free table and never blocks, which suits callers that resolve
+// the same few types on every request, such as JSON transcoding.
+//
+// Only successful resolutions are cached, so types added to a dynamic pool
+// later on are still found. If a type that was already resolved may have
+// changed, call Invalidate(). Invalidated types are kept in memory until the
+// resolver is destroyed, because concurrent readers may still be using them.
+class PROTOBUF_EXPORT CachingTypeResolver : public TypeResolver {
+ public:
+  explicit CachingTypeResolver(std::unique_ptr<TypeResolver> resolver);
+  ~CachingTypeResolver() override;
+
+  absl::Status ResolveMessageType(
+      const std::string& type_url,
+      google::protobuf::Type* message_type) override;
+  absl::Status ResolveEnumType(const std::string& type_url,
+                               google::protobuf::Enum* enum_type) override;
+
+  // Forgets all cached types, so that they are resolved again on next use.
+  void Invalidate();
+
+ private:
+  template <typename T>
+  class Cache;
+
+  template <typename T>
+  absl::Status Resolve(
+      const std::string& type_url, Cache<T>* cache,
+      absl::Status (TypeResolver::*resolve)(const std::string&, T*),
+      T* result);
+
+  const std::unique_ptr<TypeResolver> resolver_;
+  absl::Mutex mutex_;
+  // Bumped by Invalidate(), so that types resolved before are not cached.
+  uint64_t generation_ ABSL_GUARDED_BY(mutex_) = 0;
+  const std::unique_ptr<Cache<google::protobuf::Type>> message_types_;
+  const std::unique_ptr<Cache<google::protobuf::Enum>> enum_types_;
+};
+
+// Creates a CachingTypeResolver that serves type information in the given
+// descriptor pool. Caller takes ownership of the returned TypeResolver.
+PROTOBUF_EXPORT CachingTypeResolver* NewCachingTypeResolverForDescriptorPool(
+    absl::string_view url_prefix, const DescriptorPool* pool);
+
 // Performs a direct conversion from a descriptor to a type proto.
 PROTOBUF_EXPORT google::protobuf::Type ConvertDescriptorToType(
     absl::string_view url_prefix, const Descriptor& descriptor);
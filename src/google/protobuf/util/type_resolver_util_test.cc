@@ -11,6 +11,7 @@
 #include <limits>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "google/protobuf/any.pb.h"
@@ -468,6 +469,130 @@ TEST_F(DescriptorPoolTypeResolverSyntaxTest, SyntaxProto3) {
 }
 
 
+// Counts the calls into the resolver being cached.
+class CountingTypeResolver : public TypeResolver {
+ public:
+  CountingTypeResolver(TypeResolver* resolver, int* calls)
+      : resolver_(resolver), calls_(calls) {}
+
+  absl::Status ResolveMessageType(const std::string& type_url,
+                                  Type* message_type) override {
+    ++*calls_;
+    return resolver_->ResolveMessageType(type_url, message_type);
+  }
+
+  absl::Status ResolveEnumType(const std::string& type_url,
+                               Enum* enum_type) override {
+    ++*calls_;
+    return resolver_->ResolveEnumType(type_url, enum_type);
+  }
+
+ private:
+  TypeResolver* resolver_;
+  int* calls_;
+};
+
+class CachingTypeResolverTest : public testing::Test {
+ protected:
+  CachingTypeResolverTest()
+      : pool_resolver_(NewTypeResolverForDescriptorPool(
+            kUrlPrefix, DescriptorPool::generated_pool())),
+        resolver_(std::make_unique<CountingTypeResolver>(pool_resolver_.get(),
+                                                         &calls_)) {}
+
+  int calls_ = 0;
+  std::unique_ptr<TypeResolver> pool_resolver_;
+  CachingTypeResolver resolver_;
+};
+
+TEST_F(CachingTypeResolverTest, ResolvesEachTypeOnce) {
+  const std::string url = GetTypeUrl<protobuf_unittest::TestAllTypes>();
+  Type expected;
+  ASSERT_TRUE(pool_resolver_->ResolveMessageType(url, &expected).ok());
+  for (int i = 0; i < 3; ++i) {
+    Type type;
+    ASSERT_TRUE(resolver_.ResolveMessageType(url, &type).ok());
+    EXPECT_EQ(expected.SerializeAsString(), type.SerializeAsString());
+  }
+  EXPECT_EQ(1, calls_);
+
+  const std::string enum_url =
+      GetTypeUrl("protobuf_unittest.TestAllTypes.NestedEnum");
+  Enum expected_enum;
+  ASSERT_TRUE(pool_resolver_->ResolveEnumType(enum_url, &expected_enum).ok());
+  for (int i = 0; i < 3; ++i) {
+    Enum enum_type;
+    ASSERT_TRUE(resolver_.ResolveEnumType(enum_url, &enum_type).ok());
+    EXPECT_EQ(expected_enum.SerializeAsString(), enum_type.SerializeAsString());
+  }
+  EXPECT_EQ(2, calls_);
+}
+
+TEST_F(CachingTypeResolverTest, ManyTypes) {
+  // Enough types to grow the cache a few times.
+  const FileDescriptor* file =
+      protobuf_unittest::TestAllTypes::descriptor()->file();
+  for (int round = 0; round < 2; ++round) {
+    for (int i = 0; i < file->message_type_count(); ++i) {
+      Type type;
+      ASSERT_TRUE(resolver_
+                      .ResolveMessageType(
+                          GetTypeUrl(file->message_type(i)->full_name()), &type)
+                      .ok());
+      EXPECT_EQ(file->message_type(i)->full_name(), type.name());
+    }
+  }
+  EXPECT_EQ(file->message_type_count(), calls_);
+}
+
+TEST_F(CachingTypeResolverTest, ErrorsAreNotCached) {
+  Type type;
+  EXPECT_FALSE(
+      resolver_.ResolveMessageType(GetTypeUrl("not.AType"), &type).ok());
+  EXPECT_FALSE(
+      resolver_.ResolveMessageType(GetTypeUrl("not.AType"), &type).ok());
+  EXPECT_EQ(2, calls_);
+}
+
+TEST_F(CachingTypeResolverTest, Invalidate) {
+  const std::string url = GetTypeUrl<protobuf_unittest::TestAllTypes>();
+  Type type;
+  ASSERT_TRUE(resolver_.ResolveMessageType(url, &type).ok());
+  ASSERT_TRUE(resolver_.ResolveMessageType(url, &type).ok());
+  EXPECT_EQ(1, calls_);
+  resolver_.Invalidate();
+  ASSERT_TRUE(resolver_.ResolveMessageType(url, &type).ok());
+  ASSERT_TRUE(resolver_.ResolveMessageType(url, &type).ok());
+  EXPECT_EQ(2, calls_);
+  EXPECT_EQ("protobuf_unittest.TestAllTypes", type.name());
+}
+
+TEST(CachingTypeResolverThreadTest, ConcurrentResolution) {
+  std::unique_ptr<CachingTypeResolver> resolver(
+      NewCachingTypeResolverForDescriptorPool(
+          kUrlPrefix, DescriptorPool::generated_pool()));
+  const FileDescriptor* file =
+      protobuf_unittest::TestAllTypes::descriptor()->file();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < file->message_type_count(); ++i) {
+          Type type;
+          const std::string& name = file->message_type(i)->full_name();
+          EXPECT_TRUE(
+              resolver->ResolveMessageType(GetTypeUrl(name), &type).ok());
+          EXPECT_EQ(name, type.name());
+        }
+      }
+    });
+  }
+  resolver->Invalidate();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
 TEST(ConvertDescriptorToTypeTest, TestAllTypes) {
   Type type = ConvertDescriptorToType(
       kUrlPrefix, *protobuf_unittest::TestAllTypes::GetDescriptor());
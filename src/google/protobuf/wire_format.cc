@@ -11,8 +11,12 @@
 
 #include "google/protobuf/wire_format.h"
 
+#include <algorithm>
+#include <climits>
+#include <cstring>
 #include <stack>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/log/absl_check.h"
@@ -170,9 +174,8 @@ bool WireFormat::ReadPackedEnumPreserveUnknowns(io::CodedInputStream* input,
 uint8_t* WireFormat::InternalSerializeUnknownFieldsToArray(
     const UnknownFieldSet& unknown_fields, uint8_t* target,
     io::EpsCopyOutputStream* stream) {
-  for (int i = 0; i < unknown_fields.field_count(); i++) {
-    const UnknownField& field = unknown_fields.field(i);
-
+  // Fields still held as raw bytes are copied without parsing them.
+  for (const UnknownField& field : unknown_fields.fields_) {
     target = stream->EnsureSpace(target);
     switch (field.type()) {
       case UnknownField::TYPE_VARINT:
@@ -202,6 +205,11 @@ uint8_t* WireFormat::InternalSerializeUnknownFieldsToArray(
         break;
     }
   }
+  if (!unknown_fields.raw_.empty()) {
+    target = stream->WriteRaw(unknown_fields.raw_.data(),
+                              static_cast<int>(unknown_fields.raw_.size()),
+                              target);
+  }
   return target;
 }
 
@@ -243,10 +251,8 @@ uint8_t* WireFormat::InternalSerializeUnknownMessageSetItemsToArray(
 
 size_t WireFormat::ComputeUnknownFieldsSize(
     const UnknownFieldSet& unknown_fields) {
-  size_t size = 0;
-  for (int i = 0; i < unknown_fields.field_count(); i++) {
-    const UnknownField& field = unknown_fields.field(i);
-
+  size_t size = unknown_fields.raw_.size();
+  for (const UnknownField& field : unknown_fields.fields_) {
     switch (field.type()) {
       case UnknownField::TYPE_VARINT:
         size += io::CodedOutputStream::VarintSize32(WireFormatLite::MakeTag(
@@ -1048,19 +1054,17 @@ uint8_t* WireFormat::_InternalSerialize(const Message& message, uint8_t* target,
   const Descriptor* descriptor = message.GetDescriptor();
   const Reflection* message_reflection = message.GetReflection();
 
-  std::vector<const FieldDescriptor*> fields;
-
   // Fields of map entry should always be serialized.
   if (descriptor->options().map_entry()) {
     for (int i = 0; i < descriptor->field_count(); i++) {
-      fields.push_back(descriptor->field(i));
+      target =
+          InternalSerializeField(descriptor->field(i), message, target, stream);
     }
   } else {
-    message_reflection->ListFields(message, &fields);
-  }
-
-  for (auto field : fields) {
-    target = InternalSerializeField(field, message, target, stream);
+    message_reflection->ForEachListedField(
+        message, [&](const FieldDescriptor* field) {
+          target = InternalSerializeField(field, message, target, stream);
+        });
   }
 
   if (descriptor->options().message_set_wire_format()) {
@@ -1467,6 +1471,485 @@ uint8_t* WireFormat::InternalSerializeMessageSetItem(
   return target;
 }
 
+// Serializes messages back to front into a buffer that grows towards its
+// beginning. Writing the contents of a length-delimited field before its
+// length and tag means no size pass is needed.
+class WireFormat::ReverseSerializer {
+ public:
+  explicit ReverseSerializer(bool deterministic)
+      : deterministic_(deterministic) {}
+
+  size_t size() const { return buffer_.size() - begin_; }
+
+  // Moves the serialization written so far into `output`.
+  void MoveTo(std::string* output) {
+    buffer_.erase(0, begin_);
+    begin_ = 0;
+    *output = std::move(buffer_);
+  }
+
+  void WriteMessage(const Message& message) {
+    const Descriptor* descriptor = message.GetDescriptor();
+    const Reflection* reflection = message.GetReflection();
+
+    // Unknown fields come last.
+    const UnknownFieldSet& unknown_fields =
+        reflection->GetUnknownFields(message);
+    if (!unknown_fields.empty()) {
+      const bool message_set = descriptor->options().message_set_wire_format();
+      const size_t size =
+          message_set ? ComputeUnknownMessageSetItemsSize(unknown_fields)
+                      : ComputeUnknownFieldsSize(unknown_fields);
+      uint8_t* target = Prepend(size);
+      io::EpsCopyOutputStream stream(target, static_cast<int>(size),
+                                     deterministic_);
+      if (message_set) {
+        InternalSerializeUnknownMessageSetItemsToArray(unknown_fields, target,
+                                                       &stream);
+      } else {
+        InternalSerializeUnknownFieldsToArray(unknown_fields, target, &stream);
+      }
+    }
+
+    std::vector<const FieldDescriptor*> fields;
+    // Fields of map entry should always be serialized.
+    if (descriptor->options().map_entry()) {
+      for (int i = 0; i < descriptor->field_count(); i++) {
+        fields.push_back(descriptor->field(i));
+      }
+    } else {
+      reflection->ListFields(message, &fields);
+    }
+    for (auto it = fields.rbegin(); it != fields.rend(); ++it) {
+      WriteField(*it, message);
+    }
+  }
+
+ private:
+  // Enough for a varint or a fixed64, with a one byte tag.
+  static constexpr int kMaxValueBytes = 11;
+
+  // Returns space for `n` bytes in front of the serialization.
+  uint8_t* Prepend(size_t n) {
+    if (PROTOBUF_PREDICT_FALSE(n > begin_)) Grow(n);
+    begin_ -= n;
+    return reinterpret_cast<uint8_t*>(&buffer_[begin_]);
+  }
+
+  void Grow(size_t n) {
+    const size_t size = this->size();
+    std::string buffer;
+    buffer.resize(std::max({size_t{256}, 2 * buffer_.size(), size + n}));
+    if (size > 0) {
+      std::memcpy(&buffer[buffer.size() - size], &buffer_[begin_], size);
+    }
+    begin_ = buffer.size() - size;
+    buffer_.swap(buffer);
+  }
+
+  void PrependBytes(const void* data, size_t n) {
+    if (n > 0) std::memcpy(Prepend(n), data, n);
+  }
+
+  void PrependVarint(uint64_t value) {
+    uint8_t bytes[kMaxValueBytes];
+    uint8_t* end = io::CodedOutputStream::WriteVarint64ToArray(value, bytes);
+    PrependBytes(bytes, static_cast<size_t>(end - bytes));
+  }
+
+  // Prepends the length of what was written after the serialization had
+  // `end_size` bytes, and then the tag of a length-delimited field.
+  void PrependLengthAndTag(int field_number, size_t end_size) {
+    PrependVarint(size() - end_size);
+    PrependVarint(WireFormatLite::MakeTag(
+        field_number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+  }
+
+  void PrependLengthDelimited(int field_number, absl::string_view value) {
+    PrependBytes(value.data(), value.size());
+    PrependVarint(value.size());
+    PrependVarint(WireFormatLite::MakeTag(
+        field_number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+  }
+
+  void PrependMessage(int field_number, const Message& message) {
+    const size_t end_size = size();
+    WriteMessage(message);
+    PrependLengthAndTag(field_number, end_size);
+  }
+
+  void PrependGroup(int field_number, const Message& message) {
+    PrependVarint(WireFormatLite::MakeTag(field_number,
+                                          WireFormatLite::WIRETYPE_END_GROUP));
+    WriteMessage(message);
+    PrependVarint(WireFormatLite::MakeTag(
+        field_number, WireFormatLite::WIRETYPE_START_GROUP));
+  }
+
+  void WriteField(const FieldDescriptor* field, const Message& message) {
+    const Reflection* message_reflection = message.GetReflection();
+
+    if (field->is_extension() &&
+        field->containing_type()->options().message_set_wire_format() &&
+        field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
+        !field->is_repeated()) {
+      WriteMessageSetItem(field, message);
+      return;
+    }
+
+    // Like InternalSerializeField(), prefer map reflection while the map is
+    // valid.
+    if (field->is_map()) {
+      const MapFieldBase* map_field =
+          message_reflection->GetMapData(message, field);
+      if (map_field->IsMapValid()) {
+        WriteMap(field, message);
+        return;
+      }
+    }
+    int count = 0;
+
+    if (field->is_repeated()) {
+      count = message_reflection->FieldSize(message, field);
+    } else if (field->containing_type()->options().map_entry()) {
+      // Map entry fields always need to be serialized.
+      count = 1;
+    } else if (message_reflection->HasField(message, field)) {
+      count = 1;
+    }
+    if (count == 0) return;
+
+    // map_entries is for maps that'll be deterministically serialized.
+    std::vector<const Message*> map_entries;
+    if (count > 1 && field->is_map() && deterministic_) {
+      map_entries =
+          DynamicMapSorter::Sort(message, count, message_reflection, field);
+    }
+
+    if (field->is_packed()) {
+      const size_t end_size = size();
+      switch (field->type()) {
+#define HANDLE_PRIMITIVE_TYPE(TYPE, CPPTYPE, TYPE_METHOD)                      \
+  case FieldDescriptor::TYPE_##TYPE: {                                         \
+    const auto& r =                                                            \
+        message_reflection->GetRepeatedFieldInternal<CPPTYPE>(message, field); \
+    for (int j = count - 1; j >= 0; j--) {                                     \
+      uint8_t bytes[kMaxValueBytes];                                           \
+      uint8_t* end = WireFormatLite::Write##TYPE_METHOD##NoTagToArray(         \
+          r.Get(j), bytes);                                                    \
+      PrependBytes(bytes, static_cast<size_t>(end - bytes));                   \
+    }                                                                          \
+    break;                                                                     \
+  }
+
+        HANDLE_PRIMITIVE_TYPE(INT32, int32_t, Int32)
+        HANDLE_PRIMITIVE_TYPE(INT64, int64_t, Int64)
+        HANDLE_PRIMITIVE_TYPE(SINT32, int32_t, SInt32)
+        HANDLE_PRIMITIVE_TYPE(SINT64, int64_t, SInt64)
+        HANDLE_PRIMITIVE_TYPE(UINT32, uint32_t, UInt32)
+        HANDLE_PRIMITIVE_TYPE(UINT64, uint64_t, UInt64)
+        HANDLE_PRIMITIVE_TYPE(ENUM, int, Enum)
+#ifndef ABSL_IS_LITTLE_ENDIAN
+        HANDLE_PRIMITIVE_TYPE(FIXED32, uint32_t, Fixed32)
+        HANDLE_PRIMITIVE_TYPE(FIXED64, uint64_t, Fixed64)
+        HANDLE_PRIMITIVE_TYPE(SFIXED32, int32_t, SFixed32)
+        HANDLE_PRIMITIVE_TYPE(SFIXED64, int64_t, SFixed64)
+        HANDLE_PRIMITIVE_TYPE(FLOAT, float, Float)
+        HANDLE_PRIMITIVE_TYPE(DOUBLE, double, Double)
+#endif  // !ABSL_IS_LITTLE_ENDIAN
+
+#undef HANDLE_PRIMITIVE_TYPE
+#ifdef ABSL_IS_LITTLE_ENDIAN
+        // The elements are stored just as they are on the wire.
+#define HANDLE_PRIMITIVE_TYPE(TYPE, CPPTYPE)                                   \
+  case FieldDescriptor::TYPE_##TYPE: {                                         \
+    const auto& r =                                                            \
+        message_reflection->GetRepeatedFieldInternal<CPPTYPE>(message, field); \
+    PrependBytes(r.data(), r.size() * sizeof(CPPTYPE));                        \
+    break;                                                                     \
+  }
+
+        HANDLE_PRIMITIVE_TYPE(FIXED32, uint32_t)
+        HANDLE_PRIMITIVE_TYPE(FIXED64, uint64_t)
+        HANDLE_PRIMITIVE_TYPE(SFIXED32, int32_t)
+        HANDLE_PRIMITIVE_TYPE(SFIXED64, int64_t)
+        HANDLE_PRIMITIVE_TYPE(FLOAT, float)
+        HANDLE_PRIMITIVE_TYPE(DOUBLE, double)
+#undef HANDLE_PRIMITIVE_TYPE
+#endif  // ABSL_IS_LITTLE_ENDIAN
+
+        case FieldDescriptor::TYPE_BOOL: {
+          const auto& r =
+              message_reflection->GetRepeatedFieldInternal<bool>(message,
+                                                                 field);
+          for (int j = count - 1; j >= 0; j--) {
+            const uint8_t byte = r.Get(j) ? 1 : 0;
+            PrependBytes(&byte, 1);
+          }
+          break;
+        }
+        default:
+          ABSL_LOG(FATAL) << "Invalid descriptor";
+      }
+      PrependLengthAndTag(field->number(), end_size);
+      return;
+    }
+
+    auto get_message_from_field = [&message, &map_entries, message_reflection](
+                                      const FieldDescriptor* field, int j) {
+      if (!field->is_repeated()) {
+        return &message_reflection->GetMessage(message, field);
+      }
+      if (!map_entries.empty()) {
+        return map_entries[j];
+      }
+      return &message_reflection->GetRepeatedMessage(message, field, j);
+    };
+    const uint32_t tag = WireFormat::MakeTag(field);
+    for (int j = count - 1; j >= 0; j--) {
+      switch (field->type()) {
+#define HANDLE_PRIMITIVE_TYPE(TYPE, CPPTYPE, TYPE_METHOD, CPPTYPE_METHOD)     \
+  case FieldDescriptor::TYPE_##TYPE: {                                        \
+    const CPPTYPE value =                                                     \
+        field->is_repeated()                                                  \
+            ? message_reflection->GetRepeated##CPPTYPE_METHOD(message, field, \
+                                                              j)              \
+            : message_reflection->Get##CPPTYPE_METHOD(message, field);        \
+    uint8_t bytes[kMaxValueBytes];                                            \
+    uint8_t* end =                                                            \
+        WireFormatLite::Write##TYPE_METHOD##NoTagToArray(value, bytes);       \
+    PrependBytes(bytes, static_cast<size_t>(end - bytes));                    \
+    PrependVarint(tag);                                                       \
+    break;                                                                    \
+  }
+
+        HANDLE_PRIMITIVE_TYPE(INT32, int32_t, Int32, Int32)
+        HANDLE_PRIMITIVE_TYPE(INT64, int64_t, Int64, Int64)
+        HANDLE_PRIMITIVE_TYPE(SINT32, int32_t, SInt32, Int32)
+        HANDLE_PRIMITIVE_TYPE(SINT64, int64_t, SInt64, Int64)
+        HANDLE_PRIMITIVE_TYPE(UINT32, uint32_t, UInt32, UInt32)
+        HANDLE_PRIMITIVE_TYPE(UINT64, uint64_t, UInt64, UInt64)
+
+        HANDLE_PRIMITIVE_TYPE(FIXED32, uint32_t, Fixed32, UInt32)
+        HANDLE_PRIMITIVE_TYPE(FIXED64, uint64_t, Fixed64, UInt64)
+        HANDLE_PRIMITIVE_TYPE(SFIXED32, int32_t, SFixed32, Int32)
+        HANDLE_PRIMITIVE_TYPE(SFIXED64, int64_t, SFixed64, Int64)
+
+        HANDLE_PRIMITIVE_TYPE(FLOAT, float, Float, Float)
+        HANDLE_PRIMITIVE_TYPE(DOUBLE, double, Double, Double)
+
+        HANDLE_PRIMITIVE_TYPE(BOOL, bool, Bool, Bool)
+#undef HANDLE_PRIMITIVE_TYPE
+
+        case FieldDescriptor::TYPE_GROUP:
+          PrependGroup(field->number(), *get_message_from_field(field, j));
+          break;
+
+        case FieldDescriptor::TYPE_MESSAGE:
+          PrependMessage(field->number(), *get_message_from_field(field, j));
+          break;
+
+        case FieldDescriptor::TYPE_ENUM: {
+          const EnumValueDescriptor* value =
+              field->is_repeated()
+                  ? message_reflection->GetRepeatedEnum(message, field, j)
+                  : message_reflection->GetEnum(message, field);
+          uint8_t bytes[kMaxValueBytes];
+          uint8_t* end =
+              WireFormatLite::WriteEnumNoTagToArray(value->number(), bytes);
+          PrependBytes(bytes, static_cast<size_t>(end - bytes));
+          PrependVarint(tag);
+          break;
+        }
+
+        case FieldDescriptor::TYPE_STRING: {
+          std::string scratch;
+          const std::string& value =
+              field->is_repeated()
+                  ? message_reflection->GetRepeatedStringReference(
+                        message, field, j, &scratch)
+                  : message_reflection->GetStringReference(message, field,
+                                                           &scratch);
+          if (field->requires_utf8_validation()) {
+            WireFormatLite::VerifyUtf8String(value.data(), value.length(),
+                                             WireFormatLite::SERIALIZE,
+                                             field->full_name().c_str());
+          } else {
+            VerifyUTF8StringNamedField(value.data(), value.length(), SERIALIZE,
+                                       field->full_name().c_str());
+          }
+          PrependLengthDelimited(field->number(), value);
+          break;
+        }
+
+        case FieldDescriptor::TYPE_BYTES: {
+          if (internal::cpp::EffectiveStringCType(field) ==
+              FieldOptions::CORD) {
+            absl::Cord value = message_reflection->GetCord(message, field);
+            uint8_t* target = Prepend(value.size());
+            for (absl::string_view chunk : value.Chunks()) {
+              std::memcpy(target, chunk.data(), chunk.size());
+              target += chunk.size();
+            }
+            PrependVarint(value.size());
+            PrependVarint(tag);
+            break;
+          }
+          std::string scratch;
+          const std::string& value =
+              field->is_repeated()
+                  ? message_reflection->GetRepeatedStringReference(
+                        message, field, j, &scratch)
+                  : message_reflection->GetStringReference(message, field,
+                                                           &scratch);
+          PrependLengthDelimited(field->number(), value);
+          break;
+        }
+      }
+    }
+  }
+
+  void WriteMap(const FieldDescriptor* field, const Message& message) {
+    const Reflection* message_reflection = message.GetReflection();
+    // Map iterators only go forward, so collect the entries first.
+    std::vector<std::pair<MapKey, MapValueConstRef>> entries;
+    if (deterministic_) {
+      for (const MapKey& key :
+           MapKeySorter::SortKey(message, message_reflection, field)) {
+        MapValueConstRef value;
+        message_reflection->LookupMapValue(message, field, key, &value);
+        entries.emplace_back(key, value);
+      }
+    } else {
+      for (MapIterator it = message_reflection->MapBegin(
+               const_cast<Message*>(&message), field);
+           it !=
+           message_reflection->MapEnd(const_cast<Message*>(&message), field);
+           ++it) {
+        entries.emplace_back(it.GetKey(), it.GetValueRef());
+      }
+    }
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+      const size_t end_size = size();
+      WriteMapValue(field->message_type()->field(1), it->second);
+      WriteMapKey(field->message_type()->field(0), it->first);
+      PrependLengthAndTag(field->number(), end_size);
+    }
+  }
+
+  void WriteMapKey(const FieldDescriptor* field, const MapKey& value) {
+    switch (field->type()) {
+      case FieldDescriptor::TYPE_DOUBLE:
+      case FieldDescriptor::TYPE_FLOAT:
+      case FieldDescriptor::TYPE_GROUP:
+      case FieldDescriptor::TYPE_MESSAGE:
+      case FieldDescriptor::TYPE_BYTES:
+      case FieldDescriptor::TYPE_ENUM:
+        ABSL_LOG(FATAL) << "Unsupported";
+        break;
+#define CASE_TYPE(FieldType, CamelFieldType, CamelCppType)         \
+  case FieldDescriptor::TYPE_##FieldType: {                        \
+    uint8_t bytes[kMaxValueBytes];                                 \
+    uint8_t* end = WireFormatLite::Write##CamelFieldType##ToArray( \
+        1, value.Get##CamelCppType##Value(), bytes);               \
+    PrependBytes(bytes, static_cast<size_t>(end - bytes));         \
+    break;                                                         \
+  }
+      CASE_TYPE(INT64, Int64, Int64)
+      CASE_TYPE(UINT64, UInt64, UInt64)
+      CASE_TYPE(INT32, Int32, Int32)
+      CASE_TYPE(FIXED64, Fixed64, UInt64)
+      CASE_TYPE(FIXED32, Fixed32, UInt32)
+      CASE_TYPE(BOOL, Bool, Bool)
+      CASE_TYPE(UINT32, UInt32, UInt32)
+      CASE_TYPE(SFIXED32, SFixed32, Int32)
+      CASE_TYPE(SFIXED64, SFixed64, Int64)
+      CASE_TYPE(SINT32, SInt32, Int32)
+      CASE_TYPE(SINT64, SInt64, Int64)
+#undef CASE_TYPE
+      case FieldDescriptor::TYPE_STRING:
+        PrependLengthDelimited(1, value.GetStringValue());
+        break;
+    }
+  }
+
+  void WriteMapValue(const FieldDescriptor* field,
+                     const MapValueConstRef& value) {
+    switch (field->type()) {
+#define CASE_TYPE(FieldType, CamelFieldType, CamelCppType)         \
+  case FieldDescriptor::TYPE_##FieldType: {                        \
+    uint8_t bytes[kMaxValueBytes];                                 \
+    uint8_t* end = WireFormatLite::Write##CamelFieldType##ToArray( \
+        2, value.Get##CamelCppType##Value(), bytes);               \
+    PrependBytes(bytes, static_cast<size_t>(end - bytes));         \
+    break;                                                         \
+  }
+      CASE_TYPE(INT64, Int64, Int64)
+      CASE_TYPE(UINT64, UInt64, UInt64)
+      CASE_TYPE(INT32, Int32, Int32)
+      CASE_TYPE(FIXED64, Fixed64, UInt64)
+      CASE_TYPE(FIXED32, Fixed32, UInt32)
+      CASE_TYPE(BOOL, Bool, Bool)
+      CASE_TYPE(UINT32, UInt32, UInt32)
+      CASE_TYPE(SFIXED32, SFixed32, Int32)
+      CASE_TYPE(SFIXED64, SFixed64, Int64)
+      CASE_TYPE(SINT32, SInt32, Int32)
+      CASE_TYPE(SINT64, SInt64, Int64)
+      CASE_TYPE(ENUM, Enum, Enum)
+      CASE_TYPE(DOUBLE, Double, Double)
+      CASE_TYPE(FLOAT, Float, Float)
+#undef CASE_TYPE
+      case FieldDescriptor::TYPE_STRING:
+      case FieldDescriptor::TYPE_BYTES:
+        PrependLengthDelimited(2, value.GetStringValue());
+        break;
+      case FieldDescriptor::TYPE_MESSAGE:
+        PrependMessage(2, value.GetMessageValue());
+        break;
+      case FieldDescriptor::TYPE_GROUP:
+        PrependGroup(2, value.GetMessageValue());
+        break;
+    }
+  }
+
+  void WriteMessageSetItem(const FieldDescriptor* field,
+                           const Message& message) {
+    const Reflection* message_reflection = message.GetReflection();
+    PrependVarint(WireFormatLite::kMessageSetItemEndTag);
+    PrependMessage(WireFormatLite::kMessageSetMessageNumber,
+                   message_reflection->GetMessage(message, field));
+    PrependVarint(static_cast<uint32_t>(field->number()));
+    PrependVarint(WireFormatLite::MakeTag(
+        WireFormatLite::kMessageSetTypeIdNumber,
+        WireFormatLite::WIRETYPE_VARINT));
+    PrependVarint(WireFormatLite::kMessageSetItemStartTag);
+  }
+
+  const bool deterministic_;
+  std::string buffer_;
+  // The serialization occupies buffer_[begin_, buffer_.size()).
+  size_t begin_ = 0;
+};
+
+bool WireFormat::SerializeToStringInOnePass(const Message& message,
+                                            std::string* output) {
+  ABSL_DCHECK(message.IsInitialized())
+      << "Can't serialize message of type \"" << message.GetTypeName()
+      << "\" because it is missing required fields: "
+      << message.InitializationErrorString();
+  ReverseSerializer serializer(
+      io::CodedOutputStream::IsDefaultSerializationDeterministic());
+  serializer.WriteMessage(message);
+  if (serializer.size() > INT_MAX) {
+    ABSL_LOG(ERROR) << message.GetTypeName()
+                    << " exceeded maximum protobuf size of 2GB: "
+                    << serializer.size();
+    return false;
+  }
+  serializer.MoveTo(output);
+  return true;
+}
+
 // ===================================================================
 
 size_t WireFormat::ByteSize(const Message& message) {
@@ -1475,19 +1958,16 @@ size_t WireFormat::ByteSize(const Message& message) {
 
   size_t our_size = 0;
 
-  std::vector<const FieldDescriptor*> fields;
-
   // Fields of map entry should always be serialized.
   if (descriptor->options().map_entry()) {
     for (int i = 0; i < descriptor->field_count(); i++) {
-      fields.push_back(descriptor->field(i));
+      our_size += FieldByteSize(descriptor->field(i), message);
     }
   } else {
-    message_reflection->ListFields(message, &fields);
-  }
-
-  for (const FieldDescriptor* field : fields) {
-    our_size += FieldByteSize(field, message);
+    message_reflection->ForEachListedField(
+        message, [&](const FieldDescriptor* field) {
+          our_size += FieldByteSize(field, message);
+        });
   }
 
   if (descriptor->options().message_set_wire_format()) {
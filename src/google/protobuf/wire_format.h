@@ -16,6 +16,8 @@
 #ifndef GOOGLE_PROTOBUF_WIRE_FORMAT_H__
 #define GOOGLE_PROTOBUF_WIRE_FORMAT_H__
 
+#include <string>
+
 #include "google/protobuf/stubs/common.h"
 #include "absl/base/casts.h"
 #include "google/protobuf/descriptor.h"
@@ -121,6 +123,20 @@ class PROTOBUF_EXPORT WireFormat {
   // WireFormat::SerializeWithCachedSizes() on the same object.
   static size_t ByteSize(const Message& message);
 
+  // Serializes `message` to `output` like Message::SerializeToString(), with
+  // byte-identical output, but in a single traversal that neither needs nor
+  // updates cached sizes: the output is written back to front, so the length
+  // of every submessage is known by the time its tag is written.
+  //
+  // Messages with generated code are still faster to serialize with
+  // SerializeToString(). This helps messages serialized through reflection,
+  // e.g. DynamicMessage, whose size pass costs about as much as the write
+  // pass.
+  //
+  // Returns false if the result would exceed 2GB.
+  static bool SerializeToStringInOnePass(const Message& message,
+                                         std::string* output);
+
   // -----------------------------------------------------------------
   // Helpers for dealing with unknown fields
 
@@ -264,6 +280,7 @@ class PROTOBUF_EXPORT WireFormat {
 
  private:
   struct MessageSetParser;
+  class ReverseSerializer;
   friend class TcParser;
   // Skip a MessageSet field.
   static bool SkipMessageSetField(io::CodedInputStream* input,
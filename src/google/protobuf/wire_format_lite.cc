@@ -21,7 +21,7 @@
 #include "absl/strings/cord.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
-#include "utf8_validity.h"
+#include "google/protobuf/utf8_util.h"
 
 
 // Must be included last.
@@ -605,7 +605,7 @@ void PrintUTF8ErrorLog(absl::string_view message_name,
 
 bool WireFormatLite::VerifyUtf8String(const char* data, int size, Operation op,
                                       const char* field_name) {
-  if (!utf8_range::IsStructurallyValid({data, static_cast<size_t>(size)})) {
+  if (!IsValidUtf8({data, static_cast<size_t>(size)})) {
     const char* operation_str = nullptr;
     switch (op) {
       case PARSE:
@@ -0,0 +1,335 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/wire_view.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "absl/base/casts.h"
+#include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/wire_format_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+using internal::WireFormatLite;
+
+namespace {
+
+WireFormatLite::WireType ExpectedWireType(const FieldDescriptor* field) {
+  return WireFormatLite::WireTypeForFieldType(
+      static_cast<WireFormatLite::FieldType>(field->type()));
+}
+
+// Returns false for values of closed enums that regular parsing would put in
+// the unknown fields.
+bool IsKnownValue(const FieldDescriptor* field, uint64_t raw) {
+  return field->cpp_type() != FieldDescriptor::CPPTYPE_ENUM ||
+         !field->legacy_enum_field_treated_as_closed() ||
+         field->enum_type()->FindValueByNumber(static_cast<int>(raw)) !=
+             nullptr;
+}
+
+template <typename T>
+T FromRaw(const FieldDescriptor* field, uint64_t raw) {
+  switch (field->type()) {
+    case FieldDescriptor::TYPE_SINT32:
+      return static_cast<T>(
+          WireFormatLite::ZigZagDecode32(static_cast<uint32_t>(raw)));
+    case FieldDescriptor::TYPE_SINT64:
+      return static_cast<T>(WireFormatLite::ZigZagDecode64(raw));
+    case FieldDescriptor::TYPE_FLOAT:
+      return static_cast<T>(absl::bit_cast<float>(static_cast<uint32_t>(raw)));
+    case FieldDescriptor::TYPE_DOUBLE:
+      return static_cast<T>(absl::bit_cast<double>(raw));
+    case FieldDescriptor::TYPE_BOOL:
+      return static_cast<T>(raw != 0);
+    default:
+      return static_cast<T>(raw);
+  }
+}
+
+template <typename T>
+T DefaultValue(const FieldDescriptor* field) {
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+      return static_cast<T>(field->default_value_int32());
+    case FieldDescriptor::CPPTYPE_INT64:
+      return static_cast<T>(field->default_value_int64());
+    case FieldDescriptor::CPPTYPE_UINT32:
+      return static_cast<T>(field->default_value_uint32());
+    case FieldDescriptor::CPPTYPE_UINT64:
+      return static_cast<T>(field->default_value_uint64());
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      return static_cast<T>(field->default_value_float());
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      return static_cast<T>(field->default_value_double());
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return static_cast<T>(field->default_value_bool());
+    case FieldDescriptor::CPPTYPE_ENUM:
+      return static_cast<T>(field->default_value_enum()->number());
+    default:
+      ABSL_LOG(FATAL) << field->full_name() << " is not a scalar field";
+  }
+}
+
+}  // namespace
+
+const FieldDescriptor* WireView::FindField(int number, bool repeated) const {
+  const FieldDescriptor* field = descriptor_->FindFieldByNumber(number);
+  ABSL_CHECK(field != nullptr)
+      << descriptor_->full_name() << " has no field number " << number;
+  ABSL_DCHECK_EQ(field->is_repeated(), repeated) << field->full_name();
+  return field;
+}
+
+void WireView::BuildIndex() const {
+  indexed_ = true;
+  io::CodedInputStream input(reinterpret_cast<const uint8_t*>(data_.data()),
+                             static_cast<int>(data_.size()));
+  while (uint32_t tag = input.ReadTag()) {
+    Entry entry;
+    entry.number = WireFormatLite::GetTagFieldNumber(tag);
+    entry.wire_type = WireFormatLite::GetTagWireType(tag);
+    entry.value = 0;
+    if (entry.number == 0) break;
+    bool ok;
+    switch (entry.wire_type) {
+      case WireFormatLite::WIRETYPE_VARINT:
+        ok = input.ReadVarint64(&entry.value);
+        break;
+      case WireFormatLite::WIRETYPE_FIXED64:
+        ok = input.ReadLittleEndian64(&entry.value);
+        break;
+      case WireFormatLite::WIRETYPE_FIXED32: {
+        uint32_t value;
+        ok = input.ReadLittleEndian32(&value);
+        entry.value = value;
+        break;
+      }
+      case WireFormatLite::WIRETYPE_LENGTH_DELIMITED: {
+        int length;
+        ok = input.ReadVarintSizeAsInt(&length);
+        if (!ok) break;
+        const int start = input.CurrentPosition();
+        ok = input.Skip(length);
+        entry.bytes = data_.substr(start, length);
+        break;
+      }
+      case WireFormatLite::WIRETYPE_START_GROUP: {
+        const int start = input.CurrentPosition();
+        ok = WireFormatLite::SkipField(&input, tag);
+        if (!ok) break;
+        const int end_tag_size = io::CodedOutputStream::VarintSize32(
+            WireFormatLite::MakeTag(entry.number,
+                                    WireFormatLite::WIRETYPE_END_GROUP));
+        entry.bytes = data_.substr(
+            start, input.CurrentPosition() - end_tag_size - start);
+        break;
+      }
+      default:
+        ok = false;
+    }
+    if (!ok) break;
+    index_.push_back(entry);
+  }
+  if (!input.ConsumedEntireMessage()) {
+    valid_ = false;
+    index_.clear();
+    return;
+  }
+  std::stable_sort(index_.begin(), index_.end(),
+                   [](const Entry& a, const Entry& b) {
+                     return a.number < b.number;
+                   });
+}
+
+bool WireView::IsValid() const {
+  if (!indexed_) BuildIndex();
+  return valid_;
+}
+
+std::pair<const WireView::Entry*, const WireView::Entry*>
+WireView::Occurrences(int number) const {
+  if (!indexed_) BuildIndex();
+  auto first = std::lower_bound(
+      index_.begin(), index_.end(), number,
+      [](const Entry& entry, int number) { return entry.number < number; });
+  auto last = std::upper_bound(
+      first, index_.end(), number,
+      [](int number, const Entry& entry) { return number < entry.number; });
+  return {index_.data() + (first - index_.begin()),
+          index_.data() + (last - index_.begin())};
+}
+
+const WireView::Entry* WireView::FindLast(const FieldDescriptor* field) const {
+  const WireFormatLite::WireType wire_type = ExpectedWireType(field);
+  auto range = Occurrences(field->number());
+  for (const Entry* entry = range.second; entry != range.first;) {
+    --entry;
+    if (entry->wire_type == wire_type && IsKnownValue(field, entry->value)) {
+      return entry;
+    }
+  }
+  return nullptr;
+}
+
+const WireView::Entry* WireView::FindNth(const FieldDescriptor* field,
+                                         int index) const {
+  const WireFormatLite::WireType wire_type = ExpectedWireType(field);
+  auto range = Occurrences(field->number());
+  for (const Entry* entry = range.first; entry != range.second; ++entry) {
+    if (entry->wire_type == wire_type && index-- == 0) return entry;
+  }
+  return nullptr;
+}
+
+template <typename Fn>
+void WireView::ForEachScalar(const FieldDescriptor* field, Fn fn) const {
+  const WireFormatLite::WireType wire_type = ExpectedWireType(field);
+  auto range = Occurrences(field->number());
+  for (const Entry* entry = range.first; entry != range.second; ++entry) {
+    if (entry->wire_type == wire_type) {
+      if (IsKnownValue(field, entry->value) && !fn(entry->value)) return;
+      continue;
+    }
+    if (entry->wire_type != WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      continue;
+    }
+    // A packed run. Stops at the first malformed element.
+    io::CodedInputStream input(
+        reinterpret_cast<const uint8_t*>(entry->bytes.data()),
+        static_cast<int>(entry->bytes.size()));
+    while (!input.ExpectAtEnd()) {
+      uint64_t raw;
+      bool ok;
+      if (wire_type == WireFormatLite::WIRETYPE_VARINT) {
+        ok = input.ReadVarint64(&raw);
+      } else if (wire_type == WireFormatLite::WIRETYPE_FIXED64) {
+        ok = input.ReadLittleEndian64(&raw);
+      } else {
+        uint32_t raw32;
+        ok = input.ReadLittleEndian32(&raw32);
+        raw = raw32;
+      }
+      if (!ok) break;
+      if (IsKnownValue(field, raw) && !fn(raw)) return;
+    }
+  }
+}
+
+bool WireView::Has(int number) const {
+  return FindLast(FindField(number, false)) != nullptr;
+}
+
+template <typename T>
+T WireView::Get(int number) const {
+  const FieldDescriptor* field = FindField(number, false);
+  const Entry* entry = FindLast(field);
+  if (entry == nullptr) return DefaultValue<T>(field);
+  return FromRaw<T>(field, entry->value);
+}
+
+absl::string_view WireView::GetString(int number) const {
+  const FieldDescriptor* field = FindField(number, false);
+  ABSL_DCHECK_EQ(field->cpp_type(), FieldDescriptor::CPPTYPE_STRING);
+  const Entry* entry = FindLast(field);
+  if (entry == nullptr) return field->default_value_string();
+  return entry->bytes;
+}
+
+WireView WireView::GetMessage(int number) const {
+  const FieldDescriptor* field = FindField(number, false);
+  ABSL_DCHECK_EQ(field->cpp_type(), FieldDescriptor::CPPTYPE_MESSAGE);
+  const Entry* entry = FindLast(field);
+  return WireView(field->message_type(),
+                  entry == nullptr ? absl::string_view() : entry->bytes);
+}
+
+int WireView::FieldSize(int number) const {
+  const FieldDescriptor* field = FindField(number, true);
+  int size = 0;
+  if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING ||
+      field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+    const WireFormatLite::WireType wire_type = ExpectedWireType(field);
+    auto range = Occurrences(number);
+    for (const Entry* entry = range.first; entry != range.second; ++entry) {
+      if (entry->wire_type == wire_type) ++size;
+    }
+  } else {
+    ForEachScalar(field, [&size](uint64_t) {
+      ++size;
+      return true;
+    });
+  }
+  return size;
+}
+
+template <typename T>
+T WireView::GetRepeated(int number, int index) const {
+  const FieldDescriptor* field = FindField(number, true);
+  ABSL_DCHECK_GE(index, 0);
+  T value{};
+  bool found = false;
+  ForEachScalar(field, [&](uint64_t raw) {
+    if (index-- > 0) return true;
+    value = FromRaw<T>(field, raw);
+    found = true;
+    return false;
+  });
+  ABSL_DCHECK(found) << "index out of range for " << field->full_name();
+  return value;
+}
+
+absl::string_view WireView::GetRepeatedString(int number, int index) const {
+  const FieldDescriptor* field = FindField(number, true);
+  ABSL_DCHECK_EQ(field->cpp_type(), FieldDescriptor::CPPTYPE_STRING);
+  const Entry* entry = FindNth(field, index);
+  ABSL_DCHECK(entry != nullptr)
+      << "index out of range for " << field->full_name();
+  return entry == nullptr ? absl::string_view() : entry->bytes;
+}
+
+WireView WireView::GetRepeatedMessage(int number, int index) const {
+  const FieldDescriptor* field = FindField(number, true);
+  ABSL_DCHECK_EQ(field->cpp_type(), FieldDescriptor::CPPTYPE_MESSAGE);
+  const Entry* entry = FindNth(field, index);
+  ABSL_DCHECK(entry != nullptr)
+      << "index out of range for " << field->full_name();
+  return WireView(field->message_type(),
+                  entry == nullptr ? absl::string_view() : entry->bytes);
+}
+
+template int32_t WireView::Get(int) const;
+template int64_t WireView::Get(int) const;
+template uint32_t WireView::Get(int) const;
+template uint64_t WireView::Get(int) const;
+template float WireView::Get(int) const;
+template double WireView::Get(int) const;
+template bool WireView::Get(int) const;
+
+template int32_t WireView::GetRepeated(int, int) const;
+template int64_t WireView::GetRepeated(int, int) const;
+template uint32_t WireView::GetRepeated(int, int) const;
+template uint64_t WireView::GetRepeated(int, int) const;
+template float WireView::GetRepeated(int, int) const;
+template double WireView::GetRepeated(int, int) const;
+template bool WireView::GetRepeated(int, int) const;
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,126 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines WireView, which reads fields of a serialized message
+// without parsing it into a message object.
+
+#ifndef GOOGLE_PROTOBUF_WIRE_VIEW_H__
+#define GOOGLE_PROTOBUF_WIRE_VIEW_H__
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/descriptor.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+// A WireView gives read-only access to the fields of a serialized message,
+// straight from the serialized bytes. Nothing is parsed up front: the first
+// access walks the top-level fields once and records where each one starts.
+// Later accesses then decode just the requested value. Strings and submessages
+// are returned as views of the bytes, without copies:
+//
+//   // message Request { Header header = 1; bytes body = 2; }
+//   // message Header { string route = 1; int64 deadline_ms = 2; }
+//   WireView request = WireView::Of<Request>(serialized_request);
+//   WireView header = request.GetMessage(Request::kHeaderFieldNumber);
+//   absl::string_view route = header.GetString(Header::kRouteFieldNumber);
+//   if (!request.IsValid() || !header.IsValid()) { ... }
+//
+// Code that reads a few fields of a large message, e.g. to route or filter it,
+// thus skips building the rest of the message.
+//
+// Values follow the rules of regular parsing: a singular field that occurs
+// several times has its last value, occurrences with the wrong wire type and
+// unknown values of closed enums are ignored, and absent fields have their
+// default value. One difference: a singular message field that occurs several
+// times is not merged; GetMessage() returns its last occurrence.
+//
+// Fields are addressed by number and must be accessed with their C++ type, as
+// for ColumnarView: `int` for enums. Extensions are not supported. A WireView
+// indexes its data on first use and thus must not be shared between threads.
+// The data must outlive the view and the views of its submessages.
+class PROTOBUF_EXPORT WireView {
+ public:
+  // `descriptor` is the type of the message serialized in `data`.
+  WireView(const Descriptor* descriptor, absl::string_view data)
+      : descriptor_(descriptor), data_(data) {}
+
+  template <typename T>
+  static WireView Of(absl::string_view data) {
+    return WireView(T::descriptor(), data);
+  }
+
+  const Descriptor* descriptor() const { return descriptor_; }
+  absl::string_view data() const { return data_; }
+
+  // Returns false if the top-level fields of the data are malformed. Accessors
+  // of a malformed view behave as if all fields were absent. Submessages are
+  // only checked by their own views.
+  bool IsValid() const;
+
+  // Singular fields.
+  bool Has(int number) const;
+  template <typename T>
+  T Get(int number) const;
+  absl::string_view GetString(int number) const;
+  // Returns a view of an empty message if the field is absent.
+  WireView GetMessage(int number) const;
+
+  // Repeated fields. Elements of packed scalar fields are decoded on each
+  // access, so GetRepeated() takes time linear in `index` for them.
+  int FieldSize(int number) const;
+  template <typename T>
+  T GetRepeated(int number, int index) const;
+  absl::string_view GetRepeatedString(int number, int index) const;
+  WireView GetRepeatedMessage(int number, int index) const;
+
+ private:
+  // One occurrence of a field in the data.
+  struct Entry {
+    int number;
+    uint8_t wire_type;
+    // Decoded varint and fixed values.
+    uint64_t value;
+    // The payload of length-delimited fields and groups.
+    absl::string_view bytes;
+  };
+
+  const FieldDescriptor* FindField(int number, bool repeated) const;
+  void BuildIndex() const;
+  // Returns the occurrences of field `number`, in wire order.
+  std::pair<const Entry*, const Entry*> Occurrences(int number) const;
+  // Returns the last occurrence of `field` that holds a value, or nullptr.
+  const Entry* FindLast(const FieldDescriptor* field) const;
+  // Returns the `index`th occurrence of repeated `field` that holds a value,
+  // or nullptr.
+  const Entry* FindNth(const FieldDescriptor* field, int index) const;
+  // Calls `fn(raw)` on each element of repeated scalar `field` until it
+  // returns false.
+  template <typename Fn>
+  void ForEachScalar(const FieldDescriptor* field, Fn fn) const;
+
+  const Descriptor* descriptor_;
+  absl::string_view data_;
+  mutable bool indexed_ = false;
+  mutable bool valid_ = true;
+  // Sorted by field number, then wire order.
+  mutable std::vector<Entry> index_;
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_WIRE_VIEW_H__
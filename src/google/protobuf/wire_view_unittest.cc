@@ -0,0 +1,179 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/wire_view.h"
+
+#include <cstdint>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/wire_format_lite.h"
+
+
+namespace google {
+namespace protobuf {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestPackedTypes;
+using internal::WireFormatLite;
+
+TEST(WireViewTest, ReadsSingularFields) {
+  TestAllTypes message;
+  message.set_optional_int32(-7);
+  message.set_optional_sint64(-5000000000);
+  message.set_optional_fixed32(9);
+  message.set_optional_float(2.5f);
+  message.set_optional_double(-1.25);
+  message.set_optional_bool(true);
+  message.set_optional_string("route");
+  message.set_optional_nested_enum(TestAllTypes::BAZ);
+  message.mutable_optional_nested_message()->set_bb(42);
+  message.mutable_optionalgroup()->set_a(3);
+  const std::string data = message.SerializeAsString();
+
+  WireView view = WireView::Of<TestAllTypes>(data);
+  EXPECT_TRUE(view.IsValid());
+  EXPECT_EQ(view.Get<int32_t>(TestAllTypes::kOptionalInt32FieldNumber), -7);
+  EXPECT_EQ(view.Get<int64_t>(TestAllTypes::kOptionalSint64FieldNumber),
+            -5000000000);
+  EXPECT_EQ(view.Get<uint32_t>(TestAllTypes::kOptionalFixed32FieldNumber), 9);
+  EXPECT_EQ(view.Get<float>(TestAllTypes::kOptionalFloatFieldNumber), 2.5f);
+  EXPECT_EQ(view.Get<double>(TestAllTypes::kOptionalDoubleFieldNumber), -1.25);
+  EXPECT_TRUE(view.Get<bool>(TestAllTypes::kOptionalBoolFieldNumber));
+  EXPECT_EQ(view.GetString(TestAllTypes::kOptionalStringFieldNumber), "route");
+  EXPECT_EQ(view.Get<int>(TestAllTypes::kOptionalNestedEnumFieldNumber),
+            TestAllTypes::BAZ);
+
+  WireView nested =
+      view.GetMessage(TestAllTypes::kOptionalNestedMessageFieldNumber);
+  EXPECT_EQ(nested.descriptor(), TestAllTypes::NestedMessage::descriptor());
+  EXPECT_EQ(nested.Get<int32_t>(TestAllTypes::NestedMessage::kBbFieldNumber),
+            42);
+  WireView group = view.GetMessage(TestAllTypes::kOptionalgroupFieldNumber);
+  EXPECT_TRUE(group.IsValid());
+  EXPECT_EQ(group.Get<int32_t>(TestAllTypes::OptionalGroup::kAFieldNumber), 3);
+
+  // Strings point into the data.
+  absl::string_view route =
+      view.GetString(TestAllTypes::kOptionalStringFieldNumber);
+  EXPECT_GE(route.data(), data.data());
+  EXPECT_LE(route.data() + route.size(), data.data() + data.size());
+}
+
+TEST(WireViewTest, AbsentFieldsHaveDefaults) {
+  WireView view = WireView::Of<TestAllTypes>("");
+  EXPECT_TRUE(view.IsValid());
+  EXPECT_FALSE(view.Has(TestAllTypes::kOptionalInt32FieldNumber));
+  EXPECT_EQ(view.Get<int32_t>(TestAllTypes::kDefaultInt32FieldNumber), 41);
+  EXPECT_EQ(view.GetString(TestAllTypes::kDefaultStringFieldNumber), "hello");
+  EXPECT_EQ(view.Get<int>(TestAllTypes::kDefaultNestedEnumFieldNumber),
+            TestAllTypes::BAR);
+  EXPECT_EQ(view.GetMessage(TestAllTypes::kOptionalNestedMessageFieldNumber)
+                .data(),
+            "");
+  EXPECT_EQ(view.FieldSize(TestAllTypes::kRepeatedInt32FieldNumber), 0);
+}
+
+TEST(WireViewTest, ReadsRepeatedFields) {
+  TestAllTypes message;
+  message.add_repeated_int32(1);
+  message.add_repeated_int32(-2);
+  message.add_repeated_string("a");
+  message.add_repeated_string("b");
+  message.add_repeated_nested_message()->set_bb(5);
+  message.add_repeated_nested_message()->set_bb(6);
+  const std::string data = message.SerializeAsString();
+
+  WireView view = WireView::Of<TestAllTypes>(data);
+  ASSERT_EQ(view.FieldSize(TestAllTypes::kRepeatedInt32FieldNumber), 2);
+  EXPECT_EQ(view.GetRepeated<int32_t>(TestAllTypes::kRepeatedInt32FieldNumber,
+                                      1),
+            -2);
+  ASSERT_EQ(view.FieldSize(TestAllTypes::kRepeatedStringFieldNumber), 2);
+  EXPECT_EQ(
+      view.GetRepeatedString(TestAllTypes::kRepeatedStringFieldNumber, 0),
+      "a");
+  ASSERT_EQ(view.FieldSize(TestAllTypes::kRepeatedNestedMessageFieldNumber),
+            2);
+  EXPECT_EQ(
+      view.GetRepeatedMessage(TestAllTypes::kRepeatedNestedMessageFieldNumber,
+                              1)
+          .Get<int32_t>(TestAllTypes::NestedMessage::kBbFieldNumber),
+      6);
+}
+
+TEST(WireViewTest, ReadsPackedFields) {
+  TestPackedTypes message;
+  for (int i = 0; i < 100; ++i) {
+    message.add_packed_sint32(-i);
+    message.add_packed_double(i * 0.5);
+  }
+  const std::string data = message.SerializeAsString();
+
+  WireView view = WireView::Of<TestPackedTypes>(data);
+  ASSERT_EQ(view.FieldSize(TestPackedTypes::kPackedSint32FieldNumber), 100);
+  ASSERT_EQ(view.FieldSize(TestPackedTypes::kPackedDoubleFieldNumber), 100);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(view.GetRepeated<int32_t>(
+                  TestPackedTypes::kPackedSint32FieldNumber, i),
+              -i);
+    EXPECT_EQ(view.GetRepeated<double>(
+                  TestPackedTypes::kPackedDoubleFieldNumber, i),
+              i * 0.5);
+  }
+}
+
+TEST(WireViewTest, FollowsParsingRules) {
+  // Two occurrences of a singular field: the last one wins.
+  TestAllTypes first;
+  first.set_optional_int32(1);
+  first.set_optional_nested_enum(TestAllTypes::FOO);
+  TestAllTypes second;
+  second.set_optional_int32(2);
+  std::string data = first.SerializeAsString() + second.SerializeAsString();
+  auto append_varint = [&data](uint32_t value) {
+    uint8_t buffer[5];
+    uint8_t* end = io::CodedOutputStream::WriteVarint32ToArray(value, buffer);
+    data.append(reinterpret_cast<char*>(buffer), end - buffer);
+  };
+  // An unknown value of a closed enum is ignored.
+  append_varint(
+      WireFormatLite::MakeTag(TestAllTypes::kOptionalNestedEnumFieldNumber,
+                              WireFormatLite::WIRETYPE_VARINT));
+  append_varint(100);
+  // A field with the wrong wire type is ignored.
+  append_varint(WireFormatLite::MakeTag(TestAllTypes::kOptionalInt32FieldNumber,
+                                        WireFormatLite::WIRETYPE_FIXED32));
+  data.append(4, '\x01');
+
+  TestAllTypes parsed;
+  ASSERT_TRUE(parsed.ParseFromString(data));
+  WireView view = WireView::Of<TestAllTypes>(data);
+  EXPECT_EQ(view.Get<int32_t>(TestAllTypes::kOptionalInt32FieldNumber),
+            parsed.optional_int32());
+  EXPECT_EQ(view.Get<int>(TestAllTypes::kOptionalNestedEnumFieldNumber),
+            parsed.optional_nested_enum());
+}
+
+TEST(WireViewTest, MalformedData) {
+  TestAllTypes message;
+  message.set_optional_string("truncated");
+  std::string data = message.SerializeAsString();
+  data.pop_back();
+
+  WireView view = WireView::Of<TestAllTypes>(data);
+  EXPECT_FALSE(view.IsValid());
+  EXPECT_FALSE(view.Has(TestAllTypes::kOptionalStringFieldNumber));
+  EXPECT_FALSE(WireView::Of<TestAllTypes>("\x07").IsValid());
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
@@ -26,8 +26,6 @@
 #define ARRAY_SIZE(x) \
   ((sizeof(x) / sizeof(0 [x])) / ((size_t)(!(sizeof(x) % sizeof(0 [x])))))
 
-static const double MAX_LOAD = 0.85;
-
 /* The minimum utilization of the array part of a mixed hash/array table.  This
  * is a speed/memory-usage tradeoff (though it's not straightforward because of
  * cache effects).  The lower this is, the more memory we'll use. */
@@ -71,66 +69,206 @@ static lookupkey_t intkey(uintptr_t key) {
   return k;
 }
 
-typedef uint32_t hashfunc_t(upb_tabkey key);
 typedef bool eqlfunc_t(upb_tabkey k1, lookupkey_t k2);
 
 /* Base table (shared code) ***************************************************/
 
-static uint32_t upb_inthash(uintptr_t key) { return (uint32_t)key; }
+/* Each entry has a control byte, which is either kCtrlEmpty, kCtrlRemoved, or
+ * the top seven bits of the hash of the entry's key.  Lookups compare a whole
+ * group of control bytes with the hash at once, and only compare the keys of
+ * the entries that match.  An entry is found among the groups that start at
+ * its hash's position in the table, probed in order, up to the first group
+ * that has an empty entry.  Removed entries are not empty, as that would cut
+ * short the probing of other keys; they are reused by inserts, and dropped
+ * when the table is rehashed.
+ *
+ * Groups need not be aligned, so the first kGroupSize - 1 control bytes are
+ * mirrored after the last one, and a group load never wraps around.  In tables
+ * smaller than a group, the mirror repeats the control bytes, so one group
+ * covers the whole table. */
+
+#define kCtrlEmpty ((uint8_t)0x80)
+#define kCtrlRemoved ((uint8_t)0xfe)
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+
+#define kGroupSize 16
+
+/* A set of entries in a group, as one bit per control byte. */
+typedef uint32_t groupmask_t;
+#define kGroupShift 0
+
+static groupmask_t group_match(const uint8_t* ctrl, uint8_t h2) {
+  __m128i g = _mm_loadu_si128((const __m128i*)ctrl);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)h2)));
+}
+
+static groupmask_t group_matchempty(const uint8_t* ctrl) {
+  return group_match(ctrl, kCtrlEmpty);
+}
+
+static groupmask_t group_matchfree(const uint8_t* ctrl) {
+  // Only kCtrlEmpty and kCtrlRemoved have their top bit set.
+  return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+}
+
+#else
+
+#define kGroupSize 8
+
+/* A set of entries in a group, as the top bit of each control byte. */
+typedef uint64_t groupmask_t;
+#define kGroupShift 3
+
+static const uint64_t kLsbs = 0x0101010101010101ULL;
+static const uint64_t kMsbs = 0x8080808080808080ULL;
+
+static uint64_t group_load(const uint8_t* ctrl) {
+  uint64_t g;
+  memcpy(&g, ctrl, sizeof(g));
+  int x = 1;
+  if (*(char*)&x != 1) {
+    // Big endian: the first control byte must be the lowest.
+    uint64_t swapped = 0;
+    for (int i = 0; i < 8; i++) {
+      swapped |= ((g >> (i * 8)) & 0xff) << (56 - i * 8);
+    }
+    g = swapped;
+  }
+  return g;
+}
+
+static groupmask_t group_match(const uint8_t* ctrl, uint8_t h2) {
+  // Finds the zero bytes of `g ^ h2`.  This can report a byte after a true
+  // match as a match too, which is harmless as keys are compared anyway.
+  uint64_t x = group_load(ctrl) ^ (kLsbs * h2);
+  return (x - kLsbs) & ~x & kMsbs;
+}
+
+static groupmask_t group_matchempty(const uint8_t* ctrl) {
+  // kCtrlEmpty is the only control byte with its top bit set and bit 1 clear.
+  uint64_t g = group_load(ctrl);
+  return g & ~(g << 6) & kMsbs;
+}
+
+static groupmask_t group_matchfree(const uint8_t* ctrl) {
+  return group_load(ctrl) & kMsbs;
+}
+
+#endif
+
+/* The index, within its group, of the first entry in `mask`. */
+static int group_first(groupmask_t mask) {
+#ifdef __GNUC__
+  return (sizeof(mask) == 8 ? __builtin_ctzll(mask) : __builtin_ctz(mask)) >>
+         kGroupShift;
+#else
+  int i = 0;
+  while (!(mask & 1)) {
+    mask >>= 1;
+    i++;
+  }
+  return i >> kGroupShift;
+#endif
+}
 
-static const upb_tabent* upb_getentry(const upb_table* t, uint32_t hash) {
-  return t->entries + (hash & t->mask);
+/* Fibonacci hashing, so that keys that differ only in their high bits, or
+ * that are multiples of the table size, are spread across the table. */
+static uint32_t upb_inthash(uintptr_t key) {
+  return (uint32_t)(((uint64_t)key * 0x9e3779b97f4a7c15ULL) >> 32);
 }
 
+static uint8_t upb_hash_h2(uint32_t hash) { return hash >> 25; }
+
 static bool upb_arrhas(upb_tabval key) { return key.val != (uint64_t)-1; }
 
-static bool isfull(upb_table* t) { return t->count == t->max_count; }
+static size_t ctrl_size(const upb_table* t) {
+  return upb_table_size(t) + kGroupSize - 1;
+}
+
+static void set_ctrl(upb_table* t, size_t i, uint8_t ctrl) {
+  size_t size = upb_table_size(t);
+  for (size_t j = i; j < ctrl_size(t); j += size) t->ctrl[j] = ctrl;
+}
 
-static bool init(upb_table* t, uint8_t size_lg2, upb_Arena* a) {
-  size_t bytes;
+/* The number of entries, live or removed, a table of 2^size_lg2 entries may
+ * hold.  At least one entry is always empty, which ends every probe. */
+static uint32_t max_count_for(uint8_t size_lg2, uint8_t max_load) {
+  if (size_lg2 == 0) return 0;
+  uint64_t size = (uint64_t)1 << size_lg2;
+  uint64_t max = size * max_load / 100;
+  return (uint32_t)UPB_MIN(max, size - 1);
+}
+
+/* The smallest table size (as lg2) that holds `count` entries. */
+static uint8_t size_lg2_for(size_t count, uint8_t max_load) {
+  uint8_t size_lg2 = 0;
+  while (max_count_for(size_lg2, max_load) < count) size_lg2++;
+  return size_lg2;
+}
 
+static bool isfull(upb_table* t) {
+  return t->count + t->removed >= t->max_count;
+}
+
+static bool init(upb_table* t, uint8_t size_lg2, uint8_t max_load,
+                 upb_Arena* a) {
   t->count = 0;
+  t->removed = 0;
   t->size_lg2 = size_lg2;
+  t->max_load = max_load;
   t->mask = upb_table_size(t) ? upb_table_size(t) - 1 : 0;
-  t->max_count = upb_table_size(t) * MAX_LOAD;
-  bytes = upb_table_size(t) * sizeof(upb_tabent);
-  if (bytes > 0) {
-    t->entries = upb_Arena_Malloc(a, bytes);
-    if (!t->entries) return false;
+  t->max_count = max_count_for(size_lg2, max_load);
+  if (upb_table_size(t) > 0) {
+    size_t bytes = upb_table_size(t) * sizeof(upb_tabent);
+    char* mem = upb_Arena_Malloc(a, bytes + ctrl_size(t));
+    if (!mem) return false;
+    t->entries = (upb_tabent*)mem;
+    t->ctrl = (uint8_t*)mem + bytes;
     memset(t->entries, 0, bytes);
+    memset(t->ctrl, kCtrlEmpty, ctrl_size(t));
   } else {
     t->entries = NULL;
+    t->ctrl = NULL;
   }
   return true;
 }
 
-static upb_tabent* emptyent(upb_table* t, upb_tabent* e) {
-  upb_tabent* begin = t->entries;
-  upb_tabent* end = begin + upb_table_size(t);
-  for (e = e + 1; e < end; e++) {
-    if (upb_tabent_isempty(e)) return e;
-  }
-  for (e = begin; e < end; e++) {
-    if (upb_tabent_isempty(e)) return e;
-  }
-  UPB_ASSERT(false);
-  return NULL;
+static void clear(upb_table* t) {
+  if (upb_table_size(t) == 0) return;
+  t->count = 0;
+  t->removed = 0;
+  memset(t->entries, 0, upb_table_size(t) * sizeof(upb_tabent));
+  memset(t->ctrl, kCtrlEmpty, ctrl_size(t));
 }
 
-static upb_tabent* getentry_mutable(upb_table* t, uint32_t hash) {
-  return (upb_tabent*)upb_getentry(t, hash);
+static void setmaxload(upb_table* t, uint8_t max_load) {
+  UPB_ASSERT(max_load > 0 && max_load < 100);
+  t->max_load = max_load;
+  t->max_count = max_count_for(t->size_lg2, max_load);
 }
 
+UPB_FORCEINLINE
 static const upb_tabent* findentry(const upb_table* t, lookupkey_t key,
                                    uint32_t hash, eqlfunc_t* eql) {
-  const upb_tabent* e;
-
   if (t->size_lg2 == 0) return NULL;
-  e = upb_getentry(t, hash);
-  if (upb_tabent_isempty(e)) return NULL;
+  uint8_t h2 = upb_hash_h2(hash);
+  size_t pos = hash & t->mask;
+  // Most keys are in the entry their hash maps to, so try that one first.
+  const upb_tabent* home = &t->entries[pos];
+  if (t->ctrl[pos] == h2 && eql(home->key, key)) return home;
+  size_t step = 0;
   while (1) {
-    if (eql(e->key, key)) return e;
-    if ((e = e->next) == NULL) return NULL;
+    const uint8_t* group = &t->ctrl[pos];
+    for (groupmask_t m = group_match(group, h2); m; m &= m - 1) {
+      const upb_tabent* e = &t->entries[(pos + group_first(m)) & t->mask];
+      if (eql(e->key, key)) return e;
+    }
+    if (group_matchempty(group)) return NULL;
+    step += kGroupSize;
+    pos = (pos + step) & t->mask;
   }
 }
 
@@ -139,6 +277,7 @@ static upb_tabent* findentry_mutable(upb_table* t, lookupkey_t key,
   return (upb_tabent*)findentry(t, key, hash, eql);
 }
 
+UPB_FORCEINLINE
 static bool lookup(const upb_table* t, lookupkey_t key, upb_value* v,
                    uint32_t hash, eqlfunc_t* eql) {
   const upb_tabent* e = findentry(t, key, hash, eql);
@@ -152,90 +291,54 @@ static bool lookup(const upb_table* t, lookupkey_t key, upb_value* v,
   }
 }
 
-/* The given key must not already exist in the table. */
+/* The given key must not already exist in the table, and the table must not
+ * be full. */
 static void insert(upb_table* t, lookupkey_t key, upb_tabkey tabkey,
-                   upb_value val, uint32_t hash, hashfunc_t* hashfunc,
-                   eqlfunc_t* eql) {
-  upb_tabent* mainpos_e;
-  upb_tabent* our_e;
-
+                   upb_value val, uint32_t hash, eqlfunc_t* eql) {
   UPB_ASSERT(findentry(t, key, hash, eql) == NULL);
-
+  UPB_ASSERT(!isfull(t));
+
+  size_t pos = hash & t->mask;
+  size_t step = 0;
+  groupmask_t free;
+  while (!(free = group_matchfree(&t->ctrl[pos]))) {
+    step += kGroupSize;
+    pos = (pos + step) & t->mask;
+  }
+  size_t i = (pos + group_first(free)) & t->mask;
+  if (t->ctrl[i] == kCtrlRemoved) t->removed--;
+  set_ctrl(t, i, upb_hash_h2(hash));
   t->count++;
-  mainpos_e = getentry_mutable(t, hash);
-  our_e = mainpos_e;
 
-  if (upb_tabent_isempty(mainpos_e)) {
-    /* Our main position is empty; use it. */
-    our_e->next = NULL;
-  } else {
-    /* Collision. */
-    upb_tabent* new_e = emptyent(t, mainpos_e);
-    /* Head of collider's chain. */
-    upb_tabent* chain = getentry_mutable(t, hashfunc(mainpos_e->key));
-    if (chain == mainpos_e) {
-      /* Existing ent is in its main position (it has the same hash as us, and
-       * is the head of our chain).  Insert to new ent and append to this chain.
-       */
-      new_e->next = mainpos_e->next;
-      mainpos_e->next = new_e;
-      our_e = new_e;
-    } else {
-      /* Existing ent is not in its main position (it is a node in some other
-       * chain).  This implies that no existing ent in the table has our hash.
-       * Evict it (updating its chain) and use its ent for head of our chain. */
-      *new_e = *mainpos_e; /* copies next. */
-      while (chain->next != mainpos_e) {
-        chain = (upb_tabent*)chain->next;
-        UPB_ASSERT(chain);
-      }
-      chain->next = new_e;
-      our_e = mainpos_e;
-      our_e->next = NULL;
-    }
-  }
-  our_e->key = tabkey;
-  our_e->val.val = val.val;
-  UPB_ASSERT(findentry(t, key, hash, eql) == our_e);
+  t->entries[i].key = tabkey;
+  t->entries[i].val.val = val.val;
+  UPB_ASSERT(findentry(t, key, hash, eql) == &t->entries[i]);
+}
+
+static void rment(upb_table* t, upb_tabent* e) {
+  size_t i = e - t->entries;
+  t->count--;
+  t->removed++;
+  set_ctrl(t, i, kCtrlRemoved);
+  e->key = 0; /* Make the slot empty. */
 }
 
 static bool rm(upb_table* t, lookupkey_t key, upb_value* val,
                upb_tabkey* removed, uint32_t hash, eqlfunc_t* eql) {
-  upb_tabent* chain = getentry_mutable(t, hash);
-  if (upb_tabent_isempty(chain)) return false;
-  if (eql(chain->key, key)) {
-    /* Element to remove is at the head of its chain. */
-    t->count--;
-    if (val) _upb_value_setval(val, chain->val.val);
-    if (removed) *removed = chain->key;
-    if (chain->next) {
-      upb_tabent* move = (upb_tabent*)chain->next;
-      *chain = *move;
-      move->key = 0; /* Make the slot empty. */
-    } else {
-      chain->key = 0; /* Make the slot empty. */
-    }
-    return true;
-  } else {
-    /* Element to remove is either in a non-head position or not in the
-     * table. */
-    while (chain->next && !eql(chain->next->key, key)) {
-      chain = (upb_tabent*)chain->next;
-    }
-    if (chain->next) {
-      /* Found element to remove. */
-      upb_tabent* rm = (upb_tabent*)chain->next;
-      t->count--;
-      if (val) _upb_value_setval(val, chain->next->val.val);
-      if (removed) *removed = rm->key;
-      rm->key = 0; /* Make the slot empty. */
-      chain->next = rm->next;
-      return true;
-    } else {
-      /* Element to remove is not in the table. */
-      return false;
-    }
-  }
+  upb_tabent* e = findentry_mutable(t, key, hash, eql);
+  if (!e) return false;
+  if (val) _upb_value_setval(val, e->val.val);
+  if (removed) *removed = e->key;
+  rment(t, e);
+  return true;
+}
+
+/* The size (as lg2) to rehash a full table into, so that it has room for one
+ * more entry: the same size if it is full mostly of removed entries, otherwise
+ * double, or more if its max load was lowered. */
+static uint8_t grown_size_lg2(const upb_table* t) {
+  if (t->count < t->max_count / 2) return t->size_lg2;
+  return UPB_MAX(t->size_lg2 + 1, size_lg2_for(t->count + 1, t->max_load));
 }
 
 static size_t next(const upb_table* t, size_t i) {
@@ -406,12 +509,6 @@ static uint32_t _upb_Hash_NoSeed(const char* p, size_t n) {
   return _upb_Hash(p, n, 0);
 }
 
-static uint32_t strhash(upb_tabkey key) {
-  uint32_t len;
-  char* str = upb_tabstr(key, &len);
-  return _upb_Hash_NoSeed(str, len);
-}
-
 static bool streql(upb_tabkey k1, lookupkey_t k2) {
   uint32_t len;
   char* str = upb_tabstr(k1, &len);
@@ -419,23 +516,19 @@ static bool streql(upb_tabkey k1, lookupkey_t k2) {
 }
 
 bool upb_strtable_init(upb_strtable* t, size_t expected_size, upb_Arena* a) {
-  // Multiply by approximate reciprocal of MAX_LOAD (0.85), with pow2
-  // denominator.
-  size_t need_entries = (expected_size + 1) * 1204 / 1024;
-  UPB_ASSERT(need_entries >= expected_size * 0.85);
-  int size_lg2 = upb_Log2Ceiling(need_entries);
-  return init(&t->t, size_lg2, a);
+  uint8_t max_load = UPB_TABLE_DEFAULT_MAX_LOAD;
+  return init(&t->t, size_lg2_for(expected_size, max_load), max_load, a);
 }
 
-void upb_strtable_clear(upb_strtable* t) {
-  size_t bytes = upb_table_size(&t->t) * sizeof(upb_tabent);
-  t->t.count = 0;
-  memset((char*)t->t.entries, 0, bytes);
+void upb_strtable_setmaxload(upb_strtable* t, uint8_t max_load) {
+  setmaxload(&t->t, max_load);
 }
 
+void upb_strtable_clear(upb_strtable* t) { clear(&t->t); }
+
 bool upb_strtable_resize(upb_strtable* t, size_t size_lg2, upb_Arena* a) {
   upb_strtable new_table;
-  if (!init(&new_table.t, size_lg2, a)) return false;
+  if (!init(&new_table.t, size_lg2, t->t.max_load, a)) return false;
 
   intptr_t iter = UPB_STRTABLE_BEGIN;
   upb_StringView key;
@@ -447,6 +540,11 @@ bool upb_strtable_resize(upb_strtable* t, size_t size_lg2, upb_Arena* a) {
   return true;
 }
 
+bool upb_strtable_reserve(upb_strtable* t, size_t count, upb_Arena* a) {
+  if (count + t->t.removed <= t->t.max_count) return true;
+  return upb_strtable_resize(t, size_lg2_for(count, t->t.max_load), a);
+}
+
 bool upb_strtable_insert(upb_strtable* t, const char* k, size_t len,
                          upb_value v, upb_Arena* a) {
   lookupkey_t key;
@@ -454,8 +552,9 @@ bool upb_strtable_insert(upb_strtable* t, const char* k, size_t len,
   uint32_t hash;
 
   if (isfull(&t->t)) {
-    /* Need to resize.  New table of double the size, add old elements to it. */
-    if (!upb_strtable_resize(t, t->t.size_lg2 + 1, a)) {
+    /* Need to rehash.  Add old elements to a new table, of double the size
+     * unless the old one was full mostly of removed entries. */
+    if (!upb_strtable_resize(t, grown_size_lg2(&t->t), a)) {
       return false;
     }
   }
@@ -465,7 +564,7 @@ bool upb_strtable_insert(upb_strtable* t, const char* k, size_t len,
   if (tabkey == 0) return false;
 
   hash = _upb_Hash_NoSeed(key.str.str, key.str.len);
-  insert(&t->t, key, tabkey, v, hash, &strhash, &streql);
+  insert(&t->t, key, tabkey, v, hash, &streql);
   return true;
 }
 
@@ -529,8 +628,6 @@ bool upb_strtable_iter_isequal(const upb_strtable_iter* i1,
 /* For inttables we use a hybrid structure where small keys are kept in an
  * array and large keys are put in the hash table. */
 
-static uint32_t inthash(upb_tabkey key) { return upb_inthash(key); }
-
 static bool inteql(upb_tabkey k1, lookupkey_t k2) { return k1 == k2.num; }
 
 static upb_tabval* mutable_array(upb_inttable* t) {
@@ -577,7 +674,7 @@ bool upb_inttable_sizedinit(upb_inttable* t, size_t asize, int hsize_lg2,
                             upb_Arena* a) {
   size_t array_bytes;
 
-  if (!init(&t->t, hsize_lg2, a)) return false;
+  if (!init(&t->t, hsize_lg2, UPB_TABLE_DEFAULT_MAX_LOAD, a)) return false;
   /* Always make the array part at least 1 long, so that we know key 0
    * won't be in the hash part, which simplifies things. */
   t->array_size = UPB_MAX(1, asize);
@@ -596,6 +693,10 @@ bool upb_inttable_init(upb_inttable* t, upb_Arena* a) {
   return upb_inttable_sizedinit(t, 0, 4, a);
 }
 
+void upb_inttable_setmaxload(upb_inttable* t, uint8_t max_load) {
+  setmaxload(&t->t, max_load);
+}
+
 bool upb_inttable_insert(upb_inttable* t, uintptr_t key, upb_value val,
                          upb_Arena* a) {
   upb_tabval tabval;
@@ -609,11 +710,11 @@ bool upb_inttable_insert(upb_inttable* t, uintptr_t key, upb_value val,
     mutable_array(t)[key].val = val.val;
   } else {
     if (isfull(&t->t)) {
-      /* Need to resize the hash part, but we re-use the array part. */
+      /* Need to rehash the hash part, but we re-use the array part. */
       size_t i;
       upb_table new_table;
 
-      if (!init(&new_table, t->t.size_lg2 + 1, a)) {
+      if (!init(&new_table, grown_size_lg2(&t->t), t->t.max_load, a)) {
         return false;
       }
 
@@ -624,14 +725,14 @@ bool upb_inttable_insert(upb_inttable* t, uintptr_t key, upb_value val,
 
         _upb_value_setval(&v, e->val.val);
         hash = upb_inthash(e->key);
-        insert(&new_table, intkey(e->key), e->key, v, hash, &inthash, &inteql);
+        insert(&new_table, intkey(e->key), e->key, v, hash, &inteql);
       }
 
       UPB_ASSERT(t->t.count == new_table.count);
 
       t->t = new_table;
     }
-    insert(&t->t, intkey(key), key, val, upb_inthash(key), &inthash, &inteql);
+    insert(&t->t, intkey(key), key, val, upb_inthash(key), &inteql);
   }
   check(t);
   return true;
@@ -713,10 +814,11 @@ void upb_inttable_compact(upb_inttable* t, upb_Arena* a) {
     /* Insert all elements into new, perfectly-sized table. */
     size_t arr_size = max[size_lg2] + 1; /* +1 so arr[max] will fit. */
     size_t hash_count = upb_inttable_count(t) - arr_count;
-    size_t hash_size = hash_count ? (hash_count / MAX_LOAD) + 1 : 0;
-    int hashsize_lg2 = log2ceil(hash_size);
+    uint8_t max_load = t->t.max_load;
+    int hashsize_lg2 = size_lg2_for(hash_count, max_load);
 
     upb_inttable_sizedinit(&new_t, arr_size, hashsize_lg2, a);
+    setmaxload(&new_t.t, max_load);
 
     {
       intptr_t iter = UPB_INTTABLE_BEGIN;
@@ -769,25 +871,7 @@ void upb_inttable_removeiter(upb_inttable* t, intptr_t* iter) {
     t->array_count--;
     mutable_array(t)[i].val = -1;
   } else {
-    upb_tabent* ent = &t->t.entries[i - t->array_size];
-    upb_tabent* prev = NULL;
-
-    // Linear search, not great.
-    upb_tabent* end = &t->t.entries[upb_table_size(&t->t)];
-    for (upb_tabent* e = t->t.entries; e != end; e++) {
-      if (e->next == ent) {
-        prev = e;
-        break;
-      }
-    }
-
-    if (prev) {
-      prev->next = ent->next;
-    }
-
-    t->t.count--;
-    ent->key = 0;
-    ent->next = NULL;
+    rment(&t->t, &t->t.entries[i - t->array_size]);
   }
 }
 
@@ -808,26 +892,7 @@ bool upb_strtable_next2(const upb_strtable* t, upb_StringView* key,
 }
 
 void upb_strtable_removeiter(upb_strtable* t, intptr_t* iter) {
-  intptr_t i = *iter;
-  upb_tabent* ent = &t->t.entries[i];
-  upb_tabent* prev = NULL;
-
-  // Linear search, not great.
-  upb_tabent* end = &t->t.entries[upb_table_size(&t->t)];
-  for (upb_tabent* e = t->t.entries; e != end; e++) {
-    if (e->next == ent) {
-      prev = e;
-      break;
-    }
-  }
-
-  if (prev) {
-    prev->next = ent->next;
-  }
-
-  t->t.count--;
-  ent->key = 0;
-  ent->next = NULL;
+  rment(&t->t, &t->t.entries[*iter]);
 }
 
 void upb_strtable_setentryvalue(upb_strtable* t, intptr_t iter, upb_value v) {
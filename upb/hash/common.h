@@ -12,9 +12,11 @@
  * This file defines very fast int->upb_value (inttable) and string->upb_value
  * (strtable) hash tables.
  *
- * The table uses chained scatter with Brent's variation (inspired by the Lua
- * implementation of hash tables).  The hash function for strings is Austin
- * Appleby's "MurmurHash."
+ * The table uses open addressing with a byte of control data per entry,
+ * holding seven bits of the entry's hash (inspired by Abseil's SwissTable).
+ * Lookups probe a group of control bytes at a time, with SSE2 where it is
+ * available, and only compare keys whose hash bits match.  The hash function
+ * for strings is Wyhash.
  *
  * The inttable uses uintptr_t as its key, which guarantees it can be used to
  * store pointers or integers of at least 32 bits (upb isn't really useful on
@@ -139,22 +141,22 @@ typedef struct upb_tabval {
 typedef struct _upb_tabent {
   upb_tabkey key;
   upb_tabval val;
-
-  /* Internal chaining.  This is const so we can create static initializers for
-   * tables.  We cast away const sometimes, but *only* when the containing
-   * upb_table is known to be non-const.  This requires a bit of care, but
-   * the subtlety is confined to table.c. */
-  const struct _upb_tabent* next;
 } upb_tabent;
 
 typedef struct {
   size_t count;       /* Number of entries in the hash part. */
   uint32_t mask;      /* Mask to turn hash value -> bucket. */
   uint32_t max_count; /* Max count before we hit our load limit. */
+  uint32_t removed;   /* Slots of removed entries, counted toward the load. */
   uint8_t size_lg2;   /* Size of the hashtable part is 2^size_lg2 entries. */
+  uint8_t max_load;   /* Max load factor, as a percentage. */
+  uint8_t* ctrl;      /* Control bytes of the entries; see common.c. */
   upb_tabent* entries;
 } upb_table;
 
+/* The max load factor of new tables, as a percentage. */
+#define UPB_TABLE_DEFAULT_MAX_LOAD 87
+
 UPB_INLINE size_t upb_table_size(const upb_table* t) {
   return t->size_lg2 ? 1 << t->size_lg2 : 0;
 }
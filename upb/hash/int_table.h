@@ -58,6 +58,11 @@ bool upb_inttable_replace(upb_inttable* t, uintptr_t key, upb_value val);
 // inserting more entries is legal, but will likely require a table resize.
 void upb_inttable_compact(upb_inttable* t, upb_Arena* a);
 
+// Sets the max load factor of the table, as a percentage between 1 and 99.
+// The table grows when its entries would exceed it.  Higher loads save memory
+// at the cost of longer probes.  The default is UPB_TABLE_DEFAULT_MAX_LOAD.
+void upb_inttable_setmaxload(upb_inttable* t, uint8_t max_load);
+
 // Iteration over inttable:
 //
 //   intptr_t iter = UPB_INTTABLE_BEGIN;
@@ -32,6 +32,11 @@ UPB_INLINE size_t upb_strtable_count(const upb_strtable* t) {
 
 void upb_strtable_clear(upb_strtable* t);
 
+// Sets the max load factor of the table, as a percentage between 1 and 99.
+// The table grows when its entries would exceed it.  Higher loads save memory
+// at the cost of longer probes.  The default is UPB_TABLE_DEFAULT_MAX_LOAD.
+void upb_strtable_setmaxload(upb_strtable* t, uint8_t max_load);
+
 // Inserts the given key into the hashtable with the given value.
 // The key must not already exist in the hash table. The key is not required
 // to be NULL-terminated, and the table will make an internal copy of the key.
@@ -62,6 +67,11 @@ UPB_INLINE bool upb_strtable_remove(upb_strtable* t, const char* key,
   return upb_strtable_remove2(t, key, strlen(key), v);
 }
 
+// Grows the table, if needed, so that it holds `count` values in all without
+// resizing again.  Returns false if memory allocation failed, in which case the
+// table is unchanged.
+bool upb_strtable_reserve(upb_strtable* t, size_t count, upb_Arena* a);
+
 // Exposed for testing only.
 bool upb_strtable_resize(upb_strtable* t, size_t size_lg2, upb_Arena* a);
 
@@ -229,6 +229,58 @@ TEST(Table, Delete) {
   }
 }
 
+TEST(Table, MaxLoad) {
+  upb::Arena arena;
+  upb_strtable low;
+  upb_strtable high;
+  upb_strtable_init(&low, 0, arena.ptr());
+  upb_strtable_init(&high, 0, arena.ptr());
+  upb_strtable_setmaxload(&low, 25);
+  upb_strtable_setmaxload(&high, 95);
+  for (int i = 0; i < 1000; i++) {
+    std::string key = std::to_string(i);
+    upb_value val = upb_value_int32(i);
+    upb_strtable_insert(&low, key.data(), key.size(), val, arena.ptr());
+    upb_strtable_insert(&high, key.data(), key.size(), val, arena.ptr());
+  }
+  EXPECT_LE(upb_strtable_count(&low), upb_table_size(&low.t) / 4);
+  EXPECT_LT(upb_table_size(&high.t), upb_table_size(&low.t));
+  for (int i = 0; i < 1000; i++) {
+    std::string key = std::to_string(i);
+    upb_value val;
+    EXPECT_TRUE(upb_strtable_lookup2(&low, key.data(), key.size(), &val));
+    EXPECT_EQ(upb_value_getint32(val), i);
+    EXPECT_TRUE(upb_strtable_lookup2(&high, key.data(), key.size(), &val));
+    EXPECT_EQ(upb_value_getint32(val), i);
+  }
+
+  // Lowering the max load takes effect on the next insert.
+  upb_strtable_setmaxload(&high, 25);
+  upb_strtable_insert(&high, "x", 1, upb_value_int32(0), arena.ptr());
+  EXPECT_LE(upb_strtable_count(&high), upb_table_size(&high.t) / 4);
+}
+
+TEST(Table, RemoveAndInsert) {
+  // Removed entries are reused or dropped, so a table whose entries are
+  // replaced over and over does not keep growing.
+  upb::Arena arena;
+  upb_inttable t;
+  upb_inttable_init(&t, arena.ptr());
+  for (uintptr_t key = 1000; key < 1100; key++) {
+    upb_inttable_insert(&t, key, upb_value_bool(true), arena.ptr());
+  }
+  size_t size = upb_table_size(&t.t);
+  for (uintptr_t key = 1000; key < 100000; key++) {
+    EXPECT_TRUE(upb_inttable_remove(&t, key, nullptr));
+    upb_inttable_insert(&t, key + 100, upb_value_bool(true), arena.ptr());
+  }
+  EXPECT_EQ(upb_inttable_count(&t), 100);
+  EXPECT_LE(upb_table_size(&t.t), 2 * size);
+  for (uintptr_t key = 100000; key < 100100; key++) {
+    EXPECT_TRUE(upb_inttable_lookup(&t, key, nullptr));
+  }
+}
+
 TEST(Table, Init) {
   for (int i = 0; i < 2048; i++) {
     /* Tests that the size calculations in init() (lg2 size for target load)
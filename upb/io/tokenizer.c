@@ -211,9 +211,13 @@ static void Refresh(upb_Tokenizer* t) {
   t->buffer = NULL;
   t->buffer_pos = 0;
 
-  upb_Status status;
-  const void* data =
-      upb_ZeroCopyInputStream_Next(t->input, &t->buffer_size, &status);
+  // A tokenizer over a flat array has no stream to continue with.
+  const void* data = NULL;
+  t->buffer_size = 0;
+  if (t->input != NULL) {
+    upb_Status status;
+    data = upb_ZeroCopyInputStream_Next(t->input, &t->buffer_size, &status);
+  }
 
   if (t->buffer_size > 0) {
     t->buffer = data;
@@ -994,7 +998,7 @@ upb_Tokenizer* upb_Tokenizer_New(const void* data, size_t size,
 void upb_Tokenizer_Fini(upb_Tokenizer* t) {
   // If we had any buffer left unread, return it to the underlying stream
   // so that someone else can read it.
-  if (t->buffer_size > t->buffer_pos) {
+  if (t->input != NULL && t->buffer_size > t->buffer_pos) {
     upb_ZeroCopyInputStream_BackUp(t->input, t->buffer_size - t->buffer_pos);
   }
 }
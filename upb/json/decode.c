@@ -38,6 +38,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "upb/base/string_view.h"
 #include "upb/lex/atoi.h"
 #include "upb/lex/unicode.h"
 #include "upb/message/map.h"
@@ -47,6 +48,10 @@
 // Must be last.
 #include "upb/port/def.inc"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 typedef struct {
   const char *ptr, *end;
   upb_Arena* arena; /* TODO: should we have a tmp arena for tmp data? */
@@ -107,6 +112,8 @@ UPB_NORETURN static void jsondec_errf(jsondec* d, const char* fmt, ...) {
 }
 
 static void jsondec_skipws(jsondec* d) {
+  /* Tokens are usually not preceded by whitespace. */
+  if (d->ptr != d->end && (unsigned char)*d->ptr > ' ') return;
   while (d->ptr != d->end) {
     switch (*d->ptr) {
       case '\n':
@@ -410,6 +417,30 @@ static void jsondec_resize(jsondec* d, char** buf, char** end, char** buf_end) {
   *buf_end = *buf + size;
 }
 
+/* Returns the first quote, backslash or control character in [ptr, end), or
+ * `end` if there is none.  Everything before it can be copied verbatim. */
+static const char* jsondec_scanstr(const char* ptr, const char* end) {
+#ifdef __SSE2__
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i max_ctrl = _mm_set1_epi8(0x1f);
+  while (end - ptr >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)ptr);
+    __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+        _mm_cmpeq_epi8(_mm_min_epu8(v, max_ctrl), v));
+    int mask = _mm_movemask_epi8(special);
+    if (mask) return ptr + __builtin_ctz(mask);
+    ptr += 16;
+  }
+#endif
+  while (ptr < end && *ptr != '"' && *ptr != '\\' &&
+         (unsigned char)*ptr >= 0x20) {
+    ptr++;
+  }
+  return ptr;
+}
+
 static upb_StringView jsondec_string(jsondec* d) {
   char* buf = NULL;
   char* end = NULL;
@@ -422,6 +453,19 @@ static upb_StringView jsondec_string(jsondec* d) {
   }
 
   while (d->ptr < d->end) {
+    const char* run = jsondec_scanstr(d->ptr, d->end);
+    size_t len = run - d->ptr;
+    if (len) {
+      /* Leave room for the NUL and another character. */
+      while ((size_t)(buf_end - end) < len + 1) {
+        jsondec_resize(d, &buf, &end, &buf_end);
+      }
+      memcpy(end, d->ptr, len);
+      end += len;
+      d->ptr = run;
+      if (d->ptr == d->end) break;
+    }
+
     char ch = *d->ptr++;
 
     if (end == buf_end) {
@@ -450,11 +494,7 @@ static upb_StringView jsondec_string(jsondec* d) {
         }
         break;
       default:
-        if ((unsigned char)*d->ptr < 0x20) {
-          jsondec_err(d, "Invalid char in JSON string");
-        }
-        *end++ = ch;
-        break;
+        jsondec_err(d, "Invalid char in JSON string");
     }
   }
 
@@ -462,6 +502,21 @@ eof:
   jsondec_err(d, "EOF inside string");
 }
 
+/* Like jsondec_string(), but points into the input instead of copying if the
+ * string has no escapes.  The result is not NUL-terminated. */
+static upb_StringView jsondec_stringref(jsondec* d) {
+  jsondec_skipws(d);
+  if (*d->ptr == '"') {
+    const char* start = d->ptr + 1;
+    const char* end = jsondec_scanstr(start, d->end);
+    if (end < d->end && *end == '"') {
+      d->ptr = end + 1;
+      return upb_StringView_FromDataAndSize(start, end - start);
+    }
+  }
+  return jsondec_string(d);
+}
+
 static void jsondec_skipval(jsondec* d) {
   switch (jsondec_peek(d)) {
     case JD_OBJECT:
@@ -890,7 +945,7 @@ static void jsondec_field(jsondec* d, upb_Message* msg,
   const upb_FieldDef* f;
   const upb_FieldDef* preserved;
 
-  name = jsondec_string(d);
+  name = jsondec_stringref(d);
   jsondec_entrysep(d);
 
   if (name.size >= 2 && name.data[0] == '[' &&
@@ -100,3 +100,29 @@ TEST(JsonTest, DecodeConflictJsonName) {
   EXPECT_EQ(2, upb_test_Box_new_value(box));
   EXPECT_EQ(0, upb_test_Box_value(box));
 }
+
+TEST(JsonTest, DecodeStrings) {
+  upb::Arena a;
+
+  // Long enough for the scan of unescaped runs to take several steps.
+  std::string long_name(100, 'x');
+  upb_test_Box* box =
+      JsonDecode(("{\"name\": \"" + long_name + "\"}").c_str(), a.ptr());
+  ASSERT_NE(box, nullptr);
+  upb_StringView name = upb_test_Box_name(box);
+  EXPECT_EQ(long_name, std::string(name.data, name.size));
+
+  box = JsonDecode(R"({"name": "abcdefghijklmnopq\"r\\sé\ntuvwxyz"})",
+                   a.ptr());
+  ASSERT_NE(box, nullptr);
+  name = upb_test_Box_name(box);
+  EXPECT_EQ("abcdefghijklmnopq\"r\\s\xc3\xa9\ntuvwxyz",
+            std::string(name.data, name.size));
+
+  // Control characters must be escaped, wherever they are in the string.
+  EXPECT_EQ(JsonDecode("{\"name\": \"\tabc\"}", a.ptr()), nullptr);
+  EXPECT_EQ(JsonDecode("{\"name\": \"abcdefghijklmnopqrstuv\n\"}", a.ptr()),
+            nullptr);
+  EXPECT_EQ(JsonDecode("{\"name\": \"abcdefghijklmnopqrstuv", a.ptr()),
+            nullptr);
+}
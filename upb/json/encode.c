@@ -37,6 +37,7 @@
 #include <stdarg.h>
 #include <string.h>
 
+#include "upb/lex/atoi.h"
 #include "upb/lex/round_trip.h"
 #include "upb/message/map.h"
 #include "upb/port/vsnprintf_compat.h"
@@ -108,6 +109,16 @@ static void jsonenc_putstr(jsonenc* e, const char* str) {
   jsonenc_putbytes(e, str, strlen(str));
 }
 
+static void jsonenc_int64(jsonenc* e, int64_t val) {
+  char buf[kUpb_Int64ToBufSize];
+  jsonenc_putbytes(e, buf, upb_Int64ToBuf(val, buf) - buf);
+}
+
+static void jsonenc_uint64(jsonenc* e, uint64_t val) {
+  char buf[kUpb_Int64ToBufSize];
+  jsonenc_putbytes(e, buf, upb_Uint64ToBuf(val, buf) - buf);
+}
+
 UPB_PRINTF(2, 3)
 static void jsonenc_printf(jsonenc* e, const char* fmt, ...) {
   size_t n;
@@ -228,9 +239,11 @@ static void jsonenc_enum(int32_t val, const upb_FieldDef* f, jsonenc* e) {
             : upb_EnumDef_FindValueByNumber(e_def, val);
 
     if (ev) {
-      jsonenc_printf(e, "\"%s\"", upb_EnumValueDef_Name(ev));
+      jsonenc_putstr(e, "\"");
+      jsonenc_putstr(e, upb_EnumValueDef_Name(ev));
+      jsonenc_putstr(e, "\"");
     } else {
-      jsonenc_printf(e, "%" PRId32, val);
+      jsonenc_int64(e, val);
     }
   }
 }
@@ -279,6 +292,15 @@ static void jsonenc_stringbody(jsonenc* e, upb_StringView str) {
   const char* end = UPB_PTRADD(ptr, str.size);
 
   while (ptr < end) {
+    // Copy the bytes that need no escaping in one go.  Non-ASCII bytes are
+    // among them, as we rely on the string being valid UTF-8.
+    const char* run = ptr;
+    while (ptr < end && (uint8_t)*ptr >= 0x20 && *ptr != '"' && *ptr != '\\') {
+      ptr++;
+    }
+    if (ptr != run) jsonenc_putbytes(e, run, ptr - run);
+    if (ptr == end) break;
+
     switch (*ptr) {
       case '\n':
         jsonenc_putstr(e, "\\n");
@@ -302,13 +324,7 @@ static void jsonenc_stringbody(jsonenc* e, upb_StringView str) {
         jsonenc_putstr(e, "\\\\");
         break;
       default:
-        if ((uint8_t)*ptr < 0x20) {
-          jsonenc_printf(e, "\\u%04x", (int)(uint8_t)*ptr);
-        } else {
-          /* This could be a non-ASCII byte.  We rely on the string being valid
-           * UTF-8. */
-          jsonenc_putbytes(e, ptr, 1);
-        }
+        jsonenc_printf(e, "\\u%04x", (int)(uint8_t)*ptr);
         break;
     }
     ptr++;
@@ -613,16 +629,20 @@ static void jsonenc_scalar(jsonenc* e, upb_MessageValue val,
       upb_JsonEncode_Double(e, val.double_val);
       break;
     case kUpb_CType_Int32:
-      jsonenc_printf(e, "%" PRId32, val.int32_val);
+      jsonenc_int64(e, val.int32_val);
       break;
     case kUpb_CType_UInt32:
-      jsonenc_printf(e, "%" PRIu32, val.uint32_val);
+      jsonenc_uint64(e, val.uint32_val);
       break;
     case kUpb_CType_Int64:
-      jsonenc_printf(e, "\"%" PRId64 "\"", val.int64_val);
+      jsonenc_putstr(e, "\"");
+      jsonenc_int64(e, val.int64_val);
+      jsonenc_putstr(e, "\"");
       break;
     case kUpb_CType_UInt64:
-      jsonenc_printf(e, "\"%" PRIu64 "\"", val.uint64_val);
+      jsonenc_putstr(e, "\"");
+      jsonenc_uint64(e, val.uint64_val);
+      jsonenc_putstr(e, "\"");
       break;
     case kUpb_CType_String:
       jsonenc_string(e, val.str_val);
@@ -648,16 +668,16 @@ static void jsonenc_mapkey(jsonenc* e, upb_MessageValue val,
       jsonenc_putstr(e, val.bool_val ? "true" : "false");
       break;
     case kUpb_CType_Int32:
-      jsonenc_printf(e, "%" PRId32, val.int32_val);
+      jsonenc_int64(e, val.int32_val);
       break;
     case kUpb_CType_UInt32:
-      jsonenc_printf(e, "%" PRIu32, val.uint32_val);
+      jsonenc_uint64(e, val.uint32_val);
       break;
     case kUpb_CType_Int64:
-      jsonenc_printf(e, "%" PRId64, val.int64_val);
+      jsonenc_int64(e, val.int64_val);
       break;
     case kUpb_CType_UInt64:
-      jsonenc_printf(e, "%" PRIu64, val.uint64_val);
+      jsonenc_uint64(e, val.uint64_val);
       break;
     case kUpb_CType_String:
       jsonenc_stringbody(e, val.str_val);
@@ -724,7 +744,9 @@ static void jsonenc_fieldval(jsonenc* e, const upb_FieldDef* f,
     } else {
       name = upb_FieldDef_JsonName(f);
     }
-    jsonenc_printf(e, "\"%s\":", name);
+    jsonenc_putstr(e, "\"");
+    jsonenc_putstr(e, name);
+    jsonenc_putstr(e, "\":");
   }
 
   if (upb_FieldDef_IsMap(f)) {
@@ -7,6 +7,8 @@
 
 #include "upb/lex/atoi.h"
 
+#include <string.h>
+
 // Must be last.
 #include "upb/port/def.inc"
 
@@ -46,3 +48,21 @@ const char* upb_BufToInt64(const char* ptr, const char* end, int64_t* val,
   if (is_neg) *is_neg = neg;
   return ptr;
 }
+
+char* upb_Uint64ToBuf(uint64_t val, char* buf) {
+  char tmp[kUpb_Int64ToBufSize];
+  char* ptr = tmp + sizeof(tmp);
+  do {
+    *--ptr = '0' + (val % 10);
+    val /= 10;
+  } while (val);
+  size_t n = tmp + sizeof(tmp) - ptr;
+  memcpy(buf, ptr, n);
+  return buf + n;
+}
+
+char* upb_Int64ToBuf(int64_t val, char* buf) {
+  if (val >= 0) return upb_Uint64ToBuf(val, buf);
+  *buf = '-';
+  return upb_Uint64ToBuf(-(uint64_t)val, buf + 1);
+}
@@ -26,6 +26,15 @@ const char* upb_BufToUint64(const char* ptr, const char* end, uint64_t* val);
 const char* upb_BufToInt64(const char* ptr, const char* end, int64_t* val,
                            bool* is_neg);
 
+// The inverses of the above, also used instead of snprintf() for speed.  They
+// write the decimal digits of `val` to `buf`, without a NUL terminator, and
+// return the position after the last digit.  `buf` must have room for at
+// least kUpb_Int64ToBufSize bytes.
+enum { kUpb_Int64ToBufSize = 20 };
+
+char* upb_Uint64ToBuf(uint64_t val, char* buf);
+char* upb_Int64ToBuf(int64_t val, char* buf);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -89,3 +89,28 @@ TEST(AtoiTest, Int64) {
     EXPECT_EQ(val, values[i]);
   }
 }
+
+TEST(AtoiTest, ToBuf) {
+  char buf[kUpb_Int64ToBufSize];
+
+  const uint64_t uvalues[] = {
+      0, 1, 9, 10, 99, 100, 12345678901234567,
+      std::numeric_limits<uint32_t>::max(),
+      std::numeric_limits<uint64_t>::max(),
+  };
+  for (size_t i = 0; i < ABSL_ARRAYSIZE(uvalues); i++) {
+    char* end = upb_Uint64ToBuf(uvalues[i], buf);
+    EXPECT_EQ(std::string(buf, end), absl::StrCat(uvalues[i]));
+  }
+
+  const int64_t values[] = {
+      0, -1, 10, -10, -12345678901234567,
+      std::numeric_limits<int32_t>::min(),
+      std::numeric_limits<int64_t>::max(),
+      std::numeric_limits<int64_t>::min(),
+  };
+  for (size_t i = 0; i < ABSL_ARRAYSIZE(values); i++) {
+    char* end = upb_Int64ToBuf(values[i], buf);
+    EXPECT_EQ(std::string(buf, end), absl::StrCat(values[i]));
+  }
+}
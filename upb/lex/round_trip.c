@@ -8,8 +8,11 @@
 #include "upb/lex/round_trip.h"
 
 #include <float.h>
+#include <math.h>
 #include <stdlib.h>
 
+#include "upb/lex/atoi.h"
+
 // Must be last.
 #include "upb/port/def.inc"
 
@@ -26,8 +29,19 @@ static void upb_FixLocale(char* p) {
   }
 }
 
+// Integral values that "%.*g" prints without an exponent are formatted as
+// integers, which is much cheaper than snprintf() and the strtod() check.
+// `limit` is 10^digits for the precision that is tried first.
+static bool upb_EncodeIntegral(double val, double limit, char* buf) {
+  if (!(val > -limit && val < limit) || val != (int64_t)val) return false;
+  if (val == 0 && signbit(val)) return false;  // "-0"
+  *upb_Int64ToBuf((int64_t)val, buf) = '\0';
+  return true;
+}
+
 void _upb_EncodeRoundTripDouble(double val, char* buf, size_t size) {
   assert(size >= kUpb_RoundTripBufferSize);
+  if (upb_EncodeIntegral(val, 1e15, buf)) return;
   snprintf(buf, size, "%.*g", DBL_DIG, val);
   if (strtod(buf, NULL) != val) {
     snprintf(buf, size, "%.*g", DBL_DIG + 2, val);
@@ -38,6 +52,7 @@ void _upb_EncodeRoundTripDouble(double val, char* buf, size_t size) {
 
 void _upb_EncodeRoundTripFloat(float val, char* buf, size_t size) {
   assert(size >= kUpb_RoundTripBufferSize);
+  if (upb_EncodeIntegral(val, 1e6, buf)) return;
   snprintf(buf, size, "%.*g", FLT_DIG, val);
   if (strtof(buf, NULL) != val) {
     snprintf(buf, size, "%.*g", FLT_DIG + 3, val);
@@ -69,12 +69,7 @@ size_t upb_Arena_SpaceAllocated(upb_Arena* arena) {
   size_t memsize = 0;
 
   while (arena != NULL) {
-    _upb_MemBlock* block =
-        upb_Atomic_Load(&arena->blocks, memory_order_relaxed);
-    while (block != NULL) {
-      memsize += sizeof(_upb_MemBlock) + block->size;
-      block = upb_Atomic_Load(&block->next, memory_order_relaxed);
-    }
+    memsize += upb_Atomic_Load(&arena->space_allocated, memory_order_relaxed);
     arena = upb_Atomic_Load(&arena->next, memory_order_relaxed);
   }
 
@@ -99,6 +94,12 @@ static void upb_Arena_AddBlock(upb_Arena* a, void* ptr, size_t size) {
   block->size = (uint32_t)size;
   upb_Atomic_Init(&block->next, a->blocks);
   upb_Atomic_Store(&a->blocks, block, memory_order_release);
+  // Only the thread allocating from `a` writes this, so a plain add is enough.
+  upb_Atomic_Store(
+      &a->space_allocated,
+      upb_Atomic_Load(&a->space_allocated, memory_order_relaxed) +
+          sizeof(_upb_MemBlock) + size,
+      memory_order_relaxed);
 
   a->head.ptr = UPB_PTR_AT(block, memblock_reserve, char);
   a->head.end = UPB_PTR_AT(block, size, char);
@@ -124,16 +125,88 @@ void* _upb_Arena_SlowMalloc(upb_Arena* a, size_t size) {
   return upb_Arena_Malloc(a, size);
 }
 
+/* Initial block cache ********************************************************/
+
+// Arenas created without an initial block of the user's all start with a block
+// of this size, which also holds the upb_Arena itself.
+static const size_t first_block_size =
+    sizeof(upb_Arena) + UPB_ALIGN_UP(sizeof(_upb_MemBlock), UPB_MALLOC_ALIGN) +
+    256;
+
+typedef struct {
+  upb_alloc* alloc;
+  void* mem;
+} _upb_ArenaCacheEntry;
+
+// Each thread keeps the first blocks of the arenas it frees, with the
+// allocator they came from, and hands them out again to the next arenas it
+// creates with the same allocator.  Most recently freed last.
+typedef struct {
+  _upb_ArenaCacheEntry entries[kUpb_Arena_MaxCachedBlocks];
+  size_t size;
+  upb_ArenaCacheStats stats;
+} _upb_ArenaCache;
+
+static UPB_THREAD_LOCAL _upb_ArenaCache arena_cache;
+
+static UPB_ATOMIC(size_t) max_cached_blocks;
+
+static size_t _upb_ArenaCache_MaxBlocks(void) {
+  return upb_Atomic_Load(&max_cached_blocks, memory_order_relaxed);
+}
+
+static void* _upb_ArenaCache_Take(upb_alloc* alloc) {
+  _upb_ArenaCache* cache = &arena_cache;
+  for (size_t i = cache->size; i > 0; i--) {
+    _upb_ArenaCacheEntry* entry = &cache->entries[i - 1];
+    if (entry->alloc != alloc) continue;
+    void* mem = entry->mem;
+    *entry = cache->entries[--cache->size];
+    cache->stats.hits++;
+    UPB_UNPOISON_MEMORY_REGION(mem, first_block_size);
+    return mem;
+  }
+  if (_upb_ArenaCache_MaxBlocks() > 0) cache->stats.misses++;
+  return NULL;
+}
+
+static bool _upb_ArenaCache_Put(upb_alloc* alloc, void* mem) {
+  _upb_ArenaCache* cache = &arena_cache;
+  if (cache->size >= _upb_ArenaCache_MaxBlocks()) return false;
+  cache->entries[cache->size++] = (_upb_ArenaCacheEntry){alloc, mem};
+  UPB_POISON_MEMORY_REGION(mem, first_block_size);
+  return true;
+}
+
+static void _upb_ArenaCache_Trim(size_t max_blocks) {
+  _upb_ArenaCache* cache = &arena_cache;
+  while (cache->size > max_blocks) {
+    _upb_ArenaCacheEntry* entry = &cache->entries[--cache->size];
+    UPB_UNPOISON_MEMORY_REGION(entry->mem, first_block_size);
+    upb_free(entry->alloc, entry->mem);
+  }
+}
+
+void upb_Arena_SetMaxCachedBlocks(size_t max_blocks) {
+  max_blocks = UPB_MIN(max_blocks, kUpb_Arena_MaxCachedBlocks);
+  upb_Atomic_Store(&max_cached_blocks, max_blocks, memory_order_relaxed);
+  _upb_ArenaCache_Trim(max_blocks);
+}
+
+void upb_Arena_ReleaseCachedBlocks(void) { _upb_ArenaCache_Trim(0); }
+
+upb_ArenaCacheStats upb_Arena_GetCacheStats(void) { return arena_cache.stats; }
+
 /* Public Arena API ***********************************************************/
 
 static upb_Arena* upb_Arena_InitSlow(upb_alloc* alloc) {
-  const size_t first_block_overhead = sizeof(upb_Arena) + memblock_reserve;
   upb_Arena* a;
 
-  /* We need to malloc the initial block. */
+  /* We need to malloc the initial block, unless a cached one is available. */
   char* mem;
-  size_t n = first_block_overhead + 256;
-  if (!alloc || !(mem = upb_malloc(alloc, n))) {
+  size_t n = first_block_size;
+  if (!alloc) return NULL;
+  if (!(mem = _upb_ArenaCache_Take(alloc)) && !(mem = upb_malloc(alloc, n))) {
     return NULL;
   }
 
@@ -145,6 +218,7 @@ static upb_Arena* upb_Arena_InitSlow(upb_alloc* alloc) {
   upb_Atomic_Init(&a->next, NULL);
   upb_Atomic_Init(&a->tail, a);
   upb_Atomic_Init(&a->blocks, NULL);
+  upb_Atomic_Init(&a->space_allocated, 0);
 
   upb_Arena_AddBlock(a, mem, n);
 
@@ -176,6 +250,7 @@ upb_Arena* upb_Arena_Init(void* mem, size_t n, upb_alloc* alloc) {
   upb_Atomic_Init(&a->next, NULL);
   upb_Atomic_Init(&a->tail, a);
   upb_Atomic_Init(&a->blocks, NULL);
+  upb_Atomic_Init(&a->space_allocated, 0);
   a->block_alloc = upb_Arena_MakeBlockAlloc(alloc, 1);
   a->head.ptr = mem;
   a->head.end = UPB_PTR_AT(mem, n - sizeof(*a), char);
@@ -186,6 +261,12 @@ upb_Arena* upb_Arena_Init(void* mem, size_t n, upb_alloc* alloc) {
 static void arena_dofree(upb_Arena* a) {
   UPB_ASSERT(_upb_Arena_RefCountFromTagged(a->parent_or_count) == 1);
 
+  // The first block of an arena that was never fused may be cached.  It is
+  // the last one in the list, and the one that holds the arena.
+  bool cache_first_block =
+      !upb_Arena_HasInitialBlock(a) &&
+      upb_Atomic_Load(&a->next, memory_order_relaxed) == NULL;
+
   while (a != NULL) {
     // Load first since arena itself is likely from one of its blocks.
     upb_Arena* next_arena =
@@ -196,7 +277,10 @@ static void arena_dofree(upb_Arena* a) {
       // Load first since we are deleting block.
       _upb_MemBlock* next_block =
           upb_Atomic_Load(&block->next, memory_order_acquire);
-      upb_free(block_alloc, block);
+      if (next_block != NULL || !cache_first_block ||
+          !_upb_ArenaCache_Put(block_alloc, block)) {
+        upb_free(block_alloc, block);
+      }
       block = next_block;
     }
     a = next_arena;
@@ -291,12 +375,18 @@ static upb_Arena* _upb_Arena_DoFuse(upb_Arena* a1, upb_Arena* a2,
   // different node, during a previous and failed DoFuse() attempt. But we will
   // not lose track of these refs because we always add them to our overall
   // delta.
+  //
+  // If only the refcount of `r1` changed under us, `r1` is still a root and
+  // we can retry right away, without walking both trees again.
   uintptr_t r2_untagged_count = r2.tagged_count & ~1;
-  uintptr_t with_r2_refs = r1.tagged_count + r2_untagged_count;
-  if (!upb_Atomic_CompareExchangeStrong(
-          &r1.root->parent_or_count, &r1.tagged_count, with_r2_refs,
-          memory_order_release, memory_order_acquire)) {
-    return NULL;
+  while (true) {
+    uintptr_t with_r2_refs = r1.tagged_count + r2_untagged_count;
+    if (upb_Atomic_CompareExchangeStrong(
+            &r1.root->parent_or_count, &r1.tagged_count, with_r2_refs,
+            memory_order_release, memory_order_acquire)) {
+      break;
+    }
+    if (_upb_Arena_IsTaggedPointer(r1.tagged_count)) return NULL;
   }
 
   // Perform the actual fuse by removing the refs from `r2` and swapping in the
@@ -328,6 +418,17 @@ static bool _upb_Arena_FixupRefs(upb_Arena* new_root, uintptr_t ref_delta) {
                                           memory_order_relaxed);
 }
 
+static void _upb_Arena_FuseUnchecked(upb_Arena* a1, upb_Arena* a2) {
+  // The number of refs we ultimately need to transfer to the new root.
+  uintptr_t ref_delta = 0;
+  while (true) {
+    upb_Arena* new_root = _upb_Arena_DoFuse(a1, a2, &ref_delta);
+    if (new_root != NULL && _upb_Arena_FixupRefs(new_root, ref_delta)) {
+      return;
+    }
+  }
+}
+
 bool upb_Arena_Fuse(upb_Arena* a1, upb_Arena* a2) {
   if (a1 == a2) return true;  // trivial fuse
 
@@ -337,13 +438,39 @@ bool upb_Arena_Fuse(upb_Arena* a1, upb_Arena* a2) {
     return false;
   }
 
-  // The number of refs we ultimately need to transfer to the new root.
-  uintptr_t ref_delta = 0;
+  _upb_Arena_FuseUnchecked(a1, a2);
+  return true;
+}
+
+bool upb_Arena_FuseMany(upb_Arena* const* arenas, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (upb_Arena_HasInitialBlock(arenas[i])) return false;
+  }
+  if (n < 2) return true;
+
+  // Fuse into whichever root the first fuse produces.  Later fuses then find
+  // the root of `into` in a single step, as the walks before them have
+  // flattened its path, and the tree stays shallow since every arena is
+  // attached at the top.
+  upb_Arena* into = arenas[0];
+  for (size_t i = 1; i < n; i++) {
+    if (arenas[i] == into) continue;
+    _upb_Arena_FuseUnchecked(into, arenas[i]);
+    into = _upb_Arena_FindRoot(into).root;
+  }
+  return true;
+}
+
+bool upb_Arena_IsFused(upb_Arena* a, upb_Arena* b) {
+  if (a == b) return true;
   while (true) {
-    upb_Arena* new_root = _upb_Arena_DoFuse(a1, a2, &ref_delta);
-    if (new_root != NULL && _upb_Arena_FixupRefs(new_root, ref_delta)) {
-      return true;
-    }
+    upb_Arena* ra = _upb_Arena_FindRoot(a).root;
+    upb_Arena* rb = _upb_Arena_FindRoot(b).root;
+    if (ra == rb) return true;
+    // If `ra` is still a root, it was one when `rb` was found too, so the
+    // arenas were not fused at that point.  Otherwise a fuse raced with us.
+    uintptr_t poc = upb_Atomic_Load(&ra->parent_or_count, memory_order_acquire);
+    if (!_upb_Arena_IsTaggedPointer(poc)) return false;
   }
 }
 
@@ -353,16 +480,16 @@ bool upb_Arena_IncRefFor(upb_Arena* arena, const void* owner) {
 
 retry:
   r = _upb_Arena_FindRoot(arena);
-  if (upb_Atomic_CompareExchangeWeak(
-          &r.root->parent_or_count, &r.tagged_count,
-          _upb_Arena_TaggedFromRefcount(
-              _upb_Arena_RefCountFromTagged(r.tagged_count) + 1),
-          memory_order_release, memory_order_acquire)) {
-    // We incremented it successfully, so we are done.
-    return true;
+  while (!upb_Atomic_CompareExchangeWeak(
+      &r.root->parent_or_count, &r.tagged_count,
+      _upb_Arena_TaggedFromRefcount(
+          _upb_Arena_RefCountFromTagged(r.tagged_count) + 1),
+      memory_order_release, memory_order_acquire)) {
+    // If only the refcount changed, the root is unchanged and we can retry
+    // on it directly.  Otherwise the arena was fused into another root.
+    if (_upb_Arena_IsTaggedPointer(r.tagged_count)) goto retry;
   }
-  // We failed update due to parent switching on the arena.
-  goto retry;
+  return true;
 }
 
 void upb_Arena_DecRefFor(upb_Arena* arena, const void* owner) {
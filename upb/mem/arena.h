@@ -47,10 +47,57 @@ UPB_API upb_Arena* upb_Arena_Init(void* mem, size_t n, upb_alloc* alloc);
 UPB_API void upb_Arena_Free(upb_Arena* a);
 UPB_API bool upb_Arena_Fuse(upb_Arena* a, upb_Arena* b);
 
+// Fuses all `n` arenas together, like calling upb_Arena_Fuse() on each of them
+// and the first one, but with less contention on the shared root.  Returns
+// false, and fuses nothing, if any of the arenas has an initial block.
+UPB_API bool upb_Arena_FuseMany(upb_Arena* const* arenas, size_t n);
+
+// Returns whether `a` and `b` have been fused, so that memory allocated from
+// either of them lives as long as both.
+UPB_API bool upb_Arena_IsFused(upb_Arena* a, upb_Arena* b);
+
+// Creating an arena without an initial block mallocs its first block, and
+// freeing it frees the block again.  Programs that create many short-lived
+// arenas can let each thread keep the first blocks of arenas it frees, so that
+// the next arenas it creates with the same upb_alloc reuse them.  Only arenas
+// that were never fused give back their first block.
+//
+// The cache is disabled by default.  Blocks cached by a thread are not freed
+// when the thread exits, so threads should call
+// upb_Arena_ReleaseCachedBlocks() before exiting.  A thread that exits without
+// doing so leaks its cached blocks, so do not enable the cache in programs that
+// start and stop threads they do not control, such as language bindings.
+//
+// Cached blocks are matched to arenas by the address of their upb_alloc, and
+// are freed through it.  A upb_alloc must therefore outlive the caches of all
+// threads that created arenas with it: release them before freeing it, or a
+// later upb_alloc at the same address could be handed its blocks.
+
+#define kUpb_Arena_MaxCachedBlocks 16
+
+// Sets how many blocks each thread may cache, at most
+// kUpb_Arena_MaxCachedBlocks, for all threads.  0 disables the cache.  Blocks
+// cached by the calling thread beyond the new limit are freed.
+UPB_API void upb_Arena_SetMaxCachedBlocks(size_t max_blocks);
+
+// Frees the blocks cached by the calling thread.
+UPB_API void upb_Arena_ReleaseCachedBlocks(void);
+
+typedef struct {
+  size_t hits;    // Arenas whose first block came from the cache.
+  size_t misses;  // Arenas that had to malloc it while the cache was enabled.
+} upb_ArenaCacheStats;
+
+// Returns the cache statistics of the calling thread.
+UPB_API upb_ArenaCacheStats upb_Arena_GetCacheStats(void);
+
 bool upb_Arena_IncRefFor(upb_Arena* arena, const void* owner);
 void upb_Arena_DecRefFor(upb_Arena* arena, const void* owner);
 
 void* _upb_Arena_SlowMalloc(upb_Arena* a, size_t size);
+
+// Returns the memory held by `arena` and all arenas fused with it.  This takes
+// time proportional to the number of fused arenas, not to their blocks.
 size_t upb_Arena_SpaceAllocated(upb_Arena* arena);
 uint32_t upb_Arena_DebugRefCount(upb_Arena* arena);
 
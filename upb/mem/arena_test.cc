@@ -62,6 +62,118 @@ TEST(ArenaTest, FuseWithInitialBlock) {
   for (int i = 0; i < size; ++i) upb_Arena_Free(arenas[i]);
 }
 
+TEST(ArenaTest, FuseMany) {
+  std::vector<upb_Arena*> arenas;
+  for (int i = 0; i < 16; ++i) arenas.push_back(upb_Arena_New());
+  // Fusing an arena with itself, or twice, is harmless.
+  arenas.push_back(arenas[3]);
+  EXPECT_TRUE(upb_Arena_FuseMany(arenas.data(), arenas.size()));
+  arenas.pop_back();
+  // All arenas share one root, holding one ref for each of them.
+  for (upb_Arena* arena : arenas) {
+    EXPECT_EQ(upb_Arena_DebugRefCount(arena), 16);
+  }
+
+  // Each arena keeps the fused group alive until it is freed.
+  for (upb_Arena* arena : arenas) {
+    upb_Arena_Malloc(arena, 1);
+    upb_Arena_Free(arena);
+  }
+}
+
+TEST(ArenaTest, FuseManyWithInitialBlock) {
+  char buf[1024];
+  upb_Arena* arenas[] = {upb_Arena_New(), upb_Arena_New(),
+                         upb_Arena_Init(buf, 1024, &upb_alloc_global)};
+  EXPECT_FALSE(upb_Arena_FuseMany(arenas, 3));
+  // Nothing was fused.
+  EXPECT_EQ(upb_Arena_DebugRefCount(arenas[0]), 1);
+  EXPECT_TRUE(upb_Arena_FuseMany(arenas, 2));
+  EXPECT_EQ(upb_Arena_DebugRefCount(arenas[0]), 2);
+  for (upb_Arena* arena : arenas) upb_Arena_Free(arena);
+}
+
+TEST(ArenaTest, IsFused) {
+  upb_Arena* a = upb_Arena_New();
+  upb_Arena* b = upb_Arena_New();
+  upb_Arena* c = upb_Arena_New();
+  EXPECT_TRUE(upb_Arena_IsFused(a, a));
+  EXPECT_FALSE(upb_Arena_IsFused(a, b));
+  EXPECT_TRUE(upb_Arena_Fuse(a, b));
+  EXPECT_TRUE(upb_Arena_IsFused(a, b));
+  EXPECT_TRUE(upb_Arena_IsFused(b, a));
+  EXPECT_FALSE(upb_Arena_IsFused(c, b));
+  EXPECT_TRUE(upb_Arena_Fuse(c, b));
+  EXPECT_TRUE(upb_Arena_IsFused(a, c));
+  upb_Arena_Free(a);
+  upb_Arena_Free(b);
+  upb_Arena_Free(c);
+}
+
+TEST(ArenaTest, SpaceAllocated) {
+  upb_Arena* arena1 = upb_Arena_New();
+  upb_Arena* arena2 = upb_Arena_New();
+  size_t size1 = upb_Arena_SpaceAllocated(arena1);
+  size_t size2 = upb_Arena_SpaceAllocated(arena2);
+  EXPECT_GT(size1, 0);
+
+  upb_Arena_Malloc(arena1, 10000);
+  EXPECT_GT(upb_Arena_SpaceAllocated(arena1), size1 + 10000);
+  size1 = upb_Arena_SpaceAllocated(arena1);
+
+  // Fused arenas report the memory of the whole group.
+  EXPECT_TRUE(upb_Arena_Fuse(arena1, arena2));
+  EXPECT_EQ(upb_Arena_SpaceAllocated(arena1), size1 + size2);
+  EXPECT_EQ(upb_Arena_SpaceAllocated(arena2), size1 + size2);
+
+  upb_Arena_Free(arena1);
+  upb_Arena_Free(arena2);
+}
+
+TEST(ArenaTest, CachedBlocks) {
+  upb_Arena_SetMaxCachedBlocks(2);
+  upb_ArenaCacheStats stats = upb_Arena_GetCacheStats();
+
+  upb_Arena* arena1 = upb_Arena_New();
+  upb_Arena* arena2 = upb_Arena_New();
+  upb_Arena* arena3 = upb_Arena_New();
+  upb_Arena_Malloc(arena1, 10000);
+  upb_Arena_Free(arena1);
+  upb_Arena_Free(arena2);
+  upb_Arena_Free(arena3);  // Does not fit.
+  EXPECT_EQ(upb_Arena_GetCacheStats().misses, stats.misses + 3);
+
+  // The most recently freed block is reused first, and the arena is placed at
+  // the same address within it.
+  upb_Arena* reused = upb_Arena_New();
+  EXPECT_EQ(reused, arena2);
+  EXPECT_EQ(upb_Arena_GetCacheStats().hits, stats.hits + 1);
+  upb_Arena* reused_after_growth = upb_Arena_New();
+  EXPECT_EQ(reused_after_growth, arena1);
+  EXPECT_EQ(upb_Arena_SpaceAllocated(reused_after_growth),
+            upb_Arena_SpaceAllocated(reused));
+
+  // Fused arenas do not give back their blocks.
+  EXPECT_TRUE(upb_Arena_Fuse(reused, reused_after_growth));
+  upb_Arena_Free(reused);
+  upb_Arena_Free(reused_after_growth);
+  stats = upb_Arena_GetCacheStats();
+  upb_Arena* arena = upb_Arena_New();
+  EXPECT_EQ(upb_Arena_GetCacheStats().hits, stats.hits);
+  upb_Arena_Free(arena);
+
+  upb_Arena_ReleaseCachedBlocks();
+  stats = upb_Arena_GetCacheStats();
+  arena = upb_Arena_New();
+  EXPECT_EQ(upb_Arena_GetCacheStats().misses, stats.misses + 1);
+  upb_Arena_Free(arena);
+
+  upb_Arena_SetMaxCachedBlocks(0);
+  stats = upb_Arena_GetCacheStats();
+  upb_Arena_Free(upb_Arena_New());
+  EXPECT_EQ(upb_Arena_GetCacheStats().misses, stats.misses);
+}
+
 class Environment {
  public:
   ~Environment() {
@@ -42,6 +42,10 @@ struct upb_Arena {
   // Linked list of blocks to free/cleanup.  Atomic only for the benefit of
   // upb_Arena_SpaceAllocated().
   UPB_ATOMIC(_upb_MemBlock*) blocks;
+
+  // The total size of `blocks`, so that upb_Arena_SpaceAllocated() does not
+  // have to walk them.
+  UPB_ATOMIC(size_t) space_allocated;
 };
 
 UPB_INLINE bool _upb_Arena_IsTaggedRefcount(uintptr_t parent_or_count) {
@@ -86,6 +86,23 @@ bool upb_Array_Append(upb_Array* arr, upb_MessageValue val, upb_Arena* arena) {
   return true;
 }
 
+bool upb_Array_AppendN(upb_Array* arr, const void* data, size_t count,
+                       upb_Arena* arena) {
+  UPB_ASSERT(arena);
+  UPB_ASSERT(arr->size + count >= count);
+  const size_t oldsize = arr->size;
+  if (UPB_UNLIKELY(
+          !_upb_Array_ResizeUninitialized(arr, oldsize + count, arena))) {
+    return false;
+  }
+  if (count) {
+    const int lg2 = arr->data & 7;
+    char* dst = _upb_array_ptr(arr);
+    memcpy(dst + (oldsize << lg2), data, count << lg2);
+  }
+  return true;
+}
+
 void upb_Array_Move(upb_Array* arr, size_t dst_idx, size_t src_idx,
                     size_t count) {
   const int lg2 = arr->data & 7;
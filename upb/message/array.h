@@ -62,6 +62,12 @@ UPB_API void upb_Array_Set(upb_Array* arr, size_t i, upb_MessageValue val);
 UPB_API bool upb_Array_Append(upb_Array* array, upb_MessageValue val,
                               upb_Arena* arena);
 
+// Appends `count` elements to the array, copying them from `data`, which must
+// hold elements of the array's type laid out as in upb_Array_DataPtr().
+// Returns false on allocation failure.
+UPB_API bool upb_Array_AppendN(upb_Array* array, const void* data,
+                               size_t count, upb_Arena* arena);
+
 // Moves elements within the array using memmove().
 // Like memmove(), the source and destination elements may be overlapping.
 UPB_API void upb_Array_Move(upb_Array* array, size_t dst_idx, size_t src_idx,
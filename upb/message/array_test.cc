@@ -64,3 +64,21 @@ TEST(ArrayTest, Resize) {
   EXPECT_EQ(upb_Array_Get(array, 4).int32_val, 0);
   EXPECT_EQ(upb_Array_Get(array, 5).int32_val, 0);
 }
+
+TEST(ArrayTest, AppendN) {
+  upb::Arena arena;
+
+  upb_Array* array = upb_Array_New(arena.ptr(), kUpb_CType_Int64);
+  EXPECT_TRUE(array);
+  EXPECT_TRUE(upb_Array_AppendN(array, nullptr, 0, arena.ptr()));
+  EXPECT_EQ(upb_Array_Size(array), 0);
+
+  int64_t values[100];
+  for (int i = 0; i < 100; i++) values[i] = -i;
+  EXPECT_TRUE(upb_Array_AppendN(array, values, 3, arena.ptr()));
+  EXPECT_TRUE(upb_Array_AppendN(array, values, 100, arena.ptr()));
+  EXPECT_EQ(upb_Array_Size(array), 103);
+  EXPECT_EQ(upb_Array_Get(array, 2).int64_val, -2);
+  EXPECT_EQ(upb_Array_Get(array, 3).int64_val, 0);
+  EXPECT_EQ(upb_Array_Get(array, 102).int64_val, -99);
+}
@@ -14,6 +14,7 @@
 #include "upb/base/string_view.h"
 #include "upb/mem/arena.h"
 #include "upb/message/accessors.h"
+#include "upb/message/internal/array.h"
 #include "upb/message/internal/message.h"
 #include "upb/message/message.h"
 #include "upb/mini_table/field.h"
@@ -38,8 +39,13 @@ static upb_StringView upb_Clone_StringView(upb_StringView str,
   return cloned_str;
 }
 
+static upb_Message* _upb_Message_DeepClone(const upb_Message* message,
+                                           const upb_MiniTable* mini_table,
+                                           upb_Arena* arena, bool alias);
+
 static bool upb_Clone_MessageValue(void* value, upb_CType value_type,
-                                   const upb_MiniTable* sub, upb_Arena* arena) {
+                                   const upb_MiniTable* sub, upb_Arena* arena,
+                                   bool alias) {
   switch (value_type) {
     case kUpb_CType_Bool:
     case kUpb_CType_Float:
@@ -52,6 +58,7 @@ static bool upb_Clone_MessageValue(void* value, upb_CType value_type,
       return true;
     case kUpb_CType_String:
     case kUpb_CType_Bytes: {
+      if (alias) return true;
       upb_StringView source = *(upb_StringView*)value;
       int size = source.size;
       void* cloned_data = upb_Arena_Malloc(arena, size);
@@ -68,8 +75,8 @@ static bool upb_Clone_MessageValue(void* value, upb_CType value_type,
       bool is_empty = upb_TaggedMessagePtr_IsEmpty(source);
       if (is_empty) sub = &_kUpb_MiniTable_Empty;
       UPB_ASSERT(source);
-      upb_Message* clone = upb_Message_DeepClone(
-          _upb_TaggedMessagePtr_GetMessage(source), sub, arena);
+      upb_Message* clone = _upb_Message_DeepClone(
+          _upb_TaggedMessagePtr_GetMessage(source), sub, arena, alias);
       *(upb_TaggedMessagePtr*)value =
           _upb_TaggedMessagePtr_Pack(clone, is_empty);
       return clone != NULL;
@@ -78,24 +85,24 @@ static bool upb_Clone_MessageValue(void* value, upb_CType value_type,
   UPB_UNREACHABLE();
 }
 
-upb_Map* upb_Map_DeepClone(const upb_Map* map, upb_CType key_type,
-                           upb_CType value_type,
-                           const upb_MiniTable* map_entry_table,
-                           upb_Arena* arena) {
+static upb_Map* _upb_Map_DeepClone(const upb_Map* map,
+                                   const upb_MiniTable* map_entry_table,
+                                   upb_Arena* arena, bool alias) {
   upb_Map* cloned_map = _upb_Map_New(arena, map->key_size, map->val_size);
   if (cloned_map == NULL) {
     return NULL;
   }
+  const upb_MiniTableField* value_field = &map_entry_table->fields[1];
+  const upb_MiniTable* value_sub =
+      (value_field->UPB_PRIVATE(submsg_index) != kUpb_NoSub)
+          ? upb_MiniTable_GetSubMessageTable(map_entry_table, value_field)
+          : NULL;
+  upb_CType value_field_type = upb_MiniTableField_CType(value_field);
   upb_MessageValue key, val;
   size_t iter = kUpb_Map_Begin;
   while (upb_Map_Next(map, &key, &val, &iter)) {
-    const upb_MiniTableField* value_field = &map_entry_table->fields[1];
-    const upb_MiniTable* value_sub =
-        (value_field->UPB_PRIVATE(submsg_index) != kUpb_NoSub)
-            ? upb_MiniTable_GetSubMessageTable(map_entry_table, value_field)
-            : NULL;
-    upb_CType value_field_type = upb_MiniTableField_CType(value_field);
-    if (!upb_Clone_MessageValue(&val, value_field_type, value_sub, arena)) {
+    if (!upb_Clone_MessageValue(&val, value_field_type, value_sub, arena,
+                                alias)) {
       return NULL;
     }
     if (upb_Map_Insert(cloned_map, key, val, arena) ==
@@ -106,30 +113,17 @@ upb_Map* upb_Map_DeepClone(const upb_Map* map, upb_CType key_type,
   return cloned_map;
 }
 
-static upb_Map* upb_Message_Map_DeepClone(const upb_Map* map,
-                                          const upb_MiniTable* mini_table,
-                                          const upb_MiniTableField* field,
-                                          upb_Message* clone,
-                                          upb_Arena* arena) {
-  const upb_MiniTable* map_entry_table =
-      mini_table->subs[field->UPB_PRIVATE(submsg_index)].submsg;
-  UPB_ASSERT(map_entry_table);
-
-  const upb_MiniTableField* key_field = &map_entry_table->fields[0];
-  const upb_MiniTableField* value_field = &map_entry_table->fields[1];
-
-  upb_Map* cloned_map = upb_Map_DeepClone(
-      map, upb_MiniTableField_CType(key_field),
-      upb_MiniTableField_CType(value_field), map_entry_table, arena);
-  if (!cloned_map) {
-    return NULL;
-  }
-  _upb_Message_SetNonExtensionField(clone, field, &cloned_map);
-  return cloned_map;
+upb_Map* upb_Map_DeepClone(const upb_Map* map, upb_CType key_type,
+                           upb_CType value_type,
+                           const upb_MiniTable* map_entry_table,
+                           upb_Arena* arena) {
+  return _upb_Map_DeepClone(map, map_entry_table, arena, false);
 }
 
-upb_Array* upb_Array_DeepClone(const upb_Array* array, upb_CType value_type,
-                               const upb_MiniTable* sub, upb_Arena* arena) {
+static upb_Array* _upb_Array_DeepClone(const upb_Array* array,
+                                       upb_CType value_type,
+                                       const upb_MiniTable* sub,
+                                       upb_Arena* arena, bool alias) {
   size_t size = array->size;
   upb_Array* cloned_array =
       _upb_Array_New(arena, size, _upb_Array_CTypeSizeLg2(value_type));
@@ -139,52 +133,54 @@ upb_Array* upb_Array_DeepClone(const upb_Array* array, upb_CType value_type,
   if (!_upb_Array_ResizeUninitialized(cloned_array, size, arena)) {
     return NULL;
   }
+  bool is_string =
+      value_type == kUpb_CType_String || value_type == kUpb_CType_Bytes;
+  if (value_type != kUpb_CType_Message && (alias || !is_string)) {
+    if (size == 0) return cloned_array;
+    // No element points to data of its own that needs cloning.
+    memcpy(_upb_array_ptr(cloned_array), _upb_array_constptr(array),
+           size << _upb_Array_CTypeSizeLg2(value_type));
+    return cloned_array;
+  }
   for (size_t i = 0; i < size; ++i) {
     upb_MessageValue val = upb_Array_Get(array, i);
-    if (!upb_Clone_MessageValue(&val, value_type, sub, arena)) {
-      return false;
+    if (!upb_Clone_MessageValue(&val, value_type, sub, arena, alias)) {
+      return NULL;
     }
     upb_Array_Set(cloned_array, i, val);
   }
   return cloned_array;
 }
 
-static bool upb_Message_Array_DeepClone(const upb_Array* array,
-                                        const upb_MiniTable* mini_table,
-                                        const upb_MiniTableField* field,
-                                        upb_Message* clone, upb_Arena* arena) {
-  _upb_MiniTableField_CheckIsArray(field);
-  upb_Array* cloned_array = upb_Array_DeepClone(
-      array, upb_MiniTableField_CType(field),
-      upb_MiniTableField_CType(field) == kUpb_CType_Message &&
-              field->UPB_PRIVATE(submsg_index) != kUpb_NoSub
-          ? upb_MiniTable_GetSubMessageTable(mini_table, field)
-          : NULL,
-      arena);
-
-  // Clear out upb_Array* due to parent memcpy.
-  _upb_Message_SetNonExtensionField(clone, field, &cloned_array);
-  return true;
+upb_Array* upb_Array_DeepClone(const upb_Array* array, upb_CType value_type,
+                               const upb_MiniTable* sub, upb_Arena* arena) {
+  return _upb_Array_DeepClone(array, value_type, sub, arena, false);
 }
 
 static bool upb_Clone_ExtensionValue(
     const upb_MiniTableExtension* mini_table_ext,
     const upb_Message_Extension* source, upb_Message_Extension* dest,
-    upb_Arena* arena) {
+    upb_Arena* arena, bool alias) {
   dest->data = source->data;
   return upb_Clone_MessageValue(
       &dest->data, upb_MiniTableField_CType(&mini_table_ext->field),
-      mini_table_ext->sub.submsg, arena);
+      mini_table_ext->sub.submsg, arena, alias);
 }
 
-upb_Message* _upb_Message_Copy(upb_Message* dst, const upb_Message* src,
-                               const upb_MiniTable* mini_table,
-                               upb_Arena* arena) {
+// Copies `src` over `dst`, which must not hold any extensions or unknown
+// fields yet.  The message body is copied as a whole, after which only the
+// fields that point to data of `src` are fixed up.
+static upb_Message* _upb_Message_Copy(upb_Message* dst, const upb_Message* src,
+                                      const upb_MiniTable* mini_table,
+                                      upb_Arena* arena, bool alias) {
   upb_StringView empty_string = upb_StringView_FromDataAndSize(NULL, 0);
   // Only copy message area skipping upb_Message_Internal.
   memcpy(dst, src, mini_table->size);
   for (size_t i = 0; i < mini_table->field_count; ++i) {
     const upb_MiniTableField* field = &mini_table->fields[i];
+    // The hasbits and oneof cases were copied with the body, so the fixed up
+    // values are stored directly rather than through the setters.
+    void* dst_val = UPB_PTR_AT(dst, field->offset, void);
     if (!upb_IsRepeatedOrMap(field)) {
       switch (upb_MiniTableField_CType(field)) {
         case kUpb_CType_Message: {
@@ -200,46 +196,60 @@ upb_Message* _upb_Message_Copy(upb_Message* dst, const upb_Message* src,
             const upb_MiniTable* sub_message_table =
                 is_empty ? &_kUpb_MiniTable_Empty
                          : upb_MiniTable_GetSubMessageTable(mini_table, field);
-            upb_Message* dst_sub_message =
-                upb_Message_DeepClone(sub_message, sub_message_table, arena);
+            upb_Message* dst_sub_message = _upb_Message_DeepClone(
+                sub_message, sub_message_table, arena, alias);
             if (dst_sub_message == NULL) {
               return NULL;
             }
-            _upb_Message_SetTaggedMessagePtr(
-                dst, mini_table, field,
-                _upb_TaggedMessagePtr_Pack(dst_sub_message, is_empty));
+            *(upb_TaggedMessagePtr*)dst_val =
+                _upb_TaggedMessagePtr_Pack(dst_sub_message, is_empty);
           }
         } break;
         case kUpb_CType_String:
         case kUpb_CType_Bytes: {
+          if (alias) break;
           upb_StringView str = upb_Message_GetString(src, field, empty_string);
           if (str.size != 0) {
-            if (!upb_Message_SetString(
-                    dst, field, upb_Clone_StringView(str, arena), arena)) {
+            upb_StringView cloned = upb_Clone_StringView(str, arena);
+            if (cloned.data == NULL) {
               return NULL;
             }
+            *(upb_StringView*)dst_val = cloned;
           }
         } break;
         default:
           // Scalar, already copied.
           break;
       }
-    } else {
-      if (upb_MessageField_IsMap(field)) {
-        const upb_Map* map = upb_Message_GetMap(src, field);
-        if (map != NULL) {
-          if (!upb_Message_Map_DeepClone(map, mini_table, field, dst, arena)) {
-            return NULL;
-          }
+    } else if (upb_MessageField_IsMap(field)) {
+      const upb_Map* map = upb_Message_GetMap(src, field);
+      if (map != NULL) {
+        const upb_MiniTable* map_entry_table =
+            mini_table->subs[field->UPB_PRIVATE(submsg_index)].submsg;
+        UPB_ASSERT(map_entry_table);
+        upb_Map* cloned_map =
+            _upb_Map_DeepClone(map, map_entry_table, arena, alias);
+        if (cloned_map == NULL) {
+          return NULL;
         }
-      } else {
-        const upb_Array* array = upb_Message_GetArray(src, field);
-        if (array != NULL) {
-          if (!upb_Message_Array_DeepClone(array, mini_table, field, dst,
-                                           arena)) {
-            return NULL;
-          }
+        *(upb_Map**)dst_val = cloned_map;
+      }
+    } else {
+      const upb_Array* array = upb_Message_GetArray(src, field);
+      if (array != NULL) {
+        _upb_MiniTableField_CheckIsArray(field);
+        upb_CType value_type = upb_MiniTableField_CType(field);
+        const upb_MiniTable* sub =
+            value_type == kUpb_CType_Message &&
+                    field->UPB_PRIVATE(submsg_index) != kUpb_NoSub
+                ? upb_MiniTable_GetSubMessageTable(mini_table, field)
+                : NULL;
+        upb_Array* cloned_array =
+            _upb_Array_DeepClone(array, value_type, sub, arena, alias);
+        if (cloned_array == NULL) {
+          return NULL;
         }
+        *(upb_Array**)dst_val = cloned_array;
       }
     }
   }
@@ -253,15 +263,16 @@ upb_Message* _upb_Message_Copy(upb_Message* dst, const upb_Message* src,
         _upb_Message_GetOrCreateExtension(dst, msg_ext->ext, arena);
     if (!dst_ext) return NULL;
     if (!upb_IsRepeatedOrMap(field)) {
-      if (!upb_Clone_ExtensionValue(msg_ext->ext, msg_ext, dst_ext, arena)) {
+      if (!upb_Clone_ExtensionValue(msg_ext->ext, msg_ext, dst_ext, arena,
+                                    alias)) {
         return NULL;
       }
     } else {
       upb_Array* msg_array = (upb_Array*)msg_ext->data.ptr;
       UPB_ASSERT(msg_array);
       upb_Array* cloned_array =
-          upb_Array_DeepClone(msg_array, upb_MiniTableField_CType(field),
-                              msg_ext->ext->sub.submsg, arena);
+          _upb_Array_DeepClone(msg_array, upb_MiniTableField_CType(field),
+                               msg_ext->ext->sub.submsg, arena, alias);
       if (!cloned_array) {
         return NULL;
       }
@@ -282,10 +293,22 @@ upb_Message* _upb_Message_Copy(upb_Message* dst, const upb_Message* src,
   return dst;
 }
 
+static upb_Message* _upb_Message_DeepClone(const upb_Message* message,
+                                           const upb_MiniTable* mini_table,
+                                           upb_Arena* arena, bool alias) {
+  // The body is overwritten by the copy, so only the internal header needs
+  // to be cleared.
+  void* mem = upb_Arena_Malloc(arena, upb_msg_sizeof(mini_table));
+  if (UPB_UNLIKELY(!mem)) return NULL;
+  memset(mem, 0, sizeof(upb_Message_Internal));
+  upb_Message* clone = UPB_PTR_AT(mem, sizeof(upb_Message_Internal), upb_Message);
+  return _upb_Message_Copy(clone, message, mini_table, arena, alias);
+}
+
 bool upb_Message_DeepCopy(upb_Message* dst, const upb_Message* src,
                           const upb_MiniTable* mini_table, upb_Arena* arena) {
   upb_Message_Clear(dst, mini_table);
-  return _upb_Message_Copy(dst, src, mini_table, arena) != NULL;
+  return _upb_Message_Copy(dst, src, mini_table, arena, false) != NULL;
 }
 
 // Deep clones a message using the provided target arena.
@@ -294,6 +317,12 @@ bool upb_Message_DeepCopy(upb_Message* dst, const upb_Message* src,
 upb_Message* upb_Message_DeepClone(const upb_Message* message,
                                    const upb_MiniTable* mini_table,
                                    upb_Arena* arena) {
-  upb_Message* clone = upb_Message_New(mini_table, arena);
-  return _upb_Message_Copy(clone, message, mini_table, arena);
+  return _upb_Message_DeepClone(message, mini_table, arena, false);
+}
+
+upb_Message* upb_Message_DeepCloneAliasingStrings(
+    const upb_Message* message, const upb_MiniTable* mini_table,
+    upb_Arena* message_arena, upb_Arena* arena) {
+  bool alias = upb_Arena_IsFused(message_arena, arena);
+  return _upb_Message_DeepClone(message, mini_table, arena, alias);
 }
@@ -35,6 +35,16 @@ upb_Map* upb_Map_DeepClone(const upb_Map* map, upb_CType key_type,
                            const upb_MiniTable* map_entry_table,
                            upb_Arena* arena);
 
+// Deep clones a message like upb_Message_DeepClone(), except that string and
+// bytes fields are not copied if `message_arena` and `arena` are fused: the
+// clone then shares the string data of `message`.  The data must be owned by
+// `message_arena`, so this must not be used on messages parsed with
+// kUpb_DecodeOption_AliasString, and neither message may modify the data in
+// place afterwards.
+upb_Message* upb_Message_DeepCloneAliasingStrings(
+    const upb_Message* message, const upb_MiniTable* mini_table,
+    upb_Arena* message_arena, upb_Arena* arena);
+
 // Deep copies the message from src to dst.
 bool upb_Message_DeepCopy(upb_Message* dst, const upb_Message* src,
                           const upb_MiniTable* mini_table, upb_Arena* arena);
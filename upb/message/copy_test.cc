@@ -321,4 +321,57 @@ TEST(GeneratedCode, DeepCloneMessageWithUnknowns) {
   upb_Arena_Free(clone_arena);
 }
 
+TEST(GeneratedCode, DeepCloneMessageAliasingStrings) {
+  upb_Arena* source_arena = upb_Arena_New();
+  protobuf_test_messages_proto2_TestAllTypesProto2* msg =
+      protobuf_test_messages_proto2_TestAllTypesProto2_new(source_arena);
+  const upb_MiniTableField* optional_string_field =
+      find_proto2_field(kFieldOptionalString);
+  char* string_in_arena =
+      (char*)upb_Arena_Malloc(source_arena, sizeof(kTestStr1));
+  memcpy(string_in_arena, kTestStr1, sizeof(kTestStr1));
+  upb_Message_SetString(
+      msg, optional_string_field,
+      upb_StringView_FromDataAndSize(string_in_arena, sizeof(kTestStr1) - 1),
+      source_arena);
+  protobuf_test_messages_proto2_TestAllTypesProto2_NestedMessage* nested =
+      protobuf_test_messages_proto2_TestAllTypesProto2_mutable_optional_nested_message(
+          msg, source_arena);
+  protobuf_test_messages_proto2_TestAllTypesProto2_NestedMessage_set_a(
+      nested, kTestNestedInt32);
+  upb_Arena* arena = upb_Arena_New();
+
+  // Arenas that are not fused get copies of the strings.
+  EXPECT_FALSE(upb_Arena_IsFused(source_arena, arena));
+  upb_Message* clone = upb_Message_DeepCloneAliasingStrings(
+      msg, &protobuf_0test_0messages__proto2__TestAllTypesProto2_msg_init,
+      source_arena, arena);
+  upb_StringView str = upb_Message_GetString(
+      clone, optional_string_field, upb_StringView_FromDataAndSize(nullptr, 0));
+  EXPECT_TRUE(
+      upb_StringView_IsEqual(str, upb_StringView_FromString(kTestStr1)));
+  EXPECT_NE(str.data, string_in_arena);
+
+  ASSERT_TRUE(upb_Arena_Fuse(source_arena, arena));
+  EXPECT_TRUE(upb_Arena_IsFused(arena, source_arena));
+  clone = upb_Message_DeepCloneAliasingStrings(
+      msg, &protobuf_0test_0messages__proto2__TestAllTypesProto2_msg_init,
+      source_arena, arena);
+  str = upb_Message_GetString(clone, optional_string_field,
+                              upb_StringView_FromDataAndSize(nullptr, 0));
+  EXPECT_EQ(str.data, string_in_arena);
+  EXPECT_EQ(str.size, sizeof(kTestStr1) - 1);
+  // Sub-messages are still copied.
+  const upb_Message* cloned_nested = upb_Message_GetMessage(
+      clone, find_proto2_field(kFieldOptionalNestedMessage), nullptr);
+  ASSERT_NE(cloned_nested, nullptr);
+  EXPECT_NE(cloned_nested, nested);
+  EXPECT_EQ(protobuf_test_messages_proto2_TestAllTypesProto2_NestedMessage_a(
+                (protobuf_test_messages_proto2_TestAllTypesProto2_NestedMessage*)
+                    cloned_nested),
+            kTestNestedInt32);
+  upb_Arena_Free(source_arena);
+  upb_Arena_Free(arena);
+}
+
 }  // namespace
@@ -48,6 +48,10 @@ struct upb_Map {
   char val_size;
 
   upb_strtable table;
+
+  // The entries in key order, kept by upb_Map_Sort() until the map is next
+  // modified.  NULL if the map has not been sorted since.
+  const upb_tabent** sorted;
 };
 
 #ifdef __cplusplus
@@ -112,12 +116,15 @@ UPB_INLINE void* _upb_map_next(const upb_Map* map, size_t* iter) {
 
 UPB_INLINE void _upb_Map_Clear(upb_Map* map) {
   upb_strtable_clear(&map->table);
+  map->sorted = NULL;
 }
 
 UPB_INLINE bool _upb_Map_Delete(upb_Map* map, const void* key, size_t key_size,
                                 upb_value* val) {
   upb_StringView k = _upb_map_tokey(key, key_size);
-  return upb_strtable_remove2(&map->table, k.data, k.size, val);
+  bool removed = upb_strtable_remove2(&map->table, k.data, k.size, val);
+  if (removed) map->sorted = NULL;
+  return removed;
 }
 
 UPB_INLINE bool _upb_Map_Get(const upb_Map* map, const void* key,
@@ -140,6 +147,9 @@ UPB_INLINE upb_MapInsertStatus _upb_Map_Insert(upb_Map* map, const void* key,
     return kUpb_MapInsertStatus_OutOfMemory;
   }
 
+  // Replacing an entry may move it too.
+  map->sorted = NULL;
+
   // TODO: add overwrite operation to minimize number of lookups.
   bool removed =
       upb_strtable_remove2(&map->table, strkey.data, strkey.size, NULL);
@@ -54,6 +54,10 @@ typedef struct {
   void const** entries;
   int size;
   int cap;
+
+  // Scratch space for radix sorting integer keys.
+  void* radix;
+  int radix_cap;
 } _upb_mapsorter;
 
 typedef struct {
@@ -66,10 +70,13 @@ UPB_INLINE void _upb_mapsorter_init(_upb_mapsorter* s) {
   s->entries = NULL;
   s->size = 0;
   s->cap = 0;
+  s->radix = NULL;
+  s->radix_cap = 0;
 }
 
 UPB_INLINE void _upb_mapsorter_destroy(_upb_mapsorter* s) {
   if (s->entries) free(s->entries);
+  if (s->radix) free(s->radix);
 }
 
 UPB_INLINE bool _upb_sortedmap_next(_upb_mapsorter* s, const upb_Map* map,
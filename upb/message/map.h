@@ -84,6 +84,13 @@ UPB_API_INLINE bool upb_Map_Set(upb_Map* map, upb_MessageValue key,
          kUpb_MapInsertStatus_OutOfMemory;
 }
 
+// Sorts the map's entries by key, and keeps them in that order until the map
+// is next modified.  Deterministic serialization of the map then skips sorting
+// it, which pays off for maps that are serialized many times between changes.
+// |key_type| must be the map's key type.  Returns false if memory allocation
+// failed.
+UPB_API bool upb_Map_Sort(upb_Map* map, upb_CType key_type, upb_Arena* a);
+
 // Deletes this key from the table. Returns true if the key was present.
 // If present and |val| is non-NULL, stores the deleted value.
 UPB_API bool upb_Map_Delete(upb_Map* map, upb_MessageValue key,
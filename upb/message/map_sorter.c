@@ -30,7 +30,10 @@
 
 #include "upb/message/internal/map_sorter.h"
 
+#include <string.h>
+
 #include "upb/base/internal/log2.h"
+#include "upb/message/map.h"
 
 // Must be last.
 #include "upb/port/def.inc"
@@ -106,6 +109,126 @@ static int (*const compar[kUpb_FieldType_SizeOf])(const void*, const void*) = {
     [kUpb_FieldType_Bytes] = _upb_mapsorter_cmpstr,
 };
 
+// Maps with fewer integer keys than this are sorted with qsort(), which has
+// less overhead than a radix sort for them.
+#define kUpb_MapSorter_RadixMinSize 64
+
+typedef struct {
+  uint64_t key;
+  const void* entry;
+} _upb_radixent;
+
+// Radix sorts the entries of a map by their integer keys, from the lowest
+// byte up, in the order of compar[key_type].  Returns false, leaving the
+// entries as they are, if the key type is not an integer type or if memory
+// allocation failed.
+static bool _upb_mapsorter_radixsort(_upb_mapsorter* s, const void** entries,
+                                     int n, upb_FieldType key_type) {
+  int width;
+  uint64_t sign = 0;
+  switch (key_type) {
+    case kUpb_FieldType_Int64:
+    case kUpb_FieldType_SFixed64:
+    case kUpb_FieldType_SInt64:
+      sign = 1ULL << 63;
+      width = 8;
+      break;
+    case kUpb_FieldType_UInt64:
+    case kUpb_FieldType_Fixed64:
+      width = 8;
+      break;
+    case kUpb_FieldType_Int32:
+    case kUpb_FieldType_SInt32:
+    case kUpb_FieldType_SFixed32:
+    case kUpb_FieldType_Enum:
+      sign = 1ULL << 31;
+      width = 4;
+      break;
+    case kUpb_FieldType_UInt32:
+    case kUpb_FieldType_Fixed32:
+      width = 4;
+      break;
+    case kUpb_FieldType_Bool:
+      width = 1;
+      break;
+    default:
+      return false;
+  }
+
+  if (2 * n > s->radix_cap) {
+    int cap = upb_Log2CeilingSize(2 * n);
+    void* radix = realloc(s->radix, cap * sizeof(_upb_radixent));
+    if (!radix) return false;
+    s->radix = radix;
+    s->radix_cap = cap;
+  }
+  _upb_radixent* src = s->radix;
+  _upb_radixent* dst = src + n;
+
+  // Flipping the sign bit makes signed keys sort like unsigned ones.
+  uint32_t counts[8][256] = {{0}};
+  for (int i = 0; i < n; i++) {
+    const upb_tabent* ent = entries[i];
+    const char* data = upb_tabstrview(ent->key).data;
+    uint64_t key;
+    if (width == 8) {
+      memcpy(&key, data, 8);
+    } else if (width == 4) {
+      uint32_t key32;
+      memcpy(&key32, data, 4);
+      key = key32;
+    } else {
+      key = (uint8_t)*data;
+    }
+    key ^= sign;
+    src[i].key = key;
+    src[i].entry = ent;
+    for (int b = 0; b < width; b++) counts[b][(key >> (8 * b)) & 0xff]++;
+  }
+
+  for (int b = 0; b < width; b++) {
+    // Skip the bytes that all keys share.
+    if (counts[b][(src[0].key >> (8 * b)) & 0xff] == (uint32_t)n) continue;
+    uint32_t offset = 0;
+    for (int i = 0; i < 256; i++) {
+      uint32_t count = counts[b][i];
+      counts[b][i] = offset;
+      offset += count;
+    }
+    for (int i = 0; i < n; i++) {
+      dst[counts[b][(src[i].key >> (8 * b)) & 0xff]++] = src[i];
+    }
+    _upb_radixent* tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+
+  for (int i = 0; i < n; i++) entries[i] = src[i].entry;
+  return true;
+}
+
+static void _upb_mapsorter_sort(_upb_mapsorter* s, const void** entries, int n,
+                                upb_FieldType key_type) {
+  if (n <= 1) return;
+  if (n >= kUpb_MapSorter_RadixMinSize &&
+      _upb_mapsorter_radixsort(s, entries, n, key_type)) {
+    return;
+  }
+  qsort(entries, n, sizeof(*entries), compar[key_type]);
+}
+
+// Copies the entries of the map, in table order, to `dst`.
+static void _upb_mapsorter_getentries(const upb_Map* map, const void** dst) {
+  const upb_tabent* src = map->table.t.entries;
+  const upb_tabent* end = src + upb_table_size(&map->table.t);
+  for (; src < end; src++) {
+    if (!upb_tabent_isempty(src)) {
+      *dst = src;
+      dst++;
+    }
+  }
+}
+
 static bool _upb_mapsorter_resize(_upb_mapsorter* s, _upb_sortedmap* sorted,
                                   int size) {
   sorted->start = s->size;
@@ -128,21 +251,45 @@ bool _upb_mapsorter_pushmap(_upb_mapsorter* s, upb_FieldType key_type,
 
   if (!_upb_mapsorter_resize(s, sorted, map_size)) return false;
 
-  // Copy non-empty entries from the table to s->entries.
   const void** dst = &s->entries[sorted->start];
-  const upb_tabent* src = map->table.t.entries;
-  const upb_tabent* end = src + upb_table_size(&map->table.t);
-  for (; src < end; src++) {
-    if (!upb_tabent_isempty(src)) {
-      *dst = src;
-      dst++;
-    }
+  if (map->sorted) {
+    // upb_Map_Sort() has sorted the map already.
+    memcpy(dst, map->sorted, map_size * sizeof(*dst));
+    return true;
   }
-  UPB_ASSERT(dst == &s->entries[sorted->end]);
 
-  // Sort entries according to the key type.
-  qsort(&s->entries[sorted->start], map_size, sizeof(*s->entries),
-        compar[key_type]);
+  // Copy non-empty entries from the table to s->entries, and sort them
+  // according to the key type.
+  _upb_mapsorter_getentries(map, dst);
+  _upb_mapsorter_sort(s, dst, map_size, key_type);
+  return true;
+}
+
+bool upb_Map_Sort(upb_Map* map, upb_CType key_type, upb_Arena* a) {
+  static const upb_FieldType kSortType[] = {
+      [kUpb_CType_Bool] = kUpb_FieldType_Bool,
+      [kUpb_CType_Int32] = kUpb_FieldType_Int32,
+      [kUpb_CType_UInt32] = kUpb_FieldType_UInt32,
+      [kUpb_CType_Enum] = kUpb_FieldType_Enum,
+      [kUpb_CType_Int64] = kUpb_FieldType_Int64,
+      [kUpb_CType_UInt64] = kUpb_FieldType_UInt64,
+      [kUpb_CType_String] = kUpb_FieldType_String,
+      [kUpb_CType_Bytes] = kUpb_FieldType_Bytes,
+  };
+  UPB_ASSERT(kSortType[key_type] != 0);
+
+  int map_size = _upb_Map_Size(map);
+  if (map->sorted || map_size == 0) return true;
+  const upb_tabent** sorted =
+      upb_Arena_Malloc(a, map_size * sizeof(*map->sorted));
+  if (!sorted) return false;
+  _upb_mapsorter_getentries(map, (const void**)sorted);
+
+  _upb_mapsorter s;
+  _upb_mapsorter_init(&s);
+  _upb_mapsorter_sort(&s, (const void**)sorted, map_size, kSortType[key_type]);
+  _upb_mapsorter_destroy(&s);
+  map->sorted = sorted;
   return true;
 }
 
@@ -30,9 +30,37 @@
 
 #include "upb/message/map.h"
 
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
 #include <gtest/gtest.h>
+#include "upb/base/descriptor_constants.h"
 #include "upb/base/string_view.h"
 #include "upb/mem/arena.hpp"
+#include "upb/message/internal/map.h"
+#include "upb/message/internal/map_sorter.h"
+
+// Returns the keys of an int64 map in the order the encoder writes them.
+static std::vector<int64_t> SortedKeys(const upb_Map* map) {
+  std::vector<int64_t> keys;
+  _upb_mapsorter sorter;
+  _upb_mapsorter_init(&sorter);
+  _upb_sortedmap sorted;
+  EXPECT_TRUE(
+      _upb_mapsorter_pushmap(&sorter, kUpb_FieldType_SInt64, map, &sorted));
+  upb_MapEntry entry;
+  while (_upb_sortedmap_next(&sorter, map, &sorted, &entry)) {
+    int64_t key;
+    memcpy(&key, &entry.data.k, sizeof(key));
+    keys.push_back(key);
+  }
+  _upb_mapsorter_popmap(&sorter, &sorted);
+  _upb_mapsorter_destroy(&sorter);
+  return keys;
+}
 
 TEST(MapTest, DeleteRegression) {
   upb::Arena arena;
@@ -54,3 +82,45 @@ TEST(MapTest, DeleteRegression) {
   EXPECT_TRUE(
       upb_StringView_IsEqual(insert_value.str_val, delete_value.str_val));
 }
+
+TEST(MapTest, Sort) {
+  upb::Arena arena;
+  upb_Map* map = upb_Map_New(arena.ptr(), kUpb_CType_Int64, kUpb_CType_Int32);
+  EXPECT_TRUE(upb_Map_Sort(map, kUpb_CType_Int64, arena.ptr()));
+
+  // Enough keys to be radix sorted, with negative ones among them.
+  std::vector<int64_t> expected;
+  for (int i = 0; i < 200; i++) {
+    int64_t k = (i % 2 ? -1 : 1) * (int64_t{i} * 0x9e3779b97f4a7c15 >> 8);
+    upb_MessageValue key, val;
+    key.int64_val = k;
+    val.int32_val = i;
+    upb_Map_Set(map, key, val, arena.ptr());
+    expected.push_back(k);
+  }
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(expected, SortedKeys(map));
+
+  EXPECT_TRUE(upb_Map_Sort(map, kUpb_CType_Int64, arena.ptr()));
+  EXPECT_NE(nullptr, map->sorted);
+  EXPECT_EQ(expected, SortedKeys(map));
+
+  // Any change to the map drops the index.
+  upb_MessageValue key, val;
+  key.int64_val = expected[0];
+  val.int32_val = 0;
+  upb_Map_Set(map, key, val, arena.ptr());
+  EXPECT_EQ(nullptr, map->sorted);
+  EXPECT_EQ(expected, SortedKeys(map));
+
+  EXPECT_TRUE(upb_Map_Sort(map, kUpb_CType_Int64, arena.ptr()));
+  EXPECT_TRUE(upb_Map_Delete(map, key, nullptr));
+  EXPECT_EQ(nullptr, map->sorted);
+  expected.erase(expected.begin());
+  EXPECT_EQ(expected, SortedKeys(map));
+
+  EXPECT_TRUE(upb_Map_Sort(map, kUpb_CType_Int64, arena.ptr()));
+  upb_Map_Clear(map);
+  EXPECT_EQ(nullptr, map->sorted);
+  EXPECT_TRUE(SortedKeys(map).empty());
+}
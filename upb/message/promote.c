@@ -23,6 +23,7 @@
 #include "upb/message/message.h"
 #include "upb/message/tagged_ptr.h"
 #include "upb/mini_table/extension.h"
+#include "upb/mini_table/extension_registry.h"
 #include "upb/mini_table/field.h"
 #include "upb/mini_table/internal/field.h"
 #include "upb/mini_table/message.h"
@@ -152,23 +153,32 @@ upb_FindUnknownRet upb_MiniTable_FindUnknown(const upb_Message* msg,
   return ret;
 }
 
-static upb_DecodeStatus upb_Message_PromoteOne(upb_TaggedMessagePtr* tagged,
-                                               const upb_MiniTable* mini_table,
-                                               int decode_options,
-                                               upb_Arena* arena) {
+static upb_DecodeStatus upb_Message_PromoteOneWithExtensions(
+    upb_TaggedMessagePtr* tagged, const upb_MiniTable* mini_table,
+    const upb_ExtensionRegistry* extreg, int decode_options,
+    upb_Arena* arena) {
   upb_Message* empty = _upb_TaggedMessagePtr_GetEmptyMessage(*tagged);
   size_t unknown_size;
   const char* unknown_data = upb_Message_GetUnknown(empty, &unknown_size);
   upb_Message* promoted = upb_Message_New(mini_table, arena);
   if (!promoted) return kUpb_DecodeStatus_OutOfMemory;
-  upb_DecodeStatus status = upb_Decode(unknown_data, unknown_size, promoted,
-                                       mini_table, NULL, decode_options, arena);
+  upb_DecodeStatus status =
+      upb_Decode(unknown_data, unknown_size, promoted, mini_table, extreg,
+                 decode_options, arena);
   if (status == kUpb_DecodeStatus_Ok) {
     *tagged = _upb_TaggedMessagePtr_Pack(promoted, false);
   }
   return status;
 }
 
+static upb_DecodeStatus upb_Message_PromoteOne(upb_TaggedMessagePtr* tagged,
+                                               const upb_MiniTable* mini_table,
+                                               int decode_options,
+                                               upb_Arena* arena) {
+  return upb_Message_PromoteOneWithExtensions(tagged, mini_table, NULL,
+                                              decode_options, arena);
+}
+
 upb_DecodeStatus upb_Message_PromoteMessage(upb_Message* parent,
                                             const upb_MiniTable* mini_table,
                                             const upb_MiniTableField* field,
@@ -189,6 +199,28 @@ upb_DecodeStatus upb_Message_PromoteMessage(upb_Message* parent,
   return ret;
 }
 
+upb_DecodeStatus upb_Message_GetOrPromoteMessage(
+    upb_Message* parent, const upb_MiniTable* mini_table,
+    const upb_MiniTableField* field, const upb_ExtensionRegistry* extreg,
+    int decode_options, upb_Arena* arena, upb_Message** sub) {
+  upb_TaggedMessagePtr tagged =
+      upb_Message_GetTaggedMessagePtr(parent, field, NULL);
+  if (!upb_TaggedMessagePtr_IsEmpty(tagged)) {
+    *sub = _upb_TaggedMessagePtr_GetMessage(tagged);
+    return kUpb_DecodeStatus_Ok;
+  }
+  const upb_MiniTable* sub_table =
+      upb_MiniTable_GetSubMessageTable(mini_table, field);
+  UPB_ASSERT(sub_table);
+  upb_DecodeStatus ret = upb_Message_PromoteOneWithExtensions(
+      &tagged, sub_table, extreg, decode_options, arena);
+  if (ret == kUpb_DecodeStatus_Ok) {
+    *sub = upb_TaggedMessagePtr_GetNonEmptyMessage(tagged);
+    upb_Message_SetMessage(parent, mini_table, field, *sub);
+  }
+  return ret;
+}
+
 upb_DecodeStatus upb_Array_PromoteMessages(upb_Array* arr,
                                            const upb_MiniTable* mini_table,
                                            int decode_options,
@@ -222,6 +254,135 @@ upb_DecodeStatus upb_Map_PromoteMessages(upb_Map* map,
   return kUpb_DecodeStatus_Ok;
 }
 
+// Promotes the unknown fields of `msg` that `extreg` knows as (non-repeated)
+// message extensions.
+static upb_DecodeStatus upb_Message_PromoteUnknownExtensions(
+    upb_Message* msg, const upb_MiniTable* mini_table,
+    const upb_ExtensionRegistry* extreg, int decode_options,
+    upb_Arena* arena) {
+  // Promoting an extension deletes it from the unknown data, after which the
+  // scan starts over.
+  bool promoted;
+  do {
+    promoted = false;
+    size_t size;
+    const char* ptr = upb_Message_GetUnknown(msg, &size);
+    upb_EpsCopyInputStream stream;
+    upb_EpsCopyInputStream_Init(&stream, &ptr, size, true);
+    while (!promoted && !upb_EpsCopyInputStream_IsDone(&stream, &ptr)) {
+      uint32_t tag;
+      ptr = upb_WireReader_ReadTag(ptr, &tag);
+      if (!ptr) return kUpb_DecodeStatus_Malformed;
+      const upb_MiniTableExtension* ext =
+          upb_WireReader_GetWireType(tag) == kUpb_WireType_Delimited
+              ? upb_ExtensionRegistry_Lookup(
+                    extreg, mini_table, upb_WireReader_GetFieldNumber(tag))
+              : NULL;
+      // An extension that is already present can't be promoted (again), so
+      // its unknown data is left alone.
+      if (ext &&
+          upb_MiniTableField_CType(&ext->field) == kUpb_CType_Message &&
+          !upb_IsRepeatedOrMap(&ext->field) && !_upb_Message_Getext(msg, ext)) {
+        const upb_Message_Extension* unused;
+        switch (upb_MiniTable_GetOrPromoteExtension(msg, ext, decode_options,
+                                                    arena, &unused)) {
+          case kUpb_GetExtension_Ok:
+            promoted = true;
+            continue;
+          case kUpb_GetExtension_OutOfMemory:
+            return kUpb_DecodeStatus_OutOfMemory;
+          default:
+            return kUpb_DecodeStatus_Malformed;
+        }
+      }
+      ptr = _upb_WireReader_SkipValue(
+          ptr, tag, kUpb_WireFormat_DefaultDepthLimit, &stream);
+      if (!ptr) return kUpb_DecodeStatus_Malformed;
+    }
+  } while (promoted);
+  return kUpb_DecodeStatus_Ok;
+}
+
+static upb_DecodeStatus upb_Array_PromoteExtensions(
+    const upb_Array* arr, const upb_MiniTable* mini_table,
+    const upb_ExtensionRegistry* extreg, int decode_options,
+    upb_Arena* arena) {
+  for (size_t i = 0, n = upb_Array_Size(arr); i < n; i++) {
+    upb_TaggedMessagePtr tagged = upb_Array_Get(arr, i).tagged_msg_val;
+    if (upb_TaggedMessagePtr_IsEmpty(tagged)) continue;
+    upb_DecodeStatus status = upb_Message_PromoteExtensions(
+        _upb_TaggedMessagePtr_GetMessage(tagged), mini_table, extreg,
+        decode_options, arena);
+    if (status != kUpb_DecodeStatus_Ok) return status;
+  }
+  return kUpb_DecodeStatus_Ok;
+}
+
+upb_DecodeStatus upb_Message_PromoteExtensions(
+    upb_Message* msg, const upb_MiniTable* mini_table,
+    const upb_ExtensionRegistry* extreg, int decode_options,
+    upb_Arena* arena) {
+  upb_DecodeStatus status = upb_Message_PromoteUnknownExtensions(
+      msg, mini_table, extreg, decode_options, arena);
+  if (status != kUpb_DecodeStatus_Ok) return status;
+
+  for (size_t i = 0; i < mini_table->field_count; i++) {
+    const upb_MiniTableField* field = &mini_table->fields[i];
+    if (upb_MiniTableField_CType(field) != kUpb_CType_Message) continue;
+    const upb_MiniTable* sub =
+        upb_MiniTable_GetSubMessageTable(mini_table, field);
+    if (!sub) continue;  // Not linked.
+    if (upb_FieldMode_Get(field) == kUpb_FieldMode_Map) {
+      const upb_Map* map = upb_Message_GetMap(msg, field);
+      const upb_MiniTableField* val_field = &sub->fields[1];
+      const upb_MiniTable* val_sub =
+          upb_MiniTableField_CType(val_field) == kUpb_CType_Message
+              ? upb_MiniTable_GetSubMessageTable(sub, val_field)
+              : NULL;
+      if (!map || !val_sub) continue;
+      size_t iter = kUpb_Map_Begin;
+      upb_MessageValue key, val;
+      while (upb_Map_Next(map, &key, &val, &iter)) {
+        if (upb_TaggedMessagePtr_IsEmpty(val.tagged_msg_val)) continue;
+        status = upb_Message_PromoteExtensions(
+            _upb_TaggedMessagePtr_GetMessage(val.tagged_msg_val), val_sub,
+            extreg, decode_options, arena);
+        if (status != kUpb_DecodeStatus_Ok) return status;
+      }
+    } else if (upb_IsRepeatedOrMap(field)) {
+      const upb_Array* arr = upb_Message_GetArray(msg, field);
+      if (!arr) continue;
+      status = upb_Array_PromoteExtensions(arr, sub, extreg, decode_options,
+                                           arena);
+      if (status != kUpb_DecodeStatus_Ok) return status;
+    } else {
+      upb_TaggedMessagePtr tagged =
+          upb_Message_GetTaggedMessagePtr(msg, field, NULL);
+      upb_Message* sub_msg = _upb_TaggedMessagePtr_GetMessage(tagged);
+      if (!sub_msg || upb_TaggedMessagePtr_IsEmpty(tagged)) continue;
+      status = upb_Message_PromoteExtensions(sub_msg, sub, extreg,
+                                             decode_options, arena);
+      if (status != kUpb_DecodeStatus_Ok) return status;
+    }
+  }
+
+  size_t count;
+  const upb_Message_Extension* exts = _upb_Message_Getexts(msg, &count);
+  for (size_t i = 0; i < count; i++) {
+    const upb_MiniTableExtension* ext = exts[i].ext;
+    if (upb_MiniTableField_CType(&ext->field) != kUpb_CType_Message) continue;
+    if (upb_IsRepeatedOrMap(&ext->field)) {
+      status = upb_Array_PromoteExtensions(exts[i].data.ptr, ext->sub.submsg,
+                                           extreg, decode_options, arena);
+    } else {
+      status = upb_Message_PromoteExtensions(
+          exts[i].data.ptr, ext->sub.submsg, extreg, decode_options, arena);
+    }
+    if (status != kUpb_DecodeStatus_Ok) return status;
+  }
+  return kUpb_DecodeStatus_Ok;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // OLD promotion functions, will be removed!
 ////////////////////////////////////////////////////////////////////////////////
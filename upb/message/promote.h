@@ -11,6 +11,7 @@
 #include "upb/message/array.h"
 #include "upb/message/internal/extension.h"
 #include "upb/message/map.h"
+#include "upb/mini_table/extension_registry.h"
 #include "upb/wire/decode.h"
 
 // Must be last.
@@ -98,6 +99,20 @@ upb_DecodeStatus upb_Message_PromoteMessage(upb_Message* parent,
                                             upb_Arena* arena,
                                             upb_Message** promoted);
 
+// Returns the non-repeated message field `field` of `parent` in `*sub`,
+// promoting it first if it is "empty".  This is how sub-messages that were
+// parsed with kUpb_DecodeOption_ExperimentalLazySubMessages are read: the
+// first access parses the data, later ones return the parsed message.
+// `*sub` is NULL if the field is not present.
+//
+// `field` must be linked.  `extreg` is used to parse extensions of the
+// sub-message, and may be NULL.  If the return value indicates an error
+// status, `parent` is unchanged.
+upb_DecodeStatus upb_Message_GetOrPromoteMessage(
+    upb_Message* parent, const upb_MiniTable* mini_table,
+    const upb_MiniTableField* field, const upb_ExtensionRegistry* extreg,
+    int decode_options, upb_Arena* arena, upb_Message** sub);
+
 // Promotes any "empty" messages in this array to a message of the correct type
 // `mini_table`.  This function should only be called for arrays of messages.
 //
@@ -118,6 +133,20 @@ upb_DecodeStatus upb_Map_PromoteMessages(upb_Map* map,
                                          const upb_MiniTable* mini_table,
                                          int decode_options, upb_Arena* arena);
 
+// Promotes every extension in `msg` and its (already parsed) sub-messages that
+// `extreg` knows about and that is still stored as unknown data.  Only
+// non-repeated message extensions are promoted, as with
+// upb_MiniTable_GetOrPromoteExtension().
+//
+// Afterwards, reading those extensions never mutates the message, so a message
+// that is otherwise immutable can be read from several threads at once.
+//
+// If the return value indicates an error status, some but not all extensions
+// may have been promoted, but the message will not be corrupted.
+upb_DecodeStatus upb_Message_PromoteExtensions(
+    upb_Message* msg, const upb_MiniTable* mini_table,
+    const upb_ExtensionRegistry* extreg, int decode_options, upb_Arena* arena);
+
 ////////////////////////////////////////////////////////////////////////////////
 // OLD promotion interfaces, will be removed!
 ////////////////////////////////////////////////////////////////////////////////
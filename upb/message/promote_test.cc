@@ -37,6 +37,7 @@
 #include "upb/mini_descriptor/internal/encode.hpp"
 #include "upb/mini_descriptor/internal/modifiers.h"
 #include "upb/mini_descriptor/link.h"
+#include "upb/mini_table/extension_registry.h"
 #include "upb/mini_table/field.h"
 #include "upb/mini_table/message.h"
 #include "upb/mini_table/sub.h"
@@ -230,6 +231,77 @@ TEST(GeneratedCode, Extensions) {
   upb_Arena_Free(arena);
 }
 
+TEST(GeneratedCode, PromoteExtensions) {
+  upb::Arena arena;
+  upb_test_ModelWithSubMessages* input_msg =
+      upb_test_ModelWithSubMessages_new(arena.ptr());
+  upb_test_ModelWithExtensions* child =
+      upb_test_ModelWithSubMessages_mutable_optional_child(input_msg,
+                                                           arena.ptr());
+  upb_test_ModelWithExtensions* item =
+      upb_test_ModelWithSubMessages_add_items(input_msg, arena.ptr());
+  upb_test_ModelExtension1* extension1 =
+      upb_test_ModelExtension1_new(arena.ptr());
+  upb_test_ModelExtension1_set_str(extension1,
+                                   upb_StringView_FromString("World"));
+  upb_test_ModelExtension1_set_model_ext(child, extension1, arena.ptr());
+  upb_test_ModelExtension2* extension2 =
+      upb_test_ModelExtension2_new(arena.ptr());
+  upb_test_ModelExtension2_set_i(extension2, 5);
+  upb_test_ModelExtension2_set_model_ext(item, extension2, arena.ptr());
+  size_t serialized_size;
+  char* serialized = upb_test_ModelWithSubMessages_serialize(
+      input_msg, arena.ptr(), &serialized_size);
+
+  // Parsing without a registry leaves the extensions as unknown fields.
+  upb_test_ModelWithSubMessages* msg = upb_test_ModelWithSubMessages_parse(
+      serialized, serialized_size, arena.ptr());
+  ASSERT_NE(msg, nullptr);
+  const upb_Message* parsed_child =
+      (const upb_Message*)upb_test_ModelWithSubMessages_optional_child(msg);
+  size_t items_size;
+  const upb_Message* parsed_item =
+      (const upb_Message*)upb_test_ModelWithSubMessages_items(msg,
+                                                              &items_size)[0];
+  EXPECT_EQ(0, upb_Message_ExtensionCount(parsed_child));
+  EXPECT_EQ(0, upb_Message_ExtensionCount(parsed_item));
+
+  upb_ExtensionRegistry* extreg = upb_ExtensionRegistry_New(arena.ptr());
+  ASSERT_TRUE(upb_ExtensionRegistry_Add(
+      extreg, &upb_test_ModelExtension1_model_ext_ext));
+  ASSERT_TRUE(upb_ExtensionRegistry_Add(
+      extreg, &upb_test_ModelExtension2_model_ext_ext));
+
+  // Promoting a second time is a no-op.
+  for (int i = 0; i < 2; i++) {
+    EXPECT_EQ(kUpb_DecodeStatus_Ok,
+              upb_Message_PromoteExtensions(
+                  (upb_Message*)msg, &upb_0test__ModelWithSubMessages_msg_init,
+                  extreg, 0, arena.ptr()));
+
+    size_t unknown_size;
+    upb_Message_GetUnknown(parsed_child, &unknown_size);
+    EXPECT_EQ(0, unknown_size);
+    EXPECT_EQ(1, upb_Message_ExtensionCount(parsed_child));
+    const upb_Message_Extension* ext = _upb_Message_Getext(
+        parsed_child, &upb_test_ModelExtension1_model_ext_ext);
+    ASSERT_NE(ext, nullptr);
+    EXPECT_TRUE(upb_StringView_IsEqual(
+        upb_StringView_FromString("World"),
+        upb_test_ModelExtension1_str(
+            (const upb_test_ModelExtension1*)ext->data.ptr)));
+
+    upb_Message_GetUnknown(parsed_item, &unknown_size);
+    EXPECT_EQ(0, unknown_size);
+    EXPECT_EQ(1, upb_Message_ExtensionCount(parsed_item));
+    ext = _upb_Message_Getext(parsed_item,
+                              &upb_test_ModelExtension2_model_ext_ext);
+    ASSERT_NE(ext, nullptr);
+    EXPECT_EQ(5, upb_test_ModelExtension2_i(
+                     (const upb_test_ModelExtension2*)ext->data.ptr));
+  }
+}
+
 // Create a minitable to mimic ModelWithSubMessages with unlinked subs
 // to lazily promote unknowns after parsing.
 upb_MiniTable* CreateMiniTableWithEmptySubTables(upb_Arena* arena) {
@@ -488,6 +560,100 @@ TEST(GeneratedCode, PromoteInParser) {
   EXPECT_EQ(entries[1], 12);
 }
 
+// Tests lazily parsed sub-messages, which stay "empty" even though the
+// MiniTable is linked, until they are read.
+TEST(GeneratedCode, LazySubMessage) {
+  upb::Arena arena;
+  upb_test_ModelWithSubMessages* input_msg =
+      upb_test_ModelWithSubMessages_new(arena.ptr());
+  upb_test_ModelWithExtensions* sub_message =
+      upb_test_ModelWithExtensions_new(arena.ptr());
+  upb_test_ModelWithSubMessages_set_id(input_msg, 11);
+  upb_test_ModelWithExtensions_add_repeated_int32(sub_message, 12, arena.ptr());
+  upb_test_ModelWithSubMessages_set_optional_child(input_msg, sub_message);
+  size_t serialized_size;
+  char* serialized = upb_test_ModelWithSubMessages_serialize(
+      input_msg, arena.ptr(), &serialized_size);
+
+  const upb_MiniTable* mini_table = &upb_0test__ModelWithSubMessages_msg_init;
+  const upb_MiniTableField* submsg_field =
+      upb_MiniTable_FindFieldByNumber(mini_table, 5);
+
+  // Parse twice, which merges the two copies of the sub-message.
+  upb_Message* msg = _upb_Message_New(mini_table, arena.ptr());
+  for (int i = 0; i < 2; i++) {
+    upb_DecodeStatus decode_status =
+        upb_Decode(serialized, serialized_size, msg, mini_table, nullptr,
+                   kUpb_DecodeOption_ExperimentalLazySubMessages, arena.ptr());
+    EXPECT_EQ(decode_status, kUpb_DecodeStatus_Ok);
+  }
+  EXPECT_EQ(upb_Message_GetInt32(
+                msg, upb_MiniTable_FindFieldByNumber(mini_table, 4), 0),
+            11);
+  EXPECT_TRUE(upb_Message_HasField(msg, submsg_field));
+  EXPECT_TRUE(upb_TaggedMessagePtr_IsEmpty(
+      upb_Message_GetTaggedMessagePtr(msg, submsg_field, nullptr)));
+
+  upb_test_ModelWithExtensions* promoted;
+  upb_DecodeStatus promote_result = upb_Message_GetOrPromoteMessage(
+      msg, mini_table, submsg_field, nullptr, 0, arena.ptr(),
+      (upb_Message**)&promoted);
+  EXPECT_EQ(promote_result, kUpb_DecodeStatus_Ok);
+  EXPECT_NE(nullptr, promoted);
+  EXPECT_EQ(promoted, upb_Message_GetMessage(msg, submsg_field, nullptr));
+  size_t repeated_size;
+  const int32_t* entries =
+      upb_test_ModelWithExtensions_repeated_int32(promoted, &repeated_size);
+  EXPECT_EQ(repeated_size, 2);
+  EXPECT_EQ(entries[0], 12);
+  EXPECT_EQ(entries[1], 12);
+
+  // Reading it again returns the same message.
+  upb_Message* again;
+  promote_result = upb_Message_GetOrPromoteMessage(
+      msg, mini_table, submsg_field, nullptr, 0, arena.ptr(), &again);
+  EXPECT_EQ(promote_result, kUpb_DecodeStatus_Ok);
+  EXPECT_EQ(again, (upb_Message*)promoted);
+}
+
+// Tests that a lazily parsed sub-message is serialized verbatim.
+TEST(GeneratedCode, LazySubMessageReserialize) {
+  upb::Arena arena;
+  upb_test_ModelWithSubMessages* input_msg =
+      upb_test_ModelWithSubMessages_new(arena.ptr());
+  upb_test_ModelWithExtensions* sub_message =
+      upb_test_ModelWithExtensions_new(arena.ptr());
+  upb_test_ModelWithSubMessages_set_id(input_msg, 11);
+  upb_test_ModelWithExtensions_set_random_int32(sub_message, 12);
+  upb_test_ModelWithSubMessages_set_optional_child(input_msg, sub_message);
+  size_t serialized_size;
+  char* serialized = upb_test_ModelWithSubMessages_serialize(
+      input_msg, arena.ptr(), &serialized_size);
+
+  const upb_MiniTable* mini_table = &upb_0test__ModelWithSubMessages_msg_init;
+  upb_Message* msg = _upb_Message_New(mini_table, arena.ptr());
+  upb_DecodeStatus decode_status =
+      upb_Decode(serialized, serialized_size, msg, mini_table, nullptr,
+                 kUpb_DecodeOption_ExperimentalLazySubMessages, arena.ptr());
+  EXPECT_EQ(decode_status, kUpb_DecodeStatus_Ok);
+  CheckReserialize(msg, mini_table, arena.ptr(), serialized, serialized_size);
+
+  // Sub-message data is still validated when it is promoted.
+  const upb_MiniTableField* submsg_field =
+      upb_MiniTable_FindFieldByNumber(mini_table, 5);
+  const char bad_input[] = {0x2a, 0x01, 0x08};  // Field 5, truncated varint.
+  upb_Message* bad = _upb_Message_New(mini_table, arena.ptr());
+  decode_status =
+      upb_Decode(bad_input, sizeof(bad_input), bad, mini_table, nullptr,
+                 kUpb_DecodeOption_ExperimentalLazySubMessages, arena.ptr());
+  EXPECT_EQ(decode_status, kUpb_DecodeStatus_Ok);
+  upb_Message* promoted;
+  EXPECT_EQ(upb_Message_GetOrPromoteMessage(bad, mini_table, submsg_field,
+                                            nullptr, 0, arena.ptr(),
+                                            &promoted),
+            kUpb_DecodeStatus_Malformed);
+}
+
 TEST(GeneratedCode, PromoteUnknownRepeatedMessage) {
   upb::Arena arena;
   upb_test_ModelWithSubMessages* input_msg =
@@ -104,6 +104,48 @@ TEST(MessageTest, Extensions) {
   VerifyMessage(ext_msg3);
 }
 
+TEST(MessageTest, FrozenExtensionRegistry) {
+  upb::Arena arena;
+  upb_ExtensionRegistry* extreg = upb_ExtensionRegistry_New(arena.ptr());
+  const upb_MiniTableExtension* exts[] = {
+      &upb_test_TestExtensions_optional_int32_ext_ext,
+      &upb_test_TestExtensions_Nested_repeated_int32_ext_ext,
+      &upb_test_optional_msg_ext_ext,
+  };
+  ASSERT_TRUE(upb_ExtensionRegistry_AddArray(extreg, exts, 3));
+  ASSERT_TRUE(upb_ExtensionRegistry_Freeze(extreg));
+
+  const upb_MiniTable* extendee = &upb_0test__TestExtensions_msg_init;
+  for (const upb_MiniTableExtension* ext : exts) {
+    EXPECT_EQ(ext, upb_ExtensionRegistry_Lookup(extreg, extendee,
+                                                ext->field.number));
+  }
+  EXPECT_EQ(nullptr, upb_ExtensionRegistry_Lookup(extreg, extendee, 1003));
+  EXPECT_EQ(nullptr, upb_ExtensionRegistry_Lookup(
+                         extreg, &upb_0test__TestMessageSet_msg_init, 1000));
+
+  // Nothing can be added once the registry is frozen.
+  EXPECT_FALSE(upb_ExtensionRegistry_Add(
+      extreg, &upb_test_MessageSetMember_message_set_extension_ext));
+  EXPECT_EQ(nullptr,
+            upb_ExtensionRegistry_Lookup(
+                extreg, &upb_0test__TestMessageSet_msg_init,
+                upb_test_MessageSetMember_message_set_extension_ext.field
+                    .number));
+
+  upb_test_TestExtensions* ext_msg = upb_test_TestExtensions_new(arena.ptr());
+  upb_test_TestExtensions_set_optional_int32_ext(ext_msg, 123, arena.ptr());
+  size_t size;
+  char* serialized =
+      upb_test_TestExtensions_serialize(ext_msg, arena.ptr(), &size);
+  ASSERT_TRUE(serialized != nullptr);
+  upb_test_TestExtensions* parsed = upb_test_TestExtensions_parse_ex(
+      serialized, size, extreg, 0, arena.ptr());
+  ASSERT_TRUE(parsed != nullptr);
+  EXPECT_TRUE(upb_test_TestExtensions_has_optional_int32_ext(parsed));
+  EXPECT_EQ(123, upb_test_TestExtensions_optional_int32_ext(parsed));
+}
+
 void VerifyMessageSet(const upb_test_TestMessageSet* mset_msg) {
   ASSERT_TRUE(mset_msg != nullptr);
   bool has = upb_test_MessageSetMember_has_message_set_extension(mset_msg);
@@ -398,6 +440,26 @@ TEST(MessageTest, DecodeRequiredFieldsSubMessage) {
                          kUpb_DecodeOption_CheckRequired, arena.ptr()));
 }
 
+TEST(MessageTest, DecodeRequiredFieldsSubMessageCompletedLater) {
+  upb::Arena arena;
+  // optional_message { required_int32: 1 }
+  std::string first("\x0a\x02\x08\x01", 4);
+  // optional_message { required_int64: 2 required_message {} }
+  std::string second("\x0a\x04\x18\x02\x2a\x00", 6);
+
+  // The sub-message is incomplete where its first occurrence ends.
+  EXPECT_EQ(nullptr, upb_test_SubMessageHasRequired_parse_ex(
+                         first.data(), first.size(), nullptr,
+                         kUpb_DecodeOption_CheckRequired, arena.ptr()));
+
+  // No parse error; the second occurrence is merged into the first and
+  // completes it.
+  std::string both = first + second;
+  EXPECT_NE(nullptr, upb_test_SubMessageHasRequired_parse_ex(
+                         both.data(), both.size(), nullptr,
+                         kUpb_DecodeOption_CheckRequired, arena.ptr()));
+}
+
 TEST(MessageTest, EncodeRequiredFields) {
   upb::Arena arena;
   upb_test_TestRequiredFields* test_msg =
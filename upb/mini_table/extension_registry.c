@@ -18,6 +18,11 @@
 struct upb_ExtensionRegistry {
   upb_Arena* arena;
   upb_strtable exts;  // Key is upb_MiniTable* concatenated with fieldnum.
+
+  // Set by upb_ExtensionRegistry_Freeze(): an open-addressed copy of `exts`,
+  // at most half full, so that every probe sequence ends at a NULL slot.
+  const upb_MiniTableExtension** frozen;
+  uint32_t frozen_mask;
 };
 
 static void extreg_key(char* buf, const upb_MiniTable* l, uint32_t fieldnum) {
@@ -25,16 +30,26 @@ static void extreg_key(char* buf, const upb_MiniTable* l, uint32_t fieldnum) {
   memcpy(buf + sizeof(l), &fieldnum, sizeof(fieldnum));
 }
 
+static uint32_t extreg_hash(const upb_MiniTable* l, uint32_t fieldnum) {
+  uint64_t h = (uintptr_t)l ^ (fieldnum * 0x9e3779b97f4a7c15ull);
+  h ^= h >> 32;
+  h *= 0xd6e8feb86659fd93ull;
+  return (uint32_t)(h ^ (h >> 32));
+}
+
 upb_ExtensionRegistry* upb_ExtensionRegistry_New(upb_Arena* arena) {
   upb_ExtensionRegistry* r = upb_Arena_Malloc(arena, sizeof(*r));
   if (!r) return NULL;
   r->arena = arena;
+  r->frozen = NULL;
+  r->frozen_mask = 0;
   if (!upb_strtable_init(&r->exts, 8, arena)) return NULL;
   return r;
 }
 
 UPB_API bool upb_ExtensionRegistry_Add(upb_ExtensionRegistry* r,
                                        const upb_MiniTableExtension* e) {
+  if (r->frozen) return false;
   char buf[EXTREG_KEY_SIZE];
   extreg_key(buf, e->extendee, e->field.number);
   if (upb_strtable_lookup2(&r->exts, buf, EXTREG_KEY_SIZE, NULL)) return false;
@@ -63,8 +78,41 @@ failure:
   return false;
 }
 
+bool upb_ExtensionRegistry_Freeze(upb_ExtensionRegistry* r) {
+  if (r->frozen) return true;
+  size_t size = 2;
+  while (size < 2 * upb_strtable_count(&r->exts)) size *= 2;
+  const upb_MiniTableExtension** table =
+      upb_Arena_Malloc(r->arena, size * sizeof(*table));
+  if (!table) return false;
+  memset(table, 0, size * sizeof(*table));
+
+  const uint32_t mask = size - 1;
+  intptr_t iter = UPB_STRTABLE_BEGIN;
+  upb_StringView key;
+  upb_value val;
+  while (upb_strtable_next2(&r->exts, &key, &val, &iter)) {
+    const upb_MiniTableExtension* e = upb_value_getconstptr(val);
+    uint32_t i = extreg_hash(e->extendee, e->field.number) & mask;
+    while (table[i]) i = (i + 1) & mask;
+    table[i] = e;
+  }
+  r->frozen_mask = mask;
+  r->frozen = table;
+  return true;
+}
+
 const upb_MiniTableExtension* upb_ExtensionRegistry_Lookup(
     const upb_ExtensionRegistry* r, const upb_MiniTable* t, uint32_t num) {
+  if (r->frozen) {
+    uint32_t i = extreg_hash(t, num) & r->frozen_mask;
+    for (const upb_MiniTableExtension* e; (e = r->frozen[i]) != NULL;
+         i = (i + 1) & r->frozen_mask) {
+      if (e->extendee == t && e->field.number == num) return e;
+    }
+    return NULL;
+  }
+
   char buf[EXTREG_KEY_SIZE];
   upb_value v;
   extreg_key(buf, t, num);
@@ -59,18 +59,29 @@ typedef struct upb_ExtensionRegistry upb_ExtensionRegistry;
 // The arena must outlive any use of the extreg.
 UPB_API upb_ExtensionRegistry* upb_ExtensionRegistry_New(upb_Arena* arena);
 
+// Adds the given extension info to the registry.  Returns false if the
+// extension number already exists, the registry is frozen, or out of memory.
 UPB_API bool upb_ExtensionRegistry_Add(upb_ExtensionRegistry* r,
                                        const upb_MiniTableExtension* e);
 
 // Adds the given extension info for the array |e| of size |count| into the
 // registry. If there are any errors, the entire array is backed out.
 // The extensions must outlive the registry.
-// Possible errors include OOM or an extension number that already exists.
+// Possible errors include OOM, an extension number that already exists, or a
+// frozen registry.
 // TODO: There is currently no way to know the exact reason for failure.
 bool upb_ExtensionRegistry_AddArray(upb_ExtensionRegistry* r,
                                     const upb_MiniTableExtension** e,
                                     size_t count);
 
+// Freezes the registry: no more extensions can be added, and lookups switch to
+// a flat table that is faster to probe.  A frozen registry is never written
+// again, so any number of threads may decode with it concurrently.  Returns
+// false if out of memory, in which case the registry is left unfrozen.
+//
+// The registry of a upb_DefPool must not be frozen, as it grows with the pool.
+UPB_API bool upb_ExtensionRegistry_Freeze(upb_ExtensionRegistry* r);
+
 // Looks up the extension (if any) defined for message type |t| and field
 // number |num|. Returns the extension if found, otherwise NULL.
 UPB_API const upb_MiniTableExtension* upb_ExtensionRegistry_Lookup(
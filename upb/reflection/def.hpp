@@ -551,6 +551,11 @@ class DefPool {
         upb_DefPool_AddFile(ptr_.get(), file_proto, status->ptr()));
   }
 
+  // Adds all files of the given serialized FileDescriptorSet to the pool.
+  bool AddFileSet(const char* buf, size_t size, Status* status) {
+    return upb_DefPool_AddFileSet(ptr_.get(), buf, size, status->ptr());
+  }
+
  private:
   std::unique_ptr<upb_DefPool, decltype(&upb_DefPool_Free)> ptr_;
 };
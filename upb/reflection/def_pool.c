@@ -294,9 +294,12 @@ static const upb_FileDef* upb_DefBuilder_AddFileToPool(
   return builder->file;
 }
 
+static const upb_StringView kNoMiniTables = {NULL, 0};
+
 static const upb_FileDef* _upb_DefPool_AddFile(
     upb_DefPool* s, const UPB_DESC(FileDescriptorProto) * file_proto,
-    const upb_MiniTableFile* layout, upb_Status* status) {
+    const upb_MiniTableFile* layout, upb_StringView minitables,
+    upb_Status* status) {
   const upb_StringView name = UPB_DESC(FileDescriptorProto_name)(file_proto);
 
   // Determine whether we already know about this file.
@@ -313,6 +316,7 @@ static const upb_FileDef* _upb_DefPool_AddFile(
   upb_DefBuilder ctx = {
       .symtab = s,
       .layout = layout,
+      .minitables = minitables,
       .platform = s->platform,
       .msg_count = 0,
       .enum_count = 0,
@@ -330,7 +334,187 @@ const upb_FileDef* upb_DefPool_AddFile(upb_DefPool* s,
                                        const UPB_DESC(FileDescriptorProto) *
                                            file_proto,
                                        upb_Status* status) {
-  return _upb_DefPool_AddFile(s, file_proto, NULL, status);
+  return _upb_DefPool_AddFile(s, file_proto, NULL, kNoMiniTables, status);
+}
+
+void _upb_DefPool_MiniTableCacheHeader(const upb_DefPool* s, const char* buf,
+                                       size_t size, char* out) {
+  const uint64_t file_size = size;
+  const uint64_t hash =
+      ((uint64_t)_upb_Hash(buf, size, 0) << 32) | _upb_Hash(buf, size, 1);
+  memcpy(out, "upbM", 4);
+  out[4] = 1;  // Format version.
+  out[5] = s->platform;
+  out[6] = sizeof(void*);
+  out[7] = sizeof(upb_MiniTableField);
+  memcpy(out + 8, &file_size, sizeof(file_size));
+  memcpy(out + 16, &hash, sizeof(hash));
+}
+
+const upb_FileDef* upb_DefPool_AddSerializedFile(
+    upb_DefPool* s, const char* buf, size_t size, const char* minitables,
+    size_t minitables_size, upb_Status* status) {
+  upb_Arena* arena = upb_Arena_New();
+  if (!arena) {
+    upb_Status_SetErrorMessage(status, "out of memory");
+    return NULL;
+  }
+
+  const upb_FileDef* ret = NULL;
+  const UPB_DESC(FileDescriptorProto)* file_proto =
+      UPB_DESC(FileDescriptorProto_parse_ex)(
+          buf, size, NULL, kUpb_DecodeOption_AliasString, arena);
+  if (file_proto) {
+    // A cache saved for another file or platform is ignored.
+    upb_StringView cache = kNoMiniTables;
+    char header[kUpb_MiniTableCache_HeaderSize];
+    _upb_DefPool_MiniTableCacheHeader(s, buf, size, header);
+    if (minitables_size >= sizeof(header) &&
+        memcmp(minitables, header, sizeof(header)) == 0) {
+      cache = upb_StringView_FromDataAndSize(minitables + sizeof(header),
+                                             minitables_size - sizeof(header));
+    }
+    ret = _upb_DefPool_AddFile(s, file_proto, NULL, cache, status);
+  } else {
+    upb_Status_SetErrorMessage(status, "failed to parse FileDescriptorProto");
+  }
+
+  upb_Arena_Free(arena);
+  return ret;
+}
+
+static size_t _upb_DefPool_CountEnumSyms(
+    const UPB_DESC(EnumDescriptorProto) * const* enums, size_t n) {
+  size_t count = n;
+  for (size_t i = 0; i < n; i++) {
+    size_t values;
+    UPB_DESC(EnumDescriptorProto_value)(enums[i], &values);
+    count += values;
+  }
+  return count;
+}
+
+static size_t _upb_DefPool_CountMessageSyms(
+    const UPB_DESC(DescriptorProto) * const* msgs, size_t n) {
+  size_t count = n;
+  for (size_t i = 0; i < n; i++) {
+    size_t nested, enums, exts;
+    const UPB_DESC(DescriptorProto)* const* nested_msgs =
+        UPB_DESC(DescriptorProto_nested_type)(msgs[i], &nested);
+    const UPB_DESC(EnumDescriptorProto)* const* nested_enums =
+        UPB_DESC(DescriptorProto_enum_type)(msgs[i], &enums);
+    UPB_DESC(DescriptorProto_extension)(msgs[i], &exts);
+    count += _upb_DefPool_CountMessageSyms(nested_msgs, nested) +
+             _upb_DefPool_CountEnumSyms(nested_enums, enums) + exts;
+  }
+  return count;
+}
+
+// The number of symbols the file will add to the pool.
+static size_t _upb_DefPool_CountFileSyms(
+    const UPB_DESC(FileDescriptorProto) * file) {
+  size_t msgs, enums, exts, services;
+  const UPB_DESC(DescriptorProto)* const* msg_protos =
+      UPB_DESC(FileDescriptorProto_message_type)(file, &msgs);
+  const UPB_DESC(EnumDescriptorProto)* const* enum_protos =
+      UPB_DESC(FileDescriptorProto_enum_type)(file, &enums);
+  UPB_DESC(FileDescriptorProto_extension)(file, &exts);
+  UPB_DESC(FileDescriptorProto_service)(file, &services);
+  return _upb_DefPool_CountMessageSyms(msg_protos, msgs) +
+         _upb_DefPool_CountEnumSyms(enum_protos, enums) + exts + services;
+}
+
+typedef struct {
+  upb_DefPool* s;
+  const UPB_DESC(FileDescriptorProto) * const* files;
+  upb_strtable by_name;  // file_name -> index into `files`
+  bool* visited;
+  upb_Status* status;
+} upb_FileSetLoader;
+
+// Adds file `i` after the files of the set it depends on.
+static bool _upb_DefPool_AddFileFromSet(upb_FileSetLoader* l, size_t i) {
+  if (l->visited[i]) return true;
+  l->visited[i] = true;
+
+  const UPB_DESC(FileDescriptorProto)* file = l->files[i];
+  const upb_StringView name = UPB_DESC(FileDescriptorProto_name)(file);
+  if (upb_DefPool_FindFileByNameWithSize(l->s, name.data, name.size)) {
+    return true;
+  }
+
+  size_t n;
+  const upb_StringView* deps =
+      UPB_DESC(FileDescriptorProto_dependency)(file, &n);
+  for (size_t j = 0; j < n; j++) {
+    upb_value v;
+    if (upb_strtable_lookup2(&l->by_name, deps[j].data, deps[j].size, &v) &&
+        !_upb_DefPool_AddFileFromSet(l, upb_value_getuint64(v))) {
+      return false;
+    }
+  }
+
+  return _upb_DefPool_AddFile(l->s, file, NULL, kNoMiniTables, l->status) !=
+         NULL;
+}
+
+bool upb_DefPool_AddFileSet(upb_DefPool* s, const char* buf, size_t size,
+                            upb_Status* status) {
+  upb_Arena* arena = upb_Arena_New();
+  if (!arena) {
+    upb_Status_SetErrorMessage(status, "out of memory");
+    return false;
+  }
+
+  bool ok = false;
+  const UPB_DESC(FileDescriptorSet)* set = UPB_DESC(FileDescriptorSet_parse_ex)(
+      buf, size, NULL, kUpb_DecodeOption_AliasString, arena);
+  if (!set) {
+    upb_Status_SetErrorMessage(status, "failed to parse FileDescriptorSet");
+    goto done;
+  }
+  s->bytes_loaded += size;
+
+  size_t n;
+  upb_FileSetLoader l = {
+      .s = s,
+      .files = UPB_DESC(FileDescriptorSet_file)(set, &n),
+      .visited = upb_Arena_Malloc(arena, n * sizeof(bool) + 1),
+      .status = status,
+  };
+  if (!l.visited || !upb_strtable_init(&l.by_name, n, arena)) {
+    upb_Status_SetErrorMessage(status, "out of memory");
+    goto done;
+  }
+  memset(l.visited, 0, n * sizeof(bool));
+
+  // Size the pool's tables for the whole set up front, rather than growing
+  // them over and over while the files are added.
+  size_t syms = upb_strtable_count(&s->syms);
+  for (size_t i = 0; i < n; i++) {
+    const upb_StringView name = UPB_DESC(FileDescriptorProto_name)(l.files[i]);
+    if (!upb_strtable_insert(&l.by_name, name.data, name.size,
+                             upb_value_uint64(i), arena)) {
+      upb_Status_SetErrorMessage(status, "out of memory");
+      goto done;
+    }
+    syms += _upb_DefPool_CountFileSyms(l.files[i]);
+  }
+  if (!upb_strtable_reserve(&s->syms, syms, s->arena) ||
+      !upb_strtable_reserve(&s->files, upb_strtable_count(&s->files) + n,
+                            s->arena)) {
+    upb_Status_SetErrorMessage(status, "out of memory");
+    goto done;
+  }
+
+  ok = true;
+  for (size_t i = 0; i < n && ok; i++) {
+    ok = _upb_DefPool_AddFileFromSet(&l, i);
+  }
+
+done:
+  upb_Arena_Free(arena);
+  return ok;
 }
 
 bool _upb_DefPool_LoadDefInitEx(upb_DefPool* s, const _upb_DefPool_Init* init,
@@ -369,7 +553,7 @@ bool _upb_DefPool_LoadDefInitEx(upb_DefPool* s, const _upb_DefPool_Init* init,
   }
 
   const upb_MiniTableFile* mt = rebuild_minitable ? NULL : init->layout;
-  if (!_upb_DefPool_AddFile(s, file, mt, &status)) {
+  if (!_upb_DefPool_AddFile(s, file, mt, kNoMiniTables, &status)) {
     goto err;
   }
 
@@ -71,6 +71,26 @@ UPB_API const upb_FileDef* upb_DefPool_AddFile(
     upb_DefPool* s, const UPB_DESC(FileDescriptorProto) * file_proto,
     upb_Status* status);
 
+// Like upb_DefPool_AddFile(), but takes a serialized FileDescriptorProto.
+// `minitables` may hold what upb_FileDef_SerializeMiniTables() saved for the
+// same file, in which case the file's message MiniTables are loaded from it
+// instead of being built.  If `minitables` was saved for another file or
+// platform, it is ignored and the MiniTables are built as usual.
+UPB_API const upb_FileDef* upb_DefPool_AddSerializedFile(
+    upb_DefPool* s, const char* buf, size_t size, const char* minitables,
+    size_t minitables_size, upb_Status* status);
+
+// Adds every file of a serialized FileDescriptorSet.  The set is parsed once
+// and the pool's tables are sized for all of it up front, which makes this
+// cheaper than adding the files one at a time.  Files may be listed in any
+// order: each one is added after the files of the set it imports.  Files that
+// are already in the pool are skipped.
+//
+// On failure, returns false and sets `status`.  Files added before the failing
+// one stay in the pool.
+UPB_API bool upb_DefPool_AddFileSet(upb_DefPool* s, const char* buf,
+                                    size_t size, upb_Status* status);
+
 const upb_ExtensionRegistry* upb_DefPool_ExtensionRegistry(
     const upb_DefPool* s);
 
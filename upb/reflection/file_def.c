@@ -141,6 +141,27 @@ const upb_MiniTableExtension* _upb_FileDef_ExtensionMiniTable(
   return f->ext_layouts[i];
 }
 
+char* upb_FileDef_SerializeMiniTables(const upb_FileDef* f, const char* buf,
+                                      size_t size, upb_Arena* a,
+                                      size_t* out_size) {
+  size_t total = kUpb_MiniTableCache_HeaderSize;
+  for (int i = 0; i < f->top_lvl_msg_count; i++) {
+    total += _upb_MessageDef_MiniTablesSize(upb_FileDef_TopLevelMessage(f, i));
+  }
+
+  char* ret = upb_Arena_Malloc(a, total);
+  if (!ret) return NULL;
+  _upb_DefPool_MiniTableCacheHeader(f->symtab, buf, size, ret);
+  char* ptr = ret + kUpb_MiniTableCache_HeaderSize;
+  for (int i = 0; i < f->top_lvl_msg_count; i++) {
+    ptr = _upb_MessageDef_SerializeMiniTables(
+        upb_FileDef_TopLevelMessage(f, i), ptr);
+  }
+  UPB_ASSERT(ptr == ret + total);
+  *out_size = total;
+  return ret;
+}
+
 static char* strviewdup(upb_DefBuilder* ctx, upb_StringView view) {
   char* ret = upb_strdup2(view.data, view.size, _upb_DefBuilder_Arena(ctx));
   if (!ret) _upb_DefBuilder_OomErr(ctx);
@@ -327,6 +348,11 @@ void _upb_FileDef_Create(upb_DefBuilder* ctx,
     _upb_MessageDef_CreateMiniTable(ctx, (upb_MessageDef*)m);
   }
 
+  if (ctx->minitables.size != 0) {
+    _upb_DefBuilder_Errf(ctx, "invalid cached MiniTables for file %s",
+                         file->name);
+  }
+
   for (int i = 0; i < file->top_lvl_ext_count; i++) {
     upb_FieldDef* f = (upb_FieldDef*)upb_FileDef_TopLevelExtension(file, i);
     _upb_FieldDef_BuildMiniTableExtension(ctx, f);
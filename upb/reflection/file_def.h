@@ -48,6 +48,15 @@ int upb_FileDef_TopLevelMessageCount(const upb_FileDef* f);
 const upb_FileDef* upb_FileDef_WeakDependency(const upb_FileDef* f, int i);
 int upb_FileDef_WeakDependencyCount(const upb_FileDef* f);
 
+// Saves the MiniTables of the file's messages, so that a later process can
+// pass them to upb_DefPool_AddSerializedFile() to skip building them.  `buf`
+// must be the serialized FileDescriptorProto the file was built from.  The
+// result is only valid for that file, on the same platform.  Returns NULL if
+// out of memory.
+char* upb_FileDef_SerializeMiniTables(const upb_FileDef* f, const char* buf,
+                                      size_t size, upb_Arena* a,
+                                      size_t* out_size);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -33,6 +33,12 @@ void** _upb_DefPool_ScratchData(const upb_DefPool* s);
 size_t* _upb_DefPool_ScratchSize(const upb_DefPool* s);
 void _upb_DefPool_SetPlatform(upb_DefPool* s, upb_MiniTablePlatform platform);
 
+// Cached MiniTables start with a header that ties them to one serialized
+// FileDescriptorProto and to the pool's platform.
+enum { kUpb_MiniTableCache_HeaderSize = 24 };
+void _upb_DefPool_MiniTableCacheHeader(const upb_DefPool* s, const char* buf,
+                                       size_t size, char* out);
+
 // For generated code only: loads a generated descriptor.
 typedef struct _upb_DefPool_Init {
   struct _upb_DefPool_Init** deps;  // Dependencies of this file.
@@ -29,6 +29,14 @@ void _upb_MessageDef_LinkMiniTable(upb_DefBuilder* ctx,
                                    const upb_MessageDef* m);
 void _upb_MessageDef_Resolve(upb_DefBuilder* ctx, upb_MessageDef* m);
 
+// The size of the MiniTables of `m` and its nested messages, as written by
+// _upb_MessageDef_SerializeMiniTables().
+size_t _upb_MessageDef_MiniTablesSize(const upb_MessageDef* m);
+
+// Writes the MiniTables of `m` and its nested messages to `ptr`, in the order
+// _upb_MessageDef_CreateMiniTable() reads them back.  Returns the end.
+char* _upb_MessageDef_SerializeMiniTables(const upb_MessageDef* m, char* ptr);
+
 // Allocate and initialize an array of |n| message defs.
 upb_MessageDef* _upb_MessageDefs_New(
     upb_DefBuilder* ctx, int n, const UPB_DESC(DescriptorProto) * const* protos,
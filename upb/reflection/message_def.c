@@ -424,8 +424,109 @@ void _upb_MessageDef_InsertField(upb_DefBuilder* ctx, upb_MessageDef* m,
   if (!ok) _upb_DefBuilder_OomErr(ctx);
 }
 
+// Each cached MiniTable is a fixed header followed by its fields.
+enum { kUpb_CachedMiniTable_HeaderSize = 8 };
+
+UPB_NORETURN static void _upb_MessageDef_CacheErr(upb_DefBuilder* ctx,
+                                                  const upb_MessageDef* m) {
+  _upb_DefBuilder_Errf(ctx, "invalid cached MiniTable for %s", m->full_name);
+}
+
+static upb_MiniTable* _upb_MessageDef_LoadMiniTable(upb_DefBuilder* ctx,
+                                                    const upb_MessageDef* m) {
+  const char* ptr = ctx->minitables.data;
+  uint16_t size, field_count;
+  if (ctx->minitables.size < kUpb_CachedMiniTable_HeaderSize) {
+    _upb_MessageDef_CacheErr(ctx, m);
+  }
+  memcpy(&size, ptr, sizeof(size));
+  memcpy(&field_count, ptr + 2, sizeof(field_count));
+  const size_t fields_size = field_count * sizeof(upb_MiniTableField);
+  if (field_count != m->field_count ||
+      ctx->minitables.size - kUpb_CachedMiniTable_HeaderSize < fields_size) {
+    _upb_MessageDef_CacheErr(ctx, m);
+  }
+
+  upb_MiniTable* ret = _upb_DefBuilder_Alloc(ctx, sizeof(*ret));
+  upb_MiniTableField* fields = _upb_DefBuilder_Alloc(ctx, fields_size);
+  if (fields_size) {
+    memcpy(fields, ptr + kUpb_CachedMiniTable_HeaderSize, fields_size);
+  }
+  ret->fields = fields;
+  ret->size = size;
+  ret->field_count = field_count;
+  ret->ext = ptr[4];
+  ret->dense_below = ptr[5];
+  ret->required_count = ptr[6];
+  ret->table_mask = (uint8_t)-1;
+
+  // Subs start out unlinked, as upb_MiniTable_Build() leaves them;
+  // _upb_MessageDef_LinkMiniTable() fills them in.
+  int sub_count = 0;
+  for (int i = 0; i < field_count; i++) {
+    if (fields[i].UPB_PRIVATE(submsg_index) != kUpb_NoSub) sub_count++;
+  }
+  upb_MiniTableSub* subs =
+      _upb_DefBuilder_Alloc(ctx, sub_count * sizeof(*subs));
+  for (int i = 0; i < field_count; i++) {
+    const uint16_t index = fields[i].UPB_PRIVATE(submsg_index);
+    if (index == kUpb_NoSub) continue;
+    if (index >= sub_count) _upb_MessageDef_CacheErr(ctx, m);
+    if (fields[i].UPB_PRIVATE(descriptortype) == kUpb_FieldType_Enum) {
+      subs[index].subenum = NULL;
+    } else {
+      subs[index].submsg = &_kUpb_MiniTable_Empty;
+    }
+  }
+  ret->subs = subs;
+
+  ctx->minitables.data += kUpb_CachedMiniTable_HeaderSize + fields_size;
+  ctx->minitables.size -= kUpb_CachedMiniTable_HeaderSize + fields_size;
+  return ret;
+}
+
+size_t _upb_MessageDef_MiniTablesSize(const upb_MessageDef* m) {
+  size_t ret = kUpb_CachedMiniTable_HeaderSize +
+               m->layout->field_count * sizeof(upb_MiniTableField);
+  for (int i = 0; i < m->nested_msg_count; i++) {
+    ret += _upb_MessageDef_MiniTablesSize(&m->nested_msgs[i]);
+  }
+  return ret;
+}
+
+char* _upb_MessageDef_SerializeMiniTables(const upb_MessageDef* m,
+                                          char* ptr) {
+  const upb_MiniTable* mt = m->layout;
+  const size_t fields_size = mt->field_count * sizeof(upb_MiniTableField);
+  memcpy(ptr, &mt->size, sizeof(mt->size));
+  memcpy(ptr + 2, &mt->field_count, sizeof(mt->field_count));
+  ptr[4] = mt->ext;
+  ptr[5] = mt->dense_below;
+  ptr[6] = mt->required_count;
+  ptr[7] = 0;
+  ptr += kUpb_CachedMiniTable_HeaderSize;
+  if (fields_size) memcpy(ptr, mt->fields, fields_size);
+  ptr += fields_size;
+  for (int i = 0; i < m->nested_msg_count; i++) {
+    ptr = _upb_MessageDef_SerializeMiniTables(&m->nested_msgs[i], ptr);
+  }
+  return ptr;
+}
+
 void _upb_MessageDef_CreateMiniTable(upb_DefBuilder* ctx, upb_MessageDef* m) {
-  if (ctx->layout == NULL) {
+  if (ctx->layout == NULL && ctx->minitables.data != NULL) {
+    m->layout = _upb_MessageDef_LoadMiniTable(ctx, m);
+
+    // Assigns layout_index for all the fields, and checks that the cached
+    // fields are the ones of this message.
+    const upb_FieldDef** sorted =
+        _upb_FieldDefs_Sorted(m->fields, m->field_count, ctx->tmp_arena);
+    for (int i = 0; i < m->field_count; i++) {
+      if (upb_FieldDef_Number(sorted[i]) != m->layout->fields[i].number) {
+        _upb_MessageDef_CacheErr(ctx, m);
+      }
+    }
+  } else if (ctx->layout == NULL) {
     m->layout = _upb_MessageDef_MakeMiniTable(ctx, m);
   } else {
     UPB_ASSERT(ctx->msg_count < ctx->layout->msg_count);
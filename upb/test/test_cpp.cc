@@ -14,11 +14,13 @@
 #include <set>
 #include <sstream>
 
+#include "google/protobuf/descriptor.upb.h"
 #include "google/protobuf/timestamp.upb.h"
 #include "google/protobuf/timestamp.upbdefs.h"
 #include <gtest/gtest.h>
 #include "upb/json/decode.h"
 #include "upb/json/encode.h"
+#include "upb/mini_table/message.h"
 #include "upb/reflection/def.h"
 #include "upb/reflection/def.hpp"
 #include "upb/test/test_cpp.upb.h"
@@ -106,3 +108,151 @@ TEST(Cpp, TimestampEncoder) {
     EXPECT_EQ(timestamp, timestamp_decoded);
   }
 }
+
+// Adds a file holding one empty message to the set.
+static google_protobuf_DescriptorProto* AddFile(
+    google_protobuf_FileDescriptorSet* set, const char* name,
+    const char* dependency, const char* message, upb_Arena* arena) {
+  google_protobuf_FileDescriptorProto* file =
+      google_protobuf_FileDescriptorSet_add_file(set, arena);
+  google_protobuf_FileDescriptorProto_set_name(
+      file, upb_StringView_FromString(name));
+  if (dependency) {
+    google_protobuf_FileDescriptorProto_add_dependency(
+        file, upb_StringView_FromString(dependency), arena);
+  }
+  google_protobuf_DescriptorProto* m =
+      google_protobuf_FileDescriptorProto_add_message_type(file, arena);
+  google_protobuf_DescriptorProto_set_name(m,
+                                           upb_StringView_FromString(message));
+  return m;
+}
+
+TEST(Cpp, AddFileSet) {
+  upb::Arena arena;
+  google_protobuf_FileDescriptorSet* set =
+      google_protobuf_FileDescriptorSet_new(arena.ptr());
+
+  // b.proto imports a.proto, but comes first.
+  google_protobuf_DescriptorProto* b =
+      AddFile(set, "b.proto", "a.proto", "B", arena.ptr());
+  google_protobuf_FieldDescriptorProto* f =
+      google_protobuf_DescriptorProto_add_field(b, arena.ptr());
+  google_protobuf_FieldDescriptorProto_set_name(
+      f, upb_StringView_FromString("a"));
+  google_protobuf_FieldDescriptorProto_set_number(f, 1);
+  google_protobuf_FieldDescriptorProto_set_label(
+      f, google_protobuf_FieldDescriptorProto_LABEL_OPTIONAL);
+  google_protobuf_FieldDescriptorProto_set_type(
+      f, google_protobuf_FieldDescriptorProto_TYPE_MESSAGE);
+  google_protobuf_FieldDescriptorProto_set_type_name(
+      f, upb_StringView_FromString(".A"));
+  AddFile(set, "a.proto", nullptr, "A", arena.ptr());
+
+  size_t size;
+  char* data =
+      google_protobuf_FileDescriptorSet_serialize(set, arena.ptr(), &size);
+  ASSERT_NE(data, nullptr);
+
+  upb::DefPool defpool;
+  upb::Status status;
+  ASSERT_TRUE(defpool.AddFileSet(data, size, &status))
+      << status.error_message();
+  upb::MessageDefPtr a = defpool.FindMessageByName("A");
+  upb::MessageDefPtr b_msg = defpool.FindMessageByName("B");
+  ASSERT_TRUE(a);
+  ASSERT_TRUE(b_msg);
+  EXPECT_EQ(b_msg.FindFieldByName("a").message_type(), a);
+
+  // Files already in the pool are skipped.
+  EXPECT_TRUE(defpool.AddFileSet(data, size, &status))
+      << status.error_message();
+
+  // Dependencies outside the set must be in the pool already.
+  google_protobuf_FileDescriptorSet_resize_file(set, 1, arena.ptr());
+  data = google_protobuf_FileDescriptorSet_serialize(set, arena.ptr(), &size);
+  upb::DefPool other;
+  EXPECT_FALSE(other.AddFileSet(data, size, &status));
+  EXPECT_FALSE(other.FindMessageByName("B"));
+}
+
+TEST(Cpp, CachedMiniTables) {
+  upb::Arena arena;
+  google_protobuf_FileDescriptorSet* set =
+      google_protobuf_FileDescriptorSet_new(arena.ptr());
+  google_protobuf_DescriptorProto* a =
+      AddFile(set, "a.proto", nullptr, "A", arena.ptr());
+  const char* names[] = {"x", "child", "s"};
+  for (int i = 0; i < 3; i++) {
+    google_protobuf_FieldDescriptorProto* f =
+        google_protobuf_DescriptorProto_add_field(a, arena.ptr());
+    google_protobuf_FieldDescriptorProto_set_name(
+        f, upb_StringView_FromString(names[i]));
+    google_protobuf_FieldDescriptorProto_set_number(f, i + 1);
+    google_protobuf_FieldDescriptorProto_set_label(
+        f, google_protobuf_FieldDescriptorProto_LABEL_OPTIONAL);
+  }
+  google_protobuf_FieldDescriptorProto* child =
+      google_protobuf_DescriptorProto_mutable_field(a, nullptr)[1];
+  google_protobuf_FieldDescriptorProto_set_type(
+      google_protobuf_DescriptorProto_mutable_field(a, nullptr)[0],
+      google_protobuf_FieldDescriptorProto_TYPE_INT32);
+  google_protobuf_FieldDescriptorProto_set_type(
+      child, google_protobuf_FieldDescriptorProto_TYPE_MESSAGE);
+  google_protobuf_FieldDescriptorProto_set_type_name(
+      child, upb_StringView_FromString(".A"));
+  google_protobuf_FieldDescriptorProto_set_type(
+      google_protobuf_DescriptorProto_mutable_field(a, nullptr)[2],
+      google_protobuf_FieldDescriptorProto_TYPE_STRING);
+
+  size_t size;
+  const google_protobuf_FileDescriptorProto* file =
+      google_protobuf_FileDescriptorSet_file(set, &size)[0];
+  char* data =
+      google_protobuf_FileDescriptorProto_serialize(file, arena.ptr(), &size);
+  ASSERT_NE(data, nullptr);
+
+  upb::DefPool built;
+  upb::Status status;
+  const upb_FileDef* f = upb_DefPool_AddSerializedFile(
+      built.ptr(), data, size, nullptr, 0, status.ptr());
+  ASSERT_NE(f, nullptr) << status.error_message();
+  size_t cache_size;
+  char* cache = upb_FileDef_SerializeMiniTables(f, data, size, arena.ptr(),
+                                                &cache_size);
+  ASSERT_NE(cache, nullptr);
+
+  upb::DefPool loaded;
+  ASSERT_NE(upb_DefPool_AddSerializedFile(loaded.ptr(), data, size, cache,
+                                          cache_size, status.ptr()),
+            nullptr)
+      << status.error_message();
+  const upb_MiniTable* built_mt =
+      upb_MessageDef_MiniTable(built.FindMessageByName("A").ptr());
+  const upb_MiniTable* loaded_mt =
+      upb_MessageDef_MiniTable(loaded.FindMessageByName("A").ptr());
+  EXPECT_NE(built_mt, loaded_mt);
+  EXPECT_EQ(built_mt->size, loaded_mt->size);
+  ASSERT_EQ(built_mt->field_count, loaded_mt->field_count);
+  const upb_MiniTableField* loaded_child =
+      upb_MiniTable_FindFieldByNumber(loaded_mt, 2);
+  ASSERT_NE(loaded_child, nullptr);
+  EXPECT_EQ(upb_MiniTable_GetSubMessageTable(loaded_mt, loaded_child),
+            loaded_mt);
+  for (int i = 0; i < built_mt->field_count; i++) {
+    const upb_MiniTableField* built_f =
+        upb_MiniTable_GetFieldByIndex(built_mt, i);
+    const upb_MiniTableField* loaded_f =
+        upb_MiniTable_GetFieldByIndex(loaded_mt, i);
+    EXPECT_EQ(built_f->number, loaded_f->number);
+    EXPECT_EQ(built_f->offset, loaded_f->offset);
+  }
+
+  // A cache saved for another file is ignored.
+  data[size - 1] ^= 1;
+  upb::DefPool other;
+  EXPECT_NE(upb_DefPool_AddSerializedFile(other.ptr(), data, size, cache,
+                                          cache_size, status.ptr()),
+            nullptr)
+      << status.error_message();
+}
@@ -12,6 +12,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <string>
 
 #include <gtest/gtest.h>
 #include "google/protobuf/test_messages_proto2.upb.h"
@@ -20,7 +21,9 @@
 #include "upb/base/string_view.h"
 #include "upb/mem/arena.hpp"
 #include "upb/message/array.h"
+#include "upb/message/message.h"
 #include "upb/test/test.upb.h"
+#include "upb/wire/encode.h"
 
 // Must be last.
 #include "upb/port/def.inc"
@@ -805,6 +808,66 @@ TEST(GeneratedCode, TestRepeated) {
   upb_Arena_Free(arena);
 }
 
+TEST(GeneratedCode, LargePackedVarints) {
+  upb::Arena arena;
+  protobuf_test_messages_proto3_TestAllTypesProto3* msg =
+      protobuf_test_messages_proto3_TestAllTypesProto3_new(arena.ptr());
+  for (int i = 0; i < 10000; i++) {
+    // Values of every encoded length.
+    protobuf_test_messages_proto3_TestAllTypesProto3_add_packed_int64(
+        msg, (int64_t)((uint64_t)i << (i % 64)), arena.ptr());
+  }
+  size_t size;
+  char* serialized = protobuf_test_messages_proto3_TestAllTypesProto3_serialize(
+      msg, arena.ptr(), &size);
+  ASSERT_NE(nullptr, serialized);
+
+  upb::Arena parse_arena;
+  protobuf_test_messages_proto3_TestAllTypesProto3* parsed =
+      protobuf_test_messages_proto3_TestAllTypesProto3_parse(serialized, size,
+                                                             parse_arena.ptr());
+  ASSERT_NE(nullptr, parsed);
+  const int64_t* elems =
+      protobuf_test_messages_proto3_TestAllTypesProto3_packed_int64(parsed,
+                                                                    &size);
+  ASSERT_EQ(10000, size);
+  for (int i = 0; i < 10000; i++) {
+    EXPECT_EQ((int64_t)((uint64_t)i << (i % 64)), elems[i]);
+  }
+}
+
+TEST(GeneratedCode, LargePackedClosedEnum) {
+  upb::Arena arena;
+  protobuf_test_messages_proto2_TestAllTypesProto2* msg =
+      protobuf_test_messages_proto2_TestAllTypesProto2_new(arena.ptr());
+  // 7 is not a value of the enum, so it is parsed as an unknown field.
+  const int32_t values[] = {0, 1, 2, -1, 7};
+  for (int i = 0; i < 5000; i++) {
+    protobuf_test_messages_proto2_TestAllTypesProto2_add_packed_nested_enum(
+        msg, values[i % 5], arena.ptr());
+  }
+  size_t size;
+  char* serialized = protobuf_test_messages_proto2_TestAllTypesProto2_serialize(
+      msg, arena.ptr(), &size);
+  ASSERT_NE(nullptr, serialized);
+
+  upb::Arena parse_arena;
+  protobuf_test_messages_proto2_TestAllTypesProto2* parsed =
+      protobuf_test_messages_proto2_TestAllTypesProto2_parse(serialized, size,
+                                                             parse_arena.ptr());
+  ASSERT_NE(nullptr, parsed);
+  const int32_t* elems =
+      protobuf_test_messages_proto2_TestAllTypesProto2_packed_nested_enum(
+          parsed, &size);
+  ASSERT_EQ(4000, size);
+  for (int i = 0; i < 4000; i++) {
+    EXPECT_EQ(values[i % 4], elems[i]);
+  }
+  size_t unknown_size;
+  upb_Message_GetUnknown(parsed, &unknown_size);
+  EXPECT_NE(0, unknown_size);
+}
+
 TEST(GeneratedCode, Issue9440) {
   upb::Arena arena;
   upb_test_HelloRequest* msg = upb_test_HelloRequest_new(arena.ptr());
@@ -827,6 +890,53 @@ TEST(GeneratedCode, NullDecodeBuffer) {
   upb_Arena_Free(arena);
 }
 
+TEST(GeneratedCode, PresizedSerialize) {
+  upb::Arena arena;
+  protobuf_test_messages_proto3_TestAllTypesProto3* msg =
+      protobuf_test_messages_proto3_TestAllTypesProto3_new(arena.ptr());
+  const std::string long_str(1000, 'x');
+  protobuf_test_messages_proto3_TestAllTypesProto3_set_optional_string(
+      msg, upb_StringView_FromDataAndSize(long_str.data(), long_str.size()));
+  for (int i = 0; i < 300; i++) {
+    protobuf_test_messages_proto3_TestAllTypesProto3_add_repeated_int32(
+        msg, i * 1000003 - 150000000, arena.ptr());
+    protobuf_test_messages_proto3_TestAllTypesProto3_add_repeated_string(
+        msg, upb_StringView_FromString(test_str4), arena.ptr());
+  }
+  protobuf_test_messages_proto3_TestAllTypesProto3_map_string_string_set(
+      msg, upb_StringView_FromString(test_str),
+      upb_StringView_FromString(test_str2), arena.ptr());
+  protobuf_test_messages_proto3_TestAllTypesProto3_map_string_string_set(
+      msg, upb_StringView_FromString(test_str3),
+      upb_StringView_FromString(test_str4), arena.ptr());
+  protobuf_test_messages_proto3_TestAllTypesProto3_NestedMessage_set_a(
+      protobuf_test_messages_proto3_TestAllTypesProto3_mutable_optional_nested_message(
+          msg, arena.ptr()),
+      12345);
+
+  for (int options : {0, int{kUpb_EncodeOption_Deterministic}}) {
+    size_t size;
+    char* data = protobuf_test_messages_proto3_TestAllTypesProto3_serialize_ex(
+        msg, options, arena.ptr(), &size);
+    size_t presized_size;
+    char* presized =
+        protobuf_test_messages_proto3_TestAllTypesProto3_serialize_ex(
+            msg, options | kUpb_EncodeOption_Presize, arena.ptr(),
+            &presized_size);
+    ASSERT_NE(nullptr, presized);
+    EXPECT_EQ(std::string(data, size), std::string(presized, presized_size));
+  }
+
+  // Empty messages still serialize to a non-NULL buffer.
+  size_t size;
+  EXPECT_NE(nullptr,
+            protobuf_test_messages_proto3_TestAllTypesProto3_serialize_ex(
+                protobuf_test_messages_proto3_TestAllTypesProto3_new(
+                    arena.ptr()),
+                kUpb_EncodeOption_Presize, arena.ptr(), &size));
+  EXPECT_EQ(0, size);
+}
+
 TEST(GeneratedCode, StatusTruncation) {
   int i, j;
   upb_Status status;
@@ -0,0 +1,715 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "upb/text/decode.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "upb/base/descriptor_constants.h"
+#include "upb/base/status.h"
+#include "upb/base/string_view.h"
+#include "upb/io/string.h"
+#include "upb/io/tokenizer.h"
+#include "upb/mem/arena.h"
+#include "upb/message/array.h"
+#include "upb/message/map.h"
+#include "upb/message/message.h"
+#include "upb/reflection/message.h"
+#include "upb/wire/encode.h"
+#include "utf8_range.h"
+
+// Must be last.
+#include "upb/port/def.inc"
+
+typedef struct {
+  upb_Tokenizer* t;
+  upb_Arena* arena;
+  const upb_DefPool* symtab;
+  int depth;
+  int options;
+  upb_Status* status;
+  jmp_buf err;
+} txtdec;
+
+static void txtdec_field(txtdec* d, upb_Message* msg, const upb_MessageDef* m);
+static void txtdec_skipvalue(txtdec* d);
+
+// Errors are reported at the current token, in the same "line:column: " form
+// that the tokenizer uses for its own errors.
+
+UPB_NORETURN static void txtdec_err(txtdec* d, const char* msg) {
+  upb_Status_SetErrorFormat(d->status, "%d:%d: %s", upb_Tokenizer_Line(d->t),
+                            upb_Tokenizer_Column(d->t), msg);
+  UPB_LONGJMP(d->err, 1);
+}
+
+UPB_PRINTF(2, 3)
+UPB_NORETURN static void txtdec_errf(txtdec* d, const char* fmt, ...) {
+  va_list argp;
+  upb_Status_SetErrorFormat(d->status, "%d:%d: ", upb_Tokenizer_Line(d->t),
+                            upb_Tokenizer_Column(d->t));
+  va_start(argp, fmt);
+  upb_Status_VAppendErrorFormat(d->status, fmt, argp);
+  va_end(argp);
+  UPB_LONGJMP(d->err, 1);
+}
+
+static void* txtdec_checkmem(txtdec* d, void* ptr) {
+  if (!ptr) txtdec_err(d, "Out of memory");
+  return ptr;
+}
+
+/* Tokens *********************************************************************/
+
+static void txtdec_next(txtdec* d) {
+  // At the end of the input Next() returns false but leaves an End token,
+  // which the callers check for.
+  if (!upb_Tokenizer_Next(d->t, d->status) &&
+      upb_Tokenizer_Type(d->t) != kUpb_TokenType_End) {
+    UPB_LONGJMP(d->err, 1);
+  }
+}
+
+static upb_TokenType txtdec_type(const txtdec* d) {
+  return upb_Tokenizer_Type(d->t);
+}
+
+// The text of the current token, which is NULL-terminated and valid until the
+// next call to txtdec_next().
+static const char* txtdec_text(const txtdec* d) {
+  return upb_Tokenizer_TextData(d->t);
+}
+
+static bool txtdec_issym(const txtdec* d, char ch) {
+  return upb_Tokenizer_Type(d->t) == kUpb_TokenType_Symbol &&
+         upb_Tokenizer_TextData(d->t)[0] == ch;
+}
+
+static bool txtdec_tryconsume(txtdec* d, char ch) {
+  if (!txtdec_issym(d, ch)) return false;
+  txtdec_next(d);
+  return true;
+}
+
+static void txtdec_consume(txtdec* d, char ch) {
+  if (!txtdec_tryconsume(d, ch)) txtdec_errf(d, "Expected \"%c\".", ch);
+}
+
+static void txtdec_append(txtdec* d, upb_String* str, const char* data,
+                          size_t size) {
+  if (!upb_String_Append(str, data, size)) txtdec_err(d, "Out of memory");
+}
+
+// Consumes a dotted name like "foo.bar.Baz" and appends it to |name|.
+static void txtdec_dottedname(txtdec* d, upb_String* name) {
+  while (true) {
+    if (txtdec_type(d) != kUpb_TokenType_Identifier) {
+      txtdec_err(d, "Expected identifier.");
+    }
+    txtdec_append(d, name, txtdec_text(d), upb_Tokenizer_TextSize(d->t));
+    txtdec_next(d);
+    if (!txtdec_tryconsume(d, '.')) return;
+    txtdec_append(d, name, ".", 1);
+  }
+}
+
+/* Scalar values **************************************************************/
+
+// Parses an integer in [min, max], with an optional minus sign.
+static int64_t txtdec_int(txtdec* d, int64_t min, int64_t max) {
+  bool neg = txtdec_tryconsume(d, '-');
+  uint64_t limit = neg ? (uint64_t)-(min + 1) + 1 : (uint64_t)max;
+  uint64_t val;
+
+  if (txtdec_type(d) != kUpb_TokenType_Integer) {
+    txtdec_err(d, "Expected integer.");
+  }
+  if (!upb_Parse_Integer(txtdec_text(d), limit, &val)) {
+    txtdec_err(d, "Integer out of range.");
+  }
+  txtdec_next(d);
+
+  if (neg && val != 0) return -(int64_t)(val - 1) - 1;
+  return (int64_t)val;
+}
+
+// Parses an integer in [0, max].  "-0" is accepted.
+static uint64_t txtdec_uint(txtdec* d, uint64_t max) {
+  bool neg = txtdec_tryconsume(d, '-');
+  uint64_t val;
+
+  if (txtdec_type(d) != kUpb_TokenType_Integer) {
+    txtdec_err(d, "Expected integer.");
+  }
+  if (!upb_Parse_Integer(txtdec_text(d), neg ? 0 : max, &val)) {
+    txtdec_err(d, "Integer out of range.");
+  }
+  txtdec_next(d);
+  return val;
+}
+
+// Compares an identifier to a lower case string, ignoring case.
+static bool txtdec_iequals(const char* ident, const char* lower) {
+  for (; *ident && *lower; ident++, lower++) {
+    char ch = *ident;
+    if (ch >= 'A' && ch <= 'Z') ch += 'a' - 'A';
+    if (ch != *lower) return false;
+  }
+  return *ident == *lower;
+}
+
+static double txtdec_float(txtdec* d) {
+  bool neg = txtdec_tryconsume(d, '-');
+  const char* text = txtdec_text(d);
+  double val;
+
+  switch (txtdec_type(d)) {
+    case kUpb_TokenType_Integer: {
+      uint64_t u;
+      val = upb_Parse_Integer(text, UINT64_MAX, &u) ? (double)u
+                                                    : upb_Parse_Float(text);
+      break;
+    }
+    case kUpb_TokenType_Float:
+      val = upb_Parse_Float(text);
+      break;
+    case kUpb_TokenType_Identifier:
+      if (txtdec_iequals(text, "inf") || txtdec_iequals(text, "inff") ||
+          txtdec_iequals(text, "infinity") ||
+          txtdec_iequals(text, "infinityf")) {
+        val = INFINITY;
+      } else if (txtdec_iequals(text, "nan") || txtdec_iequals(text, "nanf")) {
+        val = NAN;
+      } else {
+        txtdec_err(d, "Expected double.");
+      }
+      break;
+    default:
+      txtdec_err(d, "Expected double.");
+  }
+
+  txtdec_next(d);
+  return neg ? -val : val;
+}
+
+static bool txtdec_bool(txtdec* d) {
+  const char* text = txtdec_text(d);
+  bool val;
+
+  if (txtdec_type(d) != kUpb_TokenType_Identifier &&
+      txtdec_type(d) != kUpb_TokenType_Integer) {
+    txtdec_err(d, "Expected \"true\" or \"false\".");
+  }
+
+  if (!strcmp(text, "true") || !strcmp(text, "t") || !strcmp(text, "True") ||
+      !strcmp(text, "1")) {
+    val = true;
+  } else if (!strcmp(text, "false") || !strcmp(text, "f") ||
+             !strcmp(text, "False") || !strcmp(text, "0")) {
+    val = false;
+  } else {
+    txtdec_err(d, "Expected \"true\" or \"false\".");
+  }
+
+  txtdec_next(d);
+  return val;
+}
+
+static upb_StringView txtdec_string(txtdec* d, bool is_utf8) {
+  upb_StringView str;
+
+  if (txtdec_type(d) != kUpb_TokenType_String) {
+    txtdec_err(d, "Expected string.");
+  }
+  str = upb_Parse_String(txtdec_text(d), d->arena);
+  txtdec_next(d);
+
+  // Adjacent string literals are concatenated, like in C.
+  while (txtdec_type(d) == kUpb_TokenType_String) {
+    upb_StringView next = upb_Parse_String(txtdec_text(d), d->arena);
+    if (next.size) {
+      char* buf =
+          txtdec_checkmem(d, upb_Arena_Malloc(d->arena, str.size + next.size));
+      if (str.size) memcpy(buf, str.data, str.size);
+      memcpy(buf + str.size, next.data, next.size);
+      str = upb_StringView_FromDataAndSize(buf, str.size + next.size);
+    }
+    txtdec_next(d);
+  }
+
+  if (is_utf8 && utf8_range2((const unsigned char*)str.data, str.size) != 0) {
+    txtdec_err(d, "String field is not valid UTF-8.");
+  }
+  return str;
+}
+
+static int32_t txtdec_enum(txtdec* d, const upb_FieldDef* f) {
+  const upb_EnumDef* e = upb_FieldDef_EnumSubDef(f);
+
+  if (txtdec_type(d) == kUpb_TokenType_Identifier) {
+    const char* name = txtdec_text(d);
+    const upb_EnumValueDef* ev = upb_EnumDef_FindValueByNameWithSize(
+        e, name, upb_Tokenizer_TextSize(d->t));
+    if (!ev) {
+      txtdec_errf(d, "Enum type \"%s\" has no value named %s.",
+                  upb_EnumDef_FullName(e), name);
+    }
+    txtdec_next(d);
+    return upb_EnumValueDef_Number(ev);
+  }
+
+  int32_t val = (int32_t)txtdec_int(d, INT32_MIN, INT32_MAX);
+  if (upb_EnumDef_IsClosed(e) && !upb_EnumDef_CheckNumber(e, val)) {
+    txtdec_errf(d, "Enum type \"%s\" has no value with number %" PRId32 ".",
+                upb_EnumDef_FullName(e), val);
+  }
+  return val;
+}
+
+static upb_MessageValue txtdec_scalar(txtdec* d, const upb_FieldDef* f) {
+  upb_MessageValue val;
+
+  switch (upb_FieldDef_CType(f)) {
+    case kUpb_CType_Int32:
+      val.int32_val = (int32_t)txtdec_int(d, INT32_MIN, INT32_MAX);
+      break;
+    case kUpb_CType_Int64:
+      val.int64_val = txtdec_int(d, INT64_MIN, INT64_MAX);
+      break;
+    case kUpb_CType_UInt32:
+      val.uint32_val = (uint32_t)txtdec_uint(d, UINT32_MAX);
+      break;
+    case kUpb_CType_UInt64:
+      val.uint64_val = txtdec_uint(d, UINT64_MAX);
+      break;
+    case kUpb_CType_Float:
+      val.float_val = (float)txtdec_float(d);
+      break;
+    case kUpb_CType_Double:
+      val.double_val = txtdec_float(d);
+      break;
+    case kUpb_CType_Bool:
+      val.bool_val = txtdec_bool(d);
+      break;
+    case kUpb_CType_String:
+      val.str_val = txtdec_string(d, true);
+      break;
+    case kUpb_CType_Bytes:
+      val.str_val = txtdec_string(d, false);
+      break;
+    case kUpb_CType_Enum:
+      val.int32_val = txtdec_enum(d, f);
+      break;
+    default:
+      UPB_UNREACHABLE();
+  }
+
+  return val;
+}
+
+/* Messages *******************************************************************/
+
+// Parses the fields of a message up to its closing '}' or '>'.
+static void txtdec_submsg(txtdec* d, upb_Message* msg,
+                          const upb_MessageDef* m) {
+  char end = '}';
+  if (txtdec_tryconsume(d, '<')) {
+    end = '>';
+  } else {
+    txtdec_consume(d, '{');
+  }
+
+  if (--d->depth < 0) txtdec_err(d, "Message nesting too deep.");
+
+  while (!txtdec_tryconsume(d, end)) {
+    if (txtdec_type(d) == kUpb_TokenType_End) {
+      txtdec_errf(d, "Expected \"%c\".", end);
+    }
+    txtdec_field(d, msg, m);
+  }
+
+  d->depth++;
+}
+
+static upb_Message* txtdec_newmsg(txtdec* d, const upb_MessageDef* m) {
+  const upb_MiniTable* layout = upb_MessageDef_MiniTable(m);
+  return txtdec_checkmem(d, upb_Message_New(layout, d->arena));
+}
+
+// Returns true if a singular field was already given.  Without presence, that
+// is the best we can tell from a non-zero value.
+static bool txtdec_isset(const upb_Message* msg, const upb_FieldDef* f) {
+  if (upb_FieldDef_HasPresence(f)) return upb_Message_HasFieldByDef(msg, f);
+
+  upb_MessageValue val = upb_Message_GetFieldByDef(msg, f);
+  switch (upb_FieldDef_CType(f)) {
+    case kUpb_CType_Bool:
+      return val.bool_val;
+    case kUpb_CType_Float:
+      return val.float_val != 0;
+    case kUpb_CType_Double:
+      return val.double_val != 0;
+    case kUpb_CType_Int32:
+    case kUpb_CType_UInt32:
+    case kUpb_CType_Enum:
+      return val.int32_val != 0;
+    case kUpb_CType_Int64:
+    case kUpb_CType_UInt64:
+      return val.int64_val != 0;
+    case kUpb_CType_String:
+    case kUpb_CType_Bytes:
+      return val.str_val.size != 0;
+    default:
+      UPB_UNREACHABLE();
+  }
+}
+
+/*
+ * Map entries are parsed as messages of key/value, and an entry with a key that
+ * is already present replaces it:
+ *
+ *    foo_map {
+ *      key: "abc"
+ *      value: 123
+ *    }
+ */
+static void txtdec_mapentry(txtdec* d, upb_Message* msg,
+                            const upb_FieldDef* f) {
+  const upb_MessageDef* entry = upb_FieldDef_MessageSubDef(f);
+  const upb_FieldDef* key_f = upb_MessageDef_Field(entry, 0);
+  const upb_FieldDef* val_f = upb_MessageDef_Field(entry, 1);
+  upb_Map* map = txtdec_checkmem(d, upb_Message_Mutable(msg, f, d->arena).map);
+  upb_Message* entry_msg = txtdec_newmsg(d, entry);
+
+  txtdec_submsg(d, entry_msg, entry);
+
+  upb_MessageValue key = upb_Message_GetFieldByDef(entry_msg, key_f);
+  upb_MessageValue val = upb_Message_GetFieldByDef(entry_msg, val_f);
+  if (upb_FieldDef_IsSubMessage(val_f) && !val.msg_val) {
+    val.msg_val = txtdec_newmsg(d, upb_FieldDef_MessageSubDef(val_f));
+  }
+  if (!upb_Map_Set(map, key, val, d->arena)) txtdec_err(d, "Out of memory");
+}
+
+static void txtdec_value(txtdec* d, upb_Message* msg, const upb_FieldDef* f) {
+  upb_MessageValue val;
+
+  if (upb_FieldDef_IsMap(f)) {
+    txtdec_mapentry(d, msg, f);
+  } else if (upb_FieldDef_IsRepeated(f)) {
+    upb_Array* arr =
+        txtdec_checkmem(d, upb_Message_Mutable(msg, f, d->arena).array);
+    if (upb_FieldDef_IsSubMessage(f)) {
+      const upb_MessageDef* subm = upb_FieldDef_MessageSubDef(f);
+      upb_Message* sub = txtdec_newmsg(d, subm);
+      txtdec_submsg(d, sub, subm);
+      val.msg_val = sub;
+    } else {
+      val = txtdec_scalar(d, f);
+    }
+    if (!upb_Array_Append(arr, val, d->arena)) txtdec_err(d, "Out of memory");
+  } else if (upb_FieldDef_IsSubMessage(f)) {
+    upb_Message* sub =
+        txtdec_checkmem(d, upb_Message_Mutable(msg, f, d->arena).msg);
+    txtdec_submsg(d, sub, upb_FieldDef_MessageSubDef(f));
+  } else {
+    val = txtdec_scalar(d, f);
+    if (!upb_Message_SetFieldByDef(msg, f, val, d->arena)) {
+      txtdec_err(d, "Out of memory");
+    }
+  }
+}
+
+static void txtdec_fieldvalue(txtdec* d, upb_Message* msg,
+                              const upb_FieldDef* f) {
+  if ((d->options & upb_TextDecode_AllowMultipleScalars) == 0) {
+    const upb_OneofDef* o = upb_FieldDef_RealContainingOneof(f);
+    const upb_FieldDef* set = o ? upb_Message_WhichOneof(msg, o) : NULL;
+    if (set && set != f) {
+      txtdec_errf(d,
+                  "Field \"%s\" is specified along with field \"%s\", another "
+                  "member of oneof \"%s\".",
+                  upb_FieldDef_Name(f), upb_FieldDef_Name(set),
+                  upb_OneofDef_Name(o));
+    }
+    if (!upb_FieldDef_IsRepeated(f) && txtdec_isset(msg, f)) {
+      txtdec_errf(d, "Non-repeated field \"%s\" is specified multiple times.",
+                  upb_FieldDef_FullName(f));
+    }
+  }
+
+  // The colon is optional before a message value.
+  if (upb_FieldDef_IsSubMessage(f)) {
+    txtdec_tryconsume(d, ':');
+  } else {
+    txtdec_consume(d, ':');
+  }
+
+  if (upb_FieldDef_IsRepeated(f) && txtdec_tryconsume(d, '[')) {
+    // The short form of a repeated field: "foo: [1, 2, 3]".
+    if (txtdec_tryconsume(d, ']')) return;
+    do {
+      txtdec_value(d, msg, f);
+    } while (txtdec_tryconsume(d, ','));
+    txtdec_consume(d, ']');
+  } else {
+    txtdec_value(d, msg, f);
+  }
+}
+
+static const upb_FieldDef* txtdec_fieldname(txtdec* d,
+                                            const upb_MessageDef* m) {
+  // Unknown fields are printed by number, so numbers can be skipped too.
+  if (txtdec_type(d) != kUpb_TokenType_Identifier &&
+      txtdec_type(d) != kUpb_TokenType_Integer) {
+    txtdec_err(d, "Expected field name.");
+  }
+
+  const char* name = txtdec_text(d);
+  size_t size = upb_Tokenizer_TextSize(d->t);
+  const upb_FieldDef* f = upb_MessageDef_FindFieldByNameWithSize(m, name, size);
+
+  // Groups are written with the name of their type, which is usually the field
+  // name capitalized.
+  if (!f) {
+    char* lower = txtdec_checkmem(d, upb_Arena_Malloc(d->arena, size));
+    for (size_t i = 0; i < size; i++) {
+      char ch = name[i];
+      lower[i] = (ch >= 'A' && ch <= 'Z') ? ch + ('a' - 'A') : ch;
+    }
+    f = upb_MessageDef_FindFieldByNameWithSize(m, lower, size);
+    if (f && upb_FieldDef_Type(f) != kUpb_FieldType_Group) f = NULL;
+  }
+  if (f && upb_FieldDef_Type(f) == kUpb_FieldType_Group &&
+      strcmp(upb_MessageDef_Name(upb_FieldDef_MessageSubDef(f)), name) != 0) {
+    f = NULL;
+  }
+
+  if (!f && (d->options & upb_TextDecode_IgnoreUnknown) == 0) {
+    txtdec_errf(d, "Message type \"%s\" has no field named \"%s\".",
+                upb_MessageDef_FullName(m), name);
+  }
+
+  txtdec_next(d);
+  return f;
+}
+
+// Parses an extension name after the opening '['.
+static const upb_FieldDef* txtdec_extension(txtdec* d,
+                                            const upb_MessageDef* m) {
+  upb_String name;
+  if (!upb_String_Init(&name, d->arena)) txtdec_err(d, "Out of memory");
+  txtdec_dottedname(d, &name);
+
+  if (upb_MessageDef_ExtensionRangeCount(m) == 0) {
+    txtdec_errf(d, "Message type \"%s\" does not have extensions.",
+                upb_MessageDef_FullName(m));
+  }
+
+  const upb_FieldDef* f =
+      d->symtab ? upb_DefPool_FindExtensionByNameWithSize(
+                      d->symtab, upb_String_Data(&name), upb_String_Size(&name))
+                : NULL;
+  if (!f) {
+    if ((d->options & upb_TextDecode_IgnoreUnknown) == 0) {
+      txtdec_errf(d, "Extension \"%s\" not registered.",
+                  upb_String_Data(&name));
+    }
+  } else if (upb_FieldDef_ContainingType(f) != m) {
+    txtdec_errf(d, "Extension \"%s\" does not extend message type \"%s\".",
+                upb_String_Data(&name), upb_MessageDef_FullName(m));
+  }
+
+  txtdec_consume(d, ']');
+  return f;
+}
+
+/*
+ * An Any can be written with its contents expanded, after the opening '[':
+ *
+ *    [type.googleapis.com/foo.Bar] {
+ *      baz: 1
+ *    }
+ */
+static void txtdec_any(txtdec* d, upb_Message* msg, const upb_MessageDef* m) {
+  upb_String url;
+  size_t prefix_size;
+  if (!upb_String_Init(&url, d->arena)) txtdec_err(d, "Out of memory");
+
+  txtdec_dottedname(d, &url);
+  do {
+    txtdec_consume(d, '/');
+    txtdec_append(d, &url, "/", 1);
+    prefix_size = upb_String_Size(&url);
+    txtdec_dottedname(d, &url);
+  } while (txtdec_issym(d, '/'));
+
+  const char* type_name = upb_String_Data(&url) + prefix_size;
+  const upb_MessageDef* type_m =
+      d->symtab ? upb_DefPool_FindMessageByNameWithSize(
+                      d->symtab, type_name, upb_String_Size(&url) - prefix_size)
+                : NULL;
+  if (!type_m) {
+    txtdec_errf(d, "Type %s not found in descriptor pool", type_name);
+  }
+  txtdec_consume(d, ']');
+  txtdec_tryconsume(d, ':');
+
+  upb_Message* any = txtdec_newmsg(d, type_m);
+  txtdec_submsg(d, any, type_m);
+
+  upb_MessageValue type_url, value;
+  char* buf;
+  size_t size;
+  if (upb_Encode(any, upb_MessageDef_MiniTable(type_m), 0, d->arena, &buf,
+                 &size) != kUpb_EncodeStatus_Ok) {
+    txtdec_err(d, "Error encoding Any");
+  }
+  type_url.str_val = upb_StringView_FromDataAndSize(upb_String_Data(&url),
+                                                    upb_String_Size(&url));
+  value.str_val = upb_StringView_FromDataAndSize(buf, size);
+  upb_Message_SetFieldByDef(msg, upb_MessageDef_FindFieldByNumber(m, 1),
+                            type_url, d->arena);
+  upb_Message_SetFieldByDef(msg, upb_MessageDef_FindFieldByNumber(m, 2), value,
+                            d->arena);
+}
+
+static void txtdec_field(txtdec* d, upb_Message* msg, const upb_MessageDef* m) {
+  const upb_FieldDef* f;
+
+  if (upb_MessageDef_WellKnownType(m) == kUpb_WellKnown_Any &&
+      txtdec_tryconsume(d, '[')) {
+    txtdec_any(d, msg, m);
+  } else {
+    if (txtdec_tryconsume(d, '[')) {
+      f = txtdec_extension(d, m);
+    } else {
+      f = txtdec_fieldname(d, m);
+    }
+
+    if (f) {
+      txtdec_fieldvalue(d, msg, f);
+    } else {
+      txtdec_skipvalue(d);
+    }
+  }
+
+  // For historical reasons, fields may optionally be separated by commas or
+  // semicolons.
+  if (!txtdec_tryconsume(d, ',')) txtdec_tryconsume(d, ';');
+}
+
+/* Skipping unknown fields ****************************************************/
+
+static void txtdec_skipmsg(txtdec* d) {
+  char end = '}';
+  if (txtdec_tryconsume(d, '<')) {
+    end = '>';
+  } else {
+    txtdec_consume(d, '{');
+  }
+
+  if (--d->depth < 0) txtdec_err(d, "Message nesting too deep.");
+
+  while (!txtdec_tryconsume(d, end)) {
+    if (txtdec_type(d) == kUpb_TokenType_End) {
+      txtdec_errf(d, "Expected \"%c\".", end);
+    }
+    if (txtdec_tryconsume(d, '[')) {
+      while (!txtdec_tryconsume(d, ']')) {
+        if (txtdec_type(d) == kUpb_TokenType_End) {
+          txtdec_err(d, "Expected \"]\".");
+        }
+        txtdec_next(d);
+      }
+    } else if (txtdec_type(d) == kUpb_TokenType_Identifier ||
+               txtdec_type(d) == kUpb_TokenType_Integer) {
+      txtdec_next(d);
+    } else {
+      txtdec_err(d, "Expected field name.");
+    }
+    txtdec_skipvalue(d);
+    if (!txtdec_tryconsume(d, ',')) txtdec_tryconsume(d, ';');
+  }
+
+  d->depth++;
+}
+
+static void txtdec_skipelement(txtdec* d) {
+  if (txtdec_issym(d, '{') || txtdec_issym(d, '<')) {
+    txtdec_skipmsg(d);
+    return;
+  }
+
+  txtdec_tryconsume(d, '-');
+  switch (txtdec_type(d)) {
+    case kUpb_TokenType_String:
+      while (txtdec_type(d) == kUpb_TokenType_String) txtdec_next(d);
+      break;
+    case kUpb_TokenType_Identifier:
+    case kUpb_TokenType_Integer:
+    case kUpb_TokenType_Float:
+      txtdec_next(d);
+      break;
+    default:
+      txtdec_err(d, "Expected value.");
+  }
+}
+
+// Skips the value of an unknown field: a scalar, a message, or a list of
+// either.
+static void txtdec_skipvalue(txtdec* d) {
+  if (!txtdec_tryconsume(d, ':')) {
+    txtdec_skipmsg(d);
+  } else if (txtdec_tryconsume(d, '[')) {
+    if (txtdec_tryconsume(d, ']')) return;
+    do {
+      txtdec_skipelement(d);
+    } while (txtdec_tryconsume(d, ','));
+    txtdec_consume(d, ']');
+  } else {
+    txtdec_skipelement(d);
+  }
+}
+
+static bool upb_TextDecoder_Decode(txtdec* const d, upb_Message* const msg,
+                                   const upb_MessageDef* const m) {
+  if (UPB_SETJMP(d->err)) return false;
+
+  txtdec_next(d);
+  while (txtdec_type(d) != kUpb_TokenType_End) {
+    txtdec_field(d, msg, m);
+  }
+  return true;
+}
+
+bool upb_TextDecode(const char* buf, size_t size, upb_Message* msg,
+                    const upb_MessageDef* m, const upb_DefPool* symtab,
+                    int options, upb_Arena* arena, upb_Status* status) {
+  txtdec d;
+
+  d.t = upb_Tokenizer_New(buf, size, NULL,
+                          kUpb_TokenizerOption_AllowFAfterFloat |
+                              kUpb_TokenizerOption_CommentStyleShell,
+                          arena);
+  if (!d.t) {
+    upb_Status_SetErrorMessage(status, "Out of memory");
+    return false;
+  }
+  d.arena = arena;
+  d.symtab = symtab;
+  d.depth = 100;
+  d.options = options;
+  d.status = status;
+
+  return upb_TextDecoder_Decode(&d, msg, m);
+}
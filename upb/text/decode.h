@@ -0,0 +1,50 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef UPB_TEXT_DECODE_H_
+#define UPB_TEXT_DECODE_H_
+
+#include "upb/reflection/def.h"
+
+// Must be last.
+#include "upb/port/def.inc"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+  // When set, unknown fields and extensions are skipped instead of being
+  // reported as errors.
+  upb_TextDecode_IgnoreUnknown = 1,
+
+  // When set, a singular field that is given more than once takes the last
+  // value (and submessages are merged), like TextFormat::Merge().  Otherwise
+  // that is an error, as is setting two members of the same oneof, like
+  // TextFormat::Parse().
+  upb_TextDecode_AllowMultipleScalars = 2,
+};
+
+/* Parses the text format message in |buf| into |msg|, whose reflection is given
+ * in |m|.  Fields already present in |msg| are merged with, so with the default
+ * options it is an error for the text to set a singular field that |msg|
+ * already has.
+ *
+ * Extensions, and the types of expanded google.protobuf.Any messages, are
+ * looked up in |symtab|.  All memory is allocated from |arena|.  On error,
+ * returns false and sets |status|; |msg| may then be partially modified. */
+UPB_API bool upb_TextDecode(const char* buf, size_t size, upb_Message* msg,
+                            const upb_MessageDef* m, const upb_DefPool* symtab,
+                            int options, upb_Arena* arena, upb_Status* status);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#include "upb/port/undef.inc"
+
+#endif /* UPB_TEXT_DECODE_H_ */
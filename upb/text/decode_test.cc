@@ -0,0 +1,200 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "upb/text/decode.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/test_messages_proto2.upbdefs.h"
+#include "google/protobuf/test_messages_proto3.upbdefs.h"
+#include "upb/base/status.hpp"
+#include "upb/mem/arena.hpp"
+#include "upb/reflection/def.hpp"
+#include "upb/text/encode.h"
+
+namespace {
+
+class TextDecodeTest : public ::testing::Test {
+ protected:
+  const upb_MessageDef* Proto2() {
+    return protobuf_test_messages_proto2_TestAllTypesProto2_getmsgdef(
+        defpool_.ptr());
+  }
+
+  const upb_MessageDef* Proto3() {
+    return protobuf_test_messages_proto3_TestAllTypesProto3_getmsgdef(
+        defpool_.ptr());
+  }
+
+  // Parses |text| and returns the message re-encoded on a single line, or the
+  // error message prefixed with "error: ".
+  std::string Parse(const upb_MessageDef* m, const std::string& text,
+                    int options = 0) {
+    upb_Message* msg = upb_Message_New(upb_MessageDef_MiniTable(m),
+                                       arena_.ptr());
+    upb::Status status;
+    if (!upb_TextDecode(text.data(), text.size(), msg, m, defpool_.ptr(),
+                        options, arena_.ptr(), status.ptr())) {
+      return std::string("error: ") + status.error_message();
+    }
+    char buf[1024];
+    size_t size = upb_TextEncode(msg, m, defpool_.ptr(), UPB_TXTENC_SINGLELINE,
+                                 buf, sizeof(buf));
+    EXPECT_LT(size, sizeof(buf));
+    return std::string(buf, size);
+  }
+
+  upb::Arena arena_;
+  upb::DefPool defpool_;
+};
+
+TEST_F(TextDecodeTest, Scalars) {
+  EXPECT_EQ(Parse(Proto3(),
+                  "optional_int32: -5\n"
+                  "optional_uint64: 0xFFFFFFFFFFFFFFFF\n"
+                  "optional_sint32: 017\n"
+                  "optional_float: 1.5f\n"
+                  "optional_double: -inf\n"
+                  "optional_bool: t\n"
+                  "optional_string: \"a\" 'b\\n'\n"
+                  "optional_bytes: \"\\x00\\377\"\n"
+                  "optional_nested_enum: BAZ\n"
+                  "optional_foreign_enum: 1"),
+            "optional_int32: -5 optional_uint64: 18446744073709551615 "
+            "optional_sint32: 15 optional_float: 1.5 optional_double: -inf "
+            "optional_bool: true optional_string: \"ab\\n\" "
+            "optional_bytes: \"\\000\\377\" optional_nested_enum: BAZ "
+            "optional_foreign_enum: FOREIGN_BAR ");
+}
+
+TEST_F(TextDecodeTest, NonFiniteFloats) {
+  EXPECT_EQ(Parse(Proto3(),
+                  "optional_double: nan optional_float: -Infinity "
+                  "repeated_double: [inf, 1e10, -0]"),
+            "optional_float: -inf optional_double: nan repeated_double: inf "
+            "repeated_double: 10000000000 repeated_double: -0 ");
+}
+
+TEST_F(TextDecodeTest, MessagesAndRepeatedFields) {
+  EXPECT_EQ(Parse(Proto3(),
+                  "optional_nested_message < a: 3 corecursive { "
+                  "optional_int32: 1 } >; "
+                  "repeated_int32: [1, 2, -3], repeated_int32: 4 "
+                  "repeated_nested_message: [{a: 1}, {a: 2}] "
+                  "repeated_string: []"),
+            "optional_nested_message { a: 3 corecursive { optional_int32: 1 "
+            "} } repeated_int32: 1 repeated_int32: 2 repeated_int32: -3 "
+            "repeated_int32: 4 repeated_nested_message { a: 1 } "
+            "repeated_nested_message { a: 2 } ");
+}
+
+TEST_F(TextDecodeTest, Maps) {
+  EXPECT_EQ(Parse(Proto3(),
+                  "# A comment.\n"
+                  "map_string_string { key: \"a\" value: \"b\" }\n"
+                  "map_string_string { key: \"a\" value: \"c\" }\n"
+                  "map_bool_bool { key: true }"),
+            "map_bool_bool { key: true value: false } "
+            "map_string_string { key: \"a\" value: \"c\" } ");
+}
+
+TEST_F(TextDecodeTest, GroupsAndExtensions) {
+  EXPECT_EQ(Parse(Proto2(),
+                  "Data { group_int32: 1 } "
+                  "[protobuf_test_messages.proto2.extension_int32]: 2 "
+                  "optional_nested_enum: NEG"),
+            "optional_nested_enum: NEG Data { group_int32: 1 } "
+            "[protobuf_test_messages.proto2.extension_int32]: 2 ");
+}
+
+TEST_F(TextDecodeTest, ExpandedAny) {
+  EXPECT_EQ(Parse(Proto3(),
+                  "optional_any { "
+                  "[type.googleapis.com/"
+                  "protobuf_test_messages.proto3.TestAllTypesProto3] { "
+                  "optional_int32: 9 } }"),
+            "optional_any { type_url: \"type.googleapis.com/"
+            "protobuf_test_messages.proto3.TestAllTypesProto3\" "
+            "value: \"\\010\\t\" } ");
+}
+
+TEST_F(TextDecodeTest, AllowMultipleScalars) {
+  EXPECT_EQ(Parse(Proto3(), "optional_int32: 1 optional_int32: 2"),
+            "error: 0:32: Non-repeated field "
+            "\"protobuf_test_messages.proto3.TestAllTypesProto3."
+            "optional_int32\" is specified multiple times.");
+  EXPECT_EQ(Parse(Proto3(), "optional_int32: 1 optional_int32: 2",
+                  upb_TextDecode_AllowMultipleScalars),
+            "optional_int32: 2 ");
+  EXPECT_EQ(Parse(Proto3(),
+                  "optional_nested_message { a: 1 } "
+                  "optional_nested_message { corecursive {} }",
+                  upb_TextDecode_AllowMultipleScalars),
+            "optional_nested_message { a: 1 corecursive { } } ");
+
+  EXPECT_EQ(Parse(Proto3(), "oneof_uint32: 1 oneof_string: \"x\""),
+            "error: 0:28: Field \"oneof_string\" is specified along with "
+            "field \"oneof_uint32\", another member of oneof "
+            "\"oneof_field\".");
+  EXPECT_EQ(Parse(Proto3(), "oneof_uint32: 1 oneof_string: \"x\"",
+                  upb_TextDecode_AllowMultipleScalars),
+            "oneof_string: \"x\" ");
+}
+
+TEST_F(TextDecodeTest, IgnoreUnknown) {
+  EXPECT_EQ(Parse(Proto3(),
+                  "no_such_field: 1 optional_int32: 3 "
+                  "other { a: [1, { x: 2 }], [x.y]: < z: \"s\" \"t\" > } "
+                  "1001: -inf",
+                  upb_TextDecode_IgnoreUnknown),
+            "optional_int32: 3 ");
+}
+
+TEST_F(TextDecodeTest, Errors) {
+  struct {
+    const upb_MessageDef* m;
+    const char* text;
+    const char* error;
+  } cases[] = {
+      {Proto3(), "no_such_field: 1",
+       "0:0: Message type \"protobuf_test_messages.proto3.TestAllTypesProto3\" "
+       "has no field named \"no_such_field\"."},
+      {Proto3(), "optional_int32: 2147483648", "0:16: Integer out of range."},
+      {Proto3(), "optional_uint32: -1", "0:18: Integer out of range."},
+      {Proto3(), "optional_int32: 1.5", "0:16: Expected integer."},
+      {Proto3(), "optional_bool: yes",
+       "0:15: Expected \"true\" or \"false\"."},
+      {Proto3(), "optional_string: \"\\xff\"",
+       "0:23: String field is not valid UTF-8."},
+      {Proto3(), "optional_string \"x\"", "0:16: Expected \":\"."},
+      {Proto3(), "optional_nested_message { a: 1", "0:30: Expected \"}\"."},
+      {Proto3(), "repeated_int32: [1 2]", "0:19: Expected \"]\"."},
+      {Proto3(), "optional_nested_enum: QUX",
+       "0:22: Enum type "
+       "\"protobuf_test_messages.proto3.TestAllTypesProto3.NestedEnum\" has "
+       "no value named QUX."},
+      {Proto2(), "optional_nested_enum: 77",
+       "0:24: Enum type "
+       "\"protobuf_test_messages.proto2.TestAllTypesProto2.NestedEnum\" has "
+       "no value with number 77."},
+      {Proto2(), "data { group_int32: 1 }",
+       "0:0: Message type \"protobuf_test_messages.proto2.TestAllTypesProto2\" "
+       "has no field named \"data\"."},
+      {Proto3(), "[protobuf_test_messages.proto2.extension_int32]: 2",
+       "0:46: Message type "
+       "\"protobuf_test_messages.proto3.TestAllTypesProto3\" does not have "
+       "extensions."},
+      {Proto3(), "optional_any { [type.googleapis.com/NoSuchType] {} }",
+       "0:46: Type NoSuchType not found in descriptor pool"},
+  };
+  for (const auto& c : cases) {
+    EXPECT_EQ(Parse(c.m, c.text), std::string("error: ") + c.error) << c.text;
+  }
+}
+
+}  // namespace
@@ -10,9 +10,11 @@
 #include <ctype.h>
 #include <float.h>
 #include <inttypes.h>
+#include <math.h>
 #include <stdarg.h>
 #include <string.h>
 
+#include "upb/lex/atoi.h"
 #include "upb/lex/round_trip.h"
 #include "upb/message/internal/map_sorter.h"
 #include "upb/message/map.h"
@@ -55,6 +57,16 @@ static void txtenc_putstr(txtenc* e, const char* str) {
   txtenc_putbytes(e, str, strlen(str));
 }
 
+static void txtenc_int64(txtenc* e, int64_t val) {
+  char buf[kUpb_Int64ToBufSize];
+  txtenc_putbytes(e, buf, upb_Int64ToBuf(val, buf) - buf);
+}
+
+static void txtenc_uint64(txtenc* e, uint64_t val) {
+  char buf[kUpb_Int64ToBufSize];
+  txtenc_putbytes(e, buf, upb_Uint64ToBuf(val, buf) - buf);
+}
+
 static void txtenc_printf(txtenc* e, const char* fmt, ...) {
   size_t n;
   size_t have = e->end - e->ptr;
@@ -89,14 +101,44 @@ static void txtenc_endfield(txtenc* e) {
   }
 }
 
+// Non-finite values are spelled the way the text format parser expects, which
+// printf() does not do consistently across platforms.
+static bool txtenc_specialfloat(txtenc* e, double val) {
+  if (val == INFINITY) {
+    txtenc_putstr(e, "inf");
+  } else if (val == -INFINITY) {
+    txtenc_putstr(e, "-inf");
+  } else if (val != val) {
+    txtenc_putstr(e, "nan");
+  } else {
+    return false;
+  }
+  return true;
+}
+
 static void txtenc_enum(int32_t val, const upb_FieldDef* f, txtenc* e) {
   const upb_EnumDef* e_def = upb_FieldDef_EnumSubDef(f);
   const upb_EnumValueDef* ev = upb_EnumDef_FindValueByNumber(e_def, val);
 
   if (ev) {
-    txtenc_printf(e, "%s", upb_EnumValueDef_Name(ev));
+    txtenc_putstr(e, upb_EnumValueDef_Name(ev));
   } else {
-    txtenc_printf(e, "%" PRId32, val);
+    txtenc_int64(e, val);
+  }
+}
+
+// Returns true if |ch| is printed as is inside a string literal.
+static bool txtenc_isplain(char ch, bool bytes) {
+  switch (ch) {
+    case '\n':
+    case '\r':
+    case '\t':
+    case '\"':
+    case '\'':
+    case '\\':
+      return false;
+    default:
+      return (!bytes && (uint8_t)ch >= 0x80) || isprint((uint8_t)ch);
   }
 }
 
@@ -106,6 +148,12 @@ static void txtenc_string(txtenc* e, upb_StringView str, bool bytes) {
   txtenc_putstr(e, "\"");
 
   while (ptr < end) {
+    // Runs of characters that need no escaping are copied in one go.
+    const char* run = ptr;
+    while (ptr < end && txtenc_isplain(*ptr, bytes)) ptr++;
+    if (ptr != run) txtenc_putbytes(e, run, ptr - run);
+    if (ptr == end) break;
+
     switch (*ptr) {
       case '\n':
         txtenc_putstr(e, "\\n");
@@ -125,13 +173,13 @@ static void txtenc_string(txtenc* e, upb_StringView str, bool bytes) {
       case '\\':
         txtenc_putstr(e, "\\\\");
         break;
-      default:
-        if ((bytes || (uint8_t)*ptr < 0x80) && !isprint(*ptr)) {
-          txtenc_printf(e, "\\%03o", (int)(uint8_t)*ptr);
-        } else {
-          txtenc_putbytes(e, ptr, 1);
-        }
+      default: {
+        uint8_t ch = *ptr;
+        char octal[4] = {'\\', '0' + (ch >> 6), '0' + ((ch >> 3) & 7),
+                         '0' + (ch & 7)};
+        txtenc_putbytes(e, octal, sizeof(octal));
         break;
+      }
     }
     ptr++;
   }
@@ -139,20 +187,49 @@ static void txtenc_string(txtenc* e, upb_StringView str, bool bytes) {
   txtenc_putstr(e, "\"");
 }
 
+/*
+ * A field name as it is printed: "foo_field", "[foo.ext_field]" for extensions,
+ * or the type name for groups, as parsers expect.  It is looked up once per
+ * field, rather than once per value of a repeated field or map.
+ */
+typedef struct {
+  const char* data;
+  size_t size;
+  bool is_ext;
+} txtenc_name;
+
+static txtenc_name txtenc_fieldname(const upb_FieldDef* f) {
+  txtenc_name name;
+  name.is_ext = upb_FieldDef_IsExtension(f);
+  if (name.is_ext) {
+    name.data = upb_FieldDef_FullName(f);
+  } else if (upb_FieldDef_Type(f) == kUpb_FieldType_Group) {
+    name.data = upb_MessageDef_Name(upb_FieldDef_MessageSubDef(f));
+  } else {
+    name.data = upb_FieldDef_Name(f);
+  }
+  name.size = strlen(name.data);
+  return name;
+}
+
+static void txtenc_putname(txtenc* e, txtenc_name name) {
+  if (name.is_ext) {
+    txtenc_putbytes(e, "[", 1);
+    txtenc_putbytes(e, name.data, name.size);
+    txtenc_putbytes(e, "]", 1);
+  } else {
+    txtenc_putbytes(e, name.data, name.size);
+  }
+}
+
 static void txtenc_field(txtenc* e, upb_MessageValue val,
-                         const upb_FieldDef* f) {
+                         const upb_FieldDef* f, txtenc_name name) {
   txtenc_indent(e);
   const upb_CType type = upb_FieldDef_CType(f);
-  const bool is_ext = upb_FieldDef_IsExtension(f);
-  const char* full = upb_FieldDef_FullName(f);
-  const char* name = upb_FieldDef_Name(f);
+  txtenc_putname(e, name);
 
   if (type == kUpb_CType_Message) {
-    if (is_ext) {
-      txtenc_printf(e, "[%s] {", full);
-    } else {
-      txtenc_printf(e, "%s {", name);
-    }
+    txtenc_putbytes(e, " {", 2);
     txtenc_endfield(e);
     e->indent_depth++;
     txtenc_msg(e, val.msg_val, upb_FieldDef_MessageSubDef(f));
@@ -163,11 +240,7 @@ static void txtenc_field(txtenc* e, upb_MessageValue val,
     return;
   }
 
-  if (is_ext) {
-    txtenc_printf(e, "[%s]: ", full);
-  } else {
-    txtenc_printf(e, "%s: ", name);
-  }
+  txtenc_putbytes(e, ": ", 2);
 
   switch (type) {
     case kUpb_CType_Bool:
@@ -175,27 +248,29 @@ static void txtenc_field(txtenc* e, upb_MessageValue val,
       break;
     case kUpb_CType_Float: {
       char buf[32];
+      if (txtenc_specialfloat(e, val.float_val)) break;
       _upb_EncodeRoundTripFloat(val.float_val, buf, sizeof(buf));
       txtenc_putstr(e, buf);
       break;
     }
     case kUpb_CType_Double: {
       char buf[32];
+      if (txtenc_specialfloat(e, val.double_val)) break;
       _upb_EncodeRoundTripDouble(val.double_val, buf, sizeof(buf));
       txtenc_putstr(e, buf);
       break;
     }
     case kUpb_CType_Int32:
-      txtenc_printf(e, "%" PRId32, val.int32_val);
+      txtenc_int64(e, val.int32_val);
       break;
     case kUpb_CType_UInt32:
-      txtenc_printf(e, "%" PRIu32, val.uint32_val);
+      txtenc_uint64(e, val.uint32_val);
       break;
     case kUpb_CType_Int64:
-      txtenc_printf(e, "%" PRId64, val.int64_val);
+      txtenc_int64(e, val.int64_val);
       break;
     case kUpb_CType_UInt64:
-      txtenc_printf(e, "%" PRIu64, val.uint64_val);
+      txtenc_uint64(e, val.uint64_val);
       break;
     case kUpb_CType_String:
       txtenc_string(e, val.str_val, false);
@@ -224,24 +299,29 @@ static void txtenc_array(txtenc* e, const upb_Array* arr,
                          const upb_FieldDef* f) {
   size_t i;
   size_t size = upb_Array_Size(arr);
+  txtenc_name name = txtenc_fieldname(f);
 
   for (i = 0; i < size; i++) {
-    txtenc_field(e, upb_Array_Get(arr, i), f);
+    txtenc_field(e, upb_Array_Get(arr, i), f, name);
   }
 }
 
 static void txtenc_mapentry(txtenc* e, upb_MessageValue key,
-                            upb_MessageValue val, const upb_FieldDef* f) {
+                            upb_MessageValue val, const upb_FieldDef* f,
+                            txtenc_name name) {
+  static const txtenc_name key_name = {"key", 3, false};
+  static const txtenc_name val_name = {"value", 5, false};
   const upb_MessageDef* entry = upb_FieldDef_MessageSubDef(f);
   const upb_FieldDef* key_f = upb_MessageDef_Field(entry, 0);
   const upb_FieldDef* val_f = upb_MessageDef_Field(entry, 1);
   txtenc_indent(e);
-  txtenc_printf(e, "%s {", upb_FieldDef_Name(f));
+  txtenc_putname(e, name);
+  txtenc_putbytes(e, " {", 2);
   txtenc_endfield(e);
   e->indent_depth++;
 
-  txtenc_field(e, key, key_f);
-  txtenc_field(e, val, val_f);
+  txtenc_field(e, key, key_f, key_name);
+  txtenc_field(e, val, val_f, val_name);
 
   e->indent_depth--;
   txtenc_indent(e);
@@ -262,11 +342,13 @@ static void txtenc_mapentry(txtenc* e, upb_MessageValue key,
  *    }
  */
 static void txtenc_map(txtenc* e, const upb_Map* map, const upb_FieldDef* f) {
+  txtenc_name name = txtenc_fieldname(f);
+
   if (e->options & UPB_TXTENC_NOSORT) {
     size_t iter = kUpb_Map_Begin;
     upb_MessageValue key, val;
     while (upb_Map_Next(map, &key, &val, &iter)) {
-      txtenc_mapentry(e, key, val, f);
+      txtenc_mapentry(e, key, val, f, name);
     }
   } else {
     const upb_MessageDef* entry = upb_FieldDef_MessageSubDef(f);
@@ -279,7 +361,7 @@ static void txtenc_map(txtenc* e, const upb_Map* map, const upb_FieldDef* f) {
       upb_MessageValue key, val;
       memcpy(&key, &ent.data.k, sizeof(key));
       memcpy(&val, &ent.data.v, sizeof(val));
-      txtenc_mapentry(e, key, val, f);
+      txtenc_mapentry(e, key, val, f, name);
     }
     _upb_mapsorter_popmap(&e->sorter, &sorted);
   }
@@ -318,13 +400,14 @@ static const char* txtenc_unknown(txtenc* e, const char* ptr,
     if (tag == end_group) return ptr;
 
     txtenc_indent(e);
-    txtenc_printf(e, "%d: ", (int)upb_WireReader_GetFieldNumber(tag));
+    txtenc_uint64(e, upb_WireReader_GetFieldNumber(tag));
+    txtenc_putbytes(e, ": ", 2);
 
     switch (upb_WireReader_GetWireType(tag)) {
       case kUpb_WireType_Varint: {
         uint64_t val;
         CHK(ptr = upb_WireReader_ReadVarint(ptr, &val));
-        txtenc_printf(e, "%" PRIu64, val);
+        txtenc_uint64(e, val);
         break;
       }
       case kUpb_WireType_32Bit: {
@@ -407,7 +490,7 @@ static void txtenc_msg(txtenc* e, const upb_Message* msg,
     } else if (upb_FieldDef_IsRepeated(f)) {
       txtenc_array(e, val.array_val, f);
     } else {
-      txtenc_field(e, val, f);
+      txtenc_field(e, val, f, txtenc_fieldname(f));
     }
   }
 
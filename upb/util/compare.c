@@ -8,8 +8,24 @@
 #include "upb/util/compare.h"
 
 #include <stdlib.h>
+#include <string.h>
 
+#include "upb/base/descriptor_constants.h"
 #include "upb/base/string_view.h"
+#include "upb/mem/arena.h"
+#include "upb/message/array.h"
+#include "upb/message/internal/accessors.h"
+#include "upb/message/internal/array.h"
+#include "upb/message/internal/extension.h"
+#include "upb/message/map.h"
+#include "upb/message/message.h"
+#include "upb/message/tagged_ptr.h"
+#include "upb/message/value.h"
+#include "upb/mini_table/extension.h"
+#include "upb/mini_table/field.h"
+#include "upb/mini_table/internal/field.h"
+#include "upb/mini_table/message.h"
+#include "upb/wire/decode.h"
 #include "upb/wire/eps_copy_input_stream.h"
 #include "upb/wire/reader.h"
 #include "upb/wire/types.h"
@@ -286,3 +302,255 @@ upb_UnknownCompareResult upb_Message_UnknownFieldsAreEqual(const char* buf1,
 
   return upb_UnknownField_Compare(&ctx, buf1, size1, buf2, size2);
 }
+
+// Message comparison //////////////////////////////////////////////////////////
+
+// Nesting limit for sub-messages, which also bounds the unknown fields.
+#define kUpb_Compare_DepthLimit 100
+
+static bool upb_Message_DoIsEqual(const upb_Message* msg1,
+                                  const upb_Message* msg2,
+                                  const upb_MiniTable* m, int depth);
+
+static bool upb_Compare_UnknownFields(const upb_Message* msg1,
+                                      const upb_Message* msg2, int depth) {
+  size_t size1, size2;
+  const char* buf1 = upb_Message_GetUnknown(msg1, &size1);
+  const char* buf2 = upb_Message_GetUnknown(msg2, &size2);
+  return upb_Message_UnknownFieldsAreEqual(buf1, size1, buf2, size2, depth) ==
+         kUpb_UnknownCompareResult_Equal;
+}
+
+// Compares a sub-message that was left unparsed, whose data is held in the
+// unknown fields of an empty message, with a parsed one, by parsing the former
+// into a temporary arena.
+static bool upb_Compare_EmptyWithParsed(const upb_Message* empty,
+                                        const upb_Message* parsed,
+                                        const upb_MiniTable* m, int depth) {
+  if (!m) return false;  // Unlinked.
+  upb_Arena* arena = upb_Arena_New();
+  if (!arena) return false;
+  size_t size;
+  const char* buf = upb_Message_GetUnknown(empty, &size);
+  upb_Message* msg = upb_Message_New(m, arena);
+  bool ret = msg &&
+             upb_Decode(buf, size, msg, m, NULL, 0, arena) ==
+                 kUpb_DecodeStatus_Ok &&
+             upb_Message_DoIsEqual(msg, parsed, m, depth);
+  upb_Arena_Free(arena);
+  return ret;
+}
+
+static bool upb_Compare_TaggedMessages(upb_TaggedMessagePtr ptr1,
+                                       upb_TaggedMessagePtr ptr2,
+                                       const upb_MiniTable* m, int depth) {
+  const upb_Message* msg1 = _upb_TaggedMessagePtr_GetMessage(ptr1);
+  const upb_Message* msg2 = _upb_TaggedMessagePtr_GetMessage(ptr2);
+  bool empty1 = upb_TaggedMessagePtr_IsEmpty(ptr1);
+  bool empty2 = upb_TaggedMessagePtr_IsEmpty(ptr2);
+  if (empty1 && empty2) return upb_Compare_UnknownFields(msg1, msg2, depth);
+  if (empty1) return upb_Compare_EmptyWithParsed(msg1, msg2, m, depth);
+  if (empty2) return upb_Compare_EmptyWithParsed(msg2, msg1, m, depth);
+  return upb_Message_DoIsEqual(msg1, msg2, m, depth);
+}
+
+static bool upb_Compare_Values(upb_MessageValue val1, upb_MessageValue val2,
+                               upb_CType type, const upb_MiniTable* sub,
+                               int depth) {
+  switch (type) {
+    case kUpb_CType_Bool:
+      return val1.bool_val == val2.bool_val;
+    case kUpb_CType_Float:
+      return val1.float_val == val2.float_val;
+    case kUpb_CType_Double:
+      return val1.double_val == val2.double_val;
+    case kUpb_CType_Int32:
+    case kUpb_CType_UInt32:
+    case kUpb_CType_Enum:
+      return val1.int32_val == val2.int32_val;
+    case kUpb_CType_Int64:
+    case kUpb_CType_UInt64:
+      return val1.int64_val == val2.int64_val;
+    case kUpb_CType_String:
+    case kUpb_CType_Bytes:
+      // Empty strings may have NULL data.
+      return val1.str_val.size == val2.str_val.size &&
+             (val1.str_val.size == 0 ||
+              memcmp(val1.str_val.data, val2.str_val.data,
+                     val1.str_val.size) == 0);
+    case kUpb_CType_Message:
+      return upb_Compare_TaggedMessages((upb_TaggedMessagePtr)val1.msg_val,
+                                        (upb_TaggedMessagePtr)val2.msg_val,
+                                        sub, depth);
+  }
+  UPB_UNREACHABLE();
+}
+
+static bool upb_Compare_Arrays(const upb_Array* arr1, const upb_Array* arr2,
+                               upb_CType type, const upb_MiniTable* sub,
+                               int depth) {
+  size_t size1 = arr1 ? upb_Array_Size(arr1) : 0;
+  size_t size2 = arr2 ? upb_Array_Size(arr2) : 0;
+  if (size1 != size2) return false;
+  if (size1 == 0) return true;
+  switch (type) {
+    case kUpb_CType_Float:
+    case kUpb_CType_Double:
+    case kUpb_CType_String:
+    case kUpb_CType_Bytes:
+    case kUpb_CType_Message:
+      break;
+    default:
+      // Integers are equal exactly when their representations are.
+      return memcmp(_upb_array_constptr(arr1), _upb_array_constptr(arr2),
+                    size1 << _upb_Array_CTypeSizeLg2(type)) == 0;
+  }
+  for (size_t i = 0; i < size1; i++) {
+    if (!upb_Compare_Values(upb_Array_Get(arr1, i), upb_Array_Get(arr2, i),
+                            type, sub, depth)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool upb_Compare_Maps(const upb_Map* map1, const upb_Map* map2,
+                             const upb_MiniTable* entry, int depth) {
+  size_t size1 = map1 ? upb_Map_Size(map1) : 0;
+  size_t size2 = map2 ? upb_Map_Size(map2) : 0;
+  if (size1 != size2) return false;
+  if (size1 == 0) return true;
+  const upb_MiniTableField* val_field = &entry->fields[1];
+  upb_CType val_type = upb_MiniTableField_CType(val_field);
+  const upb_MiniTable* val_sub =
+      val_type == kUpb_CType_Message
+          ? upb_MiniTable_GetSubMessageTable(entry, val_field)
+          : NULL;
+  // Entries are stored in hash order, so each key is looked up in the other
+  // map.
+  upb_MessageValue key, val1, val2;
+  size_t iter = kUpb_Map_Begin;
+  while (upb_Map_Next(map1, &key, &val1, &iter)) {
+    if (!upb_Map_Get(map2, key, &val2)) return false;
+    if (!upb_Compare_Values(val1, val2, val_type, val_sub, depth)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool upb_Compare_Field(const upb_Message* msg1, const upb_Message* msg2,
+                              const upb_MiniTable* m,
+                              const upb_MiniTableField* field, int depth) {
+  const void* ptr1 = _upb_MiniTableField_GetConstPtr(msg1, field);
+  const void* ptr2 = _upb_MiniTableField_GetConstPtr(msg2, field);
+  upb_CType type = upb_MiniTableField_CType(field);
+
+  switch (upb_FieldMode_Get(field)) {
+    case kUpb_FieldMode_Map:
+      if (*(void* const*)ptr1 == *(void* const*)ptr2) return true;
+      return upb_Compare_Maps(*(const upb_Map* const*)ptr1,
+                              *(const upb_Map* const*)ptr2,
+                              upb_MiniTable_GetSubMessageTable(m, field),
+                              depth);
+    case kUpb_FieldMode_Array:
+      if (*(void* const*)ptr1 == *(void* const*)ptr2) return true;
+      return upb_Compare_Arrays(
+          *(const upb_Array* const*)ptr1, *(const upb_Array* const*)ptr2, type,
+          type == kUpb_CType_Message
+              ? upb_MiniTable_GetSubMessageTable(m, field)
+              : NULL,
+          depth);
+    default:
+      break;
+  }
+
+  if (field->presence > 0) {
+    bool has1 = _upb_hasbit_field(msg1, field);
+    if (has1 != _upb_hasbit_field(msg2, field)) return false;
+    if (!has1) return true;
+  } else if (_upb_MiniTableField_InOneOf(field)) {
+    // Both oneof cases were compared already.
+    if (_upb_getoneofcase_field(msg1, field) != field->number) return true;
+  }
+
+  switch (type) {
+    case kUpb_CType_Float:
+    case kUpb_CType_Double:
+      // Without presence, zero values are not set: a set -0.0 does not equal
+      // an unset 0.0.  For the other types, equal values are set alike.
+      if (field->presence == 0 &&
+          _upb_MiniTable_ValueIsNonZero(ptr1, field) !=
+              _upb_MiniTable_ValueIsNonZero(ptr2, field)) {
+        return false;
+      }
+      // Fallthrough.
+    case kUpb_CType_String:
+    case kUpb_CType_Bytes:
+    case kUpb_CType_Message: {
+      upb_MessageValue val1, val2;
+      _upb_MiniTable_CopyFieldData(&val1, ptr1, field);
+      _upb_MiniTable_CopyFieldData(&val2, ptr2, field);
+      return upb_Compare_Values(val1, val2, type,
+                                type == kUpb_CType_Message
+                                    ? upb_MiniTable_GetSubMessageTable(m, field)
+                                    : NULL,
+                                depth);
+    }
+    default:
+      return memcmp(ptr1, ptr2,
+                    (size_t)1 << _upb_MiniTable_ElementSizeLg2(field)) == 0;
+  }
+}
+
+static bool upb_Compare_Extensions(const upb_Message* msg1,
+                                   const upb_Message* msg2, int depth) {
+  size_t count1, count2;
+  const upb_Message_Extension* exts1 = _upb_Message_Getexts(msg1, &count1);
+  _upb_Message_Getexts(msg2, &count2);
+  if (count1 != count2) return false;
+  for (size_t i = 0; i < count1; i++) {
+    const upb_MiniTableExtension* ext = exts1[i].ext;
+    const upb_Message_Extension* ext2 = _upb_Message_Getext(msg2, ext);
+    if (!ext2) return false;
+    const upb_MiniTableField* field = &ext->field;
+    upb_CType type = upb_MiniTableField_CType(field);
+    const upb_MiniTable* sub =
+        type == kUpb_CType_Message ? ext->sub.submsg : NULL;
+    if (upb_IsRepeatedOrMap(field)) {
+      if (!upb_Compare_Arrays(exts1[i].data.ptr, ext2->data.ptr, type, sub,
+                              depth)) {
+        return false;
+      }
+    } else {
+      upb_MessageValue val1, val2;
+      _upb_MiniTable_CopyFieldData(&val1, &exts1[i].data, field);
+      _upb_MiniTable_CopyFieldData(&val2, &ext2->data, field);
+      if (!upb_Compare_Values(val1, val2, type, sub, depth)) return false;
+    }
+  }
+  return true;
+}
+
+static bool upb_Message_DoIsEqual(const upb_Message* msg1,
+                                  const upb_Message* msg2,
+                                  const upb_MiniTable* m, int depth) {
+  if (msg1 == msg2) return true;
+  if (--depth == 0) return false;
+  for (size_t i = 0; i < m->field_count; i++) {
+    const upb_MiniTableField* field = &m->fields[i];
+    if (_upb_MiniTableField_InOneOf(field) &&
+        _upb_getoneofcase_field(msg1, field) !=
+            _upb_getoneofcase_field(msg2, field)) {
+      return false;
+    }
+    if (!upb_Compare_Field(msg1, msg2, m, field, depth)) return false;
+  }
+  return upb_Compare_Extensions(msg1, msg2, depth) &&
+         upb_Compare_UnknownFields(msg1, msg2, depth);
+}
+
+bool upb_Message_IsEqual(const upb_Message* msg1, const upb_Message* msg2,
+                         const upb_MiniTable* m) {
+  return upb_Message_DoIsEqual(msg1, msg2, m, kUpb_Compare_DepthLimit);
+}
@@ -10,6 +10,9 @@
 
 #include <stddef.h>
 
+#include "upb/message/message.h"
+#include "upb/mini_table/message.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -39,6 +42,22 @@ upb_UnknownCompareResult upb_Message_UnknownFieldsAreEqual(const char* buf1,
                                                            size_t size2,
                                                            int max_depth);
 
+// Returns true if the two messages of type `m` are equal: they have the same
+// fields set, including extensions, to equal values, and equal unknown fields
+// as compared by upb_Message_UnknownFieldsAreEqual().
+//
+// The messages are compared directly, field by field as laid out by `m`,
+// without serializing them.  Repeated fields compare in order and maps
+// regardless of order.  Floating point values compare by value, so NaN is
+// never equal to itself and -0.0 equals 0.0 when both are set.  Sub-messages
+// that were left unparsed compare by their unknown fields if both are
+// unparsed; otherwise the unparsed one is parsed into a temporary arena.
+//
+// Returns false as well if the messages are nested more than 100 deep or
+// memory runs out.
+bool upb_Message_IsEqual(const upb_Message* msg1, const upb_Message* msg2,
+                         const upb_MiniTable* m);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
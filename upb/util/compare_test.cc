@@ -15,6 +15,11 @@
 #include <vector>
 
 #include <gtest/gtest.h>
+#include "google/protobuf/test_messages_proto3.upb.h"
+#include "google/protobuf/test_messages_proto3.upb_minitable.h"
+#include "upb/base/string_view.h"
+#include "upb/mem/arena.hpp"
+#include "upb/wire/decode.h"
 #include "upb/wire/internal/swap.h"
 #include "upb/wire/types.h"
 
@@ -172,3 +177,111 @@ TEST(CompareTest, MaxDepth) {
           {{1, Group({{2, Group({{4, Fixed64(123)}, {3, Fixed32(456)}})}})}},
           2));
 }
+
+typedef protobuf_test_messages_proto3_TestAllTypesProto3 TestAllTypes;
+
+const upb_MiniTable* TestAllTypesMiniTable() {
+  return &protobuf_0test_0messages__proto3__TestAllTypesProto3_msg_init;
+}
+
+// Sets the same fields on every call, inserting map entries in the order of
+// `keys`.
+TestAllTypes* NewTestMessage(std::initializer_list<int32_t> keys,
+                             upb_Arena* arena) {
+  TestAllTypes* msg =
+      protobuf_test_messages_proto3_TestAllTypesProto3_new(arena);
+  protobuf_test_messages_proto3_TestAllTypesProto3_set_optional_int32(msg, 1);
+  protobuf_test_messages_proto3_TestAllTypesProto3_set_optional_string(
+      msg, upb_StringView_FromString("abc"));
+  protobuf_test_messages_proto3_TestAllTypesProto3_NestedMessage_set_a(
+      protobuf_test_messages_proto3_TestAllTypesProto3_mutable_optional_nested_message(
+          msg, arena),
+      2);
+  for (int32_t key : keys) {
+    protobuf_test_messages_proto3_TestAllTypesProto3_map_int32_int32_set(
+        msg, key, key * 2, arena);
+    protobuf_test_messages_proto3_TestAllTypesProto3_add_repeated_int32(msg, 3,
+                                                                        arena);
+  }
+  protobuf_test_messages_proto3_TestAllTypesProto3_add_repeated_double(msg, 1.5,
+                                                                       arena);
+  protobuf_test_messages_proto3_TestAllTypesProto3_set_oneof_uint32(msg, 4);
+  return msg;
+}
+
+TEST(CompareTest, MessagesAreEqual) {
+  upb::Arena arena;
+  TestAllTypes* msg1 = NewTestMessage({1, 2, 3, 4}, arena.ptr());
+  TestAllTypes* msg2 = NewTestMessage({4, 3, 2, 1}, arena.ptr());
+  EXPECT_TRUE(upb_Message_IsEqual(msg1, msg2, TestAllTypesMiniTable()));
+
+  protobuf_test_messages_proto3_TestAllTypesProto3_NestedMessage_set_a(
+      protobuf_test_messages_proto3_TestAllTypesProto3_mutable_optional_nested_message(
+          msg2, arena.ptr()),
+      3);
+  EXPECT_FALSE(upb_Message_IsEqual(msg1, msg2, TestAllTypesMiniTable()));
+
+  msg2 = NewTestMessage({1, 2, 3, 4}, arena.ptr());
+  protobuf_test_messages_proto3_TestAllTypesProto3_map_int32_int32_set(
+      msg2, 4, 9, arena.ptr());
+  EXPECT_FALSE(upb_Message_IsEqual(msg1, msg2, TestAllTypesMiniTable()));
+
+  // Another member of the oneof, with the same value.
+  msg2 = NewTestMessage({1, 2, 3, 4}, arena.ptr());
+  protobuf_test_messages_proto3_TestAllTypesProto3_set_oneof_uint64(msg2, 4);
+  EXPECT_FALSE(upb_Message_IsEqual(msg1, msg2, TestAllTypesMiniTable()));
+
+  msg2 = NewTestMessage({1, 2, 3, 4}, arena.ptr());
+  protobuf_test_messages_proto3_TestAllTypesProto3_add_repeated_int32(
+      msg2, 3, arena.ptr());
+  EXPECT_FALSE(upb_Message_IsEqual(msg1, msg2, TestAllTypesMiniTable()));
+}
+
+TEST(CompareTest, MessageWithUnknownFields) {
+  upb::Arena arena;
+  TestAllTypes* msg1 = NewTestMessage({1}, arena.ptr());
+  size_t size;
+  char* data = protobuf_test_messages_proto3_TestAllTypesProto3_serialize(
+      msg1, arena.ptr(), &size);
+  ASSERT_TRUE(data != nullptr);
+  std::string with_unknown(data, size);
+  with_unknown += ToBinaryPayload({{9999, Varint(1)}});
+
+  TestAllTypes* msg2 = protobuf_test_messages_proto3_TestAllTypesProto3_parse(
+      with_unknown.data(), with_unknown.size(), arena.ptr());
+  ASSERT_TRUE(msg2 != nullptr);
+  EXPECT_FALSE(upb_Message_IsEqual(msg1, msg2, TestAllTypesMiniTable()));
+  TestAllTypes* msg3 = protobuf_test_messages_proto3_TestAllTypesProto3_parse(
+      with_unknown.data(), with_unknown.size(), arena.ptr());
+  EXPECT_TRUE(upb_Message_IsEqual(msg2, msg3, TestAllTypesMiniTable()));
+}
+
+TEST(CompareTest, LazySubMessages) {
+  upb::Arena arena;
+  TestAllTypes* msg = NewTestMessage({1, 2}, arena.ptr());
+  size_t size;
+  char* data = protobuf_test_messages_proto3_TestAllTypesProto3_serialize(
+      msg, arena.ptr(), &size);
+  ASSERT_TRUE(data != nullptr);
+
+  TestAllTypes* lazy1 =
+      protobuf_test_messages_proto3_TestAllTypesProto3_new(arena.ptr());
+  TestAllTypes* lazy2 =
+      protobuf_test_messages_proto3_TestAllTypesProto3_new(arena.ptr());
+  for (TestAllTypes* lazy : {lazy1, lazy2}) {
+    ASSERT_EQ(kUpb_DecodeStatus_Ok,
+              upb_Decode(data, size, lazy, TestAllTypesMiniTable(), nullptr,
+                         kUpb_DecodeOption_ExperimentalLazySubMessages,
+                         arena.ptr()));
+  }
+  EXPECT_TRUE(upb_Message_IsEqual(lazy1, lazy2, TestAllTypesMiniTable()));
+  EXPECT_TRUE(upb_Message_IsEqual(msg, lazy1, TestAllTypesMiniTable()));
+  EXPECT_TRUE(upb_Message_IsEqual(lazy1, msg, TestAllTypesMiniTable()));
+
+  TestAllTypes* other = NewTestMessage({1, 2}, arena.ptr());
+  protobuf_test_messages_proto3_TestAllTypesProto3_NestedMessage_set_a(
+      protobuf_test_messages_proto3_TestAllTypesProto3_mutable_optional_nested_message(
+          other, arena.ptr()),
+      5);
+  EXPECT_FALSE(upb_Message_IsEqual(other, lazy1, TestAllTypesMiniTable()));
+}
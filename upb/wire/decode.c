@@ -45,6 +45,11 @@
 #include "upb/wire/internal/swap.h"
 #include "upb/wire/reader.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
 // Must be last.
 #include "upb/port/def.inc"
 
@@ -265,6 +270,28 @@ static upb_Message* _upb_Decoder_ReuseSubMessage(
   return promoted;
 }
 
+// Keeps the data of a sub-message field verbatim in an empty message, to be
+// parsed when the message is promoted.  Data for the same field that appears
+// more than once is appended, which merges it as parsing would.
+static const char* _upb_Decoder_DecodeLazySubMessage(
+    upb_Decoder* d, const char* ptr, upb_TaggedMessagePtr* target, int size) {
+  upb_Message* empty;
+  if (*target) {
+    empty = _upb_TaggedMessagePtr_GetEmptyMessage(*target);
+  } else {
+    empty = _upb_Message_New(&_kUpb_MiniTable_Empty, &d->arena);
+    if (!empty) _upb_Decoder_ErrorJmp(d, kUpb_DecodeStatus_OutOfMemory);
+    *target = _upb_TaggedMessagePtr_Pack(empty, true);
+  }
+  if (!upb_EpsCopyInputStream_CheckDataSizeAvailable(&d->input, ptr, size)) {
+    _upb_Decoder_ErrorJmp(d, kUpb_DecodeStatus_Malformed);
+  }
+  if (!_upb_Message_AddUnknown(empty, ptr, size, &d->arena)) {
+    _upb_Decoder_ErrorJmp(d, kUpb_DecodeStatus_OutOfMemory);
+  }
+  return ptr + size;
+}
+
 static const char* _upb_Decoder_ReadString(upb_Decoder* d, const char* ptr,
                                            int size, upb_StringView* str) {
   const char* str_ptr = ptr;
@@ -436,11 +463,65 @@ static const char* _upb_Decoder_DecodeFixedPacked(
   return ptr;
 }
 
+// Returns the number of varints that end in the `size` bytes at `ptr`, which
+// is the number of bytes without a continuation bit.
+static size_t _upb_Decoder_CountVarints(const char* ptr, size_t size) {
+  const char* end = ptr + size;
+  size_t count = 0;
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  // Each byte of `acc` counts the terminating bytes in its lane, for at most
+  // 255 blocks before they are summed.
+  while (end - ptr >= 16) {
+    size_t blocks = UPB_MIN((size_t)(end - ptr) / 16, 255);
+    __m128i acc = _mm_setzero_si128();
+    for (size_t i = 0; i < blocks; i++, ptr += 16) {
+      __m128i bytes = _mm_loadu_si128((const __m128i*)ptr);
+      acc = _mm_sub_epi8(acc, _mm_cmpgt_epi8(bytes, _mm_set1_epi8(-1)));
+    }
+    __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+    count += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+  }
+#else
+  // The terminating bytes become 0x01 and the multiply sums them into the top
+  // byte.
+  for (; end - ptr >= 8; ptr += 8) {
+    uint64_t word;
+    memcpy(&word, ptr, 8);
+    word = (~word & 0x8080808080808080ULL) >> 7;
+    count += (word * 0x0101010101010101ULL) >> 56;
+  }
+#endif
+  for (; ptr < end; ptr++) {
+    count += (*ptr & 0x80) == 0;
+  }
+  return count;
+}
+
+// Reserves space for every element of a packed varint field up front, so a
+// large field is not copied from block to block as the array grows.  This is
+// skipped when the array could grow in place anyway: each varint is at least
+// one byte, so `size` elements is an upper bound.  The count is also only an
+// upper bound for enums, and it is skipped if the field is not all in the
+// current buffer; the decode loop still checks the capacity for each element.
+static void _upb_Decoder_ReservePackedVarints(upb_Decoder* d, const char* ptr,
+                                              upb_Array* arr, int size,
+                                              int lg2) {
+  if (arr->capacity - arr->size >= (size_t)size ||
+      ((size_t)size << lg2) <= _upb_ArenaHas(&d->arena)) {
+    return;
+  }
+  if (upb_EpsCopyInputStream_CheckDataSizeAvailable(&d->input, ptr, size)) {
+    _upb_Decoder_Reserve(d, arr, _upb_Decoder_CountVarints(ptr, size));
+  }
+}
+
 UPB_FORCEINLINE
 static const char* _upb_Decoder_DecodeVarintPacked(
     upb_Decoder* d, const char* ptr, upb_Array* arr, wireval* val,
     const upb_MiniTableField* field, int lg2) {
   int scale = 1 << lg2;
+  _upb_Decoder_ReservePackedVarints(d, ptr, arr, (int)val->size, lg2);
   int saved_limit = upb_EpsCopyInputStream_PushLimit(&d->input, ptr, val->size);
   char* out = UPB_PTR_AT(_upb_array_ptr(arr), arr->size << lg2, void);
   while (!_upb_Decoder_IsDone(d, &ptr)) {
@@ -464,6 +545,7 @@ static const char* _upb_Decoder_DecodeEnumPacked(
     const upb_MiniTableSub* subs, const upb_MiniTableField* field,
     wireval* val) {
   const upb_MiniTableEnum* e = subs[field->UPB_PRIVATE(submsg_index)].subenum;
+  _upb_Decoder_ReservePackedVarints(d, ptr, arr, (int)val->size, 2);
   int saved_limit = upb_EpsCopyInputStream_PushLimit(&d->input, ptr, val->size);
   char* out = UPB_PTR_AT(_upb_array_ptr(arr), arr->size * 4, void);
   while (!_upb_Decoder_IsDone(d, &ptr)) {
@@ -707,6 +789,13 @@ static const char* _upb_Decoder_DecodeToSubMessage(
     case kUpb_DecodeOp_SubMessage: {
       upb_TaggedMessagePtr* submsgp = mem;
       upb_Message* submsg;
+      if (UPB_UNLIKELY(d->options &
+                       kUpb_DecodeOption_ExperimentalLazySubMessages) &&
+          type != kUpb_FieldType_Group &&
+          !(field->mode & kUpb_LabelFlags_IsExtension) &&
+          (!*submsgp || upb_TaggedMessagePtr_IsEmpty(*submsgp))) {
+        return _upb_Decoder_DecodeLazySubMessage(d, ptr, submsgp, val->size);
+      }
       if (*submsgp) {
         submsg = _upb_Decoder_ReuseSubMessage(d, subs, field, submsgp);
       } else {
@@ -742,6 +831,15 @@ static const char* _upb_Decoder_DecodeToSubMessage(
   return ptr;
 }
 
+// Returns true if all of the required fields of |msg| are set.
+static bool _upb_Decoder_HasRequired(const upb_Message* msg,
+                                     const upb_MiniTable* l) {
+  uint64_t msg_head;
+  memcpy(&msg_head, msg, 8);
+  msg_head = _upb_BigEndian_Swap64(msg_head);
+  return (upb_MiniTable_requiredmask(l) & ~msg_head) == 0;
+}
+
 UPB_NOINLINE
 const char* _upb_Decoder_CheckRequired(upb_Decoder* d, const char* ptr,
                                        const upb_Message* msg,
@@ -750,21 +848,47 @@ const char* _upb_Decoder_CheckRequired(upb_Decoder* d, const char* ptr,
   if (UPB_LIKELY((d->options & kUpb_DecodeOption_CheckRequired) == 0)) {
     return ptr;
   }
-  uint64_t msg_head;
-  memcpy(&msg_head, msg, 8);
-  msg_head = _upb_BigEndian_Swap64(msg_head);
-  if (upb_MiniTable_requiredmask(l) & ~msg_head) {
-    d->missing_required = true;
+  if (!_upb_Decoder_HasRequired(msg, l)) {
+    // The same message may end several times (eg. a sub-message that occurs
+    // more than once), and only the last time matters.
+    if (d->unverified_count &&
+        d->unverified[d->unverified_count - 1].msg == msg) {
+      return ptr;
+    }
+    if (d->unverified_count == d->unverified_size) {
+      uint32_t new_size = UPB_MAX(8, d->unverified_size * 2);
+      void* mem = upb_Arena_Realloc(
+          &d->arena, d->unverified,
+          d->unverified_size * sizeof(*d->unverified),
+          new_size * sizeof(*d->unverified));
+      if (!mem) _upb_Decoder_ErrorJmp(d, kUpb_DecodeStatus_OutOfMemory);
+      d->unverified = mem;
+      d->unverified_size = new_size;
+    }
+    d->unverified[d->unverified_count].msg = msg;
+    d->unverified[d->unverified_count].layout = l;
+    d->unverified_count++;
   }
   return ptr;
 }
 
+// Returns false if any message that was incomplete when its data ended is still
+// incomplete at the end of the parse.
+static bool _upb_Decoder_VerifyRequired(const upb_Decoder* d) {
+  for (uint32_t i = 0; i < d->unverified_count; i++) {
+    const _upb_Decoder_Unverified* u = &d->unverified[i];
+    if (!_upb_Decoder_HasRequired(u->msg, u->layout)) return false;
+  }
+  return true;
+}
+
 UPB_FORCEINLINE
 static bool _upb_Decoder_TryFastDispatch(upb_Decoder* d, const char** ptr,
                                          upb_Message* msg,
                                          const upb_MiniTable* layout) {
 #if UPB_FASTTABLE
-  if (layout && layout->table_mask != (unsigned char)-1) {
+  if (layout && layout->table_mask != (unsigned char)-1 &&
+      !(d->options & kUpb_DecodeOption_ExperimentalLazySubMessages)) {
     uint16_t tag = _upb_FastDecoder_LoadTag(*ptr);
     intptr_t table = decode_totable(layout);
     *ptr = _upb_FastDecoder_TagDispatch(d, *ptr, msg, table, 0, tag);
@@ -1317,7 +1441,7 @@ static upb_DecodeStatus _upb_Decoder_DecodeTop(struct upb_Decoder* d,
     _upb_Decoder_DecodeMessage(d, buf, msg, l);
   }
   if (d->end_group != DECODE_NOGROUP) return kUpb_DecodeStatus_Malformed;
-  if (d->missing_required) return kUpb_DecodeStatus_MissingRequired;
+  if (!_upb_Decoder_VerifyRequired(d)) return kUpb_DecodeStatus_MissingRequired;
   return kUpb_DecodeStatus_Ok;
 }
 
@@ -1343,6 +1467,10 @@ static upb_DecodeStatus upb_Decoder_Decode(upb_Decoder* const decoder,
       upb_Atomic_Load(&decoder->arena.blocks, memory_order_relaxed);
   arena->head = decoder->arena.head;
   upb_Atomic_Store(&arena->blocks, blocks, memory_order_relaxed);
+  upb_Atomic_Store(&arena->space_allocated,
+                   upb_Atomic_Load(&decoder->arena.space_allocated,
+                                   memory_order_relaxed),
+                   memory_order_relaxed);
   return decoder->status;
 }
 
@@ -1361,7 +1489,9 @@ upb_DecodeStatus upb_Decode(const char* buf, size_t size, void* msg,
   decoder.depth = depth ? depth : kUpb_WireFormat_DefaultDepthLimit;
   decoder.end_group = DECODE_NOGROUP;
   decoder.options = (uint16_t)options;
-  decoder.missing_required = false;
+  decoder.unverified = NULL;
+  decoder.unverified_count = 0;
+  decoder.unverified_size = 0;
   decoder.status = kUpb_DecodeStatus_Ok;
 
   // Violating the encapsulation of the arena for performance reasons.
@@ -1373,6 +1503,9 @@ upb_DecodeStatus upb_Decode(const char* buf, size_t size, void* msg,
   decoder.arena.head = arena->head;
   decoder.arena.block_alloc = arena->block_alloc;
   upb_Atomic_Init(&decoder.arena.blocks, blocks);
+  upb_Atomic_Init(
+      &decoder.arena.space_allocated,
+      upb_Atomic_Load(&arena->space_allocated, memory_order_relaxed));
 
   return upb_Decoder_Decode(&decoder, buf, msg, l, arena);
 }
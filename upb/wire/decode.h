@@ -30,23 +30,31 @@ enum {
    * arena. */
   kUpb_DecodeOption_AliasString = 1,
 
-  /* If set, the parse will return failure if any message is missing any
-   * required fields when the message data ends.  The parse will still continue,
-   * and the failure will only be reported at the end.
+  /* If set, the parse will return failure if any message that occurs in the
+   * payload, including extensions, is still missing required fields when the
+   * parse ends.  The parse will still continue, and the failure will only be
+   * reported at the end.  A message that is incomplete when its data ends is
+   * checked again at the end, so it may be completed by a later occurrence.
+   *
+   * When decoding into an empty message, success therefore means the same as
+   * upb_util_HasUnsetRequired() returning false, without walking the message
+   * again.
    *
    * IMPORTANT CAVEATS:
    *
-   * 1. This can throw a false positive failure if an incomplete message is seen
-   *    on the wire but is later completed when the sub-message occurs again.
-   *    For this reason, a second pass is required to verify a failure, to be
-   *    truly robust.
+   * 1. This can throw a false positive failure if an incomplete sub-message is
+   *    replaced by a later one, eg. by a map entry with the same key or by
+   *    another member of the same oneof.
    *
    * 2. This can return a false success if you are decoding into a message that
    *    already has some sub-message fields present.  If the sub-message does
    *    not occur in the binary payload, we will never visit it and discover the
    *    incomplete sub-message.  For this reason, this check is only useful for
    *    implemting ParseFromString() semantics.  For MergeFromString(), a
-   *    post-parse validation step will always be necessary. */
+   *    post-parse validation step will always be necessary.
+   *
+   * 3. Sub-messages that are not parsed (see the experimental options below)
+   *    are not checked. */
   kUpb_DecodeOption_CheckRequired = 2,
 
   /* EXPERIMENTAL:
@@ -83,6 +91,22 @@ enum {
    *    be created by the parser or the message-copying logic in message/copy.h.
    */
   kUpb_DecodeOption_ExperimentalAllowUnlinked = 4,
+
+  /* EXPERIMENTAL:
+   *
+   * If set, singular sub-message fields are not parsed.  Their data is kept
+   * verbatim in an "empty" message, as if the field were unlinked (see
+   * above), and the same promotion rules apply to the result: the
+   * sub-message must be promoted with upb_Message_GetOrPromoteMessage() from
+   * message/promote.h before it can be read.  Serializing the parent writes
+   * the data back unchanged, without parsing it.
+   *
+   * This makes parsing cheaper for callers that only look at a few
+   * sub-messages of a large payload.  Errors in the sub-message data,
+   * including missing required fields, are only found when it is promoted.
+   * Repeated, map, group and extension fields are always parsed, and the
+   * fast table parser is not used. */
+  kUpb_DecodeOption_ExperimentalLazySubMessages = 8,
 };
 
 UPB_INLINE uint32_t upb_DecodeOptions_MaxDepth(uint16_t depth) {
@@ -0,0 +1,61 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "upb/wire/decode_stream.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "upb/base/status.h"
+#include "upb/io/zero_copy_input_stream.h"
+#include "upb/mem/arena.h"
+#include "upb/wire/decode.h"
+
+// Must be last.
+#include "upb/port/def.inc"
+
+// The initial size of the input buffer.  The buffer doubles as it fills up,
+// and it is grown in place while it is the last allocation on the arena.
+#define kUpb_DecodeStream_InitialSize 4096
+
+upb_DecodeStatus upb_DecodeStream(upb_ZeroCopyInputStream* stream,
+                                  upb_Message* msg, const upb_MiniTable* l,
+                                  const upb_ExtensionRegistry* extreg,
+                                  int options, upb_Arena* arena,
+                                  upb_Status* status) {
+  upb_Status local_status;
+  if (!status) status = &local_status;
+  upb_Status_Clear(status);
+
+  char* buf = NULL;
+  size_t size = 0;
+  size_t capacity = 0;
+  while (true) {
+    size_t count;
+    const void* chunk = upb_ZeroCopyInputStream_Next(stream, &count, status);
+    if (!chunk) {
+      if (!upb_Status_IsOk(status)) return kUpb_DecodeStatus_Malformed;
+      break;
+    }
+    if (count >= INT32_MAX - size) return kUpb_DecodeStatus_Malformed;
+    if (size + count > capacity) {
+      size_t new_capacity = capacity ? capacity : kUpb_DecodeStream_InitialSize;
+      while (new_capacity < size + count) new_capacity *= 2;
+      buf = upb_Arena_Realloc(arena, buf, capacity, new_capacity);
+      if (!buf) return kUpb_DecodeStatus_OutOfMemory;
+      capacity = new_capacity;
+    }
+    memcpy(buf + size, chunk, count);
+    size += count;
+  }
+
+  // Gives back the unused space, if no other allocation followed the buffer.
+  if (buf) buf = upb_Arena_Realloc(arena, buf, capacity, size);
+
+  return upb_Decode(buf ? buf : "", size, msg, l, extreg,
+                    options | kUpb_DecodeOption_AliasString, arena);
+}
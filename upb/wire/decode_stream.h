@@ -0,0 +1,53 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// upb_DecodeStream: parsing from a upb_ZeroCopyInputStream.
+
+#ifndef UPB_WIRE_DECODE_STREAM_H_
+#define UPB_WIRE_DECODE_STREAM_H_
+
+#include "upb/base/status.h"
+#include "upb/io/zero_copy_input_stream.h"
+#include "upb/mem/arena.h"
+#include "upb/message/message.h"
+#include "upb/mini_table/extension_registry.h"
+#include "upb/mini_table/message.h"
+#include "upb/wire/decode.h"
+
+// Must be last.
+#include "upb/port/def.inc"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Parses the rest of `stream` into `msg`, like upb_Decode() parses a buffer.
+//
+// The input is gathered chunk by chunk into a single buffer on `arena`, and
+// string fields alias that buffer as if kUpb_DecodeOption_AliasString had
+// been passed, so the input is held in memory once rather than once in the
+// caller's buffer and again in the message.  Once the input has been parsed,
+// the buffer space that is not referenced by the message is still owned by
+// the arena until it is freed.
+//
+// If the stream reports an error, it is stored in `status`, which may be
+// NULL, and kUpb_DecodeStatus_Malformed is returned.  Input of 2GB or more is
+// malformed as well, as it is for upb_Decode().
+UPB_API upb_DecodeStatus upb_DecodeStream(upb_ZeroCopyInputStream* stream,
+                                          upb_Message* msg,
+                                          const upb_MiniTable* l,
+                                          const upb_ExtensionRegistry* extreg,
+                                          int options, upb_Arena* arena,
+                                          upb_Status* status);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#include "upb/port/undef.inc"
+
+#endif /* UPB_WIRE_DECODE_STREAM_H_ */
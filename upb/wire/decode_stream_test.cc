@@ -0,0 +1,103 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "upb/wire/decode_stream.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/test_messages_proto3.upb.h"
+#include "google/protobuf/test_messages_proto3.upb_minitable.h"
+#include "upb/base/status.hpp"
+#include "upb/base/string_view.h"
+#include "upb/io/chunked_input_stream.h"
+#include "upb/io/zero_copy_input_stream.h"
+#include "upb/mem/arena.hpp"
+#include "upb/wire/decode.h"
+
+namespace {
+
+typedef protobuf_test_messages_proto3_TestAllTypesProto3 TestAllTypes;
+
+const upb_MiniTable* TestAllTypesMiniTable() {
+  return &protobuf_0test_0messages__proto3__TestAllTypesProto3_msg_init;
+}
+
+std::string SerializeTestMessage(const std::string& str, int count) {
+  upb::Arena arena;
+  TestAllTypes* msg = protobuf_test_messages_proto3_TestAllTypesProto3_new(
+      arena.ptr());
+  upb_StringView view = upb_StringView_FromDataAndSize(str.data(), str.size());
+  protobuf_test_messages_proto3_TestAllTypesProto3_set_optional_string(msg,
+                                                                       view);
+  for (int i = 0; i < count; i++) {
+    protobuf_test_messages_proto3_TestAllTypesProto3_add_repeated_int32(
+        msg, i, arena.ptr());
+  }
+  size_t size;
+  char* data = protobuf_test_messages_proto3_TestAllTypesProto3_serialize(
+      msg, arena.ptr(), &size);
+  return std::string(data, size);
+}
+
+TEST(DecodeStreamTest, DecodesAcrossChunks) {
+  const std::string str(10000, 'x');
+  const std::string data = SerializeTestMessage(str, 1000);
+
+  for (size_t limit : {1, 7, 16, 100, 4096, 100000}) {
+    upb::Arena arena;
+    upb_ZeroCopyInputStream* stream = upb_ChunkedInputStream_New(
+        data.data(), data.size(), limit, arena.ptr());
+    TestAllTypes* msg =
+        protobuf_test_messages_proto3_TestAllTypesProto3_new(arena.ptr());
+    upb::Status status;
+    ASSERT_EQ(kUpb_DecodeStatus_Ok,
+              upb_DecodeStream(stream, msg, TestAllTypesMiniTable(),
+                               nullptr, 0, arena.ptr(), status.ptr()));
+    EXPECT_TRUE(status.ok());
+
+    upb_StringView parsed =
+        protobuf_test_messages_proto3_TestAllTypesProto3_optional_string(msg);
+    EXPECT_EQ(str, std::string(parsed.data, parsed.size));
+    size_t count;
+    const int32_t* values =
+        protobuf_test_messages_proto3_TestAllTypesProto3_repeated_int32(msg,
+                                                                        &count);
+    ASSERT_EQ(size_t{1000}, count);
+    for (size_t i = 0; i < count; i++) {
+      EXPECT_EQ(static_cast<int32_t>(i), values[i]);
+    }
+  }
+}
+
+TEST(DecodeStreamTest, EmptyStream) {
+  upb::Arena arena;
+  upb_ZeroCopyInputStream* stream =
+      upb_ChunkedInputStream_New("", 0, 16, arena.ptr());
+  TestAllTypes* msg =
+      protobuf_test_messages_proto3_TestAllTypesProto3_new(arena.ptr());
+  EXPECT_EQ(kUpb_DecodeStatus_Ok,
+            upb_DecodeStream(stream, msg, TestAllTypesMiniTable(),
+                             nullptr, 0, arena.ptr(), nullptr));
+}
+
+TEST(DecodeStreamTest, TruncatedInput) {
+  const std::string data = SerializeTestMessage(std::string(100, 'x'), 0);
+  upb::Arena arena;
+  upb_ZeroCopyInputStream* stream = upb_ChunkedInputStream_New(
+      data.data(), data.size() - 1, 16, arena.ptr());
+  TestAllTypes* msg =
+      protobuf_test_messages_proto3_TestAllTypesProto3_new(arena.ptr());
+  EXPECT_EQ(kUpb_DecodeStatus_Malformed,
+            upb_DecodeStream(stream, msg, TestAllTypesMiniTable(),
+                             nullptr, 0, arena.ptr(), nullptr));
+}
+
+}  // namespace
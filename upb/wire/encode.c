@@ -61,6 +61,9 @@ static uint64_t encode_zz64(int64_t n) {
   return ((uint64_t)n << 1) ^ (n >> 63);
 }
 
+// Room for the largest write other than encode_bytes(), a varint.
+#define kUpb_Encode_ScratchSize 16
+
 typedef struct {
   upb_EncodeStatus status;
   jmp_buf err;
@@ -69,8 +72,19 @@ typedef struct {
   int options;
   int depth;
   _upb_mapsorter sorter;
+  // When only sizing, the output is counted rather than kept: `buf` is the
+  // scratch buffer below, and `skipped` counts the bytes written and dropped.
+  bool size_only;
+  size_t skipped;
+  char scratch[kUpb_Encode_ScratchSize];
 } upb_encstate;
 
+// The number of bytes written so far.
+UPB_FORCEINLINE
+static size_t encode_written(const upb_encstate* e) {
+  return e->skipped + (e->limit - e->ptr);
+}
+
 static size_t upb_roundup_pow2(size_t bytes) {
   size_t ret = 128;
   while (ret < bytes) {
@@ -87,6 +101,13 @@ UPB_NORETURN static void encode_err(upb_encstate* e, upb_EncodeStatus s) {
 
 UPB_NOINLINE
 static void encode_growbuffer(upb_encstate* e, size_t bytes) {
+  if (e->size_only) {
+    UPB_ASSERT(bytes <= kUpb_Encode_ScratchSize);
+    e->skipped += e->limit - e->ptr;
+    e->ptr = e->limit - bytes;
+    return;
+  }
+
   size_t old_size = e->limit - e->buf;
   size_t new_size = upb_roundup_pow2(bytes + (e->limit - e->ptr));
   char* new_buf = upb_Arena_Realloc(e->arena, e->buf, old_size, new_size);
@@ -122,6 +143,10 @@ static void encode_reserve(upb_encstate* e, size_t bytes) {
 /* Writes the given bytes to the buffer, handling reserve/advance. */
 static void encode_bytes(upb_encstate* e, const void* data, size_t len) {
   if (len == 0) return; /* memcpy() with zero size is UB */
+  if ((size_t)(e->ptr - e->buf) < len && e->size_only) {
+    e->skipped += len;
+    return;
+  }
   encode_reserve(e, len);
   memcpy(e->ptr, data, len);
 }
@@ -307,7 +332,7 @@ static void encode_array(upb_encstate* e, const upb_Message* msg,
                          const upb_MiniTableField* f) {
   const upb_Array* arr = *UPB_PTR_AT(msg, f->offset, upb_Array*);
   bool packed = f->mode & kUpb_LabelFlags_IsPacked;
-  size_t pre_len = e->limit - e->ptr;
+  size_t pre_len = encode_written(e);
 
   if (arr == NULL || arr->size == 0) {
     return;
@@ -403,7 +428,7 @@ static void encode_array(upb_encstate* e, const upb_Message* msg,
 #undef VARINT_CASE
 
   if (packed) {
-    encode_varint(e, e->limit - e->ptr - pre_len);
+    encode_varint(e, encode_written(e) - pre_len);
     encode_tag(e, f->number, kUpb_WireType_Delimited);
   }
 }
@@ -413,11 +438,11 @@ static void encode_mapentry(upb_encstate* e, uint32_t number,
                             const upb_MapEntry* ent) {
   const upb_MiniTableField* key_field = &layout->fields[0];
   const upb_MiniTableField* val_field = &layout->fields[1];
-  size_t pre_len = e->limit - e->ptr;
+  size_t pre_len = encode_written(e);
   size_t size;
   encode_scalar(e, &ent->data.v, layout->subs, val_field);
   encode_scalar(e, &ent->data.k, layout->subs, key_field);
-  size = (e->limit - e->ptr) - pre_len;
+  size = encode_written(e) - pre_len;
   encode_varint(e, size);
   encode_tag(e, number, kUpb_WireType_Delimited);
 }
@@ -533,7 +558,7 @@ static void encode_ext(upb_encstate* e, const upb_Message_Extension* ext,
 
 static void encode_message(upb_encstate* e, const upb_Message* msg,
                            const upb_MiniTable* m, size_t* size) {
-  size_t pre_len = e->limit - e->ptr;
+  size_t pre_len = encode_written(e);
 
   if ((e->options & kUpb_EncodeOption_CheckRequired) && m->required_count) {
     uint64_t msg_head;
@@ -587,7 +612,26 @@ static void encode_message(upb_encstate* e, const upb_Message* msg,
     }
   }
 
-  *size = (e->limit - e->ptr) - pre_len;
+  *size = encode_written(e) - pre_len;
+}
+
+// Sizes the output with a pass that only counts bytes, then allocates the
+// buffer at its final size so that it is never grown.
+static void encode_presize(upb_encstate* e, const upb_Message* msg,
+                           const upb_MiniTable* l) {
+  size_t size;
+  e->size_only = true;
+  e->buf = e->scratch;
+  e->ptr = e->limit = e->scratch + kUpb_Encode_ScratchSize;
+  encode_message(e, msg, l, &size);
+  e->size_only = false;
+  e->skipped = 0;
+
+  e->buf = e->ptr = e->limit = NULL;
+  if (size == 0) return;
+  e->buf = upb_Arena_Malloc(e->arena, size);
+  if (!e->buf) encode_err(e, kUpb_EncodeStatus_OutOfMemory);
+  e->ptr = e->limit = e->buf + size;
 }
 
 static upb_EncodeStatus upb_Encoder_Encode(upb_encstate* const encoder,
@@ -600,6 +644,9 @@ static upb_EncodeStatus upb_Encoder_Encode(upb_encstate* const encoder,
   // check for errors until much later (b/235839510). So we still set *buf to
   // NULL on error and we still set it to non-NULL on a successful empty result.
   if (UPB_SETJMP(encoder->err) == 0) {
+    if (encoder->options & kUpb_EncodeOption_Presize) {
+      encode_presize(encoder, msg, l);
+    }
     encode_message(encoder, msg, l, size);
     *size = encoder->limit - encoder->ptr;
     if (*size == 0) {
@@ -632,6 +679,8 @@ upb_EncodeStatus upb_Encode(const void* msg, const upb_MiniTable* l,
   e.ptr = NULL;
   e.depth = depth ? depth : kUpb_WireFormat_DefaultDepthLimit;
   e.options = options;
+  e.size_only = false;
+  e.skipped = 0;
   _upb_mapsorter_init(&e.sorter);
 
   return upb_Encoder_Encode(&e, msg, l, buf, size);
@@ -37,6 +37,13 @@ enum {
 
   // When set, the encode will fail if any required fields are missing.
   kUpb_EncodeOption_CheckRequired = 4,
+
+  // When set, the encoder first walks the message to compute the size of the
+  // output without keeping it, then writes the output into a buffer of that
+  // size. Otherwise the buffer starts small and is reallocated, copying what
+  // was written so far, each time it fills up. For large messages the sizing
+  // pass, which does not copy long strings, costs less than the copies.
+  kUpb_EncodeOption_Presize = 8,
 };
 
 typedef enum {
@@ -24,6 +24,12 @@
 
 #define DECODE_NOGROUP (uint32_t) - 1
 
+// A message that was missing required fields when its data ended.
+typedef struct {
+  const upb_Message* msg;
+  const upb_MiniTable* layout;
+} _upb_Decoder_Unverified;
+
 typedef struct upb_Decoder {
   upb_EpsCopyInputStream input;
   const upb_ExtensionRegistry* extreg;
@@ -32,7 +38,11 @@ typedef struct upb_Decoder {
   int depth;                 // Tracks recursion depth to bound stack usage.
   uint32_t end_group;  // field number of END_GROUP tag, else DECODE_NOGROUP.
   uint16_t options;
-  bool missing_required;
+  // Messages to check again for required fields once the parse is done,
+  // because later data may still set them.
+  _upb_Decoder_Unverified* unverified;
+  uint32_t unverified_count;
+  uint32_t unverified_size;
   upb_Arena arena;
   upb_DecodeStatus status;
   jmp_buf err;
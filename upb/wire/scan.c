@@ -0,0 +1,176 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "upb/wire/scan.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "upb/base/string_view.h"
+#include "upb/wire/internal/swap.h"
+#include "upb/wire/types.h"
+
+// Must be last.
+#include "upb/port/def.inc"
+
+// Nesting limit for groups, as for upb_WireReader_SkipGroup().
+#define kUpb_WireScanner_GroupDepthLimit 100
+
+// The buffer has no slop bytes after it, unlike the input of
+// upb_WireReader, so every read is bounds checked.
+static const char* upb_WireScanner_ReadVarint(const char* ptr,
+                                              const char* end,
+                                              uint64_t* val) {
+  if (UPB_LIKELY(ptr < end && (*ptr & 0x80) == 0)) {
+    *val = (uint8_t)*ptr;
+    return ptr + 1;
+  }
+  uint64_t ret = 0;
+  for (int i = 0; i < 10 && ptr < end; i++) {
+    uint64_t byte = (uint8_t)*ptr++;
+    ret |= (byte & 0x7f) << (i * 7);
+    if ((byte & 0x80) == 0) {
+      *val = ret;
+      return ptr;
+    }
+  }
+  return NULL;
+}
+
+static const char* upb_WireScanner_ReadTag(const char* ptr, const char* end,
+                                           uint32_t* number,
+                                           upb_WireType* wire_type) {
+  uint64_t tag;
+  ptr = upb_WireScanner_ReadVarint(ptr, end, &tag);
+  if (!ptr || tag > UINT32_MAX) return NULL;
+  *number = (uint32_t)tag >> 3;
+  *wire_type = (upb_WireType)(tag & 7);
+  return *number == 0 ? NULL : ptr;
+}
+
+static const char* upb_WireScanner_ReadValue(const char* ptr, const char* end,
+                                             uint32_t number,
+                                             upb_WireType wire_type,
+                                             upb_WireField* field,
+                                             int depth_limit);
+
+// Reads the body of group `number` into `body`, returning a pointer past its
+// end tag.
+static const char* upb_WireScanner_ReadGroup(const char* ptr, const char* end,
+                                             uint32_t number,
+                                             upb_StringView* body,
+                                             int depth_limit) {
+  if (--depth_limit == 0) return NULL;
+  const char* start = ptr;
+  while (ptr < end) {
+    const char* tag_start = ptr;
+    uint32_t field_number;
+    upb_WireType wire_type;
+    ptr = upb_WireScanner_ReadTag(ptr, end, &field_number, &wire_type);
+    if (!ptr) return NULL;
+    if (wire_type == kUpb_WireType_EndGroup) {
+      if (field_number != number) return NULL;
+      *body = upb_StringView_FromDataAndSize(start, tag_start - start);
+      return ptr;
+    }
+    upb_WireField field;
+    ptr = upb_WireScanner_ReadValue(ptr, end, field_number, wire_type, &field,
+                                    depth_limit);
+    if (!ptr) return NULL;
+  }
+  return NULL;  // Missing end tag.
+}
+
+static const char* upb_WireScanner_ReadValue(const char* ptr, const char* end,
+                                             uint32_t number,
+                                             upb_WireType wire_type,
+                                             upb_WireField* field,
+                                             int depth_limit) {
+  field->number = number;
+  field->wire_type = wire_type;
+  switch (wire_type) {
+    case kUpb_WireType_Varint:
+      return upb_WireScanner_ReadVarint(ptr, end, &field->val.int_val);
+    case kUpb_WireType_32Bit: {
+      if (end - ptr < 4) return NULL;
+      uint32_t val;
+      memcpy(&val, ptr, 4);
+      field->val.int_val = _upb_BigEndian_Swap32(val);
+      return ptr + 4;
+    }
+    case kUpb_WireType_64Bit: {
+      if (end - ptr < 8) return NULL;
+      uint64_t val;
+      memcpy(&val, ptr, 8);
+      field->val.int_val = _upb_BigEndian_Swap64(val);
+      return ptr + 8;
+    }
+    case kUpb_WireType_Delimited: {
+      uint64_t size;
+      ptr = upb_WireScanner_ReadVarint(ptr, end, &size);
+      if (!ptr || size > (uint64_t)(end - ptr)) return NULL;
+      field->val.str_val = upb_StringView_FromDataAndSize(ptr, size);
+      return ptr + size;
+    }
+    case kUpb_WireType_StartGroup:
+      return upb_WireScanner_ReadGroup(ptr, end, number, &field->val.str_val,
+                                       depth_limit);
+    default:
+      return NULL;  // Unmatched end group, or an invalid wire type.
+  }
+}
+
+bool upb_WireScanner_Next(upb_WireScanner* s, upb_WireField* field) {
+  if (s->ptr == s->end || s->malformed) return false;
+  uint32_t number;
+  upb_WireType wire_type;
+  const char* ptr = upb_WireScanner_ReadTag(s->ptr, s->end, &number,
+                                            &wire_type);
+  if (ptr) {
+    ptr = upb_WireScanner_ReadValue(ptr, s->end, number, wire_type, field,
+                                    kUpb_WireScanner_GroupDepthLimit);
+  }
+  if (!ptr) {
+    s->malformed = true;
+    return false;
+  }
+  s->ptr = ptr;
+  return true;
+}
+
+upb_WireScanStatus upb_WireScanner_FindPath(const char* buf, size_t size,
+                                            const uint32_t* path,
+                                            size_t path_size,
+                                            upb_WireField* field) {
+  if (path_size == 0) return kUpb_WireScanStatus_NotFound;
+  upb_WireScanStatus ret = kUpb_WireScanStatus_NotFound;
+  upb_WireScanner s;
+  upb_WireScanner_Init(&s, buf, size);
+  upb_WireField f;
+  while (upb_WireScanner_Next(&s, &f)) {
+    if (f.number != path[0]) continue;
+    if (path_size == 1) {
+      *field = f;
+      ret = kUpb_WireScanStatus_Found;
+    } else if (f.wire_type == kUpb_WireType_Delimited ||
+               f.wire_type == kUpb_WireType_StartGroup) {
+      switch (upb_WireScanner_FindPath(f.val.str_val.data, f.val.str_val.size,
+                                       path + 1, path_size - 1, field)) {
+        case kUpb_WireScanStatus_Found:
+          ret = kUpb_WireScanStatus_Found;
+          break;
+        case kUpb_WireScanStatus_NotFound:
+          break;
+        case kUpb_WireScanStatus_Malformed:
+          return kUpb_WireScanStatus_Malformed;
+      }
+    }
+  }
+  if (upb_WireScanner_IsMalformed(&s)) return kUpb_WireScanStatus_Malformed;
+  return ret;
+}
@@ -0,0 +1,114 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// upb_WireScanner: iterating over the fields of a serialized message.
+//
+// Unlike upb_Decode(), the scanner needs no MiniTable and no arena, and it
+// never allocates.  It reports each field of a buffer in wire order with its
+// raw value; nested messages are reported as a byte range that can be scanned
+// in turn, only if the caller is interested in them:
+//
+//   upb_WireScanner s;
+//   upb_WireScanner_Init(&s, buf, size);
+//   upb_WireField field;
+//   while (upb_WireScanner_Next(&s, &field)) {
+//     if (field.number == 3 && field.wire_type == kUpb_WireType_Delimited) {
+//       upb_WireScanner sub;
+//       upb_WireScanner_Init(&sub, field.val.str_val.data,
+//                            field.val.str_val.size);
+//       ...
+//     }
+//   }
+//   if (upb_WireScanner_IsMalformed(&s)) ...
+//
+// The input is only checked as far as the wire format goes: the contents of
+// delimited fields are not validated until they are scanned.
+
+#ifndef UPB_WIRE_SCAN_H_
+#define UPB_WIRE_SCAN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "upb/base/string_view.h"
+#include "upb/wire/types.h"
+
+// Must be last.
+#include "upb/port/def.inc"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  uint32_t number;
+  upb_WireType wire_type;  // Never kUpb_WireType_EndGroup.
+  union {
+    // kUpb_WireType_Varint, kUpb_WireType_32Bit and kUpb_WireType_64Bit.  The
+    // value is not zigzag decoded, and 32-bit values are zero extended.
+    uint64_t int_val;
+    // kUpb_WireType_Delimited, or the body of a group without its end tag
+    // for kUpb_WireType_StartGroup.  Points into the scanned buffer.
+    upb_StringView str_val;
+  } val;
+} upb_WireField;
+
+typedef struct {
+  const char* ptr;
+  const char* end;
+  bool malformed;
+} upb_WireScanner;
+
+// Starts scanning the `size` bytes at `buf`, which must outlive the scanner
+// and the fields it returns.
+UPB_INLINE void upb_WireScanner_Init(upb_WireScanner* s, const char* buf,
+                                     size_t size) {
+  s->ptr = buf;
+  s->end = buf + size;
+  s->malformed = false;
+}
+
+// Reads the next field into `field`.  Returns false at the end of the input,
+// or if the input is malformed, in which case the scanner stays at the
+// malformed field.
+UPB_API bool upb_WireScanner_Next(upb_WireScanner* s, upb_WireField* field);
+
+// Returns true if upb_WireScanner_Next() stopped at malformed input.
+UPB_INLINE bool upb_WireScanner_IsMalformed(const upb_WireScanner* s) {
+  return s->malformed;
+}
+
+typedef enum {
+  kUpb_WireScanStatus_Found = 0,
+  kUpb_WireScanStatus_NotFound = 1,
+  kUpb_WireScanStatus_Malformed = 2,
+} upb_WireScanStatus;
+
+// Finds the field at `path` in the message serialized in `buf`, where
+// path[0] is a field number in the message, path[1] a field number in that
+// submessage, and so on.  For example {3, 7, 1} is field 1 of field 7 of
+// field 3.
+//
+// Like a parser merging repeated occurrences, the last occurrence of the
+// field wins, searching every occurrence of the submessages along the path.
+// Submessages may be delimited fields or groups.  Only the fields that lead
+// to the path are scanned; the rest of the input is skipped.  The fields
+// along the path, except the last one, must be submessages: if they are
+// strings, their contents are scanned as if they were messages.
+UPB_API upb_WireScanStatus upb_WireScanner_FindPath(const char* buf,
+                                                    size_t size,
+                                                    const uint32_t* path,
+                                                    size_t path_size,
+                                                    upb_WireField* field);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#include "upb/port/undef.inc"
+
+#endif /* UPB_WIRE_SCAN_H_ */
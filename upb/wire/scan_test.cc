@@ -0,0 +1,167 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2023 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "upb/wire/scan.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/test_messages_proto3.upb.h"
+#include "upb/base/string_view.h"
+#include "upb/mem/arena.hpp"
+#include "upb/wire/types.h"
+
+namespace {
+
+typedef protobuf_test_messages_proto3_TestAllTypesProto3 TestAllTypes;
+typedef protobuf_test_messages_proto3_TestAllTypesProto3_NestedMessage
+    NestedMessage;
+
+std::string ToString(upb_StringView view) {
+  return std::string(view.data, view.size);
+}
+
+TEST(WireScannerTest, ScansFields) {
+  // 1: 150, 2: "ab", 3: fixed32 1, 4: fixed64 -1, 5: group { 1: 1 }.
+  const std::string data(
+      "\x08\x96\x01"
+      "\x12\x02"
+      "ab"
+      "\x1d\x01\x00\x00\x00"
+      "\x21\xff\xff\xff\xff\xff\xff\xff\xff"
+      "\x2b\x08\x01\x2c",
+      25);
+  upb_WireScanner s;
+  upb_WireScanner_Init(&s, data.data(), data.size());
+  upb_WireField field;
+
+  ASSERT_TRUE(upb_WireScanner_Next(&s, &field));
+  EXPECT_EQ(1, field.number);
+  EXPECT_EQ(kUpb_WireType_Varint, field.wire_type);
+  EXPECT_EQ(150, field.val.int_val);
+
+  ASSERT_TRUE(upb_WireScanner_Next(&s, &field));
+  EXPECT_EQ(2, field.number);
+  EXPECT_EQ(kUpb_WireType_Delimited, field.wire_type);
+  EXPECT_EQ("ab", ToString(field.val.str_val));
+
+  ASSERT_TRUE(upb_WireScanner_Next(&s, &field));
+  EXPECT_EQ(3, field.number);
+  EXPECT_EQ(kUpb_WireType_32Bit, field.wire_type);
+  EXPECT_EQ(1, field.val.int_val);
+
+  ASSERT_TRUE(upb_WireScanner_Next(&s, &field));
+  EXPECT_EQ(4, field.number);
+  EXPECT_EQ(kUpb_WireType_64Bit, field.wire_type);
+  EXPECT_EQ(UINT64_MAX, field.val.int_val);
+
+  ASSERT_TRUE(upb_WireScanner_Next(&s, &field));
+  EXPECT_EQ(5, field.number);
+  EXPECT_EQ(kUpb_WireType_StartGroup, field.wire_type);
+  EXPECT_EQ(std::string("\x08\x01"), ToString(field.val.str_val));
+
+  EXPECT_FALSE(upb_WireScanner_Next(&s, &field));
+  EXPECT_FALSE(upb_WireScanner_IsMalformed(&s));
+}
+
+TEST(WireScannerTest, Malformed) {
+  for (const std::string& data : {
+           std::string("\x08", 1),              // Missing value.
+           std::string("\x08\x80", 2),          // Truncated varint.
+           std::string("\x12\x03" "ab", 4),     // Truncated string.
+           std::string("\x1d\x01\x00", 3),      // Truncated fixed32.
+           std::string("\x00\x01", 2),          // Field number 0.
+           std::string("\x0c", 1),              // Unmatched end group.
+           std::string("\x0b\x08\x01", 3),      // Unterminated group.
+           std::string("\x0b\x14", 2),          // Mismatched end group.
+           std::string("\x0e\x01", 2),          // Invalid wire type.
+       }) {
+    upb_WireScanner s;
+    upb_WireScanner_Init(&s, data.data(), data.size());
+    upb_WireField field;
+    EXPECT_FALSE(upb_WireScanner_Next(&s, &field));
+    EXPECT_TRUE(upb_WireScanner_IsMalformed(&s));
+    EXPECT_FALSE(upb_WireScanner_Next(&s, &field));
+
+    const uint32_t path[] = {1};
+    EXPECT_EQ(kUpb_WireScanStatus_Malformed,
+              upb_WireScanner_FindPath(data.data(), data.size(), path, 1,
+                                       &field));
+  }
+}
+
+TEST(WireScannerTest, FindPath) {
+  upb::Arena arena;
+  TestAllTypes* msg =
+      protobuf_test_messages_proto3_TestAllTypesProto3_new(arena.ptr());
+  protobuf_test_messages_proto3_TestAllTypesProto3_set_optional_int32(msg, 5);
+  NestedMessage* nested =
+      protobuf_test_messages_proto3_TestAllTypesProto3_mutable_optional_nested_message(
+          msg, arena.ptr());
+  protobuf_test_messages_proto3_TestAllTypesProto3_NestedMessage_set_a(nested,
+                                                                       7);
+  TestAllTypes* corecursive =
+      protobuf_test_messages_proto3_TestAllTypesProto3_NestedMessage_mutable_corecursive(
+          nested, arena.ptr());
+  protobuf_test_messages_proto3_TestAllTypesProto3_set_optional_string(
+      corecursive, upb_StringView_FromString("key"));
+  size_t size;
+  char* data = protobuf_test_messages_proto3_TestAllTypesProto3_serialize(
+      msg, arena.ptr(), &size);
+  ASSERT_TRUE(data != nullptr);
+
+  upb_WireField field;
+  const uint32_t int32_path[] = {1};
+  ASSERT_EQ(kUpb_WireScanStatus_Found,
+            upb_WireScanner_FindPath(data, size, int32_path, 1, &field));
+  EXPECT_EQ(5, field.val.int_val);
+
+  const uint32_t a_path[] = {18, 1};
+  ASSERT_EQ(kUpb_WireScanStatus_Found,
+            upb_WireScanner_FindPath(data, size, a_path, 2, &field));
+  EXPECT_EQ(7, field.val.int_val);
+
+  const uint32_t string_path[] = {18, 2, 14};
+  ASSERT_EQ(kUpb_WireScanStatus_Found,
+            upb_WireScanner_FindPath(data, size, string_path, 3, &field));
+  EXPECT_EQ(kUpb_WireType_Delimited, field.wire_type);
+  EXPECT_EQ("key", ToString(field.val.str_val));
+
+  const uint32_t missing_path[] = {18, 2, 1};
+  EXPECT_EQ(kUpb_WireScanStatus_NotFound,
+            upb_WireScanner_FindPath(data, size, missing_path, 3, &field));
+  // A scalar along the path has no fields.
+  const uint32_t scalar_path[] = {1, 1};
+  EXPECT_EQ(kUpb_WireScanStatus_NotFound,
+            upb_WireScanner_FindPath(data, size, scalar_path, 2, &field));
+}
+
+TEST(WireScannerTest, FindPathLastOccurrenceWins) {
+  // 1: { 2: 1 }, 1: group { 2: 2 }, 1: { 3: 3 }
+  const std::string data(
+      "\x0a\x02\x10\x01"
+      "\x0b\x10\x02\x0c"
+      "\x0a\x02\x18\x03",
+      12);
+  upb_WireField field;
+  const uint32_t path[] = {1, 2};
+  ASSERT_EQ(kUpb_WireScanStatus_Found,
+            upb_WireScanner_FindPath(data.data(), data.size(), path, 2,
+                                     &field));
+  EXPECT_EQ(2, field.val.int_val);
+
+  // Malformed input after the field is still an error.
+  const std::string truncated = data + std::string("\x0a\x05", 2);
+  EXPECT_EQ(kUpb_WireScanStatus_Malformed,
+            upb_WireScanner_FindPath(truncated.data(), truncated.size(), path,
+                                     2, &field));
+}
+
+}  // namespace